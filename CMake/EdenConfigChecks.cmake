@@ -52,6 +52,15 @@ find_package(OpenSSL MODULE REQUIRED)
 find_package(SELinux)
 set(EDEN_HAVE_SELINUX ${SELINUX_FOUND})
 
+# liburing is optional.  Without it FuseChannel only supports the
+# blocking read() request loop.
+if(CMAKE_SYSTEM_NAME STREQUAL "Linux")
+  find_package(LibUring MODULE)
+  set(EDEN_HAVE_LIBURING ${LibUring_FOUND})
+else()
+  set(EDEN_HAVE_LIBURING OFF)
+endif()
+
 if("${ENABLE_GIT}" STREQUAL "AUTO")
   find_package(LibGit2 MODULE)
   set(EDEN_HAVE_GIT "${LibGit2_FOUND}")
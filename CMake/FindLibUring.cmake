@@ -0,0 +1,27 @@
+# Copyright (c) Facebook, Inc. and its affiliates.
+#
+# This software may be used and distributed according to the terms of the
+# GNU General Public License version 2.
+
+include(FindPackageHandleStandardArgs)
+
+find_path(LIBURING_INCLUDE_DIR NAMES liburing.h)
+find_library(LIBURING_LIBRARY NAMES uring)
+find_package_handle_standard_args(
+  LibUring
+  DEFAULT_MSG
+  LIBURING_INCLUDE_DIR
+  LIBURING_LIBRARY
+)
+
+if(LibUring_FOUND)
+  add_library(LibUring::uring UNKNOWN IMPORTED)
+  set_target_properties(
+    LibUring::uring PROPERTIES
+    INTERFACE_INCLUDE_DIRECTORIES "${LIBURING_INCLUDE_DIR}"
+    IMPORTED_LINK_INTERFACE_LANGUAGES "C"
+    IMPORTED_LOCATION "${LIBURING_LIBRARY}"
+  )
+endif()
+
+mark_as_advanced(LIBURING_INCLUDE_DIR LIBURING_LIBRARY)
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/benchharness/AllocationCounter.h"
+#include <folly/Conv.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+
+namespace facebook {
+namespace eden {
+
+namespace {
+
+// Plain thread_local data needs no dynamic initialization, so it is safe to
+// touch from operator new at any point in a thread's life.
+thread_local AllocationCounts threadAllocations;
+
+void* countedAllocate(size_t size) noexcept {
+  ++threadAllocations.allocations;
+  threadAllocations.bytes += size;
+  return malloc(size ? size : 1);
+}
+
+void* countedAlignedAllocate(size_t size, size_t alignment) noexcept {
+  ++threadAllocations.allocations;
+  threadAllocations.bytes += size;
+  void* p = nullptr;
+  if (posix_memalign(
+          &p, std::max(alignment, sizeof(void*)), size ? size : 1) != 0) {
+    return nullptr;
+  }
+  return p;
+}
+
+void* allocateOrThrow(void* p) {
+  if (!p) {
+    throw std::bad_alloc{};
+  }
+  return p;
+}
+
+} // namespace
+
+AllocationCounts getThreadAllocationCounts() noexcept {
+  return threadAllocations;
+}
+
+void AllocationAccumulator::addTo(
+    BenchmarkReport& report,
+    folly::StringPiece scope) const {
+  report.metric(folly::to<std::string>(scope, " allocations"), "count")
+      .combine(allocations_);
+  report.metric(folly::to<std::string>(scope, " allocated bytes"), "bytes")
+      .combine(bytes_);
+}
+
+} // namespace eden
+} // namespace facebook
+
+using facebook::eden::allocateOrThrow;
+using facebook::eden::countedAlignedAllocate;
+using facebook::eden::countedAllocate;
+
+void* operator new(size_t size) {
+  return allocateOrThrow(countedAllocate(size));
+}
+
+void* operator new[](size_t size) {
+  return allocateOrThrow(countedAllocate(size));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return countedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return countedAllocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  return allocateOrThrow(
+      countedAlignedAllocate(size, static_cast<size_t>(alignment)));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return allocateOrThrow(
+      countedAlignedAllocate(size, static_cast<size_t>(alignment)));
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+  free(p);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <stdint.h>
+
+#include "eden/fs/benchharness/Bench.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Heap allocations made by one thread.
+ *
+ * Linking AllocationCounter.cpp into a benchmark replaces the global operator
+ * new and delete with versions that count every allocation the calling
+ * thread makes, along with the bytes it asked for.  Allocations made directly
+ * with malloc() are not counted.
+ */
+struct AllocationCounts {
+  uint64_t allocations{0};
+  uint64_t bytes{0};
+
+  AllocationCounts operator-(const AllocationCounts& other) const {
+    return AllocationCounts{allocations - other.allocations,
+                            bytes - other.bytes};
+  }
+};
+
+/**
+ * Returns the allocations made by the calling thread since it started.
+ */
+AllocationCounts getThreadAllocationCounts() noexcept;
+
+/**
+ * Accumulates the allocations made by each operation of a named scope, such
+ * as "LocalStore::getTree".
+ *
+ * This type is a monoid, so each thread of a benchmark can keep its own and
+ * combine them afterwards.
+ */
+class AllocationAccumulator {
+ public:
+  void add(AllocationCounts counts) {
+    allocations_.add(counts.allocations);
+    bytes_.add(counts.bytes);
+  }
+
+  void combine(const AllocationAccumulator& other) {
+    allocations_.combine(other.allocations_);
+    bytes_.combine(other.bytes_);
+  }
+
+  /**
+   * Adds the "<scope> allocations" and "<scope> allocated bytes" metrics,
+   * measured per operation, to report.
+   */
+  void addTo(BenchmarkReport& report, folly::StringPiece scope) const;
+
+ private:
+  HistogramAccumulator allocations_;
+  HistogramAccumulator bytes_;
+};
+
+/**
+ * Adds the allocations the current thread makes during its lifetime to an
+ * AllocationAccumulator as one operation.
+ *
+ * Work the scope hands off to other threads, such as future callbacks run on
+ * an executor, is not counted; benchmarks that want it counted should drive
+ * that executor from the measuring thread.
+ */
+class AllocationScope {
+ public:
+  explicit AllocationScope(AllocationAccumulator& accumulator) noexcept
+      : accumulator_{accumulator}, start_{getThreadAllocationCounts()} {}
+
+  ~AllocationScope() {
+    accumulator_.add(getThreadAllocationCounts() - start_);
+  }
+
+  AllocationScope(const AllocationScope&) = delete;
+  AllocationScope& operator=(const AllocationScope&) = delete;
+
+ private:
+  AllocationAccumulator& accumulator_;
+  AllocationCounts start_;
+};
+
+} // namespace eden
+} // namespace facebook
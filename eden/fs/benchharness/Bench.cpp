@@ -6,13 +6,228 @@
  */
 
 #include "eden/fs/benchharness/Bench.h"
+#include <folly/FileUtil.h>
+#include <folly/json.h>
+#include <gflags/gflags.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <time.h>
+#include <cmath>
+
+DEFINE_uint64(bench_runs, 1, "How many times to run the benchmark");
+DEFINE_string(
+    bench_json,
+    "",
+    "If set, write the benchmark results as JSON to this file");
+DEFINE_string(
+    bench_baseline,
+    "",
+    "If set, compare the results against the JSON results in this file");
+DEFINE_uint64(
+    bench_regression_percent,
+    10,
+    "How much slower than --bench_baseline a result may be before it is "
+    "reported as a regression");
 
 namespace facebook {
 namespace eden {
 
+namespace {
+constexpr std::pair<const char*, double> kReportedPercentiles[] = {
+    {"p50", 0.5},
+    {"p90", 0.9},
+    {"p99", 0.99},
+};
+
+// The statistics compared against a baseline.
+constexpr const char* kComparedStats[] = {"p50", "p99"};
+} // namespace
+
+HistogramAccumulator::HistogramAccumulator()
+    : buckets_(getBucketIndex(std::numeric_limits<uint64_t>::max()) + 1) {}
+
+void HistogramAccumulator::combine(const HistogramAccumulator& other) {
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+  minimum_ = std::min(minimum_, other.minimum_);
+  maximum_ = std::max(maximum_, other.maximum_);
+  total_ += other.total_;
+  sumOfSquares_ += other.sumOfSquares_;
+  count_ += other.count_;
+}
+
+double HistogramAccumulator::getStandardDeviation() const {
+  if (count_ == 0) {
+    return 0;
+  }
+  double mean = static_cast<double>(total_) / count_;
+  return std::sqrt(std::max(0.0, sumOfSquares_ / count_ - mean * mean));
+}
+
+uint64_t HistogramAccumulator::getPercentile(double fraction) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  auto rank = std::max<uint64_t>(1, std::ceil(fraction * count_));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::clamp(getBucketMaximum(i), getMinimum(), maximum_);
+    }
+  }
+  return maximum_;
+}
+
+uint64_t HistogramAccumulator::getBucketMaximum(size_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  auto shift = index / kSubBuckets - 1;
+  auto subBucket = index % kSubBuckets + kSubBuckets;
+  // Wraps around to the largest uint64_t for the last bucket.
+  return (uint64_t{subBucket + 1} << shift) - 1;
+}
+
+HistogramAccumulator& BenchmarkReport::metric(
+    folly::StringPiece name,
+    folly::StringPiece unit) {
+  for (auto& metric : metrics_) {
+    if (metric.name == name) {
+      return metric.histogram;
+    }
+  }
+  metrics_.push_back(Metric{name.str(), unit.str(), {}});
+  return metrics_.back().histogram;
+}
+
+void BenchmarkReport::combine(const BenchmarkReport& other) {
+  for (const auto& metric : other.metrics_) {
+    this->metric(metric.name, metric.unit).combine(metric.histogram);
+  }
+}
+
+void BenchmarkReport::print(FILE* file) const {
+  for (const auto& metric : metrics_) {
+    const auto& histogram = metric.histogram;
+    const auto* unit = metric.unit.c_str();
+    fprintf(file, "%s\n", metric.name.c_str());
+    fprintf(file, "  samples: %" PRIu64 "\n", histogram.getCount());
+    fprintf(file, "  minimum: %" PRIu64 " %s\n", histogram.getMinimum(), unit);
+    fprintf(file, "  average: %" PRIu64 " %s\n", histogram.getAverage(), unit);
+    for (auto [label, fraction] : kReportedPercentiles) {
+      fprintf(
+          file,
+          "  %s: %" PRIu64 " %s\n",
+          label,
+          histogram.getPercentile(fraction),
+          unit);
+    }
+    fprintf(file, "  maximum: %" PRIu64 " %s\n", histogram.getMaximum(), unit);
+    fprintf(
+        file, "  stddev: %.1f %s\n", histogram.getStandardDeviation(), unit);
+  }
+}
+
+folly::dynamic BenchmarkReport::toDynamic() const {
+  auto metrics = folly::dynamic::object();
+  for (const auto& metric : metrics_) {
+    const auto& histogram = metric.histogram;
+    auto stats = folly::dynamic::object("unit", metric.unit)(
+        "count", histogram.getCount())("min", histogram.getMinimum())(
+        "avg", histogram.getAverage())("max", histogram.getMaximum())(
+        "stddev", histogram.getStandardDeviation());
+    for (auto [label, fraction] : kReportedPercentiles) {
+      stats[label] = histogram.getPercentile(fraction);
+    }
+    metrics[metric.name] = std::move(stats);
+  }
+  return folly::dynamic::object("benchmark", name_)(
+      "metrics", std::move(metrics));
+}
+
+namespace {
+/**
+ * Prints every compared statistic of results that is worse than the
+ * baseline by more than the allowed regression, and returns how many were.
+ */
+size_t compareToBaseline(
+    const folly::dynamic& results,
+    const folly::dynamic& baseline) {
+  size_t regressions = 0;
+  auto limit = 1.0 + FLAGS_bench_regression_percent / 100.0;
+  for (const auto& [name, stats] : results["metrics"].items()) {
+    const auto* baselineStats = baseline["metrics"].get_ptr(name);
+    if (!baselineStats) {
+      fprintf(stderr, "%s: not in the baseline\n", name.c_str());
+      continue;
+    }
+    for (const auto* stat : kComparedStats) {
+      const auto* baselineValue = baselineStats->get_ptr(stat);
+      if (!baselineValue) {
+        continue;
+      }
+      auto value = stats[stat].asDouble();
+      auto limitValue = baselineValue->asDouble() * limit;
+      bool regressed = value > limitValue;
+      fprintf(
+          regressed ? stderr : stdout,
+          "%s %s: %.0f vs baseline %.0f%s\n",
+          name.c_str(),
+          stat,
+          value,
+          baselineValue->asDouble(),
+          regressed ? " (REGRESSION)" : "");
+      regressions += regressed;
+    }
+  }
+  return regressions;
+}
+} // namespace
+
+int runBenchmark(
+    folly::StringPiece name,
+    folly::FunctionRef<void(BenchmarkReport&)> benchmark) {
+  BenchmarkReport report{name};
+  for (uint64_t run = 0; run < std::max<uint64_t>(1, FLAGS_bench_runs);
+       ++run) {
+    BenchmarkReport runReport{name};
+    benchmark(runReport);
+    report.combine(runReport);
+  }
+  report.print(stdout);
+
+  auto results = report.toDynamic();
+  results["runs"] = FLAGS_bench_runs;
+  if (!FLAGS_bench_json.empty()) {
+    auto json = folly::toPrettyJson(results);
+    if (!folly::writeFile(json, FLAGS_bench_json.c_str())) {
+      perror("failed to write --bench_json");
+      return 1;
+    }
+  }
+
+  if (FLAGS_bench_baseline.empty()) {
+    return 0;
+  }
+  std::string baselineJson;
+  if (!folly::readFile(FLAGS_bench_baseline.c_str(), baselineJson)) {
+    perror("failed to read --bench_baseline");
+    return 1;
+  }
+  auto regressions = compareToBaseline(results, folly::parseJson(baselineJson));
+  if (regressions > 0) {
+    fprintf(
+        stderr,
+        "%zu results regressed by more than %" PRIu64 "%%\n",
+        regressions,
+        FLAGS_bench_regression_percent);
+    return 1;
+  }
+  return 0;
+}
+
 uint64_t getTime() noexcept {
   timespec ts;
   // CLOCK_MONOTONIC is subject in NTP adjustments. CLOCK_MONOTONIC_RAW would be
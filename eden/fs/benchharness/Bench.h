@@ -7,11 +7,18 @@
 
 #pragma once
 
+#include <folly/Function.h>
+#include <folly/Range.h>
+#include <folly/dynamic.h>
+#include <folly/lang/Bits.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <algorithm>
 #include <condition_variable>
 #include <limits>
 #include <mutex>
+#include <string>
+#include <vector>
 
 namespace facebook {
 namespace eden {
@@ -49,6 +56,134 @@ class StatAccumulator {
   uint64_t count_{0};
 };
 
+/**
+ * Accumulates data points into a histogram, tracking their distribution as
+ * well as their average, minimum and maximum.
+ *
+ * Values are counted in buckets that are within about 3% of each other, so
+ * percentiles are approximate but the memory used does not grow with the
+ * number of data points.
+ *
+ * This type is a monoid.
+ */
+class HistogramAccumulator {
+ public:
+  HistogramAccumulator();
+
+  void add(uint64_t value) {
+    ++buckets_[getBucketIndex(value)];
+    minimum_ = std::min(minimum_, value);
+    maximum_ = std::max(maximum_, value);
+    total_ += value;
+    sumOfSquares_ += static_cast<double>(value) * value;
+    ++count_;
+  }
+
+  void combine(const HistogramAccumulator& other);
+
+  uint64_t getCount() const {
+    return count_;
+  }
+
+  uint64_t getMinimum() const {
+    return count_ ? minimum_ : 0;
+  }
+
+  uint64_t getMaximum() const {
+    return maximum_;
+  }
+
+  uint64_t getAverage() const {
+    return count_ ? total_ / count_ : 0;
+  }
+
+  double getStandardDeviation() const;
+
+  /**
+   * Returns the value that the given fraction (from 0.0 to 1.0) of the data
+   * points are at or below, rounded up to the top of its bucket.
+   */
+  uint64_t getPercentile(double fraction) const;
+
+ private:
+  static constexpr unsigned kSubBucketBits = 5;
+  static constexpr size_t kSubBuckets = size_t{1} << kSubBucketBits;
+
+  /**
+   * Values below kSubBuckets get a bucket each.  Every larger power of two is
+   * split into kSubBuckets buckets.
+   */
+  static size_t getBucketIndex(uint64_t value) {
+    if (value < kSubBuckets) {
+      return value;
+    }
+    auto shift = folly::findLastSet(value) - 1 - kSubBucketBits;
+    return kSubBuckets * (shift + 1) + ((value >> shift) - kSubBuckets);
+  }
+
+  static uint64_t getBucketMaximum(size_t index);
+
+  std::vector<uint64_t> buckets_;
+  uint64_t minimum_{std::numeric_limits<uint64_t>::max()};
+  uint64_t maximum_{0};
+  uint64_t total_{0};
+  uint64_t count_{0};
+  double sumOfSquares_{0};
+};
+
+/**
+ * The named metrics recorded by a benchmark, which can be printed for people
+ * or emitted as JSON for tools.
+ *
+ * This type is a monoid: combining reports combines their metrics by name.
+ */
+class BenchmarkReport {
+ public:
+  explicit BenchmarkReport(folly::StringPiece name) : name_{name.str()} {}
+
+  /**
+   * Returns the histogram for the named metric, measured in unit (e.g. "ns"),
+   * adding it if this is the first time it is used.  Metrics are printed in
+   * the order they were added.
+   */
+  HistogramAccumulator& metric(
+      folly::StringPiece name,
+      folly::StringPiece unit);
+
+  void combine(const BenchmarkReport& other);
+
+  void print(FILE* file) const;
+
+  /**
+   * Returns the report as an object of the form
+   *   {"benchmark": name, "metrics": {metric: {"unit": ..., "p50": ...}}}
+   */
+  folly::dynamic toDynamic() const;
+
+ private:
+  struct Metric {
+    std::string name;
+    std::string unit;
+    HistogramAccumulator histogram;
+  };
+
+  std::string name_;
+  std::vector<Metric> metrics_;
+};
+
+/**
+ * Runs a benchmark --bench_runs times, combining the metrics it records into
+ * the report passed to each run.  The combined report is printed to stdout,
+ * written as JSON to --bench_json if set, and compared against the JSON
+ * report in --bench_baseline if set.
+ *
+ * Returns the exit status for main(): 1 if any metric's p50 or p99 is more
+ * than --bench_regression_percent above the baseline, and 0 otherwise.
+ */
+int runBenchmark(
+    folly::StringPiece name,
+    folly::FunctionRef<void(BenchmarkReport&)> benchmark);
+
 /**
  * Returns the current time in nanoseconds since some epoch. A fast timer
  * suitable for benchmarking short operations.
@@ -8,14 +8,15 @@
 #include <benchmark/benchmark.h>
 #include <boost/filesystem.hpp>
 #include <folly/File.h>
-#include <folly/container/Array.h>
+#include <folly/String.h>
 #include <folly/init/Init.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/net/NetworkSocket.h>
 #include <folly/synchronization/test/Barrier.h>
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
 #include <iostream>
-#include <numeric>
+#include <map>
+#include <random>
 #include <thread>
 #include <vector>
 
@@ -27,6 +28,130 @@ using namespace boost::filesystem;
 
 DEFINE_uint64(threads, 1, "The number of concurrent Thrift client threads");
 DEFINE_string(repo, "", "Path to Eden repository");
+DEFINE_uint64(samples, 131072, "Thrift calls made by each client thread");
+DEFINE_string(
+    mix,
+    "getSHA1=1",
+    "Comma-separated METHOD=WEIGHT pairs giving the share of calls made to "
+    "each method.  Supported methods are getSHA1, getFileInformation, "
+    "globFiles, getScmStatusV2, getFilesChangedSince and "
+    "getCurrentJournalPosition.");
+DEFINE_string(
+    globs,
+    "**/*",
+    "Comma-separated glob patterns passed to globFiles; keep them narrow "
+    "enough for the repository");
+DEFINE_string(
+    server_counters,
+    "",
+    "Comma-separated substrings of server counter names, from getStatInfo, "
+    "whose change over each run is reported");
+
+namespace {
+
+enum class Method {
+  GetSHA1,
+  GetFileInformation,
+  GlobFiles,
+  GetScmStatusV2,
+  GetFilesChangedSince,
+  GetCurrentJournalPosition,
+};
+
+constexpr std::pair<folly::StringPiece, Method> kMethods[] = {
+    {"getSHA1", Method::GetSHA1},
+    {"getFileInformation", Method::GetFileInformation},
+    {"globFiles", Method::GlobFiles},
+    {"getScmStatusV2", Method::GetScmStatusV2},
+    {"getFilesChangedSince", Method::GetFilesChangedSince},
+    {"getCurrentJournalPosition", Method::GetCurrentJournalPosition},
+};
+
+folly::StringPiece getMethodName(Method method) {
+  for (const auto& [name, value] : kMethods) {
+    if (value == method) {
+      return name;
+    }
+  }
+  return "unknown";
+}
+
+/**
+ * Parses --mix into the methods to call and their relative weights.
+ */
+std::vector<std::pair<Method, double>> parseMix(folly::StringPiece mix) {
+  std::vector<folly::StringPiece> entries;
+  folly::split(',', mix, entries, /*ignoreEmpty=*/true);
+  std::vector<std::pair<Method, double>> result;
+  for (auto entry : entries) {
+    folly::StringPiece name;
+    folly::StringPiece weight;
+    if (!folly::split('=', entry, name, weight)) {
+      throw std::invalid_argument(
+          folly::to<std::string>("expected METHOD=WEIGHT in --mix: ", entry));
+    }
+    auto it = std::find_if(
+        std::begin(kMethods), std::end(kMethods), [&](const auto& method) {
+          return method.first == name;
+        });
+    if (it == std::end(kMethods)) {
+      throw std::invalid_argument(
+          folly::to<std::string>("unknown method in --mix: ", name));
+    }
+    result.emplace_back(it->second, folly::to<double>(weight));
+  }
+  return result;
+}
+
+std::unique_ptr<EdenServiceAsyncClient> connectClient(
+    folly::EventBase& eventBase,
+    const path& socket_path) {
+  auto sock_fd = socket(AF_LOCAL, SOCK_STREAM, 0);
+  if (sock_fd == -1) {
+    perror("Failed to create socket");
+    return nullptr;
+  }
+  struct sockaddr_un addr;
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socket_path.c_str(), 108);
+  addr.sun_path[107] = '\0';
+  auto rc = connect(sock_fd, (const struct sockaddr*)&addr, sizeof(addr));
+  if (rc == -1) {
+    perror("Failed to connect to socket");
+    close(sock_fd);
+    return nullptr;
+  }
+  auto socket = folly::AsyncSocket::newSocket(
+      &eventBase, folly::NetworkSocket::fromFd(sock_fd));
+  auto channel = folly::to_shared_ptr(
+      apache::thrift::HeaderClientChannel::newChannel(socket));
+  return std::make_unique<EdenServiceAsyncClient>(channel);
+}
+
+/**
+ * Returns the server counters matching --server_counters.
+ */
+std::map<std::string, int64_t> getServerCounters(
+    EdenServiceAsyncClient& client,
+    const std::vector<std::string>& patterns) {
+  std::map<std::string, int64_t> counters;
+  if (patterns.empty()) {
+    return counters;
+  }
+  InternalStats stats;
+  client.sync_getStatInfo(stats);
+  for (const auto& [name, value] : stats.counters) {
+    for (const auto& pattern : patterns) {
+      if (name.find(pattern) != std::string::npos) {
+        counters.emplace(name, value);
+        break;
+      }
+    }
+  }
+  return counters;
+}
+
+} // namespace
 
 int main(int argc, char** argv) {
   folly::init(&argc, &argv);
@@ -42,6 +167,25 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  std::vector<std::pair<Method, double>> mix;
+  try {
+    mix = parseMix(FLAGS_mix);
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+  if (mix.empty()) {
+    std::cerr << "--mix must name at least one method" << std::endl;
+    return 1;
+  }
+  std::vector<double> weights;
+  bool needsFiles = false;
+  for (const auto& [method, weight] : mix) {
+    weights.push_back(weight);
+    needsFiles |= method == Method::GetSHA1 ||
+        method == Method::GetFileInformation;
+  }
+
   auto real_path = realpath(FLAGS_repo.c_str(), nullptr);
   if (!real_path) {
     perror("realpath on given repo failed");
@@ -56,77 +200,126 @@ int main(int argc, char** argv) {
     files.emplace_back(argv[i]);
   }
 
-  if (files.size() < FLAGS_threads) {
+  if (needsFiles && files.size() < FLAGS_threads) {
     std::cerr << "Must specify a set of files to query, at least one per thread"
               << std::endl;
     return 1;
   }
 
+  std::vector<std::string> globs;
+  folly::split(',', FLAGS_globs, globs, /*ignoreEmpty=*/true);
+  std::vector<std::string> counterPatterns;
+  folly::split(',', FLAGS_server_counters, counterPatterns, true);
+
   path repo_path = real_path;
   const auto socket_path = repo_path / ".eden" / "socket";
   const unsigned nthreads = FLAGS_threads;
-  const auto samples_per_thread = 131072;
-
-  std::vector<std::thread> threads;
-  folly::test::Barrier gate{static_cast<unsigned>(nthreads)};
-  std::vector<uint64_t> samples(nthreads * samples_per_thread);
-  for (unsigned i = 0; i < nthreads; ++i) {
-    threads.emplace_back(
-        [i, &gate, &socket_path, &repo_path, &samples, &files] {
-          // Setup a socket per-thread talking to eden
-          auto sock_fd = socket(AF_LOCAL, SOCK_STREAM, 0);
-          if (sock_fd == -1) {
-            perror("Failed to create socket");
-            return;
-          }
-          struct sockaddr_un addr;
-          addr.sun_family = AF_UNIX;
-          strncpy(addr.sun_path, socket_path.c_str(), 108);
-          addr.sun_path[107] = '\0';
-          auto rc =
-              connect(sock_fd, (const struct sockaddr*)&addr, sizeof(addr));
-          if (rc == -1) {
-            perror("Failed to connect to socket");
-            return;
-          }
-          folly::EventBase eventBase;
-          auto socket = folly::AsyncSocket::newSocket(
-              &eventBase, folly::NetworkSocket::fromFd(sock_fd));
-          auto channel = folly::to_shared_ptr(
-              apache::thrift::HeaderClientChannel::newChannel(socket));
-          auto client = std::make_unique<EdenServiceAsyncClient>(channel);
+  const auto mountPoint = repo_path.native();
 
+  folly::EventBase counterEventBase;
+  auto counterClient = connectClient(counterEventBase, socket_path);
+  if (!counterClient) {
+    return 1;
+  }
+
+  return runBenchmark("get_sha1_thrift", [&](BenchmarkReport& report) {
+    auto countersBefore = getServerCounters(*counterClient, counterPatterns);
+
+    std::vector<std::thread> threads;
+    folly::test::Barrier gate{static_cast<unsigned>(nthreads)};
+    std::vector<std::map<Method, HistogramAccumulator>> samples(nthreads);
+    for (unsigned i = 0; i < nthreads; ++i) {
+      threads.emplace_back([&, i] {
+        // Setup a socket per-thread talking to eden
+        folly::EventBase eventBase;
+        auto client = connectClient(eventBase, socket_path);
+        if (!client) {
           gate.wait();
-          for (auto j = 0; j < samples_per_thread; ++j) {
-            std::vector<SHA1Result> res;
-            auto start = getTime();
-            benchmark::DoNotOptimize(files[i]);
-            client->sync_getSHA1(res, repo_path.native(), {files[i]});
-            benchmark::DoNotOptimize(res);
-            auto duration = std::chrono::nanoseconds(getTime() - start);
-            samples[i * samples_per_thread + j] =
-                std::chrono::duration_cast<std::chrono::microseconds>(duration)
-                    .count();
+          return;
+        }
+
+        std::mt19937 rng{i};
+        std::discrete_distribution<size_t> pick{
+            weights.begin(), weights.end()};
+        JournalPosition position;
+        client->sync_getCurrentJournalPosition(position, mountPoint);
+        const std::string& file = needsFiles ? files[i] : mountPoint;
+
+        gate.wait();
+        for (uint64_t j = 0; j < FLAGS_samples; ++j) {
+          auto method = mix[pick(rng)].first;
+          auto start = getTime();
+          switch (method) {
+            case Method::GetSHA1: {
+              std::vector<SHA1Result> res;
+              benchmark::DoNotOptimize(file);
+              client->sync_getSHA1(res, mountPoint, {file});
+              benchmark::DoNotOptimize(res);
+              break;
+            }
+            case Method::GetFileInformation: {
+              std::vector<FileInformationOrError> res;
+              client->sync_getFileInformation(res, mountPoint, {file});
+              benchmark::DoNotOptimize(res);
+              break;
+            }
+            case Method::GlobFiles: {
+              GlobParams params;
+              params.mountPoint = mountPoint;
+              params.globs = globs;
+              Glob res;
+              client->sync_globFiles(res, params);
+              benchmark::DoNotOptimize(res);
+              break;
+            }
+            case Method::GetScmStatusV2: {
+              GetScmStatusParams params;
+              params.mountPoint = mountPoint;
+              params.commit = position.snapshotHash;
+              GetScmStatusResult res;
+              client->sync_getScmStatusV2(res, params);
+              benchmark::DoNotOptimize(res);
+              break;
+            }
+            case Method::GetFilesChangedSince: {
+              FileDelta res;
+              client->sync_getFilesChangedSince(res, mountPoint, position);
+              benchmark::DoNotOptimize(res);
+              break;
+            }
+            case Method::GetCurrentJournalPosition: {
+              JournalPosition res;
+              client->sync_getCurrentJournalPosition(res, mountPoint);
+              benchmark::DoNotOptimize(res);
+              break;
+            }
           }
-        });
-  }
+          auto duration = std::chrono::nanoseconds(getTime() - start);
+          samples[i][method].add(
+              std::chrono::duration_cast<std::chrono::microseconds>(duration)
+                  .count());
+        }
+      });
+    }
 
-  for (auto& thread : threads) {
-    thread.join();
-  }
+    for (auto& thread : threads) {
+      thread.join();
+    }
 
-  // calculate statistics
-  std::sort(samples.begin(), samples.end());
-  double avg =
-      std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
-  std::cout << "avg: " << avg << "us" << std::endl;
-  std::cout << "min: " << samples[0] << "us" << std::endl;
-  const auto nsamples = samples_per_thread * nthreads;
-  auto pct = folly::make_array(0.05, 0.5, 0.95);
-  for (const auto& p : pct) {
-    std::cout << "p" << static_cast<uint64_t>(p * 100) << ": "
-              << samples[p * nsamples] << "us" << std::endl;
-  }
+    for (const auto& threadSamples : samples) {
+      for (const auto& [method, histogram] : threadSamples) {
+        report.metric(folly::to<std::string>(getMethodName(method), "()"), "us")
+            .combine(histogram);
+      }
+    }
 
-  return 0;
+    auto countersAfter = getServerCounters(*counterClient, counterPatterns);
+    for (const auto& [name, value] : countersAfter) {
+      auto before = countersBefore.find(name);
+      auto delta =
+          value - (before == countersBefore.end() ? 0 : before->second);
+      report.metric(folly::to<std::string>("server ", name), "delta")
+          .add(std::max<int64_t>(delta, 0));
+    }
+  });
 }
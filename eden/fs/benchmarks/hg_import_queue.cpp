@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/init/Init.h>
+#include <folly/synchronization/test/Barrier.h>
+#include <gflags/gflags.h>
+#include <inttypes.h>
+#include <string.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/store/hg/HgImportRequest.h"
+#include "eden/fs/store/hg/HgImportRequestQueue.h"
+#include "eden/fs/telemetry/RequestMetricsScope.h"
+
+DEFINE_uint64(producers, 4, "The number of threads enqueueing requests");
+DEFINE_uint64(workers, 8, "The number of threads processing requests");
+DEFINE_uint64(requests, 10000, "Number of requests each producer enqueues");
+DEFINE_uint64(blob_weight, 8, "Relative share of blob import requests");
+DEFINE_uint64(tree_weight, 2, "Relative share of tree import requests");
+DEFINE_uint64(prefetch_weight, 1, "Relative share of prefetch requests");
+DEFINE_uint64(prefetch_size, 100, "Number of blobs in each prefetch request");
+DEFINE_double(
+    high_priority_fraction,
+    0.1,
+    "Fraction of blob and tree imports that have high priority; the rest "
+    "have normal priority and prefetches have low priority");
+DEFINE_uint64(batch_size, 1, "The most requests a worker takes at once");
+DEFINE_uint64(
+    max_prefetch_workers,
+    0,
+    "The most workers that process prefetches at once, or 0 for no limit");
+DEFINE_uint64(
+    batch_latency_us,
+    500,
+    "Simulated fixed cost of importing a batch, in microseconds");
+DEFINE_uint64(
+    request_latency_us,
+    50,
+    "Simulated cost of importing each request of a batch, in microseconds");
+
+using namespace facebook::eden;
+
+namespace {
+
+constexpr std::array<const char*, HgImportRequest::kTypeCount> kTypeNames{
+    "blob",
+    "tree",
+    "prefetch"};
+
+/**
+ * Collects samples in nanoseconds so that percentiles can be reported.
+ */
+struct Samples {
+  StatAccumulator stats;
+  std::vector<uint64_t> values;
+
+  void add(uint64_t value) {
+    stats.add(value);
+    values.push_back(value);
+  }
+
+  void combine(Samples other) {
+    stats.combine(other.stats);
+    values.insert(values.end(), other.values.begin(), other.values.end());
+  }
+
+  void print(const char* name) {
+    if (values.empty()) {
+      return;
+    }
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](double p) {
+      auto index = static_cast<size_t>(p * (values.size() - 1));
+      return values[index] / 1000;
+    };
+    printf(
+        "  %s: average %" PRIu64 " us, minimum %" PRIu64 " us, p50 %" PRIu64
+        " us, p90 %" PRIu64 " us, p99 %" PRIu64 " us, maximum %" PRIu64
+        " us\n",
+        name,
+        stats.getAverage() / 1000,
+        stats.getMinimum() / 1000,
+        percentile(0.5),
+        percentile(0.9),
+        percentile(0.99),
+        values.back() / 1000);
+  }
+};
+
+struct TypeSamples {
+  std::array<Samples, HgImportRequest::kTypeCount> wait;
+  std::array<Samples, HgImportRequest::kTypeCount> latency;
+
+  void combine(TypeSamples other) {
+    for (size_t type = 0; type < HgImportRequest::kTypeCount; ++type) {
+      wait[type].combine(std::move(other.wait[type]));
+      latency[type].combine(std::move(other.latency[type]));
+    }
+  }
+};
+
+/**
+ * Each request is identified by the index encoded in its hash, which is
+ * where its enqueue time is recorded.
+ */
+Hash indexHash(uint64_t index) {
+  std::array<uint8_t, Hash::RAW_SIZE> bytes = {0};
+  memcpy(bytes.data(), &index, sizeof(index));
+  return Hash{bytes};
+}
+
+uint64_t hashIndex(const Hash& hash) {
+  uint64_t index;
+  memcpy(&index, hash.getBytes().data(), sizeof(index));
+  return index;
+}
+
+uint64_t requestIndex(HgImportRequest& request) {
+  if (auto blob = request.getRequest<HgImportRequest::BlobImport>()) {
+    return hashIndex(blob->hash);
+  } else if (auto tree = request.getRequest<HgImportRequest::TreeImport>()) {
+    return hashIndex(tree->hash);
+  } else {
+    auto prefetch = request.getRequest<HgImportRequest::Prefetch>();
+    return hashIndex(prefetch->hashes.at(0));
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+
+  auto totalWeight =
+      FLAGS_blob_weight + FLAGS_tree_weight + FLAGS_prefetch_weight;
+  if (totalWeight == 0 || FLAGS_producers == 0 || FLAGS_workers == 0) {
+    fprintf(stderr, "At least one request type, producer and worker needed\n");
+    return 1;
+  }
+
+  const uint64_t total = FLAGS_producers * FLAGS_requests;
+  std::vector<std::atomic<uint64_t>> enqueueTimes(total);
+  std::atomic<uint64_t> processed{0};
+
+  HgImportRequestQueue queue;
+  RequestMetricsScope::RequestWatchList watches;
+
+  HgImportRequestQueue::Limits limits;
+  limits.batchSizes.fill(std::max<uint64_t>(FLAGS_batch_size, 1));
+  limits.allowed.fill(true);
+  limits.maxRunning[HgImportRequest::Prefetch::kType] =
+      FLAGS_max_prefetch_workers;
+
+  folly::test::Barrier gate(FLAGS_producers + FLAGS_workers + 1);
+
+  std::mutex resultMutex;
+  TypeSamples combined;
+
+  auto worker = [&] {
+    TypeSamples samples;
+    gate.wait();
+
+    while (true) {
+      auto requests = queue.dequeue(limits);
+      if (requests.empty()) {
+        break;
+      }
+      auto type = requests.at(0).getType();
+
+      auto dequeued = getTime();
+      std::vector<uint64_t> indices;
+      for (auto& request : requests) {
+        auto index = requestIndex(request);
+        indices.push_back(index);
+        samples.wait[type].add(dequeued - enqueueTimes[index].load());
+      }
+
+      std::this_thread::sleep_for(std::chrono::microseconds(
+          FLAGS_batch_latency_us + FLAGS_request_latency_us * requests.size()));
+
+      auto done = getTime();
+      for (auto index : indices) {
+        samples.latency[type].add(done - enqueueTimes[index].load());
+      }
+      queue.finish(type);
+      processed += requests.size();
+    }
+
+    std::lock_guard guard{resultMutex};
+    combined.combine(std::move(samples));
+  };
+
+  auto producer = [&](uint64_t producerIndex) {
+    std::mt19937_64 rng{producerIndex};
+    std::uniform_int_distribution<uint64_t> typeDist{0, totalWeight - 1};
+    std::bernoulli_distribution highDist{FLAGS_high_priority_fraction};
+
+    gate.wait();
+
+    for (uint64_t i = 0; i < FLAGS_requests; ++i) {
+      auto index = producerIndex * FLAGS_requests + i;
+      auto hash = indexHash(index);
+      auto priority =
+          highDist(rng) ? ImportPriority::kHigh() : ImportPriority::kNormal();
+      auto tracker = std::make_unique<RequestMetricsScope>(&watches);
+      auto kind = typeDist(rng);
+
+      enqueueTimes[index].store(getTime());
+      if (kind < FLAGS_blob_weight) {
+        queue.enqueue(HgImportRequest::makeBlobImportRequest(
+                          hash, priority, std::move(tracker))
+                          .first);
+      } else if (kind < FLAGS_blob_weight + FLAGS_tree_weight) {
+        queue.enqueue(HgImportRequest::makeTreeImportRequest(
+                          hash, priority, std::move(tracker))
+                          .first);
+      } else {
+        // Only the first hash identifies the request; the rest are unique
+        // so that prefetches are never combined with other requests.
+        std::vector<Hash> hashes{hash};
+        for (uint64_t j = 1; j < FLAGS_prefetch_size; ++j) {
+          hashes.push_back(indexHash(total + index * FLAGS_prefetch_size + j));
+        }
+        queue.enqueue(HgImportRequest::makePrefetchRequest(
+                          std::move(hashes),
+                          ImportPriority::kLow(),
+                          std::move(tracker))
+                          .first);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (uint64_t t = 0; t < FLAGS_workers; ++t) {
+    threads.emplace_back(worker);
+  }
+  for (uint64_t t = 0; t < FLAGS_producers; ++t) {
+    threads.emplace_back(producer, t);
+  }
+
+  gate.wait();
+  auto start = getTime();
+  while (processed.load() < total) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  auto elapsed = getTime() - start;
+
+  queue.stop();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  printf(
+      "%" PRIu64 " requests in %" PRIu64 " ms: %.0f requests/s\n",
+      total,
+      elapsed / 1000000,
+      total * 1e9 / elapsed);
+  for (size_t type = 0; type < HgImportRequest::kTypeCount; ++type) {
+    if (combined.wait[type].values.empty()) {
+      continue;
+    }
+    printf(
+        "%s (%zu requests)\n",
+        kTypeNames[type],
+        combined.wait[type].values.size());
+    combined.wait[type].print("queue wait");
+    combined.latency[type].print("latency");
+  }
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <dirent.h>
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/init/Init.h>
+#include <folly/synchronization/test/Barrier.h>
+#include <gflags/gflags.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "eden/fs/benchharness/Bench.h"
+
+DEFINE_uint64(threads, 8, "The number of concurrent metadata threads");
+DEFINE_uint64(
+    passes,
+    3,
+    "How many times to walk the tree in each run.  The first walk of the "
+    "first run is reported as cold and the rest as warm.");
+DEFINE_string(
+    missing_names,
+    "BUCK,TARGETS,.buckconfig,BUCK.v2",
+    "Comma-separated names probed with access() in every directory, the way "
+    "build tools look for build files.  They should not exist.");
+DEFINE_uint64(
+    restats,
+    100000,
+    "The number of stat() calls per thread on random paths found by the "
+    "walk, after each walk");
+
+using namespace facebook::eden;
+
+namespace {
+
+/**
+ * Directories waiting to be listed, shared by the walking threads.
+ */
+class DirectoryQueue {
+ public:
+  explicit DirectoryQueue(const std::vector<std::string>& roots)
+      : pending_{roots}, outstanding_{roots.size()} {}
+
+  /**
+   * Returns false once every directory has been listed.
+   */
+  bool pop(std::string& directory) {
+    std::unique_lock lock{mutex_};
+    cv_.wait(lock, [&] { return !pending_.empty() || outstanding_ == 0; });
+    if (pending_.empty()) {
+      return false;
+    }
+    directory = std::move(pending_.back());
+    pending_.pop_back();
+    return true;
+  }
+
+  /**
+   * Called once a popped directory has been listed, with its subdirectories.
+   */
+  void finish(std::vector<std::string>&& subdirectories) {
+    {
+      std::lock_guard lock{mutex_};
+      outstanding_ += subdirectories.size();
+      --outstanding_;
+      for (auto& subdirectory : subdirectories) {
+        pending_.push_back(std::move(subdirectory));
+      }
+    }
+    cv_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<std::string> pending_;
+  size_t outstanding_;
+};
+
+struct ThreadResults {
+  HistogramAccumulator readdir;
+  HistogramAccumulator lstat;
+  HistogramAccumulator access;
+  HistogramAccumulator restat;
+  std::vector<std::string> paths;
+};
+
+void listDirectory(
+    const std::string& directory,
+    const std::vector<std::string>& missingNames,
+    ThreadResults& results,
+    std::vector<std::string>& subdirectories) {
+  std::vector<std::string> entries;
+  auto start = getTime();
+  DIR* dir = opendir(directory.c_str());
+  if (!dir) {
+    folly::throwSystemError("Failed to open directory '", directory, "'");
+  }
+  while (auto* entry = readdir(dir)) {
+    folly::StringPiece name{entry->d_name};
+    if (name != "." && name != "..") {
+      entries.push_back(folly::to<std::string>(directory, "/", name));
+    }
+  }
+  closedir(dir);
+  results.readdir.add(getTime() - start);
+
+  for (auto& path : entries) {
+    struct stat st;
+    start = getTime();
+    int rc = lstat(path.c_str(), &st);
+    results.lstat.add(getTime() - start);
+    if (rc != 0) {
+      // The entry may have been removed since it was listed.
+      continue;
+    }
+    if (S_ISDIR(st.st_mode)) {
+      subdirectories.push_back(path);
+    }
+    results.paths.push_back(std::move(path));
+  }
+
+  for (const auto& name : missingNames) {
+    auto path = folly::to<std::string>(directory, "/", name);
+    start = getTime();
+    access(path.c_str(), F_OK);
+    results.access.add(getTime() - start);
+  }
+}
+
+void restatPaths(
+    const std::vector<std::string>& paths,
+    ThreadResults& results) {
+  if (paths.empty()) {
+    return;
+  }
+  for (uint64_t i = 0; i < FLAGS_restats; ++i) {
+    const auto& path = paths[folly::Random::rand64(paths.size())];
+    struct stat st;
+    auto start = getTime();
+    stat(path.c_str(), &st);
+    results.restat.add(getTime() - start);
+  }
+}
+
+/**
+ * Walks every root once with FLAGS_threads threads, then stats random paths
+ * from the walk, recording the results under the given label.
+ */
+void runPass(
+    const std::vector<std::string>& roots,
+    const std::vector<std::string>& missingNames,
+    folly::StringPiece label,
+    BenchmarkReport& report) {
+  DirectoryQueue queue{roots};
+  std::vector<ThreadResults> results(FLAGS_threads);
+  folly::test::Barrier walkGate{static_cast<unsigned>(FLAGS_threads)};
+  folly::test::Barrier restatGate{static_cast<unsigned>(FLAGS_threads)};
+  std::vector<std::string> allPaths;
+  std::mutex allPathsMutex;
+
+  std::vector<std::thread> threads;
+  threads.reserve(FLAGS_threads);
+  for (uint64_t t = 0; t < FLAGS_threads; ++t) {
+    threads.emplace_back([&, t] {
+      auto& threadResults = results[t];
+      walkGate.wait();
+      std::string directory;
+      while (queue.pop(directory)) {
+        std::vector<std::string> subdirectories;
+        try {
+          listDirectory(directory, missingNames, threadResults, subdirectories);
+        } catch (const std::exception& ex) {
+          fprintf(stderr, "%s\n", ex.what());
+        }
+        queue.finish(std::move(subdirectories));
+      }
+      {
+        std::lock_guard lock{allPathsMutex};
+        allPaths.insert(
+            allPaths.end(),
+            threadResults.paths.begin(),
+            threadResults.paths.end());
+      }
+
+      // Wait for every thread to finish walking, so that the repeated stats
+      // pick from the whole tree.
+      restatGate.wait();
+      restatPaths(allPaths, threadResults);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto& threadResults : results) {
+    report.metric(folly::to<std::string>(label, " readdir()"), "ns")
+        .combine(threadResults.readdir);
+    report.metric(folly::to<std::string>(label, " lstat()"), "ns")
+        .combine(threadResults.lstat);
+    report.metric(folly::to<std::string>(label, " access() missing"), "ns")
+        .combine(threadResults.access);
+    report.metric(folly::to<std::string>(label, " repeated stat()"), "ns")
+        .combine(threadResults.restat);
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+
+  if (argc <= 1) {
+    fprintf(
+        stderr,
+        "Specify one or more directories in an EdenFS mount on the command "
+        "line.  Each is walked recursively.\n");
+    return 1;
+  }
+  if (!FLAGS_threads || !FLAGS_passes) {
+    fprintf(stderr, "--threads and --passes must be nonzero\n");
+    return 1;
+  }
+
+  std::vector<std::string> roots{argv + 1, argv + argc};
+  std::vector<std::string> missingNames;
+  folly::split(',', FLAGS_missing_names, missingNames, /*ignoreEmpty=*/true);
+
+  auto clock_overhead = measureClockOverhead();
+  printf(
+      "Clock overhead measured at %" PRIu64 " ns minimum, %" PRIu64
+      " ns average\n",
+      clock_overhead.getMinimum(),
+      clock_overhead.getAverage());
+
+  // Only the first walk in this process sees the tree cold, as far as it can
+  // tell.  Inodes EdenFS loaded before the benchmark started are still warm.
+  bool cold = true;
+  return runBenchmark("metadata_storm", [&](BenchmarkReport& report) {
+    for (uint64_t pass = 0; pass < FLAGS_passes; ++pass) {
+      runPass(roots, missingNames, cold ? "cold" : "warm", report);
+      cold = false;
+    }
+  });
+}
@@ -54,60 +54,56 @@ int main(int argc, char** argv) {
     ::close(fd);
   }
 
-  folly::test::Barrier gate{FLAGS_threads};
-
-  std::mutex result_mutex;
-  StatAccumulator combined_open;
-  StatAccumulator combined_close;
-
-  auto thread = [&] {
-    StatAccumulator open_accum;
-    StatAccumulator close_accum;
-    int file_index = 1;
-
-    gate.wait();
-
-    for (uint64_t i = 0; i < FLAGS_iterations; ++i) {
-      const char* filename = argv[file_index];
-
-      uint64_t start_time = getTime();
-      int fd = ::open(filename, O_RDONLY);
-      uint64_t after_open = getTime();
-      if (UNLIKELY(-1 == fd)) {
-        folly::throwSystemError("Failed to open '", filename, "'");
+  return runBenchmark("open_close_parallel", [&](BenchmarkReport& report) {
+    folly::test::Barrier gate{FLAGS_threads};
+
+    std::mutex result_mutex;
+    HistogramAccumulator combined_open;
+    HistogramAccumulator combined_close;
+
+    auto thread = [&] {
+      HistogramAccumulator open_accum;
+      HistogramAccumulator close_accum;
+      int file_index = 1;
+
+      gate.wait();
+
+      for (uint64_t i = 0; i < FLAGS_iterations; ++i) {
+        const char* filename = argv[file_index];
+
+        uint64_t start_time = getTime();
+        int fd = ::open(filename, O_RDONLY);
+        uint64_t after_open = getTime();
+        if (UNLIKELY(-1 == fd)) {
+          folly::throwSystemError("Failed to open '", filename, "'");
+        }
+        ::close(fd);
+        uint64_t after_close = getTime();
+
+        if (++file_index >= argc) {
+          file_index = 1;
+        }
+
+        open_accum.add(after_open - start_time);
+        close_accum.add(after_close - after_open);
       }
-      ::close(fd);
-      uint64_t after_close = getTime();
 
-      if (++file_index >= argc) {
-        file_index = 1;
-      }
+      std::lock_guard guard{result_mutex};
+      combined_open.combine(open_accum);
+      combined_close.combine(close_accum);
+    };
 
-      open_accum.add(after_open - start_time);
-      close_accum.add(after_close - after_open);
+    std::vector<std::thread> threads;
+    threads.reserve(FLAGS_threads);
+    for (uint64_t t = 0; t < FLAGS_threads; ++t) {
+      threads.emplace_back(thread);
     }
 
-    std::lock_guard guard{result_mutex};
-    combined_open.combine(open_accum);
-    combined_close.combine(close_accum);
-  };
-
-  std::vector<std::thread> threads;
-  threads.reserve(FLAGS_threads);
-  for (uint64_t t = 0; t < FLAGS_threads; ++t) {
-    threads.emplace_back(thread);
-  }
-
-  for (auto& thread : threads) {
-    thread.join();
-  }
+    for (auto& thread : threads) {
+      thread.join();
+    }
 
-  printf(
-      "open()\n  minimum: %" PRIu64 " ns\n  average: %" PRIu64 " ns\n",
-      combined_open.getMinimum(),
-      combined_open.getAverage());
-  printf(
-      "close()\n  minimum: %" PRIu64 " ns\n  average: %" PRIu64 " ns\n",
-      combined_close.getMinimum(),
-      combined_close.getAverage());
+    report.metric("open()", "ns").combine(combined_open);
+    report.metric("close()", "ns").combine(combined_close);
+  });
 }
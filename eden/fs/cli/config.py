@@ -79,6 +79,10 @@ DEFAULT_REVISION = {  # supported repo name -> default bookmark
 
 SUPPORTED_REPOS = DEFAULT_REVISION.keys()
 
+# Where a checkout's overlay can store directories: one file per directory,
+# or a SQLite database.
+SUPPORTED_OVERLAY_TYPES = ("fs", "sqlite")
+
 REPO_FOR_EXTENSION = {".git": "git", ".hg": "hg"}
 
 # Create a readme file with this name in the mount point directory.
@@ -118,12 +122,15 @@ class CheckoutConfig(typing.NamedTuple):
     - redirections: dict where keys are relative pathnames in the EdenFS mount
       and the values are RedirectionType enum values that describe the type of
       the redirection.
+    - overlay_type: "fs" or "sqlite"; where a newly created overlay stores
+      directories.  Changing it has no effect on an existing overlay.
     """
 
     backing_repo: Path
     scm_type: str
     default_revision: str
     redirections: Dict[str, "RedirectionType"]
+    overlay_type: str = "fs"
 
 
 class EdenInstance:
@@ -810,14 +817,14 @@ class EdenCheckout:
         # configuration.
 
         redirections = {k: str(v) for k, v in checkout_config.redirections.items()}
-        config_data = {
-            "repository": {
-                # TODO: replace is needed to workaround a bug in toml
-                "path": str(checkout_config.backing_repo).replace("\\", "/"),
-                "type": checkout_config.scm_type,
-            },
-            "redirections": redirections,
+        repository = {
+            # TODO: replace is needed to workaround a bug in toml
+            "path": str(checkout_config.backing_repo).replace("\\", "/"),
+            "type": checkout_config.scm_type,
         }
+        if checkout_config.overlay_type != "fs":
+            repository["overlay-type"] = checkout_config.overlay_type
+        config_data = {"repository": repository, "redirections": redirections}
 
         util.write_file_atomically(
             self._config_path(), toml.dumps(config_data).encode()
@@ -853,6 +860,13 @@ class EdenCheckout:
                 f'repository "{config_path}" has unsupported type ' f'"{scm_type}"'
             )
 
+        overlay_type = repository.get("overlay-type", "fs")
+        if overlay_type not in SUPPORTED_OVERLAY_TYPES:
+            raise Exception(
+                f'repository "{config_path}" has unsupported overlay type '
+                f'"{overlay_type}"'
+            )
+
         redirections = {}
         redirections_dict = config.get("redirections")
 
@@ -884,6 +898,7 @@ class EdenCheckout:
             default_revision=(
                 repository.get("default-revision") or DEFAULT_REVISION[scm_type]
             ),
+            overlay_type=overlay_type,
         )
 
     def get_snapshot(self) -> str:
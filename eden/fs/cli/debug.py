@@ -436,6 +436,22 @@ class InodeCmd(Subcmd):
             results = client.debugInodeStatus(bytes(checkout.path), bytes(rel_path))
 
         out.write(b"%d loaded TreeInodes\n" % len(results))
+        loaded_files = [
+            entry
+            for inode_info in results
+            for entry in inode_info.entries
+            if entry.loaded and entry.compact is not None
+        ]
+        if loaded_files:
+            compact_count = sum(1 for entry in loaded_files if entry.compact)
+            out.write(
+                b"%d loaded FileInodes, %d (%.1f%%) compact\n"
+                % (
+                    len(loaded_files),
+                    compact_count,
+                    100.0 * compact_count / len(loaded_files),
+                )
+            )
         for inode_info in results:
             _print_inode_info(inode_info, out)
         return 0
@@ -641,12 +657,25 @@ class FlushCacheCmd(Subcmd):
         parser.add_argument(
             "path", help="Path to a directory/file inside an eden mount."
         )
+        parser.add_argument(
+            "--recursive",
+            action="store_true",
+            help="Also flush the cache for everything loaded beneath the path",
+        )
 
     def run(self, args: argparse.Namespace) -> int:
         instance, checkout, rel_path = cmd_util.require_checkout(args, args.path)
 
         with instance.get_thrift_client() as client:
-            client.invalidateKernelInodeCache(bytes(checkout.path), bytes(rel_path))
+            if args.recursive:
+                count = client.invalidateKernelInodeCacheRecursive(
+                    bytes(checkout.path), bytes(rel_path)
+                )
+                print(f"Flushed the kernel cache for {count} inodes")
+            else:
+                client.invalidateKernelInodeCache(
+                    bytes(checkout.path), bytes(rel_path)
+                )
 
         return 0
 
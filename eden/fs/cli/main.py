@@ -508,6 +508,12 @@ class CloneCmd(Subcmd):
             action="store_true",
             help="Allow repo with null revision (no revisions)",
         )
+        parser.add_argument(
+            "--overlay-type",
+            choices=config_mod.SUPPORTED_OVERLAY_TYPES,
+            help="Where the checkout's overlay stores directories: one file per "
+            'directory ("fs", the default), or a SQLite database ("sqlite")',
+        )
 
         # Optional arguments to control how to start the daemon if clone needs
         # to start edenfs.  We do not show these in --help by default These
@@ -552,6 +558,8 @@ class CloneCmd(Subcmd):
         except RepoError as ex:
             print_stderr("error: {}", ex)
             return 1
+        if args.overlay_type is not None:
+            repo_config = repo_config._replace(overlay_type=args.overlay_type)
 
         # Find the commit to check out
         if args.rev is not None:
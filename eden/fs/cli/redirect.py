@@ -560,6 +560,7 @@ def apply_redirection_configs_to_checkout_config(
         scm_type=config.scm_type,
         default_revision=config.default_revision,
         redirections=redirections,
+        overlay_type=config.overlay_type,
     )
 
 
@@ -400,6 +400,7 @@ class LocalStoreCmd(Subcmd):
             ("blob", True),
             ("blobmeta", True),
             ("hgcommit2tree", True),
+            ("gitcommit2tree", True),
             ("tree", False),
             ("hgproxyhash", False),
         ]
@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+# Copyright (c) Facebook, Inc. and its affiliates.
+#
+# This software may be used and distributed according to the terms of the
+# GNU General Public License version 2.
+
+import unittest
+
+from facebook.eden.ttypes import TracePoint, TracePointEvent
+
+from ..trace import chrome_trace_events
+
+
+def start(ts: int, block: int, parent: int, name: str) -> TracePoint:
+    return TracePoint(
+        timestamp=ts,
+        traceId=1,
+        blockId=block,
+        parentBlockId=parent,
+        name=name,
+        event=TracePointEvent.START,
+    )
+
+
+def stop(ts: int, block: int, parent: int) -> TracePoint:
+    return TracePoint(
+        timestamp=ts,
+        traceId=1,
+        blockId=block,
+        parentBlockId=parent,
+        event=TracePointEvent.STOP,
+    )
+
+
+class ChromeTraceTest(unittest.TestCase):
+    def test_nested_blocks(self) -> None:
+        events = chrome_trace_events(
+            [start(1000, 1, 0, "outer"), start(2000, 2, 1, "inner")]
+            + [stop(5000, 2, 1), stop(9000, 1, 0)]
+        )
+        blocks = [e for e in events if e["ph"] == "X"]
+        self.assertEqual(["outer", "inner"], [e["name"] for e in blocks])
+        self.assertEqual([1.0, 2.0], [e["ts"] for e in blocks])
+        self.assertEqual([8.0, 3.0], [e["dur"] for e in blocks])
+        self.assertEqual(1, blocks[1]["args"]["parentBlockId"])
+        flows = [e for e in events if e["ph"] in ("s", "f")]
+        self.assertEqual([2, 2], [e["id"] for e in flows])
+
+    def test_incomplete_blocks(self) -> None:
+        events = chrome_trace_events([stop(1000, 1, 0), start(2000, 2, 0, "open")])
+        self.assertEqual(1, len(events))
+        self.assertEqual("B", events[0]["ph"])
+        self.assertEqual("open", events[0]["name"])
@@ -35,7 +35,7 @@ HELP_SECTION_CONCERN = "concern? "
 
 Row = collections.namedtuple(
     "Row",
-    "top_pid mount fuse_reads fuse_writes fuse_total fuse_backing_store_imports fuse_duration fuse_last_access command",
+    "top_pid mount fuse_reads fuse_writes fuse_total fuse_backing_store_imports fuse_duration fetch_bytes fetch_wait fuse_last_access command",
 )
 
 COLUMN_TITLES = Row(
@@ -46,6 +46,8 @@ COLUMN_TITLES = Row(
     fuse_total="FUSE COUNT",
     fuse_backing_store_imports="IMPORTS",
     fuse_duration="FUSE TIME",
+    fetch_bytes="FETCHED",
+    fetch_wait="FETCH TIME",
     fuse_last_access="FUSE LAST",
     command="CMD",
 )
@@ -57,6 +59,8 @@ COLUMN_SPACING = Row(
     fuse_total=10,
     fuse_backing_store_imports=10,
     fuse_duration=10,
+    fetch_bytes=10,
+    fetch_wait=10,
     fuse_last_access=10,
     command=25,
 )
@@ -68,6 +72,8 @@ COLUMN_ALIGNMENT = Row(
     fuse_total=">",
     fuse_backing_store_imports=">",
     fuse_duration=">",
+    fetch_bytes=">",
+    fetch_wait=">",
     fuse_last_access=">",
     command="<",
 )
@@ -79,6 +85,8 @@ COLUMN_REVERSE_SORT = Row(
     fuse_total=True,
     fuse_backing_store_imports=True,
     fuse_duration=True,
+    fetch_bytes=True,
+    fetch_wait=True,
     fuse_last_access=True,
     command=False,
 )
@@ -94,6 +102,12 @@ def format_duration(duration):
     return format_time(duration, modulos, suffixes)
 
 
+def format_bytes(size):
+    modulos = (1024, 1024, 1024, 1024)
+    suffixes = ("B", "K", "M", "G", "T")
+    return format_time(size, modulos, suffixes)
+
+
 def format_last_access(last_access):
     elapsed = int(time.monotonic() - last_access)
 
@@ -132,6 +146,8 @@ COLUMN_FORMATTING = Row(
     fuse_total=lambda x: x,
     fuse_backing_store_imports=lambda x: x,
     fuse_duration=format_duration,
+    fetch_bytes=format_bytes,
+    fetch_wait=format_duration,
     fuse_last_access=format_last_access,
     command=lambda x: x,
 )
@@ -928,7 +944,7 @@ class Process:
         self.pid = pid
         self.cmd = format_cmd(cmd)
         self.mount = format_mount(mount)
-        self.access_counts = AccessCounts(0, 0, 0, 0, 0)
+        self.access_counts = AccessCounts(0, 0, 0, 0, 0, 0, 0, 0)
         self.last_access_time = time.monotonic()
         self.is_running = True
 
@@ -952,6 +968,9 @@ class Process:
             access_counts.fuseBackingStoreImports
         )
         self.access_counts.fuseDurationNs += access_counts.fuseDurationNs
+        self.access_counts.fetchCount += access_counts.fetchCount
+        self.access_counts.fetchBytes += access_counts.fetchBytes
+        self.access_counts.fetchWaitNs += access_counts.fetchWaitNs
 
     def get_row(self):
         return Row(
@@ -962,6 +981,8 @@ class Process:
             fuse_total=self.access_counts.fuseTotal,
             fuse_backing_store_imports=self.access_counts.fuseBackingStoreImports,
             fuse_duration=self.access_counts.fuseDurationNs,
+            fetch_bytes=self.access_counts.fetchBytes,
+            fetch_wait=self.access_counts.fetchWaitNs,
             fuse_last_access=self.last_access,
             command=self.cmd,
         )
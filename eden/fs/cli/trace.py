@@ -5,6 +5,11 @@
 # GNU General Public License version 2.
 
 import argparse
+import json
+import sys
+from typing import Any, Dict, List
+
+from facebook.eden.ttypes import TracePoint, TracePointEvent
 
 from . import cmd_util, subcmd as subcmd_mod
 from .subcmd import Subcmd
@@ -29,6 +34,97 @@ class DisableTraceCmd(Subcmd):
         return 0
 
 
+@trace_cmd(
+    "sample", "Trace one in every N requests, even while tracing is disabled"
+)
+class SampleTraceCmd(Subcmd):
+    def setup_parser(self, parser: argparse.ArgumentParser) -> None:
+        parser.add_argument(
+            "rate", type=int, help="Trace one in every RATE requests; 0 disables"
+        )
+
+    def run(self, args: argparse.Namespace) -> int:
+        instance = cmd_util.get_eden_instance(args)
+        with instance.get_thrift_client() as client:
+            client.setTraceSampleRate(args.rate)
+        return 0
+
+
+def chrome_trace_events(points: List[TracePoint]) -> List[Dict[str, Any]]:
+    """Convert tracepoints to Chrome trace / Perfetto JSON events.
+
+    Each request is shown as its own track. Blocks whose start was
+    overwritten in the tracepoint buffers are dropped, and blocks that have
+    not stopped yet are left open. Flow events link each block to its parent.
+    """
+    events: List[Dict[str, Any]] = []
+    starts: Dict[int, Dict[str, Any]] = {}
+    for point in sorted(points, key=lambda p: p.timestamp):
+        if point.event == TracePointEvent.START:
+            event = {
+                "name": point.name,
+                "cat": "eden",
+                "ph": "B",
+                "ts": point.timestamp / 1000,
+                "pid": 0,
+                "tid": point.traceId,
+                "args": {
+                    "blockId": point.blockId,
+                    "parentBlockId": point.parentBlockId,
+                },
+            }
+            starts[point.blockId] = event
+            events.append(event)
+            if point.parentBlockId in starts:
+                flow = {
+                    "name": "parent",
+                    "cat": "eden",
+                    "id": point.blockId,
+                    "pid": 0,
+                    "tid": point.traceId,
+                    "ts": event["ts"],
+                }
+                events.append(dict(flow, ph="s"))
+                events.append(dict(flow, ph="f", bp="e"))
+        elif point.event == TracePointEvent.STOP:
+            event = starts.get(point.blockId)
+            if event is not None:
+                event["ph"] = "X"
+                event["dur"] = point.timestamp / 1000 - event["ts"]
+    return events
+
+
+@trace_cmd("export", "Export recent tracepoints as Chrome trace JSON")
+class ExportTraceCmd(Subcmd):
+    def setup_parser(self, parser: argparse.ArgumentParser) -> None:
+        parser.add_argument(
+            "--output",
+            "-o",
+            help="Write the trace to this file instead of standard output",
+        )
+        parser.add_argument(
+            "--drain",
+            action="store_true",
+            help="Remove the exported tracepoints from edenfs's buffers",
+        )
+
+    def run(self, args: argparse.Namespace) -> int:
+        instance = cmd_util.get_eden_instance(args)
+        with instance.get_thrift_client() as client:
+            if args.drain:
+                points = client.getTracePoints()
+            else:
+                points = client.getTracePointSnapshot()
+        trace = {"traceEvents": chrome_trace_events(points)}
+        if args.output:
+            with open(args.output, "w") as f:
+                json.dump(trace, f)
+        else:
+            json.dump(trace, sys.stdout)
+            sys.stdout.write("\n")
+        return 0
+
+
 @subcmd_mod.subcmd("trace", "Commands for managing eden tracing")
 # pyre-fixme[13]: Attribute `parser` is never initialized.
 class TraceCmd(Subcmd):
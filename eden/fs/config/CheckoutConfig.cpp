@@ -29,6 +29,7 @@ const facebook::eden::RelativePathPiece kCheckoutConfig{"config.toml"};
 constexpr folly::StringPiece kRepoSection{"repository"};
 constexpr folly::StringPiece kRepoSourceKey{"path"};
 constexpr folly::StringPiece kRepoTypeKey{"type"};
+constexpr folly::StringPiece kOverlayTypeKey{"overlay-type"};
 
 // Files of interest in the client directory.
 const facebook::eden::RelativePathPiece kSnapshotFile{"SNAPSHOT"};
@@ -178,6 +179,17 @@ std::unique_ptr<CheckoutConfig> CheckoutConfig::loadFromClientDirectory(
   auto repository = configRoot->get_table(kRepoSection.str());
   config->repoType_ = *repository->get_as<std::string>(kRepoTypeKey.str());
   config->repoSource_ = *repository->get_as<std::string>(kRepoSourceKey.str());
+  auto overlayType = repository->get_as<std::string>(kOverlayTypeKey.str());
+  if (overlayType) {
+    if (*overlayType != "fs" && *overlayType != "sqlite") {
+      throw std::runtime_error(folly::sformat(
+          "unsupported overlay type \"{}\" in {}: expected \"fs\" or "
+          "\"sqlite\"",
+          *overlayType,
+          configPath));
+    }
+    config->overlayType_ = *overlayType;
+  }
 
   return config;
 }
@@ -90,6 +90,17 @@ class CheckoutConfig {
     return repoSource_;
   }
 
+  /**
+   * Get where the checkout's overlay stores directories.
+   *
+   * This is "fs" (the default) for one overlay file per directory, or
+   * "sqlite" for a SQLite database.  It is only consulted when the overlay is
+   * first created; an existing overlay keeps the storage it was created with.
+   */
+  const std::string& getOverlayType() const {
+    return overlayType_;
+  }
+
   /** Path to the file where the current commit ID is stored */
   AbsolutePath getSnapshotPath() const;
 
@@ -101,6 +112,7 @@ class CheckoutConfig {
   const AbsolutePath mountPath_;
   std::string repoType_;
   std::string repoSource_;
+  std::string overlayType_{"fs"};
 };
 } // namespace eden
 } // namespace facebook
@@ -211,10 +211,51 @@ class EdenConfig : private ConfigSettingManager {
       std::chrono::minutes(5),
       this};
 
+  /**
+   * Background periodic tasks, such as local store management, are run up to
+   * this percentage of their interval earlier or later than scheduled, so
+   * that they drift apart instead of repeatedly running at the same moment.
+   */
+  ConfigSetting<uint64_t> periodicTaskJitterPercent{
+      "core:periodic-task-jitter-percent",
+      0,
+      this};
+
+  /**
+   * Background periodic tasks are postponed while at least this many FUSE
+   * and thrift requests are in progress.  0 never postpones them.
+   */
+  ConfigSetting<uint64_t> backgroundTaskBusyRequests{
+      "core:background-task-busy-requests",
+      0,
+      this};
+
+  /**
+   * The longest a background periodic task is postponed because of
+   * core:background-task-busy-requests before it runs anyway.
+   */
+  ConfigSetting<std::chrono::nanoseconds> backgroundTaskMaxDeferral{
+      "core:background-task-max-deferral",
+      std::chrono::minutes(5),
+      this};
+
+  /**
+   * If true, thrift clients whose user is a member of the EdenFS user's
+   * primary group may invoke any method.
+   */
   ConfigSetting<bool> allowUnixGroupRequests{"thrift:allow-unix-group-requests",
                                              false,
                                              this};
 
+  /**
+   * If true, the permission check for each thrift connection is cached for
+   * the life of the connection rather than repeated for every request, until
+   * the config is next reloaded.
+   */
+  ConfigSetting<bool> thriftPermissionCache{"thrift:permission-cache",
+                                            false,
+                                            this};
+
   ConfigSetting<AbsolutePath> clientCertificate{"ssl:client-certificate",
                                                 kUnspecifiedDefault,
                                                 this};
@@ -249,6 +290,65 @@ class EdenConfig : private ConfigSettingManager {
       std::chrono::minutes(1),
       this};
 
+  /**
+   * Approximate bytes of loaded inode objects each mount may keep before
+   * EdenFS starts unloading inodes that have not been used recently.  0
+   * disables budget-driven unloading.
+   */
+  ConfigSetting<uint64_t> inodeMemoryBudget{"inode:memory-budget", 0, this};
+
+  /**
+   * How often each mount is checked against inode:memory-budget.  Inode
+   * recency is tracked in units of this interval.
+   */
+  ConfigSetting<std::chrono::nanoseconds> inodeUnloadInterval{
+      "inode:unload-interval",
+      std::chrono::minutes(5),
+      this};
+
+  /**
+   * When the "some avg10" memory stall percentage read from
+   * memory:pressure-file reaches this value, EdenFS starts releasing the
+   * in-memory state listed in memory:pressure-shrink-order.  0 disables the
+   * memory governor.
+   */
+  ConfigSetting<double> memoryPressureThreshold{
+      "memory:pressure-threshold",
+      0.0,
+      this};
+
+  /**
+   * The pressure stall information file watched by the memory governor.  If
+   * empty, EdenFS uses the memory.pressure file of its own cgroup, so it
+   * reacts to the limit it runs under, and falls back to
+   * /proc/pressure/memory.  Readings of /proc/pressure/memory cover the whole
+   * machine, so inodes are not unloaded based on them.
+   */
+  ConfigSetting<std::string> memoryPressureFile{
+      "memory:pressure-file",
+      "",
+      this};
+
+  /**
+   * How often memory:pressure-file is checked.
+   */
+  ConfigSetting<std::chrono::nanoseconds> memoryPressureCheckInterval{
+      "memory:pressure-check-interval",
+      std::chrono::seconds(10),
+      this};
+
+  /**
+   * Comma-separated consumers to release under memory pressure, cheapest to
+   * rebuild first.  Each check that still finds pressure releases one more
+   * of them, along with all of those before it.  Known consumers are
+   * tree-cache, blob-metadata-cache, blob-cache, overlay-file-cache (open
+   * and mapped overlay files) and inodes.
+   */
+  ConfigSetting<std::string> memoryPressureShrinkOrder{
+      "memory:pressure-shrink-order",
+      "tree-cache,blob-metadata-cache,blob-cache,overlay-file-cache,inodes",
+      this};
+
   /*
    * The following settings control the maximum sizes of the local store's
    * caches, per object type.
@@ -275,6 +375,153 @@ class EdenConfig : private ConfigSettingManager {
       20'000'000,
       this};
 
+  ConfigSetting<uint64_t> localStoreGitCommit2TreeSizeLimit{
+      "store:gitcommit2tree-size-limit",
+      20'000'000,
+      this};
+
+  /**
+   * The approximate maximum size of the keys and values kept by the memory
+   * local store, beyond which the oldest ephemeral objects are evicted.  0
+   * means unlimited.
+   */
+  ConfigSetting<uint64_t> localStoreMemorySizeLimit{
+      "store:memory-size-limit",
+      0,
+      this};
+
+  /**
+   * If true, automatic garbage collection evicts the least recently used
+   * keys of an ephemeral key space until it shrinks to
+   * store:eviction-target-percent of its size limit, rather than clearing the
+   * whole key space.  Tracking key accesses costs about 1 MB of memory per
+   * ephemeral key space.  Takes effect on restart.
+   */
+  ConfigSetting<bool> localStoreAccessAwareEviction{
+      "store:access-aware-eviction",
+      false,
+      this};
+
+  ConfigSetting<uint64_t> localStoreEvictionTargetPercent{
+      "store:eviction-target-percent",
+      75,
+      this};
+
+  /**
+   * If true, trees imported into the local store are written to immutable
+   * memory-mapped pack files under the storage directory rather than to the
+   * local store's tree key space.  Staged trees are written out as a pack
+   * once they add up to store:tree-pack-size bytes, and the oldest packs are
+   * deleted once all packs exceed store:tree-pack-size-limit.  Takes effect
+   * on restart.
+   */
+  ConfigSetting<bool> localStoreTreePacks{"store:tree-packs", false, this};
+
+  ConfigSetting<uint64_t> localStoreTreePackSize{"store:tree-pack-size",
+                                                 64'000'000,
+                                                 this};
+
+  ConfigSetting<uint64_t> localStoreTreePackSizeLimit{
+      "store:tree-pack-size-limit",
+      3'000'000'000,
+      this};
+
+  /*
+   * The following settings tune the connections of the SQLite local store.
+   * They take effect on restart.  A size of 0 keeps SQLite's default.
+   */
+
+  ConfigSetting<uint64_t> localStoreSqliteMmapSize{"store:sqlite-mmap-size",
+                                                   0,
+                                                   this};
+
+  ConfigSetting<uint64_t> localStoreSqliteCacheSize{"store:sqlite-cache-size",
+                                                    0,
+                                                    this};
+
+  ConfigSetting<uint64_t> localStoreSqliteReadConnections{
+      "store:sqlite-read-connections",
+      4,
+      this};
+
+  /*
+   * The following settings tune the RocksDB column families of the local
+   * store, and take effect when the local store is opened.
+   *
+   * The key spaces are tuned in three groups: "blob" holds large file
+   * contents that are mostly read once and then cached by the kernel, "tree"
+   * holds directory listings, and "metadata" holds the tiny, very frequently
+   * read values of every other key space (blob metadata, proxy hashes and
+   * commit to tree mappings).
+   *
+   * Each group has its own block cache of block-cache-size bytes.  A
+   * bloom-bits of 0 disables the bloom filter, partitioned-index splits the
+   * index and filter blocks so that only the parts in use are cached,
+   * compaction-style is "level" or "universal", and write-buffer-size is the
+   * size of each memtable.
+   */
+
+  ConfigSetting<uint64_t> rocksdbBlobBlockCacheSize{
+      "rocksdb:blob-block-cache-size",
+      8 * 1024 * 1024,
+      this};
+  ConfigSetting<uint64_t> rocksdbBlobBloomBits{"rocksdb:blob-bloom-bits",
+                                               10,
+                                               this};
+  ConfigSetting<bool> rocksdbBlobPartitionedIndex{
+      "rocksdb:blob-partitioned-index",
+      false,
+      this};
+  ConfigSetting<std::string> rocksdbBlobCompactionStyle{
+      "rocksdb:blob-compaction-style",
+      "level",
+      this};
+  ConfigSetting<uint64_t> rocksdbBlobWriteBufferSize{
+      "rocksdb:blob-write-buffer-size",
+      128 * 1024 * 1024,
+      this};
+
+  ConfigSetting<uint64_t> rocksdbTreeBlockCacheSize{
+      "rocksdb:tree-block-cache-size",
+      48 * 1024 * 1024,
+      this};
+  ConfigSetting<uint64_t> rocksdbTreeBloomBits{"rocksdb:tree-bloom-bits",
+                                               10,
+                                               this};
+  ConfigSetting<bool> rocksdbTreePartitionedIndex{
+      "rocksdb:tree-partitioned-index",
+      false,
+      this};
+  ConfigSetting<std::string> rocksdbTreeCompactionStyle{
+      "rocksdb:tree-compaction-style",
+      "level",
+      this};
+  ConfigSetting<uint64_t> rocksdbTreeWriteBufferSize{
+      "rocksdb:tree-write-buffer-size",
+      128 * 1024 * 1024,
+      this};
+
+  ConfigSetting<uint64_t> rocksdbMetadataBlockCacheSize{
+      "rocksdb:metadata-block-cache-size",
+      16 * 1024 * 1024,
+      this};
+  ConfigSetting<uint64_t> rocksdbMetadataBloomBits{
+      "rocksdb:metadata-bloom-bits",
+      10,
+      this};
+  ConfigSetting<bool> rocksdbMetadataPartitionedIndex{
+      "rocksdb:metadata-partitioned-index",
+      false,
+      this};
+  ConfigSetting<std::string> rocksdbMetadataCompactionStyle{
+      "rocksdb:metadata-compaction-style",
+      "level",
+      this};
+  ConfigSetting<uint64_t> rocksdbMetadataWriteBufferSize{
+      "rocksdb:metadata-write-buffer-size",
+      32 * 1024 * 1024,
+      this};
+
   /**
    * The maximum time duration allowed for a fuse request. If a request exceeds
    * this amount of time, an ETIMEDOUT error will be returned to the kernel to
@@ -296,6 +543,107 @@ class EdenConfig : private ConfigSettingManager {
       std::chrono::nanoseconds::max(),
       this};
 
+  /**
+   * How long the kernel may cache the result of looking up a name that does
+   * not exist.  Eden invalidates these entries itself when checkout adds the
+   * name, so the default caches them until then.
+   */
+  ConfigSetting<std::chrono::nanoseconds> fuseNegativeEntryTimeout{
+      "fuse:negative-entry-timeout",
+      std::chrono::nanoseconds::max(),
+      this};
+
+  /**
+   * How many bytes of file contents read ahead by store:sibling-blob-readahead
+   * to push into the kernel's page cache with FUSE_NOTIFY_STORE per batch, so
+   * that reading those files does not need a FUSE request at all.  0 disables
+   * this.
+   */
+  ConfigSetting<uint64_t> fuseNotifyStoreBudget{
+      "fuse:notify-store-budget",
+      0,
+      this};
+
+  /**
+   * Files larger than this are never pushed into the kernel's page cache by
+   * fuse:notify-store-budget.
+   */
+  ConfigSetting<uint64_t> fuseNotifyStoreMaxFileSize{
+      "fuse:notify-store-max-file-size",
+      128 * 1024,
+      this};
+
+  /**
+   * Whether large reads from materialized files should be spliced from the
+   * overlay to the FUSE device rather than copied through userspace.
+   */
+  ConfigSetting<bool> fuseSpliceReadReplies{"fuse:splice-read-replies",
+                                            false,
+                                            this};
+
+  /**
+   * Whether FUSE worker threads should read requests through io_uring.
+   * This has no effect if EdenFS was built without liburing, and workers fall
+   * back to blocking reads on kernels without io_uring support.
+   */
+  ConfigSetting<bool> fuseUseIoUring{"fuse:use-io-uring", false, this};
+
+  /**
+   * Whether each FUSE worker thread should read requests from its own clone
+   * of the FUSE device rather than sharing a single device.
+   */
+  ConfigSetting<bool> fuseCloneDevicePerWorker{
+      "fuse:clone-device-per-worker",
+      false,
+      this};
+
+  /**
+   * Whether to negotiate FUSE_READDIRPLUS with the kernel, prefilling the
+   * attributes of directory entries that are cheap to stat.
+   */
+  ConfigSetting<bool> fuseReaddirplus{"fuse:readdirplus", false, this};
+
+  /**
+   * Whether each loaded directory keeps its serialized FUSE_READDIR reply,
+   * so that re-reading an unchanged directory copies it instead of rebuilding
+   * it from the directory entries.
+   */
+  ConfigSetting<bool> fuseReaddirCache{"fuse:readdir-cache", false, this};
+
+  /**
+   * The largest FUSE read or write request, in bytes, to negotiate with the
+   * kernel.  Kernels without FUSE_MAX_PAGES support cap this at 128KiB, and
+   * newer kernels cap it at 1MiB.
+   */
+  ConfigSetting<uint64_t> fuseMaxWriteSize{
+      "fuse:max-write-size",
+      1024 * 1024,
+      this};
+
+  /**
+   * The fewest FUSE worker threads a mount keeps once idle workers have
+   * exited.  0 means --fuseNumThreads, which disables shrinking.
+   */
+  ConfigSetting<uint64_t> fuseMinThreads{"fuse:min-threads", 0, this};
+
+  /**
+   * The most FUSE worker threads a mount starts when requests queue up
+   * behind busy workers.  0 means --fuseNumThreads, which disables growth.
+   */
+  ConfigSetting<uint64_t> fuseMaxThreads{"fuse:max-threads", 0, this};
+
+  /**
+   * If set, each mount records the FUSE requests it receives to a trace file
+   * in this directory, for replaying later.  The file is named
+   * <basename>.<hash of the mount path>.<pid>.fusetrace.  Traces hold file
+   * names, so this is meant for reproducing slowness reports.  Empty disables
+   * tracing.
+   */
+  ConfigSetting<std::string> fuseRequestTraceDir{
+      "fuse:request-trace-dir",
+      "",
+      this};
+
   /**
    * Whether Eden should implement its own unix domain socket permission checks
    * or rely on filesystem permissions.
@@ -311,11 +659,116 @@ class EdenConfig : private ConfigSettingManager {
    */
   ConfigSetting<bool> enforceParents{"hg:enforce-parents", true, this};
 
+  /**
+   * Whether each mount remembers its last status result and updates it from
+   * the journal, instead of diffing the whole working copy on every status
+   * call.
+   *
+   * Changes to the user and system ignore files outside the repository are
+   * not journaled, so they are only picked up once something else forces a
+   * full diff.
+   */
+  ConfigSetting<bool> statusCache{"status:cache", false, this};
+
+  /**
+   * The most changed paths that a cached status is updated with one path at a
+   * time.  Beyond this a full diff is faster.
+   */
+  ConfigSetting<uint64_t> statusCacheMaxIncrementalPaths{
+      "status:cache-max-incremental-paths",
+      1000,
+      this};
+
+  /**
+   * The most subtree diffs a single status call may have queued on or running
+   * on the server thread pool at once.  Subtrees beyond that are diffed
+   * inline.  0 diffs every subtree inline.
+   */
+  ConfigSetting<uint64_t> statusDiffFanOut{"status:diff-fan-out", 0, this};
+
   /**
    * Controls whether EdenFS reads directly from hgcache.
    */
   ConfigSetting<bool> useHgCache{"hg:use-hgcache", true, this};
 
+  /**
+   * Whether the size and SHA-1 of blobs that are in hgcache are computed
+   * straight from hgcache when only their metadata is needed, rather than by
+   * importing the blobs into the local store.
+   */
+  ConfigSetting<bool> hgBlobMetadataFromHgCache{
+      "hg:blob-metadata-from-hgcache",
+      false,
+      this};
+
+  /**
+   * The number of threads that process queued hg import requests.  This is
+   * only read when a repository's backing store is created.
+   */
+  ConfigSetting<uint64_t> hgImportThreads{"hg:import-threads", 8, this};
+
+  /**
+   * How many of the hg import threads only import trees, so that directory
+   * listings never wait behind a wall of blob imports.
+   */
+  ConfigSetting<uint64_t> hgReservedTreeImportThreads{
+      "hg:reserved-tree-import-threads",
+      0,
+      this};
+
+  /**
+   * The most hg import threads that may work on each type of import at once.
+   * 0 means no limit.
+   */
+  ConfigSetting<uint64_t> hgMaxBlobImportThreads{
+      "hg:max-blob-import-threads",
+      0,
+      this};
+  ConfigSetting<uint64_t> hgMaxTreeImportThreads{
+      "hg:max-tree-import-threads",
+      0,
+      this};
+  ConfigSetting<uint64_t> hgMaxPrefetchImportThreads{
+      "hg:max-prefetch-import-threads",
+      0,
+      this};
+
+  /**
+   * The most requests of each type that an hg import thread handles in one
+   * batch.  0 uses --hg_queue_batch_size.
+   */
+  ConfigSetting<uint64_t> hgBlobImportBatchSize{
+      "hg:blob-import-batch-size",
+      0,
+      this};
+  ConfigSetting<uint64_t> hgTreeImportBatchSize{
+      "hg:tree-import-batch-size",
+      0,
+      this};
+  ConfigSetting<uint64_t> hgPrefetchImportBatchSize{
+      "hg:prefetch-import-batch-size",
+      0,
+      this};
+
+  /**
+   * Whether a batch of tree imports decodes all of the trees it fetched from
+   * the HgImporter at once, and then starts fetching their subtrees in the
+   * background so that the next level of a directory walk is already local.
+   */
+  ConfigSetting<bool> hgPipelinedTreeImport{
+      "hg:pipelined-tree-import",
+      false,
+      this};
+
+  /**
+   * The most subtrees hg:pipelined-tree-import fetches in the background at
+   * once.  Subtrees past this are left to their own imports.
+   */
+  ConfigSetting<uint64_t> hgPipelinedTreeImportMaxSubtrees{
+      "hg:pipelined-tree-import-max-subtrees",
+      4096,
+      this};
+
   /**
    * Location of scribe_cat binary on the system. If not specified, scribe
    * logging will be disabled.
@@ -329,6 +782,33 @@ class EdenConfig : private ConfigSettingManager {
                                             "",
                                             this};
 
+  /**
+   * How many structured log events may wait for the background thread that
+   * writes them to scribe.  Events logged while the queue is full are
+   * dropped.  0 writes events on the thread that logs them.
+   */
+  ConfigSetting<uint64_t> structuredLogQueueSize{
+      "telemetry:structured-log-queue-size",
+      1024,
+      this};
+
+  /**
+   * How often the background thread writes the queued structured log events.
+   */
+  ConfigSetting<std::chrono::nanoseconds> structuredLogFlushInterval{
+      "telemetry:structured-log-flush-interval",
+      std::chrono::milliseconds{100},
+      this};
+
+  /**
+   * Comma-separated "type=N" pairs: only one in every N structured log events
+   * of that type is logged.  N=0 drops every event of the type.
+   */
+  ConfigSetting<std::string> structuredLogSampleRates{
+      "telemetry:structured-log-sample-rates",
+      "",
+      this};
+
   /**
    * Controls whether if EdenFS caches blobs in local store.
    */
@@ -341,6 +821,60 @@ class EdenConfig : private ConfigSettingManager {
    */
   ConfigSetting<bool> useEdenApi{"experimental:use-edenapi", false, this};
 
+  /**
+   * Which blobs the in-memory blob cache keeps when it is full: "all" evicts
+   * the least recently used blob to cache every new one, "tinylfu" only
+   * caches a new blob if it was requested more often recently than the blob
+   * it would evict.  Takes effect on restart.
+   */
+  ConfigSetting<std::string> blobCacheAdmissionPolicy{
+      "store:blob-cache-admission-policy",
+      "all",
+      this};
+
+  /**
+   * When a file that is not materialized is read sequentially to its end,
+   * fetch the blobs of up to this many of the files that follow it in its
+   * directory into the blob cache, on the assumption that they will be read
+   * next (e.g. by tar or a compiler reading headers).  0 disables readahead.
+   */
+  ConfigSetting<uint64_t> siblingBlobReadahead{
+      "store:sibling-blob-readahead",
+      0,
+      this};
+
+  /**
+   * Once reads into a blob at least this large are seen to be random, the
+   * file stops holding the blob in the blob cache and is read in chunks from
+   * the local store instead, so that it does not evict blobs that are more
+   * likely to be read again.  Only applies when blobs are stored in chunks.
+   * 0 disables this.
+   */
+  ConfigSetting<uint64_t> randomReadUncachedBlobSize{
+      "store:random-read-uncached-blob-size",
+      0,
+      this};
+
+  /**
+   * Blobs at least this large are kept as files in the overlay's blob file
+   * cache when they are materialized, so that materializing them again clones
+   * or copies that file in the kernel instead of fetching and writing out the
+   * blob.  Only useful on filesystems that support reflinks.  0 disables this.
+   */
+  ConfigSetting<uint64_t> blobFileCacheMinSize{
+      "overlay:blob-file-cache-min-size",
+      0,
+      this};
+
+  /**
+   * The most bytes the overlay's blob file cache may hold.  Blobs are not
+   * added once it is full.
+   */
+  ConfigSetting<uint64_t> blobFileCacheMaxSize{
+      "overlay:blob-file-cache-max-size",
+      10ull * 1024 * 1024 * 1024,
+      this};
+
   /**
    * The maximum number of tree prefetch operations to allow in parallel for any
    * checkout.  Setting this to 0 will disable prefetch operations.
@@ -348,6 +882,121 @@ class EdenConfig : private ConfigSettingManager {
   ConfigSetting<uint64_t> maxTreePrefetches{"store:max-tree-prefetches",
                                             5,
                                             this};
+
+  /**
+   * Whether readdir() prefetches adapt to how many of the prefetched children
+   * were looked up soon afterwards, per directory and per command: deeper for
+   * crawlers, only a few entries for commands that rarely use them.
+   */
+  ConfigSetting<bool> adaptiveTreePrefetch{
+      "store:adaptive-tree-prefetch",
+      false,
+      this};
+
+  /**
+   * The most directory levels that one adaptive prefetch may load.
+   */
+  ConfigSetting<uint64_t> maxTreePrefetchDepth{
+      "store:max-tree-prefetch-depth",
+      3,
+      this};
+
+  /**
+   * For how long after an adaptive prefetch a looked up child counts as a
+   * prefetch hit.
+   */
+  ConfigSetting<std::chrono::nanoseconds> treePrefetchHitWindow{
+      "store:tree-prefetch-hit-window",
+      std::chrono::seconds{2},
+      this};
+
+  /**
+   * Whether getScmStatusBetweenRevisions() diffs the two commits one
+   * directory level at a time, requesting every differing tree at a level
+   * together so that the backing store can import them as one batch.
+   */
+  ConfigSetting<bool> batchedCommitDiff{"store:batched-commit-diff",
+                                        false,
+                                        this};
+
+  /**
+   * The number of threads that check out subtrees in parallel.  Values of 0
+   * or 1 check out each subtree on whichever thread finished loading it.
+   * The checkout thread pool is sized when it is first used.
+   */
+  ConfigSetting<uint64_t> checkoutParallelism{"checkout:parallelism", 1, this};
+
+  /**
+   * Whether checkout starts fetching the trees that differ between the
+   * source and destination commits along the paths of loaded and
+   * materialized inodes, and batched prefetches of the blobs of those files
+   * that differ.  Checkout does not wait for these.
+   */
+  ConfigSetting<bool> checkoutPrefetch{"checkout:prefetch", false, this};
+
+  /**
+   * The most blob hashes that a single checkout prefetch request contains.
+   */
+  ConfigSetting<uint64_t> checkoutPrefetchBatchSize{
+      "checkout:prefetch-batch-size",
+      20480,
+      this};
+
+  /**
+   * For how long after a checkout the files that are loaded from source
+   * control are recorded in the mount's checkout profile.  The next
+   * checkout prefetches the recorded files at low priority.  Zero disables
+   * both recording and prefetching.
+   */
+  ConfigSetting<std::chrono::nanoseconds> checkoutProfileWindow{
+      "checkout:profile-window",
+      std::chrono::nanoseconds::zero(),
+      this};
+
+  /**
+   * The most paths that the checkout profile keeps for each command.
+   */
+  ConfigSetting<uint64_t> checkoutProfileMaxPaths{
+      "checkout:profile-max-paths",
+      20000,
+      this};
+
+  /**
+   * Whether checkout on Windows collects the ProjectedFS placeholders that it
+   * invalidates and updates them in one batch once the tree is checked out,
+   * instead of removing them one at a time while holding the rename lock.
+   * Files whose new size is known are updated in place, and the directories of
+   * the checkout profile that were changed are filled with placeholders.
+   */
+  ConfigSetting<bool> prjfsBatchCheckoutUpdates{
+      "prjfs:batch-checkout-updates",
+      false,
+      this};
+
+  /**
+   * The number of threads that apply batched placeholder updates.
+   */
+  ConfigSetting<uint64_t> prjfsUpdateThreads{"prjfs:update-threads", 8, this};
+
+  /**
+   * The most loaded files and directories that a mount remembers when it is
+   * shut down, so that they can be prefetched after edenfs restarts.  0
+   * disables both remembering and prefetching them.
+   */
+  ConfigSetting<uint64_t> warmRestartMaxPaths{
+      "mount:warm-restart-max-paths",
+      0,
+      this};
+
+  /**
+   * How long after a mount starts to keep prefetching the files and
+   * directories it remembered from before the restart.
+   */
+  ConfigSetting<std::chrono::nanoseconds> warmRestartTimeBudget{
+      "mount:warm-restart-time-budget",
+      std::chrono::seconds{60},
+      this};
+
   /**
    * A command to run to warn the user of a generic problem encountered
    * while trying to process a request.
@@ -369,6 +1018,34 @@ class EdenConfig : private ConfigSettingManager {
 
   ConfigSetting<uint64_t> maxLogFileSize{"log:max-file-size", 50000000, this};
   ConfigSetting<uint64_t> maxRotatedLogFiles{"log:num-rotated-logs", 3, this};
+
+  // [journal]
+
+  /**
+   * Whether to keep a copy of each mount's journal on disk, so that after a
+   * graceful restart or takeover journal positions from before the restart
+   * stay valid and watchman does not have to recrawl the mount.
+   */
+  ConfigSetting<bool> persistentJournal{"journal:persistent", false, this};
+
+  /**
+   * The size in bytes of each mount's on-disk journal.  At least the most
+   * recent half of it is kept.
+   */
+  ConfigSetting<uint64_t> persistentJournalSize{
+      "journal:persistent-size",
+      64 * 1024 * 1024,
+      this};
+
+  /**
+   * Whether file changes are staged per thread and merged into each mount's
+   * journal in batches, so that parallel writers don't all contend on the
+   * journal lock.  This is only read when a mount is created.
+   */
+  ConfigSetting<bool> journalStagedWrites{
+      "journal:staged-writes",
+      false,
+      this};
 };
 } // namespace eden
 } // namespace facebook
@@ -21,7 +21,7 @@ namespace facebook {
 namespace eden {
 
 ReloadableConfig::ReloadableConfig(std::shared_ptr<const EdenConfig> config)
-    : state_{ConfigState{config}} {}
+    : state_{ConfigState{config}}, current_{config} {}
 
 ReloadableConfig::~ReloadableConfig() {}
 
@@ -69,6 +69,7 @@ std::shared_ptr<const EdenConfig> ReloadableConfig::getEdenConfig(
       newConfig->loadSystemConfig();
     }
     state->config = std::move(newConfig);
+    current_.reset(state->config);
   }
   return state->config;
 }
@@ -7,10 +7,12 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <memory>
 
 #include <folly/Synchronized.h>
+#include <folly/experimental/ReadMostlySharedPtr.h>
 
 #include "eden/fs/config/gen-cpp2/eden_config_types.h"
 
@@ -37,6 +39,19 @@ class ReloadableConfig {
   std::shared_ptr<const EdenConfig> getEdenConfig(
       ConfigReloadBehavior reload = ConfigReloadBehavior::AutoReload);
 
+  /**
+   * Get the most recently loaded EdenConfig without taking a lock, sharing a
+   * reference count with other threads or checking the config files for
+   * changes.  Intended for hot paths such as the import workers.
+   *
+   * Changes on disk are only seen once some other caller reloads the config,
+   * e.g. EdenServer's periodic reload task or an AutoReload getEdenConfig().
+   * A replaced config is freed once the last returned pointer to it is gone.
+   */
+  folly::ReadMostlySharedPtr<const EdenConfig> getCachedEdenConfig() const {
+    return current_.getShared();
+  }
+
  private:
   struct ConfigState {
     explicit ConfigState(const std::shared_ptr<const EdenConfig>& config)
@@ -45,6 +60,7 @@ class ReloadableConfig {
   };
 
   folly::Synchronized<ConfigState> state_;
+  folly::ReadMostlyMainPtr<const EdenConfig> current_;
   std::atomic<std::chrono::steady_clock::time_point::rep> lastCheck_;
 };
 
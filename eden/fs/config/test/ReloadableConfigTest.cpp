@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/config/ReloadableConfig.h"
+
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <gtest/gtest.h>
+
+#include "eden/fs/config/EdenConfig.h"
+
+using folly::test::TemporaryDirectory;
+using namespace facebook::eden;
+
+TEST(ReloadableConfig, cached_config_follows_reloads) {
+  TemporaryDirectory tmpDir{"eden_reloadable_config_test_"};
+  AbsolutePath dir{tmpDir.path().string()};
+  auto userConfigPath = dir + PathComponentPiece{".edenrc"};
+  auto systemConfigPath = dir + PathComponentPiece{"edenfs.rc"};
+
+  ReloadableConfig config{std::make_shared<EdenConfig>(
+      "bob",
+      uid_t{},
+      dir,
+      userConfigPath,
+      dir,
+      systemConfigPath)};
+  std::weak_ptr<const EdenConfig> weakOriginal =
+      config.getEdenConfig(ConfigReloadBehavior::NoReload);
+  auto original = config.getCachedEdenConfig();
+  EXPECT_EQ(
+      original.get(),
+      config.getEdenConfig(ConfigReloadBehavior::NoReload).get());
+  EXPECT_EQ(0, original->hgBlobImportBatchSize.getValue());
+
+  folly::writeFile(
+      folly::StringPiece{"[hg]\nblob-import-batch-size=7\n"},
+      userConfigPath.c_str());
+  // Reading the cached config never checks the files.
+  EXPECT_EQ(original.get(), config.getCachedEdenConfig().get());
+
+  config.getEdenConfig(ConfigReloadBehavior::ForceReload);
+  auto reloaded = config.getCachedEdenConfig();
+  EXPECT_NE(original.get(), reloaded.get());
+  EXPECT_EQ(7, reloaded->hgBlobImportBatchSize.getValue());
+  // The replaced config is still alive for readers that hold on to it.
+  EXPECT_EQ(0, original->hgBlobImportBatchSize.getValue());
+  EXPECT_FALSE(weakOriginal.expired());
+
+  // Once no reader holds it, the replaced config is freed rather than kept
+  // for the lifetime of the ReloadableConfig.
+  original.reset();
+  EXPECT_TRUE(weakOriginal.expired());
+}
@@ -7,30 +7,129 @@
 
 #include "eden/fs/fuse/BufVec.h"
 
+#include <fcntl.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/logging/xlog.h>
+
 namespace facebook {
 namespace eden {
 
 BufVec::Buf::Buf(std::unique_ptr<folly::IOBuf> buf) : buf(std::move(buf)) {}
 
+BufVec::Buf::Buf(
+    int fd,
+    off_t pos,
+    size_t size,
+    std::shared_ptr<const void> owner)
+    : fd(fd), fd_size(size), fd_pos(pos), fd_owner(std::move(owner)) {}
+
 BufVec::BufVec(std::unique_ptr<folly::IOBuf> buf) {
   items_.emplace_back(std::make_shared<Buf>(std::move(buf)));
 }
 
+BufVec BufVec::fromFd(
+    int fd,
+    off_t offset,
+    size_t size,
+    std::shared_ptr<const void> owner) {
+  DCHECK_GE(fd, 0);
+  DCHECK_GE(offset, 0);
+  BufVec vec;
+  vec.items_.emplace_back(
+      std::make_shared<Buf>(fd, offset, size, std::move(owner)));
+  return vec;
+}
+
+bool BufVec::hasFdSegments() const {
+  for (const auto& b : items_) {
+    if (b->fd != -1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BufVec::readIntoMemory() {
+  for (auto& b : items_) {
+    if (b->fd == -1) {
+      continue;
+    }
+
+    auto buf = folly::IOBuf::createCombined(b->fd_size);
+    auto res = folly::preadFull(
+        b->fd, buf->writableBuffer(), b->fd_size, b->fd_pos);
+    if (res < 0) {
+      folly::throwSystemError("pread failed while loading BufVec segment");
+    }
+    buf->append(res);
+
+    b = std::make_shared<Buf>(std::move(buf));
+  }
+}
+
+#ifdef __linux__
+size_t BufVec::spliceToPipe(int pipeFd) const {
+  size_t total = 0;
+  for (const auto& b : items_) {
+    if (b->fd == -1) {
+      folly::fbvector<struct iovec> vec;
+      b->buf->appendToIov(&vec);
+      auto expected = b->buf->computeChainDataLength();
+      auto res = folly::writevFull(pipeFd, vec.data(), vec.size());
+      if (res < 0) {
+        folly::throwSystemError("error writing BufVec segment to pipe");
+      }
+      total += res;
+      if (static_cast<size_t>(res) != expected) {
+        return total;
+      }
+      continue;
+    }
+
+    loff_t pos = b->fd_pos;
+    size_t remaining = b->fd_size;
+    while (remaining > 0) {
+      auto res = splice(b->fd, &pos, pipeFd, nullptr, remaining, SPLICE_F_MOVE);
+      if (res < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        folly::throwSystemError("error splicing BufVec segment to pipe");
+      }
+      if (res == 0) {
+        // The file is shorter than expected.
+        return total;
+      }
+      remaining -= res;
+      total += res;
+    }
+  }
+  return total;
+}
+#endif
+
 folly::fbvector<struct iovec> BufVec::getIov() const {
   folly::fbvector<struct iovec> vec;
+  appendIov(vec);
+  return vec;
+}
 
+void BufVec::appendIov(folly::fbvector<struct iovec>& vec) const {
   for (const auto& b : items_) {
-    DCHECK(b->fd == -1) << "we don't support splicing yet";
+    DCHECK(b->fd == -1) << "fd segments must be loaded with readIntoMemory()";
     b->buf->appendToIov(&vec);
   }
-
-  return vec;
 }
 
 size_t BufVec::size() const {
   size_t total = 0;
   for (const auto& b : items_) {
-    total += b->buf->computeChainDataLength();
+    if (b->fd != -1) {
+      total += b->fd_size;
+    } else {
+      total += b->buf->computeChainDataLength();
+    }
   }
   return total;
 }
@@ -39,7 +138,16 @@ std::string BufVec::copyData() const {
   std::string rv;
   rv.reserve(size());
   for (const auto& b : items_) {
-    DCHECK(b->fd == -1) << "we don't support splicing yet";
+    if (b->fd != -1) {
+      auto start = rv.size();
+      rv.resize(start + b->fd_size);
+      auto res = folly::preadFull(b->fd, &rv[start], b->fd_size, b->fd_pos);
+      if (res < 0) {
+        folly::throwSystemError("pread failed while copying BufVec segment");
+      }
+      rv.resize(start + res);
+      continue;
+    }
     const auto* buf = b->buf.get();
     do {
       rv.append(reinterpret_cast<const char*>(buf->data()), buf->length());
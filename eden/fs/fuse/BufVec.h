@@ -15,9 +15,9 @@ namespace eden {
 /**
  * Represents data that may come from a buffer or a file descriptor.
  *
- * While we don't currently have a fuse client lib that supports this,
- * we want to make sure we're ready to use it, so this looks like
- * a dumb wrapper around IOBuf at the moment.
+ * Buffer segments are plain IOBuf chains.  File descriptor segments refer to
+ * a byte range of an open file and allow the data to be spliced directly to
+ * the FUSE device without first copying it into userspace.
  */
 class BufVec {
   struct Buf {
@@ -25,6 +25,8 @@ class BufVec {
     int fd{-1};
     size_t fd_size{0};
     off_t fd_pos{-1};
+    // Keeps the file descriptor open for as long as this segment is alive.
+    std::shared_ptr<const void> fd_owner;
 
     Buf(const Buf&) = delete;
     Buf& operator=(const Buf&) = delete;
@@ -32,9 +34,12 @@ class BufVec {
     Buf& operator=(Buf&&) = default;
 
     explicit Buf(std::unique_ptr<folly::IOBuf> buf);
+    Buf(int fd, off_t pos, size_t size, std::shared_ptr<const void> owner);
   };
   folly::fbvector<std::shared_ptr<Buf>> items_;
 
+  BufVec() = default;
+
  public:
   BufVec(const BufVec&) = delete;
   BufVec& operator=(const BufVec&) = delete;
@@ -43,6 +48,45 @@ class BufVec {
 
   explicit BufVec(std::unique_ptr<folly::IOBuf> buf);
 
+  /**
+   * Create a BufVec referring to `size` bytes of `fd` starting at `offset`.
+   *
+   * The data is not read until it is needed.  `owner` is retained until the
+   * BufVec is destroyed and must keep `fd` open.
+   */
+  static BufVec fromFd(
+      int fd,
+      off_t offset,
+      size_t size,
+      std::shared_ptr<const void> owner);
+
+  /**
+   * Returns true if any part of this BufVec refers to a file descriptor
+   * rather than to memory.  getIov() may only be called once all such
+   * segments have been loaded with readIntoMemory().
+   */
+  bool hasFdSegments() const;
+
+  /**
+   * Replace all file descriptor segments with buffers holding their data.
+   *
+   * If the file is shorter than expected the resulting buffers are shortened
+   * accordingly.  Throws std::system_error if reading from a file fails.
+   */
+  void readIntoMemory();
+
+#ifdef __linux__
+  /**
+   * Transfer the contents of this BufVec into the write end of a pipe.
+   *
+   * Buffer segments are written to the pipe and file descriptor segments are
+   * spliced into it, so file data is never copied through userspace.
+   * Returns the number of bytes transferred, which may be less than size() if
+   * a file was truncated concurrently.  Throws std::system_error on failure.
+   */
+  size_t spliceToPipe(int pipeFd) const;
+#endif
+
   /**
    * Return an iovector suitable for e.g. writev()
    *   auto iov = buf->getIov();
@@ -50,6 +94,12 @@ class BufVec {
    */
   folly::fbvector<struct iovec> getIov() const;
 
+  /**
+   * Like getIov(), but appends to an existing iovector so that callers can
+   * reuse its storage across calls.
+   */
+  void appendIov(folly::fbvector<struct iovec>& vec) const;
+
   /**
    * Returns the total number of bytes in the BufVec.
    */
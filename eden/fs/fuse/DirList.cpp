@@ -18,6 +18,10 @@ namespace eden {
 DirList::DirList(size_t maxSize)
     : buf_(new char[maxSize]), end_(buf_.get() + maxSize), cur_(buf_.get()) {}
 
+size_t DirList::entrySize(StringPiece name) {
+  return FUSE_DIRENT_ALIGN(FUSE_NAME_OFFSET + name.size());
+}
+
 bool DirList::add(StringPiece name, ino_t inode, dtype_t type, off_t off) {
   const size_t avail = end_ - cur_;
   const auto entLength = FUSE_NAME_OFFSET + name.size();
@@ -42,6 +46,12 @@ bool DirList::add(StringPiece name, ino_t inode, dtype_t type, off_t off) {
   return true;
 }
 
+void DirList::addSerialized(StringPiece dirents) {
+  CHECK_LE(dirents.size(), remaining());
+  memcpy(cur_, dirents.data(), dirents.size());
+  cur_ += dirents.size();
+}
+
 StringPiece DirList::getBuf() const {
   return StringPiece(buf_.get(), cur_ - buf_.get());
 }
@@ -63,5 +73,73 @@ std::vector<DirList::ExtractedEntry> DirList::extract() const {
   return result;
 }
 
+#ifdef __linux__
+DirListPlus::DirListPlus(size_t maxSize)
+    : buf_(new char[maxSize]), end_(buf_.get() + maxSize), cur_(buf_.get()) {}
+
+size_t DirListPlus::entrySize(StringPiece name) {
+  return FUSE_DIRENT_ALIGN(FUSE_NAME_OFFSET_DIRENTPLUS + name.size());
+}
+
+bool DirListPlus::add(StringPiece name, ino_t inode, dtype_t type, off_t off) {
+  fuse_entry_out entry = {};
+  entry.attr.ino = inode;
+  return add(name, entry, type, off);
+}
+
+bool DirListPlus::add(
+    StringPiece name,
+    const fuse_entry_out& entry,
+    dtype_t type,
+    off_t off) {
+  const size_t avail = end_ - cur_;
+  const auto entLength = FUSE_NAME_OFFSET_DIRENTPLUS + name.size();
+  const auto fullSize = FUSE_DIRENT_ALIGN(entLength);
+  if (fullSize > avail) {
+    return false;
+  }
+
+  fuse_direntplus* const direntplus = reinterpret_cast<fuse_direntplus*>(cur_);
+  direntplus->entry_out = entry;
+  fuse_dirent& dirent = direntplus->dirent;
+  dirent.ino = entry.attr.ino;
+  dirent.off = off;
+  dirent.namelen = name.size();
+  dirent.type = static_cast<decltype(dirent.type)>(type);
+  memcpy(dirent.name, name.data(), name.size());
+  if (fullSize > entLength) {
+    // 0 out any padding
+    memset(cur_ + entLength, 0, fullSize - entLength);
+  }
+
+  cur_ += fullSize;
+  DCHECK_LE(cur_, end_);
+  return true;
+}
+
+StringPiece DirListPlus::getBuf() const {
+  return StringPiece(buf_.get(), cur_ - buf_.get());
+}
+
+std::vector<DirListPlus::ExtractedEntry> DirListPlus::extract() const {
+  std::vector<DirListPlus::ExtractedEntry> result;
+
+  char* p = buf_.get();
+  while (p != cur_) {
+    auto direntplus = reinterpret_cast<fuse_direntplus*>(p);
+    const auto& dirent = direntplus->dirent;
+    result.emplace_back(ExtractedEntry{
+        std::string{dirent.name, dirent.name + dirent.namelen},
+        dirent.ino,
+        static_cast<dtype_t>(dirent.type),
+        static_cast<off_t>(dirent.off),
+        direntplus->entry_out});
+
+    p += FUSE_DIRENTPLUS_SIZE(direntplus);
+  }
+  return result;
+}
+#endif
+
 } // namespace eden
 } // namespace facebook
@@ -9,6 +9,7 @@
 #include <folly/Range.h>
 #include <sys/stat.h>
 #include <memory>
+#include "eden/fs/fuse/FuseTypes.h"
 #include "eden/fs/utils/DirType.h"
 
 namespace facebook {
@@ -37,12 +38,97 @@ class DirList {
   DirList(DirList&&) = default;
   DirList& operator=(DirList&&) = default;
 
+  /**
+   * Returns the number of bytes an entry with the given name occupies.
+   */
+  static size_t entrySize(folly::StringPiece name);
+
+  /**
+   * Returns the number of bytes still available in the list.
+   */
+  size_t remaining() const {
+    return end_ - cur_;
+  }
+
   /**
    * Add a new dirent to the list.
    * Returns true on success or false if the list is full.
    */
   bool add(folly::StringPiece name, ino_t inode, dtype_t type, off_t off);
 
+  /**
+   * Append whole dirents taken from another DirList's getBuf().  The caller
+   * must ensure that they fit in remaining().
+   */
+  void addSerialized(folly::StringPiece dirents);
+
+  folly::StringPiece getBuf() const;
+
+  /**
+   * Helper function that parses an accumulated buffer back into its constituent
+   * parts.
+   */
+  std::vector<ExtractedEntry> extract() const;
+};
+
+#ifdef __linux__
+/**
+ * Helper for populating FUSE_READDIRPLUS replies.
+ *
+ * Each entry is a fuse_direntplus: a dirent preceded by a fuse_entry_out.
+ * Entries added without attributes carry a nodeid of 0, which tells the
+ * kernel not to instantiate a dentry for them or bump their lookup count.
+ */
+class DirListPlus {
+  std::unique_ptr<char[]> buf_;
+  char* end_;
+  char* cur_;
+
+ public:
+  struct ExtractedEntry {
+    std::string name;
+    ino_t inode;
+    dtype_t type;
+    off_t offset;
+    fuse_entry_out entry;
+  };
+
+  explicit DirListPlus(size_t maxSize);
+
+  DirListPlus(const DirListPlus&) = delete;
+  DirListPlus& operator=(const DirListPlus&) = delete;
+  DirListPlus(DirListPlus&&) = default;
+  DirListPlus& operator=(DirListPlus&&) = default;
+
+  /**
+   * Returns the number of bytes an entry with the given name occupies.
+   */
+  static size_t entrySize(folly::StringPiece name);
+
+  /**
+   * Returns the number of bytes still available in the list.
+   */
+  size_t remaining() const {
+    return end_ - cur_;
+  }
+
+  /**
+   * Add a dirent without attributes.
+   * Returns true on success or false if the list is full.
+   */
+  bool add(folly::StringPiece name, ino_t inode, dtype_t type, off_t off);
+
+  /**
+   * Add a dirent along with its attributes.  entry.nodeid must be nonzero;
+   * the caller is responsible for incrementing the inode's FUSE reference
+   * count if and only if this returns true.
+   */
+  bool add(
+      folly::StringPiece name,
+      const fuse_entry_out& entry,
+      dtype_t type,
+      off_t off);
+
   folly::StringPiece getBuf() const;
 
   /**
@@ -51,6 +137,7 @@ class DirList {
    */
   std::vector<ExtractedEntry> extract() const;
 };
+#endif
 
 } // namespace eden
 } // namespace facebook
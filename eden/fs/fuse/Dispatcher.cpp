@@ -54,8 +54,36 @@ fuse_attr_out Dispatcher::Attr::asFuseAttr() const {
   return result;
 }
 
+fuse_entry_out Dispatcher::Attr::asFuseEntry() const {
+  DCHECK(st.st_ino) << "We should never return a 0 inode to FUSE";
+  fuse_entry_out entry = {};
+  entry.nodeid = st.st_ino;
+  entry.generation = 0;
+  auto fuse_attr = asFuseAttr();
+  entry.attr = fuse_attr.attr;
+  entry.attr_valid = fuse_attr.attr_valid;
+  entry.attr_valid_nsec = fuse_attr.attr_valid_nsec;
+  entry.entry_valid = fuse_attr.attr_valid;
+  entry.entry_valid_nsec = fuse_attr.attr_valid_nsec;
+  return entry;
+}
+
 Dispatcher::~Dispatcher() {}
 
+std::optional<Dispatcher::Attr> Dispatcher::getattrIfReady(InodeNumber) {
+  return std::nullopt;
+}
+
+std::optional<fuse_entry_out> Dispatcher::lookupIfReady(
+    InodeNumber,
+    PathComponentPiece) {
+  return std::nullopt;
+}
+
+std::optional<std::string> Dispatcher::readlinkIfReady(InodeNumber, bool) {
+  return std::nullopt;
+}
+
 Dispatcher::Dispatcher(EdenStats* stats) : stats_(stats) {}
 
 void Dispatcher::initConnection(const fuse_init_out& out) {
@@ -177,6 +205,13 @@ Dispatcher::readdir(InodeNumber, DirList&&, off_t, uint64_t) {
   FUSELL_NOT_IMPL();
 }
 
+#ifdef __linux__
+folly::Future<DirListPlus>
+Dispatcher::readdirplus(InodeNumber, DirListPlus&&, off_t, uint64_t) {
+  FUSELL_NOT_IMPL();
+}
+#endif
+
 folly::Future<struct fuse_kstatfs> Dispatcher::statfs(InodeNumber /*ino*/) {
   struct fuse_kstatfs info = {};
 
@@ -10,6 +10,7 @@
 #include <folly/Portability.h>
 #include <folly/Range.h>
 #include <sys/statvfs.h>
+#include <optional>
 #include "eden/fs/fuse/BufVec.h"
 #include "eden/fs/fuse/FuseTypes.h"
 #include "eden/fs/fuse/InodeNumber.h"
@@ -30,6 +31,7 @@ namespace eden {
   } while (0)
 
 class DirList;
+class DirListPlus;
 class Dispatcher;
 class EdenStats;
 class FileHandle;
@@ -114,8 +116,34 @@ class Dispatcher {
         uint64_t timeout = std::numeric_limits<int32_t>::max());
 
     fuse_attr_out asFuseAttr() const;
+
+    /**
+     * Build the fuse_entry_out sent in response to lookup-like requests,
+     * using the same timeout for the entry as for the attributes.
+     */
+    fuse_entry_out asFuseEntry() const;
   };
 
+  /**
+   * Synchronous fast paths for getattr(), lookup() and readlink().
+   *
+   * These are called on the FUSE worker thread before the corresponding
+   * Future-based method, and may answer a request inline when the result is
+   * already available in memory, e.g. because the inode is loaded.  They
+   * must never block.  Returning std::nullopt means the request should go
+   * through the regular asynchronous method instead.
+   *
+   * As with lookup(), a successful lookupIfReady() must increment the FUSE
+   * reference count of the returned inode.
+   */
+  virtual std::optional<Attr> getattrIfReady(InodeNumber ino);
+  virtual std::optional<fuse_entry_out> lookupIfReady(
+      InodeNumber parent,
+      PathComponentPiece name);
+  virtual std::optional<std::string> readlinkIfReady(
+      InodeNumber ino,
+      bool kernelCachesReadlink);
+
   /**
    * Get file attributes
    *
@@ -352,6 +380,23 @@ class Dispatcher {
   virtual folly::Future<DirList>
   readdir(InodeNumber ino, DirList&& dirList, off_t offset, uint64_t fh);
 
+#ifdef __linux__
+  /**
+   * Read directory, including attributes for the entries.
+   *
+   * Send a DirListPlus filled using DirListPlus::add().  Entries added with
+   * attributes must have their FUSE reference count incremented, as with
+   * lookup().
+   *
+   * The fh parameter contains opendir's result.
+   */
+  virtual folly::Future<DirListPlus> readdirplus(
+      InodeNumber ino,
+      DirListPlus&& dirList,
+      off_t offset,
+      uint64_t fh);
+#endif
+
   /**
    * Get file system statistics
    *
@@ -8,20 +8,38 @@
 #include "eden/fs/fuse/FuseChannel.h"
 
 #include <boost/cast.hpp>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
 #include <folly/futures/Future.h>
 #include <folly/io/async/Request.h>
 #include <folly/logging/xlog.h>
+#include <folly/ScopeGuard.h>
+#include <folly/String.h>
+#include <folly/container/F14Map.h>
+#include <folly/container/F14Set.h>
 #include <folly/system/ThreadName.h>
 #include <signal.h>
+#include <future>
 #include <type_traits>
+#include "eden/fs/eden-config.h"
 #include "eden/fs/fuse/DirList.h"
 #include "eden/fs/fuse/Dispatcher.h"
+#include "eden/fs/fuse/FuseRequestTrace.h"
 #include "eden/fs/fuse/RequestData.h"
+#include "eden/fs/telemetry/EdenStats.h"
+#include "eden/fs/telemetry/Tracing.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/Synchronized.h"
 #include "eden/fs/utils/SystemError.h"
 #include "eden/fs/utils/Thread.h"
 
+#ifdef EDEN_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
 using namespace folly;
 using std::string;
 
@@ -33,6 +51,41 @@ namespace {
 // This is the minimum size used by libfuse so we use it too!
 constexpr size_t MIN_BUFSIZE = 0x21000;
 
+// Room reserved in each request buffer for the fuse_in_header and
+// fuse_write_in that precede a FUSE_WRITE payload.
+constexpr size_t kRequestHeaderSpace = 0x1000;
+
+#ifdef __linux__
+// The kernel refuses to raise max_pages beyond this.  See FUSE_MAX_MAX_PAGES
+// in fs/fuse/fuse_i.h.
+constexpr size_t kFuseMaxMaxPages = 256;
+
+// The pages per request without FUSE_MAX_PAGES.  See
+// FUSE_DEFAULT_MAX_PAGES_PER_REQ in fs/fuse/fuse_i.h.
+constexpr size_t kFuseDefaultMaxPages = 32;
+
+/**
+ * The largest pipe an unprivileged process may ask for with F_SETPIPE_SZ.
+ * Asking for more fails with EPERM.
+ */
+size_t getPipeMaxSize() {
+  static const size_t pipeMaxSize = [] {
+    std::string contents;
+    if (folly::readFile("/proc/sys/fs/pipe-max-size", contents)) {
+      auto size = folly::tryTo<size_t>(folly::trimWhitespace(contents));
+      if (size.hasValue()) {
+        return size.value();
+      }
+    }
+    // The kernel's default.
+    return size_t{1024 * 1024};
+  }();
+  return pipeMaxSize;
+}
+#endif
+
+} // namespace
+
 StringPiece fuseOpcodeName(FuseOpcode opcode) {
   switch (opcode) {
     case FUSE_LOOKUP:
@@ -140,6 +193,8 @@ StringPiece fuseOpcodeName(FuseOpcode opcode) {
   return "<unknown>";
 }
 
+namespace {
+
 ProcessAccessLog::AccessType getAccessType(FuseOpcode opcode) {
   switch (opcode) {
     case FUSE_GETATTR:
@@ -248,6 +303,10 @@ const FuseChannel::HandlerMap FuseChannel::handlerMap_ = {
     {FUSE_FLUSH, {&FuseChannel::fuseFlush, &FuseThreadStats::flush}},
     {FUSE_OPENDIR, {&FuseChannel::fuseOpenDir, &FuseThreadStats::opendir}},
     {FUSE_READDIR, {&FuseChannel::fuseReadDir, &FuseThreadStats::readdir}},
+#ifdef __linux__
+    {FUSE_READDIRPLUS,
+     {&FuseChannel::fuseReadDirPlus, &FuseThreadStats::readdirplus}},
+#endif
     {FUSE_RELEASEDIR,
      {&FuseChannel::fuseReleaseDir, &FuseThreadStats::releasedir}},
     {FUSE_FSYNCDIR, {&FuseChannel::fuseFsyncDir, &FuseThreadStats::fsyncdir}},
@@ -314,6 +373,7 @@ static const std::unordered_map<int32_t, const char*> capsLabels = {
     {FUSE_PARALLEL_DIROPS, "PARALLEL_DIROPS"},
     {FUSE_HANDLE_KILLPRIV, "HANDLE_KILLPRIV"},
     {FUSE_POSIX_ACL, "POSIX_ACL"},
+    {FUSE_MAX_PAGES, "MAX_PAGES"},
     {FUSE_CACHE_SYMLINKS, "CACHE_SYMLINKS"},
     {FUSE_NO_OPENDIR_SUPPORT, "NO_OPENDIR_SUPPORT"},
 #endif
@@ -329,6 +389,11 @@ static const std::unordered_map<int32_t, const char*> capsLabels = {
 FuseChannel::DataRange::DataRange(int64_t off, int64_t len)
     : offset(off), length(len) {}
 
+FuseChannel::DataStore::DataStore(
+    uint64_t off,
+    std::unique_ptr<folly::IOBuf> buf)
+    : offset(off), data(std::move(buf)) {}
+
 FuseChannel::InvalidationEntry::InvalidationEntry(
     InodeNumber num,
     PathComponentPiece n)
@@ -345,6 +410,14 @@ FuseChannel::InvalidationEntry::InvalidationEntry(Promise<Unit> p)
       inode(kRootNodeId),
       promise(std::move(p)) {}
 
+FuseChannel::InvalidationEntry::InvalidationEntry(
+    InodeNumber num,
+    uint64_t offset,
+    std::unique_ptr<folly::IOBuf> data)
+    : type(InvalidationType::STORE),
+      inode(num),
+      store(offset, std::move(data)) {}
+
 FuseChannel::InvalidationEntry::~InvalidationEntry() {
   switch (type) {
     case InvalidationType::INODE:
@@ -356,6 +429,9 @@ FuseChannel::InvalidationEntry::~InvalidationEntry() {
     case InvalidationType::FLUSH:
       promise.~Promise();
       return;
+    case InvalidationType::STORE:
+      store.~DataStore();
+      return;
   }
   XLOG(FATAL) << "unknown InvalidationEntry type: "
               << static_cast<uint64_t>(type);
@@ -376,6 +452,9 @@ FuseChannel::InvalidationEntry::InvalidationEntry(
   static_assert(
       std::is_nothrow_move_constructible<DataRange>::value,
       "All members should be nothrow move constructible");
+  static_assert(
+      std::is_nothrow_move_constructible<DataStore>::value,
+      "All members should be nothrow move constructible");
 
   switch (type) {
     case InvalidationType::INODE:
@@ -387,6 +466,9 @@ FuseChannel::InvalidationEntry::InvalidationEntry(
     case InvalidationType::FLUSH:
       new (&promise) Promise<Unit>(std::move(other.promise));
       return;
+    case InvalidationType::STORE:
+      new (&store) DataStore(std::move(other.store));
+      return;
   }
 }
 
@@ -402,20 +484,27 @@ std::ostream& operator<<(
                 << "\")";
     case FuseChannel::InvalidationType::FLUSH:
       return os << "(invalidation flush)";
+    case FuseChannel::InvalidationType::STORE:
+      return os << "(store inode " << entry.inode << ", offset "
+                << entry.store.offset << ", length "
+                << entry.store.data->computeChainDataLength() << ")";
   }
   return os << "(unknown invalidation type "
             << static_cast<uint64_t>(entry.type) << " inode " << entry.inode
             << ")";
 }
 
-void FuseChannel::replyError(const fuse_in_header& request, int errorCode) {
+void FuseChannel::replyError(
+    const fuse_in_header& request,
+    int errorCode,
+    int deviceFd) {
   fuse_out_header err;
   err.len = sizeof(err);
   err.error = -errorCode;
   err.unique = request.unique;
   XLOG(DBG7) << "replyError unique=" << err.unique << " error=" << errorCode
              << " " << folly::errnoStr(errorCode);
-  auto res = write(fuseDevice_.fd(), &err, sizeof(err));
+  auto res = write(getReplyFd(deviceFd), &err, sizeof(err));
   if (res != sizeof(err)) {
     if (res < 0) {
       throwSystemError("replyError: error writing to fuse device");
@@ -427,19 +516,21 @@ void FuseChannel::replyError(const fuse_in_header& request, int errorCode) {
 
 void FuseChannel::sendReply(
     const fuse_in_header& request,
-    folly::fbvector<iovec>&& vec) const {
+    folly::fbvector<iovec>&& vec,
+    int deviceFd) const {
   fuse_out_header out;
   out.unique = request.unique;
   out.error = 0;
 
   vec.insert(vec.begin(), make_iovec(out));
 
-  sendRawReply(vec.data(), vec.size());
+  sendRawReply(vec.data(), vec.size(), deviceFd);
 }
 
 void FuseChannel::sendReply(
     const fuse_in_header& request,
-    folly::ByteRange bytes) const {
+    folly::ByteRange bytes,
+    int deviceFd) const {
   fuse_out_header out;
   out.unique = request.unique;
   out.error = 0;
@@ -450,10 +541,177 @@ void FuseChannel::sendReply(
   iov[1].iov_base = const_cast<uint8_t*>(bytes.data());
   iov[1].iov_len = bytes.size();
 
-  sendRawReply(iov.data(), iov.size());
+  sendRawReply(iov.data(), iov.size(), deviceFd);
+}
+
+void FuseChannel::sendReply(
+    const fuse_in_header& request,
+    BufVec&& buf,
+    int deviceFd) const {
+  if (buf.hasFdSegments()) {
+#ifdef __linux__
+    if (spliceReplies_.load(std::memory_order_relaxed) &&
+        trySpliceReply(request, buf, deviceFd)) {
+      return;
+    }
+#endif
+    buf.readIntoMemory();
+  }
+
+  fuse_out_header out;
+  out.unique = request.unique;
+  out.error = 0;
+
+  auto& vec = *replyIovecs_;
+  const auto capacity = vec.capacity();
+  vec.clear();
+  vec.push_back(make_iovec(out));
+  buf.appendIov(vec);
+  recordReplyPoolUse(vec.capacity() == capacity);
+  SCOPE_EXIT {
+    vec.clear();
+  };
+
+  sendRawReply(vec.data(), vec.size(), deviceFd);
+}
+
+void FuseChannel::recordReplyPoolUse(bool hit) const {
+  if (auto* stats = dispatcher_->getStats()) {
+    auto& fuseStats = stats->getFuseStatsForCurrentThread();
+    if (hit) {
+      fuseStats.replyPoolHits.addValue(1);
+    } else {
+      fuseStats.replyPoolMisses.addValue(1);
+    }
+  }
+}
+
+#ifdef __linux__
+std::unique_ptr<FuseChannel::SplicePipe> FuseChannel::createSplicePipe()
+    const {
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC | O_NONBLOCK) != 0) {
+    XLOG(WARN) << "unable to create pipe for splicing FUSE replies: "
+               << folly::errnoStr(errno);
+    return nullptr;
+  }
+  auto pipe = std::make_unique<SplicePipe>();
+  pipe->readEnd = folly::File{fds[0], /*ownsFd=*/true};
+  pipe->writeEnd = folly::File{fds[1], /*ownsFd=*/true};
+
+  // The whole reply must be staged before it is spliced to the kernel, so
+  // size the pipe for the largest read reply, which is what file-backed
+  // replies are.  Larger replies are copied instead.  The kernel rounds the
+  // size up to a power of two pages.
+  auto capacity = fcntl(
+      fds[1],
+      F_SETPIPE_SZ,
+      std::min(getMaxReadReplySize(), getPipeMaxSize()));
+  if (capacity < 0) {
+    XLOG(DBG3) << "unable to grow pipe for splicing FUSE replies: "
+               << folly::errnoStr(errno);
+    capacity = fcntl(fds[1], F_GETPIPE_SZ);
+  }
+  if (capacity < 0) {
+    return nullptr;
+  }
+  pipe->capacity = capacity;
+  return pipe;
+}
+
+size_t FuseChannel::getMaxReadReplySize() const {
+  size_t maxPages = kFuseDefaultMaxPages;
+  if (connInfo_ && (connInfo_->flags & FUSE_MAX_PAGES)) {
+    maxPages = connInfo_->max_pages;
+  }
+  return sizeof(fuse_out_header) + maxPages * getpagesize();
+}
+
+bool FuseChannel::trySpliceReply(
+    const fuse_in_header& request,
+    const BufVec& buf,
+    int deviceFd) const {
+  auto& pipe = *splicePipe_;
+  if (!pipe) {
+    pipe = createSplicePipe();
+    if (!pipe) {
+      return false;
+    }
+  }
+
+  fuse_out_header out;
+  out.unique = request.unique;
+  out.error = 0;
+  out.len = sizeof(out) + buf.size();
+  if (out.len > pipe->capacity) {
+    return false;
+  }
+
+  // Stage the header and the payload in the pipe.  Any failure here leaves
+  // the pipe holding a partial reply, so discard it and let the caller fall
+  // back to copying.
+  if (folly::writeFull(pipe->writeEnd.fd(), &out, sizeof(out)) !=
+      sizeof(out)) {
+    pipe.reset();
+    return false;
+  }
+  size_t staged;
+  try {
+    staged = buf.spliceToPipe(pipe->writeEnd.fd());
+  } catch (const std::system_error& ex) {
+    XLOG(DBG3) << "unable to stage FUSE reply in pipe: " << ex.what();
+    pipe.reset();
+    return false;
+  }
+  if (staged + sizeof(out) != out.len) {
+    // The file was truncated after the reply size was computed.
+    pipe.reset();
+    return false;
+  }
+
+  const auto res = splice(
+      pipe->readEnd.fd(),
+      nullptr,
+      getReplyFd(deviceFd),
+      nullptr,
+      out.len,
+      SPLICE_F_MOVE);
+  const int err = errno;
+  XLOG(DBG7) << "trySpliceReply: unique=" << out.unique
+             << " header->len=" << out.len << " wrote=" << res;
+  if (res == static_cast<ssize_t>(out.len)) {
+    return true;
+  }
+
+  pipe.reset();
+  if (res >= 0) {
+    throw std::runtime_error("unexpected short splice to FUSE device");
+  }
+  if (err == EINVAL || err == ENOSYS) {
+    // The device does not accept spliced replies.  Stop trying; the kernel
+    // did not consume the reply, so it is safe for the caller to resend it.
+    XLOG(WARN) << "FUSE device does not support splice, disabling spliced "
+                  "replies on mount "
+               << mountPath_;
+    spliceReplies_.store(false, std::memory_order_relaxed);
+    return false;
+  }
+  if (err != ENOENT) {
+    if (!isFuseDeviceValid(state_.rlock()->stopReason)) {
+      XLOG(INFO) << "error splicing to fuse device: session closed";
+    } else {
+      XLOG(WARNING) << "error splicing to fuse device: "
+                    << folly::errnoStr(err);
+    }
+  }
+  throwSystemErrorExplicit(err, "error splicing to fuse device");
 }
+#endif
 
-void FuseChannel::sendRawReply(const iovec iov[], size_t count) const {
+void FuseChannel::sendRawReply(
+    const iovec iov[],
+    size_t count,
+    int deviceFd) const {
   // Ensure that the length is set correctly
   DCHECK_EQ(iov[0].iov_len, sizeof(fuse_out_header));
   const auto header = reinterpret_cast<fuse_out_header*>(iov[0].iov_base);
@@ -462,7 +720,7 @@ void FuseChannel::sendRawReply(const iovec iov[], size_t count) const {
     header->len += iov[i].iov_len;
   }
 
-  const auto res = writev(fuseDevice_.fd(), iov, count);
+  const auto res = writev(getReplyFd(deviceFd), iov, count);
   const int err = errno;
   XLOG(DBG7) << "sendRawReply: unique=" << header->unique
              << " header->len=" << header->len << " wrote=" << res;
@@ -487,16 +745,35 @@ FuseChannel::FuseChannel(
     Dispatcher* const dispatcher,
     std::shared_ptr<ProcessNameCache> processNameCache,
     folly::Duration requestTimeout,
-    Notifications* notifications)
-    : bufferSize_(std::max(size_t(getpagesize()) + 0x1000, MIN_BUFSIZE)),
+    Notifications* notifications,
+    bool spliceReplies,
+    bool useIoUring,
+    bool cloneDevicePerWorker,
+    bool readdirplus,
+    size_t maxWrite,
+    size_t minThreads,
+    size_t maxThreads,
+    folly::Duration workerIdleTimeout)
+    : bufferSize_(std::max(
+          {size_t(getpagesize()) + 0x1000,
+           MIN_BUFSIZE,
+           maxWrite + kRequestHeaderSpace})),
       numThreads_(numThreads),
+      minThreads_(std::min(minThreads ? minThreads : numThreads, numThreads)),
+      maxThreads_(std::max(maxThreads ? maxThreads : numThreads, numThreads)),
+      workerIdleTimeout_(workerIdleTimeout),
       dispatcher_(dispatcher),
       mountPath_(mountPath),
       requestTimeout_(requestTimeout),
       notifications_(notifications),
+      spliceReplies_(spliceReplies),
+      useIoUring_(useIoUring),
+      cloneDevicePerWorker_(cloneDevicePerWorker),
+      readdirplus_(readdirplus),
+      myPid_(getpid()),
       fuseDevice_(std::move(fuseDevice)),
       processAccessLog_(std::move(processNameCache)) {
-  CHECK_GE(numThreads_, 1);
+  CHECK_GE(minThreads_, 1);
   installSignalHandler();
 }
 
@@ -510,6 +787,8 @@ Future<FuseChannel::StopFuture> FuseChannel::initialize() {
     auto state = state_.wlock();
     state->workerThreads.reserve(numThreads_);
     state->workerThreads.emplace_back([this] { initWorkerThread(); });
+    ++state->startedThreads;
+    liveWorkers_.store(state->liveWorkers(), std::memory_order_relaxed);
     return initPromise_.getFuture();
   });
 }
@@ -518,9 +797,19 @@ FuseChannel::StopFuture FuseChannel::initializeFromTakeover(
     fuse_init_out connInfo) {
   connInfo_ = connInfo;
   dispatcher_->initConnection(connInfo);
+  // The previous process may have negotiated a larger max_write than we were
+  // configured with.  The kernel rejects reads into buffers that cannot hold
+  // a maximal FUSE_WRITE, so grow ours to match before starting the workers.
+  bufferSize_ = std::max(
+      bufferSize_, size_t(connInfo_->max_write) + kRequestHeaderSpace);
   XLOG(DBG1) << "Takeover using max_write=" << connInfo_->max_write
+#ifdef __linux__
+             << ", max_pages=" << connInfo_->max_pages
+#endif
              << ", max_readahead=" << connInfo_->max_readahead
              << ", want=" << flagsToLabel(capsLabels, connInfo_->flags);
+  // Only the main FUSE device is handed over during a takeover.  If
+  // cloneDevicePerWorker_ is set, the new worker threads clone it again.
   startWorkerThreads();
   return sessionCompletePromise_.getFuture();
 }
@@ -543,7 +832,10 @@ void FuseChannel::startWorkerThreads() {
     state->workerThreads.reserve(numThreads_);
     while (state->workerThreads.size() < numThreads_) {
       state->workerThreads.emplace_back([this] { fuseWorkerThread(); });
+      ++state->startedThreads;
     }
+    state->workersStarted = true;
+    liveWorkers_.store(state->liveWorkers(), std::memory_order_relaxed);
 
     invalidationThread_ = std::thread([this] { invalidationThread(); });
   } catch (const std::exception& ex) {
@@ -561,6 +853,10 @@ void FuseChannel::destroy() {
     auto state = state_.wlock();
     requestSessionExit(state, StopReason::DESTRUCTOR);
     threads.swap(state->workerThreads);
+    for (auto& thread : state->retiredThreads) {
+      threads.push_back(std::move(thread));
+    }
+    state->retiredThreads.clear();
   }
 
   for (auto& thread : threads) {
@@ -595,6 +891,14 @@ void FuseChannel::invalidateInode(InodeNumber ino, off_t off, off_t len) {
   invalidationCV_.notify_one();
 }
 
+void FuseChannel::storeInodeData(
+    InodeNumber ino,
+    uint64_t off,
+    std::unique_ptr<folly::IOBuf> data) {
+  invalidationQueue_.lock()->queue.emplace_back(ino, off, std::move(data));
+  invalidationCV_.notify_one();
+}
+
 void FuseChannel::invalidateEntry(InodeNumber parent, PathComponentPiece name) {
   // Add the entry to invalidationQueue_ and wake up the invalidation thread to
   // send it.
@@ -602,6 +906,21 @@ void FuseChannel::invalidateEntry(InodeNumber parent, PathComponentPiece name) {
   invalidationCV_.notify_one();
 }
 
+void FuseChannel::invalidateEntries(
+    InodeNumber parent,
+    folly::Range<const PathComponentPiece*> names) {
+  if (names.empty()) {
+    return;
+  }
+  {
+    auto queue = invalidationQueue_.lock();
+    for (auto name : names) {
+      queue->queue.emplace_back(parent, name);
+    }
+  }
+  invalidationCV_.notify_one();
+}
+
 void FuseChannel::invalidateInodes(folly::Range<InodeNumber*> range) {
   {
     auto queue = invalidationQueue_.lock();
@@ -625,6 +944,109 @@ folly::Future<folly::Unit> FuseChannel::flushInvalidations() {
   return result;
 }
 
+/**
+ * Merge redundant entries in a batch taken from the invalidation queue.
+ *
+ * Every change that caused an entry to be queued has already happened by the
+ * time the batch is sent, so between two FLUSH entries the order in which
+ * invalidations are sent does not matter and duplicates only need to be sent
+ * once.  Entries are never moved across a FLUSH, so flushInvalidations() still
+ * waits for everything queued before it.  Nothing is moved across a STORE
+ * either, so that it neither overwrites a later invalidation nor is discarded
+ * by an earlier one.
+ *
+ * Returns the number of entries that were dropped or merged.
+ */
+size_t FuseChannel::coalesceInvalidations(
+    std::vector<InvalidationEntry>& entries) {
+  constexpr int64_t kEndOfFile = std::numeric_limits<int64_t>::max();
+
+  std::vector<InvalidationEntry> result;
+  result.reserve(entries.size());
+
+  // Half-open [offset, end) data ranges per inode, kept in first-seen order.
+  // An empty vector means only the attributes need to be invalidated.
+  std::vector<InodeNumber> inodeOrder;
+  folly::F14FastMap<InodeNumber, std::vector<std::pair<int64_t, int64_t>>>
+      inodeRanges;
+  folly::F14FastSet<std::pair<uint64_t, folly::StringPiece>> seenDirEntries;
+  std::vector<size_t> dirEntries;
+
+  auto flushSegment = [&] {
+    for (auto ino : inodeOrder) {
+      auto& ranges = inodeRanges[ino];
+      if (ranges.empty()) {
+        result.emplace_back(ino, -1, 0);
+        continue;
+      }
+      std::sort(ranges.begin(), ranges.end());
+      auto current = ranges.front();
+      auto emit = [&] {
+        result.emplace_back(
+            ino,
+            current.first,
+            current.second == kEndOfFile ? 0 : current.second - current.first);
+      };
+      for (size_t i = 1; i < ranges.size(); ++i) {
+        if (ranges[i].first <= current.second) {
+          current.second = std::max(current.second, ranges[i].second);
+        } else {
+          emit();
+          current = ranges[i];
+        }
+      }
+      emit();
+    }
+    for (auto index : dirEntries) {
+      result.push_back(std::move(entries[index]));
+    }
+    inodeOrder.clear();
+    inodeRanges.clear();
+    seenDirEntries.clear();
+    dirEntries.clear();
+  };
+
+  for (size_t index = 0; index < entries.size(); ++index) {
+    auto& entry = entries[index];
+    switch (entry.type) {
+      case InvalidationType::INODE: {
+        auto [it, inserted] = inodeRanges.try_emplace(entry.inode);
+        if (inserted) {
+          inodeOrder.push_back(entry.inode);
+        }
+        // A negative offset invalidates attributes only, which every
+        // FUSE_NOTIFY_INVAL_INODE does anyway.
+        if (entry.range.offset >= 0) {
+          auto end = entry.range.length <= 0
+              ? kEndOfFile
+              : entry.range.offset +
+                  std::min(entry.range.length, kEndOfFile - entry.range.offset);
+          it->second.emplace_back(entry.range.offset, end);
+        }
+        break;
+      }
+      case InvalidationType::DIR_ENTRY:
+        if (seenDirEntries
+                .emplace(entry.inode.get(), entry.name.stringPiece())
+                .second) {
+          dirEntries.push_back(index);
+        }
+        break;
+      case InvalidationType::FLUSH:
+      case InvalidationType::STORE:
+        flushSegment();
+        result.push_back(std::move(entry));
+        break;
+    }
+  }
+  flushSegment();
+
+  DCHECK_LE(result.size(), entries.size());
+  auto coalesced = entries.size() - result.size();
+  entries.swap(result);
+  return coalesced;
+}
+
 /**
  * Send an element from the invalidation queue.
  *
@@ -648,6 +1070,9 @@ void FuseChannel::sendInvalidation(InvalidationEntry& entry) {
         // invalidation queue have been completed.
         entry.promise.setValue();
         return;
+      case InvalidationType::STORE:
+        sendStoreInode(entry.inode, entry.store);
+        return;
     }
     EDEN_BUG() << "unknown invalidation entry type "
                << static_cast<uint64_t>(entry.type);
@@ -774,6 +1199,72 @@ void FuseChannel::sendInvalidateEntry(
   }
 }
 
+/**
+ * Send a FUSE_NOTIFY_STORE message to the kernel.
+ *
+ * This method always runs in the invalidation thread.
+ */
+void FuseChannel::sendStoreInode(InodeNumber ino, DataStore& store) {
+  fuse_notify_store_out notify = {};
+  notify.nodeid = ino.get();
+  notify.offset = store.offset;
+  notify.size = store.data->computeChainDataLength();
+  XLOG(DBG3) << "sendStoreInode(ino=" << ino << ", off=" << notify.offset
+             << ", len=" << notify.size << ")";
+
+  fuse_out_header out;
+  out.unique = 0;
+  out.error = FUSE_NOTIFY_STORE;
+
+  folly::fbvector<iovec> iov;
+  iov.reserve(2 + store.data->countChainElements());
+  iov.push_back({&out, sizeof(out)});
+  iov.push_back({&notify, sizeof(notify)});
+  store.data->appendToIov(&iov);
+
+  try {
+    sendRawReply(iov.data(), iov.size());
+  } catch (const std::system_error& exc) {
+    // Ignore ENOENT.  The kernel only accepts data for inodes it has looked
+    // up, and callers store data for inodes it may not have seen yet.
+    if (!isEnoent(exc)) {
+      throwSystemErrorExplicit(
+          exc.code().value(), "error storing data for FUSE inode ", ino);
+    } else {
+      XLOG(DBG6) << "sendStoreInode(ino=" << ino << ") failed with ENOENT";
+    }
+  }
+}
+
+void FuseChannel::startRequestTrace(AbsolutePathPiece path) {
+  auto trace = std::make_shared<FuseRequestTraceWriter>(path);
+  XLOG(INFO) << "recording FUSE requests for " << mountPath_ << " to "
+             << path;
+  std::swap(*requestTrace_.wlock(), trace);
+  requestTraceActive_.store(true, std::memory_order_relaxed);
+}
+
+void FuseChannel::stopRequestTrace() {
+  requestTraceActive_.store(false, std::memory_order_relaxed);
+  // The writer flushes when the last request recording to it lets go.
+  requestTrace_.wlock()->reset();
+}
+
+void FuseChannel::traceRequest(folly::ByteRange request) {
+  if (auto trace = *requestTrace_.rlock()) {
+    trace->recordRequest(request);
+  }
+}
+
+void FuseChannel::traceEntry(const fuse_entry_out& entry) {
+  if (!requestTraceActive_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  if (auto trace = *requestTrace_.rlock()) {
+    trace->recordEntry(RequestData::get().getReq().unique, entry.nodeid);
+  }
+}
+
 std::vector<fuse_in_header> FuseChannel::getOutstandingRequests() {
   auto state = state_.wlock();
   const auto& requests = state->requests;
@@ -877,10 +1368,12 @@ void FuseChannel::fuseWorkerThread() noexcept {
   setThreadName(to<std::string>("fuse", mountPath_.basename()));
   setThreadSigmask();
   *(liveRequestWatches_.get()) =
-      std::make_shared<RequestMetricsScope::LockedRequestWatchList>();
+      std::make_shared<RequestMetricsScope::RequestWatchList>();
 
   try {
-    processSession();
+    if (processSession(getWorkerDeviceFd())) {
+      return;
+    }
   } catch (const std::exception& ex) {
     XLOG(ERR) << "unexpected error in FUSE worker thread: " << exceptionStr(ex);
     // Request that all other FUSE threads exit.
@@ -894,6 +1387,7 @@ void FuseChannel::fuseWorkerThread() noexcept {
   {
     auto state = state_.wlock();
     ++state->stoppedThreads;
+    liveWorkers_.store(state->liveWorkers(), std::memory_order_relaxed);
     DCHECK(!state->destroyPending) << "destroyPending cannot be set while "
                                       "worker threads are still running";
 
@@ -902,12 +1396,57 @@ void FuseChannel::fuseWorkerThread() noexcept {
     // but there are still outstanding requests we will invoke
     // sessionComplete() when we process the final stage of the request
     // processing for the last request.
-    if (state->stoppedThreads == numThreads_ && state->requests.empty()) {
+    if (state->allWorkersStopped() && state->requests.empty()) {
       sessionComplete(std::move(state));
     }
   }
 }
 
+int FuseChannel::getWorkerDeviceFd() {
+  if (!cloneDevicePerWorker_) {
+    return fuseDevice_.fd();
+  }
+
+#ifdef __linux__
+  {
+    auto state = state_.wlock();
+    if (!state->spareWorkerDevices.empty()) {
+      auto fd = state->spareWorkerDevices.back();
+      state->spareWorkerDevices.pop_back();
+      return fd;
+    }
+  }
+
+  // Cloned devices share the connection's input queue, but each has its own
+  // processing queue, so workers no longer contend on a single lock when
+  // reading requests and writing replies.
+  int fd = open("/dev/fuse", O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    XLOG_EVERY_MS(WARN, 60000)
+        << "unable to open /dev/fuse to clone the FUSE device for "
+        << mountPath_ << ": " << folly::errnoStr(errno);
+    return fuseDevice_.fd();
+  }
+  folly::File clone{fd, /*ownsFd=*/true};
+
+  uint32_t masterFd = fuseDevice_.fd();
+  if (ioctl(clone.fd(), FUSE_DEV_IOC_CLONE, &masterFd) != 0) {
+    // This fails on kernels older than 4.2, and in tests that use a fake
+    // FUSE device.
+    XLOG_EVERY_MS(WARN, 60000)
+        << "unable to clone the FUSE device for " << mountPath_ << ": "
+        << folly::errnoStr(errno);
+    return fuseDevice_.fd();
+  }
+
+  fd = clone.fd();
+  state_.wlock()->workerDevices.push_back(std::move(clone));
+  return fd;
+#else
+  return fuseDevice_.fd();
+#endif
+}
+
 void FuseChannel::invalidationThread() noexcept {
   // We send all FUSE_NOTIFY_INVAL_ENTRY and FUSE_NOTIFY_INVAL_INODE requests
   // in a dedicated thread.  These requests will block in the kernel until it
@@ -939,6 +1478,19 @@ void FuseChannel::invalidationThread() noexcept {
       lockedQueue->queue.swap(entries);
     }
 
+    // Drop and merge redundant entries before sending anything.  Each
+    // notification is a separate write to the FUSE device, so the batch is
+    // still sent one entry at a time.
+    auto coalesced = coalesceInvalidations(entries);
+    if (coalesced > 0) {
+      XLOG(DBG4) << "coalesced " << coalesced << " of "
+                 << entries.size() + coalesced << " invalidation requests";
+      if (auto* stats = dispatcher_->getStats()) {
+        stats->getFuseStatsForCurrentThread().invalidationsCoalesced.addValue(
+            coalesced);
+      }
+    }
+
     // Process all of the entries we found
     for (auto& entry : entries) {
       sendInvalidation(entry);
@@ -1039,16 +1591,31 @@ void FuseChannel::readInitPacket() {
   fuse_init_out connInfo = {};
   connInfo.major = init.init.major;
   connInfo.minor = init.init.minor;
-  connInfo.max_write = bufferSize_ - 4096;
+  connInfo.max_write = bufferSize_ - kRequestHeaderSpace;
 
+  // The kernel offers the largest readahead it is willing to use and will
+  // only ever lower it to what we reply with, so accept its value as is.
   connInfo.max_readahead = init.init.max_readahead;
 
   const auto capable = init.init.flags;
   auto& want = connInfo.flags;
 
-  // TODO: follow up and look at the new flags; particularly
-  // FUSE_DO_READDIRPLUS, FUSE_READDIRPLUS_AUTO. FUSE_SPLICE_XXX are interesting
-  // too, but may not directly benefit eden today.
+#ifdef __linux__
+  // Without FUSE_MAX_PAGES the kernel splits reads and writes into requests
+  // of at most 32 pages, however large max_write is.
+  if (capable & FUSE_MAX_PAGES) {
+    const size_t pageSize = getpagesize();
+    const size_t maxPages = std::min(
+        kFuseMaxMaxPages, (connInfo.max_write + pageSize - 1) / pageSize);
+    want |= FUSE_MAX_PAGES;
+    connInfo.max_pages = maxPages;
+    connInfo.max_write =
+        std::min<size_t>(connInfo.max_write, maxPages * pageSize);
+  }
+#endif
+
+  // The FUSE_SPLICE_XXX flags only describe libfuse behavior; spliced replies
+  // are controlled by spliceReplies_ instead.
   //
   // FUSE_ATOMIC_O_TRUNC is a nice optimization when the kernel supports it
   // and the FUSE daemon requires handling open/release for stateful file
@@ -1075,6 +1642,11 @@ void FuseChannel::readInitPacket() {
   // File handles are stateless so the kernel does not need to send
   // open() and release().
   want |= FUSE_NO_OPENDIR_SUPPORT;
+  if (readdirplus_) {
+    // Let the kernel decide between FUSE_READDIR and FUSE_READDIRPLUS based
+    // on whether the entries of a listing tend to be looked up afterwards.
+    want |= FUSE_DO_READDIRPLUS | FUSE_READDIRPLUS_AUTO;
+  }
 #endif
 
   // Only return the capabilities the kernel supports.
@@ -1084,6 +1656,9 @@ void FuseChannel::readInitPacket() {
              << init.init.minor << " local=" << FUSE_KERNEL_VERSION << "."
              << FUSE_KERNEL_MINOR_VERSION << " on mount \"" << mountPath_
              << "\", max_write=" << connInfo.max_write
+#ifdef __linux__
+             << ", max_pages=" << connInfo.max_pages
+#endif
              << ", max_readahead=" << connInfo.max_readahead
              << ", capable=" << flagsToLabel(capsLabels, capable)
              << ", want=" << flagsToLabel(capsLabels, want);
@@ -1135,252 +1710,532 @@ void FuseChannel::readInitPacket() {
   dispatcher_->initConnection(connInfo);
 }
 
-void FuseChannel::processSession() {
+bool FuseChannel::processSession(int deviceFd) {
+#ifdef EDEN_HAVE_LIBURING
+  if (useIoUring_ && processSessionUring(deviceFd)) {
+    return false;
+  }
+#endif
+
   std::vector<char> buf(bufferSize_);
-  // Save this for the sanity check later in the loop to avoid
-  // additional syscalls on each loop iteration.
-  auto myPid = getpid();
 
   while (!stop_.load(std::memory_order_relaxed)) {
+    if (liveWorkers_.load(std::memory_order_relaxed) > minThreads_ &&
+        retireIfIdle(deviceFd)) {
+      return true;
+    }
+
     // TODO: FUSE_SPLICE_READ allows using splice(2) here if we enable it.
     // We can look at turning this on once the main plumbing is complete.
-    auto res = read(fuseDevice_.fd(), buf.data(), buf.size());
+    auto res = read(deviceFd, buf.data(), buf.size());
     if (UNLIKELY(res < 0)) {
-      int error = errno;
-      if (stop_.load(std::memory_order_relaxed)) {
+      if (!handleReadError(errno)) {
         break;
       }
+      continue;
+    }
 
-      if (error == EINTR || error == EAGAIN) {
-        // If we got interrupted by a signal while reading the next
-        // fuse command, we will simply retry and read the next thing.
-        continue;
-      } else if (error == ENOENT) {
-        // According to comments in the libfuse code:
-        // ENOENT means the operation was interrupted; it's safe to restart
-        continue;
-      } else if (error == ENODEV) {
-        // ENODEV means the filesystem was unmounted
-        folly::call_once(unmountLogFlag_, [this] {
-          XLOG(DBG3) << "received unmount event ENODEV on mount " << mountPath_;
-        });
-        requestSessionExit(StopReason::UNMOUNTED);
-        break;
-      } else {
-        XLOG(WARNING) << "error reading from fuse channel: "
-                      << folly::errnoStr(error);
-        requestSessionExit(StopReason::FUSE_READ_ERROR);
-        break;
-      }
+    if (!processRequest(buf.data(), static_cast<size_t>(res), deviceFd)) {
+      return false;
     }
+  }
+  return false;
+}
+
+bool FuseChannel::shouldGrowWorkerPool(
+    const folly::Synchronized<State>::LockedPtr& state) {
+  if (maxThreads_ == minThreads_ || !state->workersStarted ||
+      state->stopReason != StopReason::RUNNING || state->growingWorkerPool) {
+    return false;
+  }
+  const auto live = state->liveWorkers();
+  if (live >= maxThreads_ || state->requests.size() <= live) {
+    return false;
+  }
+  state->growingWorkerPool = true;
+  return true;
+}
 
-    const auto arg_size = static_cast<size_t>(res);
-    if (arg_size < sizeof(struct fuse_in_header)) {
-      if (arg_size == 0) {
-        // This code path is hit when a fake FUSE channel is closed in our unit
-        // tests.  On real FUSE channels we should get ENODEV to indicate that
-        // the FUSE channel was shut down.  However, in our unit tests that use
-        // fake FUSE connections we cannot send an ENODEV error, and so we just
-        // close the channel instead.
-        requestSessionExit(StopReason::UNMOUNTED);
-      } else {
-        // We got a partial FUSE header.  This shouldn't ever happen unless
-        // there is a bug in the FUSE kernel code.
-        XLOG(ERR) << "read truncated message from kernel fuse device: len="
-                  << arg_size;
-        requestSessionExit(StopReason::FUSE_TRUNCATED_REQUEST);
+void FuseChannel::growWorkerPool() {
+  // Starting a thread is slow, so it is done without holding the state_
+  // lock.  The new thread waits until it has been added to workerThreads,
+  // and exits straight away if the channel started stopping in the
+  // meantime, since destroy() may already have taken the other threads.
+  std::promise<bool> added;
+  std::thread thread;
+  try {
+    thread = std::thread([this, added = added.get_future()]() mutable {
+      if (added.get()) {
+        fuseWorkerThread();
       }
-      return;
+    });
+  } catch (const std::exception& ex) {
+    state_.wlock()->growingWorkerPool = false;
+    XLOG_EVERY_MS(WARN, 60000)
+        << "unable to start another FUSE worker thread for " << mountPath_
+        << ": " << exceptionStr(ex);
+    return;
+  }
+
+  bool running;
+  {
+    auto state = state_.wlock();
+    state->growingWorkerPool = false;
+    running = state->stopReason == StopReason::RUNNING;
+    if (running) {
+      state->workerThreads.push_back(std::move(thread));
+      ++state->startedThreads;
+      liveWorkers_.store(state->liveWorkers(), std::memory_order_relaxed);
+      XLOG(DBG3) << "grew FUSE worker pool for " << mountPath_ << " to "
+                 << state->liveWorkers() << " threads with "
+                 << state->requests.size() << " outstanding requests";
     }
+  }
+  added.set_value(running);
+  if (!running) {
+    thread.join();
+  }
+}
 
-    const auto* header = reinterpret_cast<fuse_in_header*>(buf.data());
-    const uint8_t* arg = reinterpret_cast<const uint8_t*>(header + 1);
-
-    XLOG(DBG7) << "fuse request opcode=" << header->opcode << " "
-               << fuseOpcodeName(header->opcode) << " unique=" << header->unique
-               << " len=" << header->len << " nodeid=" << header->nodeid
-               << " uid=" << header->uid << " gid=" << header->gid
-               << " pid=" << header->pid;
-
-    // On Linux, if security caps are enabled and the FUSE filesystem implements
-    // xattr support, every FUSE_WRITE opcode is preceded by FUSE_GETXATTR for
-    // "security.capability". Until we discover a way to tell the kernel that
-    // they will always return nothing in an Eden mount, short-circuit that path
-    // as efficiently and as early as possible.
-    if (header->opcode == FUSE_GETXATTR) {
-      const auto getxattr = reinterpret_cast<const fuse_getxattr_in*>(arg);
-      const auto nameStr = reinterpret_cast<const char*>(getxattr + 1);
-      if (strcmp("security.capability", nameStr) == 0) {
-        replyError(*header, ENODATA);
-        continue;
-      }
+bool FuseChannel::retireIfIdle(int deviceFd) {
+  // Waiting with poll() costs an extra syscall per request, which is why only
+  // workers above the pool's floor do it.  Floor workers block in read().
+  //
+  // poll() wakes every waiting worker when a request arrives, and the ones
+  // that lose the race block in read() until a later request.  They get back
+  // here once they have handled one, so an idle pool still shrinks, just not
+  // all at once.
+  struct pollfd pfd = {};
+  pfd.fd = deviceFd;
+  pfd.events = POLLIN;
+  auto timeoutMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       workerIdleTimeout_)
+                       .count();
+  if (poll(&pfd, 1, timeoutMs) != 0) {
+    // A request is ready, poll() was interrupted, or the device failed.  In
+    // all cases let read() deal with it.
+    return false;
+  }
+
+  // Workers that retired earlier are joined once the lock is released, so
+  // that no thread waits on them while holding it.
+  std::vector<std::thread> previouslyRetired;
+  SCOPE_EXIT {
+    for (auto& thread : previouslyRetired) {
+      thread.join();
     }
+  };
 
-    // Sanity check to ensure that the request wasn't from ourself.
-    //
-    // We should never make requests to ourself via normal filesytem
-    // operations going through the kernel.  Otherwise we risk deadlocks if the
-    // kernel calls us while holding an inode lock, and we then end up making a
-    // filesystem call that need the same inode lock.  We will then not be able
-    // to resolve this deadlock on kernel inode locks without rebooting the
-    // system.
-    if (UNLIKELY(static_cast<pid_t>(header->pid) == myPid)) {
-      replyError(*header, EIO);
-      XLOG(CRITICAL) << "Received FUSE request from our own pid: opcode="
-                     << header->opcode << " nodeid=" << header->nodeid
-                     << " pid=" << header->pid;
-      continue;
+  auto state = state_.wlock();
+  if (state->stopReason != StopReason::RUNNING ||
+      state->liveWorkers() <= minThreads_) {
+    return false;
+  }
+  auto self = std::find_if(
+      state->workerThreads.begin(),
+      state->workerThreads.end(),
+      [](const std::thread& thread) {
+        return thread.get_id() == std::this_thread::get_id();
+      });
+  if (self == state->workerThreads.end()) {
+    return false;
+  }
+  previouslyRetired.swap(state->retiredThreads);
+  state->retiredThreads.push_back(std::move(*self));
+  state->workerThreads.erase(self);
+  --state->startedThreads;
+  if (deviceFd != fuseDevice_.fd()) {
+    state->spareWorkerDevices.push_back(deviceFd);
+  }
+  liveWorkers_.store(state->liveWorkers(), std::memory_order_relaxed);
+  XLOG(DBG3) << "shrank FUSE worker pool for " << mountPath_ << " to "
+             << state->liveWorkers() << " threads";
+  return true;
+}
+
+bool FuseChannel::handleReadError(int error) {
+  if (stop_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+
+  if (error == EINTR || error == EAGAIN) {
+    // If we got interrupted by a signal while reading the next
+    // fuse command, we will simply retry and read the next thing.
+    return true;
+  } else if (error == ENOENT) {
+    // According to comments in the libfuse code:
+    // ENOENT means the operation was interrupted; it's safe to restart
+    return true;
+  } else if (error == ENODEV) {
+    // ENODEV means the filesystem was unmounted
+    folly::call_once(unmountLogFlag_, [this] {
+      XLOG(DBG3) << "received unmount event ENODEV on mount " << mountPath_;
+    });
+    requestSessionExit(StopReason::UNMOUNTED);
+    return false;
+  } else {
+    XLOG(WARNING) << "error reading from fuse channel: "
+                  << folly::errnoStr(error);
+    requestSessionExit(StopReason::FUSE_READ_ERROR);
+    return false;
+  }
+}
+
+bool FuseChannel::processRequest(
+    const char* buf,
+    size_t arg_size,
+    int deviceFd) {
+  if (arg_size < sizeof(struct fuse_in_header)) {
+    if (arg_size == 0) {
+      // This code path is hit when a fake FUSE channel is closed in our unit
+      // tests.  On real FUSE channels we should get ENODEV to indicate that
+      // the FUSE channel was shut down.  However, in our unit tests that use
+      // fake FUSE connections we cannot send an ENODEV error, and so we just
+      // close the channel instead.
+      requestSessionExit(StopReason::UNMOUNTED);
+    } else {
+      // We got a partial FUSE header.  This shouldn't ever happen unless
+      // there is a bug in the FUSE kernel code.
+      XLOG(ERR) << "read truncated message from kernel fuse device: len="
+                << arg_size;
+      requestSessionExit(StopReason::FUSE_TRUNCATED_REQUEST);
     }
+    return false;
+  }
 
-    processAccessLog_.recordAccess(header->pid, getAccessType(header->opcode));
-
-    switch (header->opcode) {
-      case FUSE_INIT:
-        replyError(*header, EPROTO);
-        throw std::runtime_error(
-            "received FUSE_INIT after we have been initialized!?");
-
-      case FUSE_GETLK:
-      case FUSE_SETLK:
-      case FUSE_SETLKW:
-        // Deliberately not handling locking; this causes
-        // the kernel to do it for us
-        XLOG(DBG7) << fuseOpcodeName(header->opcode);
-        replyError(*header, ENOSYS);
-        break;
+  const auto* header = reinterpret_cast<const fuse_in_header*>(buf);
+  const uint8_t* arg = reinterpret_cast<const uint8_t*>(header + 1);
+
+  XLOG(DBG7) << "fuse request opcode=" << header->opcode << " "
+             << fuseOpcodeName(header->opcode) << " unique=" << header->unique
+             << " len=" << header->len << " nodeid=" << header->nodeid
+             << " uid=" << header->uid << " gid=" << header->gid
+             << " pid=" << header->pid;
+
+  if (requestTraceActive_.load(std::memory_order_relaxed)) {
+    traceRequest(
+        folly::ByteRange{reinterpret_cast<const uint8_t*>(buf), arg_size});
+  }
+
+  // On Linux, if security caps are enabled and the FUSE filesystem implements
+  // xattr support, every FUSE_WRITE opcode is preceded by FUSE_GETXATTR for
+  // "security.capability". Until we discover a way to tell the kernel that
+  // they will always return nothing in an Eden mount, short-circuit that path
+  // as efficiently and as early as possible.
+  if (header->opcode == FUSE_GETXATTR) {
+    const auto getxattr = reinterpret_cast<const fuse_getxattr_in*>(arg);
+    const auto nameStr = reinterpret_cast<const char*>(getxattr + 1);
+    if (strcmp("security.capability", nameStr) == 0) {
+      replyError(*header, ENODATA, deviceFd);
+      return true;
+    }
+  }
+
+  // Sanity check to ensure that the request wasn't from ourself.
+  //
+  // We should never make requests to ourself via normal filesytem
+  // operations going through the kernel.  Otherwise we risk deadlocks if the
+  // kernel calls us while holding an inode lock, and we then end up making a
+  // filesystem call that need the same inode lock.  We will then not be able
+  // to resolve this deadlock on kernel inode locks without rebooting the
+  // system.
+  if (UNLIKELY(static_cast<pid_t>(header->pid) == myPid_)) {
+    replyError(*header, EIO, deviceFd);
+    XLOG(CRITICAL) << "Received FUSE request from our own pid: opcode="
+                   << header->opcode << " nodeid=" << header->nodeid
+                   << " pid=" << header->pid;
+    return true;
+  }
+
+  processAccessLog_.recordAccess(header->pid, getAccessType(header->opcode));
+
+  switch (header->opcode) {
+    case FUSE_INIT:
+      replyError(*header, EPROTO, deviceFd);
+      throw std::runtime_error(
+          "received FUSE_INIT after we have been initialized!?");
+
+    case FUSE_GETLK:
+    case FUSE_SETLK:
+    case FUSE_SETLKW:
+      // Deliberately not handling locking; this causes
+      // the kernel to do it for us
+      XLOG(DBG7) << fuseOpcodeName(header->opcode);
+      replyError(*header, ENOSYS, deviceFd);
+      break;
 
 #ifdef __linux__
-      case FUSE_LSEEK:
-        // We only support stateless file handles, so lseek() is meaningless
-        // for us.  Returning ENOSYS causes the kernel to implement it for us,
-        // and will cause it to stop sending subsequent FUSE_LSEEK requests.
-        XLOG(DBG7) << "FUSE_LSEEK";
-        replyError(*header, ENOSYS);
-        break;
+    case FUSE_LSEEK:
+      // We only support stateless file handles, so lseek() is meaningless
+      // for us.  Returning ENOSYS causes the kernel to implement it for us,
+      // and will cause it to stop sending subsequent FUSE_LSEEK requests.
+      XLOG(DBG7) << "FUSE_LSEEK";
+      replyError(*header, ENOSYS, deviceFd);
+      break;
 #endif
 
-      case FUSE_POLL:
-        // We do not currently implement FUSE_POLL.
-        XLOG(DBG7) << "FUSE_POLL";
-        replyError(*header, ENOSYS);
-        break;
+    case FUSE_POLL:
+      // We do not currently implement FUSE_POLL.
+      XLOG(DBG7) << "FUSE_POLL";
+      replyError(*header, ENOSYS, deviceFd);
+      break;
+
+    case FUSE_INTERRUPT: {
+      // no reply is required
+      XLOG(DBG7) << "FUSE_INTERRUPT";
+      // Ignore it: we don't have a reliable way to guarantee
+      // that interrupting functions correctly.
+      // In addition, the kernel (certainly on macOS) may recycle
+      // ids too quickly for us to safely track by `unique` id.
+      break;
+    }
 
-      case FUSE_INTERRUPT: {
-        // no reply is required
-        XLOG(DBG7) << "FUSE_INTERRUPT";
-        // Ignore it: we don't have a reliable way to guarantee
-        // that interrupting functions correctly.
-        // In addition, the kernel (certainly on macOS) may recycle
-        // ids too quickly for us to safely track by `unique` id.
+    case FUSE_DESTROY:
+      XLOG(DBG7) << "FUSE_DESTROY";
+      dispatcher_->destroy();
+      // FUSE on linux doesn't care whether we reply to FUSE_DESTROY
+      // but the macOS implementation blocks the unmount syscall until
+      // we have responded, which in turn blocks our attempt to gracefully
+      // unmount, so we respond here.  It doesn't hurt Linux to respond
+      // so we do it for both platforms.
+      replyError(*header, 0, deviceFd);
+      break;
+
+    case FUSE_NOTIFY_REPLY:
+      XLOG(DBG7) << "FUSE_NOTIFY_REPLY";
+      // Don't strictly need to do anything here, but may want to
+      // turn the kernel notifications in Futures and use this as
+      // a way to fulfil the promise
+      break;
+
+    case FUSE_IOCTL:
+      // Rather than the default ENOSYS, we need to return ENOTTY
+      // to indicate that the requested ioctl is not supported
+      replyError(*header, ENOTTY, deviceFd);
+      break;
+
+    default: {
+      const auto handlerIter = handlerMap_.find(header->opcode);
+      if (handlerIter != handlerMap_.end()) {
+        // Start a new request and associate it with the current thread.
+        // It will be disassociated when we leave this scope, but will
+        // propagate across any futures that are spawned as part of this
+        // request.
+        RequestContextScopeGuard requestContextGuard;
+
+        auto& request =
+            RequestData::create(this, *header, dispatcher_, deviceFd);
+        uint64_t requestId;
+        bool grow;
+        {
+          // Save a weak reference to this new request context.
+          // We use this to enable getOutstandingRequests() for debugging
+          // purposes, as well as to determine when all requests are done.
+          // We allocate our own request Id for this purpose, as the
+          // kernel may recycle `unique` values more quickly than the
+          // lifecycle of our state here.
+          auto state = state_.wlock();
+          requestId = state->nextRequestId++;
+          state->requests.emplace(
+              requestId,
+              std::weak_ptr<folly::RequestContext>(
+                  RequestContext::saveContext()));
+          grow = shouldGrowWorkerPool(state);
+        }
+        if (grow) {
+          growWorkerPool();
+        }
+        const auto& entry = handlerIter->second;
+
+        request
+            .catchErrors(
+                folly::makeFutureWith([&] {
+                  request.startRequest(
+                      dispatcher_->getStats(),
+                      entry.histogram,
+                      *(liveRequestWatches_.get()));
+                  return (this->*entry.handler)(&request.getReq(), arg);
+                })
+                    .within(requestTimeout_),
+                notifications_)
+            .ensure([this, requestId] {
+              auto state = state_.wlock();
+
+              // Remove the request from the map
+              state->requests.erase(requestId);
+
+              // We may be complete; check to see if all requests are
+              // done and whether there are any threads remaining.
+              if (state->requests.empty() && state->allWorkersStopped()) {
+                sessionComplete(std::move(state));
+              }
+            });
         break;
       }
 
-      case FUSE_DESTROY:
-        XLOG(DBG7) << "FUSE_DESTROY";
-        dispatcher_->destroy();
-        // FUSE on linux doesn't care whether we reply to FUSE_DESTROY
-        // but the macOS implementation blocks the unmount syscall until
-        // we have responded, which in turn blocks our attempt to gracefully
-        // unmount, so we respond here.  It doesn't hurt Linux to respond
-        // so we do it for both platforms.
-        replyError(*header, 0);
-        break;
+      const auto opcode = header->opcode;
+      tryRlockCheckBeforeUpdate<folly::Unit>(
+          unhandledOpcodes_,
+          [&](const auto& unhandledOpcodes) -> std::optional<folly::Unit> {
+            if (unhandledOpcodes.find(opcode) != unhandledOpcodes.end()) {
+              return folly::unit;
+            }
+            return std::nullopt;
+          },
+          [&](auto& unhandledOpcodes) -> folly::Unit {
+            XLOG(WARN) << "unhandled fuse opcode " << opcode << "("
+                       << fuseOpcodeName(opcode) << ")";
+            unhandledOpcodes->insert(opcode);
+            return folly::unit;
+          });
+
+      try {
+        replyError(*header, ENOSYS, deviceFd);
+      } catch (const std::system_error& exc) {
+        XLOG(ERR) << "Failed to write error response to fuse: " << exc.what();
+        requestSessionExit(StopReason::FUSE_WRITE_ERROR);
+        return false;
+      }
+      break;
+    }
+  }
+  return true;
+}
 
-      case FUSE_NOTIFY_REPLY:
-        XLOG(DBG7) << "FUSE_NOTIFY_REPLY";
-        // Don't strictly need to do anything here, but may want to
-        // turn the kernel notifications in Futures and use this as
-        // a way to fulfil the promise
-        break;
+#ifdef EDEN_HAVE_LIBURING
+namespace {
+// The number of reads each worker keeps posted on the FUSE device.
+constexpr size_t kUringReadsPerWorker = 4;
+// Each read may need a cancellation request when shutting down.
+constexpr unsigned kUringQueueDepth = 2 * kUringReadsPerWorker;
+// user_data value used for cancellation requests.
+constexpr uintptr_t kUringCancelTag = ~uintptr_t{0};
+} // namespace
 
-      case FUSE_IOCTL:
-        // Rather than the default ENOSYS, we need to return ENOTTY
-        // to indicate that the requested ioctl is not supported
-        replyError(*header, ENOTTY);
-        break;
+bool FuseChannel::processSessionUring(int deviceFd) {
+  struct io_uring ring;
+  auto rc = io_uring_queue_init(kUringQueueDepth, &ring, 0);
+  if (rc < 0) {
+    // io_uring is unavailable on this kernel, or we hit a resource limit.
+    // Fall back to the read() loop.
+    XLOG_EVERY_MS(WARN, 60000) << "unable to set up io_uring for FUSE mount "
+                               << mountPath_ << ": " << folly::errnoStr(-rc)
+                               << "; falling back to blocking reads";
+    return false;
+  }
+  SCOPE_EXIT {
+    io_uring_queue_exit(&ring);
+  };
+
+  std::vector<std::vector<char>> bufs(
+      kUringReadsPerWorker, std::vector<char>(bufferSize_));
+  std::vector<bool> posted(kUringReadsPerWorker, false);
+  size_t outstanding = 0;
+
+  auto postRead = [&](size_t index) {
+    // The queue is sized to hold a read for every buffer, so this can only
+    // fail due to a bug.
+    auto* sqe = io_uring_get_sqe(&ring);
+    CHECK(sqe) << "io_uring submission queue unexpectedly full";
+    io_uring_prep_read(
+        sqe, deviceFd, bufs[index].data(), bufs[index].size(), 0);
+    io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(index));
+    posted[index] = true;
+    ++outstanding;
+  };
+
+  // Process one completion.  Returns false if the worker should stop.
+  auto processCompletion = [&](struct io_uring_cqe* cqe) {
+    const auto data = reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe));
+    const auto res = cqe->res;
+    io_uring_cqe_seen(&ring, cqe);
+    if (data == kUringCancelTag) {
+      return true;
+    }
 
-      default: {
-        const auto handlerIter = handlerMap_.find(header->opcode);
-        if (handlerIter != handlerMap_.end()) {
-          // Start a new request and associate it with the current thread.
-          // It will be disassociated when we leave this scope, but will
-          // propagate across any futures that are spawned as part of this
-          // request.
-          RequestContextScopeGuard requestContextGuard;
-
-          auto& request = RequestData::create(this, *header, dispatcher_);
-          uint64_t requestId;
-          {
-            // Save a weak reference to this new request context.
-            // We use this to enable getOutstandingRequests() for debugging
-            // purposes, as well as to determine when all requests are done.
-            // We allocate our own request Id for this purpose, as the
-            // kernel may recycle `unique` values more quickly than the
-            // lifecycle of our state here.
-            auto state = state_.wlock();
-            requestId = state->nextRequestId++;
-            state->requests.emplace(
-                requestId,
-                std::weak_ptr<folly::RequestContext>(
-                    RequestContext::saveContext()));
-          }
-          const auto& entry = handlerIter->second;
-
-          request
-              .catchErrors(
-                  folly::makeFutureWith([&] {
-                    request.startRequest(
-                        dispatcher_->getStats(),
-                        entry.histogram,
-                        *(liveRequestWatches_.get()));
-                    return (this->*entry.handler)(&request.getReq(), arg);
-                  })
-                      .within(requestTimeout_),
-                  notifications_)
-              .ensure([this, requestId] {
-                auto state = state_.wlock();
-
-                // Remove the request from the map
-                state->requests.erase(requestId);
-
-                // We may be complete; check to see if all requests are
-                // done and whether there are any threads remaining.
-                if (state->requests.empty() &&
-                    state->stoppedThreads == numThreads_) {
-                  sessionComplete(std::move(state));
-                }
-              });
-          break;
-        }
+    posted[data] = false;
+    --outstanding;
+    if (res < 0) {
+      if (res == -ECANCELED) {
+        return false;
+      }
+      if (!handleReadError(-res)) {
+        return false;
+      }
+    } else if (!processRequest(
+                   bufs[data].data(), static_cast<size_t>(res), deviceFd)) {
+      return false;
+    }
 
-        const auto opcode = header->opcode;
-        tryRlockCheckBeforeUpdate<folly::Unit>(
-            unhandledOpcodes_,
-            [&](const auto& unhandledOpcodes) -> std::optional<folly::Unit> {
-              if (unhandledOpcodes.find(opcode) != unhandledOpcodes.end()) {
-                return folly::unit;
-              }
-              return std::nullopt;
-            },
-            [&](auto& unhandledOpcodes) -> folly::Unit {
-              XLOG(WARN) << "unhandled fuse opcode " << opcode << "("
-                         << fuseOpcodeName(opcode) << ")";
-              unhandledOpcodes->insert(opcode);
-              return folly::unit;
-            });
+    if (!stop_.load(std::memory_order_relaxed)) {
+      postRead(data);
+    }
+    return true;
+  };
 
-        try {
-          replyError(*header, ENOSYS);
-        } catch (const std::system_error& exc) {
-          XLOG(ERR) << "Failed to write error response to fuse: " << exc.what();
-          requestSessionExit(StopReason::FUSE_WRITE_ERROR);
-          return;
-        }
-        break;
+  for (size_t index = 0; index < kUringReadsPerWorker; ++index) {
+    postRead(index);
+  }
+
+  bool running = true;
+  while (running && !stop_.load(std::memory_order_relaxed)) {
+    // Submit all re-posted reads and wait for the next request with a single
+    // syscall.
+    rc = io_uring_submit_and_wait(&ring, 1);
+    if (rc < 0 && rc != -EINTR && rc != -EAGAIN) {
+      XLOG(WARNING) << "error waiting on io_uring for fuse channel: "
+                    << folly::errnoStr(-rc);
+      requestSessionExit(StopReason::FUSE_READ_ERROR);
+      break;
+    }
+
+    // Handle every completion that is already available before submitting
+    // again, so that bursts of requests only cost one io_uring_enter().
+    struct io_uring_cqe* cqe;
+    while (running && io_uring_peek_cqe(&ring, &cqe) == 0) {
+      running = processCompletion(cqe);
+    }
+  }
+
+  // Cancel the reads that are still posted and wait for them to finish before
+  // their buffers are freed.  A read may complete with a request before it is
+  // cancelled, in which case it still has to be answered.
+  for (size_t index = 0; index < kUringReadsPerWorker; ++index) {
+    if (posted[index]) {
+      auto* sqe = io_uring_get_sqe(&ring);
+      if (!sqe) {
+        io_uring_submit(&ring);
+        sqe = io_uring_get_sqe(&ring);
       }
+      io_uring_prep_cancel(sqe, reinterpret_cast<void*>(index), 0);
+      io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(kUringCancelTag));
     }
   }
+  while (outstanding > 0) {
+    struct io_uring_cqe* cqe;
+    rc = io_uring_submit_and_wait(&ring, 1);
+    if (rc < 0 && rc != -EINTR && rc != -EAGAIN) {
+      XLOG(FATAL) << "error waiting for io_uring reads to be cancelled: "
+                  << folly::errnoStr(-rc);
+    }
+    while (io_uring_peek_cqe(&ring, &cqe) == 0) {
+      const auto data =
+          reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe));
+      const auto res = cqe->res;
+      io_uring_cqe_seen(&ring, cqe);
+      if (data == kUringCancelTag) {
+        continue;
+      }
+      posted[data] = false;
+      --outstanding;
+      if (res > 0) {
+        processRequest(bufs[data].data(), static_cast<size_t>(res), deviceFd);
+      }
+    }
+  }
+  return true;
 }
+#endif
 
 void FuseChannel::sessionComplete(folly::Synchronized<State>::LockedPtr state) {
   // Check to see if we should delete ourself after fulfilling
@@ -1415,6 +2270,7 @@ void FuseChannel::sessionComplete(folly::Synchronized<State>::LockedPtr state) {
 folly::Future<folly::Unit> FuseChannel::fuseRead(
     const fuse_in_header* header,
     const uint8_t* arg) {
+  TraceBlock block{"FuseChannel::fuseRead"};
   const auto read = reinterpret_cast<const fuse_read_in*>(arg);
 
   XLOG(DBG7) << "FUSE_READ";
@@ -1422,7 +2278,7 @@ folly::Future<folly::Unit> FuseChannel::fuseRead(
   auto ino = InodeNumber{header->nodeid};
   return dispatcher_->read(ino, read->size, read->offset)
       .thenValue(
-          [](BufVec&& buf) { RequestData::get().sendReply(buf.getIov()); });
+          [](BufVec&& buf) { RequestData::get().sendReply(std::move(buf)); });
 }
 
 folly::Future<folly::Unit> FuseChannel::fuseWrite(
@@ -1453,9 +2309,16 @@ folly::Future<folly::Unit> FuseChannel::fuseLookup(
 
   XLOG(DBG7) << "FUSE_LOOKUP parent=" << parent << " name=" << name;
 
-  return dispatcher_->lookup(parent, name).thenValue([](fuse_entry_out param) {
-    RequestData::get().sendReply(param);
-  });
+  if (auto param = dispatcher_->lookupIfReady(parent, name)) {
+    traceEntry(*param);
+    RequestData::get().sendReply(*param);
+    return folly::unit;
+  }
+  return dispatcher_->lookup(parent, name).thenValue(
+      [this](fuse_entry_out param) {
+        traceEntry(param);
+        RequestData::get().sendReply(param);
+      });
 }
 
 folly::Future<folly::Unit> FuseChannel::fuseForget(
@@ -1473,7 +2336,12 @@ folly::Future<folly::Unit> FuseChannel::fuseGetAttr(
     const fuse_in_header* header,
     const uint8_t* /*arg*/) {
   XLOG(DBG7) << "FUSE_GETATTR inode=" << header->nodeid;
-  return dispatcher_->getattr(InodeNumber{header->nodeid})
+  const auto ino = InodeNumber{header->nodeid};
+  if (auto attr = dispatcher_->getattrIfReady(ino)) {
+    RequestData::get().sendReply(attr->asFuseAttr());
+    return folly::unit;
+  }
+  return dispatcher_->getattr(ino)
       .thenValue([](Dispatcher::Attr attr) {
         RequestData::get().sendReply(attr.asFuseAttr());
       });
@@ -1494,16 +2362,18 @@ folly::Future<folly::Unit> FuseChannel::fuseReadLink(
     const fuse_in_header* header,
     const uint8_t* /*arg*/) {
   XLOG(DBG7) << "FUSE_READLINK inode=" << header->nodeid;
-  return dispatcher_
-      ->readlink(
-          InodeNumber{header->nodeid},
-  /*kernelCachesReadlink=*/
+  const auto ino = InodeNumber{header->nodeid};
+  const bool kernelCachesReadlink =
 #ifdef FUSE_CACHE_SYMLINKS
-          connInfo_->flags & FUSE_CACHE_SYMLINKS
+      connInfo_->flags & FUSE_CACHE_SYMLINKS;
 #else
-          false
+      false;
 #endif
-          )
+  if (auto target = dispatcher_->readlinkIfReady(ino, kernelCachesReadlink)) {
+    RequestData::get().sendReply(folly::StringPiece(*target));
+    return folly::unit;
+  }
+  return dispatcher_->readlink(ino, kernelCachesReadlink)
       .thenValue([](std::string&& str) {
         RequestData::get().sendReply(folly::StringPiece(str));
       });
@@ -1518,8 +2388,10 @@ folly::Future<folly::Unit> FuseChannel::fuseSymlink(
   const StringPiece link{nameStr + name.stringPiece().size() + 1};
 
   return dispatcher_->symlink(InodeNumber{header->nodeid}, name, link)
-      .thenValue(
-          [](fuse_entry_out param) { RequestData::get().sendReply(param); });
+      .thenValue([this](fuse_entry_out param) {
+        traceEntry(param);
+        RequestData::get().sendReply(param);
+      });
 }
 
 folly::Future<folly::Unit> FuseChannel::fuseMknod(
@@ -1542,8 +2414,10 @@ folly::Future<folly::Unit> FuseChannel::fuseMknod(
 
   return dispatcher_
       ->mknod(InodeNumber{header->nodeid}, name, nod->mode, nod->rdev)
-      .thenValue(
-          [](fuse_entry_out entry) { RequestData::get().sendReply(entry); });
+      .thenValue([this](fuse_entry_out entry) {
+        traceEntry(entry);
+        RequestData::get().sendReply(entry);
+      });
 }
 
 folly::Future<folly::Unit> FuseChannel::fuseMkdir(
@@ -1563,8 +2437,10 @@ folly::Future<folly::Unit> FuseChannel::fuseMkdir(
 
   return dispatcher_
       ->mkdir(InodeNumber{header->nodeid}, name, dir->mode & ~dir->umask)
-      .thenValue(
-          [](fuse_entry_out entry) { RequestData::get().sendReply(entry); });
+      .thenValue([this](fuse_entry_out entry) {
+        traceEntry(entry);
+        RequestData::get().sendReply(entry);
+      });
 }
 
 folly::Future<folly::Unit> FuseChannel::fuseUnlink(
@@ -1621,8 +2497,10 @@ folly::Future<folly::Unit> FuseChannel::fuseLink(
 
   return dispatcher_
       ->link(InodeNumber{link->oldnodeid}, InodeNumber{header->nodeid}, newName)
-      .thenValue(
-          [](fuse_entry_out param) { RequestData::get().sendReply(param); });
+      .thenValue([this](fuse_entry_out param) {
+        traceEntry(param);
+        RequestData::get().sendReply(param);
+      });
 }
 
 folly::Future<folly::Unit> FuseChannel::fuseOpen(
@@ -1811,6 +2689,22 @@ folly::Future<folly::Unit> FuseChannel::fuseReadDir(
       });
 }
 
+#ifdef __linux__
+folly::Future<folly::Unit> FuseChannel::fuseReadDirPlus(
+    const fuse_in_header* header,
+    const uint8_t* arg) {
+  auto read = reinterpret_cast<const fuse_read_in*>(arg);
+  XLOG(DBG7) << "FUSE_READDIRPLUS";
+  auto ino = InodeNumber{header->nodeid};
+  return dispatcher_
+      ->readdirplus(ino, DirListPlus{read->size}, read->offset, read->fh)
+      .thenValue([](DirListPlus&& list) {
+        const auto buf = list.getBuf();
+        RequestData::get().sendReply(StringPiece{buf});
+      });
+}
+#endif
+
 folly::Future<folly::Unit> FuseChannel::fuseReleaseDir(
     const fuse_in_header* header,
     const uint8_t* arg) {
@@ -1854,7 +2748,8 @@ folly::Future<folly::Unit> FuseChannel::fuseCreate(
   XLOG(DBG7) << "FUSE_CREATE " << name;
   auto ino = InodeNumber{header->nodeid};
   return dispatcher_->create(ino, name, create->mode, create->flags)
-      .thenValue([](fuse_entry_out entry) {
+      .thenValue([this](fuse_entry_out entry) {
+        traceEntry(entry);
         fuse_open_out out = {};
         out.open_flags |= FOPEN_KEEP_CACHE;
 
@@ -24,6 +24,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "eden/fs/fuse/BufVec.h"
 #include "eden/fs/fuse/FuseTypes.h"
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/telemetry/RequestMetricsScope.h"
@@ -39,8 +40,14 @@ namespace facebook {
 namespace eden {
 
 class Dispatcher;
+class FuseRequestTraceWriter;
 class Notifications;
 
+/**
+ * Returns the name of a FUSE opcode, such as "FUSE_LOOKUP".
+ */
+folly::StringPiece fuseOpcodeName(FuseOpcode opcode);
+
 class FuseChannel {
  public:
   enum class StopReason {
@@ -95,6 +102,33 @@ class FuseChannel {
    * The caller is expected to follow up with a call to the
    * initialize() method to perform the handshake with the
    * kernel and set up the thread pool.
+   *
+   * If spliceReplies is true, replies whose payload refers to a file
+   * descriptor (see BufVec::fromFd()) are spliced to the FUSE device instead
+   * of being copied through userspace.
+   *
+   * If useIoUring is true and Eden was built with liburing, worker threads
+   * keep several reads posted on the FUSE device through io_uring rather
+   * than issuing one blocking read() per request.  Workers fall back to
+   * read() if the kernel does not support io_uring.
+   *
+   * If cloneDevicePerWorker is true, each worker thread clones the FUSE
+   * device with FUSE_DEV_IOC_CLONE so that it has its own kernel processing
+   * queue instead of contending with every other worker on a single one.
+   *
+   * If readdirplus is true, the kernel is asked to send FUSE_READDIRPLUS so
+   * that directory listings can carry attributes for their entries.
+   *
+   * maxWrite is the largest FUSE_WRITE payload to negotiate with the kernel.
+   * Kernels that support FUSE_MAX_PAGES are also asked to allow reads and
+   * writes of that size; older kernels cap requests at 128KiB regardless.
+   * The per-worker request buffers are sized to match.
+   *
+   * numThreads worker threads are started initially.  If maxThreads is
+   * larger, another worker is started whenever the number of outstanding
+   * requests exceeds the number of workers, up to maxThreads.  Workers above
+   * minThreads exit after being idle for workerIdleTimeout.  A value of 0
+   * for either bound means numThreads.
    */
   FuseChannel(
       folly::File&& fuseDevice,
@@ -103,7 +137,21 @@ class FuseChannel {
       Dispatcher* const dispatcher,
       std::shared_ptr<ProcessNameCache> processNameCache,
       folly::Duration requestTimeout = std::chrono::seconds(60),
-      Notifications* FOLLY_NULLABLE notifications = nullptr);
+      Notifications* FOLLY_NULLABLE notifications = nullptr,
+      bool spliceReplies = false,
+      bool useIoUring = false,
+      bool cloneDevicePerWorker = false,
+      bool readdirplus = false,
+      size_t maxWrite = kDefaultMaxWrite,
+      size_t minThreads = 0,
+      size_t maxThreads = 0,
+      folly::Duration workerIdleTimeout = std::chrono::seconds(30));
+
+  /**
+   * The max_write value used when none is specified, which matches the
+   * kernel's default request size limit.
+   */
+  static constexpr size_t kDefaultMaxWrite = 128 * 1024;
 
   /**
    * Destroy the FuseChannel.
@@ -164,6 +212,21 @@ class FuseChannel {
    */
   StopFuture initializeFromTakeover(fuse_init_out connInfo);
 
+  /**
+   * Start recording every request this channel receives to a trace file at
+   * path, which can be replayed against a test mount later.  See
+   * FuseRequestTrace.h for the format.  Replaces any trace in progress.
+   *
+   * Throws if the trace file cannot be created.
+   */
+  void startRequestTrace(AbsolutePathPiece path);
+
+  /**
+   * Stop recording requests and flush the trace file, if a trace is in
+   * progress.
+   */
+  void stopRequestTrace();
+
   // Forbidden copy constructor and assignment operator
   FuseChannel(FuseChannel const&) = delete;
   FuseChannel& operator=(FuseChannel const&) = delete;
@@ -202,6 +265,14 @@ class FuseChannel {
    */
   void invalidateEntry(InodeNumber parent, PathComponentPiece name);
 
+  /**
+   * Like invalidateEntry(), but for many names in the same directory.  All of
+   * them are queued under a single acquisition of the queue's lock.
+   */
+  void invalidateEntries(
+      InodeNumber parent,
+      folly::Range<const PathComponentPiece*> names);
+
   /*
    * Request that the kernel invalidate its cached data for the specified
    * inodes.
@@ -213,6 +284,25 @@ class FuseChannel {
    */
   void invalidateInodes(folly::Range<InodeNumber*> range);
 
+  /**
+   * Push data for the specified inode into the kernel's page cache, so that
+   * later reads of that range do not need to be sent to us.
+   *
+   * This is sent from the invalidation thread in order with the invalidations
+   * queued around it, so an invalidation queued later discards the data.
+   * The kernel extends its idea of the file size to cover the data, so it
+   * must never extend past the end of the file.  Inodes the kernel does not
+   * know about are ignored.
+   *
+   * @param ino the inode number
+   * @param off the offset in the inode where the data starts
+   * @param data the data to store
+   */
+  void storeInodeData(
+      InodeNumber ino,
+      uint64_t off,
+      std::unique_ptr<folly::IOBuf> data);
+
   /**
    * Wait for all currently scheduled invalidateInode() and invalidateEntry()
    * operations to complete.
@@ -229,10 +319,14 @@ class FuseChannel {
    * status (no additional payload).
    * `err` may be 0 (indicating success) or a positive errno value.
    *
+   * The deviceFd parameter of this and the other reply methods is the FUSE
+   * device the request was read from.  Replies must be written to the same
+   * (possibly cloned) device; -1 means the main FUSE device.
+   *
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void replyError(const fuse_in_header& request, int err);
+  void replyError(const fuse_in_header& request, int err, int deviceFd = -1);
 
   /**
    * Sends a raw data packet to the kernel.
@@ -245,7 +339,7 @@ class FuseChannel {
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void sendRawReply(const iovec iov[], size_t count) const;
+  void sendRawReply(const iovec iov[], size_t count, int deviceFd = -1) const;
 
   /**
    * Sends a range of contiguous bytes as a reply to the kernel.
@@ -256,7 +350,10 @@ class FuseChannel {
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void sendReply(const fuse_in_header& request, folly::ByteRange bytes) const;
+  void sendReply(
+      const fuse_in_header& request,
+      folly::ByteRange bytes,
+      int deviceFd = -1) const;
 
   /**
    * Sends a reply to a kernel request, consisting of multiple parts.
@@ -267,8 +364,26 @@ class FuseChannel {
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void sendReply(const fuse_in_header& request, folly::fbvector<iovec>&& vec)
-      const;
+  void sendReply(
+      const fuse_in_header& request,
+      folly::fbvector<iovec>&& vec,
+      int deviceFd = -1) const;
+
+  /**
+   * Sends the contents of a BufVec as a reply to the kernel.
+   *
+   * If the BufVec refers to file descriptors and splicing is enabled, the
+   * header and data are staged in a per-thread pipe and spliced to the FUSE
+   * device.  Otherwise, or if splicing fails, the data is read into memory and
+   * sent with writev().
+   *
+   * throws system_error if the write fails.  Writes can fail if the
+   * data we send to the kernel is invalid.
+   */
+  void sendReply(
+      const fuse_in_header& request,
+      BufVec&& buf,
+      int deviceFd = -1) const;
 
   /**
    * Sends a reply to the kernel.
@@ -279,11 +394,15 @@ class FuseChannel {
    * data we send to the kernel is invalid.
    */
   template <typename T>
-  void sendReply(const fuse_in_header& request, const T& payload) const {
+  void sendReply(
+      const fuse_in_header& request,
+      const T& payload,
+      int deviceFd = -1) const {
     sendReply(
         request,
         folly::ByteRange{reinterpret_cast<const uint8_t*>(&payload),
-                         sizeof(T)});
+                         sizeof(T)},
+        deviceFd);
   }
 
   /**
@@ -301,6 +420,22 @@ class FuseChannel {
 
   size_t getRequestMetric(RequestMetricsScope::RequestMetric metric) const;
 
+  /**
+   * Returns the number of worker threads that are currently running.
+   */
+  size_t getWorkerThreadCount() const {
+    return liveWorkers_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns whether replies that refer to a file descriptor are spliced to
+   * the FUSE device.  When this is false they are read into memory first, so
+   * there is no point in building them.
+   */
+  bool isSplicingReplies() const {
+    return spliceReplies_.load(std::memory_order_relaxed);
+  }
+
  private:
   struct HandlerEntry;
   using HandlerMap = std::unordered_map<uint32_t, HandlerEntry>;
@@ -314,6 +449,46 @@ class FuseChannel {
     std::unordered_map<uint64_t, std::weak_ptr<folly::RequestContext>> requests;
     std::vector<std::thread> workerThreads;
 
+    /*
+     * FUSE devices cloned for individual worker threads.  These are kept
+     * open until the FuseChannel is destroyed, since requests read from a
+     * clone may still be replied to after its worker thread has exited.
+     */
+    std::vector<folly::File> workerDevices;
+
+    /*
+     * Cloned devices left behind by workers that retired because the pool
+     * shrank.  The next worker to start reuses one of these rather than
+     * cloning the device again.
+     */
+    std::vector<int> spareWorkerDevices;
+
+    /*
+     * Worker threads that retired because the pool shrank.  They have
+     * removed themselves from workerThreads and are joined by the next
+     * worker to retire, after it releases the state_ lock, or when the
+     * FuseChannel is destroyed.
+     */
+    std::vector<std::thread> retiredThreads;
+
+    /*
+     * Set while a worker is starting another one, so that the requests that
+     * arrive meanwhile do not start more.
+     */
+    bool growingWorkerPool{false};
+
+    /*
+     * Set once startWorkerThreads() has started the initial set of workers.
+     */
+    bool workersStarted{false};
+
+    /*
+     * The number of worker threads started and not retired.  This is tracked
+     * separately from workerThreads.size() because destroy() takes ownership
+     * of the threads while they are still stopping.
+     */
+    size_t startedThreads{0};
+
     /*
      * We track the number of stopped threads, to know when we are done and can
      * signal sessionCompletePromise_.  We only want to signal
@@ -339,6 +514,18 @@ class FuseChannel {
      * or running.
      */
     StopReason stopReason{StopReason::RUNNING};
+
+    size_t liveWorkers() const {
+      return startedThreads - stoppedThreads;
+    }
+
+    /*
+     * Returns true once every worker thread started after a successful
+     * initialization has stopped.
+     */
+    bool allWorkersStopped() const {
+      return workersStarted && stoppedThreads == startedThreads;
+    }
   };
 
   struct DataRange {
@@ -347,15 +534,26 @@ class FuseChannel {
     int64_t offset;
     int64_t length;
   };
+  struct DataStore {
+    DataStore(uint64_t offset, std::unique_ptr<folly::IOBuf> data);
+
+    uint64_t offset;
+    std::unique_ptr<folly::IOBuf> data;
+  };
   enum class InvalidationType : uint32_t {
     INODE,
     DIR_ENTRY,
     FLUSH,
+    STORE,
   };
   struct InvalidationEntry {
     InvalidationEntry(InodeNumber inode, int64_t offset, int64_t length);
     InvalidationEntry(InodeNumber inode, PathComponentPiece name);
     explicit InvalidationEntry(folly::Promise<folly::Unit> promise);
+    InvalidationEntry(
+        InodeNumber inode,
+        uint64_t offset,
+        std::unique_ptr<folly::IOBuf> data);
     InvalidationEntry(InvalidationEntry&& other) noexcept;
     ~InvalidationEntry();
 
@@ -365,6 +563,7 @@ class FuseChannel {
       PathComponent name;
       DataRange range;
       folly::Promise<folly::Unit> promise;
+      DataStore store;
     };
   };
   struct InvalidationQueue {
@@ -374,6 +573,8 @@ class FuseChannel {
   friend std::ostream& operator<<(
       std::ostream& os,
       const InvalidationEntry& entry);
+  friend class CoalesceInvalidationsTest;
+  friend class FuseChannelSpliceTest;
 
   /**
    * Private destructor.
@@ -462,6 +663,11 @@ class FuseChannel {
   folly::Future<folly::Unit> fuseReadDir(
       const fuse_in_header* header,
       const uint8_t* arg);
+#ifdef __linux__
+  folly::Future<folly::Unit> fuseReadDirPlus(
+      const fuse_in_header* header,
+      const uint8_t* arg);
+#endif
   folly::Future<folly::Unit> fuseReleaseDir(
       const fuse_in_header* header,
       const uint8_t* arg);
@@ -486,12 +692,46 @@ class FuseChannel {
   void fuseWorkerThread() noexcept;
   void invalidationThread() noexcept;
   void stopInvalidationThread();
+  static size_t coalesceInvalidations(std::vector<InvalidationEntry>& entries);
   void sendInvalidation(InvalidationEntry& entry);
   void sendInvalidateInode(InodeNumber ino, int64_t off, int64_t len);
   void sendInvalidateEntry(InodeNumber parent, PathComponentPiece name);
+  void sendStoreInode(InodeNumber ino, DataStore& store);
   void readInitPacket();
   void startWorkerThreads();
 
+#ifdef __linux__
+  struct SplicePipe {
+    folly::File readEnd;
+    folly::File writeEnd;
+    size_t capacity{0};
+  };
+
+  /**
+   * Attempt to send a reply by splicing it to the FUSE device.
+   *
+   * Returns false if the reply could not be spliced but nothing was sent to
+   * the kernel, in which case the caller should send it with writev().
+   */
+  bool trySpliceReply(
+      const fuse_in_header& request,
+      const BufVec& buf,
+      int deviceFd) const;
+  std::unique_ptr<SplicePipe> createSplicePipe() const;
+
+  /**
+   * The size of the largest FUSE_READ reply the kernel can ask for, which
+   * is bounded by the pages it allows per request rather than by max_write.
+   */
+  size_t getMaxReadReplySize() const;
+#endif
+
+  /**
+   * Count whether a reply could be built in the current thread's reusable
+   * buffers (a hit) or needed them to grow (a miss).
+   */
+  void recordReplyPoolUse(bool hit) const;
+
   /**
    * sessionComplete() will fulfill the sessionCompletePromise_.
    *
@@ -518,8 +758,81 @@ class FuseChannel {
    * This function blocks until the fuse session is stopped.
    * The intent is that this is called from each of the
    * fuse worker threads provided by the MountPoint.
+   *
+   * Returns true if the worker instead retired because the pool shrank, in
+   * which case it has already removed itself from State::workerThreads.
+   */
+  bool processSession(int deviceFd);
+
+  /**
+   * Returns true if requests are queueing up behind the current workers and
+   * the pool is below maxThreads_.  The caller must then release the lock
+   * and call growWorkerPool().
+   */
+  bool shouldGrowWorkerPool(const folly::Synchronized<State>::LockedPtr& state);
+
+  /**
+   * Start one more worker thread, after shouldGrowWorkerPool() returned true.
+   */
+  void growWorkerPool();
+
+  /**
+   * Called by a worker before reading its next request while the pool is
+   * above minThreads_.  Waits up to the idle timeout for a request, and
+   * returns true if none arrived and the worker has retired.
+   */
+  bool retireIfIdle(int deviceFd);
+
+  /**
+   * Returns the FUSE device that the calling worker thread should read
+   * requests from.  This is a per-worker clone of fuseDevice_ when
+   * cloneDevicePerWorker_ is set and cloning succeeds, and fuseDevice_
+   * otherwise.
+   */
+  int getWorkerDeviceFd();
+
+  /**
+   * Returns the device to write a reply to, given the device the request was
+   * read from.
+   */
+  int getReplyFd(int deviceFd) const {
+    return deviceFd >= 0 ? deviceFd : fuseDevice_.fd();
+  }
+
+  /**
+   * The io_uring flavor of processSession().
+   *
+   * Returns false without processing any requests if io_uring could not be
+   * set up, in which case the caller should use the read() loop instead.
+   */
+  bool processSessionUring(int deviceFd);
+
+  /**
+   * Handle an error from reading the FUSE device.
+   *
+   * Returns true if the worker should retry the read, or false if it should
+   * stop.
    */
-  void processSession();
+  bool handleReadError(int error);
+
+  /**
+   * Dispatch a single request read from the FUSE device.
+   *
+   * Returns false if the worker thread should stop processing requests.
+   */
+  bool processRequest(const char* buf, size_t size, int deviceFd);
+
+  /**
+   * Record a request to the request trace.  Callers check
+   * requestTraceActive_ first.
+   */
+  void traceRequest(folly::ByteRange request);
+
+  /**
+   * Record the inode number the current request is about to reply with to
+   * the request trace, if one is in progress.
+   */
+  void traceEntry(const fuse_entry_out& entry);
 
   /**
    * Requests that the worker threads terminate their processing loop.
@@ -532,13 +845,35 @@ class FuseChannel {
   /*
    * Constant state that does not change for the lifetime of the FuseChannel
    */
-  const size_t bufferSize_{0};
+  /*
+   * The size of each buffer used to read requests from the FUSE device.  This
+   * must be large enough for a FUSE_WRITE of connInfo_->max_write bytes.  It
+   * is only changed before the worker threads are started.
+   */
+  size_t bufferSize_{0};
   const size_t numThreads_;
+  const size_t minThreads_;
+  const size_t maxThreads_;
+  const folly::Duration workerIdleTimeout_;
+  // The number of live worker threads, kept for checks that should not take
+  // the state_ lock.  Only updated while holding it.
+  std::atomic<size_t> liveWorkers_{0};
   Dispatcher* const dispatcher_{nullptr};
   const AbsolutePath mountPath_;
   const folly::Duration requestTimeout_;
   Notifications* notifications_{nullptr};
 
+  /*
+   * Whether to splice file-backed replies.  This is cleared at runtime if the
+   * FUSE device turns out not to support splice().
+   */
+  mutable std::atomic<bool> spliceReplies_;
+  const bool useIoUring_;
+  const bool cloneDevicePerWorker_;
+  const bool readdirplus_;
+  // Saved to avoid a getpid() syscall for every request.
+  const pid_t myPid_;
+
   /*
    * connInfo_ is modified during the initialization process,
    * but constant once initialization is complete.
@@ -584,6 +919,11 @@ class FuseChannel {
 
   ProcessAccessLog processAccessLog_;
 
+  // The trace requests are recorded to, if any.  requestTraceActive_ lets
+  // processRequest() skip the lock while nothing is being traced.
+  std::atomic<bool> requestTraceActive_{false};
+  folly::Synchronized<std::shared_ptr<FuseRequestTraceWriter>> requestTrace_;
+
   // this tracks metrics for live FUSE requests, this is a thread local
   // to avoid contention between the FuseWorkerThreads as they kick off
   // requests.
@@ -592,10 +932,23 @@ class FuseChannel {
   // requests as these may outlive the spawning worker thread.
   class ThreadLocalTag {};
   folly::ThreadLocal<
-      std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>,
+      std::shared_ptr<RequestMetricsScope::RequestWatchList>,
       ThreadLocalTag>
       liveRequestWatches_;
 
+  // Scratch iovectors for sending BufVec replies.  Like splicePipe_ these are
+  // per-thread, and they keep their capacity so that steady-state replies do
+  // not allocate.
+  mutable folly::ThreadLocal<folly::fbvector<iovec>, ThreadLocalTag>
+      replyIovecs_;
+
+#ifdef __linux__
+  // Pipes used to stage spliced replies.  Replies can be sent from any thread
+  // that completes a request, so these are per-thread rather than per-worker.
+  mutable folly::ThreadLocal<std::unique_ptr<SplicePipe>, ThreadLocalTag>
+      splicePipe_;
+#endif
+
   static const HandlerMap handlerMap_;
 };
 
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/fuse/FuseRequestTrace.h"
+
+#include <fcntl.h>
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/logging/xlog.h>
+#include <cstring>
+
+namespace facebook {
+namespace eden {
+
+namespace {
+
+constexpr folly::StringPiece kTraceMagic{"EDENFTRC"};
+constexpr uint32_t kTraceVersion = 1;
+
+// Buffered records are written once they reach this size.
+constexpr size_t kFlushThreshold = 64 * 1024;
+
+} // namespace
+
+FuseRequestTraceWriter::FuseRequestTraceWriter(AbsolutePathPiece path)
+    : start_{std::chrono::steady_clock::now()},
+      file_{path.stringPiece().str().c_str(),
+            O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            0600} {
+  auto buffer = buffer_.lock();
+  buffer->append(kTraceMagic.data(), kTraceMagic.size());
+  buffer->append(
+      reinterpret_cast<const char*>(&kTraceVersion), sizeof(kTraceVersion));
+  writeBuffer(*buffer);
+}
+
+FuseRequestTraceWriter::~FuseRequestTraceWriter() {
+  try {
+    flush();
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "error flushing FUSE request trace: "
+              << folly::exceptionStr(ex);
+  }
+}
+
+void FuseRequestTraceWriter::recordRequest(folly::ByteRange request) {
+  if (request.size() >= sizeof(fuse_in_header)) {
+    const auto* header =
+        reinterpret_cast<const fuse_in_header*>(request.data());
+    if (header->opcode == FUSE_WRITE) {
+      request = request.subpiece(
+          0,
+          std::min(
+              request.size(), sizeof(fuse_in_header) + sizeof(fuse_write_in)));
+    }
+  }
+  append(FuseTraceRecordType::Request, request);
+}
+
+void FuseRequestTraceWriter::recordEntry(uint64_t unique, uint64_t nodeid) {
+  FuseTraceEntry entry{unique, nodeid};
+  append(
+      FuseTraceRecordType::Entry,
+      folly::ByteRange{
+          reinterpret_cast<const uint8_t*>(&entry), sizeof(entry)});
+}
+
+void FuseRequestTraceWriter::flush() {
+  writeBuffer(*buffer_.lock());
+}
+
+void FuseRequestTraceWriter::append(
+    FuseTraceRecordType type,
+    folly::ByteRange data) {
+  FuseTraceRecordHeader header{};
+  header.type = type;
+  header.length = data.size();
+  header.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start_)
+                           .count();
+
+  auto buffer = buffer_.lock();
+  buffer->append(reinterpret_cast<const char*>(&header), sizeof(header));
+  buffer->append(reinterpret_cast<const char*>(data.data()), data.size());
+  if (buffer->size() >= kFlushThreshold) {
+    writeBuffer(*buffer);
+  }
+}
+
+void FuseRequestTraceWriter::writeBuffer(std::string& buffer) {
+  if (buffer.empty()) {
+    return;
+  }
+  auto result = folly::writeFull(file_.fd(), buffer.data(), buffer.size());
+  buffer.clear();
+  folly::checkUnixError(result, "error writing FUSE request trace");
+}
+
+std::vector<FuseTraceRecord> readFuseRequestTrace(AbsolutePathPiece path) {
+  std::string contents;
+  if (!folly::readFile(path.stringPiece().str().c_str(), contents)) {
+    folly::throwSystemError("unable to read FUSE request trace ", path);
+  }
+  folly::StringPiece remaining{contents};
+  if (!remaining.startsWith(kTraceMagic) ||
+      remaining.size() < kTraceMagic.size() + sizeof(kTraceVersion)) {
+    throw std::runtime_error(
+        folly::to<std::string>(path, " is not a FUSE request trace"));
+  }
+  remaining.advance(kTraceMagic.size());
+  uint32_t version;
+  memcpy(&version, remaining.data(), sizeof(version));
+  remaining.advance(sizeof(version));
+  if (version != kTraceVersion) {
+    throw std::runtime_error(folly::to<std::string>(
+        "unsupported FUSE request trace version ", version, " in ", path));
+  }
+
+  std::vector<FuseTraceRecord> records;
+  while (remaining.size() >= sizeof(FuseTraceRecordHeader)) {
+    FuseTraceRecordHeader header;
+    memcpy(&header, remaining.data(), sizeof(header));
+    if (remaining.size() - sizeof(header) < header.length) {
+      break;
+    }
+    remaining.advance(sizeof(header));
+
+    FuseTraceRecord record;
+    record.type = header.type;
+    record.timestamp = std::chrono::nanoseconds{header.timestampNs};
+    record.data.assign(
+        reinterpret_cast<const uint8_t*>(remaining.data()),
+        reinterpret_cast<const uint8_t*>(remaining.data()) + header.length);
+    remaining.advance(header.length);
+
+    size_t minimumLength;
+    switch (header.type) {
+      case FuseTraceRecordType::Request:
+        minimumLength = sizeof(fuse_in_header);
+        break;
+      case FuseTraceRecordType::Entry:
+        minimumLength = sizeof(FuseTraceEntry);
+        break;
+      default:
+        // Skip record types added by later versions of the writer.
+        continue;
+    }
+    if (record.data.size() < minimumLength) {
+      XLOG(WARN) << "skipping truncated FUSE trace record";
+      continue;
+    }
+    records.push_back(std::move(record));
+  }
+  return records;
+}
+
+} // namespace eden
+} // namespace facebook
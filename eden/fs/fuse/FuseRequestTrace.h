@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "eden/fs/fuse/FuseTypes.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * A FUSE request trace records the requests a FuseChannel receives, so that
+ * they can be replayed later against a test mount.
+ *
+ * The file starts with an 8 byte magic number and a 4 byte version, and is
+ * followed by records that each start with a FuseTraceRecordHeader:
+ *
+ * - Request records hold the fuse_in_header and its arguments.  The data of
+ *   FUSE_WRITE requests is dropped to keep traces small; the header's len
+ *   still gives its size.
+ * - Entry records hold a FuseTraceEntry with the inode number a request that
+ *   creates a directory entry (lookup, mkdir and so on) replied with, so that
+ *   a replay can map the traced inode numbers onto its own.
+ *
+ * Fields are in host byte order: traces are meant to be replayed on the same
+ * kind of machine.
+ */
+enum class FuseTraceRecordType : uint8_t {
+  Request = 1,
+  Entry = 2,
+};
+
+struct FuseTraceRecordHeader {
+  FuseTraceRecordType type;
+  uint8_t reserved[3];
+  // The number of bytes in the record after this header.
+  uint32_t length;
+  // When the record was written, relative to the start of the trace.
+  uint64_t timestampNs;
+};
+
+struct FuseTraceEntry {
+  uint64_t unique;
+  uint64_t nodeid;
+};
+
+/**
+ * Appends records to a trace file.  Records are buffered and written in
+ * batches; it is safe to record from many threads.
+ */
+class FuseRequestTraceWriter {
+ public:
+  /**
+   * Creates or truncates the trace file at path.  Throws on error.
+   */
+  explicit FuseRequestTraceWriter(AbsolutePathPiece path);
+  ~FuseRequestTraceWriter();
+
+  FuseRequestTraceWriter(const FuseRequestTraceWriter&) = delete;
+  FuseRequestTraceWriter& operator=(const FuseRequestTraceWriter&) = delete;
+
+  /**
+   * Records a request as read from the FUSE device, starting with its
+   * fuse_in_header.
+   */
+  void recordRequest(folly::ByteRange request);
+
+  /**
+   * Records the inode number sent in reply to the request with the given
+   * unique ID.
+   */
+  void recordEntry(uint64_t unique, uint64_t nodeid);
+
+  /**
+   * Writes any buffered records to the file.
+   */
+  void flush();
+
+ private:
+  void append(FuseTraceRecordType type, folly::ByteRange data);
+  void writeBuffer(std::string& buffer);
+
+  const std::chrono::steady_clock::time_point start_;
+  folly::File file_;
+  folly::Synchronized<std::string, std::mutex> buffer_;
+};
+
+struct FuseTraceRecord {
+  FuseTraceRecordType type;
+  std::chrono::nanoseconds timestamp;
+  std::vector<uint8_t> data;
+
+  const fuse_in_header& getRequestHeader() const {
+    return *reinterpret_cast<const fuse_in_header*>(data.data());
+  }
+  const FuseTraceEntry& getEntry() const {
+    return *reinterpret_cast<const FuseTraceEntry*>(data.data());
+  }
+};
+
+/**
+ * Reads every record from a trace file.  Throws if the file cannot be read
+ * or is not a trace; a truncated final record, as left by a crash, is
+ * ignored.
+ */
+std::vector<FuseTraceRecord> readFuseRequestTrace(AbsolutePathPiece path);
+
+} // namespace eden
+} // namespace facebook
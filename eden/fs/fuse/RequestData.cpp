@@ -26,8 +26,12 @@ const std::string RequestData::kKey("fuse");
 RequestData::RequestData(
     FuseChannel* channel,
     const fuse_in_header& fuseHeader,
-    Dispatcher* dispatcher)
-    : channel_(channel), fuseHeader_(fuseHeader), dispatcher_(dispatcher) {}
+    Dispatcher* dispatcher,
+    int deviceFd)
+    : channel_(channel),
+      fuseHeader_(fuseHeader),
+      deviceFd_(deviceFd),
+      dispatcher_(dispatcher) {}
 
 bool RequestData::isFuseRequest() {
   return folly::RequestContext::get()->getContextData(kKey) != nullptr;
@@ -45,18 +49,19 @@ RequestData& RequestData::get() {
 RequestData& RequestData::create(
     FuseChannel* channel,
     const fuse_in_header& fuseHeader,
-    Dispatcher* dispatcher) {
+    Dispatcher* dispatcher,
+    int deviceFd) {
   folly::RequestContext::get()->setContextData(
       RequestData::kKey,
-      std::make_unique<RequestData>(channel, fuseHeader, dispatcher));
+      std::make_unique<RequestData>(
+          channel, fuseHeader, dispatcher, deviceFd));
   return get();
 }
 
 void RequestData::startRequest(
     EdenStats* stats,
     FuseThreadStats::HistogramPtr histogram,
-    std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>&
-        requestWatches) {
+    std::shared_ptr<RequestMetricsScope::RequestWatchList>& requestWatches) {
   startTime_ = steady_clock::now();
   DCHECK(latencyHistogram_ == nullptr);
   latencyHistogram_ = histogram;
@@ -74,7 +79,10 @@ void RequestData::finishRequest() {
   const auto diff_ns = duration_cast<nanoseconds>(diff);
 
   stats_->getFuseStatsForCurrentThread().recordLatency(
-      latencyHistogram_, diff_us, now_since_epoch);
+      latencyHistogram_,
+      getEdenTopStats().getOutcome(),
+      diff_us,
+      now_since_epoch);
   latencyHistogram_ = nullptr;
   stats_ = nullptr;
   { auto temp = std::move(requestMetricsScope_); }
@@ -86,6 +94,13 @@ void RequestData::finishRequest() {
     pal.recordAccess(examineReq().pid, type);
   }
   pal.recordDuration(examineReq().pid, diff_ns);
+  if (auto fetches = getEdenTopStats().getBackingStoreFetches()) {
+    pal.recordFetches(
+        examineReq().pid,
+        fetches,
+        getEdenTopStats().getBackingStoreFetchBytes(),
+        getEdenTopStats().getBackingStoreFetchWait());
+  }
 }
 
 fuse_in_header RequestData::stealReq() {
@@ -118,8 +133,18 @@ RequestData::EdenTopStats& RequestData::getEdenTopStats() {
   return edenTopStats_;
 }
 
+FuseThreadStats::RequestOutcome RequestData::EdenTopStats::getOutcome() const {
+  if (didImportFromBackingStore()) {
+    return FuseThreadStats::RequestOutcome::BackingStoreFetch;
+  }
+  if (didLoadInode()) {
+    return FuseThreadStats::RequestOutcome::InodeLoad;
+  }
+  return FuseThreadStats::RequestOutcome::LoadedInode;
+}
+
 void RequestData::replyError(int err) {
-  channel_->replyError(stealReq(), err);
+  channel_->replyError(stealReq(), err, deviceFd_);
 }
 
 void RequestData::replyNone() {
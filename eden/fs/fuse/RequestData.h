@@ -38,13 +38,15 @@ class Dispatcher;
 class RequestData : public folly::RequestData {
   FuseChannel* channel_;
   fuse_in_header fuseHeader_;
+  // The FUSE device the request was read from, or -1 for the main device.
+  int deviceFd_;
   // Needed to track stats
   std::chrono::time_point<std::chrono::steady_clock> startTime_;
   FuseThreadStats::HistogramPtr latencyHistogram_{nullptr};
   EdenStats* stats_{nullptr};
   Dispatcher* dispatcher_{nullptr};
   RequestMetricsScope requestMetricsScope_;
-  std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>
+  std::shared_ptr<RequestMetricsScope::RequestWatchList>
       channelThreadLocalStats_;
 
   struct EdenTopStats {
@@ -55,10 +57,42 @@ class RequestData : public folly::RequestData {
     void setDidImportFromBackingStore() {
       didImportFromBackingStore_.store(true, std::memory_order_relaxed);
     }
+    bool didLoadInode() const {
+      return didLoadInode_.load(std::memory_order_relaxed);
+    }
+    void setDidLoadInode() {
+      didLoadInode_.store(true, std::memory_order_relaxed);
+    }
+    /**
+     * Records an object this request imported from the backing store, its
+     * size, and how long the request waited for it.  Imports may complete
+     * on several threads at once.
+     */
+    void addBackingStoreFetch(uint64_t bytes, std::chrono::nanoseconds wait) {
+      backingStoreFetches_.fetch_add(1, std::memory_order_relaxed);
+      backingStoreFetchBytes_.fetch_add(bytes, std::memory_order_relaxed);
+      backingStoreFetchWaitNs_.fetch_add(
+          wait.count(), std::memory_order_relaxed);
+    }
+    uint64_t getBackingStoreFetches() const {
+      return backingStoreFetches_.load(std::memory_order_relaxed);
+    }
+    uint64_t getBackingStoreFetchBytes() const {
+      return backingStoreFetchBytes_.load(std::memory_order_relaxed);
+    }
+    std::chrono::nanoseconds getBackingStoreFetchWait() const {
+      return std::chrono::nanoseconds{
+          backingStoreFetchWaitNs_.load(std::memory_order_relaxed)};
+    }
+    FuseThreadStats::RequestOutcome getOutcome() const;
     std::chrono::nanoseconds fuseDuration{0};
 
    private:
     std::atomic<bool> didImportFromBackingStore_{false};
+    std::atomic<bool> didLoadInode_{false};
+    std::atomic<uint64_t> backingStoreFetches_{0};
+    std::atomic<uint64_t> backingStoreFetchBytes_{0};
+    std::atomic<int64_t> backingStoreFetchWaitNs_{0};
   } edenTopStats_;
 
   fuse_in_header stealReq();
@@ -72,12 +106,14 @@ class RequestData : public folly::RequestData {
   explicit RequestData(
       FuseChannel* channel,
       const fuse_in_header& fuseHeader,
-      Dispatcher* dispatcher);
+      Dispatcher* dispatcher,
+      int deviceFd = -1);
   static RequestData& get();
   static RequestData& create(
       FuseChannel* channel,
       const fuse_in_header& fuseHeader,
-      Dispatcher* dispatcher);
+      Dispatcher* dispatcher,
+      int deviceFd = -1);
 
   bool hasCallback() override {
     return false;
@@ -90,8 +126,7 @@ class RequestData : public folly::RequestData {
   void startRequest(
       EdenStats* stats,
       FuseThreadStats::HistogramPtr histogram,
-      std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>&
-          requestWatches);
+      std::shared_ptr<RequestMetricsScope::RequestWatchList>& requestWatches);
   void finishRequest();
 
   // Returns the associated dispatcher instance
@@ -146,19 +181,23 @@ class RequestData : public folly::RequestData {
 
   template <typename T>
   void sendReply(const T& payload) {
-    channel_->sendReply(stealReq(), payload);
+    channel_->sendReply(stealReq(), payload, deviceFd_);
   }
 
   void sendReply(folly::ByteRange bytes) {
-    channel_->sendReply(stealReq(), bytes);
+    channel_->sendReply(stealReq(), bytes, deviceFd_);
   }
 
   void sendReply(folly::fbvector<iovec>&& vec) {
-    channel_->sendReply(stealReq(), std::move(vec));
+    channel_->sendReply(stealReq(), std::move(vec), deviceFd_);
+  }
+
+  void sendReply(BufVec&& buf) {
+    channel_->sendReply(stealReq(), std::move(buf), deviceFd_);
   }
 
   void sendReply(folly::StringPiece piece) {
-    channel_->sendReply(stealReq(), folly::ByteRange(piece));
+    channel_->sendReply(stealReq(), folly::ByteRange(piece), deviceFd_);
   }
 
   // Reply with a negative errno value or 0 for success
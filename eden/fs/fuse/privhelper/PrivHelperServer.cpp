@@ -16,6 +16,8 @@
 #include <folly/FileUtil.h>
 #include <folly/Format.h>
 #include <folly/String.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/init/Init.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
@@ -54,6 +56,11 @@ using std::string;
 namespace facebook {
 namespace eden {
 
+namespace {
+// Number of mount operations for different mount points that may run at once.
+constexpr size_t kMountThreads = 8;
+} // namespace
+
 PrivHelperServer::PrivHelperServer() {}
 
 PrivHelperServer::~PrivHelperServer() {}
@@ -96,6 +103,10 @@ void PrivHelperServer::initPartial(folly::File&& socket, uid_t uid, gid_t gid) {
   // NotificationQueue code checks to ensure that it isn't used across a fork.
   eventBase_ = std::make_unique<folly::EventBase>();
   conn_ = UnixSocket::makeUnique(eventBase_.get(), std::move(socket));
+  // Like eventBase_, the thread pool must only be started after we fork.
+  mountThreadPool_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+      kMountThreads,
+      std::make_shared<folly::NamedThreadFactory>("PrivHelperMount"));
   uid_ = uid;
   gid_ = gid;
 
@@ -300,7 +311,8 @@ folly::File PrivHelperServer::fuseMount(const char* mountPath, bool readOnly) {
   // If the timeout is reached, the kernel will shut down the fuse
   // connection.
   auto daemon_timeout_seconds =
-      std::chrono::duration_cast<std::chrono::seconds>(fuseTimeout_).count();
+      std::chrono::duration_cast<std::chrono::seconds>(fuseTimeout_.load())
+          .count();
   if (daemon_timeout_seconds > FUSE_MAX_DAEMON_TIMEOUT) {
     args.daemon_timeout = FUSE_MAX_DAEMON_TIMEOUT;
   } else {
@@ -443,7 +455,7 @@ UnixSocket::Message PrivHelperServer::processTakeoverStartupMsg(
   XLOG(DBG3) << "takeover startup for \"" << mountPath << "\"; "
              << bindMounts.size() << " bind mounts";
 
-  mountPoints_.insert(mountPath);
+  mountPoints_.wlock()->insert(mountPath);
   return makeResponse();
 }
 
@@ -454,7 +466,7 @@ UnixSocket::Message PrivHelperServer::processMountMsg(Cursor& cursor) {
   XLOG(DBG3) << "mount \"" << mountPath << "\"";
 
   auto fuseDev = fuseMount(mountPath.c_str(), readOnly);
-  mountPoints_.insert(mountPath);
+  mountPoints_.wlock()->insert(mountPath);
 
   return makeResponse(std::move(fuseDev));
 }
@@ -464,14 +476,13 @@ UnixSocket::Message PrivHelperServer::processUnmountMsg(Cursor& cursor) {
   PrivHelperConn::parseUnmountRequest(cursor, mountPath);
   XLOG(DBG3) << "unmount \"" << mountPath << "\"";
 
-  const auto it = mountPoints_.find(mountPath);
-  if (it == mountPoints_.end()) {
+  if (mountPoints_.rlock()->count(mountPath) == 0) {
     throw std::domain_error(
         folly::to<string>("No FUSE mount found for ", mountPath));
   }
 
   fuseUnmount(mountPath.c_str());
-  mountPoints_.erase(mountPath);
+  mountPoints_.wlock()->erase(mountPath);
   return makeResponse();
 }
 
@@ -481,18 +492,16 @@ UnixSocket::Message PrivHelperServer::processTakeoverShutdownMsg(
   PrivHelperConn::parseTakeoverShutdownRequest(cursor, mountPath);
   XLOG(DBG3) << "takeover shutdown \"" << mountPath << "\"";
 
-  const auto it = mountPoints_.find(mountPath);
-  if (it == mountPoints_.end()) {
+  if (mountPoints_.wlock()->erase(mountPath) == 0) {
     throw std::domain_error(
         folly::to<string>("No FUSE mount found for ", mountPath));
   }
 
-  mountPoints_.erase(mountPath);
   return makeResponse();
 }
 
 std::string PrivHelperServer::findMatchingMountPrefix(folly::StringPiece path) {
-  for (const auto& mountPoint : mountPoints_) {
+  for (const auto& mountPoint : *mountPoints_.rlock()) {
     if (boost::starts_with(path, mountPoint + "/")) {
       return mountPoint;
     }
@@ -639,6 +648,10 @@ void PrivHelperServer::run() {
   // too.
   XLOG(DBG5) << "privhelper process exiting";
 
+  // Let any mount operations still running finish so that their mount points
+  // are recorded before we clean them up.
+  mountThreadPool_->join();
+
   // Unmount all active mount points
   cleanupMountPoints();
 }
@@ -657,6 +670,100 @@ void PrivHelperServer::processAndSendResponse(UnixSocket::Message&& message) {
   const auto xid = cursor.readBE<uint32_t>();
   const auto msgType =
       static_cast<PrivHelperConn::MsgType>(cursor.readBE<uint32_t>());
+
+  auto mountPoint = getMountOperationKey(msgType, cursor);
+  if (!mountPoint.has_value()) {
+    conn_->send(processRequest(xid, msgType, cursor, message));
+    return;
+  }
+
+  queueMountOperation(
+      mountPoint.value(),
+      [this, xid, msgType, message = std::move(message)]() mutable {
+        Cursor requestCursor{&message.data};
+        requestCursor.skip(PrivHelperConn::kHeaderSize);
+        auto response = processRequest(xid, msgType, requestCursor, message);
+        eventBase_->runInEventBaseThread(
+            [this, response = std::move(response)]() mutable {
+              // The connection is gone if the loop exited in the meantime.
+              if (conn_) {
+                conn_->send(std::move(response));
+              }
+            });
+      });
+}
+
+std::optional<std::string> PrivHelperServer::getMountOperationKey(
+    PrivHelperConn::MsgType msgType,
+    Cursor cursor) {
+  // Requests that fail to parse, or name a path outside any known mount, are
+  // processed on the main thread, which reports the error.
+  try {
+    string mountPath;
+    switch (msgType) {
+      case PrivHelperConn::REQ_MOUNT_FUSE: {
+        bool readOnly;
+        PrivHelperConn::parseMountRequest(cursor, mountPath, readOnly);
+        return mountPath;
+      }
+      case PrivHelperConn::REQ_UNMOUNT_FUSE:
+        PrivHelperConn::parseUnmountRequest(cursor, mountPath);
+        return mountPath;
+      case PrivHelperConn::REQ_MOUNT_BIND: {
+        string clientPath;
+        PrivHelperConn::parseBindMountRequest(cursor, clientPath, mountPath);
+        return findMatchingMountPrefix(mountPath);
+      }
+      case PrivHelperConn::REQ_UNMOUNT_BIND:
+        PrivHelperConn::parseBindUnMountRequest(cursor, mountPath);
+        return findMatchingMountPrefix(mountPath);
+      default:
+        return std::nullopt;
+    }
+  } catch (const std::exception&) {
+    return std::nullopt;
+  }
+}
+
+void PrivHelperServer::queueMountOperation(
+    const std::string& mountPoint,
+    folly::Function<void()> operation) {
+  {
+    auto operations = mountOperations_.wlock();
+    auto& queue = (*operations)[mountPoint];
+    queue.operations.push_back(std::move(operation));
+    if (queue.running) {
+      return;
+    }
+    queue.running = true;
+  }
+  mountThreadPool_->add(
+      [this, mountPoint] { runMountOperations(mountPoint); });
+}
+
+void PrivHelperServer::runMountOperations(const std::string& mountPoint) {
+  while (true) {
+    folly::Function<void()> operation;
+    {
+      auto operations = mountOperations_.wlock();
+      auto it = operations->find(mountPoint);
+      DCHECK(it != operations->end());
+      if (it->second.operations.empty()) {
+        operations->erase(it);
+        return;
+      }
+      operation = std::move(it->second.operations.front());
+      it->second.operations.pop_front();
+    }
+    operation();
+  }
+}
+
+UnixSocket::Message PrivHelperServer::processRequest(
+    uint32_t xid,
+    PrivHelperConn::MsgType msgType,
+    Cursor& cursor,
+    UnixSocket::Message& message) {
   auto responseType = msgType;
 
   UnixSocket::Message response;
@@ -692,8 +799,7 @@ void PrivHelperServer::processAndSendResponse(UnixSocket::Message&& message) {
   RWPrivateCursor respCursor(&response.data);
   respCursor.writeBE<uint32_t>(xid);
   respCursor.writeBE<uint32_t>(responseType);
-
-  conn_->send(std::move(response));
+  return response;
 }
 
 UnixSocket::Message PrivHelperServer::makeResponse() {
@@ -761,7 +867,9 @@ void PrivHelperServer::receiveError(
 }
 
 void PrivHelperServer::cleanupMountPoints() {
-  for (const auto& mountPoint : mountPoints_) {
+  std::set<std::string> mountPoints;
+  mountPoints_.wlock()->swap(mountPoints);
+  for (const auto& mountPoint : mountPoints) {
     try {
       fuseUnmount(mountPoint.c_str());
     } catch (const std::exception& ex) {
@@ -769,8 +877,6 @@ void PrivHelperServer::cleanupMountPoints() {
                 << "\": " << folly::exceptionStr(ex);
     }
   }
-
-  mountPoints_.clear();
 }
 
 } // namespace eden
@@ -7,8 +7,13 @@
 
 #pragma once
 
+#include <folly/Function.h>
+#include <folly/Synchronized.h>
 #include <sys/types.h>
+#include <atomic>
+#include <deque>
 #include <limits>
+#include <optional>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -16,6 +21,7 @@
 #include "eden/fs/utils/UnixSocket.h"
 
 namespace folly {
+class CPUThreadPoolExecutor;
 class EventBase;
 class File;
 namespace io {
@@ -36,6 +42,13 @@ namespace eden {
  *
  * The uid and gid parameters specify the user and group ID of the unprivileged
  * process that will be making requests to us.
+ *
+ * Requests are answered as soon as they complete rather than in the order
+ * they arrived.  FUSE and bind mount operations run on a small thread pool,
+ * so that the mounts of different checkouts proceed concurrently; operations
+ * acting on the same FUSE mount point (including the bind mounts inside it)
+ * still run one at a time, in the order they were received.  All other
+ * requests are handled on the main thread.
  */
 class PrivHelperServer : private UnixSocket::ReceiveCallback {
  public:
@@ -71,6 +84,28 @@ class PrivHelperServer : private UnixSocket::ReceiveCallback {
   void receiveError(const folly::exception_wrapper& ew) noexcept override;
 
   void processAndSendResponse(UnixSocket::Message&& message);
+  UnixSocket::Message processRequest(
+      uint32_t xid,
+      PrivHelperConn::MsgType msgType,
+      folly::io::Cursor& cursor,
+      UnixSocket::Message& request);
+
+  /**
+   * Returns the FUSE mount point that a mount operation acts on, or
+   * std::nullopt if the request should be processed on the main thread.
+   */
+  std::optional<std::string> getMountOperationKey(
+      PrivHelperConn::MsgType msgType,
+      folly::io::Cursor cursor);
+
+  /**
+   * Runs operation on the mount thread pool after every operation previously
+   * queued for the same mount point has finished.
+   */
+  void queueMountOperation(
+      const std::string& mountPoint,
+      folly::Function<void()> operation);
+  void runMountOperations(const std::string& mountPoint);
   UnixSocket::Message processMessage(
       PrivHelperConn::MsgType msgType,
       folly::io::Cursor& cursor,
@@ -93,7 +128,9 @@ class PrivHelperServer : private UnixSocket::ReceiveCallback {
       folly::io::Cursor& cursor,
       UnixSocket::Message& request);
 
-  // These methods are virtual so we can override them during unit tests
+  // These methods are virtual so we can override them during unit tests.
+  // fuseMount(), fuseUnmount(), bindMount() and bindUnmount() are called from
+  // the mount thread pool, concurrently for different mount points.
   virtual folly::File fuseMount(const char* mountPath, bool readOnly);
   virtual void fuseUnmount(const char* mountPath);
   // Both clientPath and mountPath must be existing directories.
@@ -102,15 +139,27 @@ class PrivHelperServer : private UnixSocket::ReceiveCallback {
   virtual void setLogFile(folly::File&& logFile);
   virtual void setDaemonTimeout(std::chrono::nanoseconds duration);
 
+  struct MountOperationQueue {
+    // Whether a thread pool task is currently running this queue.
+    bool running{false};
+    std::deque<folly::Function<void()>> operations;
+  };
+
   std::unique_ptr<folly::EventBase> eventBase_;
   UnixSocket::UniquePtr conn_;
   uid_t uid_{std::numeric_limits<uid_t>::max()};
   gid_t gid_{std::numeric_limits<gid_t>::max()};
-  std::chrono::nanoseconds fuseTimeout_{std::chrono::seconds(60)};
+  std::atomic<std::chrono::nanoseconds> fuseTimeout_{std::chrono::seconds(60)};
+
+  std::unique_ptr<folly::CPUThreadPoolExecutor> mountThreadPool_;
+
+  // Mount operations waiting to run, keyed by FUSE mount point.  A queue is
+  // removed once it has been drained.
+  folly::Synchronized<std::unordered_map<std::string, MountOperationQueue>>
+      mountOperations_;
 
-  // The privhelper server only has a single thread,
-  // so we don't need to lock the following state
-  std::set<std::string> mountPoints_;
+  // Mount operations run on mountThreadPool_, so this is locked.
+  folly::Synchronized<std::set<std::string>> mountPoints_;
 };
 
 } // namespace eden
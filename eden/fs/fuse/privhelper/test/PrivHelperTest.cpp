@@ -289,6 +289,28 @@ TEST_F(PrivHelperTest, multiplePendingFuseMounts) {
   EXPECT_THAT(server_.getUnusedFuseUnmountResults(), UnorderedElementsAre());
 }
 
+TEST_F(PrivHelperTest, fuseMountsRunConcurrently) {
+  auto abcPromise = server_.setFuseMountResult("/mnt/abc");
+  auto defPromise = server_.setFuseMountResult("/mnt/def");
+  server_.setFuseUnmountResult("/mnt/abc").setValue();
+  server_.setFuseUnmountResult("/mnt/def").setValue();
+
+  auto abcResult = client_->fuseMount("/mnt/abc", false);
+  auto defResult = client_->fuseMount("/mnt/def", false);
+
+  // The mount of /mnt/def completes while /mnt/abc is still blocked.
+  TemporaryFile tempFile;
+  defPromise.setValue(File(tempFile.fd(), /* ownsFD */ false));
+  std::move(defResult).get(1s);
+  EXPECT_FALSE(abcResult.isReady());
+
+  abcPromise.setValue(File(tempFile.fd(), /* ownsFD */ false));
+  std::move(abcResult).get(1s);
+
+  cleanup();
+  EXPECT_THAT(server_.getUnusedFuseUnmountResults(), UnorderedElementsAre());
+}
+
 TEST_F(PrivHelperTest, bindMounts) {
   TemporaryFile tempFile;
 
@@ -49,7 +49,7 @@ void PrivHelperTestServer::fuseUnmount(const char* mountPath) {
 
   // Implicitly unmount all bind mounts
   auto mountPrefix = folly::to<std::string>(mountPath, "/");
-  for (auto& path : allBindMounts_) {
+  for (auto& path : *allBindMounts_.rlock()) {
     if (folly::StringPiece(path).startsWith(mountPrefix)) {
       folly::writeFile(StringPiece{"bind-unmounted"}, path.c_str());
     }
@@ -78,7 +78,7 @@ void PrivHelperTestServer::bindMount(
 
   auto fileInMountPath = getPathToBindMountMarker(mountPath);
   folly::writeFile(StringPiece{"bind-mounted"}, fileInMountPath.c_str());
-  allBindMounts_.push_back(fileInMountPath);
+  allBindMounts_.wlock()->push_back(fileInMountPath);
 }
 
 void PrivHelperTestServer::bindUnmount(const char* mountPath) {
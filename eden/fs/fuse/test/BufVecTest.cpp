@@ -7,8 +7,12 @@
 
 #include "eden/fs/fuse/BufVec.h"
 
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
 #include <gtest/gtest.h>
 
+using folly::test::TemporaryFile;
+
 TEST(BufVecTest, BufVec) {
   auto root = folly::IOBuf::wrapBuffer("hello", 5);
   root->appendChain(folly::IOBuf::wrapBuffer("world", 5));
@@ -16,4 +20,51 @@ TEST(BufVecTest, BufVec) {
   EXPECT_EQ(10u, bufVec.size());
   EXPECT_EQ(10u, bufVec.copyData().size());
   EXPECT_EQ("helloworld", bufVec.copyData());
+  EXPECT_FALSE(bufVec.hasFdSegments());
+}
+
+TEST(BufVecTest, fdSegment) {
+  TemporaryFile file;
+  ASSERT_EQ(11, folly::writeFull(file.fd(), "hello world", 11));
+
+  auto bufVec = facebook::eden::BufVec::fromFd(file.fd(), 6, 5, nullptr);
+  EXPECT_TRUE(bufVec.hasFdSegments());
+  EXPECT_EQ(5u, bufVec.size());
+  EXPECT_EQ("world", bufVec.copyData());
+
+  bufVec.readIntoMemory();
+  EXPECT_FALSE(bufVec.hasFdSegments());
+  auto iov = bufVec.getIov();
+  ASSERT_EQ(1u, iov.size());
+  EXPECT_EQ(
+      "world",
+      std::string(static_cast<const char*>(iov[0].iov_base), iov[0].iov_len));
+}
+
+TEST(BufVecTest, fdSegmentPastEndOfFile) {
+  TemporaryFile file;
+  ASSERT_EQ(5, folly::writeFull(file.fd(), "hello", 5));
+
+  auto bufVec = facebook::eden::BufVec::fromFd(file.fd(), 2, 10, nullptr);
+  EXPECT_EQ("llo", bufVec.copyData());
+  bufVec.readIntoMemory();
+  EXPECT_EQ(3u, bufVec.size());
+}
+
+#ifdef __linux__
+TEST(BufVecTest, spliceToPipe) {
+  TemporaryFile file;
+  ASSERT_EQ(11, folly::writeFull(file.fd(), "hello world", 11));
+
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  auto bufVec = facebook::eden::BufVec::fromFd(file.fd(), 0, 11, nullptr);
+  EXPECT_EQ(11u, bufVec.spliceToPipe(fds[1]));
+
+  char buf[11];
+  ASSERT_EQ(11, folly::readFull(fds[0], buf, sizeof(buf)));
+  EXPECT_EQ("hello world", std::string(buf, sizeof(buf)));
+  close(fds[0]);
+  close(fds[1]);
 }
+#endif
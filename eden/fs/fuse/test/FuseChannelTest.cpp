@@ -7,11 +7,19 @@
 
 #include "eden/fs/fuse/FuseChannel.h"
 
+#include <fcntl.h>
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
 #include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/io/IOBuf.h>
 #include <folly/logging/xlog.h>
 #include <folly/test/TestUtils.h>
 #include <gtest/gtest.h>
+#include <thread>
 #include <unordered_map>
+#include "eden/fs/fuse/BufVec.h"
 #include "eden/fs/fuse/Dispatcher.h"
 #include "eden/fs/fuse/RequestData.h"
 #include "eden/fs/telemetry/EdenStats.h"
@@ -100,6 +108,25 @@ class FuseChannelTest : public ::testing::Test {
     return std::move(initFuture).get(kTimeout);
   }
 
+  /**
+   * Sends count lookup requests, answers each of them, and checks that the
+   * FuseChannel replies to every one.
+   */
+  void expectLookupsAnswered(size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      auto requestId = fuse_.sendLookup(FUSE_ROOT_ID, "foo");
+      auto expected = genRandomLookupResponse(i + 2);
+      dispatcher_.waitForLookup(requestId).promise.setValue(expected);
+      auto response = fuse_.recvResponse();
+      EXPECT_EQ(requestId, response.header.unique);
+      EXPECT_EQ(0, response.header.error);
+      EXPECT_EQ(
+          ByteRange(
+              reinterpret_cast<const uint8_t*>(&expected), sizeof(expected)),
+          ByteRange(response.body.data(), response.body.size()));
+    }
+  }
+
   FakeFuse fuse_;
   EdenStats stats_;
   TestDispatcher dispatcher_{&stats_};
@@ -108,6 +135,38 @@ class FuseChannelTest : public ::testing::Test {
 
 } // namespace
 
+namespace facebook {
+namespace eden {
+class CoalesceInvalidationsTest : public ::testing::Test {
+ protected:
+  using Entry = FuseChannel::InvalidationEntry;
+  using Type = FuseChannel::InvalidationType;
+
+  static size_t coalesce(std::vector<Entry>& entries) {
+    return FuseChannel::coalesceInvalidations(entries);
+  }
+
+  static void expectInode(
+      const Entry& entry,
+      uint64_t ino,
+      int64_t offset,
+      int64_t length) {
+    EXPECT_EQ(Type::INODE, entry.type);
+    EXPECT_EQ(InodeNumber{ino}, entry.inode);
+    EXPECT_EQ(offset, entry.range.offset);
+    EXPECT_EQ(length, entry.range.length);
+  }
+
+  static void
+  expectDirEntry(const Entry& entry, uint64_t parent, folly::StringPiece name) {
+    EXPECT_EQ(Type::DIR_ENTRY, entry.type);
+    EXPECT_EQ(InodeNumber{parent}, entry.inode);
+    EXPECT_EQ(name, entry.name.stringPiece());
+  }
+};
+} // namespace eden
+} // namespace facebook
+
 TEST_F(FuseChannelTest, testDestroyNeverInitialized) {
   // Create a FuseChannel and then destroy it without ever calling initialize()
   auto channel = createChannel();
@@ -178,6 +237,39 @@ TEST_F(FuseChannelTest, testTakeoverStop) {
   EXPECT_EQ(flags, stopData.fuseSettings.flags);
 }
 
+#ifdef __linux__
+TEST_F(FuseChannelTest, testInitNegotiatesMaxPages) {
+  constexpr size_t maxWrite = 1024 * 1024;
+  unique_ptr<FuseChannel, FuseChannelDeleter> channel(new FuseChannel(
+      fuse_.start(),
+      mountPath_,
+      2,
+      &dispatcher_,
+      std::make_shared<ProcessNameCache>(),
+      std::chrono::seconds(60),
+      nullptr,
+      false,
+      false,
+      false,
+      false,
+      maxWrite));
+  auto completeFuture = performInit(
+      channel.get(),
+      FUSE_KERNEL_VERSION,
+      FUSE_KERNEL_MINOR_VERSION,
+      0,
+      FUSE_MAX_PAGES);
+
+  channel->takeoverStop();
+
+  auto stopData = std::move(completeFuture).get(kTimeout);
+  EXPECT_EQ(stopData.reason, FuseChannel::StopReason::TAKEOVER);
+  EXPECT_EQ(FUSE_MAX_PAGES, stopData.fuseSettings.flags);
+  EXPECT_EQ(maxWrite, stopData.fuseSettings.max_write);
+  EXPECT_EQ(maxWrite / getpagesize(), stopData.fuseSettings.max_pages);
+}
+#endif
+
 TEST_F(FuseChannelTest, testInitUnmountRace) {
   auto channel = createChannel();
   auto completeFuture = performInit(channel.get());
@@ -392,3 +484,298 @@ TEST_F(FuseChannelTest, interruptLookups) {
     EXPECT_EQ(requestId, received.header.unique);
   }
 }
+
+TEST_F(FuseChannelTest, workerPoolGrowsAndShrinksWithOutstandingRequests) {
+  constexpr size_t kMinThreads = 1;
+  constexpr size_t kMaxThreads = 4;
+  unique_ptr<FuseChannel, FuseChannelDeleter> channel(new FuseChannel(
+      fuse_.start(),
+      mountPath_,
+      kMinThreads,
+      &dispatcher_,
+      std::make_shared<ProcessNameCache>(),
+      std::chrono::seconds(60),
+      nullptr,
+      false,
+      false,
+      false,
+      false,
+      FuseChannel::kDefaultMaxWrite,
+      kMinThreads,
+      kMaxThreads,
+      250ms));
+  auto completeFuture = performInit(channel.get());
+  EXPECT_EQ(kMinThreads, channel->getWorkerThreadCount());
+
+  // Every lookup stays outstanding until it is answered below, so each one
+  // beyond the number of workers starts another worker, up to kMaxThreads.
+  std::vector<uint64_t> requestIds;
+  std::vector<TestDispatcher::PendingLookup> lookups;
+  for (size_t i = 0; i < kMaxThreads + 2; ++i) {
+    requestIds.push_back(fuse_.sendLookup(FUSE_ROOT_ID, "foo"));
+    lookups.push_back(dispatcher_.waitForLookup(requestIds.back()));
+  }
+  EXPECT_EQ(kMaxThreads, channel->getWorkerThreadCount());
+
+  for (size_t i = 0; i < lookups.size(); ++i) {
+    lookups[i].promise.setValue(genRandomLookupResponse(i + 2));
+    EXPECT_EQ(requestIds[i], fuse_.recvResponse().header.unique);
+  }
+
+  // Workers above kMinThreads exit once they see no request for the idle
+  // timeout.  Workers that lost the race for the last request are blocked in
+  // read(), so keep sending an occasional request to wake them up.
+  auto deadline = std::chrono::steady_clock::now() + 10s;
+  while (channel->getWorkerThreadCount() > kMinThreads &&
+         std::chrono::steady_clock::now() < deadline) {
+    /* sleep override */ std::this_thread::sleep_for(500ms);
+    auto requestId = fuse_.sendLookup(FUSE_ROOT_ID, "bar");
+    dispatcher_.waitForLookup(requestId).promise.setValue(
+        genRandomLookupResponse(1));
+    EXPECT_EQ(requestId, fuse_.recvResponse().header.unique);
+  }
+  EXPECT_EQ(kMinThreads, channel->getWorkerThreadCount());
+
+  // The remaining worker still answers requests.
+  auto requestId = fuse_.sendLookup(FUSE_ROOT_ID, "baz");
+  dispatcher_.waitForLookup(requestId).promise.setValue(
+      genRandomLookupResponse(7));
+  EXPECT_EQ(requestId, fuse_.recvResponse().header.unique);
+}
+
+TEST_F(CoalesceInvalidationsTest, mergesOverlappingAndAdjacentRanges) {
+  std::vector<Entry> entries;
+  entries.emplace_back(InodeNumber{5}, 0, 10);
+  entries.emplace_back(InodeNumber{5}, 100, 10);
+  entries.emplace_back(InodeNumber{6}, 0, 0);
+  entries.emplace_back(InodeNumber{5}, 5, 10);
+  entries.emplace_back(InodeNumber{5}, 15, 5);
+  entries.emplace_back(InodeNumber{6}, 4096, 10);
+
+  EXPECT_EQ(3, coalesce(entries));
+  ASSERT_EQ(3, entries.size());
+  // [0, 10), [5, 15) and the adjacent [15, 20) become one range.
+  expectInode(entries[0], 5, 0, 20);
+  expectInode(entries[1], 5, 100, 10);
+  // A length of 0 runs to the end of the file and covers later ranges.
+  expectInode(entries[2], 6, 0, 0);
+}
+
+TEST_F(CoalesceInvalidationsTest, foldsAttributeOnlyIntoDataInvalidations) {
+  std::vector<Entry> entries;
+  entries.emplace_back(InodeNumber{7}, -1, 0);
+  entries.emplace_back(InodeNumber{8}, -1, 0);
+  entries.emplace_back(InodeNumber{7}, 0, 4096);
+  entries.emplace_back(InodeNumber{8}, -1, 0);
+
+  EXPECT_EQ(2, coalesce(entries));
+  ASSERT_EQ(2, entries.size());
+  // Every inode invalidation also invalidates attributes.
+  expectInode(entries[0], 7, 0, 4096);
+  expectInode(entries[1], 8, -1, 0);
+}
+
+TEST_F(CoalesceInvalidationsTest, dropsDuplicateDirEntries) {
+  std::vector<Entry> entries;
+  entries.emplace_back(InodeNumber{1}, "a"_pc);
+  entries.emplace_back(InodeNumber{1}, "b"_pc);
+  entries.emplace_back(InodeNumber{1}, "a"_pc);
+  entries.emplace_back(InodeNumber{2}, "a"_pc);
+  entries.emplace_back(InodeNumber{1}, "b"_pc);
+
+  EXPECT_EQ(2, coalesce(entries));
+  ASSERT_EQ(3, entries.size());
+  expectDirEntry(entries[0], 1, "a");
+  expectDirEntry(entries[1], 1, "b");
+  expectDirEntry(entries[2], 2, "a");
+}
+
+TEST_F(CoalesceInvalidationsTest, keepsOrderAroundFlushesAndStores) {
+  folly::Promise<folly::Unit> promise;
+  auto flushed = promise.getFuture();
+  std::vector<Entry> entries;
+  entries.emplace_back(InodeNumber{1}, "a"_pc);
+  entries.emplace_back(InodeNumber{5}, 0, 10);
+  entries.emplace_back(std::move(promise));
+  entries.emplace_back(InodeNumber{1}, "a"_pc);
+  entries.emplace_back(InodeNumber{5}, 0, 10);
+  entries.emplace_back(
+      InodeNumber{5}, uint64_t{0}, folly::IOBuf::copyBuffer("data"));
+  entries.emplace_back(InodeNumber{5}, 0, 10);
+
+  // Duplicates on either side of a FLUSH or STORE are all kept.
+  EXPECT_EQ(0, coalesce(entries));
+  ASSERT_EQ(7, entries.size());
+  expectInode(entries[0], 5, 0, 10);
+  expectDirEntry(entries[1], 1, "a");
+  EXPECT_EQ(Type::FLUSH, entries[2].type);
+  expectInode(entries[3], 5, 0, 10);
+  expectDirEntry(entries[4], 1, "a");
+  EXPECT_EQ(Type::STORE, entries[5].type);
+  EXPECT_EQ(InodeNumber{5}, entries[5].inode);
+  expectInode(entries[6], 5, 0, 10);
+
+  // The FLUSH entry still fulfills the original promise.
+  entries[2].promise.setValue();
+  EXPECT_TRUE(flushed.isReady());
+}
+
+TEST_F(FuseChannelTest, ioUringAnswersRequestsOrFallsBackToRead) {
+  // Whether io_uring is available depends on the kernel, its sandboxing and
+  // on whether Eden was built with liburing.  If it is not, the workers fall
+  // back to blocking reads, and requests must be answered either way.
+  unique_ptr<FuseChannel, FuseChannelDeleter> channel(new FuseChannel(
+      fuse_.start(),
+      mountPath_,
+      2,
+      &dispatcher_,
+      std::make_shared<ProcessNameCache>(),
+      std::chrono::seconds(60),
+      nullptr,
+      false,
+      /*useIoUring=*/true));
+  auto completeFuture = performInit(channel.get());
+  expectLookupsAnswered(20);
+
+  // Closing the fake device completes the posted reads with end-of-file,
+  // which must stop the workers.
+  fuse_.close();
+  auto stopData = std::move(completeFuture).get(kTimeout);
+  EXPECT_EQ(stopData.reason, FuseChannel::StopReason::UNMOUNTED);
+}
+
+TEST_F(FuseChannelTest, ioUringWorkersStopOnTakeover) {
+  unique_ptr<FuseChannel, FuseChannelDeleter> channel(new FuseChannel(
+      fuse_.start(),
+      mountPath_,
+      2,
+      &dispatcher_,
+      std::make_shared<ProcessNameCache>(),
+      std::chrono::seconds(60),
+      nullptr,
+      false,
+      /*useIoUring=*/true));
+  auto completeFuture = performInit(channel.get());
+  expectLookupsAnswered(5);
+
+  // Reads posted through io_uring are cancelled so that the device can be
+  // handed over.
+  channel->takeoverStop();
+  auto stopData = std::move(completeFuture).get(kTimeout);
+  EXPECT_EQ(stopData.reason, FuseChannel::StopReason::TAKEOVER);
+  EXPECT_TRUE(stopData.fuseDevice);
+}
+
+TEST_F(FuseChannelTest, cloneDevicePerWorkerFallsBackToSharedDevice) {
+  // FakeFuse is a socket rather than a /dev/fuse connection, so
+  // FUSE_DEV_IOC_CLONE always fails and every worker reads from the device
+  // it was given instead.
+  unique_ptr<FuseChannel, FuseChannelDeleter> channel(new FuseChannel(
+      fuse_.start(),
+      mountPath_,
+      4,
+      &dispatcher_,
+      std::make_shared<ProcessNameCache>(),
+      std::chrono::seconds(60),
+      nullptr,
+      false,
+      false,
+      /*cloneDevicePerWorker=*/true));
+  auto completeFuture = performInit(channel.get());
+  expectLookupsAnswered(20);
+
+  channel->takeoverStop();
+  auto stopData = std::move(completeFuture).get(kTimeout);
+  EXPECT_EQ(stopData.reason, FuseChannel::StopReason::TAKEOVER);
+  EXPECT_TRUE(stopData.fuseDevice);
+}
+
+#ifdef __linux__
+namespace facebook {
+namespace eden {
+class FuseChannelSpliceTest : public FuseChannelTest {
+ protected:
+  static size_t maxReadReplySize(const FuseChannel& channel) {
+    return channel.getMaxReadReplySize();
+  }
+
+  static size_t splicePipeCapacity(const FuseChannel& channel) {
+    auto pipe = channel.createSplicePipe();
+    return pipe ? pipe->capacity : 0;
+  }
+
+  static bool trySpliceReply(
+      const FuseChannel& channel,
+      const fuse_in_header& request,
+      const BufVec& buf,
+      int deviceFd) {
+    return channel.trySpliceReply(request, buf, deviceFd);
+  }
+};
+} // namespace eden
+} // namespace facebook
+
+TEST_F(FuseChannelSpliceTest, pipeFitsTheLargestReadReply) {
+  auto channel = createChannel();
+  // Without FUSE_MAX_PAGES the kernel reads at most 32 pages at a time.
+  EXPECT_EQ(
+      sizeof(fuse_out_header) + 32 * getpagesize(), maxReadReplySize(*channel));
+
+  // The pipe is only grown as far as an unprivileged process may, which is
+  // at least the kernel's default pipe size.
+  std::string pipeMaxSize;
+  ASSERT_TRUE(folly::readFile("/proc/sys/fs/pipe-max-size", pipeMaxSize));
+  auto limit = folly::to<size_t>(folly::trimWhitespace(pipeMaxSize));
+  auto capacity = splicePipeCapacity(*channel);
+  EXPECT_GE(capacity, std::min(maxReadReplySize(*channel), limit));
+  EXPECT_LE(capacity, std::max<size_t>(limit, 16 * getpagesize()));
+}
+
+TEST_F(FuseChannelSpliceTest, splicesFileBackedReplies) {
+  unique_ptr<FuseChannel, FuseChannelDeleter> channel(new FuseChannel(
+      fuse_.start(),
+      mountPath_,
+      2,
+      &dispatcher_,
+      std::make_shared<ProcessNameCache>(),
+      std::chrono::seconds(60),
+      nullptr,
+      /*spliceReplies=*/true));
+
+  folly::test::TemporaryFile file;
+  std::string contents(64 * 1024, 'x');
+  ASSERT_EQ(
+      static_cast<ssize_t>(contents.size()),
+      folly::writeFull(file.fd(), contents.data(), contents.size()));
+
+  // Splice to a pipe standing in for the FUSE device, so that the reply can
+  // be read back whole.
+  int fds[2];
+  folly::checkUnixError(pipe2(fds, O_CLOEXEC), "pipe2 failed");
+  folly::File readEnd{fds[0], /*ownsFd=*/true};
+  folly::File writeEnd{fds[1], /*ownsFd=*/true};
+  fcntl(writeEnd.fd(), F_SETPIPE_SZ, 1024 * 1024);
+  if (fcntl(writeEnd.fd(), F_GETPIPE_SZ) <
+      static_cast<int>(sizeof(fuse_out_header) + contents.size())) {
+    GTEST_SKIP() << "pipes cannot hold a 64KiB reply on this system";
+  }
+
+  fuse_in_header request = {};
+  request.unique = 42;
+  auto buf = BufVec::fromFd(file.fd(), 0, contents.size(), nullptr);
+  ASSERT_TRUE(trySpliceReply(*channel, request, buf, writeEnd.fd()));
+
+  fuse_out_header out;
+  ASSERT_EQ(
+      static_cast<ssize_t>(sizeof(out)),
+      folly::readFull(readEnd.fd(), &out, sizeof(out)));
+  EXPECT_EQ(42, out.unique);
+  EXPECT_EQ(0, out.error);
+  EXPECT_EQ(sizeof(out) + contents.size(), out.len);
+  std::string spliced(contents.size(), '\0');
+  ASSERT_EQ(
+      static_cast<ssize_t>(contents.size()),
+      folly::readFull(readEnd.fd(), spliced.data(), spliced.size()));
+  EXPECT_EQ(contents, spliced);
+}
+#endif
@@ -319,8 +319,7 @@ Future<InvalidationRequired> CheckoutAction::doAction() {
 
 Future<bool> CheckoutAction::hasConflict() {
   if (oldTree_) {
-    auto treeInode = inode_.asTreePtrOrNull();
-    if (!treeInode) {
+    if (!inode_.asTreeOrNull()) {
       // This was a directory, but has been replaced with a file on disk
       ctx_->addConflict(ConflictType::MODIFIED_MODIFIED, inode_.get());
       return true;
@@ -334,7 +333,7 @@ Future<bool> CheckoutAction::hasConflict() {
     // parent directories.
     return false;
   } else if (oldBlob_) {
-    auto fileInode = inode_.asFilePtrOrNull();
+    auto* fileInode = inode_.asFileOrNull();
     if (!fileInode) {
       // This was a file, but has been replaced with a directory on disk
       ctx_->addConflict(ConflictType::MODIFIED_MODIFIED, inode_.get());
@@ -369,7 +368,7 @@ Future<bool> CheckoutAction::hasConflict() {
   DCHECK(newScmEntry_) << "If there is no oldScmEntry_, then there must be a "
                           "newScmEntry_.";
 
-  auto localIsFile = inode_.asFilePtrOrNull() != nullptr;
+  auto localIsFile = inode_.asFileOrNull() != nullptr;
   if (localIsFile) {
     auto remoteIsFile = !newScmEntry_->isTree();
     if (remoteIsFile) {
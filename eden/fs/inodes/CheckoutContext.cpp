@@ -7,12 +7,21 @@
 
 #include "eden/fs/inodes/CheckoutContext.h"
 
+#include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
 
 #include "eden/fs/config/CheckoutConfig.h"
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/InodePtr.h"
+#include "eden/fs/inodes/ServerState.h"
 #include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/utils/UnboundedQueueExecutor.h"
+
+#ifdef _WIN32
+#include "eden/fs/model/TreeEntry.h"
+#include "eden/fs/win/utils/StringConv.h" // @manual
+#endif
 
 using folly::Future;
 using std::vector;
@@ -26,10 +35,39 @@ CheckoutContext::CheckoutContext(
     CheckoutMode checkoutMode)
     : checkoutMode_{checkoutMode},
       mount_{mount},
-      parentsLock_(std::move(parentsLock)) {}
+      parentsLock_(std::move(parentsLock)),
+      checkoutThreadPool_{mount->getServerState()->getCheckoutThreadPool()} {
+#ifdef _WIN32
+  batchCachedFileUpdates_ = mount->getServerState()
+                                ->getEdenConfig()
+                                ->prjfsBatchCheckoutUpdates.getValue();
+#endif
+}
 
 CheckoutContext::~CheckoutContext() {}
 
+Future<folly::Unit> CheckoutContext::runSubtreeCheckout(
+    folly::Function<Future<folly::Unit>()> func) {
+  if (!checkoutThreadPool_) {
+    return func();
+  }
+  treesQueued_.fetch_add(1, std::memory_order_relaxed);
+  return folly::via(
+      checkoutThreadPool_.get(), [this, func = std::move(func)]() mutable {
+        treesQueued_.fetch_sub(1, std::memory_order_relaxed);
+        return func();
+      });
+}
+
+CheckoutContext::Progress CheckoutContext::getProgress() const {
+  Progress progress;
+  progress.treesQueued = treesQueued_.load(std::memory_order_relaxed);
+  progress.treesStarted = treesStarted_.load(std::memory_order_relaxed);
+  progress.treesFinished = treesFinished_.load(std::memory_order_relaxed);
+  progress.entriesUpdated = entriesUpdated_.load(std::memory_order_relaxed);
+  return progress;
+}
+
 void CheckoutContext::start(RenameLock&& renameLock) {
   renameLock_ = std::move(renameLock);
 }
@@ -48,10 +86,24 @@ Future<vector<CheckoutConflict>> CheckoutContext::finish(Hash newSnapshot) {
                << oldParents << " to " << newSnapshot;
   }
 
+  auto progress = getProgress();
+  XLOG(DBG2) << "checkout of " << mount_->getPath() << " processed "
+             << progress.treesFinished << " trees and updated "
+             << progress.entriesUpdated << " entries";
+
   // Release the rename lock.
   // This allows any filesystem unlink() or rename() operations to proceed.
   renameLock_.unlock();
 
+#ifdef _WIN32
+  // Like the FUSE invalidations below, the batched ProjectedFS updates are
+  // applied after releasing the rename lock but before other checkouts may
+  // start.
+  if (!isDryRun()) {
+    applyCachedFileUpdates();
+  }
+#endif
+
 #ifndef _WIN32
   // If we have a FUSE channel, flush all invalidations we sent to the kernel
   // as part of the checkout operation.  This will ensure that other processes
@@ -129,5 +181,76 @@ void CheckoutContext::addError(
   conflict.message = folly::exceptionStr(ew).toStdString();
   conflicts_.wlock()->push_back(std::move(conflict));
 }
+
+#ifdef _WIN32
+void CheckoutContext::addCachedFileUpdate(
+    RelativePathPiece path,
+    const TreeEntry* newEntry) {
+  FsChannel::CachedFileUpdate update;
+  update.path = edenToWinPath(path.stringPiece());
+  if (newEntry && !newEntry->isTree() &&
+      newEntry->getType() != TreeEntryType::SYMLINK) {
+    update.size = newEntry->getSize();
+    update.hash = newEntry->getHash();
+  }
+
+  auto updates = cachedFileUpdates_.wlock();
+  updates->updates.push_back(std::move(update));
+  updates->directories.insert(path.dirname().copy());
+}
+
+void CheckoutContext::setHotDirectories(
+    const std::vector<RelativePath>& paths) {
+  std::unordered_set<RelativePathPiece> seen;
+  for (const auto& path : paths) {
+    auto dir = path.dirname();
+    if (seen.insert(dir).second) {
+      hotDirectories_.push_back(dir.copy());
+    }
+  }
+}
+
+void CheckoutContext::applyCachedFileUpdates() {
+  auto updates = std::move(*cachedFileUpdates_.wlock());
+  if (updates.updates.empty()) {
+    return;
+  }
+
+  folly::stop_watch<std::chrono::milliseconds> watch;
+  auto* fsChannel = mount_->getFsChannel();
+  fsChannel->updateCachedFiles(updates.updates);
+
+  std::vector<FsChannel::Placeholder> placeholders;
+  for (const auto& dir : hotDirectories_) {
+    if (updates.directories.count(dir) == 0) {
+      continue;
+    }
+    std::vector<FileMetadata> entries;
+    try {
+      mount_->enumerateDirectory(dir, entries);
+    } catch (const std::exception& ex) {
+      // The checkout may have removed this directory.
+      XLOG(DBG4) << "not writing placeholders for " << dir << ": "
+                 << folly::exceptionStr(ex);
+      continue;
+    }
+    auto winDir = edenToWinPath(dir.stringPiece());
+    for (auto& entry : entries) {
+      FsChannel::Placeholder placeholder;
+      placeholder.path =
+          dir.empty() ? std::move(entry.name) : winDir + L'\\' + entry.name;
+      placeholder.isDirectory = entry.isDirectory;
+      placeholder.size = entry.size;
+      placeholders.push_back(std::move(placeholder));
+    }
+  }
+  fsChannel->writePlaceholders(placeholders);
+
+  XLOG(DBG2) << "checkout of " << mount_->getPath() << " updated "
+             << updates.updates.size() << " cached files and wrote "
+             << placeholders.size() << " placeholders in "
+             << watch.elapsed().count() << "ms";
+}
+#endif
 } // namespace eden
 } // namespace facebook
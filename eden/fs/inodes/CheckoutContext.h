@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <folly/Function.h>
 #include <folly/Synchronized.h>
 #include <folly/stop_watch.h>
+#include <atomic>
+#include <unordered_set>
 #include <vector>
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/InodePtrFwd.h"
@@ -29,6 +32,8 @@ namespace eden {
 class CheckoutConflict;
 class TreeInode;
 class Tree;
+class TreeEntry;
+class UnboundedQueueExecutor;
 
 /**
  * CheckoutContext maintains state during a checkout operation.
@@ -106,12 +111,97 @@ class CheckoutContext {
     return fetchContext_;
   }
 
+  /**
+   * Run func, which checks out one subtree.
+   *
+   * When checkout:parallelism is greater than 1, func is queued on the
+   * server's checkout thread pool, so sibling subtrees are walked
+   * concurrently by however many threads are idle.  Otherwise func runs
+   * inline.
+   */
+  folly::Future<folly::Unit> runSubtreeCheckout(
+      folly::Function<folly::Future<folly::Unit>()> func);
+
+  /**
+   * Counters describing how far this checkout has progressed.
+   */
+  struct Progress {
+    /** Trees whose checkout has been queued but not started. */
+    uint64_t treesQueued{0};
+    /** Trees that TreeInode::checkout() has started processing. */
+    uint64_t treesStarted{0};
+    /** Trees whose entries have all been checked out. */
+    uint64_t treesFinished{0};
+    /** Files and symlinks that were replaced or removed. */
+    uint64_t entriesUpdated{0};
+  };
+
+  Progress getProgress() const;
+
+  void treeStarted() {
+    treesStarted_.fetch_add(1, std::memory_order_relaxed);
+  }
+  void treeFinished() {
+    treesFinished_.fetch_add(1, std::memory_order_relaxed);
+  }
+  void entryUpdated() {
+    entriesUpdated_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+#ifdef _WIN32
+  /**
+   * Returns true if the ProjectedFS cache entries that the checkout changes
+   * should be passed to addCachedFileUpdate() rather than removed right away.
+   */
+  bool batchCachedFileUpdates() const {
+    return batchCachedFileUpdates_;
+  }
+
+  /**
+   * Records that the entry at path was replaced by newEntry, or removed if
+   * newEntry is null.  finish() applies all recorded updates in one batch.
+   */
+  void addCachedFileUpdate(RelativePathPiece path, const TreeEntry* newEntry);
+
+  /**
+   * Sets the directories whose placeholders finish() writes ahead of time if
+   * the checkout changed them.  Typically the directories of the files in the
+   * mount's checkout profile.
+   */
+  void setHotDirectories(const std::vector<RelativePath>& paths);
+#endif
+
  private:
   CheckoutMode checkoutMode_;
   EdenMount* const mount_;
   folly::Synchronized<EdenMount::ParentInfo>::LockedPtr parentsLock_;
   RenameLock renameLock_;
   StatsFetchContext fetchContext_;
+  // Null unless subtrees are checked out in parallel.
+  std::shared_ptr<UnboundedQueueExecutor> checkoutThreadPool_;
+
+  std::atomic<uint64_t> treesQueued_{0};
+  std::atomic<uint64_t> treesStarted_{0};
+  std::atomic<uint64_t> treesFinished_{0};
+  std::atomic<uint64_t> entriesUpdated_{0};
+
+#ifdef _WIN32
+  struct CachedFileUpdates {
+    std::vector<FsChannel::CachedFileUpdate> updates;
+    // The directories that contain the updated entries.
+    std::unordered_set<RelativePath> directories;
+  };
+
+  /**
+   * Applies the recorded cache updates, and writes the placeholders of the
+   * hot directories that they touched.
+   */
+  void applyCachedFileUpdates();
+
+  bool batchCachedFileUpdates_{false};
+  folly::Synchronized<CachedFileUpdates> cachedFileUpdates_;
+  std::vector<RelativePath> hotDirectories_;
+#endif
 
   // The checkout processing may occur across many threads,
   // if some data load operations complete asynchronously on other threads.
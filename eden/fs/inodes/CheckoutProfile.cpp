@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/CheckoutProfile.h"
+
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/logging/xlog.h>
+#include <map>
+#include <unordered_set>
+#include "eden/fs/utils/FileUtils.h"
+
+#ifndef _WIN32
+#include "eden/fs/utils/ProcessNameCache.h"
+#endif
+
+namespace facebook {
+namespace eden {
+
+namespace {
+constexpr folly::StringPiece kUnknownCommand{"<unknown>"};
+
+std::chrono::steady_clock::rep now() {
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+} // namespace
+
+CheckoutProfile::CheckoutProfile(
+    AbsolutePath path,
+    std::shared_ptr<ProcessNameCache> processNameCache)
+    : path_{std::move(path)}, processNameCache_{std::move(processNameCache)} {}
+
+std::vector<RelativePath> CheckoutProfile::startRecording(
+    std::chrono::steady_clock::duration window,
+    size_t maxPathsPerCommand) {
+  auto state = state_.wlock();
+  state->maxPathsPerCommand = maxPathsPerCommand;
+  if (!state->loaded) {
+    load(*state);
+  }
+  if (merge(*state)) {
+    write(*state);
+  }
+
+  std::vector<RelativePath> paths;
+  std::unordered_set<RelativePathPiece> seen;
+  for (const auto& [command, commandPaths] : state->commands) {
+    for (const auto& path : commandPaths) {
+      if (seen.insert(path).second) {
+        paths.push_back(path);
+      }
+    }
+  }
+
+  recordUntil_.store(now() + window.count(), std::memory_order_relaxed);
+  return paths;
+}
+
+bool CheckoutProfile::isRecording() const {
+  return now() < recordUntil_.load(std::memory_order_relaxed);
+}
+
+void CheckoutProfile::recordLoad(RelativePathPiece path, uint32_t pid) {
+  if (!isRecording()) {
+    return;
+  }
+  auto state = state_.wlock();
+  auto& paths = state->recorded[pid];
+  if (paths.size() < state->maxPathsPerCommand) {
+    paths.push_back(path.copy());
+  }
+}
+
+void CheckoutProfile::save() {
+  auto state = state_.wlock();
+  if (state->recorded.empty()) {
+    return;
+  }
+  if (!state->loaded) {
+    load(*state);
+  }
+  merge(*state);
+  write(*state);
+}
+
+void CheckoutProfile::load(State& state) {
+  state.loaded = true;
+  std::string contents;
+  try {
+#ifdef _WIN32
+    readFile(path_.c_str(), contents);
+#else
+    if (!folly::readFile(path_.c_str(), contents)) {
+      // There is no profile until the first checkout saves one.
+      return;
+    }
+#endif
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "unable to read checkout profile " << path_ << ": "
+               << folly::exceptionStr(ex);
+    return;
+  }
+
+  std::vector<folly::StringPiece> lines;
+  folly::split('\n', contents, lines);
+  std::vector<RelativePath>* paths = nullptr;
+  for (auto line : lines) {
+    if (line.empty()) {
+      continue;
+    }
+    if (line.front() != '\t') {
+      paths = &state.commands[line.str()];
+    } else if (paths) {
+      line.advance(1);
+      try {
+        paths->emplace_back(line);
+      } catch (const std::exception&) {
+        XLOG(DBG3) << "ignoring invalid path in checkout profile: " << line;
+      }
+    }
+  }
+}
+
+bool CheckoutProfile::merge(State& state) {
+  if (state.recorded.empty()) {
+    return false;
+  }
+
+#ifndef _WIN32
+  auto names = processNameCache_ ? processNameCache_->getAllProcessNames()
+                                 : std::map<pid_t, std::string>{};
+#endif
+
+  // The paths each command loaded since the last save come first, followed
+  // by the ones the profile already held for it.
+  std::unordered_map<std::string, std::vector<RelativePath>> recent;
+  for (auto& [pid, paths] : state.recorded) {
+    std::string command = kUnknownCommand.str();
+#ifndef _WIN32
+    auto name = names.find(static_cast<pid_t>(pid));
+    if (name != names.end()) {
+      command = name->second;
+    }
+#endif
+    auto& commandPaths = recent[command];
+    for (auto& path : paths) {
+      commandPaths.push_back(std::move(path));
+    }
+  }
+  state.recorded.clear();
+
+  for (auto& [command, paths] : recent) {
+    auto& existing = state.commands[command];
+    for (auto& path : existing) {
+      paths.push_back(std::move(path));
+    }
+    existing.clear();
+
+    std::unordered_set<std::string> seen;
+    for (auto& path : paths) {
+      if (existing.size() >= state.maxPathsPerCommand) {
+        break;
+      }
+      if (seen.insert(path.value()).second) {
+        existing.push_back(std::move(path));
+      }
+    }
+  }
+  return true;
+}
+
+void CheckoutProfile::write(const State& state) {
+  std::string contents;
+  for (const auto& [command, paths] : state.commands) {
+    if (paths.empty()) {
+      continue;
+    }
+    contents.append(command);
+    contents.push_back('\n');
+    for (const auto& path : paths) {
+      contents.push_back('\t');
+      contents.append(path.value());
+      contents.push_back('\n');
+    }
+  }
+
+  try {
+    auto data = folly::ByteRange{folly::StringPiece{contents}};
+#ifdef _WIN32
+    writeFileAtomic(path_.c_str(), data);
+#else
+    folly::writeFileAtomic(path_.stringPiece(), data);
+#endif
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "unable to write checkout profile " << path_ << ": "
+               << folly::exceptionStr(ex);
+  }
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+class ProcessNameCache;
+
+/**
+ * Remembers which files are loaded from source control shortly after a
+ * checkout, so that the next checkout can prefetch them before they are
+ * needed again.
+ *
+ * Paths are recorded per command, as reported by the ProcessNameCache, and
+ * only the most recently loaded paths of each command are kept.  The profile
+ * is stored in a small text file in the mount's client directory: each
+ * command is on a line of its own, followed by its paths, each on a line that
+ * starts with a tab.
+ *
+ * It is safe to use this object from arbitrary threads.
+ */
+class CheckoutProfile {
+ public:
+  CheckoutProfile(
+      AbsolutePath path,
+      std::shared_ptr<ProcessNameCache> processNameCache);
+
+  /**
+   * Saves what was recorded since the previous checkout, and starts
+   * recording the files that are loaded during the given window.  At most
+   * maxPathsPerCommand paths are kept for each command.
+   *
+   * Returns the paths that the profile holds for every command, which the
+   * caller should prefetch.
+   */
+  std::vector<RelativePath> startRecording(
+      std::chrono::steady_clock::duration window,
+      size_t maxPathsPerCommand);
+
+  /**
+   * Returns whether a checkout recently started recording.  This is cheap,
+   * so callers can check it before computing the arguments of recordLoad().
+   */
+  bool isRecording() const;
+
+  /**
+   * Records that the process with the given pid caused the file at path to
+   * be loaded.  Does nothing unless isRecording() is true.
+   */
+  void recordLoad(RelativePathPiece path, uint32_t pid);
+
+  /**
+   * Merges what was recorded into the profile and writes it to disk.
+   */
+  void save();
+
+ private:
+  struct State {
+    bool loaded{false};
+    size_t maxPathsPerCommand{0};
+    // The paths of each command, most recently loaded first.
+    std::unordered_map<std::string, std::vector<RelativePath>> commands;
+    // The paths loaded by each process since the last save, in order.
+    std::unordered_map<uint32_t, std::vector<RelativePath>> recorded;
+  };
+
+  void load(State& state);
+  /**
+   * Returns false if nothing was recorded since the last merge.
+   */
+  bool merge(State& state);
+  void write(const State& state);
+
+  const AbsolutePath path_;
+  const std::shared_ptr<ProcessNameCache> processNameCache_;
+  std::atomic<std::chrono::steady_clock::rep> recordUntil_{0};
+  folly::Synchronized<State> state_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -79,8 +79,10 @@ class UntrackedDiffEntry : public DeferredDiffEntry {
       });
     }
 
-    auto treeInode = inode_.asTreePtrOrNull();
-    if (!treeInode.get()) {
+    // inode_ keeps the tree alive until this entry is destroyed, which only
+    // happens once the diff has finished.
+    auto* treeInode = inode_.asTreeOrNull();
+    if (!treeInode) {
       return EDEN_BUG_FUTURE(Unit)
           << "UntrackedDiffEntry should only used with tree inodes";
     }
@@ -146,7 +148,7 @@ class ModifiedDiffEntry : public DeferredDiffEntry {
 
  private:
   folly::Future<folly::Unit> runForScmTree() {
-    auto treeInode = inode_.asTreePtrOrNull();
+    auto* treeInode = inode_.asTreeOrNull();
     if (!treeInode) {
       // This is a Tree in the source control state, but a file or symlink
       // in the current filesystem state.
@@ -192,15 +194,14 @@ class ModifiedDiffEntry : public DeferredDiffEntry {
     // Possibly modified directory.  Load the Tree in question.
     return context_->store
         ->getTree(scmEntry_.getHash(), context_->getFetchContext())
-        .thenValue([this, treeInode = std::move(treeInode)](
-                       shared_ptr<const Tree>&& tree) {
+        .thenValue([this, treeInode](shared_ptr<const Tree>&& tree) {
           return treeInode->diff(
               context_, getPath(), std::move(tree), ignore_, isIgnored_);
         });
   }
 
   folly::Future<folly::Unit> runForScmBlob() {
-    auto fileInode = inode_.asFilePtrOrNull();
+    auto* fileInode = inode_.asFileOrNull();
     if (!fileInode) {
       // This is a file in the source control state, but a directory
       // in the current filesystem state.
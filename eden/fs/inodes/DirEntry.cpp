@@ -41,6 +41,10 @@ FileInodePtr DirEntry::asFilePtrOrNull() const {
   return FileInodePtr{};
 }
 
+TreeInode* DirEntry::asTreeOrNull() const {
+  return hasInodePointer_ ? dynamic_cast<TreeInode*>(inode_) : nullptr;
+}
+
 TreeInodePtr DirEntry::asTreePtrOrNull() const {
   if (hasInodePointer_) {
     if (auto tree = dynamic_cast<TreeInode*>(inode_)) {
@@ -146,6 +146,13 @@ class DirEntry {
    */
   FileInodePtr asFilePtrOrNull() const;
 
+  /**
+   * Returns the loaded TreeInode for this entry, or nullptr if the entry is
+   * not loaded or is not a directory.  Like getInode(), the result is only
+   * valid while the parent TreeInode's contents_ lock is held.
+   */
+  TreeInode* asTreeOrNull() const;
+
   /**
    * Same as getInodePtr().asTreePtrOrNull() except it avoids constructing
    * a TreeInodePtr if the entry does not point to a FileInode.
@@ -232,6 +239,11 @@ class DirEntry {
 };
 
 static_assert(sizeof(DirEntry) == 32, "DirEntry is four words");
+// DirContents stores each name inline next to its entry, so that scanning a
+// directory touches one cache line per child.
+static_assert(
+    sizeof(std::pair<PathComponent, DirEntry>) <= 64,
+    "a directory child fits in a cache line");
 
 /**
  * Represents a directory in the overlay.
@@ -13,12 +13,14 @@
 #include <cstring>
 #include <shared_mutex>
 
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/fuse/DirList.h"
 #include "eden/fs/fuse/RequestData.h"
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/inodes/InodeMap.h"
 #include "eden/fs/inodes/Overlay.h"
+#include "eden/fs/inodes/ServerState.h"
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/utils/SystemError.h"
 
@@ -43,21 +45,48 @@ namespace {
 
 /** Compute a fuse_entry_out */
 fuse_entry_out computeEntryParam(const Dispatcher::Attr& attr) {
-  DCHECK(attr.st.st_ino) << "We should never return a 0 inode to FUSE";
-  fuse_entry_out entry = {};
-  entry.nodeid = attr.st.st_ino;
-  entry.generation = 0;
-  auto fuse_attr = attr.asFuseAttr();
-  entry.attr = fuse_attr.attr;
-  entry.attr_valid = fuse_attr.attr_valid;
-  entry.attr_valid_nsec = fuse_attr.attr_valid_nsec;
-  entry.entry_valid = fuse_attr.attr_valid;
-  entry.entry_valid_nsec = fuse_attr.attr_valid_nsec;
-  return entry;
+  return attr.asFuseEntry();
+}
+
+/**
+ * Calls func and returns the value of the Future it returns if that has
+ * already completed successfully, or std::nullopt if the Future is still
+ * pending or failed, or if func threw.  Errors are left for the asynchronous
+ * path to report, which also handles inodes with corrupt overlay data.
+ */
+template <typename Func>
+auto valueIfReady(Func&& func)
+    -> std::optional<typename folly::invoke_result_t<Func>::value_type> {
+  auto future = folly::makeFutureWith(std::forward<Func>(func));
+  if (future.isReady() && future.hasValue()) {
+    return std::move(future).value();
+  }
+  return std::nullopt;
 }
 
 constexpr int64_t kBrokenInodeCacheSeconds = 5;
 
+/**
+ * A successful lookup reply with an inode number of 0, which tells the kernel
+ * to cache that the name does not exist for the configured time.
+ */
+fuse_entry_out negativeEntry(const EdenMount& mount) {
+  fuse_entry_out entry = {};
+  entry.attr_valid = std::numeric_limits<decltype(entry.attr_valid)>::max();
+  auto timeout = mount.getServerState()
+                     ->getEdenConfig(ConfigReloadBehavior::NoReload)
+                     ->fuseNegativeEntryTimeout.getValue();
+  if (timeout == std::chrono::nanoseconds::max()) {
+    entry.entry_valid =
+        std::numeric_limits<decltype(entry.entry_valid)>::max();
+  } else {
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    entry.entry_valid = seconds.count();
+    entry.entry_valid_nsec = (timeout - seconds).count();
+  }
+  return entry;
+}
+
 Dispatcher::Attr attrForInodeWithCorruptOverlay(InodeNumber ino) noexcept {
   struct stat st = {};
   st.st_ino = ino.get();
@@ -66,6 +95,67 @@ Dispatcher::Attr attrForInodeWithCorruptOverlay(InodeNumber ino) noexcept {
 }
 } // namespace
 
+std::optional<Dispatcher::Attr> EdenDispatcher::getattrIfReady(
+    InodeNumber ino) {
+  auto inode = inodeMap_->lookupLoadedInode(ino);
+  if (!inode) {
+    return std::nullopt;
+  }
+  auto st = valueIfReady([&] { return inode->stat(); });
+  if (!st) {
+    return std::nullopt;
+  }
+  FB_LOGF(mount_->getStraceLogger(), DBG7, "getattr({})", ino);
+  return Dispatcher::Attr{*st};
+}
+
+std::optional<fuse_entry_out> EdenDispatcher::lookupIfReady(
+    InodeNumber parent,
+    PathComponentPiece name) {
+  auto tree = inodeMap_->lookupLoadedInode(parent).asTreePtrOrNull();
+  if (!tree) {
+    return std::nullopt;
+  }
+  auto inode = tree->getLoadedChild(name);
+  if (!inode) {
+    // Answer probes for missing names without going through
+    // getOrLoadChild(), which reports them by throwing ENOENT.
+    if (tree->isChildMissing(name)) {
+      FB_LOGF(mount_->getStraceLogger(), DBG7, "lookup({}, {})", parent, name);
+      return negativeEntry(*mount_);
+    }
+    return std::nullopt;
+  }
+  auto st = valueIfReady([&] { return inode->stat(); });
+  if (!st) {
+    return std::nullopt;
+  }
+  FB_LOGF(mount_->getStraceLogger(), DBG7, "lookup({}, {})", parent, name);
+  inode->incFuseRefcount();
+  return computeEntryParam(Dispatcher::Attr{*st});
+}
+
+std::optional<std::string> EdenDispatcher::readlinkIfReady(
+    InodeNumber ino,
+    bool kernelCachesReadlink) {
+  auto file = inodeMap_->lookupLoadedInode(ino).asFilePtrOrNull();
+  if (!file || file->getType() != dtype_t::Symlink) {
+    return std::nullopt;
+  }
+  // If the contents are not available yet, readlink() below joins the load
+  // started here rather than starting another one.
+  auto target = valueIfReady([&] {
+    return file->readlink(
+        ObjectFetchContext::getNullContext(),
+        kernelCachesReadlink ? CacheHint::NotNeededAgain
+                             : CacheHint::LikelyNeededAgain);
+  });
+  if (target) {
+    FB_LOGF(mount_->getStraceLogger(), DBG7, "readlink({})", ino);
+  }
+  return target;
+}
+
 folly::Future<Dispatcher::Attr> EdenDispatcher::getattr(InodeNumber ino) {
   FB_LOGF(mount_->getStraceLogger(), DBG7, "getattr({})", ino);
   return inodeMap_->lookupInode(ino)
@@ -134,17 +224,13 @@ folly::Future<fuse_entry_out> EdenDispatcher::lookup(
             });
       })
       .thenError(
-          folly::tag_t<std::system_error>{}, [](const std::system_error& err) {
+          folly::tag_t<std::system_error>{},
+          [mount = mount_](const std::system_error& err) {
             // Translate ENOENT into a successful response with an
-            // inode number of 0 and a large entry_valid time, to let the kernel
-            // cache this negative lookup result.
+            // inode number of 0, to let the kernel cache this negative lookup
+            // result.
             if (isEnoent(err)) {
-              fuse_entry_out entry = {};
-              entry.attr_valid =
-                  std::numeric_limits<decltype(entry.attr_valid)>::max();
-              entry.entry_valid =
-                  std::numeric_limits<decltype(entry.entry_valid)>::max();
-              return entry;
+              return negativeEntry(*mount);
             }
             throw err;
           });
@@ -175,6 +261,11 @@ void EdenDispatcher::forget(InodeNumber ino, unsigned long nlookup) {
 
 folly::Future<uint64_t> EdenDispatcher::open(InodeNumber ino, int flags) {
   FB_LOGF(mount_->getStraceLogger(), DBG7, "open({}, flags={:x})", ino, flags);
+  // Materialized files can't be handed to the kernel with FUSE passthrough:
+  // the kernel maps offsets one-to-one onto the backing file, but overlay
+  // files start with an FsOverlay::kHeaderLength byte header, and writes
+  // that bypass edenfs would never reach the journal or invalidate the
+  // cached size and SHA-1 in OverlayFileAccess.
 #ifdef FUSE_NO_OPEN_SUPPORT
   if (getConnInfo().flags & FUSE_NO_OPEN_SUPPORT) {
     // If the kernel understands FUSE_NO_OPEN_SUPPORT, then returning ENOSYS
@@ -236,6 +327,13 @@ EdenDispatcher::write(InodeNumber ino, folly::StringPiece data, off_t off) {
       ino,
       off,
       data.size());
+  // The data points into the FUSE worker's request buffer, which is reused as
+  // soon as we return.  If the inode is already loaded FileInode::write()
+  // copies the data only if it cannot write it immediately, so avoid making
+  // our own copy.
+  if (auto inode = inodeMap_->lookupLoadedFile(ino)) {
+    return inode->write(data, off);
+  }
   return inodeMap_->lookupFileInode(ino).thenValue(
       [copy = data.str(), off](FileInodePtr&& inode) {
         return inode->write(copy, off);
@@ -296,6 +394,21 @@ folly::Future<DirList> EdenDispatcher::readdir(
       });
 }
 
+#ifdef __linux__
+folly::Future<DirListPlus> EdenDispatcher::readdirplus(
+    InodeNumber ino,
+    DirListPlus&& dirList,
+    off_t offset,
+    uint64_t /*fh*/) {
+  FB_LOGF(
+      mount_->getStraceLogger(), DBG7, "readdirplus({}, {})", ino, offset);
+  return inodeMap_->lookupTreeInode(ino).thenValue(
+      [dirList = std::move(dirList), offset](TreeInodePtr inode) mutable {
+        return inode->readdirplus(std::move(dirList), offset);
+      });
+}
+#endif
+
 folly::Future<fuse_entry_out> EdenDispatcher::mknod(
     InodeNumber parent,
     PathComponentPiece name,
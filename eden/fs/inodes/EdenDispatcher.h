@@ -31,6 +31,14 @@ class EdenDispatcher : public Dispatcher {
   explicit EdenDispatcher(EdenMount* mount);
 
   folly::Future<struct fuse_kstatfs> statfs(InodeNumber ino) override;
+  std::optional<Attr> getattrIfReady(InodeNumber ino) override;
+  std::optional<fuse_entry_out> lookupIfReady(
+      InodeNumber parent,
+      PathComponentPiece name) override;
+  std::optional<std::string> readlinkIfReady(
+      InodeNumber ino,
+      bool kernelCachesReadlink) override;
+
   folly::Future<Attr> getattr(InodeNumber ino) override;
   folly::Future<Attr> setattr(InodeNumber ino, const fuse_setattr_in& attr)
       override;
@@ -91,6 +99,13 @@ class EdenDispatcher : public Dispatcher {
       DirList&& dirList,
       off_t offset,
       uint64_t fh) override;
+#ifdef __linux__
+  folly::Future<DirListPlus> readdirplus(
+      InodeNumber ino,
+      DirListPlus&& dirList,
+      off_t offset,
+      uint64_t fh) override;
+#endif
 
   folly::Future<std::string> getxattr(InodeNumber ino, folly::StringPiece name)
       override;
@@ -10,10 +10,13 @@
 #include <boost/filesystem.hpp>
 #include <folly/ExceptionWrapper.h>
 #include <folly/FBString.h>
+#include <folly/Format.h>
+#include <folly/MapUtil.h>
 #include <folly/stop_watch.h>
 
 #include <folly/chrono/Conv.h>
 #include <folly/futures/Future.h>
+#include <folly/hash/Hash.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/logging/Logger.h>
 #include <folly/logging/xlog.h>
@@ -37,6 +40,7 @@
 #include "eden/fs/service/PrettyPrinters.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
 #include "eden/fs/store/BlobAccess.h"
+#include "eden/fs/store/Diff.h"
 #include "eden/fs/store/DiffCallback.h"
 #include "eden/fs/store/DiffContext.h"
 #include "eden/fs/store/ObjectStore.h"
@@ -47,6 +51,7 @@
 #include "eden/fs/utils/FaultInjector.h"
 #include "eden/fs/utils/Future.h"
 #include "eden/fs/utils/PathFuncs.h"
+#include "eden/fs/utils/SystemError.h"
 #include "eden/fs/utils/UnboundedQueueExecutor.h"
 
 #ifdef _WIN32
@@ -86,6 +91,165 @@ namespace {
 // The name of that symlink is `this-dir`:
 // .eden/this-dir -> /abs/path/to/mount/.eden
 constexpr PathComponentPiece kDotEdenSymlinkName{"this-dir"_pc};
+
+constexpr PathComponentPiece kIgnoreFilename{".gitignore"_pc};
+
+// Rough costs of a loaded inode for the inode memory budget: the object itself
+// plus its share of the InodeMap and of its parent's directory entries.
+constexpr size_t kApproxFileInodeBytes = sizeof(FileInode) + 128;
+constexpr size_t kApproxTreeInodeBytes = sizeof(TreeInode) + 256;
+
+/**
+ * How a single path recorded in the journal affects a cached ScmStatus.
+ */
+struct PathStatusUpdate {
+  enum Kind {
+    /** The path matches source control and has no status entry. */
+    CLEAN,
+    /** The path has the status in the status field. */
+    CHANGED,
+    /**
+     * The path cannot be checked on its own, for instance because a
+     * directory is involved or because deciding requires ignore rules.
+     */
+    NEEDS_FULL_DIFF,
+  };
+
+  Kind kind;
+  ScmFileStatus status{ScmFileStatus::MODIFIED};
+};
+
+/**
+ * Look up the source control entry for components[index:] below tree.
+ * Returns std::nullopt if source control has nothing at that path.
+ */
+Future<std::optional<TreeEntry>> findScmEntry(
+    ObjectStore* store,
+    std::shared_ptr<const Tree> tree,
+    std::vector<PathComponent> components,
+    size_t index) {
+  const auto* entry = tree->getEntryPtr(components[index]);
+  if (!entry) {
+    return std::optional<TreeEntry>{};
+  }
+  if (index + 1 == components.size()) {
+    return std::optional<TreeEntry>{*entry};
+  }
+  if (!entry->isTree()) {
+    return std::optional<TreeEntry>{};
+  }
+  return store->getTree(entry->getHash(), ObjectFetchContext::getNullContext())
+      .thenValue([store, components = std::move(components), index](
+                     std::shared_ptr<const Tree>&& subtree) mutable {
+        return findScmEntry(
+            store, std::move(subtree), std::move(components), index + 1);
+      });
+}
+
+/**
+ * Compute what the status of path is now, assuming the caller has already
+ * ruled out .gitignore files and paths with cached entries below them.
+ */
+Future<PathStatusUpdate> getPathStatus(
+    const EdenMount* mount,
+    std::shared_ptr<const Tree> rootTree,
+    RelativePathPiece path,
+    std::optional<ScmFileStatus> cachedStatus) {
+  std::vector<PathComponent> components;
+  for (auto component : path.components()) {
+    components.emplace_back(component);
+  }
+  auto scmFuture = findScmEntry(
+      mount->getObjectStore(), std::move(rootTree), std::move(components), 0);
+  auto inodeFuture = mount->getInode(path).thenTry([](Try<InodePtr>&& inode) {
+    if (inode.hasException()) {
+      auto* err = inode.tryGetExceptionObject<std::system_error>();
+      if (err && isErrnoError(*err) &&
+          (err->code().value() == ENOENT || err->code().value() == ENOTDIR)) {
+        return InodePtr{};
+      }
+    }
+    return std::move(inode).value();
+  });
+
+  return collectSafe(scmFuture, inodeFuture)
+      .thenValue([cachedStatus](
+                     std::tuple<std::optional<TreeEntry>, InodePtr>&& tup)
+                     -> Future<PathStatusUpdate> {
+        auto& [scmEntry, inode] = tup;
+        if ((scmEntry && scmEntry->isTree()) ||
+            (inode && inode.asTreePtrOrNull())) {
+          return PathStatusUpdate{PathStatusUpdate::NEEDS_FULL_DIFF};
+        }
+        if (!inode) {
+          if (scmEntry) {
+            return PathStatusUpdate{
+                PathStatusUpdate::CHANGED, ScmFileStatus::REMOVED};
+          }
+          return PathStatusUpdate{PathStatusUpdate::CLEAN};
+        }
+        if (!scmEntry) {
+          // Whether an untracked file is added or ignored depends on the
+          // ignore rules, which have not changed since the cached status was
+          // computed.  A path the cached status did not know about needs
+          // them evaluated.
+          if (cachedStatus == ScmFileStatus::ADDED ||
+              cachedStatus == ScmFileStatus::IGNORED) {
+            return PathStatusUpdate{PathStatusUpdate::CHANGED, *cachedStatus};
+          }
+          return PathStatusUpdate{PathStatusUpdate::NEEDS_FULL_DIFF};
+        }
+        return inode.asFilePtr()
+            ->isSameAs(
+                scmEntry->getHash(),
+                scmEntry->getType(),
+                ObjectFetchContext::getNullContext())
+            .thenValue([](bool isSame) {
+              return isSame ? PathStatusUpdate{PathStatusUpdate::CLEAN}
+                            : PathStatusUpdate{PathStatusUpdate::CHANGED,
+                                               ScmFileStatus::MODIFIED};
+            });
+      })
+      .thenError([path = path.copy()](const folly::exception_wrapper& ew) {
+        XLOG(DBG3) << "unable to update cached status for " << path << ": "
+                   << folly::exceptionStr(ew);
+        return PathStatusUpdate{PathStatusUpdate::NEEDS_FULL_DIFF};
+      });
+}
+
+/**
+ * Prefetches the paths from begin onwards, one batch at a time, and stops
+ * starting new batches once deadline has passed.  Returns the number of
+ * blobs that were prefetched.
+ */
+folly::Future<uint64_t> prefetchPathsUntil(
+    std::shared_ptr<ObjectStore> store,
+    std::shared_ptr<const Tree> tree,
+    std::shared_ptr<const std::vector<RelativePath>> paths,
+    size_t begin,
+    size_t batchSize,
+    std::chrono::steady_clock::time_point deadline) {
+  batchSize = std::max<size_t>(batchSize, 1);
+  if (begin >= paths->size() || std::chrono::steady_clock::now() >= deadline) {
+    return uint64_t{0};
+  }
+  auto end = std::min(paths->size(), begin + batchSize);
+  std::vector<RelativePath> batch(
+      paths->begin() + begin, paths->begin() + end);
+  return prefetchPaths(
+             store.get(),
+             ObjectFetchContext::getNullContext(),
+             tree,
+             batch,
+             batchSize,
+             ImportPriority::kLow())
+      .thenValue([store, tree, paths, end, batchSize, deadline](
+                     uint64_t numBlobs) {
+        return prefetchPathsUntil(
+                   store, tree, paths, end, batchSize, deadline)
+            .thenValue([numBlobs](uint64_t rest) { return numBlobs + rest; });
+      });
+}
 } // namespace
 
 /**
@@ -205,16 +369,28 @@ EdenMount::EdenMount(
       objectStore_{std::move(objectStore)},
       blobCache_{std::move(blobCache)},
       blobAccess_{objectStore_, blobCache_},
+#ifdef _WIN32
       overlay_{Overlay::create(config_->getOverlayPath())},
-#ifndef _WIN32
+#else
+      overlay_{Overlay::create(
+          config_->getOverlayPath(),
+          config_->getOverlayType() == "sqlite"
+              ? FsOverlay::DirStorage::Sqlite
+              : FsOverlay::DirStorage::Files)},
       overlayFileAccess_{overlay_.get()},
 #endif
       journal_{std::move(journal)},
-      mountGeneration_{globalProcessGeneration | ++mountGeneration},
+      mountGeneration_{journal_->getRestoredMountGeneration().value_or(
+          globalProcessGeneration | ++mountGeneration)},
       straceLogger_{kEdenStracePrefix.str() + config_->getMountPath().value()},
       lastCheckoutTime_{serverState_->getClock()->getRealtime()},
       owner_{Owner{getuid(), getgid()}},
+      checkoutProfile_{
+          config_->getClientDirectory() + "checkout-profile"_pc,
+          serverState_->getProcessNameCache()},
+      workingSet_{config_->getClientDirectory() + "working-set"_pc},
       clock_{serverState_->getClock()} {
+  journal_->setLogMountGeneration(mountGeneration_);
 }
 
 #ifdef _WIN32
@@ -222,30 +398,38 @@ FOLLY_NODISCARD folly::Future<folly::Unit> EdenMount::initialize(
     std::unique_ptr<FsChannel>&& fsChannel) {
   const bool takeover = false;
   fsChannel_ = std::move(fsChannel);
+  // The Windows overlay is never checked, so there is no progress to report.
+  Overlay::FsckProgressCallback fsckProgressCallback;
 
 #else
 FOLLY_NODISCARD folly::Future<folly::Unit> EdenMount::initialize(
-    const std::optional<SerializedInodeMap>& takeover) {
+    const std::optional<SerializedInodeMap>& takeover,
+    std::function<void(uint32_t percentComplete)> fsckProgressCallback) {
 #endif
   transitionState(State::UNINITIALIZED, State::INITIALIZING);
 
   return serverState_->getFaultInjector()
       .checkAsync("mount", getPath().stringPiece())
       .via(serverState_->getThreadPool().get())
-      .thenValue([this](auto&&) {
+      .thenValue([this, fsckProgressCallback = std::move(fsckProgressCallback)](
+                     auto&&) mutable {
         auto parents = config_->getParentCommits();
         parentInfo_.wlock()->parents.setParents(parents);
 
         // Record the transition from no snapshot to the current snapshot in
         // the journal.  This also sets things up so that we can carry the
-        // snapshot id forward through subsequent journal entries.
-        journal_->recordHashUpdate(parents.parent1());
+        // snapshot id forward through subsequent journal entries.  A journal
+        // replayed from disk may already be on this snapshot.
+        auto latest = journal_->getLatest();
+        if (!latest || latest->toHash != parents.parent1()) {
+          journal_->recordHashUpdate(parents.parent1());
+        }
 
         // Initialize the overlay.
         // This must be performed before we do any operations that may allocate
         // inode numbers, including creating the root TreeInode.
-        return overlay_->initialize().deferValue(
-            [parents](auto&&) { return parents; });
+        return overlay_->initialize(std::move(fsckProgressCallback))
+            .deferValue([parents](auto&&) { return parents; });
       })
       .thenValue(
           [this](ParentCommits&& parents) { return createRootInode(parents); })
@@ -607,6 +791,15 @@ folly::SemiFuture<SerializedInodeMap> EdenMount::shutdownImpl(bool doTakeover) {
   journal_->cancelAllSubscribers();
   XLOG(DBG1) << "beginning shutdown for EdenMount " << getPath();
 
+  auto warmRestartMaxPaths =
+      serverState_->getEdenConfig()->warmRestartMaxPaths.getValue();
+  if (warmRestartMaxPaths > 0) {
+    if (auto root = getRootInode()) {
+      workingSet_.save(
+          WorkingSet::collectLoadedPaths(root, warmRestartMaxPaths));
+    }
+  }
+
   return inodeMap_->shutdown(doTakeover)
       .thenValue([this](SerializedInodeMap inodeMap) {
         XLOG(DBG1) << "shutdown complete for EdenMount " << getPath();
@@ -616,6 +809,10 @@ folly::SemiFuture<SerializedInodeMap> EdenMount::shutdownImpl(bool doTakeover) {
         // the mount point.
         overlay_->close();
         XLOG(DBG1) << "successfully closed overlay at " << getPath();
+        // Likewise release the on-disk journal, if any, so that the new
+        // process can replay it.
+        journal_->closeLog();
+        checkoutProfile_.save();
         auto oldState =
             state_.exchange(State::SHUT_DOWN, std::memory_order_acq_rel);
         if (oldState == State::DESTROYING) {
@@ -811,6 +1008,109 @@ folly::Future<InodePtr> EdenMount::resolveSymlinkImpl(
 }
 #endif
 
+void EdenMount::prefetchWorkingSet() {
+  auto config = serverState_->getEdenConfig();
+  if (config->warmRestartMaxPaths.getValue() == 0) {
+    return;
+  }
+  auto paths =
+      std::make_shared<const std::vector<RelativePath>>(workingSet_.load());
+  if (paths->empty()) {
+    return;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      config->warmRestartTimeBudget.getValue());
+  auto batchSize = config->checkoutPrefetchBatchSize.getValue();
+  folly::stop_watch<std::chrono::milliseconds> watch;
+  getRootTree()
+      .thenValue([store = objectStore_, paths, batchSize, deadline](
+                     std::shared_ptr<const Tree> tree) {
+        return prefetchPathsUntil(
+            store, std::move(tree), paths, 0, batchSize, deadline);
+      })
+      .thenValue([path = getPath(), numPaths = paths->size(), watch](
+                     uint64_t numBlobs) {
+        XLOG(DBG2) << path << " prefetched " << numBlobs << " blobs for the "
+                   << numPaths << " paths it had loaded before restarting in "
+                   << watch.elapsed().count() << "ms";
+      })
+      .thenError([path = getPath()](const folly::exception_wrapper& ew) {
+        XLOG(WARN) << "working set prefetch failed for " << path << ": "
+                   << folly::exceptionStr(ew);
+      });
+}
+
+void EdenMount::prefetchForCheckout(
+    CheckoutContext* ctx,
+    const std::shared_ptr<const Tree>& fromTree,
+    const std::shared_ptr<const Tree>& toTree) {
+  auto config = serverState_->getEdenConfig();
+  auto profileWindow = config->checkoutProfileWindow.getValue();
+  if (profileWindow.count() > 0) {
+    auto paths = checkoutProfile_.startRecording(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            profileWindow),
+        config->checkoutProfileMaxPaths.getValue());
+#ifdef _WIN32
+    // The directories of the profiled files are likely to be read right after
+    // checkout, so their placeholders are written ahead of time.
+    ctx->setHotDirectories(paths);
+#endif
+    // The profile prefetch only fetches the trees leading to the profiled
+    // files, so checkout does not wait for it.
+    prefetchPaths(
+        objectStore_.get(),
+        ObjectFetchContext::getNullContext(),
+        toTree,
+        paths,
+        config->checkoutPrefetchBatchSize.getValue(),
+        ImportPriority::kLow())
+        .thenValue([path = getPath(), store = objectStore_](
+                       uint64_t numBlobs) {
+          XLOG(DBG2) << "checkout of " << path << " prefetching " << numBlobs
+                     << " blobs from its checkout profile";
+        })
+        .thenError([path = getPath()](const folly::exception_wrapper& ew) {
+          XLOG(WARN) << "checkout profile prefetch failed for " << path
+                     << ": " << folly::exceptionStr(ew);
+        });
+  }
+
+  if (!config->checkoutPrefetch.getValue()) {
+    return;
+  }
+
+  // Checkout replaces the hashes of entries without inodes without fetching
+  // anything, so only the objects along the paths it will visit are worth
+  // prefetching.
+  std::vector<RelativePath> paths;
+  getRootInode()->getCheckoutPaths(RelativePathPiece{}, paths);
+
+  // The walk runs alongside checkout, which may finish first, so it uses the
+  // null fetch context and keeps the ObjectStore alive.
+  folly::stop_watch<std::chrono::milliseconds> watch;
+  prefetchTreeDifferences(
+      objectStore_.get(),
+      ObjectFetchContext::getNullContext(),
+      fromTree,
+      toTree,
+      paths,
+      config->checkoutPrefetchBatchSize.getValue(),
+      ImportPriority::kLow())
+      .thenValue([path = getPath(), store = objectStore_, watch](
+                     uint64_t numBlobs) {
+        XLOG(DBG2) << "checkout of " << path << " planned prefetch of "
+                   << numBlobs << " blobs in " << watch.elapsed().count()
+                   << "ms";
+      })
+      .thenError([path = getPath()](const folly::exception_wrapper& ew) {
+        XLOG(WARN) << "checkout prefetch failed for " << path << ": "
+                   << folly::exceptionStr(ew);
+      });
+}
+
 folly::Future<CheckoutResult> EdenMount::checkout(
     Hash snapshotHash,
     CheckoutMode checkoutMode) {
@@ -879,6 +1179,12 @@ folly::Future<CheckoutResult> EdenMount::checkout(
           return folly::makeFuture(treeResults);
         }
 
+        // Start fetching what checkout will need while the journal diff
+        // runs, so the backing store sees a few large requests instead of
+        // one request per entry that checkout touches.
+        prefetchForCheckout(
+            ctx.get(), std::get<0>(treeResults), std::get<1>(treeResults));
+
         auto& fromTree = std::get<0>(treeResults);
         return journalDiffCallback->performDiff(this, getRootInode(), fromTree)
             .thenValue([ctx, journalDiffCallback, treeResults](
@@ -1023,6 +1329,9 @@ folly::Future<folly::Unit> EdenMount::chown(uid_t uid, gid_t gid) {
     record.uid = uid;
     record.gid = gid;
   });
+  // Start writing the rewritten table back now rather than leaving every
+  // page of it dirty until the kernel gets around to it.
+  metadata->sync(/*wait=*/false);
 
   // Note that any files being created at this point are not
   // guaranteed to have the requested uid/gid, but that racyness is
@@ -1048,6 +1357,46 @@ function starts at the root of the tree, and will follow the path and resolve
 symlinks and will load inodes as needed in order to load the contents of the
 file.
 */
+size_t EdenMount::estimateInodeMemoryUsage() const {
+  auto counts = inodeMap_->getInodeCounts();
+  return counts.fileCount * kApproxFileInodeBytes +
+      counts.treeCount * kApproxTreeInodeBytes;
+}
+
+#ifndef _WIN32
+size_t EdenMount::unloadInodesOverBudget(size_t budgetBytes) {
+  // Anything looked up from here on is newer than everything examined below.
+  auto epoch = inodeAccessEpoch_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+  auto usage = estimateInodeMemoryUsage();
+  if (usage <= budgetBytes) {
+    return 0;
+  }
+
+  // Unload the inodes that have been idle longest first, and only move on to
+  // more recently used ones while still over budget.  The last pass keeps
+  // only the inodes used during the previous interval.
+  auto rootInode = getRootInode();
+  size_t unloaded = 0;
+  for (uint32_t idleEpochs : {16, 8, 4, 2, 1}) {
+    if (idleEpochs > epoch) {
+      continue;
+    }
+    unloaded +=
+        rootInode->unloadChildrenAccessedBeforeEpoch(epoch - idleEpochs);
+    usage = estimateInodeMemoryUsage();
+    if (usage <= budgetBytes) {
+      break;
+    }
+  }
+
+  XLOG(DBG2) << "unloaded " << unloaded << " inodes from " << getPath()
+             << " to meet its inode memory budget; now using about " << usage
+             << " of " << budgetBytes << " bytes";
+  return unloaded;
+}
+#endif // !_WIN32
+
 std::unique_ptr<DiffContext> EdenMount::createDiffContext(
     DiffCallback* callback,
     bool listIgnored,
@@ -1061,13 +1410,17 @@ std::unique_ptr<DiffContext> EdenMount::createDiffContext(
     return loadFileContentsFromPath(
         fetchContext, path, CacheHint::LikelyNeededAgain);
   };
+  auto fanOut = serverState_->getEdenConfig()->statusDiffFanOut.getValue();
   return make_unique<DiffContext>(
       callback,
       listIgnored,
       getObjectStore(),
       serverState_->getTopLevelIgnores(),
       std::move(loadContents),
-      request);
+      request,
+      fanOut > 0 ? serverState_->getThreadPool().get() : nullptr,
+      fanOut,
+      &gitIgnoreCache_);
 }
 
 Future<Unit> EdenMount::diff(DiffContext* ctxPtr, Hash commitHash) const {
@@ -1091,32 +1444,10 @@ Future<Unit> EdenMount::diff(
     bool enforceCurrentParent,
     ResponseChannelRequest* request) const {
   if (enforceCurrentParent) {
-    auto parentInfo = parentInfo_.rlock(std::chrono::milliseconds{500});
-
-    if (!parentInfo) {
-      // We failed to get the lock, which generally means a checkout is in
-      // progress.
-      return makeFuture<Unit>(newEdenError(
-          EdenErrorType::CHECKOUT_IN_PROGRESS,
-          "cannot compute status while a checkout is currently in progress"));
+    auto parentCheck = checkCurrentParent(commitHash);
+    if (parentCheck.hasException()) {
+      return makeFuture<Unit>(std::move(parentCheck).exception());
     }
-
-    if (parentInfo->parents.parent1() != commitHash) {
-      // Log this occurrence to Scuba
-      getServerState()->getStructuredLogger()->logEvent(ParentMismatch{
-          commitHash.toString(), parentInfo->parents.parent1().toString()});
-      return makeFuture<Unit>(newEdenError(
-          EdenErrorType::OUT_OF_DATE_PARENT,
-          "error computing status: requested parent commit is out-of-date: requested ",
-          commitHash,
-          ", but current parent commit is ",
-          parentInfo->parents.parent1(),
-          ".\nTry running `eden doctor` to remediate"));
-    }
-
-    // TODO: Should we perhaps hold the parentInfo read-lock for the duration
-    // of the status operation?  This would block new checkout operations from
-    // starting until we have finished computing this status call.
   }
 
   // Create a DiffContext object for this diff operation.
@@ -1130,11 +1461,176 @@ Future<Unit> EdenMount::diff(
   return diff(ctxPtr, commitHash).ensure(std::move(stateHolder));
 }
 
+Try<Unit> EdenMount::checkCurrentParent(const Hash& commitHash) const {
+  auto parentInfo = parentInfo_.rlock(std::chrono::milliseconds{500});
+
+  if (!parentInfo) {
+    // We failed to get the lock, which generally means a checkout is in
+    // progress.
+    return Try<Unit>(newEdenError(
+        EdenErrorType::CHECKOUT_IN_PROGRESS,
+        "cannot compute status while a checkout is currently in progress"));
+  }
+
+  if (parentInfo->parents.parent1() != commitHash) {
+    // Log this occurrence to Scuba
+    getServerState()->getStructuredLogger()->logEvent(ParentMismatch{
+        commitHash.toString(), parentInfo->parents.parent1().toString()});
+    return Try<Unit>(newEdenError(
+        EdenErrorType::OUT_OF_DATE_PARENT,
+        "error computing status: requested parent commit is out-of-date: requested ",
+        commitHash,
+        ", but current parent commit is ",
+        parentInfo->parents.parent1(),
+        ".\nTry running `eden doctor` to remediate"));
+  }
+
+  // TODO: Should we perhaps hold the parentInfo read-lock for the duration
+  // of the status operation?  This would block new checkout operations from
+  // starting until we have finished computing this status call.
+  return Try<Unit>{folly::unit};
+}
+
 folly::Future<std::unique_ptr<ScmStatus>> EdenMount::diff(
     Hash commitHash,
     bool listIgnored,
     bool enforceCurrentParent,
     ResponseChannelRequest* request) {
+  if (!serverState_->getEdenConfig()->statusCache.getValue()) {
+    // Don't hold on to a result cached before the cache was turned off.
+    statusCache_.clear();
+    return diffForStatus(
+        commitHash, listIgnored, enforceCurrentParent, request);
+  }
+
+  if (enforceCurrentParent) {
+    auto parentCheck = checkCurrentParent(commitHash);
+    if (parentCheck.hasException()) {
+      return makeFuture<std::unique_ptr<ScmStatus>>(
+          std::move(parentCheck).exception());
+    }
+  }
+
+  // Read the journal position before looking at the working copy, so that
+  // anything that changes while we compute the status is picked up next time.
+  auto latest = journal_->getLatest();
+  auto sequence = latest ? latest->sequenceID : 0;
+
+  auto cached = statusCache_.get(commitHash, listIgnored);
+  if (!cached) {
+    return diffAndCacheStatus(commitHash, listIgnored, sequence, request);
+  }
+  if (cached->sequence == sequence) {
+    return make_unique<ScmStatus>(std::move(cached->status));
+  }
+  return updateCachedStatus(std::move(*cached), sequence, request);
+}
+
+Future<std::unique_ptr<ScmStatus>> EdenMount::diffAndCacheStatus(
+    Hash commitHash,
+    bool listIgnored,
+    JournalDelta::SequenceNumber sequence,
+    ResponseChannelRequest* request) {
+  return diffForStatus(
+             commitHash, listIgnored, /*enforceCurrentParent=*/false, request)
+      .thenValue([this, commitHash, listIgnored, sequence](
+                     std::unique_ptr<ScmStatus>&& status) {
+        // A status with errors may be incomplete, so it would not be safe to
+        // update incrementally.
+        if (status->errors.empty()) {
+          statusCache_.insert({commitHash, listIgnored, sequence, *status});
+        }
+        return std::move(status);
+      });
+}
+
+Future<std::unique_ptr<ScmStatus>> EdenMount::updateCachedStatus(
+    ScmStatusCache::Entry cached,
+    JournalDelta::SequenceNumber sequence,
+    ResponseChannelRequest* request) {
+  auto range = journal_->accumulateRange(cached.sequence + 1);
+  if (!range) {
+    cached.sequence = sequence;
+    auto status = make_unique<ScmStatus>(cached.status);
+    statusCache_.insert(std::move(cached));
+    return status;
+  }
+
+  // Checkouts and resets record unclean paths rather than every file they
+  // touched, so anything but plain file changes needs a full diff.
+  auto maxPaths = serverState_->getEdenConfig()
+                      ->statusCacheMaxIncrementalPaths.getValue();
+  bool needsFullDiff = range->isTruncated || range->containsHashUpdates ||
+      !range->uncleanPaths.empty() ||
+      range->changedFilesInOverlay.size() > maxPaths;
+  std::vector<RelativePath> paths;
+  std::vector<std::optional<ScmFileStatus>> cachedStatuses;
+  if (!needsFullDiff) {
+    paths.reserve(range->changedFilesInOverlay.size());
+    cachedStatuses.reserve(range->changedFilesInOverlay.size());
+    for (const auto& entry : range->changedFilesInOverlay) {
+      const auto& path = entry.first;
+      if (path.basename() == kIgnoreFilename ||
+          ScmStatusCache::hasEntriesUnder(cached.status, path)) {
+        needsFullDiff = true;
+        break;
+      }
+      paths.push_back(path);
+      auto* cachedStatus =
+          folly::get_ptr(cached.status.entries, path.stringPiece().str());
+      cachedStatuses.push_back(
+          cachedStatus ? std::make_optional(*cachedStatus) : std::nullopt);
+    }
+  }
+  if (needsFullDiff) {
+    return diffAndCacheStatus(
+        cached.commitHash, cached.listIgnored, sequence, request);
+  }
+
+  XLOG(DBG4) << "updating cached status for " << getPath() << " with "
+             << paths.size() << " changed paths";
+  auto commitHash = cached.commitHash;
+  return objectStore_
+      ->getTreeForCommit(commitHash, ObjectFetchContext::getNullContext())
+      .thenValue([this, paths, cachedStatuses = std::move(cachedStatuses)](
+                     std::shared_ptr<const Tree>&& rootTree) {
+        std::vector<Future<PathStatusUpdate>> futures;
+        futures.reserve(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i) {
+          futures.push_back(
+              getPathStatus(this, rootTree, paths[i], cachedStatuses[i]));
+        }
+        return folly::collect(futures);
+      })
+      .thenValue([this, paths, cached = std::move(cached), sequence, request](
+                     std::vector<PathStatusUpdate>&& updates) mutable
+                 -> Future<std::unique_ptr<ScmStatus>> {
+        for (size_t i = 0; i < paths.size(); ++i) {
+          auto pathString = paths[i].stringPiece().str();
+          switch (updates[i].kind) {
+            case PathStatusUpdate::CLEAN:
+              cached.status.entries.erase(pathString);
+              break;
+            case PathStatusUpdate::CHANGED:
+              cached.status.entries[pathString] = updates[i].status;
+              break;
+            case PathStatusUpdate::NEEDS_FULL_DIFF:
+              return diffAndCacheStatus(
+                  cached.commitHash, cached.listIgnored, sequence, request);
+          }
+        }
+        cached.sequence = sequence;
+        auto status = make_unique<ScmStatus>(cached.status);
+        statusCache_.insert(std::move(cached));
+        return std::move(status);
+      });
+}
+
+Future<std::unique_ptr<ScmStatus>> EdenMount::diffForStatus(
+    Hash commitHash,
+    bool listIgnored,
+    bool enforceCurrentParent,
+    ResponseChannelRequest* request) {
   auto callback = std::make_unique<ScmStatusDiffCallback>();
   auto callbackPtr = callback.get();
   return this
@@ -1198,6 +1694,8 @@ std::string EdenMount::getCounterName(CounterName name) {
       return folly::to<std::string>("journal.", base, ".duration_secs");
     case CounterName::JOURNAL_MAX_FILES_ACCUMULATED:
       return folly::to<std::string>("journal.", base, ".files_accumulated.max");
+    case CounterName::OVERLAY_GC_QUEUE_DEPTH:
+      return folly::to<std::string>("overlay.", base, ".gc_queue_depth");
   }
   EDEN_BUG() << "unknown counter name "
              << static_cast<std::underlying_type_t<CounterName>>(name);
@@ -1314,6 +1812,7 @@ folly::Promise<folly::Unit>& EdenMount::beginMount() {
 }
 
 void EdenMount::createFuseChannel(folly::File fuseDevice) {
+  auto edenConfig = serverState_->getReloadableConfig().getEdenConfig();
   channel_.reset(new FuseChannel(
       std::move(fuseDevice),
       getPath(),
@@ -1321,10 +1820,34 @@ void EdenMount::createFuseChannel(folly::File fuseDevice) {
       dispatcher_.get(),
       serverState_->getProcessNameCache(),
       std::chrono::duration_cast<folly::Duration>(
-          serverState_->getReloadableConfig()
-              .getEdenConfig()
-              ->fuseRequestTimeout.getValue()),
-      serverState_->getNotifications()));
+          edenConfig->fuseRequestTimeout.getValue()),
+      serverState_->getNotifications(),
+      edenConfig->fuseSpliceReadReplies.getValue(),
+      edenConfig->fuseUseIoUring.getValue(),
+      edenConfig->fuseCloneDevicePerWorker.getValue(),
+      edenConfig->fuseReaddirplus.getValue(),
+      edenConfig->fuseMaxWriteSize.getValue(),
+      edenConfig->fuseMinThreads.getValue(),
+      edenConfig->fuseMaxThreads.getValue()));
+
+  const auto& traceDir = edenConfig->fuseRequestTraceDir.getValue();
+  if (!traceDir.empty()) {
+    try {
+      // Mounts with the same basename are told apart by a hash of the
+      // whole mount path.
+      auto mountPath = getPath().stringPiece();
+      auto tracePath = AbsolutePath{traceDir} +
+          PathComponent{folly::sformat(
+              "{}.{:016x}.{}.fusetrace",
+              getPath().basename(),
+              folly::hash::fnv64_buf(mountPath.data(), mountPath.size()),
+              getpid())};
+      channel_->startRequestTrace(tracePath);
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "unable to start FUSE request trace for " << getPath()
+                << ": " << folly::exceptionStr(ex);
+    }
+  }
 }
 
 void EdenMount::fuseInitSuccessful(
@@ -16,15 +16,21 @@
 #include <folly/futures/SharedPromise.h>
 #include <folly/logging/Logger.h>
 #include <chrono>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <shared_mutex>
 #include <stdexcept>
 #include "eden/fs/inodes/CacheHint.h"
+#include "eden/fs/inodes/CheckoutProfile.h"
 #include "eden/fs/inodes/InodePtrFwd.h"
+#include "eden/fs/inodes/ScmStatusCache.h"
+#include "eden/fs/inodes/TreePrefetchPolicy.h"
+#include "eden/fs/inodes/WorkingSet.h"
 #include "eden/fs/journal/Journal.h"
 #include "eden/fs/model/ParentCommits.h"
+#include "eden/fs/model/git/GitIgnoreCache.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
 #include "eden/fs/store/BlobAccess.h"
 #include "eden/fs/utils/PathFuncs.h"
@@ -64,6 +70,7 @@ class BindMount;
 class BlobCache;
 class CheckoutConfig;
 class CheckoutConflict;
+class CheckoutContext;
 class Clock;
 class DiffContext;
 class EdenDispatcher;
@@ -114,7 +121,12 @@ enum class CounterName {
   /**
    * Represents the maximum deltas iterated over in the Journal's forEachDelta
    */
-  JOURNAL_MAX_FILES_ACCUMULATED
+  JOURNAL_MAX_FILES_ACCUMULATED,
+  /**
+   * Represents the number of unreferenced directories waiting for their
+   * overlay data to be removed
+   */
+  OVERLAY_GC_QUEUE_DEPTH
 };
 
 /**
@@ -174,10 +186,15 @@ class EdenMount {
    * Asynchronous EdenMount initialization - post instantiation.
    *
    * If takeover data is specified, it is used to initialize the inode map.
+   *
+   * If the overlay was not shut down cleanly it is checked for errors, and
+   * fsckProgressCallback is called with the percentage of it scanned so far.
    */
 #ifndef _WIN32
   FOLLY_NODISCARD folly::Future<folly::Unit> initialize(
-      const std::optional<SerializedInodeMap>& takeover = std::nullopt);
+      const std::optional<SerializedInodeMap>& takeover = std::nullopt,
+      std::function<void(uint32_t percentComplete)> fsckProgressCallback =
+          nullptr);
 #else
   FOLLY_NODISCARD folly::Future<folly::Unit> initialize(
       std::unique_ptr<FsChannel>&& fsChannel);
@@ -342,6 +359,33 @@ class EdenMount {
     return inodeMap_.get();
   }
 
+  /**
+   * The current inode access epoch.
+   *
+   * Inodes remember the epoch in which they were last looked up.  The epoch
+   * advances each time unloadInodesOverBudget() runs, so the gap between an
+   * inode's epoch and this one approximates how long it has been idle.
+   */
+  uint32_t getInodeAccessEpoch() const {
+    return inodeAccessEpoch_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Approximate bytes used by this mount's loaded inode objects.
+   */
+  size_t estimateInodeMemoryUsage() const;
+
+#ifndef _WIN32
+  /**
+   * Start a new inode access epoch and, if the loaded inodes are estimated to
+   * use more than budgetBytes, unload unreferenced and unmaterialized inodes,
+   * least recently used first, until they fit or nothing idle remains.
+   *
+   * Returns the number of inodes unloaded.
+   */
+  size_t unloadInodesOverBudget(size_t budgetBytes);
+#endif // !_WIN32
+
   /**
    * Return the Overlay for this mount.
    */
@@ -475,6 +519,9 @@ class EdenMount {
    * Compute differences between the current commit and the working directory
    * state.
    *
+   * When status:cache is enabled the result of the previous call is reused
+   * and only the paths recorded in the journal since then are re-checked.
+   *
    * @param listIgnored Whether or not to inform the callback of ignored files.
    *     When listIgnored is set to false can speed up the diff computation, as
    *     the code does not need to descend into ignored directories at all.
@@ -533,6 +580,24 @@ class EdenMount {
    */
   SharedRenameLock acquireSharedRenameLock();
 
+  /**
+   * Returns a counter that changes whenever a directory in this mount is
+   * renamed or unlinked, which is when cached directory paths may go stale.
+   * Renaming or unlinking a file leaves it unchanged, since the paths of files
+   * are not cached.
+   */
+  uint64_t getPathGeneration() const {
+    return pathGeneration_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Invalidates all cached directory paths.  Must be called while holding
+   * the rename lock, after updating a directory's location.
+   */
+  void bumpPathGeneration() {
+    pathGeneration_.fetch_add(1, std::memory_order_acq_rel);
+  }
+
   /**
    * Returns a pointer to a stats instance associated with this mountpoint.
    * Today this is the global stats instance, but in the future it will be
@@ -674,6 +739,29 @@ class EdenMount {
   FOLLY_NODISCARD std::optional<TreePrefetchLease> tryStartTreePrefetch(
       TreeInodePtr treeInode);
 
+  /**
+   * The hit rates of earlier readdir() prefetches, which decide how much the
+   * next ones load if store:adaptive-tree-prefetch is set.
+   */
+  TreePrefetchPolicy& getTreePrefetchPolicy() {
+    return treePrefetchPolicy_;
+  }
+
+  /**
+   * The files loaded shortly after recent checkouts, which the next checkout
+   * prefetches if checkout:profile-window is set.
+   */
+  CheckoutProfile& getCheckoutProfile() {
+    return checkoutProfile_;
+  }
+
+  /**
+   * If mount:warm-restart-max-paths is set, starts low priority prefetches
+   * of the files and directories that were loaded when this mount was last
+   * shut down, until mount:warm-restart-time-budget has passed.
+   */
+  void prefetchWorkingSet();
+
 #ifdef _WIN32
   /**
    * The following functions are to start and stop Eden Mount on Windows. They
@@ -812,6 +900,19 @@ class EdenMount {
 
   folly::SemiFuture<SerializedInodeMap> shutdownImpl(bool doTakeover);
 
+  /**
+   * If checkout:prefetch is enabled, start fetching the trees that differ
+   * between fromTree and toTree along the paths of loaded and materialized
+   * inodes, and batched prefetches of the blobs of those files that differ.
+   * If checkout:profile-window is set, also start prefetches of the files in
+   * toTree that the checkout profile holds, and start recording a new
+   * profile.  Checkout does not wait for any of these.
+   */
+  void prefetchForCheckout(
+      CheckoutContext* ctx,
+      const std::shared_ptr<const Tree>& fromTree,
+      const std::shared_ptr<const Tree>& toTree);
+
   /**
    * Create a DiffContext to be passed through the TreeInode diff codepath. This
    * will be used to record differences through the callback (in which
@@ -839,6 +940,43 @@ class EdenMount {
       bool enforceCurrentParent,
       apache::thrift::ResponseChannelRequest* FOLLY_NULLABLE request) const;
 
+  /**
+   * Return an error if commitHash is not the current working directory parent
+   * or a checkout is in progress.
+   */
+  folly::Try<folly::Unit> checkCurrentParent(const Hash& commitHash) const;
+
+  /**
+   * Compute the status without consulting the status cache.
+   */
+  FOLLY_NODISCARD folly::Future<std::unique_ptr<ScmStatus>> diffForStatus(
+      Hash commitHash,
+      bool listIgnored,
+      bool enforceCurrentParent,
+      apache::thrift::ResponseChannelRequest* FOLLY_NULLABLE request);
+
+  /**
+   * Compute the full status and remember it as of the given journal sequence
+   * number.
+   */
+  FOLLY_NODISCARD folly::Future<std::unique_ptr<ScmStatus>>
+  diffAndCacheStatus(
+      Hash commitHash,
+      bool listIgnored,
+      JournalDelta::SequenceNumber sequence,
+      apache::thrift::ResponseChannelRequest* FOLLY_NULLABLE request);
+
+  /**
+   * Bring a cached status up to date with the journal by re-checking only
+   * the paths changed since it was computed, falling back to a full diff
+   * when that is not possible.
+   */
+  FOLLY_NODISCARD folly::Future<std::unique_ptr<ScmStatus>>
+  updateCachedStatus(
+      ScmStatusCache::Entry cached,
+      JournalDelta::SequenceNumber sequence,
+      apache::thrift::ResponseChannelRequest* FOLLY_NULLABLE request);
+
 #ifndef _WIN32
   /**
    * Open the FUSE device and mount it using the mount(2) syscall.
@@ -932,6 +1070,12 @@ class EdenMount {
    */
   folly::SharedMutex renameMutex_;
 
+  /**
+   * See getPathGeneration().  This starts at 1 so that a generation of 0
+   * never matches.
+   */
+  std::atomic<uint64_t> pathGeneration_{1};
+
   /**
    * The IDs of the parent commit(s) of the working directory.
    *
@@ -943,6 +1087,26 @@ class EdenMount {
 
   std::unique_ptr<Journal> journal_;
 
+  /**
+   * See getInodeAccessEpoch().
+   */
+  std::atomic<uint32_t> inodeAccessEpoch_{0};
+
+  /**
+   * The last status computed for this mount, when status:cache is enabled.
+   */
+  ScmStatusCache statusCache_;
+
+  /**
+   * The rules parsed from unmodified .gitignore files, keyed by blob hash, so
+   * that status does not re-parse them.  Only updated through the
+   * DiffContexts created by createDiffContext(), hence mutable.  Few
+   * directories have a .gitignore, so this is far below one entry per
+   * directory.
+   */
+  static constexpr size_t kGitIgnoreCacheSize = 4096;
+  mutable GitIgnoreCache gitIgnoreCache_{kGitIgnoreCacheSize};
+
   /**
    * A number to uniquely identify this particular incarnation of this mount.
    * We use bits from the process id and the time at which we were mounted.
@@ -1037,6 +1201,15 @@ class EdenMount {
    */
   std::atomic<uint64_t> numPrefetchesInProgress_{0};
 
+  TreePrefetchPolicy treePrefetchPolicy_;
+
+  CheckoutProfile checkoutProfile_;
+
+  /**
+   * The unmaterialized inodes that were loaded when the mount was shut down.
+   */
+  WorkingSet workingSet_;
+
 #ifdef _WIN32
   /**
    * This is the channel between ProjectedFS and rest of Eden.
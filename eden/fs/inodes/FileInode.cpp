@@ -11,12 +11,15 @@
 #include <folly/io/IOBuf.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/logging/xlog.h>
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/InodeError.h"
+#include "eden/fs/inodes/ServerState.h"
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/store/BlobMetadata.h"
+#include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/ObjectStore.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/Clock.h"
@@ -26,6 +29,8 @@
 #include "eden/fs/utils/UnboundedQueueExecutor.h"
 
 #ifndef _WIN32
+#include "eden/fs/fuse/FuseChannel.h"
+#include "eden/fs/fuse/RequestData.h"
 #include "eden/fs/inodes/InodeTable.h"
 #include "eden/fs/inodes/Overlay.h"
 #include "eden/fs/store/BlobAccess.h"
@@ -122,8 +127,10 @@ std::shared_ptr<const Blob> FileInode::LockedState::getCachedBlob(
       << "getCachedBlob can only be called when not materialized";
 
   // Is the previous handle still valid? If so, return it.
-  if (auto blob = ptr_->interestHandle.getBlob()) {
-    return blob;
+  if (ptr_->loadState) {
+    if (auto blob = ptr_->loadState->interestHandle.getBlob()) {
+      return blob;
+    }
   }
   // Otherwise, does the cache have one?
   //
@@ -132,18 +139,15 @@ std::shared_ptr<const Blob> FileInode::LockedState::getCachedBlob(
   // BLOB_LOADING and back, and also avoid allocating some futures and closures.
   auto result = mount->getBlobCache()->get(ptr_->hash.value(), interest);
   if (result.blob) {
-    ptr_->interestHandle = std::move(result.interestHandle);
+    ptr_->getLoadState().interestHandle = std::move(result.interestHandle);
     return std::move(result.blob);
   }
 
   // If we received a read and missed cache because the blob was
   // already evicted, assume the existing readByteRanges CoverageSet
   // doesn't accurately reflect how much data is in the kernel's
-  // caches.
-  ptr_->interestHandle.reset();
-#ifndef _WIN32
-  ptr_->readByteRanges.clear();
-#endif // !_WIN32
+  // caches.  We are not loading, so that leaves nothing in the load state.
+  ptr_->loadState.reset();
 
   return nullptr;
 }
@@ -152,11 +156,16 @@ void FileInode::LockedState::setMaterialized() {
   ptr_->hash.reset();
   ptr_->tag = State::MATERIALIZED_IN_OVERLAY;
 
-  ptr_->interestHandle.reset();
-
+  // If a load is in progress the caller is responsible for extracting and
+  // fulfilling blobLoadingPromise, which frees the rest of the load state.
+  if (ptr_->isLoading()) {
+    ptr_->loadState->interestHandle.reset();
 #ifndef _WIN32
-  ptr_->readByteRanges.clear();
+    ptr_->loadState->readByteRanges.clear();
 #endif
+  } else {
+    ptr_->loadState.reset();
+  }
 }
 
 /*********************************************************************
@@ -187,11 +196,20 @@ ReturnType FileInode::runWhileDataLoaded(
       } else {
         future = startLoadingData(
             std::move(state), interest, fetchContext, priority);
+        if (future.isReady() && future.hasValue()) {
+          return runWhileDataLoaded<ReturnType>(
+              LockedState{this},
+              interest,
+              fetchContext,
+              priority,
+              std::move(future).value(),
+              std::forward<Fn>(fn));
+        }
       }
       break;
     case State::BLOB_LOADING:
       // If we're already loading, latch on to the in-progress load
-      future = state->blobLoadingPromise->getFuture();
+      future = state->loadState->blobLoadingPromise->getFuture();
       state.unlock();
       break;
     case State::MATERIALIZED_IN_OVERLAY:
@@ -239,10 +257,12 @@ typename folly::futures::detail::callableResult<FileInode::LockedState, Fn>::
         blob = state.getCachedBlob(
             getMount(), BlobCache::Interest::UnlikelyNeededAgain);
       }
-      if (blob) {
-        // We have the blob data loaded.
-        // Materialize the file now.
-        materializeNow(state, blob);
+      if (blob || materializeFromBlobFile(state)) {
+        // We have the blob data loaded, or it could be copied without loading
+        // it.  Materialize the file now.
+        if (blob) {
+          materializeNow(state, blob);
+        }
         // Call materializeInParent before we return, after we are
         // sure the state lock has been released.  This does mean that our
         // parent won't have updated our state until after the caller's function
@@ -275,7 +295,7 @@ typename folly::futures::detail::callableResult<FileInode::LockedState, Fn>::
       break;
     case State::BLOB_LOADING:
       // If we're already loading, latch on to the in-progress load
-      future = state->blobLoadingPromise->getFuture();
+      future = state->loadState->blobLoadingPromise->getFuture();
       state.unlock();
       break;
     case State::MATERIALIZED_IN_OVERLAY:
@@ -332,8 +352,10 @@ FileInode::truncateAndRun(LockedState state, Fn&& fn) {
 
       // Now that materializeAndTruncate() has succeeded, extract the
       // blobLoadingPromise so we can fulfill it as we exit.
-      loadingPromise = std::move(state->blobLoadingPromise);
-      state->blobLoadingPromise.reset();
+      if (state->loadState) {
+        loadingPromise = std::move(state->loadState->blobLoadingPromise);
+        state->loadState.reset();
+      }
       // Also call materializeInParent() as we exit, before fulfilling the
       // blobLoadingPromise.
       SCOPE_EXIT {
@@ -379,26 +401,30 @@ FileInodeState::FileInodeState() : tag(MATERIALIZED_IN_OVERLAY) {
  */
 FileInodeState::~FileInodeState() = default;
 
+FileInodeState::LoadState& FileInodeState::getLoadState() {
+  if (!loadState) {
+    loadState = std::make_unique<LoadState>();
+  }
+  return *loadState;
+}
+
 void FileInodeState::checkInvariants() {
   switch (tag) {
     case BLOB_NOT_LOADING:
       CHECK(hash);
-      CHECK(!blobLoadingPromise);
+      CHECK(!isLoading());
       return;
     case BLOB_LOADING:
       CHECK(hash);
-      CHECK(blobLoadingPromise);
+      CHECK(isLoading());
 #ifndef _WIN32
-      CHECK(readByteRanges.empty());
+      CHECK(loadState->readByteRanges.empty());
 #endif
       return;
     case MATERIALIZED_IN_OVERLAY:
       // 'materialized'
       CHECK(!hash);
-      CHECK(!blobLoadingPromise);
-#ifndef _WIN32
-      CHECK(readByteRanges.empty());
-#endif
+      CHECK(!loadState);
       return;
   }
 
@@ -591,6 +617,11 @@ std::optional<Hash> FileInode::getBlobHash() const {
   return state_.rlock()->hash;
 }
 
+bool FileInode::isCompact() const {
+  auto state = state_.rlock();
+  return !state->isMaterialized() && !state->loadState;
+}
+
 void FileInode::materializeInParent() {
   auto renameLock = getMount()->acquireRenameLock();
   auto loc = getLocationInfo(renameLock);
@@ -800,6 +831,46 @@ void FileInode::materialize() {
 
 Future<BufVec> FileInode::read(size_t size, off_t off) {
   DCHECK_GE(off, 0);
+  if (LocalStore::getBlobChunkSize() == 0) {
+    return readFromBlob(size, off);
+  }
+
+  // If the blob is not already in memory and the LocalStore has it in
+  // chunks, read just the chunks covering this range rather than loading
+  // and caching the whole blob.  This keeps random reads of huge files from
+  // pinning the entire file in memory.
+  std::optional<Hash> hash;
+  {
+    auto state = LockedState{this};
+    if (state->tag == State::BLOB_NOT_LOADING && !state->loadState &&
+        !getMount()->getBlobCache()->contains(state->hash.value())) {
+      hash = state->hash.value();
+    }
+  }
+  if (!hash) {
+    return readFromBlob(size, off);
+  }
+
+  return getObjectStore()
+      ->getBlobRange(
+          *hash, off, size, ObjectFetchContext::getNullContext())
+      .thenValue([size, off, hash = *hash, self = inodePtrFromThis()](
+                     std::unique_ptr<folly::IOBuf> range) {
+        if (!range) {
+          return self->readFromBlob(size, off);
+        }
+        auto state = LockedState{self};
+        // The file may have been modified while the chunks were loading.
+        if (state->isMaterialized() || state->hash != hash) {
+          state.unlock();
+          return self->readFromBlob(size, off);
+        }
+        self->updateAtimeLocked(*state);
+        return makeFuture(BufVec{std::move(range)});
+      });
+}
+
+Future<BufVec> FileInode::readFromBlob(size_t size, off_t off) {
   return runWhileDataLoaded<Future<BufVec>>(
       LockedState{this},
       BlobCache::Interest::WantHandle,
@@ -815,7 +886,12 @@ Future<BufVec> FileInode::read(size_t size, off_t off) {
 
         // Materialized either before or during blob load.
         if (state->tag == State::MATERIALIZED_IN_OVERLAY) {
-          return self->getOverlayFileAccess(state)->read(*self, size, off);
+          auto* fuseChannel = self->getMount()->getFuseChannel();
+          return self->getOverlayFileAccess(state)->read(
+              *self,
+              size,
+              off,
+              fuseChannel && fuseChannel->isSplicingReplies());
         }
 
         // runWhileDataLoaded() ensures that the state is either
@@ -823,13 +899,29 @@ Future<BufVec> FileInode::read(size_t size, off_t off) {
         DCHECK_EQ(state->tag, State::BLOB_NOT_LOADING);
         DCHECK(blob) << "blob missing after load completed";
 
-        state->readByteRanges.add(off, off + size);
-        if (state->readByteRanges.covers(0, blob->getSize())) {
+        auto& loadState = state->getLoadState();
+        auto& readByteRanges = loadState.readByteRanges;
+        readByteRanges.add(off, off + size);
+        auto pattern = loadState.readPattern.recordRead(off, size);
+        if (readByteRanges.covers(0, blob->getSize())) {
           XLOG(DBG4) << "Inode " << self->getNodeId()
                      << " dropping interest for blob " << blob->getHash()
                      << " because it's been fully read.";
-          state->interestHandle.reset();
-          state->readByteRanges.clear();
+          // Without an interest handle or read ranges to track, the inode
+          // can go back to its compact form.
+          state->loadState.reset();
+          if (pattern == ReadPattern::Sequential) {
+            self->readAheadSiblings();
+          }
+        } else if (
+            pattern == ReadPattern::Random &&
+            self->shouldStopCachingRandomReads(*blob)) {
+          XLOG(DBG4) << "Inode " << self->getNodeId()
+                     << " dropping interest for blob " << blob->getHash()
+                     << " because it's being read randomly.";
+          // With no interest or load state, the next read finds the blob
+          // uncached and reads just the chunks it needs.
+          state->loadState.reset();
         }
 
         auto buf = blob->getContents();
@@ -849,6 +941,32 @@ Future<BufVec> FileInode::read(size_t size, off_t off) {
       });
 }
 
+void FileInode::readAheadSiblings() {
+  auto count = getMount()
+                   ->getServerState()
+                   ->getEdenConfig(ConfigReloadBehavior::NoReload)
+                   ->siblingBlobReadahead.getValue();
+  if (count == 0) {
+    return;
+  }
+  // Only schedules the prefetch, so it is safe to call with our lock held.
+  if (auto parent = getParentRacy()) {
+    parent->prefetchBlobsAfter(getNodeId(), count);
+  }
+}
+
+bool FileInode::shouldStopCachingRandomReads(const Blob& blob) {
+  if (LocalStore::getBlobChunkSize() == 0) {
+    // Every read needs the whole blob, so it is better kept in the cache.
+    return false;
+  }
+  auto minimumSize = getMount()
+                         ->getServerState()
+                         ->getEdenConfig(ConfigReloadBehavior::NoReload)
+                         ->randomReadUncachedBlobSize.getValue();
+  return minimumSize != 0 && blob.getSize() >= minimumSize;
+}
+
 size_t FileInode::writeImpl(
     LockedState& state,
     const struct iovec* iov,
@@ -912,15 +1030,37 @@ Future<std::shared_ptr<const Blob>> FileInode::startLoadingData(
     ImportPriority priority) {
   DCHECK_EQ(state->tag, State::BLOB_NOT_LOADING);
 
+  auto& checkoutProfile = getMount()->getCheckoutProfile();
+  if (checkoutProfile.isRecording()) {
+    if (auto path = getPath()) {
+      uint32_t pid = 0;
+#ifndef _WIN32
+      if (RequestData::isFuseRequest()) {
+        pid = RequestData::get().examineReq().pid;
+      }
+#endif
+      checkoutProfile.recordLoad(*path, pid);
+    }
+  }
+
   // Start the blob load first in case this throws an exception.
   // Ideally the state transition is no-except in tandem with the
   // Future's .then call.
   auto getBlobFuture = getMount()->getBlobAccess()->getBlob(
       state->hash.value(), fetchContext, interest, priority);
 
+  if (getBlobFuture.isReady() && getBlobFuture.hasValue()) {
+    // The blob came straight from the LocalStore, so skip the loading state
+    // and the continuation that would just undo it.
+    auto result = std::move(getBlobFuture).value();
+    state->getLoadState().interestHandle = std::move(result.interestHandle);
+    return makeFuture(std::move(result.blob));
+  }
+
   // Everything from here through blobFuture.then should be noexcept.
-  state->blobLoadingPromise.emplace();
-  auto resultFuture = state->blobLoadingPromise->getFuture();
+  auto& loadingPromise = state->getLoadState().blobLoadingPromise;
+  loadingPromise.emplace();
+  auto resultFuture = loadingPromise->getFuture();
   state->tag = State::BLOB_LOADING;
 
   // Unlock state_ while we wait on the blob data to load
@@ -943,18 +1083,22 @@ Future<std::shared_ptr<const Blob>> FileInode::startLoadingData(
           // materialized the FileInode, so we may already be
           // MATERIALIZED_IN_OVERLAY at this point.
           case State::BLOB_LOADING: {
-            auto promise = std::move(*state->blobLoadingPromise);
-            state->blobLoadingPromise.reset();
+            auto promise = std::move(*state->loadState->blobLoadingPromise);
+            state->loadState->blobLoadingPromise.reset();
             state->tag = State::BLOB_NOT_LOADING;
 
             // Call the Future's subscribers while the state_ lock is not
             // held. Even if the FileInode has transitioned to a materialized
             // state, any pending loads must be unblocked.
             if (tryResult.hasValue()) {
-              state->interestHandle = std::move(tryResult->interestHandle);
+              state->loadState->interestHandle =
+                  std::move(tryResult->interestHandle);
               state.unlock();
               promise.setValue(std::move(tryResult->blob));
             } else {
+              // Loads only start after a cache miss cleared the rest of the
+              // load state, so there is nothing left to keep.
+              state->loadState.reset();
               state.unlock();
               promise.setException(std::move(tryResult).exception());
             }
@@ -965,7 +1109,7 @@ Future<std::shared_ptr<const Blob>> FileInode::startLoadingData(
             // The load raced with a someone materializing the file to truncate
             // it.  Nothing left to do here. The truncation completed the
             // promise with a null blob.
-            CHECK_EQ(false, state->blobLoadingPromise.has_value());
+            CHECK_EQ(false, state->isLoading());
             return;
         }
       })
@@ -1000,11 +1144,62 @@ void FileInode::materializeNow(
     blobSha1 = blobSha1Future.value();
   }
 
-  getOverlayFileAccess(state)->createFile(getNodeId(), *blob, blobSha1);
+  auto* overlayFileAccess = getOverlayFileAccess(state);
+  auto config = getMount()->getServerState()->getEdenConfig(
+      ConfigReloadBehavior::NoReload);
+  auto minSize = config->blobFileCacheMinSize.getValue();
+  if (minSize > 0 && blob->getSize() >= minSize) {
+    getMount()->getOverlay()->addBlobFile(
+        state->hash.value(),
+        blob->getContents(),
+        config->blobFileCacheMaxSize.getValue());
+    if (!overlayFileAccess->createFileFromBlobFile(
+            getNodeId(), state->hash.value(), blob->getSize(), blobSha1)) {
+      overlayFileAccess->createFile(getNodeId(), *blob, blobSha1);
+    }
+  } else {
+    overlayFileAccess->createFile(getNodeId(), *blob, blobSha1);
+  }
 
   state.setMaterialized();
 }
 
+bool FileInode::materializeFromBlobFile(LockedState& state) {
+  DCHECK_EQ(state->tag, State::BLOB_NOT_LOADING);
+  auto minSize = getMount()
+                     ->getServerState()
+                     ->getEdenConfig(ConfigReloadBehavior::NoReload)
+                     ->blobFileCacheMinSize.getValue();
+  if (minSize == 0) {
+    return false;
+  }
+
+  // The blob file is only trusted if its size matches the blob's, so without
+  // the size at hand the blob has to be loaded instead.
+  auto blobSizeFuture = getObjectStore()->getBlobSize(
+      state->hash.value(), ObjectFetchContext::getNullContext());
+  if (!blobSizeFuture.isReady() || !blobSizeFuture.hasValue()) {
+    return false;
+  }
+
+  auto blobSha1Future = getObjectStore()->getBlobSha1(
+      state->hash.value(), ObjectFetchContext::getNullContext());
+  std::optional<Hash> blobSha1;
+  if (blobSha1Future.isReady() && blobSha1Future.hasValue()) {
+    blobSha1 = blobSha1Future.value();
+  }
+
+  if (!getOverlayFileAccess(state)->createFileFromBlobFile(
+          getNodeId(),
+          state->hash.value(),
+          blobSizeFuture.value(),
+          blobSha1)) {
+    return false;
+  }
+  state.setMaterialized();
+  return true;
+}
+
 void FileInode::materializeAndTruncate(LockedState& state) {
   CHECK_NE(state->tag, State::MATERIALIZED_IN_OVERLAY);
   getOverlayFileAccess(state)->createEmptyFile(getNodeId());
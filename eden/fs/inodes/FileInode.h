@@ -19,6 +19,7 @@
 #include "eden/fs/store/ImportPriority.h"
 #ifndef _WIN32
 #include "eden/fs/utils/CoverageSet.h"
+#include "eden/fs/utils/ReadPatternTracker.h"
 #endif
 
 namespace folly {
@@ -54,6 +55,11 @@ class OverlayFileAccess;
  *   - loading -> not loaded (blob available during transition)
  *   - loading -> materialized (O_TRUNC or not)
  *   - loading -> not loading -> materialized
+ *
+ * Most loaded FileInodes are only ever stat()ed, so everything needed to load
+ * and read blob data lives in a separately allocated LoadState that is only
+ * created once the file's contents are first needed, and freed again once
+ * there is nothing left in it.
  */
 struct FileInodeState {
   enum Tag : uint8_t {
@@ -62,6 +68,44 @@ struct FileInodeState {
     MATERIALIZED_IN_OVERLAY,
   };
 
+  struct LoadState {
+    /**
+     * Set if 'loading'. Unset when load completes.
+     *
+     * It's possible for this future to complete with a null blob - that
+     * happens if a truncate operation occurs during load. In that case, the
+     * future is completed and the inode transitions to the materialized state
+     * without a blob. Callbacks on this future must handle that case.
+     */
+    std::optional<folly::SharedPromise<std::shared_ptr<const Blob>>>
+        blobLoadingPromise;
+
+    /**
+     * If the blob has ever been loaded from cache, this handle represents
+     * this inode's interest in it. By explicitly resetting the interest
+     * handle, the inode indicates to the cache that the blob can be released.
+     *
+     * This also indicates to the cache that the blob is no longer needed in
+     * memory when the FileInode is deallocated.
+     *
+     * Before attempting to reload the blob, check if the interestHandle has
+     * it first.
+     */
+    BlobInterestHandle interestHandle;
+
+#ifndef _WIN32
+    /**
+     * Records the ranges that have been read() when not materialized.
+     */
+    CoverageSet readByteRanges;
+
+    /**
+     * How the reads recorded in readByteRanges move through the file.
+     */
+    ReadPatternTracker readPattern;
+#endif
+  };
+
   explicit FileInodeState(const std::optional<Hash>& hash);
   explicit FileInodeState();
   ~FileInodeState();
@@ -87,35 +131,22 @@ struct FileInodeState {
   std::optional<Hash> hash;
 
   /**
-   * Set if 'loading'. Unset when load completes.
-   *
-   * It's possible for this future to complete with a null blob - that happens
-   * if a truncate operation occurs during load. In that case, the future is
-   * completed and the inode transitions to the materialized state without
-   * a blob. Callbacks on this future must handle that case.
+   * Returns the LoadState, allocating it if necessary.
    */
-  std::optional<folly::SharedPromise<std::shared_ptr<const Blob>>>
-      blobLoadingPromise;
+  LoadState& getLoadState();
 
   /**
-   * If the blob has ever been loaded from cache, this handle represents this
-   * inode's interest in it. By explicitly resetting the interest handle, the
-   * inode indicates to the cache that the blob can be released.
-   *
-   * This also indicates to the cache that the blob is no longer needed in
-   * memory when the FileInode is deallocated.
-   *
-   * Before attempting to reload the blob, check if the interestHandle has it
-   * first.
+   * Returns true if a blob load is in progress.
    */
-  BlobInterestHandle interestHandle;
+  bool isLoading() const {
+    return loadState && loadState->blobLoadingPromise.has_value();
+  }
 
-#ifndef _WIN32
   /**
-   * Records the ranges that have been read() when not materialized.
+   * Null until the file's contents are first needed, and while there is no
+   * load in progress, blob interest or read history to remember.
    */
-  CoverageSet readByteRanges;
-#endif
+  std::unique_ptr<LoadState> loadState;
 };
 
 class FileInode final : public InodeBaseMetadata<FileInodeState> {
@@ -213,6 +244,15 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
    */
   std::optional<Hash> getBlobHash() const;
 
+  /**
+   * Returns true if this inode is not materialized and currently holds no
+   * state for loading or reading its blob, which is the case for files that
+   * have only been stat()ed.  Such inodes use considerably less memory.
+   *
+   * Like getBlobHash(), this is primarily intended for debugging.
+   */
+  bool isCompact() const;
+
   /**
    * Read the entire file contents, and return them as a string.
    *
@@ -312,6 +352,10 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
    *
    * state->tag must be NOT_LOADED when this is called.
    *
+   * If the blob is available immediately, e.g. from the LocalStore, the
+   * returned Future is already complete and the inode never enters the
+   * BLOB_LOADING state.
+   *
    * This should normally only be invoked by runWhileDataLoaded() or
    * runWhileMaterialized().  Most other callers should use
    * runWhileDataLoaded() or runWhileMaterialized() instead.
@@ -355,6 +399,13 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
    */
   void materializeNow(LockedState& state, std::shared_ptr<const Blob> blob);
 
+  /**
+   * Like materializeNow(), but copies the blob from the overlay's blob file
+   * cache without loading it.  Returns false, leaving the state unchanged, if
+   * the blob file cache is disabled or does not have the blob.
+   */
+  bool materializeFromBlobFile(LockedState& state);
+
   /**
    * Get a FileInodePtr to ourself.
    *
@@ -399,6 +450,24 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
    */
   OverlayFileAccess* getOverlayFileAccess(LockedState&) const;
 
+  /**
+   * Implements read() by loading the whole blob, or by reading the overlay
+   * if the file is materialized.
+   */
+  folly::Future<BufVec> readFromBlob(size_t size, off_t off);
+
+  /**
+   * Called when this file has been read sequentially to its end, to start
+   * prefetching the files after it if store:sibling-blob-readahead is set.
+   */
+  void readAheadSiblings();
+
+  /**
+   * Returns true if random reads into blob should read chunks from the local
+   * store rather than keep the blob in the BlobCache.
+   */
+  bool shouldStopCachingRandomReads(const Blob& blob);
+
   size_t writeImpl(
       LockedState& state,
       const struct iovec* iov,
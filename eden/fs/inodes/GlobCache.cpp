@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/GlobCache.h"
+
+#include <folly/logging/xlog.h>
+#include "eden/fs/utils/Memory.h"
+
+namespace facebook {
+namespace eden {
+
+namespace {
+size_t estimateSize(
+    const std::string& key,
+    const std::vector<GlobNode::GlobResult>& results) {
+  size_t size = sizeof(std::string) + estimateIndirectMemoryUsage(key) +
+      results.capacity() * sizeof(GlobNode::GlobResult);
+  for (const auto& result : results) {
+    size += estimateIndirectMemoryUsage(result.name.value());
+  }
+  return size;
+}
+} // namespace
+
+std::shared_ptr<GlobCache> GlobCache::create(
+    size_t maximumCacheSizeBytes,
+    size_t minimumEntryCount) {
+  return std::shared_ptr<GlobCache>{
+      new GlobCache{maximumCacheSizeBytes, minimumEntryCount}};
+}
+
+GlobCache::GlobCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount)
+    : maximumCacheSizeBytes_{maximumCacheSizeBytes},
+      minimumEntryCount_{minimumEntryCount} {}
+
+GlobCache::Results GlobCache::get(folly::StringPiece key) {
+  auto state = state_.wlock();
+  auto iter = state->items.find(key.str());
+  if (iter == state->items.end()) {
+    ++state->missCount;
+    return nullptr;
+  }
+  ++state->hitCount;
+  return iter->second.results;
+}
+
+void GlobCache::insert(
+    std::string key,
+    std::vector<GlobNode::GlobResult> results) {
+  auto size = estimateSize(key, results);
+  auto shared =
+      std::make_shared<const std::vector<GlobNode::GlobResult>>(
+          std::move(results));
+
+  // Destroy evicted results after the lock is released.
+  std::vector<Results> evicted;
+  {
+    auto state = state_.wlock();
+    if (state->items.exists(key)) {
+      // Trees are immutable, so the cached matches are as good as these.
+      return;
+    }
+    state->items.set(std::move(key), CacheItem{std::move(shared), size});
+    state->totalSize += size;
+    evictUntilFits(*state, evicted);
+  }
+}
+
+void GlobCache::clear() {
+  XLOG(DBG6) << "GlobCache::clear";
+  folly::EvictingCacheMap<std::string, CacheItem> items{0};
+  {
+    auto state = state_.wlock();
+    state->totalSize = 0;
+    items.swap(state->items);
+  }
+}
+
+GlobCache::Stats GlobCache::getStats() const {
+  auto state = state_.rlock();
+  Stats stats;
+  stats.entryCount = state->items.size();
+  stats.totalSizeInBytes = state->totalSize;
+  stats.hitCount = state->hitCount;
+  stats.missCount = state->missCount;
+  stats.evictionCount = state->evictionCount;
+  return stats;
+}
+
+void GlobCache::evictUntilFits(
+    State& state,
+    std::vector<Results>& evicted) noexcept {
+  while (state.totalSize > maximumCacheSizeBytes_ &&
+         state.items.size() > minimumEntryCount_) {
+    auto oldest = state.items.rbegin();
+    auto oldestKey = oldest->first;
+    state.totalSize -= oldest->second.size;
+    evicted.push_back(std::move(oldest->second.results));
+    state.items.erase(oldestKey);
+    ++state.evictionCount;
+  }
+}
+
+} // namespace eden
+} // namespace facebook
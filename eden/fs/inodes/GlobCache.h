@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "eden/fs/inodes/GlobNode.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * An in-memory LRU cache of the matches of compiled glob patterns against
+ * unmodified source control trees, so that repeated globs over the same
+ * commit only walk the directories that have local changes.
+ *
+ * Entries are keyed by a string that GlobNode builds from the tree hash,
+ * the path of the tree and the patterns being matched, so the cached matches
+ * are valid for any mount that has an unmodified copy of the tree at that
+ * path.  Like TreeCache, the cache is bounded by the total size of its
+ * entries but always keeps the minimum entry count around.
+ *
+ * It is safe to use this object from arbitrary threads.
+ */
+class GlobCache {
+ public:
+  using Results = std::shared_ptr<const std::vector<GlobNode::GlobResult>>;
+
+  struct Stats {
+    size_t entryCount{0};
+    size_t totalSizeInBytes{0};
+    uint64_t hitCount{0};
+    uint64_t missCount{0};
+    uint64_t evictionCount{0};
+  };
+
+  static std::shared_ptr<GlobCache> create(
+      size_t maximumCacheSizeBytes,
+      size_t minimumEntryCount);
+
+  /**
+   * Returns the cached matches for key and moves them to the back of the
+   * eviction queue, or nullptr if they are not cached.
+   */
+  Results get(folly::StringPiece key);
+
+  /**
+   * Caches results under key, evicting old entries if the new total size
+   * exceeds the maximum cache size and the minimum entry count.
+   */
+  void insert(std::string key, std::vector<GlobNode::GlobResult> results);
+
+  void clear();
+
+  Stats getStats() const;
+
+ private:
+  GlobCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount);
+
+  struct CacheItem {
+    Results results;
+    size_t size;
+  };
+
+  struct State {
+    size_t totalSize{0};
+
+    /// Unbounded by count; evictUntilFits() bounds it by size.
+    folly::EvictingCacheMap<std::string, CacheItem> items{0};
+
+    uint64_t hitCount{0};
+    uint64_t missCount{0};
+    uint64_t evictionCount{0};
+  };
+
+  void evictUntilFits(State& state, std::vector<Results>& evicted) noexcept;
+
+  const size_t maximumCacheSizeBytes_;
+  const size_t minimumEntryCount_;
+  folly::Synchronized<State> state_;
+};
+
+} // namespace eden
+} // namespace facebook
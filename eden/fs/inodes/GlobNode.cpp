@@ -6,8 +6,11 @@
  */
 
 #include "GlobNode.h"
+#include <folly/Conv.h>
 #include <iomanip>
 #include <iostream>
+#include <tuple>
+#include "eden/fs/inodes/GlobCache.h"
 #include "eden/fs/inodes/TreeInode.h"
 
 using folly::Future;
@@ -21,6 +24,45 @@ namespace eden {
 
 namespace {
 
+// Continues on executor, if set, once the future is ready.
+template <typename T>
+Future<T> viaExecutor(Future<T>&& future, folly::Executor* executor) {
+  if (!executor) {
+    return std::move(future);
+  }
+  return std::move(future).via(executor);
+}
+
+// Returns cached matches, handing them to resultSink instead if it is set.
+vector<GlobNode::GlobResult> useCachedResults(
+    const vector<GlobNode::GlobResult>& cached,
+    const GlobNode::ResultSink& resultSink) {
+  if (!resultSink) {
+    return cached;
+  }
+  if (!cached.empty()) {
+    (*resultSink)(vector<GlobNode::GlobResult>(cached));
+  }
+  return {};
+}
+
+// Caches matches computed by walking root under key, which was built from
+// treeHash.  A TreeInode walk reads live inodes, so a write during the walk
+// would leave local changes in the results.  Any write below root
+// materializes it, so the results are only cached if root still has the same
+// unmodified tree hash once the walk is done.
+template <typename ROOT>
+void cacheResults(
+    GlobCache* cache,
+    std::string&& key,
+    const Hash& treeHash,
+    ROOT& root,
+    const vector<GlobNode::GlobResult>& results) {
+  if (root.unmodifiedTreeHash() == treeHash) {
+    cache->insert(std::move(key), results);
+  }
+}
+
 // Policy objects to help avoid duplicating the core globbing logic.
 // We can walk over two different kinds of trees; either TreeInodes
 // or raw Trees from the storage layer.  While they have similar
@@ -43,6 +85,12 @@ struct TreeInodePtrRoot {
     return root->getContents().rlock();
   }
 
+  /** The hash of the source control tree this inode is identical to, if it
+   * is not materialized. */
+  std::optional<Hash> unmodifiedTreeHash() {
+    return root->getContents().rlock()->treeHash;
+  }
+
   /** Given the return value from lockContents and a name,
    * return a pointer to the child with that name, or nullptr
    * if there is no match */
@@ -138,6 +186,10 @@ struct TreeRoot {
 
   explicit TreeRoot(const std::shared_ptr<const Tree>& tree) : tree(tree) {}
 
+  std::optional<Hash> unmodifiedTreeHash() {
+    return tree->getHash();
+  }
+
   /** We don't need to lock the contents, so we just return a reference
    * to the entries */
   auto& lockContents() {
@@ -292,12 +344,41 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
     ObjectFetchContext& context,
     RelativePathPiece rootPath,
     ROOT&& root,
-    GlobNode::PrefetchList fileBlobsToPrefetch) {
+    GlobNode::PrefetchList fileBlobsToPrefetch,
+    GlobNode::ResultSink resultSink,
+    folly::Executor* executor,
+    GlobCache* cache) {
+  // The key to cache this node's matches under, if they can be cached.
+  std::string cacheKey;
+  Hash cacheTreeHash;
+  if (cache && !fileBlobsToPrefetch) {
+    if (auto treeHash = root.unmodifiedTreeHash()) {
+      auto key = makeCacheKey('e', *treeHash, rootPath);
+      if (auto cached = cache->get(key)) {
+        return useCachedResults(*cached, resultSink);
+      }
+      if (!resultSink) {
+        cacheKey = std::move(key);
+        cacheTreeHash = *treeHash;
+      }
+    }
+  }
+
   vector<GlobResult> results;
   vector<std::pair<PathComponentPiece, GlobNode*>> recurse;
+  // Source control trees to fetch and walk, once the lock on the contents
+  // has been released.
+  vector<std::tuple<RelativePath, Hash, GlobNode*>> fetch;
   vector<Future<vector<GlobResult>>> futures;
   futures.emplace_back(evaluateRecursiveComponentImpl(
-      store, context, rootPath, root, fileBlobsToPrefetch));
+      store,
+      context,
+      rootPath,
+      root,
+      fileBlobsToPrefetch,
+      resultSink,
+      executor,
+      cache));
 
   auto recurseIfNecessary =
       [&](PathComponentPiece name, GlobNode* node, const auto& entry) {
@@ -306,22 +387,7 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
           if (root.entryShouldLoadChildTree(entry)) {
             recurse.emplace_back(std::make_pair(name, node));
           } else {
-            auto candidateName = rootPath + name;
-            futures.emplace_back(
-                store->getTree(root.entryHash(entry), context)
-                    .thenValue(
-                        [candidateName,
-                         store,
-                         &context,
-                         innerNode = node,
-                         fileBlobsToPrefetch](std::shared_ptr<const Tree> dir) {
-                          return innerNode->evaluateImpl(
-                              store,
-                              context,
-                              candidateName,
-                              TreeRoot(dir),
-                              fileBlobsToPrefetch);
-                        }));
+            fetch.emplace_back(rootPath + name, root.entryHash(entry), node);
           }
         }
       };
@@ -367,23 +433,60 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
     }
   }
 
+  if (resultSink) {
+    if (!(*resultSink)(std::move(results))) {
+      recurse.clear();
+      fetch.clear();
+    }
+    results.clear();
+  }
+
+  for (auto& [candidateName, hash, node] : fetch) {
+    futures.emplace_back(
+        viaExecutor(store->getTree(hash, context), executor)
+            .thenValue([candidateName = std::move(candidateName),
+                        store,
+                        &context,
+                        innerNode = node,
+                        fileBlobsToPrefetch,
+                        resultSink,
+                        executor,
+                        cache](std::shared_ptr<const Tree> dir) {
+              return innerNode->evaluateImpl(
+                  store,
+                  context,
+                  candidateName,
+                  TreeRoot(dir),
+                  fileBlobsToPrefetch,
+                  resultSink,
+                  executor,
+                  cache);
+            }));
+  }
+
   // Recursively load child inodes and evaluate matches
 
   for (auto& item : recurse) {
     auto candidateName = rootPath + item.first;
     futures.emplace_back(
-        root.getOrLoadChildTree(item.first)
+        viaExecutor(root.getOrLoadChildTree(item.first), executor)
             .thenValue([store,
                         &context,
                         candidateName,
                         node = item.second,
-                        fileBlobsToPrefetch](TreeInodePtr dir) {
+                        fileBlobsToPrefetch,
+                        resultSink,
+                        executor,
+                        cache](TreeInodePtr dir) {
               return node->evaluateImpl(
                   store,
                   context,
                   candidateName,
                   TreeInodePtrRoot(dir),
-                  fileBlobsToPrefetch);
+                  fileBlobsToPrefetch,
+                  resultSink,
+                  executor,
+                  cache);
             }));
   }
 
@@ -392,7 +495,11 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
   // Our caller may destroy us after we return, so we can't let errors propagate
   // back to the caller early while some processing may still be occurring.
   return folly::collectAllUnsafe(futures).thenValue(
-      [shadowResults = std::move(results)](
+      [shadowResults = std::move(results),
+       cache,
+       cacheKey = std::move(cacheKey),
+       cacheTreeHash,
+       cacheRoot = root](
           vector<folly::Try<vector<GlobNode::GlobResult>>>&&
               matchVector) mutable {
         for (auto& matches : matchVector) {
@@ -402,6 +509,14 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
               std::make_move_iterator(matches->begin()),
               std::make_move_iterator(matches->end()));
         }
+        if (!cacheKey.empty()) {
+          cacheResults(
+              cache,
+              std::move(cacheKey),
+              cacheTreeHash,
+              cacheRoot,
+              shadowResults);
+        }
         return shadowResults;
       });
 }
@@ -411,9 +526,22 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluate(
     ObjectFetchContext& context,
     RelativePathPiece rootPath,
     TreeInodePtr root,
-    GlobNode::PrefetchList fileBlobsToPrefetch) {
+    GlobNode::PrefetchList fileBlobsToPrefetch,
+    GlobNode::ResultSink resultSink,
+    folly::Executor* executor,
+    GlobCache* cache) {
+  if (cache) {
+    computeCacheKeys();
+  }
   return evaluateImpl(
-      store, context, rootPath, TreeInodePtrRoot(root), fileBlobsToPrefetch);
+      store,
+      context,
+      rootPath,
+      TreeInodePtrRoot(root),
+      fileBlobsToPrefetch,
+      resultSink,
+      executor,
+      cache);
 }
 
 folly::Future<vector<GlobNode::GlobResult>> GlobNode::evaluate(
@@ -421,9 +549,57 @@ folly::Future<vector<GlobNode::GlobResult>> GlobNode::evaluate(
     ObjectFetchContext& context,
     RelativePathPiece rootPath,
     const std::shared_ptr<const Tree>& tree,
-    GlobNode::PrefetchList fileBlobsToPrefetch) {
+    GlobNode::PrefetchList fileBlobsToPrefetch,
+    GlobNode::ResultSink resultSink,
+    folly::Executor* executor,
+    GlobCache* cache) {
+  if (cache) {
+    computeCacheKeys();
+  }
   return evaluateImpl(
-      store, context, rootPath, TreeRoot(tree), fileBlobsToPrefetch);
+      store,
+      context,
+      rootPath,
+      TreeRoot(tree),
+      fileBlobsToPrefetch,
+      resultSink,
+      executor,
+      cache);
+}
+
+void GlobNode::computeCacheKeys() {
+  // Every string is length-prefixed so that different sets of patterns can
+  // never produce the same key.
+  auto key = folly::to<string>(
+      pattern_.size(),
+      ':',
+      pattern_,
+      includeDotfiles_,
+      isLeaf_,
+      hasSpecials_,
+      alwaysMatch_);
+  for (auto& child : children_) {
+    child->computeCacheKeys();
+    folly::toAppend('c', child->cacheKey_.size(), ':', child->cacheKey_, &key);
+  }
+  for (auto& child : recursiveChildren_) {
+    child->computeCacheKeys();
+    folly::toAppend('r', child->cacheKey_.size(), ':', child->cacheKey_, &key);
+  }
+  cacheKey_ = std::move(key);
+}
+
+string GlobNode::makeCacheKey(
+    char kind,
+    const Hash& treeHash,
+    RelativePathPiece rootPath) const {
+  return folly::to<string>(
+      kind,
+      treeHash.toString(),
+      rootPath.stringPiece().size(),
+      ':',
+      rootPath.stringPiece(),
+      cacheKey_);
 }
 
 StringPiece GlobNode::tokenize(StringPiece& pattern, bool* hasSpecials) {
@@ -470,13 +646,34 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateRecursiveComponentImpl(
     ObjectFetchContext& context,
     RelativePathPiece rootPath,
     ROOT&& root,
-    GlobNode::PrefetchList fileBlobsToPrefetch) {
+    GlobNode::PrefetchList fileBlobsToPrefetch,
+    GlobNode::ResultSink resultSink,
+    folly::Executor* executor,
+    GlobCache* cache) {
   vector<GlobResult> results;
   if (recursiveChildren_.empty()) {
     return results;
   }
 
+  std::string cacheKey;
+  Hash cacheTreeHash;
+  if (cache && !fileBlobsToPrefetch) {
+    if (auto treeHash = root.unmodifiedTreeHash()) {
+      auto key = makeCacheKey('r', *treeHash, rootPath);
+      if (auto cached = cache->get(key)) {
+        return useCachedResults(*cached, resultSink);
+      }
+      if (!resultSink) {
+        cacheKey = std::move(key);
+        cacheTreeHash = *treeHash;
+      }
+    }
+  }
+
   vector<RelativePath> subDirNames;
+  // Source control trees to fetch and walk, once the lock on the contents
+  // has been released.
+  vector<std::pair<RelativePath, Hash>> fetch;
   vector<Future<vector<GlobResult>>> futures;
   {
     auto contents = root.lockContents();
@@ -501,40 +698,65 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateRecursiveComponentImpl(
         if (root.entryShouldLoadChildTree(entry)) {
           subDirNames.emplace_back(candidateName);
         } else {
-          futures.emplace_back(
-              store->getTree(root.entryHash(entry), context)
-                  .thenValue([candidateName,
-                              store,
-                              &context,
-                              this,
-                              fileBlobsToPrefetch](
-                                 const std::shared_ptr<const Tree>& tree) {
-                    return evaluateRecursiveComponentImpl(
-                        store,
-                        context,
-                        candidateName,
-                        TreeRoot(tree),
-                        fileBlobsToPrefetch);
-                  }));
+          fetch.emplace_back(candidateName, root.entryHash(entry));
         }
       }
     }
   }
 
+  if (resultSink) {
+    if (!(*resultSink)(std::move(results))) {
+      subDirNames.clear();
+      fetch.clear();
+    }
+    results.clear();
+  }
+
+  for (auto& [candidateName, hash] : fetch) {
+    futures.emplace_back(
+        viaExecutor(store->getTree(hash, context), executor)
+            .thenValue([candidateName = std::move(candidateName),
+                        store,
+                        &context,
+                        this,
+                        fileBlobsToPrefetch,
+                        resultSink,
+                        executor,
+                        cache](const std::shared_ptr<const Tree>& tree) {
+              return evaluateRecursiveComponentImpl(
+                  store,
+                  context,
+                  candidateName,
+                  TreeRoot(tree),
+                  fileBlobsToPrefetch,
+                  resultSink,
+                  executor,
+                  cache);
+            }));
+  }
+
   // Recursively load child inodes and evaluate matches
   for (auto& candidateName : subDirNames) {
     futures.emplace_back(
-        root.getOrLoadChildTree(candidateName.basename())
-            .thenValue(
-                [candidateName, store, &context, this, fileBlobsToPrefetch](
-                    TreeInodePtr dir) {
-                  return evaluateRecursiveComponentImpl(
-                      store,
-                      context,
-                      candidateName,
-                      TreeInodePtrRoot(dir),
-                      fileBlobsToPrefetch);
-                }));
+        viaExecutor(root.getOrLoadChildTree(candidateName.basename()), executor)
+            .thenValue([candidateName,
+                        store,
+                        &context,
+                        this,
+                        fileBlobsToPrefetch,
+                        resultSink,
+                        executor,
+                        cache](TreeInodePtr dir) {
+              return evaluateRecursiveComponentImpl(
+                  store,
+                  context,
+                  candidateName,
+                  TreeInodePtrRoot(dir),
+                  fileBlobsToPrefetch,
+                  resultSink,
+                  executor,
+                  cache);
+            }));
   }
 
   // Note: we use collectAll() rather than collect() here to make sure that
@@ -542,7 +764,11 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateRecursiveComponentImpl(
   // Our caller may destroy us after we return, so we can't let errors propagate
   // back to the caller early while some processing may still be occurring.
   return folly::collectAllUnsafe(futures).thenValue(
-      [shadowResults = std::move(results)](
+      [shadowResults = std::move(results),
+       cache,
+       cacheKey = std::move(cacheKey),
+       cacheTreeHash,
+       cacheRoot = root](
           vector<folly::Try<vector<GlobResult>>>&& matchVector) mutable {
         for (auto& matches : matchVector) {
           // Rethrow the exception if any of the results failed
@@ -552,6 +778,14 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateRecursiveComponentImpl(
               std::make_move_iterator(matches->begin()),
               std::make_move_iterator(matches->end()));
         }
+        if (!cacheKey.empty()) {
+          cacheResults(
+              cache,
+              std::move(cacheKey),
+              cacheTreeHash,
+              cacheRoot,
+              shadowResults);
+        }
         return shadowResults;
       });
 }
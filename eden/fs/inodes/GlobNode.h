@@ -7,7 +7,9 @@
 
 #pragma once
 #include <folly/futures/Future.h>
+#include <functional>
 #include <ostream>
+#include <string>
 #include "eden/fs/inodes/InodePtrFwd.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/model/Tree.h"
@@ -20,6 +22,8 @@
 namespace facebook {
 namespace eden {
 
+class GlobCache;
+
 /** Represents the compiled state of a tree-walking glob operation.
  * We split the glob into path components and build a tree of name
  * matching operations.
@@ -57,6 +61,15 @@ class GlobNode {
         : name(std::move(name)), dtype(dtype) {}
   };
 
+  // When passed to evaluate(), each directory's matches are handed to the
+  // sink as soon as that directory has been walked, rather than being
+  // collected into the returned vector, which is then empty.  The sink is
+  // called for every directory walked, even one without matches, and may be
+  // called concurrently from several threads.  Once it returns false the walk
+  // does not descend any further.
+  using ResultSink =
+      std::shared_ptr<std::function<bool(std::vector<GlobResult>&&)>>;
+
   // Compile and add a new glob pattern to the tree.
   // Compilation splits the pattern into nodes, with one node for each
   // directory separator separated path component.
@@ -71,12 +84,23 @@ class GlobNode {
   // prefetched via the ObjectStore layer.  This will not change the
   // materialization or overlay state for children that already have
   // inodes assigned.
+  // If executor is set, each child directory is evaluated on it once it has
+  // been loaded, so that sibling subtrees are matched in parallel, up to the
+  // executor's thread count, rather than one after another on whichever
+  // thread loaded them.
+  // If cache is set, the matches in source control trees that have no local
+  // changes are looked up in it, and cached there, rather than walking those
+  // trees every time.  Nothing is cached while prefetching or while
+  // streaming to a resultSink, which only reads the cache.
   folly::Future<std::vector<GlobResult>> evaluate(
       const ObjectStore* store,
       ObjectFetchContext& context,
       RelativePathPiece rootPath,
       TreeInodePtr root,
-      PrefetchList fileBlobsToPrefetch);
+      PrefetchList fileBlobsToPrefetch,
+      ResultSink resultSink = nullptr,
+      folly::Executor* executor = nullptr,
+      GlobCache* cache = nullptr);
 
   // This is the Tree version of the method above
   folly::Future<std::vector<GlobResult>> evaluate(
@@ -84,7 +108,10 @@ class GlobNode {
       ObjectFetchContext& context,
       RelativePathPiece rootPath,
       const std::shared_ptr<const Tree>& tree,
-      PrefetchList fileBlobsToPrefetch);
+      PrefetchList fileBlobsToPrefetch,
+      ResultSink resultSink = nullptr,
+      folly::Executor* executor = nullptr,
+      GlobCache* cache = nullptr);
 
   /**
    * Print a human-readable description of this GlobNode to stderr.
@@ -123,7 +150,10 @@ class GlobNode {
       ObjectFetchContext& context,
       RelativePathPiece rootPath,
       ROOT&& root,
-      PrefetchList fileBlobsToPrefetch);
+      PrefetchList fileBlobsToPrefetch,
+      ResultSink resultSink,
+      folly::Executor* executor,
+      GlobCache* cache);
 
   template <typename ROOT>
   folly::Future<std::vector<GlobResult>> evaluateImpl(
@@ -131,14 +161,27 @@ class GlobNode {
       ObjectFetchContext& context,
       RelativePathPiece rootPath,
       ROOT&& root,
-      PrefetchList fileBlobsToPrefetch);
+      PrefetchList fileBlobsToPrefetch,
+      ResultSink resultSink,
+      folly::Executor* executor,
+      GlobCache* cache);
 
   void debugDump(int currentDepth) const;
 
+  // Fills in cacheKey_ for this node and all its descendants.
+  void computeCacheKeys();
+  std::string makeCacheKey(
+      char kind,
+      const Hash& treeHash,
+      RelativePathPiece rootPath) const;
+
   // The pattern fragment for this node
   std::string pattern_;
   // The compiled pattern
   GlobMatcher matcher_;
+  // Identifies the patterns of this node and its descendants in GlobCache
+  // keys; only set while evaluating with a cache.
+  std::string cacheKey_;
   // List of non-** child rules
   std::vector<std::unique_ptr<GlobNode>> children_;
   // List of ** child rules
@@ -27,6 +27,7 @@ InodeBase::InodeBase(EdenMount* mount)
     : ino_{kRootNodeId},
       initialMode_{S_IFDIR | 0755},
       mount_{mount},
+      lastAccessEpoch_{mount->getInodeAccessEpoch()},
       location_{
           LocationInfo{nullptr,
                        PathComponentPiece{"", detail::SkipPathSanityCheck()}}} {
@@ -50,6 +51,7 @@ InodeBase::InodeBase(
     : ino_{ino},
       initialMode_{initialMode},
       mount_{parent->mount_},
+      lastAccessEpoch_{mount_->getInodeAccessEpoch()},
       location_{LocationInfo{std::move(parent), name}} {
   // Inode numbers generally shouldn't be 0.
   // Older versions of glibc have bugs handling files with an inode number of 0
@@ -68,6 +70,15 @@ InodeBase::InodeBase(
 #endif
 }
 
+void InodeBase::markAccessed() {
+  auto epoch = mount_->getInodeAccessEpoch();
+  // Avoid dirtying the cache line when the epoch has not moved, which is the
+  // common case for hot inodes.
+  if (lastAccessEpoch_.load(std::memory_order_relaxed) != epoch) {
+    lastAccessEpoch_.store(epoch, std::memory_order_relaxed);
+  }
+}
+
 InodeBase::~InodeBase() {
   XLOG(DBG5) << "inode " << this << " (" << ino_
              << ") destroyed: " << getLogPath();
@@ -184,11 +195,28 @@ std::optional<RelativePath> InodeBase::getPath() const {
     return RelativePath();
   }
 
-  std::vector<PathComponent> names;
-  if (!getPathHelper(names, true)) {
+  TreeInodePtr parent;
+  PathComponent name;
+  {
+    auto loc = location_.rlock();
+    if (loc->unlinked) {
+      return std::nullopt;
+    }
+    parent = loc->parent;
+    // Our caller should ensure that we are not the root
+    DCHECK(parent);
+    name = loc->name;
+  }
+
+  // Stop at the root inode without acquiring any of its locks.
+  if (parent->ino_ == kRootNodeId) {
+    return RelativePath(std::move(name));
+  }
+  auto parentPath = parent->getCachedPath();
+  if (!parentPath) {
     return std::nullopt;
   }
-  return RelativePath(names);
+  return *parentPath + name;
 }
 
 std::string InodeBase::getLogPath() const {
@@ -227,6 +255,10 @@ std::unique_ptr<InodeBase> InodeBase::markUnlinked(
     DCHECK_EQ(loc->parent.get(), parent);
     loc->unlinked = true;
   }
+  // Only directory paths are cached.
+  if (isDir()) {
+    mount_->bumpPathGeneration();
+  }
 
   // Grab the inode map lock, and check if we should unload
   // ourself immediately.
@@ -264,10 +296,16 @@ void InodeBase::updateLocation(
   DCHECK(renameLock.isHeld(mount_));
   DCHECK_EQ(mount_, newParent->mount_);
 
-  auto loc = location_.wlock();
-  DCHECK(!loc->unlinked);
-  loc->parent = newParent;
-  loc->name = newName.copy();
+  {
+    auto loc = location_.wlock();
+    DCHECK(!loc->unlinked);
+    loc->parent = newParent;
+    loc->name = newName.copy();
+  }
+  // Only directory paths are cached.
+  if (isDir()) {
+    mount_->bumpPathGeneration();
+  }
 }
 
 void InodeBase::onPtrRefZero() const {
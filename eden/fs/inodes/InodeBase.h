@@ -78,6 +78,7 @@ class InodeBase {
    */
   void incFuseRefcount(uint32_t count = 1) {
     numFuseReferences_.fetch_add(count, std::memory_order_acq_rel);
+    markAccessed();
   }
 
   /**
@@ -92,6 +93,23 @@ class InodeBase {
     DCHECK_GE(prevValue, count);
   }
 
+  /**
+   * Record that this inode was just used, for the purpose of deciding which
+   * inodes to unload when the mount is over its inode memory budget.
+   *
+   * This only stores the mount's current access epoch (see
+   * EdenMount::getInodeAccessEpoch()), so it is cheap enough to call on every
+   * lookup.
+   */
+  void markAccessed();
+
+  /**
+   * The mount's access epoch as of the last markAccessed() call.
+   */
+  uint32_t getLastAccessEpoch() const {
+    return lastAccessEpoch_.load(std::memory_order_relaxed);
+  }
+
   /**
    * Get the EdenMount that this inode belongs to
    *
@@ -268,6 +286,15 @@ class InodeBase {
     return numFuseReferences_.load(std::memory_order_acquire);
   }
 
+  /**
+   * Get the FUSE refcount for heuristics that can tolerate a stale value,
+   * such as telling whether the kernel looked up an inode after it was
+   * prefetched.
+   */
+  uint32_t getApproximateFuseRefcount() const {
+    return numFuseReferences_.load(std::memory_order_relaxed);
+  }
+
   /**
    * Set the FUSE reference count.
    *
@@ -444,6 +471,12 @@ class InodeBase {
    */
   std::atomic<uint32_t> numFuseReferences_{0};
 
+  /**
+   * The mount's inode access epoch when this inode was last looked up.
+   * This is an approximate recency used to pick inodes to unload.
+   */
+  std::atomic<uint32_t> lastAccessEpoch_{0};
+
   /**
    * A reference count used by InodePtr.
    *
@@ -11,8 +11,13 @@
 #include <folly/MapUtil.h>
 #include <folly/functional/Invoke.h>
 #include <folly/futures/Future.h>
+#include <folly/futures/FutureSplitter.h>
+#include <folly/logging/xlog.h>
+#include <optional>
+#include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/InodePtr.h"
 #include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/store/ObjectStore.h"
 #include "eden/fs/utils/PathMap.h"
 
 namespace facebook {
@@ -57,39 +62,95 @@ class InodeLoader {
 
   // Called to signal that a load attempt has completed.
   // In the success case this will cause any children of
-  // this inode to be loaded.
+  // this inode to be loaded, all of them under one lock of the
+  // tree's contents.
   // In the failure case this will propagate the failure to
   // any children of this node, too.
-  void loaded(folly::Try<InodePtr> inodeTry) {
+  // If prefetchBlobMetadata is set, the metadata of the files
+  // among the children is fetched in one batch before their
+  // inodes are handed out, so that stat() or getSha1() on them
+  // do not each fetch it separately.
+  void loaded(
+      folly::Try<InodePtr> inodeTry,
+      bool prefetchBlobMetadata = false) {
     for (auto& promise : promises_) {
       promise.setValue(inodeTry);
     }
 
-    auto tree = inodeTry.hasValue() ? inodeTry->asTreePtrOrNull() : nullptr;
+    if (children_.empty()) {
+      return;
+    }
+
+    if (inodeTry.hasException()) {
+      // The attempt failed, so propagate the failure to our children
+      for (auto& entry : children_) {
+        entry.second->loaded(inodeTry, prefetchBlobMetadata);
+      }
+      return;
+    }
+
+    auto tree = inodeTry->asTreePtrOrNull();
+    if (!tree) {
+      // This inode is not a tree but we're trying to load
+      // children; generate failures for these
+      for (auto& entry : children_) {
+        entry.second->loaded(folly::Try<InodePtr>(
+            folly::make_exception_wrapper<std::system_error>(
+                ENOENT, std::generic_category())));
+      }
+      return;
+    }
 
+    // otherwise schedule the next level of lookup
+    std::vector<PathComponentPiece> names;
+    std::vector<std::unique_ptr<InodeLoader>> loaders;
+    names.reserve(children_.size());
+    loaders.reserve(children_.size());
     for (auto& entry : children_) {
-      if (inodeTry.hasException()) {
-        // The attempt failed, so propagate the failure to our children
-        entry.second->loaded(inodeTry);
-      } else {
-        // otherwise schedule the next level of lookup
-        auto& childName = entry.first;
-        auto& childLoader = entry.second;
-
-        if (!tree) {
-          // This inode is not a tree but we're trying to load
-          // children; generate failures for these
-          childLoader->loaded(folly::Try<InodePtr>(
-              folly::make_exception_wrapper<std::system_error>(
-                  ENOENT, std::generic_category())));
-          continue;
-        }
-
-        folly::makeFutureWith([&] { return tree->getOrLoadChild(childName); })
-            .thenTry(
-                [loader = std::move(childLoader)](
-                    folly::Try<InodePtr>&& inode) { loader->loaded(inode); });
+      names.push_back(entry.first);
+      loaders.push_back(std::move(entry.second));
+    }
+
+    auto& fetchContext = ObjectFetchContext::getNullContext();
+    std::vector<Hash> blobs;
+    std::vector<folly::Future<InodePtr>> inodes;
+    try {
+      inodes = tree->getOrLoadChildren(
+          names, fetchContext, prefetchBlobMetadata ? &blobs : nullptr);
+    } catch (const std::exception& ex) {
+      auto ew = folly::exception_wrapper{std::current_exception(), ex};
+      for (auto& loader : loaders) {
+        loader->loaded(folly::Try<InodePtr>(ew), prefetchBlobMetadata);
+      }
+      return;
+    }
+
+    std::optional<folly::FutureSplitter<folly::Unit>> prefetched;
+    if (!blobs.empty()) {
+      prefetched.emplace(
+          tree->getMount()
+              ->getObjectStore()
+              ->prefetchBlobMetadata(blobs, fetchContext)
+              .thenError([](folly::exception_wrapper&& ew) {
+                // Each file's own metadata fetch retries and reports any
+                // error.
+                XLOG(DBG3) << "failed to prefetch blob metadata: " << ew;
+              }));
+    }
+
+    for (size_t i = 0; i < loaders.size(); ++i) {
+      auto inode = std::move(inodes[i]);
+      if (prefetched && loaders[i]->children_.empty()) {
+        inode = prefetched->getFuture().thenValue(
+            [inode = std::move(inode)](folly::Unit) mutable {
+              return std::move(inode);
+            });
       }
+      std::move(inode).thenTry(
+          [loader = std::move(loaders[i]), prefetchBlobMetadata](
+              folly::Try<InodePtr>&& inodeTry) {
+            loader->loaded(std::move(inodeTry), prefetchBlobMetadata);
+          });
     }
   }
 
@@ -121,6 +182,9 @@ class InodeLoader {
  * loading the same inodes over and over again.  In other words, the
  * number of inode load calls is O(number-of-unique-inodes) rather than
  * O(number-of-path-components) in the input set of paths.
+ * The children of each directory are loaded together, and if
+ * `prefetchBlobMetadata` is set the metadata of the requested files in
+ * each directory is fetched in one batch before `func` sees them.
  * As each matching inode is loaded, `func` is applied to it.
  * This function returns `vector<SemiFuture<Result>>` where `Result`
  * is the return type of `func`.
@@ -131,7 +195,8 @@ template <typename Func>
 auto applyToInodes(
     InodePtr rootInode,
     const std::vector<std::string>& paths,
-    Func func) {
+    Func func,
+    bool prefetchBlobMetadata = false) {
   using FuncRet = folly::invoke_result_t<Func&, InodePtr&>;
   using Result = typename folly::isFutureOrSemiFuture<FuncRet>::Inner;
 
@@ -144,7 +209,7 @@ auto applyToInodes(
         [func](InodePtr&& inode) { return func(inode); }));
   }
 
-  loader.loaded(folly::Try<InodePtr>(rootInode));
+  loader.loaded(folly::Try<InodePtr>(rootInode), prefetchBlobMetadata);
 
   return results;
 }
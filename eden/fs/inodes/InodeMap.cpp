@@ -10,8 +10,12 @@
 #include <boost/polymorphic_cast.hpp>
 #include <folly/Exception.h>
 #include <folly/Likely.h>
+#include <folly/hash/Hash.h>
 #include <folly/logging/xlog.h>
 
+#ifndef _WIN32
+#include "eden/fs/fuse/RequestData.h"
+#endif // !_WIN32
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/inodes/Overlay.h"
@@ -97,43 +101,65 @@ InodeMap::~InodeMap() {
   // destroy the EdenMount.
 }
 
-inline void InodeMap::insertLoadedInode(
-    const folly::Synchronized<Members>::LockedPtr& data,
-    InodeBase* inode) {
-  auto ret = data->loadedInodes_.emplace(inode->getNodeId(), inode);
+InodeMap::LockedShards::LockedShards(ShardArray& shards) {
+  for (size_t i = 0; i < kNumShards; ++i) {
+    locks_[i] = shards[i].wlock();
+  }
+}
+
+void InodeMap::LockedShards::unlock() {
+  // Release in the reverse of the acquisition order.
+  for (size_t i = kNumShards; i > 0; --i) {
+    if (!locks_[i - 1].isNull()) {
+      locks_[i - 1].unlock();
+    }
+  }
+}
+
+size_t InodeMap::shardIndex(InodeNumber number) {
+  // Inode numbers are allocated sequentially, and a directory's children
+  // usually have neighbouring numbers.  Mixing spreads them across shards.
+  return folly::hash::twang_mix64(number.get()) % kNumShards;
+}
+
+inline void InodeMap::insertLoadedInode(Shard& shard, InodeBase* inode) {
+  auto ret = shard.loadedInodes_.emplace(inode->getNodeId(), inode);
   CHECK(ret.second);
   if (inode->getType() == dtype_t::Dir) {
-    ++data->numTreeInodes_;
+    ++shard.numTreeInodes_;
   } else {
-    ++data->numFileInodes_;
+    ++shard.numFileInodes_;
   }
 }
 
 void InodeMap::initialize(TreeInodePtr root) {
-  auto data = data_.wlock();
   CHECK(!root_);
   root_ = std::move(root);
-  insertLoadedInode(data, root_.get());
-  DCHECK_EQ(1, data->numTreeInodes_);
-  DCHECK_EQ(0, data->numFileInodes_);
+  auto shard = getShard(root_->getNodeId()).wlock();
+  insertLoadedInode(*shard, root_.get());
+  DCHECK_EQ(1, shard->numTreeInodes_);
+  DCHECK_EQ(0, shard->numFileInodes_);
 }
 
 #ifndef _WIN32
 void InodeMap::initializeFromTakeover(
     TreeInodePtr root,
     const SerializedInodeMap& takeover) {
-  auto data = data_.wlock();
+  auto shards = lockAllShards();
 
-  CHECK_EQ(data->loadedInodes_.size(), 0)
-      << "cannot load InodeMap data over a populated instance";
-  CHECK_EQ(data->unloadedInodes_.size(), 0)
-      << "cannot load InodeMap data over a populated instance";
+  shards.forEach([](const Shard& shard) {
+    CHECK_EQ(shard.loadedInodes_.size(), 0)
+        << "cannot load InodeMap data over a populated instance";
+    CHECK_EQ(shard.unloadedInodes_.size(), 0)
+        << "cannot load InodeMap data over a populated instance";
+  });
 
   CHECK(!root_);
   root_ = std::move(root);
-  insertLoadedInode(data, root_.get());
-  DCHECK_EQ(1, data->numTreeInodes_);
-  DCHECK_EQ(0, data->numFileInodes_);
+  auto& rootShard = shards.forInode(root_->getNodeId());
+  insertLoadedInode(rootShard, root_.get());
+  DCHECK_EQ(1, rootShard.numTreeInodes_);
+  DCHECK_EQ(0, rootShard.numFileInodes_);
   for (const auto& entry : takeover.unloadedInodes) {
     if (entry.numFuseReferences < 0) {
       auto message = folly::to<std::string>(
@@ -153,8 +179,10 @@ void InodeMap::initializeFromTakeover(
                            : std::optional<Hash>{hashFromThrift(entry.hash)},
         folly::to<uint32_t>(entry.numFuseReferences));
 
-    auto result = data->unloadedInodes_.emplace(
-        InodeNumber::fromThrift(entry.inodeNumber), std::move(unloadedEntry));
+    auto inodeNumber = InodeNumber::fromThrift(entry.inodeNumber);
+    auto result = shards.forInode(inodeNumber)
+                      .unloadedInodes_.emplace(
+                          inodeNumber, std::move(unloadedEntry));
     if (!result.second) {
       auto message = folly::to<std::string>(
           "failed to emplace inode number ",
@@ -166,33 +194,52 @@ void InodeMap::initializeFromTakeover(
   }
 
   XLOG(DBG2) << "InodeMap initialized mount " << mount_->getPath()
-             << " from takeover, " << data->unloadedInodes_.size()
+             << " from takeover, " << takeover.unloadedInodes.size()
              << " inodes registered";
 }
 #endif
 
 Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
-  // Lock the data.
-  // We hold it while doing most of our work below, but explicitly unlock it
-  // before triggering inode loading or before fulfilling any Promises.
-  auto data = data_.wlock();
-
-  // Check to see if this Inode is already loaded
-  auto loadedIter = data->loadedInodes_.find(number);
-  if (loadedIter != data->loadedInodes_.end()) {
-    // Make a copy of the InodePtr with the lock held, then release the lock
-    // before calling makeFuture().
-    //
-    // This code path should be quite common, so it's better to perform
-    // makeFuture()'s memory allocation without the lock held.
+  {
+    // Check to see if this Inode is already loaded.  This only needs the
+    // inode's own shard.
+    auto shard = getShard(number).rlock();
+    auto loadedIter = shard->loadedInodes_.find(number);
+    if (loadedIter != shard->loadedInodes_.end()) {
+      // Make a copy of the InodePtr with the lock held, then release the lock
+      // before calling makeFuture().
+      //
+      // This code path should be quite common, so it's better to perform
+      // makeFuture()'s memory allocation without the lock held.
+      auto result = loadedIter->second.getPtr();
+      shard.unlock();
+      result->markAccessed();
+      return folly::makeFuture<InodePtr>(std::move(result));
+    }
+  }
+
+  return lookupUnloadedInode(number);
+}
+
+Future<InodePtr> InodeMap::lookupUnloadedInode(InodeNumber number) {
+  // Loading may require walking up through unloaded parents in other shards,
+  // so lock all of them.
+  // We hold them while doing most of our work below, but explicitly unlock
+  // them before triggering inode loading or before fulfilling any Promises.
+  auto shards = lockAllShards();
+
+  // The inode may have finished loading since lookupInode() checked.
+  auto* shard = &shards.forInode(number);
+  auto loadedIter = shard->loadedInodes_.find(number);
+  if (loadedIter != shard->loadedInodes_.end()) {
     auto result = loadedIter->second.getPtr();
-    data.unlock();
+    shards.unlock();
     return folly::makeFuture<InodePtr>(std::move(result));
   }
 
   // Look up the data in the unloadedInodes_ map.
-  auto unloadedIter = data->unloadedInodes_.find(number);
-  if (UNLIKELY(unloadedIter == data->unloadedInodes_.end())) {
+  auto unloadedIter = shard->unloadedInodes_.find(number);
+  if (UNLIKELY(unloadedIter == shard->unloadedInodes_.end())) {
     // This generally shouldn't happen.  If a InodeNumber has been allocated we
     // should always know about it.  It's a bug if our caller calls us with an
     // invalid InodeNumber number.
@@ -200,6 +247,12 @@ Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
         << "InodeMap called with unknown inode number " << number;
   }
 
+#ifndef _WIN32
+  if (RequestData::isFuseRequest()) {
+    RequestData::get().getEdenTopStats().setDidLoadInode();
+  }
+#endif // !_WIN32
+
   // Check to see if anyone else has already started loading this inode.
   auto* unloadedData = &unloadedIter->second;
   bool alreadyLoading = !unloadedData->promises.empty();
@@ -228,18 +281,19 @@ Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
   auto childInodeNumber = number;
   while (true) {
     // Check to see if this parent is loaded
-    loadedIter = data->loadedInodes_.find(unloadedData->parent);
-    if (loadedIter != data->loadedInodes_.end()) {
+    auto& parentShard = shards.forInode(unloadedData->parent);
+    loadedIter = parentShard.loadedInodes_.find(unloadedData->parent);
+    if (loadedIter != parentShard.loadedInodes_.end()) {
       // We found a loaded parent.
       // Grab copies of the arguments we need for startChildLookup(),
       // with the lock still held.
       InodePtr firstLoadedParent = loadedIter->second.getPtr();
-      PathComponent requiredChildName = unloadedData->name;
+      PathComponent requiredChildName{unloadedData->name.piece()};
       bool isUnlinked = unloadedData->isUnlinked;
       auto optionalHash = unloadedData->hash;
       auto mode = unloadedData->mode;
       // Unlock the data before starting the child lookup
-      data.unlock();
+      shards.unlock();
       // Trigger the lookup, then return to our caller.
       startChildLookup(
           firstLoadedParent,
@@ -252,15 +306,15 @@ Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
     }
 
     // Look up the parent in unloadedInodes_
-    unloadedIter = data->unloadedInodes_.find(unloadedData->parent);
-    if (UNLIKELY(unloadedIter == data->unloadedInodes_.end())) {
+    unloadedIter = parentShard.unloadedInodes_.find(unloadedData->parent);
+    if (UNLIKELY(unloadedIter == parentShard.unloadedInodes_.end())) {
       // This shouldn't happen.  We must know about the parent inode number if
       // we knew about the child.
       auto bug = EDEN_BUG_EXCEPTION()
           << "unknown parent inode " << unloadedData->parent << " (of "
           << unloadedData->name << ")";
       // Unlock our data before calling inodeLoadFailed()
-      data.unlock();
+      shards.unlock();
       inodeLoadFailed(childInodeNumber, bug);
       return result;
     }
@@ -349,9 +403,9 @@ InodeMap::PromiseVector InodeMap::inodeLoadComplete(InodeBase* inode) {
 
   PromiseVector promises;
   try {
-    auto data = data_.wlock();
-    auto it = data->unloadedInodes_.find(number);
-    CHECK(it != data->unloadedInodes_.end())
+    auto shard = getShard(number).wlock();
+    auto it = shard->unloadedInodes_.find(number);
+    CHECK(it != shard->unloadedInodes_.end())
         << "failed to find unloaded inode data when finishing load of inode "
         << number;
     swap(promises, it->second.promises);
@@ -359,8 +413,8 @@ InodeMap::PromiseVector InodeMap::inodeLoadComplete(InodeBase* inode) {
     inode->setFuseRefcount(it->second.numFuseReferences);
 
     // Insert the entry into loadedInodes_, and remove it from unloadedInodes_
-    insertLoadedInode(data, inode);
-    data->unloadedInodes_.erase(it);
+    insertLoadedInode(*shard, inode);
+    shard->unloadedInodes_.erase(it);
     return promises;
   } catch (const std::exception& ex) {
     XLOG(ERR) << "error marking inode " << number
@@ -387,9 +441,9 @@ void InodeMap::inodeLoadFailed(
 InodeMap::PromiseVector InodeMap::extractPendingPromises(InodeNumber number) {
   PromiseVector promises;
   {
-    auto data = data_.wlock();
-    auto it = data->unloadedInodes_.find(number);
-    CHECK(it != data->unloadedInodes_.end())
+    auto shard = getShard(number).wlock();
+    auto it = shard->unloadedInodes_.find(number);
+    CHECK(it != shard->unloadedInodes_.end())
         << "failed to find unloaded inode data when finishing load of inode "
         << number;
     swap(promises, it->second.promises);
@@ -408,9 +462,12 @@ Future<FileInodePtr> InodeMap::lookupFileInode(InodeNumber number) {
 }
 
 InodePtr InodeMap::lookupLoadedInode(InodeNumber number) {
-  auto data = data_.rlock();
-  auto it = data->loadedInodes_.find(number);
-  if (it == data->loadedInodes_.end()) {
+  // This is the hottest InodeMap call.  It only takes a shared lock on one
+  // shard, and does nothing under it but a hash lookup and one atomic
+  // increment.
+  auto shard = getShard(number).rlock();
+  auto it = shard->loadedInodes_.find(number);
+  if (it == shard->loadedInodes_.end()) {
     return nullptr;
   }
   return it->second.getPtr();
@@ -421,7 +478,8 @@ TreeInodePtr InodeMap::lookupLoadedTree(InodeNumber number) {
   if (!inode) {
     return nullptr;
   }
-  return inode.asTreePtr();
+  // Move the reference into the result rather than taking another one.
+  return std::move(inode).asTreePtr();
 }
 
 FileInodePtr InodeMap::lookupLoadedFile(InodeNumber number) {
@@ -429,52 +487,62 @@ FileInodePtr InodeMap::lookupLoadedFile(InodeNumber number) {
   if (!inode) {
     return nullptr;
   }
-  return inode.asFilePtr();
+  return std::move(inode).asFilePtr();
 }
 
 std::optional<RelativePath> InodeMap::getPathForInode(InodeNumber inodeNumber) {
-  auto data = data_.rlock();
-  return getPathForInodeHelper(inodeNumber, data);
-}
+  // Walk up through unloaded parents one shard at a time, collecting names
+  // until we reach a loaded inode or the root.
+  std::vector<PathComponent> names;
+  std::optional<RelativePath> base;
+  auto number = inodeNumber;
+  while (true) {
+    auto shard = getShard(number).rlock();
+    auto loadedIt = shard->loadedInodes_.find(number);
+    if (loadedIt != shard->loadedInodes_.cend()) {
+      // If the inode is loaded, start from its RelativePath
+      base = loadedIt->second->getPath();
+      break;
+    }
 
-std::optional<RelativePath> InodeMap::getPathForInodeHelper(
-    InodeNumber inodeNumber,
-    const folly::Synchronized<Members>::RLockedPtr& data) {
-  auto loadedIt = data->loadedInodes_.find(inodeNumber);
-  if (loadedIt != data->loadedInodes_.cend()) {
-    // If the inode is loaded, return its RelativePath
-    return loadedIt->second->getPath();
-  } else {
-    auto unloadedIt = data->unloadedInodes_.find(inodeNumber);
-    if (unloadedIt != data->unloadedInodes_.cend()) {
-      if (unloadedIt->second.isUnlinked) {
-        return std::nullopt;
-      }
-      // If the inode is not loaded, return its parent's path as long as it's
-      // parent isn't the root
-      auto parent = unloadedIt->second.parent;
-      if (parent == kRootNodeId) {
-        // The parent is the Eden mount root, just return its name (base case)
-        return RelativePath(unloadedIt->second.name);
-      }
-      auto dir = getPathForInodeHelper(parent, data);
-      if (!dir) {
-        EDEN_BUG() << "unlinked parent inode " << parent
-                   << "appears to contain non-unlinked child " << inodeNumber;
-      }
-      return *dir + unloadedIt->second.name;
-    } else {
-      throwSystemErrorExplicit(EINVAL, "unknown inode number ", inodeNumber);
+    auto unloadedIt = shard->unloadedInodes_.find(number);
+    if (unloadedIt == shard->unloadedInodes_.cend()) {
+      throwSystemErrorExplicit(EINVAL, "unknown inode number ", number);
     }
+    if (unloadedIt->second.isUnlinked) {
+      break;
+    }
+    names.emplace_back(unloadedIt->second.name.piece());
+    // If the inode is not loaded, continue with its parent as long as its
+    // parent isn't the root
+    auto parent = unloadedIt->second.parent;
+    if (parent == kRootNodeId) {
+      // The parent is the Eden mount root (base case)
+      base = RelativePath{};
+      break;
+    }
+    number = parent;
+  }
+
+  if (!base) {
+    if (!names.empty()) {
+      EDEN_BUG() << "unlinked parent inode " << number
+                 << "appears to contain non-unlinked child " << inodeNumber;
+    }
+    return std::nullopt;
   }
+  for (auto it = names.rbegin(); it != names.rend(); ++it) {
+    base = *base + *it;
+  }
+  return base;
 }
 
 void InodeMap::decFuseRefcount(InodeNumber number, uint32_t count) {
-  auto data = data_.wlock();
+  auto shard = getShard(number).wlock();
 
   // First check in the loaded inode map
-  auto loadedIter = data->loadedInodes_.find(number);
-  if (loadedIter != data->loadedInodes_.end()) {
+  auto loadedIter = shard->loadedInodes_.find(number);
+  if (loadedIter != shard->loadedInodes_.end()) {
     // Acquire an InodePtr, so that we are always holding a pointer reference
     // on the inode when we decrement the fuse refcount.
     //
@@ -484,14 +552,14 @@ void InodeMap::decFuseRefcount(InodeNumber number, uint32_t count) {
     auto inode = loadedIter->second.getPtr();
     // Now release our lock before decrementing the inode's FUSE reference
     // count and immediately releasing our pointer reference.
-    data.unlock();
+    shard.unlock();
     inode->decFuseRefcount(count);
     return;
   }
 
   // If it wasn't loaded, it should be in the unloaded map
-  auto unloadedIter = data->unloadedInodes_.find(number);
-  if (UNLIKELY(unloadedIter == data->unloadedInodes_.end())) {
+  auto unloadedIter = shard->unloadedInodes_.find(number);
+  if (UNLIKELY(unloadedIter == shard->unloadedInodes_.end())) {
     EDEN_BUG() << "InodeMap::decFuseRefcount() called on unknown inode number "
                << number;
   }
@@ -504,30 +572,48 @@ void InodeMap::decFuseRefcount(InodeNumber number, uint32_t count) {
     // We can completely forget about this unloaded inode now.
     XLOG(DBG5) << "forgetting unloaded inode " << number << ": "
                << unloadedEntry.parent << ":" << unloadedEntry.name;
-    data->unloadedInodes_.erase(unloadedIter);
+    shard->unloadedInodes_.erase(unloadedIter);
   }
 }
 
+uint32_t InodeMap::getApproximateFuseRefcount(InodeNumber number) const {
+  auto shard = getShard(number).rlock();
+  auto loadedIter = shard->loadedInodes_.find(number);
+  if (loadedIter != shard->loadedInodes_.end()) {
+    return loadedIter->second->getApproximateFuseRefcount();
+  }
+  auto unloadedIter = shard->unloadedInodes_.find(number);
+  if (unloadedIter != shard->unloadedInodes_.end()) {
+    return unloadedIter->second.numFuseReferences;
+  }
+  return 0;
+}
+
 void InodeMap::setUnmounted() {
-  auto data = data_.wlock();
-  DCHECK(!data->isUnmounted_);
-  data->isUnmounted_ = true;
+  auto wasUnmounted = isUnmounted_.exchange(true);
+  DCHECK(!wasUnmounted);
 }
 
 Future<SerializedInodeMap> InodeMap::shutdown(bool doTakeover) {
   // Record that we are in the process of shutting down.
   auto future = Future<folly::Unit>::makeEmpty();
   {
-    auto data = data_.wlock();
-    CHECK(!data->shutdownPromise.has_value())
+    auto shards = lockAllShards();
+    CHECK(!shuttingDown_.load())
         << "shutdown() invoked more than once on InodeMap for "
         << mount_->getPath();
-    data->shutdownPromise.emplace(Promise<Unit>{});
-    future = data->shutdownPromise->getFuture();
-
-    XLOG(DBG3) << "starting InodeMap::shutdown: loadedCount="
-               << data->loadedInodes_.size()
-               << " unloadedCount=" << data->unloadedInodes_.size();
+    shutdownPromise_.emplace(Promise<Unit>{});
+    future = shutdownPromise_->getFuture();
+    shuttingDown_.store(true);
+
+    size_t loadedCount = 0;
+    size_t unloadedCount = 0;
+    shards.forEach([&](const Shard& shard) {
+      loadedCount += shard.loadedInodes_.size();
+      unloadedCount += shard.unloadedInodes_.size();
+    });
+    XLOG(DBG3) << "starting InodeMap::shutdown: loadedCount=" << loadedCount
+               << " unloadedCount=" << unloadedCount;
   }
 
   // If an error occurs during mount point initialization, shutdown() can be
@@ -564,19 +650,20 @@ Future<SerializedInodeMap> InodeMap::shutdown(bool doTakeover) {
     // to them, then let the normal pointer release process be responsible for
     // unloading them.
     std::vector<InodePtr> inodesToUnload;
-    auto data = data_.wlock();
-    for (const auto& entry : data->loadedInodes_) {
-      if (!entry.second->isPtrAcquireCountZero()) {
-        continue;
+    for (auto& lockedShard : shards_) {
+      auto shard = lockedShard.wlock();
+      for (const auto& entry : shard->loadedInodes_) {
+        if (!entry.second->isPtrAcquireCountZero()) {
+          continue;
+        }
+        if (!entry.second->isUnlinked()) {
+          continue;
+        }
+        inodesToUnload.push_back(entry.second.getPtr());
       }
-      if (!entry.second->isUnlinked()) {
-        continue;
-      }
-      inodesToUnload.push_back(entry.second.getPtr());
     }
-    // Release the lock, then release all of our InodePtrs to unload
+    // Release the locks, then release all of our InodePtrs to unload
     // the inodes.
-    data.unlock();
     inodesToUnload.clear();
   }
 
@@ -598,45 +685,51 @@ Future<SerializedInodeMap> InodeMap::shutdown(bool doTakeover) {
       return SerializedInodeMap{};
     }
 
-    auto data = data_.wlock();
+    auto shards = lockAllShards();
+    size_t loadedCount = 0;
+    size_t unloadedCount = 0;
+    shards.forEach([&](const Shard& shard) {
+      loadedCount += shard.loadedInodes_.size();
+      unloadedCount += shard.unloadedInodes_.size();
+    });
     XLOG(DBG3)
         << "InodeMap::shutdown after releasing inodesToClear: loadedCount="
-        << data->loadedInodes_.size()
-        << " unloadedCount=" << data->unloadedInodes_.size();
+        << loadedCount << " unloadedCount=" << unloadedCount;
 
-    if (data->loadedInodes_.size() != 1) {
-      EDEN_BUG() << "After InodeMap::shutdown() finished, "
-                 << data->loadedInodes_.size()
+    if (loadedCount != 1) {
+      EDEN_BUG() << "After InodeMap::shutdown() finished, " << loadedCount
                  << " inodes still loaded; they must all (except the root) "
                  << "have been unloaded for this to succeed!";
     }
 
     SerializedInodeMap result;
-    result.unloadedInodes.reserve(data->unloadedInodes_.size());
-    for (const auto& [inodeNumber, entry] : data->unloadedInodes_) {
-      SerializedInodeMapEntry serializedEntry;
-
-      XLOG(DBG5) << "  serializing unloaded inode " << inodeNumber
-                 << " parent=" << entry.parent.get() << " name=" << entry.name;
-
-      serializedEntry.inodeNumber = inodeNumber.get();
-      serializedEntry.parentInode = entry.parent.get();
-      serializedEntry.name = entry.name.stringPiece().str();
-      serializedEntry.isUnlinked = entry.isUnlinked;
-      serializedEntry.numFuseReferences = entry.numFuseReferences;
-      serializedEntry.hash = thriftHash(entry.hash);
-      serializedEntry.mode = entry.mode;
-
-      result.unloadedInodes.emplace_back(std::move(serializedEntry));
-    }
+    result.unloadedInodes.reserve(unloadedCount);
+    shards.forEach([&](const Shard& shard) {
+      for (const auto& [inodeNumber, entry] : shard.unloadedInodes_) {
+        SerializedInodeMapEntry serializedEntry;
+
+        XLOG(DBG5) << "  serializing unloaded inode " << inodeNumber
+                   << " parent=" << entry.parent.get()
+                   << " name=" << entry.name;
+
+        serializedEntry.inodeNumber = inodeNumber.get();
+        serializedEntry.parentInode = entry.parent.get();
+        serializedEntry.name = entry.name.stringPiece().str();
+        serializedEntry.isUnlinked = entry.isUnlinked;
+        serializedEntry.numFuseReferences = entry.numFuseReferences;
+        serializedEntry.hash = thriftHash(entry.hash);
+        serializedEntry.mode = entry.mode;
+
+        result.unloadedInodes.emplace_back(std::move(serializedEntry));
+      }
+    });
 
     return result;
 #endif
   });
 }
 
-void InodeMap::shutdownComplete(
-    folly::Synchronized<Members>::LockedPtr&& data) {
+void InodeMap::shutdownComplete(LockedShards&& shards) {
   // We manually dropped our reference count to the root inode in
   // beginShutdown().  Destroy it now, and call resetNoDecRef() on our pointer
   // to make sure it doesn't try to decrement the reference count again when
@@ -644,16 +737,15 @@ void InodeMap::shutdownComplete(
   delete root_.get();
   root_.resetNoDecRef();
 
-  // Unlock data_ before fulfilling the shutdown promise, just in case the
-  // promise invokes a callback that calls some of our other methods that
-  // may need to acquire this lock.
-  auto* shutdownPromise = &data->shutdownPromise.value();
-  data.unlock();
-  shutdownPromise->setValue();
+  // Unlock the shards before fulfilling the shutdown promise, just in case
+  // the promise invokes a callback that calls some of our other methods that
+  // may need to acquire these locks.
+  shards.unlock();
+  shutdownPromise_->setValue();
 }
 
 bool InodeMap::isInodeRemembered(InodeNumber ino) const {
-  return data_.rlock()->unloadedInodes_.count(ino) > 0;
+  return getShard(ino).rlock()->unloadedInodes_.count(ino) > 0;
 }
 
 void InodeMap::onInodeUnreferenced(
@@ -661,8 +753,28 @@ void InodeMap::onInodeUnreferenced(
     ParentInodeInfo&& parentInfo) {
   XLOG(DBG8) << "inode " << inode->getNodeId()
              << " unreferenced: " << inode->getLogPath();
-  // Acquire our lock.
-  auto data = data_.wlock();
+
+  // Inodes are only unloaded here while shutting down, or once they are
+  // unlinked and have no FUSE references.  Unloading needs every shard (a
+  // tree's children can live in any of them), but in all other cases we only
+  // need to decrement the acquire count under the inode's own shard lock.
+  //
+  // If shutdown starts after this check the inode simply stays loaded.  We
+  // hold the parent's contents lock, so shutdown's walk from the root cannot
+  // pass this inode until we are done, and it unloads the inode then.
+  if (!shuttingDown_.load() && !parentInfo.isUnlinked()) {
+    DCHECK(inode != root_.get());
+    auto shard = getShard(inode->getNodeId()).wlock();
+    inode->decPtrAcquireCount();
+    // In this case:
+    // - If the inode is materialized, we should never unload it.
+    // - Otherwise, we have the option to unload it or not.
+    //   For now we choose to always keep it loaded.
+    return;
+  }
+
+  // Acquire our locks.
+  auto shards = lockAllShards();
 
   // Decrement the Inode's acquire count
   auto acquireCount = inode->decPtrAcquireCount();
@@ -674,13 +786,13 @@ void InodeMap::onInodeUnreferenced(
 
   // Decide if we should unload the inode now, or wait until later.
   bool unloadNow = false;
-  bool shuttingDown = data->shutdownPromise.has_value();
+  bool shuttingDown = shuttingDown_.load();
   DCHECK(shuttingDown || inode != root_.get());
   if (shuttingDown) {
     // Check to see if this was the root inode that got unloaded.
     // This indicates that the shutdown is complete.
     if (inode == root_.get()) {
-      shutdownComplete(std::move(data));
+      shutdownComplete(std::move(shards));
       return;
     }
 
@@ -691,11 +803,6 @@ void InodeMap::onInodeUnreferenced(
     // This inode has been unlinked and has no outstanding FUSE references.
     // This inode can now be completely destroyed and forgotten about.
     unloadNow = true;
-  } else {
-    // In other cases:
-    // - If the inode is materialized, we should never unload it.
-    // - Otherwise, we have the option to unload it or not.
-    //   For now we choose to always keep it loaded.
   }
 
   if (unloadNow) {
@@ -704,7 +811,7 @@ void InodeMap::onInodeUnreferenced(
         parentInfo.getParent().get(),
         parentInfo.getName(),
         parentInfo.isUnlinked(),
-        data);
+        shards);
     if (!parentInfo.isUnlinked()) {
       const auto& parentContents = parentInfo.getParentContents();
       auto it = parentContents->entries.find(parentInfo.getName());
@@ -718,7 +825,7 @@ void InodeMap::onInodeUnreferenced(
   // Deleting it may cause its parent TreeInode to become unreferenced, causing
   // another recursive call to onInodeUnreferenced(), which will need to
   // reacquire the lock.
-  data.unlock();
+  shards.unlock();
   parentInfo.reset();
   if (unloadNow) {
     delete inode;
@@ -726,7 +833,7 @@ void InodeMap::onInodeUnreferenced(
 }
 
 InodeMapLock InodeMap::lockForUnload() {
-  return InodeMapLock{data_.wlock()};
+  return InodeMapLock{lockAllShards()};
 }
 
 void InodeMap::unloadInode(
@@ -735,7 +842,7 @@ void InodeMap::unloadInode(
     PathComponentPiece name,
     bool isUnlinked,
     const InodeMapLock& lock) {
-  return unloadInode(inode, parent, name, isUnlinked, lock.data_);
+  return unloadInode(inode, parent, name, isUnlinked, lock.shards_);
 }
 
 void InodeMap::unloadInode(
@@ -743,27 +850,28 @@ void InodeMap::unloadInode(
     TreeInode* parent,
     PathComponentPiece name,
     bool isUnlinked,
-    const folly::Synchronized<Members>::LockedPtr& data) {
+    const LockedShards& shards) {
   // Call updateOverlayForUnload() to update the overlay and compute
   // if we need to remember an UnloadedInode entry.
   auto unloadedEntry =
-      updateOverlayForUnload(inode, parent, name, isUnlinked, data);
+      updateOverlayForUnload(inode, parent, name, isUnlinked, shards);
+  auto& shard = shards.forInode(inode->getNodeId());
   if (unloadedEntry) {
     // Insert the unloaded entry
     XLOG(DBG7) << "inserting unloaded map entry for inode "
                << inode->getNodeId();
-    auto ret = data->unloadedInodes_.emplace(
+    auto ret = shard.unloadedInodes_.emplace(
         inode->getNodeId(), std::move(unloadedEntry.value()));
     CHECK(ret.second);
   }
 
-  auto numErased = data->loadedInodes_.erase(inode->getNodeId());
+  auto numErased = shard.loadedInodes_.erase(inode->getNodeId());
   CHECK_EQ(numErased, 1) << "inconsistent loaded inodes data: "
                          << inode->getLogPath();
   if (inode->getType() == dtype_t::Dir) {
-    --data->numTreeInodes_;
+    --shard.numTreeInodes_;
   } else {
-    --data->numFileInodes_;
+    --shard.numFileInodes_;
   }
 }
 
@@ -772,9 +880,10 @@ optional<InodeMap::UnloadedInode> InodeMap::updateOverlayForUnload(
     TreeInode* parent,
     PathComponentPiece name,
     bool isUnlinked,
-    const folly::Synchronized<Members>::LockedPtr& data) {
+    const LockedShards& shards) {
   auto fuseCount = inode->getFuseRefcount();
-  if (isUnlinked && (data->isUnmounted_ || fuseCount == 0)) {
+  auto isUnmounted = isUnmounted_.load();
+  if (isUnlinked && (isUnmounted || fuseCount == 0)) {
     try {
       mount_->getOverlay()->removeOverlayData(inode->getNodeId());
     } catch (const std::exception& ex) {
@@ -797,7 +906,7 @@ optional<InodeMap::UnloadedInode> InodeMap::updateOverlayForUnload(
   // refcounts on inodes that still existed before it was unmounted.
   // Everything is unreferenced by FUSE after an unmount operation, and we no
   // longer need to remember anything in the unloadedInodes_ map.
-  if (data->isUnmounted_) {
+  if (isUnmounted) {
     XLOG(DBG5) << "forgetting unreferenced inode " << inode->getNodeId()
                << " after unmount: " << inode->getLogPath();
     return std::nullopt;
@@ -834,7 +943,8 @@ optional<InodeMap::UnloadedInode> InodeMap::updateOverlayForUnload(
     for (const auto& pair : treeContents.entries) {
       const auto& childName = pair.first;
       const auto& entry = pair.second;
-      if (data->unloadedInodes_.count(entry.getInodeNumber())) {
+      auto childNumber = entry.getInodeNumber();
+      if (shards.forInode(childNumber).unloadedInodes_.count(childNumber)) {
         XLOG(DBG5) << "remembering inode " << asTree->getNodeId() << " ("
                    << asTree->getLogPath() << ") because its child "
                    << childName << " was remembered";
@@ -864,14 +974,14 @@ bool InodeMap::shouldLoadChild(
     PathComponentPiece name,
     InodeNumber childInode,
     folly::Promise<InodePtr> promise) {
-  auto data = data_.wlock();
+  auto shard = getShard(childInode).wlock();
   UnloadedInode* unloadedData{nullptr};
-  auto iter = data->unloadedInodes_.find(childInode);
-  if (iter == data->unloadedInodes_.end()) {
+  auto iter = shard->unloadedInodes_.find(childInode);
+  if (iter == shard->unloadedInodes_.end()) {
     InodeNumber parentNumber = parent->getNodeId();
     auto newUnloadedData = UnloadedInode(parentNumber, name);
     auto ret =
-        data->unloadedInodes_.emplace(childInode, std::move(newUnloadedData));
+        shard->unloadedInodes_.emplace(childInode, std::move(newUnloadedData));
     DCHECK(ret.second);
     unloadedData = &ret.first->second;
   } else {
@@ -892,33 +1002,38 @@ bool InodeMap::shouldLoadChild(
 void InodeMap::inodeCreated(const InodePtr& inode) {
   XLOG(DBG4) << "created new inode " << inode->getNodeId() << ": "
              << inode->getLogPath();
-  auto data = data_.wlock();
-  insertLoadedInode(data, inode.get());
+  auto shard = getShard(inode->getNodeId()).wlock();
+  insertLoadedInode(*shard, inode.get());
 }
 
 InodeMap::InodeCounts InodeMap::getInodeCounts() const {
+  // Each shard is counted under its own lock, so the totals are not a
+  // consistent snapshot of the whole map.  That is fine for statistics.
   InodeCounts counts;
-  auto data = data_.rlock();
-  DCHECK_EQ(
-      data->numTreeInodes_ + data->numFileInodes_, data->loadedInodes_.size());
-  counts.treeCount = data->numTreeInodes_;
-  counts.fileCount = data->numFileInodes_;
-  counts.unloadedInodeCount = data->unloadedInodes_.size();
+  for (const auto& lockedShard : shards_) {
+    auto shard = lockedShard.rlock();
+    DCHECK_EQ(
+        shard->numTreeInodes_ + shard->numFileInodes_,
+        shard->loadedInodes_.size());
+    counts.treeCount += shard->numTreeInodes_;
+    counts.fileCount += shard->numFileInodes_;
+    counts.unloadedInodeCount += shard->unloadedInodes_.size();
+  }
   return counts;
 }
 
 std::vector<InodeNumber> InodeMap::getReferencedInodes() const {
   std::vector<InodeNumber> inodes;
-  {
-    auto data = data_.rlock();
+  for (const auto& lockedShard : shards_) {
+    auto shard = lockedShard.rlock();
 
-    for (auto& kv : data->loadedInodes_) {
+    for (auto& kv : shard->loadedInodes_) {
       auto& loadedInode = kv.second;
 
       inodes.push_back(loadedInode->getNodeId());
     }
 
-    for (const auto& [ino, unloadedInode] : data->unloadedInodes_) {
+    for (const auto& [ino, unloadedInode] : shard->unloadedInodes_) {
       if (unloadedInode.numFuseReferences > 0) {
         inodes.push_back(ino);
       }
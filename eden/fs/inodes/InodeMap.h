@@ -8,7 +8,10 @@
 #pragma once
 
 #include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
 #include <folly/futures/Future.h>
+#include <array>
+#include <atomic>
 #include <list>
 #include <memory>
 #include <optional>
@@ -16,6 +19,7 @@
 
 #include "eden/fs/inodes/InodePtr.h"
 #include "eden/fs/model/Hash.h"
+#include "eden/fs/utils/InternedPathComponent.h"
 #include "eden/fs/utils/PathFuncs.h"
 
 #ifndef _WIN32
@@ -45,7 +49,7 @@ struct UnloadedInodeData {
   UnloadedInodeData(InodeNumber p, PathComponentPiece n) : parent(p), name(n) {}
 
   InodeNumber const parent;
-  PathComponent const name;
+  InternedPathComponent const name;
 };
 
 class InodeMapLock;
@@ -237,6 +241,13 @@ class InodeMap {
    */
   void decFuseRefcount(InodeNumber number, uint32_t count = 1);
 
+  /**
+   * Returns the number of outstanding FUSE references to an inode number,
+   * whether or not it is loaded, without loading it.  The count may already
+   * be stale when it is returned.
+   */
+  uint32_t getApproximateFuseRefcount(InodeNumber number) const;
+
   /**
    * Indicate that the mount point has been unmounted.
    *
@@ -425,7 +436,11 @@ class InodeMap {
         uint32_t fuseRefcount);
 
     InodeNumber const parent;
-    PathComponent const name;
+    /**
+     * Interned, since the same few names (src, BUCK, __init__.py, ...) show
+     * up under many of the unloaded directories we remember.
+     */
+    InternedPathComponent const name;
 
     /**
      * A boolean indicating if this inode is unlinked.
@@ -452,7 +467,7 @@ class InodeMap {
      *
      * (We could use folly::SharedPromise here instead, but it has extra
      * overhead that we don't really need.  It performs its own locking, but we
-     * are already protected by the data_ lock.)
+     * are already protected by the shard lock.)
      */
     PromiseVector promises;
     /**
@@ -477,7 +492,7 @@ class InodeMap {
 
     InodePtr getPtr() const {
       // Calling InodePtr::newPtrLocked is safe because interacting with
-      // LoadedInode implies the data_ lock is held.
+      // LoadedInode implies the lock for its shard is held.
       return InodePtr::newPtrLocked(inode_);
     }
 
@@ -496,7 +511,14 @@ class InodeMap {
     InodeBase* inode_{nullptr};
   };
 
-  struct Members {
+  /**
+   * The inodes whose numbers hash to one shard of the InodeMap.
+   *
+   * Sharding keeps FUSE requests for unrelated inodes from contending on a
+   * single lock.  An inode's loaded and unloaded entries always live in the
+   * same shard.
+   */
+  struct Shard {
     /**
      * The map of loaded inodes
      *
@@ -504,22 +526,18 @@ class InodeMap {
      * itself does not hold a reference to the Inode objects.  When an Inode is
      * looked up the InodeMap will wrap the Inode in an InodePtr so that the
      * caller acquires a reference.
+     *
+     * This is an F14 map, rather than std::unordered_map, to keep lookups
+     * under the shard lock short; nothing holds references to its entries
+     * across an insertion.
      */
-    std::unordered_map<InodeNumber, LoadedInode> loadedInodes_;
+    folly::F14FastMap<InodeNumber, LoadedInode> loadedInodes_;
 
     /**
      * The map of currently unloaded inodes
      */
     std::unordered_map<InodeNumber, UnloadedInode> unloadedInodes_;
 
-    /**
-     * Indicates if the FUSE mount point has been unmounted.
-     *
-     * If this is true then the FUSE refcount on all inodes should be treated
-     * as 0, and we can forget all inodes while shutting down.
-     */
-    bool isUnmounted_{false};
-
     /**
      * The number of loaded TreeInode objects
      */
@@ -533,25 +551,58 @@ class InodeMap {
      * hold true to make sure our calculations are correct.
      */
     size_t numFileInodes_{0};
+  };
 
-    /**
-     * A promise to fulfill once shutdown() completes.
-     *
-     * This is only initialized when shutdown() is called, and will be
-     * std::nullopt until we are shutting down.
-     *
-     * In the future we could update this to just use an empty promise to
-     * indicate that we are not shutting down yet.  However, currently
-     * folly::Promise does not have a simple API to check if it is empty or not,
-     * so we have to wrap it in a std::optional.
-     */
-    std::optional<folly::Promise<folly::Unit>> shutdownPromise;
+  static constexpr size_t kNumShards = 32;
+  using ShardArray = std::array<folly::Synchronized<Shard>, kNumShards>;
+
+  /**
+   * The write locks of every shard, acquired in shard order.
+   *
+   * Operations that need more than one inode's entry hold this: walking up
+   * through unloaded parents, checking a tree's children when unloading it,
+   * and visiting every inode.  Operations on a single inode only lock that
+   * inode's shard, and never lock a second shard while holding it, so
+   * acquiring all shards in order cannot deadlock.
+   */
+  class LockedShards {
+   public:
+    explicit LockedShards(ShardArray& shards);
+
+    Shard& forInode(InodeNumber number) const {
+      return *locks_[shardIndex(number)];
+    }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+      for (auto& lock : locks_) {
+        fn(*lock);
+      }
+    }
+
+    void unlock();
+
+   private:
+    std::array<folly::Synchronized<Shard>::LockedPtr, kNumShards> locks_;
   };
 
+  static size_t shardIndex(InodeNumber number);
+
+  folly::Synchronized<Shard>& getShard(InodeNumber number) {
+    return shards_[shardIndex(number)];
+  }
+  const folly::Synchronized<Shard>& getShard(InodeNumber number) const {
+    return shards_[shardIndex(number)];
+  }
+
+  LockedShards lockAllShards() {
+    return LockedShards{shards_};
+  }
+
   InodeMap(InodeMap const&) = delete;
   InodeMap& operator=(InodeMap const&) = delete;
 
-  void shutdownComplete(folly::Synchronized<Members>::LockedPtr&& data);
+  void shutdownComplete(LockedShards&& shards);
 
   void setupParentLookupPromise(
       folly::Promise<InodePtr>& promise,
@@ -572,14 +623,16 @@ class InodeMap {
    * Extract the list of promises waiting on the specified inode number to be
    * loaded.
    *
-   * This method acquires the data_ lock internally.
-   * It should never be called while already holding the lock.
+   * This method acquires the inode's shard lock internally.
+   * It should never be called while already holding any shard lock.
    */
   PromiseVector extractPendingPromises(InodeNumber number);
 
-  std::optional<RelativePath> getPathForInodeHelper(
-      InodeNumber inodeNumber,
-      const folly::Synchronized<Members>::RLockedPtr& data);
+  /**
+   * The part of lookupInode() that runs when the inode is not loaded and we
+   * may have to walk up through its unloaded parents.
+   */
+  folly::Future<InodePtr> lookupUnloadedInode(InodeNumber number);
 
   /**
    * Unload an inode
@@ -595,7 +648,7 @@ class InodeMap {
       TreeInode* parent,
       PathComponentPiece name,
       bool isUnlinked,
-      const folly::Synchronized<Members>::LockedPtr& lock);
+      const LockedShards& shards);
 
   /**
    * Update the overlay data for an inode before unloading it.
@@ -609,11 +662,9 @@ class InodeMap {
       TreeInode* parent,
       PathComponentPiece name,
       bool isUnlinked,
-      const folly::Synchronized<Members>::LockedPtr& lock);
+      const LockedShards& shards);
 
-  void insertLoadedInode(
-      const folly::Synchronized<Members>::LockedPtr& data,
-      InodeBase* inode);
+  static void insertLoadedInode(Shard& shard, InodeBase* inode);
 
   /**
    * The EdenMount that owns this InodeMap.
@@ -629,16 +680,38 @@ class InodeMap {
   TreeInodePtr root_;
 
   /**
-   * The locked data.
+   * Indicates if the FUSE mount point has been unmounted.
    *
-   * Note: be very careful to hold this lock only when necessary.  No other
-   * locks should be acquired when holding this lock.  In particular this means
-   * that we should never access any InodeBase objects while holding the lock,
-   * since we should not hold our lock while an InodeBase acquires its own
-   * internal lock.  (This makes it safe for InodeBase to perform operations on
-   * the InodeMap while holding their own lock.)
+   * If this is true then the FUSE refcount on all inodes should be treated
+   * as 0, and we can forget all inodes while shutting down.
+   */
+  std::atomic<bool> isUnmounted_{false};
+
+  /**
+   * Set once shutdown() has been called.
+   */
+  std::atomic<bool> shuttingDown_{false};
+
+  /**
+   * A promise to fulfill once shutdown() completes.
+   *
+   * This is emplaced by shutdown() before it releases its reference on the
+   * root inode, and only fulfilled once the root becomes unreferenced, so it
+   * needs no lock of its own.
+   */
+  std::optional<folly::Promise<folly::Unit>> shutdownPromise_;
+
+  /**
+   * The locked data, sharded by inode number.
+   *
+   * Note: be very careful to hold these locks only when necessary.  No other
+   * locks should be acquired when holding one.  In particular this means
+   * that we should never access any InodeBase objects while holding a shard
+   * lock, since we should not hold our lock while an InodeBase acquires its
+   * own internal lock.  (This makes it safe for InodeBase to perform
+   * operations on the InodeMap while holding their own lock.)
    */
-  folly::Synchronized<Members> data_;
+  ShardArray shards_;
 };
 
 /**
@@ -650,17 +723,16 @@ class InodeMap {
  */
 class InodeMapLock {
  public:
-  explicit InodeMapLock(
-      folly::Synchronized<InodeMap::Members>::LockedPtr&& data)
-      : data_(std::move(data)) {}
+  explicit InodeMapLock(InodeMap::LockedShards&& shards)
+      : shards_(std::move(shards)) {}
 
   void unlock() {
-    data_.unlock();
+    shards_.unlock();
   }
 
  private:
   friend class InodeMap;
-  folly::Synchronized<InodeMap::Members>::LockedPtr data_;
+  InodeMap::LockedShards shards_;
 };
 } // namespace eden
 } // namespace facebook
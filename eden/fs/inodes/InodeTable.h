@@ -8,8 +8,10 @@
 #pragma once
 
 #include <optional>
+#include <vector>
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/inodes/InodeMetadata.h"
+#include "eden/fs/inodes/InodeTableIndex.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/MappedDiskVector.h"
 
@@ -63,7 +65,8 @@ struct InodeTableEntry {
  *
  * The index from inode number to record index is wrapped in a SharedMutex.
  * Most accesses will only take a reader lock unless a new entry is added or
- * an inode number is removed.
+ * an inode number is removed.  The index is a flat InodeTableIndex built
+ * with its final size when the table is opened.
  *
  * The contents of each record itself is protected by the FileInode and
  * TreeInode's locks.
@@ -154,11 +157,10 @@ class InodeTable {
    */
   std::optional<Record> getOptional(InodeNumber ino) {
     return state_.withRLock([&](const auto& state) -> std::optional<Record> {
-      auto iter = state.indices.find(ino);
-      if (iter == state.indices.end()) {
+      auto index = state.indices.find(ino);
+      if (index == InodeTableIndex::kNotFound) {
         return std::nullopt;
       } else {
-        auto index = iter->second;
         CHECK_LT(index, state.storage.size());
         return state.storage[index].record;
       }
@@ -175,12 +177,11 @@ class InodeTable {
   template <typename ModFn>
   Record modifyOrThrow(InodeNumber ino, ModFn&& fn) {
     return state_.withRLock([&](auto& state) {
-      auto iter = state.indices.find(ino);
-      if (iter == state.indices.end()) {
+      auto index = state.indices.find(ino);
+      if (index == InodeTableIndex::kNotFound) {
         throw std::out_of_range(
             folly::to<std::string>("no entry in InodeTable for inode ", ino));
       }
-      auto index = iter->second;
       CHECK_LT(index, state.storage.size());
       fn(state.storage[index].record);
       // TODO: maybe trigger a background msync
@@ -188,36 +189,22 @@ class InodeTable {
     });
   }
 
-  // TODO: replace with freeInodes - it's much more efficient to free a bunch
-  // at once.
   void freeInode(InodeNumber ino) {
-    state_.withWLock([&](auto& state) {
-      auto& storage = state.storage;
-      auto& indices = state.indices;
-
-      auto iter = indices.find(ino);
-      if (iter == indices.end()) {
-        // While transitioning metadata from the overlay to the
-        // InodeMetadataTable, it is common for there to be no metadata for an
-        // inode whose number is known. The Overlay calls freeInode()
-        // unconditionally, so simply do nothing.
-        return;
-      }
-
-      size_t indexToDelete = iter->second;
-      indices.erase(iter);
-
-      DCHECK_GT(storage.size(), 0);
-      size_t lastIndex = storage.size() - 1;
-
-      if (lastIndex != indexToDelete) {
-        auto lastInode = storage[lastIndex].inode;
-        storage[indexToDelete] = storage[lastIndex];
-        indices[lastInode] = indexToDelete;
-      }
+    state_.withWLock([&](auto& state) { freeLocked(state, ino); });
+  }
 
-      storage.pop_back();
-    });
+  /**
+   * Remove the records for many inodes while taking the table's lock only
+   * once.  Inodes without a record are skipped.
+   */
+  void freeInodes(const std::vector<InodeNumber>& inodes) {
+    if (inodes.empty()) {
+      return;
+    }
+    auto state = state_.wlock();
+    for (auto ino : inodes) {
+      freeLocked(*state, ino);
+    }
   }
 
   /**
@@ -229,14 +216,24 @@ class InodeTable {
   template <typename ModifyFn>
   void forEachModify(ModifyFn&& fn) {
     auto state = state_.wlock();
-    for (auto& entry : state->indices) {
-      const auto& inode = entry.first;
-      auto index = entry.second;
-      auto& record = state->storage[index].record;
-      fn(inode, record);
+    // Walk the records in storage order rather than through the index, so
+    // that a table with millions of entries is read and dirtied
+    // sequentially instead of one random page at a time.
+    auto& storage = state->storage;
+    for (size_t i = 0; i < storage.size(); ++i) {
+      fn(storage[i].inode, storage[i].record);
     }
   }
 
+  /**
+   * Write the table's modified records back to disk.  InodeTable normally
+   * leaves this to the kernel; callers that just changed many records can
+   * use this to start (wait=false) or finish (wait=true) the writeback.
+   */
+  void sync(bool wait) {
+    state_.rlock()->storage.sync(wait);
+  }
+
  private:
   explicit InodeTable(MappedDiskVector<Entry>&& storage)
       : state_{folly::in_place, std::move(storage)} {}
@@ -270,9 +267,8 @@ class InodeTable {
     // modify immediately.
     {
       auto state = state_.rlock();
-      auto iter = state->indices.find(ino);
-      if (LIKELY(iter != state->indices.end())) {
-        auto index = iter->second;
+      auto index = state->indices.find(ino);
+      if (LIKELY(index != InodeTableIndex::kNotFound)) {
         return modify(state->storage[index].record);
       }
     }
@@ -283,26 +279,54 @@ class InodeTable {
 
     auto state = state_.wlock();
     // Check again - something may have raced between the locks.
-    auto iter = state->indices.find(ino);
-    if (UNLIKELY(iter != state->indices.end())) {
-      auto index = iter->second;
-      return modify(state->storage[index].record);
+    auto existing = state->indices.find(ino);
+    if (UNLIKELY(existing != InodeTableIndex::kNotFound)) {
+      return modify(state->storage[existing].record);
     }
 
     size_t index = state->storage.size();
     state->storage.emplace_back(ino, record);
-    state->indices.emplace(ino, index);
+    state->indices.insert(ino, index);
     return result(state->storage[index].record);
   }
 
+  struct State;
+
+  static void freeLocked(State& state, InodeNumber ino) {
+    auto& storage = state.storage;
+    auto& indices = state.indices;
+
+    size_t indexToDelete = indices.find(ino);
+    if (indexToDelete == InodeTableIndex::kNotFound) {
+      // While transitioning metadata from the overlay to the
+      // InodeMetadataTable, it is common for there to be no metadata for an
+      // inode whose number is known. The Overlay calls freeInode()
+      // unconditionally, so simply do nothing.
+      return;
+    }
+
+    indices.erase(ino);
+
+    DCHECK_GT(storage.size(), 0);
+    size_t lastIndex = storage.size() - 1;
+
+    if (lastIndex != indexToDelete) {
+      auto lastInode = storage[lastIndex].inode;
+      storage[indexToDelete] = storage[lastIndex];
+      indices.assign(lastInode, indexToDelete);
+    }
+
+    storage.pop_back();
+  }
+
   struct State {
-    State(MappedDiskVector<Entry>&& mdv) : storage{std::move(mdv)} {
+    State(MappedDiskVector<Entry>&& mdv)
+        : storage{std::move(mdv)}, indices{storage.size()} {
       for (size_t i = 0; i < storage.size(); ++i) {
         const Entry& entry = storage[i];
-        auto ret = indices.insert({entry.inode, i});
-        if (!ret.second) {
+        if (!indices.insert(entry.inode, i)) {
           XLOG(WARNING) << "Duplicate records for the same inode: indices "
-                        << indices[entry.inode] << " and " << i;
+                        << indices.find(entry.inode) << " and " << i;
           continue;
         }
       }
@@ -320,7 +344,7 @@ class InodeTable {
     mutable MappedDiskVector<Entry> storage;
 
     /// Maintains an index from inode number to index in storage_.
-    std::unordered_map<InodeNumber, size_t> indices;
+    InodeTableIndex indices;
   };
 
   folly::Synchronized<State> state_;
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/InodeTableIndex.h"
+
+#include <folly/hash/Hash.h>
+#include <folly/lang/Bits.h>
+
+namespace facebook {
+namespace eden {
+
+namespace {
+constexpr size_t kMinSlots = 16;
+
+// Linear probing degrades quickly past this load factor.
+constexpr size_t kMaxLoadNumerator = 7;
+constexpr size_t kMaxLoadDenominator = 10;
+
+size_t slotsForSize(size_t size) {
+  return folly::nextPowTwo(std::max(
+      kMinSlots, size * kMaxLoadDenominator / kMaxLoadNumerator + 1));
+}
+} // namespace
+
+InodeTableIndex::InodeTableIndex(size_t expectedSize)
+    : slots_(slotsForSize(expectedSize), Slot{0, 0}),
+      mask_{slots_.size() - 1} {}
+
+size_t InodeTableIndex::slotFor(uint64_t ino) const {
+  // Inode numbers are allocated sequentially, so mix them before masking.
+  return folly::hash::twang_mix64(ino) & mask_;
+}
+
+size_t InodeTableIndex::probe(uint64_t ino) const {
+  auto slot = slotFor(ino);
+  while (slots_[slot].ino != ino && slots_[slot].ino != 0) {
+    slot = (slot + 1) & mask_;
+  }
+  return slot;
+}
+
+bool InodeTableIndex::insert(InodeNumber ino, size_t index) {
+  auto slot = probe(ino.get());
+  if (slots_[slot].ino != 0) {
+    return false;
+  }
+  if ((size_ + 1) * kMaxLoadDenominator > slots_.size() * kMaxLoadNumerator) {
+    grow();
+    slot = probe(ino.get());
+  }
+  slots_[slot] = Slot{ino.get(), index};
+  ++size_;
+  return true;
+}
+
+void InodeTableIndex::assign(InodeNumber ino, size_t index) {
+  auto slot = probe(ino.get());
+  if (slots_[slot].ino != 0) {
+    slots_[slot].index = index;
+    return;
+  }
+  insert(ino, index);
+}
+
+bool InodeTableIndex::erase(InodeNumber ino) {
+  auto hole = probe(ino.get());
+  if (slots_[hole].ino == 0) {
+    return false;
+  }
+
+  // Shift later entries of the probe sequence back into the hole so that no
+  // tombstones are needed and lookups stay short.
+  auto slot = hole;
+  while (true) {
+    slot = (slot + 1) & mask_;
+    if (slots_[slot].ino == 0) {
+      break;
+    }
+    auto home = slotFor(slots_[slot].ino);
+    // The entry can move back only if its home slot is not cyclically in
+    // (hole, slot].
+    if (((slot - home) & mask_) >= ((slot - hole) & mask_)) {
+      slots_[hole] = slots_[slot];
+      hole = slot;
+    }
+  }
+  slots_[hole] = Slot{0, 0};
+  --size_;
+  return true;
+}
+
+void InodeTableIndex::grow() {
+  std::vector<Slot> old(slots_.size() * 2, Slot{0, 0});
+  old.swap(slots_);
+  mask_ = slots_.size() - 1;
+  for (const auto& entry : old) {
+    if (entry.ino != 0) {
+      slots_[probe(entry.ino)] = entry;
+    }
+  }
+}
+
+} // namespace eden
+} // namespace facebook
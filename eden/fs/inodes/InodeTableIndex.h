@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <limits>
+#include <vector>
+#include "eden/fs/fuse/InodeNumber.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * InodeTableIndex maps inode numbers to record indices in an InodeTable.
+ *
+ * It is an open-addressing hash table with linear probing over a power-of-two
+ * array of slots.  Inode numbers are never zero, so a zero inode number marks
+ * an empty slot.  Compared to std::unordered_map, a lookup touches one
+ * contiguous run of memory and building the index at startup does not
+ * allocate a node per record.
+ *
+ * InodeTableIndex is not thread-safe - the caller is responsible for
+ * synchronization.  It is safe for multiple threads to simultaneously read.
+ */
+class InodeTableIndex {
+ public:
+  static constexpr size_t kNotFound = std::numeric_limits<size_t>::max();
+
+  /**
+   * Creates an index with room for expectedSize entries before it needs to
+   * grow.
+   */
+  explicit InodeTableIndex(size_t expectedSize = 0);
+
+  /**
+   * Returns the record index for the given inode, or kNotFound.
+   */
+  size_t find(InodeNumber ino) const {
+    auto slot = slotFor(ino.get());
+    while (true) {
+      const auto& s = slots_[slot];
+      if (s.ino == ino.get()) {
+        return s.index;
+      }
+      if (s.ino == 0) {
+        return kNotFound;
+      }
+      slot = (slot + 1) & mask_;
+    }
+  }
+
+  /**
+   * Adds an entry for the inode.  Returns false, leaving the index
+   * unchanged, if the inode already has one.
+   */
+  bool insert(InodeNumber ino, size_t index);
+
+  /**
+   * Adds an entry for the inode or overwrites its existing one.
+   */
+  void assign(InodeNumber ino, size_t index);
+
+  /**
+   * Removes the inode's entry.  Returns false if it did not have one.
+   */
+  bool erase(InodeNumber ino);
+
+  size_t size() const {
+    return size_;
+  }
+
+  /**
+   * Calls fn(InodeNumber, size_t recordIndex) for every entry, in no
+   * particular order.  fn must not modify the index.
+   */
+  template <typename Fn>
+  void forEach(Fn&& fn) const {
+    for (const auto& slot : slots_) {
+      if (slot.ino != 0) {
+        fn(InodeNumber{slot.ino}, slot.index);
+      }
+    }
+  }
+
+ private:
+  struct Slot {
+    uint64_t ino;
+    size_t index;
+  };
+
+  size_t slotFor(uint64_t ino) const;
+
+  /**
+   * Returns the slot holding ino, or the empty slot where it would go.
+   */
+  size_t probe(uint64_t ino) const;
+
+  /**
+   * Rehashes into twice as many slots.
+   */
+  void grow();
+
+  std::vector<Slot> slots_;
+  size_t mask_;
+  size_t size_{0};
+};
+
+} // namespace eden
+} // namespace facebook
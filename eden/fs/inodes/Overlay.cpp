@@ -13,10 +13,15 @@
 #include <folly/Exception.h>
 #include <folly/File.h>
 #include <folly/FileUtil.h>
+#include <folly/Portability.h>
 #include <folly/Range.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/futures/Future.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 #include "eden/fs/inodes/DirEntry.h"
 #include "eden/fs/utils/Bug.h"
@@ -37,14 +42,34 @@
 namespace facebook {
 namespace eden {
 
+DEFINE_bool(
+    overlayDirWriteBehind,
+    false,
+    "Write directories saved to the overlay from a background thread, "
+    "coalescing repeated saves of the same directory, instead of before the "
+    "filesystem request returns. If EdenFS crashes, the most recent directory "
+    "changes may be lost; they are still written on clean shutdown and "
+    "graceful restart.");
+DEFINE_int32(
+    overlayGCThreads,
+    1,
+    "Number of threads that remove the overlay data of directory trees that "
+    "are no longer referenced, e.g. after a checkout removes a large "
+    "materialized tree.");
+
 namespace {
 constexpr uint64_t ioCountMask = 0x7FFFFFFFFFFFFFFFull;
 constexpr uint64_t ioClosedMask = 1ull << 63;
+// The number of unreferenced inodes the GC thread removes at a time.
+constexpr size_t kGCRemovalBatchSize = 256;
+// The most directories the write-behind thread writes at a time.
+constexpr size_t kDirWriteBatchSize = 256;
 } // namespace
 
 using folly::Unit;
 using std::optional;
 
+#ifdef _WIN32
 std::shared_ptr<Overlay> Overlay::create(AbsolutePathPiece localDir) {
   struct MakeSharedEnabler : public Overlay {
     explicit MakeSharedEnabler(AbsolutePathPiece localDir)
@@ -53,7 +78,31 @@ std::shared_ptr<Overlay> Overlay::create(AbsolutePathPiece localDir) {
   return std::make_shared<MakeSharedEnabler>(localDir);
 }
 
-Overlay::Overlay(AbsolutePathPiece localDir) : backingOverlay_{localDir} {}
+Overlay::Overlay(AbsolutePathPiece localDir)
+    : backingOverlay_{localDir}, dirWriteBehind_{false} {}
+#else
+std::shared_ptr<Overlay> Overlay::create(AbsolutePathPiece localDir) {
+  return create(localDir, FsOverlay::DirStorage::Files);
+}
+
+std::shared_ptr<Overlay> Overlay::create(
+    AbsolutePathPiece localDir,
+    FsOverlay::DirStorage newDirStorage) {
+  struct MakeSharedEnabler : public Overlay {
+    MakeSharedEnabler(
+        AbsolutePathPiece localDir,
+        FsOverlay::DirStorage newDirStorage)
+        : Overlay(localDir, newDirStorage) {}
+  };
+  return std::make_shared<MakeSharedEnabler>(localDir, newDirStorage);
+}
+
+Overlay::Overlay(
+    AbsolutePathPiece localDir,
+    FsOverlay::DirStorage newDirStorage)
+    : backingOverlay_{localDir, newDirStorage},
+      dirWriteBehind_{FLAGS_overlayDirWriteBehind} {}
+#endif // _WIN32
 
 Overlay::~Overlay() {
   close();
@@ -61,12 +110,22 @@ Overlay::~Overlay() {
 
 void Overlay::close() {
   CHECK_NE(std::this_thread::get_id(), gcThread_.get_id());
+  CHECK_NE(std::this_thread::get_id(), dirWriterThread_.get_id());
+
+  // The writer thread drains every queued directory before it exits, so
+  // nothing saved before close() is lost.
+  dirWriteQueue_.lock()->stop = true;
+  dirWriteCondVar_.notify_one();
+  if (dirWriterThread_.joinable()) {
+    dirWriterThread_.join();
+  }
 
   gcQueue_.lock()->stop = true;
   gcCondVar_.notify_one();
   if (gcThread_.joinable()) {
     gcThread_.join();
   }
+  gcExecutor_.reset();
 
   // Make sure everything is shut down in reverse of construction order.
   // Cleanup is not necessary if overlay was not initialized
@@ -103,7 +162,8 @@ struct statfs Overlay::statFs() {
 }
 #endif // !_WIN32
 
-folly::SemiFuture<Unit> Overlay::initialize() {
+folly::SemiFuture<Unit> Overlay::initialize(
+    FsckProgressCallback fsckProgressCallback) {
   // The initOverlay() call is potentially slow, so we want to avoid
   // performing it in the current thread and blocking returning to our caller.
   //
@@ -111,9 +171,20 @@ folly::SemiFuture<Unit> Overlay::initialize() {
   // to simply use this existing thread to perform the initialization logic
   // before waiting for GC work to do.
   auto [initPromise, initFuture] = folly::makePromiseContract<Unit>();
-  gcThread_ = std::thread([this, promise = std::move(initPromise)]() mutable {
+#ifndef _WIN32
+  if (FLAGS_overlayGCThreads > 1) {
+    // gcThread_ itself is one of the workers.
+    gcExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        FLAGS_overlayGCThreads - 1,
+        std::make_shared<folly::NamedThreadFactory>("OverlayGC"));
+  }
+#endif
+  gcThread_ = std::thread([this,
+                           promise = std::move(initPromise),
+                           fsckProgressCallback =
+                               std::move(fsckProgressCallback)]() mutable {
     try {
-      initOverlay();
+      initOverlay(fsckProgressCallback);
     } catch (std::exception& ex) {
       XLOG(ERR) << "overlay initialization failed for "
                 << backingOverlay_.getLocalDir() << ": " << ex.what();
@@ -129,10 +200,15 @@ folly::SemiFuture<Unit> Overlay::initialize() {
     gcThread();
 #endif
   });
+#ifndef _WIN32
+  if (dirWriteBehind_) {
+    dirWriterThread_ = std::thread([this] { dirWriterThread(); });
+  }
+#endif
   return std::move(initFuture);
 }
 
-void Overlay::initOverlay() {
+void Overlay::initOverlay(const FsckProgressCallback& fsckProgressCallback) {
   IORequest req{this};
   auto optNextInodeNumber = backingOverlay_.initOverlay(true);
   if (!optNextInodeNumber.has_value()) {
@@ -146,7 +222,8 @@ void Overlay::initOverlay() {
     // correct next inode number as it does so.
     XLOG(WARN) << "Overlay " << backingOverlay_.getLocalDir()
                << " was not shut down cleanly.  Performing fsck scan.";
-    OverlayChecker checker(&backingOverlay_, std::nullopt);
+    OverlayChecker checker(
+        &backingOverlay_, std::nullopt, fsckProgressCallback);
     checker.scanForErrors();
     checker.repairErrors();
 
@@ -171,7 +248,7 @@ void Overlay::initOverlay() {
 #endif // !_WIN32
 }
 
-InodeNumber Overlay::allocateInodeNumber() {
+InodeNumber Overlay::allocateInodeNumbers(size_t count) {
   // InodeNumber should generally be 64-bits wide, in which case it isn't even
   // worth bothering to handle the case where nextInodeNumber_ wraps.  We don't
   // need to bother checking for conflicts with existing inode numbers since
@@ -183,11 +260,13 @@ InodeNumber Overlay::allocateInodeNumber() {
   static_assert(
       sizeof(InodeNumber) >= 8, "expected InodeNumber to be at least 64 bits");
 
+  DCHECK_GT(count, 0);
+
   // This could be a relaxed atomic operation.  It doesn't matter on x86 but
   // might on ARM.
-  auto previous = nextInodeNumber_++;
+  auto previous = nextInodeNumber_.fetch_add(count);
 #ifdef _WIN32
-  backingOverlay_.updateUsedInodeNumber(previous);
+  backingOverlay_.updateUsedInodeNumber(previous + count - 1);
 #endif
   DCHECK_NE(0, previous) << "allocateInodeNumber called before initialize";
   return InodeNumber{previous};
@@ -195,7 +274,11 @@ InodeNumber Overlay::allocateInodeNumber() {
 
 optional<DirContents> Overlay::loadOverlayDir(InodeNumber inodeNumber) {
   IORequest req{this};
+#ifdef _WIN32
   auto dirData = backingOverlay_.loadOverlayDir(inodeNumber);
+#else
+  auto dirData = loadOverlayDirData(inodeNumber);
+#endif
   if (!dirData.has_value()) {
     return std::nullopt;
   }
@@ -204,6 +287,7 @@ optional<DirContents> Overlay::loadOverlayDir(InodeNumber inodeNumber) {
   bool shouldMigrateToNewFormat = false;
 
   DirContents result;
+  result.reserve(dir.entries.size());
   for (auto& iter : dir.entries) {
     const auto& name = iter.first;
     const auto& value = iter.second;
@@ -275,6 +359,19 @@ void Overlay::saveOverlayDir(InodeNumber inodeNumber, const DirContents& dir) {
         std::make_pair(entName.stringPiece().str(), std::move(oent)));
   }
 
+#ifndef _WIN32
+  if (dirWriteBehind_) {
+    {
+      auto queue = dirWriteQueue_.lock();
+      queue->pending[inodeNumber] = DirWriteQueue::PendingDir{
+          queue->nextGeneration++,
+          std::make_shared<const overlay::OverlayDir>(std::move(odir))};
+    }
+    dirWriteCondVar_.notify_one();
+    return;
+  }
+#endif // !_WIN32
+
   backingOverlay_.saveOverlayDir(inodeNumber, odir);
 }
 
@@ -282,18 +379,41 @@ void Overlay::removeOverlayData(InodeNumber inodeNumber) {
   IORequest req{this};
 
 #ifndef _WIN32
-  // TODO: batch request during GC
+  std::unique_lock<std::mutex> dirWriteGuard;
+  if (dirWriteBehind_) {
+    dirWriteGuard = std::unique_lock<std::mutex>{dirWriteMutex_};
+    dirWriteQueue_.lock()->pending.erase(inodeNumber);
+    dirWrittenCondVar_.notify_all();
+  }
+
   getInodeMetadataTable()->freeInode(inodeNumber);
-  backingOverlay_.removeOverlayFile(inodeNumber);
+  backingOverlay_.removeOverlayData(inodeNumber);
 #else
   backingOverlay_.removeOverlayData(inodeNumber);
 #endif // !_WIN32
 }
 
 #ifndef _WIN32
+void Overlay::removeOverlayData(const std::vector<InodeNumber>& inodeNumbers) {
+  IORequest req{this};
+
+  std::unique_lock<std::mutex> dirWriteGuard;
+  if (dirWriteBehind_) {
+    dirWriteGuard = std::unique_lock<std::mutex>{dirWriteMutex_};
+    auto queue = dirWriteQueue_.lock();
+    for (auto inodeNumber : inodeNumbers) {
+      queue->pending.erase(inodeNumber);
+    }
+    dirWrittenCondVar_.notify_all();
+  }
+
+  getInodeMetadataTable()->freeInodes(inodeNumbers);
+  backingOverlay_.removeOverlayData(inodeNumbers);
+}
+
 void Overlay::recursivelyRemoveOverlayData(InodeNumber inodeNumber) {
   IORequest req{this};
-  auto dirData = backingOverlay_.loadOverlayDir(inodeNumber);
+  auto dirData = loadOverlayDirData(inodeNumber);
 
   // This inode's data must be removed from the overlay before
   // recursivelyRemoveOverlayData returns to avoid a race condition if
@@ -304,6 +424,7 @@ void Overlay::recursivelyRemoveOverlayData(InodeNumber inodeNumber) {
   removeOverlayData(inodeNumber);
 
   if (dirData) {
+    gcQueueDepth_.fetch_add(1, std::memory_order_relaxed);
     gcQueue_.lock()->queue.emplace_back(std::move(*dirData));
     gcCondVar_.notify_one();
   }
@@ -312,6 +433,8 @@ void Overlay::recursivelyRemoveOverlayData(InodeNumber inodeNumber) {
 
 #ifndef _WIN32
 folly::Future<folly::Unit> Overlay::flushPendingAsync() {
+  flushPendingDirs();
+
   folly::Promise<folly::Unit> promise;
   auto future = promise.getFuture();
   gcQueue_.lock()->queue.emplace_back(std::move(promise));
@@ -322,6 +445,9 @@ folly::Future<folly::Unit> Overlay::flushPendingAsync() {
 
 bool Overlay::hasOverlayData(InodeNumber inodeNumber) {
   IORequest req{this};
+  if (dirWriteBehind_ && dirWriteQueue_.lock()->pending.count(inodeNumber)) {
+    return true;
+  }
   return backingOverlay_.hasOverlayData(inodeNumber);
 }
 
@@ -364,6 +490,29 @@ OverlayFile Overlay::createOverlayFile(
       weak_from_this());
 }
 
+std::optional<OverlayFile> Overlay::cloneOverlayFileFromBlobFile(
+    InodeNumber inodeNumber,
+    const Hash& blobHash,
+    uint64_t blobSize) {
+  IORequest req{this};
+  CHECK_LT(inodeNumber.get(), nextInodeNumber_.load(std::memory_order_relaxed))
+      << "cloneOverlayFileFromBlobFile called with unallocated inode number";
+  auto file = backingOverlay_.cloneOverlayFileFromBlobFile(
+      inodeNumber, blobHash, blobSize);
+  if (!file) {
+    return std::nullopt;
+  }
+  return OverlayFile(std::move(*file), weak_from_this());
+}
+
+void Overlay::addBlobFile(
+    const Hash& blobHash,
+    const folly::IOBuf& contents,
+    uint64_t maxCacheSize) {
+  IORequest req{this};
+  backingOverlay_.addBlobFile(blobHash, contents, maxCacheSize);
+}
+
 #endif // !_WIN32
 
 InodeNumber Overlay::getMaxInodeNumber() {
@@ -438,40 +587,62 @@ void Overlay::gcThread() noexcept {
       requests = std::move(lock->queue);
     }
 
-    for (auto& request : requests) {
+    // Flush requests complete once every directory queued before them has
+    // been collected, so collect up to each flush before fulfilling it.
+    std::vector<overlay::OverlayDir> dirs;
+    auto collect = [&] {
       try {
-        handleGCRequest(request);
+        collectDirs(dirs);
       } catch (const std::exception& e) {
-        XLOG(ERR) << "handleGCRequest should never throw, but it did: "
+        XLOG(ERR) << "collectDirs should never throw, but it did: "
                   << e.what();
       }
+      dirs.clear();
+    };
+    for (auto& request : requests) {
+      if (request.flush) {
+        collect();
+        request.flush->setValue();
+      } else {
+        dirs.push_back(std::move(request.dir));
+      }
+    }
+    collect();
+
+    // Collection is what removes directories in bulk, so this is when a
+    // SQLite directory store has space worth reclaiming.
+    try {
+      IORequest req{this};
+      backingOverlay_.compactDirStoreIfNeeded();
+    } catch (const std::exception& e) {
+      XLOG(ERR) << "failed to compact overlay directory store: " << e.what();
     }
   }
 }
 
-void Overlay::handleGCRequest(GCRequest& request) {
-  IORequest req{this};
-  if (request.flush) {
-    request.flush->setValue();
+/**
+ * The state shared by the workers collecting one round of GC requests.
+ */
+struct Overlay::GCWalk {
+  std::mutex mutex;
+  std::condition_variable cv;
+  // Tree inodes whose data still has to be loaded and removed.  Used as a
+  // stack so it stays proportional to the depth of the trees rather than
+  // their width.
+  std::vector<InodeNumber> trees;
+  // Workers currently processing a tree, and so possibly about to add more.
+  size_t active{0};
+};
+
+void Overlay::collectDirs(std::vector<overlay::OverlayDir>& dirs) {
+  if (dirs.empty()) {
     return;
   }
 
-  // Should only include inode numbers for trees.
-  std::queue<InodeNumber> queue;
-
-  // TODO: For better throughput on large tree collections, it might make
-  // sense to split this into two threads: one for traversing the tree and
-  // another that makes the actual unlink calls.
-  auto safeRemoveOverlayData = [&](InodeNumber inodeNumber) {
-    try {
-      removeOverlayData(inodeNumber);
-    } catch (const std::exception& e) {
-      XLOG(ERR) << "Failed to remove overlay data for inode " << inodeNumber
-                << ": " << e.what();
-    }
-  };
-
-  auto processDir = [&](const overlay::OverlayDir& dir) {
+  IORequest req{this};
+  GCWalk walk;
+  std::vector<InodeNumber> removals;
+  for (const auto& dir : dirs) {
     for (const auto& entry : dir.entries) {
       const auto& value = entry.second;
       if (!value.inodeNumber) {
@@ -480,43 +651,214 @@ void Overlay::handleGCRequest(GCRequest& request) {
         continue;
       }
       auto ino = InodeNumber::fromThrift(value.inodeNumber);
-
       if (S_ISDIR(value.mode)) {
-        queue.push(ino);
+        walk.trees.push_back(ino);
       } else {
         // No need to recurse, but delete any file at this inode.  Note that,
         // under normal operation, there should be nothing at this path
         // because files are only written into the overlay if they're
         // materialized.
-        safeRemoveOverlayData(ino);
+        removals.push_back(ino);
       }
     }
-  };
+  }
+  gcQueueDepth_.fetch_add(walk.trees.size(), std::memory_order_relaxed);
+  // The directories themselves were removed by recursivelyRemoveOverlayData.
+  gcQueueDepth_.fetch_sub(dirs.size(), std::memory_order_relaxed);
+
+  for (size_t begin = 0; begin < removals.size();
+       begin += kGCRemovalBatchSize) {
+    auto end = std::min(removals.size(), begin + kGCRemovalBatchSize);
+    std::vector<InodeNumber> batch{
+        removals.begin() + begin, removals.begin() + end};
+    try {
+      removeOverlayData(batch);
+    } catch (const std::exception& e) {
+      XLOG(ERR) << "Failed to remove overlay data for " << batch.size()
+                << " inodes starting at " << batch.front() << ": " << e.what();
+    }
+  }
 
-  processDir(request.dir);
+  std::vector<folly::Future<Unit>> helpers;
+  if (gcExecutor_ && !walk.trees.empty()) {
+    for (size_t i = 0; i < gcExecutor_->numThreads(); ++i) {
+      helpers.push_back(
+          folly::via(gcExecutor_.get(), [this, &walk] { gcWorker(walk); }));
+    }
+  }
+  gcWorker(walk);
+  folly::collectAll(helpers).wait();
+}
 
-  while (!queue.empty()) {
-    auto ino = queue.front();
-    queue.pop();
+void Overlay::gcWorker(GCWalk& walk) noexcept {
+  // Nothing references these inodes any more, so their removal can be
+  // batched, which lets a SQLite directory store commit many removals at once.
+  std::vector<InodeNumber> removals;
+  auto flushRemovals = [&] {
+    if (removals.empty()) {
+      return;
+    }
+    try {
+      removeOverlayData(removals);
+    } catch (const std::exception& e) {
+      XLOG(ERR) << "Failed to remove overlay data for " << removals.size()
+                << " inodes starting at " << removals.front() << ": "
+                << e.what();
+    }
+    removals.clear();
+  };
+  auto safeRemoveOverlayData = [&](InodeNumber inodeNumber) {
+    removals.push_back(inodeNumber);
+    if (removals.size() >= kGCRemovalBatchSize) {
+      flushRemovals();
+    }
+  };
+
+  std::vector<InodeNumber> children;
+  for (;;) {
+    InodeNumber ino;
+    {
+      std::unique_lock<std::mutex> lock{walk.mutex};
+      walk.cv.wait(
+          lock, [&] { return !walk.trees.empty() || walk.active == 0; });
+      if (walk.trees.empty()) {
+        break;
+      }
+      ino = walk.trees.back();
+      walk.trees.pop_back();
+      ++walk.active;
+    }
 
-    overlay::OverlayDir dir;
+    children.clear();
     try {
-      auto dirData = backingOverlay_.loadOverlayDir(ino);
+      auto dirData = loadOverlayDirData(ino);
       if (!dirData.has_value()) {
         XLOG(DBG7) << "no dir data for inode " << ino;
-        continue;
       } else {
-        dir = std::move(*dirData);
+        safeRemoveOverlayData(ino);
+        for (const auto& entry : dirData->entries) {
+          const auto& value = entry.second;
+          if (!value.inodeNumber) {
+            continue;
+          }
+          auto childIno = InodeNumber::fromThrift(value.inodeNumber);
+          if (S_ISDIR(value.mode)) {
+            children.push_back(childIno);
+          } else {
+            safeRemoveOverlayData(childIno);
+          }
+        }
       }
     } catch (const std::exception& e) {
       XLOG(ERR) << "While collecting, failed to load tree data for inode "
                 << ino << ": " << e.what();
-      continue;
     }
 
-    safeRemoveOverlayData(ino);
-    processDir(dir);
+    gcQueueDepth_.fetch_add(children.size(), std::memory_order_relaxed);
+    gcQueueDepth_.fetch_sub(1, std::memory_order_relaxed);
+    bool done;
+    {
+      std::lock_guard<std::mutex> lock{walk.mutex};
+      walk.trees.insert(walk.trees.end(), children.begin(), children.end());
+      --walk.active;
+      done = walk.trees.empty() && walk.active == 0;
+    }
+    // A single child is picked up by this worker on its next iteration.
+    if (done || children.size() > 1) {
+      walk.cv.notify_all();
+    }
+  }
+  flushRemovals();
+}
+
+std::optional<overlay::OverlayDir> Overlay::loadOverlayDirData(
+    InodeNumber inodeNumber) {
+  if (dirWriteBehind_) {
+    auto queue = dirWriteQueue_.lock();
+    auto it = queue->pending.find(inodeNumber);
+    if (it != queue->pending.end()) {
+      return *it->second.dir;
+    }
+  }
+  return backingOverlay_.loadOverlayDir(inodeNumber);
+}
+
+void Overlay::dirWriterThread() noexcept {
+  for (;;) {
+    std::vector<std::pair<InodeNumber, DirWriteQueue::PendingDir>> batch;
+    {
+      auto queue = dirWriteQueue_.lock();
+      while (queue->pending.empty()) {
+        if (queue->stop) {
+          return;
+        }
+        dirWriteCondVar_.wait(queue.getUniqueLock());
+      }
+      batch.assign(queue->pending.begin(), queue->pending.end());
+    }
+
+    // Writing several directories at once lets a SQLite directory store
+    // commit them as one transaction.  Batches are bounded because
+    // removeOverlayData() waits for dirWriteMutex_.
+    for (size_t begin = 0; begin < batch.size(); begin += kDirWriteBatchSize) {
+      auto end = std::min(batch.size(), begin + kDirWriteBatchSize);
+      std::lock_guard<std::mutex> guard{dirWriteMutex_};
+
+      // Skip directories that were removed, or saved again and so will be
+      // written by the next batch, since they were queued.
+      std::vector<
+          std::pair<InodeNumber, std::shared_ptr<const overlay::OverlayDir>>>
+          dirs;
+      {
+        auto queue = dirWriteQueue_.lock();
+        for (size_t i = begin; i < end; ++i) {
+          auto it = queue->pending.find(batch[i].first);
+          if (it != queue->pending.end() &&
+              it->second.generation == batch[i].second.generation) {
+            dirs.emplace_back(batch[i].first, batch[i].second.dir);
+          }
+        }
+      }
+
+      try {
+        IORequest req{this};
+        backingOverlay_.saveOverlayDirs(dirs);
+      } catch (const std::exception& e) {
+        // There is no caller left to report this to.  Dropping the writes
+        // leaves the overlay as if EdenFS had crashed before them, which fsck
+        // repairs.
+        XLOG(ERR) << "failed to write overlay data for " << dirs.size()
+                  << " directory inodes: " << e.what();
+      }
+
+      {
+        // Keep entries that were saved again while this batch was written.
+        auto queue = dirWriteQueue_.lock();
+        for (const auto& [inodeNumber, dir] : dirs) {
+          auto it = queue->pending.find(inodeNumber);
+          if (it != queue->pending.end() && it->second.dir == dir) {
+            queue->pending.erase(it);
+          }
+        }
+      }
+      dirWrittenCondVar_.notify_all();
+    }
+  }
+}
+
+void Overlay::flushPendingDirs() {
+  if (!dirWriteBehind_) {
+    return;
   }
+
+  auto queue = dirWriteQueue_.lock();
+  auto generation = queue->nextGeneration;
+  dirWrittenCondVar_.wait(queue.getUniqueLock(), [&] {
+    return std::none_of(
+        queue->pending.begin(), queue->pending.end(), [&](const auto& entry) {
+          return entry.second.generation < generation;
+        });
+  });
 }
 #endif // !1
 
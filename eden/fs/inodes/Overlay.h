@@ -13,8 +13,10 @@
 #include <array>
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <optional>
 #include <thread>
+#include <unordered_map>
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
 #include "eden/fs/utils/DirType.h"
@@ -27,6 +29,10 @@
 
 #endif
 
+namespace folly {
+class CPUThreadPoolExecutor;
+} // namespace folly
+
 namespace facebook {
 namespace eden {
 
@@ -35,6 +41,7 @@ class OverlayDir;
 }
 
 struct DirContents;
+class Hash;
 class InodeMap;
 class SerializedInodeMap;
 
@@ -66,6 +73,8 @@ class OverlayFile;
  */
 class Overlay : public std::enable_shared_from_this<Overlay> {
  public:
+  using FsckProgressCallback = std::function<void(uint32_t percentComplete)>;
+
   /**
    * Create a new Overlay object.
    *
@@ -74,6 +83,17 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
    */
   static std::shared_ptr<Overlay> create(AbsolutePathPiece localDir);
 
+#ifndef _WIN32
+  /**
+   * Create a new Overlay object, choosing where directories are stored if
+   * initialize() has to create a brand new overlay.  An existing overlay
+   * keeps using the storage it was created with.
+   */
+  static std::shared_ptr<Overlay> create(
+      AbsolutePathPiece localDir,
+      FsOverlay::DirStorage newDirStorage);
+#endif // !_WIN32
+
   ~Overlay();
 
   Overlay(const Overlay&) = delete;
@@ -98,8 +118,12 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
    *   cleanly the last time it was opened.
    * - Upgrading the on-disk data from older formats if the Overlay was created
    *   by an older version of the software.
+   *
+   * If the overlay has to be checked, fsckProgressCallback is called with the
+   * percentage of the overlay scanned so far.
    */
-  FOLLY_NODISCARD folly::SemiFuture<folly::Unit> initialize();
+  FOLLY_NODISCARD folly::SemiFuture<folly::Unit> initialize(
+      FsckProgressCallback fsckProgressCallback = nullptr);
 
   /**
    * Closes the overlay. It is undefined behavior to access the
@@ -127,6 +151,14 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
     return hadCleanStartup_;
   }
 
+  /**
+   * Returns the number of unreferenced directories whose overlay data is
+   * waiting to be removed by the background GC.
+   */
+  uint64_t getGCQueueDepth() const {
+    return gcQueueDepth_.load(std::memory_order_relaxed);
+  }
+
   /**
    * Get the maximum inode number that has ever been allocated to an inode.
    */
@@ -142,11 +174,17 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
    *   TreeInode::create() or TreeInode::mkdir().  In this case
    *   inodeCreated() should be called immediately afterwards to register the
    *   new child Inode object.
-   *
-   * TODO: It would be easy to extend this function to allocate a range of
-   * inode values in one atomic operation.
    */
-  InodeNumber allocateInodeNumber();
+  InodeNumber allocateInodeNumber() {
+    return allocateInodeNumbers(1);
+  }
+
+  /**
+   * Allocate count consecutive inode numbers in one atomic operation, and
+   * return the first of them.  This is intended for giving numbers to all of
+   * the entries of a directory at once.  count must be nonzero.
+   */
+  InodeNumber allocateInodeNumbers(size_t count);
 #ifndef _WIN32
 
   /**
@@ -176,6 +214,9 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
   /**
    * Returns a future that completes once all previously-issued async
    * operations, namely recursivelyRemoveOverlayData, finish.
+   *
+   * Directories queued by saveOverlayDir() under --overlayDirWriteBehind are
+   * written to the backing overlay before this returns.
    */
   folly::Future<folly::Unit> flushPendingAsync();
 
@@ -208,13 +249,34 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
       InodeNumber inodeNumber,
       const folly::IOBuf& contents);
 
+  /**
+   * Creates an overlay file for a FileInode from the blob file cache.
+   * See FsOverlay::cloneOverlayFileFromBlobFile().
+   */
+  std::optional<OverlayFile> cloneOverlayFileFromBlobFile(
+      InodeNumber inodeNumber,
+      const Hash& blobHash,
+      uint64_t blobSize);
+
+  /**
+   * Adds a blob to the blob file cache.  See FsOverlay::addBlobFile().
+   */
+  void addBlobFile(
+      const Hash& blobHash,
+      const folly::IOBuf& contents,
+      uint64_t maxCacheSize);
+
   /**
    * call statfs(2) on the filesystem in which the overlay is located
    */
   struct statfs statFs();
 #endif // !_WIN32
  private:
+#ifdef _WIN32
   explicit Overlay(AbsolutePathPiece localDir);
+#else
+  Overlay(AbsolutePathPiece localDir, FsOverlay::DirStorage newDirStorage);
+#endif // _WIN32
 
   /**
    * A request for the background GC thread.  There are two types of requests:
@@ -242,9 +304,64 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
     std::vector<GCRequest> queue;
   };
 
-  void initOverlay();
+  /**
+   * Directories saved by saveOverlayDir() that have not been written to the
+   * backing overlay yet.  Only used with --overlayDirWriteBehind.
+   *
+   * Saving a directory again before it is written replaces the queued
+   * contents, so a burst of changes to one directory costs a single write.
+   */
+  struct DirWriteQueue {
+    struct PendingDir {
+      // Distinguishes successive saves of the same directory.
+      uint64_t generation;
+      std::shared_ptr<const overlay::OverlayDir> dir;
+    };
+
+    bool stop = false;
+    uint64_t nextGeneration = 0;
+    std::unordered_map<InodeNumber, PendingDir> pending;
+  };
+
+  void initOverlay(const FsckProgressCallback& fsckProgressCallback);
   void gcThread() noexcept;
-  void handleGCRequest(GCRequest& request);
+
+  struct GCWalk;
+
+  /**
+   * Recursively remove the overlay data underneath the given directories,
+   * using the gcExecutor_ threads too if there are any.
+   */
+  void collectDirs(std::vector<overlay::OverlayDir>& dirs);
+
+  /**
+   * Take directories from the walk and remove their data until there are
+   * none left and no other worker can add more.
+   */
+  void gcWorker(GCWalk& walk) noexcept;
+
+#ifndef _WIN32
+  void dirWriterThread() noexcept;
+
+  /**
+   * Remove the data for several inodes that are no longer referenced by any
+   * directory, letting the backing overlay group the removals.
+   */
+  void removeOverlayData(const std::vector<InodeNumber>& inodeNumbers);
+
+  /**
+   * Block until every directory queued before this call has been written to
+   * the backing overlay, removed, or superseded by a later save.
+   */
+  void flushPendingDirs();
+
+  /**
+   * Load a directory's data, preferring a queued write over the backing
+   * overlay.
+   */
+  std::optional<overlay::OverlayDir> loadOverlayDirData(
+      InodeNumber inodeNumber);
+#endif // !_WIN32
 
   bool tryIncOutstandingIORequests();
   void decOutstandingIORequests();
@@ -281,6 +398,32 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
   folly::Synchronized<GCQueue, std::mutex> gcQueue_;
   std::condition_variable gcCondVar_;
 
+  /**
+   * Additional threads that walk the trees collected by gcThread_, if
+   * --overlayGCThreads is more than 1.
+   */
+  std::unique_ptr<folly::CPUThreadPoolExecutor> gcExecutor_;
+
+  /**
+   * Directories queued for collection or found while collecting, and not
+   * removed yet.
+   */
+  std::atomic<uint64_t> gcQueueDepth_{0};
+
+  /**
+   * Write-behind state for saveOverlayDir(), see DirWriteQueue.
+   *
+   * dirWriteMutex_ is held while the writer thread writes a directory to the
+   * backing overlay, and by removeOverlayData(), so a queued write can never
+   * recreate data that was just removed.
+   */
+  const bool dirWriteBehind_;
+  std::thread dirWriterThread_;
+  folly::Synchronized<DirWriteQueue, std::mutex> dirWriteQueue_;
+  std::condition_variable dirWriteCondVar_;
+  std::condition_variable dirWrittenCondVar_;
+  std::mutex dirWriteMutex_;
+
   /**
    * This uint64_t holds two values, a single bit on the MSB that
    * acts a boolean closed: True if the the Overlay has been closed with
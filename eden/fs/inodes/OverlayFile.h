@@ -39,6 +39,17 @@ class OverlayFile {
   folly::Expected<int, int> fdatasync() const;
   folly::Expected<std::string, int> readFile() const;
 
+  /**
+   * Returns the underlying file descriptor.
+   *
+   * Callers must keep this OverlayFile alive for as long as they use the
+   * descriptor, and should prefer the methods above, which bail out once the
+   * Overlay has been closed.
+   */
+  int fd() const {
+    return file_.fd();
+  }
+
  private:
   OverlayFile(const OverlayFile&) = delete;
   OverlayFile& operator=(const OverlayFile&) = delete;
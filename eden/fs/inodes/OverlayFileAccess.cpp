@@ -9,6 +9,8 @@
 
 #include <folly/Expected.h>
 #include <folly/Range.h>
+#include <folly/String.h>
+#include <folly/io/Cursor.h>
 #include <folly/logging/xlog.h>
 #include <gflags/gflags.h>
 #include <openssl/sha.h>
@@ -33,21 +35,81 @@ namespace eden {
  */
 
 DEFINE_uint64(overlayFileCacheSize, 100, "");
+DEFINE_uint64(
+    overlayFileCacheMaxSize,
+    0,
+    "The overlay file handle cache grows up to this many entries while "
+    "recently closed files keep being reopened. Values not larger than "
+    "overlayFileCacheSize keep the cache at a fixed size.");
+DEFINE_uint64(
+    overlayMmapCacheBytes,
+    0,
+    "Keep the contents of materialized files that are read mapped into "
+    "memory, up to this many bytes in total, and serve reads from the "
+    "mappings instead of pread or splice. Files larger than this are never "
+    "mapped. 0 disables this.");
+DEFINE_uint64(
+    overlaySpliceReadMinSize,
+    64 * 1024,
+    "Reads of at least this many bytes from materialized files are returned "
+    "as file descriptor ranges so they can be spliced to FUSE. "
+    "0 disables this.");
+DEFINE_bool(
+    overlayPersistSha1,
+    false,
+    "Persist the SHA-1 of materialized files in their overlay file header so "
+    "it does not have to be recomputed when the file is reopened. EdenFS "
+    "versions that do not know about the persisted SHA-1 do not clear it when "
+    "they modify the file.");
+
+namespace {
+// Large enough to amortize the pread syscalls; OpenSSL picks the fastest
+// SHA-1 implementation (SHA-NI, AVX2, ...) the CPU supports.
+constexpr size_t kSha1ReadSize = 256 * 1024;
+
+// The file cache shrinks after this many lookups per entry did not reopen a
+// recently evicted file.
+constexpr size_t kShrinkLookupsPerEntry = 16;
+
+std::unique_ptr<folly::IOBuf> copyFromMapping(
+    const folly::MemoryMapping& mapping,
+    size_t size,
+    off_t off) {
+  auto contents = mapping.range().subpiece(FsOverlay::kHeaderLength);
+  if (static_cast<size_t>(off) >= contents.size()) {
+    return folly::IOBuf::create(0);
+  }
+  contents = contents.subpiece(off, size);
+  return folly::IOBuf::copyBuffer(contents.data(), contents.size());
+}
+} // namespace
 
 void OverlayFileAccess::Entry::Info::invalidateMetadata() {
   ++version;
   size = std::nullopt;
   sha1 = std::nullopt;
+  mapping.reset();
 }
 
-OverlayFileAccess::State::State(size_t cacheSize) : entries{cacheSize} {
+OverlayFileAccess::State::State(size_t cacheSize, size_t maxCacheSize)
+    : entries{cacheSize},
+      evicted{std::max(cacheSize, maxCacheSize)},
+      minCacheSize{cacheSize},
+      maxCacheSize{std::max(cacheSize, maxCacheSize)} {
   if (cacheSize == 0) {
     throw std::range_error{"overlayFileCacheSize must be at least 1"};
   }
+  if (this->maxCacheSize > minCacheSize) {
+    entries.setPruneHook(
+        [this](InodeNumber ino, EntryPtr&&) { evicted.set(ino, folly::unit); });
+  }
 }
 
 OverlayFileAccess::OverlayFileAccess(Overlay* overlay)
-    : overlay_{overlay}, state_{folly::in_place, FLAGS_overlayFileCacheSize} {}
+    : overlay_{overlay},
+      state_{folly::in_place,
+             FLAGS_overlayFileCacheSize,
+             FLAGS_overlayFileCacheMaxSize} {}
 
 OverlayFileAccess::~OverlayFileAccess() = default;
 
@@ -57,7 +119,8 @@ void OverlayFileAccess::createEmptyFile(InodeNumber ino) {
   CHECK(!state->entries.exists(ino))
       << "Cannot create overlay file " << ino << " when it's already open!";
   state->entries.set(
-      ino, std::make_shared<Entry>(std::move(file), size_t{0}, kEmptySha1));
+      ino,
+      std::make_shared<Entry>(std::move(file), size_t{0}, kEmptySha1, true));
 }
 
 void OverlayFileAccess::createFile(
@@ -69,7 +132,26 @@ void OverlayFileAccess::createFile(
   CHECK(!state->entries.exists(ino))
       << "Cannot create overlay file " << ino << " when it's already open!";
   state->entries.set(
-      ino, std::make_shared<Entry>(std::move(file), blob.getSize(), sha1));
+      ino,
+      std::make_shared<Entry>(std::move(file), blob.getSize(), sha1, true));
+}
+
+bool OverlayFileAccess::createFileFromBlobFile(
+    InodeNumber ino,
+    const Hash& blobHash,
+    uint64_t blobSize,
+    const std::optional<Hash>& sha1) {
+  auto file = overlay_->cloneOverlayFileFromBlobFile(ino, blobHash, blobSize);
+  if (!file) {
+    return false;
+  }
+  auto state = state_.wlock();
+  CHECK(!state->entries.exists(ino))
+      << "Cannot create overlay file " << ino << " when it's already open!";
+  state->entries.set(
+      ino,
+      std::make_shared<Entry>(std::move(*file), blobSize, sha1, true));
+  return true;
 }
 
 off_t OverlayFileAccess::getFileSize(FileInode& inode) {
@@ -121,12 +203,24 @@ Hash OverlayFileAccess::getSha1(FileInode& inode) {
     version = info->version;
   }
 
+  if (FLAGS_overlayPersistSha1) {
+    if (auto persisted = readHeaderSha1(inode, *entry)) {
+      auto info = entry->info.wlock();
+      if (version == info->version) {
+        info->size = persisted->first;
+        info->sha1 = persisted->second;
+      }
+      return persisted->second;
+    }
+  }
+
   // SHA-1 is not known, so recompute it. Do so while the lock is not held to
   // improve concurrency.
 
   SHA_CTX ctx;
   SHA1_Init(&ctx);
 
+  auto buf = std::make_unique<uint8_t[]>(kSha1ReadSize);
   off_t off = FsOverlay::kHeaderLength;
   while (true) {
     // Using pread here so that we don't move the file position;
@@ -134,8 +228,7 @@ Hash OverlayFileAccess::getSha1(FileInode& inode) {
     // and while we serialize the requests to FileData, it seems
     // like a good property of this function to avoid changing that
     // state.
-    uint8_t buf[8192];
-    auto ret = entry->file.preadNoInt(&buf, sizeof(buf), off);
+    auto ret = entry->file.preadNoInt(buf.get(), kSha1ReadSize, off);
     if (ret.hasError()) {
       throw InodeError(
           ret.error(),
@@ -146,7 +239,7 @@ Hash OverlayFileAccess::getSha1(FileInode& inode) {
     if (len == 0) {
       break;
     }
-    SHA1_Update(&ctx, buf, len);
+    SHA1_Update(&ctx, buf.get(), len);
     off += len;
   }
 
@@ -158,10 +251,87 @@ Hash OverlayFileAccess::getSha1(FileInode& inode) {
   auto info = entry->info.wlock();
   if (version == info->version) {
     info->sha1 = sha1;
+    if (FLAGS_overlayPersistSha1) {
+      // Persist the record while holding the lock, so a concurrent
+      // modification cannot clear the header before this write lands.
+      std::array<uint8_t, FsOverlay::kHeaderSha1Length> record;
+      folly::IOBuf recordBuf{folly::IOBuf::WRAP_BUFFER,
+                             folly::MutableByteRange{record}};
+      recordBuf.clear();
+      folly::io::Appender appender(&recordBuf, 0);
+      appender.push(FsOverlay::kHeaderSha1Identifier);
+      appender.writeBE<uint64_t>(off - FsOverlay::kHeaderLength);
+      appender.push(sha1.getBytes());
+      DCHECK_EQ(record.size(), recordBuf.length());
+
+      struct iovec iov;
+      iov.iov_base = record.data();
+      iov.iov_len = record.size();
+      auto ret = entry->file.pwritev(&iov, 1, FsOverlay::kHeaderSha1Offset);
+      if (ret.hasError()) {
+        // Not fatal: the SHA-1 is simply recomputed next time.  The header is
+        // in an unknown state, though, so make sure it gets cleared.
+        XLOG(WARN) << "failed to persist SHA-1 for inode " << inode.getNodeId()
+                   << ": " << folly::errnoStr(ret.error());
+      }
+      info->headerSha1MayExist = true;
+    }
   }
   return sha1;
 }
 
+std::optional<std::pair<size_t, Hash>> OverlayFileAccess::readHeaderSha1(
+    FileInode& inode,
+    Entry& entry) {
+  std::array<uint8_t, FsOverlay::kHeaderSha1Length> record;
+  auto ret = entry.file.preadNoInt(
+      record.data(), record.size(), FsOverlay::kHeaderSha1Offset);
+  if (ret.hasError() || static_cast<size_t>(ret.value()) != record.size()) {
+    return std::nullopt;
+  }
+
+  folly::IOBuf recordBuf{folly::IOBuf::WRAP_BUFFER, folly::ByteRange{record}};
+  folly::io::Cursor cursor(&recordBuf);
+  auto id = cursor.readFixedString(FsOverlay::kHeaderSha1Identifier.size());
+  if (folly::StringPiece{id} != FsOverlay::kHeaderSha1Identifier) {
+    return std::nullopt;
+  }
+  auto size = cursor.readBE<uint64_t>();
+  Hash sha1;
+  cursor.pull(sha1.mutableBytes().begin(), Hash::RAW_SIZE);
+
+  // A size mismatch means the file was modified without clearing the record,
+  // e.g. its data reached the disk but the cleared header did not.
+  if (size != static_cast<uint64_t>(getFileSize(inode))) {
+    XLOG(DBG2) << "ignoring stale persisted SHA-1 for inode "
+               << inode.getNodeId();
+    return std::nullopt;
+  }
+  return std::make_pair(static_cast<size_t>(size), sha1);
+}
+
+void OverlayFileAccess::invalidateMetadata(FileInode& inode, Entry& entry) {
+  auto info = entry.info.wlock();
+  info->invalidateMetadata();
+  if (!info->headerSha1MayExist) {
+    return;
+  }
+
+  // Clearing the identifier is enough to invalidate the whole record.
+  std::array<uint8_t, FsOverlay::kHeaderSha1Identifier.size()> zeroes{};
+  struct iovec iov;
+  iov.iov_base = zeroes.data();
+  iov.iov_len = zeroes.size();
+  auto ret = entry.file.pwritev(&iov, 1, FsOverlay::kHeaderSha1Offset);
+  if (ret.hasError()) {
+    throw InodeError(
+        ret.error(),
+        inode.inodePtrFromThis(),
+        "unable to clear SHA-1 in overlay file header");
+  }
+  info->headerSha1MayExist = false;
+}
+
 std::string OverlayFileAccess::readAllContents(FileInode& inode) {
   auto entry = getEntryForInode(inode.getNodeId());
 
@@ -194,9 +364,36 @@ std::string OverlayFileAccess::readAllContents(FileInode& inode) {
   return result.value();
 }
 
-BufVec OverlayFileAccess::read(FileInode& inode, size_t size, off_t off) {
+BufVec OverlayFileAccess::read(
+    FileInode& inode,
+    size_t size,
+    off_t off,
+    bool splicing) {
   auto entry = getEntryForInode(inode.getNodeId());
 
+  if (FLAGS_overlayMmapCacheBytes > 0) {
+    if (auto buf = readMapped(inode, entry, size, off)) {
+      return BufVec{std::move(buf)};
+    }
+  }
+
+  // Without splicing, a file descriptor range would only be read into memory
+  // later, after an extra getFileSize().
+  if (splicing && FLAGS_overlaySpliceReadMinSize > 0 &&
+      size >= FLAGS_overlaySpliceReadMinSize) {
+    // The reply length has to be known before the data is spliced, so clamp
+    // the range to the current file size.  The size is normally cached, so
+    // this does not cost an extra syscall.
+    auto fileSize = getFileSize(inode);
+    if (off >= fileSize) {
+      return BufVec{folly::IOBuf::wrapBuffer("", 0)};
+    }
+    auto length = std::min(size, static_cast<size_t>(fileSize - off));
+    auto fd = entry->file.fd();
+    return BufVec::fromFd(
+        fd, off + FsOverlay::kHeaderLength, length, std::move(entry));
+  }
+
   auto buf = folly::IOBuf::createCombined(size);
   auto res = entry->file.preadNoInt(
       buf->writableBuffer(), size, off + FsOverlay::kHeaderLength);
@@ -212,6 +409,136 @@ BufVec OverlayFileAccess::read(FileInode& inode, size_t size, off_t off) {
   return BufVec{std::move(buf)};
 }
 
+std::unique_ptr<folly::IOBuf> OverlayFileAccess::readMapped(
+    FileInode& inode,
+    const EntryPtr& entry,
+    size_t size,
+    off_t off) {
+  auto ino = inode.getNodeId();
+  uint64_t version;
+  {
+    auto info = entry->info.rlock();
+    if (info->mapping) {
+      auto buf = copyFromMapping(*info->mapping, size, off);
+      info.unlock();
+      // Mark the mapping as recently used.
+      state_.wlock()->mappings.find(ino);
+      return buf;
+    }
+    version = info->version;
+  }
+
+  auto fileSize = static_cast<size_t>(getFileSize(inode));
+  if (fileSize == 0 || fileSize > FLAGS_overlayMmapCacheBytes) {
+    return nullptr;
+  }
+
+  // Map the file while no lock is held.
+  std::shared_ptr<const folly::MemoryMapping> mapping;
+  try {
+    mapping = std::make_shared<const folly::MemoryMapping>(
+        entry->file.fd(), 0, fileSize + FsOverlay::kHeaderLength);
+  } catch (const std::exception& ex) {
+    XLOG(DBG3) << "unable to map overlay file for inode " << ino << ": "
+               << folly::exceptionStr(ex);
+    return nullptr;
+  }
+
+  std::unique_ptr<folly::IOBuf> buf;
+  {
+    auto info = entry->info.wlock();
+    if (version != info->version) {
+      // The file was modified while it was being mapped.
+      return nullptr;
+    }
+    if (info->mapping) {
+      // A concurrent read mapped it first.
+      return copyFromMapping(*info->mapping, size, off);
+    }
+    info->mapping = mapping;
+    buf = copyFromMapping(*mapping, size, off);
+  }
+
+  addMapping(ino, entry, mapping);
+  return buf;
+}
+
+void OverlayFileAccess::addMapping(
+    InodeNumber ino,
+    const EntryPtr& entry,
+    const std::shared_ptr<const folly::MemoryMapping>& mapping) {
+  std::vector<MappingRef> victims;
+  {
+    auto state = state_.wlock();
+    auto iter = state->mappings.find(ino);
+    if (iter != state->mappings.end()) {
+      state->mappedBytes -= iter->second.length;
+    }
+    auto length = mapping->range().size();
+    state->mappings.set(ino, MappingRef{entry, mapping, length});
+    state->mappedBytes += length;
+
+    while (state->mappedBytes > FLAGS_overlayMmapCacheBytes &&
+           state->mappings.size() > 1) {
+      auto oldest = state->mappings.rbegin();
+      auto oldestIno = oldest->first;
+      state->mappedBytes -= oldest->second.length;
+      victims.push_back(std::move(oldest->second));
+      state->mappings.erase(oldestIno);
+    }
+  }
+
+  // Unmap the victims while the state lock is not held.
+  unmap(victims);
+}
+
+void OverlayFileAccess::unmap(const std::vector<MappingRef>& refs) {
+  for (auto& ref : refs) {
+    auto entry = ref.entry.lock();
+    auto mapping = ref.mapping.lock();
+    if (!entry || !mapping) {
+      // Already unmapped by a modification or by closing the file.
+      continue;
+    }
+    auto info = entry->info.wlock();
+    if (info->mapping == mapping) {
+      info->mapping.reset();
+    }
+  }
+}
+
+void OverlayFileAccess::clearCache() {
+  std::vector<EntryPtr> entries;
+  std::vector<MappingRef> mappings;
+  {
+    auto state = state_.wlock();
+    for (auto& [ino, entry] : state->entries) {
+      entries.push_back(std::move(entry));
+    }
+    for (auto& [ino, ref] : state->mappings) {
+      mappings.push_back(std::move(ref));
+    }
+    state->entries.clear();
+    state->entries.setMaxSize(state->minCacheSize);
+    state->evicted.clear();
+    state->lookupsSinceEvictedMiss = 0;
+    state->mappings.clear();
+    state->mappedBytes = 0;
+  }
+
+  // Unmap and close the files while the state lock is not held.  Files that
+  // are still being read or written are closed once that finishes.
+  unmap(mappings);
+}
+
+size_t OverlayFileAccess::getFileCacheCapacity() const {
+  return state_.rlock()->entries.getMaxSize();
+}
+
+size_t OverlayFileAccess::getMappedBytes() const {
+  return state_.rlock()->mappedBytes;
+}
+
 size_t OverlayFileAccess::write(
     FileInode& inode,
     const struct iovec* iov,
@@ -219,6 +546,7 @@ size_t OverlayFileAccess::write(
     off_t off) {
   auto entry = getEntryForInode(inode.getNodeId());
 
+  invalidateMetadata(inode, *entry);
   auto xfer = entry->file.pwritev(iov, iovcnt, off + FsOverlay::kHeaderLength);
   if (xfer.hasError()) {
     throw InodeError(
@@ -226,14 +554,14 @@ size_t OverlayFileAccess::write(
         inode.inodePtrFromThis(),
         "pwritev failed during file write");
   }
-  auto info = entry->info.wlock();
-  info->invalidateMetadata();
+  invalidateMetadata(inode, *entry);
 
   return xfer.value();
 }
 
 void OverlayFileAccess::truncate(FileInode& inode, off_t size) {
   auto entry = getEntryForInode(inode.getNodeId());
+  invalidateMetadata(inode, *entry);
   auto result = entry->file.ftruncate(size + FsOverlay::kHeaderLength);
   if (result.hasError()) {
     throw InodeError(
@@ -241,9 +569,7 @@ void OverlayFileAccess::truncate(FileInode& inode, off_t size) {
         inode.inodePtrFromThis(),
         "unable to ftruncate overlay file");
   }
-
-  auto info = entry->info.wlock();
-  info->invalidateMetadata();
+  invalidateMetadata(inode, *entry);
 }
 
 void OverlayFileAccess::fsync(FileInode& inode, bool datasync) {
@@ -266,16 +592,16 @@ OverlayFileAccess::EntryPtr OverlayFileAccess::getEntryForInode(
     auto state = state_.wlock();
     auto iter = state->entries.find(ino);
     if (iter != state->entries.end()) {
+      adaptCacheSize(*state, false);
       return iter->second;
     }
+    adaptCacheSize(*state, state->evicted.erase(ino));
   }
 
-  // No entry found. Open one while the lock is not held.
-  // TODO: A possible future optimization here is, if a SHA-1 is known when
-  // the blob is evicted, write it into an xattr when the blob is closed. When
-  // reopened, if the xattr exists, read it back out (and clear).
+  // No entry found. Open one while the lock is not held.  Its SHA-1 may have
+  // been persisted in the header; see getSha1().
   auto entry = std::make_shared<Entry>(
-      overlay_->openFileNoVerify(ino), std::nullopt, std::nullopt);
+      overlay_->openFileNoVerify(ino), std::nullopt, std::nullopt, false);
 
   {
     auto state = state_.wlock();
@@ -285,5 +611,31 @@ OverlayFileAccess::EntryPtr OverlayFileAccess::getEntryForInode(
   return entry;
 }
 
+void OverlayFileAccess::adaptCacheSize(State& state, bool evictedMiss) {
+  if (state.maxCacheSize <= state.minCacheSize) {
+    return;
+  }
+
+  auto capacity = state.entries.getMaxSize();
+  if (evictedMiss) {
+    state.lookupsSinceEvictedMiss = 0;
+    if (capacity < state.maxCacheSize) {
+      auto newCapacity = std::min(
+          state.maxCacheSize, capacity + std::max<size_t>(capacity / 4, 1));
+      XLOG(DBG4) << "growing overlay file cache to " << newCapacity;
+      state.entries.setMaxSize(newCapacity);
+    }
+  } else if (
+      ++state.lookupsSinceEvictedMiss >= capacity * kShrinkLookupsPerEntry) {
+    state.lookupsSinceEvictedMiss = 0;
+    if (capacity > state.minCacheSize) {
+      auto newCapacity = std::max(
+          state.minCacheSize, capacity - std::max<size_t>(capacity / 8, 1));
+      XLOG(DBG4) << "shrinking overlay file cache to " << newCapacity;
+      state.entries.setMaxSize(newCapacity);
+    }
+  }
+}
+
 } // namespace eden
 } // namespace facebook
@@ -9,8 +9,11 @@
 
 #include <folly/File.h>
 #include <folly/Synchronized.h>
+#include <folly/Unit.h>
 #include <folly/container/EvictingCacheMap.h>
+#include <folly/system/MemoryMapping.h>
 #include <memory>
+#include <vector>
 #include "eden/fs/fuse/BufVec.h"
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/inodes/OverlayFile.h"
@@ -27,6 +30,12 @@ class Overlay;
  * Provides a file handle caching layer between FileInode and the Overlay. Read
  * and write operations for different inodes can be interleaved, and the
  * OverlayFileAccess will keep a number of file handles open in LRU.
+ *
+ * The number of file handles grows from overlayFileCacheSize up to
+ * overlayFileCacheMaxSize while recently closed files keep being reopened,
+ * and shrinks back once they are not.  Optionally, the contents of files that
+ * are read repeatedly are kept mapped into memory, up to overlayMmapCacheBytes
+ * in total, so reads do not need a syscall.
  */
 class OverlayFileAccess {
  public:
@@ -55,6 +64,17 @@ class OverlayFileAccess {
       const Blob& blob,
       const std::optional<Hash>& sha1);
 
+  /**
+   * Like createFile(), but copies the blob with the given hash from the
+   * overlay's blob file cache without needing its contents in memory.
+   * Returns false, creating nothing, if the blob cannot be copied that way.
+   */
+  bool createFileFromBlobFile(
+      InodeNumber ino,
+      const Hash& blobHash,
+      uint64_t blobSize,
+      const std::optional<Hash>& sha1);
+
   /**
    * Return the size of the overlay file at the given inode number. The result
    * will never be negative.
@@ -77,8 +97,31 @@ class OverlayFileAccess {
   /**
    * Reads a range from the file. At EOF, may return a BufVec smaller than the
    * requested size.
+   *
+   * If splicing is true, large reads are not performed immediately: the
+   * returned BufVec refers to the overlay file descriptor so that FuseChannel
+   * can splice the data to the kernel without copying it through userspace.
+   */
+  BufVec read(FileInode& inode, size_t size, off_t off, bool splicing);
+
+  /**
+   * Returns the number of file handles the LRU cache currently holds at most.
    */
-  BufVec read(FileInode& inode, size_t size, off_t off);
+  size_t getFileCacheCapacity() const;
+
+  /**
+   * Returns the number of bytes of overlay files currently mapped into memory
+   * for reads.  Approximate: mappings dropped by write() or truncate() are
+   * only subtracted once they are pruned from the mapping LRU.
+   */
+  size_t getMappedBytes() const;
+
+  /**
+   * Closes every cached file handle and unmaps every mapped file, and resets
+   * the file handle cache to overlayFileCacheSize.  Used to release memory
+   * under memory pressure.
+   */
+  void clearCache();
 
   /**
    * Writes data into the file at the specified offset. Returns the number of
@@ -116,21 +159,47 @@ class OverlayFileAccess {
    * concurrent with write or truncate, a version number is incremented on every
    * modification to an entry's file, and checked before writing the cached
    * value back.
+   *
+   * The SHA-1 may also be persisted in the overlay file header so that it
+   * outlives the entry.  Before the file is modified the persisted copy is
+   * cleared, with the info lock held.
+   *
+   * A memory mapping of the file, if any, is owned by Info and only read with
+   * the info lock held.  invalidateMetadata() drops it before the file is
+   * modified, so a read can never touch pages past a truncated end of file.
+   * State::mappings only holds weak references, in LRU order, to bound the
+   * total mapped bytes.  The state lock is never held while acquiring an
+   * info lock.
    */
 
   struct Entry {
-    Entry(OverlayFile f, std::optional<size_t> s, const std::optional<Hash>& h)
-        : file{std::move(f)}, info{folly::in_place, s, h} {}
+    Entry(
+        OverlayFile f,
+        std::optional<size_t> s,
+        const std::optional<Hash>& h,
+        bool created)
+        : file{std::move(f)}, info{folly::in_place, s, h, created} {}
 
     struct Info {
-      Info(std::optional<size_t> s, const std::optional<Hash>& h)
-          : size{s}, sha1{h} {}
+      Info(std::optional<size_t> s, const std::optional<Hash>& h, bool created)
+          : size{s}, sha1{h}, headerSha1MayExist{!created} {}
 
       void invalidateMetadata();
 
       std::optional<size_t> size;
       std::optional<Hash> sha1;
       uint64_t version{0};
+
+      /**
+       * The whole overlay file, header included, mapped into memory.
+       */
+      std::shared_ptr<const folly::MemoryMapping> mapping;
+
+      /**
+       * False once the overlay file header is known not to hold a SHA-1
+       * record, so modifications do not need to clear it.
+       */
+      bool headerSha1MayExist;
     };
 
     const OverlayFile file;
@@ -139,10 +208,33 @@ class OverlayFileAccess {
 
   using EntryPtr = std::shared_ptr<Entry>;
 
+  struct MappingRef {
+    std::weak_ptr<Entry> entry;
+    std::weak_ptr<const folly::MemoryMapping> mapping;
+    size_t length;
+  };
+
   struct State {
-    explicit State(size_t cacheSize);
+    State(size_t cacheSize, size_t maxCacheSize);
 
     folly::EvictingCacheMap<InodeNumber, EntryPtr> entries;
+
+    /**
+     * Inodes recently evicted from entries.  Reopening one of them means the
+     * open-file working set does not fit in the cache.
+     */
+    folly::EvictingCacheMap<InodeNumber, folly::Unit> evicted;
+
+    size_t minCacheSize;
+    size_t maxCacheSize;
+
+    /**
+     * Lookups since the cache last had to reopen a recently evicted inode.
+     */
+    size_t lookupsSinceEvictedMiss{0};
+
+    folly::EvictingCacheMap<InodeNumber, MappingRef> mappings{0};
+    size_t mappedBytes{0};
   };
 
   using LockedStatePtr = folly::Synchronized<State>::LockedPtr;
@@ -153,8 +245,51 @@ class OverlayFileAccess {
    */
   EntryPtr getEntryForInode(InodeNumber);
 
+  /**
+   * Adjusts the capacity of the entries cache after a lookup.  Grows it when
+   * a recently evicted inode is reopened, and shrinks it after a full cache's
+   * worth of lookups did not need to.
+   */
+  static void adaptCacheSize(State& state, bool evictedMiss);
+
+  /**
+   * Reads a range from the entry's file through its memory mapping, mapping
+   * the file if it fits in overlayMmapCacheBytes.  Returns nullptr if the
+   * file should be read with pread instead.
+   */
+  std::unique_ptr<folly::IOBuf>
+  readMapped(FileInode& inode, const EntryPtr& entry, size_t size, off_t off);
+
+  /**
+   * Adds a new mapping to the mapping LRU and unmaps the least recently used
+   * files until the total fits in overlayMmapCacheBytes again.
+   */
+  void addMapping(
+      InodeNumber ino,
+      const EntryPtr& entry,
+      const std::shared_ptr<const folly::MemoryMapping>& mapping);
+
+  /**
+   * Unmaps the files referenced by the given mapping LRU entries, unless they
+   * have been unmapped or remapped since.
+   */
+  static void unmap(const std::vector<MappingRef>& refs);
+
+  /**
+   * Forget the cached size and SHA-1 of the entry's file, including any copy
+   * persisted in its header.  Called both before and after modifying the file.
+   */
+  void invalidateMetadata(FileInode& inode, Entry& entry);
+
+  /**
+   * Returns the size and SHA-1 persisted in the entry's file header, if any.
+   */
+  std::optional<std::pair<size_t, Hash>> readHeaderSha1(
+      FileInode& inode,
+      Entry& entry);
+
   Overlay* overlay_ = nullptr;
-  folly::Synchronized<State> state_;
+  mutable folly::Synchronized<State> state_;
 };
 
 } // namespace eden
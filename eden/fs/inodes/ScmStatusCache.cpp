@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/ScmStatusCache.h"
+
+#include <folly/Conv.h>
+
+namespace facebook {
+namespace eden {
+
+std::optional<ScmStatusCache::Entry> ScmStatusCache::get(
+    const Hash& commitHash,
+    bool listIgnored) const {
+  auto entry = entry_.rlock();
+  if (!entry->has_value() || (*entry)->commitHash != commitHash ||
+      (*entry)->listIgnored != listIgnored) {
+    return std::nullopt;
+  }
+  return *entry;
+}
+
+void ScmStatusCache::insert(Entry newEntry) {
+  auto entry = entry_.wlock();
+  if (entry->has_value() && (*entry)->commitHash == newEntry.commitHash &&
+      (*entry)->listIgnored == newEntry.listIgnored &&
+      (*entry)->sequence > newEntry.sequence) {
+    return;
+  }
+  *entry = std::move(newEntry);
+}
+
+void ScmStatusCache::clear() {
+  entry_.wlock()->reset();
+}
+
+bool ScmStatusCache::hasEntriesUnder(
+    const ScmStatus& status,
+    RelativePathPiece path) {
+  auto prefix = folly::to<std::string>(path.stringPiece(), '/');
+  auto iter = status.entries.lower_bound(prefix);
+  return iter != status.entries.end() &&
+      folly::StringPiece{iter->first}.startsWith(prefix);
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <optional>
+#include "eden/fs/journal/JournalDelta.h"
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/service/gen-cpp2/eden_types.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * ScmStatusCache remembers the most recent status result computed for an
+ * EdenMount, along with the journal sequence number it reflects.
+ *
+ * EdenMount uses this to answer repeated status calls without a full diff:
+ * if the journal has not moved the cached result is returned as is, and
+ * otherwise only the paths recorded in the journal since then are re-checked.
+ */
+class ScmStatusCache {
+ public:
+  struct Entry {
+    Hash commitHash;
+    bool listIgnored{false};
+    /**
+     * The latest journal sequence number at the time the diff that produced
+     * this status started.  Every change recorded after it may be missing.
+     */
+    JournalDelta::SequenceNumber sequence{0};
+    ScmStatus status;
+  };
+
+  /**
+   * Return a copy of the cached entry if it was computed against commitHash
+   * with the same listIgnored setting.
+   */
+  std::optional<Entry> get(const Hash& commitHash, bool listIgnored) const;
+
+  /**
+   * Replace the cached entry.  If concurrent status calls race, the entry
+   * reflecting the later journal position wins.
+   */
+  void insert(Entry entry);
+
+  /**
+   * Forget the cached entry, e.g. to release its memory once the cache has
+   * been disabled.
+   */
+  void clear();
+
+  /**
+   * Return true if status reports anything strictly below the directory at
+   * path.
+   */
+  static bool hasEntriesUnder(const ScmStatus& status, RelativePathPiece path);
+
+ private:
+  folly::Synchronized<std::optional<Entry>> entry_;
+};
+
+} // namespace eden
+} // namespace facebook
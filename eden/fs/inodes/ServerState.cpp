@@ -48,12 +48,14 @@ ServerState::ServerState(
       structuredLogger_{std::move(structuredLogger)},
       faultInjector_{std::make_unique<FaultInjector>(enableFaultDetection)},
       config_{edenConfig},
-      userIgnoreFileMonitor_{CachedParsedFileMonitor<GitIgnoreFileParser>{
-          edenConfig->userIgnoreFile.getValue(),
-          kUserIgnoreMinPollSeconds}},
-      systemIgnoreFileMonitor_{CachedParsedFileMonitor<GitIgnoreFileParser>{
-          edenConfig->systemIgnoreFile.getValue(),
-          kSystemIgnoreMinPollSeconds}},
+      userIgnoreFileMonitor_{
+          CachedParsedFileMonitor<SharedGitIgnoreFileParser>{
+              edenConfig->userIgnoreFile.getValue(),
+              kUserIgnoreMinPollSeconds}},
+      systemIgnoreFileMonitor_{
+          CachedParsedFileMonitor<SharedGitIgnoreFileParser>{
+              edenConfig->systemIgnoreFile.getValue(),
+              kSystemIgnoreMinPollSeconds}},
       notifications_(config_) {
   // It would be nice if we eventually built a more generic mechanism for
   // defining faults to be configured on start up.  (e.g., loading this from the
@@ -70,6 +72,18 @@ ServerState::ServerState(
 
 ServerState::~ServerState() {}
 
+std::shared_ptr<UnboundedQueueExecutor> ServerState::getCheckoutThreadPool() {
+  auto parallelism = getEdenConfig()->checkoutParallelism.getValue();
+  if (parallelism <= 1) {
+    return nullptr;
+  }
+  auto pool = checkoutThreadPool_.wlock();
+  if (!*pool) {
+    *pool = std::make_shared<UnboundedQueueExecutor>(parallelism, "Checkout");
+  }
+  return *pool;
+}
+
 std::unique_ptr<TopLevelIgnores> ServerState::getTopLevelIgnores() {
   // Update EdenConfig to detect changes to the system or user ignore files
   auto edenConfig = getEdenConfig();
@@ -78,20 +92,21 @@ std::unique_ptr<TopLevelIgnores> ServerState::getTopLevelIgnores() {
   auto userIgnoreFile = edenConfig->userIgnoreFile.getValue();
   auto systemIgnoreFile = edenConfig->systemIgnoreFile.getValue();
 
-  // Get the userIgnoreFile
-  GitIgnore userGitIgnore{};
+  // Get the userIgnoreFile.  The monitors only re-parse a file once it
+  // changes, and hand out shared references to the parsed rules.
+  std::shared_ptr<const GitIgnore> userGitIgnore;
   auto fcResult =
       userIgnoreFileMonitor_.wlock()->getFileContents(userIgnoreFile);
   if (fcResult.hasValue()) {
-    userGitIgnore = fcResult.value();
+    userGitIgnore = std::move(fcResult.value());
   }
 
   // Get the systemIgnoreFile
-  GitIgnore systemGitIgnore{};
+  std::shared_ptr<const GitIgnore> systemGitIgnore;
   fcResult =
       systemIgnoreFileMonitor_.wlock()->getFileContents(systemIgnoreFile);
   if (fcResult.hasValue()) {
-    systemGitIgnore = fcResult.value();
+    systemGitIgnore = std::move(fcResult.value());
   }
   return std::make_unique<TopLevelIgnores>(
       std::move(userGitIgnore), std::move(systemGitIgnore));
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <folly/Synchronized.h>
 #include <folly/ThreadLocal.h>
 #include <chrono>
 #include <memory>
@@ -124,6 +125,15 @@ class ServerState {
     return threadPool_;
   }
 
+  /**
+   * Get the thread pool that checkout operations use to process subtrees in
+   * parallel.
+   *
+   * Returns nullptr if checkout:parallelism is 1 or less.  Otherwise the pool
+   * is created on first use, with checkout:parallelism threads.
+   */
+  std::shared_ptr<UnboundedQueueExecutor> getCheckoutThreadPool();
+
   /**
    * Get the Clock.
    */
@@ -153,15 +163,17 @@ class ServerState {
   EdenStats edenStats_;
   std::shared_ptr<PrivHelper> privHelper_;
   std::shared_ptr<UnboundedQueueExecutor> threadPool_;
+  folly::Synchronized<std::shared_ptr<UnboundedQueueExecutor>>
+      checkoutThreadPool_;
   std::shared_ptr<Clock> clock_;
   std::shared_ptr<ProcessNameCache> processNameCache_;
   std::shared_ptr<StructuredLogger> structuredLogger_;
   std::unique_ptr<FaultInjector> const faultInjector_;
 
   ReloadableConfig config_;
-  folly::Synchronized<CachedParsedFileMonitor<GitIgnoreFileParser>>
+  folly::Synchronized<CachedParsedFileMonitor<SharedGitIgnoreFileParser>>
       userIgnoreFileMonitor_;
-  folly::Synchronized<CachedParsedFileMonitor<GitIgnoreFileParser>>
+  folly::Synchronized<CachedParsedFileMonitor<SharedGitIgnoreFileParser>>
       systemIgnoreFileMonitor_;
   Notifications notifications_;
 };
@@ -14,6 +14,7 @@
 #include <folly/logging/xlog.h>
 #include <vector>
 
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/inodes/CheckoutAction.h"
 #include "eden/fs/inodes/CheckoutContext.h"
 #include "eden/fs/inodes/DeferredDiffEntry.h"
@@ -25,12 +26,15 @@
 #include "eden/fs/inodes/OverlayFile.h"
 #include "eden/fs/inodes/ServerState.h"
 #include "eden/fs/inodes/TreePrefetchLease.h"
+#include "eden/fs/inodes/TreePrefetchPolicy.h"
 #include "eden/fs/journal/JournalDelta.h"
+#include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/model/TreeEntry.h"
 #include "eden/fs/model/git/GitIgnoreStack.h"
 #include "eden/fs/service/ThriftUtil.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
+#include "eden/fs/store/BlobAccess.h"
 #include "eden/fs/store/DiffCallback.h"
 #include "eden/fs/store/DiffContext.h"
 #include "eden/fs/store/ObjectStore.h"
@@ -39,6 +43,7 @@
 #include "eden/fs/utils/Clock.h"
 #include "eden/fs/utils/FaultInjector.h"
 #include "eden/fs/utils/PathFuncs.h"
+#include "eden/fs/utils/ProcessNameCache.h"
 #include "eden/fs/utils/Synchronized.h"
 #include "eden/fs/utils/TimeUtil.h"
 #include "eden/fs/utils/UnboundedQueueExecutor.h"
@@ -50,6 +55,7 @@
 #else
 #include <folly/FileUtil.h>
 #include "eden/fs/fuse/DirList.h"
+#include "eden/fs/fuse/Dispatcher.h"
 #include "eden/fs/fuse/FuseChannel.h"
 #include "eden/fs/fuse/RequestData.h"
 #include "eden/fs/inodes/EdenDispatcher.h"
@@ -72,7 +78,22 @@ namespace eden {
 
 namespace {
 static constexpr PathComponentPiece kIgnoreFilename{".gitignore"};
+
+/**
+ * Fulfill the promises waiting for an inode load.  The last promise takes
+ * over the given reference instead of copying it, so the usual single waiter
+ * costs no reference count update.
+ */
+void fulfillLoadPromises(InodeMap::PromiseVector& promises, InodePtr inode) {
+  if (promises.empty()) {
+    return;
+  }
+  for (size_t i = 0; i + 1 < promises.size(); ++i) {
+    promises[i].setValue(inode);
+  }
+  promises.back().setValue(std::move(inode));
 }
+} // namespace
 
 /**
  * A helper class to track info about inode loads that we started while holding
@@ -176,6 +197,26 @@ TreeInode::TreeInode(
 
 TreeInode::~TreeInode() {}
 
+std::optional<RelativePath> TreeInode::getCachedPath() const {
+  // Read the generation before computing the path, so that a rename that
+  // races with the computation leaves the cached result stale.
+  auto generation = getMount()->getPathGeneration();
+  {
+    auto cached = cachedPath_.rlock();
+    if (cached->generation == generation) {
+      return cached->path;
+    }
+  }
+
+  auto path = getPath();
+  auto cached = cachedPath_.wlock();
+  if (cached->generation < generation) {
+    cached->generation = generation;
+    cached->path = path;
+  }
+  return path;
+}
+
 folly::Future<struct stat> TreeInode::stat() {
   auto st = getMount()->initStatData();
   st.st_ino = folly::to_narrow(getNodeId().get());
@@ -240,12 +281,18 @@ Future<InodePtr> TreeInode::getOrLoadChild(PathComponentPiece name) {
 
                // Check to see if the entry is already loaded
                const auto& entry = iter->second;
-               if (entry.getInode()) {
+               if (auto* child = entry.getInode()) {
+                 child->markAccessed();
                  return makeFuture<InodePtr>(entry.getInodePtr());
                }
                return folly::none;
              },
              [&](auto& contents) {
+#ifndef _WIN32
+               if (RequestData::isFuseRequest()) {
+                 RequestData::get().getEdenTopStats().setDidLoadInode();
+               }
+#endif // !_WIN32
                auto inodeLoadFuture =
                    Future<unique_ptr<InodeBase>>::makeEmpty();
                auto returnFuture = Future<InodePtr>::makeEmpty();
@@ -289,9 +336,7 @@ Future<InodePtr> TreeInode::getOrLoadChild(PathComponentPiece name) {
                if (inodeLoadFuture.valid()) {
                  registerInodeLoadComplete(inodeLoadFuture, name, childNumber);
                } else {
-                 for (auto& promise : promises) {
-                   promise.setValue(childInodePtr);
-                 }
+                 fulfillLoadPromises(promises, std::move(childInodePtr));
                }
 
                return returnFuture;
@@ -299,6 +344,89 @@ Future<InodePtr> TreeInode::getOrLoadChild(PathComponentPiece name) {
       .ensure([b = std::move(block)]() mutable { b.close(); });
 }
 
+std::vector<Future<InodePtr>> TreeInode::getOrLoadChildren(
+    const std::vector<PathComponentPiece>& names,
+    ObjectFetchContext& fetchContext,
+    std::vector<Hash>* fileBlobs) {
+  TraceBlock block("getOrLoadChildren");
+
+  // Names that getOrLoadChild() has to handle once the lock is released.
+  std::vector<size_t> deferred;
+  std::vector<Hash> blobs;
+  std::vector<IncompleteInodeLoad> pendingLoads;
+
+  // Looks up every name, calling loadChild for the children that are not
+  // loaded yet.  Gives up if loadChild returns an empty Future.
+  auto lookUp = [&](auto& entries, auto&& loadChild)
+      -> folly::Optional<std::vector<Future<InodePtr>>> {
+    std::vector<Future<InodePtr>> results;
+    results.reserve(names.size());
+    deferred.clear();
+    blobs.clear();
+    for (auto name : names) {
+#ifndef _WIN32
+      if (name == kDotEdenName && getNodeId() != kRootNodeId) {
+        deferred.push_back(results.size());
+        results.push_back(Future<InodePtr>::makeEmpty());
+        continue;
+      }
+#endif // !_WIN32
+
+      auto iter = entries.find(name);
+      if (iter == entries.end()) {
+        results.push_back(makeFuture<InodePtr>(
+            InodeError(ENOENT, inodePtrFromThis(), name)));
+        continue;
+      }
+
+      auto& entry = iter->second;
+      if (fileBlobs && !entry.isDirectory() && !entry.isMaterialized()) {
+        blobs.push_back(entry.getHash());
+      }
+      if (auto* child = entry.getInode()) {
+        child->markAccessed();
+        results.push_back(makeFuture<InodePtr>(entry.getInodePtr()));
+        continue;
+      }
+      auto future = loadChild(name, entry);
+      if (!future.valid()) {
+        return folly::none;
+      }
+      results.push_back(std::move(future));
+    }
+    return results;
+  };
+
+  // Usually every child is already loaded, which only needs the read lock.
+  auto results = tryRlockCheckBeforeUpdate<std::vector<Future<InodePtr>>>(
+      contents_,
+      [&](const auto& contents) {
+        return lookUp(contents.entries, [](PathComponentPiece, const auto&) {
+          // Starting a load needs the write lock.
+          return Future<InodePtr>::makeEmpty();
+        });
+      },
+      [&](auto& contents) {
+        return *lookUp(
+            contents->entries, [&](PathComponentPiece name, auto& entry) {
+              return loadChildLocked(
+                  contents->entries, name, entry, pendingLoads, fetchContext);
+            });
+      });
+  if (fileBlobs) {
+    fileBlobs->insert(fileBlobs->end(), blobs.begin(), blobs.end());
+  }
+
+  // The loads can only be completed once the contents_ lock is released.
+  for (auto& load : pendingLoads) {
+    load.finish();
+  }
+  for (auto index : deferred) {
+    results[index] = getOrLoadChild(names[index]);
+  }
+  return results;
+}
+
 Future<TreeInodePtr> TreeInode::getOrLoadChildTree(PathComponentPiece name) {
   return getOrLoadChild(name).thenValue([](InodePtr child) {
     auto treeInode = child.asTreePtrOrNull();
@@ -321,7 +449,8 @@ namespace {
  */
 class LookupProcessor {
  public:
-  explicit LookupProcessor(RelativePathPiece path) : path_{path} {}
+  explicit LookupProcessor(RelativePathPiece path, size_t pathIndex = 0)
+      : path_{path}, pathIndex_{pathIndex} {}
 
   Future<InodePtr> next(TreeInodePtr tree) {
     auto pathStr = path_.stringPiece();
@@ -351,14 +480,88 @@ Future<InodePtr> TreeInode::getChildRecursive(RelativePathPiece path) {
     return makeFuture<InodePtr>(inodePtrFromThis());
   }
 
-  auto processor = std::make_unique<LookupProcessor>(path);
-  auto future = processor->next(inodePtrFromThis());
+  // Walk through the children that are already loaded without taking a
+  // reference on each of them.  Each directory's contents lock is held until
+  // its child's has been acquired, which keeps the child from being unloaded
+  // or renamed out from under us, so only the inode that is eventually
+  // returned needs its reference count bumped.
+  TreeInodePtr start;
+  size_t pathIndex = 0;
+  {
+    TreeInode* tree = this;
+    decltype(contents_.rlock()) parentContents;
+    auto contents = contents_.rlock();
+    while (true) {
+      auto endIdx = pathStr.find(kDirSeparator, pathIndex);
+      auto nameEnd = endIdx == StringPiece::npos ? pathStr.end()
+                                                 : pathStr.begin() + endIdx;
+      auto name = PathComponentPiece{
+          StringPiece{pathStr.begin() + pathIndex, nameEnd}};
+      if (name == kDotEdenName) {
+        // getOrLoadChild() has special handling for .eden
+        break;
+      }
+      auto iter = contents->entries.find(name);
+      if (iter == contents->entries.end() || !iter->second.getInode()) {
+        break;
+      }
+      iter->second.getInode()->markAccessed();
+      if (endIdx == StringPiece::npos) {
+        return makeFuture<InodePtr>(iter->second.getInodePtr());
+      }
+      auto* child = iter->second.asTreeOrNull();
+      if (!child) {
+        // Let getOrLoadChildTree() report the ENOTDIR error.
+        break;
+      }
+      auto childContents = child->contents_.rlock();
+      parentContents = std::move(contents);
+      contents = std::move(childContents);
+      tree = child;
+      pathIndex = endIdx + 1;
+    }
+    // newPtrLocked() requires the parent's contents lock, which
+    // parentContents still holds for any tree other than this one.
+    start = tree == this ? inodePtrFromThis()
+                         : TreeInodePtr::newPtrLocked(tree);
+  }
+
+  auto processor = std::make_unique<LookupProcessor>(path, pathIndex);
+  auto future = processor->next(std::move(start));
   // This ensure() callback serves to hold onto the unique_ptr,
   // and makes sure it only gets destroyed when the future is finally resolved.
   return std::move(future).ensure(
       [p = std::move(processor)]() mutable { p.reset(); });
 }
 
+InodePtr TreeInode::getLoadedChild(PathComponentPiece name) {
+#ifndef _WIN32
+  if (name == kDotEdenName && getNodeId() != kRootNodeId) {
+    // getOrLoadChild() resolves this to the .eden/this-dir symlink.
+    return nullptr;
+  }
+#endif // !_WIN32
+
+  auto contents = contents_.rlock();
+  auto iter = contents->entries.find(name);
+  if (iter == contents->entries.end() || !iter->second.getInode()) {
+    return nullptr;
+  }
+  return iter->second.getInodePtr();
+}
+
+bool TreeInode::isChildMissing(PathComponentPiece name) {
+#ifndef _WIN32
+  if (name == kDotEdenName && getNodeId() != kRootNodeId) {
+    // getOrLoadChild() resolves this to the .eden/this-dir symlink.
+    return false;
+  }
+#endif // !_WIN32
+
+  auto contents = contents_.rlock();
+  return contents->entries.find(name) == contents->entries.end();
+}
+
 InodeNumber TreeInode::getChildInodeNumber(PathComponentPiece name) {
   auto contents = contents_.wlock();
   auto iter = contents->entries.find(name);
@@ -418,9 +621,7 @@ void TreeInode::loadUnlinkedChildInode(
     inodePtr->markUnlinkedAfterLoad();
 
     // Alert any waiters that the load is complete
-    for (auto& promise : promises) {
-      promise.setValue(inodePtr);
-    }
+    fulfillLoadPromises(promises, std::move(inodePtr));
 
   } catch (const std::exception& exc) {
     auto bug = EDEN_BUG_EXCEPTION()
@@ -523,10 +724,8 @@ void TreeInode::inodeLoadComplete(
   }
 
   // Fulfill all of the pending promises after releasing our lock
-  auto inodePtr = InodePtr::takeOwnership(std::move(childInode));
-  for (auto& promise : promises) {
-    promise.setValue(inodePtr);
-  }
+  fulfillLoadPromises(
+      promises, InodePtr::takeOwnership(std::move(childInode)));
 }
 
 Future<unique_ptr<InodeBase>> TreeInode::startLoadingInodeNoThrow(
@@ -764,6 +963,16 @@ void TreeInode::childMaterialized(
     childEntry.setMaterialized();
     contents->setMaterialized();
     saveOverlayDir(contents->entries);
+
+#ifndef _WIN32
+    // Data that prefetchBlobsAfter() pushed into the kernel's cache may be
+    // queued behind the write that materialized this file, so drop it again.
+    // This is queued under the lock so storeInKernelCache() cannot race it.
+    if (!childEntry.isDirectory() && getKernelStoreBudget(getMount()) > 0) {
+      getMount()->getFuseChannel()->invalidateInode(
+          childEntry.getInodeNumber(), 0, 0);
+    }
+#endif
   }
 
   // If we have a parent directory, ask our parent to materialize itself
@@ -851,18 +1060,23 @@ DirContents TreeInode::saveDirFromTree(
 DirContents TreeInode::buildDirFromTree(const Tree* tree, Overlay* overlay) {
   CHECK(tree);
 
-  // A future optimization is for this code to allocate all of the inode numbers
-  // at once and then dole them out, one per entry. It would reduce the number
-  // of atomic operations from N to 1, though if the atomic is issued with the
-  // other work this loop is doing it may not matter much.
-
+  const auto& entries = tree->getTreeEntries();
   DirContents dir;
+  if (entries.empty()) {
+    return dir;
+  }
+
+  // Allocate the inode numbers for all of the entries at once, so that
+  // loading a large directory costs one atomic operation instead of one per
+  // entry.
+  auto nextNumber = overlay->allocateInodeNumbers(entries.size()).get();
+  dir.reserve(entries.size());
   // TODO: O(N^2)
-  for (const auto& treeEntry : tree->getTreeEntries()) {
+  for (const auto& treeEntry : entries) {
     dir.emplace(
         treeEntry.getName(),
         modeFromTreeEntryType(treeEntry.getType()),
-        overlay->allocateInodeNumber(),
+        InodeNumber{nextNumber++},
         treeEntry.getHash());
   }
   return dir;
@@ -935,6 +1149,7 @@ FileInodePtr TreeInode::createImpl(
     auto insertion = contents->entries.emplace(name, mode, childNumber);
     CHECK(insertion.second)
         << "we already confirmed that this entry did not exist above";
+    bumpContentsVersion();
     auto& entry = insertion.first->second;
 
     inode = FileInodePtr::makeNew(
@@ -1058,6 +1273,7 @@ TreeInodePtr TreeInode::mkdir(PathComponentPiece name, mode_t mode) {
     auto emplaceResult = contents->entries.emplace(name, mode, childNumber);
     CHECK(emplaceResult.second)
         << "directory contents should not have changed since the check above";
+    bumpContentsVersion();
     auto& entry = emplaceResult.first->second;
 
     // Update timeStamps of newly created directory and current directory.
@@ -1256,6 +1472,7 @@ int TreeInode::tryRemoveChild(
 
     // Remove it from our entries list
     contents->entries.erase(entIter);
+    bumpContentsVersion();
 
     // We want to update mtime and ctime of parent directory after removing the
     // child.
@@ -1597,6 +1814,10 @@ Future<Unit> TreeInode::doRename(
 
   // Now remove the source information
   locks.srcContents()->erase(srcIter);
+  bumpContentsVersion();
+  if (destParent.get() != this) {
+    destParent->bumpContentsVersion();
+  }
 
   auto now = getNow();
 #ifndef _WIN32
@@ -1803,27 +2024,47 @@ DirList TreeInode::readdir(DirList&& list, off_t off) {
     }
   }
 
+  if (getMount()
+          ->getServerState()
+          ->getEdenConfig(ConfigReloadBehavior::NoReload)
+          ->fuseReaddirCache.getValue()) {
+    // Copy as many whole entries past off as fit.
+    auto cache = getReaddirCache();
+    const auto& offsets = cache->offsets;
+    const auto& positions = cache->positions;
+    auto first = static_cast<size_t>(
+        std::upper_bound(offsets.begin(), offsets.end(), off) -
+        offsets.begin());
+    auto begin = positions[first];
+    auto end = *(std::upper_bound(
+                     positions.begin() + first,
+                     positions.end(),
+                     begin + list.remaining()) -
+                 1);
+    list.addSerialized(cache->dirents.getBuf().subpiece(begin, end - begin));
+    return std::move(list);
+  }
+
   auto dir = contents_.rlock();
   auto& entries = dir->entries;
 
   // Compute an index into the PathMap by InodeNumber, only including the
-  // entries that are greater than the given offset.
-  std::vector<std::pair<InodeNumber, size_t>> indices;
+  // entries that are greater than the given offset.  The PathMap is not
+  // modified while we hold the contents lock, so its elements stay put.
+  std::vector<std::pair<InodeNumber, const DirContents::value_type*>> indices;
   indices.reserve(entries.size());
-  size_t index = 0;
   for (auto& entry : entries) {
     auto inodeNumber = entry.second.getInodeNumber();
     if (static_cast<off_t>(inodeNumber.get() + 2) > off) {
-      indices.emplace_back(entry.second.getInodeNumber(), index);
+      indices.emplace_back(entry.second.getInodeNumber(), &entry);
     }
-    ++index;
   }
   std::make_heap(indices.begin(), indices.end(), std::greater<>{});
 
   // The provided DirList has limited space. Add entries until no more fit.
   while (indices.size()) {
     std::pop_heap(indices.begin(), indices.end(), std::greater<>{});
-    auto& [name, entry] = entries.begin()[indices.back().second];
+    auto& [name, entry] = *indices.back().second;
     indices.pop_back();
 
     if (!list.add(
@@ -1837,6 +2078,174 @@ DirList TreeInode::readdir(DirList&& list, off_t off) {
 
   return std::move(list);
 }
+
+struct TreeInode::ReaddirCache {
+  ReaddirCache(uint64_t v, size_t size) : version{v}, dirents{size} {}
+
+  uint64_t version;
+
+  /**
+   * Every entry, in increasing inode number and so offset order.
+   */
+  DirList dirents;
+
+  /**
+   * offsets[i] is the readdir offset of the i'th entry.
+   */
+  std::vector<off_t> offsets;
+
+  /**
+   * positions[i] is where the i'th entry starts in dirents.  The final
+   * element is the end of the last entry.
+   */
+  std::vector<size_t> positions;
+};
+
+std::shared_ptr<const TreeInode::ReaddirCache> TreeInode::getReaddirCache() {
+  auto dir = contents_.rlock();
+  // contentsVersion_ only changes under the write lock, so it matches the
+  // entries for as long as we hold the read lock.
+  auto version = contentsVersion_.load(std::memory_order_relaxed);
+  auto cache = readdirCache_.copy();
+  if (cache && cache->version == version) {
+    return cache;
+  }
+
+  std::vector<const DirContents::value_type*> sorted;
+  sorted.reserve(dir->entries.size());
+  size_t size = 0;
+  for (const auto& entry : dir->entries) {
+    sorted.push_back(&entry);
+    size += DirList::entrySize(entry.first.stringPiece());
+  }
+  std::sort(sorted.begin(), sorted.end(), [](auto* a, auto* b) {
+    return a->second.getInodeNumber() < b->second.getInodeNumber();
+  });
+
+  auto newCache = std::make_shared<ReaddirCache>(version, size);
+  newCache->offsets.reserve(sorted.size());
+  newCache->positions.reserve(sorted.size() + 1);
+  for (const auto* entry : sorted) {
+    auto inodeNumber = entry->second.getInodeNumber().get();
+    newCache->offsets.push_back(inodeNumber + 2);
+    newCache->positions.push_back(newCache->dirents.getBuf().size());
+    newCache->dirents.add(
+        entry->first.stringPiece(),
+        inodeNumber,
+        entry->second.getDtype(),
+        inodeNumber + 2);
+  }
+  newCache->positions.push_back(size);
+
+  // Publish while still holding the read lock, so that a cache built from
+  // older entries can never replace a newer one.
+  cache = std::move(newCache);
+  *readdirCache_.wlock() = cache;
+  return cache;
+}
+
+#ifdef __linux__
+DirListPlus TreeInode::readdirplus(DirListPlus&& list, off_t off) {
+  // Offsets and ordering follow readdir() exactly; see the comment there.
+  if (off < 0) {
+    XLOG(ERR) << "Negative readdir offsets are illegal, off = " << off;
+    folly::throwSystemErrorExplicit(EINVAL);
+  }
+  updateAtime();
+  prefetch();
+
+  // The kernel never instantiates dentries for . and .., so they are always
+  // sent without attributes.
+  if (off <= 0) {
+    if (!list.add(".", getNodeId().get(), dtype_t::Dir, 1)) {
+      return std::move(list);
+    }
+  }
+  if (off <= 1) {
+    auto parent = getParentRacy();
+    auto parentNodeId = parent ? parent->getNodeId() : getNodeId();
+    if (!list.add("..", parentNodeId.get(), dtype_t::Dir, 2)) {
+      return std::move(list);
+    }
+  }
+
+  struct Candidate {
+    PathComponent name;
+    InodeNumber inodeNumber;
+    dtype_t type;
+    InodePtr inode;
+  };
+  std::vector<Candidate> candidates;
+
+  {
+    auto dir = contents_.rlock();
+    auto& entries = dir->entries;
+
+    std::vector<std::pair<InodeNumber, const DirContents::value_type*>>
+        indices;
+    indices.reserve(entries.size());
+    for (auto& entry : entries) {
+      auto inodeNumber = entry.second.getInodeNumber();
+      if (static_cast<off_t>(inodeNumber.get() + 2) > off) {
+        indices.emplace_back(inodeNumber, &entry);
+      }
+    }
+    std::make_heap(indices.begin(), indices.end(), std::greater<>{});
+
+    // Collect as many entries as will fit, remembering the children that are
+    // already loaded.  Their attributes are gathered after releasing our
+    // contents lock so that computing them never blocks other directory
+    // operations.
+    auto available = list.remaining();
+    while (indices.size()) {
+      std::pop_heap(indices.begin(), indices.end(), std::greater<>{});
+      auto& [name, entry] = *indices.back().second;
+      indices.pop_back();
+
+      auto size = DirListPlus::entrySize(name.stringPiece());
+      if (size > available) {
+        break;
+      }
+      available -= size;
+      candidates.push_back(Candidate{
+          name, entry.getInodeNumber(), entry.getDtype(), entry.getInodePtr()});
+    }
+  }
+
+  for (auto& candidate : candidates) {
+    const auto offset = candidate.inodeNumber.get() + 2;
+    // Only prefill attributes for children that can be stat'ed without
+    // blocking: loaded inodes whose stat() is immediately available, e.g.
+    // directories, materialized files, and files whose BlobMetadata has
+    // already been fetched.  Everything else is sent without attributes and
+    // the kernel falls back to FUSE_LOOKUP when needed.
+    if (candidate.inode) {
+      auto statFuture = candidate.inode->stat();
+      if (statFuture.isReady() && statFuture.hasValue()) {
+        auto entry = Dispatcher::Attr{statFuture.value()}.asFuseEntry();
+        if (!list.add(
+                candidate.name.stringPiece(), entry, candidate.type, offset)) {
+          break;
+        }
+        // The kernel takes a lookup reference on every entry it receives
+        // with a nonzero nodeid.
+        candidate.inode->incFuseRefcount();
+        continue;
+      }
+    }
+
+    if (!list.add(
+            candidate.name.stringPiece(),
+            candidate.inodeNumber.get(),
+            candidate.type,
+            offset)) {
+      break;
+    }
+  }
+
+  return std::move(list);
+}
+#endif
 #else
 
 DirList TreeInode::readdir() {
@@ -1852,13 +2261,15 @@ DirList TreeInode::readdir() {
   return list;
 }
 
-void TreeInode::readdir(std::vector<FileMetadata>& list) {
+std::optional<Hash> TreeInode::readdir(std::vector<FileMetadata>& list) {
   // We expect an empty list, verify that.
   CHECK(list.empty());
   vector<Future<std::pair<uint32_t, uint64_t>>> futures;
+  std::optional<Hash> treeHash;
   {
     uint32_t index = 0;
     auto dir = contents_.rlock();
+    treeHash = dir->treeHash;
     auto& entries = dir->entries;
 
     for (auto& entry : entries) {
@@ -1893,6 +2304,7 @@ void TreeInode::readdir(std::vector<FileMetadata>& list) {
     // Populate the size in the list for the non-materialized files.
     list[result->first].size = result->second;
   }
+  return treeHash;
 }
 #endif // _WIN32
 
@@ -1923,6 +2335,7 @@ Future<Unit> TreeInode::diff(
     shared_ptr<const Tree> tree,
     const GitIgnoreStack* parentIgnore,
     bool isIgnored) {
+  TraceBlock block{"TreeInode::diff"};
   if (context->isCancelled()) {
     XLOG(DBG7) << "diff() on directory " << getLogPath()
                << " cancelled due to client request no longer being active";
@@ -1931,6 +2344,7 @@ Future<Unit> TreeInode::diff(
 
   InodePtr inode;
   auto gitignoreInodeFuture = Future<InodePtr>::makeEmpty();
+  std::optional<Hash> gitignoreBlobHash;
   vector<IncompleteInodeLoad> pendingLoads;
   {
     // We have to get a write lock since we may have to load
@@ -1999,17 +2413,57 @@ Future<Unit> TreeInode::diff(
     }
 
     XLOG(DBG7) << "Loading ignore file for " << getLogPath();
-    inode = gitignoreEntry->getInodePtr();
-    if (!inode) {
-      gitignoreInodeFuture = loadChildLocked(
-          contents->entries,
-          kIgnoreFilename,
-          *gitignoreEntry,
-          pendingLoads,
-          context->getFetchContext());
+    if (!gitignoreEntry->isMaterialized() &&
+        gitignoreEntry->getDtype() == dtype_t::Regular) {
+      // An unmodified ignore file can be read by hash without loading its
+      // inode, and the rules parsed from it by an earlier diff may be cached.
+      gitignoreBlobHash = gitignoreEntry->getHash();
+      if (auto cached = context->getCachedGitIgnore(*gitignoreBlobHash)) {
+        return computeDiff(
+            std::move(contents),
+            context,
+            currentPath,
+            std::move(tree),
+            make_unique<GitIgnoreStack>(parentIgnore, std::move(cached)),
+            isIgnored);
+      }
+    } else {
+      inode = gitignoreEntry->getInodePtr();
+      if (!inode) {
+        gitignoreInodeFuture = loadChildLocked(
+            contents->entries,
+            kIgnoreFilename,
+            *gitignoreEntry,
+            pendingLoads,
+            context->getFetchContext());
+      }
     }
   }
 
+  if (gitignoreBlobHash) {
+    return context->loadGitIgnore(*gitignoreBlobHash)
+        .thenError([](const folly::exception_wrapper& ex) {
+          XLOG(WARN) << "error reading ignore file: "
+                     << folly::exceptionStr(ex);
+          return std::shared_ptr<const GitIgnore>{};
+        })
+        .thenValue([self = inodePtrFromThis(),
+                    context,
+                    currentPath = RelativePath{currentPath},
+                    tree = std::move(tree),
+                    parentIgnore,
+                    isIgnored](
+                       std::shared_ptr<const GitIgnore> ignore) mutable {
+          return self->computeDiff(
+              self->contents_.wlock(),
+              context,
+              currentPath,
+              std::move(tree),
+              make_unique<GitIgnoreStack>(parentIgnore, std::move(ignore)),
+              isIgnored);
+        });
+  }
+
   // Finish setting up any load operations we started while holding the
   // contents_ lock above.
   for (auto& load : pendingLoads) {
@@ -2059,7 +2513,7 @@ Future<Unit> TreeInode::loadGitIgnoreThenDiff(
       .thenValue([self = inodePtrFromThis(),
                   context,
                   currentPath = RelativePath{currentPath}, // deep copy
-                  tree,
+                  tree = std::move(tree),
                   parentIgnore,
                   isIgnored](std::string&& ignoreFileContents) mutable {
         return self->computeDiff(
@@ -2385,10 +2839,13 @@ Future<Unit> TreeInode::computeDiff(
     load.finish();
   }
 
-  // Now process all of the deferred work.
+  // Now process all of the deferred work.  Independent subtrees may be
+  // diffed in parallel; the entries stay alive in deferredEntries until every
+  // future below completes.
   vector<Future<Unit>> deferredFutures;
   for (auto& entry : deferredEntries) {
-    deferredFutures.push_back(entry->run());
+    deferredFutures.push_back(context->runSubtreeDiff(
+        [entry = entry.get()] { return entry->run(); }));
   }
 
   // Wait on all of the deferred entries to complete.
@@ -2430,6 +2887,7 @@ Future<Unit> TreeInode::checkout(
   XLOG(DBG4) << "checkout: starting update of " << getLogPath() << ": "
              << (fromTree ? fromTree->getHash().toString() : "<none>")
              << " --> " << (toTree ? toTree->getHash().toString() : "<none>");
+  ctx->treeStarted();
 
   vector<unique_ptr<CheckoutAction>> actions;
   vector<IncompleteInodeLoad> pendingLoads;
@@ -2486,6 +2944,7 @@ Future<Unit> TreeInode::checkout(
             // Update our state in the overlay
             self->saveOverlayPostCheckout(ctx, toTree.get());
 
+            ctx->treeFinished();
             XLOG(DBG4) << "checkout: finished update of " << self->getLogPath()
                        << ": " << numErrors << " errors";
           });
@@ -2674,6 +3133,7 @@ unique_ptr<CheckoutAction> TreeInode::processCheckoutEntry(
             modeFromTreeEntryType(newScmEntry->getType()),
             getOverlay()->allocateInodeNumber(),
             newScmEntry->getHash());
+        bumpContentsVersion();
         contentsUpdated = true;
       }
     } else if (!newScmEntry) {
@@ -2695,6 +3155,7 @@ unique_ptr<CheckoutAction> TreeInode::processCheckoutEntry(
             modeFromTreeEntryType(newScmEntry->getType()),
             getOverlay()->allocateInodeNumber(),
             newScmEntry->getHash());
+        bumpContentsVersion();
         contentsUpdated = true;
       }
     }
@@ -2803,6 +3264,7 @@ unique_ptr<CheckoutAction> TreeInode::processCheckoutEntry(
                      getOverlay()->allocateInodeNumber(),
                      newScmEntry->getHash()};
   }
+  bumpContentsVersion();
 
   wasDirectoryListModified = true;
 
@@ -2830,7 +3292,7 @@ unique_ptr<CheckoutAction> TreeInode::processCheckoutEntry(
     fuseChannel->invalidateEntry(getNodeId(), name);
   }
 #else
-  cleanupPrjfsCache(name);
+  cleanupPrjfsCache(ctx, name, newScmEntry);
 #endif // !_WIN32
 
   return nullptr;
@@ -2843,8 +3305,7 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
     std::shared_ptr<const Tree> oldTree,
     std::shared_ptr<const Tree> newTree,
     const std::optional<TreeEntry>& newScmEntry) {
-  auto treeInode = inode.asTreePtrOrNull();
-  if (!treeInode) {
+  if (!inode.asTreeOrNull()) {
     // If the target of the update is not a directory, then we know we do not
     // need to recurse into it, looking for more conflicts, so we can exit here.
     if (ctx->isDryRun()) {
@@ -2881,13 +3342,16 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
       } else {
         contents->entries.erase(it);
       }
+      bumpContentsVersion();
     }
+    ctx->entryUpdated();
 
     // Tell FUSE to invalidate its cache for this entry.
 #ifndef _WIN32
     invalidateFuseEntryCache(name);
 #else
-    cleanupPrjfsCache(name);
+    cleanupPrjfsCache(
+        ctx, name, newScmEntry.has_value() ? &newScmEntry.value() : nullptr);
 #endif
     // We don't save our own overlay data right now:
     // we'll wait to do that until the checkout operation finishes touching all
@@ -2895,6 +3359,9 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
     return InvalidationRequired::Yes;
   }
 
+  // Take over the caller's reference rather than copying it.
+  auto treeInode = std::move(inode).asTreePtr();
+
   // If we are going from a directory to a directory, all we need to do
   // is call checkout().
   if (newTree) {
@@ -2902,7 +3369,14 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
 
     CHECK(newScmEntry.has_value());
     CHECK(newScmEntry->isTree());
-    return treeInode->checkout(ctx, std::move(oldTree), std::move(newTree))
+    return ctx
+        ->runSubtreeCheckout([ctx,
+                              treeInode = std::move(treeInode),
+                              oldTree = std::move(oldTree),
+                              newTree = std::move(newTree)]() mutable {
+          return treeInode->checkout(
+              ctx, std::move(oldTree), std::move(newTree));
+        })
         .thenValue([](folly::Unit) { return InvalidationRequired::No; });
   }
 
@@ -2911,12 +3385,16 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
   // Fortunately, calling checkout() with an empty destination tree does
   // exactly what we want.  checkout() will even remove the directory before it
   // returns if the directory is empty.
-  return treeInode->checkout(ctx, std::move(oldTree), nullptr)
+  return ctx
+      ->runSubtreeCheckout(
+          [ctx, treeInode, oldTree = std::move(oldTree)]() mutable {
+            return treeInode->checkout(ctx, std::move(oldTree), nullptr);
+          })
       .thenValue(
           [ctx,
            name = PathComponent{name},
            parentInode = inodePtrFromThis(),
-           treeInode,
+           treeInode = std::move(treeInode),
            newScmEntry](auto &&) -> folly::Future<InvalidationRequired> {
             // Make sure the treeInode was completely removed by the checkout.
             // If there were still untracked files inside of it, it won't have
@@ -2951,6 +3429,7 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
                   parentInode->getOverlay()->allocateInodeNumber(),
                   newScmEntry->getHash());
               inserted = ret.second;
+              parentInode->bumpContentsVersion();
             }
 #ifndef _WIN32
             // This code is running asynchronously during checkout, so
@@ -3027,6 +3506,22 @@ void TreeInode::cleanupPrjfsCache(PathComponentPiece name) {
     }
   }
 }
+
+void TreeInode::cleanupPrjfsCache(
+    CheckoutContext* ctx,
+    PathComponentPiece name,
+    const TreeEntry* newScmEntry) {
+  if (!ctx->batchCachedFileUpdates()) {
+    cleanupPrjfsCache(name);
+    return;
+  }
+  auto optParent = getPath();
+  if (optParent.has_value()) {
+    ctx->addCachedFileUpdate(optParent.value() + name, newScmEntry);
+  } else {
+    XLOG(ERR) << "Failed to get the Inode path to clean up the FS cache";
+  }
+}
 #endif
 
 void TreeInode::saveOverlayPostCheckout(
@@ -3390,8 +3885,65 @@ size_t TreeInode::unloadChildrenLastAccessedBefore(const timespec& cutoff) {
         return toUnload.count(child->getNodeId()) != 0;
       });
 }
+
+size_t TreeInode::unloadChildrenAccessedBeforeEpoch(uint32_t cutoffEpoch) {
+  // Unlike unloadChildrenLastAccessedBefore(), the access epoch is stored
+  // outside of the child's lock, so the predicate can look at it directly.
+  // Materialization is tracked in our own entries.
+  std::vector<TreeInodePtr> treeChildren;
+  std::unordered_set<InodeNumber> materialized;
+  {
+    auto contents = contents_.rlock();
+    for (auto& entry : contents->entries) {
+      if (!entry.second.getInode()) {
+        continue;
+      }
+      if (entry.second.isMaterialized()) {
+        materialized.insert(entry.second.getInodeNumber());
+      }
+      if (auto asTree = entry.second.asTreePtrOrNull()) {
+        treeChildren.emplace_back(std::move(asTree));
+      }
+    }
+  }
+
+  return unloadChildrenIf(
+      this,
+      getInodeMap(),
+      treeChildren,
+      [&](TreeInode& child) {
+        return child.unloadChildrenAccessedBeforeEpoch(cutoffEpoch);
+      },
+      [&](InodeBase* child) {
+        return child->getFuseRefcount() == 0 &&
+            child->getLastAccessEpoch() < cutoffEpoch &&
+            materialized.count(child->getNodeId()) == 0;
+      });
+}
 #endif
 
+void TreeInode::getCheckoutPaths(
+    RelativePathPiece path,
+    std::vector<RelativePath>& results) const {
+  vector<std::pair<RelativePath, TreeInodePtr>> childTrees;
+  {
+    auto contents = contents_.rlock();
+    for (const auto& [name, entry] : contents->entries) {
+      if (!entry.getInode() && !entry.isMaterialized()) {
+        continue;
+      }
+      results.push_back(path + name);
+      if (auto tree = entry.asTreePtrOrNull()) {
+        childTrees.emplace_back(results.back(), std::move(tree));
+      }
+    }
+  }
+  // Recurse after releasing our contents_ lock, like getDebugStatus().
+  for (const auto& [childPath, childTree] : childTrees) {
+    childTree->getCheckoutPaths(childPath, results);
+  }
+}
+
 void TreeInode::getDebugStatus(vector<TreeInodeDebugInfo>& results) const {
   TreeInodeDebugInfo info;
   info.inodeNumber = getNodeId().get();
@@ -3461,6 +4013,7 @@ void TreeInode::getDebugStatus(vector<TreeInodeDebugInfo>& results) const {
       auto blobHash = childFile->getBlobHash();
       infoEntry.materialized = !blobHash.has_value();
       infoEntry.hash = thriftHash(blobHash);
+      infoEntry.set_compact(childFile->isCompact());
       futures.push_back(
           childFile->stat().thenValue([i = info.entries.size() - 1](auto st) {
             auto fileSize = st.st_size;
@@ -3512,6 +4065,41 @@ void TreeInode::prefetch() {
   if (!prefetched_.compare_exchange_strong(expected, true)) {
     return;
   }
+
+  auto* mount = getMount();
+  auto config = mount->getServerState()->getEdenConfig(
+      ConfigReloadBehavior::NoReload);
+  if (!config->adaptiveTreePrefetch.getValue()) {
+    prefetchChildren(TreePrefetchPolicy::Decision{}, std::nullopt);
+    return;
+  }
+
+  std::string command;
+#ifndef _WIN32
+  if (RequestData::isFuseRequest()) {
+    auto pid = RequestData::get().examineReq().pid;
+    auto name =
+        mount->getServerState()->getProcessNameCache()->getCachedProcessName(
+            pid);
+    if (name) {
+      command = TreePrefetchPolicy::getCommandType(*name).str();
+    }
+  }
+#endif
+  auto parent = getParentRacy();
+  auto numEntries = contents_.rlock()->entries.size();
+  auto decision = mount->getTreePrefetchPolicy().decide(
+      getNodeId(),
+      parent ? parent->getNodeId() : InodeNumber{},
+      command,
+      numEntries,
+      folly::to<uint32_t>(config->maxTreePrefetchDepth.getValue()));
+  prefetchChildren(decision, std::move(command));
+}
+
+void TreeInode::prefetchChildren(
+    TreePrefetchPolicy::Decision decision,
+    std::optional<std::string> command) {
   auto prefetchLease = getMount()->tryStartTreePrefetch(inodePtrFromThis());
   if (!prefetchLease) {
     XLOG(DBG3) << "skipping prefetch for " << getLogPath()
@@ -3521,21 +4109,29 @@ void TreeInode::prefetch() {
   }
   XLOG(DBG4) << "starting prefetch for " << getLogPath();
 
+  // Prefetching is speculative, so it must not delay work a user is waiting
+  // on.
   folly::via(
-      getMount()->getThreadPool().get(),
-      [lease = std::move(*prefetchLease)]() mutable {
+      getMount()->getThreadPool()->getBackgroundExecutor(),
+      [lease = std::move(*prefetchLease),
+       decision,
+       command = std::move(command)]() mutable {
         // prefetch() is called by readdir, under the assumption that a series
         // of stat calls on its entries will follow. (e.g. `ls -l` or `find
         // -ls`). To optimize that common situation, load trees and blob
         // metadata in parallel here.
 
         std::vector<IncompleteInodeLoad> pendingLoads;
-        std::vector<Future<Unit>> inodeFutures;
+        std::vector<Future<PrefetchedChild>> inodeFutures;
 
         {
+          auto* inodeMap = lease.getTreeInode()->getInodeMap();
           auto contents = lease.getTreeInode()->contents_.wlock();
 
           for (auto& [name, entry] : contents->entries) {
+            if (inodeFutures.size() >= decision.fanOut) {
+              break;
+            }
             if (entry.getInode()) {
               // Already loaded
               continue;
@@ -3547,6 +4143,11 @@ void TreeInode::prefetch() {
             // including the number of directory entries or number of bytes in a
             // file. Perform those operations here by loading inodes, trees, and
             // blob sizes.
+            //
+            // Sample the FUSE refcount before loading, so that lookups racing
+            // with the load count as uses of the prefetch.
+            auto number = entry.getInodeNumber();
+            auto refcount = inodeMap->getApproximateFuseRefcount(number);
             inodeFutures.emplace_back(
                 lease.getTreeInode()
                     ->loadChildLocked(
@@ -3555,8 +4156,18 @@ void TreeInode::prefetch() {
                         entry,
                         pendingLoads,
                         ObjectFetchContext::getNullContext())
-                    .thenValue([](InodePtr inode) { return inode->stat(); })
-                    .unit());
+                    .thenValue([number,
+                                isTree = entry.isDirectory(),
+                                refcount](InodePtr inode) {
+                      return inode->stat().thenValue(
+                          [number, isTree, refcount](struct stat st) {
+                            return PrefetchedChild{
+                                number,
+                                isTree,
+                                static_cast<uint64_t>(st.st_size),
+                                refcount};
+                          });
+                    }));
           }
         }
 
@@ -3568,13 +4179,205 @@ void TreeInode::prefetch() {
         }
 
         return folly::collectAllUnsafe(inodeFutures)
-            .thenTry([lease = std::move(lease)](auto&&) {
+            .thenValue([lease = std::move(lease),
+                        decision,
+                        command = std::move(command)](
+                           std::vector<folly::Try<PrefetchedChild>> results) {
               XLOG(DBG4) << "finished prefetch for "
                          << lease.getTreeInode()->getLogPath();
+              if (!command) {
+                return;
+              }
+              std::vector<PrefetchedChild> children;
+              for (auto& result : results) {
+                if (result.hasValue()) {
+                  children.push_back(std::move(result.value()));
+                }
+              }
+              lease.getTreeInode()->finishAdaptivePrefetch(
+                  std::move(children), decision, std::move(*command));
             });
       });
 }
 
+void TreeInode::finishAdaptivePrefetch(
+    std::vector<PrefetchedChild> children,
+    TreePrefetchPolicy::Decision decision,
+    std::string command) {
+  auto* mount = getMount();
+  if (decision.depth > 1) {
+    auto childDecision = decision;
+    childDecision.depth -= 1;
+    for (const auto& child : children) {
+      if (!child.isTree) {
+        continue;
+      }
+      auto tree = getInodeMap()->lookupLoadedTree(child.number);
+      bool expected = false;
+      if (tree && tree->prefetched_.compare_exchange_strong(expected, true)) {
+        tree->prefetchChildren(childDecision, command);
+      }
+    }
+  }
+
+  // The kernel looks a child up again when it is used, so compare the FUSE
+  // refcounts once the hit window has passed.  Only the inode numbers of the
+  // children are kept, so that the prefetch does not hold them loaded.
+  auto window = mount->getServerState()
+                    ->getEdenConfig(ConfigReloadBehavior::NoReload)
+                    ->treePrefetchHitWindow.getValue();
+  folly::futures::sleep(
+      std::chrono::duration_cast<std::chrono::milliseconds>(window))
+      .via(mount->getThreadPool()->getBackgroundExecutor())
+      .thenValue([tree = inodePtrFromThis(),
+                  children = std::move(children),
+                  command = std::move(command)](auto&&) {
+        TreePrefetchPolicy::Stats outcome;
+        for (const auto& child : children) {
+          ++outcome.prefetchedChildren;
+          auto refcount =
+              tree->getInodeMap()->getApproximateFuseRefcount(child.number);
+          if (refcount > child.fuseRefcount) {
+            ++outcome.usedChildren;
+            outcome.usefulBytes += child.size;
+          } else {
+            outcome.wastedBytes += child.size;
+          }
+        }
+        XLOG(DBG4) << command << " used " << outcome.usedChildren << " of "
+                   << outcome.prefetchedChildren << " children prefetched in "
+                   << tree->getLogPath();
+        tree->getMount()->getTreePrefetchPolicy().recordOutcome(
+            tree->getNodeId(), command, outcome);
+      });
+}
+
+void TreeInode::prefetchBlobsAfter(InodeNumber child, uint64_t count) {
+  auto prefetchLease = getMount()->tryStartTreePrefetch(inodePtrFromThis());
+  if (!prefetchLease) {
+    XLOG(DBG3) << "skipping blob readahead in " << getLogPath()
+               << ": too many prefetches already in progress";
+    return;
+  }
+
+  folly::via(
+      getMount()->getThreadPool()->getBackgroundExecutor(),
+      [lease = std::move(*prefetchLease), child, count]() mutable {
+        auto* mount = lease.getTreeInode()->getMount();
+        auto* blobCache = mount->getBlobCache();
+        auto storeBudget = getKernelStoreBudget(mount);
+        std::vector<std::pair<InodeNumber, Hash>> blobs;
+        {
+          auto contents = lease.getTreeInode()->contents_.rlock();
+          const auto& entries = contents->entries;
+          auto it = std::find_if(
+              entries.begin(), entries.end(), [&](const auto& entry) {
+                return entry.second.getInodeNumber() == child;
+              });
+          if (it == entries.end()) {
+            return folly::makeFuture();
+          }
+          // Count files that are already cached too, so that reading through
+          // a cached directory does not scan ahead to its end.
+          uint64_t files = 0;
+          for (++it; it != entries.end() && files < count; ++it) {
+            const auto& entry = it->second;
+            if (entry.isDirectory() || entry.isMaterialized()) {
+              continue;
+            }
+            ++files;
+            auto hash = entry.getHash();
+            // Cached blobs are still worth pushing into the kernel's cache.
+            bool store =
+                storeBudget > 0 && entry.getDtype() == dtype_t::Regular;
+            if (store || !blobCache->contains(hash)) {
+              blobs.emplace_back(entry.getInodeNumber(), hash);
+            }
+          }
+        }
+
+        XLOG(DBG4) << "reading ahead " << blobs.size() << " blobs in "
+                   << lease.getTreeInode()->getLogPath();
+        auto storedBytes = std::make_shared<std::atomic<uint64_t>>(0);
+        std::vector<Future<Unit>> blobFutures;
+        blobFutures.reserve(blobs.size());
+        for (const auto& [ino, hash] : blobs) {
+          auto future = mount->getBlobAccess()->getBlob(
+              hash,
+              ObjectFetchContext::getNullContext(),
+              BlobCache::Interest::LikelyNeededAgain,
+              ImportPriority::kLow());
+          if (storeBudget == 0) {
+            blobFutures.push_back(std::move(future).unit());
+            continue;
+          }
+          blobFutures.push_back(std::move(future).thenValue(
+              [tree = lease.getTreeInode(),
+               ino = ino,
+               hash = hash,
+               storeBudget,
+               storedBytes](BlobCache::GetResult result) {
+                tree->storeInKernelCache(
+                    ino, hash, *result.blob, storeBudget, *storedBytes);
+              }));
+        }
+        return folly::collectAllUnsafe(blobFutures)
+            .thenTry([lease = std::move(lease)](auto&&) {});
+      });
+}
+
+uint64_t TreeInode::getKernelStoreBudget(EdenMount* mount) {
+#ifndef _WIN32
+  if (mount->getFuseChannel()) {
+    return mount->getServerState()
+        ->getEdenConfig(ConfigReloadBehavior::NoReload)
+        ->fuseNotifyStoreBudget.getValue();
+  }
+#endif
+  return 0;
+}
+
+void TreeInode::storeInKernelCache(
+    InodeNumber ino,
+    const Hash& hash,
+    const Blob& blob,
+    uint64_t budget,
+    std::atomic<uint64_t>& storedBytes) {
+#ifndef _WIN32
+  auto size = blob.getSize();
+  auto maxFileSize = getMount()
+                         ->getServerState()
+                         ->getEdenConfig(ConfigReloadBehavior::NoReload)
+                         ->fuseNotifyStoreMaxFileSize.getValue();
+  if (size == 0 || size > maxFileSize ||
+      storedBytes.fetch_add(size, std::memory_order_relaxed) + size > budget) {
+    return;
+  }
+
+  // Check under the lock that the file still has these contents.
+  // childMaterialized() takes the lock exclusively before it invalidates the
+  // file's cached data, so data queued here can never outlive a write.
+  auto contents = contents_.rlock();
+  auto it = std::find_if(
+      contents->entries.begin(),
+      contents->entries.end(),
+      [&](const auto& entry) { return entry.second.getInodeNumber() == ino; });
+  if (it == contents->entries.end() || it->second.isMaterialized() ||
+      it->second.getHash() != hash) {
+    return;
+  }
+  if (auto* fuseChannel = getMount()->getFuseChannel()) {
+    fuseChannel->storeInodeData(ino, 0, blob.getContents().clone());
+  }
+#else
+  (void)ino;
+  (void)hash;
+  (void)blob;
+  (void)budget;
+  (void)storedBytes;
+#endif
+}
+
 folly::Future<Dispatcher::Attr> TreeInode::setattr(
     const fuse_setattr_in& attr) {
   materialize();
@@ -9,9 +9,11 @@
 #include <folly/File.h>
 #include <folly/Portability.h>
 #include <folly/Synchronized.h>
+#include <atomic>
 #include <optional>
 #include "eden/fs/inodes/DirEntry.h"
 #include "eden/fs/inodes/InodeBase.h"
+#include "eden/fs/inodes/TreePrefetchPolicy.h"
 
 #ifdef _WIN32
 #include "eden/fs/win/store/WinStore.h" // @manual
@@ -20,10 +22,12 @@
 namespace facebook {
 namespace eden {
 
+class Blob;
 class CheckoutAction;
 class CheckoutContext;
 class DiffContext;
 class DirList;
+class DirListPlus;
 class EdenMount;
 class GitIgnoreStack;
 class DiffCallback;
@@ -129,6 +133,34 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
   folly::Future<InodePtr> getOrLoadChild(PathComponentPiece name);
   folly::Future<TreeInodePtr> getOrLoadChildTree(PathComponentPiece name);
 
+  /**
+   * Get the inode objects for several children of this directory, loading
+   * them under a single acquisition of the contents lock.
+   *
+   * Returns a future for each name, in the same order.  If fileBlobs is
+   * non-null, the blob hashes of the named children that are files and not
+   * materialized are appended to it before any of the loads complete.
+   */
+  std::vector<folly::Future<InodePtr>> getOrLoadChildren(
+      const std::vector<PathComponentPiece>& names,
+      ObjectFetchContext& fetchContext,
+      std::vector<Hash>* fileBlobs = nullptr);
+
+  /**
+   * Get the inode object for a child of this directory if it is already
+   * loaded.
+   *
+   * Returns nullptr if the child does not exist or is not loaded, in which
+   * case getOrLoadChild() must be used instead.
+   */
+  InodePtr getLoadedChild(PathComponentPiece name);
+
+  /**
+   * Returns true if this directory has no entry with the given name.  This
+   * never loads anything, so it is cheap enough for the FUSE lookup fast path.
+   */
+  bool isChildMissing(PathComponentPiece name);
+
   /**
    * Recursively look up a child inode.
    *
@@ -146,6 +178,15 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
 
 #ifndef _WIN32
   DirList readdir(DirList&& list, off_t off);
+
+#ifdef __linux__
+  /**
+   * Like readdir(), but also fills in attributes for children that are cheap
+   * to stat.  The FUSE reference count of every child returned with
+   * attributes is incremented.
+   */
+  DirListPlus readdirplus(DirListPlus&& list, off_t off);
+#endif
 #else
   /**
    * The following readdir() is similar to the one in the POSIX code and is
@@ -163,8 +204,11 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    * size of materialized files.
    *
    * The list argument is expected to be an empty list.
+   *
+   * Returns the hash of the source control Tree the listed entries came from,
+   * or std::nullopt if the directory was materialized when it was read.
    */
-  void readdir(std::vector<FileMetadata>& list);
+  std::optional<Hash> readdir(std::vector<FileMetadata>& list);
 #endif
 
   const folly::Synchronized<TreeInodeState>& getContents() const {
@@ -174,6 +218,13 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
     return contents_;
   }
 
+  /**
+   * Like getPath(), but remembers the result until the next rename or unlink
+   * in this mount, so that looking up the paths of this directory's children
+   * does not walk up the whole tree each time.
+   */
+  std::optional<RelativePath> getCachedPath() const;
+
   FileInodePtr symlink(PathComponentPiece name, folly::StringPiece contents);
 
   TreeInodePtr mkdir(PathComponentPiece name, mode_t mode);
@@ -342,6 +393,15 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    * Returns the number of inodes unloaded.
    */
   size_t unloadChildrenLastAccessedBefore(const timespec& cutoff);
+
+  /**
+   * Unload all inodes under this tree that are referenced neither by Eden nor
+   * by FUSE, are not materialized, and were last accessed before the given
+   * access epoch (see InodeBase::markAccessed()).
+   *
+   * Returns the number of inodes unloaded.
+   */
+  size_t unloadChildrenAccessedBeforeEpoch(uint32_t cutoffEpoch);
 #endif
 
   /*
@@ -387,6 +447,17 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    */
   void getDebugStatus(std::vector<TreeInodeDebugInfo>& results) const;
 
+  /**
+   * Appends the paths of the entries below this directory that checkout
+   * cannot update by replacing their hash: loaded inodes and materialized
+   * entries.  Loaded subdirectories are searched recursively.
+   *
+   * path is the path of this directory.
+   */
+  void getCheckoutPaths(
+      RelativePathPiece path,
+      std::vector<RelativePath>& results) const;
+
   /**
    * Returns a copy of this inode's metadata.
    */
@@ -394,10 +465,37 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
   InodeMetadata getMetadata() const override;
 #endif
 
+  /**
+   * Starts loading the blobs of up to count files that follow the given
+   * child in name order into the BlobCache, in the background.  Called when
+   * the child has been read sequentially, as the files after it are likely
+   * to be read next.
+   */
+  void prefetchBlobsAfter(InodeNumber child, uint64_t count);
+
  private:
   class TreeRenameLocks;
   class IncompleteInodeLoad;
 
+  /**
+   * Returns how many bytes of read-ahead file contents each
+   * prefetchBlobsAfter() batch may push into the kernel's page cache, or 0 if
+   * none should be.
+   */
+  static uint64_t getKernelStoreBudget(EdenMount* mount);
+
+  /**
+   * Pushes a read-ahead blob into the kernel's page cache as the contents of
+   * the child with the given inode number, if the child still has those
+   * contents and storedBytes stays within budget.
+   */
+  void storeInKernelCache(
+      InodeNumber ino,
+      const Hash& hash,
+      const Blob& blob,
+      uint64_t budget,
+      std::atomic<uint64_t>& storedBytes);
+
 #ifndef _WIN32
   InodeMetadata getMetadataLocked(const DirContents&) const;
 #endif
@@ -482,6 +580,52 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
 
   void prefetch();
 
+  /**
+   * A child loaded by a prefetch, with its size and its FUSE refcount from
+   * before the prefetch loaded it.
+   */
+  struct PrefetchedChild {
+    InodeNumber number;
+    bool isTree;
+    uint64_t size;
+    uint32_t fuseRefcount;
+  };
+
+  /**
+   * Loads up to decision.fanOut unloaded children in the background.  If
+   * command is set, the prefetch is adaptive: it continues into the loaded
+   * subdirectories if decision.depth is more than 1, and its hit rate is
+   * recorded in the mount's TreePrefetchPolicy.
+   */
+  void prefetchChildren(
+      TreePrefetchPolicy::Decision decision,
+      std::optional<std::string> command);
+
+  /**
+   * Prefetches the subdirectories of an adaptive prefetch, and records how
+   * many of its children were looked up within store:tree-prefetch-hit-window.
+   */
+  void finishAdaptivePrefetch(
+      std::vector<PrefetchedChild> children,
+      TreePrefetchPolicy::Decision decision,
+      std::string command);
+
+  /**
+   * Must be called, while holding the contents_ write lock, after adding,
+   * removing or replacing any entry.
+   */
+  void bumpContentsVersion() {
+    contentsVersion_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+#ifndef _WIN32
+  /**
+   * Returns the serialized entries for the current contentsVersion_,
+   * rebuilding them if the directory changed since they were cached.
+   */
+  std::shared_ptr<const ReaddirCache> getReaddirCache();
+#endif
+
   /**
    * Get a TreeInodePtr to ourself.
    *
@@ -694,6 +838,16 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    * file or folder from the cache.
    */
   void cleanupPrjfsCache(PathComponentPiece name);
+
+  /**
+   * Same as above, for an entry that a checkout replaced with newScmEntry or
+   * removed if newScmEntry is null.  If the checkout batches cache updates,
+   * the update is recorded in ctx instead of being applied right away.
+   */
+  void cleanupPrjfsCache(
+      CheckoutContext* ctx,
+      PathComponentPiece name,
+      const TreeEntry* newScmEntry);
 #endif
 
   /**
@@ -708,9 +862,38 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
   folly::Synchronized<TreeInodeState> contents_;
 
   /**
-   * Only prefetch blob metadata on the first readdir() of a loaded inode.
+   * Only prefetch blob metadata on the first readdir() of a loaded inode, or
+   * when an adaptive prefetch of the parent reaches this directory.
    */
   std::atomic<bool> prefetched_{false};
+
+  /**
+   * Incremented by every change to the names, types or inode numbers of the
+   * entries in contents_, so that cached readdir results can tell whether
+   * they are still current.  Only modified while contents_ is write-locked.
+   */
+  std::atomic<uint64_t> contentsVersion_{0};
+
+#ifndef _WIN32
+  /**
+   * The serialized FUSE_READDIR entries of this directory, when
+   * fuse:readdir-cache is enabled.
+   */
+  struct ReaddirCache;
+  folly::Synchronized<std::shared_ptr<const ReaddirCache>> readdirCache_;
+#endif
+
+  struct CachedPath {
+    /**
+     * The EdenMount::getPathGeneration() value that path was computed at.
+     */
+    uint64_t generation{0};
+    /**
+     * std::nullopt if this directory was unlinked.
+     */
+    std::optional<RelativePath> path;
+  };
+  mutable folly::Synchronized<CachedPath> cachedPath_;
 };
 
 /**
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/TreePrefetchPolicy.h"
+
+#include <algorithm>
+#include <cmath>
+
+using folly::StringPiece;
+
+namespace facebook {
+namespace eden {
+
+namespace {
+/**
+ * Hit rates based on fewer prefetched children than this are not trusted.
+ */
+constexpr double kMinSamples = 8;
+
+/**
+ * Once this many children are counted, the counts are halved, so that the
+ * hit rate follows changes in how a directory or command is used.
+ */
+constexpr double kMaxSamples = 512;
+
+/**
+ * At or above this hit rate prefetches go as deep as allowed.
+ */
+constexpr double kDeepHitRate = 0.75;
+
+/**
+ * Below this hit rate prefetches only load a few children.  They are not
+ * turned off entirely, so that the hit rate can recover if the directory or
+ * command starts using them.
+ */
+constexpr double kLowHitRate = 0.1;
+constexpr size_t kProbeFanOut = 4;
+
+/**
+ * Bounds on the number of remembered hit rates.  When a map is full it is
+ * cleared, which only costs the history.
+ */
+constexpr size_t kMaxDirectories = 65536;
+constexpr size_t kMaxCommands = 1024;
+} // namespace
+
+void TreePrefetchPolicy::HitRate::add(const Stats& outcome) {
+  prefetched += outcome.prefetchedChildren;
+  used += outcome.usedChildren;
+  if (prefetched > kMaxSamples) {
+    prefetched /= 2;
+    used /= 2;
+  }
+}
+
+std::optional<double> TreePrefetchPolicy::HitRate::get() const {
+  if (prefetched < kMinSamples) {
+    return std::nullopt;
+  }
+  return used / prefetched;
+}
+
+TreePrefetchPolicy::Decision TreePrefetchPolicy::decide(
+    InodeNumber directory,
+    InodeNumber parent,
+    StringPiece command,
+    size_t numEntries,
+    uint32_t maxDepth) const {
+  std::optional<double> directoryRate;
+  std::optional<double> commandRate;
+  {
+    auto state = state_.rlock();
+    auto it = state->directories.find(directory);
+    if (it != state->directories.end()) {
+      directoryRate = it->second.get();
+    }
+    if (!directoryRate) {
+      it = state->directories.find(parent);
+      if (it != state->directories.end()) {
+        directoryRate = it->second.get();
+      }
+    }
+    auto commandIt = state->commands.find(command.str());
+    if (commandIt != state->commands.end()) {
+      commandRate = commandIt->second.get();
+    }
+  }
+
+  Decision decision;
+  if (!directoryRate && !commandRate) {
+    return decision;
+  }
+  double rate = directoryRate && commandRate
+      ? (*directoryRate + *commandRate) / 2
+      : directoryRate.value_or(commandRate.value_or(0));
+
+  if (rate >= kDeepHitRate) {
+    decision.depth = std::max<uint32_t>(maxDepth, 1);
+  } else if (rate < kLowHitRate) {
+    decision.fanOut = kProbeFanOut;
+  } else {
+    decision.fanOut = std::max(
+        kProbeFanOut,
+        static_cast<size_t>(std::ceil(numEntries * rate / kDeepHitRate)));
+  }
+  return decision;
+}
+
+void TreePrefetchPolicy::recordOutcome(
+    InodeNumber directory,
+    StringPiece command,
+    const Stats& outcome) {
+  auto state = state_.wlock();
+  if (state->directories.size() >= kMaxDirectories &&
+      state->directories.count(directory) == 0) {
+    state->directories.clear();
+  }
+  state->directories[directory].add(outcome);
+
+  auto commandKey = command.str();
+  if (state->commands.size() >= kMaxCommands &&
+      state->commands.count(commandKey) == 0) {
+    state->commands.clear();
+  }
+  state->commands[std::move(commandKey)].add(outcome);
+
+  state->totals.prefetchedChildren += outcome.prefetchedChildren;
+  state->totals.usedChildren += outcome.usedChildren;
+  state->totals.usefulBytes += outcome.usefulBytes;
+  state->totals.wastedBytes += outcome.wastedBytes;
+}
+
+TreePrefetchPolicy::Stats TreePrefetchPolicy::getStats() const {
+  return state_.rlock()->totals;
+}
+
+StringPiece TreePrefetchPolicy::getCommandType(StringPiece processName) {
+  auto end = std::find_if(processName.begin(), processName.end(), [](char c) {
+    return c == ' ' || c == '\0';
+  });
+  StringPiece executable{processName.begin(), end};
+  auto slash = executable.rfind('/');
+  if (slash != StringPiece::npos) {
+    executable.advance(slash + 1);
+  }
+  return executable;
+}
+
+} // namespace eden
+} // namespace facebook
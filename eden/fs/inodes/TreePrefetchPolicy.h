@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include "eden/fs/fuse/InodeNumber.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Decides how much a readdir() prefetch loads, based on how many of the
+ * children that earlier prefetches loaded were looked up soon afterwards.
+ *
+ * Hit rates are kept for each directory and for each command, identified by
+ * the base name of its executable.  Directories that were never prefetched
+ * use the hit rate of their parent, so a subtree that is crawled once is
+ * crawled the same way deeper down.  With no history at all, a prefetch loads
+ * every child of the directory, as it always did.
+ *
+ * It is safe to use this object from arbitrary threads.
+ */
+class TreePrefetchPolicy {
+ public:
+  struct Decision {
+    /**
+     * How many levels of directories to load: 1 loads the children of the
+     * directory, 2 also loads the children of its subdirectories, and so on.
+     */
+    uint32_t depth{1};
+
+    /**
+     * The most children of each directory to load.
+     */
+    size_t fanOut{std::numeric_limits<size_t>::max()};
+  };
+
+  /**
+   * What prefetches loaded, and how much of it was looked up in time.
+   */
+  struct Stats {
+    uint64_t prefetchedChildren{0};
+    uint64_t usedChildren{0};
+    uint64_t usefulBytes{0};
+    uint64_t wastedBytes{0};
+  };
+
+  /**
+   * Decides how to prefetch the children of a directory with numEntries
+   * entries, for a readdir() by the given command.  The depth is at most
+   * maxDepth.
+   */
+  Decision decide(
+      InodeNumber directory,
+      InodeNumber parent,
+      folly::StringPiece command,
+      size_t numEntries,
+      uint32_t maxDepth) const;
+
+  /**
+   * Records how much of a prefetch of the directory's children, started for
+   * the given command, was used.
+   */
+  void recordOutcome(
+      InodeNumber directory,
+      folly::StringPiece command,
+      const Stats& outcome);
+
+  /**
+   * Returns the totals of every recorded outcome.
+   */
+  Stats getStats() const;
+
+  /**
+   * Returns the part of a process name that identifies the kind of command:
+   * the base name of its executable.
+   */
+  static folly::StringPiece getCommandType(folly::StringPiece processName);
+
+ private:
+  /**
+   * Decayed counts of prefetched and used children, so that recent
+   * prefetches weigh more than old ones.
+   */
+  struct HitRate {
+    double prefetched{0};
+    double used{0};
+
+    void add(const Stats& outcome);
+    std::optional<double> get() const;
+  };
+
+  struct State {
+    std::unordered_map<InodeNumber, HitRate> directories;
+    std::unordered_map<std::string, HitRate> commands;
+    Stats totals;
+  };
+
+  folly::Synchronized<State> state_;
+};
+
+} // namespace eden
+} // namespace facebook
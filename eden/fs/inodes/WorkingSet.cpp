@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/WorkingSet.h"
+
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/logging/xlog.h>
+#include <deque>
+#include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/utils/FileUtils.h"
+
+namespace facebook {
+namespace eden {
+
+WorkingSet::WorkingSet(AbsolutePath path) : path_{std::move(path)} {}
+
+std::vector<RelativePath> WorkingSet::collectLoadedPaths(
+    const TreeInodePtr& root,
+    size_t maxPaths) {
+  std::vector<RelativePath> paths;
+  // Walk breadth first, so that the directories closest to the root are
+  // kept if there are more than maxPaths loaded inodes.
+  std::deque<std::pair<TreeInodePtr, RelativePath>> pending;
+  pending.emplace_back(root, RelativePath{});
+  while (!pending.empty() && paths.size() < maxPaths) {
+    auto [tree, treePath] = std::move(pending.front());
+    pending.pop_front();
+
+    auto contents = tree->getContents().rlock();
+    for (const auto& [name, entry] : contents->entries) {
+      if (!entry.getInode()) {
+        continue;
+      }
+      auto childPath = treePath + name;
+      if (entry.isDirectory()) {
+        // Materialized directories may still hold unmaterialized children.
+        if (auto child = entry.getInodePtr().asTreePtrOrNull()) {
+          pending.emplace_back(std::move(child), childPath);
+        }
+      }
+      if (!entry.isMaterialized()) {
+        paths.push_back(std::move(childPath));
+        if (paths.size() >= maxPaths) {
+          break;
+        }
+      }
+    }
+  }
+  return paths;
+}
+
+void WorkingSet::save(const std::vector<RelativePath>& paths) const {
+  std::string contents;
+  for (const auto& path : paths) {
+    contents.append(path.value());
+    contents.push_back('\n');
+  }
+
+  try {
+    auto data = folly::ByteRange{folly::StringPiece{contents}};
+#ifdef _WIN32
+    writeFileAtomic(path_.c_str(), data);
+#else
+    folly::writeFileAtomic(path_.stringPiece(), data);
+#endif
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "unable to write working set " << path_ << ": "
+               << folly::exceptionStr(ex);
+  }
+}
+
+std::vector<RelativePath> WorkingSet::load() const {
+  std::vector<RelativePath> paths;
+  std::string contents;
+  try {
+#ifdef _WIN32
+    readFile(path_.c_str(), contents);
+#else
+    if (!folly::readFile(path_.c_str(), contents)) {
+      // Nothing was saved when the mount was last shut down.
+      return paths;
+    }
+#endif
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "unable to read working set " << path_ << ": "
+               << folly::exceptionStr(ex);
+    return paths;
+  }
+
+  std::vector<folly::StringPiece> lines;
+  folly::split('\n', contents, lines);
+  for (auto line : lines) {
+    if (line.empty()) {
+      continue;
+    }
+    try {
+      paths.emplace_back(line);
+    } catch (const std::exception&) {
+      XLOG(DBG3) << "ignoring invalid path in working set: " << line;
+    }
+  }
+  return paths;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <vector>
+#include "eden/fs/inodes/InodePtrFwd.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Remembers which source control files and directories a mount had loaded
+ * when it was shut down, so that the next edenfs process can prefetch them
+ * before they are needed again.
+ *
+ * Only unmaterialized inodes are remembered, since materialized ones are
+ * read from the overlay.  The working set is stored in a small text file in
+ * the mount's client directory, with one path on each line.
+ */
+class WorkingSet {
+ public:
+  explicit WorkingSet(AbsolutePath path);
+
+  /**
+   * Returns the paths of the loaded, unmaterialized inodes under root,
+   * shallowest first, stopping after maxPaths.
+   */
+  static std::vector<RelativePath> collectLoadedPaths(
+      const TreeInodePtr& root,
+      size_t maxPaths);
+
+  /**
+   * Replaces the saved working set with paths.  Errors are logged and
+   * otherwise ignored.
+   */
+  void save(const std::vector<RelativePath>& paths) const;
+
+  /**
+   * Returns the saved working set, or nothing if none could be read.
+   */
+  std::vector<RelativePath> load() const;
+
+ private:
+  const AbsolutePath path_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -10,16 +10,24 @@
 #include <boost/filesystem.hpp>
 #include <algorithm>
 #include <chrono>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
 
 #include <folly/Exception.h>
 #include <folly/File.h>
 #include <folly/FileUtil.h>
+#include <folly/ScopeGuard.h>
+#include <folly/String.h>
 #include <folly/Range.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/logging/xlog.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include "eden/fs/inodes/sqliteoverlay/SqliteOverlay.h"
+#include "eden/fs/model/Hash.h"
 #include "eden/fs/service/EdenError.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
 #include "eden/fs/utils/PathFuncs.h"
@@ -67,6 +75,9 @@ constexpr folly::StringPiece FsOverlay::kHeaderIdentifierDir;
 constexpr folly::StringPiece FsOverlay::kHeaderIdentifierFile;
 constexpr uint32_t FsOverlay::kHeaderVersion;
 constexpr size_t FsOverlay::kHeaderLength;
+constexpr folly::StringPiece FsOverlay::kHeaderSha1Identifier;
+constexpr size_t FsOverlay::kHeaderSha1Offset;
+constexpr size_t FsOverlay::kHeaderSha1Length;
 constexpr uint32_t FsOverlay::kNumShards;
 
 static void doFormatSubdirPath(
@@ -91,6 +102,11 @@ void FsOverlay::formatSubdirShardPath(
   return doFormatSubdirPath(shardID, subdirPath);
 }
 
+FsOverlay::FsOverlay(AbsolutePathPiece localDir, DirStorage newDirStorage)
+    : localDir_{localDir}, newDirStorage_{newDirStorage} {}
+
+FsOverlay::~FsOverlay() = default;
+
 std::optional<InodeNumber> FsOverlay::initOverlay(bool createIfNonExisting) {
   // Read the info file.
   auto infoPath = localDir_ + PathComponentPiece{kInfoFile};
@@ -130,6 +146,16 @@ std::optional<InodeNumber> FsOverlay::initOverlay(bool createIfNonExisting) {
       dirFd, "error opening overlay directory handle for ", localDir_.value());
   dirFile_ = File{dirFd, /* ownsFd */ true};
 
+  // Only open the directory database while holding the overlay lock, and only
+  // if this overlay was created to use it: switching an existing overlay
+  // would orphan every directory already saved as a file.
+  auto dbPath = SqliteOverlay::getDatabasePath(localDir_);
+  if ((overlayCreated && newDirStorage_ == DirStorage::Sqlite) ||
+      ::access(dbPath.c_str(), F_OK) == 0) {
+    sqliteDirs_ = std::make_unique<SqliteOverlay>(localDir_);
+    sqliteDirs_->openDatabase();
+  }
+
   if (overlayCreated) {
     return InodeNumber{kRootNodeId.get() + 1};
   }
@@ -146,6 +172,10 @@ void FsOverlay::close(std::optional<InodeNumber> inodeNumber) {
   if (inodeNumber) {
     saveNextInodeNumber(inodeNumber.value());
   }
+  if (sqliteDirs_) {
+    sqliteDirs_->close(std::nullopt);
+    sqliteDirs_.reset();
+  }
   dirFile_.close();
   infoFile_.close();
 }
@@ -287,12 +317,20 @@ void FsOverlay::initNewOverlay() {
 
 optional<overlay::OverlayDir> FsOverlay::loadOverlayDir(
     InodeNumber inodeNumber) {
+  if (sqliteDirs_) {
+    return sqliteDirs_->loadOverlayDir(inodeNumber);
+  }
   return deserializeOverlayDir(inodeNumber);
 }
 
 void FsOverlay::saveOverlayDir(
     InodeNumber inodeNumber,
     const overlay::OverlayDir& odir) {
+  if (sqliteDirs_) {
+    sqliteDirs_->saveOverlayDir(inodeNumber, odir);
+    return;
+  }
+
   // Ask thrift to serialize it.
   auto serializedData = CompactSerializer::serialize<std::string>(odir);
 
@@ -307,6 +345,19 @@ void FsOverlay::saveOverlayDir(
   (void)createOverlayFileImpl(inodeNumber, iov.data(), iov.size());
 }
 
+void FsOverlay::saveOverlayDirs(
+    const std::vector<
+        std::pair<InodeNumber, std::shared_ptr<const overlay::OverlayDir>>>&
+        dirs) {
+  if (sqliteDirs_) {
+    sqliteDirs_->saveOverlayDirs(dirs);
+    return;
+  }
+  for (const auto& [inodeNumber, dir] : dirs) {
+    saveOverlayDir(inodeNumber, *dir);
+  }
+}
+
 InodePath FsOverlay::getFilePath(InodeNumber inodeNumber) {
   InodePath outPath;
   auto& outPathArray = outPath.rawData();
@@ -451,6 +502,21 @@ folly::File FsOverlay::createOverlayFileImpl(
     InodeNumber inodeNumber,
     iovec* iov,
     size_t iovCount) {
+  return *createOverlayFileWith(inodeNumber, [&](int fd) {
+    auto sizeWritten = folly::writevFull(fd, iov, iovCount);
+    folly::checkUnixError(
+        sizeWritten,
+        "error writing to overlay file for inode ",
+        inodeNumber,
+        " in ",
+        localDir_);
+    return true;
+  });
+}
+
+std::optional<folly::File> FsOverlay::createOverlayFileWith(
+    InodeNumber inodeNumber,
+    folly::FunctionRef<bool(int fd)> writeContents) {
   // We do not use mkstemp() to create the temporary file, since there is no
   // mkstempat() equivalent that can create files relative to dirFile.  We
   // simply create the file with a fixed suffix, and do not use O_EXCL.  This
@@ -485,13 +551,9 @@ folly::File FsOverlay::createOverlayFileImpl(
     }
   };
 
-  auto sizeWritten = folly::writevFull(tmpFD, iov, iovCount);
-  folly::checkUnixError(
-      sizeWritten,
-      "error writing to overlay file for inode ",
-      inodeNumber,
-      " in ",
-      localDir_);
+  if (!writeContents(tmpFD)) {
+    return std::nullopt;
+  }
 
   // fdatasync() is required to ensure that we are really reliably and
   // atomically writing out the new file.  Without calling fdatasync() the file
@@ -568,6 +630,189 @@ folly::File FsOverlay::createOverlayFile(
   return createOverlayFileImpl(inodeNumber, iov.data(), iov.size());
 }
 
+namespace {
+constexpr auto kBlobFileDir = "blobs"_sp;
+
+std::string getBlobFilePath(const Hash& blobHash) {
+  return folly::to<std::string>(kBlobFileDir, "/", blobHash.toString());
+}
+
+std::string getBlobFileTmpPath(const Hash& blobHash, uint64_t id) {
+  return folly::to<std::string>(
+      tmpPrefix, "blob-", blobHash.toString(), "-", id);
+}
+} // namespace
+
+std::optional<folly::File> FsOverlay::cloneOverlayFileFromBlobFile(
+    InodeNumber inodeNumber,
+    const Hash& blobHash,
+    uint64_t blobSize) {
+  auto blobPath = getBlobFilePath(blobHash);
+  auto blobFD = openat(
+      dirFile_.fd(), blobPath.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+  if (blobFD < 0) {
+    if (errno != ENOENT) {
+      XLOG(WARN) << "error opening blob file " << blobPath << " in "
+                 << localDir_ << ": " << folly::errnoStr(errno);
+    }
+    return std::nullopt;
+  }
+  folly::File blobFile{blobFD, /* ownsFd */ true};
+
+  // A blob file left short by a crash must not be cloned into an overlay
+  // file, as nothing would notice the truncated contents afterwards.
+  struct stat st;
+  if (fstat(blobFile.fd(), &st) != 0) {
+    XLOG(WARN) << "error checking blob file " << blobPath << " in "
+               << localDir_ << ": " << folly::errnoStr(errno);
+    return std::nullopt;
+  }
+  if (static_cast<uint64_t>(st.st_size) != kHeaderLength + blobSize) {
+    XLOG(WARN) << "blob file " << blobPath << " in " << localDir_ << " is "
+               << st.st_size << " bytes instead of "
+               << kHeaderLength + blobSize << "; removing it";
+    unlinkat(dirFile_.fd(), blobPath.c_str(), 0);
+    return std::nullopt;
+  }
+  return createOverlayFileWith(
+      inodeNumber, [&](int fd) { return copyBlobFile(blobFile.fd(), fd); });
+}
+
+bool FsOverlay::copyBlobFile(int blobFD, int fd) {
+#ifdef __linux__
+  if (!reflinkUnsupported_.load(std::memory_order_relaxed)) {
+    if (ioctl(fd, FICLONE, blobFD) == 0) {
+      return true;
+    }
+    if (errno == EOPNOTSUPP || errno == ENOTTY || errno == EXDEV ||
+        errno == EINVAL) {
+      XLOG(DBG2) << "the filesystem holding " << localDir_
+                 << " does not support reflinks: " << folly::errnoStr(errno);
+      reflinkUnsupported_.store(true, std::memory_order_relaxed);
+    } else {
+      XLOG(WARN) << "error cloning blob file in " << localDir_ << ": "
+                 << folly::errnoStr(errno);
+      return false;
+    }
+  }
+
+  // Without reflinks this still saves fetching the blob and copying it through
+  // userspace.
+  struct stat st;
+  if (fstat(blobFD, &st) != 0) {
+    return false;
+  }
+  loff_t inOffset = 0;
+  loff_t outOffset = 0;
+  while (inOffset < st.st_size) {
+    auto copied = copy_file_range(
+        blobFD, &inOffset, fd, &outOffset, st.st_size - inOffset, 0);
+    if (copied < 0 && errno == EINTR) {
+      continue;
+    }
+    if (copied <= 0) {
+      XLOG(DBG3) << "unable to copy blob file in " << localDir_ << ": "
+                 << (copied < 0 ? folly::errnoStr(errno) : "short file");
+      return false;
+    }
+  }
+  return true;
+#else
+  (void)blobFD;
+  (void)fd;
+  return false;
+#endif
+}
+
+void FsOverlay::addBlobFile(
+    const Hash& blobHash,
+    const IOBuf& contents,
+    uint64_t maxCacheSize) {
+  // Unless the overlay files can share the blob file's extents, writing it
+  // only doubles the cost of materializing the blob.
+  if (reflinkUnsupported_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  auto blobPath = getBlobFilePath(blobHash);
+  if (faccessat(dirFile_.fd(), blobPath.c_str(), F_OK, AT_SYMLINK_NOFOLLOW) ==
+      0) {
+    return;
+  }
+
+  std::call_once(blobFileCacheScan_, [&] {
+    if (mkdirat(dirFile_.fd(), kBlobFileDir.data(), 0700) != 0 &&
+        errno != EEXIST) {
+      XLOG(WARN) << "error creating blob file directory in " << localDir_
+                 << ": " << folly::errnoStr(errno);
+    }
+    uint64_t total = 0;
+    boost::system::error_code error;
+    auto dirPath = localDir_ + PathComponentPiece{kBlobFileDir};
+    boost::filesystem::directory_iterator it{dirPath.c_str(), error};
+    for (; !error && it != boost::filesystem::directory_iterator{};
+         it.increment(error)) {
+      auto size = boost::filesystem::file_size(it->path(), error);
+      if (!error) {
+        total += size;
+      }
+    }
+    blobFileCacheBytes_.fetch_add(total, std::memory_order_relaxed);
+  });
+
+  auto size = kHeaderLength + contents.computeChainDataLength();
+  if (blobFileCacheBytes_.fetch_add(size, std::memory_order_relaxed) + size >
+      maxCacheSize) {
+    blobFileCacheBytes_.fetch_sub(size, std::memory_order_relaxed);
+    XLOG(DBG3) << "blob file cache in " << localDir_ << " is full";
+    return;
+  }
+  bool success = false;
+  SCOPE_EXIT {
+    if (!success) {
+      blobFileCacheBytes_.fetch_sub(size, std::memory_order_relaxed);
+    }
+  };
+
+  // The same blob may be added concurrently for two inodes, so each addition
+  // writes its own temporary file.  Whichever is renamed last wins.
+  auto tmpPath = getBlobFileTmpPath(
+      blobHash, nextBlobFileTmpId_.fetch_add(1, std::memory_order_relaxed));
+  auto tmpFD = openat(
+      dirFile_.fd(),
+      tmpPath.c_str(),
+      O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC | O_NOFOLLOW,
+      0600);
+  if (tmpFD < 0) {
+    XLOG(WARN) << "error creating blob file " << tmpPath << " in "
+               << localDir_ << ": " << folly::errnoStr(errno);
+    return;
+  }
+  folly::File tmpFile{tmpFD, /* ownsFd */ true};
+
+  // Blob files are stored with an overlay file header, so that materializing
+  // the blob can clone the whole file.
+  auto header = createHeader(kHeaderIdentifierFile, kHeaderVersion);
+  fbvector<struct iovec> iov;
+  iov.resize(1);
+  iov[0].iov_base = header.data();
+  iov[0].iov_len = header.size();
+  contents.appendToIov(&iov);
+  // Unlike overlay files, which are only ever read back through their inode,
+  // a blob file is trusted by every later materialization of the blob, so its
+  // contents must reach the disk before the rename does.
+  if (folly::writevFull(tmpFD, iov.data(), iov.size()) < 0 ||
+      folly::fdatasyncNoInt(tmpFD) != 0 ||
+      renameat(
+          dirFile_.fd(), tmpPath.c_str(), dirFile_.fd(), blobPath.c_str()) !=
+          0) {
+    XLOG(WARN) << "error writing blob file " << blobPath << " in "
+               << localDir_ << ": " << folly::errnoStr(errno);
+    unlinkat(dirFile_.fd(), tmpPath.c_str(), 0);
+    return;
+  }
+  success = true;
+}
+
 void FsOverlay::validateHeader(
     InodeNumber inodeNumber,
     folly::StringPiece contents,
@@ -610,15 +855,38 @@ void FsOverlay::validateHeader(
   }
 }
 
-void FsOverlay::removeOverlayFile(InodeNumber inodeNumber) {
+bool FsOverlay::removeOverlayFile(InodeNumber inodeNumber) {
   auto path = getFilePath(inodeNumber);
   int result = ::unlinkat(dirFile_.fd(), path.c_str(), 0);
   if (result == 0) {
     XLOG(DBG4) << "removed overlay data for inode " << inodeNumber;
+    return true;
   } else if (errno != ENOENT) {
     folly::throwSystemError(
         "error unlinking overlay file: ", RelativePathPiece{path});
   }
+  return false;
+}
+
+void FsOverlay::removeOverlayData(InodeNumber inodeNumber) {
+  // Directories never have an overlay file when they are stored in SQLite,
+  // so the database only needs to be consulted when there was no file.
+  if (!removeOverlayFile(inodeNumber) && sqliteDirs_) {
+    sqliteDirs_->removeOverlayData(inodeNumber);
+  }
+}
+
+void FsOverlay::removeOverlayData(
+    const std::vector<InodeNumber>& inodeNumbers) {
+  std::vector<InodeNumber> missingFiles;
+  for (auto inodeNumber : inodeNumbers) {
+    if (!removeOverlayFile(inodeNumber)) {
+      missingFiles.push_back(inodeNumber);
+    }
+  }
+  if (sqliteDirs_ && !missingFiles.empty()) {
+    sqliteDirs_->removeOverlayData(missingFiles);
+  }
 }
 
 void FsOverlay::writeNextInodeNumber(InodeNumber nextInodeNumber) {
@@ -640,11 +908,19 @@ bool FsOverlay::hasOverlayData(InodeNumber inodeNumber) {
   struct stat st;
   if (0 == fstatat(dirFile_.fd(), path.c_str(), &st, AT_SYMLINK_NOFOLLOW)) {
     return S_ISREG(st.st_mode);
+  } else if (sqliteDirs_) {
+    return sqliteDirs_->hasOverlayData(inodeNumber);
   } else {
     return false;
   }
 }
 
+void FsOverlay::compactDirStoreIfNeeded() {
+  if (sqliteDirs_) {
+    sqliteDirs_->compactIfNeeded();
+  }
+}
+
 InodePath::InodePath() noexcept : path_{'\0'} {}
 
 const char* InodePath::c_str() const noexcept {
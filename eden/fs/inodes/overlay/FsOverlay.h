@@ -8,11 +8,16 @@
 #pragma once
 
 #include <folly/File.h>
+#include <folly/Function.h>
 #include <folly/Range.h>
 #include <gtest/gtest_prod.h>
 #include <array>
+#include <atomic>
 #include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <vector>
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
 #include "eden/fs/utils/DirType.h"
@@ -30,16 +35,35 @@ namespace eden {
 namespace overlay {
 class OverlayDir;
 }
+class Hash;
 class InodePath;
+class SqliteOverlay;
 
 /**
  * FsOverlay provides interfaces to manipulate the overlay. It stores the
  * overlay's file system attributes and is responsible for obtaining and
  * releasing its locks ("initOverlay" and "close" respectively).
+ *
+ * File contents are always stored as one overlay file per inode.  Directories
+ * are either stored the same way, or in a SQLite database inside the overlay
+ * directory.  The choice is made when the overlay is created and is recorded
+ * by the presence of that database.
  */
 class FsOverlay {
  public:
-  explicit FsOverlay(AbsolutePathPiece localDir) : localDir_{localDir} {}
+  /**
+   * Where a newly created overlay stores its directories.
+   */
+  enum class DirStorage {
+    Files,
+    Sqlite,
+  };
+
+  explicit FsOverlay(
+      AbsolutePathPiece localDir,
+      DirStorage newDirStorage = DirStorage::Files);
+  ~FsOverlay();
+
   /**
    * Initialize the overlay, acquire the "info" file lock and load the
    * nextInodeNumber. The "close" method should be used to release these
@@ -106,6 +130,15 @@ class FsOverlay {
 
   void saveOverlayDir(InodeNumber inodeNumber, const overlay::OverlayDir& odir);
 
+  /**
+   * Save several directories.  When directories are stored in SQLite this
+   * uses a single transaction for the whole batch.
+   */
+  void saveOverlayDirs(
+      const std::vector<
+          std::pair<InodeNumber, std::shared_ptr<const overlay::OverlayDir>>>&
+          dirs);
+
   std::optional<overlay::OverlayDir> loadOverlayDir(InodeNumber inodeNumber);
 
   void saveNextInodeNumber(InodeNumber nextInodeNumber);
@@ -141,10 +174,52 @@ class FsOverlay {
       InodeNumber inodeNumber,
       const folly::IOBuf& contents);
 
+  /**
+   * Creates an overlay file for a FileInode whose contents are the blob with
+   * the given hash, by cloning or copying the blob's file in the blob file
+   * cache.
+   *
+   * Returns std::nullopt if the blob is not in the cache, if its file is not
+   * blobSize bytes long, or if it cannot be copied inside the kernel, in which
+   * case the caller should create the overlay file from the blob's contents
+   * instead.
+   */
+  std::optional<folly::File> cloneOverlayFileFromBlobFile(
+      InodeNumber inodeNumber,
+      const Hash& blobHash,
+      uint64_t blobSize);
+
+  /**
+   * Adds a blob to the blob file cache, so that later materializations of it
+   * can use cloneOverlayFileFromBlobFile().
+   *
+   * This does nothing once the overlay's filesystem is known not to support
+   * reflinks, or if the cache would grow past maxCacheSize bytes.  Errors are
+   * logged rather than thrown, as the cache is only an optimization.
+   */
+  void addBlobFile(
+      const Hash& blobHash,
+      const folly::IOBuf& contents,
+      uint64_t maxCacheSize);
+
   /**
    * Remove the overlay file associated with the passed InodeNumber.
+   *
+   * Returns false if there was no such file.
    */
-  void removeOverlayFile(InodeNumber inodeNumber);
+  bool removeOverlayFile(InodeNumber inodeNumber);
+
+  /**
+   * Remove all overlay data for the passed InodeNumber, wherever it is
+   * stored.
+   */
+  void removeOverlayData(InodeNumber inodeNumber);
+
+  /**
+   * Remove the overlay data for several inodes.  When directories are stored
+   * in SQLite, their removal uses a single transaction for the whole batch.
+   */
+  void removeOverlayData(const std::vector<InodeNumber>& inodeNumbers);
 
   /**
    * Validates an entry's header.
@@ -180,6 +255,23 @@ class FsOverlay {
 
   bool hasOverlayData(InodeNumber inodeNumber);
 
+  /**
+   * Return the SQLite database storing this overlay's directories, or
+   * nullptr if directories are stored as overlay files.
+   *
+   * This is primarily intended for the fsck logic, which needs to enumerate
+   * and repair directories wherever they are stored.
+   */
+  SqliteOverlay* getSqliteDirStore() const {
+    return sqliteDirs_.get();
+  }
+
+  /**
+   * Reclaim space left behind by removed directories, if directories are
+   * stored in SQLite and enough of them were removed to make it worthwhile.
+   */
+  void compactDirStoreIfNeeded();
+
   static constexpr folly::StringPiece kMetadataFile{"metadata.table"};
 
   /**
@@ -189,6 +281,17 @@ class FsOverlay {
   static constexpr folly::StringPiece kHeaderIdentifierFile{"OVFL"};
   static constexpr uint32_t kHeaderVersion = 1;
   static constexpr size_t kHeaderLength = 64;
+
+  /**
+   * Materialized file headers may cache the size and SHA-1 of the file's
+   * contents in the bytes that used to hold timestamps: the identifier, the
+   * size as a big-endian uint64_t, then the raw SHA-1.  The record is only
+   * valid if it starts with kHeaderSha1Identifier, and must be cleared before
+   * the file contents are modified.
+   */
+  static constexpr folly::StringPiece kHeaderSha1Identifier{"SHA1"};
+  static constexpr size_t kHeaderSha1Offset = 8;
+  static constexpr size_t kHeaderSha1Length = 32;
   static constexpr uint32_t kNumShards = 256;
   static constexpr size_t kShardDirPathLength = 2;
 
@@ -222,10 +325,34 @@ class FsOverlay {
   folly::File
   createOverlayFileImpl(InodeNumber inodeNumber, iovec* iov, size_t iovCount);
 
+  /**
+   * Creates the overlay file for an inode, with writeContents() filling in
+   * its header and contents.  If writeContents() returns false, the file is
+   * discarded and std::nullopt returned.
+   */
+  std::optional<folly::File> createOverlayFileWith(
+      InodeNumber inodeNumber,
+      folly::FunctionRef<bool(int fd)> writeContents);
+
+  /**
+   * Copies the contents of a blob file into fd, with a reflink if possible.
+   * Returns false if the kernel cannot copy it.
+   */
+  bool copyBlobFile(int blobFD, int fd);
+
  private:
   /** Path to ".eden/CLIENT/local" */
   const AbsolutePath localDir_;
 
+  /** Where initOverlay() stores directories if it creates a new overlay. */
+  const DirStorage newDirStorage_;
+
+  /**
+   * The database storing directories, if this overlay keeps them in SQLite.
+   * Opened by initOverlay() and closed by close().
+   */
+  std::unique_ptr<SqliteOverlay> sqliteDirs_;
+
   /**
    * An open file descriptor to the overlay info file.
    *
@@ -241,6 +368,20 @@ class FsOverlay {
    * We maintain this so we can use openat(), unlinkat(), etc.
    */
   folly::File dirFile_;
+
+  /**
+   * Set once cloning a blob file has failed because the filesystem lacks
+   * reflink support.
+   */
+  std::atomic<bool> reflinkUnsupported_{false};
+
+  /**
+   * The total size of the files in the blob file cache, computed by scanning
+   * it the first time a blob is added.
+   */
+  std::once_flag blobFileCacheScan_;
+  std::atomic<uint64_t> blobFileCacheBytes_{0};
+  std::atomic<uint64_t> nextBlobFileTmpId_{0};
 };
 
 class InodePath {
@@ -18,9 +18,15 @@
 #include <folly/FileUtil.h>
 #include <folly/String.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include "eden/fs/inodes/overlay/FsOverlay.h"
+#include "eden/fs/inodes/sqliteoverlay/SqliteOverlay.h"
 #include "eden/fs/utils/EnumValue.h"
 
 using apache::thrift::CompactSerializer;
@@ -36,6 +42,12 @@ using std::chrono::seconds;
 namespace facebook {
 namespace eden {
 
+DEFINE_int32(
+    fsckScanThreads,
+    0,
+    "The number of threads used to read the overlay when checking it for "
+    "errors.  0 uses one thread per CPU.");
+
 class OverlayChecker::RepairState {
  public:
   explicit RepairState(OverlayChecker* checker)
@@ -288,6 +300,29 @@ class OverlayChecker::UnexpectedInodeShard : public OverlayChecker::Error {
   ShardID shardID_;
 };
 
+class OverlayChecker::DirStoreCorruption : public OverlayChecker::Error {
+ public:
+  DirStoreCorruption(AbsolutePathPiece path, StringPiece problem)
+      : path_(path), problem_(problem.str()) {}
+
+  string getMessage(OverlayChecker*) const override {
+    return folly::to<string>(
+        "directory database ", path_, " is damaged: ", problem_);
+  }
+
+  bool repair(RepairState& /* repair */) const override {
+    // SQLite rolls back interrupted transactions itself, so this is damage to
+    // the file rather than an incomplete write.  Directories that can no
+    // longer be read are reported and replaced individually as
+    // InodeDataErrors.
+    return false;
+  }
+
+ private:
+  AbsolutePath path_;
+  std::string problem_;
+};
+
 class OverlayChecker::InodeDataError : public OverlayChecker::Error {
  public:
   template <typename... Args>
@@ -306,9 +341,20 @@ class OverlayChecker::InodeDataError : public OverlayChecker::Error {
     auto outputPath = repair.getLostAndFoundPath(pathInfo);
     ensureDirectoryExists(outputPath.dirname());
     auto srcPath = repair.fs()->getAbsoluteFilePath(number_);
-    auto ret = ::rename(srcPath.c_str(), outputPath.c_str());
-    folly::checkUnixError(
-        ret, "failed to rename inode data ", srcPath, " to ", outputPath);
+    auto* sqliteDirs = repair.fs()->getSqliteDirStore();
+    if (sqliteDirs && ::access(srcPath.c_str(), F_OK) != 0) {
+      // This is a directory stored in SQLite, so there is no file to move.
+      // Copy its raw data out instead.
+      auto data = sqliteDirs->loadOverlayDirData(number_);
+      if (data) {
+        folly::writeFileAtomic(outputPath.stringPiece(), *data, 0600);
+      }
+      sqliteDirs->removeOverlayData(number_);
+    } else {
+      auto ret = ::rename(srcPath.c_str(), outputPath.c_str());
+      folly::checkUnixError(
+          ret, "failed to rename inode data ", srcPath, " to ", outputPath);
+    }
 
     // Create replacement data for this inode in the overlay.
     const auto& inodes = repair.checker()->inodes_;
@@ -581,8 +627,8 @@ class OverlayChecker::OrphanInode : public OverlayChecker::Error {
 
   void tryRemoveInode(RepairState& repair, InodeNumber number) const {
     try {
-      repair.fs()->removeOverlayFile(number);
-    } catch (const std::system_error& ex) {
+      repair.fs()->removeOverlayData(number);
+    } catch (const std::exception& ex) {
       // If we fail to remove the file log an error, but proceed with the rest
       // of the fsck repairs rather than letting the exception propagate up
       // to our caller.
@@ -650,8 +696,11 @@ class OverlayChecker::BadNextInodeNumber : public OverlayChecker::Error {
 
 OverlayChecker::OverlayChecker(
     FsOverlay* fs,
-    optional<InodeNumber> nextInodeNumber)
-    : fs_(fs), loadedNextInodeNumber_(nextInodeNumber) {}
+    optional<InodeNumber> nextInodeNumber,
+    ProgressCallback progressCallback)
+    : fs_(fs),
+      loadedNextInodeNumber_(nextInodeNumber),
+      progressCallback_(std::move(progressCallback)) {}
 
 OverlayChecker::~OverlayChecker() {}
 
@@ -846,23 +895,69 @@ PathComponent OverlayChecker::findChildName(
 }
 
 void OverlayChecker::readInodes() {
-  // Walk through all of the sharded subdirectories
+  // Reading the shard directories is dominated by I/O, so spread the shards
+  // across several threads.  Each shard's results are kept separate and
+  // merged in shard order afterwards.
+  std::vector<ShardScan> scans(FsOverlay::kNumShards);
+  std::atomic<ShardID> nextShard{0};
+  std::mutex progressMutex;
   uint32_t progress10pct = 0;
-  std::array<char, 2> subdirBuffer;
-  MutableStringPiece subdir{subdirBuffer.data(), subdirBuffer.size()};
-  for (uint32_t shardID = 0; shardID < FsOverlay::kNumShards; ++shardID) {
-    // Log a DBG2 message every 10% done
-    uint32_t progress = (10 * shardID) / FsOverlay::kNumShards;
-    if (progress > progress10pct) {
-      XLOG(DBG2) << "fsck:" << fs_->getLocalDir() << ": scan " << progress
-                 << "0% complete: " << inodes_.size() << " inodes scanned";
-      progress10pct = progress;
+  uint32_t shardsDone = 0;
+
+  auto scanShards = [&] {
+    std::array<char, 2> subdirBuffer;
+    MutableStringPiece subdir{subdirBuffer.data(), subdirBuffer.size()};
+    for (;;) {
+      auto shardID = nextShard.fetch_add(1, std::memory_order_relaxed);
+      if (shardID >= FsOverlay::kNumShards) {
+        return;
+      }
+      FsOverlay::formatSubdirShardPath(shardID, subdir);
+      auto subdirPath = fs_->getLocalDir() + PathComponentPiece{subdir};
+      readInodeSubdir(subdirPath, shardID, scans[shardID]);
+
+      // Log a DBG2 message every 10% done
+      std::lock_guard<std::mutex> guard(progressMutex);
+      ++shardsDone;
+      uint32_t progress = (10 * shardsDone) / FsOverlay::kNumShards;
+      if (progress > progress10pct) {
+        XLOG(DBG2) << "fsck:" << fs_->getLocalDir() << ": scan " << progress
+                   << "0% complete";
+        if (progressCallback_) {
+          progressCallback_(progress * 10);
+        }
+        progress10pct = progress;
+      }
     }
+  };
 
-    FsOverlay::formatSubdirShardPath(shardID, subdir);
-    auto subdirPath = fs_->getLocalDir() + PathComponentPiece{subdir};
+  auto numThreads = std::clamp<uint32_t>(
+      FLAGS_fsckScanThreads > 0 ? FLAGS_fsckScanThreads
+                                : std::thread::hardware_concurrency(),
+      1,
+      FsOverlay::kNumShards);
+  std::vector<std::thread> threads;
+  threads.reserve(numThreads - 1);
+  for (uint32_t n = 1; n < numThreads; ++n) {
+    threads.emplace_back(scanShards);
+  }
+  scanShards();
+  for (auto& thread : threads) {
+    thread.join();
+  }
 
-    readInodeSubdir(subdirPath, shardID);
+  for (auto& scan : scans) {
+    maxInodeNumber_ = std::max(maxInodeNumber_, scan.maxInodeNumber);
+    for (auto& [number, info] : scan.inodes) {
+      inodes_.emplace(number, std::move(info));
+    }
+    for (auto& error : scan.errors) {
+      addError(std::move(error));
+    }
+  }
+
+  if (auto* sqliteDirs = fs_->getSqliteDirStore()) {
+    readSqliteDirs(sqliteDirs);
   }
   XLOG(DBG1) << "fsck:" << fs_->getLocalDir() << ": scanned " << inodes_.size()
              << " inodes";
@@ -870,14 +965,16 @@ void OverlayChecker::readInodes() {
 
 void OverlayChecker::readInodeSubdir(
     const AbsolutePath& path,
-    ShardID shardID) {
+    ShardID shardID,
+    ShardScan& scan) const {
   XLOG(DBG5) << "fsck:" << fs_->getLocalDir() << ": scanning " << path;
 
   boost::system::error_code error;
   auto boostPath = boost::filesystem::path{path.value().c_str()};
   auto iterator = boost::filesystem::directory_iterator(boostPath, error);
   if (error.value() != 0) {
-    addError<ShardDirectoryEnumerationError>(path, error);
+    scan.errors.push_back(
+        std::make_unique<ShardDirectoryEnumerationError>(path, error));
     return;
   }
 
@@ -888,37 +985,44 @@ void OverlayChecker::readInodeSubdir(
     auto entryInodeNumber =
         folly::tryTo<uint64_t>(inodePath.basename().value());
     if (entryInodeNumber.hasValue()) {
-      loadInode(InodeNumber(*entryInodeNumber), shardID);
+      loadInode(InodeNumber(*entryInodeNumber), shardID, scan);
     } else {
-      addError<UnexpectedOverlayFile>(inodePath);
+      scan.errors.push_back(std::make_unique<UnexpectedOverlayFile>(inodePath));
     }
 
     iterator.increment(error);
     if (error.value() != 0) {
-      addError<ShardDirectoryEnumerationError>(path, error);
+      scan.errors.push_back(
+          std::make_unique<ShardDirectoryEnumerationError>(path, error));
       break;
     }
   }
 }
 
-void OverlayChecker::loadInode(InodeNumber number, ShardID shardID) {
+void OverlayChecker::loadInode(
+    InodeNumber number,
+    ShardID shardID,
+    ShardScan& scan) const {
   XLOG(DBG9) << "fsck: loading inode " << number;
-  updateMaxInodeNumber(number);
+  scan.maxInodeNumber = std::max(scan.maxInodeNumber, number.get());
 
   // Verify that we found this inode in the correct shard subdirectory.
   // Ignore the data if it is in the wrong directory.
   ShardID expectedShard = static_cast<ShardID>(number.get() & 0xff);
   if (expectedShard != shardID) {
-    addError<UnexpectedInodeShard>(number, shardID);
+    scan.errors.push_back(
+        std::make_unique<UnexpectedInodeShard>(number, shardID));
     return;
   }
 
-  inodes_.emplace(number, loadInodeInfo(number));
+  scan.inodes.emplace_back(number, loadInodeInfo(number, scan));
 }
 
-OverlayChecker::InodeInfo OverlayChecker::loadInodeInfo(InodeNumber number) {
-  auto inodeError = [this, number](auto&&... args) {
-    addError<InodeDataError>(number, args...);
+OverlayChecker::InodeInfo OverlayChecker::loadInodeInfo(
+    InodeNumber number,
+    ShardScan& scan) const {
+  auto inodeError = [&scan, number](auto&&... args) {
+    scan.errors.push_back(std::make_unique<InodeDataError>(number, args...));
     return InodeInfo(number, InodeType::Error);
   };
 
@@ -987,6 +1091,43 @@ OverlayChecker::InodeInfo OverlayChecker::loadInodeInfo(InodeNumber number) {
   return InodeInfo(number, type);
 }
 
+void OverlayChecker::readSqliteDirs(SqliteOverlay* sqliteDirs) {
+  auto dbPath = SqliteOverlay::getDatabasePath(fs_->getLocalDir());
+  XLOG(DBG5) << "fsck:" << fs_->getLocalDir() << ": scanning directories in "
+             << dbPath;
+
+  try {
+    for (const auto& problem : sqliteDirs->checkIntegrity()) {
+      addError<DirStoreCorruption>(dbPath, problem);
+    }
+  } catch (const std::exception& ex) {
+    addError<DirStoreCorruption>(dbPath, folly::exceptionStr(ex));
+  }
+
+  std::vector<InodeNumber> dirNumbers;
+  try {
+    dirNumbers = sqliteDirs->listOverlayDirs();
+  } catch (const std::exception& ex) {
+    addError<DirStoreCorruption>(dbPath, folly::exceptionStr(ex));
+    return;
+  }
+
+  for (auto number : dirNumbers) {
+    XLOG(DBG9) << "fsck: loading inode " << number;
+    updateMaxInodeNumber(number);
+    try {
+      auto dir = sqliteDirs->loadOverlayDir(number);
+      if (dir) {
+        inodes_.emplace(number, InodeInfo(number, std::move(*dir)));
+      }
+    } catch (const std::exception& ex) {
+      addError<InodeDataError>(
+          number, "error parsing directory contents: ", folly::exceptionStr(ex));
+      inodes_.emplace(number, InodeInfo(number, InodeType::Error));
+    }
+  }
+}
+
 overlay::OverlayDir OverlayChecker::loadDirectoryChildren(folly::File& file) {
   std::string serializedData;
   if (!folly::readFile(file.fd(), serializedData)) {
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <optional>
 
@@ -25,6 +26,7 @@ namespace facebook {
 namespace eden {
 
 class FsOverlay;
+class SqliteOverlay;
 
 /**
  * OverlayChecker performs "fsck" operations on the on-disk overlay data.
@@ -50,6 +52,13 @@ class OverlayChecker {
     uint32_t fixedErrors{0};
   };
 
+  /**
+   * Called as scanForErrors() reads the overlay, with the percentage of the
+   * overlay read so far.  It is called from only one thread at a time, but not
+   * necessarily the thread that called scanForErrors().
+   */
+  using ProgressCallback = std::function<void(uint32_t percentComplete)>;
+
   /**
    * Create a new OverlayChecker.
    *
@@ -57,7 +66,10 @@ class OverlayChecker {
    * of the check operation.  The caller is responsible for ensuring that the
    * FsOverlay object exists for at least as long as the OverlayChecker object.
    */
-  OverlayChecker(FsOverlay* fs, std::optional<InodeNumber> nextInodeNumber);
+  OverlayChecker(
+      FsOverlay* fs,
+      std::optional<InodeNumber> nextInodeNumber,
+      ProgressCallback progressCallback = nullptr);
 
   ~OverlayChecker();
 
@@ -143,6 +155,7 @@ class OverlayChecker {
   class ShardDirectoryEnumerationError;
   class UnexpectedOverlayFile;
   class UnexpectedInodeShard;
+  class DirStoreCorruption;
   class InodeDataError;
   class MissingMaterializedInode;
   class OrphanInode;
@@ -185,11 +198,27 @@ class OverlayChecker {
   PathInfo cachedPathComputation(InodeNumber number, Fn&& fn);
 
   using ShardID = uint32_t;
+
+  /**
+   * The results of reading one shard directory.  Shards are read in parallel,
+   * and their results merged in shard order so that the errors found, and so
+   * the repairs made, do not depend on thread scheduling.
+   */
+  struct ShardScan {
+    std::vector<std::pair<InodeNumber, InodeInfo>> inodes;
+    std::vector<std::unique_ptr<Error>> errors;
+    uint64_t maxInodeNumber{0};
+  };
+
   void readInodes();
-  void readInodeSubdir(const AbsolutePath& path, ShardID shardID);
-  void loadInode(InodeNumber number, ShardID shardID);
-  InodeInfo loadInodeInfo(InodeNumber number);
-  overlay::OverlayDir loadDirectoryChildren(folly::File& file);
+  void readInodeSubdir(
+      const AbsolutePath& path,
+      ShardID shardID,
+      ShardScan& scan) const;
+  void loadInode(InodeNumber number, ShardID shardID, ShardScan& scan) const;
+  InodeInfo loadInodeInfo(InodeNumber number, ShardScan& scan) const;
+  void readSqliteDirs(SqliteOverlay* sqliteDirs);
+  static overlay::OverlayDir loadDirectoryChildren(folly::File& file);
 
   void linkInodeChildren();
   void scanForParentErrors();
@@ -209,6 +238,7 @@ class OverlayChecker {
 
   FsOverlay* const fs_;
   std::optional<InodeNumber> loadedNextInodeNumber_;
+  ProgressCallback progressCallback_;
   std::unordered_map<InodeNumber, InodeInfo> inodes_;
   std::vector<std::unique_ptr<Error>> errors_;
   uint64_t maxInodeNumber_{kRootNodeId.get()};
@@ -7,24 +7,34 @@
 
 #include <memory>
 
+#include <boost/filesystem.hpp>
 #include <folly/Conv.h>
 #include <folly/FileUtil.h>
 #include <folly/Range.h>
 #include <folly/logging/xlog.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
+#include <gflags/gflags.h>
 
 #include "eden/fs/inodes/overlay/FsOverlay.h"
 #include "eden/fs/inodes/overlay/OverlayChecker.h"
+#include "eden/fs/inodes/sqliteoverlay/SqliteOverlay.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/testharness/TempFile.h"
 #include "eden/fs/testharness/TestUtil.h"
 
+namespace facebook {
+namespace eden {
+DECLARE_int32(fsckScanThreads);
+} // namespace eden
+} // namespace facebook
+
 using namespace facebook::eden;
 using folly::ByteRange;
 using folly::StringPiece;
 using std::make_shared;
 using std::string;
+using ::testing::Contains;
 using ::testing::HasSubstr;
 using ::testing::UnorderedElementsAre;
 
@@ -34,7 +44,8 @@ class TestDir;
 
 class TestOverlay : public std::enable_shared_from_this<TestOverlay> {
  public:
-  TestOverlay();
+  explicit TestOverlay(
+      FsOverlay::DirStorage dirStorage = FsOverlay::DirStorage::Files);
 
   /*
    * Initialize the TestOverlay object.
@@ -182,13 +193,13 @@ class TestDir {
   overlay::OverlayDir contents_;
 };
 
-TestOverlay::TestOverlay()
+TestOverlay::TestOverlay(FsOverlay::DirStorage dirStorage)
     : tmpDir_(makeTempDir()),
       tmpDirPath_(tmpDir_.path().string()),
       // fsck will write its output in a sibling directory to the overlay,
       // so make sure we put the overlay at least 1 directory deep inside our
       // temporary directory
-      fs_(tmpDirPath_ + "overlay"_pc) {}
+      fs_(tmpDirPath_ + "overlay"_pc, dirStorage) {}
 
 TestDir TestOverlay::init() {
   auto nextInodeNumber = fs_.initOverlay(/*createIfNonExisting=*/true);
@@ -613,3 +624,137 @@ TEST(Fsck, testHardLink) {
           "- src/foo/x/y/z.txt")));
   overlay->fs().close(checker.getNextInodeNumber());
 }
+
+TEST(Fsck, testSqliteDirs) {
+  auto overlay = make_shared<TestOverlay>(FsOverlay::DirStorage::Sqlite);
+  auto root = overlay->init();
+  SimpleOverlayLayout layout(root);
+  overlay->closeCleanly();
+
+  // Reopening the overlay finds the directory database without being told.
+  FsOverlay fs(overlay->overlayPath());
+  auto nextInode = fs.initOverlay(/*createIfNonExisting=*/false);
+  ASSERT_NE(nullptr, fs.getSqliteDirStore());
+  EXPECT_FALSE(boost::filesystem::exists(
+      fs.getAbsoluteFilePath(layout.src.number()).value().c_str()));
+  EXPECT_TRUE(fs.hasOverlayData(layout.src.number()));
+  EXPECT_TRUE(fs.hasOverlayData(layout.src_todoTxt.number()));
+
+  OverlayChecker checker(&fs, nextInode);
+  checker.scanForErrors();
+  EXPECT_THAT(errorMessages(checker), UnorderedElementsAre());
+  EXPECT_EQ(
+      "src/foo/x/y/z.txt",
+      checker.computePath(layout.src_foo_x_y_zTxt.number()).toString());
+
+  // Remove the "src/" directory from the database.
+  fs.removeOverlayData(layout.src.number());
+  EXPECT_FALSE(fs.hasOverlayData(layout.src.number()));
+
+  OverlayChecker checker2(&fs, nextInode);
+  checker2.scanForErrors();
+  EXPECT_THAT(
+      errorMessages(checker2),
+      UnorderedElementsAre(
+          folly::to<string>(
+              "missing overlay file for materialized directory inode ",
+              layout.src.number(),
+              " (src)"),
+          folly::to<string>(
+              "found orphan directory inode ", layout.src_foo.number()),
+          folly::to<string>(
+              "found orphan file inode ", layout.src_todoTxt.number())));
+
+  auto [result, fsckLog] = performRepair(checker2, 3, 3);
+  EXPECT_THAT(fsckLog, HasSubstr("successfully repaired all 3 problems"));
+  EXPECT_EQ(
+      "zzz", readLostNFoundFile(result, layout.src_foo.number(), "x/y/z.txt"));
+
+  // The replacement for src/ and the removal of the orphans both went to the
+  // database.
+  auto newDirContents = fs.loadOverlayDir(layout.src.number());
+  ASSERT_TRUE(newDirContents.has_value());
+  EXPECT_EQ(0, newDirContents->entries.size());
+  EXPECT_FALSE(fs.hasOverlayData(layout.src_foo.number()));
+  EXPECT_FALSE(fs.hasOverlayData(layout.src_foo_x_y.number()));
+  EXPECT_FALSE(fs.hasOverlayData(layout.src_foo_x_y_zTxt.number()));
+
+  fs.close(checker2.getNextInodeNumber());
+}
+
+TEST(Fsck, testCorruptSqliteDirs) {
+  auto overlay = make_shared<TestOverlay>(FsOverlay::DirStorage::Sqlite);
+  auto root = overlay->init();
+  SimpleOverlayLayout layout(root);
+  overlay->closeCleanly();
+
+  // Overwrite every page after the first one, which holds the schema, so
+  // that the database still opens but its tables can no longer be read.
+  constexpr off_t kPageSize = 4096;
+  auto dbPath = SqliteOverlay::getDatabasePath(overlay->overlayPath());
+  {
+    folly::File db{dbPath.c_str(), O_RDWR};
+    struct stat st;
+    folly::checkUnixError(fstat(db.fd(), &st), "fstat failed");
+    ASSERT_GT(st.st_size, kPageSize);
+    std::string garbage(st.st_size - kPageSize, 0x55);
+    folly::checkUnixError(
+        folly::pwriteFull(db.fd(), garbage.data(), garbage.size(), kPageSize),
+        "failed to corrupt the directory database");
+  }
+
+  FsOverlay fs(overlay->overlayPath());
+  auto nextInode = fs.initOverlay(/*createIfNonExisting=*/false);
+  ASSERT_NE(nullptr, fs.getSqliteDirStore());
+  OverlayChecker checker(&fs, nextInode);
+  checker.scanForErrors();
+  EXPECT_THAT(
+      errorMessages(checker),
+      Contains(HasSubstr(
+          folly::to<string>("directory database ", dbPath, " is damaged: "))));
+  fs.close(checker.getNextInodeNumber());
+}
+
+TEST(Fsck, testParallelScanIsDeterministic) {
+  auto overlay = make_shared<TestOverlay>();
+  auto root = overlay->init();
+  SimpleOverlayLayout layout(root);
+  overlay->fs().removeOverlayFile(layout.src.number());
+  overlay->fs().removeOverlayFile(layout.test_a.number());
+  std::string badHeader(FsOverlay::kHeaderLength, 0x55);
+  overlay->corruptInodeHeader(layout.src_foo_testTxt.number(), badHeader);
+
+  auto scan = [&](int32_t threads,
+                  std::vector<uint32_t>* progress,
+                  InodeNumber* nextInodeNumber) {
+    gflags::FlagSaver flagSaver;
+    FLAGS_fsckScanThreads = threads;
+    OverlayChecker checker(
+        &overlay->fs(), std::nullopt, [progress](uint32_t percentComplete) {
+          progress->push_back(percentComplete);
+        });
+    checker.scanForErrors();
+    *nextInodeNumber = checker.getNextInodeNumber();
+    return errorMessages(checker);
+  };
+
+  std::vector<uint32_t> serialProgress;
+  InodeNumber serialNextInode;
+  auto serialErrors = scan(1, &serialProgress, &serialNextInode);
+  std::vector<uint32_t> parallelProgress;
+  InodeNumber parallelNextInode;
+  auto parallelErrors = scan(8, &parallelProgress, &parallelNextInode);
+
+  // The same errors are found, in the same order, regardless of how many
+  // threads read the overlay.
+  EXPECT_EQ(5, serialErrors.size());
+  EXPECT_EQ(serialErrors, parallelErrors);
+  EXPECT_EQ(serialNextInode, parallelNextInode);
+
+  EXPECT_THAT(
+      serialProgress,
+      ::testing::ElementsAre(10, 20, 30, 40, 50, 60, 70, 80, 90, 100));
+  EXPECT_EQ(serialProgress, parallelProgress);
+
+  overlay->closeCleanly();
+}
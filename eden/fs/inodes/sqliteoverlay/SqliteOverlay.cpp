@@ -7,6 +7,7 @@
 
 #include "SqliteOverlay.h"
 
+#include <folly/ScopeGuard.h>
 #include <folly/String.h>
 #include <folly/container/Array.h>
 #include <folly/logging/xlog.h>
@@ -14,7 +15,6 @@
 #include <iostream>
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/sqlite/Sqlite.h"
-#include "eden/fs/store/StoreResult.h"
 #include "eden/fs/utils/PathFuncs.h"
 
 namespace facebook {
@@ -35,13 +35,37 @@ constexpr uint64_t kStartInodeNumber = 100;
 // shutdown. More details in the header file.
 constexpr uint64_t kInodeAllocationRange = 100;
 
+struct SqliteOverlay::Statements {
+  explicit Statements(LockedDbPtr& db)
+      : load{db, "select value from ", kInodeTable, " where inode = ?"},
+        has{db, "select 1 from ", kInodeTable, " where inode = ?"},
+        // TODO: we need `or ignore` otherwise we hit primary key violations
+        // when running our integration tests.  This implies that we're
+        // over-fetching and that we have a perf improvement opportunity.
+        save{db, "insert or replace into ", kInodeTable, " VALUES(?, ?, ?)"},
+        remove{db, "delete from ", kInodeTable, " where inode = ?"},
+        begin{db, "BEGIN"},
+        commit{db, "COMMIT"},
+        rollback{db, "ROLLBACK"} {}
+
+  SqliteStatement load;
+  SqliteStatement has;
+  SqliteStatement save;
+  SqliteStatement remove;
+  SqliteStatement begin;
+  SqliteStatement commit;
+  SqliteStatement rollback;
+};
+
 SqliteOverlay::SqliteOverlay(AbsolutePathPiece localDir)
     : localDir_{std::move(localDir)} {}
 
 SqliteOverlay::~SqliteOverlay() {
-  if (db_) {
-    db_->close();
-  }
+  closeDatabase();
+}
+
+AbsolutePath SqliteOverlay::getDatabasePath(AbsolutePathPiece localDir) {
+  return localDir + kOverlayName;
 }
 
 std::optional<InodeNumber> SqliteOverlay::initOverlay(
@@ -50,11 +74,45 @@ std::optional<InodeNumber> SqliteOverlay::initOverlay(
     ensureDirectoryExists(localDir_);
   }
 
-  db_ = std::make_unique<SqliteDatabase>(localDir_ + kOverlayName);
+  openDatabase();
   auto db = db_->lock();
 
+  // In the following code we read the last know used inode number and allocate
+  // a range of inodes by saving the incremented value in db.
+  uint64_t nextInodeNumber;
+  auto optNextInodeNumber = readNextInodeNumber(db);
+  if (optNextInodeNumber.has_value()) {
+    nextInodeNumber = optNextInodeNumber.value();
+  } else {
+    // This will only be true if this is the first run.
+    nextInodeNumber = kStartInodeNumber;
+  }
+  auto nextValue = nextInodeNumber + kStartInodeNumber;
+  writeNextInodeNumber(db, nextValue);
+  nextInodeNumber_.store(nextValue, std::memory_order_release);
+
+  // The only reason we return an optional value is to have a common interface
+  // with FsOverlay. This would change once we have implement OverlayChecker.
+  return std::make_optional(InodeNumber{nextInodeNumber});
+}
+
+void SqliteOverlay::openDatabase() {
+  db_ = std::make_unique<SqliteDatabase>(getDatabasePath(localDir_));
+  auto db = db_->lock();
+
+  // Let compact() return the pages of removed records to the filesystem.
+  // SQLite only honors this while the database is still empty, before even
+  // the switch to WAL mode below writes its header.  Overlays created before
+  // this setting keep auto_vacuum=NONE until it is set again and followed by
+  // a full VACUUM, which rewrites the database.
+  SqliteStatement(db, "PRAGMA auto_vacuum=INCREMENTAL").step();
   // Write ahead log for faster perf https://www.sqlite.org/wal.html
   SqliteStatement(db, "PRAGMA journal_mode=WAL").step();
+  // In WAL mode, NORMAL only syncs at checkpoints.  A crash of EdenFS itself
+  // loses nothing; a power failure may lose the most recent transactions but
+  // never corrupts the database.  This matches the overlay files, which are
+  // not fsynced either.
+  SqliteStatement(db, "PRAGMA synchronous=NORMAL").step();
 
   // The Inode table stores the information about each inode. At this point we
   // are only using it to store the information about the directory entries
@@ -81,30 +139,26 @@ std::optional<InodeNumber> SqliteOverlay::initOverlay(
       ")")
       .step();
 
-  // In the following code we read the last know used inode number and allocate
-  // a range of inodes by saving the incremented value in db.
-  uint64_t nextInodeNumber;
-  auto optNextInodeNumber = readNextInodeNumber(db);
-  if (optNextInodeNumber.has_value()) {
-    nextInodeNumber = optNextInodeNumber.value();
-  } else {
-    // This will only be true if this is the first run.
-    nextInodeNumber = kStartInodeNumber;
-  }
-  auto nextValue = nextInodeNumber + kStartInodeNumber;
-  writeNextInodeNumber(db, nextValue);
-  nextInodeNumber_.store(nextValue, std::memory_order_release);
-
-  // The only reason we return an optional value is to have a common interface
-  // with FsOverlay. This would change once we have implement OverlayChecker.
-  return std::make_optional(InodeNumber{nextInodeNumber});
+  statements_ = std::make_unique<Statements>(db);
 }
 
 void SqliteOverlay::close(std::optional<InodeNumber> nextInodeNumber) {
   if (nextInodeNumber.has_value()) {
     saveNextInodeNumber(nextInodeNumber.value().get());
   }
-  db_->close();
+  closeDatabase();
+}
+
+void SqliteOverlay::closeDatabase() {
+  if (db_) {
+    {
+      // Prepared statements must be finalized before the database can be
+      // closed.
+      auto db = db_->lock();
+      statements_.reset();
+    }
+    db_->close();
+  }
 }
 
 void SqliteOverlay::updateUsedInodeNumber(uint64_t usedInodeNumber) {
@@ -114,8 +168,10 @@ void SqliteOverlay::updateUsedInodeNumber(uint64_t usedInodeNumber) {
 std::optional<std::string> SqliteOverlay::load(uint64_t inodeNumber) const {
   auto db = db_->lock();
 
-  SqliteStatement stmt(
-      db, "select value from ", kInodeTable, " where inode = ?");
+  auto& stmt = statements_->load;
+  SCOPE_EXIT {
+    stmt.reset();
+  };
 
   // Bind the inode; parameters are 1-based
   stmt.bind(1, inodeNumber);
@@ -133,26 +189,24 @@ std::optional<std::string> SqliteOverlay::load(uint64_t inodeNumber) const {
 bool SqliteOverlay::hasInode(uint64_t inodeNumber) const {
   auto db = db_->lock();
 
-  SqliteStatement stmt(db, "select 1 from ", kInodeTable, " where inode = ?");
+  auto& stmt = statements_->has;
+  SCOPE_EXIT {
+    stmt.reset();
+  };
 
   stmt.bind(1, inodeNumber);
   return stmt.step();
 }
 
 void SqliteOverlay::save(
+    LockedDbPtr& /* db */,
     uint64_t inodeNumber,
     bool isDirectory,
     ByteRange value) {
-  auto db = db_->lock();
-
-  SqliteStatement stmt(
-      db,
-      // TODO: we need `or ignore` otherwise we hit primary key violations
-      // when running our integration tests.  This implies that we're
-      // over-fetching and that we have a perf improvement opportunity.
-      "insert or replace into ",
-      kInodeTable,
-      " VALUES(?, ?, ?)");
+  auto& stmt = statements_->save;
+  SCOPE_EXIT {
+    stmt.reset();
+  };
 
   const uint32_t dir = isDirectory ? 1 : 0;
 
@@ -162,6 +216,24 @@ void SqliteOverlay::save(
   stmt.step();
 }
 
+template <typename Fn>
+void SqliteOverlay::runInTransaction(LockedDbPtr& /* db */, Fn&& fn) {
+  statements_->begin.step();
+  try {
+    fn();
+  } catch (const std::exception&) {
+    try {
+      statements_->rollback.step();
+    } catch (const std::exception& ex) {
+      // Some errors roll the transaction back automatically, in which case
+      // ROLLBACK fails.  The original error is the one worth reporting.
+      XLOG(DBG3) << "failed to roll back overlay transaction: " << ex.what();
+    }
+    throw;
+  }
+  statements_->commit.step();
+}
+
 void SqliteOverlay::saveOverlayDir(
     InodeNumber inodeNumber,
     const overlay::OverlayDir& odir) {
@@ -169,12 +241,40 @@ void SqliteOverlay::saveOverlayDir(
   auto serializedData =
       apache::thrift::CompactSerializer::serialize<std::string>(odir);
 
+  auto db = db_->lock();
   save(
+      db,
       inodeNumber.getRawValue(),
       /*isDirectory=*/true,
       folly::StringPiece(serializedData));
 }
 
+void SqliteOverlay::saveOverlayDirs(
+    const std::vector<
+        std::pair<InodeNumber, std::shared_ptr<const overlay::OverlayDir>>>&
+        dirs) {
+  // Serialize outside of the lock so that readers are only blocked by the
+  // database writes.
+  std::vector<std::string> serializedDirs;
+  serializedDirs.reserve(dirs.size());
+  for (const auto& entry : dirs) {
+    serializedDirs.push_back(
+        apache::thrift::CompactSerializer::serialize<std::string>(
+            *entry.second));
+  }
+
+  auto db = db_->lock();
+  runInTransaction(db, [&] {
+    for (size_t i = 0; i < dirs.size(); ++i) {
+      save(
+          db,
+          dirs[i].first.getRawValue(),
+          /*isDirectory=*/true,
+          folly::StringPiece(serializedDirs[i]));
+    }
+  });
+}
+
 std::optional<overlay::OverlayDir> SqliteOverlay::loadOverlayDir(
     InodeNumber inodeNumber) {
   auto serializedData = load(inodeNumber.getRawValue());
@@ -189,16 +289,93 @@ std::optional<overlay::OverlayDir> SqliteOverlay::loadOverlayDir(
 void SqliteOverlay::removeOverlayData(InodeNumber inodeNumber) {
   auto db = db_->lock();
 
-  SqliteStatement stmt(db, "delete from ", kInodeTable, " where inode = ?");
+  auto& stmt = statements_->remove;
+  SCOPE_EXIT {
+    stmt.reset();
+  };
 
   stmt.bind(1, inodeNumber.get());
   stmt.step();
+  ++removedSinceCompaction_;
+}
+
+void SqliteOverlay::removeOverlayData(
+    const std::vector<InodeNumber>& inodeNumbers) {
+  auto db = db_->lock();
+  runInTransaction(db, [&] {
+    auto& stmt = statements_->remove;
+    for (auto inodeNumber : inodeNumbers) {
+      SCOPE_EXIT {
+        stmt.reset();
+      };
+      stmt.bind(1, inodeNumber.get());
+      stmt.step();
+    }
+  });
+  removedSinceCompaction_ += inodeNumbers.size();
 }
 
 bool SqliteOverlay::hasOverlayData(InodeNumber inodeNumber) {
   return hasInode(inodeNumber.get());
 }
 
+std::optional<std::string> SqliteOverlay::loadOverlayDirData(
+    InodeNumber inodeNumber) {
+  return load(inodeNumber.get());
+}
+
+std::vector<InodeNumber> SqliteOverlay::listOverlayDirs() {
+  auto db = db_->lock();
+
+  SqliteStatement stmt(
+      db, "select inode from ", kInodeTable, " where isdir = 1");
+
+  std::vector<InodeNumber> inodeNumbers;
+  while (stmt.step()) {
+    inodeNumbers.emplace_back(stmt.columnUint64(0));
+  }
+  return inodeNumbers;
+}
+
+std::vector<std::string> SqliteOverlay::checkIntegrity() {
+  auto db = db_->lock();
+
+  SqliteStatement stmt(db, "PRAGMA quick_check");
+
+  std::vector<std::string> problems;
+  while (stmt.step()) {
+    auto message = stmt.columnBlob(0);
+    if (message != "ok") {
+      problems.push_back(message.str());
+    }
+  }
+  return problems;
+}
+
+bool SqliteOverlay::compactIfNeeded() {
+  {
+    auto db = db_->lock();
+    if (removedSinceCompaction_ < kCompactionRemovalThreshold) {
+      return false;
+    }
+  }
+  compact();
+  return true;
+}
+
+void SqliteOverlay::compact() {
+  auto db = db_->lock();
+
+  SqliteStatement vacuum(db, "PRAGMA incremental_vacuum");
+  while (vacuum.step()) {
+  }
+  // TRUNCATE waits for readers and then empties the write-ahead log, which
+  // otherwise only ever grows to its largest size.
+  SqliteStatement(db, "PRAGMA wal_checkpoint(TRUNCATE)").step();
+  removedSinceCompaction_ = 0;
+  XLOG(DBG2) << "compacted overlay database in " << localDir_;
+}
+
 void SqliteOverlay::saveNextInodeNumber(uint64_t inodeNumber) {
   if (inodeNumber >= nextInodeNumber_.load(std::memory_order_relaxed)) {
     auto db = db_->lock();
@@ -213,8 +390,11 @@ void SqliteOverlay::saveNextInodeNumber(uint64_t inodeNumber) {
 }
 
 std::optional<uint64_t> SqliteOverlay::readNextInodeNumber(LockedDbPtr& db) {
-  SqliteStatement stmt(
-      db, "select value from ", kConfigTable, " where key = ?");
+  auto& stmt =
+      db_->prepare(db, "select value from ", kConfigTable, " where key = ?");
+  SCOPE_EXIT {
+    stmt.reset();
+  };
 
   // Bind the key; parameters are 1-based
   stmt.bind(1, kNextInodeNumber);
@@ -241,8 +421,11 @@ void SqliteOverlay::writeNextInodeNumber(
       reinterpret_cast<const uint8_t*>(&inodeNumber),
       reinterpret_cast<const uint8_t*>(&inodeNumber + 1))};
 
-  SqliteStatement stmt(
+  auto& stmt = db_->prepare(
       db, "insert or replace into ", kConfigTable, " VALUES(?, ?)");
+  SCOPE_EXIT {
+    stmt.reset();
+  };
 
   stmt.bind(1, kNextInodeNumber);
   stmt.bind(2, ino);
@@ -7,6 +7,8 @@
 
 #pragma once
 #include <folly/Synchronized.h>
+#include <memory>
+#include <vector>
 #include "eden/fs/sqlite/Sqlite.h"
 
 #include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
@@ -19,11 +21,25 @@ using LockedDbPtr = folly::Synchronized<sqlite3*>::LockedPtr;
 /**
  * Sqlite overlay stores the directory inode and its entries in the sqlite
  * database. This is similar to FsOverlay but doesn't support all the
- * functionality. This is only used on Windows right now.
+ * functionality.
+ *
+ * On Windows this is the whole overlay.  On other platforms FsOverlay can use
+ * it to store directories in place of one overlay file per directory, while
+ * file contents remain in overlay files.
+ *
+ * Statements are prepared once when the database is opened, and are only
+ * used while holding the db_ lock.
  */
 
 class SqliteOverlay {
  public:
+  /**
+   * compactIfNeeded() only compacts once this many records were removed
+   * since the last compaction, since compacting rewrites free pages and the
+   * write-ahead log.
+   */
+  static constexpr uint64_t kCompactionRemovalThreshold = 10000;
+
   explicit SqliteOverlay(AbsolutePathPiece localDir);
   ~SqliteOverlay();
 
@@ -38,6 +54,19 @@ class SqliteOverlay {
    */
   std::optional<InodeNumber> initOverlay(bool createIfNonExisting);
 
+  /**
+   * Open the database and create its tables, without allocating a range of
+   * inode numbers.  This is used when the database only stores directories
+   * for an FsOverlay, which tracks the next inode number itself.  The "close"
+   * method should be called with std::nullopt to release the database.
+   */
+  void openDatabase();
+
+  /**
+   * Return the path of the database inside an overlay directory.
+   */
+  static AbsolutePath getDatabasePath(AbsolutePathPiece localDir);
+
   /**
    *  Gracefully, shutdown the overlay, persisting the overlay's
    * nextInodeNumber.
@@ -60,6 +89,62 @@ class SqliteOverlay {
   void removeOverlayData(InodeNumber inodeNumber);
   bool hasOverlayData(InodeNumber inodeNumber);
 
+  /**
+   * Save several directories in a single transaction.
+   *
+   * Committing each directory on its own costs a WAL append and a sync
+   * decision per directory; bursts of directory saves are much cheaper when
+   * grouped.  Either every directory in the batch is saved, or an exception
+   * is thrown and none of them are.
+   */
+  void saveOverlayDirs(
+      const std::vector<
+          std::pair<InodeNumber, std::shared_ptr<const overlay::OverlayDir>>>&
+          dirs);
+
+  /**
+   * Remove the data for several inodes in a single transaction.
+   */
+  void removeOverlayData(const std::vector<InodeNumber>& inodeNumbers);
+
+  /**
+   * Return the serialized data of a directory without deserializing it.
+   * This is used by fsck to archive directories which cannot be parsed.
+   */
+  std::optional<std::string> loadOverlayDirData(InodeNumber inodeNumber);
+
+  /**
+   * Return the inode numbers of every directory stored in the database.
+   */
+  std::vector<InodeNumber> listOverlayDirs();
+
+  /**
+   * Return the result of SQLite's consistency check of the database: empty
+   * if the database is sound, otherwise one message per problem found.
+   */
+  std::vector<std::string> checkIntegrity();
+
+  /**
+   * Reclaim the space of removed records and fold the write-ahead log back
+   * into the database, if enough records were removed since the last time.
+   *
+   * Returns true if the database was compacted.
+   */
+  bool compactIfNeeded();
+
+  /**
+   * Unconditionally reclaim free pages and checkpoint the write-ahead log.
+   *
+   * Free pages are only returned to the filesystem in databases created with
+   * auto_vacuum=INCREMENTAL, which openDatabase() sets on new databases.
+   * SQLite cannot change auto_vacuum on a database that already has tables,
+   * so overlays created before that need a one-time
+   * "PRAGMA auto_vacuum=INCREMENTAL; VACUUM;" (for instance with the sqlite3
+   * shell while EdenFS is stopped) before compact() can shrink them.  Until
+   * then compact() only truncates the write-ahead log.
+   */
+  void compact();
+
   /**
    * Update the last used Inode number to a new value. This is a stop gap
    * solution for the recovery when Eden doesn't know the last used inode number
@@ -77,9 +162,24 @@ class SqliteOverlay {
   void updateUsedInodeNumber(uint64_t usedInodeNumber);
 
  private:
+  struct Statements;
+
   std::optional<std::string> load(uint64_t inodeNumber) const;
   bool hasInode(uint64_t inodeNumber) const;
-  void save(uint64_t inodeNumber, bool isDirectory, folly::ByteRange value);
+  void save(
+      LockedDbPtr& db,
+      uint64_t inodeNumber,
+      bool isDirectory,
+      folly::ByteRange value);
+
+  /**
+   * Run fn() inside a transaction, committing it if fn() returns and rolling
+   * it back if fn() throws.
+   */
+  template <typename Fn>
+  void runInTransaction(LockedDbPtr& db, Fn&& fn);
+
+  void closeDatabase();
 
   // APIs to fetch and save the value of next Inode number
   void saveNextInodeNumber(uint64_t inodeNumber);
@@ -89,12 +189,20 @@ class SqliteOverlay {
   // Sqlite db handle
   std::unique_ptr<SqliteDatabase> db_;
 
+  // Prepared statements for db_.  These must be destroyed before db_ is
+  // closed.
+  std::unique_ptr<Statements> statements_;
+
   // Path to the folder containing DB.
   const AbsolutePath localDir_;
 
   // Has initOverlay() been called on this.
   bool initialized_ = false;
 
+  // The number of records removed since the database was last compacted.
+  // Protected by the db_ lock.
+  uint64_t removedSinceCompaction_{0};
+
   // nextInodeNumber_ is part of a stop gap solution for Windows described
   // above. The writes to this are protected by db_ lock.
   std::atomic<uint64_t> nextInodeNumber_{0};
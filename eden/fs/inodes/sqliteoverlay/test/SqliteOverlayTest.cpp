@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/sqliteoverlay/SqliteOverlay.h"
+
+#include <boost/filesystem.hpp>
+#include <folly/Conv.h>
+#include <folly/experimental/TestUtil.h>
+#include <gtest/gtest.h>
+#include "eden/fs/fuse/InodeNumber.h"
+#include "eden/fs/testharness/TempFile.h"
+
+using namespace facebook::eden;
+
+namespace {
+class SqliteOverlayTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    overlay_ = std::make_unique<SqliteOverlay>(localDir_);
+    overlay_->initOverlay(/*createIfNonExisting=*/true);
+  }
+
+  void TearDown() override {
+    overlay_->close(std::nullopt);
+  }
+
+  /**
+   * Saves count directories with one entry each, starting at inode number
+   * first, and returns their inode numbers.
+   */
+  std::vector<InodeNumber> saveDirs(uint64_t first, size_t count) {
+    overlay::OverlayEntry entry;
+    entry.mode = S_IFREG | 0644;
+    entry.inodeNumber = 1;
+    auto odir = std::make_shared<overlay::OverlayDir>();
+    odir->entries.emplace(std::string(100, 'x'), entry);
+
+    std::vector<InodeNumber> numbers;
+    std::vector<
+        std::pair<InodeNumber, std::shared_ptr<const overlay::OverlayDir>>>
+        dirs;
+    for (size_t i = 0; i < count; ++i) {
+      numbers.emplace_back(first + i);
+      dirs.emplace_back(numbers.back(), odir);
+    }
+    overlay_->saveOverlayDirs(dirs);
+    return numbers;
+  }
+
+  uint64_t fileSize(folly::StringPiece suffix) const {
+    return boost::filesystem::file_size(folly::to<std::string>(
+        SqliteOverlay::getDatabasePath(localDir_), suffix));
+  }
+
+  folly::test::TemporaryDirectory tempDir_{makeTempDir()};
+  AbsolutePath localDir_{tempDir_.path().string()};
+  std::unique_ptr<SqliteOverlay> overlay_;
+};
+} // namespace
+
+TEST_F(SqliteOverlayTest, compacts_after_enough_removals) {
+  constexpr auto kThreshold = SqliteOverlay::kCompactionRemovalThreshold;
+  auto numbers = saveDirs(100, kThreshold + 100);
+  overlay_->compact();
+  auto fullSize = fileSize("");
+
+  // Removing fewer records than the threshold does not compact.
+  overlay_->removeOverlayData(
+      std::vector<InodeNumber>(numbers.begin(), numbers.begin() + 100));
+  overlay_->removeOverlayData(numbers[100]);
+  EXPECT_FALSE(overlay_->compactIfNeeded());
+
+  overlay_->removeOverlayData(
+      std::vector<InodeNumber>(numbers.begin() + 101, numbers.end()));
+  EXPECT_TRUE(overlay_->compactIfNeeded());
+  EXPECT_FALSE(overlay_->hasOverlayData(numbers.back()));
+
+  // The free pages went back to the filesystem and the write-ahead log was
+  // emptied.
+  EXPECT_LT(fileSize(""), fullSize);
+  EXPECT_EQ(0, fileSize("-wal"));
+
+  // The count starts over after compacting.
+  EXPECT_FALSE(overlay_->compactIfNeeded());
+}
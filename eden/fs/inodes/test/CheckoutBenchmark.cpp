@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <folly/init/Init.h>
+#include <folly/stop_watch.h>
+#include <gflags/gflags.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <optional>
+#include <random>
+#include <thread>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/fuse/FuseChannel.h"
+#include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/testharness/FakeBackingStore.h"
+#include "eden/fs/testharness/FakeFuse.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+DEFINE_uint64(fanout, 10, "Subdirectories in each directory above --depth");
+DEFINE_uint64(depth, 3, "How many levels of subdirectories the tree has");
+DEFINE_uint64(files_per_dir, 10, "Files in each directory");
+DEFINE_double(
+    change_ratio,
+    0.1,
+    "The fraction of files whose contents differ between the two commits");
+DEFINE_double(
+    materialize_ratio,
+    0.1,
+    "The fraction of unchanged files modified locally before checking out "
+    "in the materialized case");
+DEFINE_uint64(
+    latency_us,
+    0,
+    "Delay every tree and blob fetched from the FakeBackingStore by this many "
+    "microseconds");
+DEFINE_bool(
+    fuse,
+    true,
+    "Attach a fake FUSE channel so that kernel cache invalidations are sent "
+    "and counted");
+DEFINE_uint64(seed, 1, "The seed used to choose which files change");
+
+namespace {
+
+enum class InodeState { Unloaded, Loaded, Materialized };
+
+folly::StringPiece getInodeStateName(InodeState state) {
+  switch (state) {
+    case InodeState::Unloaded:
+      return "unloaded";
+    case InodeState::Loaded:
+      return "loaded";
+    case InodeState::Materialized:
+      return "materialized";
+  }
+  return "unknown";
+}
+
+struct SyntheticTrees {
+  FakeTreeBuilder from;
+  FakeTreeBuilder to;
+  std::vector<std::string> unchangedFiles;
+  size_t changedFiles{0};
+};
+
+void addDirectory(
+    SyntheticTrees& trees,
+    std::mt19937& rng,
+    const std::string& dir,
+    uint64_t depth) {
+  for (uint64_t i = 0; i < FLAGS_files_per_dir; ++i) {
+    auto path = folly::to<std::string>(dir, dir.empty() ? "" : "/", "file", i);
+    auto contents = folly::to<std::string>("contents of ", path, "\n");
+    trees.from.setFile(path, contents);
+    if (std::uniform_real_distribution<>{}(rng) < FLAGS_change_ratio) {
+      trees.to.setFile(path, folly::to<std::string>("new ", contents));
+      ++trees.changedFiles;
+    } else {
+      trees.to.setFile(path, contents);
+      trees.unchangedFiles.push_back(std::move(path));
+    }
+  }
+  if (depth == FLAGS_depth) {
+    return;
+  }
+  for (uint64_t i = 0; i < FLAGS_fanout; ++i) {
+    addDirectory(
+        trees,
+        rng,
+        folly::to<std::string>(dir, dir.empty() ? "" : "/", "dir", i),
+        depth + 1);
+  }
+}
+
+SyntheticTrees makeTrees() {
+  SyntheticTrees trees;
+  std::mt19937 rng{static_cast<std::mt19937::result_type>(FLAGS_seed)};
+  addDirectory(trees, rng, "", 0);
+  return trees;
+}
+
+/**
+ * Reads and counts the invalidation notifications EdenFS sends to a
+ * FakeFuse.  Requests are never sent to it, so every message it receives
+ * is a notification.
+ */
+class InvalidationCounter {
+ public:
+  explicit InvalidationCounter(std::shared_ptr<FakeFuse> fuse)
+      : fuse_{std::move(fuse)}, thread_{[this] { run(); }} {}
+
+  ~InvalidationCounter() {
+    stop_ = true;
+    thread_.join();
+  }
+
+  uint64_t getCount() const {
+    return count_.load();
+  }
+
+ private:
+  void run() {
+    fuse_->setTimeout(100ms);
+    while (!stop_) {
+      try {
+        auto response = fuse_->recvResponse();
+        if (response.header.unique == 0) {
+          ++count_;
+        }
+      } catch (const std::exception&) {
+        // Timed out waiting for a notification; check whether to stop.
+      }
+    }
+  }
+
+  std::shared_ptr<FakeFuse> fuse_;
+  std::atomic<bool> stop_{false};
+  std::atomic<uint64_t> count_{0};
+  std::thread thread_;
+};
+
+uint64_t getPeakRssKB() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  // Linux reports ru_maxrss in kilobytes.
+  return usage.ru_maxrss;
+}
+
+void benchmarkCheckout(
+    const SyntheticTrees& trees,
+    InodeState state,
+    BenchmarkReport& report) {
+  auto from = trees.from.clone();
+  TestMount mount{from};
+  auto backingStore = mount.getBackingStore();
+
+  auto to = trees.to.clone();
+  auto toCommit = mount.nextCommitHash();
+  backingStore->putCommit(toCommit, to.finalize(backingStore, true))
+      ->setReady();
+
+  std::shared_ptr<FakeFuse> fuse;
+  std::optional<InvalidationCounter> invalidations;
+  if (FLAGS_fuse) {
+    fuse = std::make_shared<FakeFuse>();
+    mount.startFuseAndWait(fuse);
+    invalidations.emplace(fuse);
+  }
+
+  if (state != InodeState::Unloaded) {
+    mount.loadAllInodes();
+  }
+  if (state == InodeState::Materialized) {
+    std::mt19937 rng{static_cast<std::mt19937::result_type>(FLAGS_seed)};
+    for (const auto& path : trees.unchangedFiles) {
+      if (std::uniform_real_distribution<>{}(rng) < FLAGS_materialize_ratio) {
+        mount.overwriteFile(path, "locally modified\n");
+      }
+    }
+  }
+  backingStore->setLatency(std::chrono::microseconds{FLAGS_latency_us});
+
+  // Only count the invalidations sent by the checkout itself.
+  if (auto* channel = mount.getEdenMount()->getFuseChannel()) {
+    channel->flushInvalidations().get();
+  }
+  /* sleep override */ std::this_thread::sleep_for(200ms);
+  auto invalidationsBefore = invalidations ? invalidations->getCount() : 0;
+
+  auto name = getInodeStateName(state);
+  folly::stop_watch<std::chrono::microseconds> timer;
+  auto result = mount.getEdenMount()
+                    ->checkout(toCommit)
+                    .waitVia(mount.getServerExecutor().get())
+                    .get();
+  if (auto* channel = mount.getEdenMount()->getFuseChannel()) {
+    channel->flushInvalidations().get();
+  }
+  report.metric(folly::to<std::string>(name, " checkout"), "us")
+      .add(timer.elapsed().count());
+
+  if (invalidations) {
+    // Give the counter a moment to read the last flushed notifications.
+    /* sleep override */ std::this_thread::sleep_for(200ms);
+    report.metric(folly::to<std::string>(name, " invalidations"), "count")
+        .add(invalidations->getCount() - invalidationsBefore);
+  }
+  report.metric(folly::to<std::string>(name, " conflicts"), "count")
+      .add(result.conflicts.size());
+  report.metric("peak rss", "KB").add(getPeakRssKB());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv);
+
+  auto trees = makeTrees();
+  printf(
+      "Checking out %zu changed and %zu unchanged files\n",
+      trees.changedFiles,
+      trees.unchangedFiles.size());
+
+  return runBenchmark("checkout", [&](BenchmarkReport& report) {
+    for (auto state :
+         {InodeState::Unloaded, InodeState::Loaded, InodeState::Materialized}) {
+      benchmarkCheckout(trees, state, report);
+    }
+  });
+}
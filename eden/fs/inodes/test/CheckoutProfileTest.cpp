@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/CheckoutProfile.h"
+
+#include <folly/experimental/TestUtil.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+namespace {
+struct CheckoutProfileTest : public ::testing::Test {
+  CheckoutProfileTest()
+      : tmpDir{"eden_checkout_profile_"},
+        profilePath{
+            realpath(tmpDir.path().string()) + "checkout-profile"_pc} {}
+
+  folly::test::TemporaryDirectory tmpDir;
+  AbsolutePath profilePath;
+};
+} // namespace
+
+TEST_F(CheckoutProfileTest, records_only_after_checkout) {
+  CheckoutProfile profile{profilePath, nullptr};
+  EXPECT_FALSE(profile.isRecording());
+  profile.recordLoad(RelativePathPiece{"ignored"}, 1);
+
+  EXPECT_TRUE(profile.startRecording(1h, 10).empty());
+  EXPECT_TRUE(profile.isRecording());
+  profile.recordLoad(RelativePathPiece{"dir/file"}, 1);
+
+  auto paths = profile.startRecording(1h, 10);
+  ASSERT_EQ(1, paths.size());
+  EXPECT_EQ(RelativePathPiece{"dir/file"}, paths[0]);
+}
+
+TEST_F(CheckoutProfileTest, persists_most_recent_paths) {
+  {
+    CheckoutProfile profile{profilePath, nullptr};
+    profile.startRecording(1h, 2);
+    profile.recordLoad(RelativePathPiece{"a"}, 1);
+    profile.recordLoad(RelativePathPiece{"b"}, 1);
+    profile.startRecording(1h, 2);
+    profile.recordLoad(RelativePathPiece{"c"}, 1);
+    profile.recordLoad(RelativePathPiece{"a"}, 1);
+    profile.save();
+  }
+
+  CheckoutProfile profile{profilePath, nullptr};
+  auto paths = profile.startRecording(1h, 2);
+  ASSERT_EQ(2, paths.size());
+  EXPECT_EQ(RelativePathPiece{"c"}, paths[0]);
+  EXPECT_EQ(RelativePathPiece{"a"}, paths[1]);
+}
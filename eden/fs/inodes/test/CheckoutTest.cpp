@@ -886,6 +886,43 @@ TEST(Checkout, removeSubdirectorySimple) {
   }
 }
 
+TEST(Checkout, parallelCheckoutOfManySubtrees) {
+  constexpr size_t kNumDirs = 16;
+  auto srcBuilder = FakeTreeBuilder();
+  auto destBuilder = FakeTreeBuilder();
+  for (size_t i = 0; i < kNumDirs; ++i) {
+    auto dir = folly::to<string>("dir", i);
+    srcBuilder.setFile(dir + "/same.txt", "unchanged\n");
+    srcBuilder.setFile(dir + "/sub/file.txt", "old contents\n");
+    srcBuilder.setFile(dir + "/removed.txt", "removed\n");
+    destBuilder.setFile(dir + "/same.txt", "unchanged\n");
+    destBuilder.setFile(dir + "/sub/file.txt", folly::to<string>(i, "\n"));
+    destBuilder.setFile(dir + "/added/new.txt", "new\n");
+  }
+
+  TestMount testMount{srcBuilder};
+  testMount.updateEdenConfig({{"checkout:parallelism", "4"}});
+  ASSERT_TRUE(testMount.getServerState()->getCheckoutThreadPool());
+
+  destBuilder.finalize(testMount.getBackingStore(), true);
+  testMount.getBackingStore()->putCommit("2", destBuilder)->setReady();
+
+  auto executor = testMount.getServerExecutor().get();
+  auto checkoutResult =
+      testMount.getEdenMount()->checkout(makeTestHash("2")).waitVia(executor);
+  ASSERT_TRUE(checkoutResult.isReady());
+  EXPECT_EQ(0, std::move(checkoutResult).get().conflicts.size());
+
+  for (size_t i = 0; i < kNumDirs; ++i) {
+    auto dir = folly::to<string>("dir", i);
+    EXPECT_EQ("unchanged\n", testMount.readFile(dir + "/same.txt"));
+    EXPECT_EQ(
+        folly::to<string>(i, "\n"), testMount.readFile(dir + "/sub/file.txt"));
+    EXPECT_EQ("new\n", testMount.readFile(dir + "/added/new.txt"));
+    EXPECT_FALSE(testMount.hasFileAt(dir + "/removed.txt"));
+  }
+}
+
 TEST(Checkout, checkoutModifiesDirectoryDuringLoad) {
   auto builder1 = FakeTreeBuilder{};
   builder1.setFile("dir/sub/file.txt", "contents");
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <folly/init/Init.h>
+#include <folly/stop_watch.h>
+#include <gflags/gflags.h>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+#include "eden/fs/benchharness/AllocationCounter.h"
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+
+using namespace facebook::eden;
+
+DEFINE_uint64(fanout, 10, "Subdirectories in each directory above --depth");
+DEFINE_uint64(depth, 3, "How many levels of subdirectories the tree has");
+DEFINE_uint64(files_per_dir, 10, "Committed files in each directory");
+DEFINE_uint64(materialized, 100, "Committed files locally modified");
+DEFINE_uint64(ignored, 100, "Untracked files matched by the .gitignore");
+DEFINE_uint64(
+    gitignore_patterns,
+    1000,
+    "Patterns in the top-level .gitignore, in addition to the one that "
+    "matches the ignored files");
+DEFINE_bool(list_ignored, false, "Report ignored files in the status");
+
+namespace {
+
+struct SyntheticTree {
+  FakeTreeBuilder builder;
+  std::vector<std::string> directories;
+  std::vector<std::string> files;
+};
+
+void addDirectory(SyntheticTree& tree, const std::string& dir, uint64_t depth) {
+  auto prefix = dir.empty() ? std::string{} : dir + "/";
+  tree.directories.push_back(dir);
+  for (uint64_t i = 0; i < FLAGS_files_per_dir; ++i) {
+    auto path = folly::to<std::string>(prefix, "file", i, ".txt");
+    tree.builder.setFile(path, folly::to<std::string>("contents of ", path));
+    tree.files.push_back(std::move(path));
+  }
+  if (depth == FLAGS_depth) {
+    return;
+  }
+  for (uint64_t i = 0; i < FLAGS_fanout; ++i) {
+    addDirectory(tree, folly::to<std::string>(prefix, "dir", i), depth + 1);
+  }
+}
+
+SyntheticTree makeTree() {
+  SyntheticTree tree;
+  addDirectory(tree, "", 0);
+
+  std::string gitignore;
+  for (uint64_t i = 0; i < FLAGS_gitignore_patterns; ++i) {
+    folly::toAppend("generated", i, "/*.tmp\n", &gitignore);
+  }
+  gitignore += "*.ignored\n";
+  tree.builder.setFile(".gitignore", gitignore);
+  return tree;
+}
+
+/**
+ * Picks count evenly spread entries from items, so that the local changes
+ * touch as many directories as they can.
+ */
+template <typename Fn>
+void forEachSpread(
+    const std::vector<std::string>& items,
+    uint64_t count,
+    Fn&& fn) {
+  if (items.empty()) {
+    return;
+  }
+  for (uint64_t i = 0; i < count; ++i) {
+    fn(items[i * items.size() / count], i);
+  }
+}
+
+void benchmarkDiff(
+    const SyntheticTree& tree,
+    bool loaded,
+    BenchmarkReport& report) {
+  auto builder = tree.builder.clone();
+  TestMount mount{builder};
+
+  forEachSpread(tree.files, FLAGS_materialized, [&](const auto& path, auto) {
+    mount.overwriteFile(path, "locally modified\n");
+  });
+  forEachSpread(tree.directories, FLAGS_ignored, [&](const auto& dir, auto i) {
+    mount.addFile(
+        folly::to<std::string>(dir, dir.empty() ? "" : "/", i, ".ignored"),
+        "ignored\n");
+  });
+
+  auto rootInode = mount.getEdenMount()->getRootInode();
+  if (loaded) {
+    mount.loadAllInodes();
+  } else {
+    rootInode->unloadChildrenNow();
+  }
+
+  auto edenMount = mount.getEdenMount();
+  auto commitHash = edenMount->getParentCommits().parent1();
+  auto name = loaded ? "loaded" : "unloaded";
+
+  // The diff runs on this thread's server executor, so the scope sees all of
+  // its allocations.
+  AllocationAccumulator allocations;
+  folly::stop_watch<std::chrono::microseconds> timer;
+  std::unique_ptr<ScmStatus> status;
+  {
+    AllocationScope scope{allocations};
+    status = edenMount
+                 ->diff(
+                     commitHash,
+                     FLAGS_list_ignored,
+                     /*enforceCurrentParent=*/false)
+                 .waitVia(mount.getServerExecutor().get())
+                 .get();
+  }
+  auto elapsed = timer.elapsed();
+
+  report.metric(folly::to<std::string>(name, " diff"), "us")
+      .add(elapsed.count());
+  allocations.addTo(report, folly::to<std::string>(name, " diff"));
+  report.metric(folly::to<std::string>(name, " entries"), "count")
+      .add(status->entries.size());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv);
+
+  auto tree = makeTree();
+  printf(
+      "Diffing %zu committed files in %zu directories, %" PRIu64
+      " materialized and %" PRIu64 " ignored\n",
+      tree.files.size(),
+      tree.directories.size(),
+      FLAGS_materialized,
+      FLAGS_ignored);
+
+  return runBenchmark("diff", [&](BenchmarkReport& report) {
+    benchmarkDiff(tree, /*loaded=*/false, report);
+    benchmarkDiff(tree, /*loaded=*/true, report);
+  });
+}
@@ -1895,3 +1895,89 @@ TEST_F(DiffTestNonMateralized, diff_removed_tree_low_level_not_materialized) {
           std::make_pair("root/doc/c.txt", ScmFileStatus::MODIFIED),
           std::make_pair("root/doc/d.txt", ScmFileStatus::MODIFIED)));
 }
+
+TEST(DiffTest, statusCacheFollowsJournal) {
+  DiffTest test;
+  test.getMount().updateEdenConfig({{"status:cache", "true"}});
+  auto& mount = test.getMount();
+
+  // Every cached answer must match what a full diff reports.
+  auto cachedStatus = [&test] {
+    auto df = test.diffFuture();
+    auto result = EXPECT_FUTURE_RESULT(df);
+    EXPECT_THAT(
+        result.entries, UnorderedElementsAreArray(test.diff().entries));
+    return result.entries;
+  };
+
+  EXPECT_THAT(cachedStatus(), UnorderedElementsAre());
+  EXPECT_THAT(cachedStatus(), UnorderedElementsAre());
+
+  // Plain file modifications are re-checked one path at a time.
+  mount.overwriteFile("src/1.txt", "This file has been updated.\n");
+  EXPECT_THAT(
+      cachedStatus(),
+      UnorderedElementsAre(
+          std::make_pair("src/1.txt", ScmFileStatus::MODIFIED)));
+  mount.overwriteFile("src/1.txt", "This is src/1.txt.\n");
+  EXPECT_THAT(cachedStatus(), UnorderedElementsAre());
+
+  mount.deleteFile("src/2.txt");
+  mount.addFile("src/new.txt", "new\n");
+  EXPECT_THAT(
+      cachedStatus(),
+      UnorderedElementsAre(
+          std::make_pair("src/2.txt", ScmFileStatus::REMOVED),
+          std::make_pair("src/new.txt", ScmFileStatus::ADDED)));
+  mount.overwriteFile("src/new.txt", "newer\n");
+  EXPECT_THAT(
+      cachedStatus(),
+      UnorderedElementsAre(
+          std::make_pair("src/2.txt", ScmFileStatus::REMOVED),
+          std::make_pair("src/new.txt", ScmFileStatus::ADDED)));
+
+  // New directories and ignore file changes fall back to a full diff.
+  mount.mkdir("src/newdir");
+  mount.addFile("src/newdir/x.txt", "x\n");
+  mount.addFile("build.log", "log\n");
+  mount.addFile(".gitignore", "*.log\n");
+  EXPECT_THAT(
+      cachedStatus(),
+      UnorderedElementsAre(
+          std::make_pair("src/2.txt", ScmFileStatus::REMOVED),
+          std::make_pair("src/new.txt", ScmFileStatus::ADDED),
+          std::make_pair("src/newdir/x.txt", ScmFileStatus::ADDED),
+          std::make_pair(".gitignore", ScmFileStatus::ADDED)));
+  mount.overwriteFile(".gitignore", "");
+  EXPECT_THAT(
+      cachedStatus(),
+      UnorderedElementsAre(
+          std::make_pair("src/2.txt", ScmFileStatus::REMOVED),
+          std::make_pair("src/new.txt", ScmFileStatus::ADDED),
+          std::make_pair("src/newdir/x.txt", ScmFileStatus::ADDED),
+          std::make_pair("build.log", ScmFileStatus::ADDED),
+          std::make_pair(".gitignore", ScmFileStatus::ADDED)));
+}
+
+TEST(DiffTest, subtreesDiffedOnThreadPool) {
+  DiffTest test;
+  auto& mount = test.getMount();
+  mount.overwriteFile("src/1.txt", "This file has been updated.\n");
+  mount.addFile("src/a/b/new.txt", "new\n");
+  mount.deleteFile("doc/readme.txt");
+  mount.updateEdenConfig({{"status:diff-fan-out", "4"}});
+
+  // With a fan-out configured, subtree diffs are queued on the server
+  // executor, so the diff only completes once that executor runs.
+  auto executor = mount.getServerExecutor().get();
+  auto future = test.diffFuture();
+  EXPECT_FALSE(future.isReady());
+  auto result = std::move(future).waitVia(executor);
+  ASSERT_TRUE(result.isReady());
+  EXPECT_THAT(
+      std::move(result).get().entries,
+      UnorderedElementsAre(
+          std::make_pair("src/1.txt", ScmFileStatus::MODIFIED),
+          std::make_pair("src/a/b/new.txt", ScmFileStatus::ADDED),
+          std::make_pair("doc/readme.txt", ScmFileStatus::REMOVED)));
+}
@@ -7,9 +7,13 @@
 
 #include "eden/fs/inodes/EdenDispatcher.h"
 
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
 #include <folly/experimental/TestUtil.h>
 #include <folly/test/TestUtils.h>
 #include <gtest/gtest.h>
+#include "eden/fs/config/CheckoutConfig.h"
+#include "eden/fs/inodes/overlay/FsOverlay.h"
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/testharness/FakeTreeBuilder.h"
 #include "eden/fs/testharness/StoredObject.h"
@@ -122,3 +126,30 @@ TEST(RawEdenDispatcherTest, lookup_returns_valid_inode_for_bad_file) {
   EXPECT_NE(0, entry.attr.ino);
   EXPECT_EQ(entry.nodeid, entry.attr.ino);
 }
+
+TEST(RawEdenDispatcherTest, inline_replies_fall_back_for_corrupt_overlay_file) {
+  FakeTreeBuilder builder;
+  builder.setFile("corrupt", "contents");
+  TestMount mount{builder};
+  mount.overwriteFile("corrupt", "new contents");
+  auto ino = mount.getInode("corrupt"_relpath)->getNodeId();
+
+  mount.remount();
+  folly::checkUnixError(folly::truncateNoInt(
+      (mount.getConfig()->getOverlayPath() +
+       RelativePathPiece{FsOverlay::getFilePath(ino)})
+          .c_str(),
+      0));
+  // Load the inode without stat()ing it, so that the overlay file is only
+  // read by the dispatcher.
+  mount.getInode("corrupt"_relpath);
+
+  auto* dispatcher = mount.getDispatcher();
+  EXPECT_FALSE(dispatcher->getattrIfReady(ino).has_value());
+  EXPECT_FALSE(
+      dispatcher->lookupIfReady(kRootNodeId, "corrupt"_pc).has_value());
+
+  // The asynchronous lookup still returns the inode so it can be unlinked.
+  auto entry = dispatcher->lookup(kRootNodeId, "corrupt"_pc).get(0ms);
+  EXPECT_EQ(ino.get(), entry.nodeid);
+}
@@ -10,16 +10,29 @@
 #include <folly/Format.h>
 #include <folly/Range.h>
 #include <folly/test/TestUtils.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <chrono>
 
+#include "eden/fs/inodes/Overlay.h"
+#include "eden/fs/inodes/OverlayFileAccess.h"
 #include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/inodes/overlay/FsOverlay.h"
 #include "eden/fs/testharness/FakeBackingStore.h"
 #include "eden/fs/testharness/FakeTreeBuilder.h"
 #include "eden/fs/testharness/TestChecks.h"
 #include "eden/fs/testharness/TestMount.h"
 #include "eden/fs/utils/StatTimes.h"
 
+namespace facebook {
+namespace eden {
+DECLARE_bool(overlayPersistSha1);
+DECLARE_uint64(overlayFileCacheSize);
+DECLARE_uint64(overlayFileCacheMaxSize);
+DECLARE_uint64(overlayMmapCacheBytes);
+} // namespace eden
+} // namespace facebook
+
 using namespace facebook::eden;
 using folly::StringPiece;
 using folly::literals::string_piece_literals::operator""_sp;
@@ -530,6 +543,23 @@ TEST(FileInode, dropsCacheWhenFullyRead) {
   EXPECT_FALSE(blobCache->contains(hash));
 }
 
+TEST(FileInode, readOfReadyBlobCompletesInline) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"bigfile.txt", "1234567890ab"}});
+  TestMount mount{builder};
+  auto blobCache = mount.getBlobCache();
+
+  auto inode = mount.getFileInode("bigfile.txt");
+  auto hash = inode->getBlobHash().value();
+
+  auto future = inode->read(4, 0);
+  ASSERT_TRUE(future.isReady());
+  EXPECT_EQ("1234", std::move(future).get().copyData());
+  // The interest handle from the fast path keeps the blob cached.
+  EXPECT_TRUE(blobCache->contains(hash));
+  EXPECT_EQ("5678", inode->read(4, 4).get(0ms).copyData());
+}
+
 TEST(FileInode, keepsCacheIfPartiallyReread) {
   FakeTreeBuilder builder;
   builder.setFiles({{"bigfile.txt", "1234567890ab"}});
@@ -555,6 +585,68 @@ TEST(FileInode, keepsCacheIfPartiallyReread) {
   EXPECT_FALSE(blobCache->contains(hash));
 }
 
+TEST(FileInode, sequentialReadPrefetchesFollowingFiles) {
+  FakeTreeBuilder builder;
+  builder.setFiles({
+      {"dir/a.h", "aaaa"},
+      {"dir/b.h", "bbbb"},
+      {"dir/c.h", "cccc"},
+      {"dir/d.h", "dddd"},
+  });
+  TestMount mount{builder};
+  mount.updateEdenConfig({{"store:sibling-blob-readahead", "2"}});
+  auto blobCache = mount.getBlobCache();
+
+  auto getHash = [&](folly::StringPiece path) {
+    return mount.getFileInode(path)->getBlobHash().value();
+  };
+  auto a = getHash("dir/a.h");
+  auto b = getHash("dir/b.h");
+  auto c = getHash("dir/c.h");
+  auto d = getHash("dir/d.h");
+
+  mount.getFileInode("dir/a.h")->read(4096, 0).get(0ms);
+  mount.drainServerExecutor();
+
+  EXPECT_FALSE(blobCache->contains(a));
+  EXPECT_TRUE(blobCache->contains(b));
+  EXPECT_TRUE(blobCache->contains(c));
+  EXPECT_FALSE(blobCache->contains(d));
+}
+
+TEST(FileInode, noReadaheadByDefault) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"dir/a.h", "aaaa"}, {"dir/b.h", "bbbb"}});
+  TestMount mount{builder};
+  auto blobCache = mount.getBlobCache();
+
+  auto b = mount.getFileInode("dir/b.h")->getBlobHash().value();
+  mount.getFileInode("dir/a.h")->read(4096, 0).get(0ms);
+  mount.drainServerExecutor();
+
+  EXPECT_FALSE(blobCache->contains(b));
+}
+
+TEST(FileInode, staysCompactUntilContentsAreRead) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"bigfile.txt", "1234567890ab"}});
+  TestMount mount{builder};
+
+  auto inode = mount.getFileInode("bigfile.txt");
+  inode->stat().get(0ms);
+  EXPECT_TRUE(inode->isCompact());
+
+  inode->read(4, 0).get(0ms);
+  EXPECT_FALSE(inode->isCompact());
+
+  // Once the whole blob has been read there is nothing left to track.
+  inode->read(8, 4).get(0ms);
+  EXPECT_TRUE(inode->isCompact());
+
+  inode->write("data"_sp, 0).get(0ms);
+  EXPECT_FALSE(inode->isCompact());
+}
+
 TEST(FileInode, dropsCacheWhenMaterialized) {
   FakeTreeBuilder builder;
   builder.setFiles({{"bigfile.txt", "1234567890ab"}});
@@ -608,6 +700,158 @@ TEST(FileInode, reloadsBlobIfCacheIsEvicted) {
       << "reading should insert hash " << hash << " into cache";
 }
 
+TEST(FileInode, persistedSha1OutlivesOverlayFileAccess) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_overlayPersistSha1 = true;
+
+  FakeTreeBuilder builder;
+  builder.setFiles({{"file.txt", "abc"}});
+  TestMount mount{builder};
+  auto* overlay = mount.getEdenMount()->getOverlay();
+
+  auto inode = mount.getFileInode("file.txt");
+  inode->write("xyz"_sp, 0).get(0ms);
+  auto ino = inode->getNodeId();
+  EXPECT_EQ(
+      Hash::sha1(folly::ByteRange{"xyz"_sp}),
+      inode->getSha1(ObjectFetchContext::getNullContext()).get(0ms));
+
+  // Change the contents behind EdenFS's back, keeping the size.  A fresh
+  // OverlayFileAccess still trusts the SHA-1 persisted in the header.
+  char data[] = "123";
+  struct iovec iov;
+  iov.iov_base = data;
+  iov.iov_len = 3;
+  overlay->openFileNoVerify(ino)
+      .pwritev(&iov, 1, FsOverlay::kHeaderLength)
+      .value();
+  EXPECT_EQ(
+      Hash::sha1(folly::ByteRange{"xyz"_sp}),
+      OverlayFileAccess{overlay}.getSha1(*inode));
+
+  // Writes through EdenFS clear the persisted SHA-1.
+  inode->write("uvw"_sp, 0).get(0ms);
+  EXPECT_EQ(
+      Hash::sha1(folly::ByteRange{"uvw"_sp}),
+      OverlayFileAccess{overlay}.getSha1(*inode));
+}
+
+TEST(FileInode, mappedReadsSeeWritesAndTruncates) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_overlayMmapCacheBytes = 1024 * 1024;
+
+  FakeTreeBuilder builder;
+  builder.setFiles({{"file.txt", "abc"}});
+  TestMount mount{builder};
+  auto inode = mount.getFileInode("file.txt");
+  inode->write("hello world"_sp, 0).get(0ms);
+
+  OverlayFileAccess access{mount.getEdenMount()->getOverlay()};
+  EXPECT_EQ("hello world", access.read(*inode, 4096, 0, false).copyData());
+  EXPECT_EQ("world", access.read(*inode, 4096, 6, false).copyData());
+  EXPECT_EQ("", access.read(*inode, 4096, 100, false).copyData());
+  EXPECT_EQ(11 + FsOverlay::kHeaderLength, access.getMappedBytes());
+
+  char data[] = "HELLO";
+  struct iovec iov;
+  iov.iov_base = data;
+  iov.iov_len = 5;
+  access.write(*inode, &iov, 1, 0);
+  EXPECT_EQ("HELLO world", access.read(*inode, 4096, 0, false).copyData());
+
+  access.truncate(*inode, 5);
+  EXPECT_EQ("HELLO", access.read(*inode, 4096, 0, false).copyData());
+  EXPECT_EQ("", access.read(*inode, 4096, 5, false).copyData());
+}
+
+TEST(FileInode, mappedBytesStayWithinBudget) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_overlayMmapCacheBytes = 2 * (FsOverlay::kHeaderLength + 100);
+
+  FakeTreeBuilder builder;
+  builder.setFiles({{"a", "a"}, {"b", "b"}, {"c", "c"}});
+  TestMount mount{builder};
+  OverlayFileAccess access{mount.getEdenMount()->getOverlay()};
+
+  std::string contents(100, 'x');
+  for (auto name : {"a", "b", "c"}) {
+    auto inode = mount.getFileInode(name);
+    inode->write(contents, 0).get(0ms);
+    EXPECT_EQ(contents, access.read(*inode, 4096, 0, false).copyData());
+    EXPECT_LE(access.getMappedBytes(), FLAGS_overlayMmapCacheBytes);
+  }
+  EXPECT_EQ(FLAGS_overlayMmapCacheBytes, access.getMappedBytes());
+
+  // An evicted mapping is transparently recreated.
+  auto inode = mount.getFileInode("a");
+  EXPECT_EQ(contents, access.read(*inode, 4096, 0, false).copyData());
+}
+
+TEST(FileInode, clearingTheFileCacheReleasesMappingsAndHandles) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_overlayMmapCacheBytes = 1024 * 1024;
+  FLAGS_overlayFileCacheSize = 1;
+  FLAGS_overlayFileCacheMaxSize = 8;
+
+  FakeTreeBuilder builder;
+  builder.setFiles({{"a", "a"}, {"b", "b"}});
+  TestMount mount{builder};
+  auto a = mount.getFileInode("a");
+  auto b = mount.getFileInode("b");
+  a->write("hello"_sp, 0).get(0ms);
+  b->write("world"_sp, 0).get(0ms);
+
+  OverlayFileAccess access{mount.getEdenMount()->getOverlay()};
+  for (int round = 0; round < 10; ++round) {
+    EXPECT_EQ("hello", access.read(*a, 4096, 0, false).copyData());
+    EXPECT_EQ("world", access.read(*b, 4096, 0, false).copyData());
+  }
+  EXPECT_LT(0, access.getMappedBytes());
+  EXPECT_LT(1, access.getFileCacheCapacity());
+
+  access.clearCache();
+  EXPECT_EQ(0, access.getMappedBytes());
+  EXPECT_EQ(1, access.getFileCacheCapacity());
+
+  // Files are reopened on the next access.
+  EXPECT_EQ("hello", access.read(*a, 4096, 0, false).copyData());
+  EXPECT_EQ(5 + FsOverlay::kHeaderLength, access.getMappedBytes());
+}
+
+TEST(FileInode, fileCacheAdaptsToWorkingSet) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_overlayFileCacheSize = 2;
+  FLAGS_overlayFileCacheMaxSize = 8;
+
+  FakeTreeBuilder builder;
+  builder.setFiles({{"a", "a"}, {"b", "b"}, {"c", "c"}, {"d", "d"}});
+  TestMount mount{builder};
+  std::vector<FileInodePtr> inodes;
+  for (auto name : {"a", "b", "c", "d"}) {
+    inodes.push_back(mount.getFileInode(name));
+    inodes.back()->write("x"_sp, 0).get(0ms);
+  }
+
+  OverlayFileAccess access{mount.getEdenMount()->getOverlay()};
+  EXPECT_EQ(2, access.getFileCacheCapacity());
+
+  // Cycling through four files keeps reopening evicted ones.
+  for (int round = 0; round < 10; ++round) {
+    for (auto& inode : inodes) {
+      EXPECT_EQ(1, access.getFileSize(*inode));
+    }
+  }
+  auto grown = access.getFileCacheCapacity();
+  EXPECT_GE(grown, 4);
+  EXPECT_LE(grown, 8);
+
+  // Once only one file is used, the cache shrinks back.
+  for (int i = 0; i < 1000; ++i) {
+    access.getFileSize(*inodes[0]);
+  }
+  EXPECT_EQ(2, access.getFileCacheCapacity());
+}
+
 // TODO: test multiple flags together
 // TODO: ensure ctime is updated after every call to setattr()
 // TODO: ensure mtime is updated after opening a file, writing to it, then
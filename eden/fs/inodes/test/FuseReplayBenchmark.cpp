@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <dirent.h>
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/ScopeGuard.h>
+#include <folly/init/Init.h>
+#include <gflags/gflags.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/fuse/FuseChannel.h"
+#include "eden/fs/fuse/FuseRequestTrace.h"
+#include "eden/fs/testharness/FakeFuse.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+DEFINE_string(trace, "", "The FUSE request trace to replay");
+DEFINE_string(
+    source_dir,
+    "",
+    "A directory whose contents are copied into the test mount's commit "
+    "before replaying, usually a copy of the traced checkout.  The trace's "
+    "lookups only find what exists here.");
+DEFINE_bool(
+    original_timing,
+    false,
+    "Send each request at its traced time, rather than as fast as possible");
+DEFINE_uint64(max_outstanding, 256, "The most requests sent but unanswered");
+DEFINE_uint64(
+    response_timeout_ms,
+    10000,
+    "How long to wait for a response before giving up on the replay");
+
+namespace {
+
+void addSourceDirectory(
+    FakeTreeBuilder& builder,
+    const std::string& root,
+    const std::string& relative) {
+  auto path = relative.empty() ? root : root + "/" + relative;
+  DIR* dir = opendir(path.c_str());
+  if (!dir) {
+    folly::throwSystemError("unable to open directory ", path);
+  }
+  SCOPE_EXIT {
+    closedir(dir);
+  };
+  while (auto* entry = readdir(dir)) {
+    folly::StringPiece name{entry->d_name};
+    if (name == "." || name == ".." || (relative.empty() && name == ".hg")) {
+      continue;
+    }
+    auto childRelative = relative.empty()
+        ? name.str()
+        : folly::to<std::string>(relative, "/", name);
+    auto childPath = folly::to<std::string>(path, "/", name);
+    struct stat st;
+    folly::checkUnixError(lstat(childPath.c_str(), &st), "lstat ", childPath);
+    if (S_ISDIR(st.st_mode)) {
+      builder.mkdir(childRelative);
+      addSourceDirectory(builder, root, childRelative);
+    } else if (S_ISLNK(st.st_mode)) {
+      std::string target(PATH_MAX, '\0');
+      auto length = readlink(childPath.c_str(), target.data(), target.size());
+      folly::checkUnixError(length, "readlink ", childPath);
+      target.resize(length);
+      builder.setSymlink(childRelative, target);
+    } else if (S_ISREG(st.st_mode)) {
+      std::string contents;
+      if (!folly::readFile(childPath.c_str(), contents)) {
+        folly::throwSystemError("unable to read ", childPath);
+      }
+      builder.setFile(childRelative, contents, (st.st_mode & S_IXUSR) != 0);
+    }
+  }
+}
+
+bool hasNoReply(FuseOpcode opcode) {
+  return opcode == FUSE_FORGET || opcode == FUSE_BATCH_FORGET ||
+      opcode == FUSE_INTERRUPT;
+}
+
+/**
+ * Sends the requests in a trace to a TestMount over a FakeFuse, rewriting
+ * the traced inode numbers into the test mount's as lookups reply with them.
+ */
+class Replayer {
+ public:
+  Replayer(const std::vector<FuseTraceRecord>& records, FakeFuse& fuse)
+      : records_{records}, fuse_{fuse} {
+    inodes_[FUSE_ROOT_ID] = FUSE_ROOT_ID;
+  }
+
+  void run(BenchmarkReport& report) {
+    fuse_.setTimeout(100ms);
+    std::thread responseThread{[this] { readResponses(); }};
+    SCOPE_EXIT {
+      stop_ = true;
+      responseThread.join();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::optional<std::chrono::nanoseconds> firstTimestamp;
+    for (const auto& record : records_) {
+      if (FLAGS_original_timing) {
+        if (!firstTimestamp) {
+          firstTimestamp = record.timestamp;
+        }
+        /* sleep override */ std::this_thread::sleep_until(
+            start + (record.timestamp - *firstTimestamp));
+      }
+      if (record.type == FuseTraceRecordType::Request) {
+        sendRequest(record);
+      } else {
+        mapEntry(record.getEntry());
+      }
+    }
+    waitForResponses([](const Responses& responses) {
+      return responses.pending.empty();
+    });
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    std::lock_guard lock{mutex_};
+    for (const auto& [opcode, latency] : responses_.latencies) {
+      report.metric(fuseOpcodeName(opcode), "ns").combine(latency);
+    }
+    report.metric("replay", "ms")
+        .add(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed)
+                 .count());
+    report.metric("errors", "count").add(responses_.errors);
+    report.metric("skipped", "count").add(skipped_);
+  }
+
+ private:
+  struct Pending {
+    FuseOpcode opcode;
+    std::chrono::steady_clock::time_point sent;
+  };
+
+  struct Responses {
+    std::unordered_map<uint64_t, Pending> pending;
+    // The nodeid each answered entry request replied with, by replay unique.
+    std::unordered_map<uint64_t, uint64_t> entries;
+    std::unordered_map<FuseOpcode, HistogramAccumulator> latencies;
+    uint64_t errors{0};
+  };
+
+  std::optional<uint64_t> mapInode(uint64_t traced) const {
+    auto it = inodes_.find(traced);
+    if (it == inodes_.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  /**
+   * Rewrites the inode numbers inside a request's arguments.  Returns false
+   * if one of them has no replay equivalent.
+   */
+  bool rewriteArguments(FuseOpcode opcode, std::vector<uint8_t>& args) {
+    auto rewrite = [&](uint64_t& nodeid) {
+      auto mapped = mapInode(nodeid);
+      if (mapped) {
+        nodeid = *mapped;
+      }
+      return mapped.has_value();
+    };
+    switch (opcode) {
+      case FUSE_RENAME:
+        if (args.size() < sizeof(fuse_rename_in)) {
+          return false;
+        }
+        return rewrite(reinterpret_cast<fuse_rename_in*>(args.data())->newdir);
+#ifdef __linux__
+      case FUSE_RENAME2:
+        if (args.size() < sizeof(fuse_rename2_in)) {
+          return false;
+        }
+        return rewrite(reinterpret_cast<fuse_rename2_in*>(args.data())->newdir);
+#endif
+      case FUSE_LINK:
+        if (args.size() < sizeof(fuse_link_in)) {
+          return false;
+        }
+        return rewrite(
+            reinterpret_cast<fuse_link_in*>(args.data())->oldnodeid);
+      case FUSE_BATCH_FORGET: {
+        if (args.size() < sizeof(fuse_batch_forget_in)) {
+          return false;
+        }
+        auto* forgets = reinterpret_cast<fuse_batch_forget_in*>(args.data());
+        auto* items = reinterpret_cast<fuse_forget_one*>(forgets + 1);
+        auto available = (args.size() - sizeof(*forgets)) / sizeof(*items);
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < forgets->count && i < available; ++i) {
+          if (rewrite(items[i].nodeid)) {
+            items[kept++] = items[i];
+          }
+        }
+        forgets->count = kept;
+        args.resize(sizeof(*forgets) + kept * sizeof(*items));
+        return kept > 0;
+      }
+      default:
+        return true;
+    }
+  }
+
+  void sendRequest(const FuseTraceRecord& record) {
+    const auto& header = record.getRequestHeader();
+    auto opcode = header.opcode;
+    if (opcode == FUSE_INIT || opcode == FUSE_DESTROY ||
+        opcode == FUSE_INTERRUPT) {
+      return;
+    }
+    auto nodeid = mapInode(header.nodeid);
+    std::vector<uint8_t> args{
+        record.data.begin() + sizeof(fuse_in_header), record.data.end()};
+    if (!nodeid || !rewriteArguments(opcode, args)) {
+      ++skipped_;
+      return;
+    }
+    if (opcode == FUSE_WRITE && header.len > record.data.size()) {
+      // Traces drop the data of writes; send zeros of the same length.
+      args.resize(header.len - sizeof(fuse_in_header));
+    }
+
+    waitForResponses([](const Responses& responses) {
+      return responses.pending.size() < FLAGS_max_outstanding;
+    });
+    // Register the request before sending it, so the response thread cannot
+    // see the response first.  FakeFuse assigns unique IDs in order.
+    auto unique = nextUnique_++;
+    if (!hasNoReply(opcode)) {
+      std::lock_guard lock{mutex_};
+      responses_.pending.emplace(
+          unique, Pending{opcode, std::chrono::steady_clock::now()});
+    }
+    auto sent = fuse_.sendRequest(
+        opcode, *nodeid, folly::ByteRange{args.data(), args.size()});
+    CHECK_EQ(unique, sent);
+    replayUniques_[header.unique] = unique;
+  }
+
+  void mapEntry(const FuseTraceEntry& entry) {
+    auto it = replayUniques_.find(entry.unique);
+    if (it == replayUniques_.end()) {
+      return;
+    }
+    auto unique = it->second;
+    replayUniques_.erase(it);
+    waitForResponses([&](const Responses& responses) {
+      return responses.pending.count(unique) == 0;
+    });
+    std::lock_guard lock{mutex_};
+    auto replied = responses_.entries.find(unique);
+    if (replied != responses_.entries.end()) {
+      inodes_[entry.nodeid] = replied->second;
+      responses_.entries.erase(replied);
+    }
+  }
+
+  template <typename Predicate>
+  void waitForResponses(Predicate&& predicate) {
+    std::unique_lock lock{mutex_};
+    if (!responsesCV_.wait_for(
+            lock,
+            std::chrono::milliseconds{FLAGS_response_timeout_ms},
+            [&] { return predicate(responses_); })) {
+      throw std::runtime_error(folly::to<std::string>(
+          "timed out waiting for ",
+          responses_.pending.size(),
+          " FUSE responses"));
+    }
+  }
+
+  void readResponses() {
+    while (!stop_) {
+      FakeFuse::Response response;
+      try {
+        response = fuse_.recvResponse();
+      } catch (const std::exception&) {
+        // Timed out; check whether the replay has finished.
+        continue;
+      }
+      if (response.header.unique == 0) {
+        // An invalidation notification.
+        continue;
+      }
+      auto now = std::chrono::steady_clock::now();
+      {
+        std::lock_guard lock{mutex_};
+        auto it = responses_.pending.find(response.header.unique);
+        if (it == responses_.pending.end()) {
+          continue;
+        }
+        auto& pending = it->second;
+        responses_.latencies[pending.opcode].add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                now - pending.sent)
+                .count());
+        if (response.header.error != 0) {
+          ++responses_.errors;
+        } else if (response.body.size() >= sizeof(fuse_entry_out)) {
+          fuse_entry_out entry;
+          memcpy(&entry, response.body.data(), sizeof(entry));
+          responses_.entries[response.header.unique] = entry.nodeid;
+        }
+        responses_.pending.erase(it);
+      }
+      responsesCV_.notify_all();
+    }
+  }
+
+  const std::vector<FuseTraceRecord>& records_;
+  FakeFuse& fuse_;
+  // The first request after FUSE_INIT, which startFuseAndWait() sends.
+  uint64_t nextUnique_{1};
+  uint64_t skipped_{0};
+  // Traced inode number to replay inode number.
+  std::unordered_map<uint64_t, uint64_t> inodes_;
+  // Traced unique ID to replay unique ID, for requests that may still be
+  // followed by an entry record.
+  std::unordered_map<uint64_t, uint64_t> replayUniques_;
+  std::atomic<bool> stop_{false};
+  std::mutex mutex_;
+  Responses responses_;
+  std::condition_variable responsesCV_;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv);
+  if (FLAGS_trace.empty()) {
+    fprintf(stderr, "--trace is required\n");
+    return 1;
+  }
+
+  auto records = readFuseRequestTrace(realpath(FLAGS_trace));
+  printf("Replaying %zu trace records\n", records.size());
+
+  FakeTreeBuilder builder;
+  if (!FLAGS_source_dir.empty()) {
+    addSourceDirectory(builder, FLAGS_source_dir, "");
+  }
+
+  return runBenchmark("fuse_replay", [&](BenchmarkReport& report) {
+    auto commit = builder.clone();
+    TestMount mount{commit};
+    auto fuse = std::make_shared<FakeFuse>();
+    mount.startFuseAndWait(fuse);
+    Replayer{records, *fuse}.run(report);
+  });
+}
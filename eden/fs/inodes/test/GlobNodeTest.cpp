@@ -7,16 +7,19 @@
 
 #include "eden/fs/inodes/GlobNode.h"
 
+#include <algorithm>
 #include <utility>
 
 #include <folly/Conv.h>
 #include <folly/Exception.h>
 #include <folly/Range.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/experimental/TestUtil.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 #include <folly/test/TestUtils.h>
 
+#include "eden/fs/inodes/GlobCache.h"
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/testharness/FakeBackingStore.h"
 #include "eden/fs/testharness/FakeTreeBuilder.h"
@@ -258,6 +261,152 @@ TEST_P(GlobNodeTest, matchLiteralDirectoryAndDirectoryRecursiveChildren) {
   EXPECT_EQ(expect, matches);
 }
 
+TEST_P(GlobNodeTest, resultSinkReceivesEveryMatch) {
+  GlobNode globRoot(/*includeDotfiles=*/true);
+  globRoot.parse("**/*.txt");
+  globRoot.parse("dir/*");
+
+  auto sunk = std::make_shared<folly::Synchronized<std::vector<GlobResult>>>();
+  auto sink = std::make_shared<GlobNode::ResultSink::element_type>(
+      [sunk](std::vector<GlobResult>&& results) {
+        auto locked = sunk->wlock();
+        locked->insert(
+            locked->end(),
+            std::make_move_iterator(results.begin()),
+            std::make_move_iterator(results.end()));
+        return true;
+      });
+  auto future = globRoot.evaluate(
+      mount_.getEdenMount()->getObjectStore(),
+      ObjectFetchContext::getNullContext(),
+      RelativePathPiece(),
+      mount_.getTreeInode(RelativePathPiece()),
+      /*fileBlobsToPrefetch=*/nullptr,
+      sink);
+  if (!GetParam().first) {
+    builder_.setAllReady();
+  }
+  EXPECT_TRUE(std::move(future).get().empty());
+
+  auto matches = sunk->copy();
+  std::sort(matches.begin(), matches.end(), [](const auto& a, const auto& b) {
+    return a.name < b.name;
+  });
+  std::vector<GlobResult> expect{
+      GlobResult("dir/a.txt"_relpath, dtype_t::Regular),
+      GlobResult("dir/a.txt"_relpath, dtype_t::Regular),
+      GlobResult("dir/sub"_relpath, dtype_t::Dir),
+      GlobResult("dir/sub/b.txt"_relpath, dtype_t::Regular),
+  };
+  EXPECT_EQ(expect, matches);
+}
+
+TEST_P(GlobNodeTest, resultSinkCanStopTheWalk) {
+  GlobNode globRoot(/*includeDotfiles=*/true);
+  globRoot.parse("**");
+
+  auto sunk = std::make_shared<folly::Synchronized<std::vector<GlobResult>>>();
+  auto sink = std::make_shared<GlobNode::ResultSink::element_type>(
+      [sunk](std::vector<GlobResult>&& results) {
+        auto locked = sunk->wlock();
+        locked->insert(
+            locked->end(),
+            std::make_move_iterator(results.begin()),
+            std::make_move_iterator(results.end()));
+        return false;
+      });
+  auto future = globRoot.evaluate(
+      mount_.getEdenMount()->getObjectStore(),
+      ObjectFetchContext::getNullContext(),
+      RelativePathPiece(),
+      mount_.getTreeInode(RelativePathPiece()),
+      /*fileBlobsToPrefetch=*/nullptr,
+      sink);
+  if (!GetParam().first) {
+    builder_.setAllReady();
+  }
+  EXPECT_TRUE(std::move(future).get().empty());
+
+  // Nothing below the root is walked once the sink has returned false.
+  auto matches = sunk->copy();
+  std::sort(matches.begin(), matches.end(), [](const auto& a, const auto& b) {
+    return a.name < b.name;
+  });
+  std::vector<GlobResult> expect{
+      GlobResult(".watchmanconfig"_relpath, dtype_t::Regular),
+      GlobResult("dir"_relpath, dtype_t::Dir),
+  };
+  EXPECT_EQ(expect, matches);
+}
+
+TEST_P(GlobNodeTest, evaluatesSubtreesOnExecutor) {
+  GlobNode globRoot(/*includeDotfiles=*/true);
+  globRoot.parse("**/*.txt");
+  globRoot.parse("dir/sub/*");
+
+  folly::CPUThreadPoolExecutor executor{4};
+  auto future = globRoot.evaluate(
+      mount_.getEdenMount()->getObjectStore(),
+      ObjectFetchContext::getNullContext(),
+      RelativePathPiece(),
+      mount_.getTreeInode(RelativePathPiece()),
+      /*fileBlobsToPrefetch=*/nullptr,
+      /*resultSink=*/nullptr,
+      &executor);
+  if (!GetParam().first) {
+    builder_.setAllReady();
+  }
+  auto matches = std::move(future).get();
+  std::sort(matches.begin(), matches.end(), [](const auto& a, const auto& b) {
+    return a.name < b.name;
+  });
+  std::vector<GlobResult> expect{
+      GlobResult("dir/a.txt"_relpath, dtype_t::Regular),
+      GlobResult("dir/sub/b.txt"_relpath, dtype_t::Regular),
+      GlobResult("dir/sub/b.txt"_relpath, dtype_t::Regular),
+  };
+  EXPECT_EQ(expect, matches);
+}
+
+TEST_P(GlobNodeTest, reusesCachedMatchesForUnmodifiedTrees) {
+  auto cache = GlobCache::create(1024 * 1024, 16);
+  auto evaluateCached = [&] {
+    GlobNode globRoot(/*includeDotfiles=*/true);
+    globRoot.parse("**/*.txt");
+    auto future = globRoot.evaluate(
+        mount_.getEdenMount()->getObjectStore(),
+        ObjectFetchContext::getNullContext(),
+        RelativePathPiece(),
+        mount_.getTreeInode(RelativePathPiece()),
+        /*fileBlobsToPrefetch=*/nullptr,
+        /*resultSink=*/nullptr,
+        /*executor=*/nullptr,
+        cache.get());
+    builder_.setAllReady();
+    auto matches = std::move(future).get();
+    std::sort(
+        matches.begin(), matches.end(), [](const auto& a, const auto& b) {
+          return a.name < b.name;
+        });
+    return matches;
+  };
+
+  std::vector<GlobResult> expect{
+      GlobResult("dir/a.txt"_relpath, dtype_t::Regular),
+      GlobResult("dir/sub/b.txt"_relpath, dtype_t::Regular),
+  };
+  EXPECT_EQ(expect, evaluateCached());
+  EXPECT_EQ(0, cache->getStats().hitCount);
+  EXPECT_EQ(expect, evaluateCached());
+  EXPECT_LT(0, cache->getStats().hitCount);
+
+  // Local changes are never answered from the cache.
+  mount_.addFile("dir/c.txt", "c");
+  expect.insert(
+      expect.begin() + 1, GlobResult("dir/c.txt"_relpath, dtype_t::Regular));
+  EXPECT_EQ(expect, evaluateCached());
+}
+
 const std::pair<enum StartReady, enum Prefetch> combinations[] = {
     {StartReady::Start, Prefetch::NoPrefetch},
     {StartReady::Start, Prefetch::PrefetchBlobs},
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/init/Init.h>
+#include <folly/synchronization/test/Barrier.h>
+#include <gflags/gflags.h>
+#include <inttypes.h>
+#include <thread>
+#include <vector>
+#include "eden/fs/benchharness/AllocationCounter.h"
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/inodes/EdenDispatcher.h"
+#include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/inodes/InodeMap.h"
+#include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+
+using namespace facebook::eden;
+
+DEFINE_uint64(fanout, 10, "Subdirectories in each directory above --depth");
+DEFINE_uint64(depth, 3, "How many levels of subdirectories the tree has");
+DEFINE_uint64(files_per_dir, 10, "Files in each directory");
+DEFINE_string(
+    thread_counts,
+    "1,2,4,8,16,32,64",
+    "Comma-separated thread counts to run each operation with");
+DEFINE_uint64(ops, 100000, "Operations per thread for each measurement");
+
+namespace {
+
+struct Directory {
+  std::string path;
+  std::vector<PathComponent> children;
+};
+
+void addDirectory(
+    FakeTreeBuilder& builder,
+    std::vector<Directory>& directories,
+    const std::string& path,
+    uint64_t depth) {
+  auto prefix = path.empty() ? std::string{} : path + "/";
+  Directory directory{path, {}};
+  for (uint64_t i = 0; i < FLAGS_files_per_dir; ++i) {
+    auto name = folly::to<std::string>("file", i);
+    builder.setFile(prefix + name, name);
+    directory.children.emplace_back(name);
+  }
+  if (depth < FLAGS_depth) {
+    for (uint64_t i = 0; i < FLAGS_fanout; ++i) {
+      auto name = folly::to<std::string>("dir", i);
+      directory.children.emplace_back(name);
+    }
+  }
+  directories.push_back(std::move(directory));
+  if (depth == FLAGS_depth) {
+    return;
+  }
+  for (uint64_t i = 0; i < FLAGS_fanout; ++i) {
+    addDirectory(
+        builder,
+        directories,
+        folly::to<std::string>(prefix, "dir", i),
+        depth + 1);
+  }
+}
+
+/**
+ * A mount with every inode of a synthetic tree loaded.  The TreeInodes stay
+ * referenced for the life of the benchmark; the file inodes are only
+ * referenced while files is non-empty.
+ */
+struct LoadedTree {
+  LoadedTree() {
+    FakeTreeBuilder builder;
+    addDirectory(builder, directories, "", 0);
+    mount.initialize(builder);
+    mount.loadAllInodes();
+
+    for (const auto& directory : directories) {
+      auto tree = directory.path.empty()
+          ? mount.getEdenMount()->getRootInode()
+          : mount.getTreeInode(directory.path);
+      for (const auto& child : directory.children) {
+        auto inode = tree->getOrLoadChild(child).get();
+        if (inode->isDir()) {
+          continue;
+        }
+        fileNumbers.push_back(inode->getNodeId());
+        files.push_back(std::move(inode));
+      }
+      trees.push_back(std::move(tree));
+    }
+  }
+
+  InodeMap* getInodeMap() {
+    return mount.getEdenMount()->getInodeMap();
+  }
+
+  TestMount mount;
+  std::vector<Directory> directories;
+  std::vector<TreeInodePtr> trees;
+  std::vector<InodePtr> files;
+  std::vector<InodeNumber> fileNumbers;
+};
+
+/**
+ * Runs op FLAGS_ops times on each of threadCount threads, each call timed
+ * separately.  op is given a random index below count and returns the
+ * duration to record, so that it can leave setup work out of the timing.
+ */
+template <typename Op>
+void runThreads(
+    folly::StringPiece name,
+    uint64_t threadCount,
+    size_t count,
+    BenchmarkReport& report,
+    Op op) {
+  std::vector<HistogramAccumulator> latencies(threadCount);
+  folly::test::Barrier gate{static_cast<unsigned>(threadCount)};
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount);
+  for (uint64_t t = 0; t < threadCount; ++t) {
+    threads.emplace_back([&, t] {
+      auto& latency = latencies[t];
+      gate.wait();
+      for (uint64_t i = 0; i < FLAGS_ops; ++i) {
+        latency.add(op(folly::Random::rand64(count)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto label = folly::to<std::string>(name, " ", threadCount, " threads");
+  for (const auto& latency : latencies) {
+    report.metric(label, "ns").combine(latency);
+  }
+}
+
+void benchmarkLookups(
+    LoadedTree& tree,
+    uint64_t threads,
+    BenchmarkReport& report) {
+  auto* inodeMap = tree.getInodeMap();
+  const auto& numbers = tree.fileNumbers;
+
+  runThreads(
+      "lookupLoadedInode", threads, numbers.size(), report, [&](size_t i) {
+        auto start = getTime();
+        auto inode = inodeMap->lookupLoadedInode(numbers[i]);
+        return getTime() - start;
+      });
+
+  runThreads("lookupInode", threads, numbers.size(), report, [&](size_t i) {
+    auto start = getTime();
+    auto inode = inodeMap->lookupInode(numbers[i]).get();
+    return getTime() - start;
+  });
+
+  runThreads("decFuseRefcount", threads, numbers.size(), report, [&](size_t i) {
+    tree.files[i]->incFuseRefcount();
+    auto start = getTime();
+    inodeMap->decFuseRefcount(numbers[i]);
+    return getTime() - start;
+  });
+
+  const auto& directories = tree.directories;
+  runThreads(
+      "getOrLoadChild", threads, directories.size(), report, [&](size_t i) {
+        const auto& children = directories[i].children;
+        const auto& name = children[folly::Random::rand64(children.size())];
+        auto start = getTime();
+        auto inode = tree.trees[i]->getOrLoadChild(name).get();
+        return getTime() - start;
+      });
+}
+
+/**
+ * Times EdenDispatcher::lookup() of loaded children from this thread, along
+ * with the allocations each lookup makes.  Every lookup is forgotten again
+ * so that FUSE reference counts stay balanced.
+ */
+void benchmarkDispatcherLookup(LoadedTree& tree, BenchmarkReport& report) {
+  auto* dispatcher = tree.mount.getEdenMount()->getDispatcher();
+  auto& latency = report.metric("EdenDispatcher::lookup", "ns");
+  AllocationAccumulator allocations;
+  for (uint64_t i = 0; i < FLAGS_ops; ++i) {
+    auto index = folly::Random::rand64(tree.directories.size());
+    const auto& directory = tree.directories[index];
+    const auto& parent = tree.trees[index];
+    const auto& name =
+        directory.children[folly::Random::rand64(directory.children.size())];
+
+    auto start = getTime();
+    fuse_entry_out entry;
+    {
+      AllocationScope scope{allocations};
+      entry = dispatcher->lookup(parent->getNodeId(), name).get();
+    }
+    latency.add(getTime() - start);
+    dispatcher->forget(InodeNumber{entry.nodeid}, 1);
+  }
+  allocations.addTo(report, "EdenDispatcher::lookup");
+}
+
+/**
+ * Times dropping the last reference to a file inode, which calls
+ * InodeMap::onInodeUnreferenced().  Must run after tree.files is cleared.
+ */
+void benchmarkUnreferenced(
+    LoadedTree& tree,
+    uint64_t threads,
+    BenchmarkReport& report) {
+  auto* inodeMap = tree.getInodeMap();
+  const auto& numbers = tree.fileNumbers;
+  runThreads(
+      "onInodeUnreferenced", threads, numbers.size(), report, [&](size_t i) {
+        auto inode = inodeMap->lookupLoadedInode(numbers[i]);
+        auto start = getTime();
+        inode.reset();
+        return getTime() - start;
+      });
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv);
+
+  std::vector<uint64_t> threadCounts;
+  folly::split(',', FLAGS_thread_counts, threadCounts, /*ignoreEmpty=*/true);
+  if (FLAGS_files_per_dir == 0) {
+    fprintf(stderr, "--files_per_dir must be nonzero\n");
+    return 1;
+  }
+
+  LoadedTree tree;
+  printf(
+      "Loaded %zu directories and %zu files\n",
+      tree.trees.size(),
+      tree.files.size());
+
+  auto clock_overhead = measureClockOverhead();
+  printf(
+      "Clock overhead measured at %" PRIu64 " ns minimum, %" PRIu64
+      " ns average\n",
+      clock_overhead.getMinimum(),
+      clock_overhead.getAverage());
+
+  return runBenchmark("inodes", [&](BenchmarkReport& report) {
+    benchmarkDispatcherLookup(tree, report);
+    for (auto threads : threadCounts) {
+      benchmarkLookups(tree, threads, report);
+    }
+
+    // Dropping a reference only calls onInodeUnreferenced() when it is the
+    // last one, so release the pins first.
+    tree.files.clear();
+    for (auto threads : threadCounts) {
+      benchmarkUnreferenced(tree, threads, report);
+    }
+
+    // Unreferenced inodes with loaded parents stay loaded, so they can be
+    // pinned again for the next run.
+    for (auto number : tree.fileNumbers) {
+      tree.files.push_back(tree.getInodeMap()->lookupLoadedInode(number));
+    }
+  });
+}
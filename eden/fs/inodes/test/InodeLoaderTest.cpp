@@ -102,3 +102,36 @@ TEST(InodeLoader, notReady) {
     EXPECT_EQ("dir/sub/b.txt"_relpath, results[3].value());
   }
 }
+
+TEST(InodeLoader, prefetchBlobMetadata) {
+  FakeTreeBuilder builder;
+  builder.setFiles(
+      {{"dir/a.txt", "a"}, {"dir/sub/b.txt", "bb"}, {"dir/sub/c.txt", "ccc"}});
+  TestMount mount(builder, /* startReady= */ false);
+
+  auto rootInode = mount.getTreeInode(RelativePathPiece());
+
+  auto future = collectAll(applyToInodes(
+      rootInode,
+      std::vector<std::string>{
+          "dir/sub/c.txt", "dir/a.txt", "dir/missing", "dir/sub/b.txt"},
+      [](InodePtr inode) {
+        return inode->stat().thenValue(
+            [](struct stat st) { return st.st_size; });
+      },
+      /*prefetchBlobMetadata=*/true));
+
+  builder.setReady("dir");
+  builder.setReady("dir/sub");
+  EXPECT_FALSE(future.isReady());
+  builder.setReady("dir/a.txt");
+  builder.setReady("dir/sub/b.txt");
+  builder.setReady("dir/sub/c.txt");
+
+  auto results = std::move(future).get(std::chrono::seconds{10});
+
+  EXPECT_EQ(3, results[0].value());
+  EXPECT_EQ(1, results[1].value());
+  EXPECT_THROW_ERRNO(results[2].value(), ENOENT);
+  EXPECT_EQ(2, results[3].value());
+}
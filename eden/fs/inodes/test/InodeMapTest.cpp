@@ -326,6 +326,62 @@ TEST(InodeMap, unloadedUnlinkedTreesAreRemovedFromOverlay) {
 #endif // !_WIN32
 }
 
+TEST(InodeMap, unloadedParentsAreFoundAcrossShards) {
+  // The inodes along this path have consecutive numbers, so they are spread
+  // across the InodeMap's shards.
+  FakeTreeBuilder builder;
+  builder.setFile("a/b/c/d/e/file.txt", "contents");
+  TestMount testMount{builder};
+  auto edenMount = testMount.getEdenMount();
+  auto* inodeMap = edenMount->getInodeMap();
+
+  auto file = edenMount->getInode("a/b/c/d/e/file.txt"_relpath).get();
+  file->incFuseRefcount();
+  auto fileNumber = file->getNodeId();
+  file.reset();
+
+  auto before = inodeMap->getInodeCounts();
+  EXPECT_EQ(6, before.treeCount);
+  EXPECT_EQ(1, before.fileCount);
+
+  edenMount->getRootInode()->unloadChildrenNow();
+  auto after = inodeMap->getInodeCounts();
+  EXPECT_EQ(1, after.treeCount);
+  EXPECT_EQ(0, after.fileCount);
+  // The file is remembered for its FUSE reference, and its parents for it.
+  EXPECT_EQ(6, after.unloadedInodeCount);
+  EXPECT_TRUE(inodeMap->isInodeRemembered(fileNumber));
+
+  EXPECT_EQ(
+      "a/b/c/d/e/file.txt"_relpath,
+      inodeMap->getPathForInode(fileNumber).value());
+  EXPECT_EQ(
+      "a/b/c/d/e/file.txt",
+      inodeMap->lookupInode(fileNumber).get(1s)->getLogPath());
+}
+
+TEST(InodeMap, fuseRefcountIsReportedWhetherOrNotLoaded) {
+  FakeTreeBuilder builder;
+  builder.setFile("dir/file.txt", "contents");
+  TestMount testMount{builder};
+  auto edenMount = testMount.getEdenMount();
+  auto* inodeMap = edenMount->getInodeMap();
+
+  auto file = edenMount->getInode("dir/file.txt"_relpath).get();
+  auto fileNumber = file->getNodeId();
+  EXPECT_EQ(0, inodeMap->getApproximateFuseRefcount(fileNumber));
+  file->incFuseRefcount(2);
+  EXPECT_EQ(2, inodeMap->getApproximateFuseRefcount(fileNumber));
+  file.reset();
+
+  edenMount->getRootInode()->unloadChildrenNow();
+  EXPECT_FALSE(inodeMap->lookupLoadedInode(fileNumber));
+  EXPECT_EQ(2, inodeMap->getApproximateFuseRefcount(fileNumber));
+
+  inodeMap->decFuseRefcount(fileNumber, 2);
+  EXPECT_EQ(0, inodeMap->getApproximateFuseRefcount(fileNumber));
+}
+
 #ifndef _WIN32
 
 TEST(InodeMap, unloadedFileMetadataIsForgotten) {
@@ -11,6 +11,8 @@
 #include <folly/experimental/TestUtil.h>
 #include <folly/test/TestUtils.h>
 #include <gtest/gtest.h>
+#include <random>
+#include <unordered_map>
 
 using namespace facebook::eden;
 
@@ -162,6 +164,98 @@ TEST_F(InodeTableTest, setDefault) {
   EXPECT_EQ(14, inodeTable->setDefault(1_ino, 16));
 }
 
+TEST_F(InodeTableTest, freeInodeKeepsOtherRecordsReachable) {
+  {
+    auto inodeTable = InodeTable<Int>::open(tablePath);
+    for (uint64_t i = 1; i <= 1000; ++i) {
+      inodeTable->set(InodeNumber{i}, static_cast<int>(i * 2));
+    }
+    for (uint64_t i = 1; i <= 1000; i += 3) {
+      inodeTable->freeInode(InodeNumber{i});
+    }
+  }
+
+  auto inodeTable = InodeTable<Int>::open(tablePath);
+  for (uint64_t i = 1; i <= 1000; ++i) {
+    auto record = inodeTable->getOptional(InodeNumber{i});
+    if (i % 3 == 1) {
+      EXPECT_FALSE(record.has_value()) << "inode " << i;
+    } else {
+      ASSERT_TRUE(record.has_value()) << "inode " << i;
+      EXPECT_EQ(static_cast<int>(i * 2), record->value);
+    }
+  }
+}
+
+TEST_F(InodeTableTest, freeInodesAndForEachModify) {
+  auto inodeTable = InodeTable<Int>::open(tablePath);
+  for (uint64_t i = 1; i <= 100; ++i) {
+    inodeTable->set(InodeNumber{i}, static_cast<int>(i));
+  }
+  // Inodes without records are skipped.
+  inodeTable->freeInodes({2_ino, 50_ino, 100_ino, 500_ino});
+
+  std::unordered_map<uint64_t, int> seen;
+  inodeTable->forEachModify([&](InodeNumber ino, Int& record) {
+    seen[ino.get()] = record;
+    record = record * 10;
+  });
+  inodeTable->sync(/*wait=*/true);
+
+  EXPECT_EQ(97, seen.size());
+  for (uint64_t i = 1; i <= 100; ++i) {
+    auto record = inodeTable->getOptional(InodeNumber{i});
+    if (i == 2 || i == 50 || i == 100) {
+      EXPECT_FALSE(record.has_value()) << "inode " << i;
+    } else {
+      EXPECT_EQ(static_cast<int>(i), seen[i]);
+      ASSERT_TRUE(record.has_value()) << "inode " << i;
+      EXPECT_EQ(static_cast<int>(i * 10), record->value);
+    }
+  }
+}
+
+TEST(InodeTableIndex, matchesUnorderedMap) {
+  InodeTableIndex index;
+  std::unordered_map<uint64_t, size_t> expected;
+  std::mt19937_64 rng{0};
+  std::uniform_int_distribution<uint64_t> inodes{1, 5000};
+
+  for (size_t step = 0; step < 100000; ++step) {
+    auto ino = inodes(rng);
+    switch (rng() % 3) {
+      case 0:
+        EXPECT_EQ(
+            expected.emplace(ino, step).second,
+            index.insert(InodeNumber{ino}, step));
+        break;
+      case 1:
+        expected[ino] = step;
+        index.assign(InodeNumber{ino}, step);
+        break;
+      case 2:
+        EXPECT_EQ(expected.erase(ino) == 1, index.erase(InodeNumber{ino}));
+        break;
+    }
+  }
+
+  EXPECT_EQ(expected.size(), index.size());
+  for (uint64_t ino = 1; ino <= 5000; ++ino) {
+    auto iter = expected.find(ino);
+    EXPECT_EQ(
+        iter == expected.end() ? InodeTableIndex::kNotFound : iter->second,
+        index.find(InodeNumber{ino}))
+        << "inode " << ino;
+  }
+
+  size_t visited = 0;
+  index.forEach([&](InodeNumber ino, size_t recordIndex) {
+    EXPECT_EQ(expected.at(ino.get()), recordIndex);
+    ++visited;
+  });
+  EXPECT_EQ(expected.size(), visited);
+}
+
 // TEST(INodeTable, set) {}
 // TEST(INodeTable, getOrThrow) {}
 // TEST(INodeTable, getOptional) {}
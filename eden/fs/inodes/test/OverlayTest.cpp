@@ -18,6 +18,7 @@
 #include <folly/logging/test/TestLogHandler.h>
 #include <folly/synchronization/test/Barrier.h>
 #include <folly/test/TestUtils.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <algorithm>
 #include <iomanip>
@@ -37,11 +38,15 @@
 #include "eden/fs/utils/PathFuncs.h"
 
 using namespace folly::string_piece_literals;
+using namespace std::chrono_literals;
 using folly::Subprocess;
 
 namespace facebook {
 namespace eden {
 
+DECLARE_bool(overlayDirWriteBehind);
+DECLARE_int32(overlayGCThreads);
+
 namespace {
 std::string debugDumpOverlayInodes(Overlay&, InodeNumber rootInode);
 } // namespace
@@ -237,6 +242,14 @@ TEST_F(OverlayTest, roundTripThroughSaveAndLoad) {
   EXPECT_TRUE(two.isMaterialized());
 }
 
+TEST_F(OverlayTest, allocateInodeNumbersReservesARange) {
+  auto overlay = mount_.getEdenMount()->getOverlay();
+
+  auto first = overlay->allocateInodeNumbers(100);
+  EXPECT_EQ(InodeNumber{first.get() + 99}, overlay->getMaxInodeNumber());
+  EXPECT_EQ(InodeNumber{first.get() + 100}, overlay->allocateInodeNumber());
+}
+
 TEST_F(OverlayTest, getFilePath) {
   InodePath path;
 
@@ -540,6 +553,44 @@ TEST_P(RawOverlayTest, remembers_max_inode_number_of_file) {
   EXPECT_EQ(3_ino, overlay->getMaxInodeNumber());
 }
 
+TEST_P(RawOverlayTest, blob_file_cache_copies_blobs_into_overlay_files) {
+  auto contents = folly::IOBuf::copyBuffer(std::string(100000, 'x'));
+  auto blobHash = Hash::sha1(*contents);
+  auto ino2 = overlay->allocateInodeNumber();
+  auto ino3 = overlay->allocateInodeNumber();
+
+  EXPECT_FALSE(overlay->cloneOverlayFileFromBlobFile(ino2, blobHash, 100000));
+
+  // Reflinks and copy_file_range() are not available everywhere, so the copy
+  // may fall back, but it must never produce the wrong contents.
+  overlay->addBlobFile(blobHash, *contents, 1024 * 1024);
+  auto file = overlay->cloneOverlayFileFromBlobFile(ino2, blobHash, 100000);
+  if (file) {
+    auto data = file->readFile().value();
+    EXPECT_EQ(
+        std::string(100000, 'x'), data.substr(FsOverlay::kHeaderLength));
+  }
+
+  // A full cache does not take new blobs.
+  auto other = folly::IOBuf::copyBuffer("other");
+  auto otherHash = Hash::sha1(*other);
+  overlay->addBlobFile(otherHash, *other, 0);
+  EXPECT_FALSE(overlay->cloneOverlayFileFromBlobFile(ino3, otherHash, 5));
+}
+
+TEST_P(RawOverlayTest, blob_file_cache_rejects_blob_files_of_the_wrong_size) {
+  auto contents = folly::IOBuf::copyBuffer(std::string(100000, 'x'));
+  auto blobHash = Hash::sha1(*contents);
+  auto ino2 = overlay->allocateInodeNumber();
+  auto ino3 = overlay->allocateInodeNumber();
+
+  overlay->addBlobFile(blobHash, *contents, 1024 * 1024);
+  EXPECT_FALSE(overlay->cloneOverlayFileFromBlobFile(ino2, blobHash, 99999));
+  // The mismatched blob file was dropped, so it is not cloned afterwards
+  // either.
+  EXPECT_FALSE(overlay->cloneOverlayFileFromBlobFile(ino3, blobHash, 100000));
+}
+
 TEST_P(
     RawOverlayTest,
     inode_number_scan_includes_linked_directory_despite_its_corruption) {
@@ -701,6 +752,92 @@ TEST_P(RawOverlayTest, inode_numbers_after_takeover) {
   EXPECT_EQ(5_ino, overlay->getMaxInodeNumber());
 }
 
+TEST_P(RawOverlayTest, write_behind_dirs_are_visible_and_flushed) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_overlayDirWriteBehind = true;
+  recreate();
+
+  auto hash = Hash{"0123456789012345678901234567890123456789"};
+  DirContents root;
+  for (size_t i = 0; i < 100; ++i) {
+    root.emplace(
+        PathComponent{"f" + std::to_string(i)},
+        S_IFREG | 0644,
+        overlay->allocateInodeNumber(),
+        hash);
+    overlay->saveOverlayDir(kRootNodeId, root);
+
+    // Reads see the latest save whether or not it has been written yet.
+    auto loaded = overlay->loadOverlayDir(kRootNodeId);
+    ASSERT_TRUE(loaded);
+    EXPECT_EQ(i + 1, loaded->size());
+  }
+
+  // A queued write must not resurrect a directory that was removed.
+  auto removedIno = overlay->allocateInodeNumber();
+  overlay->saveOverlayDir(removedIno, DirContents{});
+  EXPECT_TRUE(overlay->hasOverlayData(removedIno));
+  overlay->removeOverlayData(removedIno);
+  EXPECT_FALSE(overlay->hasOverlayData(removedIno));
+
+  overlay->flushPendingAsync().get(10s);
+  EXPECT_FALSE(overlay->hasOverlayData(removedIno));
+
+  // Closing the overlay writes anything still queued.
+  root.emplace("last"_pc, S_IFREG | 0644, overlay->allocateInodeNumber(), hash);
+  overlay->saveOverlayDir(kRootNodeId, root);
+  recreate();
+
+  auto loaded = overlay->loadOverlayDir(kRootNodeId);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(101, loaded->size());
+  EXPECT_FALSE(overlay->hasOverlayData(removedIno));
+}
+
+TEST_P(RawOverlayTest, parallel_gc_removes_whole_tree) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_overlayGCThreads = 4;
+  recreate();
+
+  auto hash = Hash{"0123456789012345678901234567890123456789"};
+  std::vector<InodeNumber> inodes;
+  auto top = overlay->allocateInodeNumber();
+  DirContents topDir;
+  for (size_t i = 0; i < 20; ++i) {
+    auto middle = overlay->allocateInodeNumber();
+    DirContents middleDir;
+    for (size_t j = 0; j < 10; ++j) {
+      auto leaf = overlay->allocateInodeNumber();
+      DirContents leafDir;
+      for (size_t k = 0; k < 5; ++k) {
+        auto file = overlay->allocateInodeNumber();
+        overlay->createOverlayFile(file, folly::ByteRange{});
+        leafDir.emplace(
+            PathComponent{"f" + std::to_string(k)}, S_IFREG | 0644, file, hash);
+        inodes.push_back(file);
+      }
+      overlay->saveOverlayDir(leaf, leafDir);
+      middleDir.emplace(
+          PathComponent{"d" + std::to_string(j)}, S_IFDIR | 0755, leaf, hash);
+      inodes.push_back(leaf);
+    }
+    overlay->saveOverlayDir(middle, middleDir);
+    topDir.emplace(
+        PathComponent{"d" + std::to_string(i)}, S_IFDIR | 0755, middle, hash);
+    inodes.push_back(middle);
+  }
+  overlay->saveOverlayDir(top, topDir);
+  inodes.push_back(top);
+
+  overlay->recursivelyRemoveOverlayData(top);
+  overlay->flushPendingAsync().get(10s);
+
+  for (auto ino : inodes) {
+    EXPECT_FALSE(overlay->hasOverlayData(ino)) << "inode " << ino;
+  }
+  EXPECT_EQ(0, overlay->getGCQueueDepth());
+}
+
 INSTANTIATE_TEST_CASE_P(
     Clean,
     RawOverlayTest,
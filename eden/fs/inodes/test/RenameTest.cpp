@@ -308,6 +308,28 @@ TEST_F(RenameTest, renameDirToSamePath) {
   EXPECT_EQ(path, origDir->getPath().value());
 }
 
+TEST_F(RenameTest, renameDirUpdatesDescendantPaths) {
+  // Compute the path first so that every ancestor has it cached.
+  auto file = mount_->getFileInode("a/b/c/d/e/f/readme.txt");
+  EXPECT_EQ(RelativePath{"a/b/c/d/e/f/readme.txt"}, file->getPath().value());
+  auto dirE = mount_->getTreeInode("a/b/c/d/e");
+  EXPECT_EQ(RelativePath{"a/b/c/d/e"}, dirE->getPath().value());
+
+  auto renameFuture = mount_->getTreeInode("a/b/c")->rename(
+      "d"_pc, mount_->getTreeInode("a/x"), "moved"_pc);
+  ASSERT_TRUE(renameFuture.isReady());
+  std::move(renameFuture).get();
+
+  EXPECT_EQ(RelativePath{"a/x/moved/e/f/readme.txt"}, file->getPath().value());
+  EXPECT_EQ(RelativePath{"a/x/moved/e"}, dirE->getPath().value());
+
+  auto rmdirFuture =
+      mount_->getTreeInode("a/x/moved/e/f")->rmdir("emptydir"_pc);
+  ASSERT_TRUE(rmdirFuture.isReady());
+  std::move(rmdirFuture).get();
+  EXPECT_EQ(RelativePath{"a/x/moved/e/f/readme.txt"}, file->getPath().value());
+}
+
 /*
  * Tests for error conditions
  */
@@ -212,6 +212,184 @@ TEST(TreeInode, readdirIgnoresWildOffsets) {
   EXPECT_EQ(0, result.size());
 }
 
+TEST(TreeInode, readdirCacheTracksChangesAndOffsets) {
+  FakeTreeBuilder builder;
+  builder.setFile("somedir/file1", "test\n");
+  builder.setFile("somedir/file2", "test\n");
+  builder.setFile("somedir/file3", "test\n");
+  TestMount mount{builder};
+  mount.updateEdenConfig({{"fuse:readdir-cache", "true"}});
+
+  auto somedir = mount.getTreeInode("somedir"_relpath);
+  auto names = [&] {
+    // Page through with room for only two entries at a time.
+    std::vector<std::string> result;
+    off_t off = 0;
+    while (true) {
+      auto page =
+          somedir->readdir(DirList{2 * DirList::entrySize("file1")}, off)
+              .extract();
+      if (page.empty()) {
+        return result;
+      }
+      for (auto& entry : page) {
+        result.push_back(entry.name);
+      }
+      off = page.back().offset;
+    }
+  };
+
+  using Names = std::vector<std::string>;
+  EXPECT_EQ((Names{".", "..", "file1", "file2", "file3"}), names());
+  EXPECT_EQ((Names{".", "..", "file1", "file2", "file3"}), names());
+
+  somedir->mknod("file4"_pc, S_IFREG, 0);
+  EXPECT_EQ((Names{".", "..", "file1", "file2", "file3", "file4"}), names());
+
+  somedir->unlink("file2"_pc).get(0ms);
+  EXPECT_EQ((Names{".", "..", "file1", "file3", "file4"}), names());
+
+  // Entries are listed in inode number order, so the renamed file keeps its
+  // place.
+  somedir->rename("file3"_pc, somedir, "file5"_pc).get(0ms);
+  EXPECT_EQ((Names{".", "..", "file1", "file5", "file4"}), names());
+}
+
+TEST(TreeInode, getLoadedChildOnlyReturnsLoadedInodes) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"dir/file", ""}, {"other", ""}});
+  TestMount mount{builder};
+
+  auto root = mount.getEdenMount()->getRootInode();
+  EXPECT_FALSE(root->getLoadedChild("other"_pc));
+  EXPECT_FALSE(root->getLoadedChild("missing"_pc));
+
+  auto dir = mount.getTreeInode("dir"_relpath);
+  EXPECT_EQ(dir.get(), root->getLoadedChild("dir"_pc).get());
+
+  // .eden in a subdirectory is the this-dir symlink, which is only reached
+  // through getOrLoadChild().
+  EXPECT_FALSE(dir->getLoadedChild(".eden"_pc));
+}
+
+TEST(TreeInode, isChildMissingDoesNotLoadChildren) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"dir/file", ""}});
+  TestMount mount{builder};
+
+  auto root = mount.getEdenMount()->getRootInode();
+  EXPECT_TRUE(root->isChildMissing("missing"_pc));
+  EXPECT_FALSE(root->isChildMissing("dir"_pc));
+  EXPECT_FALSE(root->getLoadedChild("dir"_pc));
+
+  auto dir = mount.getTreeInode("dir"_relpath);
+  EXPECT_FALSE(dir->isChildMissing("file"_pc));
+  EXPECT_FALSE(dir->isChildMissing(".eden"_pc));
+}
+
+TEST(TreeInode, getChildRecursiveWalksLoadedAndUnloadedChildren) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"a/b/c/file", "contents"}, {"a/other", ""}});
+  TestMount mount{builder};
+  auto root = mount.getEdenMount()->getRootInode();
+
+  // Everything below the root is loaded on demand ...
+  auto file = root->getChildRecursive("a/b/c/file"_relpath).get(1s);
+  EXPECT_EQ("a/b/c/file", file->getPath().value().stringPiece());
+
+  // ... and found again without loading anything once it is.
+  auto again = root->getChildRecursive("a/b/c/file"_relpath);
+  ASSERT_TRUE(again.isReady());
+  EXPECT_EQ(file.get(), std::move(again).get().get());
+
+  // A walk that reaches an unloaded child continues with a load.
+  auto other = root->getChildRecursive("a/other"_relpath).get(1s);
+  EXPECT_EQ("a/other", other->getPath().value().stringPiece());
+
+  EXPECT_THROW_ERRNO(
+      root->getChildRecursive("a/b/c/file/x"_relpath).get(1s), ENOTDIR);
+  EXPECT_THROW_ERRNO(
+      root->getChildRecursive("a/b/missing"_relpath).get(1s), ENOENT);
+}
+
+TEST(TreeInode, getCheckoutPathsListsLoadedAndMaterializedEntries) {
+  FakeTreeBuilder builder;
+  builder.setFiles(
+      {{"dir/file", ""}, {"dir/other", ""}, {"top", ""}, {"unloaded/x", ""}});
+  TestMount mount{builder};
+  mount.getFileInode("dir/file"_relpath);
+  mount.overwriteFile("top", "changed");
+
+  std::vector<RelativePath> paths;
+  mount.getEdenMount()->getRootInode()->getCheckoutPaths(
+      RelativePathPiece{}, paths);
+  auto contains = [&](folly::StringPiece path) {
+    return std::find(paths.begin(), paths.end(), RelativePath{path}) !=
+        paths.end();
+  };
+  EXPECT_TRUE(contains("dir"));
+  EXPECT_TRUE(contains("dir/file"));
+  EXPECT_TRUE(contains("top"));
+  EXPECT_FALSE(contains("dir/other"));
+  EXPECT_FALSE(contains("unloaded"));
+  EXPECT_FALSE(contains("unloaded/x"));
+}
+
+TEST(TreeInode, onlyDirectoryRenamesInvalidateCachedPaths) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"a/b/file", ""}, {"a/b/other", ""}, {"c/x", ""}});
+  TestMount mount{builder};
+  auto edenMount = mount.getEdenMount();
+  auto b = mount.getTreeInode("a/b"_relpath);
+  auto file = mount.getFileInode("a/b/file"_relpath);
+  EXPECT_EQ("a/b/file", file->getPath().value().stringPiece());
+
+  auto generation = edenMount->getPathGeneration();
+  b->rename("file"_pc, b, "renamed"_pc).get(0ms);
+  b->unlink("other"_pc).get(0ms);
+  EXPECT_EQ(generation, edenMount->getPathGeneration());
+  EXPECT_EQ("a/b/renamed", file->getPath().value().stringPiece());
+
+  auto a = mount.getTreeInode("a"_relpath);
+  auto c = mount.getTreeInode("c"_relpath);
+  a->rename("b"_pc, c, "b"_pc).get(0ms);
+  EXPECT_NE(generation, edenMount->getPathGeneration());
+  EXPECT_EQ("c/b", b->getPath().value().stringPiece());
+  EXPECT_EQ("c/b/renamed", file->getPath().value().stringPiece());
+}
+
+#ifdef __linux__
+TEST(TreeInode, readdirplusOnlyFillsAttributesForLoadedChildren) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"dir/file", ""}, {"other", ""}});
+  TestMount mount{builder};
+
+  auto root = mount.getEdenMount()->getRootInode();
+  auto dir = mount.getTreeInode("dir"_relpath);
+  auto refcount = dir->debugGetFuseRefcount();
+
+  auto result = root->readdirplus(DirListPlus{4096}, 0).extract();
+  ASSERT_LE(4, result.size());
+  EXPECT_EQ(".", result[0].name);
+  EXPECT_EQ(0, result[0].entry.nodeid);
+  EXPECT_EQ("..", result[1].name);
+  EXPECT_EQ(0, result[1].entry.nodeid);
+
+  for (auto& entry : result) {
+    EXPECT_NE(0, entry.offset);
+    if (entry.name == "dir") {
+      EXPECT_EQ(dir->getNodeId().get(), entry.entry.nodeid);
+      EXPECT_EQ(dir->getNodeId().get(), entry.inode);
+      EXPECT_TRUE(S_ISDIR(entry.entry.attr.mode));
+    } else if (entry.name == "other") {
+      EXPECT_EQ(0, entry.entry.nodeid);
+      EXPECT_NE(0, entry.inode);
+    }
+  }
+  EXPECT_EQ(refcount + 1, dir->debugGetFuseRefcount());
+}
+#endif
+
 namespace {
 
 // 500 is big enough for ~9 entries
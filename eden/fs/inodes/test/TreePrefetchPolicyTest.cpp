@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/TreePrefetchPolicy.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+
+namespace {
+const InodeNumber kRoot{1};
+const InodeNumber kDir{2};
+const InodeNumber kSubdir{3};
+constexpr uint32_t kMaxDepth = 3;
+
+TreePrefetchPolicy::Stats outcome(uint64_t prefetched, uint64_t used) {
+  TreePrefetchPolicy::Stats stats;
+  stats.prefetchedChildren = prefetched;
+  stats.usedChildren = used;
+  stats.usefulBytes = used * 100;
+  stats.wastedBytes = (prefetched - used) * 100;
+  return stats;
+}
+} // namespace
+
+TEST(TreePrefetchPolicyTest, prefetches_all_children_without_history) {
+  TreePrefetchPolicy policy;
+  auto decision = policy.decide(kDir, kRoot, "ls", 100, kMaxDepth);
+  EXPECT_EQ(1, decision.depth);
+  EXPECT_EQ(std::numeric_limits<size_t>::max(), decision.fanOut);
+
+  // Too few samples are not trusted either.
+  policy.recordOutcome(kDir, "ls", outcome(2, 0));
+  decision = policy.decide(kDir, kRoot, "ls", 100, kMaxDepth);
+  EXPECT_EQ(1, decision.depth);
+  EXPECT_EQ(std::numeric_limits<size_t>::max(), decision.fanOut);
+}
+
+TEST(TreePrefetchPolicyTest, crawlers_prefetch_deeper) {
+  TreePrefetchPolicy policy;
+  policy.recordOutcome(kDir, "find", outcome(20, 19));
+  // A directory that was never prefetched goes by the command alone.
+  auto decision = policy.decide(InodeNumber{10}, kRoot, "find", 100, kMaxDepth);
+  EXPECT_EQ(kMaxDepth, decision.depth);
+  EXPECT_EQ(std::numeric_limits<size_t>::max(), decision.fanOut);
+}
+
+TEST(TreePrefetchPolicyTest, unused_prefetches_shrink_to_a_probe) {
+  TreePrefetchPolicy policy;
+  policy.recordOutcome(kDir, "ls", outcome(50, 0));
+  auto decision = policy.decide(kDir, kRoot, "ls", 100, kMaxDepth);
+  EXPECT_EQ(1, decision.depth);
+  EXPECT_EQ(4, decision.fanOut);
+}
+
+TEST(TreePrefetchPolicyTest, fan_out_follows_hit_rate) {
+  TreePrefetchPolicy policy;
+  policy.recordOutcome(kDir, "make", outcome(10, 3));
+  auto decision = policy.decide(kDir, kRoot, "make", 100, kMaxDepth);
+  EXPECT_EQ(1, decision.depth);
+  EXPECT_EQ(40, decision.fanOut);
+}
+
+TEST(TreePrefetchPolicyTest, subdirectories_inherit_their_parents_rate) {
+  TreePrefetchPolicy policy;
+  policy.recordOutcome(kDir, "python", outcome(40, 40));
+  // Another command has a poor hit rate elsewhere, which is averaged in.
+  policy.recordOutcome(InodeNumber{20}, "ls", outcome(40, 0));
+  EXPECT_EQ(
+      kMaxDepth, policy.decide(kSubdir, kDir, "python", 10, kMaxDepth).depth);
+  auto decision = policy.decide(kSubdir, kDir, "ls", 10, kMaxDepth);
+  EXPECT_EQ(1, decision.depth);
+  EXPECT_EQ(7, decision.fanOut);
+}
+
+TEST(TreePrefetchPolicyTest, totals_every_outcome) {
+  TreePrefetchPolicy policy;
+  policy.recordOutcome(kDir, "ls", outcome(10, 4));
+  policy.recordOutcome(kSubdir, "find", outcome(5, 5));
+  auto stats = policy.getStats();
+  EXPECT_EQ(15, stats.prefetchedChildren);
+  EXPECT_EQ(9, stats.usedChildren);
+  EXPECT_EQ(900, stats.usefulBytes);
+  EXPECT_EQ(600, stats.wastedBytes);
+}
+
+TEST(TreePrefetchPolicyTest, command_type_is_executable_base_name) {
+  EXPECT_EQ("find", TreePrefetchPolicy::getCommandType("/usr/bin/find . -ls"));
+  EXPECT_EQ("watchman", TreePrefetchPolicy::getCommandType("watchman"));
+  EXPECT_EQ("ls", TreePrefetchPolicy::getCommandType(folly::StringPiece{
+                      "/bin/ls\0-l", 10}));
+  EXPECT_EQ("", TreePrefetchPolicy::getCommandType(""));
+}
@@ -140,3 +140,43 @@ TEST(UnloadUnreferencedByFuse, inodesReferencedByFuseAreNotUnloaded) {
   EXPECT_EQ(1, counts.fileCount);
   EXPECT_EQ(0, counts.unloadedInodeCount);
 }
+
+TEST(UnloadOverBudget, leastRecentlyUsedInodesAreUnloadedFirst) {
+  FakeTreeBuilder builder;
+  builder.setFile("docs/README.md", "readme");
+  builder.setFile("src/code.c", "main() {}");
+  builder.setFile("test/test.c", "TEST()");
+  TestMount testMount{builder};
+
+  auto* edenMount = testMount.getEdenMount().get();
+  auto inodeMap = edenMount->getInodeMap();
+
+  auto getIno = [&](RelativePathPiece relpath) {
+    return edenMount->getInode(relpath).get()->getNodeId();
+  };
+  auto readmeIno = getIno("docs/README.md"_relpath);
+  auto codeIno = getIno("src/code.c"_relpath);
+  auto testIno = getIno("test/test.c"_relpath);
+  testMount.overwriteFile("test/test.c", "TEST(modified)");
+
+  // Everything fits, so nothing is unloaded, but a new epoch starts.
+  EXPECT_EQ(0, edenMount->unloadInodesOverBudget(1024 * 1024 * 1024));
+  EXPECT_EQ(1, edenMount->getInodeAccessEpoch());
+
+  // Touch src/code.c again in the new epoch.
+  EXPECT_EQ(codeIno, getIno("src/code.c"_relpath));
+
+  // With no budget at all, only the inodes used during the last epoch and
+  // the materialized ones survive.  That includes at least docs and
+  // docs/README.md.
+  EXPECT_LE(2, edenMount->unloadInodesOverBudget(0));
+  EXPECT_FALSE(inodeMap->lookupLoadedInode(readmeIno));
+  EXPECT_TRUE(inodeMap->lookupLoadedInode(codeIno));
+  EXPECT_TRUE(inodeMap->lookupLoadedInode(testIno));
+
+  // Once src and src/code.c go unused for a whole epoch they are unloaded as
+  // well.
+  EXPECT_EQ(2, edenMount->unloadInodesOverBudget(0));
+  EXPECT_FALSE(inodeMap->lookupLoadedInode(codeIno));
+  EXPECT_TRUE(inodeMap->lookupLoadedInode(testIno));
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/WorkingSet.h"
+
+#include <folly/experimental/TestUtil.h>
+#include <gtest/gtest.h>
+#include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+
+using namespace facebook::eden;
+
+TEST(WorkingSet, collects_loaded_unmaterialized_inodes) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"dir/a.txt", "a"},
+                    {"dir/sub/b.txt", "b"},
+                    {"other/c.txt", "c"}});
+  TestMount mount{builder};
+  mount.getFileInode("dir/sub/b.txt");
+
+  auto root = mount.getTreeInode(RelativePathPiece{});
+  std::vector<RelativePath> expected{
+      RelativePath{"dir"},
+      RelativePath{"dir/sub"},
+      RelativePath{"dir/sub/b.txt"},
+  };
+  EXPECT_EQ(expected, WorkingSet::collectLoadedPaths(root, 100));
+
+  // Materialized inodes are read from the overlay, so they are skipped, but
+  // their unmaterialized children are still collected.
+  mount.addFile("dir/new.txt", "new");
+  expected = {RelativePath{"dir/sub"}, RelativePath{"dir/sub/b.txt"}};
+  EXPECT_EQ(expected, WorkingSet::collectLoadedPaths(root, 100));
+  expected.resize(1);
+  EXPECT_EQ(expected, WorkingSet::collectLoadedPaths(root, 1));
+}
+
+TEST(WorkingSet, saved_paths_are_loaded) {
+  folly::test::TemporaryDirectory tmpDir{"eden_working_set_"};
+  WorkingSet workingSet{realpath(tmpDir.path().string()) + "working-set"_pc};
+  EXPECT_TRUE(workingSet.load().empty());
+
+  std::vector<RelativePath> paths{RelativePath{"a"}, RelativePath{"b/c"}};
+  workingSet.save(paths);
+  EXPECT_EQ(paths, workingSet.load());
+}
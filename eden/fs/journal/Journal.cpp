@@ -6,35 +6,119 @@
  */
 
 #include "Journal.h"
+#include <folly/ExceptionString.h>
 #include <folly/logging/xlog.h>
+#include <functional>
+#include <iterator>
+#include <thread>
 
 namespace facebook {
 namespace eden {
 
+namespace {
+folly::StringPiece eventCharacterizationFor(const PathChangeInfo& ci) {
+  if (ci.existedBefore && !ci.existedAfter) {
+    return "Removed";
+  } else if (!ci.existedBefore && ci.existedAfter) {
+    return "Created";
+  } else if (ci.existedBefore && ci.existedAfter) {
+    return "Changed";
+  } else {
+    return "Ghost";
+  }
+}
+
+using ChangedPathMap = folly::F14FastMap<JournalPathTable::Id, PathChangeInfo>;
+
+/**
+ * Merges olderInfo, a change to the path id made before every change already
+ * in changedPaths, into changedPaths.
+ */
+void mergeOlderChange(
+    ChangedPathMap& changedPaths,
+    JournalPathTable::Id id,
+    const PathChangeInfo& olderInfo,
+    const JournalPathTable& paths) {
+  auto [it, inserted] = changedPaths.emplace(id, olderInfo);
+  if (!inserted) {
+    auto& resultInfo = it->second;
+    if (resultInfo.existedBefore != olderInfo.existedAfter) {
+      auto event1 = eventCharacterizationFor(olderInfo);
+      auto event2 = eventCharacterizationFor(resultInfo);
+      XLOG(ERR) << "Journal for " << paths.lookup(id) << " holds invalid "
+                << event1 << ", " << event2 << " sequence";
+    }
+
+    resultInfo.existedBefore = olderInfo.existedBefore;
+  }
+}
+
+/**
+ * Merges the file change deltas in [begin, end), newest first, into
+ * changedPaths.
+ */
+template <typename Iterator>
+void mergeOlderDeltas(
+    ChangedPathMap& changedPaths,
+    Iterator begin,
+    Iterator end,
+    const JournalPathTable& paths) {
+  while (end != begin) {
+    --end;
+    end->forEachChangedPath(
+        [&](JournalPathTable::Id id, const PathChangeInfo& info) {
+          mergeOlderChange(changedPaths, id, info, paths);
+        });
+  }
+}
+
+/**
+ * Returns the first delta in [begin, end), which must be ordered by sequence
+ * number, whose sequence number is at least sequence.
+ */
+template <typename Iterator>
+Iterator findSequence(
+    Iterator begin,
+    Iterator end,
+    JournalDelta::SequenceNumber sequence) {
+  return std::lower_bound(
+      begin,
+      end,
+      sequence,
+      [](const JournalDelta& delta, JournalDelta::SequenceNumber seq) {
+        return delta.sequenceID < seq;
+      });
+}
+} // namespace
+
 void Journal::recordCreated(RelativePathPiece fileName) {
-  addDelta(FileChangeJournalDelta(fileName, FileChangeJournalDelta::CREATED));
+  if (!stageFileChange(StagedAction::Created, fileName)) {
+    addFileChange(FileChangeJournalDelta::CREATED, fileName);
+  }
 }
 
 void Journal::recordRemoved(RelativePathPiece fileName) {
-  addDelta(FileChangeJournalDelta(fileName, FileChangeJournalDelta::REMOVED));
+  if (!stageFileChange(StagedAction::Removed, fileName)) {
+    addFileChange(FileChangeJournalDelta::REMOVED, fileName);
+  }
 }
 
 void Journal::recordChanged(RelativePathPiece fileName) {
-  addDelta(FileChangeJournalDelta(fileName, FileChangeJournalDelta::CHANGED));
+  if (!stageFileChange(StagedAction::Changed, fileName)) {
+    addFileChange(FileChangeJournalDelta::CHANGED, fileName);
+  }
 }
 
 void Journal::recordRenamed(
     RelativePathPiece oldName,
     RelativePathPiece newName) {
-  addDelta(FileChangeJournalDelta(
-      oldName, newName, FileChangeJournalDelta::RENAMED));
+  addFileChange(FileChangeJournalDelta::RENAMED, oldName, newName);
 }
 
 void Journal::recordReplaced(
     RelativePathPiece oldName,
     RelativePathPiece newName) {
-  addDelta(FileChangeJournalDelta(
-      oldName, newName, FileChangeJournalDelta::REPLACED));
+  addFileChange(FileChangeJournalDelta::REPLACED, oldName, newName);
 }
 
 void Journal::recordHashUpdate(Hash toHash) {
@@ -83,17 +167,62 @@ void Journal::DeltaState::popFront() {
   if (!isFileChangeEmpty && !isHashUpdateEmpty) {
     if (fileChangeDeltas.front().sequenceID <
         hashUpdateDeltas.front().sequenceID) {
-      fileChangeDeltas.pop_front();
+      popFrontFileChange();
     } else {
       hashUpdateDeltas.pop_front();
     }
   } else if (!isFileChangeEmpty) {
-    fileChangeDeltas.pop_front();
+    popFrontFileChange();
   } else if (!isHashUpdateEmpty) {
     hashUpdateDeltas.pop_front();
   }
 }
 
+void Journal::DeltaState::popFrontFileChange() {
+  auto& front = fileChangeDeltas.front();
+  if (!fileChangeSummaries.empty() &&
+      fileChangeSummaries.front().firstSequence <= front.sequenceID) {
+    summaryMemoryUsage -= fileChangeSummaries.front().estimateMemoryUsage();
+    fileChangeSummaries.pop_front();
+  }
+  releasePaths(front);
+  fileChangeDeltas.pop_front();
+}
+
+void Journal::DeltaState::maybeSummarizeFileChanges() {
+  auto unsummarized = fileChangeDeltas.begin();
+  if (!fileChangeSummaries.empty()) {
+    unsummarized = findSequence(
+                       fileChangeDeltas.begin(),
+                       fileChangeDeltas.end(),
+                       fileChangeSummaries.back().firstSequence) +
+        kFileChangeSummarySize;
+  }
+  if (static_cast<size_t>(fileChangeDeltas.end() - unsummarized) <
+      kFileChangeSummarySize) {
+    return;
+  }
+
+  auto begin = fileChangeDeltas.end() - kFileChangeSummarySize;
+  FileChangeSummary summary;
+  summary.firstSequence = begin->sequenceID;
+  mergeOlderDeltas(
+      summary.changedPaths, begin, fileChangeDeltas.end(), paths);
+  summaryMemoryUsage += summary.estimateMemoryUsage();
+  fileChangeSummaries.push_back(std::move(summary));
+}
+
+size_t Journal::FileChangeSummary::estimateMemoryUsage() const {
+  return sizeof(FileChangeSummary) + changedPaths.getAllocatedMemorySize();
+}
+
+void Journal::DeltaState::releasePaths(const FileChangeJournalDelta& delta) {
+  delta.forEachChangedPath(
+      [this](JournalPathTable::Id id, const PathChangeInfo&) {
+        paths.release(id);
+      });
+}
+
 JournalDeltaPtr Journal::DeltaState::backPtr() noexcept {
   bool isFileChangeEmpty = fileChangeDeltas.empty();
   bool isHashUpdateEmpty = hashUpdateDeltas.empty();
@@ -114,7 +243,7 @@ JournalDeltaPtr Journal::DeltaState::backPtr() noexcept {
   }
 }
 
-void Journal::truncateIfNecessary(DeltaState& deltaState) {
+void Journal::truncateIfNecessary(DeltaState& deltaState) const {
   while (JournalDeltaPtr front = deltaState.frontPtr()) {
     if (estimateMemoryUsage(deltaState) <= deltaState.memoryLimit) {
       break;
@@ -126,12 +255,16 @@ void Journal::truncateIfNecessary(DeltaState& deltaState) {
   }
 }
 
-bool Journal::compact(FileChangeJournalDelta& delta, DeltaState& deltaState) {
+bool Journal::compact(
+    FileChangeJournalDelta& delta,
+    DeltaState& deltaState) const {
   auto back = deltaState.backPtr().getAsFileChangeJournalDelta();
   if (back && delta.isModification() && delta.isSameAction(*back)) {
     deltaState.stats->latestTimestamp = delta.time;
     deltaState.deltaMemoryUsage -= back->estimateMemoryUsage();
     deltaState.deltaMemoryUsage += delta.estimateMemoryUsage();
+    // delta holds its own references to the same paths.
+    deltaState.releasePaths(*back);
     *back = std::move(delta);
     return true;
   }
@@ -140,12 +273,13 @@ bool Journal::compact(FileChangeJournalDelta& delta, DeltaState& deltaState) {
 
 bool Journal::compact(
     HashUpdateJournalDelta& /* unused */,
-    DeltaState& /* unused */) {
+    DeltaState& /* unused */) const {
   return false;
 }
 
 template <typename T>
-void Journal::addDeltaWithoutNotifying(T&& delta, DeltaState& deltaState) {
+void Journal::addDeltaWithoutNotifying(T&& delta, DeltaState& deltaState)
+    const {
   delta.sequenceID = deltaState.nextSequence++;
   delta.time = std::chrono::steady_clock::now();
 
@@ -185,9 +319,116 @@ void Journal::notifySubscribers() const {
   }
 }
 
-void Journal::addDelta(FileChangeJournalDelta&& delta) {
+bool Journal::stageFileChange(StagedAction action, RelativePathPiece path) {
+  if (!stagedWrites_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+
+  auto& shard = stagingShards_
+      [std::hash<std::thread::id>{}(std::this_thread::get_id()) %
+       kNumStagingShards];
+  bool full;
+  {
+    std::lock_guard<std::mutex> guard(shard.lock);
+    shard.changes.push_back(StagedFileChange{
+        nextStagingTicket_.fetch_add(1, std::memory_order_relaxed),
+        action,
+        path.copy()});
+    stagedCount_.fetch_add(1, std::memory_order_release);
+    full = shard.changes.size() >= kStagingBatchSize;
+  }
+  if (full) {
+    auto deltaState = deltaState_.wlock();
+    mergeStagedChanges(*deltaState);
+  }
+  notifySubscribers();
+  return true;
+}
+
+void Journal::mergeStagedChanges() const {
+  if (stagedCount_.load(std::memory_order_acquire) == 0) {
+    return;
+  }
+  auto deltaState = deltaState_.wlock();
+  mergeStagedChanges(*deltaState);
+}
+
+void Journal::mergeStagedChanges(DeltaState& deltaState) const {
+  // Every shard stays locked until all of them are drained. A writer takes
+  // its ticket under its shard's lock, so once every lock is held no change
+  // left behind can have a lower ticket than one drained here. Draining the
+  // shards one at a time would let a later change to a path be merged
+  // before an earlier one still being staged in another shard.
+  std::array<std::unique_lock<std::mutex>, kNumStagingShards> guards;
+  for (size_t i = 0; i < kNumStagingShards; ++i) {
+    guards[i] = std::unique_lock<std::mutex>(stagingShards_[i].lock);
+  }
+  std::vector<StagedFileChange> changes;
+  for (auto& shard : stagingShards_) {
+    if (shard.changes.empty()) {
+      continue;
+    }
+    stagedCount_.fetch_sub(shard.changes.size(), std::memory_order_relaxed);
+    changes.insert(
+        changes.end(),
+        std::make_move_iterator(shard.changes.begin()),
+        std::make_move_iterator(shard.changes.end()));
+    shard.changes.clear();
+  }
+  // Each shard is already in order; the tickets interleave the shards in
+  // the order their changes were staged.
+  std::sort(
+      changes.begin(),
+      changes.end(),
+      [](const StagedFileChange& a, const StagedFileChange& b) {
+        return a.ticket < b.ticket;
+      });
+  for (auto& guard : guards) {
+    guard.unlock();
+  }
+
+  for (auto& change : changes) {
+    auto id = deltaState.paths.intern(change.path.piece());
+    FileChangeJournalDelta delta;
+    switch (change.action) {
+      case StagedAction::Created:
+        delta = FileChangeJournalDelta{id, FileChangeJournalDelta::CREATED};
+        break;
+      case StagedAction::Removed:
+        delta = FileChangeJournalDelta{id, FileChangeJournalDelta::REMOVED};
+        break;
+      case StagedAction::Changed:
+        delta = FileChangeJournalDelta{id, FileChangeJournalDelta::CHANGED};
+        break;
+    }
+    if (deltaState.log) {
+      deltaState.log->appendFileChange(
+          deltaState.nextSequence,
+          {change.path.piece()},
+          delta.info1,
+          delta.info2);
+    }
+    addDeltaWithoutNotifying(std::move(delta), deltaState);
+  }
+}
+
+void Journal::setStagedWrites(bool enabled) {
+  stagedWrites_.store(enabled, std::memory_order_relaxed);
+  if (!enabled) {
+    mergeStagedChanges();
+  }
+}
+
+template <typename Action, typename... Paths>
+void Journal::addFileChange(Action action, Paths... paths) {
   {
     auto deltaState = deltaState_.wlock();
+    mergeStagedChanges(*deltaState);
+    FileChangeJournalDelta delta{deltaState->paths.intern(paths)..., action};
+    if (deltaState->log) {
+      deltaState->log->appendFileChange(
+          deltaState->nextSequence, {paths...}, delta.info1, delta.info2);
+    }
     addDeltaWithoutNotifying(std::move(delta), *deltaState);
   }
   notifySubscribers();
@@ -196,12 +437,20 @@ void Journal::addDelta(FileChangeJournalDelta&& delta) {
 void Journal::addDelta(HashUpdateJournalDelta&& delta, const Hash& newHash) {
   {
     auto deltaState = deltaState_.wlock();
+    mergeStagedChanges(*deltaState);
 
     // If the hashes were not set to anything, default to copying
     // the value from the prior journal entry
     if (delta.fromHash == kZeroHash) {
       delta.fromHash = deltaState->currentHash;
     }
+    if (deltaState->log) {
+      deltaState->log->appendHashUpdate(
+          deltaState->nextSequence,
+          delta.fromHash,
+          newHash,
+          delta.uncleanPaths);
+    }
     addDeltaWithoutNotifying(std::move(delta), *deltaState);
     deltaState->currentHash = newHash;
   }
@@ -209,6 +458,7 @@ void Journal::addDelta(HashUpdateJournalDelta&& delta, const Hash& newHash) {
 }
 
 std::optional<JournalDeltaInfo> Journal::getLatest() const {
+  mergeStagedChanges();
   auto deltaState = deltaState_.rlock();
   if (deltaState->empty()) {
     return std::nullopt;
@@ -264,23 +514,10 @@ bool Journal::isSubscriberValid(uint64_t id) const {
 }
 
 std::optional<JournalStats> Journal::getStats() {
+  mergeStagedChanges();
   return deltaState_.rlock()->stats;
 }
 
-namespace {
-folly::StringPiece eventCharacterizationFor(const PathChangeInfo& ci) {
-  if (ci.existedBefore && !ci.existedAfter) {
-    return "Removed";
-  } else if (!ci.existedBefore && ci.existedAfter) {
-    return "Created";
-  } else if (ci.existedBefore && ci.existedAfter) {
-    return "Changed";
-  } else {
-    return "Ghost";
-  }
-}
-} // namespace
-
 void Journal::setMemoryLimit(size_t limit) {
   auto deltaState = deltaState_.wlock();
   deltaState->memoryLimit = limit;
@@ -292,6 +529,7 @@ size_t Journal::getMemoryLimit() const {
 }
 
 size_t Journal::estimateMemoryUsage() const {
+  mergeStagedChanges();
   return estimateMemoryUsage(*deltaState_.rlock());
 }
 
@@ -310,6 +548,8 @@ size_t Journal::estimateMemoryUsage(const DeltaState& deltaState) const {
   // Account for overhead of deques which have a maximum buffer size of 512.
   memoryUsage += getPaddingAmount(deltaState.fileChangeDeltas);
   memoryUsage += getPaddingAmount(deltaState.hashUpdateDeltas);
+  memoryUsage += deltaState.paths.estimateMemoryUsage();
+  memoryUsage += deltaState.summaryMemoryUsage;
 
   if (deltaState.stats) {
     memoryUsage += deltaState.deltaMemoryUsage;
@@ -320,11 +560,15 @@ size_t Journal::estimateMemoryUsage(const DeltaState& deltaState) const {
 void Journal::flush() {
   {
     auto deltaState = deltaState_.wlock();
+    mergeStagedChanges(*deltaState);
     ++deltaState->nextSequence;
     auto lastHash = deltaState->currentHash;
-    deltaState->fileChangeDeltas.clear();
-    deltaState->hashUpdateDeltas.clear();
-    deltaState->stats = std::nullopt;
+    deltaState->clearDeltas();
+    if (deltaState->log) {
+      deltaState->log->clear();
+      deltaState->log->appendHashUpdate(
+          deltaState->nextSequence, lastHash, lastHash, {});
+    }
     auto delta = HashUpdateJournalDelta();
     /* Tracking the hash correctly when the journal is flushed is important
      * since Watchman uses the hash to correctly determine what additional files
@@ -339,6 +583,79 @@ void Journal::flush() {
   notifySubscribers();
 }
 
+void Journal::DeltaState::clearDeltas() {
+  fileChangeDeltas.clear();
+  hashUpdateDeltas.clear();
+  fileChangeSummaries.clear();
+  summaryMemoryUsage = 0;
+  paths = JournalPathTable();
+  stats = std::nullopt;
+}
+
+void Journal::attachLog(std::unique_ptr<JournalLog> log) {
+  auto deltaState = deltaState_.wlock();
+  DCHECK(deltaState->empty());
+  if (log->isReplayable()) {
+    auto setSequence = [&](SequenceNumber sequence) {
+      if (sequence < deltaState->nextSequence) {
+        throw std::runtime_error("journal log records are out of order");
+      }
+      deltaState->nextSequence = sequence;
+    };
+    try {
+      log->replay(
+          [&](JournalLog::FileChangeRecord&& record) {
+            FileChangeJournalDelta delta;
+            delta.path1 = deltaState->paths.intern(record.path1);
+            delta.info1 = record.info1;
+            delta.isPath1Valid = true;
+            if (record.isPath2Valid) {
+              delta.path2 = deltaState->paths.intern(record.path2);
+              delta.info2 = record.info2;
+              delta.isPath2Valid = true;
+            }
+            setSequence(record.sequence);
+            addDeltaWithoutNotifying(std::move(delta), *deltaState);
+          },
+          [&](JournalLog::HashUpdateRecord&& record) {
+            HashUpdateJournalDelta delta;
+            delta.fromHash = record.fromHash;
+            delta.uncleanPaths = std::move(record.uncleanPaths);
+            setSequence(record.sequence);
+            addDeltaWithoutNotifying(std::move(delta), *deltaState);
+          });
+      deltaState->currentHash = log->getCurrentHash();
+      deltaState->restoredMountGeneration = log->getMountGeneration();
+    } catch (const std::exception& ex) {
+      // Start over rather than answer queries from a partial history.
+      XLOG(ERR) << "unable to replay journal log: " << folly::exceptionStr(ex);
+      deltaState->clearDeltas();
+      deltaState->nextSequence = 1;
+      deltaState->currentHash = kZeroHash;
+      log->clear();
+    }
+  }
+  deltaState->log = std::move(log);
+}
+
+std::optional<uint64_t> Journal::getRestoredMountGeneration() const {
+  return deltaState_.rlock()->restoredMountGeneration;
+}
+
+void Journal::setLogMountGeneration(uint64_t mountGeneration) {
+  auto deltaState = deltaState_.wlock();
+  if (deltaState->log) {
+    deltaState->log->setMountGeneration(mountGeneration);
+  }
+}
+
+void Journal::closeLog() {
+  mergeStagedChanges();
+  std::unique_ptr<JournalLog> log;
+  deltaState_.wlock()->log.swap(log);
+  // log is synced and closed here, outside the lock.
+}
+
 std::unique_ptr<JournalDeltaRange> Journal::accumulateRange() {
   return accumulateRange(1);
 }
@@ -346,70 +663,91 @@ std::unique_ptr<JournalDeltaRange> Journal::accumulateRange() {
 std::unique_ptr<JournalDeltaRange> Journal::accumulateRange(
     SequenceNumber from) {
   DCHECK(from > 0);
+  mergeStagedChanges();
   std::unique_ptr<JournalDeltaRange> result = nullptr;
 
   size_t filesAccumulated = 0;
+  // Accumulate by path ID so each path is only built and hashed once.
+  ChangedPathMap changedPaths;
   auto deltaState = deltaState_.ulock();
+  const auto& paths = deltaState->paths;
   // If this is going to be truncated handle it before iterating.
   if (!deltaState->empty() && deltaState->getFrontSequenceID() > from) {
     result = std::make_unique<JournalDeltaRange>();
     result->isTruncated = true;
   } else {
-    forEachDelta(
-        *deltaState,
-        from,
-        std::nullopt,
-        [&](const FileChangeJournalDelta& current) -> void {
-          ++filesAccumulated;
-          if (!result) {
-            result = std::make_unique<JournalDeltaRange>();
-            result->toSequence = current.sequenceID;
-            result->toTime = current.time;
-            result->toHash = deltaState->currentHash;
-            result->fromHash = deltaState->currentHash;
-          }
-          // Capture the lower bound.
-          result->fromSequence = current.sequenceID;
-          result->fromTime = current.time;
-
-          for (auto& entry : current.getChangedFilesInOverlay()) {
-            auto& name = entry.first;
-            auto& currentInfo = entry.second;
-            auto* resultInfo =
-                folly::get_ptr(result->changedFilesInOverlay, name);
-            if (!resultInfo) {
-              result->changedFilesInOverlay.emplace(name, currentInfo);
-            } else {
-              if (resultInfo->existedBefore != currentInfo.existedAfter) {
-                auto event1 = eventCharacterizationFor(currentInfo);
-                auto event2 = eventCharacterizationFor(*resultInfo);
-                XLOG(ERR) << "Journal for " << name << " holds invalid "
-                          << event1 << ", " << event2 << " sequence";
-              }
-
-              resultInfo->existedBefore = currentInfo.existedBefore;
-            }
-          }
-        },
-        [&](const HashUpdateJournalDelta& current) -> void {
-          if (!result) {
-            result = std::make_unique<JournalDeltaRange>();
-            result->toSequence = current.sequenceID;
-            result->toTime = current.time;
-            result->toHash = deltaState->currentHash;
-          }
-          // Capture the lower bound.
-          result->fromSequence = current.sequenceID;
-          result->fromTime = current.time;
-          result->fromHash = current.fromHash;
-
-          // Merge the unclean status list
-          result->uncleanPaths.insert(
-              current.uncleanPaths.begin(), current.uncleanPaths.end());
-        });
+    const auto& fileChanges = deltaState->fileChangeDeltas;
+    const auto& hashUpdates = deltaState->hashUpdateDeltas;
+    // Both deques are ordered by sequence number, so the start of the range
+    // can be found without walking back from the newest delta.
+    auto fileBegin = findSequence(fileChanges.begin(), fileChanges.end(), from);
+    auto hashBegin = findSequence(hashUpdates.begin(), hashUpdates.end(), from);
+    bool hasFileChanges = fileBegin != fileChanges.end();
+    bool hasHashUpdates = hashBegin != hashUpdates.end();
+
+    if (hasFileChanges || hasHashUpdates) {
+      result = std::make_unique<JournalDeltaRange>();
+      const JournalDelta* newest;
+      const JournalDelta* oldest;
+      if (!hasHashUpdates ||
+          (hasFileChanges &&
+           fileChanges.back().sequenceID > hashUpdates.back().sequenceID)) {
+        newest = &fileChanges.back();
+      } else {
+        newest = &hashUpdates.back();
+      }
+      if (!hasHashUpdates ||
+          (hasFileChanges && fileBegin->sequenceID < hashBegin->sequenceID)) {
+        oldest = &*fileBegin;
+      } else {
+        oldest = &*hashBegin;
+      }
+      result->toSequence = newest->sequenceID;
+      result->toTime = newest->time;
+      result->fromSequence = oldest->sequenceID;
+      result->fromTime = oldest->time;
+      result->toHash = deltaState->currentHash;
+      result->fromHash =
+          hasHashUpdates ? hashBegin->fromHash : deltaState->currentHash;
+      result->containsHashUpdates = hasHashUpdates;
+
+      // Merge the unclean status list
+      for (auto it = hashBegin; it != hashUpdates.end(); ++it) {
+        result->uncleanPaths.insert(
+            it->uncleanPaths.begin(), it->uncleanPaths.end());
+      }
+
+      // Merge the file changes newest first, taking each summary that lies
+      // entirely within the range in place of the deltas it covers.
+      filesAccumulated = fileChanges.end() - fileBegin;
+      auto end = fileChanges.end();
+      const auto& summaries = deltaState->fileChangeSummaries;
+      for (auto summary = summaries.rbegin();
+           summary != summaries.rend() && summary->firstSequence >= from;
+           ++summary) {
+        auto summaryBegin =
+            findSequence(fileBegin, end, summary->firstSequence);
+        mergeOlderDeltas(
+            changedPaths,
+            summaryBegin + kFileChangeSummarySize,
+            end,
+            paths);
+        for (const auto& [id, info] : summary->changedPaths) {
+          mergeOlderChange(changedPaths, id, info, paths);
+        }
+        end = summaryBegin;
+      }
+      mergeOlderDeltas(changedPaths, fileBegin, end, paths);
+    }
   }
 
   if (result) {
+    result->changedFilesInOverlay.reserve(changedPaths.size());
+    for (const auto& entry : changedPaths) {
+      result->changedFilesInOverlay.emplace(
+          paths.lookup(entry.first), entry.second);
+    }
+
     if (edenStats_) {
       if (result->isTruncated) {
         edenStats_->getJournalStatsForCurrentThread().truncatedReads.addValue(
@@ -432,14 +770,16 @@ std::vector<DebugJournalDelta> Journal::getDebugRawJournalInfo(
     SequenceNumber from,
     std::optional<size_t> limit,
     long mountGeneration) const {
+  mergeStagedChanges();
   auto result = std::vector<DebugJournalDelta>();
   auto deltaState = deltaState_.rlock();
   Hash currentHash = deltaState->currentHash;
+  const auto& paths = deltaState->paths;
   forEachDelta(
       *deltaState,
       from,
       limit,
-      [mountGeneration, &result, &currentHash](
+      [mountGeneration, &result, &currentHash, &paths](
           const FileChangeJournalDelta& current) -> void {
         DebugJournalDelta delta;
         JournalPosition fromPosition;
@@ -454,15 +794,14 @@ std::vector<DebugJournalDelta> Journal::getDebugRawJournalInfo(
         toPosition.set_snapshotHash(thriftHash(currentHash));
         delta.set_toPosition(toPosition);
 
-        for (const auto& entry : current.getChangedFilesInOverlay()) {
-          auto& path = entry.first;
-          auto& changeInfo = entry.second;
-
+        current.forEachChangedPath([&](JournalPathTable::Id id,
+                                       const PathChangeInfo& changeInfo) {
           DebugPathChangeInfo debugChangeInfo;
           debugChangeInfo.existedBefore = changeInfo.existedBefore;
           debugChangeInfo.existedAfter = changeInfo.existedAfter;
-          delta.changedPaths.emplace(path.stringPiece().str(), debugChangeInfo);
-        }
+          delta.changedPaths.emplace(
+              paths.lookup(id).stringPiece().str(), debugChangeInfo);
+        });
 
         result.push_back(delta);
       },
@@ -9,12 +9,19 @@
 
 #include <folly/Function.h>
 #include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 #include "eden/fs/journal/JournalDelta.h"
+#include "eden/fs/journal/JournalLog.h"
+#include "eden/fs/journal/JournalPathTable.h"
 #include "eden/fs/service/ThriftUtil.h"
 #include "eden/fs/service/gen-cpp2/StreamingEdenService.h"
 #include "eden/fs/telemetry/EdenStats.h"
@@ -159,6 +166,37 @@ class Journal {
    * */
   void flush();
 
+  /**
+   * Records every future delta in log as well.  If the log was closed cleanly,
+   * its deltas are first replayed into this journal, which must be empty, so
+   * that positions from before the log was closed stay valid.
+   */
+  void attachLog(std::unique_ptr<JournalLog> log);
+
+  /**
+   * The mount generation that the deltas replayed by attachLog() were
+   * recorded for, which the mount should keep using, or nullopt if nothing
+   * was replayed.
+   */
+  std::optional<uint64_t> getRestoredMountGeneration() const;
+
+  /** Sets the mount generation stored in the attached log, if any. */
+  void setLogMountGeneration(uint64_t mountGeneration);
+
+  /**
+   * Syncs and closes the attached log, if any, marking it replayable by the
+   * next process to open it.  No more deltas should be recorded afterwards.
+   */
+  void closeLog();
+
+  /**
+   * Whether recordCreated(), recordRemoved() and recordChanged() stage their
+   * changes in per-thread buffers that are merged into the journal in
+   * batches, instead of each taking the journal lock.  Every other Journal
+   * method merges the staged changes first, so readers still see all of them.
+   */
+  void setStagedWrites(bool enabled);
+
   void setMemoryLimit(size_t limit);
 
   size_t getMemoryLimit() const;
@@ -170,11 +208,57 @@ class Journal {
    * The delta will have a new sequence number and timestamp
    * applied.
    */
-  void addDelta(FileChangeJournalDelta&& delta);
   void addDelta(HashUpdateJournalDelta&& delta, const Hash& newHash);
 
+  /** Interns the given paths and adds a FileChangeJournalDelta for them
+   * to the journal, then notifies subscribers.
+   */
+  template <typename Action, typename... Paths>
+  void addFileChange(Action action, Paths... paths);
+
   static constexpr size_t kDefaultJournalMemoryLimit = 1000000000;
 
+  /** The number of buffers that staged file changes are spread across, by
+   * thread */
+  static constexpr size_t kNumStagingShards = 16;
+
+  /** The number of staged file changes in one buffer that makes the writer
+   * merge every buffer into the journal */
+  static constexpr size_t kStagingBatchSize = 64;
+
+  enum class StagedAction { Created, Removed, Changed };
+
+  struct StagedFileChange {
+    /** Orders the changes staged in different buffers */
+    uint64_t ticket;
+    StagedAction action;
+    RelativePath path;
+  };
+
+  struct StagingShard {
+    std::mutex lock;
+    std::vector<StagedFileChange> changes;
+  };
+
+  /** Stages a file change for setStagedWrites(), then notifies subscribers.
+   * Returns false, without doing anything, if staged writes are disabled. */
+  bool stageFileChange(StagedAction action, RelativePathPiece path);
+
+  /** The number of consecutive file change deltas merged into each
+   * FileChangeSummary */
+  static constexpr size_t kFileChangeSummarySize = 256;
+
+  /** The merged changes of kFileChangeSummarySize consecutive file change
+   * deltas, which lets accumulateRange merge a whole run of deltas at once.
+   * The path IDs are kept alive by the deltas the summary covers, so a
+   * summary is discarded as soon as its first delta is truncated. */
+  struct FileChangeSummary {
+    SequenceNumber firstSequence;
+    folly::F14FastMap<JournalPathTable::Id, PathChangeInfo> changedPaths;
+
+    size_t estimateMemoryUsage() const;
+  };
+
   struct DeltaState {
     /** The sequence number that we'll use for the next entry
      * that we link into the chain */
@@ -183,6 +267,17 @@ class Journal {
      * of the appropriate deque. */
     std::deque<FileChangeJournalDelta> fileChangeDeltas;
     std::deque<HashUpdateJournalDelta> hashUpdateDeltas;
+    /** The paths referenced by fileChangeDeltas */
+    JournalPathTable paths;
+    /** Summaries of the older fileChangeDeltas, ordered by sequence number.
+     * The newest fileChangeDeltas are not summarized until there are
+     * kFileChangeSummarySize of them, which also keeps a delta that may
+     * still be compacted out of any summary. */
+    std::deque<FileChangeSummary> fileChangeSummaries;
+    size_t summaryMemoryUsage = 0;
+    /** The on-disk copy of the deltas, if this journal has one */
+    std::unique_ptr<JournalLog> log;
+    std::optional<uint64_t> restoredMountGeneration;
     Hash currentHash = kZeroHash;
     /** The stats about this Journal up to the latest delta */
     std::optional<JournalStats> stats;
@@ -191,6 +286,14 @@ class Journal {
 
     JournalDeltaPtr frontPtr() noexcept;
     void popFront();
+    void popFrontFileChange();
+    /** Removes every delta, along with the paths and summaries */
+    void clearDeltas();
+    /** Summarizes the newest unsummarized file change deltas if there are
+     * enough of them */
+    void maybeSummarizeFileChanges();
+    /** Releases the references delta holds on its paths */
+    void releasePaths(const FileChangeJournalDelta& delta);
     JournalDeltaPtr backPtr() noexcept;
 
     bool empty() const {
@@ -218,6 +321,7 @@ class Journal {
     }
 
     void appendDelta(FileChangeJournalDelta&& delta) {
+      maybeSummarizeFileChanges();
       fileChangeDeltas.emplace_back(std::move(delta));
     }
 
@@ -233,18 +337,34 @@ class Journal {
       }
     }
   };
-  folly::Synchronized<DeltaState> deltaState_;
+  /** Mutable so that const readers can merge the staged changes first */
+  mutable folly::Synchronized<DeltaState> deltaState_;
+
+  std::atomic<bool> stagedWrites_{false};
+  std::atomic<uint64_t> nextStagingTicket_{0};
+  /** The number of changes in stagingShards_, only updated while holding
+   * the lock of the shard that changed */
+  std::atomic<size_t> stagedCount_{0};
+  mutable std::array<StagingShard, kNumStagingShards> stagingShards_;
+
+  /** Merges the staged changes, if there are any, into the journal */
+  void mergeStagedChanges() const;
+
+  /** Merges the staged changes into deltaState in the order they were
+   * staged, without notifying subscribers.  Must be called while holding the
+   * deltaState_ lock. */
+  void mergeStagedChanges(DeltaState& deltaState) const;
 
   /** Removes the oldest deltas until the memory usage of the journal is below
    * the journal's memory limit.
    */
-  void truncateIfNecessary(DeltaState& deltaState);
+  void truncateIfNecessary(DeltaState& deltaState) const;
 
   /** Tries to compact a new Journal Delta with an old one if possible,
    * returning true if it did compact it and false if not
    */
-  bool compact(FileChangeJournalDelta& delta, DeltaState& deltaState);
-  bool compact(HashUpdateJournalDelta& delta, DeltaState& deltaState);
+  bool compact(FileChangeJournalDelta& delta, DeltaState& deltaState) const;
+  bool compact(HashUpdateJournalDelta& delta, DeltaState& deltaState) const;
 
   struct SubscriberState {
     SubscriberId nextSubscriberId{1};
@@ -257,7 +377,7 @@ class Journal {
    * function.
    */
   template <typename T>
-  void addDeltaWithoutNotifying(T&& delta, DeltaState& deltaState);
+  void addDeltaWithoutNotifying(T&& delta, DeltaState& deltaState) const;
 
   /** Notify subscribers that a change has happened, should be called with no
    * Journal locks held.
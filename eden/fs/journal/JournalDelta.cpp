@@ -12,63 +12,51 @@ namespace facebook {
 namespace eden {
 
 FileChangeJournalDelta::FileChangeJournalDelta(
-    RelativePathPiece fileName,
+    JournalPathTable::Id fileName,
     FileChangeJournalDelta::Created)
-    : path1{fileName.copy()},
+    : path1{fileName},
       info1{PathChangeInfo{false, true}},
       isPath1Valid{true} {}
 
 FileChangeJournalDelta::FileChangeJournalDelta(
-    RelativePathPiece fileName,
+    JournalPathTable::Id fileName,
     FileChangeJournalDelta::Removed)
-    : path1{fileName.copy()},
+    : path1{fileName},
       info1{PathChangeInfo{true, false}},
       isPath1Valid{true} {}
 
 FileChangeJournalDelta::FileChangeJournalDelta(
-    RelativePathPiece fileName,
+    JournalPathTable::Id fileName,
     FileChangeJournalDelta::Changed)
-    : path1{fileName.copy()},
+    : path1{fileName},
       info1{PathChangeInfo{true, true}},
       isPath1Valid{true} {}
 
 FileChangeJournalDelta::FileChangeJournalDelta(
-    RelativePathPiece oldName,
-    RelativePathPiece newName,
+    JournalPathTable::Id oldName,
+    JournalPathTable::Id newName,
     FileChangeJournalDelta::Renamed)
-    : path1{oldName.copy()},
-      path2{newName.copy()},
+    : path1{oldName},
+      path2{newName},
       info1{PathChangeInfo{true, false}},
       info2{PathChangeInfo{false, true}},
       isPath1Valid{true},
       isPath2Valid{true} {}
 
 FileChangeJournalDelta::FileChangeJournalDelta(
-    RelativePathPiece oldName,
-    RelativePathPiece newName,
+    JournalPathTable::Id oldName,
+    JournalPathTable::Id newName,
     FileChangeJournalDelta::Replaced)
-    : path1{oldName.copy()},
-      path2{newName.copy()},
+    : path1{oldName},
+      path2{newName},
       info1{PathChangeInfo{true, false}},
       info2{PathChangeInfo{true, true}},
       isPath1Valid{true},
       isPath2Valid{true} {}
 
 size_t FileChangeJournalDelta::estimateMemoryUsage() const {
-  size_t mem = sizeof(FileChangeJournalDelta);
-
-  /* NOTE: The following code assumes an unordered_set is separated into an
-   * array of buckets, each one being a chain of nodes containing a next
-   * pointer, a key-value pair, and a stored hash
-   */
-  if (isPath1Valid) {
-    mem += facebook::eden::estimateIndirectMemoryUsage(path1);
-  }
-  if (isPath2Valid) {
-    mem += facebook::eden::estimateIndirectMemoryUsage(path2);
-  }
-
-  return mem;
+  // The paths themselves are accounted for by the Journal's JournalPathTable.
+  return sizeof(FileChangeJournalDelta);
 }
 
 size_t HashUpdateJournalDelta::estimateMemoryUsage() const {
@@ -98,18 +86,6 @@ size_t HashUpdateJournalDelta::estimateMemoryUsage() const {
   return mem;
 }
 
-std::unordered_map<RelativePath, PathChangeInfo>
-FileChangeJournalDelta::getChangedFilesInOverlay() const {
-  std::unordered_map<RelativePath, PathChangeInfo> changedFilesInOverlay;
-  if (isPath1Valid) {
-    changedFilesInOverlay[path1] = info1;
-  }
-  if (isPath2Valid) {
-    changedFilesInOverlay[path2] = info2;
-  }
-  return changedFilesInOverlay;
-}
-
 bool FileChangeJournalDelta::isModification() const {
   return isPath1Valid && !isPath2Valid && info1.existedBefore &&
       info1.existedAfter;
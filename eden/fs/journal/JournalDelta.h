@@ -11,6 +11,7 @@
 #include <type_traits>
 #include <unordered_set>
 #include <variant>
+#include "eden/fs/journal/JournalPathTable.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -75,16 +76,16 @@ class FileChangeJournalDelta : public JournalDelta {
   FileChangeJournalDelta& operator=(FileChangeJournalDelta&&) = default;
   FileChangeJournalDelta(const FileChangeJournalDelta&) = delete;
   FileChangeJournalDelta& operator=(const FileChangeJournalDelta&) = delete;
-  FileChangeJournalDelta(RelativePathPiece fileName, Created);
-  FileChangeJournalDelta(RelativePathPiece fileName, Removed);
-  FileChangeJournalDelta(RelativePathPiece fileName, Changed);
+  FileChangeJournalDelta(JournalPathTable::Id fileName, Created);
+  FileChangeJournalDelta(JournalPathTable::Id fileName, Removed);
+  FileChangeJournalDelta(JournalPathTable::Id fileName, Changed);
 
   /**
    * "Renamed" means that that newName was created as a result of the mv(1).
    */
   FileChangeJournalDelta(
-      RelativePathPiece oldName,
-      RelativePathPiece newName,
+      JournalPathTable::Id oldName,
+      JournalPathTable::Id newName,
       Renamed);
 
   /**
@@ -92,20 +93,31 @@ class FileChangeJournalDelta : public JournalDelta {
    * of the mv(1).
    */
   FileChangeJournalDelta(
-      RelativePathPiece oldName,
-      RelativePathPiece newName,
+      JournalPathTable::Id oldName,
+      JournalPathTable::Id newName,
       Replaced);
 
-  /** Which of these paths actually contain information */
-  RelativePath path1;
-  RelativePath path2;
+  /** Which of these paths actually contain information.
+   * The paths are IDs in the Journal's JournalPathTable, which holds a
+   * reference to each of them for as long as this delta is in the Journal. */
+  JournalPathTable::Id path1{JournalPathTable::kRoot};
+  JournalPathTable::Id path2{JournalPathTable::kRoot};
   PathChangeInfo info1;
   PathChangeInfo info2;
   bool isPath1Valid = false;
   bool isPath2Valid = false;
 
-  std::unordered_map<RelativePath, PathChangeInfo> getChangedFilesInOverlay()
-      const;
+  /** Calls func(JournalPathTable::Id, const PathChangeInfo&) for each valid
+   * path in this delta. */
+  template <typename Func>
+  void forEachChangedPath(Func&& func) const {
+    if (isPath1Valid) {
+      func(path1, info1);
+    }
+    if (isPath2Valid) {
+      func(path2, info2);
+    }
+  }
 
   /** Checks whether this delta is a modification */
   bool isModification() const;
@@ -191,6 +203,11 @@ struct JournalDeltaRange {
    * some other operation that changes the snapshot hash */
   std::unordered_set<RelativePath> uncleanPaths;
 
+  /** Whether any delta in this range changed the snapshot hash, even if the
+   * range as a whole ends where it started (e.g. checking out A, B, then A
+   * again). */
+  bool containsHashUpdates = false;
+
   bool isTruncated = false;
   JournalDeltaRange() = default;
   JournalDeltaRange(JournalDeltaRange&&) = default;
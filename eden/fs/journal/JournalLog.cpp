@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/journal/JournalLog.h"
+
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/logging/xlog.h>
+#include <folly/portability/SysMman.h>
+#include <folly/portability/SysStat.h>
+#include <cstring>
+#include <limits>
+
+namespace facebook {
+namespace eden {
+
+namespace {
+constexpr uint32_t kMagic = 0x4c4a4445; // "EDJL"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kPageSize = 4096;
+
+enum State : uint8_t {
+  kOpen = 1,
+  kClosed = 2,
+  // A delta could not be recorded, so the log must not be replayed.
+  kInvalid = 3,
+};
+
+enum RecordType : uint8_t {
+  kFileChange = 1,
+  kHashUpdate = 2,
+};
+
+enum FileChangeFlags : uint8_t {
+  kInfo1ExistedBefore = 1 << 0,
+  kInfo1ExistedAfter = 1 << 1,
+  kInfo2ExistedBefore = 1 << 2,
+  kInfo2ExistedAfter = 1 << 3,
+  kPath2Valid = 1 << 4,
+};
+
+struct RecordHeader {
+  uint64_t sequence;
+  // The size of the whole record, including this header, rounded up to a
+  // multiple of 8 bytes.
+  uint32_t size;
+  uint8_t type;
+  uint8_t flags;
+  uint16_t unused;
+};
+static_assert(sizeof(RecordHeader) == 16, "changing RecordHeader breaks logs");
+
+size_t roundUpRecordSize(size_t size) {
+  return (size + 7) & ~size_t{7};
+}
+
+size_t pathRecordSize(RelativePathPiece path) {
+  return sizeof(uint32_t) + path.stringPiece().size();
+}
+
+uint8_t* writePath(uint8_t* out, RelativePathPiece path) {
+  uint32_t length = path.stringPiece().size();
+  memcpy(out, &length, sizeof(length));
+  memcpy(out + sizeof(length), path.stringPiece().data(), length);
+  return out + sizeof(length) + length;
+}
+
+/** Reads records from one segment, checking that they stay within it. */
+class RecordReader {
+ public:
+  RecordReader(const uint8_t* data, size_t size)
+      : cur_{data}, end_{data + size} {}
+
+  bool atEnd() const {
+    return cur_ == end_;
+  }
+
+  template <typename T>
+  T read() {
+    T value;
+    memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  RelativePath readPath() {
+    auto length = read<uint32_t>();
+    auto data = reinterpret_cast<const char*>(take(length));
+    // The sanity checks catch corrupted paths.
+    return RelativePath{folly::StringPiece{data, length}};
+  }
+
+  Hash readHash() {
+    return Hash{folly::ByteRange{take(Hash::RAW_SIZE), Hash::RAW_SIZE}};
+  }
+
+  const uint8_t* take(size_t size) {
+    if (size > static_cast<size_t>(end_ - cur_)) {
+      throw std::runtime_error("truncated record in journal log");
+    }
+    auto data = cur_;
+    cur_ += size;
+    return data;
+  }
+
+ private:
+  const uint8_t* cur_;
+  const uint8_t* end_;
+};
+} // namespace
+
+struct JournalLog::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t mapSize;
+  uint64_t mountGeneration;
+  uint64_t segmentUsed[2];
+  uint8_t currentHash[Hash::RAW_SIZE];
+  uint8_t state;
+  uint8_t activeSegment;
+  uint8_t hasMountGeneration;
+  uint8_t unused;
+};
+
+std::unique_ptr<JournalLog> JournalLog::open(
+    AbsolutePathPiece path,
+    size_t maxSize) {
+  // A header page and at least a page for each segment.
+  size_t mapSize =
+      std::max(3 * kPageSize, (maxSize + kPageSize - 1) & ~(kPageSize - 1));
+
+  folly::File file{path.stringPiece(), O_RDWR | O_CREAT | O_CLOEXEC, 0600};
+  if (!file.try_lock()) {
+    folly::throwSystemError("failed to acquire lock on ", path);
+  }
+
+  struct stat st;
+  folly::checkUnixError(
+      fstat(file.fd(), &st), "fstat failed on journal log ", path);
+  bool sizeMatches = static_cast<size_t>(st.st_size) == mapSize;
+  if (!sizeMatches) {
+    // Start from an all-zero file of the right size.
+    if (-1 == folly::ftruncateNoInt(file.fd(), 0) ||
+        -1 == folly::ftruncateNoInt(file.fd(), mapSize)) {
+      folly::throwSystemError("failed to resize journal log ", path);
+    }
+  }
+
+  auto map = mmap(
+      nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd(), 0);
+  if (map == MAP_FAILED) {
+    folly::throwSystemError("failed to map journal log ", path);
+  }
+
+  auto& header = *static_cast<Header*>(map);
+  size_t segmentSize = ((mapSize - kPageSize) / 2) & ~size_t{7};
+  bool valid = sizeMatches && header.magic == kMagic &&
+      header.version == kVersion && header.mapSize == mapSize &&
+      header.activeSegment < 2 && header.segmentUsed[0] <= segmentSize &&
+      header.segmentUsed[1] <= segmentSize;
+  if (!valid) {
+    XLOG_IF(WARN, st.st_size != 0)
+        << "discarding invalid journal log " << path;
+    memset(&header, 0, sizeof(header));
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.mapSize = mapSize;
+  }
+
+  bool replayable = valid && header.state == kClosed;
+  if (!replayable) {
+    header.segmentUsed[0] = 0;
+    header.segmentUsed[1] = 0;
+    header.activeSegment = 0;
+    header.hasMountGeneration = 0;
+    memset(header.currentHash, 0, sizeof(header.currentHash));
+  }
+
+  // Mark the log open on disk before anything is appended, so that a crash
+  // from here on leaves it unreplayable.
+  header.state = kOpen;
+  if (msync(map, kPageSize, MS_SYNC) != 0) {
+    auto err = errno;
+    munmap(map, mapSize);
+    folly::throwSystemErrorExplicit(err, "failed to sync journal log ", path);
+  }
+
+  return std::unique_ptr<JournalLog>{
+      new JournalLog{std::move(file), map, mapSize, replayable}};
+}
+
+JournalLog::JournalLog(
+    folly::File file,
+    void* map,
+    size_t mapSize,
+    bool replayable)
+    : file_{std::move(file)},
+      map_{map},
+      mapSize_{mapSize},
+      segmentSize_{((mapSize - kPageSize) / 2) & ~size_t{7}},
+      replayable_{replayable} {}
+
+JournalLog::~JournalLog() {
+  if (header().state == kOpen) {
+    // Only mark the log closed once every record is on disk.
+    if (msync(map_, mapSize_, MS_SYNC) == 0) {
+      header().state = kClosed;
+      if (msync(map_, kPageSize, MS_SYNC) != 0) {
+        XLOG(ERR) << "failed to sync journal log header: "
+                  << folly::errnoStr(errno);
+      }
+    } else {
+      XLOG(ERR) << "failed to sync journal log: " << folly::errnoStr(errno);
+    }
+  }
+  munmap(map_, mapSize_);
+}
+
+JournalLog::Header& JournalLog::header() const {
+  static_assert(sizeof(Header) <= kPageSize, "the header must fit a page");
+  return *static_cast<Header*>(map_);
+}
+
+uint8_t* JournalLog::segment(size_t index) const {
+  return static_cast<uint8_t*>(map_) + kPageSize + index * segmentSize_;
+}
+
+std::optional<uint64_t> JournalLog::getMountGeneration() const {
+  if (!replayable_ || !header().hasMountGeneration) {
+    return std::nullopt;
+  }
+  return header().mountGeneration;
+}
+
+void JournalLog::setMountGeneration(uint64_t mountGeneration) {
+  header().mountGeneration = mountGeneration;
+  header().hasMountGeneration = 1;
+}
+
+Hash JournalLog::getCurrentHash() const {
+  return Hash{folly::ByteRange{header().currentHash, Hash::RAW_SIZE}};
+}
+
+void JournalLog::replay(
+    folly::FunctionRef<void(FileChangeRecord&&)> onFileChange,
+    folly::FunctionRef<void(HashUpdateRecord&&)> onHashUpdate) const {
+  size_t active = header().activeSegment;
+  for (size_t index : {1 - active, active}) {
+    RecordReader segmentReader{segment(index), header().segmentUsed[index]};
+    while (!segmentReader.atEnd()) {
+      auto recordHeader = segmentReader.read<RecordHeader>();
+      if (recordHeader.size < sizeof(RecordHeader) ||
+          recordHeader.size % 8 != 0) {
+        throw std::runtime_error("invalid record size in journal log");
+      }
+      RecordReader reader{segmentReader.take(
+                              recordHeader.size - sizeof(RecordHeader)),
+                          recordHeader.size - sizeof(RecordHeader)};
+
+      switch (recordHeader.type) {
+        case kFileChange: {
+          auto flags = recordHeader.flags;
+          FileChangeRecord record;
+          record.sequence = recordHeader.sequence;
+          record.info1 = PathChangeInfo{(flags & kInfo1ExistedBefore) != 0,
+                                        (flags & kInfo1ExistedAfter) != 0};
+          record.info2 = PathChangeInfo{(flags & kInfo2ExistedBefore) != 0,
+                                        (flags & kInfo2ExistedAfter) != 0};
+          record.isPath2Valid = (flags & kPath2Valid) != 0;
+          record.path1 = reader.readPath();
+          if (record.isPath2Valid) {
+            record.path2 = reader.readPath();
+          }
+          onFileChange(std::move(record));
+          break;
+        }
+        case kHashUpdate: {
+          HashUpdateRecord record;
+          record.sequence = recordHeader.sequence;
+          record.fromHash = reader.readHash();
+          record.toHash = reader.readHash();
+          auto count = reader.read<uint32_t>();
+          for (uint32_t i = 0; i < count; ++i) {
+            record.uncleanPaths.insert(reader.readPath());
+          }
+          onHashUpdate(std::move(record));
+          break;
+        }
+        default:
+          throw std::runtime_error("unknown record type in journal log");
+      }
+    }
+  }
+}
+
+void JournalLog::clear() {
+  header().segmentUsed[0] = 0;
+  header().segmentUsed[1] = 0;
+  header().activeSegment = 0;
+}
+
+uint8_t* JournalLog::allocate(size_t size) {
+  auto& h = header();
+  if (h.state != kOpen) {
+    return nullptr;
+  }
+  if (size > segmentSize_ || size > std::numeric_limits<uint32_t>::max()) {
+    XLOG(WARN) << "journal delta of " << size
+               << " bytes does not fit in the journal log; it will not be "
+               << "replayed after a restart";
+    invalidate();
+    return nullptr;
+  }
+  if (h.segmentUsed[h.activeSegment] + size > segmentSize_) {
+    // Drop the older segment and continue in it.
+    h.activeSegment = 1 - h.activeSegment;
+    h.segmentUsed[h.activeSegment] = 0;
+  }
+  return segment(h.activeSegment) + h.segmentUsed[h.activeSegment];
+}
+
+void JournalLog::commit(size_t size) {
+  header().segmentUsed[header().activeSegment] += size;
+}
+
+void JournalLog::invalidate() {
+  header().state = kInvalid;
+}
+
+void JournalLog::appendFileChange(
+    SequenceNumber sequence,
+    std::initializer_list<RelativePathPiece> paths,
+    const PathChangeInfo& info1,
+    const PathChangeInfo& info2) {
+  DCHECK(paths.size() == 1 || paths.size() == 2);
+  size_t size = sizeof(RecordHeader);
+  for (auto path : paths) {
+    size += pathRecordSize(path);
+  }
+  size = roundUpRecordSize(size);
+
+  auto out = allocate(size);
+  if (!out) {
+    return;
+  }
+
+  RecordHeader recordHeader{};
+  recordHeader.sequence = sequence;
+  recordHeader.size = size;
+  recordHeader.type = kFileChange;
+  recordHeader.flags = (info1.existedBefore ? kInfo1ExistedBefore : 0) |
+      (info1.existedAfter ? kInfo1ExistedAfter : 0) |
+      (info2.existedBefore ? kInfo2ExistedBefore : 0) |
+      (info2.existedAfter ? kInfo2ExistedAfter : 0) |
+      (paths.size() == 2 ? kPath2Valid : 0);
+  memcpy(out, &recordHeader, sizeof(recordHeader));
+  auto cur = out + sizeof(recordHeader);
+  for (auto path : paths) {
+    cur = writePath(cur, path);
+  }
+  commit(size);
+}
+
+void JournalLog::appendHashUpdate(
+    SequenceNumber sequence,
+    const Hash& fromHash,
+    const Hash& toHash,
+    const std::unordered_set<RelativePath>& uncleanPaths) {
+  size_t size = sizeof(RecordHeader) + 2 * Hash::RAW_SIZE + sizeof(uint32_t);
+  for (const auto& path : uncleanPaths) {
+    size += pathRecordSize(path);
+  }
+  size = roundUpRecordSize(size);
+
+  memcpy(header().currentHash, toHash.getBytes().data(), Hash::RAW_SIZE);
+  auto out = allocate(size);
+  if (!out) {
+    return;
+  }
+
+  RecordHeader recordHeader{};
+  recordHeader.sequence = sequence;
+  recordHeader.size = size;
+  recordHeader.type = kHashUpdate;
+  memcpy(out, &recordHeader, sizeof(recordHeader));
+  auto cur = out + sizeof(recordHeader);
+  memcpy(cur, fromHash.getBytes().data(), Hash::RAW_SIZE);
+  cur += Hash::RAW_SIZE;
+  memcpy(cur, toHash.getBytes().data(), Hash::RAW_SIZE);
+  cur += Hash::RAW_SIZE;
+  uint32_t count = uncleanPaths.size();
+  memcpy(cur, &count, sizeof(count));
+  cur += sizeof(count);
+  for (const auto& path : uncleanPaths) {
+    cur = writePath(cur, path);
+  }
+  commit(size);
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <folly/Function.h>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <unordered_set>
+#include "eden/fs/journal/JournalDelta.h"
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * A bounded, memory-mapped, append-only copy of a mount's journal deltas,
+ * kept on disk so that a restarted edenfs can keep answering journal queries
+ * for positions from before the restart.
+ *
+ * The file is a header page followed by two equally sized segments.  Records
+ * are appended to the active segment; when it fills up the other segment is
+ * emptied and becomes the active one, so the log always holds at least the
+ * most recent half of its capacity.
+ *
+ * The log can only be replayed if it was closed cleanly: the header is marked
+ * open (and synced) when the log is opened and only marked closed again,
+ * after all records have been synced, when the log is destroyed.  If edenfs
+ * crashes, or a delta is too large to be recorded, the log is not replayed
+ * and clients get a new mount generation as before.
+ *
+ * JournalLog is not thread-safe; the Journal only uses it with its delta
+ * state locked.
+ */
+class JournalLog {
+ public:
+  using SequenceNumber = JournalDelta::SequenceNumber;
+
+  struct FileChangeRecord {
+    SequenceNumber sequence;
+    RelativePath path1;
+    RelativePath path2;
+    PathChangeInfo info1;
+    PathChangeInfo info2;
+    bool isPath2Valid;
+  };
+
+  struct HashUpdateRecord {
+    SequenceNumber sequence;
+    Hash fromHash;
+    Hash toHash;
+    std::unordered_set<RelativePath> uncleanPaths;
+  };
+
+  /**
+   * Opens the log at path, creating it if necessary, with room for maxSize
+   * bytes.  A file that is not a valid log of that size is replaced with an
+   * empty one.  Throws if the file cannot be opened, locked or mapped.
+   */
+  static std::unique_ptr<JournalLog> open(
+      AbsolutePathPiece path,
+      size_t maxSize);
+
+  JournalLog(const JournalLog&) = delete;
+  JournalLog& operator=(const JournalLog&) = delete;
+
+  /** Syncs the log and marks it as cleanly closed. */
+  ~JournalLog();
+
+  /**
+   * Whether the log was closed cleanly when it was last used, and so holds
+   * every delta recorded since its oldest record.
+   */
+  bool isReplayable() const {
+    return replayable_;
+  }
+
+  /**
+   * The mount generation the log was recorded for, if it is replayable and
+   * one was set.
+   */
+  std::optional<uint64_t> getMountGeneration() const;
+  void setMountGeneration(uint64_t mountGeneration);
+
+  /** The hash the journal was on when the last record was appended. */
+  Hash getCurrentHash() const;
+
+  /**
+   * Calls the matching function for every record in the log, oldest first.
+   * Throws std::runtime_error if a record is corrupt.
+   */
+  void replay(
+      folly::FunctionRef<void(FileChangeRecord&&)> onFileChange,
+      folly::FunctionRef<void(HashUpdateRecord&&)> onHashUpdate) const;
+
+  /** Drops every record, leaving the mount generation alone. */
+  void clear();
+
+  void appendFileChange(
+      SequenceNumber sequence,
+      std::initializer_list<RelativePathPiece> paths,
+      const PathChangeInfo& info1,
+      const PathChangeInfo& info2);
+
+  void appendHashUpdate(
+      SequenceNumber sequence,
+      const Hash& fromHash,
+      const Hash& toHash,
+      const std::unordered_set<RelativePath>& uncleanPaths);
+
+ private:
+  struct Header;
+
+  JournalLog(folly::File file, void* map, size_t mapSize, bool replayable);
+
+  Header& header() const;
+  uint8_t* segment(size_t index) const;
+
+  /**
+   * Returns space for a record of the given size in the active segment,
+   * switching segments if necessary, or nullptr if the record can never fit,
+   * in which case the log is invalidated.
+   */
+  uint8_t* allocate(size_t size);
+  void commit(size_t size);
+  void invalidate();
+
+  folly::File file_;
+  void* map_;
+  size_t mapSize_;
+  size_t segmentSize_;
+  bool replayable_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/journal/JournalPathTable.h"
+
+#include <folly/hash/Hash.h>
+#include <folly/logging/xlog.h>
+#include "eden/fs/utils/Memory.h"
+
+namespace facebook {
+namespace eden {
+
+size_t JournalPathTable::KeyHash::operator()(const Key& key) const {
+  return folly::hash::hash_128_to_64(
+      key.parent, folly::hash::fnv64_buf(key.name.data(), key.name.size()));
+}
+
+JournalPathTable::JournalPathTable() {
+  // The root entry is never freed, so it needs no reference count.
+  entries_.emplace_back();
+}
+
+JournalPathTable::Id JournalPathTable::intern(RelativePathPiece path) {
+  Id id = kRoot;
+  for (auto component : path.components()) {
+    auto name = component.stringPiece();
+    auto it = index_.find(Key{id, name});
+    if (it != index_.end()) {
+      id = it->second;
+      continue;
+    }
+
+    Id child;
+    if (freeIds_.empty()) {
+      child = static_cast<Id>(entries_.size());
+      entries_.emplace_back();
+    } else {
+      child = freeIds_.back();
+      freeIds_.pop_back();
+    }
+    auto& entry = entries_[child];
+    entry.name = name.str();
+    entry.parent = id;
+    entry.refCount = 0;
+    index_.emplace(Key{id, entry.name}, child);
+    // The new entry holds a reference to its parent.
+    ++entries_[id].refCount;
+    id = child;
+  }
+  ++entries_[id].refCount;
+  return id;
+}
+
+void JournalPathTable::release(Id id) {
+  while (id != kRoot) {
+    auto& entry = entries_[id];
+    DCHECK_GT(entry.refCount, 0u);
+    if (--entry.refCount > 0) {
+      return;
+    }
+    index_.erase(Key{entry.parent, entry.name});
+    auto parent = entry.parent;
+    entry.name = std::string{};
+    freeIds_.push_back(id);
+    id = parent;
+  }
+}
+
+RelativePath JournalPathTable::lookup(Id id) const {
+  std::vector<const std::string*> names;
+  size_t length = 0;
+  for (; id != kRoot; id = entries_[id].parent) {
+    names.push_back(&entries_[id].name);
+    length += entries_[id].name.size() + 1;
+  }
+
+  std::string path;
+  if (length > 0) {
+    path.reserve(length - 1);
+  }
+  for (auto it = names.rbegin(); it != names.rend(); ++it) {
+    if (!path.empty()) {
+      path.push_back('/');
+    }
+    path.append(**it);
+  }
+  return RelativePath{std::move(path), detail::SkipPathSanityCheck{}};
+}
+
+size_t JournalPathTable::estimateMemoryUsage() const {
+  size_t mem = entries_.size() * sizeof(Entry);
+  for (const auto& entry : entries_) {
+    mem += estimateIndirectMemoryUsage(entry.name);
+  }
+  mem += freeIds_.capacity() * sizeof(Id);
+  mem += index_.getAllocatedMemorySize();
+  return mem;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/container/F14Map.h>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Stores the paths recorded by the Journal, so that each path is stored once
+ * no matter how many deltas refer to it.
+ *
+ * A path is stored as its last component and the ID of its parent directory,
+ * which is stored the same way, so paths in the same directory share their
+ * prefix too.  Entries are reference counted: every delta that refers to a
+ * path holds a reference, as does every entry to its parent, and an entry is
+ * freed along with its unreferenced parents when its last reference is
+ * released.
+ *
+ * This class is not thread-safe; the Journal only uses it with its delta
+ * state locked.
+ */
+class JournalPathTable {
+ public:
+  using Id = uint32_t;
+
+  /** The ID of the empty path, which is the parent of top-level paths. */
+  static constexpr Id kRoot = 0;
+
+  JournalPathTable();
+
+  // index_ refers to the names stored in entries_, so copying a table would
+  // leave the copy's index pointing into the original.
+  JournalPathTable(const JournalPathTable&) = delete;
+  JournalPathTable& operator=(const JournalPathTable&) = delete;
+  JournalPathTable(JournalPathTable&&) = default;
+  JournalPathTable& operator=(JournalPathTable&&) = default;
+
+  /**
+   * Returns the ID of path, adding it if necessary, and takes a reference to
+   * it that must be given back with release().
+   */
+  Id intern(RelativePathPiece path);
+
+  /** Gives back a reference taken by intern(). */
+  void release(Id id);
+
+  /** Returns the path with the given ID, which must be referenced. */
+  RelativePath lookup(Id id) const;
+
+  /** Returns the number of distinct path components stored. */
+  size_t size() const {
+    return index_.size();
+  }
+
+  /**
+   * Get memory used (in bytes) by the stored paths, not counting
+   * sizeof(JournalPathTable) itself.
+   */
+  size_t estimateMemoryUsage() const;
+
+ private:
+  struct Entry {
+    std::string name;
+    Id parent{kRoot};
+    uint32_t refCount{0};
+  };
+
+  struct Key {
+    Id parent;
+    folly::StringPiece name;
+
+    bool operator==(const Key& other) const {
+      return parent == other.parent && name == other.name;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  // A deque so that the names referenced by index_ never move.
+  std::deque<Entry> entries_;
+  std::vector<Id> freeIds_;
+  folly::F14FastMap<Key, Id, KeyHash> index_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/init/Init.h>
+#include <folly/synchronization/test/Barrier.h>
+#include <gflags/gflags.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "eden/fs/benchharness/AllocationCounter.h"
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/journal/Journal.h"
+
+using namespace facebook::eden;
+
+DEFINE_uint64(threads, 8, "The number of threads recording changes");
+DEFINE_uint64(records, 100000, "Changes recorded by each thread");
+DEFINE_uint64(paths, 10000, "Distinct paths the changes are spread over");
+DEFINE_uint64(subscribers, 4, "Subscribers registered in the subscribed case");
+DEFINE_uint64(
+    memory_limit,
+    16 * 1024 * 1024,
+    "The Journal memory limit while timing accumulateRange(), small enough "
+    "that the oldest deltas are truncated");
+DEFINE_string(
+    distances,
+    "1,10,100,1000,10000,100000,1000000",
+    "Comma-separated numbers of deltas back from the latest that "
+    "accumulateRange() is timed from");
+DEFINE_uint64(accumulations, 100, "accumulateRange() calls per distance");
+
+namespace {
+
+std::vector<RelativePath> makePaths() {
+  std::vector<RelativePath> paths;
+  paths.reserve(FLAGS_paths);
+  for (uint64_t i = 0; i < FLAGS_paths; ++i) {
+    paths.emplace_back(folly::to<std::string>("dir", i % 100, "/file", i));
+  }
+  return paths;
+}
+
+/**
+ * Records FLAGS_records changes from each of FLAGS_threads threads, alternating
+ * between recordCreated() and recordChanged().
+ */
+void benchmarkRecords(
+    const std::vector<RelativePath>& paths,
+    uint64_t subscribers,
+    BenchmarkReport& report) {
+  Journal journal{std::make_shared<EdenStats>()};
+  std::atomic<uint64_t> notifications{0};
+  for (uint64_t i = 0; i < subscribers; ++i) {
+    journal.registerSubscriber(
+        [&] { notifications.fetch_add(1, std::memory_order_relaxed); });
+  }
+
+  auto label = folly::to<std::string>(subscribers, " subscribers");
+  std::vector<HistogramAccumulator> latencies(FLAGS_threads);
+  std::vector<AllocationAccumulator> changedAllocations(FLAGS_threads);
+  folly::test::Barrier gate{static_cast<unsigned>(FLAGS_threads + 1)};
+  std::vector<std::thread> threads;
+  threads.reserve(FLAGS_threads);
+  for (uint64_t t = 0; t < FLAGS_threads; ++t) {
+    threads.emplace_back([&, t] {
+      auto& latency = latencies[t];
+      gate.wait();
+      for (uint64_t i = 0; i < FLAGS_records; ++i) {
+        const auto& path = paths[(t * FLAGS_records + i) % paths.size()];
+        auto start = getTime();
+        if (i % 2) {
+          AllocationScope scope{changedAllocations[t]};
+          journal.recordChanged(path);
+        } else {
+          journal.recordCreated(path);
+        }
+        latency.add(getTime() - start);
+      }
+    });
+  }
+
+  gate.wait();
+  auto start = getTime();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto elapsed = getTime() - start;
+
+  for (const auto& latency : latencies) {
+    report.metric(folly::to<std::string>(label, " record"), "ns")
+        .combine(latency);
+  }
+  AllocationAccumulator allocations;
+  for (const auto& threadAllocations : changedAllocations) {
+    allocations.combine(threadAllocations);
+  }
+  allocations.addTo(
+      report, folly::to<std::string>(label, " Journal::recordChanged"));
+  report.metric(folly::to<std::string>(label, " throughput"), "records/s")
+      .add(FLAGS_threads * FLAGS_records * 1000000000ull / elapsed);
+  journal.cancelAllSubscribers();
+}
+
+void benchmarkAccumulateRange(
+    const std::vector<RelativePath>& paths,
+    const std::vector<uint64_t>& distances,
+    BenchmarkReport& report) {
+  Journal journal{std::make_shared<EdenStats>()};
+  journal.setMemoryLimit(FLAGS_memory_limit);
+
+  uint64_t maxDistance = 0;
+  for (auto distance : distances) {
+    maxDistance = std::max(maxDistance, distance);
+  }
+  for (uint64_t i = 0; i < maxDistance; ++i) {
+    journal.recordChanged(paths[i % paths.size()]);
+  }
+
+  auto stats = journal.getStats();
+  if (stats && stats->entryCount) {
+    report.metric("memory per delta", "bytes")
+        .add(journal.estimateMemoryUsage() / stats->entryCount);
+    report.metric("retained deltas", "count").add(stats->entryCount);
+  }
+
+  auto latest = journal.getLatest()->sequenceID;
+  for (auto distance : distances) {
+    auto from = latest >= distance ? latest - distance + 1 : 1;
+    auto label = folly::to<std::string>("accumulateRange(", distance, " back)");
+    auto& latency = report.metric(label, "ns");
+    uint64_t truncated = 0;
+    for (uint64_t i = 0; i < FLAGS_accumulations; ++i) {
+      auto start = getTime();
+      auto range = journal.accumulateRange(from);
+      latency.add(getTime() - start);
+      if (range && range->isTruncated) {
+        ++truncated;
+      }
+    }
+    report.metric(label + " truncated", "count").add(truncated);
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv);
+
+  if (!FLAGS_threads || !FLAGS_paths) {
+    fprintf(stderr, "--threads and --paths must be nonzero\n");
+    return 1;
+  }
+  std::vector<uint64_t> distances;
+  folly::split(',', FLAGS_distances, distances, /*ignoreEmpty=*/true);
+
+  auto paths = makePaths();
+  return runBenchmark("journal", [&](BenchmarkReport& report) {
+    benchmarkRecords(paths, 0, report);
+    if (FLAGS_subscribers) {
+      benchmarkRecords(paths, FLAGS_subscribers, report);
+    }
+    benchmarkAccumulateRange(paths, distances, report);
+  });
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/journal/JournalLog.h"
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <gtest/gtest.h>
+#include "eden/fs/journal/Journal.h"
+
+using namespace facebook::eden;
+using folly::test::TemporaryDirectory;
+
+namespace {
+struct JournalLogTest : ::testing::Test {
+  JournalLogTest()
+      : tmpDir{"eden_journal_log_"},
+        logPath{AbsolutePath{tmpDir.path().string()} + "journal"_pc} {}
+
+  std::unique_ptr<Journal> makeJournal(size_t logSize = 1024 * 1024) {
+    auto journal = std::make_unique<Journal>(std::make_shared<EdenStats>());
+    journal->attachLog(JournalLog::open(logPath, logSize));
+    return journal;
+  }
+
+  TemporaryDirectory tmpDir;
+  AbsolutePath logPath;
+};
+} // namespace
+
+TEST_F(JournalLogTest, new_log_is_not_replayed) {
+  auto journal = makeJournal();
+  EXPECT_FALSE(journal->getLatest());
+  EXPECT_EQ(std::nullopt, journal->getRestoredMountGeneration());
+}
+
+TEST_F(JournalLogTest, replays_after_clean_close) {
+  auto hash1 = Hash("1111111111111111111111111111111111111111");
+  auto hash2 = Hash("2222222222222222222222222222222222222222");
+  Journal::SequenceNumber latest;
+  {
+    auto journal = makeJournal();
+    journal->setLogMountGeneration(1234);
+    journal->recordHashUpdate(hash1);
+    journal->recordCreated("dir/created"_relpath);
+    journal->recordChanged("dir/changed"_relpath);
+    journal->recordRenamed("dir/old"_relpath, "dir/new"_relpath);
+    auto uncleanPaths = std::unordered_set<RelativePath>();
+    uncleanPaths.insert(RelativePath("dir/unclean"));
+    journal->recordUncleanPaths(hash1, hash2, std::move(uncleanPaths));
+    journal->recordRemoved("dir/created"_relpath);
+    latest = journal->getLatest()->sequenceID;
+    journal->closeLog();
+  }
+
+  auto journal = makeJournal();
+  EXPECT_EQ(1234, journal->getRestoredMountGeneration());
+  ASSERT_TRUE(journal->getLatest());
+  EXPECT_EQ(latest, journal->getLatest()->sequenceID);
+  EXPECT_EQ(hash2, journal->getLatest()->toHash);
+
+  auto summed = journal->accumulateRange(2);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_FALSE(summed->isTruncated);
+  EXPECT_EQ(hash1, summed->fromHash);
+  EXPECT_EQ(hash2, summed->toHash);
+  EXPECT_TRUE(summed->containsHashUpdates);
+  EXPECT_EQ(1, summed->uncleanPaths.count(RelativePath("dir/unclean")));
+  EXPECT_EQ(4, summed->changedFilesInOverlay.size());
+  EXPECT_EQ(
+      (PathChangeInfo{false, false}),
+      summed->changedFilesInOverlay[RelativePath{"dir/created"}]);
+  EXPECT_EQ(
+      (PathChangeInfo{true, true}),
+      summed->changedFilesInOverlay[RelativePath{"dir/changed"}]);
+  EXPECT_EQ(
+      (PathChangeInfo{true, false}),
+      summed->changedFilesInOverlay[RelativePath{"dir/old"}]);
+  EXPECT_EQ(
+      (PathChangeInfo{false, true}),
+      summed->changedFilesInOverlay[RelativePath{"dir/new"}]);
+
+  // New deltas continue the replayed sequence.
+  journal->recordChanged("dir/changed2"_relpath);
+  EXPECT_EQ(latest + 1, journal->getLatest()->sequenceID);
+}
+
+TEST_F(JournalLogTest, log_left_open_is_not_replayed) {
+  auto journal = makeJournal();
+  journal->setLogMountGeneration(1234);
+  journal->recordCreated("file"_relpath);
+
+  // Copy the log while it is still open, as if edenfs had crashed.
+  std::string contents;
+  ASSERT_TRUE(folly::readFile(logPath.c_str(), contents));
+  auto copyPath = AbsolutePath{tmpDir.path().string()} + "copy"_pc;
+  ASSERT_TRUE(folly::writeFile(contents, copyPath.c_str()));
+
+  auto restored = std::make_unique<Journal>(std::make_shared<EdenStats>());
+  restored->attachLog(JournalLog::open(copyPath, 1024 * 1024));
+  EXPECT_FALSE(restored->getLatest());
+  EXPECT_EQ(std::nullopt, restored->getRestoredMountGeneration());
+}
+
+TEST_F(JournalLogTest, keeps_most_recent_deltas_when_full) {
+  constexpr size_t kLogSize = 3 * 4096;
+  constexpr int kDeltas = 1000;
+  {
+    auto journal = makeJournal(kLogSize);
+    for (int i = 0; i < kDeltas; ++i) {
+      journal->recordCreated(
+          RelativePath{folly::to<std::string>("dir/file", i)});
+    }
+  }
+
+  auto journal = makeJournal(kLogSize);
+  ASSERT_TRUE(journal->getLatest());
+  EXPECT_EQ(kDeltas, journal->getLatest()->sequenceID);
+
+  // The oldest deltas were dropped, so reading from them is truncated.
+  auto summed = journal->accumulateRange(1);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_TRUE(summed->isTruncated);
+  summed = journal->accumulateRange(kDeltas);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_FALSE(summed->isTruncated);
+  EXPECT_EQ(1, summed->changedFilesInOverlay.size());
+}
+
+TEST_F(JournalLogTest, flush_truncates_replayed_positions) {
+  {
+    auto journal = makeJournal();
+    journal->recordCreated("file1"_relpath);
+    journal->recordCreated("file2"_relpath);
+    journal->flush();
+  }
+
+  auto journal = makeJournal();
+  auto summed = journal->accumulateRange(1);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_TRUE(summed->isTruncated);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/journal/JournalPathTable.h"
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+
+TEST(JournalPathTable, intern_returns_same_id_for_same_path) {
+  JournalPathTable table;
+  auto id1 = table.intern("foo/bar"_relpath);
+  auto id2 = table.intern("foo/bar"_relpath);
+  auto id3 = table.intern("foo/baz"_relpath);
+  EXPECT_EQ(id1, id2);
+  EXPECT_NE(id1, id3);
+  EXPECT_EQ("foo/bar"_relpath, table.lookup(id1));
+  EXPECT_EQ("foo/baz"_relpath, table.lookup(id3));
+}
+
+TEST(JournalPathTable, paths_share_directory_prefix) {
+  JournalPathTable table;
+  table.intern("a/b/c"_relpath);
+  // a, a/b and a/b/c
+  EXPECT_EQ(3, table.size());
+  table.intern("a/b/d"_relpath);
+  EXPECT_EQ(4, table.size());
+  auto dir = table.intern("a/b"_relpath);
+  EXPECT_EQ(4, table.size());
+  EXPECT_EQ("a/b"_relpath, table.lookup(dir));
+}
+
+TEST(JournalPathTable, release_frees_unreferenced_entries) {
+  JournalPathTable table;
+  auto id1 = table.intern("a/b/c"_relpath);
+  auto id2 = table.intern("a/b/c"_relpath);
+  auto id3 = table.intern("a/d"_relpath);
+  EXPECT_EQ(4, table.size());
+
+  table.release(id1);
+  EXPECT_EQ(4, table.size());
+  EXPECT_EQ("a/b/c"_relpath, table.lookup(id2));
+
+  // Releasing the last reference to a/b/c also frees a/b, but a is still
+  // referenced by a/d.
+  table.release(id2);
+  EXPECT_EQ(2, table.size());
+  EXPECT_EQ("a/d"_relpath, table.lookup(id3));
+
+  table.release(id3);
+  EXPECT_EQ(0, table.size());
+}
+
+TEST(JournalPathTable, released_ids_are_reused) {
+  JournalPathTable table;
+  auto id1 = table.intern("foo"_relpath);
+  table.release(id1);
+  auto id2 = table.intern("bar"_relpath);
+  EXPECT_EQ(id1, id2);
+  EXPECT_EQ("bar"_relpath, table.lookup(id2));
+}
+
+TEST(JournalPathTable, memory_usage_grows_with_new_paths) {
+  JournalPathTable table;
+  auto before = table.estimateMemoryUsage();
+  table.intern("some/long/directory/name/file_with_a_long_name.txt"_relpath);
+  EXPECT_GT(table.estimateMemoryUsage(), before);
+}
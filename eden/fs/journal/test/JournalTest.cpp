@@ -6,8 +6,12 @@
  */
 
 #include "eden/fs/journal/Journal.h"
+#include <folly/Conv.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 using namespace facebook::eden;
 
@@ -176,6 +180,15 @@ TEST(Journal, accumulate_range_with_hash_updates) {
 
   journal.recordChanged("foo/bar"_relpath);
   checkHashMatches(hash1, hash1, journal);
+
+  // File changes alone do not count as hash updates, but any range that spans
+  // one reports it.
+  auto fileOnly = journal.accumulateRange(journal.getLatest()->sequenceID);
+  ASSERT_NE(nullptr, fileOnly);
+  EXPECT_FALSE(fileOnly->containsHashUpdates);
+  auto all = journal.accumulateRange();
+  ASSERT_NE(nullptr, all);
+  EXPECT_TRUE(all->containsHashUpdates);
 }
 
 TEST(Journal, debugRawJournalInfoRemoveCreateUpdate) {
@@ -513,3 +526,155 @@ TEST(Journal, compaction) {
   EXPECT_EQ(3, summed->toSequence);
   EXPECT_EQ(1, summed->changedFilesInOverlay.size());
 }
+
+TEST(Journal, accumulate_range_across_summarized_deltas) {
+  Journal journal(std::make_shared<EdenStats>());
+  auto hash1 = Hash("1111111111111111111111111111111111111111");
+  auto hash2 = Hash("2222222222222222222222222222222222222222");
+
+  struct Op {
+    Journal::SequenceNumber sequence;
+    int file;
+    bool created;
+  };
+  std::vector<Op> ops;
+  std::vector<Journal::SequenceNumber> hashUpdates;
+  // Enough deltas for several summaries, with each file alternately created
+  // and removed and a hash update every so often.
+  constexpr int kFiles = 37;
+  for (int i = 0; i < 1500; ++i) {
+    auto file = i % kFiles;
+    bool created = (i / kFiles) % 2 == 0;
+    auto path = RelativePath(folly::to<std::string>("dir/file", file));
+    if (created) {
+      journal.recordCreated(path);
+    } else {
+      journal.recordRemoved(path);
+    }
+    ops.push_back({journal.getLatest()->sequenceID, file, created});
+    if (i % 101 == 100) {
+      journal.recordHashUpdate(hashUpdates.size() % 2 ? hash1 : hash2);
+      hashUpdates.push_back(journal.getLatest()->sequenceID);
+    }
+  }
+
+  auto latest = journal.getLatest()->sequenceID;
+  for (Journal::SequenceNumber from = 1; from <= latest; from += 13) {
+    std::unordered_map<RelativePath, PathChangeInfo> expected;
+    for (auto it = ops.rbegin(); it != ops.rend() && it->sequence >= from;
+         ++it) {
+      auto path = RelativePath(folly::to<std::string>("dir/file", it->file));
+      auto& info = expected.emplace(path, PathChangeInfo{false, it->created})
+                       .first->second;
+      // Created means the file did not exist before this delta.
+      info.existedBefore = !it->created;
+    }
+    auto firstOp = std::find_if(ops.begin(), ops.end(), [&](const Op& op) {
+      return op.sequence >= from;
+    });
+    auto firstHash =
+        std::lower_bound(hashUpdates.begin(), hashUpdates.end(), from);
+
+    auto summed = journal.accumulateRange(from);
+    ASSERT_NE(nullptr, summed);
+    EXPECT_FALSE(summed->isTruncated);
+    EXPECT_EQ(latest, summed->toSequence);
+    auto expectedFrom = firstOp->sequence;
+    if (firstHash != hashUpdates.end()) {
+      expectedFrom = std::min(expectedFrom, *firstHash);
+    }
+    EXPECT_EQ(expectedFrom, summed->fromSequence) << "from " << from;
+    EXPECT_EQ(firstHash != hashUpdates.end(), summed->containsHashUpdates);
+    EXPECT_EQ(expected, summed->changedFilesInOverlay) << "from " << from;
+  }
+}
+
+TEST(Journal, staged_writes_are_visible_to_readers) {
+  Journal journal(std::make_shared<EdenStats>());
+  journal.setStagedWrites(true);
+  size_t notifications = 0;
+  journal.registerSubscriber([&] { ++notifications; });
+
+  journal.recordCreated("a"_relpath);
+  journal.recordChanged("b"_relpath);
+  EXPECT_EQ(2, notifications);
+  auto latest = journal.getLatest();
+  ASSERT_TRUE(latest);
+  EXPECT_EQ(2, latest->sequenceID);
+
+  // Changes that aren't staged are ordered after the staged ones.
+  journal.recordCreated("c"_relpath);
+  journal.recordRenamed("c"_relpath, "d"_relpath);
+  auto summed = journal.accumulateRange(3);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_EQ(3, summed->fromSequence);
+  EXPECT_EQ(4, summed->toSequence);
+  EXPECT_EQ(
+      (PathChangeInfo{false, false}),
+      summed->changedFilesInOverlay.at(RelativePath{"c"}));
+  EXPECT_EQ(
+      (PathChangeInfo{false, true}),
+      summed->changedFilesInOverlay.at(RelativePath{"d"}));
+  EXPECT_EQ(4, journal.getStats()->entryCount);
+}
+
+TEST(Journal, staged_writes_from_many_threads) {
+  Journal journal(std::make_shared<EdenStats>());
+  journal.setStagedWrites(true);
+  constexpr size_t kThreads = 8;
+  constexpr size_t kWritesPerThread = 500;
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&journal, t] {
+      for (size_t i = 0; i < kWritesPerThread; ++i) {
+        journal.recordCreated(
+            RelativePath{folly::to<std::string>("dir", t, "/file", i)});
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto latest = journal.getLatest();
+  ASSERT_TRUE(latest);
+  EXPECT_EQ(kThreads * kWritesPerThread, latest->sequenceID);
+  auto summed = journal.accumulateRange();
+  ASSERT_NE(nullptr, summed);
+  EXPECT_EQ(kThreads * kWritesPerThread, summed->changedFilesInOverlay.size());
+}
+
+TEST(Journal, staged_writes_keep_their_order_across_threads) {
+  Journal journal(std::make_shared<EdenStats>());
+  journal.setStagedWrites(true);
+  constexpr size_t kFiles = 2000;
+
+  // Each file is created on one thread and then removed on another, so the
+  // two changes are staged in different shards while merges run
+  // concurrently.
+  std::atomic<size_t> created{0};
+  std::thread creator([&] {
+    for (size_t i = 0; i < kFiles; ++i) {
+      journal.recordCreated(RelativePath{folly::to<std::string>("file", i)});
+      created.store(i + 1, std::memory_order_release);
+    }
+  });
+  std::thread remover([&] {
+    for (size_t i = 0; i < kFiles; ++i) {
+      while (created.load(std::memory_order_acquire) <= i) {
+        std::this_thread::yield();
+      }
+      journal.recordRemoved(RelativePath{folly::to<std::string>("file", i)});
+    }
+  });
+  creator.join();
+  remover.join();
+
+  auto summed = journal.accumulateRange();
+  ASSERT_NE(nullptr, summed);
+  ASSERT_EQ(kFiles, summed->changedFilesInOverlay.size());
+  for (const auto& entry : summed->changedFilesInOverlay) {
+    EXPECT_EQ((PathChangeInfo{false, false}), entry.second) << entry.first;
+  }
+}
@@ -9,12 +9,16 @@
 
 #include <folly/Conv.h>
 #include <folly/Format.h>
-#include <folly/String.h>
+#include <folly/hash/Hash.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/ssl/OpenSSLHash.h>
 #include <string>
 
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
 using folly::ByteRange;
 using folly::range;
 using folly::ssl::OpenSSLHash;
@@ -28,21 +32,57 @@ const Hash kEmptySha1{Hash::Storage{0xda, 0x39, 0xa3, 0xee, 0x5e, 0x6b, 0x4b,
                                     0x0d, 0x32, 0x55, 0xbf, 0xef, 0x95, 0x60,
                                     0x18, 0x90, 0xaf, 0xd8, 0x07, 0x09}};
 
+namespace {
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+/** Writes the 2 * RAW_SIZE lowercase hex digits of bytes to out. */
+void writeHex(const uint8_t* bytes, char* out) {
+  size_t i = 0;
+#ifdef __SSSE3__
+  // Split the first 16 bytes into nibbles, translate all 32 of them to
+  // digits with a single shuffle, and interleave them back in order.
+  static_assert(Hash::RAW_SIZE >= 16, "Hash is shorter than a vector");
+  const __m128i digits = _mm_setr_epi8(
+      '0', '1', '2', '3', '4', '5', '6', '7',
+      '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+  __m128i high = _mm_shuffle_epi8(
+      digits, _mm_and_si128(_mm_srli_epi64(input, 4), mask));
+  __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(input, mask));
+  _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(high, low));
+  _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(high, low));
+  i = 16;
+#endif
+  for (; i < Hash::RAW_SIZE; ++i) {
+    out[i * 2] = kHexDigits[bytes[i] >> 4];
+    out[i * 2 + 1] = kHexDigits[bytes[i] & 0x0f];
+  }
+}
+} // namespace
+
 folly::MutableByteRange Hash::mutableBytes() {
   return folly::MutableByteRange{bytes_.data(), bytes_.size()};
 }
 
 std::string Hash::toString() const {
-  std::string result;
-  folly::hexlify(bytes_, result);
+  std::string result(RAW_SIZE * 2, '\0');
+  writeHex(bytes_.data(), &result[0]);
   return result;
 }
 
 size_t Hash::getHashCode() const noexcept {
-  static_assert(sizeof(size_t) <= RAW_SIZE, "crazy size_t type");
-  size_t result;
-  memcpy(&result, bytes_.data(), sizeof(size_t));
-  return result;
+  static_assert(RAW_SIZE == 20, "getHashCode reads exactly 20 bytes");
+  uint64_t first;
+  uint64_t second;
+  uint32_t third;
+  memcpy(&first, bytes_.data(), sizeof(first));
+  memcpy(&second, bytes_.data() + 8, sizeof(second));
+  memcpy(&third, bytes_.data() + 16, sizeof(third));
+  return folly::hash::hash_128_to_64(
+      folly::hash::hash_128_to_64(first, second), third);
 }
 
 bool Hash::operator==(const Hash& otherHash) const {
@@ -75,7 +115,9 @@ std::ostream& operator<<(std::ostream& os, const Hash& hash) {
 }
 
 void toAppend(const Hash& hash, std::string* result) {
-  folly::toAppend(hash.toString(), result);
+  auto offset = result->size();
+  result->resize(offset + Hash::RAW_SIZE * 2);
+  writeHex(hash.getBytes().data(), &(*result)[offset]);
 }
 } // namespace eden
 } // namespace facebook
@@ -20,6 +20,31 @@ class IOBuf;
 namespace facebook {
 namespace eden {
 
+namespace detail {
+constexpr uint8_t kInvalidHexDigit = 0xff;
+
+constexpr std::array<uint8_t, 256> makeHexDigitTable() {
+  std::array<uint8_t, 256> table{};
+  for (auto& value : table) {
+    value = kInvalidHexDigit;
+  }
+  for (uint8_t i = 0; i < 10; ++i) {
+    table['0' + i] = i;
+  }
+  for (uint8_t i = 0; i < 6; ++i) {
+    table['a' + i] = 10 + i;
+    table['A' + i] = 10 + i;
+  }
+  return table;
+}
+
+/**
+ * Maps every byte to the value of the hex digit it spells, or
+ * kInvalidHexDigit, so parsing a hash is one lookup per character.
+ */
+constexpr std::array<uint8_t, 256> kHexDigitValues = makeHexDigitTable();
+} // namespace detail
+
 /**
  * Immutable 160-bit hash.
  */
@@ -62,6 +87,10 @@ class Hash : boost::totally_ordered<Hash> {
   /** @return 40-character [lowercase] hex representation of this hash. */
   std::string toString() const;
 
+  /**
+   * Mixes all 20 bytes, since not every Hash is a uniformly distributed
+   * SHA-1: synthetic hashes often differ only in their trailing bytes.
+   */
   size_t getHashCode() const noexcept;
 
   bool operator==(const Hash&) const;
@@ -101,16 +130,12 @@ class Hash : boost::totally_ordered<Hash> {
         nibbleToHex(hex.data()[(index * 2) + 1]);
   }
   static constexpr uint8_t nibbleToHex(char c) {
-    if ('0' <= c && c <= '9') {
-      return c - '0';
-    } else if ('a' <= c && c <= 'f') {
-      return 10 + c - 'a';
-    } else if ('A' <= c && c <= 'F') {
-      return 10 + c - 'A';
-    } else {
+    auto value = detail::kHexDigitValues[static_cast<uint8_t>(c)];
+    if (value == detail::kInvalidHexDigit) {
       throwInvalidArgument(
           "invalid hex digit supplied to Hash constructor from string: ", c);
     }
+    return value;
   }
 
   [[noreturn]] static void throwInvalidArgument(
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/SerializedTree.h"
+
+#include <folly/Format.h>
+#include <folly/lang/Bits.h>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+using folly::IOBuf;
+using folly::StringPiece;
+using std::invalid_argument;
+
+namespace facebook {
+namespace eden {
+
+namespace {
+constexpr uint8_t kHasSize = 0x01;
+constexpr uint8_t kHasContentSha1 = 0x02;
+
+constexpr size_t kHeaderSize = sizeof(uint8_t) + sizeof(uint32_t);
+constexpr size_t kRecordHeaderSize = 2 * sizeof(uint8_t) + Hash::RAW_SIZE;
+
+size_t optionalFieldsSize(uint8_t flags) {
+  return ((flags & kHasSize) ? sizeof(uint64_t) : 0) +
+      ((flags & kHasContentSha1) ? Hash::RAW_SIZE : 0);
+}
+
+uint8_t flagsForEntry(const TreeEntry& entry) {
+  return (entry.getSize() ? kHasSize : 0) |
+      (entry.getContentSha1() ? kHasContentSha1 : 0);
+}
+
+template <typename T>
+void writeLittleEndian(uint8_t*& out, T value) {
+  value = folly::Endian::little(value);
+  memcpy(out, &value, sizeof(value));
+  out += sizeof(value);
+}
+
+void writeByte(uint8_t*& out, uint8_t value) {
+  *out++ = value;
+}
+
+void writeBytes(uint8_t*& out, folly::ByteRange bytes) {
+  memcpy(out, bytes.data(), bytes.size());
+  out += bytes.size();
+}
+} // namespace
+
+IOBuf SerializedTree::serialize(const std::vector<TreeEntry>& entries) {
+  size_t totalSize = kHeaderSize + (entries.size() + 1) * sizeof(uint32_t);
+  for (const auto& entry : entries) {
+    totalSize += kRecordHeaderSize + optionalFieldsSize(flagsForEntry(entry)) +
+        entry.getName().stringPiece().size();
+  }
+  if (totalSize > std::numeric_limits<uint32_t>::max()) {
+    throw invalid_argument(folly::sformat(
+        "tree with {} entries is too large to serialize", entries.size()));
+  }
+
+  IOBuf buf{IOBuf::CREATE, totalSize};
+  auto* out = buf.writableData();
+  writeByte(out, kVersion);
+  writeLittleEndian(out, static_cast<uint32_t>(entries.size()));
+
+  auto offset = kHeaderSize + (entries.size() + 1) * sizeof(uint32_t);
+  for (const auto& entry : entries) {
+    writeLittleEndian(out, static_cast<uint32_t>(offset));
+    offset += kRecordHeaderSize + optionalFieldsSize(flagsForEntry(entry)) +
+        entry.getName().stringPiece().size();
+  }
+  writeLittleEndian(out, static_cast<uint32_t>(offset));
+
+  for (const auto& entry : entries) {
+    auto flags = flagsForEntry(entry);
+    writeByte(out, static_cast<uint8_t>(entry.getType()));
+    writeByte(out, flags);
+    writeBytes(out, entry.getHash().getBytes());
+    if (flags & kHasSize) {
+      writeLittleEndian(out, static_cast<uint64_t>(*entry.getSize()));
+    }
+    if (flags & kHasContentSha1) {
+      writeBytes(out, entry.getContentSha1()->getBytes());
+    }
+    writeBytes(out, folly::ByteRange{entry.getName().stringPiece()});
+  }
+
+  buf.append(totalSize);
+  return buf;
+}
+
+SerializedTree::SerializedTree(std::string data) : data_{std::move(data)} {
+  if (data_.size() < kHeaderSize ||
+      static_cast<uint8_t>(data_[0]) != kVersion) {
+    throw invalid_argument("serialized tree has an unknown version");
+  }
+  count_ = readUint32(sizeof(uint8_t));
+
+  uint64_t tableEnd =
+      kHeaderSize + (static_cast<uint64_t>(count_) + 1) * sizeof(uint32_t);
+  if (tableEnd > data_.size()) {
+    throw invalid_argument(folly::sformat(
+        "serialized tree of {} bytes is too short for {} entries",
+        data_.size(),
+        count_));
+  }
+  if (recordStart(0) != tableEnd || recordStart(count_) != data_.size()) {
+    throw invalid_argument("serialized tree has a bad offset table");
+  }
+
+  for (size_t index = 0; index < count_; ++index) {
+    auto start = recordStart(index);
+    auto end = recordStart(index + 1);
+    if (end < start + kRecordHeaderSize) {
+      throw invalid_argument(
+          folly::sformat("serialized tree entry {} is truncated", index));
+    }
+    auto type = static_cast<uint8_t>(data_[start]);
+    auto flags = static_cast<uint8_t>(data_[start + 1]);
+    if (type > static_cast<uint8_t>(TreeEntryType::SYMLINK) ||
+        (flags & ~(kHasSize | kHasContentSha1)) != 0) {
+      throw invalid_argument(
+          folly::sformat("serialized tree entry {} is invalid", index));
+    }
+    if (end <= start + kRecordHeaderSize + optionalFieldsSize(flags)) {
+      throw invalid_argument(
+          folly::sformat("serialized tree entry {} has no name", index));
+    }
+  }
+}
+
+uint32_t SerializedTree::readUint32(size_t offset) const {
+  uint32_t value;
+  memcpy(&value, data_.data() + offset, sizeof(value));
+  return folly::Endian::little(value);
+}
+
+size_t SerializedTree::recordStart(size_t index) const {
+  return readUint32(kHeaderSize + index * sizeof(uint32_t));
+}
+
+size_t SerializedTree::nameStart(size_t index) const {
+  auto start = recordStart(index);
+  auto flags = static_cast<uint8_t>(data_[start + 1]);
+  return start + kRecordHeaderSize + optionalFieldsSize(flags);
+}
+
+StringPiece SerializedTree::getName(size_t index) const {
+  auto start = nameStart(index);
+  return StringPiece{data_}.subpiece(start, recordStart(index + 1) - start);
+}
+
+TreeEntry SerializedTree::getEntry(size_t index) const {
+  auto* record =
+      reinterpret_cast<const uint8_t*>(data_.data()) + recordStart(index);
+  auto type = static_cast<TreeEntryType>(record[0]);
+  auto flags = record[1];
+  auto* field = record + 2;
+
+  Hash hash{folly::ByteRange{field, Hash::RAW_SIZE}};
+  field += Hash::RAW_SIZE;
+
+  std::optional<uint64_t> size;
+  if (flags & kHasSize) {
+    uint64_t value;
+    memcpy(&value, field, sizeof(value));
+    size = folly::Endian::little(value);
+    field += sizeof(value);
+  }
+  std::optional<Hash> contentSha1;
+  if (flags & kHasContentSha1) {
+    contentSha1 = Hash{folly::ByteRange{field, Hash::RAW_SIZE}};
+  }
+
+  return TreeEntry{hash, getName(index), type, size, contentSha1};
+}
+
+size_t SerializedTree::find(PathComponentPiece name) const {
+  auto piece = name.stringPiece();
+  size_t low = 0;
+  size_t high = count_;
+  while (low < high) {
+    auto mid = low + (high - low) / 2;
+    if (getName(mid) < piece) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low < count_ && getName(low) == piece) {
+    return low;
+  }
+  return count_;
+}
+
+} // namespace eden
+} // namespace facebook
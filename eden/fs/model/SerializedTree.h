@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "eden/fs/model/TreeEntry.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * An indexed, versioned encoding of a Tree's entries that can be searched
+ * and read in place, without decoding the whole tree first.
+ *
+ * All integers are little-endian.  The layout is:
+ *
+ *   uint8   version (kVersion)
+ *   uint32  entry count N
+ *   uint32  offsets[N + 1]: the start of each entry record, followed by the
+ *           end of the last one, relative to the start of the data
+ *   N entry records, sorted by name:
+ *     uint8   TreeEntryType
+ *     uint8   flags (kHasSize, kHasContentSha1)
+ *     Hash    hash
+ *     uint64  size, if kHasSize
+ *     Hash    content SHA-1, if kHasContentSha1
+ *     bytes   name, up to the start of the next record
+ *
+ * The version byte can never start a git tree object ("tree <size>"), so the
+ * two formats may be mixed in the same LocalStore.
+ */
+class SerializedTree {
+ public:
+  static constexpr uint8_t kVersion = 1;
+
+  /**
+   * Returns true if data looks like a SerializedTree rather than a git tree.
+   */
+  static bool isSerializedTree(folly::ByteRange data) {
+    return !data.empty() && data[0] == kVersion;
+  }
+
+  /**
+   * Encodes entries, which must be sorted by name as in a Tree.
+   */
+  static folly::IOBuf serialize(const std::vector<TreeEntry>& entries);
+
+  /**
+   * Wraps previously serialized data.
+   *
+   * This checks the header and offset table, so that reading the entries
+   * later cannot run past the end of the data.  Throws std::invalid_argument
+   * if the data is malformed.
+   */
+  explicit SerializedTree(std::string data);
+
+  size_t size() const {
+    return count_;
+  }
+
+  folly::StringPiece getName(size_t index) const;
+  TreeEntry getEntry(size_t index) const;
+
+  /**
+   * Binary-searches for the entry with the given name, returning its index,
+   * or size() if there is no such entry.
+   */
+  size_t find(PathComponentPiece name) const;
+
+  /**
+   * Returns the number of bytes of encoded data.
+   */
+  size_t getSizeBytes() const {
+    return data_.capacity();
+  }
+
+ private:
+  uint32_t readUint32(size_t offset) const;
+  size_t recordStart(size_t index) const;
+  size_t nameStart(size_t index) const;
+
+  std::string data_;
+  uint32_t count_;
+};
+
+} // namespace eden
+} // namespace facebook
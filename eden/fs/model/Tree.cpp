@@ -9,6 +9,138 @@
 
 namespace facebook {
 namespace eden {
+
+#ifdef _WIN32
+namespace {
+unsigned char foldCase(char c) {
+  return ('A' <= c && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+bool lessCaseInsensitive(folly::StringPiece a, folly::StringPiece b) {
+  return std::lexicographical_compare(
+      a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+        return foldCase(x) < foldCase(y);
+      });
+}
+} // namespace
+#endif
+
+Tree::Tree(const Hash& hash, SerializedTree&& serialized)
+    : hash_(hash),
+      serialized_(std::move(serialized)),
+      lookups_(new std::atomic<const TreeEntry*>[serialized_->size()]()) {}
+
+Tree::Tree(const Tree& other)
+    : hash_(other.hash_),
+      serialized_(other.serialized_),
+      entries_(serialized_ ? std::vector<TreeEntry>{} : other.entries_),
+      lookups_(
+          serialized_
+              ? new std::atomic<const TreeEntry*>[serialized_->size()]()
+              : nullptr) {}
+
+Tree::~Tree() {
+  if (lookups_) {
+    for (size_t i = 0; i < serialized_->size(); ++i) {
+      delete lookups_[i].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void Tree::decodeEntries() const {
+  folly::call_once(entriesDecoded_, [this] {
+    entries_.reserve(serialized_->size());
+    for (size_t i = 0; i < serialized_->size(); ++i) {
+      entries_.push_back(serialized_->getEntry(i));
+    }
+  });
+}
+
+const TreeEntry* Tree::getSerializedEntry(size_t index) const {
+  auto& slot = lookups_[index];
+  auto* entry = slot.load(std::memory_order_acquire);
+  if (entry) {
+    return entry;
+  }
+
+  auto decoded = std::make_unique<TreeEntry>(serialized_->getEntry(index));
+  if (slot.compare_exchange_strong(
+          entry, decoded.get(), std::memory_order_acq_rel)) {
+    return decoded.release();
+  }
+  // Another thread decoded it first.
+  return entry;
+}
+
+const TreeEntry* Tree::getEntryPtr(PathComponentPiece path) const {
+  if (serialized_) {
+    auto index = serialized_->find(path);
+    if (index != serialized_->size()) {
+      return getSerializedEntry(index);
+    }
+  } else {
+    auto iter = std::lower_bound(
+        entries_.cbegin(),
+        entries_.cend(),
+        path,
+        [](const TreeEntry& entry, PathComponentPiece piece) {
+          return entry.getName() < piece;
+        });
+    if (LIKELY(iter != entries_.cend() && iter->getName() == path)) {
+      return &*iter;
+    }
+  }
+
+#ifdef _WIN32
+  // On Windows we need to do a case insensitive lookup for the file and
+  // directory names. For performance, we will do a case sensitive search
+  // first which should cover most of the cases and if not found then do a
+  // case insensitive search.
+  return getEntryPtrCaseInsensitive(path);
+#else
+  return nullptr;
+#endif
+}
+
+#ifdef _WIN32
+const TreeEntry* Tree::getEntryPtrCaseInsensitive(
+    PathComponentPiece path) const {
+  const auto& entries = getTreeEntries();
+  folly::call_once(caseInsensitiveIndexBuilt_, [&] {
+    caseInsensitiveIndex_.resize(entries.size());
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+      caseInsensitiveIndex_[i] = i;
+    }
+    std::stable_sort(
+        caseInsensitiveIndex_.begin(),
+        caseInsensitiveIndex_.end(),
+        [&](uint32_t a, uint32_t b) {
+          return lessCaseInsensitive(
+              entries[a].getName().stringPiece(),
+              entries[b].getName().stringPiece());
+        });
+  });
+
+  auto fileName = path.stringPiece();
+  auto iter = std::lower_bound(
+      caseInsensitiveIndex_.cbegin(),
+      caseInsensitiveIndex_.cend(),
+      fileName,
+      [&](uint32_t index, folly::StringPiece name) {
+        return lessCaseInsensitive(
+            entries[index].getName().stringPiece(), name);
+      });
+  if (iter != caseInsensitiveIndex_.cend()) {
+    const auto& entry = entries[*iter];
+    if (entry.getName().stringPiece().equals(
+            fileName, folly::AsciiCaseInsensitive())) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+#endif
+
 bool operator==(const Tree& tree1, const Tree& tree2) {
   return (tree1.getHash() == tree2.getHash()) &&
       (tree1.getTreeEntries() == tree2.getTreeEntries());
@@ -17,5 +149,22 @@ bool operator==(const Tree& tree1, const Tree& tree2) {
 bool operator!=(const Tree& tree1, const Tree& tree2) {
   return !(tree1 == tree2);
 }
+
+size_t Tree::getSizeBytes() const {
+  if (serialized_) {
+    // Entries decoded later are not counted, since another thread may be
+    // decoding them right now.
+    return sizeof(*this) + serialized_->getSizeBytes() +
+        serialized_->size() * sizeof(std::atomic<const TreeEntry*>);
+  }
+
+  // Names that fit in the std::string small buffer are counted twice, which
+  // is close enough for cache accounting.
+  size_t size = sizeof(*this) + entries_.capacity() * sizeof(TreeEntry);
+  for (const auto& entry : entries_) {
+    size += entry.getName().value().size();
+  }
+  return size;
+}
 } // namespace eden
 } // namespace facebook
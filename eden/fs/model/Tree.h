@@ -7,9 +7,14 @@
 
 #pragma once
 
+#include <folly/synchronization/CallOnce.h>
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
 #include <vector>
 #include "Hash.h"
+#include "SerializedTree.h"
 #include "TreeEntry.h"
 
 namespace facebook {
@@ -20,44 +25,38 @@ class Tree {
   explicit Tree(std::vector<TreeEntry>&& entries, const Hash& hash = Hash())
       : hash_(hash), entries_(std::move(entries)) {}
 
+  /**
+   * Construct a Tree backed directly by its SerializedTree encoding.
+   *
+   * The entries are only decoded once something asks for all of them, and
+   * getEntryPtr() searches the encoded data without decoding the others.
+   */
+  Tree(const Hash& hash, SerializedTree&& serialized);
+
+  /**
+   * Copies of a serialized Tree share nothing, so they decode their entries
+   * again when needed.
+   */
+  Tree(const Tree& other);
+
+  ~Tree();
+
   const Hash& getHash() const {
     return hash_;
   }
 
   const std::vector<TreeEntry>& getTreeEntries() const {
+    if (serialized_) {
+      decodeEntries();
+    }
     return entries_;
   }
 
   const TreeEntry& getEntryAt(size_t index) const {
-    return entries_.at(index);
+    return getTreeEntries().at(index);
   }
 
-  const TreeEntry* getEntryPtr(PathComponentPiece path) const {
-    auto iter = std::lower_bound(
-        entries_.cbegin(),
-        entries_.cend(),
-        path,
-        [](const TreeEntry& entry, PathComponentPiece piece) {
-          return entry.getName() < piece;
-        });
-    if (UNLIKELY(iter == entries_.cend() || iter->getName() != path)) {
-#ifdef _WIN32
-      // On Windows we need to do a case insensitive lookup for the file and
-      // directory names. For performance, we will do a case sensitive search
-      // first which should cover most of the cases and if not found then do a
-      // case sensitive search.
-      const auto& fileName = path.stringPiece();
-      for (const auto& entry : entries_) {
-        if (entry.getName().stringPiece().equals(
-                fileName, folly::AsciiCaseInsensitive())) {
-          return &entry;
-        }
-      }
-#endif
-      return nullptr;
-    }
-    return &*iter;
-  }
+  const TreeEntry* getEntryPtr(PathComponentPiece path) const;
 
   const TreeEntry& getEntryAt(PathComponentPiece path) const {
     auto entry = getEntryPtr(path);
@@ -68,18 +67,45 @@ class Tree {
     return *entry;
   }
 
+  /**
+   * Returns an estimate of the memory used by this Tree.
+   */
+  size_t getSizeBytes() const;
+
   std::vector<PathComponent> getEntryNames() const {
+    const auto& entries = getTreeEntries();
     std::vector<PathComponent> results;
-    results.reserve(entries_.size());
-    for (const auto& entry : entries_) {
+    results.reserve(entries.size());
+    for (const auto& entry : entries) {
       results.emplace_back(entry.getName());
     }
     return results;
   }
 
  private:
+  void decodeEntries() const;
+  const TreeEntry* getSerializedEntry(size_t index) const;
+#ifdef _WIN32
+  const TreeEntry* getEntryPtrCaseInsensitive(PathComponentPiece path) const;
+#endif
+
   const Hash hash_;
-  const std::vector<TreeEntry> entries_;
+  const std::optional<SerializedTree> serialized_;
+
+  // For trees backed by serialized_, entries_ is filled in by
+  // decodeEntries(), and lookups_ holds the entries that getEntryPtr()
+  // decoded individually, indexed like the serialized entries.
+  mutable folly::once_flag entriesDecoded_;
+  mutable std::vector<TreeEntry> entries_;
+  std::unique_ptr<std::atomic<const TreeEntry*>[]> lookups_;
+
+#ifdef _WIN32
+  // Indices of the entries ordered by their case-folded names, built the
+  // first time a case sensitive lookup misses.  Entries whose names only
+  // differ in case keep their relative order.
+  mutable folly::once_flag caseInsensitiveIndexBuilt_;
+  mutable std::vector<uint32_t> caseInsensitiveIndex_;
+#endif
 };
 
 bool operator==(const Tree& tree1, const Tree& tree2);
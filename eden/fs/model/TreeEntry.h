@@ -51,6 +51,16 @@ class TreeEntry {
       TreeEntryType type)
       : type_(type), hash_(hash), name_(PathComponentPiece(name)) {}
 
+  /**
+   * Construct an entry whose name is already known to be a valid path
+   * component, without checking it again.
+   */
+  explicit TreeEntry(
+      const Hash& hash,
+      PathComponentPiece name,
+      TreeEntryType type)
+      : type_(type), hash_(hash), name_(name) {}
+
   explicit TreeEntry(
       const Hash& hash,
       folly::StringPiece name,
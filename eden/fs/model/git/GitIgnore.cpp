@@ -67,21 +67,68 @@ void GitIgnore::loadFile(StringPiece contents) {
   // reverse them so that we can do a forward walk through our patterns and
   // stop at the first match.
   std::reverse(newRules.begin(), newRules.end());
+
+  folly::F14FastMap<std::string, std::vector<uint32_t>> literalBasenames;
+  folly::F14FastMap<std::string, std::vector<uint32_t>> literalSuffixes;
+  std::vector<uint32_t> otherRules;
+  for (uint32_t index = 0; index < newRules.size(); ++index) {
+    const auto& rule = newRules[index];
+    if (auto name = rule.getLiteralBasename(); !name.empty()) {
+      literalBasenames[name.str()].push_back(index);
+    } else if (auto suffix = rule.getLiteralSuffix(); !suffix.empty()) {
+      literalSuffixes[suffix.str()].push_back(index);
+    } else {
+      otherRules.push_back(index);
+    }
+  }
+
   std::swap(rules_, newRules);
+  std::swap(literalBasenames_, literalBasenames);
+  std::swap(literalSuffixes_, literalSuffixes);
+  std::swap(otherRules_, otherRules);
 }
 
 GitIgnore::MatchResult GitIgnore::match(
     RelativePathPiece path,
     PathComponentPiece basename,
     FileType fileType) const {
-  for (const auto& pattern : rules_) {
-    auto result = pattern.match(path, basename, fileType);
-    if (result != NO_MATCH) {
-      return result;
+  // Find the matching pattern with the highest precedence, i.e. the lowest
+  // index.  Each list is in precedence order, so it only needs to be searched
+  // up to its first match or the best match found so far.
+  size_t best = rules_.size();
+  MatchResult bestResult = NO_MATCH;
+  auto search = [&](const std::vector<uint32_t>& indices) {
+    for (auto index : indices) {
+      if (index >= best) {
+        return;
+      }
+      auto result = rules_[index].match(path, basename, fileType);
+      if (result != NO_MATCH) {
+        best = index;
+        bestResult = result;
+        return;
+      }
     }
-  }
+  };
 
-  return NO_MATCH;
+  auto name = basename.stringPiece();
+  if (!literalBasenames_.empty()) {
+    auto it = literalBasenames_.find(name);
+    if (it != literalBasenames_.end()) {
+      search(it->second);
+    }
+  }
+  if (!literalSuffixes_.empty()) {
+    for (auto dot = name.find('.'); dot != StringPiece::npos;
+         dot = name.find('.', dot + 1)) {
+      auto it = literalSuffixes_.find(name.subpiece(dot));
+      if (it != literalSuffixes_.end()) {
+        search(it->second);
+      }
+    }
+  }
+  search(otherRules_);
+  return bestResult;
 }
 
 string GitIgnore::matchString(MatchResult result) {
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/container/F14Map.h>
+#include <string>
 #include <vector>
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -180,6 +182,16 @@ class GitIgnore {
    * listed in the .gitignore file).
    */
   std::vector<GitIgnorePattern> rules_;
+
+  /*
+   * Indices into rules_, in precedence order, of the patterns that match a
+   * literal basename or a literal "*.suffix", keyed by that literal.  match()
+   * looks these up by hash and only tries the other patterns that have a
+   * higher precedence than the best hash match.
+   */
+  folly::F14FastMap<std::string, std::vector<uint32_t>> literalBasenames_;
+  folly::F14FastMap<std::string, std::vector<uint32_t>> literalSuffixes_;
+  std::vector<uint32_t> otherRules_;
 };
 } // namespace eden
 } // namespace facebook
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/git/GitIgnoreCache.h"
+
+namespace facebook {
+namespace eden {
+
+GitIgnoreCache::GitIgnoreCache(size_t maxEntries)
+    : state_{folly::in_place, maxEntries} {}
+
+std::shared_ptr<const GitIgnore> GitIgnoreCache::get(const Hash& blobHash) {
+  auto state = state_.wlock();
+  auto it = state->entries.find(blobHash);
+  if (it == state->entries.end()) {
+    ++state->missCount;
+    return nullptr;
+  }
+  ++state->hitCount;
+  return it->second;
+}
+
+std::shared_ptr<const GitIgnore> GitIgnoreCache::insert(
+    const Hash& blobHash,
+    folly::StringPiece contents) {
+  // Parse outside of the lock; a racing insert of the same blob just
+  // replaces an identical entry.
+  auto ignore = std::make_shared<GitIgnore>();
+  ignore->loadFile(contents);
+  std::shared_ptr<const GitIgnore> result{std::move(ignore)};
+  state_.wlock()->entries.set(blobHash, result);
+  return result;
+}
+
+void GitIgnoreCache::clear() {
+  state_.wlock()->entries.clear();
+}
+
+GitIgnoreCache::Stats GitIgnoreCache::getStats() const {
+  auto state = state_.rlock();
+  Stats stats;
+  stats.entryCount = state->entries.size();
+  stats.hitCount = state->hitCount;
+  stats.missCount = state->missCount;
+  return stats;
+}
+
+} // namespace eden
+} // namespace facebook
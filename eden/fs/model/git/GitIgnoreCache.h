@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <memory>
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/model/git/GitIgnore.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * An LRU cache of parsed ignore files, keyed by the hash of the blob they were
+ * parsed from.  Since blobs are immutable, an entry never goes stale, and
+ * repeated status calls only parse each distinct ignore file once.
+ *
+ * It is safe to use this object from arbitrary threads.
+ */
+class GitIgnoreCache {
+ public:
+  struct Stats {
+    size_t entryCount{0};
+    uint64_t hitCount{0};
+    uint64_t missCount{0};
+  };
+
+  explicit GitIgnoreCache(size_t maxEntries);
+
+  /**
+   * Return the rules parsed from the blob with the given hash, or nullptr if
+   * they are not cached.
+   */
+  std::shared_ptr<const GitIgnore> get(const Hash& blobHash);
+
+  /**
+   * Parse the contents of the blob with the given hash, cache the result, and
+   * return it.
+   */
+  std::shared_ptr<const GitIgnore> insert(
+      const Hash& blobHash,
+      folly::StringPiece contents);
+
+  void clear();
+
+  Stats getStats() const;
+
+ private:
+  struct State {
+    explicit State(size_t maxEntries) : entries{maxEntries} {}
+
+    folly::EvictingCacheMap<Hash, std::shared_ptr<const GitIgnore>> entries;
+    uint64_t hitCount{0};
+    uint64_t missCount{0};
+  };
+
+  folly::Synchronized<State> state_;
+};
+
+} // namespace eden
+} // namespace facebook
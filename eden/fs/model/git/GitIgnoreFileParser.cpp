@@ -44,5 +44,16 @@ folly::Expected<GitIgnore, int> GitIgnoreFileParser::operator()(
   }
   return gitIgnore;
 }
+
+folly::Expected<SharedGitIgnoreFileParser::value_type, int>
+SharedGitIgnoreFileParser::operator()(
+    int fileDescriptor,
+    AbsolutePathPiece filePath) const {
+  auto result = GitIgnoreFileParser{}(fileDescriptor, filePath);
+  if (result.hasError()) {
+    return folly::makeUnexpected(result.error());
+  }
+  return std::make_shared<const GitIgnore>(std::move(result.value()));
+}
 } // namespace eden
 } // namespace facebook
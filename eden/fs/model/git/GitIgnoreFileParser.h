@@ -8,6 +8,7 @@
 #pragma once
 
 #include <folly/Expected.h>
+#include <memory>
 #include "eden/fs/model/git/GitIgnore.h"
 
 namespace facebook {
@@ -29,5 +30,19 @@ class GitIgnoreFileParser {
       int fileDescriptor,
       AbsolutePathPiece filePath) const;
 };
+
+/**
+ * Like GitIgnoreFileParser, but the GitIgnore is returned in a shared_ptr so
+ * that every caller of CachedParsedFileMonitor::getFileContents() shares the
+ * cached rules instead of copying them.
+ */
+class SharedGitIgnoreFileParser {
+ public:
+  using value_type = std::shared_ptr<const GitIgnore>;
+
+  folly::Expected<value_type, int> operator()(
+      int fileDescriptor,
+      AbsolutePathPiece filePath) const;
+};
 } // namespace eden
 } // namespace facebook
@@ -130,6 +130,24 @@ optional<GitIgnorePattern> GitIgnorePattern::parseLine(StringPiece line) {
     }
   }
 
+  // Remember literal basenames and "*.suffix" patterns, which GitIgnore can
+  // look up by hash.
+  std::string literal;
+  if (flags & FLAG_BASENAME_ONLY) {
+    auto isLiteral = [](StringPiece text) {
+      return text.find_first_of(StringPiece{"*?[\\"}) == StringPiece::npos;
+    };
+    if (isLiteral(line)) {
+      flags |= FLAG_LITERAL_BASENAME;
+      literal = line.str();
+    } else if (
+        line.size() > 2 && line[0] == '*' && line[1] == '.' &&
+        isLiteral(line.subpiece(1))) {
+      flags |= FLAG_LITERAL_SUFFIX;
+      literal = line.subpiece(1).str();
+    }
+  }
+
   // Create the GlobMatcher. Note in gitignore(5), a '**' should include path
   // components that start with '.', so we do not enable the IGNORE_DOTFILES
   // option.
@@ -138,11 +156,17 @@ optional<GitIgnorePattern> GitIgnorePattern::parseLine(StringPiece line) {
     return std::nullopt;
   }
 
-  return GitIgnorePattern(flags, std::move(matcher).value());
+  return GitIgnorePattern(
+      flags, std::move(matcher).value(), std::move(literal));
 }
 
-GitIgnorePattern::GitIgnorePattern(uint32_t flags, GlobMatcher&& matcher)
-    : flags_(flags), matcher_(std::move(matcher)) {}
+GitIgnorePattern::GitIgnorePattern(
+    uint32_t flags,
+    GlobMatcher&& matcher,
+    std::string literal)
+    : flags_(flags),
+      matcher_(std::move(matcher)),
+      literal_(std::move(literal)) {}
 
 GitIgnorePattern::~GitIgnorePattern() {}
 
@@ -9,6 +9,7 @@
 
 #include <folly/Range.h>
 #include <optional>
+#include <string>
 #include "eden/fs/model/git/GitIgnore.h"
 #include "eden/fs/model/git/GlobMatcher.h"
 
@@ -70,6 +71,26 @@ class GitIgnorePattern {
       PathComponentPiece basename,
       GitIgnore::FileType fileType) const;
 
+  /**
+   * If this pattern only matches basenames equal to a literal string, returns
+   * that string.  GitIgnore looks these patterns up by hash rather than
+   * trying them one by one.  Returns an empty string otherwise.
+   */
+  folly::StringPiece getLiteralBasename() const {
+    return (flags_ & FLAG_LITERAL_BASENAME) ? folly::StringPiece{literal_}
+                                            : folly::StringPiece{};
+  }
+
+  /**
+   * If this pattern is "*" followed by a literal starting with ".", e.g.
+   * "*.o", and only matches basenames, returns the literal.  Returns an
+   * empty string otherwise.
+   */
+  folly::StringPiece getLiteralSuffix() const {
+    return (flags_ & FLAG_LITERAL_SUFFIX) ? folly::StringPiece{literal_}
+                                          : folly::StringPiece{};
+  }
+
  private:
   /**
    * Flag values that can be bitwise-ORed to create the flags_ value.
@@ -83,9 +104,17 @@ class GitIgnorePattern {
     // The pattern did not contain /, so it only matches against the last
     // component of any path.
     FLAG_BASENAME_ONLY = 0x04,
+    // The pattern only matches basenames equal to literal_.
+    FLAG_LITERAL_BASENAME = 0x08,
+    // The pattern is "*" followed by literal_, and only matches basenames
+    // ending with it.
+    FLAG_LITERAL_SUFFIX = 0x10,
   };
 
-  GitIgnorePattern(uint32_t flags, GlobMatcher&& matcher);
+  GitIgnorePattern(
+      uint32_t flags,
+      GlobMatcher&& matcher,
+      std::string literal);
 
   /**
    * A bit set of the Flags defined above.
@@ -95,6 +124,11 @@ class GitIgnorePattern {
    * The GlobMatcher object for performing matching.
    */
   GlobMatcher matcher_;
+  /**
+   * The literal basename or suffix, if FLAG_LITERAL_BASENAME or
+   * FLAG_LITERAL_SUFFIX is set.
+   */
+  std::string literal_;
 };
 } // namespace eden
 } // namespace facebook
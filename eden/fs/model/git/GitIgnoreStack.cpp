@@ -50,12 +50,14 @@ GitIgnore::MatchResult GitIgnoreStack::match(
       ++suffixIter;
     }
 
-    const GitIgnore* ignore = &node->ignore_;
+    const GitIgnore* ignore = node->ignore_.get();
     node = node->parent_;
 
-    const auto result = ignore->match(suffix, basename, fileType);
-    if (result != GitIgnore::NO_MATCH) {
-      return result;
+    if (ignore) {
+      const auto result = ignore->match(suffix, basename, fileType);
+      if (result != GitIgnore::NO_MATCH) {
+        return result;
+      }
     }
 
     // We always expect to reach the end of the suffix iteration before
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 #include "eden/fs/model/git/GitIgnore.h"
 #include "eden/fs/utils/PathFuncs.h"
@@ -57,10 +58,22 @@ class GitIgnoreStack {
       const GitIgnoreStack* parent,
       folly::StringPiece ignoreFileContents)
       : parent_{parent} {
-    ignore_.loadFile(ignoreFileContents);
+    auto ignore = std::make_shared<GitIgnore>();
+    ignore->loadFile(ignoreFileContents);
+    ignore_ = std::move(ignore);
   }
 
   GitIgnoreStack(const GitIgnoreStack* parent, GitIgnore ignore)
+      : ignore_{std::make_shared<const GitIgnore>(std::move(ignore))},
+        parent_{parent} {}
+
+  /**
+   * Create a new GitIgnoreStack that shares already parsed rules, such as
+   * those from a GitIgnoreCache.
+   */
+  GitIgnoreStack(
+      const GitIgnoreStack* parent,
+      std::shared_ptr<const GitIgnore> ignore)
       : ignore_{std::move(ignore)}, parent_{parent} {}
 
   /**
@@ -71,14 +84,15 @@ class GitIgnoreStack {
       GitIgnore::FileType fileType) const;
 
   bool empty() const {
-    return ignore_.empty();
+    return !ignore_ || ignore_->empty();
   }
 
  private:
   /**
-   * The GitIgnore info for this node on the stack
+   * The GitIgnore info for this node on the stack, or nullptr if this
+   * directory has no ignore file.  It may be shared with other stacks.
    */
-  GitIgnore ignore_;
+  std::shared_ptr<const GitIgnore> ignore_;
 
   /**
    * A pointer to the next node in the stack.
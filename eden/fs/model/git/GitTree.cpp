@@ -33,44 +33,65 @@ enum GitModeMask {
   SYMLINK = 0120000,
 };
 
-std::unique_ptr<Tree> deserializeGitTree(
+void forEachGitTreeEntry(
     const Hash& hash,
-    const IOBuf* treeData) {
-  folly::io::Cursor cursor(treeData);
+    folly::ByteRange treeData,
+    folly::FunctionRef<void(const GitTreeEntryView&)> fn) {
+  folly::StringPiece text{treeData};
 
   // Find the end of the header and extract the size.
-  if (cursor.readFixedString(5) != "tree ") {
+  if (!text.startsWith("tree ")) {
     throw invalid_argument("Contents did not start with expected header.");
   }
+  text.advance(5);
 
   // 25 characters is long enough to represent any legitimate length
-  size_t maxSizeLength = 25;
-  auto sizeStr = cursor.readTerminatedString('\0', maxSizeLength);
-  auto contentSize = folly::to<unsigned int>(sizeStr);
-  if (contentSize != cursor.length()) {
+  constexpr size_t kMaxSizeLength = 25;
+  auto sizeEnd = text.find('\0');
+  if (sizeEnd == folly::StringPiece::npos || sizeEnd > kMaxSizeLength) {
+    throw invalid_argument("Did not find the end of the tree header.");
+  }
+  auto contentSize = folly::to<unsigned int>(text.subpiece(0, sizeEnd));
+  text.advance(sizeEnd + 1);
+  if (contentSize != text.size()) {
     throw invalid_argument("Size in header should match contents");
   }
 
-  // Scan the data and populate entries, as appropriate.
-  vector<TreeEntry> entries;
-  while (!cursor.isAtEnd()) {
+  // Scan the data and report each entry.
+  while (!text.empty()) {
     // Extract the mode.
     // This should only be 6 or 7 characters.
     // Stop scanning if we haven't seen a space in 10 characters
-    size_t maxModeLength = 10;
-    auto modeStr = cursor.readTerminatedString(' ', maxModeLength);
-    size_t modeEndIndex;
-    auto mode = std::stoi(modeStr, &modeEndIndex, /* base */ 8);
-    if (modeEndIndex != modeStr.size()) {
-      throw invalid_argument("Did not parse expected number of octal chars.");
+    constexpr size_t kMaxModeLength = 10;
+    auto modeEnd = text.find(' ');
+    if (modeEnd == folly::StringPiece::npos || modeEnd == 0 ||
+        modeEnd > kMaxModeLength) {
+      throw invalid_argument("Did not find the end of an entry mode.");
+    }
+    uint32_t mode = 0;
+    for (auto c : text.subpiece(0, modeEnd)) {
+      if (c < '0' || c > '7') {
+        throw invalid_argument(
+            "Did not parse expected number of octal chars.");
+      }
+      mode = mode * 8 + (c - '0');
     }
+    text.advance(modeEnd + 1);
 
     // Extract the name.
-    auto name = cursor.readTerminatedString();
+    auto nameEnd = text.find('\0');
+    if (nameEnd == folly::StringPiece::npos) {
+      throw invalid_argument("Did not find the end of an entry name.");
+    }
+    auto name = text.subpiece(0, nameEnd);
+    text.advance(nameEnd + 1);
 
     // Extract the hash.
-    Hash::Storage hashBytes;
-    cursor.pull(hashBytes.data(), hashBytes.size());
+    if (text.size() < Hash::RAW_SIZE) {
+      throw invalid_argument("Tree entry is truncated before its hash.");
+    }
+    auto hashBytes = folly::ByteRange{text.subpiece(0, Hash::RAW_SIZE)};
+    text.advance(Hash::RAW_SIZE);
 
     // Determine the individual fields from the mode.
 
@@ -93,18 +114,43 @@ std::unique_ptr<Tree> deserializeGitTree(
           "Unrecognized mode: {:o} in object {}", mode, hash.toString()));
     }
 
-    entries.emplace_back(Hash(hashBytes), std::move(name), fileType);
+    fn(GitTreeEntryView{name, hashBytes, fileType});
   }
+}
 
+std::unique_ptr<Tree> deserializeGitTree(
+    const Hash& hash,
+    folly::ByteRange treeData,
+    GitTreeValidation validation) {
+  vector<TreeEntry> entries;
+  forEachGitTreeEntry(hash, treeData, [&](const GitTreeEntryView& entry) {
+    if (validation == GitTreeValidation::Trusted) {
+      entries.emplace_back(
+          Hash{entry.hash},
+          PathComponentPiece{entry.name, detail::SkipPathSanityCheck{}},
+          entry.type);
+    } else {
+      entries.emplace_back(Hash{entry.hash}, entry.name, entry.type);
+    }
+  });
   return std::make_unique<Tree>(std::move(entries), hash);
 }
 
-// Convenience wrapper which accepts a ByteRange
 std::unique_ptr<Tree> deserializeGitTree(
     const Hash& hash,
-    folly::ByteRange treeData) {
-  IOBuf buf(IOBuf::WRAP_BUFFER, treeData);
-  return deserializeGitTree(hash, &buf);
+    const IOBuf* treeData,
+    GitTreeValidation validation) {
+  if (!treeData->isChained()) {
+    return deserializeGitTree(
+        hash,
+        folly::ByteRange{treeData->data(), treeData->length()},
+        validation);
+  }
+  auto coalesced = treeData->cloneCoalescedAsValue();
+  return deserializeGitTree(
+      hash,
+      folly::ByteRange{coalesced.data(), coalesced.length()},
+      validation);
 }
 
 enum size_t {
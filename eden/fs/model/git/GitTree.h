@@ -7,16 +7,53 @@
 
 #pragma once
 
+#include <folly/Function.h>
 #include <folly/Range.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
+#include "eden/fs/model/TreeEntry.h"
 
 namespace facebook {
 namespace eden {
 
 class Hash;
 class Tree;
-class TreeEntry;
+
+/**
+ * How thoroughly deserializeGitTree() checks the entries it decodes.
+ */
+enum class GitTreeValidation {
+  /**
+   * Check that every entry name is a valid path component.
+   */
+  Full,
+  /**
+   * Skip the path component checks.  Only for data that Eden wrote itself,
+   * such as trees read back from the LocalStore, whose names were checked
+   * when they were first imported.
+   */
+  Trusted,
+};
+
+/**
+ * One entry of a serialized git tree.  The name and hash point into the
+ * serialized data.
+ */
+struct GitTreeEntryView {
+  folly::StringPiece name;
+  folly::ByteRange hash;
+  TreeEntryType type;
+};
+
+/**
+ * Calls fn with each entry of a serialized git tree object, in order,
+ * without copying anything.  Throws if the data is malformed, like
+ * deserializeGitTree().  The hash is only used in error messages.
+ */
+void forEachGitTreeEntry(
+    const Hash& hash,
+    folly::ByteRange treeData,
+    folly::FunctionRef<void(const GitTreeEntryView&)> fn);
 
 /**
  * Creates an Eden Tree from the serialized version of a Git tree object.
@@ -24,10 +61,12 @@ class TreeEntry;
  */
 std::unique_ptr<Tree> deserializeGitTree(
     const Hash& hash,
-    const folly::IOBuf* treeData);
+    const folly::IOBuf* treeData,
+    GitTreeValidation validation = GitTreeValidation::Full);
 std::unique_ptr<Tree> deserializeGitTree(
     const Hash& hash,
-    folly::ByteRange treeData);
+    folly::ByteRange treeData,
+    GitTreeValidation validation = GitTreeValidation::Full);
 
 /*
  * A class for serializing git tree objects in a streaming fashion.
@@ -91,7 +91,9 @@ bool operator&(GlobOptions a, GlobOptions b) {
 }
 
 GlobMatcher::GlobMatcher(vector<uint8_t> pattern)
-    : pattern_(std::move(pattern)) {}
+    : pattern_(std::move(pattern)) {
+  computePrefilter();
+}
 
 GlobMatcher::GlobMatcher() {}
 
@@ -467,7 +469,61 @@ bool GlobMatcher::addCharClass(
   return false;
 }
 
+void GlobMatcher::computePrefilter() {
+  // Walk the opcodes, remembering the literal data of each one.  The layout
+  // of each opcode is documented where the opcodes are defined.
+  size_t idx = 0;
+  bool first = true;
+  while (idx < pattern_.size()) {
+    auto opcode = pattern_[idx];
+    StringPiece literal;
+    size_t next;
+    if (opcode == GLOB_LITERAL) {
+      uint8_t length = pattern_[idx + 1];
+      literal = StringPiece{ByteRange{pattern_.data() + idx + 2, length}};
+      next = idx + 2 + length;
+    } else if (opcode == GLOB_ENDS_WITH) {
+      uint8_t length = pattern_[idx + 2];
+      literal = StringPiece{ByteRange{pattern_.data() + idx + 3, length}};
+      next = idx + 3 + length;
+    } else if (
+        opcode == GLOB_CHAR_CLASS || opcode == GLOB_CHAR_CLASS_NEGATED) {
+      next = idx + 1;
+      while (pattern_[next] != GLOB_CHAR_CLASS_END) {
+        next += pattern_[next] == GLOB_CHAR_CLASS_RANGE ? 3 : 1;
+      }
+      ++next;
+    } else if (opcode == GLOB_QMARK) {
+      next = idx + 1;
+    } else {
+      // GLOB_STAR, GLOB_STAR_STAR_END and GLOB_STAR_STAR_SLASH
+      next = idx + 2;
+    }
+
+    bool last = next >= pattern_.size();
+    // tryMatchAt() already checks a leading literal or a lone ends-with
+    // section directly, so only literals after a wildcard are worth checking
+    // ahead of time.
+    if (!first && !literal.empty()) {
+      if (last) {
+        requiredSuffix_ = literal.str();
+      } else if (literal.size() > requiredFragment_.size()) {
+        requiredFragment_ = literal.str();
+      }
+    }
+    first = false;
+    idx = next;
+  }
+}
+
 bool GlobMatcher::match(StringPiece text) const {
+  if (!requiredSuffix_.empty() && !text.endsWith(requiredSuffix_)) {
+    return false;
+  }
+  if (!requiredFragment_.empty() &&
+      text.find(requiredFragment_) == StringPiece::npos) {
+    return false;
+  }
   return tryMatchAt(text, 0, 0);
 }
 
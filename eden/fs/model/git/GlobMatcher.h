@@ -10,6 +10,7 @@
 #include <folly/Expected.h>
 #include <folly/Range.h>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 namespace facebook {
@@ -76,9 +77,23 @@ class GlobMatcher {
    */
   bool match(folly::StringPiece text) const;
 
+  /**
+   * Like match(), but without first checking the text for the literal
+   * fragments the pattern requires.  Only intended for benchmarking the
+   * prefilter.
+   */
+  bool matchWithoutPrefilter(folly::StringPiece text) const {
+    return tryMatchAt(text, 0, 0);
+  }
+
  private:
   explicit GlobMatcher(std::vector<uint8_t> pattern);
 
+  /**
+   * Extract requiredSuffix_ and requiredFragment_ from pattern_.
+   */
+  void computePrefilter();
+
   static folly::Expected<size_t, std::string> parseBracketExpr(
       folly::StringPiece glob,
       size_t idx,
@@ -117,6 +132,17 @@ class GlobMatcher {
    * rather than heap-allocating them in a vector.
    */
   std::vector<uint8_t> pattern_;
+
+  /**
+   * Literals that any matching text must end with and contain, extracted
+   * from pattern_ so match() can reject most non-matching text with a
+   * vectorized suffix compare and substring search before running the
+   * backtracking matcher, e.g. the ".java" of a pattern matching Java files
+   * in any directory.  They are empty when the matcher would check the same
+   * literal up front anyway.
+   */
+  std::string requiredSuffix_;
+  std::string requiredFragment_;
 };
 } // namespace eden
 } // namespace facebook
@@ -25,6 +25,16 @@ class TopLevelIgnores {
   TopLevelIgnores(GitIgnore userIgnore, GitIgnore systemIgnore)
       : systemIgnoreStack_{nullptr, systemIgnore},
         userIgnoreStack_{&systemIgnoreStack_, userIgnore} {}
+  /**
+   * Construct from already parsed user and system rules, which are shared
+   * rather than copied.  Either may be null if its file could not be read.
+   */
+  TopLevelIgnores(
+      std::shared_ptr<const GitIgnore> userIgnore,
+      std::shared_ptr<const GitIgnore> systemIgnore)
+      : systemIgnoreStack_{nullptr, std::move(systemIgnore)},
+        userIgnoreStack_{&systemIgnoreStack_, std::move(userIgnore)} {}
+
   /**
    * Construct from user and system gitIgnore file contents.
    * Intended for testing purposes.
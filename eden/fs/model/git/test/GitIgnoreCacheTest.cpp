@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/git/GitIgnoreCache.h"
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+
+namespace {
+const Hash kHash1{"0000000000000000000000000000000000000001"};
+const Hash kHash2{"0000000000000000000000000000000000000002"};
+} // namespace
+
+TEST(GitIgnoreCache, inserted_rules_are_shared) {
+  GitIgnoreCache cache{10};
+  EXPECT_EQ(nullptr, cache.get(kHash1));
+
+  auto inserted = cache.insert(kHash1, "*.o\n");
+  ASSERT_NE(nullptr, inserted);
+  EXPECT_EQ(
+      GitIgnore::EXCLUDE,
+      inserted->match(RelativePath{"foo.o"}, GitIgnore::TYPE_FILE));
+
+  auto cached = cache.get(kHash1);
+  EXPECT_EQ(inserted.get(), cached.get());
+  EXPECT_EQ(nullptr, cache.get(kHash2));
+
+  auto stats = cache.getStats();
+  EXPECT_EQ(1, stats.entryCount);
+  EXPECT_EQ(1, stats.hitCount);
+  EXPECT_EQ(2, stats.missCount);
+}
+
+TEST(GitIgnoreCache, evicts_least_recently_used) {
+  GitIgnoreCache cache{1};
+  cache.insert(kHash1, "*.o\n");
+  cache.insert(kHash2, "*.a\n");
+  EXPECT_EQ(nullptr, cache.get(kHash1));
+  EXPECT_NE(nullptr, cache.get(kHash2));
+
+  cache.clear();
+  EXPECT_EQ(0, cache.getStats().entryCount);
+}
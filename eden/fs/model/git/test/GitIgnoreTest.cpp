@@ -68,6 +68,36 @@ TEST(GitIgnore, testPrecedence) {
   EXPECT_IGNORE(ignore, NO_MATCH, "!a");
 }
 
+TEST(GitIgnore, testPrecedenceAcrossLiteralAndSuffixPatterns) {
+  GitIgnore ignore;
+  // Literal basenames and "*.suffix" patterns are looked up by hash, but the
+  // last matching pattern must still win over the other kinds of patterns.
+  ignore.loadFile(
+      "*.o\n"
+      "build*\n"
+      "!keep.o\n"
+      "*.tar.gz\n"
+      "!build.tar.gz\n"
+      "out/\n"
+      "!*.log\n"
+      "debug.*\n");
+
+  EXPECT_IGNORE(ignore, EXCLUDE, "main.o");
+  EXPECT_IGNORE(ignore, EXCLUDE, "dir/main.o");
+  EXPECT_IGNORE(ignore, EXCLUDE, ".o");
+  EXPECT_IGNORE(ignore, INCLUDE, "keep.o");
+  EXPECT_IGNORE(ignore, EXCLUDE, "build.o");
+  EXPECT_IGNORE(ignore, EXCLUDE, "src.tar.gz");
+  EXPECT_IGNORE(ignore, INCLUDE, "build.tar.gz");
+  EXPECT_IGNORE(ignore, EXCLUDE, "buildfoo");
+  EXPECT_IGNORE(ignore, NO_MATCH, "out");
+  EXPECT_IGNORE_DIR(ignore, EXCLUDE, "out");
+  EXPECT_IGNORE(ignore, INCLUDE, "build.log");
+  EXPECT_IGNORE(ignore, EXCLUDE, "debug.log");
+  EXPECT_IGNORE(ignore, NO_MATCH, "main.c");
+  EXPECT_IGNORE(ignore, NO_MATCH, "maino");
+}
+
 TEST(GitIgnore, testComments) {
   GitIgnore ignore;
 
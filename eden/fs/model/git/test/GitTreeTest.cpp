@@ -152,6 +152,41 @@ TEST(GitTree, deserializeEmpty) {
   EXPECT_EQ(0, tree->getTreeEntries().size());
 }
 
+TEST(GitTree, entryViewsPointIntoTheData) {
+  GitTreeSerializer serializer;
+  serializer.addEntry(TreeEntry(
+      Hash("c66788d87933862e2111a86304b705dd90bbd427"),
+      "README.md",
+      TreeEntryType::REGULAR_FILE));
+  serializer.addEntry(TreeEntry(
+      Hash("de0b8287939193ed239834991be65b96cbfc4508"),
+      "src",
+      TreeEntryType::TREE));
+  auto buf = serializer.finalize();
+  folly::ByteRange data{buf.data(), buf.length()};
+  auto treeHash = Hash::sha1(data);
+
+  std::vector<GitTreeEntryView> views;
+  forEachGitTreeEntry(treeHash, data, [&](const GitTreeEntryView& entry) {
+    views.push_back(entry);
+  });
+  ASSERT_EQ(2, views.size());
+  EXPECT_EQ("README.md", views[0].name);
+  EXPECT_EQ(TreeEntryType::REGULAR_FILE, views[0].type);
+  EXPECT_EQ("src", views[1].name);
+  EXPECT_EQ(TreeEntryType::TREE, views[1].type);
+  EXPECT_EQ(
+      Hash("de0b8287939193ed239834991be65b96cbfc4508"), Hash{views[1].hash});
+  EXPECT_GE(views[0].name.data(), reinterpret_cast<const char*>(data.begin()));
+  EXPECT_LT(views[1].name.data(), reinterpret_cast<const char*>(data.end()));
+
+  // Trusted data decodes to the same tree.
+  auto full = deserializeGitTree(treeHash, data);
+  auto trusted =
+      deserializeGitTree(treeHash, data, GitTreeValidation::Trusted);
+  EXPECT_EQ(*full, *trusted);
+}
+
 TEST(GitTree, testBadDeserialize) {
   Hash zero("0000000000000000000000000000000000000000");
   // Partial header
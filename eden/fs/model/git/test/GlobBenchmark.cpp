@@ -82,6 +82,21 @@ class GlobMatcherImpl {
   GlobMatcher matcher_;
 };
 
+class GlobMatcherNoPrefilterImpl {
+ public:
+  GlobMatcherNoPrefilterImpl() {}
+  void init(folly::StringPiece glob) {
+    matcher_ = GlobMatcher::create(glob, GlobOptions::DEFAULT).value();
+  }
+
+  bool match(const std::string& input) {
+    return matcher_.matchWithoutPrefilter(input);
+  }
+
+ private:
+  GlobMatcher matcher_;
+};
+
 class WildmatchImpl {
  public:
   WildmatchImpl() {}
@@ -247,4 +262,30 @@ GBENCHMARK(fullpath_re2)(benchmark::State& state) {
   runBenchmark<RE2Impl>(state, ".*/[^/]io[^/]*o[^/]*", fullnameCorpus);
 }
 
+GBENCHMARK(starStarEndsWith_globmatch)(benchmark::State& state) {
+  runBenchmark<GlobMatcherImpl>(state, "**/*.java", fullnameCorpus);
+}
+
+GBENCHMARK(starStarEndsWith_noprefilter)(benchmark::State& state) {
+  runBenchmark<GlobMatcherNoPrefilterImpl>(state, "**/*.java", fullnameCorpus);
+}
+
+GBENCHMARK(starStarEndsWith_wildmatch)(benchmark::State& state) {
+  runBenchmark<WildmatchImpl>(state, "**/*.java", fullnameCorpus);
+}
+
+GBENCHMARK(innerLiteral_globmatch)(benchmark::State& state) {
+  runBenchmark<GlobMatcherImpl>(
+      state, "**/netfilter/**/*.c", fullnameCorpus);
+}
+
+GBENCHMARK(innerLiteral_noprefilter)(benchmark::State& state) {
+  runBenchmark<GlobMatcherNoPrefilterImpl>(
+      state, "**/netfilter/**/*.c", fullnameCorpus);
+}
+
+GBENCHMARK(innerLiteral_wildmatch)(benchmark::State& state) {
+  runBenchmark<WildmatchImpl>(state, "**/netfilter/**/*.c", fullnameCorpus);
+}
+
 BENCHMARK_MAIN();
@@ -370,3 +370,45 @@ TEST(Glob, testCharClasses) {
   testCharClass("upper", isupper);
   testCharClass("xdigit", isxdigit);
 }
+
+TEST(Glob, prefilterAgreesWithMatcher) {
+  std::vector<StringPiece> globs = {
+      "**/*.java",
+      "src/**/test/*.py",
+      "a*b*c",
+      "*.o",
+      "foo/**",
+      "[ab]*x?z.txt",
+      "**/netfilter/**/*.c",
+      "*",
+  };
+  std::vector<StringPiece> texts = {
+      "",
+      "Foo.java",
+      "src/Foo.java",
+      "src/Foo.javax",
+      "src/a/b/test/foo.py",
+      "src/test/foo.py",
+      "src/test.py",
+      "abc",
+      "a/b/c",
+      "axxbyyc",
+      "main.o",
+      "foo/bar",
+      "bxyz.txt",
+      "a_x_z.txt",
+      "net/ipv4/netfilter/nf_conntrack.c",
+      "net/netfilter.c",
+  };
+  for (auto glob : globs) {
+    auto matcher = GlobMatcher::create(glob, GlobOptions::DEFAULT).value();
+    for (auto text : texts) {
+      EXPECT_EQ(matcher.matchWithoutPrefilter(text), matcher.match(text))
+          << "glob \"" << glob << "\", text \"" << text << "\"";
+    }
+  }
+  EXPECT_MATCH("src/a/b/test/foo.py", "src/**/test/*.py");
+  EXPECT_NOMATCH("src/a/b/tst/foo.py", "src/**/test/*.py");
+  EXPECT_MATCH("a/b/Foo.java", "**/*.java");
+  EXPECT_NOMATCH("a/b/Foo.jav", "**/*.java");
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <benchmark/benchmark.h>
+#include <folly/String.h>
+#include <unordered_set>
+
+#include "eden/fs/model/Hash.h"
+
+using namespace facebook::eden;
+
+namespace {
+std::vector<Hash> makeHashes(size_t count) {
+  std::vector<Hash> hashes;
+  hashes.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    hashes.push_back(Hash::sha1(folly::ByteRange{
+        reinterpret_cast<const uint8_t*>(&i), sizeof(i)}));
+  }
+  return hashes;
+}
+
+const std::vector<Hash> hashCorpus = makeHashes(1024);
+} // namespace
+
+GBENCHMARK(toString_hash)(benchmark::State& state) {
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(hashCorpus[i++ % hashCorpus.size()].toString());
+  }
+}
+
+GBENCHMARK(toString_hexlify)(benchmark::State& state) {
+  size_t i = 0;
+  for (auto _ : state) {
+    std::string result;
+    folly::hexlify(hashCorpus[i++ % hashCorpus.size()].getBytes(), result);
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+GBENCHMARK(fromHex)(benchmark::State& state) {
+  std::vector<std::string> hexCorpus;
+  for (const auto& hash : hashCorpus) {
+    hexCorpus.push_back(hash.toString());
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Hash{hexCorpus[i++ % hexCorpus.size()]});
+  }
+}
+
+GBENCHMARK(getHashCode)(benchmark::State& state) {
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        hashCorpus[i++ % hashCorpus.size()].getHashCode());
+  }
+}
+
+GBENCHMARK(unorderedSetInsertAndFind)(benchmark::State& state) {
+  for (auto _ : state) {
+    std::unordered_set<Hash> set;
+    for (const auto& hash : hashCorpus) {
+      set.insert(hash);
+    }
+    for (const auto& hash : hashCorpus) {
+      benchmark::DoNotOptimize(set.find(hash));
+    }
+  }
+}
+
+BENCHMARK_MAIN();
@@ -161,6 +161,9 @@ TEST(Hash, ensureStringConstructorRejectsArgumentWithWrongLength) {
 TEST(Hash, ensureStringConstructorRejectsArgumentBadCharacters) {
   EXPECT_THROW(
       Hash("ZZZZb00cdeadbeefc00010ff1badb0028badf00d"), std::invalid_argument);
+  EXPECT_THROW(
+      Hash("\xff\xffceb00cdeadbeefc00010ff1badb0028badf00d"),
+      std::invalid_argument);
 }
 
 TEST(Hash, sha1IOBuf) {
@@ -212,8 +215,38 @@ TEST(Hash, assignment) {
 }
 
 TEST(Hash, getHashCode) {
-  // This isn't so much because we care about the exact value of the hash code,
-  // but because we want to make sure that (at least on 64-bit machines), we are
-  // using 64 bits of data to contribute to the hash code.
-  EXPECT_EQ(folly::Endian::big(0xfaceb00cdeadbeef), testHash.getHashCode());
+  // Every byte of the hash should contribute to the hash code, including the
+  // trailing ones that synthetic hashes often differ in.
+  auto bytes = testHash.getBytes();
+  for (size_t i = 0; i < Hash::RAW_SIZE; ++i) {
+    Hash::Storage changed;
+    std::copy(bytes.begin(), bytes.end(), changed.begin());
+    changed[i] ^= 0x01;
+    EXPECT_NE(testHash.getHashCode(), Hash{changed}.getHashCode())
+        << "byte " << i;
+  }
+  EXPECT_NE(
+      Hash{"0000000000000000000000000000000000000001"}.getHashCode(),
+      Hash{"0000000000000000000000000000000000000002"}.getHashCode());
+}
+
+TEST(Hash, hexRoundTripsEveryByteValue) {
+  for (unsigned start = 0; start < 256; start += Hash::RAW_SIZE) {
+    Hash::Storage bytes;
+    for (size_t i = 0; i < Hash::RAW_SIZE; ++i) {
+      bytes[i] = static_cast<uint8_t>(start + i);
+    }
+    Hash hash{bytes};
+    auto hex = hash.toString();
+    EXPECT_EQ(folly::hexlify(hash.getBytes()), hex);
+    EXPECT_EQ(hash, Hash{hex});
+    std::transform(hex.begin(), hex.end(), hex.begin(), ::toupper);
+    EXPECT_EQ(hash, Hash{hex});
+  }
+}
+
+TEST(Hash, toAppendAppendsHex) {
+  std::string result = "hash: ";
+  toAppend(testHash, &result);
+  EXPECT_EQ("hash: " + testHashHex, result);
 }
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/SerializedTree.h"
+
+#include <gtest/gtest.h>
+
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/model/Tree.h"
+
+using namespace facebook::eden;
+using folly::StringPiece;
+
+namespace {
+const Hash hash1{"0000000000000000000000000000000000000001"};
+const Hash hash2{"0000000000000000000000000000000000000002"};
+const Hash hash3{"0000000000000000000000000000000000000003"};
+const Hash sha1{"faceb00cdeadbeefc00010ff1badb0028badf00d"};
+
+std::vector<TreeEntry> makeEntries() {
+  std::vector<TreeEntry> entries;
+  entries.emplace_back(hash1, "README", TreeEntryType::REGULAR_FILE, 42, sha1);
+  entries.emplace_back(hash2, "bin", TreeEntryType::TREE);
+  entries.emplace_back(
+      hash3, "run.sh", TreeEntryType::EXECUTABLE_FILE, 0, std::nullopt);
+  return entries;
+}
+
+SerializedTree serializeEntries(const std::vector<TreeEntry>& entries) {
+  auto buf = SerializedTree::serialize(entries);
+  return SerializedTree{buf.moveToFbString().toStdString()};
+}
+} // namespace
+
+TEST(SerializedTree, roundTripsEntries) {
+  auto entries = makeEntries();
+  auto serialized = serializeEntries(entries);
+  ASSERT_EQ(entries.size(), serialized.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EXPECT_EQ(entries[i], serialized.getEntry(i)) << "entry " << i;
+  }
+  EXPECT_EQ(42, serialized.getEntry(0).getSize().value());
+  EXPECT_EQ(sha1, serialized.getEntry(0).getContentSha1().value());
+  EXPECT_FALSE(serialized.getEntry(1).getSize().has_value());
+}
+
+TEST(SerializedTree, findsNamesInPlace) {
+  auto serialized = serializeEntries(makeEntries());
+  EXPECT_EQ(0, serialized.find(PathComponentPiece{"README"}));
+  EXPECT_EQ(1, serialized.find(PathComponentPiece{"bin"}));
+  EXPECT_EQ(2, serialized.find(PathComponentPiece{"run.sh"}));
+  EXPECT_EQ(3, serialized.find(PathComponentPiece{"lib"}));
+  EXPECT_EQ(3, serialized.find(PathComponentPiece{"zzz"}));
+}
+
+TEST(SerializedTree, emptyTree) {
+  auto serialized = serializeEntries({});
+  EXPECT_EQ(0, serialized.size());
+  EXPECT_EQ(0, serialized.find(PathComponentPiece{"a"}));
+}
+
+TEST(SerializedTree, isNotConfusedWithGitTrees) {
+  auto buf = SerializedTree::serialize(makeEntries());
+  EXPECT_TRUE(SerializedTree::isSerializedTree(buf.coalesce()));
+  EXPECT_FALSE(SerializedTree::isSerializedTree(
+      folly::ByteRange{StringPiece{"tree 0\0", 7}}));
+}
+
+TEST(SerializedTree, rejectsMalformedData) {
+  auto data = SerializedTree::serialize(makeEntries())
+                  .moveToFbString()
+                  .toStdString();
+
+  EXPECT_THROW(SerializedTree{""}, std::invalid_argument);
+  EXPECT_THROW(SerializedTree{"tree 0"}, std::invalid_argument);
+  for (size_t length = 1; length < data.size(); ++length) {
+    EXPECT_THROW(
+        (SerializedTree{data.substr(0, length)}), std::invalid_argument)
+        << "truncated to " << length << " bytes";
+  }
+
+  auto badType = data;
+  // The first record starts right after the 5 byte header and 4 offsets.
+  badType[5 + 4 * 4] = 17;
+  EXPECT_THROW(SerializedTree{badType}, std::invalid_argument);
+}
+
+TEST(SerializedTree, backsTree) {
+  auto entries = makeEntries();
+  Tree decoded{makeEntries(), hash1};
+  Tree tree{hash1, serializeEntries(entries)};
+
+  auto* bin = tree.getEntryPtr(PathComponentPiece{"bin"});
+  ASSERT_NE(nullptr, bin);
+  EXPECT_EQ(entries[1], *bin);
+  EXPECT_EQ(bin, tree.getEntryPtr(PathComponentPiece{"bin"}))
+      << "looking an entry up again returns the same TreeEntry";
+  EXPECT_EQ(nullptr, tree.getEntryPtr(PathComponentPiece{"lib"}));
+
+  EXPECT_EQ(decoded, tree);
+  EXPECT_EQ(entries, tree.getTreeEntries());
+  EXPECT_EQ(entries[2], tree.getEntryAt(2));
+}
@@ -67,3 +67,30 @@ TEST(Tree, testGetEntryPtr) {
   PathComponentPiece nonExistentPath("not_a_file");
   EXPECT_EQ(nullptr, tree.getEntryPtr(nonExistentPath));
 }
+
+#ifdef _WIN32
+TEST(Tree, caseInsensitiveLookupInLargeTree) {
+  vector<TreeEntry> entries;
+  for (int i = 0; i < 1000; ++i) {
+    entries.emplace_back(
+        testHash,
+        folly::to<std::string>("File", i),
+        TreeEntryType::REGULAR_FILE);
+  }
+  // Names that only differ in case resolve to the first of them.
+  entries.emplace_back(testHash, "README", TreeEntryType::REGULAR_FILE);
+  entries.emplace_back(testHash, "Readme", TreeEntryType::REGULAR_FILE);
+  std::sort(entries.begin(), entries.end(), [](auto& a, auto& b) {
+    return a.getName() < b.getName();
+  });
+  Tree tree(std::move(entries));
+
+  auto entry = tree.getEntryPtr("file123"_pc);
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ("File123"_pc, entry->getName());
+  entry = tree.getEntryPtr("readme"_pc);
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ("README"_pc, entry->getName());
+  EXPECT_EQ(nullptr, tree.getEntryPtr("file1000"_pc));
+}
+#endif
@@ -299,6 +299,15 @@ void SpawnedEdenInstance::beginProcessingLogPipe() {
   // Start reading from Eden's stdout, and forwarding it to our log file
   auto rc = ::fcntl(logPipe_.fd(), F_SETFL, O_NONBLOCK);
   folly::checkUnixError(rc, "failed to make edenfs output pipe non-blocking");
+#ifdef F_SETPIPE_SZ
+  // This is only an optimization, and may fail if kLogPipeSize is larger
+  // than the system allows, so just keep the default size on failure.
+  if (::fcntl(logPipe_.fd(), F_SETPIPE_SZ, kLogPipeSize) == -1) {
+    int errnum = errno;
+    XLOG(DBG2) << "unable to enlarge the edenfs output pipe: "
+               << folly::errnoStr(errnum);
+  }
+#endif
   changeHandlerFD(folly::NetworkSocket(logPipe_.fd()));
   registerHandler(EventHandler::READ | EventHandler::PERSIST);
 }
@@ -309,27 +318,56 @@ void SpawnedEdenInstance::forwardLogOutput() {
   // does not support writing to files in O_APPEND mode.  Using O_APPEND for the
   // log seems important just in case multiple separate processes do end up
   // writing to the log file at the same time.
-  auto bytesRead =
-      folly::readNoInt(logPipe_.fd(), logBuffer_.data(), logBuffer_.size());
-  if (bytesRead <= 0) {
-    if (bytesRead == 0) {
-      XLOG(DBG1) << "EdenFS output closed";
-    } else {
-      int errnum = errno;
-      XLOG(ERR) << "error reading EdenFS output: " << folly::errnoStr(errnum);
-      if (errnum == EAGAIN) {
-        // This isn't really expected, since we were told that the fd was ready.
-        // Just return without closing the log pipe in this case.
-        return;
+  //
+  // Instead we fill the whole buffer from the pipe before writing it out, so
+  // that a burst of small log messages costs one write() per buffer rather
+  // than one per message.
+  for (size_t n = 0; n < kMaxLogBuffersPerEvent; ++n) {
+    size_t bufferUsed = 0;
+    bool pipeEmpty = false;
+    bool pipeClosed = false;
+    while (bufferUsed < logBuffer_.size()) {
+      auto bytesRead = folly::readNoInt(
+          logPipe_.fd(),
+          logBuffer_.data() + bufferUsed,
+          logBuffer_.size() - bufferUsed);
+      if (bytesRead > 0) {
+        bufferUsed += bytesRead;
+        continue;
+      }
+
+      if (bytesRead == 0) {
+        XLOG(DBG1) << "EdenFS output closed";
+        pipeClosed = true;
+      } else {
+        int errnum = errno;
+        if (errnum != EAGAIN) {
+          XLOG(ERR) << "error reading EdenFS output: "
+                    << folly::errnoStr(errnum);
+          pipeClosed = true;
+        }
       }
+      pipeEmpty = true;
+      break;
+    }
+
+    if (bufferUsed > 0) {
+      writeLogOutput(bufferUsed);
+    }
+    if (pipeClosed) {
+      closeLogPipe();
+      return;
+    }
+    if (pipeEmpty) {
+      return;
     }
-    closeLogPipe();
-    return;
   }
+}
 
-  auto errnum = log_->write(logBuffer_.data(), bytesRead);
+void SpawnedEdenInstance::writeLogOutput(size_t length) {
+  auto errnum = log_->write(logBuffer_.data(), length);
   if (errnum == 0) {
-    XLOG(DBG3) << "forwarded " << bytesRead << " log bytes";
+    XLOG(DBG3) << "forwarded " << length << " log bytes";
   } else {
     // On a write error we generally still want to keep reading from EdenFS's
     // output and attempting to write to the log file.
@@ -115,6 +115,14 @@ class SpawnedEdenInstance : public EdenInstance,
  private:
   static constexpr size_t kLogBufferSize = 64 * 1024;
 
+  // The capacity to request for the EdenFS output pipe, so that EdenFS can
+  // keep writing through bursts of logging while we are busy writing to disk.
+  static constexpr int kLogPipeSize = 1024 * 1024;
+
+  // The most buffers of output to forward in one handlerReady() call before
+  // returning to the EventBase.
+  static constexpr size_t kMaxLogBuffersPerEvent = 16;
+
   class StartupStatusChecker;
 
   void handlerReady(uint16_t events) noexcept override;
@@ -122,6 +130,7 @@ class SpawnedEdenInstance : public EdenInstance,
 
   void beginProcessingLogPipe();
   void forwardLogOutput();
+  void writeLogOutput(size_t length);
   void closeLogPipe();
   void checkLivenessImpl();
 
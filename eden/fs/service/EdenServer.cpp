@@ -10,10 +10,13 @@
 #include <cpptoml.h> // @manual=fbsource//third-party/cpptoml:cpptoml
 
 #include <sys/stat.h>
+#include <algorithm>
 #include <atomic>
 #include <fstream>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <numeric>
 #include <sstream>
 
 #include <fb303/ServiceData.h>
@@ -22,6 +25,7 @@
 #include <folly/SocketAddress.h>
 #include <folly/String.h>
 #include <folly/chrono/Conv.h>
+#include <folly/futures/FutureSplitter.h>
 #include <folly/io/async/AsyncSignalHandler.h>
 #include <folly/logging/xlog.h>
 #include <folly/stop_watch.h>
@@ -34,18 +38,22 @@
 #include "eden/fs/config/TomlConfig.h"
 #include "eden/fs/fuse/privhelper/PrivHelper.h"
 #include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/inodes/GlobCache.h"
 #include "eden/fs/service/EdenCPUThreadPool.h"
 #include "eden/fs/service/EdenError.h"
 #include "eden/fs/service/EdenServiceHandler.h"
 #include "eden/fs/service/StartupLogger.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
 #include "eden/fs/store/BlobCache.h"
+#include "eden/fs/store/BlobCacheSnapshot.h"
 #include "eden/fs/store/EmptyBackingStore.h"
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/ObjectStore.h"
 #include "eden/fs/store/RocksDbLocalStore.h"
 #include "eden/fs/store/SqliteLocalStore.h"
+#include "eden/fs/store/TreeCache.h"
+#include "eden/fs/store/TreePackStore.h"
 #include "eden/fs/store/hg/HgBackingStore.h"
 #include "eden/fs/store/hg/HgQueuedBackingStore.h"
 #include "eden/fs/telemetry/EdenStats.h"
@@ -53,6 +61,7 @@
 #include "eden/fs/telemetry/SessionInfo.h"
 #include "eden/fs/telemetry/StructuredLogger.h"
 #include "eden/fs/telemetry/StructuredLoggerFactory.h"
+#include "eden/fs/telemetry/Tracing.h"
 #include "eden/fs/utils/Clock.h"
 #include "eden/fs/utils/EnumValue.h"
 #include "eden/fs/utils/FileUtils.h"
@@ -121,6 +130,15 @@ DEFINE_int32(
     "Maximum number of active thrift requests");
 DEFINE_bool(thrift_enable_codel, false, "Enable Codel queuing timeout");
 DEFINE_int32(thrift_min_compress_bytes, 0, "Minimum response compression size");
+DEFINE_uint32(
+    trace_sample_rate,
+    0,
+    "Record the TraceBlocks of one in every N requests even while tracing is "
+    "disabled. 0 disables sampling");
+DEFINE_bool(
+    perf_counters,
+    false,
+    "Record hardware performance counters for every TraceBlock");
 DEFINE_int64(
     unload_interval_minutes,
     0,
@@ -142,6 +160,55 @@ DEFINE_uint64(
     minimumBlobCacheEntryCount,
     16,
     "The minimum number of recent blobs to keep cached. Trumps maximumBlobCacheSize");
+DEFINE_uint64(
+    blobCacheShards,
+    1,
+    "Split the blob cache into this many independently locked shards, each "
+    "with an equal share of maximumBlobCacheSize and "
+    "minimumBlobCacheEntryCount");
+DEFINE_uint64(
+    maximumBlobMetadataCacheEntryCount,
+    4000000,
+    "How many blobs' sizes and SHA-1s to keep in memory, at most, shared by "
+    "all mounts. Each entry takes somewhere around 50 bytes plus LRU "
+    "overhead");
+DEFINE_uint64(
+    blobMetadataCacheShards,
+    16,
+    "Split the blob metadata cache into this many independently locked "
+    "shards, each with an equal share of maximumBlobMetadataCacheEntryCount");
+DEFINE_uint64(
+    maximumTreeCacheSize,
+    0,
+    "How many bytes worth of deserialized trees to keep in memory, at most. "
+    "0 disables the tree cache");
+DEFINE_uint64(
+    minimumTreeCacheEntryCount,
+    16,
+    "The minimum number of recent trees to keep cached. Trumps "
+    "maximumTreeCacheSize");
+DEFINE_uint64(
+    maximumGlobCacheSize,
+    0,
+    "How many bytes worth of glob matches in unmodified source control trees "
+    "to keep in memory, at most. 0 disables the glob cache");
+DEFINE_uint64(
+    minimumGlobCacheEntryCount,
+    16,
+    "The minimum number of recent glob matches to keep cached. Trumps "
+    "maximumGlobCacheSize");
+DEFINE_bool(
+    open_local_store_in_background,
+    false,
+    "Open the local store on the server thread pool at startup, so that the "
+    "thrift server can answer requests before it is open. Requests and "
+    "mounts that need the local store wait for it");
+DEFINE_uint64(
+    takeover_blob_cache_bytes,
+    0,
+    "During a graceful restart, hand up to this many bytes of the most "
+    "recently used blobs in the blob cache over to the new process. 0 "
+    "disables the handoff");
 
 using apache::thrift::ThriftServer;
 using folly::Future;
@@ -161,6 +228,7 @@ using namespace facebook::eden;
 
 constexpr StringPiece kRocksDBPath{"storage/rocks-db"};
 constexpr StringPiece kSqlitePath{"storage/sqlite.db"};
+constexpr StringPiece kTreePackPath{"storage/tree-packs"};
 constexpr StringPiece kHgStorePrefix{"store.hg"};
 constexpr StringPiece kFuseRequestPrefix{"fuse"};
 constexpr StringPiece kStateConfig{"config.toml"};
@@ -195,6 +263,14 @@ std::string getCounterNameForImportMetric(
       RequestMetricsScope::stringOfRequestMetric(metric));
 }
 
+std::string getCounterNameForQueueDepth(HgBackingStore::HgImportObject object) {
+  // base prefix . queue_depth . object
+  return folly::to<std::string>(
+      kHgStorePrefix,
+      ".queue_depth.",
+      HgBackingStore::stringOfHgImportObject(object));
+}
+
 std::string getCounterNameForFuseRequests(
     RequestMetricsScope::RequestStage stage,
     RequestMetricsScope::RequestMetric metric,
@@ -259,6 +335,19 @@ size_t getNumberPendingFuseRequests(const EdenMount* mount) {
 }
 #endif // __linux__
 
+BlobCache::AdmissionPolicy getBlobCacheAdmissionPolicy(
+    const EdenConfig& config) {
+  const auto& policy = config.blobCacheAdmissionPolicy.getValue();
+  if (policy == "tinylfu") {
+    return BlobCache::AdmissionPolicy::TinyLfu;
+  }
+  if (policy != "all") {
+    XLOG(WARN) << "unknown store:blob-cache-admission-policy \"" << policy
+               << "\", admitting all blobs";
+  }
+  return BlobCache::AdmissionPolicy::All;
+}
+
 } // namespace
 
 namespace facebook {
@@ -319,6 +408,19 @@ class EdenServer::ThriftServerEventHandler
 };
 
 static constexpr folly::StringPiece kBlobCacheMemory{"blob_cache.memory"};
+static constexpr folly::StringPiece kTreeCacheMemory{"tree_cache.memory"};
+static constexpr folly::StringPiece kGlobCacheMemory{"glob_cache.memory"};
+// The totals of every mount's TreePrefetchPolicy.
+using TreePrefetchStat = uint64_t TreePrefetchPolicy::Stats::*;
+static constexpr std::pair<folly::StringPiece, TreePrefetchStat>
+    kTreePrefetchCounters[] = {
+        {"tree_prefetch.children_prefetched",
+         &TreePrefetchPolicy::Stats::prefetchedChildren},
+        {"tree_prefetch.children_used",
+         &TreePrefetchPolicy::Stats::usedChildren},
+        {"tree_prefetch.useful_bytes", &TreePrefetchPolicy::Stats::usefulBytes},
+        {"tree_prefetch.wasted_bytes", &TreePrefetchPolicy::Stats::wastedBytes},
+};
 
 EdenServer::EdenServer(
     std::vector<std::string> originalCommandLine,
@@ -331,7 +433,24 @@ EdenServer::EdenServer(
       edenDir_{edenConfig->edenDir.getValue()},
       blobCache_{BlobCache::create(
           FLAGS_maximumBlobCacheSize,
-          FLAGS_minimumBlobCacheEntryCount)},
+          FLAGS_minimumBlobCacheEntryCount,
+          FLAGS_blobCacheShards,
+          getBlobCacheAdmissionPolicy(*edenConfig))},
+      treeCache_{
+          FLAGS_maximumTreeCacheSize == 0
+              ? nullptr
+              : TreeCache::create(
+                    FLAGS_maximumTreeCacheSize,
+                    FLAGS_minimumTreeCacheEntryCount)},
+      blobMetadataCache_{BlobMetadataCache::create(
+          FLAGS_maximumBlobMetadataCacheEntryCount,
+          FLAGS_blobMetadataCacheShards)},
+      globCache_{
+          FLAGS_maximumGlobCacheSize == 0
+              ? nullptr
+              : GlobCache::create(
+                    FLAGS_maximumGlobCacheSize,
+                    FLAGS_minimumGlobCacheEntryCount)},
       serverState_{make_shared<ServerState>(
           std::move(userInfo),
           std::move(privHelper),
@@ -346,6 +465,25 @@ EdenServer::EdenServer(
   counters->registerCallback(kBlobCacheMemory, [this] {
     return this->getBlobCache()->getStats().totalSizeInBytes;
   });
+  if (treeCache_) {
+    counters->registerCallback(kTreeCacheMemory, [this] {
+      return this->getTreeCache()->getStats().totalSizeInBytes;
+    });
+  }
+  if (globCache_) {
+    counters->registerCallback(kGlobCacheMemory, [this] {
+      return this->getGlobCache()->getStats().totalSizeInBytes;
+    });
+  }
+  for (const auto& counter : kTreePrefetchCounters) {
+    counters->registerCallback(counter.first, [this, stat = counter.second] {
+      uint64_t total = 0;
+      for (const auto& mount : this->getMountPoints()) {
+        total += mount->getTreePrefetchPolicy().getStats().*stat;
+      }
+      return total;
+    });
+  }
 
   for (auto stage : RequestMetricsScope::requestStages) {
     for (auto metric : RequestMetricsScope::requestMetrics) {
@@ -378,11 +516,31 @@ EdenServer::EdenServer(
       });
     }
   }
+
+  for (auto object : HgBackingStore::hgImportObjects) {
+    counters->registerCallback(
+        getCounterNameForQueueDepth(object), [this, object] {
+          auto depths = this->collectHgQueuedBackingStoreCounters(
+              [object](const HgQueuedBackingStore& store) {
+                return store.getQueueDepth(object);
+              });
+          return std::accumulate(depths.begin(), depths.end(), size_t{0});
+        });
+  }
 }
 
 EdenServer::~EdenServer() {
   auto counters = fb303::ServiceData::get()->getDynamicCounters();
   counters->unregisterCallback(kBlobCacheMemory);
+  if (treeCache_) {
+    counters->unregisterCallback(kTreeCacheMemory);
+  }
+  if (globCache_) {
+    counters->unregisterCallback(kGlobCacheMemory);
+  }
+  for (const auto& counter : kTreePrefetchCounters) {
+    counters->unregisterCallback(counter.first);
+  }
 
   for (auto stage : RequestMetricsScope::requestStages) {
     for (auto metric : RequestMetricsScope::requestMetrics) {
@@ -394,6 +552,9 @@ EdenServer::~EdenServer() {
       counters->unregisterCallback(summaryCounterName);
     }
   }
+  for (auto object : HgBackingStore::hgImportObjects) {
+    counters->unregisterCallback(getCounterNameForQueueDepth(object));
+  }
 }
 
 Future<Unit> EdenServer::unmountAll() {
@@ -460,7 +621,12 @@ Future<TakeoverData> EdenServer::stopMountsForTakeover(
               }
               return self->serverState_->getPrivHelper()
                   ->fuseTakeoverShutdown(edenMount->getPath().stringPiece())
+                  .via(self->serverState_->getThreadPool().get())
                   .thenValue([takeover = std::move(takeover)](auto&&) mutable {
+                    // Encode the inode map while other mounts are still
+                    // stopping, rather than after the slowest one.
+                    takeover.compactInodeMap =
+                        TakeoverData::encodeInodeMap(takeover.inodeMap);
                     return std::move(takeover);
                   });
             }));
@@ -475,7 +641,7 @@ Future<TakeoverData> EdenServer::stopMountsForTakeover(
   // Use collectAll() rather than collect() to wait for all of the unmounts
   // to complete, and only check for errors once everything has finished.
   return folly::collectAll(futures).toUnsafeFuture().thenValue(
-      [takeoverPromise = std::move(takeoverPromise)](
+      [this, takeoverPromise = std::move(takeoverPromise)](
           std::vector<folly::Try<optional<TakeoverData::MountInfo>>>
               results) mutable {
         TakeoverData data;
@@ -503,6 +669,22 @@ Future<TakeoverData> EdenServer::stopMountsForTakeover(
 
           data.mountPoints.emplace_back(std::move(result.value().value()));
         }
+
+        if (FLAGS_takeover_blob_cache_bytes > 0) {
+          try {
+            auto blobs = blobCache_->getMostRecentlyUsed(
+                FLAGS_takeover_blob_cache_bytes);
+            // Write the least recently used first, so the new process's
+            // cache evicts them first too.
+            std::reverse(blobs.begin(), blobs.end());
+            data.blobCacheFile = writeBlobCacheSnapshot(blobs);
+            XLOG(DBG1) << "handing " << blobs.size()
+                       << " cached blobs over to the new process";
+          } catch (const std::exception& ex) {
+            XLOG(WARN) << "not handing the blob cache over: "
+                       << folly::exceptionStr(ex);
+          }
+        }
         return data;
       });
 }
@@ -531,6 +713,12 @@ void EdenServer::startPeriodicTasks() {
   }
 #endif
 
+  // These tasks can be expensive, so keep them from competing with requests.
+  localStoreTask_.setDeferWhileBusy(true);
+  backingStoreTask_.setDeferWhileBusy(true);
+#ifndef _WIN32
+  inodeBudgetTask_.setDeferWhileBusy(true);
+#endif
   backingStoreTask_.updateInterval(1min);
 }
 
@@ -538,6 +726,19 @@ void EdenServer::updatePeriodicTaskIntervals(const EdenConfig& config) {
   // Update all periodic tasks whose interval is
   // controlled by EdenConfig settings.
 
+  // Stats must be flushed on a fixed schedule, so flushStatsTask_ is never
+  // jittered.
+  auto jitterPercent = config.periodicTaskJitterPercent.getValue();
+  reloadConfigTask_.setJitterPercent(jitterPercent);
+  checkValidityTask_.setJitterPercent(jitterPercent);
+  localStoreTask_.setJitterPercent(jitterPercent);
+  backingStoreTask_.setJitterPercent(jitterPercent);
+  memoryPressureTask_.setJitterPercent(jitterPercent);
+#ifndef _WIN32
+  memoryStatsTask_.setJitterPercent(jitterPercent);
+  inodeBudgetTask_.setJitterPercent(jitterPercent);
+#endif
+
   reloadConfigTask_.updateInterval(
       std::chrono::duration_cast<std::chrono::milliseconds>(
           config.configReloadInterval.getValue()));
@@ -553,6 +754,21 @@ void EdenServer::updatePeriodicTaskIntervals(const EdenConfig& config) {
   localStoreTask_.updateInterval(
       std::chrono::duration_cast<std::chrono::milliseconds>(
           config.localStoreManagementInterval.getValue()));
+
+  memoryPressureTask_.updateInterval(
+      config.memoryPressureThreshold.getValue() > 0
+          ? std::chrono::duration_cast<std::chrono::milliseconds>(
+                config.memoryPressureCheckInterval.getValue())
+          : std::chrono::milliseconds{0});
+
+#ifndef _WIN32
+  // A zero interval stops the task when no budget is configured.
+  inodeBudgetTask_.updateInterval(
+      config.inodeMemoryBudget.getValue() > 0
+          ? std::chrono::duration_cast<std::chrono::milliseconds>(
+                config.inodeUnloadInterval.getValue())
+          : std::chrono::milliseconds{0});
+#endif
 }
 
 #ifndef _WIN32
@@ -591,6 +807,32 @@ void EdenServer::unloadInodes() {
   scheduleInodeUnload(std::chrono::minutes(FLAGS_unload_interval_minutes));
 }
 
+void EdenServer::enforceInodeMemoryBudget() {
+  auto budget = serverState_->getReloadableConfig()
+                    .getEdenConfig()
+                    ->inodeMemoryBudget.getValue();
+  if (budget == 0) {
+    return;
+  }
+
+  uint64_t unloaded = 0;
+  for (const auto& mount : getMountPoints()) {
+    auto mountUnloaded = mount->unloadInodesOverBudget(budget);
+    if (mountUnloaded) {
+      XLOG(INFO) << "Unloaded " << mountUnloaded
+                 << " inodes to meet the inode memory budget of mount "
+                 << mount->getPath();
+    }
+    unloaded += mountUnloaded;
+  }
+  if (unloaded) {
+    auto serviceData = fb303::ServiceData::get();
+    serviceData->setCounter(
+        kPeriodicUnloadCounterKey,
+        serviceData->getCounter(kPeriodicUnloadCounterKey) + unloaded);
+  }
+}
+
 void EdenServer::scheduleInodeUnload(std::chrono::milliseconds timeout) {
   mainEventBase_->timer().scheduleTimeoutFn(
       [this] {
@@ -680,6 +922,8 @@ Future<Unit> EdenServer::prepareImpl(
   // periodic job for unloading inodes to zero on EdenServer start.
   fb303::ServiceData::get()->setCounter(kPeriodicUnloadCounterKey, 0);
 
+  setTraceSampleRate(FLAGS_trace_sample_rate);
+  setPerfCountersEnabled(FLAGS_perf_counters);
   startPeriodicTasks();
 
 #ifndef _WIN32
@@ -703,6 +947,22 @@ Future<Unit> EdenServer::prepareImpl(
     // Take over the eden lock file and the thrift server socket.
     edenDir_.takeoverLock(std::move(takeoverData.lockFile));
     server_->useExistingSocket(takeoverData.thriftSocket.release());
+
+    if (takeoverData.blobCacheFile) {
+      // Nothing waits for the old process's blobs; blobs that are loaded
+      // before they are inserted are simply read again as before.
+      folly::via(
+          serverState_->getThreadPool().get(),
+          [blobCache = blobCache_,
+           file = std::move(takeoverData.blobCacheFile)] {
+            auto count = loadBlobCacheSnapshot(file, *blobCache);
+            XLOG(DBG1) << "adopted " << count
+                       << " cached blobs from the previous process";
+          })
+          .thenError([](const folly::exception_wrapper& ew) {
+            XLOG(WARN) << "failed to adopt the previous blob cache: " << ew;
+          });
+    }
 #else
     NOT_IMPLEMENTED();
 #endif // !_WIN32
@@ -715,9 +975,29 @@ Future<Unit> EdenServer::prepareImpl(
   // is required, introduce an EdenStateConfig class to manage defaults and save
   // on update.
   auto config = parseConfig();
-  bool shouldSaveConfig = openStorageEngine(*config, *logger);
-  if (shouldSaveConfig) {
-    saveConfig(*config);
+  auto openLocalStore = [this, config, logger] {
+    bool shouldSaveConfig = openStorageEngine(*config, *logger);
+    if (shouldSaveConfig) {
+      saveConfig(*config);
+    }
+  };
+  if (FLAGS_open_local_store_in_background && !doingTakeover) {
+    // Opening RocksDB can take a long time if it needs recovery, so let the
+    // thrift server come up in the meantime.  Everything that needs the
+    // local store waits for localStoreReady_.
+    openingLocalStoreInBackground_ = true;
+    folly::via(serverState_->getThreadPool().get(), std::move(openLocalStore))
+        .thenTry([this, logger](folly::Try<Unit>&& result) {
+          if (result.hasException()) {
+            logger->warn(
+                "Failed to open the local store: ",
+                result.exception().what());
+          }
+          localStoreReady_.setTry(std::move(result));
+        });
+  } else {
+    openLocalStore();
+    localStoreReady_.setValue();
   }
 
 #ifndef _WIN32
@@ -746,6 +1026,7 @@ Future<Unit> EdenServer::prepareImpl(
     // Return a future that will complete only when all mount points have
     // started and the thrift server is also running.
     mountFutures.emplace_back(std::move(thriftRunningFuture));
+    mountFutures.emplace_back(localStoreReady_.getFuture());
     return folly::collectAllUnsafe(mountFutures).unit();
   } else {
     // Don't wait for the mount futures.
@@ -798,14 +1079,20 @@ bool EdenServer::openStorageEngine(
 
   if (storageEngine == "memory") {
     logger.log("Creating new memory store.");
-    localStore_ = make_shared<MemoryLocalStore>();
+    localStore_ = make_shared<MemoryLocalStore>(
+        serverState_->getEdenConfig()->localStoreMemorySizeLimit.getValue());
   } else if (storageEngine == "sqlite") {
     const auto path = edenDir_.getPath() + RelativePathPiece{kSqlitePath};
     const auto parentDir = path.dirname();
     ensureDirectoryExists(parentDir);
     logger.log("Opening local SQLite store ", path, "...");
     folly::stop_watch<std::chrono::milliseconds> watch;
-    localStore_ = make_shared<SqliteLocalStore>(path);
+    auto config = serverState_->getEdenConfig();
+    SqliteOptions options;
+    options.mmapSize = config->localStoreSqliteMmapSize.getValue();
+    options.cacheSize = config->localStoreSqliteCacheSize.getValue();
+    localStore_ = make_shared<SqliteLocalStore>(
+        path, options, config->localStoreSqliteReadConnections.getValue());
     logger.log(
         "Opened SQLite store in ",
         watch.elapsed().count() / 1000.0,
@@ -818,7 +1105,8 @@ bool EdenServer::openStorageEngine(
     localStore_ = make_shared<RocksDbLocalStore>(
         rocksPath,
         serverState_->getStructuredLogger(),
-        &serverState_->getFaultInjector());
+        &serverState_->getFaultInjector(),
+        *serverState_->getEdenConfig());
     localStore_->enableBlobCaching.store(
         serverState_->getEdenConfig()->enableBlobCaching.getValue(),
         std::memory_order_relaxed);
@@ -831,6 +1119,14 @@ bool EdenServer::openStorageEngine(
         folly::to<string>("invalid storage engine: ", storageEngine));
   }
 
+  auto edenConfig = serverState_->getEdenConfig();
+  if (edenConfig->localStoreTreePacks.getValue()) {
+    const auto packPath = edenDir_.getPath() + RelativePathPiece{kTreePackPath};
+    logger.log("Opening tree packs in ", packPath, "...");
+    localStore_->enableTreePacks(
+        packPath, edenConfig->localStoreTreePackSize.getValue());
+  }
+
   return configUpdated;
 }
 
@@ -841,19 +1137,31 @@ std::vector<Future<Unit>> EdenServer::prepareMountsTakeover(
   // If doingTakeover is true, use the mounts received in TakeoverData
   std::vector<Future<Unit>> mountFutures;
 #ifndef _WIN32
+  // Each mount is set up on the server thread pool, so that a mount with a
+  // large inode map does not hold up resuming the others.
+  auto* threadPool = serverState_->getThreadPool().get();
   for (auto& info : takeoverMounts) {
-    const auto stateDirectory = info.stateDirectory;
+    auto mountPath = info.mountPath;
+    folly::stop_watch<> mountStopWatch;
     auto mountFuture =
-        makeFutureWith([&] {
-          auto initialConfig = CheckoutConfig::loadFromClientDirectory(
-              AbsolutePathPiece{info.mountPath},
-              AbsolutePathPiece{info.stateDirectory});
-          return mount(std::move(initialConfig), false, std::move(info));
-        })
-            .thenTry([logger, mountPath = info.mountPath](
+        folly::via(
+            threadPool,
+            [this, info = std::move(info)]() mutable {
+              auto initialConfig = CheckoutConfig::loadFromClientDirectory(
+                  AbsolutePathPiece{info.mountPath},
+                  AbsolutePathPiece{info.stateDirectory});
+              return mount(std::move(initialConfig), false, std::move(info));
+            })
+            .thenTry([logger, mountPath, mountStopWatch](
                          folly::Try<std::shared_ptr<EdenMount>>&& result) {
               if (result.hasValue()) {
-                logger->log("Successfully took over mount ", mountPath);
+                logger->log(
+                    "Successfully took over mount ",
+                    mountPath,
+                    " in ",
+                    std::chrono::duration<double>{mountStopWatch.elapsed()}
+                        .count(),
+                    " seconds");
                 return makeFuture();
               } else {
                 incrementStartupMountFailures();
@@ -896,7 +1204,16 @@ std::vector<Future<Unit>> EdenServer::prepareMounts(
   }
   logger->log("Remounting ", dirs.size(), " mount points...");
 
+  // Remounting is a pipeline: the checkout configs are loaded here, then the
+  // backing store of each distinct repository is created, and each checkout
+  // is mounted as soon as its backing store is ready.  The last two stages
+  // run on the server thread pool, so a slow importer start or overlay check
+  // only delays the checkouts that depend on it.
+  auto* threadPool = serverState_->getThreadPool().get();
+  std::unordered_map<BackingStoreKey, folly::FutureSplitter<Unit>>
+      backingStoresReady;
   for (const auto& client : dirs.items()) {
+    folly::stop_watch<> mountStopWatch;
     auto mountFuture =
         makeFutureWith([&] {
           MountInfo mountInfo;
@@ -907,12 +1224,39 @@ std::vector<Future<Unit>> EdenServer::prepareMounts(
           auto initialConfig = CheckoutConfig::loadFromClientDirectory(
               AbsolutePathPiece{mountInfo.mountPoint},
               AbsolutePathPiece{mountInfo.edenClientPath});
-          return mount(std::move(initialConfig), false);
+
+          BackingStoreKey key{
+              initialConfig->getRepoType(), initialConfig->getRepoSource()};
+          auto it = backingStoresReady.find(key);
+          if (it == backingStoresReady.end()) {
+            auto ready =
+                localStoreReady_.getSemiFuture().via(threadPool).thenValue(
+                    [this, key](auto&&) {
+                      getBackingStore(key.first, key.second);
+                    });
+            it = backingStoresReady
+                     .emplace(std::move(key), std::move(ready))
+                     .first;
+          }
+          return it->second.getFuture().thenValue(
+              [this, logger, initialConfig = std::move(initialConfig)](
+                  auto&&) mutable {
+                return mount(
+                    std::move(initialConfig), false, std::nullopt, logger);
+              });
         })
-            .thenTry([logger, mountPath = client.first.asString()](
+            .thenTry([logger,
+                      mountPath = client.first.asString(),
+                      mountStopWatch](
                          folly::Try<std::shared_ptr<EdenMount>>&& result) {
               if (result.hasValue()) {
-                logger->log("Successfully remounted ", mountPath);
+                logger->log(
+                    "Successfully remounted ",
+                    mountPath,
+                    " in ",
+                    std::chrono::duration<double>{mountStopWatch.elapsed()}
+                        .count(),
+                    " seconds");
                 return makeFuture();
               } else {
                 incrementStartupMountFailures();
@@ -948,7 +1292,12 @@ void EdenServer::closeStorage() {
   // destroyed. We want to ensure that it is really closed and no subsequent
   // I/O can happen to it after the EdenServer is shut down and the main Eden
   // lock is released.
-  localStore_->close();
+  if (openingLocalStoreInBackground_) {
+    localStoreReady_.getSemiFuture().wait();
+  }
+  if (localStore_) {
+    localStore_->close();
+  }
 }
 
 bool EdenServer::performCleanup() {
@@ -1089,6 +1438,9 @@ void EdenServer::registerStats(std::shared_ptr<EdenMount> edenMount) {
         auto stats = edenMount->getJournal().getStats();
         return stats ? stats->maxFilesAccumulated : 0;
       });
+  counters->registerCallback(
+      edenMount->getCounterName(CounterName::OVERLAY_GC_QUEUE_DEPTH),
+      [edenMount] { return edenMount->getOverlay()->getGCQueueDepth(); });
   for (auto metric : RequestMetricsScope::requestMetrics) {
     counters->registerCallback(
         getCounterNameForFuseRequests(
@@ -1131,6 +1483,8 @@ void EdenServer::unregisterStats(EdenMount* edenMount) {
       edenMount->getCounterName(CounterName::JOURNAL_DURATION));
   counters->unregisterCallback(
       edenMount->getCounterName(CounterName::JOURNAL_MAX_FILES_ACCUMULATED));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::OVERLAY_GC_QUEUE_DEPTH));
   for (auto metric : RequestMetricsScope::requestMetrics) {
     counters->unregisterCallback(getCounterNameForFuseRequests(
         RequestMetricsScope::RequestStage::LIVE, metric, edenMount));
@@ -1188,7 +1542,25 @@ Future<Unit> EdenServer::completeTakeoverFuseStart(
 folly::Future<std::shared_ptr<EdenMount>> EdenServer::mount(
     std::unique_ptr<CheckoutConfig> initialConfig,
     bool readOnly,
-    optional<TakeoverData::MountInfo>&& optionalTakeover) {
+    optional<TakeoverData::MountInfo>&& optionalTakeover,
+    std::shared_ptr<StartupLogger> startupLogger) {
+  if (!localStoreReady_.isFulfilled()) {
+    return localStoreReady_.getSemiFuture()
+        .via(serverState_->getThreadPool().get())
+        .thenValue([this,
+                    initialConfig = std::move(initialConfig),
+                    readOnly,
+                    optionalTakeover = std::move(optionalTakeover),
+                    startupLogger = std::move(startupLogger)](
+                       auto&&) mutable {
+          return mount(
+              std::move(initialConfig),
+              readOnly,
+              std::move(optionalTakeover),
+              std::move(startupLogger));
+        });
+  }
+
   folly::stop_watch<> mountStopWatch;
 
   auto backingStore = getBackingStore(
@@ -1197,8 +1569,22 @@ folly::Future<std::shared_ptr<EdenMount>> EdenServer::mount(
       getLocalStore(),
       backingStore,
       getSharedStats(),
-      serverState_->getThreadPool().get());
+      serverState_->getThreadPool().get(),
+      treeCache_,
+      blobMetadataCache_);
   auto journal = std::make_unique<Journal>(getSharedStats());
+  auto edenConfig = serverState_->getEdenConfig();
+  journal->setStagedWrites(edenConfig->journalStagedWrites.getValue());
+  if (edenConfig->persistentJournal.getValue()) {
+    auto logPath = initialConfig->getClientDirectory() + "journal"_pc;
+    try {
+      journal->attachLog(JournalLog::open(
+          logPath, edenConfig->persistentJournalSize.getValue()));
+    } catch (const std::exception& ex) {
+      XLOG(WARN) << "unable to open journal log " << logPath << ": "
+                 << folly::exceptionStr(ex);
+    }
+  }
 
   // Create the EdenMount object and insert the mount into the mountPoints_ map.
   auto edenMount = EdenMount::create(
@@ -1222,15 +1608,30 @@ folly::Future<std::shared_ptr<EdenMount>> EdenServer::mount(
 
   // Now actually begin starting the mount point
   const bool doTakeover = optionalTakeover.has_value();
+  Overlay::FsckProgressCallback fsckProgressCallback;
+  if (startupLogger) {
+    fsckProgressCallback = [startupLogger,
+                            mountPath = edenMount->getPath()](
+                               uint32_t percentComplete) {
+      startupLogger->log(
+          "Checking overlay of ",
+          mountPath,
+          ": ",
+          percentComplete,
+          "% scanned");
+    };
+  }
   auto initFuture = edenMount->initialize(
       optionalTakeover ? std::make_optional(optionalTakeover->inodeMap)
-                       : std::nullopt);
+                       : std::nullopt,
+      std::move(fsckProgressCallback));
   return std::move(initFuture)
       .thenTry([this,
                 doTakeover,
                 readOnly,
                 edenMount,
                 mountStopWatch,
+                startupLogger,
                 optionalTakeover = std::move(optionalTakeover)](
                    folly::Try<Unit>&& result) mutable {
         if (result.hasException()) {
@@ -1240,6 +1641,14 @@ folly::Future<std::shared_ptr<EdenMount>> EdenServer::mount(
           return makeFuture<shared_ptr<EdenMount>>(
               std::move(result).exception());
         }
+        if (startupLogger) {
+          startupLogger->log(
+              "Initialized ",
+              edenMount->getPath(),
+              " in ",
+              std::chrono::duration<double>{mountStopWatch.elapsed()}.count(),
+              " seconds");
+        }
         return (optionalTakeover ? performTakeoverFuseStart(
                                        edenMount, std::move(*optionalTakeover))
                                  : performFreshFuseStart(edenMount, readOnly))
@@ -1298,6 +1707,9 @@ folly::Future<std::shared_ptr<EdenMount>> EdenServer::mount(
               event.success = !t.hasException();
               event.clean = edenMount->getOverlay()->hadCleanStartup();
               serverState_->getStructuredLogger()->logEvent(event);
+              if (!t.hasException()) {
+                edenMount->prefetchWorkingSet();
+              }
               return makeFuture(std::move(t));
             });
       });
@@ -1454,15 +1866,20 @@ shared_ptr<BackingStore> EdenServer::getBackingStore(
     StringPiece type,
     StringPiece name) {
   BackingStoreKey key{type.str(), name.str()};
-  auto lockedStores = backingStores_.wlock();
-  const auto it = lockedStores->find(key);
-  if (it != lockedStores->end()) {
-    return it->second;
+  {
+    auto lockedStores = backingStores_.rlock();
+    const auto it = lockedStores->find(key);
+    if (it != lockedStores->end()) {
+      return it->second;
+    }
   }
 
-  const auto store = createBackingStore(type, name);
-  lockedStores->emplace(key, store);
-  return store;
+  // The store is created without holding the lock so that the stores of
+  // different repositories can start up concurrently.  If another thread
+  // created one for this repository first, use that one instead.
+  auto store = createBackingStore(type, name);
+  auto lockedStores = backingStores_.wlock();
+  return lockedStores->emplace(std::move(key), std::move(store)).first->second;
 }
 
 std::unordered_set<shared_ptr<HgQueuedBackingStore>>
@@ -1496,15 +1913,24 @@ shared_ptr<BackingStore> EdenServer::createBackingStore(
     return make_shared<EmptyBackingStore>();
   } else if (type == "hg") {
     const auto repoPath = realpath(name);
+    auto reloadableConfig = shared_ptr<ReloadableConfig>(
+        serverState_, &serverState_->getReloadableConfig());
     auto store = std::make_unique<HgBackingStore>(
         repoPath,
         localStore_.get(),
         serverState_->getThreadPool().get(),
-        shared_ptr<ReloadableConfig>(
-            serverState_, &serverState_->getReloadableConfig()),
+        reloadableConfig,
         getSharedStats());
+    auto importThreads = std::clamp<uint64_t>(
+        reloadableConfig->getEdenConfig()->hgImportThreads.getValue(),
+        1,
+        std::numeric_limits<uint8_t>::max());
     return make_shared<HgQueuedBackingStore>(
-        localStore_, getSharedStats(), std::move(store));
+        localStore_,
+        getSharedStats(),
+        std::move(store),
+        static_cast<uint8_t>(importThreads),
+        std::move(reloadableConfig));
   } else if (type == "git") {
 #ifdef EDEN_HAVE_GIT
     const auto repoPath = realpath(name);
@@ -1617,7 +2043,9 @@ folly::Future<TakeoverData> EdenServer::startTakeoverShutdown() {
         // takeover start of the new process. We could potentially test this
         // more and change it in the future to simply flush instead of
         // compact if this proves to be too expensive.
-        localStore_->compactStorage();
+        if (localStoreReady_.isFulfilled() && localStore_) {
+          localStore_->compactStorage();
+        }
 
         shutdownSubscribers();
 
@@ -1674,6 +2102,28 @@ void EdenServer::flushStatsNow() {
   serverState_->getStats().aggregate();
 }
 
+bool EdenServer::shouldDeferBackgroundTask(
+    std::chrono::milliseconds deferredFor) {
+  auto config = serverState_->getReloadableConfig().getEdenConfig(
+      ConfigReloadBehavior::NoReload);
+  auto busyRequests = config->backgroundTaskBusyRequests.getValue();
+  if (busyRequests == 0 ||
+      deferredFor >= config->backgroundTaskMaxDeferral.getValue()) {
+    return false;
+  }
+
+  uint64_t requests = server_ ? server_->getActiveRequests() : 0;
+#ifndef _WIN32
+  for (const auto& mount : getMountPoints()) {
+    if (auto* channel = mount->getFuseChannel()) {
+      requests += channel->getRequestMetric(
+          RequestMetricsScope::RequestMetric::COUNT);
+    }
+  }
+#endif // !_WIN32
+  return requests >= busyRequests;
+}
+
 void EdenServer::reportMemoryStats() {
 #ifndef _WIN32
   constexpr folly::StringPiece kRssBytes{"memory_vm_rss_bytes"};
@@ -1696,10 +2146,92 @@ void EdenServer::reportMemoryStats() {
 #endif // !_WIN32
 }
 
+void EdenServer::relieveMemoryPressure() {
+  auto config = serverState_->getReloadableConfig().getEdenConfig(
+      ConfigReloadBehavior::NoReload);
+  auto threshold = config->memoryPressureThreshold.getValue();
+  if (threshold <= 0) {
+    return;
+  }
+
+  auto path = config->memoryPressureFile.getValue();
+  if (path.empty()) {
+    path = proc_util::getMemoryPressurePath();
+  }
+  auto pressure = proc_util::readMemoryPressure(path.c_str());
+  if (!pressure) {
+    XLOG_EVERY_MS(WARN, 60000)
+        << "unable to read memory pressure from " << path;
+    return;
+  }
+  memoryPressure_.store(*pressure, std::memory_order_relaxed);
+
+  auto previousLevel = memoryGovernor_.getLevel();
+  auto consumers = memoryGovernor_.update(
+      *pressure,
+      threshold,
+      config->memoryPressureShrinkOrder.getValue(),
+      /*systemWide=*/path == kLinuxMemoryPressurePath);
+  if (memoryGovernor_.getLevel() != previousLevel && !consumers.empty()) {
+    XLOG(INFO) << "memory pressure " << *pressure << "% in " << path
+               << " is at least " << threshold << "%, releasing "
+               << folly::join(", ", consumers);
+  }
+  for (const auto& consumer : consumers) {
+    if (releaseMemoryConsumer(consumer)) {
+      memoryPressureReleaseCount_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      XLOG_EVERY_MS(WARN, 60000)
+          << "unknown memory:pressure-shrink-order consumer: " << consumer;
+    }
+  }
+}
+
+bool EdenServer::releaseMemoryConsumer(folly::StringPiece consumer) {
+  if (consumer == "tree-cache") {
+    if (treeCache_) {
+      treeCache_->clear();
+    }
+  } else if (consumer == "blob-metadata-cache") {
+    blobMetadataCache_->clear();
+  } else if (consumer == "blob-cache") {
+    blobCache_->clear();
+  } else if (consumer == "overlay-file-cache") {
+#ifndef _WIN32
+    for (const auto& mount : getMountPoints()) {
+      mount->getOverlayFileAccess()->clearCache();
+    }
+#endif // !_WIN32
+  } else if (consumer == kInodesMemoryConsumer) {
+#ifndef _WIN32
+    uint64_t unloaded = 0;
+    for (const auto& mount : getMountPoints()) {
+      unloaded += mount->unloadInodesOverBudget(0);
+    }
+    if (unloaded) {
+      auto serviceData = fb303::ServiceData::get();
+      serviceData->setCounter(
+          kPeriodicUnloadCounterKey,
+          serviceData->getCounter(kPeriodicUnloadCounterKey) + unloaded);
+    }
+#endif // !_WIN32
+  } else {
+    return false;
+  }
+  return true;
+}
+
 void EdenServer::manageLocalStore() {
   auto config = serverState_->getReloadableConfig().getEdenConfig(
       ConfigReloadBehavior::NoReload);
+  if (!localStoreReady_.isFulfilled() || !localStore_) {
+    // The local store is still being opened in the background.
+    return;
+  }
   localStore_->periodicManagementTask(*config);
+  if (auto* treePacks = localStore_->getTreePacks()) {
+    treePacks->collectGarbage(config->localStoreTreePackSizeLimit.getValue());
+  }
 }
 
 void EdenServer::refreshBackingStore() {
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -29,7 +30,9 @@
 #include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/ServerState.h"
+#include "eden/fs/store/BlobMetadataCache.h"
 #include "eden/fs/service/EdenStateDir.h"
+#include "eden/fs/service/MemoryGovernor.h"
 #include "eden/fs/service/PeriodicTask.h"
 #include "eden/fs/takeover/TakeoverHandler.h"
 #include "eden/fs/telemetry/EdenStats.h"
@@ -66,6 +69,8 @@ namespace eden {
 class BackingStore;
 class HgQueuedBackingStore;
 class BlobCache;
+class TreeCache;
+class GlobCache;
 class Dirstate;
 class EdenServiceHandler;
 class LocalStore;
@@ -210,11 +215,16 @@ class EdenServer : private TakeoverHandler {
 
   /**
    * Mount and return an EdenMount.
+   *
+   * If a startup logger is given, it reports the progress of checking the
+   * overlay if it was not shut down cleanly.  If the LocalStore is still
+   * being opened, the mount starts once it is open.
    */
   FOLLY_NODISCARD folly::Future<std::shared_ptr<EdenMount>> mount(
       std::unique_ptr<CheckoutConfig> initialConfig,
       bool readOnly,
-      std::optional<TakeoverData::MountInfo>&& optionalTakeover = std::nullopt);
+      std::optional<TakeoverData::MountInfo>&& optionalTakeover = std::nullopt,
+      std::shared_ptr<StartupLogger> startupLogger = nullptr);
 
   /**
    * Takeover a mount from another eden instance
@@ -284,14 +294,63 @@ class EdenServer : private TakeoverHandler {
    */
   std::shared_ptr<EdenMount> getMountUnsafe(folly::StringPiece mountPath) const;
 
+  /**
+   * Returns the LocalStore shared by all mounts.  This is null until the
+   * future returned by getLocalStoreReady() has completed.
+   */
   std::shared_ptr<LocalStore> getLocalStore() const {
     return localStore_;
   }
 
+  /**
+   * Returns a future that completes once the LocalStore has been opened.
+   * With --open_local_store_in_background this may be some time after the
+   * thrift server has started answering requests.
+   */
+  folly::SemiFuture<folly::Unit> getLocalStoreReady() {
+    return localStoreReady_.getSemiFuture();
+  }
+
   const std::shared_ptr<BlobCache>& getBlobCache() const {
     return blobCache_;
   }
 
+  /**
+   * Returns the TreeCache shared by all mounts, or null if the tree cache is
+   * disabled.
+   */
+  const std::shared_ptr<TreeCache>& getTreeCache() const {
+    return treeCache_;
+  }
+
+  const std::shared_ptr<BlobMetadataCache>& getBlobMetadataCache() const {
+    return blobMetadataCache_;
+  }
+
+  /**
+   * The memory stall percentage most recently read by the memory governor,
+   * or a negative value if it has not read one.  See
+   * memory:pressure-threshold.
+   */
+  double getMemoryPressure() const {
+    return memoryPressure_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * The number of consumers the memory governor has released since startup.
+   */
+  uint64_t getMemoryPressureReleaseCount() const {
+    return memoryPressureReleaseCount_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the GlobCache shared by all mounts, or null if the glob cache is
+   * disabled.
+   */
+  const std::shared_ptr<GlobCache>& getGlobCache() const {
+    return globCache_;
+  }
+
   /**
    * Look up the BackingStore object for the specified repository type+name.
    *
@@ -340,6 +399,15 @@ class EdenServer : private TakeoverHandler {
    */
   void flushStatsNow();
 
+  /**
+   * Returns true if a background periodic task that has already been
+   * postponed for deferredFor should be postponed again, because at least
+   * core:background-task-busy-requests FUSE and thrift requests are in
+   * progress and it has not yet been postponed for
+   * core:background-task-max-deferral.
+   */
+  bool shouldDeferBackgroundTask(std::chrono::milliseconds deferredFor);
+
   /**
    * Reload the configuration files from disk.
    *
@@ -494,6 +562,20 @@ class EdenServer : private TakeoverHandler {
   // Report memory usage statistics to ServiceData.
   void reportMemoryStats();
 
+#ifndef _WIN32
+  // Unload idle inodes from any mount whose loaded inodes exceed
+  // inode:memory-budget.
+  void enforceInodeMemoryBudget();
+#endif // !_WIN32
+
+  // Release in-memory state, in memory:pressure-shrink-order, while the
+  // memory stall percentage is at or above memory:pressure-threshold.
+  void relieveMemoryPressure();
+
+  // Release one consumer named in memory:pressure-shrink-order.  Returns
+  // false if the name is not known.
+  bool releaseMemoryConsumer(folly::StringPiece consumer);
+
   // Compute stats for the local store and perform garbage collection if
   // necessary
   void manageLocalStore();
@@ -543,11 +625,28 @@ class EdenServer : private TakeoverHandler {
   std::shared_ptr<ThriftServerEventHandler> serverEventHandler_;
 
   std::shared_ptr<LocalStore> localStore_;
+  /**
+   * Fulfilled once localStore_ has been set.  localStore_ must not be read
+   * by other threads before then.
+   */
+  folly::SharedPromise<folly::Unit> localStoreReady_;
+  /** Whether localStore_ is being opened on the server thread pool. */
+  bool openingLocalStoreInBackground_{false};
   folly::Synchronized<BackingStoreMap> backingStores_;
   const std::shared_ptr<BlobCache> blobCache_;
+  const std::shared_ptr<TreeCache> treeCache_;
+  const std::shared_ptr<BlobMetadataCache> blobMetadataCache_;
+  const std::shared_ptr<GlobCache> globCache_;
 
   folly::Synchronized<MountMap> mountPoints_;
 
+  /**
+   * Only accessed by relieveMemoryPressure() on the main EventBase.
+   */
+  MemoryGovernor memoryGovernor_;
+  std::atomic<double> memoryPressure_{-1.0};
+  std::atomic<uint64_t> memoryPressureReleaseCount_{0};
+
 #ifndef _WIN32
   /**
    * A server that waits on a new edenfs process to attempt
@@ -607,7 +706,13 @@ class EdenServer : private TakeoverHandler {
 #ifndef _WIN32
   PeriodicFnTask<&EdenServer::reportMemoryStats> memoryStatsTask_{this,
                                                                   "mem_stats"};
+  PeriodicFnTask<&EdenServer::enforceInodeMemoryBudget> inodeBudgetTask_{
+      this,
+      "inode_memory_budget"};
 #endif
+  PeriodicFnTask<&EdenServer::relieveMemoryPressure> memoryPressureTask_{
+      this,
+      "memory_pressure"};
   PeriodicFnTask<&EdenServer::manageLocalStore> localStoreTask_{this,
                                                                 "local_store"};
 
@@ -21,6 +21,7 @@
 #include <folly/stop_watch.h>
 #include <folly/system/Shell.h>
 #include <thrift/lib/cpp/util/EnumUtils.h>
+#include <limits>
 #include <optional>
 
 #ifdef _WIN32
@@ -52,15 +53,18 @@
 #include "eden/fs/service/EdenServer.h"
 #include "eden/fs/service/ThriftPermissionChecker.h"
 #include "eden/fs/service/ThriftUtil.h"
+#include "eden/fs/store/BlobCache.h"
 #include "eden/fs/store/BlobMetadata.h"
 #include "eden/fs/store/Diff.h"
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/store/TreeCache.h"
 #include "eden/fs/telemetry/Tracing.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/FaultInjector.h"
 #include "eden/fs/utils/ProcUtil.h"
 #include "eden/fs/utils/StatTimes.h"
+#include "eden/fs/utils/UnboundedQueueExecutor.h"
 
 using folly::Future;
 using folly::makeFuture;
@@ -213,10 +217,37 @@ facebook::eden::InodePtr inodeFromUserPath(
   if (rootRelativePath.empty() || rootRelativePath == ".") {
     return mount.getRootInode();
   } else {
-    return mount.getInode(facebook::eden::RelativePathPiece{rootRelativePath})
-        .get();
+    // Load single paths the same way as the bulk path APIs do.
+    auto inodes = facebook::eden::applyToInodes(
+        mount.getRootInode(),
+        std::vector<std::string>{rootRelativePath.str()},
+        [](facebook::eden::InodePtr inode) { return inode; });
+    return std::move(inodes[0]).get();
   }
 }
+
+#ifndef _WIN32
+/**
+ * Invalidate the kernel's cached lookups of every name in tree, and return
+ * the children of tree that are currently loaded.
+ */
+std::vector<facebook::eden::InodePtr> invalidateChildEntries(
+    facebook::eden::FuseChannel& fuseChannel,
+    facebook::eden::TreeInode& tree) {
+  std::vector<facebook::eden::PathComponentPiece> names;
+  std::vector<facebook::eden::InodePtr> loaded;
+  auto dir = tree.getContents().rlock();
+  names.reserve(dir->entries.size());
+  for (const auto& entry : dir->entries) {
+    names.push_back(entry.first);
+    if (entry.second.getInode()) {
+      loaded.push_back(entry.second.getInodePtr());
+    }
+  }
+  fuseChannel.invalidateEntries(tree.getNodeId(), folly::range(names));
+  return loaded;
+}
+#endif // !_WIN32
 } // namespace
 
 // INSTRUMENT_THRIFT_CALL returns a unique pointer to
@@ -396,58 +427,66 @@ void EdenServiceHandler::resetParentCommits(
   edenMount->resetParents(edenParents);
 }
 
-void EdenServiceHandler::getSHA1(
-    vector<SHA1Result>& out,
+folly::SemiFuture<std::unique_ptr<std::vector<SHA1Result>>>
+EdenServiceHandler::semifuture_getSHA1(
     unique_ptr<string> mountPoint,
     unique_ptr<vector<string>> paths) {
   TraceBlock block("getSHA1");
   auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint, toLogArg(*paths));
-
-  vector<Future<Hash>> futures;
-  for (const auto& path : *paths) {
-    futures.emplace_back(getSHA1ForPathDefensively(*mountPoint, path));
-  }
-
-  auto results = folly::collectAll(std::move(futures)).get();
-  for (auto& result : results) {
-    out.emplace_back();
-    SHA1Result& sha1Result = out.back();
-    if (result.hasValue()) {
-      sha1Result.set_sha1(thriftHash(result.value()));
-    } else {
-      sha1Result.set_error(newEdenError(result.exception()));
+  auto edenMount = server_->getMount(*mountPoint);
+  auto& fetchContext = ObjectFetchContext::getNullContext();
+
+  // The index into paths of each path that is looked up. Empty paths would
+  // resolve to the root, so they are rejected up front.
+  vector<size_t> indices;
+  vector<string> lookupPaths;
+  indices.reserve(paths->size());
+  lookupPaths.reserve(paths->size());
+  for (size_t i = 0; i < paths->size(); ++i) {
+    if (!(*paths)[i].empty()) {
+      indices.push_back(i);
+      lookupPaths.push_back((*paths)[i]);
     }
   }
-}
-
-Future<Hash> EdenServiceHandler::getSHA1ForPathDefensively(
-    StringPiece mountPoint,
-    StringPiece path) noexcept {
-  return folly::makeFutureWith(
-      [&] { return getSHA1ForPath(mountPoint, path); });
-}
-
-Future<Hash> EdenServiceHandler::getSHA1ForPath(
-    StringPiece mountPoint,
-    StringPiece path) {
-  if (path.empty()) {
-    return makeFuture<Hash>(newEdenError(
-        EINVAL,
-        EdenErrorType::ARGUMENT_ERROR,
-        "path cannot be the empty string"));
-  }
 
-  auto edenMount = server_->getMount(mountPoint);
-  auto relativePath = RelativePathPiece{path};
-  return edenMount->getInode(relativePath).thenValue([](const InodePtr& inode) {
-    auto fileInode = inode.asFilePtr();
-    if (!S_ISREG(fileInode->getMode())) {
-      // We intentionally want to refuse to compute the SHA1 of symlinks
-      return makeFuture<Hash>(
-          InodeError(EINVAL, fileInode, "file is a symlink"));
-    }
-    return fileInode->getSha1(ObjectFetchContext::getNullContext());
-  });
+  // applyToInodes looks up each directory once, however many of the
+  // requested files it contains, and imports the blobs whose SHA-1 is not
+  // known yet in one batch per directory rather than one at a time as each
+  // getSha1 call misses.
+  auto sha1s = applyToInodes(
+      edenMount->getRootInode(),
+      lookupPaths,
+      [&fetchContext](InodePtr inode) {
+        auto fileInode = inode.asFilePtr();
+        if (!S_ISREG(fileInode->getMode())) {
+          // We intentionally want to refuse to compute the SHA1 of symlinks
+          throw InodeError(EINVAL, fileInode, "file is a symlink");
+        }
+        return fileInode->getSha1(fetchContext);
+      },
+      /*prefetchBlobMetadata=*/true);
+
+  return collectAll(std::move(sha1s))
+      .deferValue([edenMount,
+                   indices = std::move(indices),
+                   count = paths->size()](vector<Try<Hash>>&& results) {
+        auto out = std::make_unique<vector<SHA1Result>>(count);
+        for (auto& sha1Result : *out) {
+          sha1Result.set_error(newEdenError(
+              EINVAL,
+              EdenErrorType::ARGUMENT_ERROR,
+              "path cannot be the empty string"));
+        }
+        for (size_t i = 0; i < results.size(); ++i) {
+          auto& sha1Result = (*out)[indices[i]];
+          if (results[i].hasValue()) {
+            sha1Result.set_sha1(thriftHash(results[i].value()));
+          } else {
+            sha1Result.set_error(newEdenError(results[i].exception()));
+          }
+        }
+        return out;
+      });
 }
 
 void EdenServiceHandler::getBindMounts(
@@ -591,6 +630,236 @@ EdenServiceHandler::subscribeStreamTemporary(
   return std::move(streamAndPublisher.first);
 }
 
+namespace {
+/**
+ * The server side of one subscribeChangedFiles() stream.
+ *
+ * The journal subscriber callback only marks the subscription dirty and, if
+ * no flush is pending yet, schedules one after the coalescing window, so that
+ * journal writers never do more than that per subscriber.  The flush runs on
+ * the server thread pool and sends every change since the last batch.
+ */
+class ChangedFilesSubscription
+    : public std::enable_shared_from_this<ChangedFilesSubscription> {
+ public:
+  ChangedFilesSubscription(
+      EdenServer* server,
+      std::shared_ptr<EdenMount> mount,
+      const SubscribeChangedFilesParams& params)
+      : server_{server},
+        mount_{mount},
+        coalesce_{std::max<int64_t>(0, params.coalesceMilliseconds)},
+        maxPaths_{static_cast<size_t>(
+            std::max<int64_t>(0, params.maxPathsPerBatch))} {
+    for (const auto& prefix : params.pathPrefixes) {
+      prefixes_.emplace_back(prefix);
+    }
+    state_.wlock()->position = params.fromPosition;
+  }
+
+  ~ChangedFilesSubscription() {
+    auto state = state_.wlock();
+    // We have to send an exception as part of the completion, otherwise
+    // thrift doesn't seem to notify the peer of the shutdown
+    if (state->publisher && !state->disconnected) {
+      std::move(*state->publisher)
+          .complete(folly::make_exception_wrapper<std::runtime_error>(
+              "subscriber terminated"));
+    }
+  }
+
+  void start(apache::thrift::ServerStreamPublisher<ChangedFilesBatch> pub) {
+    auto mount = mount_.lock();
+    auto state = state_.wlock();
+    state->publisher.emplace(std::move(pub));
+    if (!mount ||
+        state->position.mountGeneration !=
+            static_cast<ssize_t>(mount->getMountGeneration())) {
+      sendInvalid(*state, mount.get());
+      return;
+    }
+    state->subscriberId = mount->getJournal().registerSubscriber(
+        [self = shared_from_this()] { self->schedule(); });
+    state.unlock();
+    // There may already be changes since fromPosition.
+    schedule();
+  }
+
+  void disconnect() {
+    XLOG(DBG2) << "changed files subscriber disconnected";
+    auto state = state_.wlock();
+    state->disconnected = true;
+    state->closed = true;
+    cancelSubscriber(*state);
+  }
+
+ private:
+  struct State {
+    std::optional<apache::thrift::ServerStreamPublisher<ChangedFilesBatch>>
+        publisher;
+    std::optional<Journal::SubscriberId> subscriberId;
+    JournalPosition position;
+    bool disconnected{false};
+    bool closed{false};
+  };
+
+  void schedule() {
+    if (scheduled_.exchange(true)) {
+      return;
+    }
+    auto flush = [self = shared_from_this()] {
+      self->server_->getServerState()->getThreadPool()->add(
+          [self] { self->flush(); });
+    };
+    if (coalesce_.count() == 0) {
+      flush();
+      return;
+    }
+    auto evb = server_->getMainEventBase();
+    evb->runInEventBaseThread(
+        [evb, flush = std::move(flush), coalesce = coalesce_]() mutable {
+          evb->timer().scheduleTimeoutFn(std::move(flush), coalesce);
+        });
+  }
+
+  bool matches(RelativePathPiece path) const {
+    if (prefixes_.empty()) {
+      return true;
+    }
+    for (const auto& prefix : prefixes_) {
+      if (path == prefix || path.isSubDirOf(prefix)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void flush() {
+    // Clear the flag before reading the journal so that any change made from
+    // here on schedules another flush.
+    scheduled_.store(false);
+    auto mount = mount_.lock();
+    auto state = state_.wlock();
+    if (state->closed) {
+      return;
+    }
+    if (!mount) {
+      sendInvalid(*state, nullptr);
+      return;
+    }
+
+    auto range = mount->getJournal().accumulateRange(
+        state->position.sequenceNumber + 1);
+    if (!range) {
+      return;
+    }
+    if (range->isTruncated) {
+      sendInvalid(*state, mount.get());
+      return;
+    }
+
+    ChangedFilesBatch batch;
+    batch.fromPosition = state->position;
+    batch.toPosition.mountGeneration = mount->getMountGeneration();
+    batch.toPosition.sequenceNumber = range->toSequence;
+    batch.toPosition.snapshotHash = thriftHash(range->toHash);
+    for (const auto& entry : range->changedFilesInOverlay) {
+      if (!matches(entry.first)) {
+        continue;
+      }
+      if (entry.second.isNew()) {
+        batch.createdPaths.emplace_back(entry.first.stringPiece().str());
+      } else {
+        batch.changedPaths.emplace_back(entry.first.stringPiece().str());
+      }
+    }
+    for (const auto& path : range->uncleanPaths) {
+      if (matches(path)) {
+        batch.uncleanPaths.emplace_back(path.stringPiece().str());
+      }
+    }
+
+    auto pathCount = batch.changedPaths.size() + batch.createdPaths.size() +
+        batch.uncleanPaths.size();
+    if (maxPaths_ != 0 && pathCount > maxPaths_) {
+      sendInvalid(*state, mount.get());
+      return;
+    }
+
+    state->position = batch.toPosition;
+    if (pathCount == 0 && !range->containsHashUpdates) {
+      return;
+    }
+    state->publisher->next(std::move(batch));
+  }
+
+  /** Sends the final positionInvalid batch and closes the stream. */
+  void sendInvalid(State& state, EdenMount* mount) {
+    ChangedFilesBatch batch;
+    batch.fromPosition = state.position;
+    if (mount) {
+      batch.toPosition.mountGeneration = mount->getMountGeneration();
+      auto latest = mount->getJournal().getLatest();
+      if (latest) {
+        batch.toPosition.sequenceNumber = latest->sequenceID;
+        batch.toPosition.snapshotHash = thriftHash(latest->toHash);
+      } else {
+        batch.toPosition.snapshotHash = thriftHash(kZeroHash);
+      }
+    }
+    batch.positionInvalid = true;
+    state.publisher->next(std::move(batch));
+    std::move(*state.publisher)
+        .complete(folly::make_exception_wrapper<std::runtime_error>(
+            "journal position invalid"));
+    state.publisher.reset();
+    state.closed = true;
+    if (mount) {
+      cancelSubscriber(state, mount);
+    }
+  }
+
+  void cancelSubscriber(State& state, EdenMount* mount = nullptr) {
+    std::shared_ptr<EdenMount> locked;
+    if (!mount) {
+      locked = mount_.lock();
+      mount = locked.get();
+    }
+    if (mount && state.subscriberId) {
+      mount->getJournal().cancelSubscriber(*state.subscriberId);
+    }
+    state.subscriberId.reset();
+  }
+
+  EdenServer* const server_;
+  const std::weak_ptr<EdenMount> mount_;
+  const std::chrono::milliseconds coalesce_;
+  const size_t maxPaths_;
+  std::vector<RelativePath> prefixes_;
+  std::atomic<bool> scheduled_{false};
+  folly::Synchronized<State> state_;
+};
+} // namespace
+
+apache::thrift::ServerStream<ChangedFilesBatch>
+EdenServiceHandler::subscribeChangedFiles(
+    std::unique_ptr<SubscribeChangedFilesParams> params) {
+  auto edenMount = server_->getMount(params->mountPoint);
+  auto subscription =
+      std::make_shared<ChangedFilesSubscription>(server_, edenMount, *params);
+
+  // This is called when the subscription channel is torn down
+  auto streamAndPublisher =
+      apache::thrift::ServerStream<ChangedFilesBatch>::createPublisher(
+          [weakSubscription = std::weak_ptr{subscription}] {
+            if (auto subscription = weakSubscription.lock()) {
+              subscription->disconnect();
+            }
+          });
+  subscription->start(std::move(streamAndPublisher.second));
+  return std::move(streamAndPublisher.first);
+}
+
 void EdenServiceHandler::getFilesChangedSince(
     FileDelta& out,
     std::unique_ptr<std::string> mountPoint,
@@ -739,6 +1008,78 @@ EdenServiceHandler::semifuture_getEntryInformation(
       });
 }
 
+namespace {
+folly::Future<FileInformationOrError> loadFileInformation(InodePtr inode) {
+  return inode->stat().thenValue([](struct stat st) {
+    FileInformation info;
+    info.size = st.st_size;
+    auto ts = stMtime(st);
+    info.mtime.seconds = ts.tv_sec;
+    info.mtime.nanoSeconds = ts.tv_nsec;
+    info.mode = st.st_mode;
+
+    FileInformationOrError result;
+    result.set_info(info);
+
+    return result;
+  });
+}
+
+FileInformationOrError toFileInformationOrError(
+    Try<FileInformationOrError>&& item) {
+  if (item.hasException()) {
+    FileInformationOrError result;
+    result.set_error(newEdenError(item.exception()));
+    return result;
+  }
+  return std::move(item.value());
+}
+
+// The most entries in one chunk of a streamed response.
+constexpr size_t kStreamChunkSize = 1024;
+
+/**
+ * Sends the information for paths[begin, begin + kStreamChunkSize), then
+ * moves on to the next chunk once that one has been sent, so that only one
+ * chunk's inodes are being looked up at a time.
+ */
+void streamFileInformationFrom(
+    std::shared_ptr<EdenMount> edenMount,
+    std::shared_ptr<const vector<string>> paths,
+    size_t begin,
+    std::shared_ptr<apache::thrift::ServerStreamPublisher<FileInformationChunk>>
+        publisher,
+    std::shared_ptr<std::atomic<bool>> disconnected) {
+  if (begin >= paths->size() || disconnected->load()) {
+    std::move(*publisher).complete();
+    return;
+  }
+  auto end = std::min(paths->size(), begin + kStreamChunkSize);
+  vector<string> chunkPaths(paths->begin() + begin, paths->begin() + end);
+  collectAll(applyToInodes(
+                 edenMount->getRootInode(),
+                 chunkPaths,
+                 loadFileInformation,
+                 /*prefetchBlobMetadata=*/true))
+      .toUnsafeFuture()
+      .thenValue([edenMount, paths, end, publisher, disconnected](
+                     vector<Try<FileInformationOrError>>&& done) mutable {
+        FileInformationChunk chunk;
+        chunk.results.reserve(done.size());
+        for (auto& item : done) {
+          chunk.results.emplace_back(toFileInformationOrError(std::move(item)));
+        }
+        publisher->next(std::move(chunk));
+        streamFileInformationFrom(
+            std::move(edenMount),
+            std::move(paths),
+            end,
+            std::move(publisher),
+            std::move(disconnected));
+      });
+}
+} // namespace
+
 folly::SemiFuture<std::unique_ptr<std::vector<FileInformationOrError>>>
 EdenServiceHandler::semifuture_getFileInformation(
     std::unique_ptr<std::string> mountPoint,
@@ -755,37 +1096,40 @@ EdenServiceHandler::semifuture_getFileInformation(
   return collectAll(applyToInodes(
                         rootInode,
                         *paths,
-                        [](InodePtr inode) {
-                          return inode->stat().thenValue([](struct stat st) {
-                            FileInformation info;
-                            info.size = st.st_size;
-                            auto ts = stMtime(st);
-                            info.mtime.seconds = ts.tv_sec;
-                            info.mtime.nanoSeconds = ts.tv_nsec;
-                            info.mode = st.st_mode;
-
-                            FileInformationOrError result;
-                            result.set_info(info);
-
-                            return result;
-                          });
-                        }))
+                        loadFileInformation,
+                        /*prefetchBlobMetadata=*/true))
       .deferValue([](vector<Try<FileInformationOrError>>&& done) {
         auto out = std::make_unique<vector<FileInformationOrError>>();
         out->reserve(done.size());
         for (auto& item : done) {
-          if (item.hasException()) {
-            FileInformationOrError result;
-            result.set_error(newEdenError(item.exception()));
-            out->emplace_back(std::move(result));
-          } else {
-            out->emplace_back(item.value());
-          }
+          out->emplace_back(toFileInformationOrError(std::move(item)));
         }
         return out;
       });
 }
 
+apache::thrift::ServerStream<FileInformationChunk>
+EdenServiceHandler::streamFileInformation(
+    std::unique_ptr<std::string> mountPoint,
+    std::unique_ptr<std::vector<std::string>> paths) {
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint, toLogArg(*paths));
+  auto edenMount = server_->getMount(*mountPoint);
+
+  auto disconnected = std::make_shared<std::atomic<bool>>(false);
+  auto streamAndPublisher =
+      apache::thrift::ServerStream<FileInformationChunk>::createPublisher(
+          [disconnected] { disconnected->store(true); });
+  streamFileInformationFrom(
+      std::move(edenMount),
+      std::shared_ptr<const vector<string>>(std::move(paths)),
+      0,
+      std::make_shared<
+          apache::thrift::ServerStreamPublisher<FileInformationChunk>>(
+          std::move(streamAndPublisher.second)),
+      std::move(disconnected));
+  return std::move(streamAndPublisher.first);
+}
+
 void EdenServiceHandler::glob(
     vector<string>& out,
     unique_ptr<string> mountPoint,
@@ -811,7 +1155,10 @@ void EdenServiceHandler::glob(
                            context,
                            RelativePathPiece(),
                            rootInode,
-                           /*fileBlobsToPrefetch=*/nullptr)
+                           /*fileBlobsToPrefetch=*/nullptr,
+                           /*resultSink=*/nullptr,
+                           server_->getServerState()->getThreadPool().get(),
+                           server_->getGlobCache().get())
                        .get();
     for (auto& fileName : matches) {
       out.emplace_back(fileName.name.stringPiece().toString());
@@ -821,6 +1168,35 @@ void EdenServiceHandler::glob(
   }
 }
 
+namespace {
+folly::Future<Unit> prefetchGlobBlobs(
+    const EdenMount& edenMount,
+    const folly::Synchronized<std::vector<Hash>>& fileBlobsToPrefetch) {
+  // TODO: It would be worth tracking and logging glob fetches,
+  // since they're often used by watchman.
+  auto& context = ObjectFetchContext::getNullContext();
+
+  std::vector<folly::Future<folly::Unit>> futures;
+
+  auto store = edenMount.getObjectStore();
+  auto blobs = fileBlobsToPrefetch.rlock();
+  std::vector<Hash> batch;
+
+  for (auto& hash : *blobs) {
+    if (batch.size() >= 20480) {
+      futures.emplace_back(store->prefetchBlobs(batch, context));
+      batch.clear();
+    }
+    batch.emplace_back(hash);
+  }
+  if (!batch.empty()) {
+    futures.emplace_back(store->prefetchBlobs(batch, context));
+  }
+
+  return folly::collectUnsafe(futures).unit();
+}
+} // namespace
+
 folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::future_globFiles(
     std::unique_ptr<GlobParams> params) {
   auto helper = INSTRUMENT_THRIFT_CALL(
@@ -848,6 +1224,13 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::future_globFiles(
       ? std::make_shared<folly::Synchronized<std::vector<Hash>>>()
       : nullptr;
 
+  // A glob that only prefetches, such as `eden prefetch`, has no one waiting
+  // on its results, so it must not delay the interactive work on the pool.
+  auto& threadPool = server_->getServerState()->getThreadPool();
+  auto* globExecutor = params->prefetchFiles && params->suppressFileList
+      ? threadPool->getBackgroundExecutor()
+      : threadPool.get();
+
   // and evaluate it against the root
   return helper.wrapFuture(
       globRoot
@@ -856,7 +1239,10 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::future_globFiles(
               context,
               RelativePathPiece(),
               rootInode,
-              fileBlobsToPrefetch)
+              fileBlobsToPrefetch,
+              /*resultSink=*/nullptr,
+              globExecutor,
+              server_->getGlobCache().get())
           .thenValue([edenMount,
                       wantDtype = params->wantDtype,
                       fileBlobsToPrefetch,
@@ -879,29 +1265,8 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::future_globFiles(
               }
             }
             if (fileBlobsToPrefetch) {
-              // TODO: It would be worth tracking and logging glob fetches,
-              // since they're often used by watchman.
-              auto& context = ObjectFetchContext::getNullContext();
-
-              std::vector<folly::Future<folly::Unit>> futures;
-
-              auto store = edenMount->getObjectStore();
-              auto blobs = fileBlobsToPrefetch->rlock();
-              std::vector<Hash> batch;
-
-              for (auto& hash : *blobs) {
-                if (batch.size() >= 20480) {
-                  futures.emplace_back(store->prefetchBlobs(batch, context));
-                  batch.clear();
-                }
-                batch.emplace_back(hash);
-              }
-              if (!batch.empty()) {
-                futures.emplace_back(store->prefetchBlobs(batch, context));
-              }
-
-              return folly::collectUnsafe(futures).thenValue(
-                  [glob = std::move(out)](auto&&) mutable {
+              return prefetchGlobBlobs(*edenMount, *fileBlobsToPrefetch)
+                  .thenValue([glob = std::move(out)](auto&&) mutable {
                     return makeFuture(std::move(glob));
                   });
             }
@@ -912,6 +1277,173 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::future_globFiles(
           }));
 }
 
+namespace {
+// The most paths a streamed glob remembers so as not to send them twice.
+// Past this, repeated matches are sent again rather than using more memory.
+constexpr size_t kStreamGlobMaxSeenPaths = 1000000;
+
+/**
+ * Collects the matches of a streamed glob into chunks, sending each chunk
+ * as soon as it is full.
+ */
+class GlobStream {
+ public:
+  GlobStream(bool wantDtype, bool suppressFileList, bool mayRepeatMatches)
+      : wantDtype_{wantDtype},
+        suppressFileList_{suppressFileList},
+        state_{folly::in_place, mayRepeatMatches} {}
+
+  void start(apache::thrift::ServerStreamPublisher<GlobChunk> publisher) {
+    state_.lock()->publisher.emplace(std::move(publisher));
+  }
+
+  /**
+   * Returns false once the client has gone away, which stops the glob.
+   */
+  bool add(vector<GlobNode::GlobResult>&& results) {
+    if (disconnected_.load()) {
+      return false;
+    }
+    if (suppressFileList_ || results.empty()) {
+      return true;
+    }
+    auto state = state_.lock();
+    for (auto& entry : results) {
+      // Only overlapping patterns can match a path more than once, so only
+      // remember the paths that have been sent when there are several.
+      if (state->rememberMatches) {
+        if (!state->seenPaths.insert(entry.name).second) {
+          continue;
+        }
+        if (state->seenPaths.size() >= kStreamGlobMaxSeenPaths) {
+          XLOG(DBG2) << "streamed glob matched more than "
+                     << kStreamGlobMaxSeenPaths
+                     << " paths, no longer skipping repeated matches";
+          state->seenPaths.clear();
+          state->rememberMatches = false;
+        }
+      }
+      state->chunk.matchingFiles.emplace_back(
+          entry.name.stringPiece().toString());
+      if (wantDtype_) {
+        state->chunk.dtypes.emplace_back(static_cast<OsDtype>(entry.dtype));
+      }
+      if (state->chunk.matchingFiles.size() >= kStreamChunkSize) {
+        state->publisher->next(std::move(state->chunk));
+        state->chunk = GlobChunk{};
+      }
+    }
+  }
+
+  void finish(Try<Unit>&& result) {
+    auto state = state_.lock();
+    if (result.hasException()) {
+      std::move(*state->publisher).complete(std::move(result.exception()));
+      return;
+    }
+    if (!state->chunk.matchingFiles.empty()) {
+      state->publisher->next(std::move(state->chunk));
+    }
+    std::move(*state->publisher).complete();
+  }
+
+  void disconnect() {
+    disconnected_.store(true);
+  }
+
+  bool isDisconnected() const {
+    return disconnected_.load();
+  }
+
+ private:
+  struct State {
+    explicit State(bool rememberMatches) : rememberMatches{rememberMatches} {}
+
+    std::optional<apache::thrift::ServerStreamPublisher<GlobChunk>> publisher;
+    GlobChunk chunk;
+    bool rememberMatches;
+    std::unordered_set<RelativePath> seenPaths;
+  };
+
+  const bool wantDtype_;
+  const bool suppressFileList_;
+  std::atomic<bool> disconnected_{false};
+  folly::Synchronized<State, std::mutex> state_;
+};
+} // namespace
+
+apache::thrift::ServerStream<GlobChunk> EdenServiceHandler::streamGlobFiles(
+    std::unique_ptr<GlobParams> params) {
+  auto helper = INSTRUMENT_THRIFT_CALL(
+      DBG3,
+      params->mountPoint,
+      toLogArg(params->globs),
+      params->includeDotfiles);
+  auto edenMount = server_->getMount(params->mountPoint);
+  auto rootInode = edenMount->getRootInode();
+
+  // TODO: Track and report object fetches required for this glob.
+  auto& context = ObjectFetchContext::getNullContext();
+
+  // Compile the list of globs into a tree
+  auto globRoot = std::make_shared<GlobNode>(params->includeDotfiles);
+  try {
+    for (auto& globString : params->globs) {
+      globRoot->parse(globString);
+    }
+  } catch (const std::system_error& exc) {
+    throw newEdenError(exc);
+  }
+
+  auto fileBlobsToPrefetch = params->prefetchFiles
+      ? std::make_shared<folly::Synchronized<std::vector<Hash>>>()
+      : nullptr;
+
+  auto globStream = std::make_shared<GlobStream>(
+      params->wantDtype, params->suppressFileList, params->globs.size() > 1);
+  auto streamAndPublisher =
+      apache::thrift::ServerStream<GlobChunk>::createPublisher(
+          [weakStream = std::weak_ptr{globStream}] {
+            if (auto globStream = weakStream.lock()) {
+              globStream->disconnect();
+            }
+          });
+  globStream->start(std::move(streamAndPublisher.second));
+
+  auto resultSink = std::make_shared<GlobNode::ResultSink::element_type>(
+      [globStream](vector<GlobNode::GlobResult>&& results) {
+        return globStream->add(std::move(results));
+      });
+
+  // The matches are sent as the glob is evaluated, so the future only tells
+  // when evaluation, and any prefetching, is done.
+  helper
+      .wrapFuture(
+          folly::makeFutureWith([&] {
+            return globRoot->evaluate(
+                edenMount->getObjectStore(),
+                context,
+                RelativePathPiece(),
+                rootInode,
+                fileBlobsToPrefetch,
+                std::move(resultSink),
+                server_->getServerState()->getThreadPool().get(),
+                server_->getGlobCache().get());
+          })
+              .thenValue([edenMount, fileBlobsToPrefetch, globStream](
+                             auto&&) {
+                // Nobody is waiting for the prefetch once the client is gone.
+                if (fileBlobsToPrefetch && !globStream->isDisconnected()) {
+                  return prefetchGlobBlobs(*edenMount, *fileBlobsToPrefetch);
+                }
+                return makeFuture();
+              }))
+      .thenTry([globStream, globRoot](Try<Unit>&& result) {
+        globStream->finish(std::move(result));
+      });
+  return std::move(streamAndPublisher.first);
+}
+
 folly::Future<Unit> EdenServiceHandler::future_chown(
     std::unique_ptr<std::string> mountPoint,
     int32_t uid,
@@ -1048,8 +1580,12 @@ EdenServiceHandler::future_getScmStatusBetweenRevisions(
   auto id1 = hashFromThrift(*oldHash);
   auto id2 = hashFromThrift(*newHash);
   auto mount = server_->getMount(*mountPoint);
-  return helper.wrapFuture(
-      diffCommitsForStatus(mount->getObjectStore(), id1, id2));
+  const auto batchByLevel = server_->getServerState()
+                                ->getReloadableConfig()
+                                .getEdenConfig()
+                                ->batchedCommitDiff.getValue();
+  return helper.wrapFuture(diffCommitsForStatus(
+      mount->getObjectStore(), id1, id2, batchByLevel));
 }
 
 void EdenServiceHandler::debugGetScmTree(
@@ -1229,16 +1765,19 @@ void EdenServiceHandler::getAccessCounts(
 
 void EdenServiceHandler::clearAndCompactLocalStore() {
   auto helper = INSTRUMENT_THRIFT_CALL(DBG1);
+  server_->getLocalStoreReady().get();
   server_->getLocalStore()->clearCachesAndCompactAll();
 }
 
 void EdenServiceHandler::debugClearLocalStoreCaches() {
   auto helper = INSTRUMENT_THRIFT_CALL(DBG1);
+  server_->getLocalStoreReady().get();
   server_->getLocalStore()->clearCaches();
 }
 
 void EdenServiceHandler::debugCompactLocalStorage() {
   auto helper = INSTRUMENT_THRIFT_CALL(DBG1);
+  server_->getLocalStoreReady().get();
   server_->getLocalStore()->compactStorage();
 }
 
@@ -1284,6 +1823,8 @@ void EdenServiceHandler::getStatInfo(InternalStats& result) {
     journalThrift.memoryUsage = mount->getJournal().estimateMemoryUsage();
     result.mountPointJournalInfo[mount->getPath().stringPiece().str()] =
         journalThrift;
+    result.memoryBreakdown.journalBytes += journalThrift.memoryUsage;
+    result.memoryBreakdown.inodeBytes += mount->estimateInodeMemoryUsage();
 
     result.mountPointInfo[mount->getPath().stringPiece().str()] =
         mountInodeInfo;
@@ -1317,6 +1858,38 @@ void EdenServiceHandler::getStatInfo(InternalStats& result) {
   result.blobCacheStats.missCount = blobCacheStats.missCount;
   result.blobCacheStats.evictionCount = blobCacheStats.evictionCount;
   result.blobCacheStats.dropCount = blobCacheStats.dropCount;
+  result.blobCacheStats.admissionRejectionCount =
+      blobCacheStats.admissionRejectionCount;
+
+  result.memoryBreakdown.blobCacheBytes = blobCacheStats.totalSizeInBytes;
+  if (const auto& treeCache = server_->getTreeCache()) {
+    result.memoryBreakdown.treeCacheBytes =
+        treeCache->getStats().totalSizeInBytes;
+  }
+  result.memoryBreakdown.blobMetadataCacheEntryCount =
+      server_->getBlobMetadataCache()->size();
+  result.memoryBreakdown.memoryPressure = server_->getMemoryPressure();
+  result.memoryBreakdown.memoryPressureReleaseCount =
+      server_->getMemoryPressureReleaseCount();
+
+  for (const auto& [name, percentiles] :
+       server_->getStats()->getDurationPercentiles()) {
+    auto& thriftPercentiles = result.durationPercentiles[name];
+    thriftPercentiles.count = percentiles.count;
+    thriftPercentiles.p50 = percentiles.p50;
+    thriftPercentiles.p90 = percentiles.p90;
+    thriftPercentiles.p99 = percentiles.p99;
+    thriftPercentiles.p999 = percentiles.p999;
+    thriftPercentiles.max = percentiles.max;
+  }
+
+  for (const auto& [name, totals] : getPerfCounterTotals()) {
+    auto& perfCounters = result.perfCounters[name];
+    perfCounters.count = totals.count;
+    perfCounters.cycles = totals.values.cycles;
+    perfCounters.instructions = totals.values.instructions;
+    perfCounters.cacheMisses = totals.values.cacheMisses;
+  }
 }
 
 void EdenServiceHandler::flushStatsNow() {
@@ -1340,10 +1913,7 @@ Future<Unit> EdenServiceHandler::future_invalidateKernelInodeCache(
 
   // Invalidate all parent/child relationships potentially cached.
   if (treePtr != nullptr) {
-    const auto& dir = treePtr->getContents().rlock();
-    for (const auto& entry : dir->entries) {
-      fuseChannel->invalidateEntry(inode->getNodeId(), entry.first);
-    }
+    invalidateChildEntries(*fuseChannel, *treePtr);
   }
 
   // Wait for all of the invalidations to complete
@@ -1353,6 +1923,56 @@ Future<Unit> EdenServiceHandler::future_invalidateKernelInodeCache(
 #endif // !_WIN32
 }
 
+Future<int64_t> EdenServiceHandler::future_invalidateKernelInodeCacheRecursive(
+    std::unique_ptr<std::string> mountPoint,
+    std::unique_ptr<std::string> path) {
+#ifndef _WIN32
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG2, *mountPoint, *path);
+  auto edenMount = server_->getMount(*mountPoint);
+  InodePtr inode = inodeFromUserPath(*edenMount, *path);
+  auto* fuseChannel = edenMount->getFuseChannel();
+
+  // Walk the loaded part of the subtree first, queueing each directory's
+  // entry invalidations as we go, and only then hand the kernel the inode
+  // invalidations in large batches.  Only loaded inodes are visited: the
+  // kernel cannot have cached anything about a child that has never been
+  // loaded.  Each inode is reached through exactly one parent, so the list
+  // has no duplicates.
+  std::vector<InodeNumber> inodes{inode->getNodeId()};
+  std::vector<TreeInodePtr> pending;
+  if (auto tree = inode.asTreePtrOrNull()) {
+    pending.push_back(std::move(tree));
+  }
+  while (!pending.empty()) {
+    auto tree = std::move(pending.back());
+    pending.pop_back();
+    for (auto& child : invalidateChildEntries(*fuseChannel, *tree)) {
+      inodes.push_back(child->getNodeId());
+      if (auto childTree = child.asTreePtrOrNull()) {
+        pending.push_back(std::move(childTree));
+      }
+    }
+  }
+
+  constexpr size_t kInvalidationBatchSize = 4096;
+  for (size_t start = 0; start < inodes.size();
+       start += kInvalidationBatchSize) {
+    auto end = std::min(start + kInvalidationBatchSize, inodes.size());
+    fuseChannel->invalidateInodes(
+        folly::range(inodes.data() + start, inodes.data() + end));
+    XLOG(DBG3) << "queued kernel cache invalidation for " << end << " of "
+               << inodes.size() << " inodes under " << *path;
+  }
+
+  return fuseChannel->flushInvalidations().thenValue(
+      [count = inodes.size()](folly::Unit) {
+        return static_cast<int64_t>(count);
+      });
+#else
+  NOT_IMPLEMENTED();
+#endif // !_WIN32
+}
+
 void EdenServiceHandler::enableTracing() {
   XLOG(INFO) << "Enabling tracing";
   eden::enableTracing();
@@ -1362,8 +1982,10 @@ void EdenServiceHandler::disableTracing() {
   eden::disableTracing();
 }
 
-void EdenServiceHandler::getTracePoints(std::vector<TracePoint>& result) {
-  auto compactTracePoints = getAllTracepoints();
+namespace {
+void toThriftTracePoints(
+    const std::vector<CompactTracePoint>& compactTracePoints,
+    std::vector<TracePoint>& result) {
   for (auto& point : compactTracePoints) {
     TracePoint tp;
     tp.set_timestamp(point.timestamp.count());
@@ -1381,6 +2003,33 @@ void EdenServiceHandler::getTracePoints(std::vector<TracePoint>& result) {
     result.emplace_back(std::move(tp));
   }
 }
+} // namespace
+
+void EdenServiceHandler::getTracePoints(std::vector<TracePoint>& result) {
+  toThriftTracePoints(getAllTracepoints(), result);
+}
+
+void EdenServiceHandler::setTraceSampleRate(int64_t sampleRate) {
+  if (sampleRate < 0 || sampleRate > std::numeric_limits<uint32_t>::max()) {
+    throw newEdenError(
+        EINVAL,
+        EdenErrorType::ARGUMENT_ERROR,
+        "invalid trace sample rate: ",
+        sampleRate);
+  }
+  XLOG(INFO) << "Setting trace sample rate to " << sampleRate;
+  eden::setTraceSampleRate(static_cast<uint32_t>(sampleRate));
+}
+
+void EdenServiceHandler::getTracePointSnapshot(
+    std::vector<TracePoint>& result) {
+  toThriftTracePoints(snapshotTracepoints(), result);
+}
+
+void EdenServiceHandler::setPerfCountersEnabled(bool enabled) {
+  XLOG(INFO) << (enabled ? "Enabling" : "Disabling") << " perf counters";
+  eden::setPerfCountersEnabled(enabled);
+}
 
 namespace {
 std::optional<folly::exception_wrapper> getFaultError(
@@ -71,8 +71,8 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
       std::unique_ptr<std::string> mountPoint,
       std::unique_ptr<std::string> repoPath) override;
 
-  void getSHA1(
-      std::vector<SHA1Result>& out,
+  folly::SemiFuture<std::unique_ptr<std::vector<SHA1Result>>>
+  semifuture_getSHA1(
       std::unique_ptr<std::string> mountPoint,
       std::unique_ptr<std::vector<std::string>> paths) override;
 
@@ -124,6 +124,16 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
   apache::thrift::ServerStream<JournalPosition> subscribeStreamTemporary(
       std::unique_ptr<std::string> mountPoint) override;
 
+  apache::thrift::ServerStream<GlobChunk> streamGlobFiles(
+      std::unique_ptr<GlobParams> params) override;
+
+  apache::thrift::ServerStream<FileInformationChunk> streamFileInformation(
+      std::unique_ptr<std::string> mountPoint,
+      std::unique_ptr<std::vector<std::string>> paths) override;
+
+  apache::thrift::ServerStream<ChangedFilesBatch> subscribeChangedFiles(
+      std::unique_ptr<SubscribeChangedFilesParams> params) override;
+
   void getManifestEntry(
       ManifestEntry& out,
       std::unique_ptr<std::string> mountPoint,
@@ -198,11 +208,18 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
       std::unique_ptr<std::string> mountPoint,
       std::unique_ptr<std::string> path) override;
 
+  folly::Future<int64_t> future_invalidateKernelInodeCacheRecursive(
+      std::unique_ptr<std::string> mountPoint,
+      std::unique_ptr<std::string> path) override;
+
   void getStatInfo(InternalStats& result) override;
 
   void enableTracing() override;
   void disableTracing() override;
   void getTracePoints(std::vector<TracePoint>& result) override;
+  void setTraceSampleRate(int64_t sampleRate) override;
+  void getTracePointSnapshot(std::vector<TracePoint>& result) override;
+  void setPerfCountersEnabled(bool enabled) override;
 
   void injectFault(std::unique_ptr<FaultDefinition> fault) override;
   bool removeFault(std::unique_ptr<RemoveFaultArg> fault) override;
@@ -224,14 +241,6 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
       std::unique_ptr<GetConfigParams> params) override;
 
  private:
-  folly::Future<Hash> getSHA1ForPath(
-      folly::StringPiece mountPoint,
-      folly::StringPiece path);
-
-  folly::Future<Hash> getSHA1ForPathDefensively(
-      folly::StringPiece mountPoint,
-      folly::StringPiece path) noexcept;
-
   /**
    * If `filename` exists in the manifest as a file (not a directory), returns
    * the mode of the file as recorded in the manifest.
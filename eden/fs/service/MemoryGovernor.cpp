@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/service/MemoryGovernor.h"
+
+#include <algorithm>
+
+#include <folly/String.h>
+
+namespace facebook {
+namespace eden {
+
+std::vector<std::string> MemoryGovernor::update(
+    double pressure,
+    double threshold,
+    folly::StringPiece shrinkOrder,
+    bool systemWide) {
+  if (pressure < threshold) {
+    level_ = 0;
+    return {};
+  }
+
+  std::vector<folly::StringPiece> names;
+  folly::split(',', shrinkOrder, names, /*ignoreEmpty=*/true);
+  std::vector<std::string> consumers;
+  for (auto name : names) {
+    name = folly::trimWhitespace(name);
+    if (name.empty() || (systemWide && name == kInodesMemoryConsumer)) {
+      continue;
+    }
+    consumers.push_back(name.str());
+  }
+
+  level_ = std::min(level_ + 1, consumers.size());
+  consumers.resize(level_);
+  return consumers;
+}
+
+} // namespace eden
+} // namespace facebook
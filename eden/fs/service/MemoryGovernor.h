@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * The memory:pressure-shrink-order consumer that unloads idle inodes.
+ */
+constexpr folly::StringPiece kInodesMemoryConsumer{"inodes"};
+
+/**
+ * Decides which in-memory consumers EdenServer releases under memory
+ * pressure.
+ *
+ * While the memory stall percentage stays at or above the threshold, each
+ * check releases one more consumer of the shrink order, along with all of
+ * those before it, since they refill while the pressure lasts.  Once the
+ * pressure drops below the threshold, the next episode starts over with the
+ * first consumer.
+ */
+class MemoryGovernor {
+ public:
+  /**
+   * Records a pressure reading and returns the consumers, in the order of
+   * the comma-separated shrinkOrder, that should be released now.
+   *
+   * If systemWide is true, the reading covers the whole machine rather than
+   * the cgroup EdenFS runs in, so the pressure may come from other processes.
+   * Only caches are released then: kInodesMemoryConsumer is skipped, since
+   * unloading every idle inode is expensive to undo and would not relieve
+   * pressure that EdenFS did not cause.
+   */
+  std::vector<std::string> update(
+      double pressure,
+      double threshold,
+      folly::StringPiece shrinkOrder,
+      bool systemWide);
+
+  /**
+   * The number of consumers released by the last call to update().
+   */
+  size_t getLevel() const {
+    return level_;
+  }
+
+ private:
+  size_t level_{0};
+};
+
+} // namespace eden
+} // namespace facebook
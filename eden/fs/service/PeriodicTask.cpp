@@ -7,6 +7,8 @@
 
 #include "eden/fs/service/PeriodicTask.h"
 
+#include <fb303/ServiceData.h>
+#include <folly/Conv.h>
 #include <folly/Random.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/lang/Bits.h>
@@ -18,15 +20,38 @@ using namespace std::chrono_literals;
 
 namespace {
 constexpr auto kSlowTaskLimit = 50ms;
-}
+
+// How long to wait before checking again whether a postponed task can run.
+constexpr auto kDeferralRetryDelay = 1s;
+
+constexpr uint64_t kMaxJitterPercent = 50;
+} // namespace
 
 namespace facebook {
 namespace eden {
 
 PeriodicTask::PeriodicTask(EdenServer* server, folly::StringPiece name)
-    : server_{server}, name_{name.str()}, interval_{0} {}
+    : server_{server},
+      name_{name.str()},
+      runTimeStatName_{folly::to<std::string>(
+          "periodic_task.",
+          name,
+          ".run_time_us")},
+      deferredStatName_{
+          folly::to<std::string>("periodic_task.", name, ".deferred")},
+      interval_{0} {}
 
 void PeriodicTask::timeoutExpired() noexcept {
+  if (deferWhileBusy_ && server_->shouldDeferBackgroundTask(deferredFor_)) {
+    XLOG(DBG3) << "postponing periodic task " << name_ << " while busy";
+    fb303::ServiceData::get()->addStatValue(deferredStatName_, 1, fb303::SUM);
+    deferredFor_ += kDeferralRetryDelay;
+    server_->getMainEventBase()->timer().scheduleTimeout(
+        this, kDeferralRetryDelay);
+    return;
+  }
+  deferredFor_ = Duration(0);
+
   folly::stop_watch<> timer;
   try {
     running_ = true;
@@ -41,6 +66,10 @@ void PeriodicTask::timeoutExpired() noexcept {
   // Since these run on the main EventBase thread we want to ensure that they
   // don't block this thread for long periods of time.
   auto duration = timer.elapsed();
+  fb303::ServiceData::get()->addStatValue(
+      runTimeStatName_,
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count(),
+      fb303::AVG);
   XLOG(DBG6) << "ran periodic task " << name_ << " in "
              << (std::chrono::duration_cast<std::chrono::microseconds>(duration)
                      .count() /
@@ -96,7 +125,15 @@ void PeriodicTask::reschedule() {
   if (interval_ <= Duration(0)) {
     return;
   }
-  server_->getMainEventBase()->timer().scheduleTimeout(this, interval_);
+  auto delay = interval_;
+  auto jitterPercent = std::min(jitterPercent_, kMaxJitterPercent);
+  if (jitterPercent > 0) {
+    auto maxJitter =
+        static_cast<uint64_t>(interval_.count()) * jitterPercent / 100;
+    delay += Duration(folly::Random::rand64(2 * maxJitter + 1)) -
+        Duration(maxJitter);
+  }
+  server_->getMainEventBase()->timer().scheduleTimeout(this, delay);
 }
 
 } // namespace eden
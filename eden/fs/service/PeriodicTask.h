@@ -69,6 +69,30 @@ class PeriodicTask : private folly::HHWheelTimer::Callback {
    */
   void updateInterval(Duration interval, bool splay = true);
 
+  /**
+   * Run the task up to jitterPercent percent of its interval earlier or later
+   * than scheduled each time it is rescheduled.  Values above 50 are treated
+   * as 50.  This takes effect the next time the task is rescheduled.
+   *
+   * This function should only be called from the EdenServer's main event base
+   * thread.
+   */
+  void setJitterPercent(uint64_t jitterPercent) {
+    jitterPercent_ = jitterPercent;
+  }
+
+  /**
+   * Postpone runs of this task while EdenServer::shouldDeferBackgroundTask()
+   * reports that the server is busy.  This is meant for heavy maintenance
+   * tasks that should not compete with user-visible requests.
+   *
+   * This function should only be called from the EdenServer's main event base
+   * thread.
+   */
+  void setDeferWhileBusy(bool deferWhileBusy) {
+    deferWhileBusy_ = deferWhileBusy;
+  }
+
  protected:
   /**
    * Subclasses should implement runTask()
@@ -86,6 +110,13 @@ class PeriodicTask : private folly::HHWheelTimer::Callback {
   EdenServer* const server_;
   std::string const name_;
 
+  /**
+   * The fb303 stat names this task reports its run times and the number of
+   * times it was postponed under.
+   */
+  std::string const runTimeStatName_;
+  std::string const deferredStatName_;
+
   /*
    * PeriodicTask objects are only ever used from the EdenServer's main
    * EventBase thread.  Therefore we do not need synchronization for accessing
@@ -97,6 +128,15 @@ class PeriodicTask : private folly::HHWheelTimer::Callback {
    */
   Duration interval_;
 
+  uint64_t jitterPercent_{0};
+  bool deferWhileBusy_{false};
+
+  /**
+   * How long the current run of this task has been postponed for, if it is
+   * a deferWhileBusy_ task.
+   */
+  Duration deferredFor_{0};
+
   /**
    * The number of times this task has run slowly.
    * This is tracked purely for reporting purposes.
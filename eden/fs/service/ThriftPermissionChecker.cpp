@@ -8,8 +8,16 @@
 #include "eden/fs/service/ThriftPermissionChecker.h"
 
 #include <thrift/lib/cpp2/server/Cpp2ConnContext.h>
+#include <algorithm>
+#include <vector>
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/inodes/ServerState.h"
 
+#ifndef _WIN32
+#include <grp.h>
+#include <pwd.h>
+#endif
+
 namespace {
 /**
  * Any user can call these methods.
@@ -43,6 +51,48 @@ bool isWhitelisted(folly::StringPiece methodName) {
 namespace facebook {
 namespace eden {
 
+#ifndef _WIN32
+bool isUserInGroup(uid_t uid, gid_t gid) {
+  std::vector<char> buf(1024);
+  struct passwd pwd;
+  struct passwd* result = nullptr;
+  while (true) {
+    auto errnum = getpwuid_r(uid, &pwd, buf.data(), buf.size(), &result);
+    if (errnum == ERANGE && buf.size() < 65536) {
+      buf.resize(buf.size() * 2);
+      continue;
+    }
+    if (errnum != 0 || result == nullptr) {
+      return false;
+    }
+    break;
+  }
+  if (pwd.pw_gid == gid) {
+    return true;
+  }
+
+#ifdef __APPLE__
+  using GroupId = int;
+#else
+  using GroupId = gid_t;
+#endif
+  std::vector<GroupId> groups(64);
+  int count = groups.size();
+  while (getgrouplist(pwd.pw_name, pwd.pw_gid, groups.data(), &count) < 0) {
+    // Linux reports the number of groups needed; macOS does not.
+    auto size = std::max<size_t>(count, groups.size() * 2);
+    if (size > 65536) {
+      return false;
+    }
+    groups.resize(size);
+    count = groups.size();
+  }
+  groups.resize(count);
+  return std::find(groups.begin(), groups.end(), static_cast<GroupId>(gid)) !=
+      groups.end();
+}
+#endif
+
 ThriftPermissionChecker::ThriftPermissionChecker(
     std::shared_ptr<ServerState> serverState)
     : serverState_{std::move(serverState)} {}
@@ -99,9 +149,14 @@ void ThriftPermissionChecker::preRead(void* ctx, const char* fn_name) {
   }
   const auto& peerCreds = *maybePeerCreds;
 
-  uid_t processOwner = serverState_->getUserInfo().getUid();
+  const auto& processOwner = serverState_->getUserInfo();
+  if (peerCreds.uid == 0 || peerCreds.uid == processOwner.getUid()) {
+    return;
+  }
 
-  if (peerCreds.uid == 0 || peerCreds.uid == processOwner) {
+  auto config = serverState_->getEdenConfig(ConfigReloadBehavior::NoReload);
+  if (config->allowUnixGroupRequests.getValue() &&
+      isGroupMember(connectionContext, peerCreds.uid, config)) {
     return;
   }
 
@@ -110,5 +165,39 @@ void ThriftPermissionChecker::preRead(void* ctx, const char* fn_name) {
 #endif
 }
 
+#ifndef _WIN32
+bool ThriftPermissionChecker::isGroupMember(
+    const void* connection,
+    uid_t peerUid,
+    const std::shared_ptr<const EdenConfig>& config) {
+  auto ownerGid = serverState_->getUserInfo().getGid();
+  if (!config->thriftPermissionCache.getValue()) {
+    return isUserInGroup(peerUid, ownerGid);
+  }
+
+  DecisionKey key{connection, peerUid};
+  {
+    auto cache = decisionCache_.rlock();
+    if (cache->config == config) {
+      auto it = cache->decisions.findWithoutPromotion(key);
+      if (it != cache->decisions.end()) {
+        return it->second;
+      }
+    }
+  }
+
+  // Look the membership up without holding the lock, since it may have to
+  // consult a remote name service.
+  auto isMember = isUserInGroup(peerUid, ownerGid);
+  auto cache = decisionCache_.wlock();
+  if (cache->config != config) {
+    cache->decisions.clear();
+    cache->config = config;
+  }
+  cache->decisions.set(key, isMember);
+  return isMember;
+}
+#endif
+
 } // namespace eden
 } // namespace facebook
@@ -7,12 +7,20 @@
 
 #pragma once
 
+#include <folly/SharedMutex.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/hash/Hash.h>
 #include <thrift/lib/cpp/TProcessorEventHandler.h>
+#include <sys/types.h>
+#include <memory>
 #include <stdexcept>
+#include <utility>
 
 namespace facebook {
 namespace eden {
 
+class EdenConfig;
 class ServerState;
 
 class NotAuthorized : public std::runtime_error {
@@ -20,9 +28,24 @@ class NotAuthorized : public std::runtime_error {
   using std::runtime_error::runtime_error;
 };
 
+#ifndef _WIN32
+/**
+ * Returns whether the user with the given uid is a member of group gid,
+ * either as their primary group or as a supplementary group.  Unknown users
+ * are not members of any group.
+ */
+bool isUserInGroup(uid_t uid, gid_t gid);
+#endif
+
 /**
  * Throws NotAuthorized in preRead if process connected to Eden's unix domain
  * socket has an effective uid not allowed to access a given Thrift method.
+ *
+ * Root and the EdenFS user are always allowed.  If
+ * thrift:allow-unix-group-requests is enabled, so are members of the EdenFS
+ * user's primary group.  Looking up group membership may be slow, so with
+ * thrift:permission-cache enabled the result is cached for each connection
+ * and peer uid.  The cache is dropped whenever the EdenConfig is reloaded.
  */
 class ThriftPermissionChecker : public apache::thrift::TProcessorEventHandler {
  public:
@@ -36,7 +59,37 @@ class ThriftPermissionChecker : public apache::thrift::TProcessorEventHandler {
   void preRead(void* ctx, const char* fn_name) override;
 
  private:
+#ifndef _WIN32
+  /**
+   * Returns whether the peer with the given effective uid is a member of
+   * the EdenFS user's primary group, consulting the decision cache if it
+   * is enabled in the given config.
+   */
+  bool isGroupMember(
+      const void* connection,
+      uid_t peerUid,
+      const std::shared_ptr<const EdenConfig>& config);
+#endif
+
+  /**
+   * Connections are identified by their address, which may be reused once
+   * a connection is closed.  That is harmless, since the decision only
+   * depends on the peer uid, and it bounds how long a cached group
+   * membership can go stale.
+   */
+  using DecisionKey = std::pair<const void*, uid_t>;
+  using DecisionMap =
+      folly::EvictingCacheMap<DecisionKey, bool, folly::hasher<DecisionKey>>;
+
+  static constexpr size_t kMaxCachedConnections = 1024;
+
+  struct DecisionCache {
+    std::shared_ptr<const EdenConfig> config;
+    DecisionMap decisions{kMaxCachedConnections};
+  };
+
   std::shared_ptr<ServerState> serverState_;
+  folly::Synchronized<DecisionCache, folly::SharedMutex> decisionCache_;
 };
 
 } // namespace eden
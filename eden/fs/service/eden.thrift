@@ -450,6 +450,11 @@ struct TreeInodeEntryDebugInfo {
    * Size of the file in bytes, won't be set for directories
   */
   7: optional i64 fileSize
+  /**
+   * Set for loaded files.  True if the inode is in its compact form: it is
+   * not materialized and holds no state for loading or reading its blob.
+   */
+  8: optional bool compact
 }
 
 struct WorkingDirectoryParents {
@@ -500,12 +505,58 @@ struct CacheStats {
   4: i64 missCount
   5: i64 evictionCount
   6: i64 dropCount
+  7: i64 admissionRejectionCount
+}
+
+/**
+ * Approximate bytes held by each in-memory consumer the memory governor can
+ * release, summed over all mounts.  See memory:pressure-threshold.
+ */
+struct MemoryBreakdown {
+  1: i64 blobCacheBytes
+  2: i64 treeCacheBytes
+  3: i64 blobMetadataCacheEntryCount
+  4: i64 inodeBytes
+  5: i64 journalBytes
+  /**
+   * The memory stall percentage last read by the memory governor, or
+   * negative if the governor is disabled or has not read one.
+   */
+  6: double memoryPressure
+  7: i64 memoryPressureReleaseCount
 }
 
 /**
  * Struct to store fb303 counters from ServiceData.getCounters() and inode
  * information of all the mount points.
  */
+/**
+ * Percentiles of one duration histogram over roughly the last one to two
+ * minutes, in the units of the histogram (the ones with a _us suffix are in
+ * microseconds).  Percentiles are accurate to 1/8th of their value; max is
+ * exact.
+ */
+struct DurationPercentiles {
+  1: i64 count
+  2: i64 p50
+  3: i64 p90
+  4: i64 p99
+  5: i64 p999
+  6: i64 max
+}
+
+/**
+ * Hardware performance counters summed over every measured run of a
+ * TraceBlock, while perf counters are enabled.  Only user-space events on the
+ * thread that ran the block are counted.
+ */
+struct PerfCounterStats {
+  1: i64 count
+  2: i64 cycles
+  3: i64 instructions
+  4: i64 cacheMisses
+}
+
 struct InternalStats {
   1: i64 periodicUnloadCount
   /**
@@ -542,6 +593,20 @@ struct InternalStats {
    * and whose value is information about the journal on that mount
    */
   8: map<PathString, JournalInfo> mountPointJournalInfo
+  /**
+   * Tail latencies of every duration histogram that has been recorded to,
+   * keyed by the name of its fb303 histogram.
+   */
+  9: map<string, DurationPercentiles> durationPercentiles
+  /**
+   * Linux-only: the hardware performance counters of each TraceBlock name,
+   * if perf counters have been enabled since edenfs started.
+   */
+  10: map<string, PerfCounterStats> perfCounters
+  /**
+   * The memory held by each consumer the memory governor can release.
+   */
+  11: MemoryBreakdown memoryBreakdown
 }
 
 struct ManifestEntry {
@@ -621,6 +686,12 @@ struct AccessCounts {
   3: i64 fuseWrites
   4: i64 fuseBackingStoreImports
   5: i64 fuseDurationNs
+  // Objects imported from the backing store on behalf of this process's FUSE
+  // requests, their total size in bytes (blobs only), and the total time
+  // those requests waited for the imports.
+  6: i64 fetchCount
+  7: i64 fetchBytes
+  8: i64 fetchWaitNs
 }
 
 struct MountAccesses {
@@ -1152,6 +1223,16 @@ service EdenService extends fb303_core.BaseService {
     )
   throws (1: EdenError ex)
 
+  /**
+  * Invalidate the kernel's cache for path and for every loaded inode beneath
+  * it.  Returns the number of inodes whose cached data was invalidated.
+  */
+  i64 invalidateKernelInodeCacheRecursive(
+    1: PathString mountPoint,
+    2: PathString path
+    )
+  throws (1: EdenError ex)
+
  /**
    * Gets the number of inodes unloaded by periodic job on an EdenMount.
    */
@@ -1161,6 +1242,26 @@ service EdenService extends fb303_core.BaseService {
   void disableTracing()
   list<TracePoint> getTracePoints()
 
+  /**
+   * Trace one in every sampleRate requests, even while tracing is disabled.
+   * Each thread keeps only its most recent tracepoints.  0 turns sampling
+   * off.
+   */
+  void setTraceSampleRate(1: i64 sampleRate) throws (1: EdenError ex)
+
+  /**
+   * Like getTracePoints, but returns the buffered tracepoints without
+   * removing them, so that recent sampled traces can be fetched repeatedly.
+   */
+  list<TracePoint> getTracePointSnapshot()
+
+  /**
+   * Read the hardware performance counters at the start and end of every
+   * TraceBlock, and report their totals in getStatInfo.  This adds a few
+   * microseconds to every TraceBlock while enabled.
+   */
+  void setPerfCountersEnabled(1: bool enabled)
+
   /**
    * Configure a new fault in Eden's fault injection framework.
    *
@@ -12,6 +12,50 @@ namespace cpp2 facebook.eden
  * This is only available to cpp2 clients and won't compile for other
  * language/runtimes. */
 
+/** Parameters for subscribeChangedFiles() */
+struct SubscribeChangedFilesParams {
+  1: eden.PathString mountPoint
+  /** Changes made after this position are delivered.  A position from
+   * another mount generation is reported as invalid straight away. */
+  2: eden.JournalPosition fromPosition
+  /** Only changes to these paths, or to paths under them, are delivered.
+   * Empty means every path. */
+  3: list<eden.PathString> pathPrefixes
+  /** After a change, wait this long before sending it so that changes made
+   * in the meantime are sent in the same batch. */
+  4: i64 coalesceMilliseconds
+  /** The most paths a single batch may carry; 0 means no limit.  A client
+   * that falls further behind than this is sent positionInvalid instead of
+   * the changes. */
+  5: i64 maxPathsPerBatch
+}
+
+/** The changes to the subscribed paths between two journal positions */
+struct ChangedFilesBatch {
+  1: eden.JournalPosition fromPosition
+  2: eden.JournalPosition toPosition
+  /** As in eden.FileDelta */
+  3: list<eden.PathString> changedPaths
+  4: list<eden.PathString> createdPaths
+  5: list<eden.PathString> uncleanPaths
+  /** Set when the changes since fromPosition can no longer be delivered:
+   * the journal has been truncated past it, the mount generation changed, or
+   * the batch would have exceeded maxPathsPerBatch.  This is the last batch
+   * in the stream; the client must compute a new basis and resubscribe. */
+  6: bool positionInvalid
+}
+
+/** A chunk of the matches of streamGlobFiles(), as in eden.Glob */
+struct GlobChunk {
+  1: list<eden.PathString> matchingFiles
+  2: list<eden.OsDtype> dtypes
+}
+
+/** A chunk of the results of streamFileInformation(), in request order */
+struct FileInformationChunk {
+  1: list<eden.FileInformationOrError> results
+}
+
 service StreamingEdenService extends eden.EdenService {
   /** Request notification about changes to the journal for
    * the specified mountPoint.
@@ -29,4 +73,29 @@ service StreamingEdenService extends eden.EdenService {
    * method above. */
   stream<eden.JournalPosition> subscribeStreamTemporary(
     1: string mountPoint)
+
+  /** Stream the changes to a set of paths made after the given position.
+   *
+   * Rather than one notification per journal entry, changes are coalesced
+   * for up to coalesceMilliseconds and sent as one batch covering a range of
+   * journal positions.  Batches touching none of the subscribed paths are
+   * skipped unless the snapshot hash changed.  A client that falls too far
+   * behind gets a final batch with positionInvalid set rather than an
+   * unbounded backlog. */
+  stream<ChangedFilesBatch> subscribeChangedFiles(
+    1: SubscribeChangedFilesParams params)
+
+  /** Like globFiles(), but matches are sent in chunks while the tree is
+   * still being walked, instead of all at once at the end.  No path is sent
+   * twice, unless overlapping globs match more than a million paths, after
+   * which repeats are no longer filtered out.  The stream completes once the
+   * walk, and any prefetching, is done, or ends with the error that stopped
+   * the walk.  Cancelling the stream stops the walk and skips prefetching. */
+  stream<GlobChunk> streamGlobFiles(1: eden.GlobParams params)
+
+  /** Like getFileInformation(), but the paths are looked up a chunk at a
+   * time and each chunk of results is sent as soon as it is ready. */
+  stream<FileInformationChunk> streamFileInformation(
+    1: eden.PathString mountPoint,
+    2: list<eden.PathString> paths)
 }
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/service/MemoryGovernor.h"
+
+#include <folly/portability/GTest.h>
+
+using namespace facebook::eden;
+
+namespace {
+
+constexpr folly::StringPiece kShrinkOrder{"tree-cache, blob-cache,,inodes"};
+
+using Consumers = std::vector<std::string>;
+
+} // namespace
+
+TEST(MemoryGovernor, escalatesOneConsumerPerCheckUnderPressure) {
+  MemoryGovernor governor;
+  EXPECT_EQ(Consumers{}, governor.update(4.99, 5.0, kShrinkOrder, false));
+  EXPECT_EQ(0, governor.getLevel());
+
+  EXPECT_EQ(
+      Consumers{"tree-cache"}, governor.update(5.0, 5.0, kShrinkOrder, false));
+  EXPECT_EQ(
+      (Consumers{"tree-cache", "blob-cache"}),
+      governor.update(20.0, 5.0, kShrinkOrder, false));
+  EXPECT_EQ(
+      (Consumers{"tree-cache", "blob-cache", "inodes"}),
+      governor.update(20.0, 5.0, kShrinkOrder, false));
+  EXPECT_EQ(3, governor.getLevel());
+
+  // Further checks keep releasing every consumer.
+  EXPECT_EQ(
+      (Consumers{"tree-cache", "blob-cache", "inodes"}),
+      governor.update(20.0, 5.0, kShrinkOrder, false));
+  EXPECT_EQ(3, governor.getLevel());
+}
+
+TEST(MemoryGovernor, startsOverOncePressureDrops) {
+  MemoryGovernor governor;
+  governor.update(20.0, 5.0, kShrinkOrder, false);
+  governor.update(20.0, 5.0, kShrinkOrder, false);
+  EXPECT_EQ(2, governor.getLevel());
+
+  EXPECT_EQ(Consumers{}, governor.update(0.5, 5.0, kShrinkOrder, false));
+  EXPECT_EQ(0, governor.getLevel());
+  EXPECT_EQ(
+      Consumers{"tree-cache"}, governor.update(20.0, 5.0, kShrinkOrder, false));
+}
+
+TEST(MemoryGovernor, systemWidePressureNeverUnloadsInodes) {
+  MemoryGovernor governor;
+  for (int i = 0; i < 5; ++i) {
+    governor.update(90.0, 5.0, kShrinkOrder, true);
+  }
+  EXPECT_EQ(
+      (Consumers{"tree-cache", "blob-cache"}),
+      governor.update(90.0, 5.0, kShrinkOrder, true));
+  EXPECT_EQ(2, governor.getLevel());
+}
+
+TEST(MemoryGovernor, emptyShrinkOrderReleasesNothing) {
+  MemoryGovernor governor;
+  EXPECT_EQ(Consumers{}, governor.update(90.0, 5.0, "", false));
+  EXPECT_EQ(0, governor.getLevel());
+}
@@ -200,6 +200,36 @@ TEST_F(PeriodicTaskTest, testInterval) {
   }
 }
 
+TEST_F(PeriodicTaskTest, testJitter) {
+  constexpr auto kInterval = 100ms;
+  constexpr auto kJitter = 20ms;
+  constexpr auto kTolerance = 20ms;
+  constexpr size_t kNumInvocations = 10;
+  std::vector<TimePoint> taskInvocations;
+  TestTask task(&getServer(), "test_task", [&] {
+    taskInvocations.emplace_back();
+    if (taskInvocations.size() == kNumInvocations) {
+      getServer().stop();
+    }
+  });
+  task.setJitterPercent(20);
+  // The server is idle, so deferring while busy should not delay the task.
+  task.setDeferWhileBusy(true);
+
+  runOnServerStart([&] { task.updateInterval(kInterval, /*splay=*/false); });
+  runServer();
+
+  ASSERT_EQ(kNumInvocations, taskInvocations.size());
+  for (size_t n = 1; n < taskInvocations.size(); ++n) {
+    SCOPED_TRACE(folly::to<string>("iteration  ", n));
+    T_CHECK_TIMEOUT(
+        taskInvocations[n - 1],
+        taskInvocations[n],
+        kInterval - kJitter,
+        2 * kJitter + kTolerance);
+  }
+}
+
 PeriodicTaskTest::MultiTaskResult PeriodicTaskTest::runMultipleTasks(
     size_t numTasks,
     size_t runsPerTask,
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#ifndef _WIN32
+
+#include "eden/fs/service/ThriftPermissionChecker.h"
+
+#include <folly/portability/GTest.h>
+#include <grp.h>
+#include <pwd.h>
+#include <unistd.h>
+#include <cstring>
+#include <vector>
+
+using namespace facebook::eden;
+
+namespace {
+
+// Far above the ids handed out to real users and groups.
+constexpr uid_t kUnusedUid = 0x7ffffff0;
+constexpr gid_t kUnusedGid = 0x7ffffff0;
+
+struct passwd* getPasswdEntry(uid_t uid) {
+  static std::vector<char> buf(65536);
+  static struct passwd pwd;
+  struct passwd* result = nullptr;
+  getpwuid_r(uid, &pwd, buf.data(), buf.size(), &result);
+  return result;
+}
+
+} // namespace
+
+TEST(ThriftPermissionChecker, usersAreMembersOfTheirPrimaryGroup) {
+  auto* pwd = getPasswdEntry(getuid());
+  if (!pwd) {
+    GTEST_SKIP() << "the current user has no passwd entry";
+  }
+  EXPECT_TRUE(isUserInGroup(pwd->pw_uid, pwd->pw_gid));
+}
+
+TEST(ThriftPermissionChecker, usersAreMembersOfTheirSupplementaryGroups) {
+  auto* pwd = getPasswdEntry(getuid());
+  if (!pwd) {
+    GTEST_SKIP() << "the current user has no passwd entry";
+  }
+  std::vector<char> buf(65536);
+  struct group grp;
+  struct group* result = nullptr;
+  setgrent();
+  while (getgrent_r(&grp, buf.data(), buf.size(), &result) == 0 && result) {
+    for (auto** member = grp.gr_mem; *member; ++member) {
+      if (strcmp(*member, pwd->pw_name) == 0) {
+        EXPECT_TRUE(isUserInGroup(pwd->pw_uid, grp.gr_gid)) << grp.gr_name;
+      }
+    }
+  }
+  endgrent();
+}
+
+TEST(ThriftPermissionChecker, usersAreNotMembersOfOtherGroups) {
+  auto* pwd = getPasswdEntry(getuid());
+  if (!pwd) {
+    GTEST_SKIP() << "the current user has no passwd entry";
+  }
+  ASSERT_EQ(nullptr, getgrgid(kUnusedGid));
+  ASSERT_NE(kUnusedGid, pwd->pw_gid);
+  EXPECT_FALSE(isUserInGroup(pwd->pw_uid, kUnusedGid));
+}
+
+TEST(ThriftPermissionChecker, unknownUsersAreNotMembersOfAnyGroup) {
+  ASSERT_EQ(nullptr, getPasswdEntry(kUnusedUid));
+  EXPECT_FALSE(isUserInGroup(kUnusedUid, getgid()));
+  EXPECT_FALSE(isUserInGroup(kUnusedUid, kUnusedGid));
+}
+
+#endif
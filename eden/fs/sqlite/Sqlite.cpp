@@ -35,7 +35,9 @@ void checkSqliteResult(sqlite3* db, int result) {
       to<string>("sqlite error: ", result, ": ", sqlite3_errstr(result)));
 }
 
-SqliteDatabase::SqliteDatabase(AbsolutePathPiece path) {
+SqliteDatabase::SqliteDatabase(
+    AbsolutePathPiece path,
+    const SqliteOptions& options) {
   sqlite3* db = nullptr;
   auto result = sqlite3_open(path.copy().c_str(), &db);
   if (result != SQLITE_OK) {
@@ -45,11 +47,26 @@ SqliteDatabase::SqliteDatabase(AbsolutePathPiece path) {
     checkSqliteResult(nullptr, result);
   }
   db_ = db;
+  statements_ = std::make_unique<StatementCache>(kStatementCacheSize);
+
+  auto locked = lock();
+  if (options.mmapSize != 0) {
+    SqliteStatement(locked, "PRAGMA mmap_size=", options.mmapSize).step();
+  }
+  if (options.cacheSize != 0) {
+    // A negative cache_size is a size in KiB rather than a number of pages.
+    SqliteStatement(
+        locked, "PRAGMA cache_size=-", (options.cacheSize + 1023) / 1024)
+        .step();
+  }
 }
 
 void SqliteDatabase::close() {
   auto db = db_.wlock();
   if (*db) {
+    // Prepared statements must be finalized before the database can be
+    // closed.
+    statements_.reset();
     sqlite3_close(*db);
     *db = nullptr;
   }
@@ -63,6 +80,24 @@ Synchronized<sqlite3*>::LockedPtr SqliteDatabase::lock() {
   return db_.wlock();
 }
 
+SqliteStatement& SqliteDatabase::prepare(
+    Synchronized<sqlite3*>::LockedPtr& db,
+    StringPiece query) {
+  if (!statements_) {
+    throw std::runtime_error("the sqlite database is already closed");
+  }
+  auto key = query.str();
+  auto it = statements_->find(key);
+  if (it != statements_->end()) {
+    it->second->reset();
+    return *it->second;
+  }
+  auto stmt = std::make_unique<SqliteStatement>(db, query);
+  auto& result = *stmt;
+  statements_->set(std::move(key), std::move(stmt));
+  return result;
+}
+
 SqliteStatement::SqliteStatement(
     folly::Synchronized<sqlite3*>::LockedPtr& db,
     folly::StringPiece query)
@@ -87,6 +122,13 @@ bool SqliteStatement::step() {
   }
 }
 
+void SqliteStatement::reset() {
+  // sqlite3_reset() returns the error from the most recent step(), which has
+  // already been reported, so its result is deliberately ignored here.
+  sqlite3_reset(stmt_);
+  checkSqliteResult(db_, sqlite3_clear_bindings(stmt_));
+}
+
 void SqliteStatement::bind(
     size_t paramNo,
     folly::StringPiece blob,
@@ -8,15 +8,30 @@
 #pragma once
 #include <folly/String.h>
 #include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
 #include <sqlite3.h>
+#include <memory>
 #include "eden/fs/utils/PathFuncs.h"
+
 namespace facebook {
 namespace eden {
 
+class SqliteStatement;
+
 // Given a sqlite result code, if the result was not successful
 // (SQLITE_OK), format an error message and throw an exception.
 void checkSqliteResult(sqlite3* db, int result);
 
+/** Tuning applied to each connection when it is opened.
+ * A value of zero leaves sqlite's compiled-in default in place. */
+struct SqliteOptions {
+  /** Bytes of the database file to memory-map for reads
+   * (PRAGMA mmap_size). */
+  uint64_t mmapSize{0};
+  /** Bytes of page cache to keep per connection (PRAGMA cache_size). */
+  uint64_t cacheSize{0};
+};
+
 /** A helper class for managing a handle to a sqlite database. */
 class SqliteDatabase {
  public:
@@ -24,7 +39,9 @@ class SqliteDatabase {
    * Will throw an exception if the database fails to open.
    * The database will be created if it didn't already exist.
    */
-  explicit SqliteDatabase(AbsolutePathPiece path);
+  explicit SqliteDatabase(
+      AbsolutePathPiece path,
+      const SqliteOptions& options = SqliteOptions{});
 
   // Not copyable...
   SqliteDatabase(const SqliteDatabase&) = delete;
@@ -45,8 +62,42 @@ class SqliteDatabase {
    * to the SqliteStatement class. */
   folly::Synchronized<sqlite3*>::LockedPtr lock();
 
+  /** Return a prepared statement for `query`, compiling it only if it is not
+   * already in this connection's statement cache.
+   * `db` must be this database's lock.  The statement is reset and ready to
+   * be bound, and stays valid until the next prepare() call or until the
+   * database is closed; it must only be used while `db` is held.
+   * The least recently used statements are finalized once the cache holds
+   * more than kStatementCacheSize of them. */
+  SqliteStatement& prepare(
+      folly::Synchronized<sqlite3*>::LockedPtr& db,
+      folly::StringPiece query);
+
+  /** Join together the arguments as a single query string and return its
+   * cached prepared statement. */
+  template <typename Arg1, typename Arg2, typename... Args>
+  SqliteStatement& prepare(
+      folly::Synchronized<sqlite3*>::LockedPtr& db,
+      Arg1&& first,
+      Arg2&& second,
+      Args&&... args) {
+    return prepare(
+        db,
+        folly::to<std::string>(
+            std::forward<Arg1>(first),
+            std::forward<Arg2>(second),
+            std::forward<Args>(args)...));
+  }
+
+  static constexpr size_t kStatementCacheSize = 64;
+
  private:
+  using StatementCache =
+      folly::EvictingCacheMap<std::string, std::unique_ptr<SqliteStatement>>;
+
   folly::Synchronized<sqlite3*> db_{nullptr};
+  /** Statements returned by prepare(), guarded by db_. */
+  std::unique_ptr<StatementCache> statements_;
 };
 
 /** Represents the sqlite vm that will execute a SQL statement.
@@ -93,6 +144,14 @@ class SqliteStatement {
    */
   bool step();
 
+  /** Reset the statement so that it can be executed again, and clear any
+   * parameters bound to it.
+   * This allows a prepared statement to be cached and reused rather than
+   * being compiled again for every query.  A statement must be reset before
+   * it is reused if the previous execution stopped before step() returned
+   * false. */
+  void reset();
+
   /** Bind a stringy parameter to a prepared statement placeholder.
    * Parameters are 1-based, with the first parameter having paramNo==1.
    * Throws an exception on error.
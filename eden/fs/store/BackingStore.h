@@ -9,7 +9,10 @@
 
 #include <folly/futures/Future.h>
 #include <memory>
+#include <optional>
+#include <vector>
 
+#include "eden/fs/store/BlobMetadata.h"
 #include "eden/fs/store/ImportPriority.h"
 
 namespace folly {
@@ -51,10 +54,26 @@ class BackingStore {
       const Hash& commitID,
       const Hash& manifestID) = 0;
   FOLLY_NODISCARD virtual folly::SemiFuture<folly::Unit> prefetchBlobs(
-      const std::vector<Hash>& /*ids*/) {
+      const std::vector<Hash>& /*ids*/,
+      ImportPriority /*priority*/ = ImportPriority::kNormal()) {
     return folly::unit;
   }
 
+  /**
+   * Look up the sizes and SHA-1 hashes of blobs without importing them.
+   *
+   * The result has one entry per id, which is std::nullopt for the blobs
+   * whose metadata the backing store cannot provide more cheaply than the
+   * blob itself.  Callers fall back to getBlob() for those.
+   */
+  FOLLY_NODISCARD virtual folly::SemiFuture<
+      std::vector<std::optional<BlobMetadata>>>
+  getBlobMetadataBatch(
+      const std::vector<Hash>& ids,
+      ImportPriority /*priority*/ = ImportPriority::kNormal()) {
+    return std::vector<std::optional<BlobMetadata>>(ids.size());
+  }
+
   virtual void periodicManagementTask() {}
 
  private:
@@ -7,13 +7,33 @@
 
 #include "BlobCache.h"
 #include <folly/MapUtil.h>
+#include <folly/lang/Bits.h>
 #include <folly/logging/xlog.h>
+#include <cstring>
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/utils/IDGen.h"
 
 namespace facebook {
 namespace eden {
 
+namespace {
+// Only used to size the frequency sketch, which only needs to be roughly
+// proportional to the number of cached blobs.
+constexpr size_t kAssumedAverageBlobSize = 4096;
+
+/**
+ * Pick the shard with the trailing bytes of the hash.  std::hash<Hash> mixes
+ * all of them before picking the bucket within a shard, so this does not
+ * skew the buckets.
+ */
+size_t shardIndex(const Hash& hash, size_t shardCount) {
+  uint64_t value;
+  auto bytes = hash.getBytes();
+  memcpy(&value, bytes.end() - sizeof(value), sizeof(value));
+  return folly::Endian::big(value) % shardCount;
+}
+} // namespace
+
 BlobInterestHandle::BlobInterestHandle(
     std::weak_ptr<BlobCache> blobCache,
     const Hash& hash,
@@ -49,20 +69,49 @@ std::shared_ptr<const Blob> BlobInterestHandle::getBlob() const {
 
 std::shared_ptr<BlobCache> BlobCache::create(
     size_t maximumCacheSizeBytes,
-    size_t minimumEntryCount) {
+    size_t minimumEntryCount,
+    size_t shardCount,
+    AdmissionPolicy admissionPolicy) {
   // Allow make_shared with private constructor.
   struct BC : BlobCache {
-    BC(size_t x, size_t y) : BlobCache{x, y} {}
+    BC(size_t x, size_t y, size_t z, AdmissionPolicy p)
+        : BlobCache{x, y, z, p} {}
   };
-  return std::make_shared<BC>(maximumCacheSizeBytes, minimumEntryCount);
+  return std::make_shared<BC>(
+      maximumCacheSizeBytes,
+      minimumEntryCount,
+      std::max<size_t>(shardCount, 1),
+      admissionPolicy);
 }
 
-BlobCache::BlobCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount)
-    : maximumCacheSizeBytes_{maximumCacheSizeBytes},
-      minimumEntryCount_{minimumEntryCount} {}
+BlobCache::BlobCache(
+    size_t maximumCacheSizeBytes,
+    size_t minimumEntryCount,
+    size_t shardCount,
+    AdmissionPolicy admissionPolicy)
+    : maximumCacheSizeBytes_{maximumCacheSizeBytes / shardCount},
+      minimumEntryCount_{(minimumEntryCount + shardCount - 1) / shardCount},
+      shards_(shardCount) {
+  if (admissionPolicy == AdmissionPolicy::TinyLfu) {
+    auto width = std::max(
+        minimumEntryCount_, maximumCacheSizeBytes_ / kAssumedAverageBlobSize);
+    for (auto& shard : shards_) {
+      shard.wlock()->sketch = std::make_unique<FrequencySketch>(width);
+    }
+  }
+}
 
 BlobCache::~BlobCache() {}
 
+folly::Synchronized<BlobCache::State>& BlobCache::getShard(const Hash& hash) {
+  return shards_[shardIndex(hash, shards_.size())];
+}
+
+const folly::Synchronized<BlobCache::State>& BlobCache::getShard(
+    const Hash& hash) const {
+  return shards_[shardIndex(hash, shards_.size())];
+}
+
 BlobCache::GetResult BlobCache::get(const Hash& hash, Interest interest) {
   XLOG(DBG6) << "BlobCache::get " << hash;
 
@@ -71,7 +120,10 @@ BlobCache::GetResult BlobCache::get(const Hash& hash, Interest interest) {
   // runs after the lock is released.
   BlobInterestHandle interestHandle;
 
-  auto state = state_.wlock();
+  auto state = getShard(hash).wlock();
+  if (state->sketch) {
+    state->sketch->increment(hash);
+  }
 
   auto* item = folly::get_ptr(state->items, hash);
   if (!item) {
@@ -137,7 +189,16 @@ BlobInterestHandle BlobCache::insert(
 
   XLOG(DBG6) << "  creating entry with generation=" << cacheItemGeneration;
 
-  auto state = state_.wlock();
+  auto state = getShard(hash).wlock();
+  if (state->sketch && interest != Interest::LikelyNeededAgain &&
+      !state->items.count(hash) && !shouldAdmit(*state, hash, size)) {
+    XLOG(DBG6) << "  not admitted";
+    ++state->admissionRejectionCount;
+    // The caller still gets the blob, but the handle must not refer to an
+    // entry that does not exist.
+    interestHandle.blobCache_.reset();
+    return interestHandle;
+  }
   auto [iter, inserted] =
       state->items.try_emplace(hash, std::move(blob), cacheItemGeneration);
   // noexcept from here until `try`
@@ -171,35 +232,74 @@ BlobInterestHandle BlobCache::insert(
 }
 
 bool BlobCache::contains(const Hash& hash) const {
-  auto state = state_.rlock();
+  auto state = getShard(hash).rlock();
   return 1 == state->items.count(hash);
 }
 
 void BlobCache::clear() {
   XLOG(DBG6) << "BlobCache::clear";
-  auto state = state_.wlock();
-  state->totalSize = 0;
-  state->items.clear();
-  state->evictionQueue.clear();
+  for (auto& shard : shards_) {
+    auto state = shard.wlock();
+    state->totalSize = 0;
+    state->items.clear();
+    state->evictionQueue.clear();
+  }
 }
 
 BlobCache::Stats BlobCache::getStats() const {
-  auto state = state_.rlock();
   Stats stats;
-  stats.blobCount = state->items.size();
-  stats.totalSizeInBytes = state->totalSize;
-  stats.hitCount = state->hitCount;
-  stats.missCount = state->missCount;
-  stats.evictionCount = state->evictionCount;
-  stats.dropCount = state->dropCount;
+  for (const auto& shard : shards_) {
+    auto state = shard.rlock();
+    stats.blobCount += state->items.size();
+    stats.totalSizeInBytes += state->totalSize;
+    stats.hitCount += state->hitCount;
+    stats.missCount += state->missCount;
+    stats.evictionCount += state->evictionCount;
+    stats.dropCount += state->dropCount;
+    stats.admissionRejectionCount += state->admissionRejectionCount;
+  }
   return stats;
 }
 
+std::vector<BlobCache::BlobPtr> BlobCache::getMostRecentlyUsed(
+    size_t maxBytes) const {
+  std::vector<BlobPtr> blobs;
+  const size_t shardBudget = maxBytes / shards_.size();
+  for (const auto& shard : shards_) {
+    auto state = shard.rlock();
+    size_t shardBytes = 0;
+    // The most recently used entries are at the back of the queue.
+    for (auto it = state->evictionQueue.rbegin();
+         it != state->evictionQueue.rend();
+         ++it) {
+      auto size = (*it)->blob->getSize();
+      if (shardBytes + size > shardBudget) {
+        break;
+      }
+      shardBytes += size;
+      blobs.push_back((*it)->blob);
+    }
+  }
+  return blobs;
+}
+
+bool BlobCache::shouldAdmit(const State& state, const Hash& hash, size_t size)
+    const {
+  if (state.totalSize + size <= maximumCacheSizeBytes_ ||
+      state.evictionQueue.size() < minimumEntryCount_ ||
+      state.evictionQueue.empty()) {
+    // Nothing has to be evicted to make room.
+    return true;
+  }
+  const auto& victim = state.evictionQueue.front()->blob->getHash();
+  return state.sketch->estimate(hash) > state.sketch->estimate(victim);
+}
+
 void BlobCache::dropInterestHandle(
     const Hash& hash,
     uint64_t generation) noexcept {
   XLOG(DBG6) << "dropInterestHandle " << hash << " generation=" << generation;
-  auto state = state_.wlock();
+  auto state = getShard(hash).wlock();
 
   auto* item = folly::get_ptr(state->items, hash);
   if (!item) {
@@ -10,8 +10,11 @@
 #include <folly/Synchronized.h>
 #include <cstddef>
 #include <list>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 #include "eden/fs/model/Hash.h"
+#include "eden/fs/store/FrequencySketch.h"
 
 namespace facebook {
 namespace eden {
@@ -77,6 +80,17 @@ class BlobInterestHandle {
  * frequently-accessed large blobs when they are larger than the maximum cache
  * size.
  *
+ * The cache can be split into shards by blob hash so concurrent lookups of
+ * different blobs do not contend on one lock. Each shard has its own eviction
+ * queue and an equal share of the maximum size and minimum entry count, so
+ * eviction is only approximately LRU across the whole cache.
+ *
+ * With the TinyLfu admission policy, a blob that would require evicting
+ * another is only cached if it has been requested more often recently than
+ * the least recently used blob.  This keeps one pass over many files, e.g.
+ * `grep -r`, from flushing blobs that are read over and over.  Blobs
+ * inserted with LikelyNeededAgain are always admitted.
+ *
  * It is safe to use this object from arbitrary threads.
  */
 class BlobCache : public std::enable_shared_from_this<BlobCache> {
@@ -107,6 +121,19 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
     LikelyNeededAgain,
   };
 
+  enum class AdmissionPolicy {
+    /**
+     * Every inserted blob is cached, evicting in LRU order.
+     */
+    All,
+
+    /**
+     * Compare the recent request frequency of a new blob with that of the
+     * blob it would evict, see FrequencySketch.
+     */
+    TinyLfu,
+  };
+
   struct GetResult {
     BlobPtr blob;
     BlobInterestHandle interestHandle;
@@ -122,11 +149,14 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
     uint64_t missCount{0};
     uint64_t evictionCount{0};
     uint64_t dropCount{0};
+    uint64_t admissionRejectionCount{0};
   };
 
   static std::shared_ptr<BlobCache> create(
       size_t maximumCacheSizeBytes,
-      size_t minimumEntryCount);
+      size_t minimumEntryCount,
+      size_t shardCount = 1,
+      AdmissionPolicy admissionPolicy = AdmissionPolicy::All);
   ~BlobCache();
 
   /**
@@ -151,7 +181,8 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
    * evicted.
    *
    * Optionally returns an interest handle that, when dropped, evicts the
-   * inserted blob.
+   * inserted blob.  If the admission policy rejected the blob, the handle does
+   * not refer to the cache.
    */
   BlobInterestHandle insert(
       BlobPtr blob,
@@ -169,10 +200,21 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
 
   /**
    * Return information about the current size of the cache and the total number
-   * of hits and misses.
+   * of hits and misses, summed over all shards.
    */
   Stats getStats() const;
 
+  /**
+   * Returns the most recently used blobs, most recent first within each
+   * shard, until their total size reaches maxBytes.  Each shard contributes
+   * at most an equal share of the budget.
+   */
+  std::vector<BlobPtr> getMostRecentlyUsed(size_t maxBytes) const;
+
+  size_t getShardCount() const {
+    return shards_.size();
+  }
+
  private:
   /*
    * TODO: This data structure could be implemented more efficiently. But since
@@ -215,18 +257,37 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
     uint64_t missCount{0};
     uint64_t evictionCount{0};
     uint64_t dropCount{0};
+    uint64_t admissionRejectionCount{0};
+
+    /// Only set with AdmissionPolicy::TinyLfu.
+    std::unique_ptr<FrequencySketch> sketch;
   };
 
   void dropInterestHandle(const Hash& hash, uint64_t generation) noexcept;
 
-  explicit BlobCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount);
+  BlobCache(
+      size_t maximumCacheSizeBytes,
+      size_t minimumEntryCount,
+      size_t shardCount,
+      AdmissionPolicy admissionPolicy);
+
+  /**
+   * Returns whether a new blob of the given size should be cached, according
+   * to the TinyLfu policy.
+   */
+  bool shouldAdmit(const State& state, const Hash& hash, size_t size) const;
+
+  folly::Synchronized<State>& getShard(const Hash& hash);
+  const folly::Synchronized<State>& getShard(const Hash& hash) const;
+
   void evictUntilFits(State& state) noexcept;
   void evictOne(State& state) noexcept;
   void evictItem(State&, CacheItem* item) noexcept;
 
+  // The limits of each shard.
   const size_t maximumCacheSizeBytes_;
   const size_t minimumEntryCount_;
-  folly::Synchronized<State> state_;
+  std::vector<folly::Synchronized<State>> shards_;
 
   friend class BlobInterestHandle;
 };
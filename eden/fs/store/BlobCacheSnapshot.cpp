@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/BlobCacheSnapshot.h"
+
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/ScopeGuard.h>
+#include <folly/io/IOBuf.h>
+#include <folly/portability/SysMman.h>
+#include <folly/portability/SysStat.h>
+#include <cstring>
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/store/BlobCache.h"
+
+namespace facebook {
+namespace eden {
+
+namespace {
+constexpr uint64_t kMagic = 0x45444e4243414348; // "EDNBCACH"
+
+struct Header {
+  uint64_t magic;
+  uint64_t blobCount;
+};
+
+struct EntryHeader {
+  uint8_t hash[Hash::RAW_SIZE];
+  uint8_t padding[4];
+  uint64_t size;
+};
+static_assert(sizeof(EntryHeader) == 32, "EntryHeader must not change size");
+
+void writeAll(const folly::File& file, const void* data, size_t size) {
+  folly::checkUnixError(
+      folly::writeFull(file.fd(), data, size),
+      "failed to write BlobCache snapshot");
+}
+} // namespace
+
+folly::File writeBlobCacheSnapshot(
+    const std::vector<std::shared_ptr<const Blob>>& blobs) {
+#ifdef __linux__
+  auto fd = memfd_create("edenfs-blob-cache", MFD_CLOEXEC);
+  folly::checkUnixError(fd, "failed to create BlobCache snapshot file");
+  folly::File file{fd, /*ownsFd=*/true};
+
+  Header header{kMagic, blobs.size()};
+  writeAll(file, &header, sizeof(header));
+  for (const auto& blob : blobs) {
+    EntryHeader entry{};
+    auto hash = blob->getHash().getBytes();
+    memcpy(entry.hash, hash.data(), hash.size());
+    entry.size = blob->getSize();
+    writeAll(file, &entry, sizeof(entry));
+    for (auto range : blob->getContents()) {
+      writeAll(file, range.data(), range.size());
+    }
+  }
+  return file;
+#else
+  (void)blobs;
+  return folly::File{};
+#endif
+}
+
+size_t loadBlobCacheSnapshot(const folly::File& file, BlobCache& cache) {
+  struct stat st;
+  folly::checkUnixError(
+      fstat(file.fd(), &st), "fstat failed on BlobCache snapshot");
+  auto mapSize = static_cast<size_t>(st.st_size);
+  if (mapSize < sizeof(Header)) {
+    throw std::runtime_error("BlobCache snapshot is truncated");
+  }
+
+  auto map = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, file.fd(), 0);
+  if (map == MAP_FAILED) {
+    folly::throwSystemError("failed to map BlobCache snapshot");
+  }
+  SCOPE_EXIT {
+    munmap(map, mapSize);
+  };
+
+  auto data = static_cast<const uint8_t*>(map);
+  Header header;
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != kMagic) {
+    throw std::runtime_error("BlobCache snapshot has an invalid header");
+  }
+
+  size_t offset = sizeof(header);
+  size_t inserted = 0;
+  for (uint64_t n = 0; n < header.blobCount; ++n) {
+    if (mapSize - offset < sizeof(EntryHeader)) {
+      throw std::runtime_error("BlobCache snapshot is truncated");
+    }
+    EntryHeader entry;
+    memcpy(&entry, data + offset, sizeof(entry));
+    offset += sizeof(entry);
+    if (mapSize - offset < entry.size) {
+      throw std::runtime_error("BlobCache snapshot is truncated");
+    }
+
+    // Copy the contents, since the mapping goes away when we return.
+    auto contents = folly::IOBuf::copyBuffer(data + offset, entry.size);
+    offset += entry.size;
+    Hash hash{folly::ByteRange{entry.hash, sizeof(entry.hash)}};
+    cache.insert(std::make_shared<const Blob>(hash, std::move(*contents)));
+    ++inserted;
+  }
+  return inserted;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <memory>
+#include <vector>
+
+namespace facebook {
+namespace eden {
+
+class Blob;
+class BlobCache;
+
+/**
+ * A BlobCacheSnapshot is an anonymous memory file holding a list of blobs,
+ * used to hand the hottest part of the BlobCache over to a new edenfs process
+ * during a graceful restart, so it does not have to read them again from the
+ * local or backing store.
+ *
+ * The file is a header followed by, for each blob, its hash, its size and
+ * its contents.  It is only ever read on the machine it was written on.
+ */
+
+/**
+ * Writes the blobs into a new memory file.  Returns a closed File if memory
+ * files are not supported on this platform.
+ */
+folly::File writeBlobCacheSnapshot(
+    const std::vector<std::shared_ptr<const Blob>>& blobs);
+
+/**
+ * Maps a file written by writeBlobCacheSnapshot() and inserts its blobs into
+ * the cache.  Returns the number of blobs inserted.  Throws
+ * std::runtime_error if the file is truncated or corrupt; the blobs before
+ * the corruption are still inserted.
+ */
+size_t loadBlobCacheSnapshot(const folly::File& file, BlobCache& cache);
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/BlobMetadataCache.h"
+
+#include <folly/lang/Bits.h>
+#include <algorithm>
+#include <cstring>
+
+namespace facebook {
+namespace eden {
+
+namespace {
+/**
+ * Pick the shard with the trailing bytes of the ID, as BlobCache does, so
+ * that the leading bytes still spread the entries within a shard.
+ */
+size_t shardIndex(const Hash& id, size_t shardCount) {
+  uint64_t value;
+  auto bytes = id.getBytes();
+  memcpy(&value, bytes.end() - sizeof(value), sizeof(value));
+  return folly::Endian::big(value) % shardCount;
+}
+} // namespace
+
+std::shared_ptr<BlobMetadataCache> BlobMetadataCache::create(
+    size_t maximumEntryCount,
+    size_t shardCount) {
+  return std::shared_ptr<BlobMetadataCache>{
+      new BlobMetadataCache{maximumEntryCount, shardCount}};
+}
+
+BlobMetadataCache::BlobMetadataCache(
+    size_t maximumEntryCount,
+    size_t shardCount) {
+  shardCount = std::max<size_t>(shardCount, 1);
+  auto shardSize = std::max<size_t>(maximumEntryCount / shardCount, 1);
+  shards_.reserve(shardCount);
+  for (size_t i = 0; i < shardCount; ++i) {
+    shards_.push_back(std::make_unique<Shard>(folly::in_place, shardSize));
+  }
+}
+
+BlobMetadataCache::Shard& BlobMetadataCache::getShard(const Hash& id) {
+  return *shards_[shardIndex(id, shards_.size())];
+}
+
+std::optional<BlobMetadata> BlobMetadataCache::get(const Hash& id) {
+  auto shard = getShard(id).lock();
+  auto it = shard->find(id);
+  if (it == shard->end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+void BlobMetadataCache::set(const Hash& id, const BlobMetadata& metadata) {
+  getShard(id).lock()->set(id, metadata);
+}
+
+size_t BlobMetadataCache::size() const {
+  size_t total = 0;
+  for (const auto& shard : shards_) {
+    total += shard->lock()->size();
+  }
+  return total;
+}
+
+void BlobMetadataCache::clear() {
+  for (auto& shard : shards_) {
+    shard->lock()->clear();
+  }
+}
+
+} // namespace eden
+} // namespace facebook
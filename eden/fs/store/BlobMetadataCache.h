@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/store/BlobMetadata.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * An in-memory LRU cache of the sizes and SHA-1s of blobs, by blob ID.
+ *
+ * Blob IDs name the same contents in every mount, like the keys of the
+ * BlobCache, so EdenServer shares one of these between the ObjectStores of
+ * all of its mounts and several checkouts of one repository only cache each
+ * blob's metadata once.
+ *
+ * Every lookup updates the LRU order, so each shard takes an exclusive lock
+ * even to read.  The cache is split into shards by blob ID so that the
+ * lookups of every mount do not serialize on one lock.  Each shard evicts
+ * on its own, keeping an equal share of the entries.
+ */
+class BlobMetadataCache {
+ public:
+  static std::shared_ptr<BlobMetadataCache> create(
+      size_t maximumEntryCount,
+      size_t shardCount = 1);
+
+  std::optional<BlobMetadata> get(const Hash& id);
+
+  void set(const Hash& id, const BlobMetadata& metadata);
+
+  /** The number of entries cached, summed over all shards. */
+  size_t size() const;
+
+  void clear();
+
+  size_t getShardCount() const {
+    return shards_.size();
+  }
+
+ private:
+  using Shard = folly::Synchronized<
+      folly::EvictingCacheMap<Hash, BlobMetadata>,
+      std::mutex>;
+
+  BlobMetadataCache(size_t maximumEntryCount, size_t shardCount);
+
+  Shard& getShard(const Hash& id);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace eden
+} // namespace facebook
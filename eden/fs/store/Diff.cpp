@@ -11,7 +11,13 @@
 #include <folly/Synchronized.h>
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
+#include <atomic>
+#include <map>
 #include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "eden/fs/model/Tree.h"
@@ -175,6 +181,47 @@ FOLLY_NODISCARD Future<Unit> computeTreeDiff(
       .ensure([ignore = std::move(ignore)] {});
 }
 
+/**
+ * Load the ignore rules of the directory at currentPath from its
+ * gitIgnoreEntry.  Regular files are fetched by hash so that their parsed
+ * rules can be shared through the GitIgnoreCache; symlinks have to be
+ * resolved in the working copy.
+ */
+FOLLY_NODISCARD Future<std::unique_ptr<GitIgnoreStack>> loadGitIgnoreStack(
+    const TreeEntry& gitIgnoreEntry,
+    DiffContext* context,
+    RelativePathPiece currentPath,
+    const GitIgnoreStack* parentIgnore) {
+  auto entryPath = currentPath + gitIgnoreEntry.getName();
+  auto onError = [entryPath, parentIgnore](const folly::exception_wrapper& ex) {
+    // TODO: add an API to DiffCallback to report user errors like this
+    // (errors that do not indicate a problem with EdenFS itself) that can
+    // be returned to the caller in a thrift response
+    XLOG(WARN) << "error loading gitignore at " << entryPath << ": "
+               << folly::exceptionStr(ex);
+    return make_unique<GitIgnoreStack>(parentIgnore);
+  };
+
+  if (gitIgnoreEntry.getType() != TreeEntryType::SYMLINK) {
+    const auto& blobHash = gitIgnoreEntry.getHash();
+    if (auto cached = context->getCachedGitIgnore(blobHash)) {
+      return make_unique<GitIgnoreStack>(parentIgnore, std::move(cached));
+    }
+    return context->loadGitIgnore(blobHash)
+        .thenValue([parentIgnore](std::shared_ptr<const GitIgnore> ignore) {
+          return make_unique<GitIgnoreStack>(parentIgnore, std::move(ignore));
+        })
+        .thenError(std::move(onError));
+  }
+
+  auto loadFileContentsFromPath = context->getLoadFileContentsFromPath();
+  return loadFileContentsFromPath(context->getFetchContext(), entryPath)
+      .thenValue([parentIgnore](std::string&& ignoreFileContents) {
+        return make_unique<GitIgnoreStack>(parentIgnore, ignoreFileContents);
+      })
+      .thenError(std::move(onError));
+}
+
 FOLLY_NODISCARD Future<Unit> loadGitIgnoreThenDiffTrees(
     const TreeEntry& gitIgnoreEntry,
     DiffContext* context,
@@ -183,32 +230,18 @@ FOLLY_NODISCARD Future<Unit> loadGitIgnoreThenDiffTrees(
     const Tree& wdTree,
     const GitIgnoreStack* parentIgnore,
     bool isIgnored) {
-  // TODO: load file contents directly from context->store if gitIgnoreEntry is
-  // a regular file
-  auto loadFileContentsFromPath = context->getLoadFileContentsFromPath();
-  return loadFileContentsFromPath(
-             context->getFetchContext(), currentPath + gitIgnoreEntry.getName())
-      .thenError([entryPath = currentPath + gitIgnoreEntry.getName()](
-                     const folly::exception_wrapper& ex) {
-        // TODO: add an API to DiffCallback to report user errors like this
-        // (errors that do not indicate a problem with EdenFS itself) that can
-        // be returned to the caller in a thrift response
-        XLOG(WARN) << "error loading gitignore at " << entryPath << ": "
-                   << folly::exceptionStr(ex);
-        return std::string{};
-      })
+  return loadGitIgnoreStack(gitIgnoreEntry, context, currentPath, parentIgnore)
       .thenValue([context,
                   currentPath = currentPath.copy(),
                   scmTree,
                   wdTree,
-                  parentIgnore,
-                  isIgnored](std::string&& ignoreFileContents) mutable {
+                  isIgnored](std::unique_ptr<GitIgnoreStack>&& ignore) mutable {
         return computeTreeDiff(
             context,
             currentPath,
             scmTree,
             wdTree,
-            make_unique<GitIgnoreStack>(parentIgnore, ignoreFileContents),
+            std::move(ignore),
             isIgnored);
       });
 }
@@ -296,26 +329,13 @@ FOLLY_NODISCARD Future<Unit> loadGitIgnoreThenProcessAddedChildren(
     const Tree& wdTree,
     const GitIgnoreStack* parentIgnore,
     bool isIgnored) {
-  auto loadFileContentsFromPath = context->getLoadFileContentsFromPath();
-  return loadFileContentsFromPath(
-             context->getFetchContext(), currentPath + gitIgnoreEntry.getName())
-      .thenError([entryPath = currentPath + gitIgnoreEntry.getName()](
-                     const folly::exception_wrapper& ex) {
-        XLOG(WARN) << "error loading gitignore at " << entryPath << ": "
-                   << folly::exceptionStr(ex);
-        return std::string{};
-      })
+  return loadGitIgnoreStack(gitIgnoreEntry, context, currentPath, parentIgnore)
       .thenValue([context,
                   currentPath = currentPath.copy(),
                   wdTree,
-                  parentIgnore,
-                  isIgnored](std::string&& ignoreFileContents) mutable {
+                  isIgnored](std::unique_ptr<GitIgnoreStack>&& ignore) mutable {
         return processAddedChildren(
-            context,
-            currentPath,
-            wdTree,
-            make_unique<GitIgnoreStack>(parentIgnore, ignoreFileContents),
-            isIgnored);
+            context, currentPath, wdTree, std::move(ignore), isIgnored);
       });
 }
 
@@ -597,6 +617,215 @@ FOLLY_NODISCARD Future<Unit> waitOnResults(
       });
 }
 
+/**
+ * Diffs two commits one directory level at a time on behalf of diffCommits().
+ *
+ * Entries whose hashes match are skipped without fetching anything.  The
+ * trees of every directory that differs at one depth are requested together,
+ * and each distinct tree only once, so the backing store sees a whole level
+ * as one batch of imports instead of a trickle of requests as each parent
+ * arrives.  The blob comparisons of a level run while the next level is
+ * fetched.
+ *
+ * Commit diffs never load .gitignore files, so unlike computeTreeDiff() this
+ * has no ignore handling.
+ */
+class LevelDiffer : public std::enable_shared_from_this<LevelDiffer> {
+ public:
+  explicit LevelDiffer(DiffContext* context) : context_{context} {}
+
+  FOLLY_NODISCARD Future<Unit> diff(const Tree& scmTree, const Tree& wdTree) {
+    compareTrees(RelativePathPiece{}, &scmTree, &wdTree);
+    return diffNextLevel();
+  }
+
+ private:
+  /**
+   * A directory to compare at the next level.  A missing hash means that the
+   * directory only exists on the other side.
+   */
+  struct PendingDir {
+    RelativePath path;
+    std::optional<Hash> scmHash;
+    std::optional<Hash> wdHash;
+  };
+
+  using TreeResults = vector<Try<std::shared_ptr<const Tree>>>;
+
+  /**
+   * Compare the entries of two trees, either of which may be null if the
+   * directory only exists on one side.  Files are reported or queued for
+   * comparison, and directories that differ are queued for the next level.
+   */
+  void compareTrees(
+      RelativePathPiece currentPath,
+      const Tree* scmTree,
+      const Tree* wdTree) {
+    static const vector<TreeEntry> kNoEntries;
+    const auto& scmEntries = scmTree ? scmTree->getTreeEntries() : kNoEntries;
+    const auto& wdEntries = wdTree ? wdTree->getTreeEntries() : kNoEntries;
+
+    // This relies on the fact that the entry list in each tree is always
+    // sorted.
+    size_t scmIdx = 0;
+    size_t wdIdx = 0;
+    while (scmIdx < scmEntries.size() || wdIdx < wdEntries.size()) {
+      if (wdIdx >= wdEntries.size() ||
+          (scmIdx < scmEntries.size() &&
+           scmEntries[scmIdx].getName() < wdEntries[wdIdx].getName())) {
+        removed(currentPath, scmEntries[scmIdx++]);
+      } else if (
+          scmIdx >= scmEntries.size() ||
+          scmEntries[scmIdx].getName() > wdEntries[wdIdx].getName()) {
+        added(currentPath, wdEntries[wdIdx++]);
+      } else {
+        bothPresent(currentPath, scmEntries[scmIdx++], wdEntries[wdIdx++]);
+      }
+    }
+  }
+
+  void removed(RelativePathPiece currentPath, const TreeEntry& scmEntry) {
+    auto entryPath = currentPath + scmEntry.getName();
+    if (scmEntry.isTree()) {
+      nextLevel_.push_back({std::move(entryPath), scmEntry.getHash(), {}});
+    } else {
+      context_->callback->removedFile(entryPath);
+    }
+  }
+
+  void added(RelativePathPiece currentPath, const TreeEntry& wdEntry) {
+    auto entryPath = currentPath + wdEntry.getName();
+    if (wdEntry.isTree()) {
+      nextLevel_.push_back({std::move(entryPath), {}, wdEntry.getHash()});
+    } else {
+      context_->callback->addedFile(entryPath);
+    }
+  }
+
+  void bothPresent(
+      RelativePathPiece currentPath,
+      const TreeEntry& scmEntry,
+      const TreeEntry& wdEntry) {
+    if (scmEntry.getType() == wdEntry.getType() &&
+        scmEntry.getHash() == wdEntry.getHash()) {
+      return;
+    }
+
+    auto entryPath = currentPath + scmEntry.getName();
+    if (scmEntry.isTree() && wdEntry.isTree()) {
+      nextLevel_.push_back(
+          {std::move(entryPath), scmEntry.getHash(), wdEntry.getHash()});
+    } else if (scmEntry.isTree()) {
+      context_->callback->addedFile(entryPath);
+      nextLevel_.push_back({std::move(entryPath), scmEntry.getHash(), {}});
+    } else if (wdEntry.isTree()) {
+      context_->callback->removedFile(entryPath);
+      nextLevel_.push_back({std::move(entryPath), {}, wdEntry.getHash()});
+    } else if (scmEntry.getType() != wdEntry.getType()) {
+      context_->callback->modifiedFile(entryPath);
+    } else {
+      // Blobs with different hashes may still have the same contents, for
+      // example when a change was later reverted.
+      compareBlobs(std::move(entryPath), scmEntry.getHash(), wdEntry.getHash());
+    }
+  }
+
+  void compareBlobs(RelativePath entryPath, Hash scmHash, Hash wdHash) {
+    auto& fetchContext = context_->getFetchContext();
+    comparisons_.push_back(
+        collectSafe(
+            context_->store->getBlobSha1(scmHash, fetchContext),
+            context_->store->getBlobSha1(wdHash, fetchContext))
+            .thenTry([context = context_, entryPath = std::move(entryPath)](
+                         Try<std::tuple<Hash, Hash>>&& result) {
+              if (result.hasException()) {
+                XLOG(ERR) << "error computing SCM diff for " << entryPath;
+                context->callback->diffError(entryPath, result.exception());
+              } else if (
+                  std::get<0>(result.value()) != std::get<1>(result.value())) {
+                context->callback->modifiedFile(entryPath);
+              }
+            }));
+  }
+
+  /**
+   * Fetch the trees of every directory queued by the previous level, then
+   * compare them.  Completes once the last level and every blob comparison
+   * have finished.
+   */
+  FOLLY_NODISCARD Future<Unit> diffNextLevel() {
+    if (!nextLevel_.empty() && context_->isCancelled()) {
+      XLOG(DBG7) << "diff() of " << nextLevel_.size()
+                 << " directories cancelled due to client request no longer "
+                    "being active";
+      nextLevel_.clear();
+    }
+    if (nextLevel_.empty()) {
+      return folly::collectAll(std::exchange(comparisons_, {})).unit();
+    }
+
+    auto dirs = std::exchange(nextLevel_, {});
+    std::unordered_map<Hash, size_t> treeIndices;
+    vector<Future<std::shared_ptr<const Tree>>> treeFutures;
+    auto fetch = [&](const std::optional<Hash>& hash) {
+      if (hash && treeIndices.emplace(*hash, treeFutures.size()).second) {
+        treeFutures.push_back(
+            context_->store->getTree(*hash, context_->getFetchContext()));
+      }
+    };
+    for (const auto& dir : dirs) {
+      fetch(dir.scmHash);
+      fetch(dir.wdHash);
+    }
+    XLOG(DBG5) << "diffing " << dirs.size() << " directories with "
+               << treeFutures.size() << " tree fetches";
+
+    return folly::collectAll(std::move(treeFutures))
+        .toUnsafeFuture()
+        .thenValue([self = shared_from_this(),
+                    dirs = std::move(dirs),
+                    indices = std::move(treeIndices)](TreeResults&& trees) {
+          for (const auto& dir : dirs) {
+            const Tree* scmTree = nullptr;
+            const Tree* wdTree = nullptr;
+            if (!self->lookupTree(dir, dir.scmHash, indices, trees, scmTree) ||
+                !self->lookupTree(dir, dir.wdHash, indices, trees, wdTree)) {
+              continue;
+            }
+            self->compareTrees(dir.path, scmTree, wdTree);
+          }
+          return self->diffNextLevel();
+        });
+  }
+
+  /**
+   * Look up one side of a pending directory in the fetched trees.  Returns
+   * false and reports the error if its tree could not be loaded.
+   */
+  bool lookupTree(
+      const PendingDir& dir,
+      const std::optional<Hash>& hash,
+      const std::unordered_map<Hash, size_t>& indices,
+      const TreeResults& trees,
+      const Tree*& tree) {
+    if (!hash) {
+      return true;
+    }
+    const auto& result = trees[indices.at(*hash)];
+    if (result.hasException()) {
+      XLOG(ERR) << "error computing SCM diff for " << dir.path;
+      context_->callback->diffError(dir.path, result.exception());
+      return false;
+    }
+    tree = result.value().get();
+    return true;
+  }
+
+  DiffContext* const context_;
+  vector<PendingDir> nextLevel_;
+  vector<Future<Unit>> comparisons_;
+};
+
 /**
  * Diff two commits.
  *
@@ -604,15 +833,16 @@ FOLLY_NODISCARD Future<Unit> waitOnResults(
  * will be extracted and returned to the caller.
  */
 FOLLY_NODISCARD Future<Unit>
-diffCommits(DiffContext* context, Hash hash1, Hash hash2) {
+diffCommits(DiffContext* context, Hash hash1, Hash hash2, bool batchByLevel) {
   auto future1 =
       context->store->getTreeForCommit(hash1, context->getFetchContext());
   auto future2 =
       context->store->getTreeForCommit(hash2, context->getFetchContext());
   return collectSafe(future1, future2)
-      .thenValue([context](std::tuple<
-                           std::shared_ptr<const Tree>,
-                           std::shared_ptr<const Tree>>&& tup) {
+      .thenValue([context, batchByLevel](
+                     std::tuple<
+                         std::shared_ptr<const Tree>,
+                         std::shared_ptr<const Tree>>&& tup) {
         const auto& [tree1, tree2] = tup;
 
         // This happens in the case in which the CLI (during eden doctor) calls
@@ -622,19 +852,212 @@ diffCommits(DiffContext* context, Hash hash1, Hash hash2) {
           return makeFuture();
         }
 
+        if (batchByLevel) {
+          auto differ = std::make_shared<LevelDiffer>(context);
+          return differ->diff(*tree1, *tree2);
+        }
         return diffTrees(
             context, RelativePathPiece{}, *tree1, *tree2, nullptr, false);
       });
 }
+
+/**
+ * Walks the differences between two source control trees on behalf of
+ * prefetchTreeDifferences(), collecting the hashes of blobs to prefetch.
+ *
+ * Subtrees are walked concurrently, so blob hashes are accumulated under a
+ * lock and sent to the ObjectStore whenever a full batch is available.
+ */
+class PrefetchPlanner : public std::enable_shared_from_this<PrefetchPlanner> {
+ public:
+  PrefetchPlanner(
+      const ObjectStore* store,
+      ObjectFetchContext& fetchContext,
+      size_t batchSize,
+      ImportPriority priority)
+      : store_{store},
+        fetchContext_{fetchContext},
+        batchSize_{std::max<size_t>(batchSize, 1)},
+        priority_{priority} {}
+
+  /**
+   * Walks the differences between fromTree and toTree along the paths added
+   * with addPath(), fetching the trees of those directories and prefetching
+   * the changed blobs of those files.
+   */
+  FOLLY_NODISCARD Future<Unit> walkTrees(
+      const Tree& fromTree,
+      const Tree& toTree) {
+    return walkTrees(fromTree, toTree, paths_);
+  }
+
+  /**
+   * Adds a file, or a directory whose tree should be fetched, for
+   * walkPaths() to look up.
+   */
+  void addPath(RelativePathPiece path) {
+    auto* node = &paths_;
+    for (auto component : path.components()) {
+      auto& child = node->children[component.stringPiece().str()];
+      if (!child) {
+        child = std::make_unique<PathNode>();
+      }
+      node = child.get();
+    }
+    node->isWanted = true;
+  }
+
+  /**
+   * Looks up the files added with addPath() in tree, fetching only the
+   * subtrees that contain them.
+   */
+  FOLLY_NODISCARD Future<Unit> walkPaths(const Tree& tree) {
+    return walkPaths(tree, paths_);
+  }
+
+  /**
+   * Send any blobs that did not fill a complete batch.
+   */
+  void flush() {
+    vector<Hash> remaining;
+    remaining.swap(*batch_.wlock());
+    if (!remaining.empty()) {
+      sendBatch(std::move(remaining));
+    }
+  }
+
+  uint64_t getNumBlobs() const {
+    return numBlobs_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct PathNode {
+    std::map<std::string, std::unique_ptr<PathNode>> children;
+    bool isWanted{false};
+  };
+
+  FOLLY_NODISCARD Future<Unit> walkPaths(
+      const Tree& tree,
+      const PathNode& node) {
+    vector<Future<Unit>> childFutures;
+    for (const auto& [name, child] : node.children) {
+      // Files that were removed or replaced since the profile was recorded
+      // are skipped.
+      auto entry = tree.getEntryPtr(PathComponentPiece{name});
+      if (!entry) {
+        continue;
+      }
+      if (!entry->isTree()) {
+        if (child->isWanted) {
+          addBlob(entry->getHash());
+        }
+      } else if (child->isWanted || !child->children.empty()) {
+        childFutures.push_back(walkPaths(entry->getHash(), *child));
+      }
+    }
+    return folly::collectAll(childFutures).unit();
+  }
+
+  FOLLY_NODISCARD Future<Unit> walkPaths(Hash hash, const PathNode& node) {
+    return store_->getTree(hash, fetchContext_)
+        .thenValue([self = shared_from_this(),
+                    &node](std::shared_ptr<const Tree>&& tree) {
+          return self->walkPaths(*tree, node);
+        })
+        .thenError([hash](const folly::exception_wrapper& ew) {
+          XLOG(DBG2) << "unable to plan prefetch for tree " << hash << ": "
+                     << folly::exceptionStr(ew);
+        });
+  }
+
+  FOLLY_NODISCARD Future<Unit>
+  walkTrees(const Tree& fromTree, const Tree& toTree, const PathNode& node) {
+    vector<Future<Unit>> childFutures;
+    for (const auto& [name, child] : node.children) {
+      auto toEntry = toTree.getEntryPtr(PathComponentPiece{name});
+      if (!toEntry) {
+        // Removed, so there is nothing to fetch.
+        continue;
+      }
+      auto fromEntry = fromTree.getEntryPtr(PathComponentPiece{name});
+      if (fromEntry && fromEntry->getHash() == toEntry->getHash()) {
+        continue;
+      }
+      if (!toEntry->isTree()) {
+        addBlob(toEntry->getHash());
+      } else if (fromEntry && fromEntry->isTree()) {
+        childFutures.push_back(
+            walkTrees(fromEntry->getHash(), toEntry->getHash(), *child));
+      } else {
+        childFutures.push_back(walkPaths(toEntry->getHash(), *child));
+      }
+    }
+    return folly::collectAll(childFutures).unit();
+  }
+
+  FOLLY_NODISCARD Future<Unit>
+  walkTrees(Hash fromHash, Hash toHash, const PathNode& node) {
+    return collectSafe(
+               store_->getTree(fromHash, fetchContext_),
+               store_->getTree(toHash, fetchContext_))
+        .thenValue([self = shared_from_this(), &node](
+                       std::tuple<
+                           std::shared_ptr<const Tree>,
+                           std::shared_ptr<const Tree>>&& tup) {
+          const auto& [fromTree, toTree] = tup;
+          return self->walkTrees(*fromTree, *toTree, node);
+        })
+        .thenError([toHash](const folly::exception_wrapper& ew) {
+          XLOG(DBG2) << "unable to plan prefetch for tree " << toHash << ": "
+                     << folly::exceptionStr(ew);
+        });
+  }
+
+  void addBlob(const Hash& hash) {
+    numBlobs_.fetch_add(1, std::memory_order_relaxed);
+    vector<Hash> fullBatch;
+    {
+      auto batch = batch_.wlock();
+      batch->push_back(hash);
+      if (batch->size() < batchSize_) {
+        return;
+      }
+      fullBatch.swap(*batch);
+    }
+    sendBatch(std::move(fullBatch));
+  }
+
+  void sendBatch(vector<Hash> hashes) {
+    XLOG(DBG4) << "prefetching " << hashes.size() << " blobs";
+    store_
+        ->prefetchBlobs(
+            hashes, ObjectFetchContext::getNullContext(), priority_)
+        .thenError([count = hashes.size()](const folly::exception_wrapper& ew) {
+          XLOG(WARN) << "error prefetching " << count
+                     << " blobs: " << folly::exceptionStr(ew);
+        });
+  }
+
+  const ObjectStore* const store_;
+  ObjectFetchContext& fetchContext_;
+  const size_t batchSize_;
+  const ImportPriority priority_;
+  folly::Synchronized<vector<Hash>> batch_;
+  std::atomic<uint64_t> numBlobs_{0};
+  PathNode paths_;
+};
 } // namespace
 
-Future<std::unique_ptr<ScmStatus>>
-diffCommitsForStatus(const ObjectStore* store, Hash hash1, Hash hash2) {
+Future<std::unique_ptr<ScmStatus>> diffCommitsForStatus(
+    const ObjectStore* store,
+    Hash hash1,
+    Hash hash2,
+    bool batchByLevel) {
   return folly::makeFutureWith([&] {
     auto state = std::make_unique<DiffState>(store);
     auto statePtr = state.get();
     auto contextPtr = &(statePtr->context);
-    return diffCommits(contextPtr, hash1, hash2)
+    return diffCommits(contextPtr, hash1, hash2, batchByLevel)
         .thenValue([state = std::move(state)](auto&&) {
           return std::make_unique<ScmStatus>(state->callback.extractStatus());
         });
@@ -714,5 +1137,52 @@ FOLLY_NODISCARD Future<Unit> diffRemovedTree(
       });
 }
 
+Future<uint64_t> prefetchTreeDifferences(
+    const ObjectStore* store,
+    ObjectFetchContext& fetchContext,
+    std::shared_ptr<const Tree> fromTree,
+    std::shared_ptr<const Tree> toTree,
+    const std::vector<RelativePath>& paths,
+    size_t batchSize,
+    ImportPriority priority) {
+  if (!toTree || (fromTree && fromTree->getHash() == toTree->getHash())) {
+    return uint64_t{0};
+  }
+
+  auto planner = std::make_shared<PrefetchPlanner>(
+      store, fetchContext, batchSize, priority);
+  for (const auto& path : paths) {
+    planner->addPath(path);
+  }
+  auto future = fromTree ? planner->walkTrees(*fromTree, *toTree)
+                         : planner->walkPaths(*toTree);
+  return std::move(future).thenValue([planner](auto&&) {
+    planner->flush();
+    return planner->getNumBlobs();
+  });
+}
+
+Future<uint64_t> prefetchPaths(
+    const ObjectStore* store,
+    ObjectFetchContext& fetchContext,
+    std::shared_ptr<const Tree> tree,
+    const std::vector<RelativePath>& paths,
+    size_t batchSize,
+    ImportPriority priority) {
+  if (!tree || paths.empty()) {
+    return uint64_t{0};
+  }
+
+  auto planner = std::make_shared<PrefetchPlanner>(
+      store, fetchContext, batchSize, priority);
+  for (const auto& path : paths) {
+    planner->addPath(path);
+  }
+  return planner->walkPaths(*tree).thenValue([planner](auto&&) {
+    planner->flush();
+    return planner->getNumBlobs();
+  });
+}
+
 } // namespace eden
 } // namespace facebook
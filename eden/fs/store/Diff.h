@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
 #include "eden/fs/service/gen-cpp2/eden_types.h"
+#include "eden/fs/store/ImportPriority.h"
 #include "eden/fs/utils/PathFuncs.h"
 
 namespace folly {
@@ -19,6 +22,7 @@ namespace facebook {
 namespace eden {
 
 class Hash;
+class ObjectFetchContext;
 class ObjectStore;
 class Tree;
 class DiffContext;
@@ -27,13 +31,21 @@ class GitIgnoreStack;
 /**
  * Compute the diff between two commits.
  *
+ * If batchByLevel is true the commits are compared one directory level at a
+ * time: every pair of trees that differs at one depth is requested together,
+ * deduplicated by hash, before any tree at the next depth is.  This lets the
+ * backing store import each level as a single batch.
+ *
  * The caller is responsible for ensuring that the ObjectStore remains valid
  * until the returned Future completes.
  *
  * The differences will be returned to the caller.
  */
-folly::Future<std::unique_ptr<ScmStatus>>
-diffCommitsForStatus(const ObjectStore* store, Hash hash1, Hash hash2);
+folly::Future<std::unique_ptr<ScmStatus>> diffCommitsForStatus(
+    const ObjectStore* store,
+    Hash hash1,
+    Hash hash2,
+    bool batchByLevel = false);
 
 /**
  * Compute the diff between a source control Tree and the current directory
@@ -96,5 +108,51 @@ folly::Future<folly::Unit> diffRemovedTree(
     DiffContext* context,
     RelativePathPiece currentPath,
     Hash scmHash);
+
+/**
+ * Prefetch the objects that a checkout from fromTree to toTree will need.
+ *
+ * Checkout only looks at the directories and files that have inodes, since
+ * it replaces the hashes of the others without fetching anything.  So this
+ * walks the differences between the two source control trees only along the
+ * given paths, skipping subtrees whose hashes match.  The trees of the
+ * directories on those paths that differ in toTree are fetched before the
+ * returned Future completes.  The blobs of those files that differ are
+ * passed to ObjectStore::prefetchBlobs() at the given priority, in batches of
+ * up to batchSize, as they are found.  The returned Future does not wait for
+ * those blob prefetches.
+ *
+ * Errors are logged and otherwise ignored, since checkout will fetch anything
+ * that is missing on demand.
+ *
+ * The caller is responsible for ensuring that the ObjectStore and the fetch
+ * context remain valid until the returned Future completes.
+ *
+ * Returns the number of blobs that were prefetched.
+ */
+folly::Future<uint64_t> prefetchTreeDifferences(
+    const ObjectStore* store,
+    ObjectFetchContext& fetchContext,
+    std::shared_ptr<const Tree> fromTree,
+    std::shared_ptr<const Tree> toTree,
+    const std::vector<RelativePath>& paths,
+    size_t batchSize,
+    ImportPriority priority);
+
+/**
+ * Prefetch the blobs of the files at the given paths in tree.
+ *
+ * Only the trees that lead to those files are fetched, and paths that are not
+ * in tree are ignored.  Paths that name a directory only fetch the tree of
+ * that directory.  Otherwise this behaves like prefetchTreeDifferences().
+ */
+folly::Future<uint64_t> prefetchPaths(
+    const ObjectStore* store,
+    ObjectFetchContext& fetchContext,
+    std::shared_ptr<const Tree> tree,
+    const std::vector<RelativePath>& paths,
+    size_t batchSize,
+    ImportPriority priority);
+
 } // namespace eden
 } // namespace facebook
@@ -7,11 +7,16 @@
 
 #include "eden/fs/store/DiffContext.h"
 
+#include <folly/Executor.h>
+#include <folly/ScopeGuard.h>
+#include <folly/io/Cursor.h>
 #include <thrift/lib/cpp2/async/ResponseChannel.h>
 
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/model/git/GitIgnoreCache.h"
 #include "eden/fs/model/git/GitIgnoreStack.h"
 #include "eden/fs/model/git/TopLevelIgnores.h"
-#include "eden/fs/store/IObjectStore.h"
+#include "eden/fs/store/ObjectStore.h"
 
 using apache::thrift::ResponseChannelRequest;
 
@@ -24,13 +29,19 @@ DiffContext::DiffContext(
     const ObjectStore* os,
     std::unique_ptr<TopLevelIgnores> topLevelIgnores,
     LoadFileFunction loadFileContentsFromPath,
-    ResponseChannelRequest* request)
+    ResponseChannelRequest* request,
+    folly::Executor* subtreeExecutor,
+    size_t maxParallelSubtrees,
+    GitIgnoreCache* gitIgnoreCache)
     : callback{cb},
       store{os},
       listIgnored{listIgnored},
       topLevelIgnores_(std::move(topLevelIgnores)),
       loadFileContentsFromPath_{loadFileContentsFromPath},
-      request_{request} {}
+      request_{request},
+      subtreeExecutor_{subtreeExecutor},
+      maxParallelSubtrees_{maxParallelSubtrees},
+      gitIgnoreCache_{gitIgnoreCache} {}
 
 DiffContext::DiffContext(DiffCallback* cb, const ObjectStore* os)
     : callback{cb},
@@ -38,7 +49,10 @@ DiffContext::DiffContext(DiffCallback* cb, const ObjectStore* os)
       listIgnored{true},
       topLevelIgnores_{std::unique_ptr<TopLevelIgnores>()},
       loadFileContentsFromPath_{nullptr},
-      request_{nullptr} {};
+      request_{nullptr},
+      subtreeExecutor_{nullptr},
+      maxParallelSubtrees_{0},
+      gitIgnoreCache_{nullptr} {};
 
 DiffContext::~DiffContext() = default;
 
@@ -50,14 +64,74 @@ DiffContext::LoadFileFunction DiffContext::getLoadFileContentsFromPath() const {
   return loadFileContentsFromPath_;
 }
 
+std::shared_ptr<const GitIgnore> DiffContext::getCachedGitIgnore(
+    const Hash& blobHash) {
+  return gitIgnoreCache_ ? gitIgnoreCache_->get(blobHash) : nullptr;
+}
+
+folly::Future<std::shared_ptr<const GitIgnore>> DiffContext::loadGitIgnore(
+    const Hash& blobHash) {
+  return store->getBlob(blobHash, fetchContext_)
+      .thenValue([cache = gitIgnoreCache_, blobHash](
+                     std::shared_ptr<const Blob> blob)
+                     -> std::shared_ptr<const GitIgnore> {
+        const auto& contentsBuf = blob->getContents();
+        folly::io::Cursor cursor(&contentsBuf);
+        auto contents =
+            cursor.readFixedString(contentsBuf.computeChainDataLength());
+        if (cache) {
+          return cache->insert(blobHash, contents);
+        }
+        auto ignore = std::make_shared<GitIgnore>();
+        ignore->loadFile(contents);
+        return ignore;
+      });
+}
+
 bool DiffContext::isCancelled() const {
+  if (cancelled_.load(std::memory_order_relaxed)) {
+    return true;
+  }
   // If request_ is null we do not have an associated thrift
   // request that can be cancelled, so we are always still active
   if (request_ && !request_->isActive()) {
+    cancelled_.store(true, std::memory_order_relaxed);
     return true;
   }
   return false;
 }
 
+folly::Future<folly::Unit> DiffContext::runSubtreeDiff(
+    folly::Function<folly::Future<folly::Unit>()> diffFn) {
+  if (isCancelled()) {
+    return folly::unit;
+  }
+  if (!subtreeExecutor_ ||
+      parallelSubtrees_.fetch_add(1, std::memory_order_acq_rel) >=
+          maxParallelSubtrees_) {
+    if (subtreeExecutor_) {
+      parallelSubtrees_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    return diffFn();
+  }
+
+  // The slot is held until diffFn() returns rather than until the subtree
+  // finishes, so a subtree waiting on fetches leaves room for others, and the
+  // children of an offloaded subtree can be offloaded in turn.
+  return folly::via(
+      subtreeExecutor_,
+      [this, diffFn = std::move(diffFn)]() mutable
+      -> folly::Future<folly::Unit> {
+        SCOPE_EXIT {
+          parallelSubtrees_.fetch_sub(1, std::memory_order_acq_rel);
+        };
+        // The request may have gone away while this was queued.
+        if (isCancelled()) {
+          return folly::unit;
+        }
+        return diffFn();
+      });
+}
+
 } // namespace eden
 } // namespace facebook
@@ -7,13 +7,17 @@
 
 #pragma once
 
+#include <folly/Function.h>
 #include <folly/Range.h>
 #include <folly/futures/Future.h>
+#include <atomic>
+#include <memory>
 
 #include "eden/fs/store/StatsFetchContext.h"
 #include "eden/fs/utils/PathFuncs.h"
 
 namespace folly {
+class Executor;
 template <typename T>
 class Future;
 } // namespace folly
@@ -28,7 +32,10 @@ namespace facebook {
 namespace eden {
 
 class DiffCallback;
+class GitIgnore;
+class GitIgnoreCache;
 class GitIgnoreStack;
+class Hash;
 class ObjectFetchContext;
 class ObjectStore;
 class UserInfo;
@@ -55,7 +62,10 @@ class DiffContext {
       const ObjectStore* os,
       std::unique_ptr<TopLevelIgnores> topLevelIgnores,
       LoadFileFunction loadFileContentsFromPath,
-      apache::thrift::ResponseChannelRequest* FOLLY_NULLABLE request = nullptr);
+      apache::thrift::ResponseChannelRequest* FOLLY_NULLABLE request = nullptr,
+      folly::Executor* FOLLY_NULLABLE subtreeExecutor = nullptr,
+      size_t maxParallelSubtrees = 0,
+      GitIgnoreCache* FOLLY_NULLABLE gitIgnoreCache = nullptr);
   DiffContext(DiffCallback* cb, const ObjectStore* os);
 
   DiffContext(const DiffContext&) = delete;
@@ -75,17 +85,54 @@ class DiffContext {
   bool const listIgnored;
 
   const GitIgnoreStack* getToplevelIgnore() const;
+
+  /**
+   * Whether the client request has gone away.  Once this returns true it
+   * keeps returning true, so subtrees that have not started yet are skipped.
+   */
   bool isCancelled() const;
+
   LoadFileFunction getLoadFileContentsFromPath() const;
+
+  /**
+   * Return the cached rules of the ignore file stored in the blob with the
+   * given hash, or nullptr if they are not cached.  Cheap enough to call while
+   * holding an inode lock.
+   */
+  std::shared_ptr<const GitIgnore> getCachedGitIgnore(const Hash& blobHash);
+
+  /**
+   * Fetch and parse the ignore file stored in the blob with the given hash,
+   * caching the rules for later diffs.
+   */
+  folly::Future<std::shared_ptr<const GitIgnore>> loadGitIgnore(
+      const Hash& blobHash);
+
   StatsFetchContext& getFetchContext() {
     return fetchContext_;
   }
 
+  /**
+   * Run the diff of one subtree.
+   *
+   * While fewer than maxParallelSubtrees subtree diffs are queued on or
+   * running on the subtree executor, diffFn is scheduled there so that
+   * independent subtrees are compared on separate threads.  Otherwise it runs
+   * inline.  diffFn must not block.
+   */
+  FOLLY_NODISCARD folly::Future<folly::Unit> runSubtreeDiff(
+      folly::Function<folly::Future<folly::Unit>()> diffFn);
+
  private:
   std::unique_ptr<TopLevelIgnores> topLevelIgnores_;
   const LoadFileFunction loadFileContentsFromPath_;
   apache::thrift::ResponseChannelRequest* const FOLLY_NULLABLE request_;
   StatsFetchContext fetchContext_;
+  folly::Executor* const FOLLY_NULLABLE subtreeExecutor_;
+  const size_t maxParallelSubtrees_;
+  GitIgnoreCache* const FOLLY_NULLABLE gitIgnoreCache_;
+  std::atomic<size_t> parallelSubtrees_{0};
+  mutable std::atomic<bool> cancelled_{false};
 };
 } // namespace eden
 } // namespace facebook
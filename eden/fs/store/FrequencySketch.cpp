@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/FrequencySketch.h"
+
+#include <folly/lang/Bits.h>
+#include <algorithm>
+#include <cstring>
+
+namespace facebook {
+namespace eden {
+
+static_assert(
+    Hash::RAW_SIZE >= 4 * sizeof(uint32_t),
+    "each sketch row needs its own hash bytes");
+
+FrequencySketch::FrequencySketch(size_t width) {
+  width = folly::nextPowTwo(std::max<size_t>(width, 16));
+  counters_.resize(kDepth * width);
+  mask_ = width - 1;
+  sampleSize_ = 10 * width;
+}
+
+size_t FrequencySketch::counterIndex(const Hash& hash, size_t row) const {
+  uint32_t bits;
+  memcpy(&bits, hash.getBytes().data() + row * sizeof(bits), sizeof(bits));
+  return row * (mask_ + 1) + (bits & mask_);
+}
+
+void FrequencySketch::increment(const Hash& hash) {
+  // Conservative update: only the smallest counters are incremented, which
+  // keeps collisions from inflating the estimates of other hashes.
+  auto current = estimate(hash);
+  if (current < kMaxCount) {
+    for (size_t row = 0; row < kDepth; ++row) {
+      auto& counter = counters_[counterIndex(hash, row)];
+      if (counter == current) {
+        ++counter;
+      }
+    }
+  }
+
+  if (++additions_ >= sampleSize_) {
+    age();
+  }
+}
+
+uint8_t FrequencySketch::estimate(const Hash& hash) const {
+  uint8_t result = kMaxCount;
+  for (size_t row = 0; row < kDepth; ++row) {
+    result = std::min(result, counters_[counterIndex(hash, row)]);
+  }
+  return result;
+}
+
+void FrequencySketch::age() {
+  for (auto& counter : counters_) {
+    counter /= 2;
+  }
+  additions_ /= 2;
+}
+
+} // namespace eden
+} // namespace facebook
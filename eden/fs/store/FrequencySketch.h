@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * An approximate, aging count of how often each object hash was accessed
+ * recently, as used by TinyLFU cache admission.
+ *
+ * This is a count-min sketch of small saturating counters.  Once the number
+ * of recorded accesses reaches ten times the sketch width, every counter is
+ * halved, so the estimates reflect recent rather than all-time popularity.
+ *
+ * Object hashes are already uniformly distributed, so the counter positions
+ * are taken directly from the hash bytes.
+ *
+ * FrequencySketch is not thread-safe.
+ */
+class FrequencySketch {
+ public:
+  /**
+   * width is the number of counters per row, rounded up to a power of two.
+   * It should be on the order of the number of objects the cache holds.
+   */
+  explicit FrequencySketch(size_t width);
+
+  void increment(const Hash& hash);
+
+  /**
+   * Returns an upper bound on the recent access count of the hash, between 0
+   * and kMaxCount.
+   */
+  uint8_t estimate(const Hash& hash) const;
+
+  static constexpr uint8_t kMaxCount = 15;
+
+ private:
+  static constexpr size_t kDepth = 4;
+
+  size_t counterIndex(const Hash& hash, size_t row) const;
+  void age();
+
+  std::vector<uint8_t> counters_;
+  size_t mask_;
+  size_t sampleSize_;
+  size_t additions_{0};
+};
+
+} // namespace eden
+} // namespace facebook
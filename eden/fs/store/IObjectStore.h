@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -60,6 +62,13 @@ class ObjectFetchContext {
   virtual ~ObjectFetchContext() = default;
   virtual void didFetch(ObjectType, const Hash&, Origin) {}
 
+  /**
+   * Called after an object was imported from the backing store, with the
+   * size of the imported object (0 for trees) and how long this fetch waited
+   * for the import.  Called in addition to didFetch.
+   */
+  virtual void didImport(ObjectType, uint64_t, std::chrono::nanoseconds) {}
+
   /**
    * Return a no-op fetch context suitable when no tracking is desired.
    */
@@ -97,7 +106,8 @@ class IObjectStore {
       ObjectFetchContext& context) const = 0;
   virtual folly::Future<folly::Unit> prefetchBlobs(
       const std::vector<Hash>& ids,
-      ObjectFetchContext& context) const = 0;
+      ObjectFetchContext& context,
+      ImportPriority priority = ImportPriority::kNormal()) const = 0;
 };
 } // namespace eden
 } // namespace facebook
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/KeyAccessTracker.h"
+
+#include <folly/hash/Hash.h>
+#include <folly/lang/Bits.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace facebook {
+namespace eden {
+
+KeyAccessTracker::KeyAccessTracker(size_t bucketCount) {
+  bucketCount = folly::nextPowTwo(std::max<size_t>(bucketCount, 16));
+  buckets_ = std::make_unique<std::atomic<uint32_t>[]>(bucketCount);
+  for (size_t i = 0; i < bucketCount; ++i) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+  mask_ = bucketCount - 1;
+}
+
+size_t KeyAccessTracker::bucketIndex(folly::ByteRange key) const {
+  return folly::hash::fnv64_buf(key.data(), key.size()) & mask_;
+}
+
+void KeyAccessTracker::recordAccess(folly::ByteRange key) {
+  auto& bucket = buckets_[bucketIndex(key)];
+  auto generation = generation_.load(std::memory_order_relaxed);
+  // Most accesses are to keys that were already accessed in this generation,
+  // so avoid dirtying the cache line when there is nothing to update.
+  if (bucket.load(std::memory_order_relaxed) != generation) {
+    bucket.store(generation, std::memory_order_relaxed);
+  }
+}
+
+void KeyAccessTracker::advance() {
+  generation_.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t KeyAccessTracker::getAge(folly::ByteRange key) const {
+  return generation_.load(std::memory_order_relaxed) -
+      buckets_[bucketIndex(key)].load(std::memory_order_relaxed);
+}
+
+void KeyAgeHistogram::add(uint32_t age, uint64_t weight) {
+  weightByAge_[age] += weight;
+  totalWeight_ += weight;
+}
+
+uint32_t KeyAgeHistogram::getEvictionAge(double fraction) const {
+  if (!(fraction > 0) || totalWeight_ == 0) {
+    return std::numeric_limits<uint32_t>::max();
+  }
+  auto evictWeight = static_cast<uint64_t>(
+      std::ceil(std::min(fraction, 1.0) * static_cast<double>(totalWeight_)));
+
+  // Walk from the oldest keys down until enough weight has been gathered.
+  uint64_t weight = 0;
+  uint32_t age = std::numeric_limits<uint32_t>::max();
+  for (auto it = weightByAge_.rbegin(); it != weightByAge_.rend(); ++it) {
+    age = it->first;
+    weight += it->second;
+    if (weight >= evictWeight) {
+      break;
+    }
+  }
+  return std::max<uint32_t>(age, 1);
+}
+
+} // namespace eden
+} // namespace facebook
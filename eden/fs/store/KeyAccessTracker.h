@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Approximately tracks when each key of a LocalStore key space was last
+ * read or written, so that garbage collection can evict the coldest keys
+ * rather than the whole key space.
+ *
+ * Time is measured in generations, which the owner advances periodically.
+ * Keys are hashed into a fixed number of buckets that each remember the last
+ * generation any of their keys was accessed in, so the memory used does not
+ * depend on the number of keys.  Keys that share a bucket look as recently
+ * used as the most recently used of them, which only ever makes eviction
+ * keep more than it needs to.  Keys that have not been accessed since the
+ * tracker was created look older than all others.
+ *
+ * It is safe to use this object from arbitrary threads.
+ */
+class KeyAccessTracker {
+ public:
+  /**
+   * bucketCount is rounded up to a power of two.
+   */
+  explicit KeyAccessTracker(size_t bucketCount);
+
+  void recordAccess(folly::ByteRange key);
+
+  /**
+   * Starts a new generation.
+   */
+  void advance();
+
+  /**
+   * Returns how many generations ago the key was last accessed.
+   */
+  uint32_t getAge(folly::ByteRange key) const;
+
+ private:
+  size_t bucketIndex(folly::ByteRange key) const;
+
+  std::unique_ptr<std::atomic<uint32_t>[]> buckets_;
+  size_t mask_;
+  // Generation 0 marks buckets that were never accessed.
+  std::atomic<uint32_t> generation_{1};
+};
+
+/**
+ * Tallies the keys found by a scan of a key space by age, so that the
+ * eviction cutoff reflects the keys that actually exist rather than the
+ * tracker's buckets, most of which may be empty in a sparse key space.
+ */
+class KeyAgeHistogram {
+ public:
+  /**
+   * Records a key of the given age.  weight is usually the number of bytes
+   * the key and its value occupy.
+   */
+  void add(uint32_t age, uint64_t weight);
+
+  uint64_t getTotalWeight() const {
+    return totalWeight_;
+  }
+
+  /**
+   * Returns the smallest age at which keys should be evicted in order to
+   * evict at least the given fraction of the recorded weight.  Keys accessed
+   * in the current generation are never evicted, so the result is at least 1.
+   */
+  uint32_t getEvictionAge(double fraction) const;
+
+ private:
+  std::map<uint32_t, uint64_t> weightByAge_;
+  uint64_t totalWeight_{0};
+};
+
+} // namespace eden
+} // namespace facebook
@@ -90,13 +90,18 @@ class KeySpace {
       "hgcommit2tree",
       Ephemeral{&EdenConfig::localStoreHgCommit2TreeSizeLimit}};
   static constexpr KeySpaceRecord BlobSizeFamily{5, "blobsize", Deprecated{}};
+  static constexpr KeySpaceRecord GitCommitToTreeFamily{
+      6,
+      "gitcommit2tree",
+      Ephemeral{&EdenConfig::localStoreGitCommit2TreeSizeLimit}};
 
   static constexpr const KeySpaceRecord* kAll[] = {&BlobFamily,
                                                    &BlobMetaDataFamily,
                                                    &TreeFamily,
                                                    &HgProxyHashFamily,
                                                    &HgCommitToTreeFamily,
-                                                   &BlobSizeFamily};
+                                                   &BlobSizeFamily,
+                                                   &GitCommitToTreeFamily};
   static constexpr size_t kTotalCount = std::size(kAll);
 
  private:
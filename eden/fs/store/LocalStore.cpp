@@ -14,14 +14,19 @@
 #include <folly/io/IOBuf.h>
 #include <folly/lang/Bits.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+#include <algorithm>
 #include <array>
 
 #include "eden/fs/model/Blob.h"
+#include "eden/fs/model/SerializedTree.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/model/git/GitBlob.h"
 #include "eden/fs/model/git/GitTree.h"
 #include "eden/fs/store/SerializedBlobMetadata.h"
 #include "eden/fs/store/StoreResult.h"
+#include "eden/fs/store/TreePackStore.h"
+#include "eden/fs/telemetry/Tracing.h"
 
 using folly::ByteRange;
 using folly::IOBuf;
@@ -33,6 +38,75 @@ using std::string;
 namespace facebook {
 namespace eden {
 
+DEFINE_bool(
+    localStoreIndexedTrees,
+    false,
+    "Write trees to the LocalStore in the indexed SerializedTree format, which "
+    "can be searched without decoding the whole tree. Older versions of EdenFS "
+    "cannot read trees written in this format");
+
+DEFINE_uint64(
+    localStoreBlobChunkSize,
+    0,
+    "If nonzero, blobs larger than this many bytes are written to the "
+    "LocalStore in chunks of this size, so that reads of part of a file only "
+    "need to load the chunks they overlap. Older versions of EdenFS cannot "
+    "read blobs written this way");
+
+namespace {
+// The value stored under the ID of a chunked blob is a header with this
+// prefix, followed by the blob size and chunk size in decimal and a NUL
+// terminator.  Git blobs always start with "blob ", so the two formats cannot
+// be confused.
+constexpr StringPiece kChunkedBlobPrefix{"chunks "};
+
+struct ChunkedBlobHeader {
+  uint64_t blobSize;
+  uint64_t chunkSize;
+};
+
+std::string serializeChunkedBlobHeader(const ChunkedBlobHeader& header) {
+  auto result = folly::to<string>(
+      kChunkedBlobPrefix, header.blobSize, " ", header.chunkSize);
+  result.push_back('\0');
+  return result;
+}
+
+optional<ChunkedBlobHeader> parseChunkedBlobHeader(
+    const Hash& id,
+    ByteRange data) {
+  StringPiece value{data};
+  if (!value.startsWith(kChunkedBlobPrefix)) {
+    return std::nullopt;
+  }
+  value.advance(kChunkedBlobPrefix.size());
+  auto end = value.find('\0');
+  StringPiece blobSize;
+  StringPiece chunkSize;
+  if (end == StringPiece::npos ||
+      !folly::split(' ', value.subpiece(0, end), blobSize, chunkSize)) {
+    throw std::invalid_argument(
+        folly::to<string>("invalid chunked blob header for ", id));
+  }
+  ChunkedBlobHeader header{
+      folly::to<uint64_t>(blobSize), folly::to<uint64_t>(chunkSize)};
+  if (header.chunkSize == 0) {
+    throw std::invalid_argument(
+        folly::to<string>("invalid chunk size in blob header for ", id));
+  }
+  return header;
+}
+
+/**
+ * Chunks are stored in the BlobFamily under keys derived from the blob ID,
+ * which cannot collide with the ID of any real blob.
+ */
+Hash getBlobChunkKey(const Hash& id, uint64_t index) {
+  auto key = folly::to<string>("chunk ", id.toString(), " ", index);
+  return Hash::sha1(ByteRange{StringPiece{key}});
+}
+} // namespace
+
 void LocalStore::clearDeprecatedKeySpaces() {
   for (auto& ks : KeySpace::kAll) {
     if (ks->isDeprecated()) {
@@ -57,6 +131,9 @@ void LocalStore::clearCaches() {
       clearKeySpace(ks);
     }
   }
+  if (treePacks_) {
+    treePacks_->clear();
+  }
 }
 
 void LocalStore::compactStorage() {
@@ -98,26 +175,139 @@ folly::Future<std::vector<StoreResult>> LocalStore::getBatch(
 // or deserializeGitBlob().
 
 folly::Future<std::unique_ptr<Tree>> LocalStore::getTree(const Hash& id) const {
+  TraceBlock block{"LocalStore::getTree"};
+  if (treePacks_) {
+    if (auto data = treePacks_->get(id)) {
+      ByteRange bytes{StringPiece{*data}};
+      if (SerializedTree::isSerializedTree(bytes)) {
+        return folly::makeFuture(
+            std::make_unique<Tree>(id, SerializedTree{std::move(*data)}));
+      }
+      return folly::makeFuture(
+          deserializeGitTree(id, bytes, GitTreeValidation::Trusted));
+    }
+  }
   return getFuture(KeySpace::TreeFamily, id.getBytes())
       .thenValue([id](StoreResult&& data) {
         if (!data.isValid()) {
           return std::unique_ptr<Tree>(nullptr);
         }
-        return deserializeGitTree(id, data.bytes());
+        if (SerializedTree::isSerializedTree(data.bytes())) {
+          return std::make_unique<Tree>(
+              id, SerializedTree{data.extractValue()});
+        }
+        // Trees in the LocalStore were checked when they were imported.
+        return deserializeGitTree(
+            id, data.bytes(), GitTreeValidation::Trusted);
       });
 }
 
 folly::Future<std::unique_ptr<Blob>> LocalStore::getBlob(const Hash& id) const {
   return getFuture(KeySpace::BlobFamily, id.getBytes())
-      .thenValue([id](StoreResult&& data) {
+      .thenValue([this, id](StoreResult&& data)
+                     -> folly::Future<std::unique_ptr<Blob>> {
         if (!data.isValid()) {
           return std::unique_ptr<Blob>(nullptr);
         }
+        if (auto header = parseChunkedBlobHeader(id, data.bytes())) {
+          return getBlobChunks(
+                     id,
+                     header->blobSize,
+                     header->chunkSize,
+                     0,
+                     header->blobSize)
+              .thenValue([id](std::unique_ptr<IOBuf> contents) {
+                if (!contents) {
+                  return std::unique_ptr<Blob>(nullptr);
+                }
+                return std::make_unique<Blob>(id, std::move(*contents));
+              });
+        }
         auto buf = data.extractIOBuf();
         return deserializeGitBlob(id, &buf);
       });
 }
 
+folly::Future<std::unique_ptr<IOBuf>>
+LocalStore::getBlobRange(const Hash& id, uint64_t offset, size_t length) const {
+  // Only blobs larger than the chunk size can have been stored in chunks.
+  // Checking the small metadata record first avoids reading the whole of an
+  // unchunked blob only to discard it.
+  return getBlobMetadata(id).thenValue(
+      [this, id, offset, length](optional<BlobMetadata>&& metadata)
+          -> folly::Future<std::unique_ptr<IOBuf>> {
+        if (!metadata || metadata->size <= getBlobChunkSize()) {
+          return std::unique_ptr<IOBuf>(nullptr);
+        }
+        return getFuture(KeySpace::BlobFamily, id.getBytes())
+            .thenValue(
+                [this, id, offset, length](StoreResult&& data)
+                    -> folly::Future<std::unique_ptr<IOBuf>> {
+                  if (!data.isValid()) {
+                    return std::unique_ptr<IOBuf>(nullptr);
+                  }
+                  auto header = parseChunkedBlobHeader(id, data.bytes());
+                  if (!header) {
+                    return std::unique_ptr<IOBuf>(nullptr);
+                  }
+                  return getBlobChunks(
+                      id, header->blobSize, header->chunkSize, offset, length);
+                });
+      });
+}
+
+uint64_t LocalStore::getBlobChunkSize() {
+  return FLAGS_localStoreBlobChunkSize;
+}
+
+folly::Future<std::unique_ptr<IOBuf>> LocalStore::getBlobChunks(
+    const Hash& id,
+    uint64_t blobSize,
+    uint64_t chunkSize,
+    uint64_t offset,
+    size_t length) const {
+  if (offset >= blobSize || length == 0) {
+    return IOBuf::create(0);
+  }
+  length = std::min<uint64_t>(length, blobSize - offset);
+  auto firstChunk = offset / chunkSize;
+  auto lastChunk = (offset + length - 1) / chunkSize;
+
+  std::vector<Hash> chunkKeys;
+  std::vector<ByteRange> keys;
+  chunkKeys.reserve(lastChunk - firstChunk + 1);
+  for (auto index = firstChunk; index <= lastChunk; ++index) {
+    chunkKeys.push_back(getBlobChunkKey(id, index));
+    keys.push_back(chunkKeys.back().getBytes());
+  }
+
+  return getBatch(KeySpace::BlobFamily, keys)
+      .thenValue([chunkKeys = std::move(chunkKeys),
+                  skip = offset - firstChunk * chunkSize,
+                  length](std::vector<StoreResult>&& results) {
+        std::unique_ptr<IOBuf> chunks;
+        for (auto& result : results) {
+          if (!result.isValid()) {
+            // The chunk was evicted or never written, so the blob has to be
+            // fetched again.
+            return std::unique_ptr<IOBuf>(nullptr);
+          }
+          auto chunk = std::make_unique<IOBuf>(result.extractIOBuf());
+          if (chunks) {
+            chunks->prependChain(std::move(chunk));
+          } else {
+            chunks = std::move(chunk);
+          }
+        }
+
+        Cursor cursor(chunks.get());
+        cursor.skip(skip);
+        std::unique_ptr<IOBuf> range;
+        cursor.clone(range, length);
+        return range;
+      });
+}
+
 folly::Future<optional<BlobMetadata>> LocalStore::getBlobMetadata(
     const Hash& id) const {
   return getFuture(KeySpace::BlobMetaDataFamily, id.getBytes())
@@ -131,6 +321,13 @@ folly::Future<optional<BlobMetadata>> LocalStore::getBlobMetadata(
 }
 
 std::pair<Hash, folly::IOBuf> LocalStore::serializeTree(const Tree* tree) {
+  // Trees without an ID are identified by the hash of their git encoding, so
+  // they always use it.
+  if (FLAGS_localStoreIndexedTrees && tree->getHash() != Hash()) {
+    return std::make_pair(
+        tree->getHash(), SerializedTree::serialize(tree->getTreeEntries()));
+  }
+
   GitTreeSerializer serializer;
   for (auto& entry : tree->getTreeEntries()) {
     serializer.addEntry(std::move(entry));
@@ -153,7 +350,11 @@ Hash LocalStore::putTree(const Tree* tree) {
   ByteRange treeData = serialized.second.coalesce();
 
   auto& id = serialized.first;
-  put(KeySpace::TreeFamily, id, treeData);
+  if (treePacks_) {
+    treePacks_->put(id, treeData);
+  } else {
+    put(KeySpace::TreeFamily, id, treeData);
+  }
   return id;
 }
 
@@ -184,14 +385,16 @@ BlobMetadata LocalStore::putBlob(const Hash& id, const Blob* blob) {
   }
 
   // Even if blob caching is disabled, it's worth caching the size and SHA-1.
-  auto hashBytes = id.getBytes();
-  SerializedBlobMetadata metadataBytes(metadata);
-
-  put(KeySpace::BlobMetaDataFamily, hashBytes, metadataBytes.slice());
+  putBlobMetadata(id, metadata);
 
   return metadata;
 }
 
+void LocalStore::putBlobMetadata(const Hash& id, const BlobMetadata& metadata) {
+  SerializedBlobMetadata metadataBytes(metadata);
+  put(KeySpace::BlobMetaDataFamily, id.getBytes(), metadataBytes.slice());
+}
+
 BlobMetadata LocalStore::getMetadataFromBlob(const Blob* blob) {
   Hash sha1 = Hash::sha1(blob->getContents());
   uint64_t size = blob->getSize();
@@ -217,6 +420,12 @@ void LocalStore::WriteBatch::put(
 }
 
 void LocalStore::WriteBatch::putBlob(const Hash& id, const Blob* blob) {
+  auto chunkSize = getBlobChunkSize();
+  if (chunkSize > 0 && blob->getSize() > chunkSize) {
+    putBlobChunks(id, blob, chunkSize);
+    return;
+  }
+
   const IOBuf& contents = blob->getContents();
   auto hashSlice = id.getBytes();
 
@@ -240,8 +449,39 @@ void LocalStore::WriteBatch::putBlob(const Hash& id, const Blob* blob) {
   put(KeySpace::BlobFamily, hashSlice, bodySlices);
 }
 
+void LocalStore::WriteBatch::putBlobChunks(
+    const Hash& id,
+    const Blob* blob,
+    uint64_t chunkSize) {
+  Cursor cursor(&blob->getContents());
+  for (uint64_t index = 0; !cursor.isAtEnd(); ++index) {
+    std::vector<ByteRange> chunkSlices;
+    uint64_t remaining = chunkSize;
+    while (remaining > 0 && !cursor.isAtEnd()) {
+      auto bytes = cursor.peekBytes();
+      bytes = bytes.subpiece(0, std::min<uint64_t>(bytes.size(), remaining));
+      chunkSlices.push_back(bytes);
+      cursor.skip(bytes.size());
+      remaining -= bytes.size();
+    }
+    auto chunkKey = getBlobChunkKey(id, index);
+    put(KeySpace::BlobFamily, chunkKey.getBytes(), std::move(chunkSlices));
+  }
+
+  // Write the header last, so that a reader that finds it can also expect
+  // to find every chunk unless they have since been evicted.
+  auto header = serializeChunkedBlobHeader({blob->getSize(), chunkSize});
+  put(KeySpace::BlobFamily, id.getBytes(), StringPiece{header});
+}
+
 LocalStore::WriteBatch::~WriteBatch() {}
 
+void LocalStore::enableTreePacks(
+    AbsolutePathPiece directory,
+    uint64_t packSizeTarget) {
+  treePacks_ = std::make_shared<TreePackStore>(directory, packSizeTarget);
+}
+
 void LocalStore::periodicManagementTask(const EdenConfig& /* config */) {
   // Individual store subclasses can provide their own implementations for
   // periodic management.
@@ -18,6 +18,7 @@
 namespace folly {
 template <typename T>
 class Future;
+class IOBuf;
 } // namespace folly
 
 namespace facebook {
@@ -28,6 +29,7 @@ class EdenConfig;
 class Hash;
 class StoreResult;
 class Tree;
+class TreePackStore;
 
 /*
  * LocalStore stores objects (trees and blobs) locally on disk.
@@ -127,6 +129,24 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
    */
   folly::Future<std::unique_ptr<Blob>> getBlob(const Hash& id) const;
 
+  /**
+   * Get part of the contents of a blob that was stored in chunks, reading
+   * only the chunks that overlap the requested range.
+   *
+   * Returns nullptr if the blob is not present in the store or was not
+   * stored in chunks, in which case the caller should read the whole blob
+   * instead.  The returned data is shorter than length if the range extends
+   * past the end of the blob.
+   */
+  folly::Future<std::unique_ptr<folly::IOBuf>>
+  getBlobRange(const Hash& id, uint64_t offset, size_t length) const;
+
+  /**
+   * Returns the size of the chunks that large blobs are written in, or 0 if
+   * new blobs are not being stored in chunks.
+   */
+  static uint64_t getBlobChunkSize();
+
   /**
    * Get the size of a blob and the SHA-1 hash of its contents.
    *
@@ -166,6 +186,11 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
    */
   BlobMetadata putBlob(const Hash& id, const Blob* blob);
 
+  /**
+   * Store the size and SHA-1 hash of a blob without its contents.
+   */
+  void putBlobMetadata(const Hash& id, const BlobMetadata& metadata);
+
   /**
    * Put arbitrary data in the store.
    */
@@ -233,6 +258,8 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
 
    private:
     friend class LocalStore;
+
+    void putBlobChunks(const Hash& id, const Blob* blob, uint64_t chunkSize);
   };
 
   BlobMetadata getMetadataFromBlob(const Blob* blob);
@@ -250,6 +277,22 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
 
   virtual void periodicManagementTask(const EdenConfig& config);
 
+  /**
+   * Store trees written with putTree() in memory-mapped pack files in
+   * directory instead of the TreeFamily KeySpace, and look trees up in the
+   * packs before the KeySpace.  Trees written by a WriteBatch still go to the
+   * KeySpace.  Must be called before the LocalStore is shared with other
+   * threads.
+   */
+  void enableTreePacks(AbsolutePathPiece directory, uint64_t packSizeTarget);
+
+  /**
+   * Returns the tree packs, or nullptr if they are not enabled.
+   */
+  TreePackStore* getTreePacks() const {
+    return treePacks_.get();
+  }
+
   /*
    * We keep this field to avoid making `LocalStore` holding a reference to
    * `EdenConfig`, which will require us to change all the subclasses. We update
@@ -258,6 +301,20 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
    * the configured local store management interval is).
    */
   std::atomic<bool> enableBlobCaching = true;
+
+ private:
+  /**
+   * Reads the given range of a blob stored in chunks of chunkSize bytes.
+   * Returns nullptr if any of the chunks is missing.
+   */
+  folly::Future<std::unique_ptr<folly::IOBuf>> getBlobChunks(
+      const Hash& id,
+      uint64_t blobSize,
+      uint64_t chunkSize,
+      uint64_t offset,
+      size_t length) const;
+
+  std::shared_ptr<TreePackStore> treePacks_;
 };
 } // namespace eden
 } // namespace facebook
@@ -7,22 +7,25 @@
 
 #include "eden/fs/store/MemoryLocalStore.h"
 #include <folly/String.h>
+#include <folly/hash/Hash.h>
+#include <algorithm>
 #include "eden/fs/store/StoreResult.h"
 namespace facebook {
 namespace eden {
 
 using folly::StringPiece;
 
-namespace {
+/**
+ * Buffers writes by shard, so that flush() takes each shard lock only once.
+ */
 class MemoryWriteBatch : public LocalStore::WriteBatch {
  public:
-  explicit MemoryWriteBatch(MemoryLocalStore* store) : store_(store) {
-    storage_.resize(KeySpace::kTotalCount);
-  }
+  explicit MemoryWriteBatch(MemoryLocalStore* store) : store_(store) {}
 
   void put(KeySpace keySpace, folly::ByteRange key, folly::ByteRange value)
       override {
-    storage_[keySpace->index][StringPiece(key)] = StringPiece(value).str();
+    shards_[MemoryLocalStore::getShardIndex(key)].push_back(
+        Item{keySpace, StringPiece(key).str(), StringPiece(value).str()});
   }
 
   void put(
@@ -37,54 +40,144 @@ class MemoryWriteBatch : public LocalStore::WriteBatch {
   }
 
   void flush() override {
-    for (auto& ks : KeySpace::kAll) {
-      for (const auto& it : storage_[ks->index]) {
-        store_->put(ks, folly::StringPiece(it.first), StringPiece(it.second));
+    for (size_t i = 0; i < MemoryLocalStore::kShardCount; ++i) {
+      auto& items = shards_[i];
+      if (items.empty()) {
+        continue;
+      }
+      {
+        auto shard = store_->shards_[i].wlock();
+        for (const auto& item : items) {
+          store_->insert(
+              *shard,
+              item.keySpace,
+              StringPiece(item.key),
+              StringPiece(item.value));
+        }
+        store_->evictUntilFits(*shard);
       }
-      storage_[ks->index].clear();
+      items.clear();
     }
   }
 
  private:
+  struct Item {
+    KeySpace keySpace;
+    std::string key;
+    std::string value;
+  };
+
   MemoryLocalStore* store_;
-  std::vector<folly::StringKeyedUnorderedMap<std::string>> storage_;
+  std::array<std::vector<Item>, MemoryLocalStore::kShardCount> shards_;
 };
-} // namespace
 
-MemoryLocalStore::MemoryLocalStore() {
-  storage_.wlock()->resize(KeySpace::kTotalCount);
+MemoryLocalStore::MemoryLocalStore(size_t maximumSizeBytes)
+    // Each shard gets an equal part of the maximum size.  A nonzero maximum
+    // must not round down to zero, which would disable eviction.
+    : maximumShardSize_{
+          maximumSizeBytes == 0
+              ? 0
+              : std::max<size_t>(maximumSizeBytes / kShardCount, 1)} {}
+
+size_t MemoryLocalStore::getShardIndex(folly::ByteRange key) {
+  static_assert(
+      (kShardCount & (kShardCount - 1)) == 0,
+      "kShardCount must be a power of two");
+  return folly::hash::fnv64_buf(key.data(), key.size()) & (kShardCount - 1);
 }
 
 void MemoryLocalStore::close() {}
 
 void MemoryLocalStore::clearKeySpace(KeySpace keySpace) {
-  (*storage_.wlock())[keySpace->index].clear();
+  for (auto& lockedShard : shards_) {
+    auto shard = lockedShard.wlock();
+    auto& items = shard->keySpaces[keySpace->index];
+    for (const auto& item : items) {
+      shard->totalSize -= item.first.size() + item.second.size();
+    }
+    items.clear();
+
+    auto& order = shard->insertionOrder;
+    order.erase(
+        std::remove_if(
+            order.begin(),
+            order.end(),
+            [&](const auto& entry) { return entry.first == keySpace->index; }),
+        order.end());
+  }
 }
 
 void MemoryLocalStore::compactKeySpace(KeySpace) {}
 
 StoreResult MemoryLocalStore::get(KeySpace keySpace, folly::ByteRange key)
     const {
-  auto store = storage_.rlock();
-  auto it = (*store)[keySpace->index].find(StringPiece(key));
-  if (it == (*store)[keySpace->index].end()) {
+  auto shard = shards_[getShardIndex(key)].rlock();
+  const auto& items = shard->keySpaces[keySpace->index];
+  auto it = items.find(StringPiece(key));
+  if (it == items.end()) {
     return StoreResult();
   }
   return StoreResult(std::string(it->second));
 }
 
 bool MemoryLocalStore::hasKey(KeySpace keySpace, folly::ByteRange key) const {
-  auto store = storage_.rlock();
-  auto it = (*store)[keySpace->index].find(StringPiece(key));
-  return it != (*store)[keySpace->index].end();
+  auto shard = shards_[getShardIndex(key)].rlock();
+  const auto& items = shard->keySpaces[keySpace->index];
+  return items.find(StringPiece(key)) != items.end();
 }
 
 void MemoryLocalStore::put(
     KeySpace keySpace,
     folly::ByteRange key,
     folly::ByteRange value) {
-  (*storage_.wlock())[keySpace->index][StringPiece(key)] =
-      StringPiece(value).str();
+  auto shard = shards_[getShardIndex(key)].wlock();
+  insert(*shard, keySpace, key, value);
+  evictUntilFits(*shard);
+}
+
+void MemoryLocalStore::insert(
+    Shard& shard,
+    KeySpace keySpace,
+    folly::ByteRange key,
+    folly::ByteRange value) {
+  auto& items = shard.keySpaces[keySpace->index];
+  auto it = items.find(StringPiece(key));
+  if (it != items.end()) {
+    shard.totalSize -= it->second.size();
+    it->second = StringPiece(value).str();
+    shard.totalSize += value.size();
+    return;
+  }
+
+  items.emplace(StringPiece(key), StringPiece(value).str());
+  shard.totalSize += key.size() + value.size();
+  if (maximumShardSize_ > 0 && keySpace->isEphemeral()) {
+    shard.insertionOrder.emplace_back(keySpace->index, StringPiece(key).str());
+  }
+}
+
+void MemoryLocalStore::evictUntilFits(Shard& shard) {
+  if (maximumShardSize_ == 0) {
+    return;
+  }
+  while (shard.totalSize > maximumShardSize_ && !shard.insertionOrder.empty()) {
+    const auto& oldest = shard.insertionOrder.front();
+    auto& items = shard.keySpaces[oldest.first];
+    auto it = items.find(oldest.second);
+    if (it != items.end()) {
+      shard.totalSize -= it->first.size() + it->second.size();
+      items.erase(it);
+    }
+    shard.insertionOrder.pop_front();
+  }
+}
+
+size_t MemoryLocalStore::getTotalSize() const {
+  size_t totalSize = 0;
+  for (const auto& shard : shards_) {
+    totalSize += shard.rlock()->totalSize;
+  }
+  return totalSize;
 }
 
 std::unique_ptr<LocalStore::WriteBatch> MemoryLocalStore::beginWrite(size_t) {
@@ -8,20 +8,33 @@
 #pragma once
 #include <folly/Synchronized.h>
 #include <folly/experimental/StringKeyedUnorderedMap.h>
+#include <array>
+#include <deque>
 #include "eden/fs/store/LocalStore.h"
 
 namespace facebook {
 namespace eden {
 
+class MemoryWriteBatch;
+
 /** An implementation of LocalStore that stores values in memory.
  * Stored values remain in memory for the lifetime of the
- * MemoryLocalStore instance.
+ * MemoryLocalStore instance, unless a maximum size is given.
  * MemoryLocalStore is thread safe, allowing concurrent reads and
  * writes from any thread.
+ *
+ * Keys are spread across shards by hash, each with its own lock, so that
+ * concurrent imports do not serialize on a single lock.
  * */
 class MemoryLocalStore : public LocalStore {
  public:
-  explicit MemoryLocalStore();
+  /**
+   * If maximumSizeBytes is nonzero, the oldest keys of the ephemeral key
+   * spaces are evicted to keep the total size of the keys and values stored
+   * under it.  Persistent key spaces are never evicted, so they may still
+   * grow past it.
+   */
+  explicit MemoryLocalStore(size_t maximumSizeBytes = 0);
   void close() override;
   void clearKeySpace(KeySpace keySpace) override;
   void compactKeySpace(KeySpace keySpace) override;
@@ -32,9 +45,37 @@ class MemoryLocalStore : public LocalStore {
   std::unique_ptr<LocalStore::WriteBatch> beginWrite(
       size_t bufSize = 0) override;
 
+  /**
+   * Returns the total size of the keys and values stored.
+   */
+  size_t getTotalSize() const;
+
+  static constexpr size_t kShardCount = 16;
+
  private:
-  folly::Synchronized<std::vector<folly::StringKeyedUnorderedMap<std::string>>>
-      storage_;
+  friend class MemoryWriteBatch;
+
+  using KeySpaceMap = folly::StringKeyedUnorderedMap<std::string>;
+
+  struct Shard {
+    std::array<KeySpaceMap, KeySpace::kTotalCount> keySpaces;
+    size_t totalSize{0};
+    /// The keys of the ephemeral key spaces, oldest first.  Only tracked when
+    /// there is a maximum size.
+    std::deque<std::pair<uint8_t, std::string>> insertionOrder;
+  };
+
+  static size_t getShardIndex(folly::ByteRange key);
+
+  void insert(
+      Shard& shard,
+      KeySpace keySpace,
+      folly::ByteRange key,
+      folly::ByteRange value);
+  void evictUntilFits(Shard& shard);
+
+  const size_t maximumShardSize_;
+  std::array<folly::Synchronized<Shard>, kShardCount> shards_;
 };
 
 } // namespace eden
@@ -13,6 +13,7 @@
 #include <folly/futures/Future.h>
 #include <folly/io/IOBuf.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <stdexcept>
 
 #ifndef _WIN32
@@ -22,6 +23,7 @@
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/store/BackingStore.h"
 #include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/TreeCache.h"
 #include "eden/fs/telemetry/EdenStats.h"
 
 using folly::Future;
@@ -33,34 +35,95 @@ using std::unique_ptr;
 namespace facebook {
 namespace eden {
 
+DEFINE_bool(
+    coalesceObjectStoreImports,
+    false,
+    "Have concurrent requests for the same object share a single "
+    "BackingStore import instead of each issuing their own");
+
 std::shared_ptr<ObjectStore> ObjectStore::create(
     shared_ptr<LocalStore> localStore,
     shared_ptr<BackingStore> backingStore,
     shared_ptr<EdenStats> stats,
-    folly::Executor::KeepAlive<folly::Executor> executor) {
-  return std::shared_ptr<ObjectStore>{new ObjectStore{std::move(localStore),
-                                                      std::move(backingStore),
-                                                      std::move(stats),
-                                                      executor}};
+    folly::Executor::KeepAlive<folly::Executor> executor,
+    shared_ptr<TreeCache> treeCache,
+    shared_ptr<BlobMetadataCache> metadataCache) {
+  return std::shared_ptr<ObjectStore>{new ObjectStore{
+      std::move(localStore),
+      std::move(backingStore),
+      std::move(stats),
+      executor,
+      std::move(treeCache),
+      std::move(metadataCache)}};
+}
+
+shared_ptr<BlobMetadataCache> ObjectStore::createMetadataCache() {
+  return BlobMetadataCache::create(kCacheSize);
 }
 
 ObjectStore::ObjectStore(
     shared_ptr<LocalStore> localStore,
     shared_ptr<BackingStore> backingStore,
     shared_ptr<EdenStats> stats,
-    folly::Executor::KeepAlive<folly::Executor> executor)
-    : metadataCache_{folly::in_place, kCacheSize},
+    folly::Executor::KeepAlive<folly::Executor> executor,
+    shared_ptr<TreeCache> treeCache,
+    shared_ptr<BlobMetadataCache> metadataCache)
+    : metadataCache_{metadataCache ? std::move(metadataCache)
+                                   : createMetadataCache()},
       localStore_{std::move(localStore)},
       backingStore_{std::move(backingStore)},
+      treeCache_{std::move(treeCache)},
       stats_{std::move(stats)},
       executor_{executor} {}
 
 ObjectStore::~ObjectStore() {}
 
+template <typename T, typename Import>
+Future<T> ObjectStore::coalesceImport(
+    InFlightImportMap<T> InFlightImports::*imports,
+    EdenThreadStatsBase::Timeseries ObjectStoreThreadStats::*coalescedStat,
+    const Hash& id,
+    Import&& import) const {
+  if (!FLAGS_coalesceObjectStoreImports) {
+    return import();
+  }
+
+  auto promise = std::make_shared<folly::SharedPromise<T>>();
+  {
+    auto inFlight = inFlightImports_.wlock();
+    auto ret = ((*inFlight).*imports).emplace(id, promise);
+    if (!ret.second) {
+      XLOG(DBG4) << "joining in-flight import of " << id;
+      (stats_->getObjectStoreStatsForCurrentThread().*coalescedStat)
+          .addValue(1);
+      return ret.first->second->getSemiFuture().via(executor_);
+    }
+  }
+
+  folly::makeFutureWith(std::forward<Import>(import))
+      .thenTry([self = shared_from_this(), imports, id, promise](
+                   folly::Try<T>&& result) {
+        // The object is in the LocalStore by now, so callers that arrive
+        // after this point will find it there.
+        ((*self->inFlightImports_.wlock()).*imports).erase(id);
+        promise->setTry(std::move(result));
+      });
+  return promise->getSemiFuture().via(executor_);
+}
+
 Future<shared_ptr<const Tree>> ObjectStore::getTree(
     const Hash& id,
     ObjectFetchContext& fetchContext) const {
-  // Check in the LocalStore first
+  if (treeCache_) {
+    if (auto tree = treeCache_->get(id)) {
+      XLOG(DBG4) << "tree " << id << " found in memory cache";
+      fetchContext.didFetch(
+          ObjectFetchContext::Tree, id, ObjectFetchContext::FromMemoryCache);
+      return makeFuture(std::move(tree));
+    }
+  }
+
+  // Check in the LocalStore next
   return localStore_->getTree(id).thenValue(
       [self = shared_from_this(), id, &fetchContext](
           shared_ptr<const Tree> tree) {
@@ -68,25 +131,18 @@ Future<shared_ptr<const Tree>> ObjectStore::getTree(
           XLOG(DBG4) << "tree " << id << " found in local store";
           fetchContext.didFetch(
               ObjectFetchContext::Tree, id, ObjectFetchContext::FromDiskCache);
+          if (self->treeCache_) {
+            self->treeCache_->insert(tree);
+          }
           return makeFuture(std::move(tree));
         }
 
-        // Note: We don't currently have logic here to avoid duplicate work if
-        // multiple callers request the same tree at once.  We could store a map
-        // of pending lookups as (Hash --> std::list<Promise<unique_ptr<Tree>>),
-        // and just add a new Promise to the list if this Hash already exists in
-        // the pending list.
-        //
-        // However, de-duplication of object loads will already be done at the
-        // Inode layer.  Therefore we currently don't bother de-duping loads at
-        // this layer.
-
         // Load the tree from the BackingStore.
         self->recordBackingStoreImport();
-        return self->backingStore_->getTree(id)
-            .via(self->executor_)
-            .thenValue([id, &fetchContext, localStore = self->localStore_](
-                           unique_ptr<const Tree> loadedTree) {
+        auto start = std::chrono::steady_clock::now();
+        return self->importTree(id).thenValue(
+            [self, id, &fetchContext, start](
+                shared_ptr<const Tree> loadedTree) {
               if (!loadedTree) {
                 // TODO: Perhaps we should do some short-term negative caching?
                 XLOG(DBG2) << "unable to find tree " << id;
@@ -94,13 +150,39 @@ Future<shared_ptr<const Tree>> ObjectStore::getTree(
                     folly::to<string>("tree ", id.toString(), " not found"));
               }
 
-              localStore->putTree(loadedTree.get());
               XLOG(DBG3) << "tree " << id << " retrieved from backing store";
               fetchContext.didFetch(
                   ObjectFetchContext::Tree,
                   id,
                   ObjectFetchContext::FromBackingStore);
-              return shared_ptr<const Tree>(std::move(loadedTree));
+              self->recordBackingStoreFetch(
+                  fetchContext,
+                  ObjectFetchContext::Tree,
+                  0,
+                  std::chrono::steady_clock::now() - start);
+              return loadedTree;
+            });
+      });
+}
+
+Future<shared_ptr<const Tree>> ObjectStore::importTree(const Hash& id) const {
+  return coalesceImport(
+      &InFlightImports::trees,
+      &ObjectStoreThreadStats::treeImportsCoalesced,
+      id,
+      [self = shared_from_this(), id] {
+        return self->backingStore_->getTree(id)
+            .via(self->executor_)
+            .thenValue([self](unique_ptr<const Tree> loadedTree) {
+              if (!loadedTree) {
+                return shared_ptr<const Tree>{};
+              }
+              self->localStore_->putTree(loadedTree.get());
+              auto tree = shared_ptr<const Tree>(std::move(loadedTree));
+              if (self->treeCache_) {
+                self->treeCache_->insert(tree);
+              }
+              return tree;
             });
       });
 }
@@ -149,7 +231,8 @@ Future<shared_ptr<const Tree>> ObjectStore::getTreeForManifest(
 
 folly::Future<folly::Unit> ObjectStore::prefetchBlobs(
     const std::vector<Hash>& ids,
-    ObjectFetchContext&) const {
+    ObjectFetchContext&,
+    ImportPriority priority) const {
   // In theory we could/should ask the localStore_ to filter the list
   // of ids down to just the set that we need to load, but there is no
   // bulk key existence check in rocksdb, so we would need to cause it
@@ -161,7 +244,64 @@ folly::Future<folly::Unit> ObjectStore::prefetchBlobs(
   if (ids.empty()) {
     return folly::unit;
   }
-  return backingStore_->prefetchBlobs(ids).via(executor_);
+  return backingStore_->prefetchBlobs(ids, priority).via(executor_);
+}
+
+folly::Future<folly::Unit> ObjectStore::prefetchBlobMetadata(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& context) const {
+  std::vector<Hash> uncached;
+  for (const auto& id : ids) {
+    if (!metadataCache_->get(id)) {
+      uncached.push_back(id);
+    }
+  }
+  if (uncached.empty()) {
+    return folly::unit;
+  }
+
+  std::vector<folly::ByteRange> keys;
+  keys.reserve(uncached.size());
+  for (const auto& id : uncached) {
+    keys.push_back(id.getBytes());
+  }
+  auto self = shared_from_this();
+  return localStore_->getBatch(KeySpace::BlobMetaDataFamily, keys)
+      .thenValue([self, uncached = std::move(uncached), &context](
+                     std::vector<StoreResult>&& results) {
+        std::vector<Hash> missing;
+        for (size_t i = 0; i < results.size(); ++i) {
+          if (!results[i].isValid()) {
+            missing.push_back(uncached[i]);
+          }
+        }
+        if (missing.empty()) {
+          return makeFuture();
+        }
+        return self->backingStore_->getBlobMetadataBatch(missing)
+            .via(self->executor_)
+            .thenTry([self, missing, total = uncached.size(), &context](
+                         folly::Try<std::vector<std::optional<BlobMetadata>>>&&
+                             metadata) {
+              // Blobs whose metadata is not available on its own are
+              // imported in full instead.
+              std::vector<Hash> blobs;
+              for (size_t i = 0; i < missing.size(); ++i) {
+                if (metadata.hasValue() && metadata->at(i)) {
+                  self->localStore_->putBlobMetadata(
+                      missing[i], *metadata->at(i));
+                  self->metadataCache_->set(missing[i], *metadata->at(i));
+                } else {
+                  blobs.push_back(missing[i]);
+                }
+              }
+              XLOG(DBG4) << "fetched the metadata of "
+                         << missing.size() - blobs.size() << " of "
+                         << total << " blobs, prefetching "
+                         << blobs.size() << " more";
+              return self->prefetchBlobs(blobs, context);
+            });
+      });
 }
 
 Future<shared_ptr<const Blob>> ObjectStore::getBlob(
@@ -187,20 +327,22 @@ Future<shared_ptr<const Blob>> ObjectStore::getBlob(
 
     // Look in the BackingStore
     self->recordBackingStoreImport();
-    return self->backingStore_->getBlob(id, priority)
-        .via(self->executor_)
-        .thenValue([self, &fetchContext, id](
-                       unique_ptr<const Blob> loadedBlob) {
-          if (loadedBlob) {
+    auto start = std::chrono::steady_clock::now();
+    return self->importBlob(id, priority)
+        .thenValue([self, &fetchContext, id, start](ImportedBlob imported) {
+          if (imported.blob) {
             XLOG(DBG3) << "blob " << id << "  retrieved from backing store";
             self->updateBlobStats(false, true);
             fetchContext.didFetch(
                 ObjectFetchContext::Blob,
                 id,
                 ObjectFetchContext::FromBackingStore);
-            auto metadata = self->localStore_->putBlob(id, loadedBlob.get());
-            self->metadataCache_.wlock()->set(id, metadata);
-            return shared_ptr<const Blob>(std::move(loadedBlob));
+            self->recordBackingStoreFetch(
+                fetchContext,
+                ObjectFetchContext::Blob,
+                imported.blob->getSize(),
+                std::chrono::steady_clock::now() - start);
+            return std::move(imported.blob);
           }
 
           XLOG(DBG2) << "unable to find blob " << id;
@@ -212,6 +354,48 @@ Future<shared_ptr<const Blob>> ObjectStore::getBlob(
   });
 }
 
+Future<unique_ptr<folly::IOBuf>> ObjectStore::getBlobRange(
+    const Hash& id,
+    uint64_t offset,
+    size_t length,
+    ObjectFetchContext& fetchContext) const {
+  auto self = shared_from_this();
+  return localStore_->getBlobRange(id, offset, length)
+      .thenValue([self, id, &fetchContext](unique_ptr<folly::IOBuf> range) {
+        if (range) {
+          XLOG(DBG4) << "range of blob " << id << " found in local store";
+          self->updateBlobStats(true, false);
+          fetchContext.didFetch(
+              ObjectFetchContext::Blob, id, ObjectFetchContext::FromDiskCache);
+        }
+        return range;
+      });
+}
+
+Future<ObjectStore::ImportedBlob> ObjectStore::importBlob(
+    const Hash& id,
+    ImportPriority priority) const {
+  return coalesceImport(
+      &InFlightImports::blobs,
+      &ObjectStoreThreadStats::blobImportsCoalesced,
+      id,
+      [self = shared_from_this(), id, priority] {
+        return self->backingStore_->getBlob(id, priority)
+            .via(self->executor_)
+            .thenValue([self, id](unique_ptr<const Blob> loadedBlob) {
+              ImportedBlob imported;
+              if (loadedBlob) {
+                auto metadata =
+                    self->localStore_->putBlob(id, loadedBlob.get());
+                self->metadataCache_->set(id, metadata);
+                imported.blob = std::move(loadedBlob);
+                imported.metadata = metadata;
+              }
+              return imported;
+            });
+      });
+}
+
 void ObjectStore::updateBlobStats(bool local, bool backing) const {
   ObjectStoreThreadStats& stats = stats_->getObjectStoreStatsForCurrentThread();
   stats.getBlobFromLocalStore.addValue(local);
@@ -222,17 +406,13 @@ Future<BlobMetadata> ObjectStore::getBlobMetadata(
     const Hash& id,
     ObjectFetchContext& context) const {
   // Check in-memory cache
-  {
-    auto metadataCache = metadataCache_.wlock();
-    auto cacheIter = metadataCache->find(id);
-    if (cacheIter != metadataCache->end()) {
-      updateBlobMetadataStats(true, false, false);
-      context.didFetch(
-          ObjectFetchContext::BlobMetadata,
-          id,
-          ObjectFetchContext::FromMemoryCache);
-      return cacheIter->second;
-    }
+  if (auto cached = metadataCache_->get(id)) {
+    updateBlobMetadataStats(true, false, false);
+    context.didFetch(
+        ObjectFetchContext::BlobMetadata,
+        id,
+        ObjectFetchContext::FromMemoryCache);
+    return *cached;
   }
 
   auto self = shared_from_this();
@@ -242,7 +422,7 @@ Future<BlobMetadata> ObjectStore::getBlobMetadata(
       [self, id, &context](std::optional<BlobMetadata>&& metadata) {
         if (metadata) {
           self->updateBlobMetadataStats(false, true, false);
-          self->metadataCache_.wlock()->set(id, *metadata);
+          self->metadataCache_->set(id, *metadata);
           context.didFetch(
               ObjectFetchContext::BlobMetadata,
               id,
@@ -250,32 +430,64 @@ Future<BlobMetadata> ObjectStore::getBlobMetadata(
           return makeFuture(*metadata);
         }
 
-        // Check backing store
-        //
-        // TODO: It would be nice to add a smarter API to the BackingStore so
-        // that we can query it just for the blob metadata if it supports
-        // getting that without retrieving the full blob data.
-        //
-        // TODO: This should probably check the LocalStore for the blob first,
-        // especially when we begin to expire entries in RocksDB.
-        self->recordBackingStoreImport();
-        return self->backingStore_->getBlob(id)
-            .via(self->executor_)
-            .thenValue([self, id, &context](std::unique_ptr<Blob> blob) {
-              if (blob) {
+        return self->getBlobMetadataFromBackingStore(id, context);
+      });
+}
+
+Future<BlobMetadata> ObjectStore::getBlobMetadataFromBackingStore(
+    const Hash& id,
+    ObjectFetchContext& context) const {
+  // TODO: This should probably check the LocalStore for the blob first,
+  // especially when we begin to expire entries in RocksDB.
+  recordBackingStoreImport();
+  auto start = std::chrono::steady_clock::now();
+  return backingStore_->getBlobMetadataBatch({id})
+      .via(executor_)
+      .thenTry([id](folly::Try<std::vector<std::optional<BlobMetadata>>>&&
+                        result) -> std::optional<BlobMetadata> {
+        if (result.hasException()) {
+          XLOG(DBG3) << "unable to fetch the metadata of blob " << id
+                     << " on its own: "
+                     << folly::exceptionStr(result.exception());
+          return std::nullopt;
+        }
+        return result.value().at(0);
+      })
+      .thenValue([self = shared_from_this(), id, &context, start](
+                     std::optional<BlobMetadata>&& metadata) {
+        if (metadata) {
+          self->updateBlobMetadataStats(false, false, true);
+          self->localStore_->putBlobMetadata(id, *metadata);
+          self->metadataCache_->set(id, *metadata);
+          context.didFetch(
+              ObjectFetchContext::BlobMetadata,
+              id,
+              ObjectFetchContext::FromBackingStore);
+          self->recordBackingStoreFetch(
+              context,
+              ObjectFetchContext::BlobMetadata,
+              0,
+              std::chrono::steady_clock::now() - start);
+          return makeFuture(*metadata);
+        }
+
+        return self->importBlob(id, ImportPriority::kNormal())
+            .thenValue([self, id, &context, start](ImportedBlob imported) {
+              if (imported.blob) {
                 self->updateBlobMetadataStats(false, false, true);
-                auto metadata = self->localStore_->putBlob(id, blob.get());
-                self->metadataCache_.wlock()->set(id, metadata);
                 // I could see an argument for recording this fetch with type
                 // Blob instead of BlobMetadata, but it's probably more useful
-                // in context to know how many metadata fetches occurred. Also,
-                // since backing stores don't directly support fetching
-                // metadata, it should be clear.
+                // in context to know how many metadata fetches occurred.
                 context.didFetch(
                     ObjectFetchContext::BlobMetadata,
                     id,
                     ObjectFetchContext::FromBackingStore);
-                return makeFuture(metadata);
+                self->recordBackingStoreFetch(
+                    context,
+                    ObjectFetchContext::BlobMetadata,
+                    imported.blob->getSize(),
+                    std::chrono::steady_clock::now() - start);
+                return *imported.metadata;
               }
 
               self->updateBlobMetadataStats(false, false, false);
@@ -316,5 +528,21 @@ void ObjectStore::recordBackingStoreImport() const {
 #endif
 }
 
+void ObjectStore::recordBackingStoreFetch(
+    ObjectFetchContext& context,
+    ObjectFetchContext::ObjectType type,
+    uint64_t bytes,
+    std::chrono::steady_clock::duration wait) const {
+  auto waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(wait);
+  context.didImport(type, bytes, waitNs);
+#ifndef _WIN32
+  // Future callbacks run in the RequestContext they were added from, so this
+  // is still the FUSE request that triggered the import.
+  if (RequestData::isFuseRequest()) {
+    RequestData::get().getEdenTopStats().addBackingStoreFetch(bytes, waitNs);
+  }
+#endif
+}
+
 } // namespace eden
 } // namespace facebook
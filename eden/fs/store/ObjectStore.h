@@ -10,10 +10,14 @@
 #include <folly/Executor.h>
 #include <folly/Synchronized.h>
 #include <folly/container/EvictingCacheMap.h>
+#include <folly/futures/SharedPromise.h>
 #include <memory>
+#include <optional>
+#include <unordered_map>
 
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/store/BlobMetadata.h"
+#include "eden/fs/store/BlobMetadataCache.h"
 #include "eden/fs/store/IObjectStore.h"
 #include "eden/fs/store/ImportPriority.h"
 #include "eden/fs/telemetry/EdenStats.h"
@@ -25,6 +29,7 @@ class BackingStore;
 class Blob;
 class LocalStore;
 class Tree;
+class TreeCache;
 
 /**
  * ObjectStore is a content-addressed store for eden object data.
@@ -43,9 +48,17 @@ class ObjectStore : public IObjectStore,
       std::shared_ptr<LocalStore> localStore,
       std::shared_ptr<BackingStore> backingStore,
       std::shared_ptr<EdenStats> stats,
-      folly::Executor::KeepAlive<folly::Executor> executor);
+      folly::Executor::KeepAlive<folly::Executor> executor,
+      std::shared_ptr<TreeCache> treeCache = nullptr,
+      std::shared_ptr<BlobMetadataCache> metadataCache = nullptr);
   ~ObjectStore() override;
 
+  /**
+   * Creates a BlobMetadataCache of the size each ObjectStore gets by default,
+   * for sharing between ObjectStores.
+   */
+  static std::shared_ptr<BlobMetadataCache> createMetadataCache();
+
   /**
    * Get a Tree by ID.
    *
@@ -75,7 +88,8 @@ class ObjectStore : public IObjectStore,
 
   folly::Future<folly::Unit> prefetchBlobs(
       const std::vector<Hash>& ids,
-      ObjectFetchContext& context) const override;
+      ObjectFetchContext& context,
+      ImportPriority priority = ImportPriority::kNormal()) const override;
 
   /**
    * Get a Blob by ID.
@@ -89,6 +103,19 @@ class ObjectStore : public IObjectStore,
       ObjectFetchContext& context,
       ImportPriority priority = ImportPriority::kNormal()) const override;
 
+  /**
+   * Reads part of a blob without loading the rest of it, if the LocalStore
+   * has it stored in chunks.
+   *
+   * Returns nullptr if the blob is not available in chunks, in which case
+   * the caller should fall back to getBlob().
+   */
+  folly::Future<std::unique_ptr<folly::IOBuf>> getBlobRange(
+      const Hash& id,
+      uint64_t offset,
+      size_t length,
+      ObjectFetchContext& context) const;
+
   /**
    * Returns the size of the contents of the blob with the given ID.
    */
@@ -102,6 +129,16 @@ class ObjectStore : public IObjectStore,
   folly::Future<Hash> getBlobSha1(const Hash& id, ObjectFetchContext& context)
       const;
 
+  /**
+   * Ensures the backing store has every blob whose metadata is in neither
+   * the metadata cache nor the LocalStore, asking for all of them in one
+   * batch, so that getBlobMetadata calls for these blobs do not each wait
+   * for their own import.
+   */
+  folly::Future<folly::Unit> prefetchBlobMetadata(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context) const;
+
   /**
    * Get the LocalStore used by this ObjectStore
    */
@@ -122,7 +159,9 @@ class ObjectStore : public IObjectStore,
       std::shared_ptr<LocalStore> localStore,
       std::shared_ptr<BackingStore> backingStore,
       std::shared_ptr<EdenStats> stats,
-      folly::Executor::KeepAlive<folly::Executor> executor);
+      folly::Executor::KeepAlive<folly::Executor> executor,
+      std::shared_ptr<TreeCache> treeCache,
+      std::shared_ptr<BlobMetadataCache> metadataCache);
   // Forbidden copy constructor and assignment operator
   ObjectStore(ObjectStore const&) = delete;
   ObjectStore& operator=(ObjectStore const&) = delete;
@@ -138,6 +177,59 @@ class ObjectStore : public IObjectStore,
       const Hash& id,
       ObjectFetchContext& context) const;
 
+  /**
+   * Get a blob's metadata from the BackingStore, importing the whole blob
+   * only if the BackingStore cannot provide the metadata on its own.
+   */
+  folly::Future<BlobMetadata> getBlobMetadataFromBackingStore(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+
+  /**
+   * A blob fetched from the BackingStore, along with the metadata computed
+   * while storing it in the LocalStore.  blob is null if the BackingStore
+   * does not have it.
+   */
+  struct ImportedBlob {
+    std::shared_ptr<const Blob> blob;
+    std::optional<BlobMetadata> metadata;
+  };
+
+  /**
+   * Fetch a blob from the BackingStore, and save it and its metadata in the
+   * LocalStore and the metadata cache.
+   */
+  folly::Future<ImportedBlob> importBlob(
+      const Hash& id,
+      ImportPriority priority) const;
+
+  /**
+   * Fetch a tree from the BackingStore, and save it in the LocalStore and the
+   * TreeCache.  Produces a null tree if the BackingStore does not have it.
+   */
+  folly::Future<std::shared_ptr<const Tree>> importTree(const Hash& id) const;
+
+  template <typename T>
+  using InFlightImportMap =
+      std::unordered_map<Hash, std::shared_ptr<folly::SharedPromise<T>>>;
+
+  struct InFlightImports {
+    InFlightImportMap<ImportedBlob> blobs;
+    InFlightImportMap<std::shared_ptr<const Tree>> trees;
+  };
+
+  /**
+   * Run import() unless an import of the same object is already in flight,
+   * in which case share its result instead.  This is a no-op unless
+   * --coalesceObjectStoreImports is set.
+   */
+  template <typename T, typename Import>
+  folly::Future<T> coalesceImport(
+      InFlightImportMap<T> InFlightImports::*imports,
+      EdenThreadStatsBase::Timeseries ObjectStoreThreadStats::*coalescedStat,
+      const Hash& id,
+      Import&& import) const;
+
   static constexpr size_t kCacheSize = 1000000;
 
   /**
@@ -151,11 +243,18 @@ class ObjectStore : public IObjectStore,
    * depending on whether the node fits cleanly into one of jemalloc's size
    * classes.
    *
-   * TODO: It never makes sense to rlock an LRU cache, since cache hits mutate
-   * the data structure. Thus, should we use a more appropriate type of lock?
+   * Multiple ObjectStores may share the same BlobMetadataCache, in which case
+   * its size is set by EdenServer instead.
+   */
+  std::shared_ptr<BlobMetadataCache> metadataCache_;
+
+  /**
+   * BackingStore imports currently in progress, so that FUSE requests for the
+   * same object arriving at once (e.g. a build starting up) share one import.
+   * Entries are removed once their object has been written to the LocalStore,
+   * after which later callers will find it there.
    */
-  mutable folly::Synchronized<folly::EvictingCacheMap<Hash, BlobMetadata>>
-      metadataCache_;
+  mutable folly::Synchronized<InFlightImports> inFlightImports_;
 
   /*
    * The LocalStore.
@@ -170,6 +269,12 @@ class ObjectStore : public IObjectStore,
    * Multiple ObjectStores may share the same BackingStore.
    */
   std::shared_ptr<BackingStore> backingStore_;
+  /*
+   * The in-memory TreeCache, or null if trees are not cached in memory.
+   *
+   * Multiple ObjectStores may share the same TreeCache.
+   */
+  std::shared_ptr<TreeCache> treeCache_;
 
   std::shared_ptr<EdenStats> const stats_;
 
@@ -179,6 +284,16 @@ class ObjectStore : public IObjectStore,
   void updateBlobMetadataStats(bool memory, bool local, bool backing) const;
 
   void recordBackingStoreImport() const;
+
+  /**
+   * Attribute the cost of a completed backing store import to the fetch
+   * context and, for FUSE requests, to the requesting process.
+   */
+  void recordBackingStoreFetch(
+      ObjectFetchContext& context,
+      ObjectFetchContext::ObjectType type,
+      uint64_t bytes,
+      std::chrono::steady_clock::duration wait) const;
 };
 
 } // namespace eden
@@ -7,8 +7,10 @@
 
 #include "eden/fs/store/RocksDbLocalStore.h"
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <optional>
 
 #include <fb303/ServiceData.h>
 #include <folly/Format.h>
@@ -18,10 +20,14 @@
 #include <folly/io/IOBuf.h>
 #include <folly/lang/Bits.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+#include <rocksdb/cache.h>
 #include <rocksdb/convenience.h>
 #include <rocksdb/db.h>
 #include <rocksdb/filter_policy.h>
+#include <rocksdb/statistics.h>
 #include <rocksdb/table.h>
+#include <rocksdb/table_properties.h>
 
 #include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/rocksdb/RocksException.h"
@@ -40,18 +46,207 @@ using rocksdb::WriteOptions;
 using std::string;
 using std::chrono::duration_cast;
 
+namespace facebook {
+namespace eden {
+DEFINE_string(
+    localStoreCompression,
+    "",
+    "Comma-separated keyspace=algorithm pairs, e.g. \"tree=zstd,blob=zstd\", "
+    "choosing how each key space is compressed in RocksDB. The algorithms "
+    "are none, snappy, lz4 and zstd; other key spaces keep the RocksDB "
+    "default. Read when the local store is opened");
+DEFINE_int32(
+    localStoreZstdDictionarySize,
+    0,
+    "If nonzero, train a zstd dictionary of this many bytes on a sample of "
+    "each SST file of the zstd compressed key spaces");
+} // namespace eden
+} // namespace facebook
+
 namespace {
 using namespace facebook::eden;
 
-rocksdb::ColumnFamilyOptions makeColumnOptions(uint64_t LRUblockCacheSizeMB) {
+// Each KeyAccessTracker takes 4 bytes per bucket.
+constexpr size_t kAccessTrackerBuckets = 256 * 1024;
+
+// Garbage collection deletes evicted keys in write batches of about this
+// many bytes.
+constexpr size_t kEvictionBatchSize = 1024 * 1024;
+
+// zstd recommends training dictionaries on about 100 times their size.
+constexpr int kZstdTrainingBytesPerDictionaryByte = 100;
+
+std::optional<rocksdb::CompressionType> parseCompressionType(
+    folly::StringPiece name) {
+  if (name == "none") {
+    return rocksdb::kNoCompression;
+  } else if (name == "snappy") {
+    return rocksdb::kSnappyCompression;
+  } else if (name == "lz4") {
+    return rocksdb::kLZ4Compression;
+  } else if (name == "zstd") {
+    return rocksdb::kZSTD;
+  }
+  return std::nullopt;
+}
+
+/**
+ * Parse --localStoreCompression into the compression type of each key space,
+ * indexed like KeySpace::kAll.
+ */
+std::array<std::optional<rocksdb::CompressionType>, KeySpace::kTotalCount>
+getKeySpaceCompression() {
+  std::array<std::optional<rocksdb::CompressionType>, KeySpace::kTotalCount>
+      result;
+  std::vector<folly::StringPiece> settings;
+  folly::split(',', FLAGS_localStoreCompression, settings, true);
+  for (auto setting : settings) {
+    folly::StringPiece name;
+    folly::StringPiece algorithm;
+    if (!folly::split('=', setting, name, algorithm)) {
+      XLOG(WARN) << "ignoring malformed local store compression setting \""
+                 << setting << "\"";
+      continue;
+    }
+    auto type = parseCompressionType(algorithm);
+    if (!type) {
+      XLOG(WARN) << "ignoring unknown local store compression \"" << algorithm
+                 << "\" for key space " << name;
+      continue;
+    }
+    auto ks = std::find_if(
+        std::begin(KeySpace::kAll),
+        std::end(KeySpace::kAll),
+        [name](const KeySpaceRecord* record) { return record->name == name; });
+    if (ks == std::end(KeySpace::kAll)) {
+      XLOG(WARN) << "ignoring compression setting for unknown key space "
+                 << name;
+      continue;
+    }
+    result[(*ks)->index] = type;
+  }
+  return result;
+}
+
+bool isCompressionConfigured() {
+  auto compression = getKeySpaceCompression();
+  return std::any_of(
+      compression.begin(), compression.end(), [](const auto& type) {
+        return type.has_value();
+      });
+}
+
+void setCompression(
+    rocksdb::ColumnFamilyOptions& options,
+    rocksdb::CompressionType type) {
+  options.compression = type;
+  // Also compress the bottommost level, which holds most of the data, the
+  // same way.
+  options.bottommost_compression = type;
+  if (type == rocksdb::kZSTD && FLAGS_localStoreZstdDictionarySize > 0) {
+    // RocksDB trains the dictionary on samples of the data of each SST file it
+    // writes, and stores it in the file.
+    options.compression_opts.max_dict_bytes =
+        FLAGS_localStoreZstdDictionarySize;
+    options.compression_opts.zstd_max_train_bytes =
+        FLAGS_localStoreZstdDictionarySize *
+        kZstdTrainingBytesPerDictionaryByte;
+    options.bottommost_compression_opts = options.compression_opts;
+    options.bottommost_compression_opts.enabled = true;
+  }
+}
+
+/**
+ * The groups of key spaces that are tuned together.  See the rocksdb:
+ * settings in EdenConfig.
+ */
+enum class ColumnGroup { Blob, Tree, Metadata };
+constexpr size_t kColumnGroupCount = 3;
+
+ColumnGroup getColumnGroup(KeySpace ks) {
+  if (ks == KeySpace::BlobFamily) {
+    return ColumnGroup::Blob;
+  } else if (ks == KeySpace::TreeFamily) {
+    return ColumnGroup::Tree;
+  }
+  return ColumnGroup::Metadata;
+}
+
+struct ColumnProfile {
+  uint64_t blockCacheSize;
+  uint64_t bloomBits;
+  bool partitionedIndex;
+  std::string compactionStyle;
+  uint64_t writeBufferSize;
+};
+
+ColumnProfile getColumnProfile(const EdenConfig& config, ColumnGroup group) {
+  switch (group) {
+    case ColumnGroup::Blob:
+      return ColumnProfile{config.rocksdbBlobBlockCacheSize.getValue(),
+                           config.rocksdbBlobBloomBits.getValue(),
+                           config.rocksdbBlobPartitionedIndex.getValue(),
+                           config.rocksdbBlobCompactionStyle.getValue(),
+                           config.rocksdbBlobWriteBufferSize.getValue()};
+    case ColumnGroup::Tree:
+      return ColumnProfile{config.rocksdbTreeBlockCacheSize.getValue(),
+                           config.rocksdbTreeBloomBits.getValue(),
+                           config.rocksdbTreePartitionedIndex.getValue(),
+                           config.rocksdbTreeCompactionStyle.getValue(),
+                           config.rocksdbTreeWriteBufferSize.getValue()};
+    case ColumnGroup::Metadata:
+      break;
+  }
+  return ColumnProfile{config.rocksdbMetadataBlockCacheSize.getValue(),
+                       config.rocksdbMetadataBloomBits.getValue(),
+                       config.rocksdbMetadataPartitionedIndex.getValue(),
+                       config.rocksdbMetadataCompactionStyle.getValue(),
+                       config.rocksdbMetadataWriteBufferSize.getValue()};
+}
+
+rocksdb::ColumnFamilyOptions makeColumnOptions(
+    const ColumnProfile& profile,
+    std::shared_ptr<rocksdb::Cache> blockCache) {
   rocksdb::ColumnFamilyOptions options;
 
   // We'll never perform range scans on any of the keys that we store.
-  // This enables bloom filters and a hash policy that improves our
-  // get/put performance.
-  options.OptimizeForPointLookup(LRUblockCacheSizeMB);
-
-  options.OptimizeLevelStyleCompaction();
+  // This enables bloom filters and a hash index in each data block, as
+  // OptimizeForPointLookup() does, which improves our get/put performance.
+  rocksdb::BlockBasedTableOptions tableOptions;
+  tableOptions.data_block_index_type =
+      rocksdb::BlockBasedTableOptions::kDataBlockBinaryAndHash;
+  tableOptions.data_block_hash_table_util_ratio = 0.75;
+  if (profile.bloomBits > 0) {
+    tableOptions.filter_policy.reset(
+        rocksdb::NewBloomFilterPolicy(profile.bloomBits, false));
+  }
+  tableOptions.block_cache = std::move(blockCache);
+  if (profile.partitionedIndex) {
+    // Split the index and filter of each SST file into blocks that live in
+    // the block cache like data blocks, so that large files do not pin their
+    // whole index in memory.
+    tableOptions.index_type =
+        rocksdb::BlockBasedTableOptions::kTwoLevelIndexSearch;
+    tableOptions.partition_filters = profile.bloomBits > 0;
+    tableOptions.cache_index_and_filter_blocks = true;
+    tableOptions.pin_top_level_index_and_filter = true;
+  }
+  options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(tableOptions));
+  options.memtable_prefix_bloom_size_ratio = 0.02;
+  options.memtable_whole_key_filtering = true;
+
+  // The Optimize*StyleCompaction() functions size the write buffers at a
+  // quarter of the memtable budget.
+  auto memtableBudget = profile.writeBufferSize * 4;
+  if (profile.compactionStyle == "universal") {
+    options.OptimizeUniversalStyleCompaction(memtableBudget);
+  } else {
+    if (profile.compactionStyle != "level") {
+      XLOG(WARN) << "ignoring unknown RocksDB compaction style \""
+                 << profile.compactionStyle << "\"";
+    }
+    options.OptimizeLevelStyleCompaction(memtableBudget);
+  }
   return options;
 }
 
@@ -59,32 +254,41 @@ rocksdb::ColumnFamilyOptions makeColumnOptions(uint64_t LRUblockCacheSizeMB) {
  * The different key spaces that we desire.
  * The ordering is coupled with the values of the KeySpace enum.
  */
-const std::vector<rocksdb::ColumnFamilyDescriptor>& columnFamilies() {
-  auto makeColumnFamilyDescriptors = [] {
-    // Most of the column families will share the same cache.  We
-    // want the blob data to live in its own smaller cache; the assumption
-    // is that the vfs cache will compensate for that, together with the
-    // idea that we shouldn't need to materialize a great many files.
-    auto options = makeColumnOptions(64);
-    auto blobOptions = makeColumnOptions(8);
-
-    // Meyers singleton to avoid SIOF issues
-    std::vector<rocksdb::ColumnFamilyDescriptor> families;
-    for (auto& ks : KeySpace::kAll) {
-      families.emplace_back(
-          ks->name.str(),
-          (ks->index == KeySpace::BlobFamily.index) ? blobOptions : options);
-    }
-    // Put the default column family last.
-    // This way the KeySpace enum values can be used directly as indexes
-    // into our column family vectors.
-    families.emplace_back(rocksdb::kDefaultColumnFamilyName, options);
-    return families;
-  };
+std::vector<rocksdb::ColumnFamilyDescriptor> columnFamilies(
+    const EdenConfig& config,
+    KeySpaceBlockCaches* blockCaches = nullptr) {
+  // Each group of key spaces shares its own block cache, so that streaming
+  // large blobs through the cache does not evict the small, hot metadata
+  // blocks.  The blob cache is small; the assumption is that the vfs cache
+  // will compensate for that, together with the idea that we shouldn't need
+  // to materialize a great many files.
+  std::array<rocksdb::ColumnFamilyOptions, kColumnGroupCount> groupOptions;
+  std::array<std::shared_ptr<rocksdb::Cache>, kColumnGroupCount> groupCaches;
+  for (size_t i = 0; i < kColumnGroupCount; ++i) {
+    auto profile = getColumnProfile(config, static_cast<ColumnGroup>(i));
+    groupCaches[i] = rocksdb::NewLRUCache(profile.blockCacheSize);
+    groupOptions[i] = makeColumnOptions(profile, groupCaches[i]);
+  }
+  auto compression = getKeySpaceCompression();
 
-  // Meyers singleton to avoid SIOF issues
-  static const std::vector<rocksdb::ColumnFamilyDescriptor> families =
-      makeColumnFamilyDescriptors();
+  std::vector<rocksdb::ColumnFamilyDescriptor> families;
+  for (auto& ks : KeySpace::kAll) {
+    auto group = static_cast<size_t>(getColumnGroup(ks));
+    if (blockCaches) {
+      (*blockCaches)[ks->index] = groupCaches[group];
+    }
+    auto familyOptions = groupOptions[group];
+    if (auto type = compression[ks->index]) {
+      setCompression(familyOptions, *type);
+    }
+    families.emplace_back(ks->name.str(), familyOptions);
+  }
+  // Put the default column family last.
+  // This way the KeySpace enum values can be used directly as indexes
+  // into our column family vectors.
+  families.emplace_back(
+      rocksdb::kDefaultColumnFamilyName,
+      groupOptions[static_cast<size_t>(ColumnGroup::Metadata)]);
   return families;
 }
 
@@ -110,6 +314,45 @@ rocksdb::Slice _createSlice(folly::ByteRange bytes) {
   return Slice(reinterpret_cast<const char*>(bytes.data()), bytes.size());
 }
 
+/**
+ * Values at least this large are handed out without copying them, keeping the
+ * block that holds them pinned in the block cache for as long as the
+ * StoreResult or any IOBuf made from it lives.  Smaller values are cheaper to
+ * copy than to keep their whole block pinned.
+ */
+constexpr size_t kMinPinnedValueSize = 4096;
+
+/**
+ * A value read from RocksDB without copying it.  A pinned value releases its
+ * block cache entry when it is destroyed, which may be after the DB has been
+ * closed, so it holds a reference to the cache too.
+ */
+struct PinnedValue {
+  std::shared_ptr<rocksdb::Cache> blockCache;
+  rocksdb::PinnableSlice slice;
+};
+
+StoreResult makeStoreResult(
+    rocksdb::PinnableSlice&& value,
+    const std::shared_ptr<rocksdb::Cache>& blockCache) {
+  if (value.size() < kMinPinnedValueSize) {
+    return StoreResult(value.ToString());
+  }
+  auto pinned = std::make_unique<PinnedValue>();
+  pinned->blockCache = blockCache;
+  pinned->slice = std::move(value);
+  auto data = const_cast<char*>(pinned->slice.data());
+  auto size = pinned->slice.size();
+  return StoreResult(folly::IOBuf(
+      folly::IOBuf::TAKE_OWNERSHIP,
+      data,
+      size,
+      [](void* /* buf */, void* userData) {
+        delete static_cast<PinnedValue*>(userData);
+      },
+      pinned.release()));
+}
+
 class RocksDbWriteBatch : public LocalStore::WriteBatch {
  public:
   void put(KeySpace keySpace, folly::ByteRange key, folly::ByteRange value)
@@ -123,11 +366,14 @@ class RocksDbWriteBatch : public LocalStore::WriteBatch {
   // Use LocalStore::beginWrite() to create a write batch
   RocksDbWriteBatch(
       Synchronized<RocksHandles>::ConstRLockedPtr&& dbHandles,
+      const KeyAccessTrackers& accessTrackers,
       size_t bufferSize);
 
   void flushIfNeeded();
+  void recordAccess(KeySpace keySpace, folly::ByteRange key);
 
   folly::Synchronized<RocksHandles>::ConstRLockedPtr lockedDB_;
+  const KeyAccessTrackers& accessTrackers_;
   rocksdb::WriteBatch writeBatch_;
   size_t bufSize_;
 };
@@ -162,9 +408,11 @@ void RocksDbWriteBatch::flushIfNeeded() {
 
 RocksDbWriteBatch::RocksDbWriteBatch(
     Synchronized<RocksHandles>::ConstRLockedPtr&& dbHandles,
+    const KeyAccessTrackers& accessTrackers,
     size_t bufSize)
     : LocalStore::WriteBatch(),
       lockedDB_(std::move(dbHandles)),
+      accessTrackers_(accessTrackers),
       writeBatch_(bufSize),
       bufSize_(bufSize) {}
 
@@ -175,10 +423,17 @@ RocksDbWriteBatch::~RocksDbWriteBatch() {
   }
 }
 
+void RocksDbWriteBatch::recordAccess(KeySpace keySpace, folly::ByteRange key) {
+  if (auto* tracker = accessTrackers_[keySpace->index].get()) {
+    tracker->recordAccess(key);
+  }
+}
+
 void RocksDbWriteBatch::put(
     KeySpace keySpace,
     folly::ByteRange key,
     folly::ByteRange value) {
+  recordAccess(keySpace, key);
   writeBatch_.Put(
       lockedDB_->columns[keySpace->index].get(),
       _createSlice(key),
@@ -197,6 +452,7 @@ void RocksDbWriteBatch::put(
     slices.emplace_back(_createSlice(valueSlice));
   }
 
+  recordAccess(keySpace, key);
   auto keySlice = _createSlice(key);
   SliceParts keyParts(&keySlice, 1);
   writeBatch_.Put(
@@ -217,13 +473,28 @@ rocksdb::Options getRocksdbOptions() {
   // Automatically create column families as we define new ones.
   options.create_missing_column_families = true;
 
+  if (isCompressionConfigured()) {
+    // Collect the decompression times that computeStats() publishes.  Timing
+    // them requires the detailed timers.
+    options.statistics = rocksdb::CreateDBStatistics();
+    options.statistics->set_stats_level(rocksdb::kExceptTimeForMutex);
+  }
+
   return options;
 }
 
-RocksHandles openDB(AbsolutePathPiece path, RocksDBOpenMode mode) {
+RocksHandles openDB(
+    AbsolutePathPiece path,
+    RocksDBOpenMode mode,
+    const EdenConfig& config,
+    KeySpaceBlockCaches* blockCaches) {
   auto options = getRocksdbOptions();
   try {
-    return RocksHandles(path.stringPiece(), mode, options, columnFamilies());
+    return RocksHandles(
+        path.stringPiece(),
+        mode,
+        options,
+        columnFamilies(config, blockCaches));
   } catch (const RocksException& ex) {
     XLOG(ERR) << "Error opening RocksDB storage at " << path << ": "
               << ex.what();
@@ -234,10 +505,11 @@ RocksHandles openDB(AbsolutePathPiece path, RocksDBOpenMode mode) {
     // Fall through and attempt to repair the DB
   }
 
-  RocksDbLocalStore::repairDB(path);
+  RocksDbLocalStore::repairDB(path, config);
 
   // Now try opening the DB again.
-  return RocksHandles(path.stringPiece(), mode, options, columnFamilies());
+  return RocksHandles(
+      path.stringPiece(), mode, options, columnFamilies(config, blockCaches));
 }
 
 } // namespace
@@ -249,11 +521,22 @@ RocksDbLocalStore::RocksDbLocalStore(
     AbsolutePathPiece pathToRocksDb,
     std::shared_ptr<StructuredLogger> structuredLogger,
     FaultInjector* faultInjector,
+    const EdenConfig& config,
     RocksDBOpenMode mode)
     : structuredLogger_{std::move(structuredLogger)},
       faultInjector_(*faultInjector),
       ioPool_(12, "RocksLocalStore"),
-      dbHandles_(folly::in_place, openDB(pathToRocksDb, mode)) {
+      dbHandles_(
+          folly::in_place,
+          openDB(pathToRocksDb, mode, config, &blockCaches_)) {
+  if (config.localStoreAccessAwareEviction.getValue()) {
+    for (const auto& ks : KeySpace::kAll) {
+      if (std::holds_alternative<Ephemeral>(ks->persistence)) {
+        accessTrackers_[ks->index] =
+            std::make_unique<KeyAccessTracker>(kAccessTrackerBuckets);
+      }
+    }
+  }
   // Publish fb303 stats once when we first open the DB.
   // These will be kept up-to-date later by the periodicManagementTask() call.
   computeStats(/*publish=*/true, /*config=*/nullptr);
@@ -272,13 +555,15 @@ void RocksDbLocalStore::close() {
   handles->close();
 }
 
-void RocksDbLocalStore::repairDB(AbsolutePathPiece path) {
+void RocksDbLocalStore::repairDB(
+    AbsolutePathPiece path,
+    const EdenConfig& config) {
   XLOG(ERR) << "Attempting to repair RocksDB " << path;
   rocksdb::ColumnFamilyOptions unknownColumFamilyOptions;
   unknownColumFamilyOptions.OptimizeForPointLookup(8);
   unknownColumFamilyOptions.OptimizeLevelStyleCompaction();
 
-  const auto& columnDescriptors = columnFamilies();
+  const auto columnDescriptors = columnFamilies(config);
 
   auto dbPathStr = path.stringPiece().str();
   rocksdb::DBOptions dbOptions(getRocksdbOptions());
@@ -346,7 +631,8 @@ void RocksDbLocalStore::compactKeySpace(KeySpace keySpace) {
 
 StoreResult RocksDbLocalStore::get(KeySpace keySpace, ByteRange key) const {
   auto handles = getHandles();
-  string value;
+  recordAccess(keySpace, key);
+  rocksdb::PinnableSlice value;
   auto status = handles->db->Get(
       ReadOptions(),
       handles->columns[keySpace->index].get(),
@@ -366,7 +652,7 @@ StoreResult RocksDbLocalStore::get(KeySpace keySpace, ByteRange key) const {
     throw RocksException::build(
         status, "failed to get ", folly::hexlify(key), " from local store");
   }
-  return StoreResult(std::move(value));
+  return makeStoreResult(std::move(value), blockCaches_[keySpace->index]);
 }
 
 FOLLY_NODISCARD folly::Future<StoreResult> RocksDbLocalStore::getFuture(
@@ -417,17 +703,25 @@ RocksDbLocalStore::getBatch(
                         keys = std::move(batch)](folly::Unit&&) {
               XLOG(DBG3) << __func__ << " starting to actually do work";
               auto handles = store->getHandles();
-              std::vector<Slice> keySlices;
-              std::vector<std::string> values;
-              std::vector<rocksdb::ColumnFamilyHandle*> columns;
-              for (auto& key : *keys) {
-                keySlices.emplace_back(key);
-                columns.emplace_back(handles->columns[keySpace->index].get());
+              for (const auto& key : *keys) {
+                store->recordAccess(keySpace, folly::StringPiece{key});
               }
-              auto statuses = handles->db->MultiGet(
-                  ReadOptions(), columns, keySlices, &values);
+              std::vector<Slice> keySlices(keys->begin(), keys->end());
+              std::vector<rocksdb::PinnableSlice> values(keys->size());
+              std::vector<rocksdb::Status> statuses(keys->size());
+              // The single column family overload of MultiGet looks up the
+              // whole batch together, sharing the memtable and SST lookups
+              // that the per-key column family overload repeats for each key.
+              handles->db->MultiGet(
+                  ReadOptions(),
+                  handles->columns[keySpace->index].get(),
+                  keys->size(),
+                  keySlices.data(),
+                  values.data(),
+                  statuses.data());
 
               std::vector<StoreResult> results;
+              results.reserve(keys->size());
               for (size_t i = 0; i < keys->size(); ++i) {
                 auto& status = statuses[i];
                 if (!status.ok()) {
@@ -450,7 +744,9 @@ RocksDbLocalStore::getBatch(
                       folly::hexlify(keys->at(i)),
                       " from local store");
                 }
-                results.emplace_back(std::move(values[i]));
+                results.push_back(makeStoreResult(
+                    std::move(values[i]),
+                    store->blockCaches_[keySpace->index]));
               }
               return results;
             }));
@@ -472,6 +768,7 @@ RocksDbLocalStore::getBatch(
 bool RocksDbLocalStore::hasKey(KeySpace keySpace, folly::ByteRange key) const {
   string value;
   auto handles = getHandles();
+  recordAccess(keySpace, key);
   auto status = handles->db->Get(
       ReadOptions(),
       handles->columns[keySpace->index].get(),
@@ -495,7 +792,8 @@ bool RocksDbLocalStore::hasKey(KeySpace keySpace, folly::ByteRange key) const {
 
 std::unique_ptr<LocalStore::WriteBatch> RocksDbLocalStore::beginWrite(
     size_t bufSize) {
-  return std::make_unique<RocksDbWriteBatch>(getHandles(), bufSize);
+  return std::make_unique<RocksDbWriteBatch>(
+      getHandles(), accessTrackers_, bufSize);
 }
 
 void RocksDbLocalStore::put(
@@ -503,6 +801,7 @@ void RocksDbLocalStore::put(
     folly::ByteRange key,
     folly::ByteRange value) {
   auto handles = getHandles();
+  recordAccess(keySpace, key);
   handles->db->Put(
       WriteOptions(),
       handles->columns[keySpace->index].get(),
@@ -559,6 +858,12 @@ void RocksDbLocalStore::periodicManagementTask(const EdenConfig& config) {
   enableBlobCaching.store(
       config.enableBlobCaching.getValue(), std::memory_order_relaxed);
 
+  for (auto& tracker : accessTrackers_) {
+    if (tracker) {
+      tracker->advance();
+    }
+  }
+
   // Compute and publish the stats
   auto before = computeStats(/*publish=*/true, &config);
 
@@ -578,7 +883,7 @@ void RocksDbLocalStore::periodicManagementTask(const EdenConfig& config) {
                << "ephemeral data sizes of columns " << keySpaceNames
                << " exceed their limits; total ephemeral size = "
                << before.ephemeral;
-    triggerAutoGC(before);
+    triggerAutoGC(before, config);
   }
 }
 
@@ -588,6 +893,7 @@ RocksDbLocalStore::SizeSummary RocksDbLocalStore::computeStats(
   SizeSummary result;
   for (const auto& ks : KeySpace::kAll) {
     auto size = getApproximateSize(ks);
+    result.sizes[ks->index] = size;
     if (publish) {
       fb303::fbData->setCounter(
           folly::to<string>(statsPrefix_, ks->name, ".size"), size);
@@ -611,11 +917,141 @@ RocksDbLocalStore::SizeSummary RocksDbLocalStore::computeStats(
     fb303::fbData->setCounter(
         folly::to<string>(statsPrefix_, "persistent.total_size"),
         result.persistent);
+    publishCompressionStats();
   }
 
   return result;
 }
 
+void RocksDbLocalStore::publishCompressionStats() {
+  auto handles = getHandles();
+  auto compression = getKeySpaceCompression();
+  for (const auto& ks : KeySpace::kAll) {
+    if (!compression[ks->index]) {
+      continue;
+    }
+
+    rocksdb::TablePropertiesCollection tables;
+    auto status = handles->db->GetPropertiesOfAllTables(
+        handles->columns[ks->index].get(), &tables);
+    if (!status.ok()) {
+      XLOG(WARN) << "unable to retrieve SST table properties from RocksDB for "
+                 << "key space " << ks->name << ": " << status.ToString();
+      continue;
+    }
+    uint64_t rawSize = 0;
+    uint64_t storedSize = 0;
+    for (const auto& table : tables) {
+      rawSize += table.second->raw_key_size + table.second->raw_value_size;
+      storedSize += table.second->data_size;
+    }
+    if (storedSize > 0) {
+      // Counters are integers, so publish the ratio as a percentage.
+      fb303::fbData->setCounter(
+          folly::to<string>(statsPrefix_, ks->name, ".compression_ratio_pct"),
+          rawSize * 100 / storedSize);
+    }
+  }
+
+  auto statistics = handles->db->GetDBOptions().statistics;
+  if (statistics) {
+    rocksdb::HistogramData decompression;
+    statistics->histogramData(
+        rocksdb::DECOMPRESSION_TIMES_NANOS, &decompression);
+    fb303::fbData->setCounter(
+        folly::to<string>(statsPrefix_, "decompression_time_ns.avg"),
+        decompression.average);
+    fb303::fbData->setCounter(
+        folly::to<string>(statsPrefix_, "decompression_time_ns.p99"),
+        decompression.percentile99);
+  }
+}
+
+uint64_t RocksDbLocalStore::evictColdKeys(
+    KeySpace keySpace,
+    uint64_t size,
+    uint64_t targetSize) {
+  if (size <= targetSize) {
+    return 0;
+  }
+  auto& tracker = *accessTrackers_[keySpace->index];
+  auto handles = getHandles();
+  auto columnFamily = handles->columns[keySpace->index].get();
+
+  // Scanning the whole column family should not push hot blocks out of the
+  // block cache.
+  ReadOptions readOptions;
+  readOptions.fill_cache = false;
+  std::unique_ptr<rocksdb::Iterator> it{
+      handles->db->NewIterator(readOptions, columnFamily)};
+  auto checkScan = [&] {
+    if (!it->status().ok()) {
+      throw RocksException::build(
+          it->status(),
+          "error scanning \"",
+          columnFamily->GetName(),
+          "\" column family");
+    }
+  };
+
+  // The tracker's buckets say nothing about how many keys share them, so
+  // pick the cutoff from the ages of the keys that are actually present.
+  KeyAgeHistogram histogram;
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    auto key = it->key();
+    histogram.add(
+        tracker.getAge(folly::StringPiece{key.data(), key.size()}),
+        key.size() + it->value().size());
+  }
+  checkScan();
+  auto minAge = histogram.getEvictionAge(
+      1.0 - static_cast<double>(targetSize) / static_cast<double>(size));
+  XLOG(DBG2) << "evicting keys unused for " << minAge
+             << " intervals from column family \"" << columnFamily->GetName()
+             << "\"";
+
+  rocksdb::WriteBatch batch;
+  auto flush = [&] {
+    auto status = handles->db->Write(WriteOptions(), &batch);
+    if (!status.ok()) {
+      throw RocksException::build(
+          status,
+          "error evicting keys from \"",
+          columnFamily->GetName(),
+          "\" column family");
+    }
+    batch.Clear();
+  };
+
+  uint64_t evictedBytes = 0;
+  uint64_t evictedKeys = 0;
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    auto key = it->key();
+    if (tracker.getAge(folly::StringPiece{key.data(), key.size()}) < minAge) {
+      continue;
+    }
+    evictedBytes += key.size() + it->value().size();
+    ++evictedKeys;
+    batch.Delete(columnFamily, key);
+    if (batch.GetDataSize() >= kEvictionBatchSize) {
+      flush();
+    }
+  }
+  checkScan();
+  flush();
+
+  XLOG(INFO) << "evicted " << evictedKeys << " keys (" << evictedBytes
+             << " bytes) from column family \"" << columnFamily->GetName()
+             << "\"";
+  fb303::fbData->incrementCounter(
+      folly::to<string>(statsPrefix_, keySpace->name, ".evicted_bytes"),
+      evictedBytes);
+  fb303::fbData->incrementCounter(
+      folly::to<string>(statsPrefix_, keySpace->name, ".evicted_keys"),
+      evictedKeys);
+  return evictedBytes;
+}
+
 // In the future it would perhaps be nicer to move the triggerAutoGC()
 // logic up into the LocalStore base class.  However, for now it is more
 // convenient to be able to use RocksDbLocalStore's ioPool_ to schedule the
@@ -623,7 +1059,17 @@ RocksDbLocalStore::SizeSummary RocksDbLocalStore::computeStats(
 // code, but the gc operation can take a significant amount of time, and it
 // seems unfortunate to tie up one of the main pool threads for potentially
 // multiple minutes.
-void RocksDbLocalStore::triggerAutoGC(SizeSummary before) {
+void RocksDbLocalStore::triggerAutoGC(
+    SizeSummary before,
+    const EdenConfig& config) {
+  std::array<uint64_t, KeySpace::kTotalCount> targetSizes{};
+  for (const auto& ks : KeySpace::kAll) {
+    if (auto* ephemeral = std::get_if<Ephemeral>(&ks->persistence)) {
+      targetSizes[ks->index] = (config.*(ephemeral->cacheLimit)).getValue() *
+          config.localStoreEvictionTargetPercent.getValue() / 100;
+    }
+  }
+
   {
     auto state = autoGCState_.wlock();
     if (state->inProgress_) {
@@ -642,11 +1088,16 @@ void RocksDbLocalStore::triggerAutoGC(SizeSummary before) {
     state->inProgress_ = true;
   }
 
-  ioPool_.add([store = getSharedFromThis(), before] {
+  ioPool_.add([store = getSharedFromThis(), before, targetSizes] {
     try {
       for (auto& ks : KeySpace::kAll) {
         if (before.excessiveKeySpaces.test(ks->index)) {
-          store->clearKeySpace(ks);
+          if (store->accessTrackers_[ks->index]) {
+            store->evictColdKeys(
+                ks, before.sizes[ks->index], targetSizes[ks->index]);
+          } else {
+            store->clearKeySpace(ks);
+          }
           store->compactKeySpace(ks);
         }
       }
@@ -9,18 +9,38 @@
 
 #include <folly/CppAttributes.h>
 #include <folly/Synchronized.h>
+#include <array>
 #include <bitset>
 
 #include "eden/fs/rocksdb/RocksHandles.h"
+#include "eden/fs/store/KeyAccessTracker.h"
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/utils/UnboundedQueueExecutor.h"
 
+namespace rocksdb {
+class Cache;
+} // namespace rocksdb
+
 namespace facebook {
 namespace eden {
 
 class FaultInjector;
 class StructuredLogger;
 
+/**
+ * The access trackers of each key space, indexed like KeySpace::kAll.  Only
+ * ephemeral key spaces have one, and only with store:access-aware-eviction.
+ */
+using KeyAccessTrackers =
+    std::array<std::unique_ptr<KeyAccessTracker>, KeySpace::kTotalCount>;
+
+/**
+ * The block cache of each key space, indexed like KeySpace::kAll.  Key spaces
+ * in the same column group share a cache.
+ */
+using KeySpaceBlockCaches =
+    std::array<std::shared_ptr<rocksdb::Cache>, KeySpace::kTotalCount>;
+
 /** An implementation of LocalStore that uses RocksDB for the underlying
  * storage.
  */
@@ -28,12 +48,14 @@ class RocksDbLocalStore : public LocalStore {
  public:
   /**
    * The given FaultInjector must be valid during the lifetime of this
-   * RocksDbLocalStore object.
+   * RocksDbLocalStore object.  The column families are tuned according to
+   * the rocksdb: settings of config when the DB is opened.
    */
   explicit RocksDbLocalStore(
       AbsolutePathPiece pathToRocksDb,
       std::shared_ptr<StructuredLogger> structuredLogger,
       FaultInjector* FOLLY_NONNULL faultInjector,
+      const EdenConfig& config,
       RocksDBOpenMode mode = RocksDBOpenMode::ReadWrite);
   ~RocksDbLocalStore();
   void close() override;
@@ -52,7 +74,7 @@ class RocksDbLocalStore : public LocalStore {
   std::unique_ptr<WriteBatch> beginWrite(size_t bufSize = 0) override;
 
   // Call RocksDB's RepairDB() function on the DB at the specified location
-  static void repairDB(AbsolutePathPiece path);
+  static void repairDB(AbsolutePathPiece path, const EdenConfig& config);
 
   // Get the approximate number of bytes stored on disk for the
   // specified key space.
@@ -104,6 +126,10 @@ class RocksDbLocalStore : public LocalStore {
      * cleared.
      */
     std::bitset<KeySpace::kTotalCount> excessiveKeySpaces;
+    /**
+     * The approximate size of each key space, indexed like KeySpace::kAll.
+     */
+    std::array<uint64_t, KeySpace::kTotalCount> sizes{};
   };
 
   /**
@@ -112,7 +138,26 @@ class RocksDbLocalStore : public LocalStore {
    */
   SizeSummary computeStats(bool publish, const EdenConfig* config);
 
-  void triggerAutoGC(SizeSummary before);
+  /**
+   * Publish the compression ratio of each key space configured with
+   * --localStoreCompression, and the block decompression times.
+   */
+  void publishCompressionStats();
+
+  void recordAccess(KeySpace keySpace, folly::ByteRange key) const {
+    if (auto* tracker = accessTrackers_[keySpace->index].get()) {
+      tracker->recordAccess(key);
+    }
+  }
+
+  /**
+   * Deletes the least recently used keys of the key space, which must have
+   * an access tracker, aiming to shrink it from size to targetSize bytes.
+   * Returns the number of bytes of keys and values deleted.
+   */
+  uint64_t evictColdKeys(KeySpace keySpace, uint64_t size, uint64_t targetSize);
+
+  void triggerAutoGC(SizeSummary before, const EdenConfig& config);
   void autoGCFinished(bool successful, uint64_t ephemeralSizeBefore);
 
   std::shared_ptr<StructuredLogger> structuredLogger_;
@@ -120,6 +165,12 @@ class RocksDbLocalStore : public LocalStore {
   FaultInjector& faultInjector_;
   mutable UnboundedQueueExecutor ioPool_;
   folly::Synchronized<AutoGCState> autoGCState_;
+  KeyAccessTrackers accessTrackers_;
+  /**
+   * Values handed out without copying them may keep entries of these caches
+   * pinned, so they hold a reference to them that outlives dbHandles_.
+   */
+  KeySpaceBlockCaches blockCaches_;
   folly::Synchronized<RocksHandles> dbHandles_;
 };
 
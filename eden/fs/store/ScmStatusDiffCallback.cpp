@@ -8,6 +8,7 @@
 #include "eden/fs/store/ScmStatusDiffCallback.h"
 #include <folly/Synchronized.h>
 #include <folly/futures/Future.h>
+#include <folly/hash/Hash.h>
 #include <folly/logging/xlog.h>
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/model/TreeEntry.h"
@@ -16,23 +17,31 @@
 
 namespace facebook {
 namespace eden {
+
+folly::Synchronized<ScmStatus>& ScmStatusDiffCallback::getShard(
+    RelativePathPiece path) {
+  auto piece = path.stringPiece();
+  auto hash = folly::hash::fnv64_buf(piece.data(), piece.size());
+  return shards_[hash % kNumShards];
+}
+
 void ScmStatusDiffCallback::ignoredFile(RelativePathPiece path) {
-  data_.wlock()->entries.emplace(
+  getShard(path).wlock()->entries.emplace(
       path.stringPiece().str(), ScmFileStatus::IGNORED);
 }
 
 void ScmStatusDiffCallback::addedFile(RelativePathPiece path) {
-  data_.wlock()->entries.emplace(
+  getShard(path).wlock()->entries.emplace(
       path.stringPiece().str(), ScmFileStatus::ADDED);
 }
 
 void ScmStatusDiffCallback::removedFile(RelativePathPiece path) {
-  data_.wlock()->entries.emplace(
+  getShard(path).wlock()->entries.emplace(
       path.stringPiece().str(), ScmFileStatus::REMOVED);
 }
 
 void ScmStatusDiffCallback::modifiedFile(RelativePathPiece path) {
-  data_.wlock()->entries.emplace(
+  getShard(path).wlock()->entries.emplace(
       path.stringPiece().str(), ScmFileStatus::MODIFIED);
 }
 
@@ -41,7 +50,7 @@ void ScmStatusDiffCallback::diffError(
     const folly::exception_wrapper& ew) {
   XLOG(WARNING) << "error computing status data for " << path << ": "
                 << folly::exceptionStr(ew);
-  data_.wlock()->errors.emplace(
+  getShard(path).wlock()->errors.emplace(
       path.stringPiece().str(), folly::exceptionStr(ew).toStdString());
 }
 
@@ -53,8 +62,14 @@ void ScmStatusDiffCallback::diffError(
  * the diff operation has completed.
  */
 ScmStatus ScmStatusDiffCallback::extractStatus() {
-  auto data = data_.wlock();
-  return std::move(*data);
+  ScmStatus status;
+  for (auto& shard : shards_) {
+    auto data = shard.wlock();
+    status.entries.merge(data->entries);
+    status.errors.merge(data->errors);
+    *data = ScmStatus{};
+  }
+  return status;
 }
 
 char scmStatusCodeChar(ScmFileStatus code) {
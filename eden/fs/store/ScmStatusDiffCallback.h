@@ -6,6 +6,7 @@
  */
 
 #pragma once
+#include <array>
 #include <iosfwd>
 
 #include <folly/Synchronized.h>
@@ -43,7 +44,16 @@ class ScmStatusDiffCallback : public DiffCallback {
   ScmStatus extractStatus();
 
  private:
-  folly::Synchronized<ScmStatus> data_;
+  /**
+   * Results are spread across shards by path so that subtrees diffed on
+   * different threads rarely contend on the same lock.  A given path always
+   * lands in the same shard.
+   */
+  static constexpr size_t kNumShards = 16;
+
+  folly::Synchronized<ScmStatus>& getShard(RelativePathPiece path);
+
+  std::array<folly::Synchronized<ScmStatus>, kNumShards> shards_;
 };
 
 /**
@@ -7,9 +7,11 @@
 
 #include "eden/fs/store/SqliteLocalStore.h"
 
+#include <folly/ScopeGuard.h>
 #include <folly/String.h>
 #include <folly/container/Array.h>
 #include <folly/logging/xlog.h>
+#include <algorithm>
 
 #include "eden/fs/sqlite/Sqlite.h"
 #include "eden/fs/store/StoreResult.h"
@@ -22,27 +24,118 @@ using folly::StringPiece;
 using std::string;
 
 namespace {
+using LockedDbPtr = folly::Synchronized<sqlite3*>::LockedPtr;
+
+// How long a read waits for the rare locks that WAL mode still takes, such
+// as while recovering the write-ahead log.
+constexpr folly::StringPiece kReadBusyTimeoutMs = "1000";
+
+/**
+ * One prepared statement per key space, indexed like KeySpace::kAll.
+ */
+using KeySpaceStatements = std::vector<std::unique_ptr<SqliteStatement>>;
+
+KeySpaceStatements prepareLookups(LockedDbPtr& db, StringPiece select) {
+  KeySpaceStatements statements;
+  for (const auto& ks : KeySpace::kAll) {
+    statements.push_back(std::make_unique<SqliteStatement>(
+        db, select, " from ", ks->name, " where key = ?"));
+  }
+  return statements;
+}
+
+[[noreturn]] void throwStoreClosedError() {
+  throw std::runtime_error("the SQLite local store is already closed");
+}
+} // namespace
+
+struct SqliteLocalStore::ReadStatements {
+  explicit ReadStatements(LockedDbPtr& db)
+      : get{prepareLookups(db, "select value")},
+        has{prepareLookups(db, "select 1")} {}
+
+  KeySpaceStatements get;
+  KeySpaceStatements has;
+};
+
+struct SqliteLocalStore::WriteStatements {
+  explicit WriteStatements(LockedDbPtr& db)
+      : begin{db, "BEGIN"}, commit{db, "COMMIT"}, rollback{db, "ROLLBACK"} {
+    for (const auto& ks : KeySpace::kAll) {
+      // TODO: we need `or ignore` otherwise we hit primary key violations
+      // when running our integration tests.  This implies that we're
+      // over-fetching and that we have a perf improvement opportunity.
+      insert.push_back(std::make_unique<SqliteStatement>(
+          db, "insert or ignore into ", ks->name, " VALUES(?, ?)"));
+    }
+  }
+
+  KeySpaceStatements insert;
+  SqliteStatement begin;
+  SqliteStatement commit;
+  SqliteStatement rollback;
+};
+
+struct SqliteLocalStore::ReadConnection {
+  ReadConnection(AbsolutePathPiece path, const SqliteOptions& options)
+      : db{path, options} {
+    auto locked = db.lock();
+    SqliteStatement(locked, "PRAGMA query_only=ON").step();
+    SqliteStatement(locked, "PRAGMA busy_timeout=", kReadBusyTimeoutMs)
+        .step();
+    statements = std::make_unique<ReadStatements>(locked);
+  }
+
+  void close() {
+    {
+      // Prepared statements must be finalized before the database can be
+      // closed.
+      auto locked = db.lock();
+      statements.reset();
+    }
+    db.close();
+  }
+
+  SqliteDatabase db;
+  std::unique_ptr<ReadStatements> statements;
+};
+
+namespace {
+
+void insert(SqliteStatement& stmt, ByteRange key, ByteRange value) {
+  SCOPE_EXIT {
+    stmt.reset();
+  };
+  stmt.bind(1, key);
+  stmt.bind(2, value);
+  stmt.step();
+}
 
 /**
  * Implements the write batching helper.
- * In an ideal world, we'd just start a transaction and have the WriteBatch
- * methods accumulate against that transaction, committing on flush.
- * To do that we'd either need to lock the underlying sqlite handle
- * for the lifetime of the WriteBatch, or open a separate database connection.
- * The latter might be interesting to explore if the cost of opening the
- * connection is cheap enough.
- * For now though, we batch up the incoming data and then send it to the
- * database in the flush method.
+ * The incoming data is buffered, and then sent to the database in a single
+ * transaction by the flush method, so that the write-ahead log is only
+ * synced once per batch rather than once per object.  If a buffer size is
+ * given, the batch flushes itself whenever that much data is pending, so
+ * that large imports commit in bounded chunks.
  */
 class SqliteWriteBatch : public LocalStore::WriteBatch {
  public:
-  explicit SqliteWriteBatch(SqliteDatabase& db) : db_(db) {
+  SqliteWriteBatch(
+      SqliteDatabase& db,
+      std::unique_ptr<SqliteLocalStore::WriteStatements>& statements,
+      size_t bufSize)
+      : db_(db), statements_(statements), bufSize_(bufSize) {
     buffer_.resize(KeySpace::kTotalCount);
   }
 
   void put(KeySpace keySpace, ByteRange key, ByteRange value) override {
     buffer_[keySpace->index].emplace_back(
         StringPiece(key).str(), StringPiece(value).str());
+    bufferedBytes_ += key.size() + value.size();
+    if (bufSize_ > 0 && bufferedBytes_ >= bufSize_) {
+      flush();
+    }
   }
 
   void put(KeySpace keySpace, ByteRange key, std::vector<ByteRange> valueSlices)
@@ -55,60 +148,70 @@ class SqliteWriteBatch : public LocalStore::WriteBatch {
   }
 
   void flush() override {
+    if (bufferedBytes_ == 0) {
+      return;
+    }
+
     auto db = db_.lock();
+    if (!statements_) {
+      throwStoreClosedError();
+    }
+    auto& statements = *statements_;
 
     // Start a transaction for the flush operation
-    SqliteStatement(db, "BEGIN").step();
+    statements.begin.step();
 
     try {
       for (size_t i = 0; i < buffer_.size(); ++i) {
-        auto& items = buffer_[i];
-        if (items.empty()) {
-          continue;
-        }
-
-        // See commentary in SqliteLocalStore::put re: `or ignore`
-        SqliteStatement stmt(
-            db,
-            "insert or ignore into ",
-            KeySpace::kAll[i]->name,
-            " VALUES(?, ?)");
-
-        for (const auto& item : items) {
-          const auto& key = item.first;
-          const auto& value = item.second;
-
-          stmt.bind(1, key);
-          stmt.bind(2, value);
-          stmt.step();
+        for (const auto& item : buffer_[i]) {
+          insert(
+              *statements.insert[i],
+              StringPiece{item.first},
+              StringPiece{item.second});
         }
-        items.clear();
       }
 
-      SqliteStatement(db, "COMMIT").step();
+      statements.commit.step();
     } catch (const std::exception&) {
       // Speculative rollback to make sure that we're not still in a
       // transaction if we bail out in the error path
-      SqliteStatement(db, "ROLLBACK").step();
+      statements.rollback.step();
       throw;
     }
+
+    for (auto& items : buffer_) {
+      items.clear();
+    }
+    bufferedBytes_ = 0;
   }
 
  private:
   std::vector<std::vector<std::pair<string, string>>> buffer_;
+  size_t bufferedBytes_{0};
   SqliteDatabase& db_;
+  // The store's statements, which are reset when it is closed.
+  std::unique_ptr<SqliteLocalStore::WriteStatements>& statements_;
+  const size_t bufSize_;
 };
 
 } // namespace
 
-SqliteLocalStore::SqliteLocalStore(AbsolutePathPiece pathToDb)
-    : db_(SqliteDatabase(pathToDb)) {
+SqliteLocalStore::SqliteLocalStore(
+    AbsolutePathPiece pathToDb,
+    const SqliteOptions& options,
+    size_t readConnectionCount)
+    : db_(SqliteDatabase(pathToDb, options)) {
   {
     auto db = db_.lock();
 
     // Write ahead log for faster perf
     // https://www.sqlite.org/wal.html
     SqliteStatement(db, "PRAGMA journal_mode=WAL").step();
+    // In WAL mode, NORMAL only syncs at checkpoints.  A crash of EdenFS
+    // itself loses nothing; a power failure may lose the most recently
+    // imported objects, which are fetched again, but never corrupts the
+    // database.
+    SqliteStatement(db, "PRAGMA synchronous=NORMAL").step();
 
     for (const auto& ks : KeySpace::kAll) {
       SqliteStatement(
@@ -122,29 +225,60 @@ SqliteLocalStore::SqliteLocalStore(AbsolutePathPiece pathToDb)
           ")")
           .step();
     }
+
+    writeStatements_ = std::make_unique<WriteStatements>(db);
+  }
+
+  // The read connections must be opened after the tables are created.
+  for (size_t i = 0; i < std::max(readConnectionCount, size_t{1}); ++i) {
+    readConnections_.push_back(
+        std::make_unique<ReadConnection>(pathToDb, options));
   }
 
   clearDeprecatedKeySpaces();
 }
 
+SqliteLocalStore::~SqliteLocalStore() {
+  close();
+}
+
 void SqliteLocalStore::close() {
+  for (auto& connection : readConnections_) {
+    connection->close();
+  }
+  {
+    // Prepared statements must be finalized before the database can be
+    // closed.
+    auto db = db_.lock();
+    writeStatements_.reset();
+  }
   db_.close();
 }
 
+SqliteLocalStore::ReadConnection& SqliteLocalStore::getReadConnection() const {
+  auto index = nextReadConnection_.fetch_add(1, std::memory_order_relaxed);
+  return *readConnections_[index % readConnections_.size()];
+}
+
 void SqliteLocalStore::clearKeySpace(KeySpace keySpace) {
   auto db = db_.lock();
 
-  SqliteStatement stmt(db, "delete from ", keySpace->name);
-  stmt.step();
+  db_.prepare(db, "delete from ", keySpace->name).step();
 }
 
 void SqliteLocalStore::compactKeySpace(KeySpace) {}
 
 StoreResult SqliteLocalStore::get(KeySpace keySpace, ByteRange key) const {
-  auto db = db_.lock();
+  auto& connection = getReadConnection();
+  auto db = connection.db.lock();
+  if (!connection.statements) {
+    throwStoreClosedError();
+  }
 
-  SqliteStatement stmt(
-      db, "select value from ", keySpace->name, " where key = ?");
+  auto& stmt = *connection.statements->get[keySpace->index];
+  SCOPE_EXIT {
+    stmt.reset();
+  };
 
   // Bind the key; parameters are 1-based
   stmt.bind(1, key);
@@ -159,9 +293,16 @@ StoreResult SqliteLocalStore::get(KeySpace keySpace, ByteRange key) const {
 }
 
 bool SqliteLocalStore::hasKey(KeySpace keySpace, ByteRange key) const {
-  auto db = db_.lock();
+  auto& connection = getReadConnection();
+  auto db = connection.db.lock();
+  if (!connection.statements) {
+    throwStoreClosedError();
+  }
 
-  SqliteStatement stmt(db, "select 1 from ", keySpace->name, " where key = ?");
+  auto& stmt = *connection.statements->has[keySpace->index];
+  SCOPE_EXIT {
+    stmt.reset();
+  };
 
   stmt.bind(1, key);
   return stmt.step();
@@ -169,23 +310,16 @@ bool SqliteLocalStore::hasKey(KeySpace keySpace, ByteRange key) const {
 
 void SqliteLocalStore::put(KeySpace keySpace, ByteRange key, ByteRange value) {
   auto db = db_.lock();
+  if (!writeStatements_) {
+    throwStoreClosedError();
+  }
 
-  SqliteStatement stmt(
-      db,
-      // TODO: we need `or ignore` otherwise we hit primary key violations
-      // when running our integration tests.  This implies that we're
-      // over-fetching and that we have a perf improvement opportunity.
-      "insert or ignore into ",
-      keySpace->name,
-      " VALUES(?, ?)");
-
-  stmt.bind(1, key);
-  stmt.bind(2, value);
-  stmt.step();
+  insert(*writeStatements_->insert[keySpace->index], key, value);
 }
 
-std::unique_ptr<LocalStore::WriteBatch> SqliteLocalStore::beginWrite(size_t) {
-  return std::make_unique<SqliteWriteBatch>(db_);
+std::unique_ptr<LocalStore::WriteBatch> SqliteLocalStore::beginWrite(
+    size_t bufSize) {
+  return std::make_unique<SqliteWriteBatch>(db_, writeStatements_, bufSize);
 }
 
 } // namespace eden
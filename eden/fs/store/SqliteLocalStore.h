@@ -7,6 +7,9 @@
 
 #pragma once
 #include <folly/Synchronized.h>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include "eden/fs/sqlite/Sqlite.h"
 #include "eden/fs/store/LocalStore.h"
 
@@ -16,10 +19,24 @@ namespace eden {
 /** An implementation of LocalStore that stores values in Sqlite.
  * SqliteLocalStore is thread safe, allowing reads and writes from
  * any thread.
+ *
+ * The database is in WAL mode, so writes go through a single connection
+ * while reads are spread across a small pool of read-only connections that
+ * do not wait for writes.  Each connection prepares its statements once, and
+ * they are only used while holding that connection's lock.
  * */
 class SqliteLocalStore : public LocalStore {
  public:
-  explicit SqliteLocalStore(AbsolutePathPiece pathToDb);
+  // WAL mode lets reads proceed while a write is in progress, so a handful of
+  // read connections is enough to keep prefetching and FUSE reads from
+  // queueing behind each other.
+  static constexpr size_t kDefaultReadConnectionCount = 4;
+
+  explicit SqliteLocalStore(
+      AbsolutePathPiece pathToDb,
+      const SqliteOptions& options = SqliteOptions{},
+      size_t readConnectionCount = kDefaultReadConnectionCount);
+  ~SqliteLocalStore();
   void close() override;
   void clearKeySpace(KeySpace keySpace) override;
   void compactKeySpace(KeySpace keySpace) override;
@@ -30,8 +47,22 @@ class SqliteLocalStore : public LocalStore {
   std::unique_ptr<LocalStore::WriteBatch> beginWrite(
       size_t bufSize = 0) override;
 
+  struct WriteStatements;
+
  private:
+  struct ReadStatements;
+  struct ReadConnection;
+
+  /**
+   * Picks one of the read connections, spreading concurrent readers across
+   * them.
+   */
+  ReadConnection& getReadConnection() const;
+
   mutable SqliteDatabase db_;
+  std::unique_ptr<WriteStatements> writeStatements_;
+  std::vector<std::unique_ptr<ReadConnection>> readConnections_;
+  mutable std::atomic<size_t> nextReadConnection_{0};
 };
 
 } // namespace eden
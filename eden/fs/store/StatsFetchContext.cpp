@@ -18,6 +18,8 @@ StatsFetchContext::StatsFetchContext(const StatsFetchContext& other) {
       counts_[y][x] = other.counts_[y][x].load();
     }
   }
+  importedBytes_ = other.importedBytes_.load();
+  importWaitNs_ = other.importWaitNs_.load();
 }
 
 void StatsFetchContext::didFetch(ObjectType type, const Hash&, Origin origin) {
@@ -28,6 +30,14 @@ void StatsFetchContext::didFetch(ObjectType type, const Hash&, Origin origin) {
   counts_[type][origin].fetch_add(1, std::memory_order_acq_rel);
 }
 
+void StatsFetchContext::didImport(
+    ObjectType,
+    uint64_t bytes,
+    std::chrono::nanoseconds wait) {
+  importedBytes_.fetch_add(bytes, std::memory_order_acq_rel);
+  importWaitNs_.fetch_add(wait.count(), std::memory_order_acq_rel);
+}
+
 uint64_t StatsFetchContext::countFetchesOfType(ObjectType type) const {
   XCHECK(type < ObjectFetchContext::kObjectTypeEnumMax)
       << "type is out of range: " << type;
@@ -47,6 +57,8 @@ void StatsFetchContext::merge(const StatsFetchContext& other) {
       counts_[type][origin] += other.counts_[type][origin];
     }
   }
+  importedBytes_ += other.importedBytes_;
+  importWaitNs_ += other.importWaitNs_;
 }
 
 uint64_t StatsFetchContext::countFetchesOfTypeAndOrigin(
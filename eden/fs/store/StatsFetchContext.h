@@ -43,12 +43,27 @@ class StatsFetchContext : public ObjectFetchContext {
   StatsFetchContext(const StatsFetchContext& other);
 
   void didFetch(ObjectType type, const Hash& id, Origin origin) override;
+  void didImport(
+      ObjectType type,
+      uint64_t bytes,
+      std::chrono::nanoseconds wait) override;
 
   uint64_t countFetchesOfType(ObjectType type) const;
   uint64_t countFetchesOfTypeAndOrigin(ObjectType type, Origin origin) const;
 
   FetchStatistics computeStatistics() const;
 
+  /** Total size of the blobs imported from the backing store. */
+  uint64_t getImportedBytes() const {
+    return importedBytes_.load(std::memory_order_acquire);
+  }
+
+  /** Total time spent waiting for imports from the backing store. */
+  std::chrono::nanoseconds getImportWait() const {
+    return std::chrono::nanoseconds{
+        importWaitNs_.load(std::memory_order_acquire)};
+  }
+
   /**
    * Sums the counts from another fetch context into this one.
    */
@@ -57,6 +72,8 @@ class StatsFetchContext : public ObjectFetchContext {
  private:
   std::atomic<uint64_t> counts_[ObjectFetchContext::kObjectTypeEnumMax]
                                [ObjectFetchContext::kOriginEnumMax] = {};
+  std::atomic<uint64_t> importedBytes_{0};
+  std::atomic<uint64_t> importWaitNs_{0};
 };
 
 } // namespace eden
@@ -28,6 +28,10 @@ IOBuf StoreResult::iobufWrapper() const {
 
 folly::IOBuf StoreResult::extractIOBuf() {
   ensureValid();
+  if (isBuf_) {
+    valid_ = false;
+    return std::move(buf_);
+  }
 
   // Unfortunately RocksDB returns data to us in a std::string.  This makes it
   // difficult for us to control the lifetime.  We end up having to allocate a
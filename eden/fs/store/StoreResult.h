@@ -8,27 +8,25 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/io/IOBuf.h>
 #include <string>
 
-namespace folly {
-class IOBuf;
-}
-
 namespace facebook {
 namespace eden {
 
 /*
  * StoreResult contains the result of a LocalStore lookup.
  *
- * RocksDB returns the data in a std::string (which is somewhat unfortunate,
- * since it gives us relatively poor memory management control).
+ * The data is held either in a std::string, or in an IOBuf that owns memory
+ * the store handed out without copying it (such as a RocksDB PinnableSlice
+ * pinning a block cache block).
  *
- * This class is a wrapper around the returned string, with a few benefits:
+ * This class is a wrapper around the returned data, with a few benefits:
  * - It can also represent a "not found" result, so we can efficiently handle
  *   key lookups that are not present, without throwing an exception.
  * - It is move-only, so prevents us from ever unintentionally copying the
- *   string data.
- * - It provides APIs for creating IOBuf objects around the string result.
+ *   data.
+ * - It provides APIs for creating IOBuf objects around the result.
  */
 class StoreResult {
  public:
@@ -43,6 +41,12 @@ class StoreResult {
   explicit StoreResult(std::string&& data)
       : valid_(true), data_(std::move(data)) {}
 
+  /**
+   * Construct a StoreResult from a managed IOBuf holding a single buffer.
+   */
+  explicit StoreResult(folly::IOBuf&& buf)
+      : valid_(true), isBuf_(true), buf_(std::move(buf)) {}
+
   StoreResult(StoreResult&&) = default;
   StoreResult& operator=(StoreResult&&) = default;
 
@@ -54,16 +58,6 @@ class StoreResult {
     return valid_;
   }
 
-  /**
-   * Get a reference to the std::string result.
-   *
-   * Throws std::domain_error if the key was not present in the store.
-   */
-  const std::string& asString() const {
-    ensureValid();
-    return data_;
-  }
-
   /**
    * Get a ByteRange pointing to the result.
    *
@@ -71,6 +65,9 @@ class StoreResult {
    */
   folly::ByteRange bytes() const {
     ensureValid();
+    if (isBuf_) {
+      return folly::ByteRange{buf_.data(), buf_.length()};
+    }
     return folly::StringPiece{data_};
   }
 
@@ -80,25 +77,29 @@ class StoreResult {
    * Throws std::domain_error if the key was not present in the store.
    */
   folly::StringPiece piece() const {
-    ensureValid();
-    return folly::StringPiece{data_};
+    return folly::StringPiece{bytes()};
   }
 
   /**
    * Return an IOBuf that temporarily wraps this StoreResult.
    *
-   * The IOBuf is unmanaged, and points to the string data contained in this
+   * The IOBuf is unmanaged, and points to the data contained in this
    * StoreResult.  It will be invalidated by any operation that invalidates the
    * StoreResult.
    */
   folly::IOBuf iobufWrapper() const;
 
   /**
-   * Extract the std::string contained in this StoreResult.
+   * Extract the data as a std::string.
+   *
+   * This copies the data if it is held in an IOBuf.
    */
   std::string extractValue() {
     ensureValid();
     valid_ = false;
+    if (isBuf_) {
+      return std::string{folly::StringPiece{buf_.data(), buf_.length()}};
+    }
     return std::move(data_);
   }
 
@@ -108,9 +109,9 @@ class StoreResult {
    * This will return a managed IOBuf, which will free the result data when
    * the last IOBuf clone is destroyed.
    *
-   * This does require a memory allocation to move the stored std::string onto
-   * the heap (but it just does a small allocation for the string object
-   * itself, and not the string data).
+   * If the data is held in a std::string, this does require a memory
+   * allocation to move it onto the heap (but it just does a small allocation
+   * for the string object itself, and not the string data).
    */
   folly::IOBuf extractIOBuf();
 
@@ -134,8 +135,12 @@ class StoreResult {
   // Whether or not the result is value
   // If the key was not found in the store, valid_ will be false.
   bool valid_{false};
+  // Whether the data is held in buf_ rather than data_
+  bool isBuf_{false};
   // The std::string containing the data
   std::string data_;
+  // The IOBuf containing the data
+  folly::IOBuf buf_;
 };
 } // namespace eden
 } // namespace facebook
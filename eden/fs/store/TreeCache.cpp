@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/TreeCache.h"
+
+#include <folly/logging/xlog.h>
+#include <vector>
+#include "eden/fs/model/Tree.h"
+
+namespace facebook {
+namespace eden {
+
+std::shared_ptr<TreeCache> TreeCache::create(
+    size_t maximumCacheSizeBytes,
+    size_t minimumEntryCount) {
+  return std::shared_ptr<TreeCache>{
+      new TreeCache{maximumCacheSizeBytes, minimumEntryCount}};
+}
+
+TreeCache::TreeCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount)
+    : maximumCacheSizeBytes_{maximumCacheSizeBytes},
+      minimumEntryCount_{minimumEntryCount} {}
+
+TreeCache::TreePtr TreeCache::get(const Hash& hash) {
+  auto state = state_.wlock();
+  auto iter = state->items.find(hash);
+  if (iter == state->items.end()) {
+    ++state->missCount;
+    return nullptr;
+  }
+  ++state->hitCount;
+  return iter->second.tree;
+}
+
+void TreeCache::insert(TreePtr tree) {
+  auto hash = tree->getHash();
+  auto size = tree->getSizeBytes();
+  XLOG(DBG6) << "TreeCache::insert " << hash;
+
+  // Destroy evicted trees after the lock is released.
+  std::vector<TreePtr> evicted;
+  {
+    auto state = state_.wlock();
+    auto iter = state->items.find(hash);
+    if (iter != state->items.end()) {
+      // Trees are immutable, so the cached one is as good as the new one.
+      return;
+    }
+    state->items.set(hash, CacheItem{std::move(tree), size});
+    state->totalSize += size;
+    evictUntilFits(*state, evicted);
+  }
+}
+
+bool TreeCache::contains(const Hash& hash) const {
+  return state_.rlock()->items.exists(hash);
+}
+
+void TreeCache::clear() {
+  XLOG(DBG6) << "TreeCache::clear";
+  folly::EvictingCacheMap<Hash, CacheItem> items{0};
+  {
+    auto state = state_.wlock();
+    state->totalSize = 0;
+    items.swap(state->items);
+  }
+}
+
+TreeCache::Stats TreeCache::getStats() const {
+  auto state = state_.rlock();
+  Stats stats;
+  stats.treeCount = state->items.size();
+  stats.totalSizeInBytes = state->totalSize;
+  stats.hitCount = state->hitCount;
+  stats.missCount = state->missCount;
+  stats.evictionCount = state->evictionCount;
+  return stats;
+}
+
+void TreeCache::evictUntilFits(
+    State& state,
+    std::vector<TreePtr>& evicted) noexcept {
+  while (state.totalSize > maximumCacheSizeBytes_ &&
+         state.items.size() > minimumEntryCount_) {
+    auto oldest = state.items.rbegin();
+    auto oldestHash = oldest->first;
+    state.totalSize -= oldest->second.size;
+    evicted.push_back(std::move(oldest->second.tree));
+    state.items.erase(oldestHash);
+    ++state.evictionCount;
+  }
+}
+
+} // namespace eden
+} // namespace facebook
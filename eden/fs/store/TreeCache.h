@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+class Tree;
+
+/**
+ * An in-memory LRU cache for deserialized trees, so that code walking trees
+ * that are not held by a loaded TreeInode (diff, glob, checkout) does not
+ * have to read and deserialize them from the LocalStore every time.
+ *
+ * Like BlobCache, it is parameterized by both a maximum cache size in bytes
+ * and a minimum entry count, and evicts the least recently used trees while
+ * the total exceeds the maximum size, except that it always keeps the minimum
+ * entry count around.  Trees are only referenced for the duration of a
+ * lookup, so there are no interest handles: every cached tree is kept until
+ * it is naturally evicted.
+ *
+ * It is safe to use this object from arbitrary threads.
+ */
+class TreeCache {
+ public:
+  using TreePtr = std::shared_ptr<const Tree>;
+
+  struct Stats {
+    size_t treeCount{0};
+    size_t totalSizeInBytes{0};
+    uint64_t hitCount{0};
+    uint64_t missCount{0};
+    uint64_t evictionCount{0};
+  };
+
+  static std::shared_ptr<TreeCache> create(
+      size_t maximumCacheSizeBytes,
+      size_t minimumEntryCount);
+
+  /**
+   * If a tree for the given hash is in cache, return it and move it to the
+   * back of the eviction queue.  Otherwise, return nullptr.
+   */
+  TreePtr get(const Hash& hash);
+
+  /**
+   * Inserts a tree into the cache for future lookup, evicting old entries if
+   * the new total size exceeds the maximum cache size and the minimum entry
+   * count.
+   */
+  void insert(TreePtr tree);
+
+  /**
+   * Returns true if the cache contains a tree for the given hash.
+   */
+  bool contains(const Hash& hash) const;
+
+  /**
+   * Evicts everything from cache.
+   */
+  void clear();
+
+  /**
+   * Return information about the current size of the cache and the total number
+   * of hits and misses.
+   */
+  Stats getStats() const;
+
+ private:
+  TreeCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount);
+
+  struct CacheItem {
+    TreePtr tree;
+    size_t size;
+  };
+
+  struct State {
+    size_t totalSize{0};
+
+    /// Unbounded by count; evictUntilFits() bounds it by size.
+    folly::EvictingCacheMap<Hash, CacheItem> items{0};
+
+    uint64_t hitCount{0};
+    uint64_t missCount{0};
+    uint64_t evictionCount{0};
+  };
+
+  void evictUntilFits(State& state, std::vector<TreePtr>& evicted) noexcept;
+
+  const size_t maximumCacheSizeBytes_;
+  const size_t minimumEntryCount_;
+  folly::Synchronized<State> state_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/TreePackStore.h"
+
+#include <boost/filesystem.hpp>
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
+#include <folly/ScopeGuard.h>
+#include <folly/String.h>
+#include <folly/logging/xlog.h>
+#include <folly/system/MemoryMapping.h>
+#include <algorithm>
+#include <cstring>
+
+using folly::ByteRange;
+using folly::StringPiece;
+
+namespace facebook {
+namespace eden {
+
+namespace {
+/*
+ * A pack file is a header, followed by an index entry for each tree sorted
+ * by hash, followed by the tree data.  Integers are in host byte order, since
+ * packs are a local cache that is never shared between machines.
+ */
+constexpr StringPiece kPackMagic{"EDENTRPK"};
+constexpr uint32_t kPackVersion = 1;
+constexpr StringPiece kPackSuffix{".treepack"};
+
+struct PackHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+};
+static_assert(sizeof(PackHeader) == 16, "pack header must be packed");
+
+struct PackIndexEntry {
+  uint8_t hash[Hash::RAW_SIZE];
+  uint32_t length;
+  uint64_t offset;
+};
+static_assert(sizeof(PackIndexEntry) == 32, "index entry must be packed");
+
+std::string packFileName(uint64_t sequence) {
+  return folly::sformat("{:020d}{}", sequence, kPackSuffix);
+}
+} // namespace
+
+class TreePackStore::Pack {
+ public:
+  /**
+   * Maps the pack file at path, throwing if it is not a valid pack.
+   */
+  Pack(std::string path, uint64_t sequence)
+      : path_{std::move(path)}, sequence_{sequence}, mapping_{path_.c_str()} {
+    auto data = mapping_.range();
+    if (data.size() < sizeof(PackHeader)) {
+      throw std::runtime_error(
+          folly::to<std::string>("tree pack ", path_, " is truncated"));
+    }
+    auto* header = reinterpret_cast<const PackHeader*>(data.data());
+    if (StringPiece{header->magic, sizeof(header->magic)} != kPackMagic ||
+        header->version != kPackVersion) {
+      throw std::runtime_error(
+          folly::to<std::string>("tree pack ", path_, " has a bad header"));
+    }
+    auto indexBytes = uint64_t{header->count} * sizeof(PackIndexEntry);
+    if (data.size() - sizeof(PackHeader) < indexBytes) {
+      throw std::runtime_error(
+          folly::to<std::string>("tree pack ", path_, " has a short index"));
+    }
+    index_ = reinterpret_cast<const PackIndexEntry*>(
+        data.data() + sizeof(PackHeader));
+    count_ = header->count;
+    for (size_t i = 0; i < count_; ++i) {
+      if (index_[i].offset > data.size() ||
+          data.size() - index_[i].offset < index_[i].length) {
+        throw std::runtime_error(folly::to<std::string>(
+            "tree pack ", path_, " has an entry past its end"));
+      }
+    }
+  }
+
+  std::optional<ByteRange> find(const Hash& id) const {
+    auto bytes = id.getBytes();
+    auto end = index_ + count_;
+    auto it = std::lower_bound(
+        index_, end, bytes, [](const PackIndexEntry& entry, ByteRange key) {
+          return memcmp(entry.hash, key.data(), Hash::RAW_SIZE) < 0;
+        });
+    if (it == end || memcmp(it->hash, bytes.data(), Hash::RAW_SIZE) != 0) {
+      return std::nullopt;
+    }
+    return ByteRange{mapping_.range().data() + it->offset, it->length};
+  }
+
+  const std::string& getPath() const {
+    return path_;
+  }
+
+  uint64_t getSequence() const {
+    return sequence_;
+  }
+
+  uint64_t getSize() const {
+    return mapping_.range().size();
+  }
+
+ private:
+  const std::string path_;
+  const uint64_t sequence_;
+  folly::MemoryMapping mapping_;
+  const PackIndexEntry* index_{nullptr};
+  size_t count_{0};
+};
+
+TreePackStore::TreePackStore(
+    AbsolutePathPiece directory,
+    uint64_t packSizeTarget)
+    : directory_{directory}, packSizeTarget_{packSizeTarget} {
+  ensureDirectoryExists(directory_);
+  loadPacks();
+}
+
+TreePackStore::~TreePackStore() {
+  try {
+    flush();
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "error writing tree pack in " << directory_ << ": "
+              << folly::exceptionStr(ex);
+  }
+}
+
+void TreePackStore::loadPacks() {
+  std::vector<std::shared_ptr<const Pack>> packs;
+  std::vector<boost::filesystem::path> unreadable;
+  uint64_t nextSequence = 0;
+
+  boost::system::error_code error;
+  boost::filesystem::directory_iterator it{directory_.c_str(), error};
+  for (; !error && it != boost::filesystem::directory_iterator{};
+       it.increment(error)) {
+    auto name = it->path().filename().string();
+    auto path = it->path().string();
+    if (!StringPiece{name}.endsWith(kPackSuffix)) {
+      // Leftover temporary files from an interrupted write.
+      unreadable.push_back(it->path());
+      continue;
+    }
+    auto sequence = folly::tryTo<uint64_t>(
+        StringPiece{name}.subpiece(0, name.size() - kPackSuffix.size()));
+    try {
+      if (!sequence.hasValue()) {
+        throw std::runtime_error("bad pack file name");
+      }
+      packs.push_back(std::make_shared<const Pack>(path, sequence.value()));
+      nextSequence = std::max(nextSequence, sequence.value() + 1);
+    } catch (const std::exception& ex) {
+      XLOG(WARN) << "removing unreadable tree pack " << path << ": "
+                 << folly::exceptionStr(ex);
+      unreadable.push_back(it->path());
+    }
+  }
+  for (const auto& path : unreadable) {
+    boost::filesystem::remove(path, error);
+  }
+
+  std::sort(packs.begin(), packs.end(), [](const auto& a, const auto& b) {
+    return a->getSequence() > b->getSequence();
+  });
+
+  auto state = state_.wlock();
+  state->packs = std::move(packs);
+  state->nextSequence = nextSequence;
+}
+
+std::optional<std::string> TreePackStore::get(const Hash& id) const {
+  auto state = state_.rlock();
+  auto pendingIt = state->pending.find(id);
+  if (pendingIt != state->pending.end()) {
+    return pendingIt->second;
+  }
+  for (const auto& trees : state->writing) {
+    auto it = trees->find(id);
+    if (it != trees->end()) {
+      return it->second;
+    }
+  }
+  for (const auto& pack : state->packs) {
+    if (auto data = pack->find(id)) {
+      return std::string{reinterpret_cast<const char*>(data->data()),
+                         data->size()};
+    }
+  }
+  return std::nullopt;
+}
+
+void TreePackStore::put(const Hash& id, ByteRange data) {
+  std::shared_ptr<const PendingTrees> trees;
+  uint64_t sequence;
+  {
+    auto state = state_.wlock();
+    for (const auto& pack : state->packs) {
+      if (pack->find(id)) {
+        return;
+      }
+    }
+    auto inserted =
+        state->pending.emplace(id, std::string{folly::StringPiece{data}});
+    if (!inserted.second) {
+      return;
+    }
+    state->pendingBytes += data.size();
+    if (state->pendingBytes < packSizeTarget_) {
+      return;
+    }
+    trees = std::make_shared<const PendingTrees>(std::move(state->pending));
+    state->pending.clear();
+    state->pendingBytes = 0;
+    state->writing.push_back(trees);
+    sequence = state->nextSequence++;
+  }
+  writePack(std::move(trees), sequence);
+}
+
+void TreePackStore::flush() {
+  std::shared_ptr<const PendingTrees> trees;
+  uint64_t sequence;
+  {
+    auto state = state_.wlock();
+    if (state->pending.empty()) {
+      return;
+    }
+    trees = std::make_shared<const PendingTrees>(std::move(state->pending));
+    state->pending.clear();
+    state->pendingBytes = 0;
+    state->writing.push_back(trees);
+    sequence = state->nextSequence++;
+  }
+  writePack(std::move(trees), sequence);
+}
+
+void TreePackStore::writePack(
+    std::shared_ptr<const PendingTrees> trees,
+    uint64_t sequence) {
+  SCOPE_EXIT {
+    auto state = state_.wlock();
+    auto& writing = state->writing;
+    writing.erase(
+        std::remove(writing.begin(), writing.end(), trees), writing.end());
+  };
+
+  std::vector<const PendingTrees::value_type*> sorted;
+  sorted.reserve(trees->size());
+  for (const auto& entry : *trees) {
+    sorted.push_back(&entry);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](auto* a, auto* b) {
+    return a->first < b->first;
+  });
+
+  PackHeader header;
+  memcpy(header.magic, kPackMagic.data(), sizeof(header.magic));
+  header.version = kPackVersion;
+  header.count = folly::to<uint32_t>(sorted.size());
+
+  std::string contents;
+  contents.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  uint64_t offset =
+      sizeof(PackHeader) + sorted.size() * sizeof(PackIndexEntry);
+  for (auto* entry : sorted) {
+    PackIndexEntry indexEntry;
+    memcpy(indexEntry.hash, entry->first.getBytes().data(), Hash::RAW_SIZE);
+    indexEntry.length = folly::to<uint32_t>(entry->second.size());
+    indexEntry.offset = offset;
+    offset += entry->second.size();
+    contents.append(
+        reinterpret_cast<const char*>(&indexEntry), sizeof(indexEntry));
+  }
+  for (auto* entry : sorted) {
+    contents.append(entry->second);
+  }
+
+  auto path = (directory_ + PathComponent{packFileName(sequence)}).value();
+  folly::writeFileAtomic(path, contents, 0644);
+  auto pack = std::make_shared<const Pack>(path, sequence);
+  XLOG(DBG3) << "wrote " << sorted.size() << " trees to tree pack " << path;
+
+  auto state = state_.wlock();
+  // Keep the packs sorted newest first, even if a later pack was written
+  // out before this one.
+  auto it = std::find_if(
+      state->packs.begin(), state->packs.end(), [&](const auto& other) {
+        return other->getSequence() < sequence;
+      });
+  state->packs.insert(it, std::move(pack));
+}
+
+size_t TreePackStore::collectGarbage(uint64_t maxBytes) {
+  std::vector<std::shared_ptr<const Pack>> removed;
+  {
+    auto state = state_.wlock();
+    uint64_t total = 0;
+    for (const auto& pack : state->packs) {
+      total += pack->getSize();
+    }
+    while (total > maxBytes && !state->packs.empty()) {
+      total -= state->packs.back()->getSize();
+      removed.push_back(std::move(state->packs.back()));
+      state->packs.pop_back();
+    }
+  }
+  for (const auto& pack : removed) {
+    boost::system::error_code error;
+    boost::filesystem::remove(pack->getPath(), error);
+    if (error) {
+      XLOG(WARN) << "error removing tree pack " << pack->getPath() << ": "
+                 << error.message();
+    }
+  }
+  return removed.size();
+}
+
+void TreePackStore::clear() {
+  {
+    auto state = state_.wlock();
+    state->pending.clear();
+    state->pendingBytes = 0;
+  }
+  collectGarbage(0);
+}
+
+TreePackStore::Stats TreePackStore::getStats() const {
+  Stats stats;
+  auto state = state_.rlock();
+  stats.packCount = state->packs.size();
+  for (const auto& pack : state->packs) {
+    stats.packBytes += pack->getSize();
+  }
+  stats.pendingCount = state->pending.size();
+  stats.pendingBytes = state->pendingBytes;
+  return stats;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Stores serialized trees in immutable, memory-mapped pack files.
+ *
+ * Committed trees never change, so rather than paying for a RocksDB lookup
+ * (and its block cache copy) on every tree read, trees are staged in memory
+ * and written out in bulk as a pack: a sorted index of tree hashes followed
+ * by the serialized trees.  Looking a tree up is a binary search of each
+ * pack's mapped index, newest pack first.
+ *
+ * Packs are never modified once written.  Garbage collection deletes whole
+ * packs, oldest first; trees that were in them are simply fetched from the
+ * LocalStore or the backing store again.
+ *
+ * TreePackStore is thread-safe.
+ */
+class TreePackStore {
+ public:
+  struct Stats {
+    size_t packCount{0};
+    uint64_t packBytes{0};
+    size_t pendingCount{0};
+    uint64_t pendingBytes{0};
+  };
+
+  /**
+   * Opens the packs in directory, which is created if it does not exist.
+   * Staged trees are written out as a new pack once they add up to
+   * packSizeTarget bytes.  Pack files that cannot be read are deleted.
+   */
+  TreePackStore(AbsolutePathPiece directory, uint64_t packSizeTarget);
+
+  /**
+   * Writes out any staged trees.
+   */
+  ~TreePackStore();
+
+  TreePackStore(const TreePackStore&) = delete;
+  TreePackStore& operator=(const TreePackStore&) = delete;
+
+  /**
+   * Returns the serialized tree with the given id, or std::nullopt if it is
+   * neither staged nor in any pack.
+   */
+  std::optional<std::string> get(const Hash& id) const;
+
+  /**
+   * Stages a serialized tree, writing out a new pack if enough trees have
+   * been staged.  Trees that are already stored are ignored.
+   */
+  void put(const Hash& id, folly::ByteRange data);
+
+  /**
+   * Writes out all staged trees as a new pack.
+   */
+  void flush();
+
+  /**
+   * Deletes the oldest packs until the packs take up no more than maxBytes.
+   * Returns the number of packs deleted.
+   */
+  size_t collectGarbage(uint64_t maxBytes);
+
+  /**
+   * Drops all staged trees and deletes every pack.
+   */
+  void clear();
+
+  Stats getStats() const;
+
+ private:
+  class Pack;
+  using PendingTrees = std::unordered_map<Hash, std::string>;
+
+  struct State {
+    // Newest pack first.
+    std::vector<std::shared_ptr<const Pack>> packs;
+    PendingTrees pending;
+    uint64_t pendingBytes{0};
+    // Trees that are being written out, readable until their pack is added.
+    std::vector<std::shared_ptr<const PendingTrees>> writing;
+    uint64_t nextSequence{0};
+  };
+
+  /**
+   * Writes trees to a new pack with the given sequence number and adds it to
+   * the state.
+   */
+  void writePack(std::shared_ptr<const PendingTrees> trees, uint64_t sequence);
+
+  void loadPacks();
+
+  const AbsolutePath directory_;
+  const uint64_t packSizeTarget_;
+  folly::Synchronized<State> state_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -6,9 +6,14 @@
  */
 
 #include <sysexits.h>
+#include <atomic>
+#include <cstdlib>
 #include <memory>
 #include <optional>
+#include <random>
+#include <thread>
 
+#include <folly/Conv.h>
 #include <folly/Range.h>
 #include <folly/String.h>
 #include <folly/container/Array.h>
@@ -18,12 +23,15 @@
 #include <folly/logging/xlog.h>
 #include <folly/stop_watch.h>
 
+#include "eden/fs/benchharness/Bench.h"
 #include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/config/ReloadableConfig.h"
 #include "eden/fs/service/EdenInit.h"
 #include "eden/fs/service/EdenStateDir.h"
 #include "eden/fs/store/KeySpace.h"
+#include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/RocksDbLocalStore.h"
+#include "eden/fs/store/SqliteLocalStore.h"
 #include "eden/fs/telemetry/NullStructuredLogger.h"
 #include "eden/fs/utils/FaultInjector.h"
 #include "eden/fs/utils/UserInfo.h"
@@ -38,6 +46,27 @@ FOLLY_INIT_LOGGING_CONFIG("eden=DBG2; default:async=true");
 
 DEFINE_string(keySpace, "", "operate on just a single key space");
 
+DEFINE_string(
+    benchmarkBackends,
+    "memory,sqlite,rocksdb",
+    "Comma-separated local store backends for the benchmark command");
+DEFINE_uint64(benchmarkKeys, 100000, "Keys written before each benchmark");
+DEFINE_uint64(benchmarkOps, 100000, "Operations per benchmark thread");
+DEFINE_uint64(benchmarkThreads, 4, "The number of benchmark threads");
+DEFINE_string(
+    benchmarkKeySize,
+    "20",
+    "Key size in bytes, or MIN-MAX for sizes spread uniformly over a range");
+DEFINE_string(
+    benchmarkValueSize,
+    "100-10000",
+    "Value size in bytes, or MIN-MAX for sizes spread uniformly over a range");
+DEFINE_uint64(benchmarkBatchSize, 16, "Keys per getBatch() call");
+DEFINE_double(
+    benchmarkWriteRatio,
+    0.2,
+    "The fraction of operations that are puts in the mixed workload");
+
 namespace {
 
 KeySpace stringToKeySpace(StringPiece name) {
@@ -58,14 +87,18 @@ optional<KeySpace> getKeySpace() {
 
 class Command {
  public:
-  Command()
+  /**
+   * Commands that do not touch the real local store can pass
+   * lockEdenDir=false to run while edenfs is running.
+   */
+  explicit Command(bool lockEdenDir = true)
       : userInfo_(UserInfo::lookup()),
         config_(getEdenConfig(userInfo_)),
         edenDir_([this]() {
           XLOG(INFO) << "Using Eden directory: " << config_->edenDir.getValue();
           return EdenStateDir(config_->edenDir.getValue());
         }()) {
-    if (!edenDir_.acquireLock()) {
+    if (lockEdenDir && !edenDir_.acquireLock()) {
       throw ArgumentError(
           "error: failed to acquire the Eden lock\n"
           "This utility cannot be used while edenfs is running.");
@@ -88,6 +121,7 @@ class Command {
         rocksPath,
         std::make_shared<NullStructuredLogger>(),
         &faultInjector_,
+        *config_,
         mode);
     XLOG(INFO) << "Opened RocksDB store in "
                << (mode == RocksDBOpenMode::ReadOnly ? "read-only"
@@ -182,7 +216,7 @@ class RepairCommand : public Command {
       "Force a repair of the RocksDB storage, even if it does not look corrupt");
 
   void run() override {
-    RocksDbLocalStore::repairDB(getLocalStorePath());
+    RocksDbLocalStore::repairDB(getLocalStorePath(), *config_);
   }
 };
 
@@ -204,13 +238,226 @@ class ShowSizesCommand : public Command {
   }
 };
 
+/**
+ * Key or value sizes, spread uniformly between minimum and maximum.
+ */
+struct SizeRange {
+  size_t minimum;
+  size_t maximum;
+
+  static SizeRange parse(StringPiece flag, StringPiece value) {
+    try {
+      StringPiece minimum;
+      StringPiece maximum;
+      if (folly::split('-', value, minimum, maximum)) {
+        SizeRange range{
+            folly::to<size_t>(minimum), folly::to<size_t>(maximum)};
+        if (range.minimum <= range.maximum) {
+          return range;
+        }
+      } else {
+        auto size = folly::to<size_t>(value);
+        return SizeRange{size, size};
+      }
+    } catch (const std::exception&) {
+    }
+    throw ArgumentError(
+        "invalid --", flag, " \"", value, "\": expected N or MIN-MAX");
+  }
+
+  template <typename Rng>
+  size_t pick(Rng& rng) const {
+    return std::uniform_int_distribution<size_t>{minimum, maximum}(rng);
+  }
+};
+
+class BenchmarkCommand : public Command {
+ public:
+  static constexpr auto name = StringPiece("benchmark");
+  static constexpr auto help = StringPiece(
+      "Compare put/get/getBatch/hasKey performance of the local store "
+      "backends.  Stores are created under the Eden state directory and "
+      "deleted afterwards, so this can run while edenfs is running.");
+
+  BenchmarkCommand()
+      : Command(/*lockEdenDir=*/false),
+        keySize_{SizeRange::parse("benchmarkKeySize", FLAGS_benchmarkKeySize)},
+        valueSize_{
+            SizeRange::parse("benchmarkValueSize", FLAGS_benchmarkValueSize)} {
+    folly::split(',', FLAGS_benchmarkBackends, backends_, /*ignoreEmpty=*/true);
+    if (keySize_.minimum == 0 || !FLAGS_benchmarkKeys ||
+        !FLAGS_benchmarkThreads) {
+      throw ArgumentError(
+          "--benchmarkKeySize, --benchmarkKeys and --benchmarkThreads must "
+          "be nonzero");
+    }
+  }
+
+  void run() override {
+    auto benchmarkDir = edenDir_.getPath() + "storage/benchmark"_relpath;
+    std::vector<std::string> keys;
+    keys.reserve(FLAGS_benchmarkKeys);
+    std::mt19937 rng;
+    for (uint64_t i = 0; i < FLAGS_benchmarkKeys; ++i) {
+      // Keys start with their index to keep them unique.
+      auto key = folly::to<std::string>(i, ':');
+      key.resize(std::max(key.size(), keySize_.pick(rng)), 'k');
+      keys.push_back(std::move(key));
+    }
+    std::string maxValue(valueSize_.maximum, 'v');
+
+    auto status = runBenchmark("local_store", [&](BenchmarkReport& report) {
+      for (const auto& backend : backends_) {
+        removeRecursively(benchmarkDir);
+        ensureDirectoryExists(benchmarkDir);
+        auto store = openStore(backend, benchmarkDir);
+
+        folly::stop_watch<std::chrono::microseconds> watch;
+        for (const auto& key : keys) {
+          folly::ByteRange value{
+              StringPiece{maxValue}.subpiece(0, valueSize_.pick(rng))};
+          store->put(
+              KeySpace::BlobFamily, folly::ByteRange{StringPiece{key}}, value);
+        }
+        auto elapsed = std::max<int64_t>(watch.elapsed().count(), 1);
+        report.metric(folly::to<std::string>(backend, " load"), "ops/s")
+            .add(keys.size() * 1000000 / elapsed);
+
+        runWorkload(*store, backend, "read-only", 0, keys, maxValue, report);
+        runWorkload(
+            *store,
+            backend,
+            "mixed",
+            FLAGS_benchmarkWriteRatio,
+            keys,
+            maxValue,
+            report);
+        store->close();
+      }
+    });
+    removeRecursively(benchmarkDir);
+    if (status != 0) {
+      std::exit(status);
+    }
+  }
+
+ private:
+  std::unique_ptr<LocalStore> openStore(
+      StringPiece backend,
+      AbsolutePathPiece benchmarkDir) {
+    if (backend == "memory") {
+      return make_unique<MemoryLocalStore>();
+    } else if (backend == "sqlite") {
+      return make_unique<SqliteLocalStore>(benchmarkDir + "sqlite"_pc);
+    } else if (backend == "rocksdb") {
+      auto rocksPath = benchmarkDir + "rocks-db"_pc;
+      ensureDirectoryExists(rocksPath);
+      return make_unique<RocksDbLocalStore>(
+          rocksPath,
+          std::make_shared<NullStructuredLogger>(),
+          &faultInjector_,
+          *config_,
+          RocksDBOpenMode::ReadWrite);
+    }
+    throw ArgumentError("unknown local store backend \"", backend, "\"");
+  }
+
+  /**
+   * Runs FLAGS_benchmarkOps operations from each benchmark thread.  A
+   * writeRatio fraction of them are puts, and the others are spread evenly
+   * over get, getBatch and hasKey.
+   */
+  void runWorkload(
+      LocalStore& store,
+      StringPiece backend,
+      StringPiece workload,
+      double writeRatio,
+      const std::vector<std::string>& keys,
+      const std::string& maxValue,
+      BenchmarkReport& report) {
+    struct Latencies {
+      HistogramAccumulator put;
+      HistogramAccumulator get;
+      HistogramAccumulator getBatch;
+      HistogramAccumulator hasKey;
+    };
+    std::vector<Latencies> latencies(FLAGS_benchmarkThreads);
+    std::atomic<uint64_t> missing{0};
+
+    folly::stop_watch<std::chrono::microseconds> watch;
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < FLAGS_benchmarkThreads; ++t) {
+      threads.emplace_back([&, t] {
+        std::mt19937 rng{static_cast<std::mt19937::result_type>(t + 1)};
+        std::uniform_int_distribution<size_t> keyIndex{0, keys.size() - 1};
+        std::uniform_real_distribution<> ratio;
+        std::vector<folly::ByteRange> batch(FLAGS_benchmarkBatchSize);
+        auto& latency = latencies[t];
+        for (uint64_t i = 0; i < FLAGS_benchmarkOps; ++i) {
+          folly::ByteRange key{StringPiece{keys[keyIndex(rng)]}};
+          if (ratio(rng) < writeRatio) {
+            folly::ByteRange value{
+                StringPiece{maxValue}.subpiece(0, valueSize_.pick(rng))};
+            auto start = getTime();
+            store.put(KeySpace::BlobFamily, key, value);
+            latency.put.add(getTime() - start);
+          } else if (i % 3 == 0) {
+            auto start = getTime();
+            auto result = store.get(KeySpace::BlobFamily, key);
+            latency.get.add(getTime() - start);
+            if (!result.isValid()) {
+              ++missing;
+            }
+          } else if (i % 3 == 1) {
+            for (auto& batchKey : batch) {
+              batchKey = StringPiece{keys[keyIndex(rng)]};
+            }
+            auto start = getTime();
+            auto results = store.getBatch(KeySpace::BlobFamily, batch).get();
+            latency.getBatch.add(getTime() - start);
+          } else {
+            auto start = getTime();
+            store.hasKey(KeySpace::BlobFamily, key);
+            latency.hasKey.add(getTime() - start);
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    auto elapsed = std::max<int64_t>(watch.elapsed().count(), 1);
+
+    auto label = folly::to<std::string>(backend, " ", workload);
+    for (const auto& latency : latencies) {
+      if (writeRatio > 0) {
+        report.metric(label + " put", "ns").combine(latency.put);
+      }
+      report.metric(label + " get", "ns").combine(latency.get);
+      report.metric(label + " getBatch", "ns").combine(latency.getBatch);
+      report.metric(label + " hasKey", "ns").combine(latency.hasKey);
+    }
+    report.metric(label + " throughput", "ops/s")
+        .add(FLAGS_benchmarkThreads * FLAGS_benchmarkOps * 1000000 / elapsed);
+    if (missing) {
+      XLOG(WARN) << backend << ": " << missing.load()
+                 << " written keys were not found";
+    }
+  }
+
+  SizeRange keySize_;
+  SizeRange valueSize_;
+  std::vector<std::string> backends_;
+};
+
 std::unique_ptr<Command> createCommand(StringPiece name) {
   auto commands = make_array<std::unique_ptr<CommandFactory>>(
       make_unique<CommandFactoryT<GcCommand>>(),
       make_unique<CommandFactoryT<ClearCommand>>(),
       make_unique<CommandFactoryT<CompactCommand>>(),
       make_unique<CommandFactoryT<RepairCommand>>(),
-      make_unique<CommandFactoryT<ShowSizesCommand>>());
+      make_unique<CommandFactoryT<ShowSizesCommand>>(),
+      make_unique<CommandFactoryT<BenchmarkCommand>>());
 
   std::unique_ptr<Command> command;
   for (const auto& factory : commands) {
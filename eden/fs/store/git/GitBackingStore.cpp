@@ -8,9 +8,15 @@
 #include "GitBackingStore.h"
 
 #include <folly/Conv.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/task_queue/UnboundedBlockingQueue.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <git2.h>
+#include <algorithm>
+#include <utility>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Hash.h"
@@ -18,17 +24,33 @@
 #include "eden/fs/model/TreeEntry.h"
 #include "eden/fs/model/git/GitTree.h"
 #include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/StoreResult.h"
+#include "eden/fs/store/git/GitCommitGraph.h"
 #include "eden/fs/utils/EnumValue.h"
 
 using folly::ByteRange;
 using folly::IOBuf;
-using folly::makeSemiFuture;
 using folly::SemiFuture;
 using folly::StringPiece;
 using std::make_unique;
 using std::string;
 using std::unique_ptr;
 
+DEFINE_int32(
+    num_git_import_threads,
+    4,
+    "The number of threads reading trees and blobs out of git repositories, "
+    "each with its own repository handle");
+DEFINE_uint64(
+    git_prefetch_batch_size,
+    512,
+    "The number of blobs each git import thread reads per prefetch batch");
+DEFINE_bool(
+    git_use_commit_graph,
+    false,
+    "Resolve the root trees of commits from the repository's commit-graph "
+    "files when they contain the commit");
+
 namespace {
 
 template <typename... Args>
@@ -50,25 +72,88 @@ void freeBlobIOBufData(void* /*blobData*/, void* blobObject) {
 namespace facebook {
 namespace eden {
 
+/**
+ * A repository handle borrowed from GitBackingStore::idleRepos_, which is
+ * returned there when the lease is destroyed.
+ */
+class GitBackingStore::RepositoryLease {
+ public:
+  RepositoryLease(GitBackingStore* store, git_repository* repo)
+      : store_{store}, repo_{repo} {}
+  RepositoryLease(RepositoryLease&& other) noexcept
+      : store_{other.store_}, repo_{std::exchange(other.repo_, nullptr)} {}
+  RepositoryLease& operator=(RepositoryLease&&) = delete;
+
+  ~RepositoryLease() {
+    if (repo_) {
+      store_->idleRepos_.wlock()->push_back(repo_);
+    }
+  }
+
+  git_repository* get() const {
+    return repo_;
+  }
+
+ private:
+  GitBackingStore* store_;
+  git_repository* repo_;
+};
+
 GitBackingStore::GitBackingStore(
     AbsolutePathPiece repository,
     LocalStore* localStore)
-    : localStore_{localStore} {
+    : localStore_{localStore}, repoPath_{repository.value().str()} {
   // Make sure libgit2 is initialized.
   // (git_libgit2_init() is safe to call multiple times if multiple
   // GitBackingStore objects are created.  git_libgit2_shutdown() should be
   // called once for each call to git_libgit2_init().)
   git_libgit2_init();
 
-  auto error = git_repository_open(&repo_, repository.value().str().c_str());
+  auto error = git_repository_open(&repo_, repoPath_.c_str());
   gitCheckError(error, "error opening git repository", repository);
+
+  // Trees and blobs are decompressed on these threads so that requests from
+  // many FUSE threads are not serialized behind one another.
+  auto numThreads =
+      static_cast<size_t>(std::max(FLAGS_num_git_import_threads, 1));
+  importThreadPool_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+      numThreads,
+      std::make_unique<folly::UnboundedBlockingQueue<
+          folly::CPUThreadPoolExecutor::CPUTask>>(),
+      std::make_shared<folly::NamedThreadFactory>("GitImport"));
+
+  if (FLAGS_git_use_commit_graph) {
+    commitGraph_ = std::make_unique<const GitCommitGraph>(
+        canonicalPath(git_repository_commondir(repo_)) + "objects"_pc);
+  }
 }
 
 GitBackingStore::~GitBackingStore() {
+  // Wait for pending imports before freeing the handles they use.
+  importThreadPool_.reset();
+  for (auto* repo : *idleRepos_.wlock()) {
+    git_repository_free(repo);
+  }
   git_repository_free(repo_);
   git_libgit2_shutdown();
 }
 
+GitBackingStore::RepositoryLease GitBackingStore::leaseRepository() {
+  {
+    auto idle = idleRepos_.wlock();
+    if (!idle->empty()) {
+      auto* repo = idle->back();
+      idle->pop_back();
+      return RepositoryLease{this, repo};
+    }
+  }
+
+  git_repository* repo = nullptr;
+  auto error = git_repository_open(&repo, repoPath_.c_str());
+  gitCheckError(error, "error opening git repository", repoPath_);
+  return RepositoryLease{this, repo};
+}
+
 const char* GitBackingStore::getPath() const {
   return git_repository_path(repo_);
 }
@@ -76,16 +161,20 @@ const char* GitBackingStore::getPath() const {
 SemiFuture<unique_ptr<Tree>> GitBackingStore::getTree(
     const Hash& id,
     ImportPriority /* priority */) {
-  // TODO: Use a separate thread pool to do the git I/O
-  return makeSemiFuture(getTreeImpl(id));
+  return folly::via(importThreadPool_.get(), [this, id] {
+           return getTreeImpl(leaseRepository().get(), id);
+         })
+      .semi();
 }
 
-unique_ptr<Tree> GitBackingStore::getTreeImpl(const Hash& id) {
+unique_ptr<Tree> GitBackingStore::getTreeImpl(
+    git_repository* repo,
+    const Hash& id) {
   XLOG(DBG4) << "importing tree " << id;
 
   git_oid treeOID = hash2Oid(id);
   git_tree* gitTree = nullptr;
-  auto error = git_tree_lookup(&gitTree, repo_, &treeOID);
+  auto error = git_tree_lookup(&gitTree, repo, &treeOID);
   gitCheckError(
       error, "unable to find git tree ", id, " in repository ", getPath());
   SCOPE_EXIT {
@@ -130,16 +219,43 @@ unique_ptr<Tree> GitBackingStore::getTreeImpl(const Hash& id) {
 SemiFuture<unique_ptr<Blob>> GitBackingStore::getBlob(
     const Hash& id,
     ImportPriority /* priority */) {
-  // TODO: Use a separate thread pool to do the git I/O
-  return makeSemiFuture(getBlobImpl(id));
+  return folly::via(importThreadPool_.get(), [this, id] {
+           return getBlobImpl(leaseRepository().get(), id);
+         })
+      .semi();
+}
+
+SemiFuture<folly::Unit> GitBackingStore::prefetchBlobs(
+    const std::vector<Hash>& ids,
+    ImportPriority /* priority */) {
+  auto batchSize =
+      std::max<size_t>(FLAGS_git_prefetch_batch_size, size_t{1});
+  std::vector<folly::Future<folly::Unit>> futures;
+  for (size_t start = 0; start < ids.size(); start += batchSize) {
+    auto end = std::min(ids.size(), start + batchSize);
+    std::vector<Hash> batch{ids.begin() + start, ids.begin() + end};
+    futures.push_back(folly::via(
+        importThreadPool_.get(), [this, batch = std::move(batch)] {
+          auto repo = leaseRepository();
+          auto writeBatch = localStore_->beginWrite();
+          for (const auto& id : batch) {
+            auto blob = getBlobImpl(repo.get(), id);
+            writeBatch->putBlob(id, blob.get());
+          }
+          writeBatch->flush();
+        }));
+  }
+  return folly::collect(futures).unit().semi();
 }
 
-unique_ptr<Blob> GitBackingStore::getBlobImpl(const Hash& id) {
+unique_ptr<Blob> GitBackingStore::getBlobImpl(
+    git_repository* repo,
+    const Hash& id) {
   XLOG(DBG5) << "importing blob " << id;
 
   auto blobOID = hash2Oid(id);
   git_blob* blob = nullptr;
-  int error = git_blob_lookup(&blob, repo_, &blobOID);
+  int error = git_blob_lookup(&blob, repo, &blobOID);
   gitCheckError(
       error, "unable to find git blob ", id, " in repository ", getPath());
 
@@ -159,13 +275,58 @@ unique_ptr<Blob> GitBackingStore::getBlobImpl(const Hash& id) {
 
 SemiFuture<unique_ptr<Tree>> GitBackingStore::getTreeForCommit(
     const Hash& commitID) {
-  // TODO: Use a separate thread pool to do the git I/O
+  // Commits never change, so the tree of every commit that was resolved
+  // before is remembered in the LocalStore, even across restarts.
+  return localStore_
+      ->getFuture(KeySpace::GitCommitToTreeFamily, commitID.getBytes())
+      .thenValue([this, commitID](StoreResult result) -> folly::Future<Hash> {
+        if (result.isValid()) {
+          auto treeID = Hash{result.bytes()};
+          XLOG(DBG5) << "found existing tree " << treeID << " for git commit "
+                     << commitID;
+          return treeID;
+        }
+        return folly::via(importThreadPool_.get(), [this, commitID] {
+          auto treeID = resolveTreeForCommit(commitID);
+          localStore_->put(
+              KeySpace::GitCommitToTreeFamily, commitID, treeID.getBytes());
+          return treeID;
+        });
+      })
+      .thenValue([this](Hash treeID) {
+        // Now get the specified tree.
+        return localStore_->getTree(treeID).thenValue(
+            [this, treeID](unique_ptr<Tree> tree) {
+              if (tree) {
+                return tree;
+              } else {
+                return getTreeImpl(leaseRepository().get(), treeID);
+              }
+            });
+      })
+      .semi();
+}
+
+Hash GitBackingStore::resolveTreeForCommit(const Hash& commitID) {
+  if (commitGraph_) {
+    if (auto treeID = commitGraph_->getTreeForCommit(commitID)) {
+      XLOG(DBG4) << "found tree " << *treeID << " for commit " << commitID
+                 << " in the commit-graph";
+      return *treeID;
+    }
+  }
+  return getTreeIDForCommit(leaseRepository().get(), commitID);
+}
+
+Hash GitBackingStore::getTreeIDForCommit(
+    git_repository* repo,
+    const Hash& commitID) {
   XLOG(DBG4) << "resolving tree for commit " << commitID;
 
   // Look up the commit info
   git_oid commitOID = hash2Oid(commitID);
   git_commit* commit = nullptr;
-  auto error = git_commit_lookup(&commit, repo_, &commitOID);
+  auto error = git_commit_lookup(&commit, repo, &commitOID);
   gitCheckError(
       error,
       "unable to find git commit ",
@@ -177,17 +338,7 @@ SemiFuture<unique_ptr<Tree>> GitBackingStore::getTreeForCommit(
   };
 
   // Get the tree ID for this commit.
-  Hash treeID = oid2Hash(git_commit_tree_id(commit));
-
-  // Now get the specified tree.
-  return localStore_->getTree(treeID).thenValue(
-      [this, treeID](unique_ptr<Tree> tree) {
-        if (tree) {
-          return tree;
-        } else {
-          return getTreeImpl(treeID);
-        }
-      });
+  return oid2Hash(git_commit_tree_id(commit));
 }
 
 SemiFuture<std::unique_ptr<Tree>> GitBackingStore::getTreeForManifest(
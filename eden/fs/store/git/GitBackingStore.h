@@ -8,6 +8,10 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "eden/fs/store/BackingStore.h"
 #include "eden/fs/utils/PathFuncs.h"
@@ -15,9 +19,14 @@
 struct git_oid;
 struct git_repository;
 
+namespace folly {
+class CPUThreadPoolExecutor;
+} // namespace folly
+
 namespace facebook {
 namespace eden {
 
+class GitCommitGraph;
 class Hash;
 class LocalStore;
 
@@ -55,18 +64,49 @@ class GitBackingStore : public BackingStore {
       const Hash& commitID,
       const Hash& manifestID) override;
 
+  /**
+   * Reads the blobs on the import threads, in batches that each share one
+   * repository handle, and stores them in the LocalStore so that the
+   * following getBlob() calls do not need to decompress them again.
+   */
+  FOLLY_NODISCARD folly::SemiFuture<folly::Unit> prefetchBlobs(
+      const std::vector<Hash>& ids,
+      ImportPriority priority = ImportPriority::kNormal()) override;
+
  private:
+  class RepositoryLease;
+
   GitBackingStore(GitBackingStore const&) = delete;
   GitBackingStore& operator=(GitBackingStore const&) = delete;
 
-  std::unique_ptr<Tree> getTreeImpl(const Hash& id);
-  std::unique_ptr<Blob> getBlobImpl(const Hash& id);
+  std::unique_ptr<Tree> getTreeImpl(git_repository* repo, const Hash& id);
+  std::unique_ptr<Blob> getBlobImpl(git_repository* repo, const Hash& id);
+  Hash getTreeIDForCommit(git_repository* repo, const Hash& commitID);
+
+  /**
+   * Resolves the root tree of a commit from the commit-graph if it is there,
+   * and from the commit object otherwise.
+   */
+  Hash resolveTreeForCommit(const Hash& commitID);
+
+  /**
+   * Take an idle repository handle, opening a new one if there is none.
+   *
+   * libgit2 repository objects must not be used by several threads at once,
+   * so each concurrent import borrows its own.
+   */
+  RepositoryLease leaseRepository();
 
   static git_oid hash2Oid(const Hash& hash);
   static Hash oid2Hash(const git_oid* oid);
 
   LocalStore* localStore_{nullptr};
   git_repository* repo_{nullptr};
+  std::string repoPath_;
+  // Null unless --git_use_commit_graph is set.
+  std::unique_ptr<const GitCommitGraph> commitGraph_;
+  folly::Synchronized<std::vector<git_repository*>> idleRepos_;
+  std::unique_ptr<folly::CPUThreadPoolExecutor> importThreadPool_;
 };
 } // namespace eden
 } // namespace facebook
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/git/GitCommitGraph.h"
+
+#include <boost/filesystem.hpp>
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/lang/Bits.h>
+#include <folly/logging/xlog.h>
+#include <folly/system/MemoryMapping.h>
+#include <cstring>
+
+using folly::ByteRange;
+using folly::StringPiece;
+
+namespace facebook {
+namespace eden {
+
+namespace {
+/*
+ * See Documentation/technical/commit-graph-format.txt in git.  All integers
+ * are in network byte order.
+ */
+constexpr StringPiece kSignature{"CGPH"};
+constexpr uint8_t kVersion = 1;
+constexpr uint8_t kSha1HashVersion = 1;
+constexpr size_t kHeaderSize = 8;
+constexpr size_t kChunkEntrySize = 12;
+constexpr uint32_t kOidFanoutChunk = 0x4f494446; // "OIDF"
+constexpr uint32_t kOidLookupChunk = 0x4f49444c; // "OIDL"
+constexpr uint32_t kCommitDataChunk = 0x43444154; // "CDAT"
+constexpr size_t kFanoutSize = 256 * sizeof(uint32_t);
+// The root tree id, two parent positions and the generation and commit time.
+constexpr size_t kCommitDataSize = Hash::RAW_SIZE + 16;
+
+uint32_t readUint32(const uint8_t* data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return folly::Endian::big(value);
+}
+
+uint64_t readUint64(const uint8_t* data) {
+  uint64_t value;
+  memcpy(&value, data, sizeof(value));
+  return folly::Endian::big(value);
+}
+} // namespace
+
+class GitCommitGraph::Layer {
+ public:
+  /**
+   * Maps the commit-graph file at path, throwing if it is not a valid
+   * commit-graph.
+   */
+  explicit Layer(std::string path)
+      : path_{std::move(path)}, mapping_{path_.c_str()} {
+    auto data = mapping_.range();
+    if (data.size() < kHeaderSize) {
+      throw std::runtime_error(
+          folly::to<std::string>("commit-graph ", path_, " is truncated"));
+    }
+    if (StringPiece{data.subpiece(0, kSignature.size())} != kSignature ||
+        data[4] != kVersion || data[5] != kSha1HashVersion) {
+      throw std::runtime_error(
+          folly::to<std::string>("commit-graph ", path_, " has a bad header"));
+    }
+
+    size_t numChunks = data[6];
+    if (data.size() < kHeaderSize + (numChunks + 1) * kChunkEntrySize) {
+      throw std::runtime_error(folly::to<std::string>(
+          "commit-graph ", path_, " has a short chunk table"));
+    }
+    for (size_t i = 0; i < numChunks; ++i) {
+      auto* entry = data.data() + kHeaderSize + i * kChunkEntrySize;
+      // Each chunk ends where the next one starts.
+      auto start = readUint64(entry + 4);
+      auto end = readUint64(entry + kChunkEntrySize + 4);
+      if (start > end || end > data.size()) {
+        throw std::runtime_error(folly::to<std::string>(
+            "commit-graph ", path_, " has a chunk past its end"));
+      }
+      ByteRange chunk{data.data() + start, data.data() + end};
+      switch (readUint32(entry)) {
+        case kOidFanoutChunk:
+          fanout_ = chunk;
+          break;
+        case kOidLookupChunk:
+          lookup_ = chunk;
+          break;
+        case kCommitDataChunk:
+          commitData_ = chunk;
+          break;
+      }
+    }
+
+    if (fanout_.size() != kFanoutSize) {
+      throw std::runtime_error(folly::to<std::string>(
+          "commit-graph ", path_, " has a bad fanout table"));
+    }
+    uint32_t previous = 0;
+    for (size_t i = 0; i < 256; ++i) {
+      auto value = readUint32(fanout_.data() + i * sizeof(uint32_t));
+      if (value < previous) {
+        throw std::runtime_error(folly::to<std::string>(
+            "commit-graph ", path_, " has a bad fanout table"));
+      }
+      previous = value;
+    }
+    count_ = previous;
+    if (lookup_.size() < uint64_t{count_} * Hash::RAW_SIZE ||
+        commitData_.size() < uint64_t{count_} * kCommitDataSize) {
+      throw std::runtime_error(folly::to<std::string>(
+          "commit-graph ", path_, " is missing commit data"));
+    }
+  }
+
+  std::optional<Hash> find(const Hash& commitID) const {
+    auto bytes = commitID.getBytes();
+    // The fanout table holds the number of commits whose first byte is less
+    // than or equal to its index.
+    size_t first = bytes[0];
+    uint32_t low = first == 0
+        ? 0
+        : readUint32(fanout_.data() + (first - 1) * sizeof(uint32_t));
+    uint32_t high = readUint32(fanout_.data() + first * sizeof(uint32_t));
+    while (low < high) {
+      auto middle = low + (high - low) / 2;
+      auto cmp = memcmp(
+          lookup_.data() + size_t{middle} * Hash::RAW_SIZE,
+          bytes.data(),
+          Hash::RAW_SIZE);
+      if (cmp == 0) {
+        return Hash{ByteRange{
+            commitData_.data() + size_t{middle} * kCommitDataSize,
+            Hash::RAW_SIZE}};
+      } else if (cmp < 0) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    return std::nullopt;
+  }
+
+  size_t getCommitCount() const {
+    return count_;
+  }
+
+ private:
+  const std::string path_;
+  folly::MemoryMapping mapping_;
+  ByteRange fanout_;
+  ByteRange lookup_;
+  ByteRange commitData_;
+  uint32_t count_{0};
+};
+
+GitCommitGraph::GitCommitGraph(AbsolutePathPiece objectsDir) {
+  auto infoDir = objectsDir + "info"_pc;
+
+  // Like git, use the single commit-graph file if there is one, and the
+  // chain of split commit-graph files otherwise.
+  auto single = infoDir + "commit-graph"_pc;
+  if (boost::filesystem::exists(single.c_str())) {
+    addLayer(single);
+  } else {
+    auto chainDir = infoDir + "commit-graphs"_pc;
+    std::string chain;
+    if (folly::readFile((chainDir + "commit-graph-chain"_pc).c_str(), chain)) {
+      std::vector<StringPiece> hashes;
+      folly::split('\n', chain, hashes, true);
+      for (auto hash : hashes) {
+        addLayer(
+            chainDir +
+            PathComponent{folly::to<std::string>("graph-", hash, ".graph")});
+      }
+    }
+  }
+
+  if (!layers_.empty()) {
+    XLOG(DBG2) << "read " << getCommitCount() << " commits from "
+               << layers_.size() << " commit-graph files in " << objectsDir;
+  }
+}
+
+GitCommitGraph::~GitCommitGraph() {}
+
+void GitCommitGraph::addLayer(AbsolutePathPiece path) {
+  try {
+    layers_.push_back(std::make_unique<const Layer>(path.value().str()));
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "ignoring unreadable commit-graph " << path << ": "
+               << folly::exceptionStr(ex);
+  }
+}
+
+std::optional<Hash> GitCommitGraph::getTreeForCommit(
+    const Hash& commitID) const {
+  for (const auto& layer : layers_) {
+    if (auto treeID = layer->find(commitID)) {
+      return treeID;
+    }
+  }
+  return std::nullopt;
+}
+
+size_t GitCommitGraph::getCommitCount() const {
+  size_t count = 0;
+  for (const auto& layer : layers_) {
+    count += layer->getCommitCount();
+  }
+  return count;
+}
+
+} // namespace eden
+} // namespace facebook
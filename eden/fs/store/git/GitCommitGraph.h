@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Reads the root tree of commits out of git's commit-graph files.
+ *
+ * `git commit-graph write` (or `git gc` with gc.writeCommitGraph) stores the
+ * tree and parents of every commit in a sorted table, either in a single
+ * objects/info/commit-graph file or in a chain of files listed by
+ * objects/info/commit-graphs/commit-graph-chain.  Looking a commit up is a
+ * binary search of each mapped file, which avoids probing every pack index
+ * and inflating the commit object.
+ *
+ * The files are read once, when the GitCommitGraph is created.  Commits that
+ * were added to the repository later are simply not found, and callers fall
+ * back to reading the commit object.
+ *
+ * GitCommitGraph is immutable and thus thread-safe.
+ */
+class GitCommitGraph {
+ public:
+  /**
+   * Maps the commit-graph files of the git object directory objectsDir.
+   * Files that are missing or malformed are skipped, so the graph may be
+   * empty.
+   */
+  explicit GitCommitGraph(AbsolutePathPiece objectsDir);
+  ~GitCommitGraph();
+
+  GitCommitGraph(const GitCommitGraph&) = delete;
+  GitCommitGraph& operator=(const GitCommitGraph&) = delete;
+
+  /**
+   * Returns the id of the root tree of the given commit, or std::nullopt if
+   * the commit is not in the graph.
+   */
+  std::optional<Hash> getTreeForCommit(const Hash& commitID) const;
+
+  /**
+   * Returns the number of commits in all of the graph's files.
+   */
+  size_t getCommitCount() const;
+
+ private:
+  class Layer;
+
+  void addLayer(AbsolutePathPiece path);
+
+  std::vector<std::unique_ptr<const Layer>> layers_;
+};
+
+} // namespace eden
+} // namespace facebook
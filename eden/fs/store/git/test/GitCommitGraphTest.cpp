@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/git/GitCommitGraph.h"
+#include <folly/FileUtil.h>
+#include <folly/lang/Bits.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include "eden/fs/testharness/TempFile.h"
+
+using namespace facebook::eden;
+using namespace folly::literals;
+
+namespace {
+const auto commit1 = Hash{"1100000000000000000000000000000000000001"_sp};
+const auto commit2 = Hash{"ab00000000000000000000000000000000000002"_sp};
+const auto commit3 = Hash{"ab00000000000000000000000000000000000003"_sp};
+const auto tree1 = Hash{"0000000000000000000000000000000000000011"_sp};
+const auto tree2 = Hash{"0000000000000000000000000000000000000022"_sp};
+const auto tree3 = Hash{"0000000000000000000000000000000000000033"_sp};
+
+void appendUint32(std::string& out, uint32_t value) {
+  value = folly::Endian::big(value);
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendUint64(std::string& out, uint64_t value) {
+  value = folly::Endian::big(value);
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendHash(std::string& out, const Hash& hash) {
+  auto bytes = hash.getBytes();
+  out.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+/**
+ * Builds a commit-graph file that maps each commit to its tree.
+ */
+std::string makeCommitGraph(std::vector<std::pair<Hash, Hash>> commits) {
+  std::sort(commits.begin(), commits.end());
+  std::string out{"CGPH\x01\x01\x03\x00", 8};
+
+  uint64_t offset = out.size() + 4 * 12;
+  appendUint32(out, 0x4f494446); // OIDF
+  appendUint64(out, offset);
+  offset += 256 * 4;
+  appendUint32(out, 0x4f49444c); // OIDL
+  appendUint64(out, offset);
+  offset += commits.size() * Hash::RAW_SIZE;
+  appendUint32(out, 0x43444154); // CDAT
+  appendUint64(out, offset);
+  offset += commits.size() * (Hash::RAW_SIZE + 16);
+  appendUint32(out, 0);
+  appendUint64(out, offset);
+
+  for (uint32_t i = 0; i < 256; ++i) {
+    appendUint32(
+        out,
+        std::count_if(commits.begin(), commits.end(), [i](const auto& commit) {
+          return commit.first.getBytes()[0] <= i;
+        }));
+  }
+  for (const auto& commit : commits) {
+    appendHash(out, commit.first);
+  }
+  for (const auto& commit : commits) {
+    appendHash(out, commit.second);
+    out.append(16, '\0');
+  }
+  return out;
+}
+
+AbsolutePath objectsDir(const folly::test::TemporaryDirectory& tempDir) {
+  auto objects = AbsolutePath{tempDir.path().string()};
+  ensureDirectoryExists(objects + "info/commit-graphs"_relpath);
+  return objects;
+}
+} // namespace
+
+TEST(GitCommitGraphTest, finds_trees_in_single_file) {
+  auto tempDir = makeTempDir();
+  auto objects = objectsDir(tempDir);
+  folly::writeFile(
+      makeCommitGraph({{commit2, tree2}, {commit1, tree1}}),
+      (objects + "info/commit-graph"_relpath).c_str());
+
+  GitCommitGraph graph{objects};
+  EXPECT_EQ(2, graph.getCommitCount());
+  EXPECT_EQ(tree1, graph.getTreeForCommit(commit1).value());
+  EXPECT_EQ(tree2, graph.getTreeForCommit(commit2).value());
+  EXPECT_FALSE(graph.getTreeForCommit(commit3).has_value());
+}
+
+TEST(GitCommitGraphTest, finds_trees_in_chain) {
+  auto tempDir = makeTempDir();
+  auto objects = objectsDir(tempDir);
+  auto chainDir = objects + "info/commit-graphs"_relpath;
+  folly::writeFile(
+      makeCommitGraph({{commit1, tree1}}),
+      (chainDir + "graph-base.graph"_pc).c_str());
+  folly::writeFile(
+      makeCommitGraph({{commit3, tree3}, {commit2, tree2}}),
+      (chainDir + "graph-top.graph"_pc).c_str());
+  folly::writeFile(
+      "base\ntop\n"_sp, (chainDir + "commit-graph-chain"_pc).c_str());
+
+  GitCommitGraph graph{objects};
+  EXPECT_EQ(3, graph.getCommitCount());
+  EXPECT_EQ(tree1, graph.getTreeForCommit(commit1).value());
+  EXPECT_EQ(tree2, graph.getTreeForCommit(commit2).value());
+  EXPECT_EQ(tree3, graph.getTreeForCommit(commit3).value());
+}
+
+TEST(GitCommitGraphTest, ignores_malformed_files) {
+  auto tempDir = makeTempDir();
+  auto objects = objectsDir(tempDir);
+  auto truncated = makeCommitGraph({{commit1, tree1}});
+  truncated.resize(truncated.size() - 1);
+  folly::writeFile(truncated, (objects + "info/commit-graph"_relpath).c_str());
+
+  GitCommitGraph graph{objects};
+  EXPECT_EQ(0, graph.getCommitCount());
+  EXPECT_FALSE(graph.getTreeForCommit(commit1).has_value());
+}
+
+TEST(GitCommitGraphTest, missing_files_give_an_empty_graph) {
+  auto tempDir = makeTempDir();
+  GitCommitGraph graph{AbsolutePath{tempDir.path().string()}};
+  EXPECT_EQ(0, graph.getCommitCount());
+  EXPECT_FALSE(graph.getTreeForCommit(commit1).has_value());
+}
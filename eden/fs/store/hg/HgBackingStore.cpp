@@ -18,6 +18,9 @@
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
 #include <folly/stop_watch.h>
+#include <algorithm>
+#include <chrono>
+#include <utility>
 
 #include "eden/fs/config/ReloadableConfig.h"
 #include "eden/fs/eden-config.h"
@@ -66,6 +69,48 @@ DEFINE_bool(
     "Set this parameter to \"no\" to disable fetching missing treemanifest "
     "trees from the remote mercurial server.  This is generally only useful "
     "for testing/debugging purposes");
+DEFINE_bool(
+    hg_datapack_bloom_filters,
+    false,
+    "Keep a bloom filter of each treemanifest pack's index, saved next to "
+    "the pack, so that tree lookups skip the packs that cannot hold them");
+DEFINE_uint64(
+    hg_tree_fulltext_cache_bytes,
+    0,
+    "The most bytes of trees rebuilt from treemanifest delta chains to keep "
+    "in memory, so that later rebuilds can stop at a cached ancestor; 0 "
+    "disables the cache");
+DEFINE_bool(
+    hg_datapack_watch,
+    false,
+    "Watch the treemanifest pack directories for new packs instead of "
+    "listing them whenever a tree is missing (Linux only)");
+DEFINE_int32(
+    hg_datapack_rescan_interval_ms,
+    100,
+    "How often a missing tree may list a treemanifest pack directory that "
+    "is not watched, in milliseconds");
+
+DEFINE_int32(
+    min_hg_import_threads,
+    0,
+    "If positive and lower than --num_hg_import_threads, only this many hg "
+    "import threads, each with its own hg_import_helper process, are kept "
+    "running while idle.  More are started, up to --num_hg_import_threads, "
+    "while imports are queued, and are stopped again after "
+    "--hg_import_thread_idle_timeout_ms without work");
+DEFINE_int32(
+    hg_import_thread_idle_timeout_ms,
+    60000,
+    "How long an hg import thread beyond --min_hg_import_threads may stay idle "
+    "before it and its hg_import_helper process are stopped");
+DEFINE_int32(
+    hg_import_helper_timeout_ms,
+    0,
+    "Kill and restart an hg_import_helper process that takes longer than this "
+    "to respond to a request.  0 disables the watchdog");
+
+DECLARE_uint64(hg_import_max_pending_requests);
 
 namespace facebook {
 namespace eden {
@@ -93,14 +138,17 @@ class HgImporterThreadFactory : public folly::ThreadFactory {
  public:
   HgImporterThreadFactory(
       AbsolutePathPiece repository,
-      std::shared_ptr<EdenStats> stats)
+      std::shared_ptr<EdenStats> stats,
+      std::shared_ptr<HgImporterWatchdog> watchdog)
       : delegate_("HgImporter"),
         repository_(repository),
-        stats_(std::move(stats)) {}
+        stats_(std::move(stats)),
+        watchdog_(std::move(watchdog)) {}
 
   std::thread newThread(folly::Func&& func) override {
     return delegate_.newThread([this, func = std::move(func)]() mutable {
-      threadLocalImporter.reset(new HgImporterManager(repository_, stats_));
+      threadLocalImporter.reset(new HgImporterManager(
+          repository_, stats_, std::nullopt, watchdog_));
       func();
     });
   }
@@ -109,8 +157,55 @@ class HgImporterThreadFactory : public folly::ThreadFactory {
   folly::NamedThreadFactory delegate_;
   AbsolutePath repository_;
   std::shared_ptr<EdenStats> stats_;
+  std::shared_ptr<HgImporterWatchdog> watchdog_;
 };
 
+/**
+ * Creates the pool of HgImporter threads.  With --min_hg_import_threads it
+ * grows with the import queue and shrinks again when idle, so that the
+ * number of threads is sized for fetch storms without keeping a helper
+ * process per thread running all the time.
+ */
+std::unique_ptr<folly::CPUThreadPoolExecutor> makeImportThreadPool(
+    AbsolutePathPiece repository,
+    std::shared_ptr<EdenStats> stats) {
+  std::shared_ptr<HgImporterWatchdog> watchdog;
+  if (FLAGS_hg_import_helper_timeout_ms > 0) {
+    watchdog = std::make_shared<HgImporterWatchdog>(
+        std::chrono::milliseconds{FLAGS_hg_import_helper_timeout_ms});
+  }
+
+  auto maxThreads =
+      static_cast<size_t>(std::max(FLAGS_num_hg_import_threads, 1));
+  auto minThreads = maxThreads;
+  if (FLAGS_min_hg_import_threads > 0) {
+    minThreads = std::min(
+        maxThreads, static_cast<size_t>(FLAGS_min_hg_import_threads));
+  }
+
+  auto pool = make_unique<folly::CPUThreadPoolExecutor>(
+      std::make_pair(maxThreads, minThreads),
+      /* Eden performance will degrade when, for example, a status operation
+       * causes a large number of import requests to be scheduled before a
+       * lightweight operation needs to check the RocksDB cache. In that
+       * case, the RocksDB threads can end up all busy inserting work into
+       * the importer queue, preventing future requests that would hit cache
+       * from succeeding.
+       *
+       * Thus, make the import queue unbounded.
+       *
+       * In the long term, we'll want a more comprehensive approach to
+       * bounding the parallelism of scheduled work.
+       */
+      make_unique<folly::UnboundedBlockingQueue<
+          folly::CPUThreadPoolExecutor::CPUTask>>(),
+      std::make_shared<HgImporterThreadFactory>(
+          repository, std::move(stats), std::move(watchdog)));
+  pool->setThreadDeathTimeout(
+      std::chrono::milliseconds{FLAGS_hg_import_thread_idle_timeout_ms});
+  return pool;
+}
+
 /**
  * An inline executor that, while it exists, keeps a thread-local HgImporter
  * instance.
@@ -164,23 +259,7 @@ HgBackingStore::HgBackingStore(
     std::shared_ptr<EdenStats> stats)
     : localStore_(localStore),
       stats_(stats),
-      importThreadPool_(make_unique<folly::CPUThreadPoolExecutor>(
-          FLAGS_num_hg_import_threads,
-          /* Eden performance will degrade when, for example, a status operation
-           * causes a large number of import requests to be scheduled before a
-           * lightweight operation needs to check the RocksDB cache. In that
-           * case, the RocksDB threads can end up all busy inserting work into
-           * the importer queue, preventing future requests that would hit cache
-           * from succeeding.
-           *
-           * Thus, make the import queue unbounded.
-           *
-           * In the long term, we'll want a more comprehensive approach to
-           * bounding the parallelism of scheduled work.
-           */
-          make_unique<folly::UnboundedBlockingQueue<
-              folly::CPUThreadPoolExecutor::CPUTask>>(),
-          std::make_shared<HgImporterThreadFactory>(repository, stats))),
+      importThreadPool_(makeImportThreadPool(repository, stats)),
       config_(config),
       serverThreadPool_(serverThreadPool) {
 #ifdef EDEN_HAVE_RUST_DATAPACK
@@ -217,7 +296,11 @@ HgBackingStore::HgBackingStore(
   repoName_ = options.repoName;
 }
 
-HgBackingStore::~HgBackingStore() {}
+HgBackingStore::~HgBackingStore() {
+  // Finish the background tree prefetches that HgQueuedBackingStore doesn't
+  // wait for before the members they use are destroyed.
+  importThreadPool_.reset();
+}
 
 void HgBackingStore::initializeTreeManifestImport(
     const ImporterOptions& options,
@@ -234,12 +317,21 @@ void HgBackingStore::initializeTreeManifestImport(
     // dead pack files.  This is only guaranteed to be safe so long as we copy
     // the relevant data out of the datapack objects before we issue a
     // subsequent call into the unionStore_.
-    dataPackStores_.emplace_back(std::make_unique<DatapackStore>(path, true));
+    dataPackStores_.emplace_back(std::make_unique<DatapackStore>(
+        path, true, FLAGS_hg_datapack_bloom_filters));
+    dataPackStores_.back()->setRefreshInterval(
+        std::chrono::milliseconds(FLAGS_hg_datapack_rescan_interval_ms));
+    if (FLAGS_hg_datapack_watch &&
+        !dataPackStores_.back()->watchPackDirectory()) {
+      XLOG(DBG2) << "unable to watch treemanifest pack path " << path;
+    }
     storePtrs.emplace_back(dataPackStores_.back().get());
   }
 
   unionStore_ = std::make_unique<folly::Synchronized<UnionDatapackStore>>(
       folly::in_place, storePtrs);
+  unionStore_->wlock()->setFulltextCacheLimit(
+      FLAGS_hg_tree_fulltext_cache_bytes);
   XLOG(DBG2) << "treemanifest import enabled in repository " << repoPath;
 }
 
@@ -247,6 +339,12 @@ SemiFuture<unique_ptr<Tree>> HgBackingStore::getTree(
     const Hash& id,
     ImportPriority /* priority */) {
   HgProxyHash pathInfo(localStore_, id, "importTree");
+  return getTree(id, pathInfo);
+}
+
+SemiFuture<unique_ptr<Tree>> HgBackingStore::getTree(
+    const Hash& id,
+    const HgProxyHash& pathInfo) {
   return importTreeImpl(
       pathInfo.revHash(), // this is really the manifest node
       id,
@@ -289,7 +387,7 @@ HgBackingStore::fetchTreeFromHgCacheOrImporter(
   try {
 #ifdef EDEN_HAVE_RUST_DATAPACK
     if (config_) {
-      auto edenConfig = config_->getEdenConfig();
+      auto edenConfig = config_->getCachedEdenConfig();
       if (edenConfig->useHgCache.getValue() && datapackStore_) {
         if (auto tree = datapackStore_->getTree(
                 path, manifestNode, edenTreeID, writeBatch.get())) {
@@ -302,8 +400,10 @@ HgBackingStore::fetchTreeFromHgCacheOrImporter(
 #endif
     auto content = unionStoreGetWithRefresh(
         *unionStore_->wlock(), path.stringPiece(), manifestNode);
-    return folly::makeFuture(
-        processTree(content, manifestNode, edenTreeID, path, writeBatch.get()));
+    auto tree =
+        processTree(content, manifestNode, edenTreeID, path, writeBatch.get());
+    writeBatch->flush();
+    return folly::makeFuture(std::move(tree));
   } catch (const MissingKeyError&) {
     // Data for this tree was not present locally.
     // Fall through and fetch the data from the server below.
@@ -345,10 +445,53 @@ folly::Future<std::unique_ptr<Tree>> HgBackingStore::fetchTreeFromImporter(
         unionStore_->wlock()->markForRefresh();
         auto content =
             unionStoreGet(*unionStore_->wlock(), ownedPath.stringPiece(), node);
-        return processTree(content, node, treeID, ownedPath, batch.get());
+        auto tree = processTree(content, node, treeID, ownedPath, batch.get());
+        batch->flush();
+        return tree;
       });
 }
 
+SemiFuture<folly::Unit> HgBackingStore::prefetchTreesFromImporter(
+    const std::vector<HgProxyHash>& trees) {
+  if (FLAGS_hg_import_max_pending_requests < 2 ||
+      !FLAGS_hg_fetch_missing_trees) {
+    return folly::makeSemiFuture();
+  }
+
+  std::vector<HgProxyHash> missing;
+  {
+    auto unionStore = unionStore_->wlock();
+    for (const auto& tree : trees) {
+      auto path = tree.path().stringPiece();
+      auto node = tree.revHash();
+      // The null root tree is handled by importTreeImpl().
+      if (path.empty() && node == kZeroHash) {
+        continue;
+      }
+      if (!unionStore->contains(
+              Key(path.data(),
+                  path.size(),
+                  reinterpret_cast<const char*>(node.getBytes().data()),
+                  node.getBytes().size()))) {
+        missing.push_back(tree);
+      }
+    }
+  }
+
+  if (missing.size() < 2) {
+    return folly::makeSemiFuture();
+  }
+
+  return folly::via(
+             importThreadPool_.get(),
+             [missing = std::move(missing),
+              &liveImportTreeWatches = liveImportTreeWatches_] {
+               RequestMetricsScope queueTracker{&liveImportTreeWatches};
+               getThreadLocalImporter().fetchTrees(missing);
+             })
+      .semi();
+}
+
 std::unique_ptr<Tree> HgBackingStore::processTree(
     ConstantStringRef& content,
     const Hash& manifestNode,
@@ -423,7 +566,6 @@ std::unique_ptr<Tree> HgBackingStore::processTree(
 
     iter.next();
   }
-  writeBatch->flush();
 
   return make_unique<Tree>(std::move(entries), edenTreeID);
 }
@@ -460,7 +602,7 @@ folly::Future<std::unique_ptr<Tree>> HgBackingStore::importTreeManifest(
 unique_ptr<Blob> HgBackingStore::getBlobFromHgCache(
     const Hash& id,
     const HgProxyHash& hgInfo) {
-  auto edenConfig = config_->getEdenConfig();
+  auto edenConfig = config_->getCachedEdenConfig();
 
 #ifdef EDEN_HAVE_RUST_DATAPACK
   if (edenConfig->useHgCache.getValue() && datapackStore_) {
@@ -481,6 +623,104 @@ unique_ptr<Blob> HgBackingStore::getBlobFromHgCache(
   return nullptr;
 }
 
+std::vector<unique_ptr<Blob>> HgBackingStore::getBlobBatchFromHgCache(
+    const std::vector<Hash>& ids,
+    const std::vector<HgProxyHash>& hgInfos) {
+  std::vector<unique_ptr<Blob>> blobs(ids.size());
+
+#ifdef EDEN_HAVE_RUST_DATAPACK
+  auto edenConfig = config_->getCachedEdenConfig();
+  if (edenConfig->useHgCache.getValue() && datapackStore_) {
+    blobs = datapackStore_->getBlobBatch(ids, hgInfos, true);
+
+    std::vector<size_t> missing;
+    std::vector<Hash> missingIds;
+    std::vector<HgProxyHash> missingInfos;
+    for (size_t i = 0; i < blobs.size(); ++i) {
+      if (!blobs[i]) {
+        missing.push_back(i);
+        missingIds.push_back(ids[i]);
+        missingInfos.push_back(hgInfos[i]);
+      }
+    }
+
+    if (!missing.empty()) {
+      folly::stop_watch<std::chrono::milliseconds> watch;
+      auto fetched =
+          datapackStore_->getBlobBatch(missingIds, missingInfos, false);
+      size_t failed = 0;
+      for (size_t i = 0; i < missing.size(); ++i) {
+        failed += !fetched[i];
+        blobs[missing[i]] = std::move(fetched[i]);
+      }
+      auto& stats = stats_->getHgBackingStoreStatsForCurrentThread();
+      stats.hgBackingStoreFetchRemoteBlobs.addValue(watch.elapsed().count());
+      stats.hgBackingStoreFetchRemoteFailures.addValue(failed);
+    }
+
+    XLOG(DBG5) << "imported " << blobs.size() - missing.size()
+               << " local blobs and fetched " << missing.size()
+               << " blobs from datapack store";
+  }
+#endif
+
+  return blobs;
+}
+
+std::vector<unique_ptr<Tree>> HgBackingStore::getTreeBatchFromHgCache(
+    const std::vector<Hash>& ids,
+    const std::vector<HgProxyHash>& hgInfos) {
+  std::vector<unique_ptr<Tree>> trees(ids.size());
+
+#ifdef EDEN_HAVE_RUST_DATAPACK
+  auto edenConfig = config_->getCachedEdenConfig();
+  if (edenConfig->useHgCache.getValue() && datapackStore_) {
+    folly::stop_watch<std::chrono::milliseconds> watch;
+    auto writeBatch = localStore_->beginWrite();
+    trees = datapackStore_->getTreeBatch(ids, hgInfos, writeBatch.get(), false);
+    auto failed = std::count(trees.begin(), trees.end(), nullptr);
+    auto& stats = stats_->getHgBackingStoreStatsForCurrentThread();
+    stats.hgBackingStoreFetchRemoteTrees.addValue(watch.elapsed().count());
+    stats.hgBackingStoreFetchRemoteFailures.addValue(failed);
+  }
+#endif
+
+  return trees;
+}
+
+std::vector<unique_ptr<Tree>> HgBackingStore::getTreeBatchFromTreeManifest(
+    const std::vector<Hash>& ids,
+    const std::vector<HgProxyHash>& hgInfos) {
+  std::vector<unique_ptr<Tree>> trees(ids.size());
+  auto writeBatch = localStore_->beginWrite();
+  size_t imported = 0;
+  {
+    auto unionStore = unionStore_->wlock();
+    // Trees fetched by prefetchTreesFromImporter() are in new packs.
+    unionStore->markForRefresh();
+    for (size_t i = 0; i < ids.size(); ++i) {
+      auto path = hgInfos[i].path();
+      auto node = hgInfos[i].revHash();
+      // The null root tree is handled by importTreeImpl().
+      if (path.empty() && node == kZeroHash) {
+        continue;
+      }
+      try {
+        auto content = unionStoreGet(*unionStore, path.stringPiece(), node);
+        trees[i] = processTree(content, node, ids[i], path, writeBatch.get());
+        ++imported;
+      } catch (const std::exception& ex) {
+        XLOG(DBG4) << "tree " << ids[i] << " for path \"" << path
+                   << "\" not in the treemanifest store: " << ex.what();
+      }
+    }
+  }
+  writeBatch->flush();
+  XLOG(DBG4) << "imported " << imported << " of " << ids.size()
+             << " trees from the treemanifest store";
+  return trees;
+}
+
 SemiFuture<std::unique_ptr<Blob>> HgBackingStore::fetchBlobFromHgImporter(
     HgProxyHash hgInfo) {
   return folly::via(
@@ -522,7 +762,8 @@ SemiFuture<unique_ptr<Blob>> HgBackingStore::getBlob(
 }
 
 SemiFuture<folly::Unit> HgBackingStore::prefetchBlobs(
-    const std::vector<Hash>& ids) {
+    const std::vector<Hash>& ids,
+    ImportPriority /*priority*/) {
   return HgProxyHash::getBatch(localStore_, ids)
       .via(importThreadPool_.get())
       .thenValue([&liveImportPrefetchWatches = liveImportPrefetchWatches_](
@@ -533,6 +774,34 @@ SemiFuture<folly::Unit> HgBackingStore::prefetchBlobs(
       .via(serverThreadPool_);
 }
 
+SemiFuture<std::vector<std::optional<BlobMetadata>>>
+HgBackingStore::getBlobMetadataBatch(
+    const std::vector<Hash>& ids,
+    ImportPriority /*priority*/) {
+#ifdef EDEN_HAVE_RUST_DATAPACK
+  auto edenConfig = config_->getCachedEdenConfig();
+  if (!ids.empty() && datapackStore_ && edenConfig->useHgCache.getValue() &&
+      edenConfig->hgBlobMetadataFromHgCache.getValue()) {
+    return HgProxyHash::getBatch(localStore_, ids)
+        .via(importThreadPool_.get())
+        .thenValue([this, ids](std::vector<HgProxyHash>&& hgInfos) {
+          auto blobs = datapackStore_->getBlobBatch(ids, hgInfos, true);
+          std::vector<std::optional<BlobMetadata>> metadata(ids.size());
+          for (size_t i = 0; i < blobs.size(); ++i) {
+            if (blobs[i]) {
+              metadata[i].emplace(
+                  Hash::sha1(blobs[i]->getContents()), blobs[i]->getSize());
+            }
+          }
+          return metadata;
+        })
+        .via(serverThreadPool_);
+  }
+#endif
+
+  return std::vector<std::optional<BlobMetadata>>(ids.size());
+}
+
 SemiFuture<unique_ptr<Tree>> HgBackingStore::getTreeForCommit(
     const Hash& commitID) {
   return localStore_
@@ -619,7 +888,7 @@ folly::StringPiece HgBackingStore::stringOfHgImportObject(
   EDEN_BUG() << "unknown hg import object " << enumValue(object);
 }
 
-RequestMetricsScope::LockedRequestWatchList&
+RequestMetricsScope::RequestWatchList&
 HgBackingStore::getLiveImportWatches(HgImportObject object) const {
   switch (object) {
     case HgImportObject::BLOB:
@@ -86,7 +86,19 @@ class HgBackingStore : public BackingStore {
       const Hash& commitID,
       const Hash& manifestID) override;
   FOLLY_NODISCARD folly::SemiFuture<folly::Unit> prefetchBlobs(
-      const std::vector<Hash>& ids) override;
+      const std::vector<Hash>& ids,
+      ImportPriority priority = ImportPriority::kNormal()) override;
+
+  /**
+   * Computes the metadata of the blobs that are already in hgcache from
+   * their local contents, without fetching anything from the server or
+   * writing the blobs to the LocalStore.  Mercurial keeps no separate
+   * content metadata, so the other blobs are reported as unavailable.
+   */
+  FOLLY_NODISCARD folly::SemiFuture<std::vector<std::optional<BlobMetadata>>>
+  getBlobMetadataBatch(
+      const std::vector<Hash>& ids,
+      ImportPriority priority = ImportPriority::kNormal()) override;
 
   void periodicManagementTask() override;
 
@@ -115,7 +127,7 @@ class HgBackingStore : public BackingStore {
    *        )
    *    gets the watches timing live blob imports
    */
-  RequestMetricsScope::LockedRequestWatchList& getLiveImportWatches(
+  RequestMetricsScope::RequestWatchList& getLiveImportWatches(
       HgImportObject object) const;
 
   // Get blob step functions
@@ -127,9 +139,60 @@ class HgBackingStore : public BackingStore {
   std::unique_ptr<Blob> getBlobFromHgCache(
       const Hash& id,
       const HgProxyHash& hgInfo);
+
+  /**
+   * Like getBlobFromHgCache(), for a whole batch of blobs.  The blobs missing
+   * from hgcache are fetched from the server with one request rather than one
+   * request each.  The result has one entry per hash, which is nullptr for
+   * the blobs that couldn't be fetched.
+   */
+  std::vector<std::unique_ptr<Blob>> getBlobBatchFromHgCache(
+      const std::vector<Hash>& ids,
+      const std::vector<HgProxyHash>& hgInfos);
+
+  /**
+   * Retrieves a batch of trees from hgcache, like getBlobBatchFromHgCache().
+   * Trees that couldn't be fetched are nullptr in the result and should be
+   * imported with getTree().
+   */
+  std::vector<std::unique_ptr<Tree>> getTreeBatchFromHgCache(
+      const std::vector<Hash>& ids,
+      const std::vector<HgProxyHash>& hgInfos);
+
+  /**
+   * Decodes a batch of trees from the treemanifest store, e.g. after
+   * prefetchTreesFromImporter() has fetched them, and writes the proxy hashes
+   * of all of their entries to the LocalStore in one batch.  Trees that
+   * aren't in the store yet are nullptr in the result and should be
+   * imported with getTree().
+   */
+  std::vector<std::unique_ptr<Tree>> getTreeBatchFromTreeManifest(
+      const std::vector<Hash>& ids,
+      const std::vector<HgProxyHash>& hgInfos);
+
   folly::SemiFuture<std::unique_ptr<Blob>> fetchBlobFromHgImporter(
       HgProxyHash hgInfo);
 
+  /**
+   * Like getTree(), for callers that have already loaded the tree's
+   * HgProxyHash, e.g. as part of a batch.
+   */
+  folly::SemiFuture<std::unique_ptr<Tree>> getTree(
+      const Hash& id,
+      const HgProxyHash& pathInfo);
+
+  /**
+   * Asks a single HgImporter to fetch the given trees that aren't in the
+   * treemanifest store yet, with several of the requests in flight at once,
+   * so that importing them with getTree() afterwards finds them locally.
+   *
+   * This does nothing unless --hg_import_max_pending_requests allows more
+   * than one request in flight, in which case importing the trees one at a
+   * time on different HgImporter threads is just as fast.
+   */
+  FOLLY_NODISCARD folly::SemiFuture<folly::Unit> prefetchTreesFromImporter(
+      const std::vector<HgProxyHash>& trees);
+
  private:
   // Forbidden copy constructor and assignment operator
   HgBackingStore(HgBackingStore const&) = delete;
@@ -196,10 +259,9 @@ class HgBackingStore : public BackingStore {
 #endif
 
   // Track metrics for imports currently fetching data from hg
-  mutable RequestMetricsScope::LockedRequestWatchList liveImportBlobWatches_;
-  mutable RequestMetricsScope::LockedRequestWatchList liveImportTreeWatches_;
-  mutable RequestMetricsScope::LockedRequestWatchList
-      liveImportPrefetchWatches_;
+  mutable RequestMetricsScope::RequestWatchList liveImportBlobWatches_;
+  mutable RequestMetricsScope::RequestWatchList liveImportTreeWatches_;
+  mutable RequestMetricsScope::RequestWatchList liveImportPrefetchWatches_;
 };
 } // namespace eden
 } // namespace facebook
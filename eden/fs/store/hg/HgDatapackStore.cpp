@@ -83,6 +83,30 @@ FOLLY_MAYBE_UNUSED std::unique_ptr<Tree> fromRawTree(
 
   return edenTree;
 }
+
+/**
+ * Builds the (path, node) pairs taken by the batch methods of
+ * HgNativeBackingStore.  The nodes are copied into the given vector, which
+ * must outlive the result.
+ */
+std::vector<std::pair<folly::ByteRange, folly::ByteRange>> toBatchRequests(
+    const std::vector<HgProxyHash>& hgInfos,
+    std::vector<Hash>& nodes) {
+  nodes.clear();
+  nodes.reserve(hgInfos.size());
+  for (const auto& hgInfo : hgInfos) {
+    nodes.push_back(hgInfo.revHash());
+  }
+
+  std::vector<std::pair<folly::ByteRange, folly::ByteRange>> requests;
+  requests.reserve(hgInfos.size());
+  for (size_t i = 0; i < hgInfos.size(); ++i) {
+    requests.emplace_back(
+        folly::ByteRange{hgInfos[i].path().stringPiece()},
+        nodes[i].getBytes());
+  }
+  return requests;
+}
 } // namespace
 
 std::unique_ptr<Blob> HgDatapackStore::getBlobLocal(
@@ -91,7 +115,7 @@ std::unique_ptr<Blob> HgDatapackStore::getBlobLocal(
   auto content = store_.getBlob(
       hgInfo.path().stringPiece(), hgInfo.revHash().getBytes(), true);
   if (content) {
-    return std::make_unique<Blob>(id, *content);
+    return std::make_unique<Blob>(id, std::move(*content));
   }
 
   return nullptr;
@@ -103,12 +127,54 @@ std::unique_ptr<Blob> HgDatapackStore::getBlobRemote(
   auto content = store_.getBlob(
       hgInfo.path().stringPiece(), hgInfo.revHash().getBytes(), false);
   if (content) {
-    return std::make_unique<Blob>(id, *content);
+    return std::make_unique<Blob>(id, std::move(*content));
   }
 
   return nullptr;
 }
 
+std::vector<std::unique_ptr<Blob>> HgDatapackStore::getBlobBatch(
+    const std::vector<Hash>& ids,
+    const std::vector<HgProxyHash>& hgInfos,
+    bool local) {
+  XCHECK_EQ(ids.size(), hgInfos.size());
+  std::vector<std::unique_ptr<Blob>> blobs(ids.size());
+  std::vector<Hash> nodes;
+  store_.getBlobBatch(
+      toBatchRequests(hgInfos, nodes),
+      local,
+      [&](size_t index, std::unique_ptr<folly::IOBuf> content) {
+        if (content) {
+          blobs[index] =
+              std::make_unique<Blob>(ids[index], std::move(*content));
+        }
+      });
+  return blobs;
+}
+
+std::vector<std::unique_ptr<Tree>> HgDatapackStore::getTreeBatch(
+    const std::vector<Hash>& edenTreeIds,
+    const std::vector<HgProxyHash>& hgInfos,
+    LocalStore::WriteBatch* writeBatch,
+    bool local) {
+  XCHECK_EQ(edenTreeIds.size(), hgInfos.size());
+  std::vector<std::unique_ptr<Tree>> trees(edenTreeIds.size());
+  std::vector<Hash> nodes;
+  store_.getTreeBatch(
+      toBatchRequests(hgInfos, nodes),
+      local,
+      [&](size_t index, std::shared_ptr<RustTree> tree) {
+        if (tree) {
+          trees[index] = fromRawTree(
+              tree.get(),
+              edenTreeIds[index],
+              hgInfos[index].path(),
+              writeBatch);
+        }
+      });
+  return trees;
+}
+
 std::unique_ptr<Tree> HgDatapackStore::getTree(
     const RelativePath& path,
     const Hash& manifestId,
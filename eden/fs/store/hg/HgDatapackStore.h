@@ -8,6 +8,8 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <memory>
+#include <vector>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/store/LocalStore.h"
@@ -34,6 +36,27 @@ class HgDatapackStore {
       const Hash& id,
       const HgProxyHash& hgInfo);
 
+  /**
+   * Imports the blobs for the given hashes with one call into the backing
+   * store.  The result has one entry per hash, which is nullptr when the
+   * blob could not be found.  When local is false, the blobs that are
+   * missing locally are fetched from the server together.
+   */
+  std::vector<std::unique_ptr<Blob>> getBlobBatch(
+      const std::vector<Hash>& ids,
+      const std::vector<HgProxyHash>& hgInfos,
+      bool local);
+
+  /**
+   * Imports the trees for the given hashes with one call into the backing
+   * store, like getBlobBatch.  The imported trees are written to writeBatch.
+   */
+  std::vector<std::unique_ptr<Tree>> getTreeBatch(
+      const std::vector<Hash>& edenTreeIds,
+      const std::vector<HgProxyHash>& hgInfos,
+      LocalStore::WriteBatch* writeBatch,
+      bool local);
+
   std::unique_ptr<Tree> getTree(
       const RelativePath& path,
       const Hash& manifestId,
@@ -10,8 +10,11 @@
 #include <folly/Try.h>
 #include <folly/futures/Future.h>
 #include <folly/futures/Promise.h>
+#include <algorithm>
+#include <type_traits>
 
 #include "eden/fs/telemetry/RequestMetricsScope.h"
+#include "eden/fs/utils/Bug.h"
 
 namespace facebook {
 namespace eden {
@@ -22,41 +25,86 @@ std::pair<HgImportRequest, folly::SemiFuture<typename Request::Response>>
 makeRequest(
     Input&& input,
     ImportPriority priority,
-    std::unique_ptr<RequestMetricsScope> metricsScope) {
+    std::unique_ptr<RequestMetricsScope> metricsScope,
+    std::optional<pid_t> clientPid) {
   auto [promise, future] =
       folly::makePromiseContract<typename Request::Response>();
   return std::make_pair(
       HgImportRequest{
-          Request{std::forward<Input>(input)}, priority, std::move(promise)},
+          Request{std::forward<Input>(input)},
+          priority,
+          std::move(promise),
+          clientPid},
       std::move(future).defer(
           [metrics = std::move(metricsScope)](auto&& result) {
             return std::forward<decltype(result)>(result);
           }));
 }
+
+folly::Unit copyResponse(folly::Unit unit) {
+  return unit;
+}
+
+template <typename T>
+std::unique_ptr<T> copyResponse(const std::unique_ptr<T>& response) {
+  return response ? std::make_unique<T>(*response) : nullptr;
+}
 } // namespace
 
 std::pair<HgImportRequest, folly::SemiFuture<std::unique_ptr<Blob>>>
 HgImportRequest::makeBlobImportRequest(
     Hash hash,
     ImportPriority priority,
-    std::unique_ptr<RequestMetricsScope> metricsScope) {
-  return makeRequest<BlobImport>(hash, priority, std::move(metricsScope));
+    std::unique_ptr<RequestMetricsScope> metricsScope,
+    std::optional<pid_t> clientPid) {
+  return makeRequest<BlobImport>(
+      hash, priority, std::move(metricsScope), clientPid);
 }
 
 std::pair<HgImportRequest, folly::SemiFuture<std::unique_ptr<Tree>>>
 HgImportRequest::makeTreeImportRequest(
     Hash hash,
     ImportPriority priority,
-    std::unique_ptr<RequestMetricsScope> metricsScope) {
-  return makeRequest<TreeImport>(hash, priority, std::move(metricsScope));
+    std::unique_ptr<RequestMetricsScope> metricsScope,
+    std::optional<pid_t> clientPid) {
+  return makeRequest<TreeImport>(
+      hash, priority, std::move(metricsScope), clientPid);
 }
 
 std::pair<HgImportRequest, folly::SemiFuture<folly::Unit>>
 HgImportRequest::makePrefetchRequest(
     std::vector<Hash> hashes,
     ImportPriority priority,
-    std::unique_ptr<RequestMetricsScope> metricsScope) {
-  return makeRequest<Prefetch>(hashes, priority, std::move(metricsScope));
+    std::unique_ptr<RequestMetricsScope> metricsScope,
+    std::optional<pid_t> clientPid) {
+  return makeRequest<Prefetch>(
+      hashes, priority, std::move(metricsScope), clientPid);
+}
+
+void HgImportRequest::absorb(HgImportRequest&& other) {
+  if (getType() != other.getType()) {
+    EDEN_BUG() << "cannot combine hg import requests of different types";
+  }
+
+  std::visit(
+      [&other](auto& promise) {
+        using Promise = std::remove_reference_t<decltype(promise)>;
+        auto otherPromise = std::move(std::get<Promise>(other.promise_));
+        Promise combined;
+        combined.getFuture().thenTry(
+            [first = std::move(promise),
+             second = std::move(otherPromise)](auto&& result) mutable {
+              if (result.hasValue()) {
+                second.setValue(copyResponse(result.value()));
+              } else {
+                second.setException(result.exception());
+              }
+              first.setTry(std::move(result));
+            });
+        promise = std::move(combined);
+      },
+      promise_);
+  priority_ = std::max(priority_, other.priority_);
 }
 } // namespace eden
 } // namespace facebook
@@ -8,6 +8,9 @@
 #pragma once
 
 #include <folly/futures/Promise.h>
+#include <folly/portability/SysTypes.h>
+#include <optional>
+#include <type_traits>
 #include <utility>
 #include <variant>
 
@@ -30,48 +33,62 @@ class HgImportRequest {
  public:
   struct BlobImport {
     using Response = std::unique_ptr<Blob>;
+    static constexpr size_t kType = 0;
 
     Hash hash;
   };
 
   struct TreeImport {
     using Response = std::unique_ptr<Tree>;
+    static constexpr size_t kType = 1;
 
     Hash hash;
   };
 
   struct Prefetch {
     using Response = folly::Unit;
+    static constexpr size_t kType = 2;
 
     std::vector<Hash> hashes;
   };
 
+  /**
+   * The number of request types.  getType() returns the kType of the
+   * request, which is always less than this.
+   */
+  static constexpr size_t kTypeCount = 3;
+
   static std::pair<HgImportRequest, folly::SemiFuture<std::unique_ptr<Blob>>>
   makeBlobImportRequest(
       Hash hash,
       ImportPriority priority,
-      std::unique_ptr<RequestMetricsScope> metricsScope);
+      std::unique_ptr<RequestMetricsScope> metricsScope,
+      std::optional<pid_t> clientPid = std::nullopt);
 
   static std::pair<HgImportRequest, folly::SemiFuture<std::unique_ptr<Tree>>>
   makeTreeImportRequest(
       Hash hash,
       ImportPriority priority,
-      std::unique_ptr<RequestMetricsScope> metricsScope);
+      std::unique_ptr<RequestMetricsScope> metricsScope,
+      std::optional<pid_t> clientPid = std::nullopt);
 
   static std::pair<HgImportRequest, folly::SemiFuture<folly::Unit>>
   makePrefetchRequest(
       std::vector<Hash> hashes,
       ImportPriority priority,
-      std::unique_ptr<RequestMetricsScope> metricsScope);
+      std::unique_ptr<RequestMetricsScope> metricsScope,
+      std::optional<pid_t> clientPid = std::nullopt);
 
   template <typename RequestType>
   HgImportRequest(
       RequestType request,
       ImportPriority priority,
-      folly::Promise<typename RequestType::Response>&& promise)
+      folly::Promise<typename RequestType::Response>&& promise,
+      std::optional<pid_t> clientPid = std::nullopt)
       : request_(std::move(request)),
         priority_(priority),
-        promise_(std::move(promise)) {}
+        promise_(std::move(promise)),
+        clientPid_(clientPid) {}
 
   ~HgImportRequest() = default;
 
@@ -92,6 +109,26 @@ class HgImportRequest {
     return request_.index();
   }
 
+  ImportPriority getPriority() const noexcept {
+    return priority_;
+  }
+
+  /**
+   * The process the request was made on behalf of, if it came from a FUSE
+   * request.
+   */
+  std::optional<pid_t> getClientPid() const noexcept {
+    return clientPid_;
+  }
+
+  /**
+   * Makes this request also fulfill the promise of other, which must be a
+   * request of the same type for the same object, so that other does not
+   * need to be imported separately.  This request takes the higher of the
+   * two priorities.
+   */
+  void absorb(HgImportRequest&& other);
+
   template <typename T>
   folly::Promise<T>* getPromise() {
     auto promise = std::get_if<folly::Promise<T>>(&promise_); // Promise<T>
@@ -112,9 +149,21 @@ class HgImportRequest {
       folly::Promise<std::unique_ptr<Tree>>,
       folly::Promise<folly::Unit>>;
 
+  static_assert(std::variant_size_v<Request> == kTypeCount);
+  static_assert(std::is_same_v<
+                std::variant_alternative_t<BlobImport::kType, Request>,
+                BlobImport>);
+  static_assert(std::is_same_v<
+                std::variant_alternative_t<TreeImport::kType, Request>,
+                TreeImport>);
+  static_assert(std::is_same_v<
+                std::variant_alternative_t<Prefetch::kType, Request>,
+                Prefetch>);
+
   Request request_;
   ImportPriority priority_;
   Response promise_;
+  std::optional<pid_t> clientPid_;
 
   friend bool operator<(
       const HgImportRequest& lhs,
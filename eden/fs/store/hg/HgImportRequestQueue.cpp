@@ -8,11 +8,42 @@
 #include "eden/fs/store/hg/HgImportRequestQueue.h"
 
 #include <folly/futures/Future.h>
+#include <gflags/gflags.h>
 #include <algorithm>
 
 namespace facebook {
 namespace eden {
 
+DEFINE_uint64(
+    hg_import_priority_aging_ms,
+    0,
+    "If nonzero, queued hg import requests gain one priority level each time "
+    "they have waited this many milliseconds");
+DEFINE_double(
+    hg_import_client_penalty,
+    0,
+    "How many priority levels each queued hg import request from a process "
+    "costs the next request from the same process");
+
+namespace {
+// The distance between adjacent ImportPriorityKinds.
+constexpr double kPriorityLevel = static_cast<double>(uint64_t{1} << 48);
+
+/**
+ * Returns the object imported by a blob or tree import request, which
+ * identifies duplicate requests.
+ */
+std::optional<Hash> getObjectHash(HgImportRequest& request) {
+  if (auto blob = request.getRequest<HgImportRequest::BlobImport>()) {
+    return blob->hash;
+  }
+  if (auto tree = request.getRequest<HgImportRequest::TreeImport>()) {
+    return tree->hash;
+  }
+  return std::nullopt;
+}
+} // namespace
+
 void HgImportRequestQueue::stop() {
   auto state = state_.lock();
   if (state->running) {
@@ -22,6 +53,13 @@ void HgImportRequestQueue::stop() {
 }
 
 void HgImportRequestQueue::enqueue(HgImportRequest request) {
+  double rank = request.getPriority().value() / kPriorityLevel;
+  if (auto agingMs = FLAGS_hg_import_priority_aging_ms) {
+    std::chrono::duration<double, std::milli> sinceStart =
+        std::chrono::steady_clock::now() - start_;
+    rank -= sinceStart.count() / agingMs;
+  }
+
   {
     auto state = state_.lock();
 
@@ -30,59 +68,154 @@ void HgImportRequestQueue::enqueue(HgImportRequest request) {
       return;
     }
 
-    state->queue.emplace_back(std::move(request));
-    std::push_heap(state->queue.begin(), state->queue.end());
+    auto type = request.getType();
+    auto& queue = state->queues[type];
+    auto clientPid = request.getClientPid();
+    size_t* clientRequestCount = nullptr;
+    if (clientPid) {
+      clientRequestCount = &state->clientRequestCounts[*clientPid];
+      rank -= *clientRequestCount * FLAGS_hg_import_client_penalty;
+    }
+
+    auto hash = getObjectHash(request);
+    if (hash) {
+      auto& pendingByHash = state->pendingByHash[type];
+      auto it = pendingByHash.find(*hash);
+      if (it != pendingByHash.end()) {
+        auto pending = it->second;
+        auto& existing = *pending->request;
+        bool raise = existing.getPriority() < request.getPriority();
+        existing.absorb(std::move(request));
+        if (raise) {
+          queue.push_back(QueuedRequest{rank, std::move(pending)});
+          std::push_heap(queue.begin(), queue.end());
+        }
+        if (clientRequestCount && *clientRequestCount == 0) {
+          state->clientRequestCounts.erase(*clientPid);
+        }
+        return;
+      }
+    }
+
+    auto pending = std::make_shared<PendingRequest>(std::move(request));
+    if (hash) {
+      state->pendingByHash[type].emplace(*hash, pending);
+    }
+    if (clientRequestCount) {
+      ++*clientRequestCount;
+    }
+    ++state->depths[type];
+    queue.push_back(QueuedRequest{rank, std::move(pending)});
+    std::push_heap(queue.begin(), queue.end());
   }
 
-  queueCV_.notify_one();
+  // Some waiting callers may not be allowed to take this request.
+  queueCV_.notify_all();
 }
 
 std::vector<HgImportRequest> HgImportRequestQueue::dequeue(size_t count) {
+  Limits limits;
+  limits.batchSizes.fill(count);
+  limits.allowed.fill(true);
+  limits.tracked = false;
+  return dequeue(limits);
+}
+
+void HgImportRequestQueue::finish(size_t type) {
+  {
+    auto state = state_.lock();
+    --state->processing.at(type);
+  }
+  queueCV_.notify_all();
+}
+
+std::vector<HgImportRequest> HgImportRequestQueue::dequeue(
+    const Limits& limits) {
   auto state = state_.lock();
 
-  while (state->running && state->queue.empty()) {
+  auto popEntry = [](std::vector<QueuedRequest>& queue) {
+    std::pop_heap(queue.begin(), queue.end());
+    auto pending = std::move(queue.back().pending);
+    queue.pop_back();
+    return pending;
+  };
+
+  // Pick the type, among those the limits allow, whose most urgent request
+  // has the highest priority.  Ties
+  // go to the type that comes first, so blob imports are served before tree
+  // imports at the same priority.
+  size_t queueType = 0;
+  auto findQueue = [&]() -> std::vector<QueuedRequest>* {
+    std::vector<QueuedRequest>* best = nullptr;
+    for (size_t i = 0; i < state->queues.size(); ++i) {
+      auto& queue = state->queues[i];
+      // Drop entries left behind by raising the priority of a request.
+      while (!queue.empty() && !queue.front().pending->request) {
+        popEntry(queue);
+      }
+      if (!limits.allowed[i] ||
+          (limits.maxRunning[i] != 0 &&
+           state->processing[i] >= limits.maxRunning[i])) {
+        continue;
+      }
+      if (!queue.empty() && (!best || best->front() < queue.front())) {
+        best = &queue;
+        queueType = i;
+      }
+    }
+    return best;
+  };
+
+  auto* queue = findQueue();
+  while (state->running && !queue) {
     queueCV_.wait(state.getUniqueLock());
+    queue = findQueue();
   }
 
   if (!state->running) {
-    state->queue.clear();
+    for (auto& pending : state->queues) {
+      pending.clear();
+    }
+    for (auto& pendingByHash : state->pendingByHash) {
+      pendingByHash.clear();
+    }
+    state->depths.fill(0);
+    state->clientRequestCounts.clear();
     return std::vector<HgImportRequest>();
   }
 
-  auto& queue = state->queue;
-
+  auto count = std::max<size_t>(limits.batchSizes[queueType], 1);
   std::vector<HgImportRequest> result;
-  std::vector<HgImportRequest> putback;
-  std::optional<size_t> type;
-
-  for (size_t i = 0; i < count * 3; i++) {
-    if (queue.empty() || result.size() == count) {
-      break;
+  while (result.size() < count && !queue->empty()) {
+    auto pending = popEntry(*queue);
+    if (!pending->request) {
+      continue;
     }
+    auto request = std::move(*pending->request);
+    pending->request.reset();
 
-    std::pop_heap(queue.begin(), queue.end());
-
-    auto request = std::move(queue.back());
-    queue.pop_back();
-
-    if (!type) {
-      type = request.getType();
-      result.emplace_back(std::move(request));
-    } else {
-      if (*type == request.getType()) {
-        result.emplace_back(std::move(request));
-      } else {
-        putback.emplace_back(std::move(request));
+    auto type = request.getType();
+    --state->depths[type];
+    if (auto hash = getObjectHash(request)) {
+      state->pendingByHash[type].erase(*hash);
+    }
+    if (auto pid = request.getClientPid()) {
+      auto it = state->clientRequestCounts.find(*pid);
+      if (it != state->clientRequestCounts.end() && --it->second == 0) {
+        state->clientRequestCounts.erase(it);
       }
     }
+    result.push_back(std::move(request));
   }
 
-  for (auto& item : putback) {
-    queue.emplace_back(std::move(item));
-    std::push_heap(queue.begin(), queue.end());
+  if (limits.tracked && !result.empty()) {
+    ++state->processing[queueType];
   }
-
   return result;
 }
+
+size_t HgImportRequestQueue::getQueueDepth(size_t type) const {
+  return state_.lock()->depths.at(type);
+}
 } // namespace eden
 } // namespace facebook
@@ -8,8 +8,13 @@
 #pragma once
 
 #include <folly/Synchronized.h>
+#include <array>
+#include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include "eden/fs/store/hg/HgImportRequest.h"
@@ -19,10 +24,39 @@ namespace eden {
 
 class HgImportRequestQueue {
  public:
+  /**
+   * Per-type limits on the batches handed out by dequeue(), indexed by
+   * HgImportRequest::getType().
+   */
+  struct Limits {
+    // The most requests in a batch.
+    std::array<size_t, HgImportRequest::kTypeCount> batchSizes{};
+    // The most batches that may be processed at once, or 0 for no limit.
+    std::array<size_t, HgImportRequest::kTypeCount> maxRunning{};
+    // Whether the caller processes this type at all.
+    std::array<bool, HgImportRequest::kTypeCount> allowed{};
+    // Whether the batch counts towards maxRunning.  Workers reserved for one
+    // type clear this so that they do not use up the shared workers' limit,
+    // and must not call finish().
+    bool tracked = true;
+  };
+
   explicit HgImportRequestQueue() {}
 
   /*
    * Puts an item into the queue.
+   *
+   * Requests are ordered by priority.  If --hg_import_priority_aging_ms is
+   * set, a request gains one priority level (e.g. from kLow to kNormal) each
+   * time it has waited that long, so that background requests are not starved
+   * by a steady stream of more urgent ones.  If --hg_import_client_penalty is
+   * set, each request a process already has waiting lowers the priority of
+   * its next request by that many levels, so that one process cannot
+   * monopolize the import threads.
+   *
+   * A blob or tree import for an object that already has a queued request
+   * is combined with that request rather than queued again, and raises its
+   * priority if the new request is more urgent.
    */
   void enqueue(HgImportRequest request);
 
@@ -32,22 +66,96 @@ class HgImportRequestQueue {
    * item available in the queue.
    *
    * The returned vector may have fewer requests than it requested, and all
-   * requests in the vector are guaranteed to be the same type.
+   * requests in the vector are guaranteed to be the same type.  The batch is
+   * taken from the type whose most urgent request has the highest priority,
+   * and contains that type's most urgent requests.
    */
   std::vector<HgImportRequest> dequeue(size_t count);
 
+  /*
+   * Like dequeue(count), but only returns a batch of a type that limits
+   * allows and that has fewer than limits.maxRunning batches being processed,
+   * blocking until there is one.  Unless limits.tracked is false, the caller
+   * must call finish() once it has processed the batch.
+   */
+  std::vector<HgImportRequest> dequeue(const Limits& limits);
+
+  /*
+   * Marks a non-empty batch of the given type returned by dequeue(limits) as
+   * processed.
+   */
+  void finish(size_t type);
+
+  /*
+   * Returns the number of queued requests of the given type, as returned by
+   * HgImportRequest::getType().
+   */
+  size_t getQueueDepth(size_t type) const;
+
   void stop();
 
  private:
   HgImportRequestQueue(HgImportRequestQueue&&) = delete;
   HgImportRequestQueue& operator=(HgImportRequestQueue&&) = delete;
 
+  /**
+   * A request that has not been dequeued yet.  request is reset when it is
+   * dequeued.
+   */
+  struct PendingRequest {
+    explicit PendingRequest(HgImportRequest request)
+        : request{std::move(request)} {}
+
+    std::optional<HgImportRequest> request;
+  };
+
+  /**
+   * A heap entry for a pending request, along with the rank computed when it
+   * was enqueued.  Aging raises the priority of every waiting request at the
+   * same rate, so it is enough to rank requests by their priority minus the
+   * time they were enqueued, and the heaps never need to be reordered.
+   *
+   * Raising the priority of a pending request adds another entry for it
+   * rather than reordering the heap.  Entries for requests that were already
+   * dequeued are skipped.
+   */
+  struct QueuedRequest {
+    double rank;
+    std::shared_ptr<PendingRequest> pending;
+
+    friend bool operator<(
+        const QueuedRequest& lhs,
+        const QueuedRequest& rhs) noexcept {
+      return lhs.rank < rhs.rank;
+    }
+  };
+
   struct State {
     bool running = true;
-    std::vector<HgImportRequest> queue;
+    // The number of batches of each type returned by dequeue(limits) that
+    // are still being processed.
+    std::array<size_t, HgImportRequest::kTypeCount> processing{};
+    // A heap of requests for each type, indexed by HgImportRequest::getType(),
+    // so that a batch of one type never has to skip over the others.
+    std::array<std::vector<QueuedRequest>, HgImportRequest::kTypeCount>
+        queues;
+    // The number of pending requests of each type.
+    std::array<size_t, HgImportRequest::kTypeCount> depths{};
+    // Pending blob and tree imports by the object they import, indexed by
+    // type.
+    std::array<
+        std::unordered_map<Hash, std::shared_ptr<PendingRequest>>,
+        HgImportRequest::kTypeCount>
+        pendingByHash;
+    // The number of waiting requests from each client process.
+    std::unordered_map<pid_t, size_t> clientRequestCounts;
   };
 
-  folly::Synchronized<State, std::mutex> state_;
+  // Enqueue times are measured from here, to keep the ranks small.
+  const std::chrono::steady_clock::time_point start_{
+      std::chrono::steady_clock::now()};
+
+  mutable folly::Synchronized<State, std::mutex> state_;
   std::condition_variable queueCV_;
 };
 
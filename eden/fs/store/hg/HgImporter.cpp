@@ -11,6 +11,7 @@
 #include <boost/filesystem/path.hpp>
 #include <folly/Conv.h>
 #include <folly/FileUtil.h>
+#include <folly/ScopeGuard.h>
 #include <folly/Utility.h>
 #include <folly/container/Array.h>
 #include <folly/dynamic.h>
@@ -31,7 +32,10 @@
 #include "eden/fs/win/utils/WinError.h" // @manual
 #endif
 
+#include <algorithm>
+#include <exception>
 #include <mutex>
+#include <unordered_set>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Tree.h"
@@ -77,6 +81,19 @@ DEFINE_string(
     "this value is non-empty, the existing PYTHONPATH from the environment is "
     "replaced with this value.");
 
+DEFINE_string(
+    hgConfigSnapshotDir,
+    "",
+    "If set, the import helper loads the system hgrc files through snapshots "
+    "in this directory, so that it does not parse them again while they are "
+    "unchanged.");
+
+DEFINE_uint64(
+    hg_import_max_pending_requests,
+    1,
+    "The number of requests that a batch import may have in flight to one "
+    "hg_import_helper process at a time");
+
 namespace {
 using namespace facebook::eden;
 
@@ -199,6 +216,9 @@ HgImporter::HgImporter(
   // it is done unconditionally.
   (*env)["HGPLAIN"] = "1";
   (*env)["CHGDISABLE"] = "1";
+  if (!FLAGS_hgConfigSnapshotDir.empty()) {
+    (*env)["HGRCSNAPSHOTDIR"] = FLAGS_hgConfigSnapshotDir;
+  }
 
   auto envVector = env.toVector();
   helper_ = Subprocess{cmd, opts, nullptr, &envVector};
@@ -328,6 +348,7 @@ folly::ProcessReturnCode HgImporter::debugStopHelperProcess() {
 
 void HgImporter::stopHelperProcess() {
 #ifndef _WIN32
+  std::lock_guard<std::mutex> lock(helperMutex_);
   if (helper_.returnCode().running()) {
     helper_.closeParentFd(STDIN_FILENO);
     helper_.wait();
@@ -428,6 +449,55 @@ void HgImporter::fetchTree(RelativePathPiece path, Hash pathManifestNode) {
   }
 }
 
+void HgImporter::fetchTrees(const std::vector<HgProxyHash>& trees) {
+  XLOG(DBG1) << "fetching data for " << trees.size() << " trees";
+  auto maxPending = std::max<uint64_t>(FLAGS_hg_import_max_pending_requests, 1);
+  std::unordered_set<TransactionID> pending;
+  std::exception_ptr firstError;
+  size_t next = 0;
+
+  while (next < trees.size() || !pending.empty()) {
+    while (next < trees.size() && pending.size() < maxPending) {
+      const auto& tree = trees[next++];
+      pending.insert(sendFetchTreeRequest(tree.path(), tree.revHash()));
+    }
+
+    auto header = readRawChunkHeader();
+    if (pending.erase(header.requestID) == 0) {
+      auto err = HgImporterError(
+          "received unexpected transaction ID ",
+          header.requestID,
+          " when reading CMD_FETCH_TREE responses");
+      XLOG(ERR) << err.what();
+      throw err;
+    }
+
+    if ((header.flags & FLAG_ERROR) != 0) {
+      // Keep reading the other responses so that the helper process stays in
+      // sync with us, and report the first error once they are all in.
+      try {
+        readErrorAndThrow(header);
+      } catch (const HgImportPyError&) {
+        if (!firstError) {
+          firstError = std::current_exception();
+        }
+      }
+      continue;
+    }
+
+    if (header.dataLength != 0) {
+      throw HgImporterError(
+          "got unexpected length ",
+          header.dataLength,
+          " for FETCH_TREE response");
+    }
+  }
+
+  if (firstError) {
+    std::rethrow_exception(firstError);
+  }
+}
+
 Hash HgImporter::resolveManifestNode(folly::StringPiece revName) {
   auto requestID = sendManifestNodeRequest(revName);
 
@@ -451,13 +521,7 @@ Hash HgImporter::resolveManifestNode(folly::StringPiece revName) {
 HgImporter::ChunkHeader HgImporter::readChunkHeader(
     TransactionID txnID,
     StringPiece cmdName) {
-  ChunkHeader header;
-  readFromHelper(&header, folly::to_narrow(sizeof(header)), "response header");
-
-  header.requestID = Endian::big(header.requestID);
-  header.command = Endian::big(header.command);
-  header.flags = Endian::big(header.flags);
-  header.dataLength = Endian::big(header.dataLength);
+  auto header = readRawChunkHeader();
 
   // If the header indicates an error, read the error message
   // and throw an exception.
@@ -481,6 +545,17 @@ HgImporter::ChunkHeader HgImporter::readChunkHeader(
   return header;
 }
 
+HgImporter::ChunkHeader HgImporter::readRawChunkHeader() {
+  ChunkHeader header;
+  readFromHelper(&header, folly::to_narrow(sizeof(header)), "response header");
+
+  header.requestID = Endian::big(header.requestID);
+  header.command = Endian::big(header.command);
+  header.flags = Endian::big(header.flags);
+  header.dataLength = Endian::big(header.dataLength);
+  return header;
+}
+
 [[noreturn]] void HgImporter::readErrorAndThrow(const ChunkHeader& header) {
   auto buf = IOBuf{IOBuf::CREATE, header.dataLength};
   readFromHelper(buf.writableTail(), header.dataLength, "error response body");
@@ -650,9 +725,44 @@ HgImporter::TransactionID HgImporter::sendFetchTreeRequest(
   return txnID;
 }
 
+bool HgImporter::killHelperIfHung(std::chrono::steady_clock::duration timeout) {
+  auto readStart = readStart_.load(std::memory_order_acquire);
+  if (readStart == 0) {
+    return false;
+  }
+  auto waited = std::chrono::steady_clock::now().time_since_epoch() -
+      std::chrono::steady_clock::duration{readStart};
+  if (waited < timeout) {
+    return false;
+  }
+
+#ifndef _WIN32
+  std::lock_guard<std::mutex> lock(helperMutex_);
+  if (!helper_.returnCode().running()) {
+    return false;
+  }
+  XLOG(ERR) << "hg_import_helper for " << repoPath_ << " has not responded in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(waited)
+                   .count()
+            << "ms, killing it";
+  // The blocked read will see EOF and fail with an HgImporterError.
+  helper_.kill();
+  return true;
+#else
+  return false;
+#endif
+}
+
 void HgImporter::readFromHelper(void* buf, uint32_t size, StringPiece context) {
   size_t bytesRead;
 
+  readStart_.store(
+      std::chrono::steady_clock::now().time_since_epoch().count(),
+      std::memory_order_release);
+  SCOPE_EXIT {
+    readStart_.store(0, std::memory_order_release);
+  };
+
 #ifdef _WIN32
   try {
     bytesRead = Pipe::read(helperOut_, buf, size);
@@ -732,13 +842,57 @@ const ImporterOptions& HgImporter::getOptions() const {
   return options_;
 }
 
+HgImporterWatchdog::HgImporterWatchdog(std::chrono::milliseconds timeout)
+    : timeout_{timeout}, thread_{&HgImporterWatchdog::run, this} {}
+
+HgImporterWatchdog::~HgImporterWatchdog() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  stopCondition_.notify_one();
+  thread_.join();
+}
+
+void HgImporterWatchdog::add(HgImporter* importer) {
+  importers_.wlock()->insert(importer);
+}
+
+void HgImporterWatchdog::remove(HgImporter* importer) {
+  importers_.wlock()->erase(importer);
+}
+
+void HgImporterWatchdog::run() {
+  // Checking twice per timeout kills a hung helper at most 1.5 timeouts
+  // after its last response.
+  auto interval = std::max(timeout_ / 2, std::chrono::milliseconds{1});
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopCondition_.wait_for(
+      lock, interval, [this] { return stopping_; })) {
+    // Holding the lock keeps the importers from being removed, and so
+    // destroyed, while they are checked.
+    auto importers = importers_.rlock();
+    for (auto* importer : *importers) {
+      importer->killHelperIfHung(timeout_);
+    }
+  }
+}
+
 HgImporterManager::HgImporterManager(
     AbsolutePathPiece repoPath,
     std::shared_ptr<EdenStats> stats,
-    std::optional<AbsolutePath> importHelperScript)
+    std::optional<AbsolutePath> importHelperScript,
+    std::shared_ptr<HgImporterWatchdog> watchdog)
     : repoPath_{repoPath},
       stats_{std::move(stats)},
-      importHelperScript_{importHelperScript} {}
+      importHelperScript_{importHelperScript},
+      watchdog_{std::move(watchdog)} {}
+
+HgImporterManager::~HgImporterManager() {
+  if (importer_ && watchdog_) {
+    watchdog_->remove(importer_.get());
+  }
+}
 
 template <typename Fn>
 auto HgImporterManager::retryOnError(Fn&& fn) {
@@ -798,14 +952,25 @@ void HgImporterManager::fetchTree(
   });
 }
 
+void HgImporterManager::fetchTrees(const std::vector<HgProxyHash>& trees) {
+  return retryOnError(
+      [&](HgImporter* importer) { return importer->fetchTrees(trees); });
+}
+
 HgImporter* HgImporterManager::getImporter() {
   if (!importer_) {
     importer_ = make_unique<HgImporter>(repoPath_, stats_, importHelperScript_);
+    if (watchdog_) {
+      watchdog_->add(importer_.get());
+    }
   }
   return importer_.get();
 }
 
 void HgImporterManager::resetHgImporter(const std::exception& ex) {
+  if (importer_ && watchdog_) {
+    watchdog_->remove(importer_.get());
+  }
   importer_.reset();
   XLOG(WARN) << "error communicating with hg_import_helper.py: " << ex.what();
 }
@@ -8,7 +8,14 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <optional>
+#include <thread>
+#include <unordered_set>
 #ifndef _WIN32
 #include <folly/Subprocess.h>
 #else
@@ -100,6 +107,12 @@ class Importer {
    * Import tree and store it in the datapack
    */
   virtual void fetchTree(RelativePathPiece path, Hash pathManifestNode) = 0;
+
+  /**
+   * Import several trees and store them in the datapack.  Implementations
+   * may have more than one of the requests in flight at a time.
+   */
+  virtual void fetchTrees(const std::vector<HgProxyHash>& trees) = 0;
 };
 
 /**
@@ -142,9 +155,25 @@ class HgImporter : public Importer {
       Hash blobHash) override;
   void prefetchFiles(const std::vector<HgProxyHash>& files) override;
   void fetchTree(RelativePathPiece path, Hash pathManifestNode) override;
+  /**
+   * Sends up to --hg_import_max_pending_requests CMD_FETCH_TREE requests
+   * before waiting for their responses, matching the responses to the
+   * requests by transaction ID, so that the helper process never waits on
+   * us between trees.
+   */
+  void fetchTrees(const std::vector<HgProxyHash>& trees) override;
 
   const ImporterOptions& getOptions() const;
 
+  /**
+   * Kill the helper process if we have been waiting on it for longer than
+   * timeout, so that the waiting request fails instead of hanging forever.
+   * Unlike the rest of this class, this may be called from any thread.
+   *
+   * Returns true if the helper process was killed.
+   */
+  bool killHelperIfHung(std::chrono::steady_clock::duration timeout);
+
  private:
   /**
    * Chunk header flags.
@@ -224,6 +253,12 @@ class HgImporter : public Importer {
    */
   ChunkHeader readChunkHeader(TransactionID txnID, folly::StringPiece cmdName);
 
+  /**
+   * Read the next response chunk header from the helper process, whatever
+   * its transaction ID and flags.
+   */
+  ChunkHeader readRawChunkHeader();
+
   /**
    * Read the body of an error message, and throw it as an exception.
    */
@@ -288,6 +323,16 @@ class HgImporter : public Importer {
 
   edenfd_t helperIn_{kInvalidFd};
   edenfd_t helperOut_{kInvalidFd};
+
+  /**
+   * When the current read from the helper process started, as a
+   * steady_clock time since epoch, or 0 while we aren't reading.
+   */
+  std::atomic<std::chrono::steady_clock::rep> readStart_{0};
+  /**
+   * Serializes killHelperIfHung() with stopping the helper process.
+   */
+  std::mutex helperMutex_;
 };
 
 class HgImporterError : public std::exception {
@@ -304,6 +349,39 @@ class HgImporterError : public std::exception {
   std::string message_;
 };
 
+/**
+ * Restarts hg debugedenimporthelper processes that stop responding.
+ *
+ * A background thread periodically kills the helper process of any
+ * registered HgImporter that has been waiting on a response for longer than
+ * the timeout.  The waiting request then fails with an HgImporterError, and
+ * HgImporterManager starts a new helper process and retries it.
+ */
+class HgImporterWatchdog {
+ public:
+  explicit HgImporterWatchdog(std::chrono::milliseconds timeout);
+  ~HgImporterWatchdog();
+
+  /**
+   * Start watching importer, which must be removed before it is destroyed.
+   */
+  void add(HgImporter* importer);
+  void remove(HgImporter* importer);
+
+ private:
+  HgImporterWatchdog(const HgImporterWatchdog&) = delete;
+  HgImporterWatchdog& operator=(const HgImporterWatchdog&) = delete;
+
+  void run();
+
+  const std::chrono::milliseconds timeout_;
+  folly::Synchronized<std::unordered_set<HgImporter*>> importers_;
+  std::mutex mutex_;
+  std::condition_variable stopCondition_;
+  bool stopping_{false};
+  std::thread thread_;
+};
+
 /**
  * A helper class that manages an HgImporter and recreates it after any error
  * communicating with hg debugedenimporthelper.
@@ -315,7 +393,9 @@ class HgImporterManager : public Importer {
   HgImporterManager(
       AbsolutePathPiece repoPath,
       std::shared_ptr<EdenStats>,
-      std::optional<AbsolutePath> importHelperScript = std::nullopt);
+      std::optional<AbsolutePath> importHelperScript = std::nullopt,
+      std::shared_ptr<HgImporterWatchdog> watchdog = nullptr);
+  ~HgImporterManager() override;
 
   Hash resolveManifestNode(folly::StringPiece revName) override;
 
@@ -324,6 +404,7 @@ class HgImporterManager : public Importer {
       Hash blobHash) override;
   void prefetchFiles(const std::vector<HgProxyHash>& files) override;
   void fetchTree(RelativePathPiece path, Hash pathManifestNode) override;
+  void fetchTrees(const std::vector<HgProxyHash>& trees) override;
 
  private:
   template <typename Fn>
@@ -337,6 +418,7 @@ class HgImporterManager : public Importer {
   const AbsolutePath repoPath_;
   std::shared_ptr<EdenStats> const stats_;
   const std::optional<AbsolutePath> importHelperScript_;
+  const std::shared_ptr<HgImporterWatchdog> watchdog_;
 };
 
 } // namespace eden
@@ -7,10 +7,15 @@
 
 #include "eden/fs/store/hg/HgProxyHash.h"
 
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
 #include <folly/futures/Future.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+#include <array>
+#include <optional>
 
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/StoreResult.h"
@@ -22,13 +27,89 @@ using folly::StringPiece;
 using folly::io::Appender;
 using std::string;
 
+DEFINE_uint64(
+    hg_proxy_hash_cache_size,
+    0,
+    "The number of recently stored or loaded mercurial proxy hashes to keep "
+    "in memory, so that resolving them does not need a LocalStore lookup");
+
 namespace facebook {
 namespace eden {
 
+namespace {
+/**
+ * A process-wide in-memory cache of serialized proxy hash data.
+ *
+ * Proxy hashes are the SHA-1 of the data they map to, so a hash always maps
+ * to the same data regardless of which LocalStore it was read from, and the
+ * cache can be shared by every repository.
+ */
+class ProxyHashCache {
+ public:
+  std::optional<string> get(const Hash& edenBlobHash) {
+    auto maxSize = getShardSize();
+    if (maxSize == 0) {
+      return std::nullopt;
+    }
+    auto shard = getShard(edenBlobHash).wlock();
+    auto it = shard->items.find(edenBlobHash);
+    if (it == shard->items.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  void insert(const Hash& edenBlobHash, StringPiece value) {
+    auto maxSize = getShardSize();
+    if (maxSize == 0) {
+      return;
+    }
+    auto shard = getShard(edenBlobHash).wlock();
+    // Follow changes to --hg_proxy_hash_cache_size.
+    if (shard->items.getMaxSize() != maxSize) {
+      shard->items.setMaxSize(maxSize);
+    }
+    shard->items.set(edenBlobHash, value.str());
+  }
+
+ private:
+  static constexpr size_t kShardCount = 16;
+  struct ShardState {
+    folly::EvictingCacheMap<Hash, string> items{1};
+  };
+  using Shard = folly::Synchronized<ShardState>;
+
+  static size_t getShardSize() {
+    if (FLAGS_hg_proxy_hash_cache_size == 0) {
+      return 0;
+    }
+    return std::max<size_t>(FLAGS_hg_proxy_hash_cache_size / kShardCount, 1);
+  }
+
+  Shard& getShard(const Hash& edenBlobHash) {
+    // Proxy hashes are uniformly distributed, so any byte picks a shard.
+    return shards_[edenBlobHash.getBytes()[0] % kShardCount];
+  }
+
+  std::array<Shard, kShardCount> shards_;
+};
+
+ProxyHashCache& getProxyHashCache() {
+  // Meyers singleton to avoid SIOF issues
+  static ProxyHashCache cache;
+  return cache;
+}
+} // namespace
+
 HgProxyHash::HgProxyHash(
     LocalStore* store,
     Hash edenBlobHash,
     StringPiece context) {
+  if (auto cached = getProxyHashCache().get(edenBlobHash)) {
+    value_ = std::move(*cached);
+    return;
+  }
+
   // Read the path name and file rev hash
   auto infoResult = store->get(KeySpace::HgProxyHashFamily, edenBlobHash);
   if (!infoResult.isValid()) {
@@ -39,23 +120,44 @@ HgProxyHash::HgProxyHash(
 
   value_ = infoResult.extractValue();
   validate(edenBlobHash);
+  getProxyHashCache().insert(edenBlobHash, value_);
 }
 
 folly::Future<std::vector<HgProxyHash>> HgProxyHash::getBatch(
     LocalStore* store,
     const std::vector<Hash>& blobHashes) {
-  auto hashCopies = std::make_shared<std::vector<Hash>>(blobHashes);
+  // Only look up the hashes that are not cached, and fill the results for
+  // the rest in afterwards.
+  auto cached =
+      std::make_shared<std::vector<std::optional<string>>>(blobHashes.size());
+  auto missing = std::make_shared<std::vector<Hash>>();
+  for (size_t i = 0; i < blobHashes.size(); ++i) {
+    (*cached)[i] = getProxyHashCache().get(blobHashes[i]);
+    if (!(*cached)[i]) {
+      missing->push_back(blobHashes[i]);
+    }
+  }
+
   std::vector<folly::ByteRange> byteRanges;
-  for (auto& hash : *hashCopies) {
+  for (auto& hash : *missing) {
     byteRanges.push_back(hash.getBytes());
   }
   return store->getBatch(KeySpace::HgProxyHashFamily, byteRanges)
-      .thenValue([blobHashes = hashCopies](std::vector<StoreResult>&& data) {
+      .thenValue([cached, missing](std::vector<StoreResult>&& data) {
         std::vector<HgProxyHash> results;
+        results.reserve(cached->size());
 
-        for (size_t i = 0; i < blobHashes->size(); ++i) {
-          results.emplace_back(HgProxyHash{
-              blobHashes->at(i), data[i], "prefetchFiles getBatch"});
+        size_t missingIndex = 0;
+        for (auto& value : *cached) {
+          if (value) {
+            results.emplace_back(HgProxyHash{std::move(*value)});
+            continue;
+          }
+          const auto& hash = missing->at(missingIndex);
+          results.emplace_back(
+              HgProxyHash{hash, data[missingIndex], "prefetchFiles getBatch"});
+          getProxyHashCache().insert(hash, results.back().value_);
+          ++missingIndex;
         }
 
         return results;
@@ -87,6 +189,11 @@ std::pair<Hash, IOBuf> HgProxyHash::prepareToStore(
 void HgProxyHash::store(
     const std::pair<Hash, IOBuf>& computedPair,
     LocalStore::WriteBatch* writeBatch) {
+  getProxyHashCache().insert(
+      computedPair.first,
+      StringPiece{
+          reinterpret_cast<const char*>(computedPair.second.data()),
+          computedPair.second.length()});
   writeBatch->put(
       KeySpace::HgProxyHashFamily,
       computedPair.first,
@@ -42,6 +42,10 @@ constexpr auto kDefaultProxyHash =
  * blob hash in eden.  We store the eden_blob_hash --> (path, hgRevHash)
  * mapping in the LocalStore.  The HgProxyHash class helps store and
  * retrieve these mappings.
+ *
+ * With --hg_proxy_hash_cache_size, recently stored and loaded mappings are
+ * also kept in memory, so that reading a file shortly after its parent tree
+ * was imported does not need a LocalStore lookup to find its revision.
  */
 class HgProxyHash {
  public:
@@ -111,6 +115,11 @@ class HgProxyHash {
       StoreResult& infoResult,
       folly::StringPiece context);
 
+  /**
+   * Wraps data that was already validated, such as from the in-memory cache.
+   */
+  explicit HgProxyHash(std::string value) : value_{std::move(value)} {}
+
   /**
    * Serialize the (path, hgRevHash) data into a buffer that will be stored in
    * the LocalStore.
@@ -8,14 +8,21 @@
 #include "eden/fs/store/hg/HgQueuedBackingStore.h"
 
 #include <folly/Range.h>
+#include <folly/executors/QueuedImmediateExecutor.h>
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
 #include <gflags/gflags.h>
+#include <algorithm>
 #include <thread>
+#include <unordered_set>
 #include <utility>
 #include <variant>
 
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/config/ReloadableConfig.h"
+#ifndef _WIN32
+#include "eden/fs/fuse/RequestData.h"
+#endif
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/hg/HgBackingStore.h"
@@ -31,17 +38,34 @@ namespace eden {
 
 DEFINE_uint64(hg_queue_batch_size, 1, "Number of requests per Hg import batch");
 
+namespace {
+/**
+ * Returns the process that the current FUSE request, if any, was made by.
+ */
+std::optional<pid_t> getClientPid() {
+#ifndef _WIN32
+  if (RequestData::isFuseRequest()) {
+    return static_cast<pid_t>(RequestData::get().examineReq().pid);
+  }
+#endif
+  return std::nullopt;
+}
+} // namespace
+
 HgQueuedBackingStore::HgQueuedBackingStore(
     std::shared_ptr<LocalStore> localStore,
     std::shared_ptr<EdenStats> stats,
     std::unique_ptr<HgBackingStore> backingStore,
-    uint8_t numberThreads)
+    uint8_t numberThreads,
+    std::shared_ptr<ReloadableConfig> config)
     : localStore_(std::move(localStore)),
       stats_(std::move(stats)),
+      config_(std::move(config)),
+      numberThreads_(numberThreads),
       backingStore_(std::move(backingStore)) {
   threads_.reserve(numberThreads);
-  for (int i = 0; i < numberThreads; i++) {
-    threads_.emplace_back(&HgQueuedBackingStore::processRequest, this);
+  for (size_t i = 0; i < numberThreads; i++) {
+    threads_.emplace_back(&HgQueuedBackingStore::processRequest, this, i);
   }
 }
 
@@ -90,40 +114,31 @@ void HgQueuedBackingStore::processBlobImportRequests(
   // hgimporthelper and mononoke if possible
 
   {
-    // check hgcache
-    auto request = requests.begin();
-    auto proxyHash = proxyHashes.begin();
+    // check hgcache, fetching everything it is missing with one request
     auto& stats = stats_->getHgBackingStoreStatsForCurrentThread();
+    auto blobs = backingStore_->getBlobBatchFromHgCache(hashes, proxyHashes);
+    std::vector<HgImportRequest> missingRequests;
+    std::vector<HgProxyHash> missingProxyHashes;
     size_t count = 0;
 
     XCHECK_EQ(requests.size(), proxyHashes.size());
-    for (; request != requests.end();) {
-      auto hash = request->getRequest<HgImportRequest::BlobImport>()->hash;
-
-      if (auto blob = backingStore_->getBlobFromHgCache(hash, *proxyHash)) {
-        XLOG(DBG4) << "Imported blob from hgcache for " << hash;
-        request->getPromise<decltype(blob)>()->setValue(std::move(blob));
+    XCHECK_EQ(requests.size(), blobs.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+      if (auto& blob = blobs[i]) {
+        XLOG(DBG4) << "Imported blob from hgcache for " << hashes[i];
+        requests[i]
+            .getPromise<HgImportRequest::BlobImport::Response>()
+            ->setValue(std::move(blob));
         stats.hgBackingStoreGetBlob.addValue(watch.elapsed().count());
         count += 1;
-
-        // Swap-and-pop, removing fulfilled request from the list.
-        // It is fine to call `.back()` here because if we are in the loop
-        // `requests` are guaranteed to be nonempty.
-        // @lint-ignore HOWTOEVEN ParameterUncheckedArrayBounds
-        std::swap(*request, requests.back());
-        requests.pop_back();
-
-        // Same reason as above, if `proxyHashes` is empty it would be caught
-        // by the XHCECK_EQ call above.
-        // @lint-ignore HOWTOEVEN LocalUncheckedArrayBounds
-        std::swap(*proxyHash, proxyHashes.back());
-        proxyHashes.pop_back();
       } else {
-        request++;
-        proxyHash++;
+        missingRequests.push_back(std::move(requests[i]));
+        missingProxyHashes.push_back(std::move(proxyHashes[i]));
       }
     }
 
+    requests = std::move(missingRequests);
+    proxyHashes = std::move(missingProxyHashes);
     XLOG(DBG4) << "Fetched " << count << " requests from hgcache";
   }
 
@@ -157,13 +172,189 @@ void HgQueuedBackingStore::processBlobImportRequests(
 
 void HgQueuedBackingStore::processTreeImportRequests(
     std::vector<HgImportRequest>&& requests) {
+  std::vector<Hash> hashes;
+  hashes.reserve(requests.size());
   for (auto& request : requests) {
     auto parameter = request.getRequest<HgImportRequest::TreeImport>();
-    request.getPromise<HgImportRequest::TreeImport::Response>()->setWith(
-        [store = backingStore_.get(), hash = parameter->hash]() {
-          return store->getTree(hash).getTry();
+    hashes.emplace_back(parameter->hash);
+  }
+
+  // Load the proxy hashes of the whole batch with one LocalStore lookup.
+  auto proxyHashesTry =
+      HgProxyHash::getBatch(localStore_.get(), hashes).wait().getTry();
+
+  if (proxyHashesTry.hasException()) {
+    // Fall back to per-tree lookups so that one unknown tree only fails its
+    // own request.
+    XLOG(DBG3) << "Failed to get proxy hashes for tree batch: "
+               << proxyHashesTry.exception().what();
+    for (auto& request : requests) {
+      auto parameter = request.getRequest<HgImportRequest::TreeImport>();
+      request.getPromise<HgImportRequest::TreeImport::Response>()->setWith(
+          [store = backingStore_.get(), hash = parameter->hash]() {
+            return store->getTree(hash).getTry();
+          });
+    }
+    return;
+  }
+
+  auto& proxyHashes = proxyHashesTry.value();
+  XCHECK_EQ(requests.size(), proxyHashes.size());
+  auto trees = backingStore_->getTreeBatchFromHgCache(hashes, proxyHashes);
+  XCHECK_EQ(requests.size(), trees.size());
+
+  std::vector<size_t> missingIndices;
+  std::vector<HgProxyHash> missing;
+  for (size_t i = 0; i < trees.size(); ++i) {
+    if (!trees[i]) {
+      missingIndices.push_back(i);
+      missing.push_back(proxyHashes[i]);
+    }
+  }
+  bool pipelined = config_ &&
+      config_->getCachedEdenConfig()->hgPipelinedTreeImport.getValue();
+  if (!missing.empty()) {
+    std::vector<Hash> missingIds;
+    missingIds.reserve(missingIndices.size());
+    for (auto index : missingIndices) {
+      missingIds.push_back(hashes[index]);
+    }
+    prefetchTrees(missingIds, missing);
+
+    if (pipelined) {
+      auto decoded =
+          backingStore_->getTreeBatchFromTreeManifest(missingIds, missing);
+      XCHECK_EQ(missingIndices.size(), decoded.size());
+      for (size_t i = 0; i < decoded.size(); ++i) {
+        trees[missingIndices[i]] = std::move(decoded[i]);
+      }
+    }
+  }
+
+  // The subtrees of this batch are usually what gets imported next, so start
+  // fetching them from the HgImporter before anyone asks for them.
+  std::vector<Hash> subtrees;
+  if (pipelined) {
+    for (const auto& tree : trees) {
+      if (!tree) {
+        continue;
+      }
+      for (const auto& entry : tree->getTreeEntries()) {
+        if (entry.isTree()) {
+          subtrees.push_back(entry.getHash());
+        }
+      }
+    }
+  }
+
+  for (size_t i = 0; i < requests.size(); ++i) {
+    // Trees that hgcache didn't have go through the regular import path,
+    // which also handles the null root tree.
+    if (trees[i]) {
+      XLOG(DBG4) << "Imported tree in batch for " << hashes[i];
+      requests[i].getPromise<HgImportRequest::TreeImport::Response>()->setValue(
+          std::move(trees[i]));
+      continue;
+    }
+    requests[i].getPromise<HgImportRequest::TreeImport::Response>()->setWith(
+        [store = backingStore_.get(),
+         hash = hashes[i],
+         &proxyHash = proxyHashes[i]]() {
+          return store->getTree(hash, proxyHash).getTry();
         });
   }
+
+  if (!subtrees.empty()) {
+    prefetchSubtrees(subtrees);
+  }
+}
+
+void HgQueuedBackingStore::prefetchTrees(
+    const std::vector<Hash>& ids,
+    const std::vector<HgProxyHash>& proxyHashes) {
+  std::vector<HgProxyHash> toFetch;
+  std::vector<folly::SemiFuture<folly::Unit>> inFlight;
+  {
+    auto prefetching = prefetchingSubtrees_.rlock();
+    std::unordered_set<folly::SharedPromise<folly::Unit>*> waited;
+    for (size_t i = 0; i < ids.size(); ++i) {
+      auto it = prefetching->find(ids[i]);
+      if (it == prefetching->end()) {
+        toFetch.push_back(proxyHashes[i]);
+      } else if (waited.insert(it->second.get()).second) {
+        inFlight.push_back(it->second->getSemiFuture());
+      }
+    }
+  }
+
+  // Failures are reported by the per-tree imports that follow.
+  auto prefetched =
+      backingStore_->prefetchTreesFromImporter(toFetch).wait().getTry();
+  if (prefetched.hasException()) {
+    XLOG(DBG3) << "Failed to prefetch trees from HgImporter: "
+               << prefetched.exception().what();
+  }
+  folly::collectAll(std::move(inFlight)).wait();
+}
+
+void HgQueuedBackingStore::prefetchSubtrees(const std::vector<Hash>& ids) {
+  auto maxSubtrees = config_->getCachedEdenConfig()
+                         ->hgPipelinedTreeImportMaxSubtrees.getValue();
+  // Subtrees that were already imported need no fetching.
+  std::vector<Hash> needed;
+  for (const auto& id : ids) {
+    if (!localStore_->hasKey(KeySpace::TreeFamily, id)) {
+      needed.push_back(id);
+    }
+  }
+
+  auto promise = std::make_shared<folly::SharedPromise<folly::Unit>>();
+  std::vector<Hash> toFetch;
+  {
+    auto prefetching = prefetchingSubtrees_.wlock();
+    for (const auto& id : needed) {
+      if (prefetching->size() >= maxSubtrees) {
+        break;
+      }
+      if (prefetching->emplace(id, promise).second) {
+        toFetch.push_back(id);
+      }
+    }
+  }
+  if (toFetch.empty()) {
+    return;
+  }
+
+  auto done = [this, promise, ids = toFetch] {
+    {
+      auto prefetching = prefetchingSubtrees_.wlock();
+      for (const auto& id : ids) {
+        prefetching->erase(id);
+      }
+    }
+    promise->setValue();
+  };
+
+  auto proxyHashes =
+      HgProxyHash::getBatch(localStore_.get(), toFetch).wait().getTry();
+  if (proxyHashes.hasException()) {
+    XLOG(DBG3) << "Failed to get proxy hashes for subtree prefetch: "
+               << proxyHashes.exception().what();
+    done();
+    return;
+  }
+
+  // This runs on the HgImporter threads; the import thread moves on to its
+  // next batch without waiting for it.
+  backingStore_->prefetchTreesFromImporter(proxyHashes.value())
+      .via(&folly::QueuedImmediateExecutor::instance())
+      .thenTry([done = std::move(done)](folly::Try<folly::Unit>&& result) {
+        if (result.hasException()) {
+          XLOG(DBG3) << "Failed to prefetch subtrees from HgImporter: "
+                     << result.exception().what();
+        }
+        done();
+      });
 }
 
 void HgQueuedBackingStore::processPrefetchRequests(
@@ -177,15 +368,64 @@ void HgQueuedBackingStore::processPrefetchRequests(
   }
 }
 
-void HgQueuedBackingStore::processRequest() {
+HgImportRequestQueue::Limits HgQueuedBackingStore::getQueueLimits(
+    size_t index) const {
+  HgImportRequestQueue::Limits limits;
+  limits.batchSizes.fill(FLAGS_hg_queue_batch_size);
+  limits.allowed.fill(true);
+  if (!config_) {
+    return limits;
+  }
+
+  auto config = config_->getCachedEdenConfig();
+  auto setLimits = [&](size_t type,
+                       const ConfigSetting<uint64_t>& batchSize,
+                       const ConfigSetting<uint64_t>& maxRunning) {
+    if (auto size = batchSize.getValue()) {
+      limits.batchSizes[type] = size;
+    }
+    limits.maxRunning[type] = maxRunning.getValue();
+  };
+  setLimits(
+      HgImportRequest::BlobImport::kType,
+      config->hgBlobImportBatchSize,
+      config->hgMaxBlobImportThreads);
+  setLimits(
+      HgImportRequest::TreeImport::kType,
+      config->hgTreeImportBatchSize,
+      config->hgMaxTreeImportThreads);
+  setLimits(
+      HgImportRequest::Prefetch::kType,
+      config->hgPrefetchImportBatchSize,
+      config->hgMaxPrefetchImportThreads);
+
+  // At least one worker must be left for the other types.
+  auto reserved = std::min<uint64_t>(
+      config->hgReservedTreeImportThreads.getValue(), numberThreads_ - 1);
+  if (index < reserved) {
+    limits.allowed.fill(false);
+    limits.allowed[HgImportRequest::TreeImport::kType] = true;
+    // The tree limit applies to the shared workers, and these batches do
+    // not count towards it.
+    limits.maxRunning[HgImportRequest::TreeImport::kType] = 0;
+    limits.tracked = false;
+  }
+  return limits;
+}
+
+void HgQueuedBackingStore::processRequest(size_t index) {
   for (;;) {
-    auto requests = queue_.dequeue(FLAGS_hg_queue_batch_size);
+    // The limits are read for every batch, so config changes apply to the
+    // next batch each worker takes.
+    auto limits = getQueueLimits(index);
+    auto requests = queue_.dequeue(limits);
 
     if (requests.empty()) {
       break;
     }
 
     const auto& first = requests.at(0);
+    auto type = first.getType();
 
     if (first.isType<HgImportRequest::BlobImport>()) {
       processBlobImportRequests(std::move(requests));
@@ -194,6 +434,10 @@ void HgQueuedBackingStore::processRequest() {
     } else if (first.isType<HgImportRequest::Prefetch>()) {
       processPrefetchRequests(std::move(requests));
     }
+
+    if (limits.tracked) {
+      queue_.finish(type);
+    }
   }
 }
 
@@ -203,7 +447,7 @@ folly::SemiFuture<std::unique_ptr<Tree>> HgQueuedBackingStore::getTree(
   auto importTracker =
       std::make_unique<RequestMetricsScope>(&pendingImportTreeWatches_);
   auto [request, future] = HgImportRequest::makeTreeImportRequest(
-      id, priority, std::move(importTracker));
+      id, priority, std::move(importTracker), getClientPid());
   queue_.enqueue(std::move(request));
   return std::move(future);
 }
@@ -214,7 +458,7 @@ folly::SemiFuture<std::unique_ptr<Blob>> HgQueuedBackingStore::getBlob(
   auto importTracker =
       std::make_unique<RequestMetricsScope>(&pendingImportBlobWatches_);
   auto [request, future] = HgImportRequest::makeBlobImportRequest(
-      id, priority, std::move(importTracker));
+      id, priority, std::move(importTracker), getClientPid());
   queue_.enqueue(std::move(request));
   return std::move(future);
 }
@@ -231,12 +475,20 @@ HgQueuedBackingStore::getTreeForManifest(
   return backingStore_->getTreeForManifest(commitID, manifestID);
 }
 
+folly::SemiFuture<std::vector<std::optional<BlobMetadata>>>
+HgQueuedBackingStore::getBlobMetadataBatch(
+    const std::vector<Hash>& ids,
+    ImportPriority priority) {
+  return backingStore_->getBlobMetadataBatch(ids, priority);
+}
+
 folly::SemiFuture<folly::Unit> HgQueuedBackingStore::prefetchBlobs(
-    const std::vector<Hash>& ids) {
+    const std::vector<Hash>& ids,
+    ImportPriority priority) {
   auto importTracker =
       std::make_unique<RequestMetricsScope>(&pendingImportPrefetchWatches_);
   auto [request, future] = HgImportRequest::makePrefetchRequest(
-      ids, ImportPriority::kNormal(), std::move(importTracker));
+      ids, priority, std::move(importTracker), getClientPid());
   queue_.enqueue(std::move(request));
 
   return std::move(future);
@@ -250,7 +502,20 @@ size_t HgQueuedBackingStore::getImportMetric(
       metric, getImportWatches(stage, object));
 }
 
-RequestMetricsScope::LockedRequestWatchList&
+size_t HgQueuedBackingStore::getQueueDepth(
+    HgBackingStore::HgImportObject object) const {
+  switch (object) {
+    case HgBackingStore::HgImportObject::BLOB:
+      return queue_.getQueueDepth(HgImportRequest::BlobImport::kType);
+    case HgBackingStore::HgImportObject::TREE:
+      return queue_.getQueueDepth(HgImportRequest::TreeImport::kType);
+    case HgBackingStore::HgImportObject::PREFETCH:
+      return queue_.getQueueDepth(HgImportRequest::Prefetch::kType);
+  }
+  EDEN_BUG() << "unknown hg import object type " << static_cast<int>(object);
+}
+
+RequestMetricsScope::RequestWatchList&
 HgQueuedBackingStore::getImportWatches(
     RequestMetricsScope::RequestStage stage,
     HgBackingStore::HgImportObject object) const {
@@ -263,7 +528,7 @@ HgQueuedBackingStore::getImportWatches(
   EDEN_BUG() << "unknown hg import stage " << enumValue(stage);
 }
 
-RequestMetricsScope::LockedRequestWatchList&
+RequestMetricsScope::RequestWatchList&
 HgQueuedBackingStore::getPendingImportWatches(
     HgBackingStore::HgImportObject object) const {
   switch (object) {
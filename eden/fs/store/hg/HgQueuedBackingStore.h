@@ -8,7 +8,10 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/futures/SharedPromise.h>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "eden/fs/model/Hash.h"
@@ -40,7 +43,8 @@ class HgQueuedBackingStore : public BackingStore {
       std::shared_ptr<LocalStore> localStore,
       std::shared_ptr<EdenStats> stats,
       std::unique_ptr<HgBackingStore> backingStore,
-      uint8_t numberThreads = kNumberHgQueueWorker);
+      uint8_t numberThreads = kNumberHgQueueWorker,
+      std::shared_ptr<ReloadableConfig> config = nullptr);
 
   ~HgQueuedBackingStore() override;
 
@@ -58,7 +62,13 @@ class HgQueuedBackingStore : public BackingStore {
       const Hash& manifestID) override;
 
   FOLLY_NODISCARD virtual folly::SemiFuture<folly::Unit> prefetchBlobs(
-      const std::vector<Hash>& /*ids*/) override;
+      const std::vector<Hash>& ids,
+      ImportPriority priority = ImportPriority::kNormal()) override;
+
+  FOLLY_NODISCARD folly::SemiFuture<std::vector<std::optional<BlobMetadata>>>
+  getBlobMetadataBatch(
+      const std::vector<Hash>& ids,
+      ImportPriority priority = ImportPriority::kNormal()) override;
 
   HgBackingStore* getHgBackingStore() const {
     return backingStore_.get();
@@ -78,6 +88,12 @@ class HgQueuedBackingStore : public BackingStore {
       HgBackingStore::HgImportObject object,
       RequestMetricsScope::RequestMetric metric) const;
 
+  /**
+   * Returns the number of `object` import requests waiting in the queue for
+   * a worker thread.
+   */
+  size_t getQueueDepth(HgBackingStore::HgImportObject object) const;
+
  private:
   // Forbidden copy constructor and assignment operator
   HgQueuedBackingStore(const HgQueuedBackingStore&) = delete;
@@ -88,9 +104,32 @@ class HgQueuedBackingStore : public BackingStore {
   void processPrefetchRequests(std::vector<HgImportRequest>&& requests);
 
   /**
-   * The worker runloop function.
+   * Starts fetching the given trees from the HgImporter in the background,
+   * for hg:pipelined-tree-import.  Trees that were already imported, or are
+   * already being prefetched, are skipped, as are any past
+   * hg:pipelined-tree-import-max-subtrees.
+   */
+  void prefetchSubtrees(const std::vector<Hash>& ids);
+
+  /**
+   * Fetches the given trees from the HgImporter, unless prefetchSubtrees()
+   * is already fetching them, in which case it waits for that instead.
    */
-  void processRequest();
+  void prefetchTrees(
+      const std::vector<Hash>& ids,
+      const std::vector<HgProxyHash>& proxyHashes);
+
+  /**
+   * The worker runloop function.  Workers with an index below
+   * hg:reserved-tree-import-threads only import trees.
+   */
+  void processRequest(size_t index);
+
+  /**
+   * Returns the limits on what the given worker may dequeue, according to
+   * the current config.
+   */
+  HgImportRequestQueue::Limits getQueueLimits(size_t index) const;
 
   /**
    * gets the watches timing `object` imports that are `stage`
@@ -100,7 +139,7 @@ class HgQueuedBackingStore : public BackingStore {
    *        )
    *    gets the watches timing blob imports that are pending
    */
-  RequestMetricsScope::LockedRequestWatchList& getImportWatches(
+  RequestMetricsScope::RequestWatchList& getImportWatches(
       RequestMetricsScope::RequestStage stage,
       HgBackingStore::HgImportObject object) const;
 
@@ -111,11 +150,23 @@ class HgQueuedBackingStore : public BackingStore {
    *        )
    *    gets the watches timing pending blob imports
    */
-  RequestMetricsScope::LockedRequestWatchList& getPendingImportWatches(
+  RequestMetricsScope::RequestWatchList& getPendingImportWatches(
       HgBackingStore::HgImportObject object) const;
 
   std::shared_ptr<LocalStore> localStore_;
   std::shared_ptr<EdenStats> stats_;
+  std::shared_ptr<ReloadableConfig> config_;
+  const size_t numberThreads_;
+
+  /**
+   * The trees that prefetchSubtrees() is fetching, with a promise that is
+   * fulfilled once the fetch that includes them has finished.  This outlives
+   * backingStore_, whose import threads finish those fetches.
+   */
+  folly::Synchronized<std::unordered_map<
+      Hash,
+      std::shared_ptr<folly::SharedPromise<folly::Unit>>>>
+      prefetchingSubtrees_;
 
   std::unique_ptr<HgBackingStore> backingStore_;
 
@@ -132,10 +183,9 @@ class HgQueuedBackingStore : public BackingStore {
   std::vector<std::thread> threads_;
 
   // Track metrics for queued imports
-  mutable RequestMetricsScope::LockedRequestWatchList pendingImportBlobWatches_;
-  mutable RequestMetricsScope::LockedRequestWatchList pendingImportTreeWatches_;
-  mutable RequestMetricsScope::LockedRequestWatchList
-      pendingImportPrefetchWatches_;
+  mutable RequestMetricsScope::RequestWatchList pendingImportBlobWatches_;
+  mutable RequestMetricsScope::RequestWatchList pendingImportTreeWatches_;
+  mutable RequestMetricsScope::RequestWatchList pendingImportPrefetchWatches_;
 };
 
 } // namespace eden
@@ -6,9 +6,11 @@
  */
 
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <array>
 #include <memory>
+#include <thread>
 
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/store/ImportPriority.h"
@@ -17,7 +19,16 @@
 #include "eden/fs/telemetry/RequestMetricsScope.h"
 #include "eden/fs/utils/IDGen.h"
 
+namespace facebook {
+namespace eden {
+DECLARE_uint64(hg_import_priority_aging_ms);
+DECLARE_double(hg_import_client_penalty);
+} // namespace eden
+} // namespace facebook
+
 using namespace facebook::eden;
+using namespace std::chrono_literals;
+using namespace folly::string_piece_literals;
 
 Hash uniqueHash() {
   std::array<uint8_t, Hash::RAW_SIZE> bytes = {0};
@@ -28,20 +39,21 @@ Hash uniqueHash() {
 
 std::pair<Hash, HgImportRequest> makeBlobImportRequest(
     ImportPriority priority,
-    RequestMetricsScope::LockedRequestWatchList& pendingImportWatches) {
+    RequestMetricsScope::RequestWatchList& pendingImportWatches,
+    std::optional<pid_t> clientPid = std::nullopt) {
   auto hash = uniqueHash();
   auto importTracker =
       std::make_unique<RequestMetricsScope>(&pendingImportWatches);
   return std::make_pair(
       hash,
       HgImportRequest::makeBlobImportRequest(
-          hash, priority, std::move(importTracker))
+          hash, priority, std::move(importTracker), clientPid)
           .first);
 }
 
 std::pair<Hash, HgImportRequest> makeTreeImportRequest(
     ImportPriority priority,
-    RequestMetricsScope::LockedRequestWatchList& pendingImportWatches) {
+    RequestMetricsScope::RequestWatchList& pendingImportWatches) {
   auto hash = uniqueHash();
   auto importTracker =
       std::make_unique<RequestMetricsScope>(&pendingImportWatches);
@@ -55,7 +67,7 @@ std::pair<Hash, HgImportRequest> makeTreeImportRequest(
 TEST(HgImportRequestQueueTest, getRequestByPriority) {
   auto queue = HgImportRequestQueue{};
   std::vector<Hash> enqueued;
-  RequestMetricsScope::LockedRequestWatchList pendingImportWatches;
+  RequestMetricsScope::RequestWatchList pendingImportWatches;
 
   for (int i = 0; i < 10; i++) {
     auto [hash, request] = makeBlobImportRequest(
@@ -87,7 +99,7 @@ TEST(HgImportRequestQueueTest, getRequestByPriority) {
 TEST(HgImportRequestQueueTest, getRequestByPriorityReverse) {
   auto queue = HgImportRequestQueue{};
   std::deque<Hash> enqueued;
-  RequestMetricsScope::LockedRequestWatchList pendingImportWatches;
+  RequestMetricsScope::RequestWatchList pendingImportWatches;
 
   for (int i = 0; i < 10; i++) {
     auto [hash, request] = makeBlobImportRequest(
@@ -118,7 +130,7 @@ TEST(HgImportRequestQueueTest, getRequestByPriorityReverse) {
 }
 
 TEST(HgImportRequestQueueTest, getMultipleRequests) {
-  RequestMetricsScope::LockedRequestWatchList pendingImportWatches;
+  RequestMetricsScope::RequestWatchList pendingImportWatches;
 
   auto queue = HgImportRequestQueue{};
   std::set<Hash> enqueued_blob;
@@ -149,3 +161,212 @@ TEST(HgImportRequestQueueTest, getMultipleRequests) {
         enqueued_blob.end());
   }
 }
+
+TEST(HgImportRequestQueueTest, batchesTakeTheMostUrgentType) {
+  RequestMetricsScope::RequestWatchList pendingImportWatches;
+
+  auto queue = HgImportRequestQueue{};
+  std::set<Hash> enqueuedTrees;
+
+  for (int i = 0; i < 10; i++) {
+    queue.enqueue(makeBlobImportRequest(
+                      ImportPriority(ImportPriorityKind::Normal, 0),
+                      pendingImportWatches)
+                      .second);
+
+    auto [hash, request] = makeTreeImportRequest(
+        ImportPriority(ImportPriorityKind::High, 0), pendingImportWatches);
+    queue.enqueue(std::move(request));
+    enqueuedTrees.emplace(hash);
+  }
+
+  EXPECT_EQ(10, queue.getQueueDepth(HgImportRequest::BlobImport::kType));
+  EXPECT_EQ(10, queue.getQueueDepth(HgImportRequest::TreeImport::kType));
+  EXPECT_EQ(0, queue.getQueueDepth(HgImportRequest::Prefetch::kType));
+
+  auto dequeued = queue.dequeue(10);
+  ASSERT_EQ(10, dequeued.size());
+  for (auto& request : dequeued) {
+    auto* tree = request.getRequest<HgImportRequest::TreeImport>();
+    ASSERT_NE(nullptr, tree);
+    EXPECT_EQ(1, enqueuedTrees.count(tree->hash));
+  }
+
+  EXPECT_EQ(10, queue.getQueueDepth(HgImportRequest::BlobImport::kType));
+  EXPECT_EQ(0, queue.getQueueDepth(HgImportRequest::TreeImport::kType));
+  EXPECT_EQ(10, queue.dequeue(20).size());
+}
+
+TEST(HgImportRequestQueueTest, waitingRequestsGainPriority) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_hg_import_priority_aging_ms = 1;
+  RequestMetricsScope::RequestWatchList pendingImportWatches;
+
+  auto queue = HgImportRequestQueue{};
+  auto [lowHash, lowRequest] =
+      makeBlobImportRequest(ImportPriority::kLow(), pendingImportWatches);
+  queue.enqueue(std::move(lowRequest));
+
+  // Long enough for the waiting request to gain more than two levels.
+  std::this_thread::sleep_for(20ms);
+  auto [highHash, highRequest] =
+      makeBlobImportRequest(ImportPriority::kHigh(), pendingImportWatches);
+  queue.enqueue(std::move(highRequest));
+
+  EXPECT_EQ(
+      lowHash,
+      queue.dequeue(1).at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+  EXPECT_EQ(
+      highHash,
+      queue.dequeue(1).at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+}
+
+TEST(HgImportRequestQueueTest, busyClientsArePenalized) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_hg_import_client_penalty = 1.0;
+  RequestMetricsScope::RequestWatchList pendingImportWatches;
+
+  auto queue = HgImportRequestQueue{};
+  std::vector<Hash> busyHashes;
+  for (int i = 0; i < 3; i++) {
+    auto [hash, request] = makeBlobImportRequest(
+        ImportPriority::kHigh(), pendingImportWatches, pid_t{100});
+    queue.enqueue(std::move(request));
+    busyHashes.push_back(hash);
+  }
+  auto [quietHash, quietRequest] = makeBlobImportRequest(
+      ImportPriority(ImportPriorityKind::Normal, 1),
+      pendingImportWatches,
+      pid_t{200});
+  queue.enqueue(std::move(quietRequest));
+
+  // Each of the busy client's requests is ranked one level lower than the
+  // one before, so only its first is served before the quiet client's.
+  auto dequeued = queue.dequeue(4);
+  ASSERT_EQ(4, dequeued.size());
+  std::vector<Hash> order;
+  for (auto& request : dequeued) {
+    order.push_back(request.getRequest<HgImportRequest::BlobImport>()->hash);
+  }
+  EXPECT_EQ(
+      (std::vector<Hash>{
+          busyHashes[0], quietHash, busyHashes[1], busyHashes[2]}),
+      order);
+}
+
+TEST(HgImportRequestQueueTest, duplicateRequestsAreCombined) {
+  RequestMetricsScope::RequestWatchList pendingImportWatches;
+
+  auto queue = HgImportRequestQueue{};
+  auto hash = uniqueHash();
+  auto [lowRequest, lowFuture] = HgImportRequest::makeBlobImportRequest(
+      hash,
+      ImportPriority::kLow(),
+      std::make_unique<RequestMetricsScope>(&pendingImportWatches));
+  queue.enqueue(std::move(lowRequest));
+
+  auto [normalHash, normalRequest] =
+      makeBlobImportRequest(ImportPriority::kNormal(), pendingImportWatches);
+  queue.enqueue(std::move(normalRequest));
+
+  auto [highRequest, highFuture] = HgImportRequest::makeBlobImportRequest(
+      hash,
+      ImportPriority::kHigh(),
+      std::make_unique<RequestMetricsScope>(&pendingImportWatches));
+  queue.enqueue(std::move(highRequest));
+
+  EXPECT_EQ(2, queue.getQueueDepth(HgImportRequest::BlobImport::kType));
+
+  // The combined request takes the higher priority.
+  auto dequeued = queue.dequeue(1);
+  ASSERT_EQ(1, dequeued.size());
+  EXPECT_EQ(
+      hash, dequeued.at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+  dequeued.at(0)
+      .getPromise<HgImportRequest::BlobImport::Response>()
+      ->setValue(std::make_unique<Blob>(hash, "contents"_sp));
+
+  auto lowBlob = std::move(lowFuture).get(0ms);
+  auto highBlob = std::move(highFuture).get(0ms);
+  EXPECT_EQ("contents", lowBlob->getContents().clone()->moveToFbString());
+  EXPECT_EQ("contents", highBlob->getContents().clone()->moveToFbString());
+
+  EXPECT_EQ(
+      normalHash,
+      queue.dequeue(5).at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+  EXPECT_EQ(0, queue.getQueueDepth(HgImportRequest::BlobImport::kType));
+}
+
+TEST(HgImportRequestQueueTest, limitsRestrictTypesAndConcurrency) {
+  RequestMetricsScope::RequestWatchList pendingImportWatches;
+
+  auto queue = HgImportRequestQueue{};
+  for (int i = 0; i < 4; i++) {
+    queue.enqueue(makeBlobImportRequest(
+                      ImportPriority(ImportPriorityKind::High, 0),
+                      pendingImportWatches)
+                      .second);
+  }
+  auto [treeHash, treeRequest] = makeTreeImportRequest(
+      ImportPriority(ImportPriorityKind::Low, 0), pendingImportWatches);
+  queue.enqueue(std::move(treeRequest));
+
+  HgImportRequestQueue::Limits limits;
+  limits.batchSizes.fill(1);
+  limits.batchSizes[HgImportRequest::BlobImport::kType] = 2;
+  limits.maxRunning[HgImportRequest::BlobImport::kType] = 1;
+  limits.allowed.fill(true);
+
+  auto blobs = queue.dequeue(limits);
+  ASSERT_EQ(2, blobs.size());
+  EXPECT_TRUE(blobs.at(0).isType<HgImportRequest::BlobImport>());
+
+  // A blob batch is already running, so the less urgent tree comes next.
+  auto trees = queue.dequeue(limits);
+  ASSERT_EQ(1, trees.size());
+  EXPECT_EQ(
+      treeHash, trees.at(0).getRequest<HgImportRequest::TreeImport>()->hash);
+  queue.finish(HgImportRequest::TreeImport::kType);
+
+  // A tree-only worker waits rather than taking a blob.
+  HgImportRequestQueue::Limits treesOnly = limits;
+  treesOnly.allowed.fill(false);
+  treesOnly.allowed[HgImportRequest::TreeImport::kType] = true;
+  std::thread treeWorker(
+      [&] { EXPECT_TRUE(queue.dequeue(treesOnly).empty()); });
+
+  queue.finish(HgImportRequest::BlobImport::kType);
+  EXPECT_EQ(2, queue.dequeue(limits).size());
+  EXPECT_EQ(0, queue.getQueueDepth(HgImportRequest::BlobImport::kType));
+
+  queue.stop();
+  treeWorker.join();
+}
+
+TEST(HgImportRequestQueueTest, untrackedBatchesDoNotCountTowardsLimits) {
+  RequestMetricsScope::RequestWatchList pendingImportWatches;
+
+  auto queue = HgImportRequestQueue{};
+  for (int i = 0; i < 2; i++) {
+    queue.enqueue(makeTreeImportRequest(
+                      ImportPriority(ImportPriorityKind::Normal, 0),
+                      pendingImportWatches)
+                      .second);
+  }
+
+  HgImportRequestQueue::Limits limits;
+  limits.batchSizes.fill(1);
+  limits.maxRunning[HgImportRequest::TreeImport::kType] = 1;
+  limits.allowed.fill(true);
+
+  // A reserved worker's batch leaves the shared limit untouched.
+  HgImportRequestQueue::Limits reserved = limits;
+  reserved.maxRunning.fill(0);
+  reserved.tracked = false;
+  EXPECT_EQ(1, queue.dequeue(reserved).size());
+  EXPECT_EQ(1, queue.dequeue(limits).size());
+  EXPECT_EQ(0, queue.getQueueDepth(HgImportRequest::TreeImport::kType));
+
+  queue.finish(HgImportRequest::TreeImport::kType);
+  queue.stop();
+}
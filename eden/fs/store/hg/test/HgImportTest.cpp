@@ -8,14 +8,17 @@
 #include <folly/experimental/TestUtil.h>
 #include <folly/futures/Future.h>
 #include <folly/test/TestUtils.h>
+#include <gflags/gflags.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/model/Tree.h"
+#include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/hg/HgImportPyError.h"
 #include "eden/fs/store/hg/HgImporter.h"
+#include "eden/fs/store/hg/HgProxyHash.h"
 #include "eden/fs/telemetry/EdenStats.h"
 #include "eden/fs/testharness/HgRepo.h"
 #include "eden/fs/testharness/TestUtil.h"
@@ -25,6 +28,8 @@ using namespace facebook::eden;
 using folly::StringPiece;
 using folly::test::TemporaryDirectory;
 
+DECLARE_uint64(hg_import_max_pending_requests);
+
 namespace {
 
 class HgImportTest : public ::testing::Test {
@@ -77,6 +82,36 @@ TEST_F(HgImportTest, importTest) {
       "no match found");
 }
 
+TEST_F(HgImportTest, pipelinedTreeFetchErrorsKeepTheHelperInSync) {
+  gflags::FlagSaver saver;
+  FLAGS_hg_import_max_pending_requests = 4;
+
+  StringPiece barData = "this is a test file\n";
+  RelativePathPiece filePath{"bar.txt"};
+  repo_.writeFile(filePath, barData);
+  repo_.hg("add");
+  repo_.commit("Initial commit");
+
+  HgImporter importer(repo_.path(), stats_);
+
+  // None of these trees exist, so each request gets an error response.
+  auto localStore = std::make_shared<MemoryLocalStore>();
+  auto writeBatch = localStore->beginWrite();
+  std::vector<HgProxyHash> trees;
+  for (auto name : {"a", "b", "c", "d", "e", "f"}) {
+    auto id = HgProxyHash::store(
+        RelativePathPiece{name}, makeTestHash(name), writeBatch.get());
+    writeBatch->flush();
+    trees.emplace_back(localStore.get(), id, "test");
+  }
+  EXPECT_THROW(importer.fetchTrees(trees), HgImportPyError);
+
+  // All of the responses were read, so the next request gets its own.
+  auto fileHash = repo_.hg("manifest", "--debug").substr(0, 40);
+  auto blob = importer.importFileContents(filePath, Hash{fileHash});
+  EXPECT_BLOB_EQ(blob, barData);
+}
+
 // TODO(T33797958): Check hg_importer_helper's exit code on Windows (in
 // HgImportTest).
 #ifndef _WIN32
@@ -6,7 +6,9 @@
  */
 
 #include <folly/Range.h>
+#include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <memory>
 
@@ -16,6 +18,8 @@
 #include "eden/fs/utils/IDGen.h"
 #include "eden/fs/utils/PathFuncs.h"
 
+DECLARE_uint64(hg_proxy_hash_cache_size);
+
 using namespace facebook::eden;
 
 TEST(HgProxyHashTest, testCopyMove) {
@@ -63,3 +67,29 @@ TEST(HgProxyHashTest, testCopyMove) {
       orig1.revHash(),
       Hash{folly::StringPiece{"0000000000000000000000000000000000000000"}});
 }
+
+TEST(HgProxyHashTest, cachedProxyHashesDoNotNeedTheLocalStore) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_hg_proxy_hash_cache_size = 100;
+
+  auto store = std::make_shared<MemoryLocalStore>();
+  auto revHash =
+      Hash{folly::StringPiece{"2222222222222222222222222222222222222222"}};
+  Hash hash;
+  {
+    auto write = store->beginWrite();
+    hash =
+        HgProxyHash::store(RelativePathPiece{"cached"}, revHash, write.get());
+    write->flush();
+  }
+  store->clearKeySpace(KeySpace::HgProxyHashFamily);
+
+  auto proxyHash = HgProxyHash{store.get(), hash, "test"};
+  EXPECT_EQ(RelativePathPiece{"cached"}, proxyHash.path());
+  EXPECT_EQ(revHash, proxyHash.revHash());
+
+  auto batch = HgProxyHash::getBatch(store.get(), {hash}).get();
+  ASSERT_EQ(1, batch.size());
+  EXPECT_EQ(RelativePathPiece{"cached"}, batch[0].path());
+  EXPECT_EQ(revHash, batch[0].revHash());
+}
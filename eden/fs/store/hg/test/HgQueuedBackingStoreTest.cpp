@@ -61,9 +61,10 @@ struct HgQueuedBackingStoreTest : TestRepo, ::testing::Test {
       localStore.get(),
       stats)};
 
-  std::unique_ptr<HgQueuedBackingStore> makeQueuedStore() {
+  std::unique_ptr<HgQueuedBackingStore> makeQueuedStore(
+      std::shared_ptr<ReloadableConfig> config = nullptr) {
     return std::make_unique<HgQueuedBackingStore>(
-        localStore, stats, std::move(backingStore), 1);
+        localStore, stats, std::move(backingStore), 1, std::move(config));
   }
 };
 
@@ -102,3 +103,25 @@ TEST_F(HgQueuedBackingStoreTest, getBlob) {
     }
   }
 }
+
+TEST_F(HgQueuedBackingStoreTest, pipelinedTreeImport) {
+  auto rawConfig = EdenConfig::createTestEdenConfig();
+  rawConfig->hgPipelinedTreeImport.setValue(true, ConfigSource::CommandLine);
+  auto queuedStore =
+      makeQueuedStore(std::make_shared<ReloadableConfig>(std::move(rawConfig)));
+  auto root = queuedStore->getTreeForCommit(commit1)
+                  .via(&folly::QueuedImmediateExecutor::instance())
+                  .get(kTestTimeout);
+
+  auto foo = queuedStore->getTree(root->getEntryAt("foo"_pc).getHash())
+                 .via(&folly::QueuedImmediateExecutor::instance())
+                 .get(kTestTimeout);
+  ASSERT_EQ(1, foo->getTreeEntries().size());
+  EXPECT_EQ("bar.txt", foo->getEntryAt(0).getName());
+
+  auto src = queuedStore->getTree(root->getEntryAt("src"_pc).getHash())
+                 .via(&folly::QueuedImmediateExecutor::instance())
+                 .get(kTestTimeout);
+  ASSERT_EQ(1, src->getTreeEntries().size());
+  EXPECT_EQ("hello.txt", src->getEntryAt(0).getName());
+}
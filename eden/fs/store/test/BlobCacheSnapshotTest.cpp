@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/BlobCacheSnapshot.h"
+#include <folly/FileUtil.h>
+#include <folly/portability/SysStat.h>
+#include <gtest/gtest.h>
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/store/BlobCache.h"
+
+using namespace folly::literals;
+using namespace facebook::eden;
+
+#ifdef __linux__
+
+namespace {
+const auto hash1 = Hash{"0000000000000000000000000000000000000001"_sp};
+const auto hash2 = Hash{"0000000000000000000000000000000000000002"_sp};
+} // namespace
+
+TEST(BlobCacheSnapshot, round_trips_blobs) {
+  std::vector<std::shared_ptr<const Blob>> blobs{
+      std::make_shared<Blob>(hash1, "first"_sp),
+      std::make_shared<Blob>(hash2, ""_sp)};
+  auto file = writeBlobCacheSnapshot(blobs);
+  ASSERT_TRUE(file);
+
+  auto cache = BlobCache::create(1024, 0);
+  EXPECT_EQ(2, loadBlobCacheSnapshot(file, *cache));
+  auto first = cache->get(hash1).blob;
+  ASSERT_TRUE(first);
+  auto contents = first->getContents().cloneAsValue();
+  EXPECT_EQ("first", contents.moveToFbString());
+  auto second = cache->get(hash2).blob;
+  ASSERT_TRUE(second);
+  EXPECT_EQ(0, second->getSize());
+}
+
+TEST(BlobCacheSnapshot, rejects_truncated_file) {
+  auto file = writeBlobCacheSnapshot(
+      {std::make_shared<Blob>(hash1, "some contents"_sp)});
+  ASSERT_TRUE(file);
+  struct stat st;
+  ASSERT_EQ(0, fstat(file.fd(), &st));
+  ASSERT_EQ(0, folly::ftruncateNoInt(file.fd(), st.st_size - 1));
+
+  auto cache = BlobCache::create(1024, 0);
+  EXPECT_THROW(loadBlobCacheSnapshot(file, *cache), std::runtime_error);
+  EXPECT_FALSE(cache->contains(hash1));
+}
+
+#endif
@@ -258,3 +258,91 @@ TEST(
   handle3.reset();
   EXPECT_TRUE(cache->contains(hash3));
 }
+
+TEST(BlobCache, shards_evict_independently) {
+  // hash3 and hash9 share a shard, and each shard holds 10 bytes.
+  auto cache = BlobCache::create(40, 0, 4);
+  EXPECT_EQ(4, cache->getShardCount());
+  cache->insert(blob3);
+  cache->insert(blob4);
+  cache->insert(blob5);
+  cache->insert(blob6);
+  EXPECT_TRUE(cache->contains(hash3));
+  EXPECT_TRUE(cache->contains(hash4));
+  EXPECT_TRUE(cache->contains(hash5));
+  EXPECT_TRUE(cache->contains(hash6));
+
+  cache->insert(blob9);
+  EXPECT_FALSE(cache->contains(hash3));
+  EXPECT_TRUE(cache->contains(hash4));
+  EXPECT_TRUE(cache->contains(hash5));
+  EXPECT_TRUE(cache->contains(hash6));
+  EXPECT_TRUE(cache->contains(hash9));
+}
+
+TEST(BlobCache, stats_are_summed_over_shards) {
+  auto cache = BlobCache::create(100, 0, 4);
+  cache->insert(blob3);
+  cache->insert(blob4);
+  cache->insert(blob5);
+  EXPECT_TRUE(cache->get(hash3).blob);
+  EXPECT_TRUE(cache->get(hash5).blob);
+  EXPECT_FALSE(cache->get(hash6).blob);
+
+  auto stats = cache->getStats();
+  EXPECT_EQ(3, stats.blobCount);
+  EXPECT_EQ(12, stats.totalSizeInBytes);
+  EXPECT_EQ(2, stats.hitCount);
+  EXPECT_EQ(1, stats.missCount);
+
+  cache->clear();
+  EXPECT_EQ(0, cache->getStats().blobCount);
+  EXPECT_FALSE(cache->contains(hash4));
+}
+
+TEST(BlobCache, tinylfu_only_admits_blobs_requested_more_than_the_victim) {
+  auto cache =
+      BlobCache::create(10, 0, 1, BlobCache::AdmissionPolicy::TinyLfu);
+  cache->insert(blob3);
+  cache->insert(blob4);
+  for (int i = 0; i < 3; ++i) {
+    cache->get(hash3);
+    cache->get(hash4);
+  }
+
+  // blob5 was never requested, so it does not displace blob3.
+  cache->insert(blob5, BlobCache::Interest::WantHandle);
+  EXPECT_FALSE(cache->contains(hash5));
+  EXPECT_TRUE(cache->contains(hash3));
+  EXPECT_TRUE(cache->contains(hash4));
+  EXPECT_EQ(1, cache->getStats().admissionRejectionCount);
+
+  // Once it has been requested more often than blob3, it does.
+  for (int i = 0; i < 5; ++i) {
+    cache->get(hash5);
+  }
+  cache->insert(blob5, BlobCache::Interest::UnlikelyNeededAgain);
+  EXPECT_TRUE(cache->contains(hash5));
+  EXPECT_FALSE(cache->contains(hash3));
+
+  // LikelyNeededAgain bypasses admission.
+  cache->insert(blob6, BlobCache::Interest::LikelyNeededAgain);
+  EXPECT_TRUE(cache->contains(hash6));
+  EXPECT_EQ(1, cache->getStats().admissionRejectionCount);
+}
+
+TEST(BlobCache, most_recently_used_blobs_fit_in_budget) {
+  auto cache = BlobCache::create(100, 0);
+  cache->insert(blob3);
+  cache->insert(blob4);
+  cache->insert(blob5);
+  cache->get(hash3); // blob3 is now the most recently used
+
+  auto blobs = cache->getMostRecentlyUsed(9);
+  ASSERT_EQ(2, blobs.size());
+  EXPECT_EQ(blob3, blobs[0]);
+  EXPECT_EQ(blob5, blobs[1]);
+
+  EXPECT_EQ(3, cache->getMostRecentlyUsed(100).size());
+  EXPECT_EQ(0, cache->getMostRecentlyUsed(2).size());
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/BlobMetadataCache.h"
+#include <gtest/gtest.h>
+
+using namespace folly::literals;
+using namespace facebook::eden;
+
+namespace {
+
+// With two shards, hash1 and hash3 share a shard and hash2 has the other.
+const auto hash1 = Hash{"0000000000000000000000000000000000000001"_sp};
+const auto hash2 = Hash{"0000000000000000000000000000000000000002"_sp};
+const auto hash3 = Hash{"0000000000000000000000000000000000000003"_sp};
+
+const auto sha1 = Hash{"1111111111111111111111111111111111111111"_sp};
+} // namespace
+
+TEST(BlobMetadataCache, returns_what_was_set) {
+  auto cache = BlobMetadataCache::create(10);
+  EXPECT_FALSE(cache->get(hash1));
+  cache->set(hash1, BlobMetadata{sha1, 42});
+  auto metadata = cache->get(hash1);
+  ASSERT_TRUE(metadata);
+  EXPECT_EQ(sha1, metadata->sha1);
+  EXPECT_EQ(42, metadata->size);
+}
+
+TEST(BlobMetadataCache, evicts_least_recently_used) {
+  auto cache = BlobMetadataCache::create(2);
+  cache->set(hash1, BlobMetadata{sha1, 1});
+  cache->set(hash2, BlobMetadata{sha1, 2});
+  EXPECT_TRUE(cache->get(hash1)); // hash2 is now the oldest
+  cache->set(hash3, BlobMetadata{sha1, 3});
+
+  EXPECT_EQ(2, cache->size());
+  EXPECT_TRUE(cache->get(hash1));
+  EXPECT_FALSE(cache->get(hash2));
+  EXPECT_TRUE(cache->get(hash3));
+}
+
+TEST(BlobMetadataCache, shards_evict_independently) {
+  auto cache = BlobMetadataCache::create(2, 2);
+  EXPECT_EQ(2, cache->getShardCount());
+  cache->set(hash1, BlobMetadata{sha1, 1});
+  cache->set(hash2, BlobMetadata{sha1, 2});
+  // hash3 only displaces the entry in its own shard, even though hash2 is
+  // older.
+  cache->set(hash3, BlobMetadata{sha1, 3});
+
+  EXPECT_EQ(2, cache->size());
+  EXPECT_FALSE(cache->get(hash1));
+  EXPECT_TRUE(cache->get(hash2));
+  EXPECT_TRUE(cache->get(hash3));
+
+  cache->clear();
+  EXPECT_EQ(0, cache->size());
+  EXPECT_FALSE(cache->get(hash3));
+}
@@ -65,9 +65,13 @@ class DiffTest : public ::testing::Test {
 
   Future<std::unique_ptr<ScmStatus>> diffCommits(
       StringPiece commit1,
-      StringPiece commit2) {
+      StringPiece commit2,
+      bool batchByLevel = false) {
     return diffCommitsForStatus(
-        store_.get(), makeTestHash(commit1), makeTestHash(commit2));
+        store_.get(),
+        makeTestHash(commit1),
+        makeTestHash(commit2),
+        batchByLevel);
   }
 
   ScmStatus diffCommitsWithGitIgnore(
@@ -465,6 +469,121 @@ TEST_F(DiffTest, loadTreeError) {
       UnorderedElementsAre(Pair("a/b/3.txt", ScmFileStatus::MODIFIED)));
 }
 
+TEST_F(DiffTest, batchedDiffMatchesRecursiveDiff) {
+  FakeTreeBuilder builder;
+
+  builder.setFile("a/b/c/d/e/f.txt", "contents");
+  builder.setFile("a/b/1.txt", "1");
+  builder.setFile("src/main.c", "hello world");
+  builder.setFile("src/foo/a", "regular file");
+  builder.setFile("src/test/test.c", "testing");
+  builder.finalize(backingStore_, /* setReady */ true);
+  backingStore_->putCommit("1", builder)->setReady();
+
+  auto builder2 = builder.clone();
+  builder2.replaceFile("src/main.c", "hello world v2");
+  builder2.removeFile("a/b/c/d/e/f.txt");
+  builder2.replaceFile("a/b/1.txt", "1", /* executable */ true);
+  builder2.removeFile("src/foo/a");
+  builder2.setFile("src/foo/a/b/c.txt", "c");
+  builder2.setFile("src/newdir/b/d.txt", "d");
+  builder2.finalize(backingStore_, /* setReady */ true);
+  backingStore_->putCommit("2", builder2)->setReady();
+
+  for (auto [from, to] : {std::make_pair("1", "2"), std::make_pair("2", "1")}) {
+    auto expected = diffCommits(from, to).get(100ms);
+    auto result = diffCommits(from, to, /* batchByLevel */ true).get(100ms);
+    EXPECT_THAT(result->errors, UnorderedElementsAre());
+    EXPECT_EQ(expected->entries, result->entries);
+  }
+}
+
+TEST_F(DiffTest, batchedDiffFetchesOneLevelAtATime) {
+  FakeTreeBuilder builder;
+
+  builder.setFile("a/b/1.txt", "1");
+  builder.setFile("x/y/2.txt", "2");
+  builder.setFile("same/z/3.txt", "3");
+  builder.finalize(backingStore_, /* setReady */ false);
+  backingStore_->putCommit("1", builder)->setReady();
+
+  auto builder2 = builder.clone();
+  builder2.replaceFile("a/b/1.txt", "new1");
+  builder2.replaceFile("x/y/2.txt", "new2");
+  builder2.finalize(backingStore_, /* setReady */ false);
+  backingStore_->putCommit("2", builder2)->setReady();
+
+  auto resultFuture = diffCommits("1", "2", /* batchByLevel */ true);
+  builder.setReady("");
+  builder2.setReady("");
+  builder.setReady("a");
+  builder2.setReady("a");
+
+  // a/b is not requested until every directory at the level above it, here
+  // x, has been loaded.
+  auto abHash =
+      builder2.getStoredTree(RelativePathPiece{"a/b"})->get().getHash();
+  EXPECT_EQ(0, backingStore_->getAccessCount(abHash));
+  builder.setReady("x");
+  builder2.setReady("x");
+  EXPECT_EQ(1, backingStore_->getAccessCount(abHash));
+
+  builder.setAllReady();
+  builder2.setAllReady();
+  auto result = std::move(resultFuture).get(100ms);
+  EXPECT_THAT(result->errors, UnorderedElementsAre());
+  EXPECT_THAT(
+      result->entries,
+      UnorderedElementsAre(
+          Pair("a/b/1.txt", ScmFileStatus::MODIFIED),
+          Pair("x/y/2.txt", ScmFileStatus::MODIFIED)));
+
+  // Directories with the same hash on both sides are never fetched.
+  auto sameHash =
+      builder.getStoredTree(RelativePathPiece{"same"})->get().getHash();
+  EXPECT_EQ(0, backingStore_->getAccessCount(sameHash));
+}
+
+TEST_F(DiffTest, batchedDiffLoadTreeError) {
+  FakeTreeBuilder builder;
+
+  builder.setFile("a/b/3.txt", "3");
+  builder.setFile("x/y/z/file1.txt", "file1");
+  builder.finalize(backingStore_, /* setReady */ false);
+  backingStore_->putCommit("1", builder)->setReady();
+
+  auto builder2 = builder.clone();
+  builder2.replaceFile("a/b/3.txt", "new3");
+  builder2.setFile("x/y/z/file2.txt", "file2");
+  builder2.finalize(backingStore_, /* setReady */ false);
+  backingStore_->putCommit("2", builder2)->setReady();
+
+  auto resultFuture = diffCommits("1", "2", /* batchByLevel */ true);
+  builder.setReady("");
+  builder2.setReady("");
+  builder.setReady("a");
+  builder2.setReady("a");
+  builder.setReady("x");
+  builder2.setReady("x");
+  builder.setReady("a/b");
+  builder2.setReady("a/b");
+  builder.setReady("x/y");
+  builder2.setReady("x/y");
+  builder2.triggerError("x/y/z", std::runtime_error("oh noes"));
+
+  builder.setAllReady();
+  builder2.setAllReady();
+  auto result = std::move(resultFuture).get(100ms);
+  EXPECT_THAT(
+      result->errors,
+      UnorderedElementsAre(Pair(
+          "x/y/z",
+          folly::exceptionStr(std::runtime_error("oh noes")).c_str())));
+  EXPECT_THAT(
+      result->entries,
+      UnorderedElementsAre(Pair("a/b/3.txt", ScmFileStatus::MODIFIED)));
+}
+
 // Generic test with no ignore files of a an added, modified, and removed file
 TEST_F(DiffTest, nonignored_added_modified_and_removed_files) {
   FakeTreeBuilder builder;
@@ -1209,3 +1328,70 @@ TEST_F(DiffTest, hiddenFolder) {
       result.entries,
       UnorderedElementsAre(std::make_pair("a/c.txt", ScmFileStatus::ADDED)));
 }
+
+TEST_F(DiffTest, prefetchTreeDifferences) {
+  FakeTreeBuilder builder;
+  builder.setFile("src/main.c", "hello world");
+  builder.setFile("src/lib.c", "helper code");
+  builder.setFile("src/util.c", "utilities");
+  builder.setFile("unchanged/a.txt", "a");
+  builder.setFile("unchanged/b.txt", "b");
+  builder.setFile("removed.txt", "removed");
+  builder.finalize(backingStore_, /* setReady */ true);
+
+  auto builder2 = builder.clone();
+  builder2.replaceFile("src/main.c", "hello world v2");
+  builder2.replaceFile("src/lib.c", "helper code v2");
+  builder2.replaceFile("src/util.c", "utilities v2");
+  builder2.setFile("new/dir/one.txt", "1");
+  builder2.setFile("new/dir/two.txt", "2");
+  builder2.removeFile("removed.txt");
+  builder2.finalize(backingStore_, /* setReady */ true);
+
+  auto fromTree = make_shared<const Tree>(builder.getRoot()->get());
+  auto toTree = make_shared<const Tree>(builder2.getRoot()->get());
+
+  // Only the paths that have inodes are walked: the changed files among them
+  // are prefetched, and unchanged or removed ones are not.
+  std::vector<RelativePath> paths{
+      RelativePath{"src"},
+      RelativePath{"src/main.c"},
+      RelativePath{"src/lib.c"},
+      RelativePath{"unchanged"},
+      RelativePath{"unchanged/a.txt"},
+      RelativePath{"removed.txt"}};
+  auto numBlobs = prefetchTreeDifferences(
+                      store_.get(),
+                      ObjectFetchContext::getNullContext(),
+                      fromTree,
+                      toTree,
+                      paths,
+                      /* batchSize */ 1,
+                      ImportPriority::kLow())
+                      .get(100ms);
+  EXPECT_EQ(2, numBlobs);
+
+  std::vector<Hash> prefetched;
+  for (const auto& batch : backingStore_->getPrefetchBatches()) {
+    EXPECT_LE(batch.size(), 1);
+    prefetched.insert(prefetched.end(), batch.begin(), batch.end());
+  }
+  EXPECT_THAT(
+      prefetched,
+      UnorderedElementsAre(
+          builder2.getStoredBlob("src/main.c"_relpath)->get().getHash(),
+          builder2.getStoredBlob("src/lib.c"_relpath)->get().getHash()));
+
+  // Identical trees need nothing.
+  EXPECT_EQ(
+      0,
+      prefetchTreeDifferences(
+          store_.get(),
+          ObjectFetchContext::getNullContext(),
+          toTree,
+          toTree,
+          paths,
+          /* batchSize */ 2,
+          ImportPriority::kLow())
+          .get(100ms));
+}
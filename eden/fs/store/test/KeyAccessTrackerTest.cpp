@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/KeyAccessTracker.h"
+#include <gtest/gtest.h>
+#include <limits>
+
+using namespace folly::literals;
+using namespace facebook::eden;
+
+TEST(KeyAccessTracker, age_counts_generations_since_last_access) {
+  KeyAccessTracker tracker{1024};
+  tracker.recordAccess("key"_sp);
+  EXPECT_EQ(0, tracker.getAge("key"_sp));
+
+  tracker.advance();
+  tracker.advance();
+  EXPECT_EQ(2, tracker.getAge("key"_sp));
+
+  tracker.recordAccess("key"_sp);
+  EXPECT_EQ(0, tracker.getAge("key"_sp));
+}
+
+TEST(KeyAccessTracker, unaccessed_keys_are_oldest) {
+  KeyAccessTracker tracker{1024};
+  tracker.recordAccess("old"_sp);
+  tracker.advance();
+  tracker.advance();
+  EXPECT_GT(tracker.getAge("never"_sp), tracker.getAge("old"_sp));
+}
+
+TEST(KeyAgeHistogram, eviction_age_selects_oldest_fraction) {
+  KeyAgeHistogram histogram;
+  for (uint32_t age = 0; age < 10; ++age) {
+    for (int i = 0; i < 100; ++i) {
+      histogram.add(age, 1);
+    }
+  }
+  EXPECT_EQ(1000, histogram.getTotalWeight());
+  EXPECT_EQ(9, histogram.getEvictionAge(0.1));
+  EXPECT_EQ(5, histogram.getEvictionAge(0.5));
+  EXPECT_EQ(4, histogram.getEvictionAge(0.55));
+
+  // Keys accessed in the current generation are never evicted.
+  EXPECT_EQ(1, histogram.getEvictionAge(1.0));
+
+  EXPECT_EQ(
+      std::numeric_limits<uint32_t>::max(), histogram.getEvictionAge(0.0));
+}
+
+TEST(KeyAgeHistogram, eviction_age_ignores_empty_buckets) {
+  // Far more buckets than keys, so nearly every bucket was never accessed
+  // and looks older than any key.
+  KeyAccessTracker tracker{1024};
+  for (int i = 0; i < 10; ++i) {
+    tracker.recordAccess(folly::StringPiece{std::to_string(i)});
+  }
+  tracker.advance();
+  tracker.advance();
+  tracker.advance();
+  for (int i = 0; i < 10; i += 2) {
+    tracker.recordAccess(folly::StringPiece{std::to_string(i)});
+  }
+
+  KeyAgeHistogram histogram;
+  for (int i = 0; i < 10; ++i) {
+    histogram.add(tracker.getAge(folly::StringPiece{std::to_string(i)}), 1);
+  }
+  EXPECT_EQ(3, histogram.getEvictionAge(0.5));
+}
+
+TEST(KeyAgeHistogram, eviction_age_is_weighted) {
+  KeyAgeHistogram histogram;
+  histogram.add(5, 10);
+  histogram.add(3, 1000);
+  histogram.add(0, 10);
+  // The oldest keys are too small to free a quarter of the space.
+  EXPECT_EQ(3, histogram.getEvictionAge(0.25));
+  EXPECT_EQ(5, histogram.getEvictionAge(0.005));
+  EXPECT_EQ(1, histogram.getEvictionAge(1.0));
+}
+
+TEST(KeyAgeHistogram, empty_histogram_evicts_nothing) {
+  KeyAgeHistogram histogram;
+  EXPECT_EQ(
+      std::numeric_limits<uint32_t>::max(), histogram.getEvictionAge(0.5));
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <folly/Random.h>
+#include <folly/init/Init.h>
+#include <gflags/gflags.h>
+#include <inttypes.h>
+#include <vector>
+#include "eden/fs/benchharness/AllocationCounter.h"
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/store/MemoryLocalStore.h"
+
+using namespace facebook::eden;
+
+DEFINE_uint64(trees, 1000, "Trees stored before the measurements start");
+DEFINE_uint64(entries_per_tree, 50, "Entries in each stored tree");
+DEFINE_uint64(ops, 100000, "Lookups made for each measurement");
+
+namespace {
+
+std::vector<Hash> putTrees(LocalStore& store) {
+  std::vector<Hash> hashes;
+  hashes.reserve(FLAGS_trees);
+  for (uint64_t t = 0; t < FLAGS_trees; ++t) {
+    std::vector<TreeEntry> entries;
+    entries.reserve(FLAGS_entries_per_tree);
+    for (uint64_t e = 0; e < FLAGS_entries_per_tree; ++e) {
+      auto name = folly::to<std::string>("entry", e);
+      auto path = folly::to<std::string>(t, "/", name);
+      entries.emplace_back(
+          Hash::sha1(folly::ByteRange{folly::StringPiece{path}}),
+          folly::StringPiece{name},
+          e % 4 ? TreeEntryType::REGULAR_FILE : TreeEntryType::TREE);
+    }
+    Tree tree{std::move(entries)};
+    hashes.push_back(store.putTree(&tree));
+  }
+  return hashes;
+}
+
+/**
+ * Times LocalStore::getTree() against a MemoryLocalStore, with and without
+ * decoding every entry of the result, and counts the allocations each call
+ * makes.
+ */
+void benchmarkGetTree(
+    LocalStore& store,
+    const std::vector<Hash>& hashes,
+    bool decodeEntries,
+    BenchmarkReport& report) {
+  auto name = decodeEntries ? "LocalStore::getTree + getTreeEntries"
+                            : "LocalStore::getTree";
+  auto& latency = report.metric(name, "ns");
+  AllocationAccumulator allocations;
+  for (uint64_t i = 0; i < FLAGS_ops; ++i) {
+    const auto& hash = hashes[folly::Random::rand64(hashes.size())];
+    auto start = getTime();
+    {
+      AllocationScope scope{allocations};
+      auto tree = store.getTree(hash).get();
+      if (decodeEntries) {
+        tree->getTreeEntries();
+      }
+    }
+    latency.add(getTime() - start);
+  }
+  allocations.addTo(report, name);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv);
+
+  if (FLAGS_trees == 0) {
+    fprintf(stderr, "--trees must be nonzero\n");
+    return 1;
+  }
+
+  MemoryLocalStore store;
+  auto hashes = putTrees(store);
+  printf(
+      "Stored %" PRIu64 " trees of %" PRIu64 " entries\n",
+      FLAGS_trees,
+      FLAGS_entries_per_tree);
+
+  return runBenchmark("local_store", [&](BenchmarkReport& report) {
+    benchmarkGetTree(store, hashes, /*decodeEntries=*/false, report);
+    benchmarkGetTree(store, hashes, /*decodeEntries=*/true, report);
+  });
+}
@@ -9,6 +9,15 @@
 #include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/SqliteLocalStore.h"
 
+#include <gflags/gflags.h>
+
+namespace facebook {
+namespace eden {
+DECLARE_bool(localStoreIndexedTrees);
+DECLARE_uint64(localStoreBlobChunkSize);
+} // namespace eden
+} // namespace facebook
+
 namespace {
 
 using namespace facebook::eden;
@@ -26,6 +35,18 @@ LocalStoreImplResult makeSqliteLocalStore(FaultInjector*) {
   return {std::move(tempDir), std::move(store)};
 }
 
+LocalStoreImplResult makeTunedSqliteLocalStore(FaultInjector*) {
+  auto tempDir = makeTempDir();
+  SqliteOptions options;
+  options.mmapSize = 1 << 20;
+  options.cacheSize = 1 << 20;
+  auto store = std::make_unique<SqliteLocalStore>(
+      AbsolutePathPiece{tempDir.path().string()} + "sqlite"_pc,
+      options,
+      /*readConnectionCount=*/1);
+  return {std::move(tempDir), std::move(store)};
+}
+
 TEST_P(LocalStoreTest, testReadAndWriteBlob) {
   Hash hash{"3a8f8eb91101860fd8484154885838bf322964d0"};
 
@@ -57,6 +78,47 @@ TEST_P(LocalStoreTest, testReadNonexistent) {
   EXPECT_FALSE(retreivedMetadata.has_value());
 }
 
+TEST_P(LocalStoreTest, testReadAndWriteChunkedBlob) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_localStoreBlobChunkSize = 4;
+
+  Hash hash{"3a8f8eb91101860fd8484154885838bf322964d0"};
+  StringPiece contents{"0123456789abcdefghij"};
+  auto inBlob = Blob{hash, contents};
+  store_->putBlob(hash, &inBlob);
+
+  auto outBlob = store_->getBlob(hash).get(10s);
+  ASSERT_TRUE(outBlob);
+  EXPECT_EQ(contents.size(), outBlob->getSize());
+  EXPECT_EQ(
+      contents, outBlob->getContents().clone()->moveToFbString().toStdString());
+
+  auto readRange = [&](uint64_t offset, size_t length) {
+    auto range = store_->getBlobRange(hash, offset, length).get(10s);
+    EXPECT_TRUE(range);
+    return range ? range->moveToFbString().toStdString() : std::string{};
+  };
+  EXPECT_EQ("0123", readRange(0, 4));
+  EXPECT_EQ("3456789a", readRange(3, 8));
+  EXPECT_EQ("ij", readRange(18, 100));
+  EXPECT_EQ("", readRange(20, 4));
+}
+
+TEST_P(LocalStoreTest, testBlobRangeRequiresChunks) {
+  gflags::FlagSaver flagSaver;
+
+  Hash hash{"3a8f8eb91101860fd8484154885838bf322964d0"};
+  auto blob = Blob{hash, "0123456789abcdefghij"_sp};
+  store_->putBlob(hash, &blob);
+
+  FLAGS_localStoreBlobChunkSize = 4;
+  EXPECT_TRUE(nullptr == store_->getBlobRange(hash, 0, 4).get(10s))
+      << "blobs written before chunking was enabled are read whole";
+
+  Hash missing{"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"};
+  EXPECT_TRUE(nullptr == store_->getBlobRange(missing, 0, 4).get(10s));
+}
+
 TEST_P(LocalStoreTest, testReadsAndWriteTree) {
   using folly::unhexlify;
   using std::string;
@@ -113,6 +175,31 @@ TEST_P(LocalStoreTest, testReadsAndWriteTree) {
   EXPECT_EQ(TreeEntryType::REGULAR_FILE, readmeEntry.getType());
 }
 
+TEST_P(LocalStoreTest, testReadAndWriteIndexedTree) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_localStoreIndexedTrees = true;
+
+  Hash hash("8e073e366ed82de6465d1209d3f07da7eebabb93");
+  Hash fileHash("3a8f8eb91101860fd8484154885838bf322964d0");
+  Hash dirHash("e95798e17f694c227b7a8441cc5c7dae50a187d0");
+  std::vector<TreeEntry> entries;
+  entries.emplace_back(
+      fileHash, "README.md", TreeEntryType::REGULAR_FILE, 7, fileHash);
+  entries.emplace_back(dirHash, "lib", TreeEntryType::TREE);
+  Tree original{std::move(entries), hash};
+
+  EXPECT_EQ(hash, store_->putTree(&original));
+  auto tree = store_->getTree(hash).get(10s);
+  ASSERT_TRUE(tree);
+  EXPECT_EQ(original, *tree);
+
+  auto* readme = tree->getEntryPtr("README.md"_pc);
+  ASSERT_NE(nullptr, readme);
+  EXPECT_EQ(7, readme->getSize().value())
+      << "unlike git trees, indexed trees keep the entry metadata";
+  EXPECT_EQ(fileHash, readme->getContentSha1().value());
+}
+
 TEST_P(LocalStoreTest, testGetResult) {
   StringPiece key1 = "foo";
   StringPiece key2 = "bar";
@@ -130,6 +217,38 @@ TEST_P(LocalStoreTest, testGetResult) {
   EXPECT_THROW(result2.piece(), std::domain_error);
 }
 
+TEST_P(LocalStoreTest, testLargeResultOutlivesStore) {
+  std::string value(64 * 1024, 'x');
+  store_->put(KeySpace::BlobFamily, "big"_sp, StringPiece{value});
+
+  auto result = store_->get(KeySpace::BlobFamily, "big"_sp);
+  ASSERT_TRUE(result.isValid());
+  EXPECT_EQ(value, result.piece());
+  auto buf = result.extractIOBuf();
+  EXPECT_FALSE(result.isValid());
+
+  // Values handed out without a copy must stay readable after the store that
+  // returned them has been closed.
+  store_->close();
+  EXPECT_EQ(value, buf.moveToFbString().toStdString());
+}
+
+TEST_P(LocalStoreTest, testGetBatch) {
+  store_->put(KeySpace::BlobFamily, "key1"_sp, "blob1"_sp);
+  store_->put(KeySpace::BlobFamily, "key3"_sp, "blob3"_sp);
+  store_->put(KeySpace::TreeFamily, "key2"_sp, "tree2"_sp);
+
+  std::vector<folly::ByteRange> keys{
+      folly::ByteRange{"key1"_sp},
+      folly::ByteRange{"key2"_sp},
+      folly::ByteRange{"key3"_sp}};
+  auto results = store_->getBatch(KeySpace::BlobFamily, keys).get(10s);
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ("blob1", results[0].piece());
+  EXPECT_FALSE(results[1].isValid()) << "key2 is in another key space";
+  EXPECT_EQ("blob3", results[2].piece());
+}
+
 TEST_P(LocalStoreTest, testMultipleBlobWriters) {
   StringPiece key1_1 = "foo";
   StringPiece key1_2 = "bar";
@@ -196,6 +315,6 @@ INSTANTIATE_TEST_CASE_P(
 INSTANTIATE_TEST_CASE_P(
     Sqlite,
     LocalStoreTest,
-    ::testing::Values(makeSqliteLocalStore));
+    ::testing::Values(makeSqliteLocalStore, makeTunedSqliteLocalStore));
 
 } // namespace
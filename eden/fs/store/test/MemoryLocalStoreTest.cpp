@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/MemoryLocalStore.h"
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+using namespace folly::literals;
+using folly::StringPiece;
+
+namespace {
+std::string makeKey(size_t i) {
+  return folly::to<std::string>("key", i);
+}
+} // namespace
+
+TEST(MemoryLocalStore, evicts_oldest_ephemeral_keys_past_maximum_size) {
+  constexpr size_t kValueSize = 1000;
+  constexpr size_t kCount = 1000;
+  const std::string value(kValueSize, 'x');
+  // Room for about a tenth of the values.
+  auto store = std::make_shared<MemoryLocalStore>(kCount * kValueSize / 10);
+
+  for (size_t i = 0; i < kCount; ++i) {
+    store->put(
+        KeySpace::BlobFamily, StringPiece{makeKey(i)}, StringPiece{value});
+  }
+
+  EXPECT_LE(store->getTotalSize(), kCount * kValueSize / 10);
+  EXPECT_FALSE(store->hasKey(KeySpace::BlobFamily, StringPiece{makeKey(0)}));
+  EXPECT_TRUE(
+      store->hasKey(KeySpace::BlobFamily, StringPiece{makeKey(kCount - 1)}));
+}
+
+TEST(MemoryLocalStore, never_evicts_persistent_keys) {
+  const std::string value(1000, 'x');
+  auto store = std::make_shared<MemoryLocalStore>(1000);
+
+  for (size_t i = 0; i < 100; ++i) {
+    store->put(
+        KeySpace::HgProxyHashFamily,
+        StringPiece{makeKey(i)},
+        StringPiece{value});
+  }
+
+  for (size_t i = 0; i < 100; ++i) {
+    EXPECT_TRUE(
+        store->hasKey(KeySpace::HgProxyHashFamily, StringPiece{makeKey(i)}));
+  }
+}
+
+TEST(MemoryLocalStore, write_batch_spans_shards) {
+  auto store = std::make_shared<MemoryLocalStore>();
+  auto batch = store->beginWrite();
+  for (size_t i = 0; i < 100; ++i) {
+    batch->put(KeySpace::TreeFamily, StringPiece{makeKey(i)}, "tree"_sp);
+  }
+  EXPECT_FALSE(store->hasKey(KeySpace::TreeFamily, StringPiece{makeKey(0)}));
+  batch->flush();
+
+  for (size_t i = 0; i < 100; ++i) {
+    EXPECT_EQ(
+        "tree",
+        store->get(KeySpace::TreeFamily, StringPiece{makeKey(i)}).piece());
+  }
+}
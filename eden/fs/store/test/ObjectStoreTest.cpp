@@ -7,14 +7,22 @@
 
 #include <folly/executors/QueuedImmediateExecutor.h>
 #include <folly/test/TestUtils.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
 #include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/store/TreeCache.h"
 #include "eden/fs/testharness/FakeBackingStore.h"
 #include "eden/fs/testharness/LoggingFetchContext.h"
 #include "eden/fs/testharness/StoredObject.h"
 
+namespace facebook {
+namespace eden {
+DECLARE_bool(coalesceObjectStoreImports);
+} // namespace eden
+} // namespace facebook
+
 using namespace facebook::eden;
 using namespace folly::string_piece_literals;
 using namespace std::chrono_literals;
@@ -97,6 +105,20 @@ TEST_F(ObjectStoreTest, getTree_tracks_second_read_from_cache) {
   EXPECT_EQ(ObjectFetchContext::FromDiskCache, request.origin);
 }
 
+TEST_F(ObjectStoreTest, getTree_tracks_second_read_from_tree_cache) {
+  objectStore = ObjectStore::create(
+      localStore,
+      backingStore,
+      stats,
+      executor,
+      TreeCache::create(1024 * 1024, 0));
+  objectStore->getTree(readyTreeId, context).get(0ms);
+  objectStore->getTree(readyTreeId, context).get(0ms);
+  ASSERT_EQ(2, context.requests.size());
+  EXPECT_EQ(ObjectFetchContext::FromBackingStore, context.requests[0].origin);
+  EXPECT_EQ(ObjectFetchContext::FromMemoryCache, context.requests[1].origin);
+}
+
 TEST_F(ObjectStoreTest, getBlobSize_tracks_backing_store_read) {
   objectStore->getBlobSize(readyBlobId, context).get(0ms);
   ASSERT_EQ(1, context.requests.size());
@@ -116,6 +138,26 @@ TEST_F(ObjectStoreTest, getBlobSize_tracks_second_read_from_cache) {
   EXPECT_EQ(ObjectFetchContext::FromMemoryCache, request.origin);
 }
 
+TEST_F(ObjectStoreTest, blob_metadata_cache_is_shared_between_stores) {
+  auto metadataCache = ObjectStore::createMetadataCache();
+  objectStore = ObjectStore::create(
+      localStore, backingStore, stats, executor, nullptr, metadataCache);
+  // A store for another mount, which doesn't share the LocalStore.
+  auto otherStore = ObjectStore::create(
+      std::make_shared<MemoryLocalStore>(),
+      backingStore,
+      stats,
+      executor,
+      nullptr,
+      metadataCache);
+
+  objectStore->getBlobSize(readyBlobId, context).get(0ms);
+  EXPECT_EQ(9, otherStore->getBlobSize(readyBlobId, context).get(0ms));
+  ASSERT_EQ(2, context.requests.size());
+  EXPECT_EQ(ObjectFetchContext::FromBackingStore, context.requests[0].origin);
+  EXPECT_EQ(ObjectFetchContext::FromMemoryCache, context.requests[1].origin);
+}
+
 TEST_F(ObjectStoreTest, getBlobSizeFromLocalStore) {
   auto data = "A"_sp;
   Hash id = putReadyBlob(data);
@@ -172,3 +214,62 @@ TEST_F(ObjectStoreTest, get_size_and_sha1_only_imports_blob_once) {
 
   EXPECT_EQ(1, backingStore->getAccessCount(readyBlobId));
 }
+
+TEST_F(ObjectStoreTest, blob_metadata_is_fetched_without_the_blob) {
+  auto* storedBlob = backingStore->putBlob("metadataonly"_sp);
+  auto id = storedBlob->get().getHash();
+  auto sha1 = Hash::sha1("metadataonly"_sp);
+  backingStore->putBlobMetadata(id, BlobMetadata{sha1, 12});
+
+  EXPECT_EQ(sha1, objectStore->getBlobSha1(id, context).get(0ms));
+  EXPECT_EQ(12, objectStore->getBlobSize(id, context).get(0ms));
+  EXPECT_EQ(0, backingStore->getAccessCount(id));
+  EXPECT_FALSE(localStore->hasKey(KeySpace::BlobFamily, id));
+
+  // The metadata was saved, so a new ObjectStore finds it locally.
+  auto otherStore =
+      ObjectStore::create(localStore, backingStore, stats, executor);
+  EXPECT_EQ(sha1, otherStore->getBlobSha1(id, context).get(0ms));
+}
+
+TEST_F(ObjectStoreTest, prefetch_blob_metadata_skips_blobs_with_metadata) {
+  auto* storedBlob = backingStore->putBlob("metadataonly"_sp);
+  auto id = storedBlob->get().getHash();
+  backingStore->putBlobMetadata(
+      id, BlobMetadata{Hash::sha1("metadataonly"_sp), 12});
+
+  objectStore->prefetchBlobMetadata({id, readyBlobId}, context).get(0ms);
+  auto batches = backingStore->getPrefetchBatches();
+  ASSERT_EQ(1, batches.size());
+  EXPECT_EQ(std::vector<Hash>{readyBlobId}, batches[0]);
+  EXPECT_EQ(12, objectStore->getBlobSize(id, context).get(0ms));
+}
+
+TEST_F(ObjectStoreTest, concurrent_imports_of_the_same_object_are_coalesced) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_coalesceObjectStoreImports = true;
+
+  auto* storedBlob = backingStore->putBlob("pendingblob"_sp);
+  auto blobId = storedBlob->get().getHash();
+  auto* storedTree = backingStore->putTree({});
+  auto treeId = storedTree->get().getHash();
+
+  auto blobFuture1 = objectStore->getBlob(blobId, context);
+  auto blobFuture2 = objectStore->getBlob(blobId, context);
+  auto sizeFuture = objectStore->getBlobSize(blobId, context);
+  auto treeFuture1 = objectStore->getTree(treeId, context);
+  auto treeFuture2 = objectStore->getTree(treeId, context);
+  EXPECT_EQ(1, backingStore->getAccessCount(blobId));
+  EXPECT_EQ(1, backingStore->getAccessCount(treeId));
+
+  storedBlob->setReady();
+  storedTree->setReady();
+  auto blob = std::move(blobFuture1).get(0ms);
+  EXPECT_EQ(blob, std::move(blobFuture2).get(0ms));
+  EXPECT_EQ(11, std::move(sizeFuture).get(0ms));
+  EXPECT_EQ(std::move(treeFuture1).get(0ms), std::move(treeFuture2).get(0ms));
+
+  // Once the import has finished, the objects come from the local store.
+  objectStore->getBlob(blobId, context).get(0ms);
+  EXPECT_EQ(1, backingStore->getAccessCount(blobId));
+}
@@ -5,6 +5,7 @@
  * GNU General Public License version 2.
  */
 
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/store/RocksDbLocalStore.h"
 #include "eden/fs/store/test/LocalStoreTest.h"
 #include "eden/fs/telemetry/NullStructuredLogger.h"
@@ -18,7 +19,8 @@ LocalStoreImplResult makeRocksDbLocalStore(FaultInjector* faultInjector) {
   auto store = std::make_unique<RocksDbLocalStore>(
       AbsolutePathPiece{tempDir.path().string()},
       std::make_shared<NullStructuredLogger>(),
-      faultInjector);
+      faultInjector,
+      *EdenConfig::createTestEdenConfig());
   return {std::move(tempDir), std::move(store)};
 }
 
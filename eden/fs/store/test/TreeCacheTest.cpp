@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/TreeCache.h"
+#include <gtest/gtest.h>
+#include "eden/fs/model/Tree.h"
+
+using namespace folly::literals;
+using namespace facebook::eden;
+
+namespace {
+
+const auto hash1 = Hash{"0000000000000000000000000000000000000001"_sp};
+const auto hash2 = Hash{"0000000000000000000000000000000000000002"_sp};
+const auto hash3 = Hash{"0000000000000000000000000000000000000003"_sp};
+
+// Empty trees all have the same size, which keeps the arithmetic simple.
+
+const auto tree1 =
+    std::make_shared<const Tree>(std::vector<TreeEntry>{}, hash1);
+const auto tree2 =
+    std::make_shared<const Tree>(std::vector<TreeEntry>{}, hash2);
+const auto tree3 =
+    std::make_shared<const Tree>(std::vector<TreeEntry>{}, hash3);
+const auto treeSize = tree1->getSizeBytes();
+} // namespace
+
+TEST(TreeCache, evicts_least_recently_used_on_insertion) {
+  auto cache = TreeCache::create(2 * treeSize, 0);
+  cache->insert(tree1);
+  cache->insert(tree2);
+  EXPECT_EQ(tree1, cache->get(hash1)); // tree2 is now the oldest
+  cache->insert(tree3);
+
+  EXPECT_EQ(2 * treeSize, cache->getStats().totalSizeInBytes);
+  EXPECT_EQ(tree1, cache->get(hash1));
+  EXPECT_EQ(nullptr, cache->get(hash2));
+  EXPECT_EQ(tree3, cache->get(hash3));
+  EXPECT_EQ(1, cache->getStats().evictionCount);
+}
+
+TEST(TreeCache, preserves_minimum_number_of_entries) {
+  auto cache = TreeCache::create(1, 2);
+  cache->insert(tree1);
+  cache->insert(tree2);
+  cache->insert(tree3);
+
+  EXPECT_EQ(2, cache->getStats().treeCount);
+  EXPECT_FALSE(cache->contains(hash1));
+  EXPECT_TRUE(cache->contains(hash2));
+  EXPECT_TRUE(cache->contains(hash3));
+}
+
+TEST(TreeCache, inserting_existing_tree_does_not_double_count) {
+  auto cache = TreeCache::create(10 * treeSize, 0);
+  cache->insert(tree1);
+  cache->insert(tree1);
+  EXPECT_EQ(1, cache->getStats().treeCount);
+  EXPECT_EQ(treeSize, cache->getStats().totalSizeInBytes);
+}
+
+TEST(TreeCache, counts_hits_and_misses) {
+  auto cache = TreeCache::create(10 * treeSize, 0);
+  cache->insert(tree1);
+  cache->get(hash1);
+  cache->get(hash2);
+  cache->get(hash1);
+
+  auto stats = cache->getStats();
+  EXPECT_EQ(2, stats.hitCount);
+  EXPECT_EQ(1, stats.missCount);
+}
+
+TEST(TreeCache, clear_evicts_everything) {
+  auto cache = TreeCache::create(10 * treeSize, 0);
+  cache->insert(tree1);
+  cache->insert(tree2);
+  cache->clear();
+  EXPECT_EQ(0, cache->getStats().treeCount);
+  EXPECT_EQ(0, cache->getStats().totalSizeInBytes);
+  EXPECT_FALSE(cache->get(hash1));
+}
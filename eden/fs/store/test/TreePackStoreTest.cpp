@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/TreePackStore.h"
+#include <boost/filesystem.hpp>
+#include <folly/FileUtil.h>
+#include <gtest/gtest.h>
+#include "eden/fs/testharness/TempFile.h"
+
+using namespace facebook::eden;
+using namespace folly::literals;
+
+namespace {
+const auto hash1 = Hash{"0000000000000000000000000000000000000001"_sp};
+const auto hash2 = Hash{"0000000000000000000000000000000000000002"_sp};
+const auto hash3 = Hash{"0000000000000000000000000000000000000003"_sp};
+
+AbsolutePath packDir(const folly::test::TemporaryDirectory& tempDir) {
+  return AbsolutePath{tempDir.path().string()} + "packs"_pc;
+}
+} // namespace
+
+TEST(TreePackStoreTest, staged_trees_are_readable_before_flush) {
+  auto tempDir = makeTempDir();
+  TreePackStore packs{packDir(tempDir), 1000};
+  packs.put(hash1, "one"_sp);
+  EXPECT_EQ("one", packs.get(hash1).value());
+  EXPECT_FALSE(packs.get(hash2).has_value());
+
+  auto stats = packs.getStats();
+  EXPECT_EQ(0, stats.packCount);
+  EXPECT_EQ(1, stats.pendingCount);
+  EXPECT_EQ(3, stats.pendingBytes);
+}
+
+TEST(TreePackStoreTest, packs_are_written_at_size_target_and_reopened) {
+  auto tempDir = makeTempDir();
+  {
+    TreePackStore packs{packDir(tempDir), 6};
+    packs.put(hash2, "two"_sp);
+    packs.put(hash1, "one"_sp);
+    EXPECT_EQ(1, packs.getStats().packCount);
+    EXPECT_EQ(0, packs.getStats().pendingCount);
+    // The destructor writes out the remaining staged tree.
+    packs.put(hash3, "three"_sp);
+  }
+
+  TreePackStore packs{packDir(tempDir), 6};
+  EXPECT_EQ(2, packs.getStats().packCount);
+  EXPECT_EQ("one", packs.get(hash1).value());
+  EXPECT_EQ("two", packs.get(hash2).value());
+  EXPECT_EQ("three", packs.get(hash3).value());
+}
+
+TEST(TreePackStoreTest, gc_removes_oldest_packs) {
+  auto tempDir = makeTempDir();
+  TreePackStore packs{packDir(tempDir), 1000};
+  packs.put(hash1, "one"_sp);
+  packs.flush();
+  packs.put(hash2, "two"_sp);
+  packs.flush();
+
+  auto stats = packs.getStats();
+  EXPECT_EQ(2, stats.packCount);
+  EXPECT_EQ(1, packs.collectGarbage(stats.packBytes - 1));
+  EXPECT_FALSE(packs.get(hash1).has_value());
+  EXPECT_EQ("two", packs.get(hash2).value());
+
+  packs.clear();
+  EXPECT_EQ(0, packs.getStats().packCount);
+  EXPECT_FALSE(packs.get(hash2).has_value());
+}
+
+TEST(TreePackStoreTest, unreadable_packs_are_removed_on_open) {
+  auto tempDir = makeTempDir();
+  auto dir = packDir(tempDir);
+  {
+    TreePackStore packs{dir, 1000};
+    packs.put(hash1, "one"_sp);
+  }
+  auto badPack = dir + "255.treepack"_pc;
+  folly::writeFile("garbage"_sp, badPack.c_str());
+
+  TreePackStore packs{dir, 1000};
+  EXPECT_EQ(1, packs.getStats().packCount);
+  EXPECT_EQ("one", packs.get(hash1).value());
+  EXPECT_FALSE(boost::filesystem::exists(badPack.c_str()));
+}
@@ -97,8 +97,11 @@ TakeoverData takeoverMounts(
   auto& message = expectedMessage.value();
 
   auto data = TakeoverData::deserialize(&message.data);
-  // Add 2 here for the lock file and the thrift socket
-  if (data.mountPoints.size() + 2 != message.files.size()) {
+  // Add 2 here for the lock file and the thrift socket.  Version 6 servers
+  // may also send a BlobCache snapshot after the FUSE FDs.
+  auto mountFileCount = data.mountPoints.size() + 2;
+  if (message.files.size() != mountFileCount &&
+      message.files.size() != mountFileCount + 1) {
     throw std::runtime_error(folly::to<string>(
         "received ",
         data.mountPoints.size(),
@@ -112,6 +115,9 @@ TakeoverData takeoverMounts(
     auto& mountInfo = data.mountPoints[n];
     mountInfo.fuseFD = std::move(message.files[n + 2]);
   }
+  if (message.files.size() > mountFileCount) {
+    data.blobCacheFile = std::move(message.files[mountFileCount]);
+  }
 
   return data;
 }
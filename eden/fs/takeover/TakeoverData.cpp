@@ -8,9 +8,12 @@
 #include "eden/fs/takeover/TakeoverData.h"
 
 #include <folly/Format.h>
+#include <folly/Varint.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
+#include <exception>
+#include <thread>
 
 #include "eden/fs/utils/Bug.h"
 
@@ -24,7 +27,76 @@ namespace eden {
 const std::set<int32_t> kSupportedTakeoverVersions{
     TakeoverData::kTakeoverProtocolVersionOne,
     TakeoverData::kTakeoverProtocolVersionThree,
-    TakeoverData::kTakeoverProtocolVersionFour};
+    TakeoverData::kTakeoverProtocolVersionFour,
+    TakeoverData::kTakeoverProtocolVersionFive,
+    TakeoverData::kTakeoverProtocolVersionSix};
+
+namespace {
+void appendVarint(std::string& out, uint64_t value) {
+  uint8_t buf[folly::kMaxVarintLength64];
+  auto size = folly::encodeVarint(value, buf);
+  out.append(reinterpret_cast<const char*>(buf), size);
+}
+
+uint64_t readVarint(folly::ByteRange& data) {
+  auto value = folly::tryDecodeVarint(data);
+  if (!value) {
+    throw std::runtime_error("invalid varint in compact inode map");
+  }
+  return value.value();
+}
+
+folly::StringPiece readBytes(folly::ByteRange& data, uint64_t size) {
+  if (data.size() < size) {
+    throw std::runtime_error("truncated compact inode map");
+  }
+  auto bytes = data.subpiece(0, size);
+  data.advance(size);
+  return folly::StringPiece{bytes};
+}
+
+/**
+ * Fill in everything but the inode map of a mount.
+ */
+SerializedMountInfo serializeMountInfo(const TakeoverData::MountInfo& mount) {
+  SerializedMountInfo serializedMount;
+
+  serializedMount.mountPath = mount.mountPath.stringPiece().str();
+  serializedMount.stateDirectory = mount.stateDirectory.stringPiece().str();
+
+  for (const auto& bindMount : mount.bindMounts) {
+    serializedMount.bindMountPaths.push_back(bindMount.stringPiece().str());
+  }
+
+  // Stuffing the fuse connection information in as a binary
+  // blob because we know that the endianness of the target
+  // machine must match the current system for a graceful
+  // takeover, and it saves us from re-encoding an operating
+  // system specific struct into a thrift file.
+  serializedMount.connInfo = std::string{
+      reinterpret_cast<const char*>(&mount.connInfo), sizeof(mount.connInfo)};
+  return serializedMount;
+}
+
+TakeoverData::MountInfo deserializeMountInfo(
+    SerializedMountInfo& serializedMount,
+    SerializedInodeMap&& inodeMap) {
+  const auto* connInfo =
+      reinterpret_cast<const fuse_init_out*>(serializedMount.connInfo.data());
+
+  std::vector<AbsolutePath> bindMounts;
+  for (const auto& path : serializedMount.bindMountPaths) {
+    bindMounts.emplace_back(AbsolutePathPiece{path});
+  }
+
+  return TakeoverData::MountInfo{AbsolutePath{serializedMount.mountPath},
+                                 AbsolutePath{serializedMount.stateDirectory},
+                                 std::move(bindMounts),
+                                 folly::File{},
+                                 *connInfo,
+                                 std::move(inodeMap)};
+}
+} // namespace
 
 std::optional<int32_t> TakeoverData::computeCompatibleVersion(
     const std::set<int32_t>& versions,
@@ -53,6 +125,10 @@ IOBuf TakeoverData::serialize(int32_t protocolVersion) {
     case kTakeoverProtocolVersionFour:
       // versions 3 and 4 use the same data serialization
       return serializeVersion3();
+    case kTakeoverProtocolVersionFive:
+    case kTakeoverProtocolVersionSix:
+      // version 6 only differs from 5 in the file descriptors it sends
+      return serializeVersion5();
     default: {
       EDEN_BUG() << "asked to serialize takeover data in unsupported format "
                  << protocolVersion;
@@ -72,7 +148,9 @@ folly::IOBuf TakeoverData::serializeError(
       return serializeErrorVersion1(ew);
     case kTakeoverProtocolVersionThree:
     case kTakeoverProtocolVersionFour:
-      // versions 3 and 4 use the same data serialization
+    case kTakeoverProtocolVersionFive:
+    case kTakeoverProtocolVersionSix:
+      // versions 3 through 6 use the same error serialization
       return serializeErrorVersion3(ew);
     default: {
       EDEN_BUG() << "asked to serialize takeover error in unsupported format "
@@ -114,6 +192,9 @@ TakeoverData TakeoverData::deserialize(IOBuf* buf) {
       // and let the underlying code decode the data
       buf->trimStart(sizeof(uint32_t));
       return deserializeVersion3(buf);
+    case kTakeoverProtocolVersionFive:
+      buf->trimStart(sizeof(uint32_t));
+      return deserializeVersion5(buf);
     default:
       throw std::runtime_error(folly::sformat(
           "Unrecognized TakeoverData response starting with {:x}",
@@ -292,25 +373,8 @@ IOBuf TakeoverData::serializeVersion3() {
 
   std::vector<SerializedMountInfo> serializedMounts;
   for (const auto& mount : mountPoints) {
-    SerializedMountInfo serializedMount;
-
-    serializedMount.mountPath = mount.mountPath.stringPiece().str();
-    serializedMount.stateDirectory = mount.stateDirectory.stringPiece().str();
-
-    for (const auto& bindMount : mount.bindMounts) {
-      serializedMount.bindMountPaths.push_back(bindMount.stringPiece().str());
-    }
-
-    // Stuffing the fuse connection information in as a binary
-    // blob because we know that the endianness of the target
-    // machine must match the current system for a graceful
-    // takeover, and it saves us from re-encoding an operating
-    // system specific struct into a thrift file.
-    serializedMount.connInfo = std::string{
-        reinterpret_cast<const char*>(&mount.connInfo), sizeof(mount.connInfo)};
-
+    auto serializedMount = serializeMountInfo(mount);
     serializedMount.inodeMap = mount.inodeMap;
-
     serializedMounts.emplace_back(std::move(serializedMount));
   }
 
@@ -348,21 +412,8 @@ TakeoverData TakeoverData::deserializeVersion3(IOBuf* buf) {
     case SerializedTakeoverData::Type::mounts: {
       TakeoverData data;
       for (auto& serializedMount : serialized.mutable_mounts()) {
-        const auto* connInfo = reinterpret_cast<const fuse_init_out*>(
-            serializedMount.connInfo.data());
-
-        std::vector<AbsolutePath> bindMounts;
-        for (const auto& path : serializedMount.bindMountPaths) {
-          bindMounts.emplace_back(AbsolutePathPiece{path});
-        }
-
-        data.mountPoints.emplace_back(
-            AbsolutePath{serializedMount.mountPath},
-            AbsolutePath{serializedMount.stateDirectory},
-            std::move(bindMounts),
-            folly::File{},
-            *connInfo,
-            std::move(serializedMount.inodeMap));
+        data.mountPoints.push_back(deserializeMountInfo(
+            serializedMount, std::move(serializedMount.inodeMap)));
       }
       return data;
     }
@@ -376,5 +427,190 @@ TakeoverData TakeoverData::deserializeVersion3(IOBuf* buf) {
       "impossible enum variant for SerializedTakeoverData");
 }
 
+IOBuf TakeoverData::serializeVersion5() {
+  SerializedTakeoverData serialized;
+
+  folly::IOBufQueue bufQ;
+  folly::io::QueueAppender app(&bufQ, 0);
+
+  // First word is the protocol version
+  app.writeBE<uint32_t>(kTakeoverProtocolVersionFive);
+
+  std::vector<SerializedMountInfo> serializedMounts;
+  for (const auto& mount : mountPoints) {
+    auto serializedMount = serializeMountInfo(mount);
+    serializedMount.compactInodeMap = mount.compactInodeMap.empty()
+        ? encodeInodeMap(mount.inodeMap)
+        : mount.compactInodeMap;
+    serializedMounts.emplace_back(std::move(serializedMount));
+  }
+
+  serialized.set_mounts(std::move(serializedMounts));
+
+  CompactSerializer::serialize(serialized, &bufQ);
+  return std::move(*bufQ.move());
+}
+
+TakeoverData TakeoverData::deserializeVersion5(IOBuf* buf) {
+  auto serialized = CompactSerializer::deserialize<SerializedTakeoverData>(buf);
+  switch (serialized.getType()) {
+    case SerializedTakeoverData::Type::errorReason:
+      throw std::runtime_error(serialized.get_errorReason());
+    case SerializedTakeoverData::Type::__EMPTY__:
+      return TakeoverData{};
+    case SerializedTakeoverData::Type::mounts:
+      break;
+  }
+  auto& serializedMounts = serialized.mutable_mounts();
+
+  // Decoding the inode maps is most of the work, so decode the inode map of
+  // each mount on its own thread.
+  std::vector<SerializedInodeMap> inodeMaps(serializedMounts.size());
+  std::vector<std::exception_ptr> errors(serializedMounts.size());
+  auto decode = [&](size_t index) {
+    try {
+      inodeMaps[index] =
+          decodeInodeMap(serializedMounts[index].compactInodeMap);
+    } catch (const std::exception&) {
+      errors[index] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t index = 1; index < serializedMounts.size(); ++index) {
+    threads.emplace_back(decode, index);
+  }
+  if (!serializedMounts.empty()) {
+    decode(0);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  TakeoverData data;
+  for (size_t index = 0; index < serializedMounts.size(); ++index) {
+    data.mountPoints.push_back(deserializeMountInfo(
+        serializedMounts[index], std::move(inodeMaps[index])));
+  }
+  return data;
+}
+
+/*
+ * The compact inode map is a varint entry count followed by one column for
+ * each field of SerializedInodeMapEntry:
+ *
+ * - inodeNumber: zigzag varint difference from the previous entry's
+ * - parentInode: zigzag varint difference from the entry's inodeNumber
+ * - name: varint lengths, then the concatenated names
+ * - isUnlinked: a bitmap, least significant bit first
+ * - numFuseReferences: zigzag varints
+ * - hash: varint lengths, then the concatenated hashes
+ * - mode: varints
+ *
+ * Inode numbers are allocated sequentially and children are usually
+ * allocated soon after their parents, so most numbers fit in a byte or two.
+ */
+std::string TakeoverData::encodeInodeMap(const SerializedInodeMap& inodeMap) {
+  const auto& entries = inodeMap.unloadedInodes;
+  std::string out;
+  appendVarint(out, entries.size());
+
+  int64_t previousInode = 0;
+  for (const auto& entry : entries) {
+    appendVarint(out, folly::encodeZigZag(entry.inodeNumber - previousInode));
+    previousInode = entry.inodeNumber;
+  }
+  for (const auto& entry : entries) {
+    appendVarint(
+        out, folly::encodeZigZag(entry.parentInode - entry.inodeNumber));
+  }
+  for (const auto& entry : entries) {
+    appendVarint(out, entry.name.size());
+  }
+  for (const auto& entry : entries) {
+    out.append(entry.name);
+  }
+  uint8_t bits = 0;
+  for (size_t index = 0; index < entries.size(); ++index) {
+    if (entries[index].isUnlinked) {
+      bits |= 1 << (index % 8);
+    }
+    if (index % 8 == 7 || index + 1 == entries.size()) {
+      out.push_back(static_cast<char>(bits));
+      bits = 0;
+    }
+  }
+  for (const auto& entry : entries) {
+    appendVarint(out, folly::encodeZigZag(entry.numFuseReferences));
+  }
+  for (const auto& entry : entries) {
+    appendVarint(out, entry.hash.size());
+  }
+  for (const auto& entry : entries) {
+    out.append(entry.hash);
+  }
+  for (const auto& entry : entries) {
+    appendVarint(out, static_cast<uint32_t>(entry.mode));
+  }
+  return out;
+}
+
+SerializedInodeMap TakeoverData::decodeInodeMap(folly::StringPiece data) {
+  auto range = folly::ByteRange{data};
+  auto count = readVarint(range);
+  // Every entry takes at least a byte, so a larger count is corrupt, and
+  // must not be used to size the entries.
+  if (count > range.size()) {
+    throw std::runtime_error("invalid entry count in compact inode map");
+  }
+
+  SerializedInodeMap inodeMap;
+  auto& entries = inodeMap.unloadedInodes;
+  entries.resize(count);
+
+  int64_t previousInode = 0;
+  for (auto& entry : entries) {
+    entry.inodeNumber =
+        previousInode + folly::decodeZigZag(readVarint(range));
+    previousInode = entry.inodeNumber;
+  }
+  for (auto& entry : entries) {
+    entry.parentInode =
+        entry.inodeNumber + folly::decodeZigZag(readVarint(range));
+  }
+  std::vector<uint64_t> sizes(count);
+  for (auto& size : sizes) {
+    size = readVarint(range);
+  }
+  for (size_t index = 0; index < count; ++index) {
+    entries[index].name = readBytes(range, sizes[index]).str();
+  }
+  auto bitmap = readBytes(range, (count + 7) / 8);
+  for (size_t index = 0; index < count; ++index) {
+    auto bits = static_cast<uint8_t>(bitmap[index / 8]);
+    entries[index].isUnlinked = (bits >> (index % 8)) & 1;
+  }
+  for (auto& entry : entries) {
+    entry.numFuseReferences = folly::decodeZigZag(readVarint(range));
+  }
+  for (auto& size : sizes) {
+    size = readVarint(range);
+  }
+  for (size_t index = 0; index < count; ++index) {
+    entries[index].hash = readBytes(range, sizes[index]).str();
+  }
+  for (auto& entry : entries) {
+    entry.mode = static_cast<int32_t>(readVarint(range));
+  }
+  if (!range.empty()) {
+    throw std::runtime_error("trailing data in compact inode map");
+  }
+  return inodeMap;
+}
+
 } // namespace eden
 } // namespace facebook
@@ -8,9 +8,11 @@
 #pragma once
 
 #include <folly/File.h>
+#include <folly/Range.h>
 #include <folly/futures/Promise.h>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
 #include "eden/fs/fuse/FuseTypes.h"
@@ -70,6 +72,18 @@ class TakeoverData {
     // break a server with this extra handshake talking to a client
     // without it
     kTakeoverProtocolVersionFour = 4,
+
+    // This version keeps the handshake of version 4, but sends each mount's
+    // inode map in a compact columnar encoding, which is much faster to
+    // produce and parse than a thrift list with millions of entries.  The
+    // receiving side decodes the inode maps of different mounts in parallel.
+    kTakeoverProtocolVersionFive = 5,
+
+    // This version uses the data format of version 5, but the message may
+    // carry one more file descriptor after those of the mounts: a memory
+    // file with the most recently used blobs of the old process's
+    // BlobCache, see blobCacheFile.
+    kTakeoverProtocolVersionSix = 6,
   };
 
   // Given a set of versions provided by a client, find the largest
@@ -100,6 +114,11 @@ class TakeoverData {
     folly::File fuseFD;
     fuse_init_out connInfo;
     SerializedInodeMap inodeMap;
+    /**
+     * inodeMap encoded with encodeInodeMap(), if it was encoded as soon as
+     * the mount stopped rather than when the takeover data is serialized.
+     */
+    std::string compactInodeMap;
   };
 
   /**
@@ -133,6 +152,18 @@ class TakeoverData {
    */
   static bool isPing(const folly::IOBuf* buf);
 
+  /**
+   * Encode an inode map in the compact format used by version 5 of the
+   * takeover protocol.
+   */
+  static std::string encodeInodeMap(const SerializedInodeMap& inodeMap);
+
+  /**
+   * Decode an inode map produced by encodeInodeMap().  Throws
+   * std::runtime_error if the data is truncated or corrupt.
+   */
+  static SerializedInodeMap decodeInodeMap(folly::StringPiece data);
+
   /**
    * The main eden lock file that prevents two edenfs processes from running at
    * the same time.
@@ -149,6 +180,12 @@ class TakeoverData {
    */
   std::vector<MountInfo> mountPoints;
 
+  /**
+   * An optional memory file holding a BlobCacheSnapshot of the old process's
+   * BlobCache.  Only sent with version 6 or later of the protocol.
+   */
+  folly::File blobCacheFile;
+
   /**
    * The takeoverComplete promise will be fulfilled by the TakeoverServer code
    * once the TakeoverData has been sent to the remote process.
@@ -190,6 +227,17 @@ class TakeoverData {
    */
   static TakeoverData deserializeVersion3(folly::IOBuf* buf);
 
+  /**
+   * Serialize data using version 5 of the takeover protocol.
+   */
+  folly::IOBuf serializeVersion5();
+
+  /**
+   * Deserialize the TakeoverData from a buffer using version 5 of the takeover
+   * protocol.
+   */
+  static TakeoverData deserializeVersion5(folly::IOBuf* buf);
+
   /**
    * Message type values.
    * If we ever need to include more information in the takeover data in the
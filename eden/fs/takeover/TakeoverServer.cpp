@@ -146,8 +146,8 @@ Future<Unit> TakeoverServer::ConnHandler::start() noexcept {
           }
           // Initiate the takeover shutdown.
           protocolVersion_ = supported.value();
-          shouldPing_ =
-              (protocolVersion_ == TakeoverData::kTakeoverProtocolVersionFour);
+          shouldPing_ = protocolVersion_ >=
+              TakeoverData::kTakeoverProtocolVersionFour;
           return server_->getTakeoverHandler()->startTakeoverShutdown();
         })
         .thenTryInline(folly::makeAsyncTask(
@@ -238,6 +238,10 @@ Future<Unit> TakeoverServer::ConnHandler::sendTakeoverData(
     for (auto& mount : data.mountPoints) {
       msg.files.push_back(std::move(mount.fuseFD));
     }
+    if (protocolVersion_ >= TakeoverData::kTakeoverProtocolVersionSix &&
+        data.blobCacheFile) {
+      msg.files.push_back(std::move(data.blobCacheFile));
+    }
   } catch (const std::exception& ex) {
     auto ew = folly::exception_wrapper{std::current_exception(), ex};
     data.takeoverComplete.setException(ew);
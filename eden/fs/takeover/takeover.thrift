@@ -47,6 +47,10 @@ struct SerializedMountInfo {
   // 5: SerializedFileHandleMap fileHandleMap,
 
   6: SerializedInodeMap inodeMap,
+
+  // Version 5 of the takeover protocol sends the inode map in this compact
+  // columnar encoding instead of in inodeMap.  See TakeoverData.cpp.
+  7: binary compactInodeMap,
 }
 
 union SerializedTakeoverData {
@@ -335,6 +335,135 @@ TEST(Takeover, manyMounts) {
   }
 }
 
+namespace {
+SerializedInodeMap makeInodeMap(int64_t firstInode, size_t numEntries) {
+  SerializedInodeMap inodeMap;
+  for (size_t n = 0; n < numEntries; ++n) {
+    SerializedInodeMapEntry entry;
+    entry.inodeNumber = firstInode + 3 * n;
+    entry.parentInode = n == 0 ? 1 : firstInode;
+    entry.name = folly::to<string>("file", n);
+    entry.isUnlinked = n % 3 == 0;
+    entry.numFuseReferences = n % 5;
+    if (n % 2 == 0) {
+      entry.hash = string(20, static_cast<char>('a' + n % 26));
+    }
+    entry.mode = 0100644 + n % 2;
+    inodeMap.unloadedInodes.push_back(std::move(entry));
+  }
+  return inodeMap;
+}
+} // namespace
+
+TEST(Takeover, inodeMapsSurviveEachProtocolVersion) {
+  for (auto version : {TakeoverData::kTakeoverProtocolVersionFour,
+                       TakeoverData::kTakeoverProtocolVersionFive,
+                       TakeoverData::kTakeoverProtocolVersionSix}) {
+    TemporaryDirectory tmpDir("eden_takeover_test");
+    AbsolutePathPiece tmpDirPath{tmpDir.path().string()};
+
+    TakeoverData serverData;
+    auto lockFilePath = tmpDirPath + "lock"_pc;
+    serverData.lockFile =
+        folly::File{lockFilePath.stringPiece(), O_RDWR | O_CREAT};
+    auto thriftSocketPath = tmpDirPath + "thrift"_pc;
+    serverData.thriftSocket =
+        folly::File{thriftSocketPath.stringPiece(), O_RDWR | O_CREAT};
+
+    std::vector<SerializedInodeMap> expectedInodeMaps;
+    for (size_t n = 0; n < 3; ++n) {
+      auto inodeMap = makeInodeMap(100 * (n + 1), 10 * n + 3);
+      expectedInodeMaps.push_back(inodeMap);
+      auto fusePath =
+          tmpDirPath + PathComponentPiece{folly::to<string>("fuse", n)};
+      serverData.mountPoints.emplace_back(
+          tmpDirPath + PathComponentPiece{folly::to<string>("mount", n)},
+          tmpDirPath + PathComponentPiece{folly::to<string>("client", n)},
+          std::vector<AbsolutePath>{},
+          folly::File{fusePath.stringPiece(), O_RDWR | O_CREAT},
+          fuse_init_out{},
+          std::move(inodeMap));
+      if (n == 1) {
+        // EdenServer encodes inode maps as soon as each mount stops.
+        auto& mount = serverData.mountPoints.back();
+        mount.compactInodeMap = TakeoverData::encodeInodeMap(mount.inodeMap);
+      }
+    }
+
+    auto serverSendFuture = serverData.takeoverComplete.getFuture();
+    TestHandler handler{std::move(serverData)};
+    auto result = runTakeover(tmpDir, &handler, std::set<int32_t>{version});
+    ASSERT_TRUE(serverSendFuture.hasValue());
+    ASSERT_TRUE(result.hasValue());
+
+    const auto& clientData = result.value();
+    ASSERT_EQ(3, clientData.mountPoints.size());
+    for (size_t n = 0; n < 3; ++n) {
+      EXPECT_EQ(expectedInodeMaps[n], clientData.mountPoints[n].inodeMap)
+          << "version " << version << ", mount " << n;
+    }
+  }
+}
+
+TEST(Takeover, blobCacheFileIsOnlySentWithVersionSix) {
+  for (auto version : {TakeoverData::kTakeoverProtocolVersionFive,
+                       TakeoverData::kTakeoverProtocolVersionSix}) {
+    TemporaryDirectory tmpDir("eden_takeover_test");
+    AbsolutePathPiece tmpDirPath{tmpDir.path().string()};
+
+    TakeoverData serverData;
+    auto lockFilePath = tmpDirPath + "lock"_pc;
+    serverData.lockFile =
+        folly::File{lockFilePath.stringPiece(), O_RDWR | O_CREAT};
+    auto thriftSocketPath = tmpDirPath + "thrift"_pc;
+    serverData.thriftSocket =
+        folly::File{thriftSocketPath.stringPiece(), O_RDWR | O_CREAT};
+    auto fusePath = tmpDirPath + "fuse"_pc;
+    serverData.mountPoints.emplace_back(
+        tmpDirPath + "mount"_pc,
+        tmpDirPath + "client"_pc,
+        std::vector<AbsolutePath>{},
+        folly::File{fusePath.stringPiece(), O_RDWR | O_CREAT},
+        fuse_init_out{},
+        SerializedInodeMap{});
+    auto blobCachePath = tmpDirPath + "blob_cache"_pc;
+    serverData.blobCacheFile =
+        folly::File{blobCachePath.stringPiece(), O_RDWR | O_CREAT};
+
+    auto serverSendFuture = serverData.takeoverComplete.getFuture();
+    TestHandler handler{std::move(serverData)};
+    auto result = runTakeover(tmpDir, &handler, std::set<int32_t>{version});
+    ASSERT_TRUE(serverSendFuture.hasValue());
+    ASSERT_TRUE(result.hasValue());
+
+    const auto& clientData = result.value();
+    ASSERT_EQ(1, clientData.mountPoints.size());
+    checkExpectedFile(clientData.mountPoints[0].fuseFD.fd(), fusePath);
+    if (version == TakeoverData::kTakeoverProtocolVersionSix) {
+      ASSERT_TRUE(clientData.blobCacheFile);
+      checkExpectedFile(clientData.blobCacheFile.fd(), blobCachePath);
+    } else {
+      EXPECT_FALSE(clientData.blobCacheFile);
+    }
+  }
+}
+
+TEST(Takeover, compactInodeMapRejectsCorruptData) {
+  auto encoded = TakeoverData::encodeInodeMap(makeInodeMap(10, 20));
+  EXPECT_EQ(makeInodeMap(10, 20), TakeoverData::decodeInodeMap(encoded));
+  EXPECT_EQ(
+      SerializedInodeMap{},
+      TakeoverData::decodeInodeMap(
+          TakeoverData::encodeInodeMap(SerializedInodeMap{})));
+
+  EXPECT_THROW(
+      TakeoverData::decodeInodeMap(
+          folly::StringPiece{encoded}.subpiece(0, encoded.size() - 1)),
+      std::runtime_error);
+  EXPECT_THROW(
+      TakeoverData::decodeInodeMap(encoded + "x"), std::runtime_error);
+}
+
 TEST(Takeover, error) {
   TemporaryDirectory tmpDir("eden_takeover_test");
   ErrorHandler handler;
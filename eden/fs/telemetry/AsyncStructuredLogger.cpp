@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/AsyncStructuredLogger.h"
+
+#include <fb303/ServiceData.h>
+#include <folly/logging/xlog.h>
+#include <folly/system/ThreadName.h>
+
+namespace facebook {
+namespace eden {
+
+namespace {
+constexpr folly::StringPiece kDroppedCounter{
+    "telemetry.structured_log.dropped_events"};
+constexpr folly::StringPiece kSampledOutCounter{
+    "telemetry.structured_log.sampled_out_events"};
+} // namespace
+
+AsyncStructuredLogger::AsyncStructuredLogger(
+    std::unique_ptr<StructuredLogger> logger,
+    SessionInfo sessionInfo,
+    size_t maxQueuedEvents,
+    std::chrono::milliseconds flushInterval)
+    : StructuredLogger{true, std::move(sessionInfo)},
+      logger_{std::move(logger)},
+      maxQueuedEvents_{maxQueuedEvents},
+      flushInterval_{flushInterval} {
+  flusherThread_ = std::thread([this] {
+    folly::setThreadName("StructuredLog");
+    flusherThread();
+  });
+}
+
+AsyncStructuredLogger::~AsyncStructuredLogger() {
+  state_.lock()->shouldStop = true;
+  flushOrStop_.notify_one();
+  flusherThread_.join();
+}
+
+void AsyncStructuredLogger::logDynamicEvent(DynamicEvent event) {
+  {
+    auto state = state_.lock();
+    if (state->events.size() >= maxQueuedEvents_) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      XLOG_EVERY_MS(DBG7, 10000)
+          << "structured log queue full, dropping event";
+      return;
+    }
+    state->events.push_back(std::move(event));
+  }
+  // The flusher wakes up on its own every flushInterval, so events do not
+  // need to wake it, which would cost a syscall per event.
+}
+
+void AsyncStructuredLogger::flush() {
+  auto state = state_.lock();
+  // Wait for the batch after the one that is being written, if any, since
+  // it has all the events logged before this call.
+  auto target = state->batchesTaken + 1;
+  state->flushRequested = true;
+  flushOrStop_.notify_one();
+  batchWritten_.wait(state.getUniqueLock(), [&] {
+    return state->batchesWritten >= target;
+  });
+}
+
+void AsyncStructuredLogger::flusherThread() {
+  std::vector<DynamicEvent> batch;
+  while (true) {
+    bool stop;
+    {
+      auto state = state_.lock();
+      flushOrStop_.wait_for(state.getUniqueLock(), flushInterval_, [&] {
+        return state->shouldStop || state->flushRequested;
+      });
+      state->flushRequested = false;
+      stop = state->shouldStop;
+      batch.swap(state->events);
+      ++state->batchesTaken;
+    }
+
+    for (auto& event : batch) {
+      logger_->logDynamicEvent(std::move(event));
+    }
+    batch.clear();
+
+    fb303::fbData->setCounter(
+        kDroppedCounter, dropped_.load(std::memory_order_relaxed));
+    fb303::fbData->setCounter(kSampledOutCounter, getSampledOutCount());
+
+    ++state_.lock()->batchesWritten;
+    batchWritten_.notify_all();
+    if (stop) {
+      return;
+    }
+  }
+}
+
+} // namespace eden
+} // namespace facebook
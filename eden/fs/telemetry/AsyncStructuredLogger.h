@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "eden/fs/telemetry/StructuredLogger.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Hands events to another StructuredLogger on a background thread, so that
+ * serializing and writing them never delays the thread that logged them.
+ *
+ * Events are queued, up to maxQueuedEvents of them, and the background
+ * thread forwards everything queued at once, at least every flushInterval.
+ * Events logged while the queue is full are dropped and counted.
+ */
+class AsyncStructuredLogger final : public StructuredLogger {
+ public:
+  AsyncStructuredLogger(
+      std::unique_ptr<StructuredLogger> logger,
+      SessionInfo sessionInfo,
+      size_t maxQueuedEvents,
+      std::chrono::milliseconds flushInterval);
+
+  /**
+   * Forwards the events that are still queued, then stops the background
+   * thread.
+   */
+  ~AsyncStructuredLogger() override;
+
+  /** The number of events dropped because the queue was full. */
+  uint64_t getDroppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  /** Blocks until every event logged so far has been forwarded. */
+  void flush();
+
+ private:
+  void logDynamicEvent(DynamicEvent event) override;
+  void flusherThread();
+
+  struct State {
+    std::vector<DynamicEvent> events;
+    // Incremented every time the flusher takes the queued events, and when
+    // it has forwarded them.
+    uint64_t batchesTaken{0};
+    uint64_t batchesWritten{0};
+    bool flushRequested{false};
+    bool shouldStop{false};
+  };
+
+  const std::unique_ptr<StructuredLogger> logger_;
+  const size_t maxQueuedEvents_;
+  const std::chrono::milliseconds flushInterval_;
+  std::atomic<uint64_t> dropped_{0};
+
+  folly::Synchronized<State, std::mutex> state_;
+  std::condition_variable flushOrStop_;
+  std::condition_variable batchWritten_;
+  std::thread flusherThread_;
+};
+
+} // namespace eden
+} // namespace facebook
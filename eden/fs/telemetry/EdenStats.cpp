@@ -7,6 +7,8 @@
 
 #include "eden/fs/telemetry/EdenStats.h"
 
+#include <fb303/ServiceData.h>
+#include <folly/Conv.h>
 #include <chrono>
 #include <memory>
 
@@ -14,6 +16,15 @@ namespace {
 constexpr std::chrono::microseconds kMinValue{0};
 constexpr std::chrono::microseconds kMaxValue{10000};
 constexpr std::chrono::microseconds kBucketSize{1000};
+
+// The percentiles exported for each FUSE opcode and request outcome and for
+// each duration histogram, and the suffix of their counter names.
+constexpr std::pair<double, folly::StringPiece> kExportedPercentiles[] = {
+    {50, "p50"},
+    {90, "p90"},
+    {99, "p99"},
+    {99.9, "p999"},
+};
 } // namespace
 
 namespace facebook {
@@ -40,21 +51,93 @@ JournalThreadStats& EdenStats::getJournalStatsForCurrentThread() {
 }
 
 void EdenStats::aggregate() {
+  folly::F14FastMap<std::string, LatencyHistogram> durations;
+  folly::F14FastMap<
+      std::string,
+      std::array<LatencyHistogram, FuseThreadStats::kNumRequestOutcomes>>
+      fuseLatencies;
   for (auto& stats : threadLocalFuseStats_.accessAllThreads()) {
     stats.aggregate();
+    stats.drainOutcomeLatencies(fuseLatencies);
+    stats.drainDurations(durations);
+  }
+  // Opcodes without requests since the last call keep their previous values
+  // rather than dropping to zero.
+  for (const auto& [name, histograms] : fuseLatencies) {
+    for (size_t i = 0; i < histograms.size(); ++i) {
+      const auto& histogram = histograms[i];
+      if (histogram.count() == 0) {
+        continue;
+      }
+      auto outcome = FuseThreadStats::requestOutcomeName(
+          static_cast<FuseThreadStats::RequestOutcome>(i));
+      for (const auto& [pct, suffix] : kExportedPercentiles) {
+        fb303::fbData->setCounter(
+            folly::to<std::string>(name, ".", outcome, ".", suffix),
+            histogram.getPercentile(pct));
+      }
+    }
   }
   for (auto& stats : threadLocalObjectStoreStats_.accessAllThreads()) {
     stats.aggregate();
+    stats.drainDurations(durations);
   }
   for (auto& stats : threadLocalHgBackingStoreStats_.accessAllThreads()) {
     stats.aggregate();
+    stats.drainDurations(durations);
   }
   for (auto& stats : threadLocalHgImporterStats_.accessAllThreads()) {
     stats.aggregate();
+    stats.drainDurations(durations);
   }
   for (auto& stats : threadLocalJournalStats_.accessAllThreads()) {
     stats.aggregate();
+    stats.drainDurations(durations);
+  }
+  exportDurations(durations);
+}
+
+void EdenStats::exportDurations(
+    folly::F14FastMap<std::string, LatencyHistogram>& durations) {
+  auto state = durations_.lock();
+  auto now = std::chrono::steady_clock::now();
+  if (now - state->windowStart >= kDurationWindow) {
+    for (auto& [name, windows] : state->windows) {
+      windows.previous = windows.current;
+      windows.current.clear();
+    }
+    state->windowStart = now;
+  }
+  for (auto& [name, histogram] : durations) {
+    state->windows[name].current.merge(histogram);
   }
+
+  for (const auto& [name, windows] : state->windows) {
+    auto merged = windows.previous;
+    merged.merge(windows.current);
+    if (merged.count() == 0) {
+      continue;
+    }
+    auto& percentiles = state->percentiles[name];
+    percentiles.count = merged.count();
+    percentiles.p50 = merged.getPercentile(50);
+    percentiles.p90 = merged.getPercentile(90);
+    percentiles.p99 = merged.getPercentile(99);
+    percentiles.p999 = merged.getPercentile(99.9);
+    percentiles.max = merged.getMax();
+    for (const auto& [pct, suffix] : kExportedPercentiles) {
+      fb303::fbData->setCounter(
+          folly::to<std::string>(name, ".hdr.", suffix),
+          merged.getPercentile(pct));
+    }
+    fb303::fbData->setCounter(
+        folly::to<std::string>(name, ".hdr.max"), percentiles.max);
+  }
+}
+
+folly::F14FastMap<std::string, EdenStats::DurationPercentiles>
+EdenStats::getDurationPercentiles() const {
+  return durations_.lock()->percentiles;
 }
 
 std::shared_ptr<HgImporterThreadStats> getSharedHgImporterStatsForCurrentThread(
@@ -78,6 +161,25 @@ EdenThreadStatsBase::Histogram EdenThreadStatsBase::createHistogram(
                    99};
 }
 
+void EdenThreadStatsBase::recordDuration(
+    const Histogram& histogram,
+    int64_t value) {
+  // LatencyHistogram is written in terms of microseconds, but only the
+  // bucketing depends on the unit, so other durations are stored as-is.
+  (*durations_.lock())[&histogram].addValue(std::chrono::microseconds{value});
+}
+
+void EdenThreadStatsBase::drainDurations(
+    folly::F14FastMap<std::string, LatencyHistogram>& merged) {
+  auto durations = durations_.lock();
+  for (auto& [histogram, latencies] : *durations) {
+    if (latencies.count() != 0) {
+      merged[histogram->name()].merge(latencies);
+      latencies.clear();
+    }
+  }
+}
+
 EdenThreadStatsBase::Timeseries EdenThreadStatsBase::createTimeseries(
     const std::string& name) {
   auto timeseries = Timeseries{this, name};
@@ -86,12 +188,50 @@ EdenThreadStatsBase::Timeseries EdenThreadStatsBase::createTimeseries(
   return timeseries;
 }
 
+folly::StringPiece FuseThreadStats::requestOutcomeName(
+    RequestOutcome outcome) {
+  switch (outcome) {
+    case RequestOutcome::LoadedInode:
+      return "loaded";
+    case RequestOutcome::InodeLoad:
+      return "inode_load";
+    case RequestOutcome::BackingStoreFetch:
+      return "backing_store";
+  }
+  return "unknown";
+}
+
 void FuseThreadStats::recordLatency(
     HistogramPtr item,
+    RequestOutcome outcome,
     std::chrono::microseconds elapsed,
     std::chrono::seconds now) {
   (void)now; // we don't use it in this code path
-  (this->*item).addValue(elapsed.count());
+  auto& histogram = this->*item;
+  histogram.addValue(elapsed.count());
+
+  auto latencies = outcomeLatencies_.lock();
+  auto& slot = (*latencies)[&histogram][static_cast<size_t>(outcome)];
+  if (!slot) {
+    slot = std::make_unique<LatencyHistogram>();
+  }
+  slot->addValue(elapsed);
+}
+
+void FuseThreadStats::drainOutcomeLatencies(
+    folly::F14FastMap<
+        std::string,
+        std::array<LatencyHistogram, kNumRequestOutcomes>>& merged) {
+  auto latencies = outcomeLatencies_.lock();
+  for (auto& [histogram, outcomes] : *latencies) {
+    auto* mergedOutcomes = &merged[histogram->name()];
+    for (size_t i = 0; i < outcomes.size(); ++i) {
+      if (outcomes[i] && outcomes[i]->count() != 0) {
+        (*mergedOutcomes)[i].merge(*outcomes[i]);
+        outcomes[i]->clear();
+      }
+    }
+  }
 }
 
 } // namespace eden
@@ -8,10 +8,17 @@
 #pragma once
 
 #include <fb303/ThreadLocalStats.h>
+#include <folly/Synchronized.h>
 #include <folly/ThreadLocal.h>
+#include <folly/container/F14Map.h>
+#include <array>
+#include <chrono>
 #include <memory>
+#include <mutex>
+#include <string>
 
 #include "eden/fs/eden-config.h"
+#include "eden/fs/telemetry/LatencyHistogram.h"
 
 namespace facebook {
 namespace eden {
@@ -24,6 +31,19 @@ class JournalThreadStats;
 
 class EdenStats {
  public:
+  /**
+   * Percentiles of one duration histogram over the last one to two minutes,
+   * in the histogram's own units.
+   */
+  struct DurationPercentiles {
+    uint64_t count{0};
+    uint64_t p50{0};
+    uint64_t p90{0};
+    uint64_t p99{0};
+    uint64_t p999{0};
+    uint64_t max{0};
+  };
+
   /**
    * This function can be called on any thread.
    *
@@ -61,12 +81,49 @@ class EdenStats {
 
   /**
    * This function can be called on any thread.
+   *
+   * Besides aggregating the fb303 stats, this exports the percentiles of the
+   * FUSE request latencies recorded since the previous call as counters,
+   * see FuseThreadStats::recordLatency().
+   *
+   * It also merges every thread's log-linear copy of each duration
+   * histogram and exports its percentiles and maximum as
+   * "<name>.hdr.<p50|p90|p99|p999|max>" counters.
    */
   void aggregate();
 
+  /**
+   * The duration percentiles computed by the last call to aggregate(), keyed
+   * by histogram name.  This function can be called on any thread.
+   */
+  folly::F14FastMap<std::string, DurationPercentiles> getDurationPercentiles()
+      const;
+
  private:
   class ThreadLocalTag {};
 
+  // Durations are reported over a window of kDurationWindow to twice that,
+  // so the percentiles neither jump at each rotation nor hide regressions
+  // behind hours of history.
+  static constexpr std::chrono::seconds kDurationWindow{60};
+
+  struct DurationWindows {
+    LatencyHistogram current;
+    LatencyHistogram previous;
+  };
+
+  struct DurationState {
+    folly::F14FastMap<std::string, DurationWindows> windows;
+    folly::F14FastMap<std::string, DurationPercentiles> percentiles;
+    std::chrono::steady_clock::time_point windowStart{
+        std::chrono::steady_clock::now()};
+  };
+
+  void exportDurations(
+      folly::F14FastMap<std::string, LatencyHistogram>& durations);
+
+  folly::Synchronized<DurationState, std::mutex> durations_;
+
   folly::ThreadLocal<FuseThreadStats, ThreadLocalTag, void>
       threadLocalFuseStats_;
   folly::ThreadLocal<ObjectStoreThreadStats, ThreadLocalTag, void>
@@ -93,14 +150,52 @@ std::shared_ptr<HgImporterThreadStats> getSharedHgImporterStatsForCurrentThread(
 class EdenThreadStatsBase
     : public fb303::ThreadLocalStatsT<fb303::TLStatsThreadSafe> {
  public:
-  using Histogram = TLHistogram;
+  /**
+   * An fb303 histogram of durations that also records every value in a
+   * LatencyHistogram, whose tail percentiles are exported by
+   * EdenStats::aggregate().
+   */
+  class Histogram : public TLHistogram {
+   public:
+    template <typename... Args>
+    Histogram(EdenThreadStatsBase* stats, Args&&... args)
+        : TLHistogram{stats, std::forward<Args>(args)...}, stats_{stats} {}
+
+    using TLHistogram::addValue;
+    void addValue(int64_t value) {
+      TLHistogram::addValue(value);
+      stats_->recordDuration(*this, value);
+    }
+
+   private:
+    EdenThreadStatsBase* stats_;
+  };
   using Timeseries = TLTimeseries;
 
   explicit EdenThreadStatsBase();
 
+  /**
+   * Move the durations recorded on this thread into merged, which is keyed
+   * by histogram name.
+   *
+   * This may be called from any thread.
+   */
+  void drainDurations(
+      folly::F14FastMap<std::string, LatencyHistogram>& merged);
+
  protected:
   Histogram createHistogram(const std::string& name);
   Timeseries createTimeseries(const std::string& name);
+
+ private:
+  void recordDuration(const Histogram& histogram, int64_t value);
+
+  // Only the histograms this thread has recorded to are allocated.  The lock
+  // is only contended while EdenStats::aggregate() drains them.
+  folly::Synchronized<
+      folly::F14FastMap<const Histogram*, LatencyHistogram>,
+      std::mutex>
+      durations_;
 };
 
 class FuseThreadStats : public EdenThreadStatsBase {
@@ -128,6 +223,7 @@ class FuseThreadStats : public EdenThreadStatsBase {
   Histogram fsync{createHistogram("fuse.fsync_us")};
   Histogram opendir{createHistogram("fuse.opendir_us")};
   Histogram readdir{createHistogram("fuse.readdir_us")};
+  Histogram readdirplus{createHistogram("fuse.readdirplus_us")};
   Histogram releasedir{createHistogram("fuse.releasedir_us")};
   Histogram fsyncdir{createHistogram("fuse.fsyncdir_us")};
   Histogram statfs{createHistogram("fuse.statfs_us")};
@@ -142,23 +238,77 @@ class FuseThreadStats : public EdenThreadStatsBase {
   Histogram poll{createHistogram("fuse.poll_us")};
   Histogram forgetmulti{createHistogram("fuse.forgetmulti_us")};
 
+  // Kernel cache invalidations that were dropped or merged into another
+  // invalidation before being sent.
+  Timeseries invalidationsCoalesced{this,
+                                    "fuse.invalidations_coalesced",
+                                    fb303::SUM};
+
+  // Replies built in a thread's reusable iovec storage, and replies that
+  // required that storage to grow.
+  Timeseries replyPoolHits{this, "fuse.reply_pool_hits", fb303::SUM};
+  Timeseries replyPoolMisses{this, "fuse.reply_pool_misses", fb303::SUM};
+
   // Since we can potentially finish a request in a different
   // thread from the one used to initiate it, we use HistogramPtr
   // as a helper for referencing the pointer-to-member that we
   // want to update at the end of the request.
   using HistogramPtr = Histogram FuseThreadStats::*;
 
+  /**
+   * What a FUSE request had to wait for, from cheapest to most expensive.
+   */
+  enum class RequestOutcome : uint8_t {
+    // Every inode the request touched was already loaded.
+    LoadedInode,
+    // The request waited for an inode to be loaded, but every object it
+    // needed was in the local store or in memory.
+    InodeLoad,
+    // The request waited for an import from the backing store.
+    BackingStoreFetch,
+  };
+  static constexpr size_t kNumRequestOutcomes = 3;
+
+  static folly::StringPiece requestOutcomeName(RequestOutcome outcome);
+
   /** Record a the latency for an operation.
    * item is the pointer-to-member for one of the histograms defined
    * above.
+   * outcome classifies the request for the log-linear histograms exported
+   * by EdenStats::aggregate().
    * elapsed is the duration of the operation, measured in microseconds.
    * now is the current steady clock value in seconds.
    * (Once we open source the common stats code we can eliminate the
    * now parameter from this method). */
   void recordLatency(
       HistogramPtr item,
+      RequestOutcome outcome,
       std::chrono::microseconds elapsed,
       std::chrono::seconds now);
+
+  /**
+   * Move the log-linear latencies recorded on this thread into merged, which
+   * is keyed by the name of the fb303 histogram and indexed by
+   * RequestOutcome.
+   *
+   * This may be called from any thread.
+   */
+  void drainOutcomeLatencies(
+      folly::F14FastMap<
+          std::string,
+          std::array<LatencyHistogram, kNumRequestOutcomes>>& merged);
+
+ private:
+  using OutcomeHistograms =
+      std::array<std::unique_ptr<LatencyHistogram>, kNumRequestOutcomes>;
+
+  // Histograms are allocated the first time an opcode and outcome is seen,
+  // since most threads only ever see a few of them.  The lock is only
+  // contended while EdenStats::aggregate() drains them.
+  folly::Synchronized<
+      folly::F14FastMap<const Histogram*, OutcomeHistograms>,
+      std::mutex>
+      outcomeLatencies_;
 };
 
 /**
@@ -182,6 +332,13 @@ class ObjectStoreThreadStats : public EdenThreadStatsBase {
       createTimeseries("object_store.get_blob_size.local_store")};
   Timeseries getBlobSizeFromBackingStore{
       createTimeseries("object_store.get_blob_size.backing_store")};
+
+  // BackingStore imports that joined an import of the same object that was
+  // already in flight instead of issuing their own.
+  Timeseries blobImportsCoalesced{
+      createTimeseries("object_store.blob_imports_coalesced")};
+  Timeseries treeImportsCoalesced{
+      createTimeseries("object_store.tree_imports_coalesced")};
 };
 
 /**
@@ -193,6 +350,14 @@ class HgBackingStoreThreadStats : public EdenThreadStatsBase {
   Histogram hgBackingStoreImportBlob{createHistogram("store.hg.import_blob")};
   Histogram hgBackingStoreGetTree{createHistogram("store.hg.get_tree")};
   Histogram hgBackingStoreImportTree{createHistogram("store.hg.import_tree")};
+  // Latency of the batched remote fetches through the hgcache, and the
+  // number of objects they failed to fetch.
+  Histogram hgBackingStoreFetchRemoteBlobs{
+      createHistogram("store.hg.fetch_remote_blobs")};
+  Histogram hgBackingStoreFetchRemoteTrees{
+      createHistogram("store.hg.fetch_remote_trees")};
+  Timeseries hgBackingStoreFetchRemoteFailures{
+      createTimeseries("store.hg.fetch_remote_failures")};
   Histogram mononokeBackingStoreGetTree{
       createHistogram("store.mononoke.get_tree")};
   Histogram mononokeBackingStoreGetBlob{
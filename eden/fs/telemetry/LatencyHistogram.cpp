@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/LatencyHistogram.h"
+
+#include <folly/lang/Bits.h>
+#include <algorithm>
+#include <cmath>
+
+namespace facebook {
+namespace eden {
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+  if (value < kSubBuckets) {
+    return value;
+  }
+  value = std::min(value, (uint64_t{1} << kMaxExponent) - 1);
+  // The exponent is at least kSubBucketBits here, and the bucket group for
+  // exponent e starts at (e - kSubBucketBits + 1) * kSubBuckets.
+  const size_t exponent = folly::findLastSet(value) - 1;
+  const size_t shift = exponent - kSubBucketBits;
+  const size_t subBucket = (value >> shift) & (kSubBuckets - 1);
+  return ((shift + 1) << kSubBucketBits) + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketHighestValue(size_t index) {
+  const size_t group = index >> kSubBucketBits;
+  const uint64_t subBucket = index & (kSubBuckets - 1);
+  if (group == 0) {
+    return subBucket;
+  }
+  const size_t shift = group - 1;
+  const uint64_t lowest = (kSubBuckets + subBucket) << shift;
+  return lowest + (uint64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::addValue(std::chrono::microseconds value) {
+  const auto us = value.count() < 0 ? 0 : static_cast<uint64_t>(value.count());
+  ++buckets_[bucketIndex(us)];
+  ++count_;
+  max_ = std::max(max_, us);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+  count_ += other.count_;
+  max_ = std::max(max_, other.max_);
+}
+
+void LatencyHistogram::clear() {
+  buckets_.fill(0);
+  count_ = 0;
+  max_ = 0;
+}
+
+uint64_t LatencyHistogram::getPercentile(double pct) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  pct = std::clamp(pct, 0.0, 100.0);
+  // The epsilon keeps rounding error in pct from pushing the target one
+  // sample too far, e.g. 99.9% of 1000 samples must be sample 999.
+  auto target =
+      static_cast<uint64_t>(std::ceil(pct / 100.0 * count_ - 1e-9));
+  target = std::clamp<uint64_t>(target, 1, count_);
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    seen += buckets_[i];
+    if (seen >= target) {
+      return bucketHighestValue(i);
+    }
+  }
+  return bucketHighestValue(kNumBuckets - 1);
+}
+
+} // namespace eden
+} // namespace facebook
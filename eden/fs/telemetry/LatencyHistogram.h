@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * A log-linear histogram of latencies, in the style of HdrHistogram.
+ *
+ * Values are bucketed by their power of two, and each power of two is split
+ * into kSubBuckets equal buckets, so a bucket never spans more than 1/8th of
+ * the values it holds.  This keeps tail percentiles accurate from single
+ * microseconds up to hours without configuring a range, unlike the linear
+ * fb303 histograms.
+ *
+ * LatencyHistogram is not thread-safe.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr size_t kSubBucketBits = 3;
+  static constexpr size_t kSubBuckets = size_t{1} << kSubBucketBits;
+  /**
+   * Values at or above 2^kMaxExponent microseconds (about 19 hours) are
+   * recorded in the last bucket.
+   */
+  static constexpr size_t kMaxExponent = 36;
+  static constexpr size_t kNumBuckets =
+      (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+  void addValue(std::chrono::microseconds value);
+
+  /**
+   * Add all of other's samples to this histogram.
+   */
+  void merge(const LatencyHistogram& other);
+
+  void clear();
+
+  uint64_t count() const {
+    return count_;
+  }
+
+  /**
+   * Returns the highest latency, in microseconds, that is recorded in the
+   * same bucket as the sample at the given percentile.  pct is in the range
+   * [0, 100].  Returns 0 if the histogram is empty.
+   */
+  uint64_t getPercentile(double pct) const;
+
+  /**
+   * Returns the exact highest latency recorded, in microseconds, or 0 if the
+   * histogram is empty.
+   */
+  uint64_t getMax() const {
+    return max_;
+  }
+
+  static size_t bucketIndex(uint64_t value);
+  static uint64_t bucketHighestValue(size_t index);
+
+ private:
+  std::array<uint64_t, kNumBuckets> buckets_{};
+  uint64_t count_{0};
+  uint64_t max_{0};
+};
+
+} // namespace eden
+} // namespace facebook
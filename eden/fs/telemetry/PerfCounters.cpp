@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/PerfCounters.h"
+
+#include <folly/FileUtil.h>
+#include <folly/logging/xlog.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace facebook {
+namespace eden {
+namespace detail {
+
+PerfCounters globalPerfCounters;
+
+namespace {
+#ifdef __linux__
+folly::File openCounter(uint64_t config, int groupFd) {
+  struct perf_event_attr attr {};
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  // Count the calling thread on whichever CPU it runs.
+  auto fd = syscall(
+      SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC);
+  if (fd < 0) {
+    return folly::File{};
+  }
+  return folly::File{static_cast<int>(fd), /*ownsFd=*/true};
+}
+#endif
+} // namespace
+
+ThreadPerfCounters::ThreadPerfCounters() {
+#ifdef __linux__
+  group_ = openCounter(PERF_COUNT_HW_CPU_CYCLES, -1);
+  if (group_) {
+    instructions_ = openCounter(PERF_COUNT_HW_INSTRUCTIONS, group_.fd());
+    cacheMisses_ = openCounter(PERF_COUNT_HW_CACHE_MISSES, group_.fd());
+  }
+  if (!group_ || !instructions_ || !cacheMisses_) {
+    XLOG_EVERY_MS(WARN, 60000)
+        << "unable to open hardware performance counters: "
+        << folly::errnoStr(errno);
+    group_.close();
+    instructions_.close();
+    cacheMisses_.close();
+  }
+#endif
+}
+
+ThreadPerfCounters::~ThreadPerfCounters() {
+  auto exited = globalPerfCounters.exitedTotals_.wlock();
+  addTotalsTo(*exited);
+}
+
+bool ThreadPerfCounters::read(PerfCounterValues& values) {
+  if (!group_) {
+    return false;
+  }
+  // The PERF_FORMAT_GROUP layout: the number of counters, then their values
+  // in the order they were opened.
+  uint64_t buffer[4];
+  if (folly::readNoInt(group_.fd(), buffer, sizeof(buffer)) !=
+          sizeof(buffer) ||
+      buffer[0] != 3) {
+    return false;
+  }
+  values.cycles = buffer[1];
+  values.instructions = buffer[2];
+  values.cacheMisses = buffer[3];
+  return true;
+}
+
+void ThreadPerfCounters::record(
+    const char* name,
+    const PerfCounterValues& start) {
+  PerfCounterValues end;
+  if (!read(end)) {
+    return;
+  }
+  auto totals = totals_.lock();
+  auto& scope = (*totals)[name];
+  ++scope.count;
+  scope.values.cycles += end.cycles - start.cycles;
+  scope.values.instructions += end.instructions - start.instructions;
+  scope.values.cacheMisses += end.cacheMisses - start.cacheMisses;
+}
+
+void ThreadPerfCounters::addTotalsTo(
+    folly::F14FastMap<std::string, PerfCounterTotals>& totals) {
+  auto threadTotals = totals_.lock();
+  for (const auto& [name, scope] : *threadTotals) {
+    totals[name].add(scope);
+  }
+}
+
+folly::F14FastMap<std::string, PerfCounterTotals> PerfCounters::getTotals() {
+  auto totals = *exitedTotals_.rlock();
+  for (auto& counters : counters_.accessAllThreads()) {
+    counters.addTotalsTo(totals);
+  }
+  return totals;
+}
+
+void PerfCounterBlock::start(const char* name) {
+  if (globalPerfCounters.getThreadCounters().read(start_)) {
+    name_ = name;
+    thread_ = std::this_thread::get_id();
+  }
+}
+
+void PerfCounterBlock::stop() {
+  if (thread_ == std::this_thread::get_id()) {
+    globalPerfCounters.getThreadCounters().record(name_, start_);
+  }
+  name_ = nullptr;
+}
+
+} // namespace detail
+} // namespace eden
+} // namespace facebook
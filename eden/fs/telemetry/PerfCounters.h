@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <folly/SpinLock.h>
+#include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
+#include <folly/container/F14Map.h>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace facebook {
+namespace eden {
+
+struct PerfCounterValues {
+  uint64_t cycles{0};
+  uint64_t instructions{0};
+  uint64_t cacheMisses{0};
+};
+
+/** What was counted for every measured run of one scope. */
+struct PerfCounterTotals {
+  uint64_t count{0};
+  PerfCounterValues values;
+
+  void add(const PerfCounterTotals& other) {
+    count += other.count;
+    values.cycles += other.values.cycles;
+    values.instructions += other.values.instructions;
+    values.cacheMisses += other.values.cacheMisses;
+  }
+};
+
+namespace detail {
+
+/**
+ * The hardware counters of one thread, opened with perf_event_open the first
+ * time a scope is measured on it, and the totals of the scopes measured on
+ * it.
+ */
+class ThreadPerfCounters {
+ public:
+  ThreadPerfCounters();
+  ~ThreadPerfCounters();
+
+  ThreadPerfCounters(const ThreadPerfCounters&) = delete;
+  ThreadPerfCounters& operator=(const ThreadPerfCounters&) = delete;
+
+  /**
+   * Reads this thread's counters, returning false if they could not be
+   * opened. Only the owning thread may call this.
+   */
+  bool read(PerfCounterValues& values);
+
+  /** Adds what was counted since start to the totals of the named scope. */
+  void record(const char* name, const PerfCounterValues& start);
+
+  void addTotalsTo(folly::F14FastMap<std::string, PerfCounterTotals>& totals);
+
+ private:
+  folly::File group_;
+  folly::File instructions_;
+  folly::File cacheMisses_;
+  // Keyed by the address of the scope's name, which is a string literal.
+  folly::Synchronized<
+      folly::F14FastMap<const char*, PerfCounterTotals>,
+      folly::SpinLock>
+      totals_;
+};
+
+class PerfCounters {
+ public:
+  ThreadPerfCounters& getThreadCounters() {
+    return *counters_;
+  }
+
+  folly::F14FastMap<std::string, PerfCounterTotals> getTotals();
+
+ private:
+  friend class ThreadPerfCounters;
+  struct Tag {};
+
+  // The totals of threads that have exited. Declared before counters_ so
+  // that it outlives the ThreadPerfCounters that add to it when destroyed.
+  folly::Synchronized<folly::F14FastMap<std::string, PerfCounterTotals>>
+      exitedTotals_;
+  folly::ThreadLocal<ThreadPerfCounters, Tag, folly::AccessModeStrict>
+      counters_;
+};
+
+extern PerfCounters globalPerfCounters;
+
+/**
+ * Measures one run of a scope. The counters are per thread, so a scope that
+ * finishes on a different thread than it started on is not recorded.
+ */
+class PerfCounterBlock {
+ public:
+  void start(const char* name);
+  void stop();
+
+  bool isStarted() const {
+    return name_ != nullptr;
+  }
+
+ private:
+  const char* name_{nullptr};
+  std::thread::id thread_;
+  PerfCounterValues start_;
+};
+
+} // namespace detail
+
+/**
+ * The hardware counters measured for each TraceBlock name while perf
+ * counters are enabled, keyed by the name.
+ */
+inline folly::F14FastMap<std::string, PerfCounterTotals>
+getPerfCounterTotals() {
+  return detail::globalPerfCounters.getTotals();
+}
+
+} // namespace eden
+} // namespace facebook
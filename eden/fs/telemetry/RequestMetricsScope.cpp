@@ -11,6 +11,7 @@
 #include <numeric>
 
 #include <folly/String.h>
+#include <folly/lang/Bits.h>
 
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/EnumValue.h"
@@ -18,16 +19,93 @@
 namespace facebook {
 namespace eden {
 
-RequestMetricsScope::RequestMetricsScope(
-    LockedRequestWatchList* pendingRequestWatches)
-    : pendingRequestWatches_(pendingRequestWatches) {
-  folly::stop_watch<> watch;
-  {
-    auto startTimes = pendingRequestWatches_->wlock();
-    requestWatch_ = startTimes->insert(startTimes->end(), watch);
+namespace {
+RequestWatchList::Duration::rep now() {
+  // 0 marks an empty slot, so never return it.
+  return std::max<RequestWatchList::Duration::rep>(
+      1, std::chrono::steady_clock::now().time_since_epoch().count());
+}
+} // namespace
+
+RequestWatchList::~RequestWatchList() {
+  auto* chunk = head_.next.load(std::memory_order_acquire);
+  while (chunk) {
+    auto* next = chunk->next.load(std::memory_order_acquire);
+    delete chunk;
+    chunk = next;
+  }
+}
+
+RequestWatchList::Slot RequestWatchList::insert() {
+  auto start = now();
+  Chunk* chunk = &head_;
+  while (true) {
+    auto used = chunk->used.load(std::memory_order_relaxed);
+    while (used != ~uint64_t{0}) {
+      auto index = static_cast<size_t>(folly::findFirstSet(~used) - 1);
+      if (chunk->used.compare_exchange_weak(
+              used,
+              used | (uint64_t{1} << index),
+              std::memory_order_acquire,
+              std::memory_order_relaxed)) {
+        chunk->startTimes[index].store(start, std::memory_order_release);
+        return Slot{chunk, index};
+      }
+    }
+
+    auto* next = chunk->next.load(std::memory_order_acquire);
+    if (!next) {
+      auto newChunk = std::make_unique<Chunk>();
+      if (chunk->next.compare_exchange_strong(
+              next,
+              newChunk.get(),
+              std::memory_order_acq_rel,
+              std::memory_order_acquire)) {
+        next = newChunk.release();
+      }
+    }
+    chunk = next;
   }
 }
 
+void RequestWatchList::erase(Slot slot) {
+  slot.chunk->startTimes[slot.index].store(0, std::memory_order_relaxed);
+  slot.chunk->used.fetch_and(
+      ~(uint64_t{1} << slot.index), std::memory_order_release);
+}
+
+size_t RequestWatchList::size() const {
+  size_t count = 0;
+  for (auto* chunk = &head_; chunk;
+       chunk = chunk->next.load(std::memory_order_acquire)) {
+    count += folly::popcount(chunk->used.load(std::memory_order_acquire));
+  }
+  return count;
+}
+
+RequestWatchList::Duration RequestWatchList::getMaxDuration() const {
+  auto current = now();
+  Duration::rep oldest = current;
+  for (auto* chunk = &head_; chunk;
+       chunk = chunk->next.load(std::memory_order_acquire)) {
+    auto used = chunk->used.load(std::memory_order_acquire);
+    while (used) {
+      auto index = static_cast<size_t>(folly::findFirstSet(used) - 1);
+      used &= used - 1;
+      auto start = chunk->startTimes[index].load(std::memory_order_acquire);
+      if (start != 0) {
+        oldest = std::min(oldest, start);
+      }
+    }
+  }
+  return Duration{current - oldest};
+}
+
+RequestMetricsScope::RequestMetricsScope(
+    RequestWatchList* pendingRequestWatches)
+    : pendingRequestWatches_(pendingRequestWatches),
+      requestWatch_(pendingRequestWatches_->insert()) {}
+
 RequestMetricsScope::RequestMetricsScope() : pendingRequestWatches_(nullptr) {}
 
 RequestMetricsScope::RequestMetricsScope(RequestMetricsScope&& other) noexcept
@@ -38,6 +116,9 @@ RequestMetricsScope::RequestMetricsScope(RequestMetricsScope&& other) noexcept
 
 RequestMetricsScope& RequestMetricsScope::operator=(
     RequestMetricsScope&& other) {
+  if (pendingRequestWatches_ != nullptr) {
+    RequestWatchList::erase(requestWatch_);
+  }
   this->pendingRequestWatches_ = std::move(other.pendingRequestWatches_);
   this->requestWatch_ = std::move(other.requestWatch_);
   other.pendingRequestWatches_ = nullptr;
@@ -46,8 +127,7 @@ RequestMetricsScope& RequestMetricsScope::operator=(
 
 RequestMetricsScope::~RequestMetricsScope() {
   if (pendingRequestWatches_ != nullptr) {
-    auto startTimes = pendingRequestWatches_->wlock();
-    startTimes->erase(requestWatch_);
+    RequestWatchList::erase(requestWatch_);
   }
 }
 
@@ -99,10 +179,10 @@ size_t RequestMetricsScope::aggregateMetricCounters(
 
 size_t RequestMetricsScope::getMetricFromWatches(
     RequestMetric metric,
-    const LockedRequestWatchList& watches) {
+    const RequestWatchList& watches) {
   switch (metric) {
     case COUNT:
-      return watches.rlock()->size();
+      return watches.size();
     case MAX_DURATION_US:
       return static_cast<size_t>(
           std::chrono::duration_cast<std::chrono::microseconds>(
@@ -113,15 +193,8 @@ size_t RequestMetricsScope::getMetricFromWatches(
 }
 
 RequestMetricsScope::DefaultRequestDuration RequestMetricsScope::getMaxDuration(
-    const LockedRequestWatchList& watches) {
-  DefaultRequestDuration maxDurationImport{0};
-  {
-    auto lockedWatches = watches.rlock();
-    for (const auto& watch : *lockedWatches) {
-      maxDurationImport = std::max(maxDurationImport, watch.elapsed());
-    }
-  }
-  return maxDurationImport;
+    const RequestWatchList& watches) {
+  return watches.getMaxDuration();
 }
 
 } // namespace eden
@@ -7,33 +7,89 @@
 
 #pragma once
 
-#include <list>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <folly/String.h>
-#include <folly/Synchronized.h>
-#include <folly/stop_watch.h>
 
 namespace facebook {
 namespace eden {
 
 /**
- * Represents a request tracked in a RequestMetricsScope::RequestWatchList.
- * To track a request a RequestMetricsScope object should be in scope for the
- * duration of the request.
+ * The start times of the requests currently tracked by RequestMetricsScope
+ * objects.
+ *
+ * Starting and finishing a request never takes a lock: start times live in
+ * fixed-size chunks of slots, each with a bitmap of the slots in use, and a
+ * request claims a slot with a compare-and-swap on the bitmap.  Chunks are
+ * added when every slot is in use and are only freed with the list, so its
+ * memory is bounded by the peak number of concurrent requests.
+ *
+ * Reads scan every chunk, which is cheap since they only happen when stats
+ * are collected.  They may miss a request that starts or finishes while they
+ * run.
+ */
+class RequestWatchList {
+ public:
+  using Duration = std::chrono::steady_clock::duration;
+
+  RequestWatchList() = default;
+  RequestWatchList(const RequestWatchList&) = delete;
+  RequestWatchList& operator=(const RequestWatchList&) = delete;
+  ~RequestWatchList();
+
+  /** The number of requests currently being tracked. */
+  size_t size() const;
+
+  /**
+   * How long the oldest request currently being tracked has been running,
+   * or 0 if there are none.
+   */
+  Duration getMaxDuration() const;
+
+ private:
+  friend class RequestMetricsScope;
+
+  static constexpr size_t kSlotsPerChunk = 64;
+
+  struct Chunk {
+    std::atomic<uint64_t> used{0};
+    // steady_clock ticks at which each request started; 0 while the slot is
+    // being claimed or released.
+    std::array<std::atomic<Duration::rep>, kSlotsPerChunk> startTimes{};
+    std::atomic<Chunk*> next{nullptr};
+  };
+
+  struct Slot {
+    Chunk* chunk{nullptr};
+    size_t index{0};
+  };
+
+  Slot insert();
+  static void erase(Slot slot);
+
+  Chunk head_;
+};
+
+/**
+ * Represents a request tracked in a RequestWatchList.  To track a request a
+ * RequestMetricsScope object should be in scope for the duration of the
+ * request.
  *
  * The scope inserts a watch into the given list on construction and removes
  * that watch on destruction.
  */
 class RequestMetricsScope {
  public:
-  using RequestWatchList = std::list<folly::stop_watch<>>;
-  using LockedRequestWatchList = folly::Synchronized<RequestWatchList>;
-  using DefaultRequestDuration =
-      std::chrono::steady_clock::steady_clock::duration;
+  using RequestWatchList = eden::RequestWatchList;
+  using DefaultRequestDuration = RequestWatchList::Duration;
 
-  RequestMetricsScope(LockedRequestWatchList* pendingRequestWatches);
+  RequestMetricsScope(RequestWatchList* pendingRequestWatches);
   RequestMetricsScope();
   RequestMetricsScope(RequestMetricsScope&&) noexcept;
   RequestMetricsScope& operator=(RequestMetricsScope&&);
@@ -95,18 +151,18 @@ class RequestMetricsScope {
    */
   static size_t getMetricFromWatches(
       RequestMetric metric,
-      const LockedRequestWatchList& watches);
+      const RequestWatchList& watches);
 
   /**
    * finds the watch in `watches` for which the time that has elapsed
    * is the greatest and returns the duration of time that has elapsed
    */
   static DefaultRequestDuration getMaxDuration(
-      const LockedRequestWatchList& watches);
+      const RequestWatchList& watches);
 
  private:
-  LockedRequestWatchList* pendingRequestWatches_;
-  RequestWatchList::iterator requestWatch_;
+  RequestWatchList* pendingRequestWatches_;
+  RequestWatchList::Slot requestWatch_;
 }; // namespace eden
 } // namespace eden
 } // namespace facebook
@@ -7,6 +7,7 @@
 
 #include "eden/fs/telemetry/StructuredLogger.h"
 
+#include <folly/Random.h>
 #include <time.h>
 #include <random>
 
@@ -40,6 +41,22 @@ StructuredLogger::StructuredLogger(bool enabled, SessionInfo sessionInfo)
       sessionId_{getSessionId()},
       sessionInfo_{std::move(sessionInfo)} {}
 
+void StructuredLogger::setSampleRate(folly::StringPiece type, uint32_t rate) {
+  sampleRates_[type.str()] = rate;
+}
+
+bool StructuredLogger::isSampledOut(const char* type) {
+  auto it = sampleRates_.find(type);
+  if (it == sampleRates_.end()) {
+    return false;
+  }
+  if (it->second != 0 && folly::Random::oneIn(it->second)) {
+    return false;
+  }
+  sampledOut_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
 DynamicEvent StructuredLogger::populateDefaultFields(const char* type) {
   DynamicEvent event;
   if (kExplicitTimeField) {
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <folly/Range.h>
+#include <atomic>
+#include <string>
 #include <unordered_map>
 #include "eden/fs/telemetry/LogEvent.h"
 #include "eden/fs/telemetry/SessionInfo.h"
@@ -30,22 +33,43 @@ class StructuredLogger {
     // constexpr to ensure that the type field on the Event struct is constexpr
     // too.
     constexpr const char* type = Event::type;
+    if (!sampleRates_.empty() && isSampledOut(type)) {
+      return;
+    }
 
-    // TODO: consider moving the event to another thread and populating the
-    // default fields there to reduce latency at the call site.
     DynamicEvent de{populateDefaultFields(type)};
     event.populate(de);
     logDynamicEvent(std::move(de));
   }
 
+  /**
+   * Only log one in every rate events of the given type, chosen at random.
+   * A rate of 0 drops every event of that type.
+   *
+   * This must be called before the logger is shared with other threads.
+   */
+  void setSampleRate(folly::StringPiece type, uint32_t rate);
+
+  /** The number of events that were not logged because of sampling. */
+  uint64_t getSampledOutCount() const {
+    return sampledOut_.load(std::memory_order_relaxed);
+  }
+
  private:
+  // Forwards events to another logger's logDynamicEvent.
+  friend class AsyncStructuredLogger;
+
   virtual void logDynamicEvent(DynamicEvent event) = 0;
 
+  bool isSampledOut(const char* type);
+
   DynamicEvent populateDefaultFields(const char* type);
 
   bool enabled_;
   uint32_t sessionId_;
   SessionInfo sessionInfo_;
+  std::unordered_map<std::string, uint32_t> sampleRates_;
+  std::atomic<uint64_t> sampledOut_{0};
 };
 
 } // namespace eden
@@ -6,11 +6,14 @@
  */
 
 #include "eden/fs/telemetry/StructuredLoggerFactory.h"
+#include <folly/Conv.h>
+#include <folly/String.h>
 #include <folly/logging/xlog.h>
 #include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/telemetry/NullStructuredLogger.h"
 
 #ifndef _WIN32
+#include "eden/fs/telemetry/AsyncStructuredLogger.h"
 #include "eden/fs/telemetry/ScubaStructuredLogger.h"
 #include "eden/fs/telemetry/SubprocessScribeLogger.h"
 #endif
@@ -18,6 +21,27 @@
 namespace facebook {
 namespace eden {
 
+namespace {
+void applySampleRates(StructuredLogger& logger, folly::StringPiece rates) {
+  std::vector<folly::StringPiece> entries;
+  folly::split(',', rates, entries, /*ignoreEmpty=*/true);
+  for (auto entry : entries) {
+    folly::StringPiece type;
+    folly::StringPiece rate;
+    if (!folly::split('=', entry, type, rate)) {
+      XLOG(WARN) << "ignoring malformed structured log sample rate: " << entry;
+      continue;
+    }
+    auto value = folly::tryTo<uint32_t>(folly::trimWhitespace(rate));
+    if (!value) {
+      XLOG(WARN) << "ignoring malformed structured log sample rate: " << entry;
+      continue;
+    }
+    logger.setSampleRate(folly::trimWhitespace(type), *value);
+  }
+}
+} // namespace
+
 std::unique_ptr<StructuredLogger> makeDefaultStructuredLogger(
     const EdenConfig& config,
     SessionInfo sessionInfo) {
@@ -37,8 +61,20 @@ std::unique_ptr<StructuredLogger> makeDefaultStructuredLogger(
 #ifndef _WIN32
   auto logger =
       std::make_unique<SubprocessScribeLogger>(binary.c_str(), category);
-  return std::make_unique<ScubaStructuredLogger>(
-      std::move(logger), std::move(sessionInfo));
+  std::unique_ptr<StructuredLogger> structuredLogger =
+      std::make_unique<ScubaStructuredLogger>(std::move(logger), sessionInfo);
+  auto queueSize = config.structuredLogQueueSize.getValue();
+  if (queueSize != 0) {
+    structuredLogger = std::make_unique<AsyncStructuredLogger>(
+        std::move(structuredLogger),
+        std::move(sessionInfo),
+        queueSize,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            config.structuredLogFlushInterval.getValue()));
+  }
+  applySampleRates(
+      *structuredLogger, config.structuredLogSampleRates.getValue());
+  return structuredLogger;
 #else
   return std::make_unique<NullStructuredLogger>();
 #endif
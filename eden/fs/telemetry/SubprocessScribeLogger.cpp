@@ -7,8 +7,10 @@
 
 #include "eden/fs/telemetry/SubprocessScribeLogger.h"
 
+#include <folly/FileUtil.h>
 #include <folly/logging/xlog.h>
 #include <folly/system/ThreadName.h>
+#include <vector>
 
 using folly::Subprocess;
 
@@ -18,6 +20,8 @@ namespace {
  * following bytes.
  */
 constexpr size_t kQueueLimitBytes = 128 * 1024;
+// Each message takes two iovecs, so this stays well under IOV_MAX.
+constexpr size_t kMaxBatchMessages = 64;
 
 constexpr std::chrono::seconds kFlushTimeout{1};
 constexpr std::chrono::seconds kProcessExitTimeout{1};
@@ -109,8 +113,11 @@ void SubprocessScribeLogger::log(std::string message) {
 void SubprocessScribeLogger::writerThread() {
   int fd = process_.stdinFd();
 
+  std::list<std::string> batch;
+  std::vector<iovec> iov;
+  char newline = '\n';
   for (;;) {
-    std::string message;
+    batch.clear();
 
     {
       auto state = state_.lock();
@@ -118,13 +125,21 @@ void SubprocessScribeLogger::writerThread() {
         return state->shouldStop || !state->messages.empty();
       });
       if (!state->messages.empty()) {
-        CHECK_LE(state->messages.front().size(), state->totalBytes)
+        // Write up to kMaxBatchMessages queued messages with one writev.
+        auto end = state->messages.begin();
+        size_t batchBytes = 0;
+        for (size_t i = 0;
+             i < kMaxBatchMessages && end != state->messages.end();
+             ++i, ++end) {
+          batchBytes += end->size();
+        }
+        CHECK_LE(batchBytes, state->totalBytes)
             << "totalSize accounting fell out of sync!";
 
         // The below statements are all noexcept.
-        std::swap(message, state->messages.front());
-        state->messages.pop_front();
-        state->totalBytes -= message.size();
+        batch.splice(
+            batch.end(), state->messages, state->messages.begin(), end);
+        state->totalBytes -= batchBytes;
       } else {
         // If the predicate succeeded but we have no messages, then we're
         // shutting down cleanly.
@@ -138,13 +153,12 @@ void SubprocessScribeLogger::writerThread() {
       }
     }
 
-    char newline = '\n';
-    std::array<iovec, 2> iov;
-    iov[0].iov_base = message.data();
-    iov[0].iov_len = message.size();
-    iov[1].iov_base = &newline;
-    iov[1].iov_len = sizeof(newline);
-    if (-1 == folly::writevNoInt(fd, iov.data(), iov.size())) {
+    iov.clear();
+    for (auto& message : batch) {
+      iov.push_back({message.data(), message.size()});
+      iov.push_back({&newline, sizeof(newline)});
+    }
+    if (-1 == folly::writevFull(fd, iov.data(), iov.size())) {
       // TODO: We could attempt to restart the process here.
       XLOG(ERR) << "Failed to writev to logger process stdin: "
                 << folly::errnoStr(errno) << ". Giving up!";
@@ -16,24 +16,73 @@ void ThreadLocalTracePoints::flush() {
   auto points = globalTracer.tracepoints_.wlock();
   auto state = state_.lock();
   size_t npoints = std::min(kBufferPoints, state->currNum_);
-  points->insert(
-      points->end(),
+  points->append(
+      state->tracePoints_.data(), state->tracePoints_.data() + npoints);
+  state->currNum_ = 0;
+}
+
+void ThreadLocalTracePoints::copyTo(std::vector<CompactTracePoint>& points) {
+  auto state = state_.lock();
+  size_t npoints = std::min(kBufferPoints, state->currNum_);
+  points.insert(
+      points.end(),
+      state->tracePoints_.begin(),
+      state->tracePoints_.begin() + npoints);
+}
+
+void ThreadLocalTracePoints::drainTo(std::vector<CompactTracePoint>& points) {
+  auto state = state_.lock();
+  size_t npoints = std::min(kBufferPoints, state->currNum_);
+  points.insert(
+      points.end(),
       state->tracePoints_.begin(),
       state->tracePoints_.begin() + npoints);
   state->currNum_ = 0;
 }
 
+void Tracer::ExitedTracePoints::append(
+    const CompactTracePoint* begin,
+    const CompactTracePoint* end) {
+  for (auto it = begin; it != end; ++it) {
+    if (points.size() < kExitedThreadPoints) {
+      points.push_back(*it);
+    } else {
+      points[next] = *it;
+      next = (next + 1) % kExitedThreadPoints;
+    }
+  }
+}
+
 folly::RequestToken tracingToken("eden_tracing");
 
 std::vector<CompactTracePoint> Tracer::getAllTracepoints() {
+  // Live threads' points bypass the exited thread ring, so that draining
+  // many full buffers at once does not overwrite any of them.
+  std::vector<CompactTracePoint> points;
+  {
+    auto exited = tracepoints_.wlock();
+    points = std::move(exited->points);
+    exited->points.clear();
+    exited->next = 0;
+  }
+  for (auto& tltp : tltp_.accessAllThreads()) {
+    tltp.drainTo(points);
+  }
+  std::sort(points.begin(), points.end(), [](const auto& a, const auto& b) {
+    return a.timestamp < b.timestamp;
+  });
+  return points;
+}
+
+std::vector<CompactTracePoint> Tracer::snapshotTracepoints() {
+  std::vector<CompactTracePoint> points = tracepoints_.rlock()->points;
   for (auto& tltp : tltp_.accessAllThreads()) {
-    tltp.flush();
+    tltp.copyTo(points);
   }
-  auto points = tracepoints_.wlock();
-  std::sort(points->begin(), points->end(), [](const auto& a, const auto& b) {
+  std::sort(points.begin(), points.end(), [](const auto& a, const auto& b) {
     return a.timestamp < b.timestamp;
   });
-  return std::move(*points);
+  return points;
 }
 } // namespace detail
 } // namespace eden
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <cstdint>
+#include <utility>
 
 #include <folly/ClockGettimeWrappers.h>
 #include <folly/Singleton.h>
@@ -18,6 +19,7 @@
 #include <folly/lang/Aligned.h>
 #include <folly/logging/xlog.h>
 
+#include "eden/fs/telemetry/PerfCounters.h"
 #include "eden/fs/utils/IDGen.h"
 
 namespace facebook {
@@ -59,8 +61,26 @@ class ThreadLocalTracePoints {
     flush();
   }
 
+  /** Moves the buffered tracepoints into the Tracer's exited thread store. */
   void flush();
 
+  /**
+   * Appends the buffered tracepoints to points without removing them from
+   * the buffer.
+   */
+  void copyTo(std::vector<CompactTracePoint>& points);
+
+  /** Like copyTo, but empties the buffer. */
+  void drainTo(std::vector<CompactTracePoint>& points);
+
+  /**
+   * Returns true for one in every sampleRate calls made on this thread.
+   * Only the owning thread may call this.
+   */
+  bool sampleNext(uint32_t sampleRate) {
+    return ++sampleCount_ % sampleRate == 0;
+  }
+
   FOLLY_ALWAYS_INLINE void trace(
       uint64_t traceId,
       uint64_t blockId,
@@ -87,6 +107,7 @@ class ThreadLocalTracePoints {
   };
 
   folly::Synchronized<State, folly::SpinLock> state_;
+  uint32_t sampleCount_{0};
 };
 
 class TraceRequestData : public folly::RequestData {
@@ -97,6 +118,9 @@ class TraceRequestData : public folly::RequestData {
 
   uint64_t traceId{0};
   uint64_t blockId{0};
+  // Whether this request was picked for sampled tracing when its first
+  // TraceBlock was created
+  bool sampled{false};
 };
 
 extern folly::RequestToken tracingToken;
@@ -120,32 +144,91 @@ class Tracer {
     return *tltp_;
   }
 
+  /**
+   * The most tracepoints kept from threads that have exited, 3 MB worth.
+   * Older points are overwritten first, like in a thread's own buffer.
+   */
+  static constexpr size_t kExitedThreadPoints = 64 * 1024;
+
   std::vector<CompactTracePoint> getAllTracepoints();
+  std::vector<CompactTracePoint> snapshotTracepoints();
+
+  /** Whether TraceBlocks need to look at their request at all. */
+  bool isActive() noexcept {
+    return state_->enabled.load(std::memory_order_acquire) ||
+        state_->sampleRate.load(std::memory_order_acquire) != 0;
+  }
 
   bool isEnabled() noexcept {
-    return enabled_->load(std::memory_order_acquire);
+    return state_->enabled.load(std::memory_order_acquire);
   }
 
   void enable() noexcept {
-    enabled_->store(true, std::memory_order_release);
+    state_->enabled.store(true, std::memory_order_release);
   }
 
   void disable() noexcept {
-    enabled_->store(false, std::memory_order_release);
+    state_->enabled.store(false, std::memory_order_release);
+  }
+
+  bool arePerfCountersEnabled() noexcept {
+    return state_->perfCounters.load(std::memory_order_acquire);
+  }
+
+  void setPerfCountersEnabled(bool enabled) noexcept {
+    state_->perfCounters.store(enabled, std::memory_order_release);
+  }
+
+  uint32_t getSampleRate() noexcept {
+    return state_->sampleRate.load(std::memory_order_acquire);
+  }
+
+  void setSampleRate(uint32_t sampleRate) noexcept {
+    state_->sampleRate.store(sampleRate, std::memory_order_release);
+  }
+
+  /**
+   * Decides whether a request whose first TraceBlock is being created
+   * should be traced.
+   */
+  bool shouldTraceNewRequest() {
+    if (isEnabled()) {
+      return true;
+    }
+    auto sampleRate = getSampleRate();
+    return sampleRate != 0 && tltp_->sampleNext(sampleRate);
   }
 
  private:
   friend class ThreadLocalTracePoints;
   struct Tag {};
 
-  folly::cacheline_aligned<std::atomic<bool>> enabled_{folly::in_place, false};
+  struct State {
+    std::atomic<bool> enabled{false};
+    // Trace one in every sampleRate requests; 0 disables sampling
+    std::atomic<uint32_t> sampleRate{0};
+    // Whether TraceBlocks read the hardware performance counters
+    std::atomic<bool> perfCounters{false};
+  };
+
+  /**
+   * A ring of the tracepoints left by exited threads, which is written to
+   * only when a thread dies and emptied by getAllTracepoints. Bounding it
+   * keeps threads that come and go while tracing is on from growing it
+   * without limit.
+   */
+  struct ExitedTracePoints {
+    void append(const CompactTracePoint* begin, const CompactTracePoint* end);
+
+    std::vector<CompactTracePoint> points;
+    // Where the next point goes once points is full
+    size_t next{0};
+  };
+
+  folly::cacheline_aligned<State> state_{folly::in_place};
   folly::ThreadLocal<ThreadLocalTracePoints, Tag, folly::AccessModeStrict>
       tltp_;
-  // This is written to only when a thread dies and when
-  // getAllTracepoints is invoked, though the latter will leave it
-  // empty. As long as threads aren't continuously being created and
-  // destroyed while tracing is on, this shouldn't grow large
-  folly::Synchronized<std::vector<CompactTracePoint>> tracepoints_;
+  folly::Synchronized<ExitedTracePoints> tracepoints_;
 };
 
 extern Tracer globalTracer;
@@ -174,6 +257,42 @@ inline std::vector<CompactTracePoint> getAllTracepoints() {
   return detail::globalTracer.getAllTracepoints();
 }
 
+/*
+ * Sampled tracing records every TraceBlock of one in every sampleRate
+ * requests, chosen when the request's first TraceBlock is created, whether
+ * or not tracing is enabled. Each thread keeps only its most recent
+ * tracepoints, so sampling can be left on to catch rare slow requests after
+ * the fact. A sampleRate of 0 turns sampling off.
+ */
+inline void setTraceSampleRate(uint32_t sampleRate) {
+  detail::globalTracer.setSampleRate(sampleRate);
+}
+
+inline uint32_t getTraceSampleRate() {
+  return detail::globalTracer.getSampleRate();
+}
+
+/*
+ * Like getAllTracepoints, but leaves the tracepoints in place so that the
+ * buffers can be inspected repeatedly. Points that have been overwritten in
+ * a thread's buffer are lost, so a block may be missing its start or stop.
+ */
+inline std::vector<CompactTracePoint> snapshotTracepoints() {
+  return detail::globalTracer.snapshotTracepoints();
+}
+
+/*
+ * While enabled, every TraceBlock reads its thread's hardware performance
+ * counters (cycles, instructions and cache misses) when it starts and
+ * stops, and adds the difference to the totals of its name, which
+ * getPerfCounterTotals returns. This does not depend on tracing being
+ * enabled, but costs two syscalls per TraceBlock, so it is meant for
+ * diagnosing a slow machine rather than for always being left on.
+ */
+inline void setPerfCountersEnabled(bool enabled) {
+  detail::globalTracer.setPerfCountersEnabled(enabled);
+}
+
 /*
  * TraceBlocks demark sections of eden's execution so we can analyze
  * the behavior of a request in a fine-grained fashion.
@@ -200,13 +319,21 @@ class TraceBlock {
    */
   template <size_t size>
   explicit TraceBlock(const char (&name)[size]) {
-    if (detail::globalTracer.isEnabled()) {
-      blockId_ = generateUniqueID();
+    if (FOLLY_UNLIKELY(detail::globalTracer.arePerfCountersEnabled())) {
+      perf_.start(name);
+    }
+    if (detail::globalTracer.isActive()) {
       auto& reqData = detail::Tracer::getRequestData();
       if (!reqData.traceId) {
         reqData.traceId = generateUniqueID();
+        reqData.sampled = detail::globalTracer.shouldTraceNewRequest();
+      }
+      if (!reqData.sampled && !detail::globalTracer.isEnabled()) {
+        return;
       }
 
+      blockId_ = generateUniqueID();
+
       parentBlockId_ = reqData.blockId;
       detail::globalTracer.getThreadLocalTracePoints().trace(
           reqData.traceId,
@@ -224,12 +351,14 @@ class TraceBlock {
   TraceBlock(TraceBlock&& other) noexcept {
     blockId_ = other.blockId_;
     parentBlockId_ = other.parentBlockId_;
+    perf_ = std::exchange(other.perf_, detail::PerfCounterBlock{});
     other.blockId_ = 0;
   }
   TraceBlock& operator=(TraceBlock&& other) {
     close();
     blockId_ = other.blockId_;
     parentBlockId_ = other.parentBlockId_;
+    perf_ = std::exchange(other.perf_, detail::PerfCounterBlock{});
     other.blockId_ = 0;
     return *this;
   }
@@ -242,6 +371,9 @@ class TraceBlock {
    * Explicitly end the TraceBlock before the destructor
    */
   void close() {
+    if (perf_.isStarted()) {
+      perf_.stop();
+    }
     if (blockId_) {
       auto& reqData = detail::Tracer::getRequestData();
       detail::globalTracer.getThreadLocalTracePoints().trace(
@@ -259,6 +391,7 @@ class TraceBlock {
  private:
   uint64_t blockId_{0};
   uint64_t parentBlockId_{0};
+  detail::PerfCounterBlock perf_;
 };
 
 } // namespace eden
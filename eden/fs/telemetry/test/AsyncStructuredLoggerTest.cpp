@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/AsyncStructuredLogger.h"
+#include <gtest/gtest.h>
+#include "eden/fs/telemetry/ScribeLogger.h"
+#include "eden/fs/telemetry/ScubaStructuredLogger.h"
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct TestScribeLogger : public ScribeLogger {
+  std::vector<std::string> lines;
+
+  void log(std::string line) override {
+    lines.emplace_back(std::move(line));
+  }
+};
+
+struct TestLogEvent {
+  static constexpr const char* type = "test_event";
+
+  int number = 0;
+
+  void populate(DynamicEvent& event) const {
+    event.addInt("number", number);
+  }
+};
+
+struct OtherLogEvent {
+  static constexpr const char* type = "other_event";
+
+  void populate(DynamicEvent&) const {}
+};
+
+struct AsyncStructuredLoggerTest : public ::testing::Test {
+  // The flush interval is long enough that events are only forwarded when the
+  // tests ask for it.
+  std::unique_ptr<AsyncStructuredLogger> makeLogger(size_t maxQueuedEvents) {
+    return std::make_unique<AsyncStructuredLogger>(
+        std::make_unique<ScubaStructuredLogger>(scribe, SessionInfo{}),
+        SessionInfo{},
+        maxQueuedEvents,
+        1h);
+  }
+
+  std::shared_ptr<TestScribeLogger> scribe{
+      std::make_shared<TestScribeLogger>()};
+};
+
+} // namespace
+
+TEST_F(AsyncStructuredLoggerTest, flush_forwards_queued_events) {
+  auto logger = makeLogger(16);
+  logger->logEvent(TestLogEvent{1});
+  logger->logEvent(TestLogEvent{2});
+  logger->flush();
+  ASSERT_EQ(2, scribe->lines.size());
+  EXPECT_NE(std::string::npos, scribe->lines[0].find("\"number\":1"));
+  EXPECT_NE(std::string::npos, scribe->lines[1].find("\"number\":2"));
+}
+
+TEST_F(AsyncStructuredLoggerTest, destructor_forwards_queued_events) {
+  auto logger = makeLogger(16);
+  logger->logEvent(TestLogEvent{1});
+  logger.reset();
+  EXPECT_EQ(1, scribe->lines.size());
+}
+
+TEST_F(AsyncStructuredLoggerTest, events_are_dropped_when_queue_is_full) {
+  auto logger = makeLogger(2);
+  for (int i = 0; i < 5; ++i) {
+    logger->logEvent(TestLogEvent{i});
+  }
+  EXPECT_EQ(3, logger->getDroppedCount());
+  logger->flush();
+  EXPECT_EQ(2, scribe->lines.size());
+
+  // Forwarding the queued events makes room for new ones.
+  logger->logEvent(TestLogEvent{5});
+  logger->flush();
+  EXPECT_EQ(3, scribe->lines.size());
+  EXPECT_EQ(3, logger->getDroppedCount());
+}
+
+TEST_F(AsyncStructuredLoggerTest, sample_rate_applies_per_event_type) {
+  auto logger = makeLogger(16);
+  logger->setSampleRate(TestLogEvent::type, 0);
+  logger->setSampleRate(OtherLogEvent::type, 1);
+  for (int i = 0; i < 4; ++i) {
+    logger->logEvent(TestLogEvent{i});
+    logger->logEvent(OtherLogEvent{});
+  }
+  logger->flush();
+  EXPECT_EQ(4, scribe->lines.size());
+  EXPECT_EQ(4, logger->getSampledOutCount());
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/LatencyHistogram.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+TEST(LatencyHistogram, emptyHistogramReportsZero) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0, histogram.count());
+  EXPECT_EQ(0, histogram.getPercentile(50));
+  EXPECT_EQ(0, histogram.getPercentile(99.9));
+}
+
+TEST(LatencyHistogram, bucketsBoundRelativeError) {
+  // Small values are exact.
+  for (uint64_t value = 0; value < LatencyHistogram::kSubBuckets; ++value) {
+    EXPECT_EQ(
+        value,
+        LatencyHistogram::bucketHighestValue(
+            LatencyHistogram::bucketIndex(value)));
+  }
+
+  for (uint64_t value : {8ul, 9ul, 17ul, 1000ul, 12345ul, 1000000ul}) {
+    auto highest = LatencyHistogram::bucketHighestValue(
+        LatencyHistogram::bucketIndex(value));
+    EXPECT_GE(highest, value);
+    EXPECT_LE(highest - value, value / LatencyHistogram::kSubBuckets)
+        << "value " << value;
+  }
+
+  // Bucket indices are monotonic and cover the whole range.
+  size_t lastIndex = 0;
+  for (uint64_t value = 1; value < (uint64_t{1} << 40); value *= 3) {
+    auto index = LatencyHistogram::bucketIndex(value);
+    EXPECT_GE(index, lastIndex);
+    EXPECT_LT(index, LatencyHistogram::kNumBuckets);
+    lastIndex = index;
+  }
+}
+
+TEST(LatencyHistogram, percentilesFindTheTail) {
+  LatencyHistogram histogram;
+  for (int i = 0; i < 990; ++i) {
+    histogram.addValue(100us);
+  }
+  for (int i = 0; i < 9; ++i) {
+    histogram.addValue(20ms);
+  }
+  histogram.addValue(2s);
+  EXPECT_EQ(1000, histogram.count());
+
+  auto p50 = histogram.getPercentile(50);
+  EXPECT_GE(p50, 100);
+  EXPECT_LT(p50, 100 + 100 / 8);
+
+  auto p99 = histogram.getPercentile(99);
+  EXPECT_EQ(p50, p99);
+
+  auto p999 = histogram.getPercentile(99.9);
+  EXPECT_GE(p999, 20000);
+  EXPECT_LT(p999, 20000 + 20000 / 8);
+
+  auto max = histogram.getPercentile(100);
+  EXPECT_GE(max, 2000000);
+  EXPECT_LT(max, 2000000 + 2000000 / 8);
+}
+
+TEST(LatencyHistogram, mergeAndClear) {
+  LatencyHistogram a;
+  LatencyHistogram b;
+  a.addValue(10us);
+  b.addValue(10ms);
+  b.addValue(10ms);
+
+  a.merge(b);
+  EXPECT_EQ(3, a.count());
+  EXPECT_GE(a.getPercentile(50), 10000);
+  EXPECT_EQ(10000, a.getMax());
+
+  a.clear();
+  EXPECT_EQ(0, a.count());
+  EXPECT_EQ(0, a.getPercentile(100));
+  EXPECT_EQ(0, a.getMax());
+}
+
+TEST(LatencyHistogram, maxIsExact) {
+  LatencyHistogram histogram;
+  histogram.addValue(1us);
+  histogram.addValue(123457us);
+  histogram.addValue(1000us);
+  EXPECT_EQ(123457, histogram.getMax());
+  EXPECT_GE(histogram.getPercentile(100), histogram.getMax());
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/RequestMetricsScope.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+TEST(RequestMetricsScope, tracks_live_requests) {
+  RequestWatchList watches;
+  EXPECT_EQ(0, watches.size());
+  EXPECT_EQ(0, watches.getMaxDuration().count());
+  {
+    RequestMetricsScope first{&watches};
+    std::this_thread::sleep_for(1ms);
+    RequestMetricsScope second{&watches};
+    EXPECT_EQ(2, watches.size());
+    EXPECT_GE(watches.getMaxDuration(), 1ms);
+  }
+  EXPECT_EQ(0, watches.size());
+}
+
+TEST(RequestMetricsScope, grows_past_one_chunk) {
+  RequestWatchList watches;
+  std::vector<RequestMetricsScope> scopes;
+  for (int i = 0; i < 200; ++i) {
+    scopes.emplace_back(&watches);
+  }
+  EXPECT_EQ(200, watches.size());
+  scopes.erase(scopes.begin(), scopes.begin() + 150);
+  EXPECT_EQ(50, watches.size());
+  for (int i = 0; i < 100; ++i) {
+    scopes.emplace_back(&watches);
+  }
+  EXPECT_EQ(150, watches.size());
+  scopes.clear();
+  EXPECT_EQ(0, watches.size());
+}
+
+TEST(RequestMetricsScope, move_transfers_the_request) {
+  RequestWatchList watches;
+  RequestMetricsScope scope{&watches};
+  RequestMetricsScope moved{std::move(scope)};
+  EXPECT_EQ(1, watches.size());
+  RequestMetricsScope assigned{&watches};
+  assigned = std::move(moved);
+  EXPECT_EQ(1, watches.size());
+}
+
+TEST(RequestMetricsScope, concurrent_requests) {
+  RequestWatchList watches;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&watches] {
+      for (int i = 0; i < 1000; ++i) {
+        RequestMetricsScope scope{&watches};
+        RequestMetricsScope nested{&watches};
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, watches.size());
+}
@@ -7,6 +7,8 @@
 
 #include <gtest/gtest.h>
 
+#include <thread>
+
 #include <folly/executors/ThreadedExecutor.h>
 #include <folly/futures/Future.h>
 
@@ -130,3 +132,98 @@ TEST(Tracing, does_not_record_if_disabled) {
   auto points = getAllTracepoints();
   ASSERT_EQ(0, points.size());
 }
+
+TEST(Tracing, samples_one_in_n_requests) {
+  disableTracing();
+  (void)getAllTracepoints();
+
+  setTraceSampleRate(4);
+  for (int i = 0; i < 8; ++i) {
+    folly::RequestContextScopeGuard guard;
+    TraceBlock block{"my_block"};
+    TraceBlock block2{"my_block2"};
+  }
+  setTraceSampleRate(0);
+
+  auto points = getAllTracepoints();
+  // Two requests, each with two blocks
+  ensureValidTracePoints(points, 8);
+  EXPECT_NE(points[0].traceId, points[4].traceId);
+  for (auto i = 1; i < 4; ++i) {
+    EXPECT_EQ(points[0].traceId, points[i].traceId);
+    EXPECT_EQ(points[4].traceId, points[4 + i].traceId);
+  }
+  EXPECT_EQ(points[0].blockId, points[1].parentBlockId);
+}
+
+TEST(Tracing, snapshot_does_not_drain) {
+  (void)getAllTracepoints();
+
+  enableTracing();
+  {
+    folly::RequestContextScopeGuard guard;
+    TraceBlock block{"my_block"};
+  }
+  disableTracing();
+
+  auto snapshot = snapshotTracepoints();
+  ensureValidTracePoints(snapshot, 2);
+  snapshot = snapshotTracepoints();
+  ensureValidTracePoints(snapshot, 2);
+  ensureValidBlock();
+  EXPECT_EQ(0, snapshotTracepoints().size());
+}
+
+TEST(Tracing, exited_threads_keep_a_bounded_number_of_points) {
+  (void)getAllTracepoints();
+
+  // Each thread fills a quarter of the exited thread store before it exits.
+  constexpr size_t kThreads = 8;
+  constexpr size_t kBlocksPerThread =
+      detail::Tracer::kExitedThreadPoints / 4 / 2;
+  enableTracing();
+  for (size_t i = 0; i < kThreads; ++i) {
+    std::thread([] {
+      for (size_t j = 0; j < kBlocksPerThread; ++j) {
+        folly::RequestContextScopeGuard guard;
+        TraceBlock block{"my_block"};
+      }
+    }).join();
+  }
+  disableTracing();
+
+  auto snapshot = snapshotTracepoints();
+  EXPECT_EQ(detail::Tracer::kExitedThreadPoints, snapshot.size());
+  auto points = getAllTracepoints();
+  ensureValidTracePoints(points, detail::Tracer::kExitedThreadPoints);
+  EXPECT_EQ(0, snapshotTracepoints().size());
+}
+
+TEST(Tracing, perf_counters_are_totaled_per_block_name) {
+  PerfCounterValues values;
+  if (!detail::globalPerfCounters.getThreadCounters().read(values)) {
+    GTEST_SKIP() << "hardware performance counters are unavailable";
+  }
+
+  disableTracing();
+  setPerfCountersEnabled(true);
+  for (int i = 0; i < 3; ++i) {
+    TraceBlock block{"perf_block"};
+  }
+  // Blocks that finish on another thread are not measured.
+  TraceBlock block{"perf_block"};
+  folly::ThreadedExecutor executor;
+  folly::makeFuture(42)
+      .via(&executor)
+      .thenValue([b = std::move(block)](auto /* unused */) {})
+      .wait();
+  setPerfCountersEnabled(false);
+  { TraceBlock disabled{"perf_block"}; }
+
+  auto totals = getPerfCounterTotals();
+  ASSERT_EQ(1, totals.count("perf_block"));
+  const auto& perfBlock = totals["perf_block"];
+  EXPECT_EQ(3, perfBlock.count);
+  EXPECT_GT(perfBlock.values.instructions, 0);
+  EXPECT_GT(perfBlock.values.cycles, 0);
+}
@@ -54,6 +54,9 @@ SemiFuture<unique_ptr<Tree>> FakeBackingStore::getTree(
     throw std::domain_error("tree " + id.toString() + " not found");
   }
 
+  if (data->latency.count() > 0) {
+    return it->second->getFuture().delayed(data->latency);
+  }
   return it->second->getFuture();
 }
 
@@ -68,6 +71,9 @@ SemiFuture<unique_ptr<Blob>> FakeBackingStore::getBlob(
     throw std::domain_error("blob " + id.toString() + " not found");
   }
 
+  if (data->latency.count() > 0) {
+    return it->second->getFuture().delayed(data->latency);
+  }
   return it->second->getFuture();
 }
 
@@ -374,5 +380,43 @@ void FakeBackingStore::discardOutstandingRequests() {
 size_t FakeBackingStore::getAccessCount(const Hash& hash) const {
   return folly::get_default(data_.rlock()->accessCounts, hash, 0);
 }
+
+SemiFuture<folly::Unit> FakeBackingStore::prefetchBlobs(
+    const std::vector<Hash>& ids,
+    ImportPriority /*priority*/) {
+  data_.wlock()->prefetchBatches.push_back(ids);
+  return folly::unit;
+}
+
+SemiFuture<std::vector<std::optional<BlobMetadata>>>
+FakeBackingStore::getBlobMetadataBatch(
+    const std::vector<Hash>& ids,
+    ImportPriority /*priority*/) {
+  auto data = data_.rlock();
+  std::vector<std::optional<BlobMetadata>> metadata;
+  for (const auto& id : ids) {
+    auto it = data->blobMetadata.find(id);
+    if (it != data->blobMetadata.end()) {
+      metadata.emplace_back(it->second);
+    } else {
+      metadata.emplace_back(std::nullopt);
+    }
+  }
+  return metadata;
+}
+
+void FakeBackingStore::putBlobMetadata(
+    const Hash& hash,
+    const BlobMetadata& metadata) {
+  data_.wlock()->blobMetadata.insert_or_assign(hash, metadata);
+}
+
+std::vector<std::vector<Hash>> FakeBackingStore::getPrefetchBatches() const {
+  return data_.rlock()->prefetchBatches;
+}
+
+void FakeBackingStore::setLatency(folly::Duration latency) {
+  data_.wlock()->latency = latency;
+}
 } // namespace eden
 } // namespace facebook
@@ -50,6 +50,20 @@ class FakeBackingStore : public BackingStore {
   folly::SemiFuture<std::unique_ptr<Tree>> getTreeForManifest(
       const Hash& commitID,
       const Hash& manifestID) override;
+  FOLLY_NODISCARD folly::SemiFuture<folly::Unit> prefetchBlobs(
+      const std::vector<Hash>& ids,
+      ImportPriority priority = ImportPriority::kNormal()) override;
+  FOLLY_NODISCARD folly::SemiFuture<std::vector<std::optional<BlobMetadata>>>
+  getBlobMetadataBatch(
+      const std::vector<Hash>& ids,
+      ImportPriority priority = ImportPriority::kNormal()) override;
+
+  /**
+   * Make getBlobMetadataBatch() return metadata for the given hash, whether
+   * or not the blob itself is present.
+   */
+  void putBlobMetadata(const Hash& hash, const BlobMetadata& metadata);
+
   /**
    * Add a Blob to the backing store
    *
@@ -141,12 +155,26 @@ class FakeBackingStore : public BackingStore {
    */
   size_t getAccessCount(const Hash& hash) const;
 
+  /**
+   * Returns the hashes passed to each prefetchBlobs() call, in order.
+   */
+  std::vector<std::vector<Hash>> getPrefetchBatches() const;
+
+  /**
+   * Delay every later getTree() and getBlob() result by latency after its
+   * object is ready, to model a remote backing store.
+   */
+  void setLatency(folly::Duration latency);
+
  private:
   struct Data {
     std::unordered_map<Hash, std::unique_ptr<StoredTree>> trees;
     std::unordered_map<Hash, std::unique_ptr<StoredBlob>> blobs;
     std::unordered_map<Hash, std::unique_ptr<StoredHash>> commits;
     std::unordered_map<Hash, size_t> accessCounts;
+    std::vector<std::vector<Hash>> prefetchBatches;
+    std::unordered_map<Hash, BlobMetadata> blobMetadata;
+    folly::Duration latency{0};
   };
 
   static std::vector<TreeEntry> buildTreeEntries(
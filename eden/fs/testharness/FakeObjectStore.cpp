@@ -89,7 +89,8 @@ folly::Future<std::shared_ptr<const Tree>> FakeObjectStore::getTreeForManifest(
 
 folly::Future<folly::Unit> FakeObjectStore::prefetchBlobs(
     const std::vector<Hash>&,
-    ObjectFetchContext&) const {
+    ObjectFetchContext&,
+    ImportPriority) const {
   return folly::unit;
 }
 
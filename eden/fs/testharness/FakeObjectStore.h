@@ -51,8 +51,8 @@ class FakeObjectStore : public IObjectStore {
           ObjectFetchContext::getNullContext()) const override;
   folly::Future<folly::Unit> prefetchBlobs(
       const std::vector<Hash>& ids,
-      ObjectFetchContext& context =
-          ObjectFetchContext::getNullContext()) const override;
+      ObjectFetchContext& context = ObjectFetchContext::getNullContext(),
+      ImportPriority priority = ImportPriority::kNormal()) const override;
 
   size_t getAccessCount(const Hash& hash) const;
 
@@ -104,11 +104,11 @@ TestMount::TestMount()
           /*userID=*/uid_t{},
           /*userHomePath=*/AbsolutePath{testDir_->path().string()},
           /*userConfigPath=*/
-          AbsolutePath{testDir_->path().string() + ".edenrc"},
+          AbsolutePath{testDir_->path().string() + "/.edenrc"},
           /*systemConfigDir=*/AbsolutePath{testDir_->path().string()},
           /*systemConfigPath=*/
           AbsolutePath{
-              testDir_->path().string() + "edenfs.rc",
+              testDir_->path().string() + "/edenfs.rc",
           }),
       /*enableFaultInjection=*/true)};
 }
@@ -396,6 +396,30 @@ size_t TestMount::drainServerExecutor() {
   return serverExecutor_->drain();
 }
 
+void TestMount::updateEdenConfig(
+    const std::map<std::string, std::string>& values) {
+  std::map<std::string, std::string> sections;
+  for (const auto& [key, value] : values) {
+    auto colon = key.find(':');
+    CHECK_NE(colon, std::string::npos) << "config key without section: " << key;
+    folly::StringPiece keyPiece{key};
+    sections[keyPiece.subpiece(0, colon).str()] += folly::to<std::string>(
+        keyPiece.subpiece(colon + 1), " = ", value, "\n");
+  }
+  std::string contents;
+  for (const auto& [section, settings] : sections) {
+    contents += folly::to<std::string>("[", section, "]\n", settings);
+  }
+
+  auto& reloadableConfig = serverState_->getReloadableConfig();
+  auto userConfigPath = reloadableConfig
+                            .getEdenConfig(ConfigReloadBehavior::NoReload)
+                            ->getUserConfigPath();
+  CHECK(writeFile(contents, userConfigPath.c_str()))
+      << "failed to write " << userConfigPath;
+  reloadableConfig.getEdenConfig(ConfigReloadBehavior::ForceReload);
+}
+
 void TestMount::setInitialCommit(Hash commitHash) {
   // Write the commit hash to the snapshot file
   auto snapshotPath = config_->getSnapshotPath();
@@ -11,6 +11,7 @@
 #include <folly/Range.h>
 #include <folly/experimental/TestUtil.h>
 #include <sys/stat.h>
+#include <map>
 #include <optional>
 #include <vector>
 #include "eden/fs/fuse/InodeNumber.h"
@@ -341,6 +342,13 @@ class TestMount {
     return serverExecutor_;
   }
 
+  /**
+   * Replace the user's EdenConfig file with the given settings and reload it.
+   *
+   * Keys are of the form "section:name", and values are TOML values.
+   */
+  void updateEdenConfig(const std::map<std::string, std::string>& values);
+
  private:
   void createMount();
   void initTestDirectory();
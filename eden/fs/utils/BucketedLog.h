@@ -17,8 +17,10 @@ namespace eden {
  * Maintains a circular buffer of `Size` `Bucket`s, each of which can accumulate
  * samples. When the clock advances, old buckets are cleared.
  *
- * Bucket must be a struct or class with an add() method, a merge() that takes
- * another Bucket as an argument, and a clear() method that empties the bucket.
+ * Bucket must be a struct or class with a merge() that takes another Bucket as
+ * an argument and a clear() method that empties the bucket.  Callers of add()
+ * also need an add() method on Bucket; others can update the bucket returned
+ * by getBucket() directly.
  * If this were Haskell, we'd put a Monoid constraint on Bucket. For performance
  * reasons, it's mutable with separate add() and merge().
  *
@@ -43,12 +45,26 @@ class BucketedLog {
    */
   template <typename... Args>
   void add(uint64_t now, Args&&... args) {
+    if (auto* bucket = getBucket(now)) {
+      bucket->add(std::forward<Args>(args)...);
+    }
+  }
+
+  /**
+   * Advances the internal clock to `now` as add() does, and returns the
+   * bucket for `now` so the caller can update it directly.  Returns nullptr
+   * if the internal clock has already advanced beyond `now`.
+   *
+   * The bucket stays valid until the clock advances past it or the log is
+   * cleared.
+   */
+  Bucket* getBucket(uint64_t now) {
     if (now < windowStart_) {
       // Ignore values from before this window.
-      return;
+      return nullptr;
     }
     advanceWindow(now);
-    buckets_[now % Size].add(std::forward<Args>(args)...);
+    return &buckets_[now % Size];
   }
 
   /**
@@ -57,15 +73,25 @@ class BucketedLog {
    * returned array is the most recent one.
    */
   std::array<Bucket, Size> getAll(uint64_t now) {
+    std::array<Bucket, Size> result;
+    size_t i = 0;
+    forEach(now, [&](const Bucket& bucket) { result[i++] = bucket; });
+    return result;
+  }
+
+  /**
+   * Like getAll(), but calls fn on each bucket, oldest first, instead of
+   * copying them.
+   */
+  template <typename Fn>
+  void forEach(uint64_t now, Fn&& fn) {
     advanceWindow(now);
 
-    std::array<Bucket, Size> result;
     uint64_t b = now + 1;
     for (size_t i = 0; i < Size; ++i) {
-      result[i] = buckets_[b % Size];
+      fn(static_cast<const Bucket&>(buckets_[b % Size]));
       ++b;
     }
-    return result;
   }
 
   /**
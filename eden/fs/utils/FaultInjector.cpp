@@ -148,6 +148,23 @@ void FaultInjector::injectFault(
   auto state = state_.wlock();
   state->faults[keyClass].emplace_back(
       keyValueRegex, std::move(behavior), count);
+  addArmedFault(*state, keyClass);
+}
+
+void FaultInjector::addArmedFault(State& state, StringPiece keyClass) {
+  auto bucket = getArmedBucket(keyClass);
+  if (state.faultsPerBucket[bucket]++ == 0) {
+    armedBuckets_.fetch_or(uint64_t{1} << bucket, std::memory_order_relaxed);
+  }
+}
+
+void FaultInjector::removeArmedFault(State& state, StringPiece keyClass) {
+  auto bucket = getArmedBucket(keyClass);
+  DCHECK_GT(state.faultsPerBucket[bucket], 0u);
+  if (--state.faultsPerBucket[bucket] == 0) {
+    armedBuckets_.fetch_and(
+        ~(uint64_t{1} << bucket), std::memory_order_relaxed);
+  }
 }
 
 bool FaultInjector::removeFault(
@@ -172,6 +189,7 @@ bool FaultInjector::removeFault(
       if (faultVector.empty()) {
         state->faults.erase(classIter);
       }
+      removeArmedFault(*state, keyClass);
       return true;
     }
   }
@@ -248,6 +266,7 @@ FaultInjector::FaultBehavior FaultInjector::findFault(
         XLOG(DBG1) << "fault expired: " << keyClass << ", "
                    << iter->keyValueRegex.str();
         faultVector.erase(iter);
+        removeArmedFault(*state, keyClass);
       }
     }
     return behavior;
@@ -11,6 +11,8 @@
 #include <boost/variant.hpp>
 #include <folly/experimental/StringKeyedUnorderedMap.h>
 #include <folly/futures/Future.h>
+#include <array>
+#include <atomic>
 #include <optional>
 
 namespace facebook {
@@ -47,7 +49,7 @@ class FaultInjector {
   FOLLY_NODISCARD folly::SemiFuture<folly::Unit> checkAsync(
       folly::StringPiece keyClass,
       folly::StringPiece keyValue) {
-    if (UNLIKELY(enabled_)) {
+    if (UNLIKELY(isArmed(keyClass))) {
       return checkAsyncImpl(keyClass, keyValue);
     }
     return folly::makeSemiFuture();
@@ -63,7 +65,7 @@ class FaultInjector {
    * code.
    */
   void check(folly::StringPiece keyClass, folly::StringPiece keyValue) {
-    if (UNLIKELY(enabled_)) {
+    if (UNLIKELY(isArmed(keyClass))) {
       return checkImpl(keyClass, keyValue);
     }
   }
@@ -191,13 +193,38 @@ class FaultInjector {
     folly::Promise<folly::Unit> promise;
   };
 
+  /**
+   * Key classes are grouped into buckets by their length, which is known
+   * without reading the string, so that checks for key classes with no faults
+   * need neither a string hash nor the state lock.
+   */
+  static constexpr size_t kNumArmedBuckets = 64;
+
   struct State {
     // A map from key class -> Faults
     folly::StringKeyedUnorderedMap<std::vector<Fault>> faults;
+    // The number of faults defined in each bucket of key classes
+    std::array<size_t, kNumArmedBuckets> faultsPerBucket{};
     // A map from key class -> BlockedChecks
     folly::StringKeyedUnorderedMap<std::vector<BlockedCheck>> blockedChecks;
   };
 
+  static size_t getArmedBucket(folly::StringPiece keyClass) {
+    return keyClass.size() % kNumArmedBuckets;
+  }
+
+  /**
+   * Returns false if no fault can match checks for this key class.  This may
+   * return true for key classes sharing a bucket with one that has faults.
+   */
+  bool isArmed(folly::StringPiece keyClass) const {
+    return armedBuckets_.load(std::memory_order_relaxed) &
+        (uint64_t{1} << getArmedBucket(keyClass));
+  }
+
+  void addArmedFault(State& state, folly::StringPiece keyClass);
+  void removeArmedFault(State& state, folly::StringPiece keyClass);
+
   FOLLY_NODISCARD folly::SemiFuture<folly::Unit> checkAsyncImpl(
       folly::StringPiece keyClass,
       folly::StringPiece keyValue);
@@ -226,6 +253,13 @@ class FaultInjector {
    * enabled in the first place, and fall through
    */
   bool const enabled_{false};
+
+  /**
+   * One bit per bucket of key classes, set while any fault is defined for a
+   * key class in that bucket.  Only modified with the state_ lock held.
+   * This is always 0 if fault injection is disabled.
+   */
+  std::atomic<uint64_t> armedBuckets_{0};
   folly::Synchronized<State> state_;
 };
 
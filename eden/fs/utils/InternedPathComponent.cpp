@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/InternedPathComponent.h"
+
+#include <folly/Indestructible.h>
+#include <folly/Portability.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include <folly/lang/Align.h>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <ostream>
+
+namespace facebook {
+namespace eden {
+
+static_assert(
+    folly::kIsLittleEndian,
+    "inline names rely on the tag bit being in the first byte");
+static_assert(
+    sizeof(InternedPathComponent) == sizeof(uint64_t),
+    "InternedPathComponent should be a single word");
+
+namespace detail {
+struct InternedPathComponentEntry {
+  explicit InternedPathComponentEntry(folly::StringPiece n) : name{n.str()} {}
+
+  std::atomic<size_t> refCount{1};
+  const std::string name;
+};
+} // namespace detail
+
+namespace {
+using Entry = detail::InternedPathComponentEntry;
+
+constexpr size_t kShardCount = 64;
+constexpr uint64_t kEmptyInline = 1;
+
+struct alignas(folly::hardware_destructive_interference_size) Shard {
+  folly::Synchronized<folly::F14FastMap<folly::StringPiece, Entry*>> entries;
+};
+
+std::array<Shard, kShardCount>& getShards() {
+  static folly::Indestructible<std::array<Shard, kShardCount>> shards;
+  return *shards;
+}
+
+Shard& getShard(folly::StringPiece name) {
+  return getShards()[folly::hasher<folly::StringPiece>{}(name) % kShardCount];
+}
+
+uint64_t toBits(Entry* entry) {
+  return reinterpret_cast<uintptr_t>(entry);
+}
+} // namespace
+
+InternedPathComponent::InternedPathComponent(PathComponentPiece name) {
+  auto str = name.stringPiece();
+  if (str.size() <= kMaxInlineSize) {
+    unsigned char bytes[sizeof(bits_)] = {};
+    bytes[0] = static_cast<unsigned char>((str.size() << 1) | 1);
+    memcpy(bytes + 1, str.data(), str.size());
+    memcpy(&bits_, bytes, sizeof(bits_));
+    return;
+  }
+
+  auto& shard = getShard(str);
+  {
+    // The last reference is only dropped with the shard write-locked, so an
+    // entry found under the read lock cannot be freed from under us.
+    auto entries = shard.entries.rlock();
+    auto it = entries->find(str);
+    if (it != entries->end()) {
+      it->second->refCount.fetch_add(1, std::memory_order_relaxed);
+      bits_ = toBits(it->second);
+      return;
+    }
+  }
+
+  auto entries = shard.entries.wlock();
+  auto it = entries->find(str);
+  if (it != entries->end()) {
+    it->second->refCount.fetch_add(1, std::memory_order_relaxed);
+    bits_ = toBits(it->second);
+    return;
+  }
+  auto* entry = new Entry{str};
+  entries->emplace(folly::StringPiece{entry->name}, entry);
+  bits_ = toBits(entry);
+}
+
+InternedPathComponent::InternedPathComponent(
+    const InternedPathComponent& other) noexcept
+    : bits_{other.bits_} {
+  acquire();
+}
+
+InternedPathComponent::InternedPathComponent(
+    InternedPathComponent&& other) noexcept
+    : bits_{other.bits_} {
+  other.bits_ = kEmptyInline;
+}
+
+InternedPathComponent& InternedPathComponent::operator=(
+    const InternedPathComponent& other) noexcept {
+  if (bits_ != other.bits_) {
+    release();
+    bits_ = other.bits_;
+    acquire();
+  }
+  return *this;
+}
+
+InternedPathComponent& InternedPathComponent::operator=(
+    InternedPathComponent&& other) noexcept {
+  if (this != &other) {
+    release();
+    bits_ = other.bits_;
+    other.bits_ = kEmptyInline;
+  }
+  return *this;
+}
+
+InternedPathComponent::~InternedPathComponent() {
+  release();
+}
+
+PathComponentPiece InternedPathComponent::piece() const {
+  if (isInline()) {
+    auto size = static_cast<size_t>((bits_ & 0xff) >> 1);
+    return PathComponentPiece{
+        folly::StringPiece{reinterpret_cast<const char*>(&bits_) + 1, size},
+        detail::SkipPathSanityCheck{}};
+  }
+  return PathComponentPiece{entry()->name, detail::SkipPathSanityCheck{}};
+}
+
+size_t InternedPathComponent::getTableSize() {
+  size_t size = 0;
+  for (auto& shard : getShards()) {
+    size += shard.entries.rlock()->size();
+  }
+  return size;
+}
+
+void InternedPathComponent::acquire() noexcept {
+  if (!isInline()) {
+    entry()->refCount.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void InternedPathComponent::release() noexcept {
+  if (isInline()) {
+    return;
+  }
+  auto* e = entry();
+  auto count = e->refCount.load(std::memory_order_acquire);
+  while (count > 1) {
+    if (e->refCount.compare_exchange_weak(
+            count, count - 1, std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+
+  // This may be the last reference, so drop it with the shard locked to keep
+  // a concurrent lookup from handing the entry out again.
+  {
+    auto entries = getShard(e->name).entries.wlock();
+    if (e->refCount.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
+    }
+    entries->erase(folly::StringPiece{e->name});
+  }
+  delete e;
+}
+
+std::ostream& operator<<(std::ostream& os, const InternedPathComponent& name) {
+  return os << name.stringPiece();
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+namespace detail {
+struct InternedPathComponentEntry;
+}
+
+/**
+ * An immutable, 8-byte handle to a PathComponent whose bytes are shared by
+ * every handle to the same name.
+ *
+ * Names of up to kMaxInlineSize bytes (src, BUCK, test, ...) are stored in
+ * the handle itself.  Longer names live in a process-wide, refcounted table
+ * and are freed when their last handle is destroyed.  Either way, two handles
+ * compare equal exactly when their representations do, so comparing names is
+ * a single integer comparison.
+ *
+ * InternedPathComponent is thread-safe.
+ */
+class InternedPathComponent {
+ public:
+  static constexpr size_t kMaxInlineSize = 7;
+
+  explicit InternedPathComponent(PathComponentPiece name);
+
+  InternedPathComponent(const InternedPathComponent& other) noexcept;
+  InternedPathComponent(InternedPathComponent&& other) noexcept;
+  InternedPathComponent& operator=(const InternedPathComponent& other) noexcept;
+  InternedPathComponent& operator=(InternedPathComponent&& other) noexcept;
+  ~InternedPathComponent();
+
+  PathComponentPiece piece() const;
+
+  folly::StringPiece stringPiece() const {
+    return piece().stringPiece();
+  }
+
+  /* implicit */ operator PathComponentPiece() const {
+    return piece();
+  }
+
+  bool operator==(const InternedPathComponent& other) const {
+    return bits_ == other.bits_;
+  }
+  bool operator!=(const InternedPathComponent& other) const {
+    return bits_ != other.bits_;
+  }
+
+  /** The number of names currently held in the shared table. */
+  static size_t getTableSize();
+
+ private:
+  using Entry = detail::InternedPathComponentEntry;
+
+  bool isInline() const {
+    return bits_ & 1;
+  }
+  Entry* entry() const {
+    return reinterpret_cast<Entry*>(static_cast<uintptr_t>(bits_));
+  }
+  void acquire() noexcept;
+  void release() noexcept;
+
+  /**
+   * Either an Entry pointer, or, if the low bit is set, an inline name: the
+   * first byte holds the size and the tag bit and the rest hold the name,
+   * padded with zeroes so that equal names have equal bits.
+   */
+  uint64_t bits_;
+};
+
+std::ostream& operator<<(std::ostream& os, const InternedPathComponent& name);
+
+} // namespace eden
+} // namespace facebook
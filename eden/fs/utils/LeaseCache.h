@@ -9,10 +9,27 @@
 #include <folly/container/EvictingCacheMap.h>
 #include <folly/futures/Future.h>
 #include <folly/futures/SharedPromise.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 namespace facebook {
 namespace eden {
 
+/**
+ * A cache of values that are fetched asynchronously.
+ *
+ * Concurrent get() calls for a missing key share a single fetch.  A fetch
+ * that fails is not cached, so the next get() retries it.
+ *
+ * The keys are split across numShards independently locked LRU maps, each
+ * holding up to maxSize / numShards entries, so that threads looking up
+ * different keys rarely contend.  With a single shard the cache is a plain
+ * LRU of maxSize entries.
+ *
+ * The LeaseCache must outlive all of the fetches it has started.
+ */
 template <typename KEY, typename VAL, typename HASH = std::hash<KEY>>
 class LeaseCache {
  public:
@@ -21,58 +38,130 @@ class LeaseCache {
   using SharedPromiseType = std::shared_ptr<folly::SharedPromise<ValuePtr>>;
   using FetchFunc = std::function<FutureType(const KEY& key)>;
 
- private:
-  std::mutex lock_;
-  folly::EvictingCacheMap<KEY, SharedPromiseType, HASH> cache_;
-  FetchFunc fetcher_;
-
- public:
-  LeaseCache(size_t maxSize, FetchFunc fetcher, size_t clearSize = 1)
-      : cache_(maxSize, clearSize), fetcher_(fetcher) {}
+  struct Stats {
+    uint64_t hitCount{0};
+    uint64_t missCount{0};
+    uint64_t evictionCount{0};
+  };
+
+  LeaseCache(
+      size_t maxSize,
+      FetchFunc fetcher,
+      size_t clearSize = 1,
+      size_t numShards = 1)
+      : numShards_{std::max(numShards, size_t{1})},
+        shards_{new Shard[numShards_]},
+        fetcher_(std::move(fetcher)) {
+    for (size_t i = 0; i < numShards_; ++i) {
+      shards_[i].cache = std::make_unique<Map>(
+          shardSize(maxSize), std::min(clearSize, shardSize(maxSize)));
+      shards_[i].cache->setPruneHook([this](KEY, SharedPromiseType&&) {
+        evictionCount_.fetch_add(1, std::memory_order_relaxed);
+      });
+    }
+  }
 
   void set(const KEY& key, ValuePtr val) {
-    std::lock_guard<std::mutex> g(lock_);
     auto entry = std::make_shared<typename SharedPromiseType::element_type>();
     entry->setValue(val);
-    cache_.set(key, entry);
+    auto& shard = getShard(key);
+    std::lock_guard<std::mutex> g(shard.lock);
+    shard.cache->set(key, entry);
   }
 
   void erase(const KEY& key) {
-    std::lock_guard<std::mutex> g(lock_);
-    cache_.erase(key);
+    auto& shard = getShard(key);
+    std::lock_guard<std::mutex> g(shard.lock);
+    shard.cache->erase(key);
   }
 
   void setMaxSize(size_t size) {
-    cache_.setMaxSize(size);
+    for (size_t i = 0; i < numShards_; ++i) {
+      std::lock_guard<std::mutex> g(shards_[i].lock);
+      shards_[i].cache->setMaxSize(shardSize(size));
+    }
   }
 
   FutureType get(const KEY& key) {
     SharedPromiseType entry;
+    auto& shard = getShard(key);
 
     {
-      std::lock_guard<std::mutex> g(lock_);
+      std::lock_guard<std::mutex> g(shard.lock);
 
-      auto it = cache_.find(key);
-      if (it != cache_.end()) {
+      auto it = shard.cache->find(key);
+      if (it != shard.cache->end()) {
+        hitCount_.fetch_add(1, std::memory_order_relaxed);
         entry = it->second;
         return entry->getFuture();
       }
 
+      missCount_.fetch_add(1, std::memory_order_relaxed);
       entry = std::make_shared<typename SharedPromiseType::element_type>();
-      cache_.set(key, entry);
+      shard.cache->set(key, entry);
     }
 
     auto future = entry->getFuture();
 
     fetcher_(key).thenTry(
-        [entry](folly::Try<ValuePtr>&& t) { entry->setTry(std::move(t)); });
+        [this, key, entry](folly::Try<ValuePtr>&& t) {
+          if (t.hasException()) {
+            forget(key, entry);
+          }
+          entry->setTry(std::move(t));
+        });
 
     return future;
   }
 
   bool exists(const KEY& key) {
-    return cache_.exists(key);
+    auto& shard = getShard(key);
+    std::lock_guard<std::mutex> g(shard.lock);
+    return shard.cache->exists(key);
+  }
+
+  Stats getStats() const {
+    Stats stats;
+    stats.hitCount = hitCount_.load(std::memory_order_relaxed);
+    stats.missCount = missCount_.load(std::memory_order_relaxed);
+    stats.evictionCount = evictionCount_.load(std::memory_order_relaxed);
+    return stats;
   }
+
+ private:
+  using Map = folly::EvictingCacheMap<KEY, SharedPromiseType, HASH>;
+
+  struct Shard {
+    std::mutex lock;
+    std::unique_ptr<Map> cache;
+  };
+
+  size_t shardSize(size_t maxSize) const {
+    return std::max((maxSize + numShards_ - 1) / numShards_, size_t{1});
+  }
+
+  Shard& getShard(const KEY& key) {
+    return shards_[HASH{}(key) % numShards_];
+  }
+
+  /**
+   * Drop key's entry, unless it has been replaced since entry was inserted.
+   */
+  void forget(const KEY& key, const SharedPromiseType& entry) {
+    auto& shard = getShard(key);
+    std::lock_guard<std::mutex> g(shard.lock);
+    auto it = shard.cache->findWithoutPromotion(key);
+    if (it != shard.cache->end() && it->second == entry) {
+      shard.cache->erase(key);
+    }
+  }
+
+  const size_t numShards_;
+  std::unique_ptr<Shard[]> shards_;
+  FetchFunc fetcher_;
+  std::atomic<uint64_t> hitCount_{0};
+  std::atomic<uint64_t> missCount_{0};
+  std::atomic<uint64_t> evictionCount_{0};
 };
 
 } // namespace eden
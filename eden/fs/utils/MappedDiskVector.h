@@ -9,6 +9,7 @@
 
 #include <sys/mman.h>
 #include <unistd.h>
+#include <algorithm>
 #include <type_traits>
 
 #include <eden/fs/utils/Bug.h>
@@ -16,6 +17,7 @@
 #include <folly/File.h>
 #include <folly/FileUtil.h>
 #include <folly/Range.h>
+#include <folly/String.h>
 #include <folly/logging/xlog.h>
 
 namespace facebook {
@@ -299,8 +301,13 @@ class MappedDiskVector {
           "Growth must expand the file more than a single record");
 
       size_t oldSize = size();
-      size_t newFileSize =
-          mapSizeInBytes_ + GROWTH_IN_PAGES * detail::kPageSize;
+      // Grow geometrically once the file is large, so that filling a table
+      // with millions of records only remaps it a few dozen times.  The
+      // file is extended with ftruncate, so the unused tail costs no disk.
+      size_t growth = std::max(
+          GROWTH_IN_PAGES * detail::kPageSize,
+          detail::roundUpToNonzeroPageSize(mapSizeInBytes_ / 4));
+      size_t newFileSize = mapSizeInBytes_ + growth;
 
       // Always keep the file size a whole number of pages.
       CHECK_EQ(0, newFileSize % detail::kPageSize);
@@ -330,6 +337,7 @@ class MappedDiskVector {
 
 #ifdef __APPLE__
       munmap(map_, mapSizeInBytes_);
+      adviseHugePages(newMap, newFileSize);
 #endif
       map_ = newMap;
       mapSizeInBytes_ = newFileSize;
@@ -345,6 +353,17 @@ class MappedDiskVector {
     ++header().entryCount;
   }
 
+  /**
+   * Ask the kernel to write the mapped records back to the file.  With
+   * wait=false this only schedules the writeback; with wait=true it returns
+   * once the data has reached the disk.
+   */
+  void sync(bool wait) {
+    folly::checkUnixError(
+        msync(map_, mapSizeInBytes_, wait ? MS_SYNC : MS_ASYNC),
+        "msync failed");
+  }
+
   void pop_back() {
     // TODO: It might be worth eliminating the end_ pointer and always adding
     // header().entryCount to begin_.
@@ -437,9 +456,9 @@ class MappedDiskVector {
       }
     }
 
-    // Call readahead() here?  Offer it as optional functionality?
-    // InodeTable needs to traverse every record immediately after opening.
-
+    // InodeTable needs to traverse every record immediately after opening,
+    // so it asks for the whole file to be read in up front rather than
+    // taking a page fault on the first touch of each page.
     auto map = mmap(
         0,
         desiredSize,
@@ -456,8 +475,12 @@ class MappedDiskVector {
     }
 
 #ifndef MAP_POPULATE
-    (void)populate;
+    if (populate && madvise(map, desiredSize, MADV_WILLNEED) != 0) {
+      XLOG(DBG3) << "madvise(MADV_WILLNEED) failed: "
+                 << folly::errnoStr(errno);
+    }
 #endif
+    adviseHugePages(map, desiredSize);
 
     // Throw no exceptions between assigning the fields.
 
@@ -475,6 +498,24 @@ class MappedDiskVector {
         static_cast<char*>(map_) + mapSizeInBytes_);
   }
 
+  /**
+   * Ask for the mapping to be backed by transparent huge pages, which cuts
+   * the number of page faults and TLB entries needed to cover a large table.
+   * Only filesystems whose page cache supports huge pages (e.g. tmpfs mounted
+   * with huge=advise) honor this; elsewhere it has no effect.  mremap()
+   * carries the advice over when the mapping grows.
+   */
+  static void adviseHugePages(void* map, size_t size) {
+#ifdef MADV_HUGEPAGE
+    if (madvise(map, size, MADV_HUGEPAGE) != 0) {
+      XLOG(DBG3) << "madvise(MADV_HUGEPAGE) failed: " << folly::errnoStr(errno);
+    }
+#else
+    (void)map;
+    (void)size;
+#endif
+  }
+
   bool hasRoom(size_t amount) const {
     // Technically, the expression (end_ + amount) is constructing a pointer
     // past the end of the "object" (mmap) and is thus UB.  But hopefully no
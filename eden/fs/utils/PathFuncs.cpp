@@ -12,6 +12,7 @@
 #include <glog/logging.h>
 
 #include <folly/Exception.h>
+#include <folly/Likely.h>
 #include <folly/portability/Stdlib.h>
 #include <optional>
 #ifdef _WIN32
@@ -43,6 +44,35 @@ StringPiece basename(StringPiece path) {
   return path;
 }
 
+namespace detail {
+void validatePathComponent(StringPiece val) {
+  auto hasSeparator = findDirSeparator(val.begin(), val.end()) != val.end();
+#ifdef _WIN32
+  // On Windows we should also check if we have missed a Windows path
+  // separator. We have function to convert from Windows widechar paths
+  // to path component.
+  hasSeparator = hasSeparator || memchr(val.data(), '\\', val.size());
+#endif
+  if (UNLIKELY(hasSeparator)) {
+    throw std::domain_error(folly::to<std::string>(
+        "attempt to construct a PathComponent from a string containing a "
+        "directory separator: ",
+        val));
+  }
+
+  if (UNLIKELY(val.empty())) {
+    throw std::domain_error("cannot have an empty PathComponent");
+  }
+
+  const char* data = val.data();
+  if (UNLIKELY(
+          data[0] == '.' &&
+          (val.size() == 1 || (val.size() == 2 && data[1] == '.')))) {
+    throw std::domain_error("PathComponent must not be . or ..");
+  }
+}
+} // namespace detail
+
 AbsolutePath getcwd() {
   char cwd[PATH_MAX];
   if (!::getcwd(cwd, sizeof(cwd))) {
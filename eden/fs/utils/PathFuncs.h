@@ -19,9 +19,16 @@
 #include <folly/Format.h>
 #include <folly/String.h>
 #include <folly/hash/Hash.h>
+#include <cstring>
 #include <optional>
 #include <type_traits>
 
+#ifdef __has_builtin
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define EDEN_HAVE_IS_CONSTANT_EVALUATED 1
+#endif
+#endif
+
 namespace facebook {
 namespace eden {
 
@@ -92,6 +99,40 @@ namespace detail {
 /// A type to select the constructors that skip sanity checks
 struct SkipPathSanityCheck {};
 
+/**
+ * Returns the first directory separator in [begin, end), or end if there is
+ * none.  This uses memchr, which the C library vectorizes, since it runs for
+ * every component of every path we validate or iterate over.
+ */
+inline const char* findDirSeparator(const char* begin, const char* end) {
+  auto sep =
+      static_cast<const char*>(memchr(begin, kDirSeparator, end - begin));
+  return sep ? sep : end;
+}
+
+/**
+ * Returns the last directory separator in [begin, end), or nullptr if there
+ * is none.
+ */
+inline const char* rfindDirSeparator(const char* begin, const char* end) {
+#ifdef __GLIBC__
+  return static_cast<const char*>(memrchr(begin, kDirSeparator, end - begin));
+#else
+  for (auto pos = end; pos != begin; --pos) {
+    if (*(pos - 1) == kDirSeparator) {
+      return pos - 1;
+    }
+  }
+  return nullptr;
+#endif
+}
+
+/**
+ * The run-time version of PathComponentSanityCheck, which scans for
+ * separators with memchr rather than a byte at a time.
+ */
+void validatePathComponent(folly::StringPiece val);
+
 template <typename STR>
 class PathComponentBase;
 
@@ -303,9 +344,7 @@ class PathBase :
       typename = typename std::enable_if<
           std::is_same<StorageAlias, std::string>::value>::type>
   explicit PathBase(std::string&& str, SkipPathSanityCheck)
-      : path_(std::move(str)) {
-    SanityChecker()(path_);
-  }
+      : path_(std::move(str)) {}
 
   /// Return the path as a StringPiece
   folly::StringPiece stringPiece() const {
@@ -348,6 +387,12 @@ class PathBase :
 /// Asserts that val is a well formed path component
 struct PathComponentSanityCheck {
   constexpr void operator()(folly::StringPiece val) const {
+#ifdef EDEN_HAVE_IS_CONSTANT_EVALUATED
+    if (!__builtin_is_constant_evaluated()) {
+      validatePathComponent(val);
+      return;
+    }
+#endif
     for (auto c : val) {
       if (c == kDirSeparator
 #ifdef _WIN32
@@ -543,10 +588,7 @@ class ComposedPathIterator
       }
     }
 
-    ++pos_;
-    while (pos_ < path_.end() && *pos_ != kDirSeparator) {
-      ++pos_;
-    }
+    pos_ = findDirSeparator(pos_ + 1, path_.end());
   }
 
   // Move the iterator backwards in the path.
@@ -567,8 +609,9 @@ class ComposedPathIterator
     }
 
     --pos_;
-    while (pos_ > stopPos && *pos_ != kDirSeparator) {
-      --pos_;
+    if (pos_ > stopPos) {
+      auto sep = rfindDirSeparator(stopPos + 1, pos_ + 1);
+      pos_ = sep ? sep : stopPos;
     }
   }
 
@@ -602,9 +645,8 @@ class PathComponentIterator
       start_ = path_.end();
       end_ = path_.end();
       // Back start_ up to just after the last kDirSeparator
-      while (start_ != path_.begin() && *(start_ - 1) != kDirSeparator) {
-        --start_;
-      }
+      auto sep = rfindDirSeparator(path_.begin(), start_);
+      start_ = sep ? sep + 1 : path_.begin();
     } else {
       // Skip over any leading slash, to handle absolute paths
       start_ = path_.begin();
@@ -612,10 +654,7 @@ class PathComponentIterator
         ++start_;
       }
       // Advance end_ until the next slash or the end of the path
-      end_ = start_;
-      while (end_ != path_.end() && *end_ != kDirSeparator) {
-        ++end_;
-      }
+      end_ = findDirSeparator(start_, path_.end());
     }
   }
 
@@ -713,9 +752,7 @@ class PathComponentIterator
     }
     ++end_;
     start_ = end_;
-    while (end_ != path_.end() && *end_ != kDirSeparator) {
-      ++end_;
-    }
+    end_ = findDirSeparator(start_, path_.end());
   }
 
   // Move the iterator backwards in the path.
@@ -728,9 +765,8 @@ class PathComponentIterator
 
     --start_;
     end_ = start_;
-    while (start_ != path_.begin() && *(start_ - 1) != kDirSeparator) {
-      --start_;
-    }
+    auto sep = rfindDirSeparator(path_.begin(), start_);
+    start_ = sep ? sep + 1 : path_.begin();
   }
 
   /// the path we're iterating over.
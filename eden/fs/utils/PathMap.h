@@ -7,10 +7,15 @@
 
 #pragma once
 #include <folly/FBVector.h>
+#include <folly/container/F14Map.h>
 #include <algorithm>
 #include <functional>
 #include <iterator>
+#include <set>
 #include <utility>
+#ifdef _WIN32
+#include <folly/String.h>
+#endif
 #include "eden/fs/utils/PathFuncs.h"
 
 namespace facebook {
@@ -22,23 +27,27 @@ namespace eden {
  * This is similar to std::map but has a couple of different properties:
  * - lookups can be made using the Piece (non-stored) variant of the key
  *   type and won't require allocation just for the lookup.
- * - The storage is a vector maintained in sorted order using a binary
- *   search (std::lower_bound). Out-of-order inserts require moving
- *   the guts of the vector around to make space and are therefore slower
- *   than the equivalent std::map.  If bulk insert performance is critical,
- *   it is better to pre-sort the data to be inserted.
- * - Since insert and erase operations move the vector contents around,
- *   those operations invalidate iterators.
+ * - Small maps are stored in a vector maintained in sorted order using a
+ *   binary search (std::lower_bound). Out-of-order inserts require moving
+ *   the guts of the vector around to make space.
+ * - Once a map grows past kIndexThreshold entries it switches to an ordered
+ *   set of nodes plus a hash index keyed by name, so that inserts are
+ *   O(log n) and lookups are O(1) even for directories with hundreds of
+ *   thousands of entries.  On Windows a second, case-folded hash index
+ *   replaces the linear case-insensitive scan.  Iteration is always in
+ *   sorted key order.  A map stays indexed until it is cleared.
+ * - Since insert and erase operations may move the contents around (or
+ *   switch representations), those operations invalidate iterators.
  */
 template <typename Value, typename Key = PathComponent>
-class PathMap : private folly::fbvector<std::pair<Key, Value>> {
+class PathMap {
   using Pair = std::pair<Key, Value>;
-  using Vector = folly::fbvector<Pair>;
   using Piece = typename Key::piece_type;
-  using Allocator = typename Vector::allocator_type;
 
   // Comparator that knows how compare Stored and Piece in the vector.
   struct Compare {
+    using is_transparent = void;
+
     // Compare two values that are convertible to the Piece type.
     template <typename A, typename B>
     typename std::enable_if<
@@ -68,6 +77,118 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
     operator()(const std::pair<B, C>& lhs, const A& a) const {
       return Piece(lhs.first) < Piece(a);
     }
+
+    // Compare two stored Pairs; used by the ordered set.
+    bool operator()(const Pair& lhs, const Pair& rhs) const {
+      return Piece(lhs.first) < Piece(rhs.first);
+    }
+  };
+
+  using Vector = folly::fbvector<Pair>;
+  using Allocator = typename Vector::allocator_type;
+  // std::set nodes never move, so the indices below can hold iterators and
+  // Pieces that point into them.  Elements are only ever modified through
+  // their Value, which does not affect the ordering.
+  using Set = std::set<Pair, Compare>;
+  using SetIter = typename Set::const_iterator;
+  using Index = folly::F14FastMap<Piece, SetIter, std::hash<Piece>>;
+#ifdef _WIN32
+  struct FoldedEntry {
+    // The first entry, in sorted order, whose name folds to this key.
+    SetIter iter;
+    // How many entries fold to this key.
+    size_t count;
+  };
+  using FoldedIndex = folly::F14FastMap<std::string, FoldedEntry>;
+#endif
+
+  template <bool IsConst>
+  class Iterator {
+    using VectorIter = std::conditional_t<
+        IsConst,
+        typename Vector::const_iterator,
+        typename Vector::iterator>;
+
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = Pair;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const Pair*, Pair*>;
+    using reference = std::conditional_t<IsConst, const Pair&, Pair&>;
+
+    Iterator() = default;
+
+    // Allow iterator to convert to const_iterator.
+    template <bool C = IsConst, typename = std::enable_if_t<C>>
+    /* implicit */ Iterator(const Iterator<false>& other)
+        : vectorIter_{other.vectorIter_},
+          setIter_{other.setIter_},
+          indexed_{other.indexed_} {}
+
+    reference operator*() const {
+      if (indexed_) {
+        return const_cast<reference>(*setIter_);
+      }
+      return *vectorIter_;
+    }
+
+    pointer operator->() const {
+      return &**this;
+    }
+
+    Iterator& operator++() {
+      if (indexed_) {
+        ++setIter_;
+      } else {
+        ++vectorIter_;
+      }
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      auto result = *this;
+      ++*this;
+      return result;
+    }
+
+    Iterator& operator--() {
+      if (indexed_) {
+        --setIter_;
+      } else {
+        --vectorIter_;
+      }
+      return *this;
+    }
+
+    Iterator operator--(int) {
+      auto result = *this;
+      --*this;
+      return result;
+    }
+
+    friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+      if (lhs.indexed_ != rhs.indexed_) {
+        return false;
+      }
+      return lhs.indexed_ ? lhs.setIter_ == rhs.setIter_
+                          : lhs.vectorIter_ == rhs.vectorIter_;
+    }
+
+    friend bool operator!=(const Iterator& lhs, const Iterator& rhs) {
+      return !(lhs == rhs);
+    }
+
+   private:
+    friend class PathMap;
+    template <bool>
+    friend class Iterator;
+
+    explicit Iterator(VectorIter iter) : vectorIter_{iter} {}
+    explicit Iterator(SetIter iter) : setIter_{iter}, indexed_{true} {}
+
+    VectorIter vectorIter_{};
+    SetIter setIter_{};
+    bool indexed_{false};
   };
 
   // Hold an instance of the comparator.  It doesn't actually
@@ -75,22 +196,28 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
   Compare compare_;
 
  public:
+  /**
+   * Maps with more entries than this are converted to the indexed
+   * representation.
+   */
+  static constexpr size_t kIndexThreshold = 1024;
+
   // Various type aliases to satisfy container concepts.
   using key_type = Key;
   using mapped_type = Value;
-  using value_type = typename Vector::value_type;
+  using value_type = Pair;
   using key_compare = Compare;
   using allocator_type = Allocator;
-  using reference = typename Allocator::reference;
-  using const_reference = typename Allocator::const_reference;
-  using iterator = typename Vector::iterator;
-  using const_iterator = typename Vector::const_iterator;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
   using size_type = typename Vector::size_type;
   using difference_type = typename Vector::difference_type;
-  using pointer = typename Allocator::pointer;
-  using const_pointer = typename Allocator::const_pointer;
-  using reverse_iterator = typename Vector::reverse_iterator;
-  using const_reverse_iterator = typename Vector::const_reverse_iterator;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
   // Construct empty.
   PathMap() {}
@@ -106,101 +233,158 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
     // O(n) otherwise.  We're fine with the O(n) on the basis that if n is large
     // enough to matter, the cost of iterating will be dwarfed by the cost
     // of growing the storage several times during population.
-    this->reserve(std::distance(first, last));
+    auto count = std::distance(first, last);
+    if (static_cast<size_t>(count) <= kIndexThreshold) {
+      vector_.reserve(count);
+    }
     for (; first != last; ++first) {
       insert(*first);
     }
   }
 
-  // Inherit the underlying vector copy/assignment.
-  PathMap(const PathMap& other) : Vector(other) {}
+  PathMap(const PathMap& other)
+      : vector_(other.vector_), set_(other.set_), indexed_(other.indexed_) {
+    rebuildIndex();
+  }
   PathMap& operator=(const PathMap& other) {
     PathMap(other).swap(*this);
     return *this;
   }
 
-  // inherit Move construction.
-  PathMap(PathMap&& other) noexcept : Vector(std::move(other)) {}
+  PathMap(PathMap&& other) noexcept {
+    swap(other);
+  }
   PathMap& operator=(PathMap&& other) {
     other.swap(*this);
     return *this;
   }
 
-  // inherit these methods from the underlying vector.
-  using Vector::begin;
-  using Vector::cbegin;
-  using Vector::cend;
-  using Vector::clear;
-  using Vector::crbegin;
-  using Vector::crend;
-  using Vector::empty;
-  using Vector::end;
-  using Vector::erase;
-  using Vector::max_size;
-  using Vector::rbegin;
-  using Vector::rend;
-  using Vector::size;
+  iterator begin() {
+    return indexed_ ? iterator{set_.begin()} : iterator{vector_.begin()};
+  }
+  const_iterator begin() const {
+    return indexed_ ? const_iterator{set_.begin()}
+                    : const_iterator{vector_.cbegin()};
+  }
+  const_iterator cbegin() const {
+    return begin();
+  }
+
+  iterator end() {
+    return indexed_ ? iterator{set_.end()} : iterator{vector_.end()};
+  }
+  const_iterator end() const {
+    return indexed_ ? const_iterator{set_.end()}
+                    : const_iterator{vector_.cend()};
+  }
+  const_iterator cend() const {
+    return end();
+  }
+
+  reverse_iterator rbegin() {
+    return reverse_iterator{end()};
+  }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator{end()};
+  }
+  const_reverse_iterator crbegin() const {
+    return rbegin();
+  }
+
+  reverse_iterator rend() {
+    return reverse_iterator{begin()};
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator{begin()};
+  }
+  const_reverse_iterator crend() const {
+    return rend();
+  }
+
+  bool empty() const {
+    return indexed_ ? set_.empty() : vector_.empty();
+  }
+
+  size_type size() const {
+    return indexed_ ? set_.size() : vector_.size();
+  }
+
+  size_type max_size() const {
+    return vector_.max_size();
+  }
+
+  /**
+   * Make room for n entries so that populating the map does not repeatedly
+   * grow its storage and leave up to half of it unused.  This has no effect
+   * on maps that are indexed or would become indexed before reaching n.
+   */
+  void reserve(size_type n) {
+    if (!indexed_ && n <= kIndexThreshold) {
+      vector_.reserve(n);
+    }
+  }
+
+  /** Returns true if this map uses the hash-indexed representation. */
+  bool isIndexed() const {
+    return indexed_;
+  }
+
+  void clear() {
+    vector_.clear();
+    set_.clear();
+    index_.clear();
+#ifdef _WIN32
+    foldedIndex_.clear();
+#endif
+    indexed_ = false;
+  }
 
   // Swap contents with another map.
   void swap(PathMap& other) noexcept {
-    Vector::swap(other);
+    vector_.swap(other.vector_);
+    set_.swap(other.set_);
+    index_.swap(other.index_);
+#ifdef _WIN32
+    foldedIndex_.swap(other.foldedIndex_);
+#endif
+    std::swap(indexed_, other.indexed_);
   }
 
   // lower_bound performs the binary search for locating keys.
   iterator lower_bound(Piece key) {
-    return std::lower_bound(begin(), end(), key, compare_);
+    if (indexed_) {
+      return iterator{set_.lower_bound(key)};
+    }
+    return iterator{
+        std::lower_bound(vector_.begin(), vector_.end(), key, compare_)};
   }
 
   const_iterator lower_bound(Piece key) const {
-    return std::lower_bound(begin(), end(), key, compare_);
+    if (indexed_) {
+      return const_iterator{set_.lower_bound(key)};
+    }
+    return const_iterator{
+        std::lower_bound(vector_.cbegin(), vector_.cend(), key, compare_)};
   }
 
   /** Find using the Piece representation of a key.
    * Does not allocate a copy of the key string.
    */
   iterator find(Piece key) {
-    auto iter = lower_bound(key);
-    if (iter != end() && !compare_(key, iter->first)) {
-      // Found it
-      return iter;
+    if (indexed_) {
+      return iterator{findIndexed(key)};
     }
-#ifdef _WIN32
-    // On Windows we need to do a case insensitive lookup for the file and
-    // directory names. For performance, we will do a case sensitive search
-    // first which should cover most of the cases and if not found then do a
-    // case sensitive search.
-    for (iter = begin(); iter != end(); ++iter) {
-      if (key.stringPiece().equals(
-              iter->first.stringPiece(), folly::AsciiCaseInsensitive())) {
-        return iter;
-      }
-    }
-#endif
-    return end();
+    return iterator{findInVector(vector_.begin(), vector_.end(), key)};
   }
 
   /** Find using the Piece representation of a key.
    * Does not allocate a copy of the key string.
    */
   const_iterator find(Piece key) const {
-    auto iter = lower_bound(key);
-    if (iter != end() && !compare_(key, iter->first)) {
-      // Found it
-      return iter;
-    }
-#ifdef _WIN32
-    // On Windows we need to do a case insensitive lookup for the file and
-    // directory names. For performance, we will do a case sensitive search
-    // first which should cover most of the cases and if not found then do a
-    // case sensitive search.
-    for (iter = begin(); iter != end(); ++iter) {
-      if (key.stringPiece().equals(
-              iter->first.stringPiece(), folly::AsciiCaseInsensitive())) {
-        return iter;
-      }
+    if (indexed_) {
+      return const_iterator{findIndexed(key)};
     }
-#endif
-    return end();
+    return const_iterator{findInVector(vector_.cbegin(), vector_.cend(), key)};
   }
 
   /** Insert a new key-value pair.
@@ -208,11 +392,7 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
    * Returns a pair consisting of an iterator to the position for key and
    * a boolean that is true if an insert took place. */
   std::pair<iterator, bool> insert(const value_type& val) {
-    auto iter = lower_bound(val.first);
-    if (iter == end() || compare_(val.first, iter->first)) {
-      return std::make_pair(Vector::insert(iter, val), true);
-    }
-    return std::make_pair(iter, false);
+    return insertImpl(val.first, [&] { return val; });
   }
 
   /** Emplace a new key-value pair by constructing it in-place.
@@ -223,24 +403,18 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
    * a boolean that is true if an insert took place. */
   template <typename... Args>
   std::pair<iterator, bool> emplace(Piece key, Args&&... args) {
-    auto iter = lower_bound(key);
-    if (iter == end() || compare_(key, iter->first)) {
-      iter = Vector::emplace(
-          iter, std::make_pair(Key(key), Value(std::forward<Args>(args)...)));
-      return std::make_pair(iter, true);
-    }
-    return std::make_pair(iter, false);
+    return insertImpl(key, [&] {
+      return std::make_pair(Key(key), Value(std::forward<Args>(args)...));
+    });
   }
 
   /** Returns a reference to the map position for key, creating it needed.
    * If the key is already present, no additional allocations are performed. */
   mapped_type& operator[](Piece key) {
-    auto iter = lower_bound(key);
-    if (iter == end() || compare_(key, iter->first)) {
-      // Not yet present, make a new one
-      iter = Vector::insert(iter, std::make_pair(Key(key), mapped_type()));
-    }
-    return iter->second;
+    return insertImpl(key, [&] {
+             return std::make_pair(Key(key), mapped_type());
+           })
+        .first->second;
   }
 
   /** Returns a reference to the map position for key, if present.
@@ -270,6 +444,16 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
     return iter->second;
   }
 
+  /** Erase the entry at pos.
+   * Returns an iterator to the entry that followed it. */
+  iterator erase(const_iterator pos) {
+    if (indexed_) {
+      removeFromIndex(pos.setIter_);
+      return iterator{set_.erase(pos.setIter_)};
+    }
+    return iterator{vector_.erase(pos.vectorIter_)};
+  }
+
   /** Erase the value associated with key.
    * Does not allocate any additional memory to look up the key.
    * Returns the number of matching elements that were erased; this is
@@ -296,6 +480,157 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
   /// Inequality operator.
   template <typename V, typename K>
   friend bool operator!=(const PathMap<V, K>& lhs, const PathMap<V, K>& rhs);
+
+ private:
+  template <typename VectorIter>
+  VectorIter findInVector(VectorIter first, VectorIter last, Piece key) const {
+    auto iter = std::lower_bound(first, last, key, compare_);
+    if (iter != last && !compare_(key, iter->first)) {
+      // Found it
+      return iter;
+    }
+#ifdef _WIN32
+    // On Windows we need to do a case insensitive lookup for the file and
+    // directory names. For performance, we will do a case sensitive search
+    // first which should cover most of the cases and if not found then do a
+    // case sensitive search.
+    for (iter = first; iter != last; ++iter) {
+      if (key.stringPiece().equals(
+              iter->first.stringPiece(), folly::AsciiCaseInsensitive())) {
+        return iter;
+      }
+    }
+#endif
+    return last;
+  }
+
+  SetIter findIndexed(Piece key) const {
+    auto found = index_.find(key);
+    if (found != index_.end()) {
+      return found->second;
+    }
+#ifdef _WIN32
+    // Same fallback as findInVector(), but through the case-folded index.
+    auto folded = foldedIndex_.find(foldCase(key));
+    if (folded != foldedIndex_.end()) {
+      return folded->second.iter;
+    }
+#endif
+    return set_.end();
+  }
+
+  /**
+   * Insert the Pair returned by makePair() if key is not already present.
+   * makePair is only invoked when an insert takes place.
+   */
+  template <typename MakePair>
+  std::pair<iterator, bool> insertImpl(Piece key, MakePair&& makePair) {
+    if (!indexed_) {
+      auto iter =
+          std::lower_bound(vector_.begin(), vector_.end(), key, compare_);
+      if (iter != vector_.end() && !compare_(key, iter->first)) {
+        return std::make_pair(iterator{iter}, false);
+      }
+      if (vector_.size() < kIndexThreshold) {
+        return std::make_pair(
+            iterator{vector_.insert(iter, makePair())}, true);
+      }
+      // The arguments to makePair() may refer to an element of this map, as
+      // in emplace(newName, std::move(oldIter->second)), so build the pair
+      // before convertToIndexed() moves the elements and frees vector_.
+      auto pair = makePair();
+      convertToIndexed();
+      auto setIter = set_.insert(std::move(pair)).first;
+      addToIndex(setIter);
+      return std::make_pair(iterator{setIter}, true);
+    } else {
+      auto found = index_.find(key);
+      if (found != index_.end()) {
+        return std::make_pair(iterator{found->second}, false);
+      }
+    }
+
+    auto iter = set_.insert(makePair()).first;
+    addToIndex(iter);
+    return std::make_pair(iterator{iter}, true);
+  }
+
+  void convertToIndexed() {
+    // The vector is already sorted, so hinting at the end makes each insert
+    // amortized constant time.
+    for (auto& pair : vector_) {
+      set_.emplace_hint(set_.end(), std::move(pair));
+    }
+    Vector().swap(vector_);
+    indexed_ = true;
+    rebuildIndex();
+  }
+
+  void rebuildIndex() {
+    index_.clear();
+#ifdef _WIN32
+    foldedIndex_.clear();
+#endif
+    if (!indexed_) {
+      return;
+    }
+    index_.reserve(set_.size());
+    for (auto iter = set_.begin(); iter != set_.end(); ++iter) {
+      addToIndex(iter);
+    }
+  }
+
+  void addToIndex(SetIter iter) {
+    index_.emplace(Piece(iter->first), iter);
+#ifdef _WIN32
+    auto [folded, inserted] =
+        foldedIndex_.emplace(foldCase(iter->first), FoldedEntry{iter, 1});
+    if (!inserted) {
+      ++folded->second.count;
+      if (compare_(iter->first, folded->second.iter->first)) {
+        folded->second.iter = iter;
+      }
+    }
+#endif
+  }
+
+  void removeFromIndex(SetIter iter) {
+    index_.erase(Piece(iter->first));
+#ifdef _WIN32
+    auto folded = foldedIndex_.find(foldCase(iter->first));
+    if (--folded->second.count == 0) {
+      foldedIndex_.erase(folded);
+    } else if (folded->second.iter == iter) {
+      // Another entry differs from this one only by case; find the first one
+      // in sorted order.  This is only reached in directories that contain
+      // such entries.
+      for (auto other = set_.begin(); other != set_.end(); ++other) {
+        if (other != iter &&
+            iter->first.stringPiece().equals(
+                other->first.stringPiece(), folly::AsciiCaseInsensitive())) {
+          folded->second.iter = other;
+          break;
+        }
+      }
+    }
+#endif
+  }
+
+#ifdef _WIN32
+  static std::string foldCase(Piece key) {
+    auto folded = key.stringPiece().str();
+    folly::toLowerAscii(folded);
+    return folded;
+  }
+#endif
+
+  Vector vector_;
+  Set set_;
+  Index index_;
+#ifdef _WIN32
+  FoldedIndex foldedIndex_;
+#endif
+  bool indexed_{false};
 };
 
 // Implementations of the equality operators; gcc hates us if we
@@ -304,17 +639,14 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
 /// Equality operator.
 template <typename V, typename K>
 bool operator==(const PathMap<V, K>& lhs, const PathMap<V, K>& rhs) {
-  // reinterpret lhs as the underlying vector type.
-  const folly::fbvector<std::pair<K, V>>& vector = lhs;
-  return vector == rhs;
+  return lhs.size() == rhs.size() &&
+      std::equal(lhs.begin(), lhs.end(), rhs.begin());
 }
 
 /// Inequality operator.
 template <typename V, typename K>
 bool operator!=(const PathMap<V, K>& lhs, const PathMap<V, K>& rhs) {
-  // reinterpret lhs as the underlying vector type.
-  const folly::fbvector<std::pair<K, V>>& vector = lhs;
-  return vector != rhs;
+  return !(lhs == rhs);
 }
 } // namespace eden
 } // namespace facebook
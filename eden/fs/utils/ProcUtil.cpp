@@ -103,6 +103,63 @@ optional<MemoryStats> parseStatmFile(StringPiece data, size_t pageSize) {
 }
 #endif
 
+optional<double> readMemoryPressure(const char* filename) {
+  std::string contents;
+  if (!folly::readFile(filename, contents)) {
+    return std::nullopt;
+  }
+  return parseMemoryPressure(contents);
+}
+
+optional<double> parseMemoryPressure(StringPiece data) {
+  std::vector<StringPiece> lines;
+  folly::split('\n', data, lines);
+  for (auto line : lines) {
+    if (!line.removePrefix("some ")) {
+      continue;
+    }
+    std::vector<StringPiece> fields;
+    folly::split(' ', line, fields, /*ignoreEmpty=*/true);
+    for (auto field : fields) {
+      if (field.removePrefix("avg10=")) {
+        auto value = folly::tryTo<double>(field);
+        if (value.hasValue()) {
+          return value.value();
+        }
+        return std::nullopt;
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+std::string getMemoryPressurePath() {
+  std::string contents;
+  if (folly::readFile("/proc/self/cgroup", contents)) {
+    auto cgroup = parseCgroupV2Path(contents);
+    if (cgroup && *cgroup != "/") {
+      auto path = folly::to<std::string>(
+          "/sys/fs/cgroup", *cgroup, "/memory.pressure");
+      if (access(path.c_str(), R_OK) == 0) {
+        return path;
+      }
+    }
+  }
+  return kLinuxMemoryPressurePath.str();
+}
+
+optional<std::string> parseCgroupV2Path(StringPiece data) {
+  std::vector<StringPiece> lines;
+  folly::split('\n', data, lines);
+  for (auto line : lines) {
+    // cgroup v2 has a single hierarchy with ID 0 and no controller list.
+    if (line.removePrefix("0::") && !line.empty()) {
+      return line.str();
+    }
+  }
+  return std::nullopt;
+}
+
 std::string& trim(std::string& str, const std::string& delim) {
   str.erase(0, str.find_first_not_of(delim));
   str.erase(str.find_last_not_of(delim) + 1);
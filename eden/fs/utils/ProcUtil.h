@@ -19,6 +19,7 @@ constexpr folly::StringPiece kVmRSSKey{"VmRSS"};
 constexpr folly::StringPiece kKBytes{"kB"};
 constexpr folly::StringPiece kLinuxProcStatusPath{"/proc/self/status"};
 constexpr folly::StringPiece kLinuxProcSmapsPath{"/proc/self/smaps"};
+constexpr folly::StringPiece kLinuxMemoryPressurePath{"/proc/pressure/memory"};
 
 namespace proc_util {
 
@@ -59,6 +60,36 @@ std::optional<MemoryStats> parseStatmFile(
     folly::StringPiece data,
     size_t pageSize);
 
+/**
+ * Read a pressure stall information file, such as /proc/pressure/memory or a
+ * cgroup's memory.pressure, and return its "some avg10" value: the
+ * percentage of the last ten seconds in which at least one task was stalled
+ * waiting for memory.
+ *
+ * Returns std::nullopt if the file cannot be read or parsed, for example on
+ * kernels without PSI.
+ */
+std::optional<double> readMemoryPressure(const char* filename);
+
+/**
+ * Parse the contents of a pressure stall information file.
+ */
+std::optional<double> parseMemoryPressure(folly::StringPiece data);
+
+/**
+ * Returns the memory.pressure file of the cgroup v2 group this process is in,
+ * so the reading only covers the memory limit EdenFS runs under.  Falls back
+ * to kLinuxMemoryPressurePath, which covers the whole machine, if the process
+ * is not in a cgroup v2 group or the group has no memory.pressure file.
+ */
+std::string getMemoryPressurePath();
+
+/**
+ * Parse the contents of a /proc/<pid>/cgroup file, returning the path of the
+ * process's cgroup v2 group relative to the cgroup mount point.
+ */
+std::optional<std::string> parseCgroupV2Path(folly::StringPiece data);
+
 /**
  * Trim leading and trailing delimiter characters from passed string.
  * @return the modified string.
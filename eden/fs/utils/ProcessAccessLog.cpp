@@ -27,30 +27,37 @@ struct ThreadLocalBucket {
   }
 
   /**
-   * Returns whether the pid was newly-recorded in this thread-second or not.
+   * Applies update to pid's counts for secondsSinceStart.  Returns whether
+   * the pid was newly-recorded in this thread-second or not.
    */
-  bool add(
-      uint64_t secondsSinceStart,
-      pid_t pid,
-      ProcessAccessLog::AccessType type) {
+  template <typename Update>
+  bool add(uint64_t secondsSinceStart, pid_t pid, Update&& update) {
     auto state = state_.lock();
 
-    // isNewPid must be initialized because BucketedLog::add will not call
-    // Bucket::add if secondsSinceStart is too old and the sample is dropped.
-    // (In that case, it's unnecessary to record the process name.)
-    bool isNewPid = false;
-    state->buckets.add(secondsSinceStart, pid, isNewPid, type);
-    return isNewPid;
-  }
-
-  bool add(
-      uint64_t secondsSinceStart,
-      pid_t pid,
-      std::chrono::nanoseconds duration) {
-    auto state = state_.lock();
+    // Most of the requests a thread handles within one second come from the
+    // same process, so remember the counts the last call updated and skip
+    // the bucket and map lookups when they match.
+    if (state->lastCounts && state->lastSecond == secondsSinceStart &&
+        state->lastPid == pid) {
+      update(*state->lastCounts);
+      return false;
+    }
 
-    bool isNewPid = false;
-    state->buckets.add(secondsSinceStart, pid, isNewPid, duration);
+    // getBucket() returns null if secondsSinceStart is too old, in which case
+    // the sample is dropped and the process name need not be recorded.
+    auto* bucket = state->buckets.getBucket(secondsSinceStart);
+    if (!bucket) {
+      return false;
+    }
+    auto [it, isNewPid] = bucket->accessCountsByPid.emplace(
+        pid, ProcessAccessLog::PerBucketAccessCounts{});
+    update(it->second);
+    // unordered_map never moves its elements, so this stays valid until the
+    // bucket is cleared, which can only happen once the second has passed or
+    // when mergeUpstream() resets it.
+    state->lastSecond = secondsSinceStart;
+    state->lastPid = pid;
+    state->lastCounts = &it->second;
     return isNewPid;
   }
 
@@ -62,6 +69,7 @@ struct ThreadLocalBucket {
     state->owner->state_.withWLock(
         [&](auto& ownerState) { ownerState.buckets.merge(state->buckets); });
     state->buckets.clear();
+    state->lastCounts = nullptr;
   }
 
   void clearOwnerIfMe(ProcessAccessLog* owner) {
@@ -88,6 +96,10 @@ struct ThreadLocalBucket {
     explicit State(ProcessAccessLog* pal) : owner{pal} {}
     ProcessAccessLog::Buckets buckets;
     ProcessAccessLog* owner;
+
+    uint64_t lastSecond{0};
+    pid_t lastPid{0};
+    ProcessAccessLog::PerBucketAccessCounts* lastCounts{nullptr};
   };
 
   struct InitedMicroLock : folly::MicroLock {
@@ -107,32 +119,18 @@ void ProcessAccessLog::Bucket::clear() {
   accessCountsByPid.clear();
 }
 
-void ProcessAccessLog::Bucket::add(
-    pid_t pid,
-    bool& isNewPid,
-    ProcessAccessLog::AccessType type) {
-  auto [it, contains] = accessCountsByPid.emplace(pid, PerBucketAccessCounts{});
-  it->second[type]++;
-  isNewPid = contains;
-}
-
-void ProcessAccessLog::Bucket::add(
-    pid_t pid,
-    bool& isNewPid,
-    std::chrono::nanoseconds duration) {
-  auto [it, contains] = accessCountsByPid.emplace(pid, PerBucketAccessCounts{});
-  it->second.duration += duration;
-  isNewPid = contains;
-}
-
 void ProcessAccessLog::Bucket::merge(const Bucket& other) {
-  for (auto [pid, otherAccessCounts] : other.accessCountsByPid) {
+  for (const auto& [pid, otherAccessCounts] : other.accessCountsByPid) {
+    auto& accessCounts = accessCountsByPid[pid];
     for (std::underlying_type_t<AccessType> type = 0;
          type != folly::to_underlying(AccessType::Last);
          type++) {
-      accessCountsByPid[pid].counts[type] += otherAccessCounts.counts[type];
+      accessCounts.counts[type] += otherAccessCounts.counts[type];
     }
-    accessCountsByPid[pid].duration += otherAccessCounts.duration;
+    accessCounts.duration += otherAccessCounts.duration;
+    accessCounts.fetchCount += otherAccessCounts.fetchCount;
+    accessCounts.fetchBytes += otherAccessCounts.fetchBytes;
+    accessCounts.fetchWait += otherAccessCounts.fetchWait;
   }
 }
 
@@ -170,7 +168,8 @@ void ProcessAccessLog::recordAccess(
   // write-often, read-rarely use case, so, to avoid synchronization overhead,
   // record to thread-local storage and only merge into the access log when the
   // calling thread dies or when the data must be read.
-  bool isNewPid = getTlb()->add(getSecondsSinceEpoch(), pid, type);
+  bool isNewPid = getTlb()->add(
+      getSecondsSinceEpoch(), pid, [&](auto& counts) { counts[type]++; });
 
   // Many processes are short-lived, so grab the executable name during the
   // access. We could potentially get away with grabbing executable names a
@@ -193,7 +192,26 @@ void ProcessAccessLog::recordAccess(
 void ProcessAccessLog::recordDuration(
     pid_t pid,
     std::chrono::nanoseconds duration) {
-  bool isNewPid = getTlb()->add(getSecondsSinceEpoch(), pid, duration);
+  bool isNewPid = getTlb()->add(
+      getSecondsSinceEpoch(), pid, [&](auto& counts) {
+        counts.duration += duration;
+      });
+  if (pid != 0 && isNewPid) {
+    processNameCache_->add(pid);
+  }
+}
+
+void ProcessAccessLog::recordFetches(
+    pid_t pid,
+    uint64_t count,
+    uint64_t bytes,
+    std::chrono::nanoseconds wait) {
+  bool isNewPid = getTlb()->add(
+      getSecondsSinceEpoch(), pid, [&](auto& counts) {
+        counts.fetchCount += count;
+        counts.fetchBytes += bytes;
+        counts.fetchWait += wait;
+      });
   if (pid != 0 && isNewPid) {
     processNameCache_->add(pid);
   }
@@ -208,32 +226,39 @@ std::unordered_map<pid_t, AccessCounts> ProcessAccessLog::getAccessCounts(
     tlb.mergeUpstream();
   }
 
-  auto state = state_.wlock();
-  auto allBuckets = state->buckets.getAll(getSecondsSinceEpoch());
-
   if (secondCount < 0) {
     return {};
   }
 
+  // Merge the most recent buckets in place rather than copying all of them
+  // out first.
   Bucket bucket;
-  uint64_t count = std::min(
-      static_cast<uint64_t>(allBuckets.size()),
-      static_cast<uint64_t>(secondCount));
-  for (auto iter = allBuckets.end() - count; iter != allBuckets.end(); ++iter) {
-    bucket.merge(*iter);
-  }
+  uint64_t count =
+      std::min(kBucketCount, static_cast<uint64_t>(secondCount));
+  uint64_t index = 0;
+  state_.wlock()->buckets.forEach(
+      getSecondsSinceEpoch(), [&](const Bucket& recent) {
+        if (index++ >= kBucketCount - count) {
+          bucket.merge(recent);
+        }
+      });
 
   // Transfer to a Thrift map
   std::unordered_map<pid_t, AccessCounts> accessCountsByPid;
+  accessCountsByPid.reserve(bucket.accessCountsByPid.size());
   for (auto& [pid, accessCounts] : bucket.accessCountsByPid) {
-    accessCountsByPid[pid].fuseReads = accessCounts[AccessType::FuseRead];
-    accessCountsByPid[pid].fuseWrites = accessCounts[AccessType::FuseWrite];
-    accessCountsByPid[pid].fuseTotal = accessCounts[AccessType::FuseRead] +
+    auto& result = accessCountsByPid[pid];
+    result.fuseReads = accessCounts[AccessType::FuseRead];
+    result.fuseWrites = accessCounts[AccessType::FuseWrite];
+    result.fuseTotal = accessCounts[AccessType::FuseRead] +
         accessCounts[AccessType::FuseWrite] +
         accessCounts[AccessType::FuseOther];
-    accessCountsByPid[pid].fuseBackingStoreImports =
+    result.fuseBackingStoreImports =
         accessCounts[AccessType::FuseBackingStoreImport];
-    accessCountsByPid[pid].fuseDurationNs = accessCounts.duration.count();
+    result.fuseDurationNs = accessCounts.duration.count();
+    result.fetchCount = accessCounts.fetchCount;
+    result.fetchBytes = accessCounts.fetchBytes;
+    result.fetchWaitNs = accessCounts.fetchWait.count();
   }
   return accessCountsByPid;
 }
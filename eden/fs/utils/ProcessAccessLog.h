@@ -54,6 +54,17 @@ class ProcessAccessLog {
   void recordAccess(pid_t pid, AccessType type);
   void recordDuration(pid_t pid, std::chrono::nanoseconds duration);
 
+  /**
+   * Records the backing store imports a request by pid triggered: how many
+   * objects were imported, their total size, and the total time the request
+   * spent waiting on them.
+   */
+  void recordFetches(
+      pid_t pid,
+      uint64_t count,
+      uint64_t bytes,
+      std::chrono::nanoseconds wait);
+
   /**
    * Returns the number of times each pid was passed to recordAccess() in
    * `lastNSeconds`.
@@ -68,6 +79,9 @@ class ProcessAccessLog {
   struct PerBucketAccessCounts {
     size_t counts[enumValue(AccessType::Last)];
     std::chrono::nanoseconds duration;
+    uint64_t fetchCount;
+    uint64_t fetchBytes;
+    std::chrono::nanoseconds fetchWait;
 
     size_t& operator[](AccessType type) {
       static_assert(std::is_unsigned_v<std::underlying_type_t<AccessType>>);
@@ -80,8 +94,6 @@ class ProcessAccessLog {
   // Data for one second.
   struct Bucket {
     void clear();
-    void add(pid_t pid, bool& isNew, AccessType type);
-    void add(pid_t pid, bool& isNew, std::chrono::nanoseconds duration);
     void merge(const Bucket& other);
 
     std::unordered_map<pid_t, PerBucketAccessCounts> accessCountsByPid;
@@ -174,8 +174,17 @@ std::string readPidName(pid_t pid) {
 namespace facebook {
 namespace eden {
 
+namespace {
+// The longest a thread goes without refreshing the access time of a pid it
+// keeps recording.
+constexpr std::chrono::nanoseconds kMaxRefreshInterval =
+    std::chrono::seconds{1};
+} // namespace
+
 ProcessNameCache::ProcessNameCache(std::chrono::nanoseconds expiry)
-    : expiry_{expiry}, startPoint_{std::chrono::steady_clock::now()} {
+    : expiry_{expiry},
+      refreshInterval_{std::min(expiry / 16, kMaxRefreshInterval)},
+      startPoint_{std::chrono::steady_clock::now()} {
   workerThread_ = std::thread{[this] {
     folly::setThreadName("ProcessNameCacheWorker");
     processActions();
@@ -226,6 +235,16 @@ void ProcessNameCache::add(pid_t pid) {
 
   auto now = std::chrono::steady_clock::now() - startPoint_;
 
+  // Most calls come from a thread that recorded the same pid moments ago, so
+  // check for that without touching any shared state.
+  auto& recent = *recentPids_;
+  auto& slot = recent.slots[pid % recent.slots.size()];
+  if (slot.pid == pid && now - slot.recordedAt < refreshInterval_) {
+    return;
+  }
+  slot.pid = pid;
+  slot.recordedAt = now;
+
   tryRlockCheckBeforeUpdate<folly::Unit>(
       state_,
       [&](const auto& state) -> std::optional<folly::Unit> {
@@ -257,6 +276,15 @@ std::map<pid_t, std::string> ProcessNameCache::getAllProcessNames() {
   return std::move(future).get();
 }
 
+std::optional<std::string> ProcessNameCache::getCachedProcessName(pid_t pid) {
+  auto state = state_.rlock();
+  auto it = state->names.find(pid);
+  if (it == state->names.end()) {
+    return std::nullopt;
+  }
+  return it->second.name;
+}
+
 void ProcessNameCache::clearExpired(
     std::chrono::steady_clock::duration now,
     State& state) {
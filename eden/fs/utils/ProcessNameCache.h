@@ -8,12 +8,15 @@
 #pragma once
 
 #include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
 #include <folly/container/F14Set.h>
 #include <folly/futures/Promise.h>
 #include <folly/synchronization/LifoSem.h>
 #include <sys/types.h>
+#include <array>
 #include <chrono>
 #include <map>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -36,8 +39,9 @@ class ProcessNameCache {
    * Refreshes the expiry on the given pid. The process name is read
    * asynchronously on a background thread.
    *
-   * If possible, the caller should avoid calling add() with a series of
-   * redundant pids.
+   * Repeated calls for a pid from the same thread only touch shared state
+   * once per refresh interval (a small fraction of the expiry), so names may
+   * expire up to one refresh interval early.
    */
   void add(pid_t pid);
 
@@ -47,6 +51,12 @@ class ProcessNameCache {
    */
   std::map<pid_t, std::string> getAllProcessNames();
 
+  /**
+   * Returns the name of the pid if it has already been read, without waiting
+   * for the background thread.  Cheap enough to call once per request.
+   */
+  std::optional<std::string> getCachedProcessName(pid_t pid);
+
  private:
   struct ProcessName {
     ProcessName(std::string n, std::chrono::steady_clock::duration d)
@@ -64,6 +74,19 @@ class ProcessNameCache {
     mutable std::atomic<std::chrono::steady_clock::duration> lastAccess;
   };
 
+  /**
+   * The pids each thread has recently recorded, and when. A pid recorded
+   * less than refreshInterval_ ago is known to be cached or queued with a
+   * fresh access time, so add() can return without taking the state lock.
+   */
+  struct RecentPids {
+    struct Slot {
+      pid_t pid{-1};
+      std::chrono::steady_clock::duration recordedAt{};
+    };
+    std::array<Slot, 64> slots;
+  };
+
   struct State {
     std::unordered_map<pid_t, ProcessName> names;
 
@@ -81,7 +104,9 @@ class ProcessNameCache {
   void processActions();
 
   const std::chrono::nanoseconds expiry_;
+  const std::chrono::nanoseconds refreshInterval_;
   const std::chrono::steady_clock::time_point startPoint_;
+  folly::ThreadLocal<RecentPids> recentPids_;
   folly::Synchronized<State> state_;
   folly::LifoSem sem_;
   std::thread workerThread_;
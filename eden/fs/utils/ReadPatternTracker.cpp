@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/ReadPatternTracker.h"
+
+namespace facebook {
+namespace eden {
+
+ReadPattern ReadPatternTracker::recordRead(
+    uint64_t offset,
+    uint64_t size) noexcept {
+  auto gap = static_cast<int64_t>(offset - nextOffset_);
+  nextOffset_ = offset + size;
+
+  if (!started_) {
+    started_ = true;
+    if (offset == 0) {
+      pattern_ = ReadPattern::Sequential;
+    }
+    return pattern_;
+  }
+
+  if (gap == 0) {
+    pattern_ = ReadPattern::Sequential;
+    mismatched_ = false;
+  } else if (gap == stride_) {
+    pattern_ = ReadPattern::Strided;
+    mismatched_ = false;
+  } else {
+    stride_ = gap;
+    if (mismatched_ || pattern_ == ReadPattern::Unknown) {
+      pattern_ = ReadPattern::Random;
+    }
+    mismatched_ = true;
+  }
+  return pattern_;
+}
+
+} // namespace eden
+} // namespace facebook
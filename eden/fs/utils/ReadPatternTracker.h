@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace facebook {
+namespace eden {
+
+enum class ReadPattern : uint8_t {
+  /**
+   * Not enough reads have been seen to tell.
+   */
+  Unknown,
+  /**
+   * Each read starts where the previous one ended.
+   */
+  Sequential,
+  /**
+   * Each read starts the same distance past the end of the previous one.
+   */
+  Strided,
+  /**
+   * Reads jump around the file.
+   */
+  Random,
+};
+
+/**
+ * Classifies the access pattern of a series of reads into one file.
+ *
+ * A read that starts at offset 0 is assumed to begin a sequential scan.  A
+ * single read that breaks the current pattern, as happens when the kernel's
+ * readahead overlaps with a process's own reads, is not enough to call the
+ * reads random: that takes two in a row.
+ */
+class ReadPatternTracker {
+ public:
+  /**
+   * Records a read of size bytes at offset, and returns the pattern of the
+   * reads recorded so far.
+   */
+  ReadPattern recordRead(uint64_t offset, uint64_t size) noexcept;
+
+  ReadPattern getPattern() const noexcept {
+    return pattern_;
+  }
+
+ private:
+  uint64_t nextOffset_{0};
+  int64_t stride_{0};
+  ReadPattern pattern_{ReadPattern::Unknown};
+  bool started_{false};
+  bool mismatched_{false};
+};
+
+} // namespace eden
+} // namespace facebook
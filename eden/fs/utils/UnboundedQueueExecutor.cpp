@@ -9,24 +9,64 @@
 
 #include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/executors/ManualExecutor.h>
-#include <folly/executors/task_queue/UnboundedBlockingQueue.h>
+#include <folly/executors/task_queue/PriorityUnboundedBlockingQueue.h>
 #include <folly/executors/thread_factory/NamedThreadFactory.h>
 
 namespace facebook {
 namespace eden {
 
+namespace {
+// One lane each for LO_PRI, MID_PRI and HI_PRI.
+constexpr uint8_t kNumPriorities = 3;
+
+/**
+ * Forwards everything it is given to an UnboundedQueueExecutor at a fixed
+ * priority.
+ */
+class PriorityLaneExecutor : public folly::Executor {
+ public:
+  PriorityLaneExecutor(UnboundedQueueExecutor& executor, int8_t priority)
+      : executor_{executor}, priority_{priority} {}
+
+  void add(folly::Func func) override {
+    executor_.addWithPriority(std::move(func), priority_);
+  }
+
+ private:
+  UnboundedQueueExecutor& executor_;
+  const int8_t priority_;
+};
+} // namespace
+
 UnboundedQueueExecutor::UnboundedQueueExecutor(
     size_t threadCount,
     folly::StringPiece threadNamePrefix)
     : executor_{std::make_unique<folly::CPUThreadPoolExecutor>(
           threadCount,
-          std::make_unique<folly::UnboundedBlockingQueue<
-              folly::CPUThreadPoolExecutor::CPUTask>>(),
-          std::make_unique<folly::NamedThreadFactory>(threadNamePrefix))} {}
+          std::make_unique<folly::PriorityUnboundedBlockingQueue<
+              folly::CPUThreadPoolExecutor::CPUTask>>(kNumPriorities),
+          std::make_unique<folly::NamedThreadFactory>(threadNamePrefix))},
+      numPriorities_{kNumPriorities},
+      backgroundExecutor_{
+          std::make_unique<PriorityLaneExecutor>(*this, LO_PRI)} {}
 
 UnboundedQueueExecutor::UnboundedQueueExecutor(
     std::shared_ptr<folly::ManualExecutor> executor)
-    : executor_{std::move(executor)} {}
+    : executor_{std::move(executor)},
+      numPriorities_{1},
+      backgroundExecutor_{
+          std::make_unique<PriorityLaneExecutor>(*this, LO_PRI)} {}
+
+void UnboundedQueueExecutor::addWithPriority(
+    folly::Func func,
+    int8_t priority) {
+  if (numPriorities_ > 1) {
+    executor_->addWithPriority(std::move(func), priority);
+  } else {
+    // ManualExecutor runs everything in the order it was queued.
+    executor_->add(std::move(func));
+  }
+}
 
 } // namespace eden
 } // namespace facebook
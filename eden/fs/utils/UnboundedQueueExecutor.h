@@ -9,6 +9,7 @@
 
 #include <folly/Executor.h>
 #include <folly/Range.h>
+#include <memory>
 
 namespace folly {
 class ManualExecutor;
@@ -23,6 +24,11 @@ namespace eden {
  *
  * Parts of Eden rely on queuing a function to be non-blocking for deadlock
  * safety.
+ *
+ * Functions are queued in one of three lanes, folly::Executor::HI_PRI,
+ * MID_PRI and LO_PRI; an idle thread always takes from the most urgent
+ * non-empty lane. add() uses MID_PRI. Background work such as prefetching
+ * should use LO_PRI so that it never delays requests a user is waiting on.
  */
 class UnboundedQueueExecutor : public folly::Executor {
  public:
@@ -51,8 +57,24 @@ class UnboundedQueueExecutor : public folly::Executor {
     executor_->add(std::move(func));
   }
 
+  void addWithPriority(folly::Func func, int8_t priority) override;
+
+  uint8_t getNumPriorities() const override {
+    return numPriorities_;
+  }
+
+  /**
+   * An Executor that queues functions on this one at LO_PRI, for use with
+   * folly::via(). It is valid for as long as this executor is.
+   */
+  folly::Executor* getBackgroundExecutor() const {
+    return backgroundExecutor_.get();
+  }
+
  private:
   std::shared_ptr<folly::Executor> executor_;
+  uint8_t numPriorities_;
+  std::unique_ptr<folly::Executor> backgroundExecutor_;
 };
 
 } // namespace eden
@@ -57,6 +57,21 @@ namespace {
  * linux/include/net/scm.h
  */
 constexpr size_t kMaxFDs = 253;
+
+/**
+ * The capacity of the buffer that small messages are received into.  Message
+ * bodies at least this large are received directly into their own buffer.
+ */
+constexpr size_t kRecvBufferSize = 64 * 1024;
+
+/**
+ * The number of 1-byte placeholders sent after a message's data, each with
+ * one additional batch of file descriptors, when a message carries more than
+ * fit in its first sendmsg() call.
+ */
+size_t getFillerByteCount(size_t numFiles) {
+  return numFiles > kMaxFDs ? (numFiles - 1) / kMaxFDs : 0;
+}
 } // namespace
 
 class UnixSocket::Connector : private folly::EventHandler, folly::AsyncTimeout {
@@ -109,7 +124,8 @@ UnixSocket::UnixSocket(EventBase* eventBase, File socket)
       socket_{std::move(socket)},
       // Create recvControlBuffer_ with enough capacity to receive
       // the maximum number of file descriptors that can be sent at once.
-      recvControlBuffer_(CMSG_SPACE(kMaxFDs * sizeof(int))) {
+      recvControlBuffer_(CMSG_SPACE(kMaxFDs * sizeof(int))),
+      recvBuffer_(IOBuf::CREATE, kRecvBufferSize) {
   // on macOS, sendmsg() doesn't respect MSG_DONTWAIT at all.
   // Instead, the socket must be placed on non-blocking mode for
   // the sendmsg call to have non-blocking semantics.
@@ -485,23 +501,24 @@ void UnixSocket::trySend() {
   // break out after sending MAX_MSGS_AT_ONCE, just to yield the event loop
   // so that we don't starve other events that need to be handled.
   constexpr unsigned int MAX_MSGS_AT_ONCE = 10;
-  for (unsigned int n = 0; n < MAX_MSGS_AT_ONCE; ++n) {
-    if (!sendQueue_) {
-      break;
-    }
-
-    if (!trySendMessage(sendQueue_.get())) {
+  size_t n = 0;
+  while (sendQueue_ && n < MAX_MSGS_AT_ONCE) {
+    auto sent = trySendMessages(MAX_MSGS_AT_ONCE - n);
+    if (sent == 0) {
       // The write blocked, and we need to retry this message again
       // after waiting for the socket to become writable.
       break;
     }
-    auto* callback = sendQueue_->callback;
-    sendQueue_ = std::move(sendQueue_->next);
-    if (!sendQueue_) {
-      sendQueueTail_ = nullptr;
-    }
-    if (callback) {
-      callback->sendSuccess();
+    n += sent;
+    for (; sent > 0; --sent) {
+      auto* callback = sendQueue_->callback;
+      sendQueue_ = std::move(sendQueue_->next);
+      if (!sendQueue_) {
+        sendQueueTail_ = nullptr;
+      }
+      if (callback) {
+        callback->sendSuccess();
+      }
     }
   }
 
@@ -521,6 +538,93 @@ void UnixSocket::trySend() {
   }
 }
 
+namespace {
+/**
+ * Advances entry's iovecs past bytesSent bytes of sent data, or to their end.
+ * Returns how many of the bytes belonged to later entries.
+ */
+template <typename Entry>
+size_t consumeSentData(Entry* entry, size_t bytesSent) {
+  while (bytesSent > 0 && entry->iovIndex < entry->iovCount) {
+    auto* iov = entry->iov + entry->iovIndex;
+    if (bytesSent >= iov->iov_len) {
+      bytesSent -= iov->iov_len;
+      ++entry->iovIndex;
+    } else {
+      iov->iov_len -= bytesSent;
+      iov->iov_base = static_cast<char*>(iov->iov_base) + bytesSent;
+      bytesSent = 0;
+    }
+  }
+  return bytesSent;
+}
+} // namespace
+
+size_t UnixSocket::trySendMessages(size_t maxMessages) {
+  auto* first = sendQueue_.get();
+  // Messages still sending their remaining file descriptors, messages with
+  // more descriptors than fit in one call, and messages with too many iovecs
+  // to share a call are sent on their own.
+  if (first->iovIndex >= first->iovCount ||
+      first->message.files.size() > kMaxFDs ||
+      first->iovCount - first->iovIndex > folly::kIovMax || maxMessages < 2 ||
+      !first->next || !first->next->message.files.empty()) {
+    return trySendMessage(first) ? 1 : 0;
+  }
+
+  vector<struct iovec> iovs;
+  size_t numEntries = 0;
+  for (auto* entry = first; entry && numEntries < maxMessages;
+       entry = entry->next.get()) {
+    // File descriptors are attached to the first byte of a sendmsg() call,
+    // so only the first message may carry any.
+    auto remaining = entry->iovCount - entry->iovIndex;
+    if ((entry != first && !entry->message.files.empty()) ||
+        iovs.size() + remaining > folly::kIovMax) {
+      break;
+    }
+    iovs.insert(
+        iovs.end(),
+        entry->iov + entry->iovIndex,
+        entry->iov + entry->iovCount);
+    ++numEntries;
+  }
+
+  struct msghdr msg = {};
+  msg.msg_iov = iovs.data();
+  msg.msg_iovlen = iovs.size();
+  vector<uint8_t> controlBuf;
+  size_t filesToSend = 0;
+  bool isFirstSend = first->iovIndex == 0 &&
+      (first->iov[0].iov_base == first->header.data());
+  if (isFirstSend) {
+    filesToSend = initializeFirstControlMsg(controlBuf, &msg, first);
+  }
+
+  auto bytesSent = sendmsg(socket_.fd(), &msg, MSG_DONTWAIT);
+  XLOG(DBG9) << "sendmsg() of " << numEntries << " messages returned "
+             << bytesSent << ", files sent: " << filesToSend;
+  if (bytesSent < 0) {
+    if (errno == EAGAIN) {
+      return 0;
+    }
+    throwSystemError("sendmsg() failed on UnixSocket");
+  }
+  first->filesSent += filesToSend;
+
+  size_t sentEntries = 0;
+  size_t bytesLeft = bytesSent;
+  for (auto* entry = first; sentEntries < numEntries;
+       entry = entry->next.get()) {
+    bytesLeft = consumeSentData(entry, bytesLeft);
+    if (entry->iovIndex < entry->iovCount) {
+      break;
+    }
+    ++sentEntries;
+  }
+  return sentEntries;
+}
+
 bool UnixSocket::trySendMessage(SendQueueEntry* entry) {
   uint8_t dataByte = 0;
   struct msghdr msg = {};
@@ -582,18 +686,7 @@ bool UnixSocket::trySendMessage(SendQueueEntry* entry) {
   if (entry->iovIndex < entry->iovCount) {
     // Update entry->iov and entry->iovIndex to account for the data that was
     // successfully sent.
-    while (bytesSent > 0) {
-      if (static_cast<size_t>(bytesSent) >=
-          entry->iov[entry->iovIndex].iov_len) {
-        bytesSent -= entry->iov[entry->iovIndex].iov_len;
-        ++entry->iovIndex;
-      } else {
-        auto* iov = entry->iov + entry->iovIndex;
-        iov->iov_len -= bytesSent;
-        iov->iov_base = static_cast<char*>(iov->iov_base) + bytesSent;
-        break;
-      }
-    }
+    consumeSentData(entry, bytesSent);
   }
 
   // Update entry->filesSent to account for the file descriptors we sent.
@@ -678,6 +771,11 @@ void UnixSocket::setReceiveCallback(ReceiveCallback* callback) {
   eventBase_->dcheckIsInEventBaseThread();
   receiveCallback_ = callback;
   registerForReads();
+  if (!recvBuffer_.empty()) {
+    // Data left over from before the previous callback was uninstalled will
+    // not trigger another readable event.
+    scheduleBufferedReceive();
+  }
 }
 
 void UnixSocket::clearReceiveCallback() {
@@ -713,6 +811,21 @@ void UnixSocket::tryReceive() {
     headerBytesReceived_ = 0;
     receiveCallback_->messageReceived(Message{std::move(recvMessage_)});
   }
+
+  if (receiveCallback_ && !recvBuffer_.empty()) {
+    // The socket may have no more data to make it readable again, so process
+    // what we already received on the next loop iteration.
+    scheduleBufferedReceive();
+  }
+}
+
+void UnixSocket::scheduleBufferedReceive() {
+  eventBase_->runInLoop(
+      [this, eventBase = eventBase_, guard = DestructorGuard{this}] {
+        if (eventBase_ == eventBase && receiveCallback_ && socket_) {
+          handlerReady(EventHandler::READ);
+        }
+      });
 }
 
 bool UnixSocket::tryReceiveOne() {
@@ -750,6 +863,7 @@ bool UnixSocket::tryReceiveOne() {
     if (recvHeader_.dataSize > 0) {
       recvMessage_.data = IOBuf(IOBuf::CREATE, recvHeader_.dataSize);
     }
+    recvFillerBytes_ = getFillerByteCount(recvHeader_.numFiles);
   }
 
   if (recvMessage_.data.computeChainDataLength() < recvHeader_.dataSize) {
@@ -758,12 +872,20 @@ bool UnixSocket::tryReceiveOne() {
     }
   }
 
-  if (recvMessage_.files.size() < recvHeader_.numFiles) {
+  if (recvFillerBytes_ > 0 || recvFiles_.size() < recvHeader_.numFiles) {
     if (!tryReceiveFiles()) {
       return false;
     }
   }
 
+  // File descriptors arrive in the order their messages were sent, and a
+  // message's descriptors are attached to its own bytes, so the oldest
+  // received descriptors belong to this message.  Descriptors for the
+  // following message may already have arrived with it.
+  for (size_t n = 0; n < recvHeader_.numFiles; ++n) {
+    recvMessage_.files.push_back(std::move(recvFiles_.front()));
+    recvFiles_.pop_front();
+  }
   return true;
 }
 
@@ -810,7 +932,7 @@ void UnixSocket::processReceivedFiles(struct cmsghdr* cmsg) {
     folly::checkPosixError(flags);
     folly::checkPosixError(fcntl(fd, F_SETFD, flags | FD_CLOEXEC));
 #endif
-    recvMessage_.files.push_back(File{fd, /* ownsFd */ true});
+    recvFiles_.push_back(File{fd, /* ownsFd */ true});
   }
 }
 
@@ -848,78 +970,131 @@ ssize_t UnixSocket::callRecvMsg(MutableByteRange buf) {
   return bytesReceived;
 }
 
-bool UnixSocket::tryReceiveHeader() {
-  MutableByteRange buf{recvHeaderBuffer_.data(), recvHeaderBuffer_.size()};
-  buf.advance(headerBytesReceived_);
+size_t UnixSocket::takeBufferedData(MutableByteRange buf) {
+  auto length = std::min(buf.size(), recvBuffer_.length());
+  if (length > 0) {
+    memcpy(buf.data(), recvBuffer_.data(), length);
+    recvBuffer_.trimStart(length);
+  }
+  return length;
+}
 
-  auto bytesReceived = callRecvMsg(buf);
-  if (bytesReceived < 0) {
-    if (errno == EAGAIN) {
-      return false;
+ssize_t UnixSocket::fillRecvBuffer() {
+  if (recvBuffer_.empty()) {
+    recvBuffer_.clear();
+  } else if (recvBuffer_.tailroom() == 0) {
+    // Move the unprocessed data to the front of the buffer.
+    auto length = recvBuffer_.length();
+    memmove(recvBuffer_.writableBuffer(), recvBuffer_.data(), length);
+    recvBuffer_.clear();
+    recvBuffer_.append(length);
+    if (recvBuffer_.tailroom() == 0) {
+      throwSystemErrorExplicit(
+          ECONNABORTED, "unix socket receive buffer unexpectedly full");
     }
-    throwSystemError("error receiving message header on unix socket");
   }
-  if (bytesReceived == 0) {
-    if (headerBytesReceived_ == 0) {
-      receiveCallback_->eofReceived();
+
+  auto bytesReceived = callRecvMsg(
+      MutableByteRange{recvBuffer_.writableTail(), recvBuffer_.tailroom()});
+  if (bytesReceived > 0) {
+    recvBuffer_.append(bytesReceived);
+  }
+  return bytesReceived;
+}
+
+bool UnixSocket::tryReceiveHeader() {
+  while (true) {
+    MutableByteRange buf{recvHeaderBuffer_.data(), recvHeaderBuffer_.size()};
+    buf.advance(headerBytesReceived_);
+    headerBytesReceived_ += takeBufferedData(buf);
+    if (headerBytesReceived_ == recvHeaderBuffer_.size()) {
+      return true;
+    }
+
+    auto bytesReceived = fillRecvBuffer();
+    if (bytesReceived < 0) {
       return false;
     }
-    throwSystemErrorExplicit(
-        ECONNABORTED,
-        "remote endpoint closed connection partway "
-        "through a unix socket message header");
+    if (bytesReceived == 0) {
+      if (headerBytesReceived_ == 0) {
+        receiveCallback_->eofReceived();
+        return false;
+      }
+      throwSystemErrorExplicit(
+          ECONNABORTED,
+          "remote endpoint closed connection partway "
+          "through a unix socket message header");
+    }
   }
-
-  headerBytesReceived_ += bytesReceived;
-  return headerBytesReceived_ == recvHeaderBuffer_.size();
 }
 
 bool UnixSocket::tryReceiveData() {
-  auto dataToRead =
-      recvHeader_.dataSize - recvMessage_.data.computeChainDataLength();
-  auto bytesReceived = callRecvMsg(
-      MutableByteRange{recvMessage_.data.writableTail(), dataToRead});
-  if (bytesReceived < 0) {
-    return false;
-  }
-  if (bytesReceived == 0) {
-    throwSystemErrorExplicit(
-        ECONNABORTED,
-        "remote endpoint closed connection partway "
-        "through a unix socket message");
-  }
+  while (true) {
+    auto dataToRead =
+        recvHeader_.dataSize - recvMessage_.data.computeChainDataLength();
+    MutableByteRange buf{recvMessage_.data.writableTail(), dataToRead};
+    auto buffered = takeBufferedData(buf);
+    recvMessage_.data.append(buffered);
+    dataToRead -= buffered;
+    if (dataToRead == 0) {
+      return true;
+    }
 
-  recvMessage_.data.append(bytesReceived);
-  if (static_cast<size_t>(bytesReceived) == dataToRead) {
-    return true;
+    ssize_t bytesReceived;
+    if (dataToRead >= kRecvBufferSize) {
+      // Large bodies are received straight into the message buffer rather
+      // than copied through recvBuffer_.
+      bytesReceived = callRecvMsg(
+          MutableByteRange{recvMessage_.data.writableTail(), dataToRead});
+      if (bytesReceived > 0) {
+        recvMessage_.data.append(bytesReceived);
+      }
+    } else {
+      bytesReceived = fillRecvBuffer();
+    }
+    if (bytesReceived < 0) {
+      return false;
+    }
+    if (bytesReceived == 0) {
+      throwSystemErrorExplicit(
+          ECONNABORTED,
+          "remote endpoint closed connection partway "
+          "through a unix socket message");
+    }
   }
-  return false;
 }
 
 bool UnixSocket::tryReceiveFiles() {
-  uint8_t dataByte = 0;
-  MutableByteRange buf(&dataByte, sizeof(dataByte));
-  auto bytesReceived = callRecvMsg(buf);
-  if (bytesReceived < 0) {
-    return false;
-  }
-  if (bytesReceived == 0) {
-    throwSystemErrorExplicit(
-        ECONNABORTED,
-        "remote endpoint closed connection partway "
-        "through a unix socket FD message");
-  }
+  while (true) {
+    // Each batch of file descriptors after the first is sent along with one
+    // placeholder byte.
+    auto fillerBytes = std::min(recvFillerBytes_, recvBuffer_.length());
+    recvBuffer_.trimStart(fillerBytes);
+    recvFillerBytes_ -= fillerBytes;
+    if (recvFillerBytes_ == 0) {
+      if (recvFiles_.size() < recvHeader_.numFiles) {
+        throwSystemErrorExplicit(
+            ECONNABORTED,
+            "remote endpoint sent fewer file descriptors than indicated "
+            "in the unix socket message header: ",
+            recvFiles_.size(),
+            " < ",
+            recvHeader_.numFiles);
+      }
+      return true;
+    }
 
-  if (recvMessage_.files.size() > recvHeader_.numFiles) {
-    throwSystemErrorExplicit(
-        ECONNABORTED,
-        "remote endpoint sent more file descriptors than indicated "
-        "in the unix socket message header: ",
-        recvMessage_.files.size(),
-        " > ",
-        recvHeader_.numFiles);
+    auto bytesReceived = fillRecvBuffer();
+    if (bytesReceived < 0) {
+      return false;
+    }
+    if (bytesReceived == 0) {
+      throwSystemErrorExplicit(
+          ECONNABORTED,
+          "remote endpoint closed connection partway "
+          "through a unix socket FD message");
+    }
   }
-  return (recvMessage_.files.size() == recvHeader_.numFiles);
 }
 
 void UnixSocket::registerForReads() {
@@ -9,6 +9,7 @@
 
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <deque>
 #include <memory>
 #include <vector>
 
@@ -348,6 +349,14 @@ class UnixSocket : public folly::DelayedDestruction,
       SendCallback* callback);
 
   void trySend();
+
+  /**
+   * Sends the front of the send queue.  Messages carrying no file
+   * descriptors that follow it are gathered into the same sendmsg() call.
+   *
+   * Returns how many queue entries were sent completely.
+   */
+  size_t trySendMessages(size_t maxMessages);
   bool trySendMessage(SendQueueEntry* entry);
   size_t initializeFirstControlMsg(
       std::vector<uint8_t>& controlBuf,
@@ -364,6 +373,25 @@ class UnixSocket : public folly::DelayedDestruction,
   bool tryReceiveData();
   bool tryReceiveFiles();
 
+  /**
+   * Moves up to buf.size() bytes already read into recvBuffer_ into buf,
+   * returning how many were moved.
+   */
+  size_t takeBufferedData(folly::MutableByteRange buf);
+
+  /**
+   * Reads as much as is available, up to the free space in recvBuffer_,
+   * into recvBuffer_.  Returns the same values as callRecvMsg().
+   */
+  ssize_t fillRecvBuffer();
+
+  /**
+   * Receiving can get ahead of the receive callback, and buffered messages
+   * do not make the socket readable again, so deliver them from the next
+   * EventBase loop iteration instead.
+   */
+  void scheduleBufferedReceive();
+
   /**
    * Call recvmsg(), reading data into the supplied ByteRange.
    *
@@ -412,6 +440,18 @@ class UnixSocket : public folly::DelayedDestruction,
   Header recvHeader_{0, 0, 0};
   Message recvMessage_;
 
+  // Reads are made into this reused buffer, so that several small messages
+  // arrive in one recvmsg() call.  Large payloads bypass it.
+  folly::IOBuf recvBuffer_;
+
+  // File descriptors are assigned to messages in the order they arrive,
+  // since a read may also pick up those of the next message.
+  std::deque<folly::File> recvFiles_;
+
+  // The number of 1-byte placeholders, each sent with an additional batch of
+  // file descriptors, still to be read for the current message.
+  size_t recvFillerBytes_{0};
+
   SendQueuePtr sendQueue_;
   SendQueueEntry* sendQueueTail_{nullptr};
 };
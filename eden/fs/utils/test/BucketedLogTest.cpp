@@ -93,6 +93,25 @@ TEST(BucketedLog, accumulates_within_bucket) {
   EXPECT_EQ(bucketArray("", "", "abc"), b.getAll(1));
 }
 
+TEST(BucketedLog, get_bucket_updates_in_place) {
+  BucketedLog<Bucket, 3> b;
+  b.getBucket(5)->add("a");
+  b.getBucket(5)->add("b");
+  b.getBucket(6)->add("c");
+  EXPECT_EQ(nullptr, b.getBucket(3));
+  EXPECT_EQ(bucketArray("", "ab", "c"), b.getAll(6));
+}
+
+TEST(BucketedLog, for_each_visits_oldest_first) {
+  BucketedLog<Bucket, 3> b;
+  b.add(1, "a");
+  b.add(2, "b");
+  b.add(3, "c");
+  std::string visited;
+  b.forEach(3, [&](const Bucket& bucket) { visited += bucket.s; });
+  EXPECT_EQ("abc", visited);
+}
+
 TEST(BucketedLog, drops_old_values_when_time_skips_ahead) {
   BucketedLog<Bucket, 3> b;
   b.add(1, "a");
@@ -151,3 +151,21 @@ TEST(FaultInjector, noop) {
   fi.check("mount", "/a/b/c");
   EXPECT_THROW_RE(fi.check("mount", "/test/test"), std::runtime_error, "fail");
 }
+
+TEST(FaultInjector, keyClassesWithSameLength) {
+  FaultInjector fi(true);
+  // "mount" and "fetch" are checked through the same armed bucket, so faults
+  // for one must not affect the other.
+  fi.injectError("mount", ".*", std::runtime_error("mount"), 1);
+  fi.injectError("fetch", "abc", std::runtime_error("fetch"));
+  fi.check("fetch", "def");
+  fi.check("mount_", "/a/b/c");
+  EXPECT_THROW_RE(fi.check("mount", "/a/b/c"), std::runtime_error, "mount");
+  fi.check("mount", "/a/b/c");
+
+  // Removing the last fault for a key class disarms its checks.
+  EXPECT_THROW_RE(fi.check("fetch", "abc"), std::runtime_error, "fetch");
+  EXPECT_TRUE(fi.removeFault("fetch", "abc"));
+  fi.check("fetch", "abc");
+  fi.checkAsync("mount", "/a/b/c").get();
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/InternedPathComponent.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace facebook::eden;
+
+TEST(InternedPathComponent, short_names_are_stored_inline) {
+  auto before = InternedPathComponent::getTableSize();
+  InternedPathComponent name{"BUCK"_pc};
+  EXPECT_EQ("BUCK"_pc, name.piece());
+  EXPECT_EQ(before, InternedPathComponent::getTableSize());
+  EXPECT_EQ(InternedPathComponent{"BUCK"_pc}, name);
+  EXPECT_NE(InternedPathComponent{"BUCKS"_pc}, name);
+}
+
+TEST(InternedPathComponent, long_names_share_one_entry) {
+  auto before = InternedPathComponent::getTableSize();
+  {
+    InternedPathComponent name1{"__init__.py"_pc};
+    InternedPathComponent name2{PathComponent{"__init__.py"}.piece()};
+    EXPECT_EQ(before + 1, InternedPathComponent::getTableSize());
+    EXPECT_EQ(name1, name2);
+    EXPECT_EQ(name1.stringPiece().data(), name2.stringPiece().data());
+    EXPECT_EQ("__init__.py"_pc, name2.piece());
+
+    InternedPathComponent other{"__main__.py"_pc};
+    EXPECT_NE(name1, other);
+    EXPECT_EQ(before + 2, InternedPathComponent::getTableSize());
+  }
+  EXPECT_EQ(before, InternedPathComponent::getTableSize());
+}
+
+TEST(InternedPathComponent, copies_keep_the_entry_alive) {
+  auto before = InternedPathComponent::getTableSize();
+  std::vector<InternedPathComponent> names;
+  {
+    InternedPathComponent name{"some_long_file_name.txt"_pc};
+    names.push_back(name);
+    names.push_back(std::move(name));
+  }
+  EXPECT_EQ(before + 1, InternedPathComponent::getTableSize());
+  EXPECT_EQ("some_long_file_name.txt"_pc, names[0].piece());
+
+  names[0] = InternedPathComponent{"x"_pc};
+  EXPECT_EQ("x"_pc, names[0].piece());
+  EXPECT_EQ(before + 1, InternedPathComponent::getTableSize());
+  names.clear();
+  EXPECT_EQ(before, InternedPathComponent::getTableSize());
+}
+
+TEST(InternedPathComponent, concurrent_interning) {
+  auto before = InternedPathComponent::getTableSize();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([] {
+      for (int i = 0; i < 1000; ++i) {
+        InternedPathComponent name{"concurrently_interned"_pc};
+        InternedPathComponent copy{name};
+        EXPECT_EQ("concurrently_interned"_pc, copy.piece());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(before, InternedPathComponent::getTableSize());
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/LeaseCache.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+using namespace facebook::eden;
+using namespace folly;
+
+namespace {
+struct Fetcher {
+  LeaseCache<int, std::string>::FutureType operator()(const int& key) {
+    ++fetches[key];
+    auto& promise = pending[key];
+    promise = Promise<std::shared_ptr<std::string>>{};
+    return promise.getFuture();
+  }
+
+  std::unordered_map<int, int> fetches;
+  std::unordered_map<int, Promise<std::shared_ptr<std::string>>> pending;
+};
+} // namespace
+
+TEST(LeaseCacheTest, concurrent_gets_share_one_fetch) {
+  Fetcher fetcher;
+  LeaseCache<int, std::string> cache{10, std::ref(fetcher)};
+
+  auto f1 = cache.get(1);
+  auto f2 = cache.get(1);
+  EXPECT_EQ(1, fetcher.fetches[1]);
+  EXPECT_FALSE(f1.isReady());
+
+  fetcher.pending[1].setValue(std::make_shared<std::string>("one"));
+  EXPECT_EQ("one", *std::move(f1).get());
+  EXPECT_EQ("one", *std::move(f2).get());
+  EXPECT_EQ("one", *cache.get(1).get());
+  EXPECT_EQ(1, fetcher.fetches[1]);
+
+  auto stats = cache.getStats();
+  EXPECT_EQ(2, stats.hitCount);
+  EXPECT_EQ(1, stats.missCount);
+}
+
+TEST(LeaseCacheTest, failed_fetches_are_retried) {
+  Fetcher fetcher;
+  LeaseCache<int, std::string> cache{10, std::ref(fetcher)};
+
+  auto f1 = cache.get(1);
+  fetcher.pending[1].setException(std::runtime_error("failed"));
+  EXPECT_THROW(std::move(f1).get(), std::runtime_error);
+  EXPECT_FALSE(cache.exists(1));
+
+  auto f2 = cache.get(1);
+  EXPECT_EQ(2, fetcher.fetches[1]);
+  fetcher.pending[1].setValue(std::make_shared<std::string>("one"));
+  EXPECT_EQ("one", *std::move(f2).get());
+}
+
+TEST(LeaseCacheTest, shards_evict_independently) {
+  Fetcher fetcher;
+  // Two shards of two entries each.
+  LeaseCache<int, std::string> cache{4, std::ref(fetcher), 1, 2};
+
+  for (int i = 0; i < 20; ++i) {
+    cache.set(i, std::make_shared<std::string>(std::to_string(i)));
+  }
+  size_t present = 0;
+  for (int i = 0; i < 20; ++i) {
+    present += cache.exists(i);
+  }
+  EXPECT_LE(present, 4);
+  EXPECT_EQ(20 - present, cache.getStats().evictionCount);
+
+  // The most recent entry is always kept.
+  EXPECT_TRUE(cache.exists(19));
+  EXPECT_EQ("19", *cache.get(19).get());
+  EXPECT_EQ(0, fetcher.fetches[19]);
+}
@@ -64,6 +64,25 @@ TEST_F(MappedDiskVectorTest, grows_file) {
   EXPECT_GT(new_size, old_size);
 }
 
+TEST_F(MappedDiskVectorTest, large_files_grow_geometrically) {
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+
+  // 80 MB, which would take 80 remaps with a constant 1 MB growth step.
+  constexpr uint64_t N = 10000000;
+  size_t growths = 0;
+  auto capacity = mdv.capacity();
+  for (uint64_t i = 0; i < N; ++i) {
+    mdv.emplace_back(i);
+    if (mdv.capacity() != capacity) {
+      capacity = mdv.capacity();
+      ++growths;
+    }
+  }
+  EXPECT_EQ(N, mdv.size());
+  EXPECT_EQ(N - 1, mdv[N - 1]);
+  EXPECT_LT(growths, 30);
+}
+
 TEST_F(MappedDiskVectorTest, remembers_contents_on_reopen) {
   {
     auto mdv = MappedDiskVector<U64>::open(mdvPath);
@@ -359,6 +359,27 @@ TEST(PathFuncs, PathComponent) {
       PathComponent(".."), std::domain_error, "must not be \\. or \\.\\.");
 }
 
+TEST(PathFuncs, PathComponentRejectsSeparatorAnywhere) {
+  // Long enough that the separator search covers several vector widths.
+  std::string name(100, 'x');
+  EXPECT_EQ(name, PathComponent(name).stringPiece());
+  for (size_t pos : {0, 15, 16, 63, 99}) {
+    auto withSeparator = name;
+    withSeparator[pos] = '/';
+    EXPECT_THROW_RE(
+        PathComponent(withSeparator),
+        std::domain_error,
+        "containing a directory separator");
+  }
+  EXPECT_EQ("...", PathComponent("...").stringPiece());
+  EXPECT_EQ(".x", PathComponent(".x").stringPiece());
+}
+
+TEST(PathFuncs, SkipSanityCheckFromString) {
+  RelativePath trusted{std::string{"foo/bar"}, detail::SkipPathSanityCheck{}};
+  EXPECT_EQ("foo/bar"_relpath, trusted);
+}
+
 TEST(PathFuncs, RelativePath) {
   RelativePath emptyRel;
   EXPECT_EQ("", emptyRel.stringPiece());
@@ -6,6 +6,7 @@
  */
 
 #include "eden/fs/utils/PathMap.h"
+#include <folly/Conv.h>
 #include <folly/portability/Unistd.h>
 #include <gtest/gtest.h>
 
@@ -127,6 +128,21 @@ TEST(PathMap, emplace) {
   EXPECT_TRUE(map.at("one"_pc).dummy) << "didn't change value to false";
 }
 
+TEST(PathMap, reserve) {
+  PathMap<int> map;
+  map.reserve(3);
+  map.emplace("b"_pc, 2);
+  map.emplace("c"_pc, 3);
+  map.emplace("a"_pc, 1);
+  EXPECT_EQ(3, map.size());
+  EXPECT_EQ("a"_pc, map.begin()->first);
+
+  // Reserving past the index threshold leaves the map as it was.
+  map.reserve(PathMap<int>::kIndexThreshold * 2);
+  EXPECT_FALSE(map.isIndexed());
+  EXPECT_EQ(2, map.at("b"_pc));
+}
+
 TEST(PathMap, swap) {
   PathMap<std::string> b, a{std::make_pair(PathComponent("foo"), "foo")};
 
@@ -140,3 +156,84 @@ TEST(PathMap, swap) {
   EXPECT_EQ(0, b.size()) << "b now has 0 elements";
   EXPECT_EQ("foo", a.at("foo"_pc));
 }
+
+TEST(PathMap, emplace_moving_an_element_while_converting_to_indexed) {
+  using Map = PathMap<std::string>;
+  Map map;
+  for (size_t i = 0; i < Map::kIndexThreshold; ++i) {
+    map.emplace(
+        PathComponent(folly::to<std::string>("file", i)),
+        folly::to<std::string>("a value too long for small strings ", i));
+  }
+  ASSERT_FALSE(map.isIndexed());
+
+  // This insert converts the map, while its value is still an element of
+  // the map, as when TreeInode renames an entry.
+  auto source = map.find("file5"_pc);
+  ASSERT_NE(map.end(), source);
+  auto inserted = map.emplace("renamed"_pc, std::move(source->second));
+  EXPECT_TRUE(inserted.second);
+  EXPECT_TRUE(map.isIndexed());
+  EXPECT_EQ("a value too long for small strings 5", inserted.first->second);
+  EXPECT_EQ("a value too long for small strings 5", map.at("renamed"_pc));
+}
+
+TEST(PathMap, large_maps_are_indexed) {
+  constexpr size_t kCount = PathMap<int>::kIndexThreshold * 3;
+  auto nameFor = [](size_t i) {
+    return PathComponent(folly::to<std::string>("file", i));
+  };
+
+  PathMap<int> map;
+  // Insert in descending order so that every vector insert is at the front.
+  for (size_t i = kCount; i > 0; --i) {
+    EXPECT_TRUE(map.emplace(nameFor(i - 1), static_cast<int>(i - 1)).second);
+    EXPECT_EQ(map.size() > PathMap<int>::kIndexThreshold, map.isIndexed());
+  }
+  EXPECT_EQ(kCount, map.size());
+
+  for (size_t i = 0; i < kCount; ++i) {
+    auto iter = map.find(nameFor(i));
+    ASSERT_NE(map.end(), iter);
+    EXPECT_EQ(static_cast<int>(i), iter->second);
+    EXPECT_FALSE(map.emplace(nameFor(i), -1).second);
+  }
+  EXPECT_EQ(map.end(), map.find("notpresent"_pc));
+
+  // Iteration remains in sorted order.
+  EXPECT_TRUE(std::is_sorted(
+      map.begin(), map.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+      }));
+
+  // Erase every other entry, using both forms of erase.
+  for (size_t i = 0; i < kCount; i += 2) {
+    if (i % 4 == 0) {
+      EXPECT_EQ(1, map.erase(nameFor(i)));
+    } else {
+      map.erase(map.find(nameFor(i)));
+    }
+  }
+  EXPECT_EQ(kCount / 2, map.size());
+  EXPECT_TRUE(map.isIndexed());
+  for (size_t i = 0; i < kCount; ++i) {
+    EXPECT_EQ(i % 2, map.count(nameFor(i))) << "entry " << i;
+  }
+
+  // Copies get their own index.
+  PathMap<int> copy = map;
+  EXPECT_TRUE(copy.isIndexed());
+  EXPECT_EQ(map, copy);
+  copy["newentry"_pc] = 7;
+  EXPECT_EQ(7, copy.at("newentry"_pc));
+  EXPECT_EQ(0, map.count("newentry"_pc));
+  EXPECT_NE(map, copy);
+
+  PathMap<int> moved = std::move(map);
+  EXPECT_EQ(kCount / 2, moved.size());
+  EXPECT_EQ(1, moved.at(nameFor(1)));
+
+  moved.clear();
+  EXPECT_TRUE(moved.empty());
+  EXPECT_FALSE(moved.isIndexed());
+}
@@ -141,6 +141,30 @@ TEST(proc_util, readMemoryStatsNoThrow) {
   EXPECT_FALSE(stats.has_value());
 }
 
+TEST(proc_util, parseMemoryPressure) {
+  auto pressure = parseMemoryPressure(
+      "some avg10=12.50 avg60=3.00 avg300=0.75 total=123456\n"
+      "full avg10=4.00 avg60=1.00 avg300=0.25 total=45678\n");
+  ASSERT_TRUE(pressure.has_value());
+  EXPECT_DOUBLE_EQ(12.5, *pressure);
+
+  EXPECT_FALSE(parseMemoryPressure(""));
+  EXPECT_FALSE(parseMemoryPressure("full avg10=4.00 avg60=1.00\n"));
+  EXPECT_FALSE(parseMemoryPressure("some avg10=abc avg60=1.00\n"));
+  EXPECT_FALSE(readMemoryPressure("/DOES_NOT_EXIST"));
+}
+
+TEST(proc_util, parseCgroupV2Path) {
+  EXPECT_EQ(
+      "/system.slice/edenfs.service",
+      parseCgroupV2Path("0::/system.slice/edenfs.service\n"));
+  EXPECT_EQ(
+      "/user.slice",
+      parseCgroupV2Path("12:memory:/user.slice/legacy\n0::/user.slice\n"));
+  EXPECT_FALSE(parseCgroupV2Path(""));
+  EXPECT_FALSE(parseCgroupV2Path("4:memory:/user.slice\n"));
+}
+
 TEST(proc_util, procSmapsPrivateBytes) {
   auto procPath = dataPath("ProcSmapsSimple.txt"_pc);
   std::ifstream input(procPath.c_str());
@@ -51,3 +51,19 @@ TEST(ProcessAccessLog, accessIncrementsAccessCount) {
 
   EXPECT_THAT(log.getAccessCounts(10s), Contains(std::pair{pid, ac}));
 }
+
+TEST(ProcessAccessLog, fetchesAccumulateByPid) {
+  auto pid = pid_t{42};
+  auto log = ProcessAccessLog{std::make_shared<ProcessNameCache>()};
+
+  log.recordFetches(pid, 2, 1000, 5ms);
+  log.recordFetches(pid, 1, 24, 1ms);
+  log.recordFetches(pid_t{43}, 1, 1, 1ms);
+
+  auto ac = AccessCounts{};
+  ac.fetchCount = 3;
+  ac.fetchBytes = 1024;
+  ac.fetchWaitNs = std::chrono::nanoseconds{6ms}.count();
+
+  EXPECT_THAT(log.getAccessCounts(10s), Contains(std::pair{pid, ac}));
+}
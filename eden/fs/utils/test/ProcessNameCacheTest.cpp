@@ -28,6 +28,15 @@ TEST(ProcessNameCache, readMyPidsName) {
   EXPECT_NE("", results[getpid()]);
 }
 
+TEST(ProcessNameCache, getCachedProcessNameAfterRead) {
+  ProcessNameCache processNameCache;
+  EXPECT_FALSE(processNameCache.getCachedProcessName(getpid()).has_value());
+  processNameCache.add(getpid());
+  // getAllProcessNames() waits for the pending name to be read.
+  auto results = processNameCache.getAllProcessNames();
+  EXPECT_EQ(results[getpid()], processNameCache.getCachedProcessName(getpid()));
+}
+
 TEST(ProcessNameCache, expireMyPidsName) {
   ProcessNameCache processNameCache{0ms};
   processNameCache.add(getpid());
@@ -52,3 +61,13 @@ TEST(ProcessNameCache, addFromMultipleThreads) {
   }
   EXPECT_EQ(1, results.size());
 }
+
+TEST(ProcessNameCache, addRepeatedlyFromOneThread) {
+  ProcessNameCache processNameCache;
+  for (int i = 0; i < 1000; ++i) {
+    processNameCache.add(getpid());
+  }
+  auto results = processNameCache.getAllProcessNames();
+  EXPECT_EQ(1, results.size());
+  EXPECT_NE("", results[getpid()]);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/ReadPatternTracker.h"
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+
+TEST(ReadPatternTrackerTest, starts_unknown) {
+  ReadPatternTracker t;
+  EXPECT_EQ(ReadPattern::Unknown, t.getPattern());
+  EXPECT_EQ(ReadPattern::Unknown, t.recordRead(4096, 4096));
+}
+
+TEST(ReadPatternTrackerTest, read_from_start_is_sequential) {
+  ReadPatternTracker t;
+  EXPECT_EQ(ReadPattern::Sequential, t.recordRead(0, 4096));
+  EXPECT_EQ(ReadPattern::Sequential, t.recordRead(4096, 4096));
+  EXPECT_EQ(ReadPattern::Sequential, t.recordRead(8192, 100));
+}
+
+TEST(ReadPatternTrackerTest, sequential_from_middle) {
+  ReadPatternTracker t;
+  t.recordRead(1000, 10);
+  EXPECT_EQ(ReadPattern::Sequential, t.recordRead(1010, 10));
+}
+
+TEST(ReadPatternTrackerTest, detects_strides) {
+  ReadPatternTracker t;
+  t.recordRead(0, 10);
+  t.recordRead(20, 10);
+  EXPECT_EQ(ReadPattern::Strided, t.recordRead(40, 10));
+  EXPECT_EQ(ReadPattern::Strided, t.recordRead(60, 10));
+}
+
+TEST(ReadPatternTrackerTest, one_out_of_order_read_keeps_pattern) {
+  ReadPatternTracker t;
+  t.recordRead(0, 4096);
+  t.recordRead(4096, 4096);
+  EXPECT_EQ(ReadPattern::Sequential, t.recordRead(16384, 4096));
+  EXPECT_EQ(ReadPattern::Sequential, t.recordRead(20480, 4096));
+}
+
+TEST(ReadPatternTrackerTest, detects_random_reads) {
+  ReadPatternTracker t;
+  t.recordRead(0, 4096);
+  t.recordRead(1 << 20, 4096);
+  EXPECT_EQ(ReadPattern::Random, t.recordRead(4096, 4096));
+  EXPECT_EQ(ReadPattern::Random, t.recordRead(1 << 30, 4096));
+}
+
+TEST(ReadPatternTrackerTest, random_reads_can_become_sequential) {
+  ReadPatternTracker t;
+  t.recordRead(500, 10);
+  EXPECT_EQ(ReadPattern::Random, t.recordRead(100, 10));
+  EXPECT_EQ(ReadPattern::Sequential, t.recordRead(110, 10));
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/UnboundedQueueExecutor.h"
+
+#include <folly/Synchronized.h>
+#include <folly/synchronization/Baton.h>
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace facebook::eden;
+
+TEST(UnboundedQueueExecutor, runsMoreUrgentLanesFirst) {
+  UnboundedQueueExecutor executor{1, "Test"};
+  EXPECT_EQ(3, executor.getNumPriorities());
+
+  // Keep the only thread busy until everything has been queued.
+  folly::Baton<> started;
+  folly::Baton<> release;
+  executor.add([&] {
+    started.post();
+    release.wait();
+  });
+  started.wait();
+
+  folly::Synchronized<std::vector<int>> order;
+  folly::Baton<> done;
+  executor.getBackgroundExecutor()->add([&] {
+    order.wlock()->push_back(0);
+    done.post();
+  });
+  executor.add([&] { order.wlock()->push_back(1); });
+  executor.addWithPriority(
+      [&] { order.wlock()->push_back(2); }, folly::Executor::HI_PRI);
+
+  release.post();
+  done.wait();
+  EXPECT_EQ((std::vector<int>{2, 1, 0}), *order.rlock());
+}
@@ -8,6 +8,7 @@
 #include "eden/fs/utils/UnixSocket.h"
 #include "eden/fs/utils/FutureUnixSocket.h"
 
+#include <folly/Conv.h>
 #include <folly/Exception.h>
 #include <folly/File.h>
 #include <folly/Random.h>
@@ -251,6 +252,74 @@ TEST(FutureUnixSocket, receiveQueue) {
   EXPECT_EQ(sendMessages.size(), receivedMessages.size());
 }
 
+TEST(FutureUnixSocket, manySmallMessagesWithFiles) {
+  auto sockets = createSocketPair();
+  EventBase evb;
+
+  auto socket1 = make_unique<FutureUnixSocket>(&evb, std::move(sockets.first));
+  auto socket2 = make_unique<FutureUnixSocket>(&evb, std::move(sockets.second));
+
+  auto tmpFile = makeTempFile();
+  struct stat tmpFileStat;
+  checkUnixError(fstat(tmpFile.fd(), &tmpFileStat), "fstat failed");
+
+  // Queue all of the messages before the event loop runs, so they are sent
+  // together and arrive together.  Every tenth message carries some files,
+  // and one carries more than fit in a single sendmsg() call.
+  constexpr size_t kNumMessages = 200;
+  auto numFilesFor = [](size_t n) -> size_t {
+    if (n == 50) {
+      return 300;
+    }
+    return n % 10 == 0 ? n / 10 + 1 : 0;
+  };
+  for (size_t n = 0; n < kNumMessages; ++n) {
+    std::vector<File> files;
+    for (size_t f = 0; f < numFilesFor(n); ++f) {
+      files.emplace_back(tmpFile.fd(), /* ownsFd */ false);
+    }
+    auto data = folly::to<std::string>("message ", n);
+    socket1
+        ->send(UnixSocket::Message(
+            IOBuf(IOBuf::COPY_BUFFER, data), std::move(files)))
+        .thenError([](const folly::exception_wrapper& ew) {
+          ADD_FAILURE() << "send error: " << ew.what();
+        });
+  }
+
+  std::vector<UnixSocket::Message> receivedMessages;
+  for (size_t n = 0; n < kNumMessages; ++n) {
+    auto future =
+        socket2->receive(1s)
+            .thenValue([&receivedMessages](UnixSocket::Message&& msg) {
+              receivedMessages.push_back(std::move(msg));
+            })
+            .thenError([n, &evb](const folly::exception_wrapper& ew) {
+              ADD_FAILURE() << "receive " << n << " error: " << ew.what();
+              evb.terminateLoopSoon();
+            });
+    if (n == kNumMessages - 1) {
+      std::move(future).ensure([&evb]() { evb.terminateLoopSoon(); });
+    }
+  }
+
+  evb.loopForever();
+
+  ASSERT_EQ(kNumMessages, receivedMessages.size());
+  for (size_t n = 0; n < kNumMessages; ++n) {
+    auto& msg = receivedMessages[n];
+    EXPECT_EQ(
+        folly::to<std::string>("message ", n),
+        StringPiece{msg.data.coalesce()});
+    ASSERT_EQ(numFilesFor(n), msg.files.size()) << "message " << n;
+    for (const auto& file : msg.files) {
+      struct stat receivedFileStat;
+      checkUnixError(fstat(file.fd(), &receivedFileStat), "fstat failed");
+      EXPECT_EQ(tmpFileStat.st_ino, receivedFileStat.st_ino);
+    }
+  }
+}
+
 TEST(FutureUnixSocket, attachEventBase) {
   // A helper function to attach sockets to an EventBase, send a message, then
   // detach from the EventBase
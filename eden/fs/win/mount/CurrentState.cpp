@@ -12,6 +12,7 @@
 #include "eden/fs/win/mount/StateDbNode.h"
 #include "eden/fs/win/store/WinStore.h"
 #include "eden/fs/win/utils/Guid.h"
+#include "eden/fs/win/utils/RegUtils.h"
 #include "eden/fs/win/utils/StringConv.h"
 #include "folly/logging/xlog.h"
 
@@ -24,84 +25,288 @@ namespace eden {
 #define LOG_STATE_CHANGE(fmt, ...) XLOGF(INFO, fmt, ##__VA_ARGS__)
 #endif
 
+namespace {
+constexpr folly::StringPiece kStateTable = "State";
+
+/**
+ * Adds the entries under the registry key for path, and everything below
+ * them, to entries.
+ */
+void readRegistryState(
+    const RegistryKey& rootKey,
+    const WinRelativePathW& path,
+    std::vector<std::pair<WinRelativePathW, StateDirectoryEntry>>& entries) {
+  StateDbNode dbNode{path, rootKey.openSubKey(path.c_str())};
+  for (auto& entry : dbNode.getDirectoryEntries()) {
+    auto childPath = path / entry.getName();
+    entries.emplace_back(childPath, std::move(entry));
+    readRegistryState(rootKey, childPath, entries);
+  }
+}
+} // namespace
+
 //
-// In the current design we could get away without any locking in this for two
-// reasons. First, all FS notifications are synchronous so file system will not
-// send us multiple notifications for the same file. Plus registry has its own
-// internal locking to protect its structure.
-//
-// Based on how it performs we might want to serialize the request in here.
-// Which could take care of both performance and atomicity.
+// Notifications for different files can arrive concurrently, so the tree is
+// locked.  Database writes only happen in flush(), which holds the database
+// lock while it takes its snapshot of the changes so that flushes are applied
+// in order.
 //
 
+CurrentState::CurrentState(
+    AbsolutePathPiece dbPath,
+    const std::wstring_view& registryRoot,
+    const std::wstring& mountId)
+    : db_{dbPath} {
+  {
+    auto db = db_.lock();
+    SqliteStatement(db, "PRAGMA journal_mode=WAL").step();
+    SqliteStatement(db, "PRAGMA synchronous=NORMAL").step();
+    SqliteStatement(
+        db,
+        "CREATE TABLE IF NOT EXISTS ",
+        kStateTable,
+        "(path BLOB NOT NULL PRIMARY KEY, info INTEGER NOT NULL, "
+        "hash BLOB NOT NULL)")
+        .step();
+  }
+  loadDatabase();
+  if (state_.rlock()->root.children.empty()) {
+    migrateFromRegistry(registryRoot, mountId);
+  }
+}
+
+CurrentState::~CurrentState() {
+  try {
+    flush();
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "failed to save the current state: " << ex.what();
+  }
+}
+
+void CurrentState::loadDatabase() {
+  auto db = db_.lock();
+  auto state = state_.wlock();
+  SqliteStatement stmt(db, "SELECT path, info, hash FROM ", kStateTable);
+  while (stmt.step()) {
+    auto path = edenToWinPath(stmt.columnBlob(0).str());
+    auto& node = recordNode(*state, path.c_str());
+    node.info = StateInfo{static_cast<DWORD>(stmt.columnUint64(1))};
+    auto hash = stmt.columnBlob(2);
+    if (node.info.hasHash) {
+      node.hash = Hash{folly::ByteRange{hash}};
+    }
+  }
+  // Everything was just read from the database.
+  state->dirty.clear();
+}
+
+void CurrentState::migrateFromRegistry(
+    const std::wstring_view& registryRoot,
+    const std::wstring& mountId) {
+  auto keyPath = WinRelativePathW(registryRoot) / mountId;
+  RegistryKey rootKey;
+  try {
+    rootKey = RegistryKey::openCurrentUser(keyPath.c_str());
+  } catch (const std::system_error& ex) {
+    if (ex.code().value() == ERROR_FILE_NOT_FOUND) {
+      return;
+    }
+    throw;
+  }
+
+  std::vector<std::pair<WinRelativePathW, StateDirectoryEntry>> entries;
+  readRegistryState(rootKey, L"", entries);
+  {
+    auto state = state_.wlock();
+    for (const auto& [path, entry] : entries) {
+      auto& node = recordNode(*state, path.c_str());
+      node.info = entry.getStateInfo();
+      if (entry.hasHash()) {
+        node.hash = entry.getHash();
+      }
+    }
+  }
+  flush();
+
+  XLOG(INFO) << "moved the state of " << entries.size()
+             << " entries from the registry to the database";
+  rootKey.deleteKey();
+}
+
+CurrentState::Node& CurrentState::recordNode(
+    State& state,
+    ConstWinRelativePathWPtr path,
+    bool* created) {
+  Node* node = &state.root;
+  WinRelativePathW canonicalPath;
+  bool isNew = false;
+  for (const auto& component : WinRelativePathW(path)) {
+    auto [it, inserted] = node->children.try_emplace(component.wstring());
+    // Keep the case the name was first recorded with.
+    canonicalPath /= it->first;
+    node = &it->second;
+    isNew = inserted;
+  }
+  if (created) {
+    *created = isNew;
+  }
+  if (node != &state.root) {
+    state.dirty.insert(canonicalPath.wstring());
+  }
+  return *node;
+}
+
+void CurrentState::maybeFlush(folly::Synchronized<State>::LockedPtr state) {
+  if (state->dirty.size() < kFlushThreshold) {
+    return;
+  }
+  state.unlock();
+  flush();
+}
+
+void CurrentState::flush() {
+  struct Row {
+    std::string path;
+    StateInfo info;
+    Hash hash;
+  };
+
+  auto db = db_.lock();
+  std::vector<Row> rows;
+  {
+    auto state = state_.wlock();
+    if (state->dirty.empty()) {
+      return;
+    }
+    rows.reserve(state->dirty.size());
+    for (const auto& path : state->dirty) {
+      const Node* node = &state->root;
+      for (const auto& component : WinRelativePathW(path)) {
+        node = &node->children.at(component.wstring());
+      }
+      rows.push_back(Row{winToEdenPath(path), node->info, node->hash});
+    }
+    state->dirty.clear();
+  }
+
+  SqliteStatement(db, "BEGIN").step();
+  try {
+    SqliteStatement save(
+        db, "INSERT OR REPLACE INTO ", kStateTable, " VALUES(?, ?, ?)");
+    for (const auto& row : rows) {
+      save.bind(1, folly::StringPiece{row.path});
+      save.bind(2, static_cast<uint32_t>(row.info.toDWord()));
+      // Entries without a hash store zeroes, which are ignored on load.
+      save.bind(3, row.hash.getBytes());
+      save.step();
+      save.reset();
+    }
+    SqliteStatement(db, "COMMIT").step();
+  } catch (const std::exception&) {
+    SqliteStatement(db, "ROLLBACK").step();
+    throw;
+  }
+}
+
+std::vector<StateDirectoryEntry> CurrentState::getDirectoryEntries(
+    const WinRelativePathW& path) const {
+  auto parent = std::make_shared<WinRelativePathW>(path);
+  std::vector<StateDirectoryEntry> entries;
+
+  auto state = state_.rlock();
+  const Node* node = &state->root;
+  for (const auto& component : path) {
+    auto it = node->children.find(component.wstring());
+    if (it == node->children.end()) {
+      return entries;
+    }
+    node = &it->second;
+  }
+
+  entries.reserve(node->children.size());
+  for (const auto& [name, child] : node->children) {
+    if (child.info.hasHash) {
+      entries.emplace_back(parent, name, child.info, child.hash);
+    } else {
+      entries.emplace_back(parent, name, child.info);
+    }
+  }
+  return entries;
+}
+
 void CurrentState::entryCreated(
     ConstWinRelativePathWPtr path,
     const FileMetadata& metadata) {
   DCHECK(std::filesystem::path(path).filename() == metadata.name);
 
-  DWORD disposition;
-  StateDbNode dbNode{path, rootKey_.create(path, KEY_ALL_ACCESS, &disposition)};
-  // Either it's a new key or the state was deleted
-  DCHECK(
-      (disposition == REG_CREATED_NEW_KEY) ||
-      (dbNode.getEntryState() == EntryState::REMOVED));
+  auto state = state_.wlock();
+  bool created;
+  auto& node = recordNode(*state, path, &created);
+  // Either it's a new entry or the state was deleted
+  DCHECK(created || (node.info.entryState == EntryState::REMOVED));
 
-  if ((dbNode.getEntryState() != EntryState::REMOVED)) {
+  if ((node.info.entryState != EntryState::REMOVED)) {
     //
     // Sometimes Prjfs calls getFileInfo to fetch the file details even when it
     // is deleted. We have seen mostly in rename calls where the deleted file is
     // a dest. Not updating our structures in that case.
     //
     LOG_STATE_CHANGE("{} NONE -> CREATED", winToEdenPath(path));
-    dbNode.setEntryState(EntryState::CREATED);
-    dbNode.setIsDirectory(metadata.isDirectory);
-    dbNode.setHash(metadata.hash);
+    node.info.entryState = EntryState::CREATED;
+    node.info.isDirectory = metadata.isDirectory ? 1 : 0;
+    node.info.hasHash = 1;
+    node.hash = metadata.hash;
   }
+  maybeFlush(std::move(state));
 }
 
 void CurrentState::entryLoaded(ConstWinRelativePathWPtr path) {
-  StateDbNode dbNode{path, rootKey_.openSubKey(path)};
-  DCHECK(dbNode.isDirectory() == false);
+  auto state = state_.wlock();
+  auto& node = recordNode(*state, path);
+  DCHECK(node.info.isDirectory == 0);
 
   LOG_STATE_CHANGE(
       "{} {} -> LOADED",
       winToEdenPath(path),
-      entryStateCodeToString(dbNode.getEntryState()));
+      entryStateCodeToString(node.info.entryState));
 
-  dbNode.setEntryState(EntryState::LOADED);
+  node.info.entryState = EntryState::LOADED;
+  maybeFlush(std::move(state));
 }
 
 void CurrentState::fileCreated(
     ConstWinRelativePathWPtr path,
     bool isDirectory) {
-  DWORD disposition;
-  StateDbNode dbNode{path, rootKey_.create(path, KEY_ALL_ACCESS, &disposition)};
+  auto state = state_.wlock();
+  bool created;
+  auto& node = recordNode(*state, path, &created);
 
-  // Either it's a new key or the state was deleted
-  DCHECK(
-      (disposition == REG_CREATED_NEW_KEY) ||
-      (dbNode.getEntryState() == EntryState::REMOVED));
+  // Either it's a new entry or the state was deleted
+  DCHECK(created || (node.info.entryState == EntryState::REMOVED));
 
   LOG_STATE_CHANGE("{} NONE -> MATERIALIZED", winToEdenPath(path));
 
-  dbNode.setEntryState(EntryState::MATERIALIZED);
-  dbNode.setIsDirectory(isDirectory);
-  dbNode.resetHash();
+  node.info.entryState = EntryState::MATERIALIZED;
+  node.info.isDirectory = isDirectory ? 1 : 0;
+  node.info.hasHash = 0;
+  maybeFlush(std::move(state));
 }
 
 void CurrentState::fileModified(
     ConstWinRelativePathWPtr path,
     bool isDirectory) {
-  StateDbNode dbNode{path, rootKey_.openSubKey(path)};
+  auto state = state_.wlock();
+  auto& node = recordNode(*state, path);
 
-  DCHECK_EQ(dbNode.isDirectory(), isDirectory);
+  DCHECK_EQ(node.info.isDirectory != 0, isDirectory);
 
   LOG_STATE_CHANGE(
       "{} {} -> MATERIALIZED",
       winToEdenPath(path),
-      entryStateCodeToString(dbNode.getEntryState()));
+      entryStateCodeToString(node.info.entryState));
 
-  dbNode.setEntryState(EntryState::MATERIALIZED);
+  node.info.entryState = EntryState::MATERIALIZED;
+  maybeFlush(std::move(state));
 }
 
 void CurrentState::fileRenamed(
@@ -117,14 +322,17 @@ void CurrentState::fileRenamed(
 void CurrentState::fileRemoved(
     ConstWinRelativePathWPtr path,
     bool isDirectory) {
-  StateDbNode dbNode{path, rootKey_.openSubKey(path)};
+  auto state = state_.wlock();
+  auto& node = recordNode(*state, path);
 
   LOG_STATE_CHANGE(
       "{} {} -> REMOVED",
       winToEdenPath(path),
-      entryStateCodeToString(dbNode.getEntryState()));
+      entryStateCodeToString(node.info.entryState));
 
-  dbNode.setEntryState(EntryState::REMOVED);
+  node.info.wasDeleted = 1;
+  node.info.entryState = EntryState::REMOVED;
+  maybeFlush(std::move(state));
 }
 
 } // namespace eden
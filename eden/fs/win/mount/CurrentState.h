@@ -7,8 +7,15 @@
 
 #pragma once
 
-#include "eden/fs/win/mount/StateDbNode.h"
-#include "eden/fs/win/utils/RegUtils.h"
+#include <folly/Synchronized.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "eden/fs/sqlite/Sqlite.h"
+#include "eden/fs/utils/PathFuncs.h"
+#include "eden/fs/win/mount/StateDirectoryEntry.h"
 #include "eden/fs/win/utils/StringConv.h"
 
 namespace facebook {
@@ -17,20 +24,33 @@ namespace eden {
 /**
  * CurrentState is top level interface for recording the notifications to
  * replicate the cache state in the internal db in usermode.
+ *
+ * The state is kept as an in-memory tree, so recording a notification and
+ * walking the state for status never touch the disk.  Changes are written to
+ * a sqlite database in batches of kFlushThreshold paths, and when the
+ * CurrentState is flushed or destroyed.
+ *
+ * All methods are thread-safe.
  */
 class CurrentState {
  public:
   /**
-   * root is the regdb root path to the eden current state data.
+   * dbPath is the sqlite database holding the state of this mount.
    *
-   * mountId is a unique identifier for this mount. This need to be same across
-   * restarts.
+   * registryRoot and mountId name the registry key that older versions
+   * recorded the state under.  The first time a mount's database is created,
+   * the contents of that key are moved into it and the key is deleted.
    */
-  explicit CurrentState(
-      const std::wstring_view& root,
-      const std::wstring& mountId)
-      : path_{WinRelativePathW(root) / mountId},
-        rootKey_{RegistryKey::create(HKEY_CURRENT_USER, path_.c_str())} {}
+  CurrentState(
+      AbsolutePathPiece dbPath,
+      const std::wstring_view& registryRoot,
+      const std::wstring& mountId);
+
+  CurrentState(const CurrentState&) = delete;
+  CurrentState& operator=(const CurrentState&) = delete;
+
+  /** Writes any unflushed changes to the database. */
+  ~CurrentState();
 
   /**
    * entryCreated is to record the Prjfs's meatadata request. This takes path of
@@ -73,22 +93,61 @@ class CurrentState {
   void fileRemoved(ConstWinRelativePathWPtr path, bool isDirectory);
 
   /**
-   * API to get the StateDbNode for the relative path of a file.
+   * Returns the recorded state of every entry in the directory at path,
+   * ordered by name like the registry enumerated them.
    */
-  [[nodiscard]] StateDbNode getDbNode(const WinRelativePathW& path) const {
-    return StateDbNode{path, rootKey_.openSubKey(path.c_str())};
-  }
+  [[nodiscard]] std::vector<StateDirectoryEntry> getDirectoryEntries(
+      const WinRelativePathW& path) const;
+
+  /** Writes all recorded changes to the database. */
+  void flush();
+
+  /** The number of changed paths that triggers a write to the database. */
+  static constexpr size_t kFlushThreshold = 1024;
 
  private:
-  /**
-   * path_ is the registry path to record Eden repo data.
-   */
-  const WinRelativePathW path_;
+  /** Names are case insensitive, as they were in the registry. */
+  struct NameLess {
+    bool operator()(const std::wstring& a, const std::wstring& b) const {
+      return _wcsicmp(a.c_str(), b.c_str()) < 0;
+    }
+  };
+
+  struct Node {
+    StateInfo info;
+    Hash hash;
+    std::map<std::wstring, Node, NameLess> children;
+  };
+
+  struct State {
+    Node root;
+
+    /**
+     * The paths, with the case of their first recording, whose state changed
+     * since the last flush.
+     */
+    std::unordered_set<std::wstring> dirty;
+  };
 
   /**
-   * This is the registry key object for the quick access to the data.
+   * Returns the node for path, creating it and any missing parents, and
+   * marks it changed.  created is set if the node itself did not exist.
    */
-  RegistryKey rootKey_;
+  static Node& recordNode(
+      State& state,
+      ConstWinRelativePathWPtr path,
+      bool* created = nullptr);
+
+  /** Flushes if enough changes have accumulated since the last flush. */
+  void maybeFlush(folly::Synchronized<State>::LockedPtr state);
+
+  void loadDatabase();
+  void migrateFromRegistry(
+      const std::wstring_view& registryRoot,
+      const std::wstring& mountId);
+
+  SqliteDatabase db_;
+  folly::Synchronized<State> state_;
 };
 
 } // namespace eden
@@ -11,6 +11,7 @@
 #include <folly/logging/xlog.h>
 #include "ProjectedFSLib.h"
 #include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/service/EdenError.h"
@@ -38,8 +39,13 @@ struct PrjAlignedBufferDeleter {
 constexpr uint32_t kMinChunkSize = 512 * 1024; // 512 KB
 constexpr uint32_t kMaxChunkSize = 5 * 1024 * 1024; // 5 MB
 
+// Number of sorted directory listings kept for source control Trees.
+constexpr size_t kEnumerationCacheSize = 1024;
+
 EdenDispatcher::EdenDispatcher(EdenMount& mount)
-    : mount_{mount}, winStore_{mount} {
+    : mount_{mount},
+      winStore_{mount},
+      enumerationCache_{folly::in_place, kEnumerationCacheSize} {
   XLOGF(
       INFO,
       "Creating Dispatcher mount (0x{:x}) root ({}) dispatcher (0x{:x})",
@@ -52,7 +58,6 @@ HRESULT EdenDispatcher::startEnumeration(
     const PRJ_CALLBACK_DATA& callbackData,
     const GUID& enumerationId) noexcept {
   try {
-    std::vector<FileMetadata> list;
     wstring path{callbackData.FilePathName};
 
     XLOGF(
@@ -64,12 +69,12 @@ HRESULT EdenDispatcher::startEnumeration(
         wideToMultibyteString(callbackData.TriggeringProcessImageFileName));
 
     auto relPath = wideCharToEdenRelativePath(path);
-    getMount().enumerateDirectory(relPath.piece(), list);
+    auto snapshot = getEnumerationSnapshot(relPath.piece());
 
     auto [iterator, inserted] = enumSessions_.wlock()->emplace(
         enumerationId,
         make_unique<Enumerator>(
-            enumerationId, std::move(path), std::move(list)));
+            enumerationId, std::move(path), std::move(snapshot)));
     DCHECK(inserted);
     return S_OK;
   } catch (const std::exception&) {
@@ -77,6 +82,31 @@ HRESULT EdenDispatcher::startEnumeration(
   }
 }
 
+EnumerationSnapshot EdenDispatcher::getEnumerationSnapshot(
+    RelativePathPiece path) {
+  auto treeInode = getMount().getInode(path).get().asTreePtr();
+
+  // A directory that still matches its source control Tree lists exactly
+  // the Tree's entries, so the sorted listing can be shared by every
+  // enumeration of that Tree, in this directory or any other.
+  auto treeHash = treeInode->getContents().rlock()->treeHash;
+  if (treeHash.has_value()) {
+    auto cache = enumerationCache_.wlock();
+    auto it = cache->find(treeHash.value());
+    if (it != cache->end()) {
+      return it->second;
+    }
+  }
+
+  std::vector<FileMetadata> list;
+  auto listedHash = treeInode->readdir(list);
+  auto snapshot = makeEnumerationSnapshot(std::move(list));
+  if (listedHash.has_value()) {
+    enumerationCache_.wlock()->set(listedHash.value(), snapshot);
+  }
+  return snapshot;
+}
+
 void EdenDispatcher::endEnumeration(const GUID& enumerationId) noexcept {
   try {
     auto erasedCount = enumSessions_.wlock()->erase(enumerationId);
@@ -225,74 +255,122 @@ EdenDispatcher::getFileData(
     uint64_t byteOffset,
     uint32_t length) noexcept {
   try {
-    //
-    // We should return file data which is smaller than
-    // our kMaxChunkSize and meets the memory alignment requirements
-    // of the virtualization instance's storage device.
-    //
-    auto blob = winStore_.getBlob(callbackData.FilePathName);
-    if (!blob) {
-      return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    auto blobFuture = winStore_.getBlobAsync(callbackData.FilePathName);
+    if (blobFuture.isReady()) {
+      return writeFileData(
+          callbackData.NamespaceVirtualizationContext,
+          callbackData.DataStreamId,
+          std::move(blobFuture).get(),
+          byteOffset,
+          length);
     }
 
-    const folly::IOBuf& iobuf = blob->getContents();
     //
-    // Assuming that it will not be a chain of IOBUFs.
-    // TODO: The following assert fails - need to dig more into IOBuf.
-    // assert(iobuf.next() == nullptr);
+    // The blob has to be fetched, which may mean going to the network. Don't
+    // tie up the ProjectedFS callback thread meanwhile: finish the request
+    // with PrjCompleteCommand once the blob arrives. The continuation must not
+    // use the dispatcher, which may be gone by then.
     //
+    auto context = callbackData.NamespaceVirtualizationContext;
+    auto dataStreamId = callbackData.DataStreamId;
+    auto commandId = callbackData.CommandId;
+    std::move(blobFuture)
+        .thenTry([context, dataStreamId, commandId, byteOffset, length](
+                     folly::Try<std::shared_ptr<const Blob>>&& blob) {
+          HRESULT result;
+          try {
+            result = writeFileData(
+                context, dataStreamId, blob.value(), byteOffset, length);
+          } catch (const std::exception&) {
+            result = exceptionToHResult();
+          }
+          HRESULT completeResult =
+              PrjCompleteCommand(context, commandId, result, nullptr);
+          if (FAILED(completeResult)) {
+            XLOGF(
+                DBG2,
+                "Failed to complete the file data request {} error {}",
+                commandId,
+                win32ErrorToString(completeResult));
+          }
+        });
+    return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
+  } catch (const std::exception&) {
+    return exceptionToHResult();
+  }
+}
 
-    if (iobuf.length() <= kMinChunkSize) {
-      //
-      // If the file is small - copy the whole file in one shot.
-      //
-      return readSingleFileChunk(
-          callbackData.NamespaceVirtualizationContext,
-          callbackData.DataStreamId,
-          iobuf,
-          /*startOffset=*/0,
-          /*writeLength=*/iobuf.length());
-
-    } else if (length <= kMaxChunkSize) {
-      //
-      // If the request is with in our kMaxChunkSize - copy the entire request.
-      //
-      return readSingleFileChunk(
-          callbackData.NamespaceVirtualizationContext,
-          callbackData.DataStreamId,
-          iobuf,
-          /*startOffset=*/byteOffset,
-          /*writeLength=*/length);
-    } else {
-      //
-      // When the request is larger than kMaxChunkSize we split the
-      // request into multiple chunks.
-      //
-      PRJ_VIRTUALIZATION_INSTANCE_INFO instanceInfo;
-      HRESULT result = PrjGetVirtualizationInstanceInfo(
-          callbackData.NamespaceVirtualizationContext, &instanceInfo);
-
-      if (FAILED(result)) {
-        return result;
-      }
+HRESULT
+EdenDispatcher::writeFileData(
+    PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT namespaceVirtualizationContext,
+    const GUID& dataStreamId,
+    const std::shared_ptr<const Blob>& blob,
+    uint64_t byteOffset,
+    uint32_t length) {
+  //
+  // We should return file data which is smaller than
+  // our kMaxChunkSize and meets the memory alignment requirements
+  // of the virtualization instance's storage device.
+  //
+  if (!blob) {
+    return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+  }
 
-      uint64_t startOffset = byteOffset;
-      uint64_t endOffset = BlockAlignTruncate(
-          startOffset + kMaxChunkSize, instanceInfo.WriteAlignment);
-      DCHECK(endOffset > 0);
-      DCHECK(endOffset > startOffset);
+  const folly::IOBuf& iobuf = blob->getContents();
+  //
+  // Assuming that it will not be a chain of IOBUFs.
+  // TODO: The following assert fails - need to dig more into IOBuf.
+  // assert(iobuf.next() == nullptr);
+  //
 
-      uint32_t chunkSize = endOffset - startOffset;
-      return readMultipleFileChunks(
-          callbackData.NamespaceVirtualizationContext,
-          callbackData.DataStreamId,
-          iobuf,
-          /*startOffset=*/startOffset,
-          /*length=*/length,
-          /*chunkSize=*/chunkSize);
+  if (iobuf.length() <= kMinChunkSize) {
+    //
+    // If the file is small - copy the whole file in one shot.
+    //
+    return readSingleFileChunk(
+        namespaceVirtualizationContext,
+        dataStreamId,
+        iobuf,
+        /*startOffset=*/0,
+        /*writeLength=*/iobuf.length());
+
+  } else if (length <= kMaxChunkSize) {
+    //
+    // If the request is with in our kMaxChunkSize - copy the entire request.
+    //
+    return readSingleFileChunk(
+        namespaceVirtualizationContext,
+        dataStreamId,
+        iobuf,
+        /*startOffset=*/byteOffset,
+        /*writeLength=*/length);
+  } else {
+    //
+    // When the request is larger than kMaxChunkSize we split the
+    // request into multiple chunks.
+    //
+    PRJ_VIRTUALIZATION_INSTANCE_INFO instanceInfo;
+    HRESULT result = PrjGetVirtualizationInstanceInfo(
+        namespaceVirtualizationContext, &instanceInfo);
+
+    if (FAILED(result)) {
+      return result;
     }
-  } catch (const std::exception&) {
-    return exceptionToHResult();
+
+    uint64_t startOffset = byteOffset;
+    uint64_t endOffset = BlockAlignTruncate(
+        startOffset + kMaxChunkSize, instanceInfo.WriteAlignment);
+    DCHECK(endOffset > 0);
+    DCHECK(endOffset > startOffset);
+
+    uint32_t chunkSize = endOffset - startOffset;
+    return readMultipleFileChunks(
+        namespaceVirtualizationContext,
+        dataStreamId,
+        iobuf,
+        /*startOffset=*/startOffset,
+        /*length=*/length,
+        /*chunkSize=*/chunkSize);
   }
 }
 
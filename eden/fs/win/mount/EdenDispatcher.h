@@ -18,6 +18,7 @@
 #include "eden/fs/win/store/WinStore.h"
 #include "eden/fs/win/utils/Guid.h"
 #include "folly/Synchronized.h"
+#include "folly/container/EvictingCacheMap.h"
 
 constexpr uint32_t kDispatcherCode = 0x1155aaff;
 
@@ -70,7 +71,24 @@ class EdenDispatcher {
   }
 
  private:
-  HRESULT
+  /**
+   * Returns the sorted entries of the directory at path, reusing the cached
+   * listing of its source control Tree when it is not materialized.
+   */
+  EnumerationSnapshot getEnumerationSnapshot(RelativePathPiece path);
+
+  /**
+   * Writes the range ProjectedFS asked for from blob, which is nullptr if the
+   * file does not exist.
+   */
+  static HRESULT writeFileData(
+      PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT namespaceVirtualizationContext,
+      const GUID& dataStreamId,
+      const std::shared_ptr<const Blob>& blob,
+      uint64_t byteOffset,
+      uint32_t length);
+
+  static HRESULT
   readSingleFileChunk(
       PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT namespaceVirtualizationContext,
       const GUID& dataStreamId,
@@ -78,7 +96,7 @@ class EdenDispatcher {
       uint64_t startOffset,
       uint32_t writeLength);
 
-  HRESULT
+  static HRESULT
   readMultipleFileChunks(
       PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT namespaceVirtualizationContext,
       const GUID& dataStreamId,
@@ -104,6 +122,13 @@ class EdenDispatcher {
   folly::Synchronized<std::map<GUID, std::unique_ptr<Enumerator>, CompareGuid>>
       enumSessions_;
 
+  //
+  // Sorted listings of unmaterialized directories, keyed by the hash of their
+  // source control Tree.
+  //
+  folly::Synchronized<folly::EvictingCacheMap<Hash, EnumerationSnapshot>>
+      enumerationCache_;
+
   const uint32_t verificationCode_ = kDispatcherCode;
 };
 
@@ -14,31 +14,35 @@
 namespace facebook {
 namespace eden {
 
-Enumerator::Enumerator(
-    const GUID& enumerationId,
-    const std::wstring& path,
-    std::vector<FileMetadata> entryList)
-    : path_(path), metadataList_(std::move(entryList)) {
+EnumerationSnapshot makeEnumerationSnapshot(
+    std::vector<FileMetadata> entries) {
   std::sort(
-      metadataList_.begin(),
-      metadataList_.end(),
+      entries.begin(),
+      entries.end(),
       [](const FileMetadata& first, const FileMetadata& second) -> bool {
         return (
             PrjFileNameCompare(first.name.c_str(), second.name.c_str()) < 0);
       });
+  return std::make_shared<const std::vector<FileMetadata>>(std::move(entries));
 }
 
+Enumerator::Enumerator(
+    const GUID& enumerationId,
+    std::wstring path,
+    EnumerationSnapshot snapshot)
+    : path_(std::move(path)), metadataList_(std::move(snapshot)) {}
+
 const FileMetadata* Enumerator::current() {
-  for (; listIndex_ < metadataList_.size(); listIndex_++) {
+  auto& entries = *metadataList_;
+  for (; listIndex_ < entries.size(); listIndex_++) {
     if (PrjFileNameMatch(
-            metadataList_[listIndex_].name.c_str(),
-            searchExpression_.c_str())) {
+            entries[listIndex_].name.c_str(), searchExpression_.c_str())) {
       //
       // Don't increment the index here because we don't know if the caller
       // would be able to use this. The caller should instead call advance() on
       // success.
       //
-      return &metadataList_[listIndex_];
+      return &entries[listIndex_];
     }
   }
   return nullptr;
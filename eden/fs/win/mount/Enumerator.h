@@ -9,6 +9,7 @@
 
 #include "folly/portability/Windows.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -18,6 +19,18 @@ namespace eden {
 class WinStore;
 struct FileMetadata;
 
+/**
+ * The entries of a directory, sorted in ProjectedFS order. A snapshot is
+ * immutable once built, so it can be shared by every enumeration session of
+ * the same source control Tree.
+ */
+using EnumerationSnapshot = std::shared_ptr<const std::vector<FileMetadata>>;
+
+/**
+ * Sorts entries with PrjFileNameCompare and wraps them in a snapshot.
+ */
+EnumerationSnapshot makeEnumerationSnapshot(std::vector<FileMetadata> entries);
+
 class Enumerator {
  public:
   Enumerator(const Enumerator&) = delete;
@@ -25,8 +38,8 @@ class Enumerator {
 
   Enumerator(
       const GUID& enumerationId,
-      const std::wstring& path,
-      std::vector<FileMetadata> entryList);
+      std::wstring path,
+      EnumerationSnapshot snapshot);
 
   explicit Enumerator() = delete;
 
@@ -51,7 +64,7 @@ class Enumerator {
  private:
   std::wstring path_;
   std::wstring searchExpression_;
-  std::vector<FileMetadata> metadataList_;
+  EnumerationSnapshot metadataList_;
 
   //
   // use the listIndex_ to return entries when the enumeration is done over
@@ -7,6 +7,12 @@
 
 #pragma once
 
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+
 namespace facebook {
 namespace eden {
 
@@ -22,6 +28,40 @@ class FsChannel {
 
   virtual void removeCachedFile(const wchar_t* path) = 0;
   virtual void removeDeletedFile(const wchar_t* path) = 0;
+
+  /**
+   * A cached file or directory that a checkout changed. If the new size and
+   * hash of a file are known, its placeholder can be updated in place;
+   * otherwise it is removed from the cache like removeCachedFile() does.
+   */
+  struct CachedFileUpdate {
+    std::wstring path;
+    std::optional<uint64_t> size;
+    Hash hash;
+  };
+
+  /**
+   * Applies many cache updates, returning once all of them are done.
+   */
+  virtual void updateCachedFiles(const std::vector<CachedFileUpdate>& updates) {
+    for (const auto& update : updates) {
+      removeCachedFile(update.path.c_str());
+    }
+  }
+
+  struct Placeholder {
+    std::wstring path;
+    bool isDirectory{false};
+    uint64_t size{0};
+  };
+
+  /**
+   * Creates placeholders ahead of time, so that accessing them later does not
+   * have to ask for their metadata one at a time. Paths that are already
+   * cached are left alone.
+   */
+  virtual void writePlaceholders(
+      const std::vector<Placeholder>& /* placeholders */) {}
 };
 
 } // namespace eden
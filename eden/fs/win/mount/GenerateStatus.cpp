@@ -69,8 +69,7 @@ GenerateStatus::markAllFsSubEntriesAdded(
     const WinRelativePathW& currentPath,
     DiffCallback* callback,
     const StateDirectoryEntry& dirEntry) {
-  StateDbNode dirNode = currentState()->getDbNode(currentPath);
-  auto subDirectoryEntries = dirNode.getDirectoryEntries();
+  auto subDirectoryEntries = currentState()->getDirectoryEntries(currentPath);
   WinRelativePathW childPath;
   std::vector<FOLLY_NODISCARD folly::Future<folly::Unit>> futures;
 
@@ -186,8 +185,7 @@ FOLLY_NODISCARD folly::Future<folly::Unit> GenerateStatus::compute(
     const WinRelativePathW& path,
     const std::shared_ptr<const Tree>& tree,
     DiffCallback* callback) {
-  const auto dirNode = currentState()->getDbNode(path);
-  const auto dirEntries = dirNode.getDirectoryEntries();
+  const auto dirEntries = currentState()->getDirectoryEntries(path);
   std::vector<folly::Future<folly::Unit>> futures;
 
   for (const auto& dirEntry : dirEntries) {
@@ -231,8 +229,7 @@ FOLLY_NODISCARD folly::Future<folly::Unit> GenerateStatus::computeCompareBoth(
     const std::shared_ptr<const Tree>& tree,
     DiffCallback* callback) {
   CHECK(tree);
-  const auto dirNode = currentState()->getDbNode(path);
-  const auto dirEntries = dirNode.getDirectoryEntries();
+  const auto dirEntries = currentState()->getDirectoryEntries(path);
   std::vector<folly::Future<folly::Unit>> futures;
 
   const auto& scmEntries = tree->getTreeEntries();
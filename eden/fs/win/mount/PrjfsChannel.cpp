@@ -8,9 +8,16 @@
 #include "PrjfsChannel.h"
 #include "folly/portability/Windows.h"
 
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
+#include <algorithm>
+#include <cstring>
 #include <string>
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/inodes/ServerState.h"
 #include "eden/fs/win/mount/EdenDispatcher.h"
 #include "eden/fs/win/utils/Guid.h"
 #include "eden/fs/win/utils/StringConv.h"
@@ -21,11 +28,51 @@ using folly::sformat;
 namespace facebook {
 namespace eden {
 
+namespace {
+constexpr PRJ_UPDATE_TYPES kUpdateAnyState = PRJ_UPDATE_ALLOW_DIRTY_METADATA |
+    PRJ_UPDATE_ALLOW_DIRTY_DATA | PRJ_UPDATE_ALLOW_READ_ONLY |
+    PRJ_UPDATE_ALLOW_TOMBSTONE;
+
+/**
+ * Calls func on every item, with the items split into one chunk per thread of
+ * executor, and waits for all of them.
+ */
+template <typename T, typename Func>
+void forEachOnExecutor(
+    folly::Executor* executor,
+    size_t threads,
+    const std::vector<T>& items,
+    const Func& func) {
+  if (items.empty()) {
+    return;
+  }
+  auto chunkSize = (items.size() + threads - 1) / threads;
+  std::vector<folly::Future<folly::Unit>> futures;
+  for (size_t start = 0; start < items.size(); start += chunkSize) {
+    auto end = std::min(start + chunkSize, items.size());
+    futures.push_back(folly::via(executor, [&items, &func, start, end] {
+      for (auto i = start; i < end; ++i) {
+        func(items[i]);
+      }
+    }));
+  }
+  folly::collectAll(std::move(futures)).wait();
+}
+} // namespace
+
 PrjfsChannel::PrjfsChannel(EdenMount* mount)
     : mount_{mount},
       dispatcher_{*mount},
       mountId_{Guid::generate()},
-      winPath_{edenToWinPath(mount->getPath().value())} {
+      winPath_{edenToWinPath(mount->getPath().value())},
+      updateThreads_{std::max<size_t>(
+          1,
+          mount->getServerState()
+              ->getEdenConfig()
+              ->prjfsUpdateThreads.getValue())},
+      updateExecutor_{std::make_unique<folly::CPUThreadPoolExecutor>(
+          updateThreads_,
+          std::make_shared<folly::NamedThreadFactory>("PrjfsUpdate"))} {
   XLOG(INFO) << sformat(
       "Creating PrjfsChannel, mount ({}), MountPath ({})",
       mount,
@@ -217,15 +264,87 @@ void PrjfsChannel::deleteFile(
 }
 
 void PrjfsChannel::removeCachedFile(const wchar_t* path) {
-  deleteFile(
-      path,
-      PRJ_UPDATE_ALLOW_DIRTY_METADATA | PRJ_UPDATE_ALLOW_DIRTY_DATA |
-          PRJ_UPDATE_ALLOW_READ_ONLY | PRJ_UPDATE_ALLOW_TOMBSTONE);
+  deleteFile(path, kUpdateAnyState);
 }
 
 void PrjfsChannel::removeDeletedFile(const wchar_t* path) {
   deleteFile(path, PRJ_UPDATE_ALLOW_TOMBSTONE);
 }
 
+bool PrjfsChannel::updatePlaceholder(const CachedFileUpdate& update) {
+  PRJ_PLACEHOLDER_INFO placeholderInfo = {};
+  placeholderInfo.FileBasicInfo.IsDirectory = false;
+  placeholderInfo.FileBasicInfo.FileSize = update.size.value();
+  // Record the blob hash as the content id, so the updated placeholder does
+  // not look like the one it replaces.
+  auto hashBytes = update.hash.getBytes();
+  memcpy(
+      placeholderInfo.VersionInfo.ContentID,
+      hashBytes.data(),
+      std::min<size_t>(hashBytes.size(), PRJ_PLACEHOLDER_ID_LENGTH));
+
+  PRJ_UPDATE_FAILURE_CAUSES failureReason;
+  HRESULT hr = PrjUpdateFileIfNeeded(
+      mountChannel_,
+      update.path.c_str(),
+      &placeholderInfo,
+      sizeof(placeholderInfo),
+      kUpdateAnyState,
+      &failureReason);
+  if (hr == S_OK || hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) ||
+      hr == HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND)) {
+    // Files that were never cached will get their new placeholder info when
+    // they are first accessed.
+    return true;
+  }
+  XLOGF(
+      DBG6,
+      "Failed to update placeholder {} reason: {} error: {}",
+      winToEdenPath(update.path),
+      static_cast<uint32_t>(failureReason),
+      hr);
+  return false;
+}
+
+void PrjfsChannel::updateCachedFiles(
+    const std::vector<CachedFileUpdate>& updates) {
+  forEachOnExecutor(
+      updateExecutor_.get(),
+      updateThreads_,
+      updates,
+      [this](const CachedFileUpdate& update) {
+        if (update.size.has_value() && updatePlaceholder(update)) {
+          return;
+        }
+        removeCachedFile(update.path.c_str());
+      });
+}
+
+void PrjfsChannel::writePlaceholders(
+    const std::vector<Placeholder>& placeholders) {
+  forEachOnExecutor(
+      updateExecutor_.get(),
+      updateThreads_,
+      placeholders,
+      [this](const Placeholder& placeholder) {
+        PRJ_PLACEHOLDER_INFO placeholderInfo = {};
+        placeholderInfo.FileBasicInfo.IsDirectory = placeholder.isDirectory;
+        placeholderInfo.FileBasicInfo.FileSize = placeholder.size;
+        HRESULT hr = PrjWritePlaceholderInfo(
+            mountChannel_,
+            placeholder.path.c_str(),
+            &placeholderInfo,
+            sizeof(placeholderInfo));
+        if (FAILED(hr)) {
+          // This is expected for paths that are already on disk.
+          XLOGF(
+              DBG6,
+              "Failed to write placeholder {} error: {}",
+              winToEdenPath(placeholder.path),
+              hr);
+        }
+      });
+}
+
 } // namespace eden
 } // namespace facebook
@@ -9,11 +9,16 @@
 #include "folly/portability/Windows.h"
 
 #include <ProjectedFSLib.h>
+#include <memory>
 #include "eden/fs/utils/PathFuncs.h"
 #include "eden/fs/win/mount/EdenDispatcher.h"
 #include "eden/fs/win/mount/FsChannel.h"
 #include "eden/fs/win/utils/Guid.h"
 
+namespace folly {
+class CPUThreadPoolExecutor;
+} // namespace folly
+
 namespace facebook {
 namespace eden {
 class EdenMount;
@@ -44,6 +49,19 @@ class PrjfsChannel : public FsChannel {
    */
   void removeDeletedFile(const wchar_t* path) override;
 
+  /**
+   * Updates file placeholders in place with PrjUpdateFileIfNeeded() when
+   * their new size is known, and removes everything else from the cache. The
+   * updates are spread over the channel's update threads.
+   */
+  void updateCachedFiles(const std::vector<CachedFileUpdate>& updates) override;
+
+  /**
+   * Writes placeholders with PrjWritePlaceholderInfo() on the channel's update
+   * threads.
+   */
+  void writePlaceholders(const std::vector<Placeholder>& placeholders) override;
+
  private:
   static HRESULT CALLBACK startEnumeration(
       const PRJ_CALLBACK_DATA* callbackData,
@@ -81,6 +99,12 @@ class PrjfsChannel : public FsChannel {
 
   void deleteFile(const wchar_t* path, PRJ_UPDATE_TYPES updateFlags);
 
+  /**
+   * Returns false if the placeholder could not be updated and should be
+   * removed from the cache instead.
+   */
+  bool updatePlaceholder(const CachedFileUpdate& update);
+
  private:
   /**
    * getDispatcher fetches the EdenDispatcher from the Projectedfs request.
@@ -107,6 +131,9 @@ class PrjfsChannel : public FsChannel {
   Guid mountId_;
   std::wstring winPath_;
   bool isRunning_{false};
+
+  size_t updateThreads_;
+  std::unique_ptr<folly::CPUThreadPoolExecutor> updateExecutor_;
 };
 
 } // namespace eden
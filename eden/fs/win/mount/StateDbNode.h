@@ -21,6 +21,9 @@ namespace eden {
  * from RegDb. This class is not multi-thread safe and the call needs to be
  * synchronized by the caller.
  *
+ * CurrentState no longer records its state in the registry; it only uses
+ * StateDbNode to move the state older versions recorded into its database.
+ *
  * TODO(puneetk): We need to add interfaces which could fetch and set all the
  * entries in a single call.
  */
@@ -193,6 +193,10 @@ class StateDirectoryEntry {
     return scmHash_;
   }
 
+  [[nodiscard]] StateInfo getStateInfo() const {
+    return info_;
+  }
+
   [[nodiscard]] bool wasDeleted() const {
     return (info_.wasDeleted != 0);
   }
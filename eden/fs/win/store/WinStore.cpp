@@ -23,6 +23,32 @@ using namespace folly;
 namespace facebook {
 namespace eden {
 
+namespace {
+/**
+ * Looks up components[index], then everything after it, under tree, fetching
+ * the subtrees asynchronously.
+ */
+Future<shared_ptr<const Tree>> getSubtree(
+    ObjectStore* store,
+    shared_ptr<const Tree> tree,
+    vector<PathComponent> components,
+    size_t index) {
+  if (index == components.size()) {
+    return tree;
+  }
+  auto entry = tree->getEntryPtr(components[index]);
+  if (entry == nullptr || !entry->isTree()) {
+    return shared_ptr<const Tree>{nullptr};
+  }
+  return store->getTree(entry->getHash(), ObjectFetchContext::getNullContext())
+      .thenValue([store, components = std::move(components), index](
+                     shared_ptr<const Tree> subtree) mutable {
+        return getSubtree(
+            store, std::move(subtree), std::move(components), index + 1);
+      });
+}
+} // namespace
+
 WinStore::WinStore(const EdenMount& mount) : mount_{mount} {
   XLOGF(
       INFO,
@@ -160,20 +186,36 @@ bool WinStore::checkFileName(const std::wstring_view path) const {
 
 std::shared_ptr<const Blob> WinStore::getBlob(
     const std::wstring_view path) const {
-  RelativePath relPath{wideCharToEdenRelativePath(path)};
-  shared_ptr<const Tree> tree = getTree(relPath.dirname());
-  if (!tree) {
-    return nullptr;
-  }
+  return getBlobAsync(path).get();
+}
 
-  auto file = tree->getEntryPtr(relPath.basename());
-  if ((file) && (!file->isTree())) {
-    return (getMount()
-                .getObjectStore()
-                ->getBlob(file->getHash(), ObjectFetchContext::getNullContext())
-                .get());
+Future<shared_ptr<const Blob>> WinStore::getBlobAsync(
+    const std::wstring_view path) const {
+  RelativePath relPath{wideCharToEdenRelativePath(path)};
+  vector<PathComponent> components;
+  for (auto piece : relPath.dirname().components()) {
+    components.emplace_back(piece);
   }
-  return nullptr;
+  auto* store = getMount().getObjectStore();
+  return getMount()
+      .getRootTree()
+      .thenValue([store, components = std::move(components)](
+                     shared_ptr<const Tree> root) mutable {
+        return getSubtree(store, std::move(root), std::move(components), 0);
+      })
+      .thenValue([store, name = PathComponent{relPath.basename()}](
+                     shared_ptr<const Tree> tree)
+                     -> Future<shared_ptr<const Blob>> {
+        if (!tree) {
+          return shared_ptr<const Blob>{nullptr};
+        }
+        auto file = tree->getEntryPtr(name);
+        if (file == nullptr || file->isTree()) {
+          return shared_ptr<const Blob>{nullptr};
+        }
+        return store->getBlob(
+            file->getHash(), ObjectFetchContext::getNullContext());
+      });
 }
 
 } // namespace eden
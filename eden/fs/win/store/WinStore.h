@@ -47,10 +47,10 @@ struct FileMetadata {
   Hash hash{};
 
   FileMetadata(std::wstring name, bool isDir, size_t size)
-      : name(name), isDirectory(isDir), size(size) {}
+      : name(std::move(name)), isDirectory(isDir), size(size) {}
 
   FileMetadata(std::wstring name, bool isDir, size_t size, const Hash& hash)
-      : name(name), isDirectory(isDir), size(size), hash{hash} {}
+      : name(std::move(name)), isDirectory(isDir), size(size), hash{hash} {}
 
   FileMetadata() {}
 
@@ -88,6 +88,13 @@ class WinStore {
   std::shared_ptr<const Tree> getTree(const std::wstring_view path) const;
   std::shared_ptr<const Blob> getBlob(const std::wstring_view path) const;
 
+  /**
+   * Fetches the blob for the file at path without blocking on the object
+   * store.  The result is nullptr if path is not a file in the backing store.
+   */
+  folly::Future<std::shared_ptr<const Blob>> getBlobAsync(
+      const std::wstring_view path) const;
+
  private:
   std::shared_ptr<const Tree> getTree(const RelativePathPiece& relPath) const;
   const TreeEntry* getTreeEntry(const std::wstring_view path) const;
@@ -8,7 +8,9 @@
 #include "folly/portability/Windows.h"
 
 #include <folly/Utility.h>
+#include <folly/futures/Future.h>
 #include <folly/portability/IOVec.h>
+#include <malloc.h>
 #include <filesystem>
 #include <iostream>
 #include "eden/fs/model/Hash.h"
@@ -124,6 +126,136 @@ void writeFileAtomic(const wchar_t* filePath, const folly::ByteRange data) {
   }
 }
 
+namespace {
+/*
+ * The state of one outstanding overlapped operation. The OVERLAPPED must come
+ * first: the completion callback gets a pointer to it and casts it back.
+ */
+struct AsyncIoRequest {
+  OVERLAPPED overlapped{};
+  folly::Promise<size_t> promise;
+};
+
+void CALLBACK onAsyncIoComplete(
+    DWORD error,
+    DWORD bytesTransferred,
+    LPOVERLAPPED overlapped) {
+  std::unique_ptr<AsyncIoRequest> request{
+      reinterpret_cast<AsyncIoRequest*>(overlapped)};
+  if (error == ERROR_SUCCESS || error == ERROR_HANDLE_EOF) {
+    request->promise.setValue(bytesTransferred);
+  } else {
+    request->promise.setException(
+        makeWin32ErrorExplicit(error, "Asynchronous I/O failed"));
+  }
+}
+
+/*
+ * Issues one overlapped operation at offset by calling issue with its
+ * OVERLAPPED. Once the operation has been queued its completion is always
+ * reported through the completion port, even when it finished immediately.
+ */
+template <typename Issue>
+folly::Future<size_t> startAsyncIo(uint64_t offset, Issue&& issue) {
+  auto request = std::make_unique<AsyncIoRequest>();
+  request->overlapped.Offset = static_cast<DWORD>(offset);
+  request->overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+  auto future = request->promise.getFuture();
+
+  if (!issue(&request->overlapped)) {
+    DWORD error = GetLastError();
+    if (error == ERROR_HANDLE_EOF) {
+      // Reading at or past the end of the file fails without queueing a
+      // completion.
+      return folly::makeFuture<size_t>(0);
+    }
+    if (error != ERROR_IO_PENDING) {
+      return folly::makeFuture<size_t>(folly::exception_wrapper{
+          makeWin32ErrorExplicit(error, "Unable to start asynchronous I/O")});
+    }
+  }
+
+  // The completion callback now owns the request.
+  request.release();
+  return future;
+}
+} // namespace
+
+std::unique_ptr<folly::IOBuf> allocateAlignedIOBuf(size_t capacity) {
+  // _aligned_malloc rejects zero sized allocations.
+  auto buffer =
+      _aligned_malloc(std::max<size_t>(capacity, 1), kAsyncIoAlignment);
+  if (!buffer) {
+    throw std::bad_alloc();
+  }
+  return folly::IOBuf::takeOwnership(
+      buffer,
+      capacity,
+      0,
+      [](void* buf, void* /* userData */) { _aligned_free(buf); });
+}
+
+void bindToCompletionPort(HANDLE handle) {
+  if (!BindIoCompletionCallback(handle, onAsyncIoComplete, 0)) {
+    throw makeWin32ErrorExplicit(
+        GetLastError(), "Unable to bind the handle to the completion port");
+  }
+}
+
+folly::Future<std::unique_ptr<folly::IOBuf>>
+readFileAsync(HANDLE handle, uint64_t offset, size_t length) {
+  auto buf = allocateAlignedIOBuf(length);
+  auto data = buf->writableData();
+  return startAsyncIo(
+             offset,
+             [&](OVERLAPPED* overlapped) {
+               return ReadFile(
+                   handle,
+                   data,
+                   folly::to_narrow(length),
+                   nullptr,
+                   overlapped);
+             })
+      // The continuation keeps the buffer alive until the read completes.
+      .thenValue([buf = std::move(buf)](size_t bytesRead) mutable {
+        buf->append(bytesRead);
+        return std::move(buf);
+      });
+}
+
+folly::Future<size_t> writeFileAsync(
+    HANDLE handle,
+    uint64_t offset,
+    std::unique_ptr<folly::IOBuf> data) {
+  std::vector<folly::Future<size_t>> writes;
+  for (auto range : *data) {
+    if (range.empty()) {
+      continue;
+    }
+    writes.push_back(startAsyncIo(offset, [&](OVERLAPPED* overlapped) {
+      return WriteFile(
+          handle,
+          range.data(),
+          folly::to_narrow(range.size()),
+          nullptr,
+          overlapped);
+    }));
+    offset += range.size();
+  }
+
+  // Wait for every write, even after one fails, since they all point into
+  // data.
+  return folly::collectAllUnsafe(std::move(writes))
+      .thenValue([data = std::move(data)](
+                     std::vector<folly::Try<size_t>> results) {
+        size_t bytesWritten = 0;
+        for (auto& result : results) {
+          bytesWritten += result.value();
+        }
+        return bytesWritten;
+      });
+}
+
 Hash getFileSha1(const wchar_t* filePath) {
   std::string data;
   readFile(filePath, data);
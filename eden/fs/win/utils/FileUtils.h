@@ -12,6 +12,8 @@
 #include "eden/fs/win/utils/Handle.h"
 #include "eden/fs/win/utils/StringConv.h"
 #include "folly/Range.h"
+#include "folly/futures/Future.h"
+#include "folly/io/IOBuf.h"
 #include "folly/portability/IOVec.h"
 
 namespace facebook {
@@ -158,6 +160,46 @@ inline void writeFileAtomic(const wchar_t* filePath, const std::string& data) {
   writeFileAtomic(filePath, folly::StringPiece(data));
 }
 
+/*
+ * Alignment of the buffers returned by allocateAlignedIOBuf(). This satisfies
+ * the sector alignment required by handles opened with
+ * FILE_FLAG_NO_BUFFERING.
+ */
+constexpr size_t kAsyncIoAlignment = 4096;
+
+/*
+ * Allocates an empty IOBuf with room for capacity bytes, whose buffer is
+ * aligned to kAsyncIoAlignment.
+ */
+std::unique_ptr<folly::IOBuf> allocateAlignedIOBuf(size_t capacity);
+
+/*
+ * Associates a handle opened with FILE_FLAG_OVERLAPPED with the I/O completion
+ * port of the system thread pool, so that readFileAsync() and writeFileAsync()
+ * can be used with it. A handle can only be bound once. Throws on failure.
+ */
+void bindToCompletionPort(HANDLE handle);
+
+/*
+ * Reads up to length bytes at offset from a handle bound with
+ * bindToCompletionPort() without blocking the calling thread. The future
+ * completes on a thread pool thread with an aligned IOBuf holding the bytes
+ * read, which is shorter than length at the end of the file.
+ */
+folly::Future<std::unique_ptr<folly::IOBuf>>
+readFileAsync(HANDLE handle, uint64_t offset, size_t length);
+
+/*
+ * Writes every buffer of the data chain back to back, starting at offset, to a
+ * handle bound with bindToCompletionPort(). All of the writes are issued
+ * at once; the future completes with the number of bytes written once all of
+ * them have, or with the first error.
+ */
+folly::Future<size_t> writeFileAsync(
+    HANDLE handle,
+    uint64_t offset,
+    std::unique_ptr<folly::IOBuf> data);
+
 Hash getFileSha1(const wchar_t* filePath);
 
 static inline Hash getFileSha1(char const* filePath) {
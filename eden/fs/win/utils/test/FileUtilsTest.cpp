@@ -250,3 +250,34 @@ TEST_F(FileUtilsTest, testGetEnumerationEntries) {
   EXPECT_EQ(std::wstring(entriesWide[6].data.cFileName), L"testfile5.txt");
   EXPECT_EQ(std::wstring(entriesWide[7].data.cFileName), L"zztestdir3");
 }
+
+TEST_F(FileUtilsTest, testAsyncWriteReadFile) {
+  auto filePath = getTestPath() / L"testfile.txt";
+  {
+    FileHandle fileHandle{CreateFile(
+        filePath.c_str(),
+        GENERIC_READ | GENERIC_WRITE,
+        0,
+        nullptr,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
+        nullptr)};
+    ASSERT_TRUE(fileHandle);
+    bindToCompletionPort(fileHandle.get());
+
+    auto data = folly::IOBuf::copyBuffer("This is ");
+    data->prependChain(folly::IOBuf::copyBuffer("the test file."));
+    EXPECT_EQ(22, writeFileAsync(fileHandle.get(), 0, std::move(data)).get());
+
+    auto contents = readFileAsync(fileHandle.get(), 8, 1024).get();
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(contents->data()) % 4096);
+    EXPECT_EQ("the test file.", contents->moveToFbString());
+
+    EXPECT_EQ(0, readFileAsync(fileHandle.get(), 1024, 10).get()->length());
+  }
+
+  std::string readContents;
+  readFile(filePath.c_str(), readContents);
+  EXPECT_TRUE(DeleteFile(filePath.c_str()));
+  EXPECT_EQ("This is the test file.", readContents);
+}
@@ -43,6 +43,16 @@ class RemountTest(testcase.EdenRepoTest):
         # Verify that default repo created by EdenRepoTestBase is remounted
         self._assert_mounted(self.mount)
 
+    def test_remount_with_local_store_opened_in_background(self) -> None:
+        self._clone_checkouts(3)
+
+        self.eden.shutdown()
+        self.eden.start(extra_args=["--open_local_store_in_background"])
+
+        for i in range(3):
+            self._assert_mounted(f"{self.mount}-{i}")
+        self._assert_mounted(self.mount)
+
     def test_git_and_hg(self) -> None:
         # Create git and hg repositories for mounting
         repo_names = {"git": "git_repo", "hg": "hg_repo"}
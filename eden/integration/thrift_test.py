@@ -82,6 +82,17 @@ class ThriftTest(testcase.EdenRepoTest):
             self.client.getSHA1(self.mount_path_bytes, [b"hello", b"adir/file"]),
         )
 
+    def test_get_sha1_keeps_results_in_request_order(self) -> None:
+        results = self.client.getSHA1(
+            self.mount_path_bytes, [b"adir/file", b"", b"hello", b"adir/file"]
+        )
+        self.assertEqual(4, len(results))
+        expected_sha1_for_adir_file = hashlib.sha1(b"foo!\n").digest()
+        self.assertEqual(SHA1Result(expected_sha1_for_adir_file), results[0])
+        self.assert_error(results[1], "path cannot be the empty string")
+        self.assertEqual(SHA1Result(hashlib.sha1(b"hola\n").digest()), results[2])
+        self.assertEqual(SHA1Result(expected_sha1_for_adir_file), results[3])
+
     def test_get_sha1_throws_for_path_with_dot_components(self) -> None:
         results = self.client.getSHA1(self.mount_path_bytes, [b"./hello"])
         self.assertEqual(1, len(results))
@@ -192,6 +203,21 @@ class ThriftTest(testcase.EdenRepoTest):
         lookups_2ls = self.get_counter("fuse.lookup_us.count")
         self.assertEqual(lookups_1ls + 1, lookups_2ls)
 
+    def test_invalidate_inode_cache_recursive(self) -> None:
+        filename = "bdir/file"
+        self.read_file(filename)
+        reads = self.get_counter("fuse.read_us.count")
+        self.read_file(filename)
+        self.assertEqual(reads, self.get_counter("fuse.read_us.count"))
+
+        # Invalidating from the root reaches the file two levels down.
+        count = self.client.invalidateKernelInodeCacheRecursive(
+            self.mount_path_bytes, b""
+        )
+        self.assertGreaterEqual(count, 3)
+        self.read_file(filename)
+        self.assertEqual(reads + 1, self.get_counter("fuse.read_us.count"))
+
     def test_diff_revisions(self) -> None:
         # Convert the commit hashes to binary for the thrift call
         with self.get_thrift_client() as client:
@@ -0,0 +1,96 @@
+# Copyright (c) Facebook, Inc. and its affiliates.
+#
+# This software may be used and distributed according to the terms of the
+# GNU General Public License version 2.
+
+# Benchmark bdiff over a corpus, with and without parallel line splitting
+#
+# usage: bdiff-bench.py [-t THREADS] [-m MINSIZE] [-r REPEAT] PATH...
+#
+# Every file under the given paths is diffed against an edited copy of
+# itself. The output of each parallel run is checked to be identical to the
+# serial one.
+
+from __future__ import absolute_import, print_function
+
+import optparse
+import os
+import random
+import sys
+import time
+
+from edenscm.mercurial import mdiff
+
+
+def corpus(paths):
+    for path in paths:
+        if os.path.isdir(path):
+            for root, dirs, files in os.walk(path):
+                dirs.sort()
+                for name in sorted(files):
+                    yield os.path.join(root, name)
+        else:
+            yield path
+
+
+def edit(text, rng):
+    """change a few ranges of text, like a typical commit would"""
+    if not text:
+        return b"x\n"
+    for _i in range(rng.randint(1, 8)):
+        start = rng.randrange(len(text))
+        end = min(len(text), start + rng.randint(0, 256))
+        text = text[:start] + os.urandom(rng.randint(0, 64)) + text[end:]
+    return text
+
+
+def timepairs(pairs, repeat):
+    best = None
+    for _i in range(repeat):
+        start = time.time()
+        for a, b in pairs:
+            mdiff.textdiff(a, b)
+            mdiff.blocks(a, b)
+        elapsed = time.time() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best
+
+
+def main():
+    parser = optparse.OptionParser(usage="%prog [options] PATH...")
+    parser.add_option("-t", "--threads", type="int", default=8)
+    parser.add_option("-m", "--minsize", type="int", default=1 << 20)
+    parser.add_option("-r", "--repeat", type="int", default=3)
+    opts, args = parser.parse_args()
+    if not args:
+        parser.error("no corpus given")
+
+    rng = random.Random(0)
+    pairs = []
+    for path in corpus(args):
+        with open(path, "rb") as f:
+            text = f.read()
+        pairs.append((text, edit(text, rng)))
+    size = sum(len(a) + len(b) for a, b in pairs)
+    print("%d pairs, %d bytes" % (len(pairs), size))
+
+    mdiff.setbdiffparallel(0, 0)
+    expected = [(mdiff.textdiff(a, b), mdiff.blocks(a, b)) for a, b in pairs]
+    serial = timepairs(pairs, opts.repeat)
+    print("serial: %.3f s" % serial)
+
+    mdiff.setbdiffparallel(opts.threads, opts.minsize)
+    actual = [(mdiff.textdiff(a, b), mdiff.blocks(a, b)) for a, b in pairs]
+    if actual != expected:
+        print("parallel output differs from serial output")
+        return 1
+    parallel = timepairs(pairs, opts.repeat)
+    print(
+        "%d threads, minsize %d: %.3f s (%.2fx)"
+        % (opts.threads, opts.minsize, parallel, serial / parallel)
+    )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
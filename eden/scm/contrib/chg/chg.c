@@ -35,10 +35,16 @@
 #define PATH_MAX 4096
 #endif
 
+/* Upper bound of CHGPOOLSIZE, so that the pool fits in a bitmask */
+#define MAX_POOL_SIZE 8
+
 struct cmdserveropts {
+  char basesockname[PATH_MAX];
   char sockname[PATH_MAX];
   char initsockname[PATH_MAX];
   char redirectsockname[PATH_MAX];
+  unsigned int poolsize;
+  unsigned int missingslots; /* bitmask of servers to prefork */
 };
 
 static void initcmdserveropts(struct cmdserveropts* opts) {
@@ -96,6 +102,45 @@ static void getdefaultsockdir(char sockdir[], size_t size) {
     abortmsg("too long TMPDIR (r = %d)", r);
 }
 
+/*
+ * Point sockname and initsockname at the given server of the pool. The first
+ * server uses the base socket name, so a pool of one behaves as before.
+ */
+static void setcmdserverslot(struct cmdserveropts* opts, unsigned int slot) {
+  int r;
+  if (slot == 0) {
+    r = snprintf(
+        opts->sockname, sizeof(opts->sockname), "%s", opts->basesockname);
+  } else {
+    /* no '.' here: the server drops everything after it from its address */
+    r = snprintf(
+        opts->sockname,
+        sizeof(opts->sockname),
+        "%s-%u",
+        opts->basesockname,
+        slot);
+  }
+  if (r < 0 || (size_t)r >= sizeof(opts->sockname))
+    abortmsg("too long TMPDIR or CHGSOCKNAME (r = %d)", r);
+  r = snprintf(
+      opts->initsockname,
+      sizeof(opts->initsockname),
+      "%s.%u",
+      opts->sockname,
+      (unsigned)getpid());
+  if (r < 0 || (size_t)r >= sizeof(opts->initsockname))
+    abortmsg("too long TMPDIR or CHGSOCKNAME (r = %d)", r);
+}
+
+static int configint(const char* name, int fallback) {
+  const char* str = getenv(name);
+  int value = fallback;
+  if (str) {
+    sscanf(str, "%d", &value);
+  }
+  return value;
+}
+
 static void setcmdserveropts(struct cmdserveropts* opts) {
   int r;
   char sockdir[PATH_MAX];
@@ -107,17 +152,18 @@ static void setcmdserveropts(struct cmdserveropts* opts) {
 
   const char* basename = (envsockname) ? envsockname : sockdir;
   const char* sockfmt = (envsockname) ? "%s" : "%s/server3";
-  r = snprintf(opts->sockname, sizeof(opts->sockname), sockfmt, basename);
-  if (r < 0 || (size_t)r >= sizeof(opts->sockname))
-    abortmsg("too long TMPDIR or CHGSOCKNAME (r = %d)", r);
   r = snprintf(
-      opts->initsockname,
-      sizeof(opts->initsockname),
-      "%s.%u",
-      opts->sockname,
-      (unsigned)getpid());
-  if (r < 0 || (size_t)r >= sizeof(opts->initsockname))
+      opts->basesockname, sizeof(opts->basesockname), sockfmt, basename);
+  if (r < 0 || (size_t)r >= sizeof(opts->basesockname))
     abortmsg("too long TMPDIR or CHGSOCKNAME (r = %d)", r);
+
+  int poolsize = configint("CHGPOOLSIZE", 1);
+  if (poolsize < 1)
+    poolsize = 1;
+  if (poolsize > MAX_POOL_SIZE)
+    poolsize = MAX_POOL_SIZE;
+  opts->poolsize = (unsigned int)poolsize;
+  setcmdserverslot(opts, 0);
 }
 
 static const char* gethgcmd(void) {
@@ -210,8 +256,105 @@ cleanup:
   return NULL;
 }
 
+/*
+ * Start a server for the given slot in the background, without waiting for
+ * it. The work is done in a detached grandchild, so there is no child left
+ * for us to reap and the server survives us exiting.
+ */
+static void preforkcmdserver(
+    const struct cmdserveropts* opts,
+    unsigned int slot) {
+  pid_t pid = fork();
+  if (pid < 0) {
+    debugmsg("failed to fork prefork process");
+    return;
+  }
+  if (pid > 0) {
+    waitpid(pid, NULL, 0);
+    return;
+  }
+
+  setsid();
+  if (fork() != 0)
+    _exit(0);
+
+  int nullfd = open("/dev/null", O_RDWR);
+  if (nullfd >= 0) {
+    dup2(nullfd, STDIN_FILENO);
+    dup2(nullfd, STDOUT_FILENO);
+    dup2(nullfd, STDERR_FILENO);
+    if (nullfd > STDERR_FILENO)
+      close(nullfd);
+  }
+
+  /* initsockname must be unique to this process */
+  struct cmdserveropts slotopts = *opts;
+  setcmdserverslot(&slotopts, slot);
+  char lockname[PATH_MAX + 8];
+  snprintf(lockname, sizeof(lockname), "%s.lock", slotopts.sockname);
+
+  /* another client is already starting this server */
+  int lockfd = open(lockname, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (lockfd < 0 || flock(lockfd, LOCK_EX | LOCK_NB) < 0)
+    _exit(0);
+  hgclient_t* hgc = hgc_open(slotopts.sockname);
+  if (!hgc) {
+    pid_t serverpid = fork();
+    if (serverpid < 0)
+      _exit(1);
+    if (serverpid == 0)
+      execcmdserver(&slotopts);
+    hgc = retryconnectcmdserver(&slotopts, serverpid);
+  }
+  hgc_close(hgc);
+  _exit(0);
+}
+
+/*
+ * Connect to a running server of the pool, starting from a slot picked by
+ * our pid so that concurrent clients are spread across the servers. Servers
+ * found missing are remembered, to be preforked once the command is done.
+ * Returns NULL with the first slot selected if no server is running.
+ */
+static hgclient_t* connectcmdserverpool(struct cmdserveropts* opts) {
+  unsigned int first = (unsigned int)getpid() % opts->poolsize;
+  for (unsigned int i = 0; i < opts->poolsize; i++) {
+    unsigned int slot = (first + i) % opts->poolsize;
+    setcmdserverslot(opts, slot);
+    debugmsg("try connect to %s", opts->sockname);
+    hgclient_t* hgc = hgc_open(opts->sockname);
+    if (hgc) {
+      opts->missingslots &= ~(1u << slot);
+      return hgc;
+    }
+    opts->missingslots |= 1u << slot;
+  }
+
+  /* the caller starts the first slot in the foreground */
+  opts->missingslots &= ~(1u << first);
+  setcmdserverslot(opts, first);
+  return NULL;
+}
+
+/* Start the servers that were found missing in the background. */
+static void preforkmissingcmdservers(struct cmdserveropts* opts) {
+  for (unsigned int slot = 0; slot < opts->poolsize; slot++) {
+    if (opts->missingslots & (1u << slot)) {
+      debugmsg("prefork cmdserver for slot %u", slot);
+      preforkcmdserver(opts, slot);
+    }
+  }
+  opts->missingslots = 0;
+}
+
 /* Connect to a cmdserver. Will start a new server on demand. */
 static hgclient_t* connectcmdserver(struct cmdserveropts* opts) {
+  if (opts->poolsize > 1 && !opts->redirectsockname[0]) {
+    hgclient_t* hgc = connectcmdserverpool(opts);
+    if (hgc)
+      return hgc;
+  }
+
   const char* sockname =
       opts->redirectsockname[0] ? opts->redirectsockname : opts->sockname;
   debugmsg("try connect to %s", sockname);
@@ -282,15 +425,6 @@ static void execoriginalhg(const char* argv[]) {
     abortmsgerrno("failed to exec original hg");
 }
 
-static int configint(const char* name, int fallback) {
-  const char* str = getenv(name);
-  int value = fallback;
-  if (str) {
-    sscanf(str, "%d", &value);
-  }
-  return value;
-}
-
 int chg_main(int argc, const char* argv[], const char* envp[]) {
   if (configint("CHGDEBUG", 0))
     enabledebugmsg();
@@ -325,7 +459,10 @@ int chg_main(int argc, const char* argv[], const char* envp[]) {
 
   if (argc == 2) {
     if (strcmp(argv[1], "--kill-chg-daemon") == 0) {
-      killcmdserver(&opts);
+      for (unsigned int slot = 0; slot < opts.poolsize; slot++) {
+        setcmdserverslot(&opts, slot);
+        killcmdserver(&opts);
+      }
       return 0;
     }
   }
@@ -373,6 +510,8 @@ int chg_main(int argc, const char* argv[], const char* envp[]) {
   int exitcode = hgc_runcommand(hgc, argv + 1, argc - 1);
   restoresignalhandler();
   hgc_close(hgc);
+  /* done after the command, so that it never adds to its latency */
+  preforkmissingcmdservers(&opts);
 
   return exitcode;
 }
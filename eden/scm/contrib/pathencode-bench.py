@@ -0,0 +1,75 @@
+# Copyright (c) Facebook, Inc. and its affiliates.
+#
+# This software may be used and distributed according to the terms of the
+# GNU General Public License version 2.
+
+# Benchmark the C fncache path encoder against the pure Python one
+#
+# usage: pathencode-bench.py [-r REPEAT] PATH...
+#
+# Every file under the given paths becomes a store path, the way a commit
+# adding it would. The output of the C encoder is checked to be identical to
+# the pure Python one.
+
+from __future__ import absolute_import, print_function
+
+import optparse
+import os
+import sys
+import time
+
+from edenscm.mercurial import store
+from edenscm.mercurial.cext import parsers
+
+
+def corpus(paths):
+    for path in paths:
+        if os.path.isdir(path):
+            for root, dirs, files in os.walk(path):
+                dirs.sort()
+                for name in sorted(files):
+                    yield os.path.relpath(os.path.join(root, name), path)
+        else:
+            yield path
+
+
+def timeencode(encode, paths, repeat):
+    best = None
+    for _i in range(repeat):
+        start = time.time()
+        for path in paths:
+            encode(path)
+        elapsed = time.time() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best
+
+
+def main():
+    parser = optparse.OptionParser(usage="%prog [options] PATH...")
+    parser.add_option("-r", "--repeat", type="int", default=5)
+    opts, args = parser.parse_args()
+    if not args:
+        parser.error("no corpus given")
+
+    paths = []
+    for path in corpus(args):
+        path = path.replace(os.sep, "/")
+        paths.extend(["data/%s.i" % path, "data/%s.d" % path])
+    size = sum(len(p) for p in paths)
+    print("%d paths, %d bytes" % (len(paths), size))
+
+    def pure(path):
+        return store._hybridencode(path, True)
+
+    if [parsers.pathencode(p) for p in paths] != [pure(p) for p in paths]:
+        print("C output differs from pure Python output")
+        return 1
+    puretime = timeencode(pure, paths, opts.repeat)
+    print("pure: %.3f s" % puretime)
+    ctime = timeencode(parsers.pathencode, paths, opts.repeat)
+    print("C: %.3f s (%.2fx)" % (ctime, puretime / ctime))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
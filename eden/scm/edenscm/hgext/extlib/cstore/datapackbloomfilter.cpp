@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+// datapackbloomfilter.cpp - bloom filter of the nodes in a datapack index
+// no-check-code
+
+#include "edenscm/hgext/extlib/cstore/datapackbloomfilter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <random>
+
+namespace {
+
+const char kMagic[8] = {'d', 'p', 'b', 'l', 'o', 'o', 'm', '1'};
+
+// About 1% false positives.
+constexpr uint64_t kBitsPerEntry = 10;
+constexpr uint64_t kProbeCount = 7;
+
+struct FileCloser {
+  void operator()(FILE* file) {
+    fclose(file);
+  }
+};
+using FilePtr = std::unique_ptr<FILE, FileCloser>;
+
+// Nodes are already uniformly distributed hashes, so the probe positions are
+// derived directly from their bytes.
+void getProbeHashes(const uint8_t* node, uint64_t* h1, uint64_t* h2) {
+  memcpy(h1, node + 4, sizeof(*h1));
+  memcpy(h2, node + 12, sizeof(*h2));
+  *h2 |= 1;
+}
+
+} // namespace
+
+DatapackBloomFilter::DatapackBloomFilter(uint64_t entryCount)
+    : entryCount_(entryCount),
+      bitCount_(((entryCount * kBitsPerEntry + 63) / 64) * 64),
+      words_(bitCount_ / 64) {
+  if (bitCount_ == 0) {
+    bitCount_ = 64;
+    words_.resize(1);
+  }
+}
+
+std::unique_ptr<DatapackBloomFilter> DatapackBloomFilter::loadOrBuild(
+    const std::string& packPath,
+    const datapack_handle_t* pack) {
+  uint64_t entryCount = get_index_entry_count(pack);
+  std::unique_ptr<DatapackBloomFilter> filter(
+      new DatapackBloomFilter(entryCount));
+
+  std::string path = packPath + BLOOMSUFFIX;
+  if (filter->load(path)) {
+    return filter;
+  }
+
+  for (size_t i = 0; i < entryCount; ++i) {
+    filter->add(get_index_entry_node(pack, i));
+  }
+  filter->save(path);
+  return filter;
+}
+
+void DatapackBloomFilter::add(const uint8_t* node) {
+  uint64_t h1, h2;
+  getProbeHashes(node, &h1, &h2);
+  for (uint64_t i = 0; i < kProbeCount; ++i) {
+    uint64_t bit = (h1 + i * h2) % bitCount_;
+    words_[bit / 64] |= uint64_t(1) << (bit % 64);
+  }
+}
+
+bool DatapackBloomFilter::mayContain(const uint8_t* node) const {
+  uint64_t h1, h2;
+  getProbeHashes(node, &h1, &h2);
+  for (uint64_t i = 0; i < kProbeCount; ++i) {
+    uint64_t bit = (h1 + i * h2) % bitCount_;
+    if (!(words_[bit / 64] & (uint64_t(1) << (bit % 64)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DatapackBloomFilter::load(const std::string& path) {
+  FilePtr file(fopen(path.c_str(), "rb"));
+  if (!file) {
+    return false;
+  }
+
+  char magic[sizeof(kMagic)];
+  uint64_t entryCount, bitCount;
+  if (fread(magic, sizeof(magic), 1, file.get()) != 1 ||
+      memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      fread(&entryCount, sizeof(entryCount), 1, file.get()) != 1 ||
+      fread(&bitCount, sizeof(bitCount), 1, file.get()) != 1) {
+    return false;
+  }
+  // A filter for a different pack with the same name, or one written with
+  // different parameters, is rebuilt.
+  if (entryCount != entryCount_ || bitCount != bitCount_) {
+    return false;
+  }
+
+  std::vector<uint64_t> words(bitCount / 64);
+  if (fread(words.data(), sizeof(uint64_t), words.size(), file.get()) !=
+      words.size()) {
+    return false;
+  }
+  words_ = std::move(words);
+  return true;
+}
+
+void DatapackBloomFilter::save(const std::string& path) const {
+  // Write to a temporary file first so that concurrent readers never see
+  // a partial filter.  Failures are ignored: the pack directory may be
+  // read-only, and the filter is rebuilt next time.
+  std::random_device random;
+  std::string tmpPath = path + ".tmp" + std::to_string(random());
+  {
+    FilePtr file(fopen(tmpPath.c_str(), "wb"));
+    if (!file) {
+      return;
+    }
+    bool ok = fwrite(kMagic, sizeof(kMagic), 1, file.get()) == 1 &&
+        fwrite(&entryCount_, sizeof(entryCount_), 1, file.get()) == 1 &&
+        fwrite(&bitCount_, sizeof(bitCount_), 1, file.get()) == 1 &&
+        fwrite(words_.data(), sizeof(uint64_t), words_.size(), file.get()) ==
+            words_.size();
+    if (fclose(file.release()) != 0 || !ok) {
+      remove(tmpPath.c_str());
+      return;
+    }
+  }
+  if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+    remove(tmpPath.c_str());
+  }
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+// datapackbloomfilter.h - bloom filter of the nodes in a datapack index
+// no-check-code
+
+#ifndef FBHGEXT_DATAPACKBLOOMFILTER_H
+#define FBHGEXT_DATAPACKBLOOMFILTER_H
+
+extern "C" {
+#include "lib/cdatapack/cdatapack.h"
+}
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#define BLOOMSUFFIX ".databloom"
+
+/* A bloom filter of the nodes in one datapack's index, so that lookups of
+ * nodes that are not in the pack can usually skip its index.
+ *
+ * Pack files never change once written, so the filter is saved next to the
+ * pack's index (with the BLOOMSUFFIX extension) and reused by later
+ * processes.  The saved file is in native byte order, like the rest of the
+ * local caches that are never shared between machines. */
+class DatapackBloomFilter {
+ public:
+  /* Loads the filter saved for the pack at packPath (without an extension),
+   * or builds it from the pack's index and tries to save it. */
+  static std::unique_ptr<DatapackBloomFilter> loadOrBuild(
+      const std::string& packPath,
+      const datapack_handle_t* pack);
+
+  /* Returns false if the node is definitely not in the pack. */
+  bool mayContain(const uint8_t* node) const;
+
+ private:
+  explicit DatapackBloomFilter(uint64_t entryCount);
+
+  void add(const uint8_t* node);
+  bool load(const std::string& path);
+  void save(const std::string& path) const;
+
+  uint64_t entryCount_;
+  uint64_t bitCount_;
+  std::vector<uint64_t> words_;
+};
+
+#endif // FBHGEXT_DATAPACKBLOOMFILTER_H
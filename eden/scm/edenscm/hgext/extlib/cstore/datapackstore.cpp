@@ -11,9 +11,19 @@
 #include "edenscm/hgext/extlib/cstore/datapackstore.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
+#include <algorithm>
+#include <cstdio>
 #include <stdexcept>
 
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 #include "edenscm/hgext/extlib/cstore/key.h"
 #include "lib/clib/portability/dirent.h"
 
@@ -29,14 +39,28 @@ struct Deleter {
   }
 };
 
+std::string getPackDirPrefix(const std::string& path) {
+  std::string prefix(path);
+  if (!path.empty() && path[path.size() - 1] != '/') {
+    prefix.push_back('/');
+  }
+  return prefix;
+}
+
+bool hasSuffix(const char* name, size_t length, const char* suffix) {
+  size_t suffixLength = strlen(suffix);
+  return length >= suffixLength &&
+      strcmp(name + length - suffixLength, suffix) == 0;
+}
+
+// If bloomFilters is given, the pack paths of any bloom filter files found
+// in the directory are added to it as well.
 std::unordered_set<std::string> getAvailablePackFileNames(
-    const std::string& path) {
+    const std::string& path,
+    std::vector<std::string>* bloomFilters = nullptr) {
   std::unordered_set<std::string> results;
 
-  std::string packpath(path);
-  if (!path.empty() && path[path.size() - 1] != '/') {
-    packpath.push_back('/');
-  }
+  std::string packpath = getPackDirPrefix(path);
   size_t dirLength = packpath.size();
 
   std::unique_ptr<DIR, Deleter> dirp(opendir(path.c_str()));
@@ -47,6 +71,12 @@ std::unordered_set<std::string> getAvailablePackFileNames(
   dirent* entry;
   while ((entry = readdir(dirp.get())) != nullptr) {
     size_t fileLength = strlen(entry->d_name);
+    if (bloomFilters && hasSuffix(entry->d_name, fileLength, BLOOMSUFFIX)) {
+      bloomFilters->push_back(
+          packpath +
+          std::string(entry->d_name, fileLength - strlen(BLOOMSUFFIX)));
+      continue;
+    }
     if (fileLength < PACKSUFFIXLEN) {
       continue;
     }
@@ -60,12 +90,22 @@ std::unordered_set<std::string> getAvailablePackFileNames(
 
   return results;
 }
+
+// Bloom filters are written next to their pack, but nothing else deletes
+// them once the pack is repacked away. Failure is fine; the next scan or
+// removal event tries again.
+void removeBloomFilter(const std::string& packPath) {
+  std::remove((packPath + BLOOMSUFFIX).c_str());
+}
 } // namespace
 
 DatapackStore::DatapackStore(
     const std::string& path,
-    bool removeDeadPackFilesOnRefresh)
-    : path_(path), removeOnRefresh_(removeDeadPackFilesOnRefresh) {
+    bool removeDeadPackFilesOnRefresh,
+    bool useBloomFilters)
+    : path_(path),
+      removeOnRefresh_(removeDeadPackFilesOnRefresh),
+      useBloomFilters_(useBloomFilters) {
   // Find pack files in path
   auto files = getAvailablePackFileNames(path);
   for (const auto& packpath : files) {
@@ -94,13 +134,67 @@ std::shared_ptr<datapack_handle_t> DatapackStore::addPack(
   std::shared_ptr<datapack_handle_t> pack(cpack, close_datapack);
 
   if (pack && pack->status == DATAPACK_HANDLE_OK) {
+    if (useBloomFilters_) {
+      filters_[pack.get()] = DatapackBloomFilter::loadOrBuild(path, cpack);
+    }
     packs_[path] = pack;
     return pack;
   }
   return nullptr;
 }
 
-DatapackStore::~DatapackStore() {}
+bool DatapackStore::mayContain(
+    const datapack_handle_t* pack,
+    const uint8_t* node) const {
+  auto it = filters_.find(pack);
+  return it == filters_.end() || it->second->mayContain(node);
+}
+
+DatapackStore::~DatapackStore() {
+  stopWatching();
+}
+
+bool DatapackStore::watchPackDirectory() {
+#ifdef __linux__
+  if (watchFd_ >= 0) {
+    return true;
+  }
+  watchFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (watchFd_ < 0) {
+    return false;
+  }
+  // Packs are written under temporary names and renamed into place, and
+  // each new pack is a new file, so these events cover every change.
+  if (inotify_add_watch(
+          watchFd_,
+          path_.c_str(),
+          IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE |
+              IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR) < 0) {
+    stopWatching();
+    return false;
+  }
+
+  // Catch up with any pack added before the watch started.
+  std::vector<std::shared_ptr<datapack_handle_t>> added;
+  scanDirectory(added);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void DatapackStore::stopWatching() {
+#ifdef __linux__
+  if (watchFd_ >= 0) {
+    close(watchFd_);
+    watchFd_ = -1;
+  }
+#endif
+}
+
+void DatapackStore::setRefreshInterval(std::chrono::milliseconds interval) {
+  refreshInterval_ = interval;
+}
 
 DeltaChainIterator DatapackStore::getDeltaChain(const Key& key) {
   std::shared_ptr<DeltaChain> chain = this->getDeltaChainRaw(key);
@@ -113,6 +207,9 @@ DeltaChainIterator DatapackStore::getDeltaChain(const Key& key) {
 std::shared_ptr<DeltaChain> DatapackStore::getDeltaChainRaw(const Key& key) {
   for (const auto& it : packs_) {
     auto& pack = it.second;
+    if (!mayContain(pack.get(), (const uint8_t*)key.node)) {
+      continue;
+    }
     auto chain = getdeltachain(pack.get(), (const uint8_t*)key.node);
 
     if (chain.code == GET_DELTA_CHAIN_OOM) {
@@ -132,6 +229,9 @@ std::shared_ptr<DeltaChain> DatapackStore::getDeltaChainRaw(const Key& key) {
   // Check if there are new packs available
   auto rescanned = rescan();
   for (const auto& pack : rescanned) {
+    if (!mayContain(pack.get(), (const uint8_t*)key.node)) {
+      continue;
+    }
     auto chain = getdeltachain(pack.get(), (const uint8_t*)key.node);
     if (chain.code == GET_DELTA_CHAIN_OOM) {
       throw std::runtime_error("out of memory");
@@ -150,19 +250,28 @@ std::shared_ptr<DeltaChain> DatapackStore::getDeltaChainRaw(const Key& key) {
 }
 
 Key* DatapackStoreKeyIterator::next() {
-  Key* key;
-  while ((key = _missing.next()) != NULL) {
-    if (!_store.contains(*key)) {
-      return key;
+  if (!_loaded) {
+    _loaded = true;
+    std::vector<Key> keys;
+    Key* key;
+    while ((key = _missing.next()) != NULL) {
+      keys.push_back(*key);
     }
+    _missingKeys = _store.getMissingBatch(std::move(keys));
   }
 
+  if (_index < _missingKeys.size()) {
+    return &_missingKeys[_index++];
+  }
   return NULL;
 }
 
 bool DatapackStore::contains(const Key& key) {
   for (auto& it : packs_) {
     auto& pack = it.second;
+    if (!mayContain(pack.get(), (const uint8_t*)key.node)) {
+      continue;
+    }
     pack_index_entry_t packindex;
     if (find(pack.get(), (uint8_t*)key.node, &packindex)) {
       return true;
@@ -172,6 +281,9 @@ bool DatapackStore::contains(const Key& key) {
   // Check if there are new packs available
   auto rescanned = rescan();
   for (auto& pack : rescanned) {
+    if (!mayContain(pack.get(), (const uint8_t*)key.node)) {
+      continue;
+    }
     pack_index_entry_t packindex;
     if (find(pack.get(), (uint8_t*)key.node, &packindex)) {
       return true;
@@ -181,47 +293,224 @@ bool DatapackStore::contains(const Key& key) {
   return false;
 }
 
+std::vector<Key> DatapackStore::getMissingBatch(std::vector<Key> keys) {
+  // The indices of the keys not found so far, sorted by node.
+  std::vector<size_t> remaining(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    remaining[i] = i;
+  }
+  std::sort(remaining.begin(), remaining.end(), [&](size_t a, size_t b) {
+    return memcmp(keys[a].node, keys[b].node, BIN_NODE_SIZE) < 0;
+  });
+
+  // The keys the pack's bloom filter does not rule out, as indices into
+  // remaining.
+  std::vector<size_t> candidates;
+  std::vector<const uint8_t*> nodes;
+  std::unique_ptr<bool[]> found(new bool[keys.size()]);
+  std::unique_ptr<bool[]> inPack(new bool[keys.size()]);
+  auto probe = [&](datapack_handle_t* pack) {
+    candidates.clear();
+    nodes.clear();
+    for (size_t i = 0; i < remaining.size(); ++i) {
+      auto node = (const uint8_t*)keys[remaining[i]].node;
+      if (mayContain(pack, node)) {
+        candidates.push_back(i);
+        nodes.push_back(node);
+      }
+    }
+    if (nodes.empty()) {
+      return;
+    }
+    find_batch(pack, nodes.data(), nodes.size(), found.get());
+
+    std::fill(inPack.get(), inPack.get() + remaining.size(), false);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      inPack[candidates[i]] = found[i];
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < remaining.size(); ++i) {
+      if (!inPack[i]) {
+        remaining[kept++] = remaining[i];
+      }
+    }
+    remaining.resize(kept);
+  };
+
+  for (auto& it : packs_) {
+    if (remaining.empty()) {
+      break;
+    }
+    probe(it.second.get());
+  }
+
+  // Check if there are new packs available
+  if (!remaining.empty()) {
+    for (auto& pack : rescan()) {
+      if (remaining.empty()) {
+        break;
+      }
+      probe(pack.get());
+    }
+  }
+
+  std::sort(remaining.begin(), remaining.end());
+  std::vector<Key> missing;
+  missing.reserve(remaining.size());
+  for (auto index : remaining) {
+    missing.push_back(std::move(keys[index]));
+  }
+  return missing;
+}
+
 std::shared_ptr<KeyIterator> DatapackStore::getMissing(KeyIterator& missing) {
   return std::make_shared<DatapackStoreKeyIterator>(*this, missing);
 }
 
 std::vector<std::shared_ptr<datapack_handle_t>> DatapackStore::rescan() {
-  constexpr auto PACK_REFRESH_RATE = std::chrono::milliseconds(100);
-  auto now = steady_clock::now();
-
   std::vector<std::shared_ptr<datapack_handle_t>> newPacks;
+  if (watchFd_ >= 0) {
+    if (readWatchEvents(newPacks)) {
+      return newPacks;
+    }
+    // The watch is gone, so fall back to listing the directory, starting
+    // right away.
+    stopWatching();
+    nextRefresh_ = steady_clock::time_point();
+  }
+
+  auto now = steady_clock::now();
   if (nextRefresh_ <= now) {
-    auto availablePacks = getAvailablePackFileNames(path_);
-
-    // Garbage collect removed pack files
-    if (removeOnRefresh_) {
-      auto it = packs_.begin();
-      while (it != packs_.end()) {
-        if (availablePacks.find(it->first) == availablePacks.end()) {
-          // This pack file no longer exists, we
-          // can forget it
-          it = packs_.erase(it);
-          continue;
-        }
-        ++it;
+    scanDirectory(newPacks);
+    nextRefresh_ = now + refreshInterval_;
+  }
+
+  return newPacks;
+}
+
+void DatapackStore::scanDirectory(
+    std::vector<std::shared_ptr<datapack_handle_t>>& added) {
+  std::vector<std::string> bloomFilters;
+  auto availablePacks = getAvailablePackFileNames(
+      path_, useBloomFilters_ ? &bloomFilters : nullptr);
+
+  for (const auto& packPath : bloomFilters) {
+    if (availablePacks.find(packPath) == availablePacks.end()) {
+      removeBloomFilter(packPath);
+    }
+  }
+
+  // Garbage collect removed pack files
+  if (removeOnRefresh_) {
+    auto it = packs_.begin();
+    while (it != packs_.end()) {
+      if (availablePacks.find(it->first) == availablePacks.end()) {
+        // This pack file no longer exists, we
+        // can forget it
+        filters_.erase(it->second.get());
+        it = packs_.erase(it);
+        continue;
       }
+      ++it;
     }
+  }
 
-    // Add any newly discovered files
-    for (const auto& packPath : availablePacks) {
-      if (packs_.find(packPath) == packs_.end()) {
-        // We haven't loaded this path yet, do so now
-        auto newPack = addPack(packPath);
-        if (newPack) {
-          newPacks.push_back(std::move(newPack));
-        }
+  // Add any newly discovered files
+  for (const auto& packPath : availablePacks) {
+    if (packs_.find(packPath) == packs_.end()) {
+      // We haven't loaded this path yet, do so now
+      auto newPack = addPack(packPath);
+      if (newPack) {
+        added.push_back(std::move(newPack));
       }
     }
+  }
+}
+
+bool DatapackStore::readWatchEvents(
+    std::vector<std::shared_ptr<datapack_handle_t>>& added) {
+#ifdef __linux__
+  std::string prefix = getPackDirPrefix(path_);
+  std::unordered_set<std::string> created;
+  std::unordered_set<std::string> removed;
+
+  alignas(struct inotify_event) char buf[16 * 1024];
+  while (true) {
+    ssize_t length = read(watchFd_, buf, sizeof(buf));
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN) {
+        break;
+      }
+      return false;
+    }
+
+    for (char* ptr = buf; ptr < buf + length;) {
+      auto event = reinterpret_cast<struct inotify_event*>(ptr);
+      ptr += sizeof(struct inotify_event) + event->len;
 
-    nextRefresh_ = now + PACK_REFRESH_RATE;
+      if (event->mask &
+          (IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+        return false;
+      }
+      if (event->len == 0) {
+        continue;
+      }
+
+      size_t nameLength = strlen(event->name);
+      size_t suffixLength;
+      if (hasSuffix(event->name, nameLength, PACKSUFFIX)) {
+        suffixLength = PACKSUFFIXLEN;
+      } else if (hasSuffix(event->name, nameLength, INDEXSUFFIX)) {
+        suffixLength = INDEXSUFFIXLEN;
+      } else {
+        continue;
+      }
+      std::string packPath =
+          prefix + std::string(event->name, nameLength - suffixLength);
+      if (event->mask & (IN_MOVED_FROM | IN_DELETE)) {
+        created.erase(packPath);
+        removed.insert(std::move(packPath));
+      } else {
+        removed.erase(packPath);
+        created.insert(std::move(packPath));
+      }
+    }
   }
 
-  return newPacks;
+  if (useBloomFilters_) {
+    for (const auto& packPath : removed) {
+      removeBloomFilter(packPath);
+    }
+  }
+
+  if (removeOnRefresh_) {
+    for (const auto& packPath : removed) {
+      auto it = packs_.find(packPath);
+      if (it != packs_.end()) {
+        filters_.erase(it->second.get());
+        packs_.erase(it);
+      }
+    }
+  }
+
+  // A pack can only be opened once both of its files are in place; until
+  // then addPack() fails and the event for the second file retries it.
+  for (const auto& packPath : created) {
+    if (packs_.find(packPath) == packs_.end()) {
+      auto newPack = addPack(packPath);
+      if (newPack) {
+        added.push_back(std::move(newPack));
+      }
+    }
+  }
+  return true;
+#else
+  (void)added;
+  return false;
+#endif
 }
 
 void DatapackStore::refresh() {
@@ -22,15 +22,22 @@ extern "C" {
 #include <unordered_set>
 #include <vector>
 
+#include "edenscm/hgext/extlib/cstore/datapackbloomfilter.h"
 #include "edenscm/hgext/extlib/cstore/datastore.h"
 #include "edenscm/hgext/extlib/cstore/key.h"
 #include "lib/clib/portability/portability.h"
 
 class DatapackStore;
+/* Returns the keys of an iterator that are missing from a DatapackStore.
+ * The keys are all read and looked up in one batch on the first call to
+ * next(). */
 class DatapackStoreKeyIterator : public KeyIterator {
  private:
   DatapackStore& _store;
   KeyIterator& _missing;
+  bool _loaded{false};
+  std::vector<Key> _missingKeys;
+  size_t _index{0};
 
  public:
   DatapackStoreKeyIterator(DatapackStore& store, KeyIterator& missing)
@@ -44,11 +51,27 @@ class DatapackStore : public DataStore {
  private:
   std::string path_;
   std::chrono::steady_clock::time_point nextRefresh_;
+  std::chrono::milliseconds refreshInterval_{100};
+  // The inotify descriptor watching path_, or -1 when it is not watched.
+  int watchFd_{-1};
   bool removeOnRefresh_{false};
+  bool useBloomFilters_{false};
   std::unordered_map<std::string, std::shared_ptr<datapack_handle_t>> packs_;
+  std::unordered_map<
+      const datapack_handle_t*,
+      std::unique_ptr<DatapackBloomFilter>>
+      filters_;
 
   std::shared_ptr<datapack_handle_t> addPack(const std::string& path);
+  /* Returns false if the pack definitely does not contain the node. */
+  bool mayContain(const datapack_handle_t* pack, const uint8_t* node) const;
   std::vector<std::shared_ptr<datapack_handle_t>> rescan();
+  void scanDirectory(std::vector<std::shared_ptr<datapack_handle_t>>& added);
+  /* Adds and removes the packs that the watch reported since the last call.
+   * Returns false if the watch lost track of the directory, in which case
+   * it has to be listed again. */
+  bool readWatchEvents(std::vector<std::shared_ptr<datapack_handle_t>>& added);
+  void stopWatching();
 
  public:
   ~DatapackStore();
@@ -62,10 +85,25 @@ class DatapackStore : public DataStore {
    * responsibility of the calling code to ensure that the lifetime is
    * managed correctly as it cannot be enforced automatically without
    * restructing this API.
+   * If useBloomFilters is set to true, a bloom filter of each pack's index
+   * is loaded or built when the pack is added, and lookups skip the packs
+   * whose filter rules the key out.
    */
   explicit DatapackStore(
       const std::string& path,
-      bool removeDeadPackFilesOnRefresh = false);
+      bool removeDeadPackFilesOnRefresh = false,
+      bool useBloomFilters = false);
+
+  /* Watches the pack directory for added and removed packs, so that a
+   * rescan only looks at what changed instead of listing the directory.
+   * This is only supported on Linux.  Returns false if the directory cannot
+   * be watched, in which case rescans keep listing it, at most once per
+   * refresh interval. */
+  bool watchPackDirectory();
+
+  /* Sets how often a rescan may list the pack directory when it is not
+   * watched.  Defaults to 100ms. */
+  void setRefreshInterval(std::chrono::milliseconds interval);
 
   DeltaChainIterator getDeltaChain(const Key& key) override;
 
@@ -75,6 +113,10 @@ class DatapackStore : public DataStore {
 
   bool contains(const Key& key) override;
 
+  /* Returns the keys that are not in any pack, in the order given.  Each
+   * pack's index is walked once for the whole batch. */
+  std::vector<Key> getMissingBatch(std::vector<Key> keys);
+
   void markForRefresh() override;
 
   void refresh() override;
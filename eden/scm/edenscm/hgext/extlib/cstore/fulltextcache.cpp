@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+// fulltextcache.cpp - implementation of a cache of reconstructed fulltexts
+// no-check-code
+
+#include "edenscm/hgext/extlib/cstore/fulltextcache.h"
+
+namespace {
+
+std::string
+makeCacheKey(const char* name, size_t namelen, const uint8_t* node) {
+  std::string key;
+  key.reserve(namelen + 1 + BIN_NODE_SIZE);
+  key.append(name, namelen);
+  key.push_back('\0');
+  key.append((const char*)node, BIN_NODE_SIZE);
+  return key;
+}
+
+} // namespace
+
+FulltextCache::FulltextCache(size_t maxBytes) : maxBytes_(maxBytes) {}
+
+void FulltextCache::setMaxBytes(size_t maxBytes) {
+  maxBytes_ = maxBytes;
+  evict(maxBytes_);
+}
+
+std::shared_ptr<std::string>
+FulltextCache::get(const char* name, size_t namelen, const uint8_t* node) {
+  if (!enabled()) {
+    return nullptr;
+  }
+  auto it = index_.find(makeCacheKey(name, namelen, node));
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->text;
+}
+
+void FulltextCache::put(const Key& key, std::shared_ptr<std::string> text) {
+  if (!enabled() || text->size() > maxBytes_) {
+    return;
+  }
+  auto cacheKey = makeCacheKey(
+      key.name.data(), key.name.size(), (const uint8_t*)key.node);
+  if (index_.find(cacheKey) != index_.end()) {
+    return;
+  }
+
+  evict(maxBytes_ - text->size());
+  bytes_ += text->size();
+  entries_.push_front(Entry{cacheKey, std::move(text)});
+  index_.emplace(std::move(cacheKey), entries_.begin());
+}
+
+FulltextCache::Stats FulltextCache::getStats() const {
+  Stats stats = stats_;
+  stats.entries = index_.size();
+  stats.bytes = bytes_;
+  return stats;
+}
+
+void FulltextCache::evict(size_t maxBytes) {
+  while (bytes_ > maxBytes && !entries_.empty()) {
+    auto& entry = entries_.back();
+    bytes_ -= entry.text->size();
+    index_.erase(entry.key);
+    entries_.pop_back();
+    ++stats_.evictions;
+  }
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+// fulltextcache.h - c++ declarations for a cache of reconstructed fulltexts
+// no-check-code
+
+#ifndef FBHGEXT_CSTORE_FULLTEXTCACHE_H
+#define FBHGEXT_CSTORE_FULLTEXTCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "edenscm/hgext/extlib/cstore/key.h"
+
+/* A least recently used cache of the fulltexts that were rebuilt from delta
+ * chains, keyed by (name, node) and bounded by the total size of the texts.
+ * A limit of 0 (the default) disables the cache.
+ *
+ * Like the stores that use it, this class is not thread safe. */
+class FulltextCache {
+ public:
+  struct Stats {
+    /* Rebuilt texts whose chain walk stopped at a cached text. */
+    uint64_t hits{0};
+    /* Rebuilt texts whose chain walk reached the base fulltext. */
+    uint64_t misses{0};
+    uint64_t evictions{0};
+    uint64_t entries{0};
+    uint64_t bytes{0};
+  };
+
+  explicit FulltextCache(size_t maxBytes = 0);
+
+  bool enabled() const {
+    return maxBytes_ > 0;
+  }
+
+  /* Sets the most bytes of text to keep, evicting texts as needed. */
+  void setMaxBytes(size_t maxBytes);
+
+  /* Returns the cached text of the given name and node, or null. */
+  std::shared_ptr<std::string>
+  get(const char* name, size_t namelen, const uint8_t* node);
+
+  /* Caches the text of a key.  Texts larger than the limit are not cached. */
+  void put(const Key& key, std::shared_ptr<std::string> text);
+
+  void recordHit() {
+    ++stats_.hits;
+  }
+
+  void recordMiss() {
+    ++stats_.misses;
+  }
+
+  Stats getStats() const;
+
+ private:
+  struct Entry {
+    std::string key;
+    std::shared_ptr<std::string> text;
+  };
+  using EntryList = std::list<Entry>;
+
+  void evict(size_t maxBytes);
+
+  size_t maxBytes_;
+  size_t bytes_{0};
+  Stats stats_;
+  // Most recently used first.
+  EntryList entries_;
+  std::unordered_map<std::string, EntryList::iterator> index_;
+};
+
+#endif // FBHGEXT_CSTORE_FULLTEXTCACHE_H
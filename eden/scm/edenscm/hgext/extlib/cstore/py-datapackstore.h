@@ -473,9 +473,43 @@ static PyObject* uniondatapackstore_markforrefresh(
   Py_RETURN_NONE;
 }
 
-static PyObject* uniondatapackstore_getmetrics(
-    py_uniondatapackstore* /*self*/) {
-  return PyDict_New();
+static PyObject* uniondatapackstore_setfulltextcachelimit(
+    py_uniondatapackstore* self,
+    PyObject* args) {
+  Py_ssize_t maxBytes;
+  if (!PyArg_ParseTuple(args, "n", &maxBytes)) {
+    return NULL;
+  }
+  if (maxBytes < 0) {
+    PyErr_SetString(PyExc_ValueError, "cache limit must not be negative");
+    return NULL;
+  }
+  self->uniondatapackstore->setFulltextCacheLimit((size_t)maxBytes);
+  Py_RETURN_NONE;
+}
+
+static PyObject* uniondatapackstore_getmetrics(py_uniondatapackstore* self) {
+  try {
+    FulltextCache::Stats stats =
+        self->uniondatapackstore->getFulltextCacheStats();
+    PythonObj metrics = PyDict_New();
+    const std::pair<const char*, uint64_t> values[] = {
+        {"fulltextcachehits", stats.hits},
+        {"fulltextcachemisses", stats.misses},
+        {"fulltextcacheevictions", stats.evictions},
+        {"fulltextcacheentries", stats.entries},
+        {"fulltextcachebytes", stats.bytes},
+    };
+    for (const auto& value : values) {
+      PythonObj number = PyLong_FromUnsignedLongLong(value.second);
+      if (PyDict_SetItemString(metrics, value.first, number) < 0) {
+        return NULL;
+      }
+    }
+    return metrics.returnval();
+  } catch (const pyexception& ex) {
+    return NULL;
+  }
 }
 
 // --------- UnionDatapackStore Declaration ---------
@@ -493,6 +527,10 @@ static PyMethodDef uniondatapackstore_methods[] = {
      (PyCFunction)uniondatapackstore_markforrefresh,
      METH_NOARGS,
      ""},
+    {"setfulltextcachelimit",
+     (PyCFunction)uniondatapackstore_setfulltextcachelimit,
+     METH_VARARGS,
+     ""},
     {"getmetrics", (PyCFunction)uniondatapackstore_getmetrics, METH_NOARGS, ""},
     {NULL, NULL}};
 
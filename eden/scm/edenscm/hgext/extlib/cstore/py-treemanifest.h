@@ -423,16 +423,18 @@ treemanifest_diff(PyObject* o, PyObject* args, PyObject* kwargs) {
   PyObject* otherObj;
   PyObject* matcherObj = NULL;
   PyObject* cleanObj = NULL;
-  static char const* kwlist[] = {"m2", "matcher", "clean", NULL};
+  PyObject* prefetchObj = NULL;
+  static char const* kwlist[] = {"m2", "matcher", "clean", "prefetch", NULL};
 
   if (!PyArg_ParseTupleAndKeywords(
           args,
           kwargs,
-          "O|OO",
+          "O|OOO",
           (char**)kwlist,
           &otherObj,
           &matcherObj,
-          &cleanObj)) {
+          &cleanObj,
+          &prefetchObj)) {
     return NULL;
   }
 
@@ -456,6 +458,13 @@ treemanifest_diff(PyObject* o, PyObject* args, PyObject* kwargs) {
     clean = true;
   }
 
+  // status and diff call diff() without arguments beyond the matcher, so
+  // batching subtree fetches is on unless a caller opts out.
+  bool prefetch = true;
+  if (prefetchObj && !PyObject_IsTrue(prefetchObj)) {
+    prefetch = false;
+  }
+
   PythonDiffResult results(PyDict_New());
 
   ManifestFetcher fetcher = self->tm.fetcher;
@@ -471,7 +480,8 @@ treemanifest_diff(PyObject* o, PyObject* args, PyObject* kwargs) {
         results,
         fetcher,
         clean,
-        *matcherPtr);
+        *matcherPtr,
+        prefetch);
   } catch (const pyexception& ex) {
     // Python has already set the error message
     return NULL;
@@ -1339,7 +1349,8 @@ static PyObject* treemanifest_filesnotin(
         diffresults,
         fetcher,
         /*clean=*/false,
-        *matcherPtr);
+        *matcherPtr,
+        /*prefetch=*/true);
   } catch (const pyexception& ex) {
     // Python has already set the error message
     return NULL;
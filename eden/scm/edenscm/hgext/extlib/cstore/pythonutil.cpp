@@ -124,6 +124,28 @@ ConstantStringRef PythonStore::get(const Key& key) {
   return ConstantStringRef(path, pathlen);
 }
 
+void PythonStore::prefetch(const std::vector<Key>& keys) {
+  if (keys.empty() || !PyObject_HasAttrString(_storeObj, "prefetch")) {
+    return;
+  }
+
+  PythonObj keylist = PyList_New(0);
+  for (const Key& key : keys) {
+    PythonObj tuple = Py_BuildValue(
+        "(s#s#)",
+        key.name.c_str(),
+        (Py_ssize_t)key.name.size(),
+        key.node,
+        (Py_ssize_t)BIN_NODE_SIZE);
+    if (PyList_Append(keylist, tuple)) {
+      throw pyexception();
+    }
+  }
+
+  PythonObj arglist = Py_BuildValue("(O)", (PyObject*)keylist);
+  _storeObj.callmethod("prefetch", arglist);
+}
+
 bool PythonMatcher::matches(const std::string& path) {
   PythonObj matchArgs =
       Py_BuildValue("(s#)", path.c_str(), (Py_ssize_t)path.size());
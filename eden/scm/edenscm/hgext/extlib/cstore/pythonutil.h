@@ -98,6 +98,10 @@ class PythonStore : public Store {
   virtual ~PythonStore() {}
 
   ConstantStringRef get(const Key& key);
+
+  /* Calls the store's prefetch() with a list of (name, node) tuples, if the
+   * store has one. */
+  void prefetch(const std::vector<Key>& keys);
 };
 
 class PythonMatcher : public Matcher {
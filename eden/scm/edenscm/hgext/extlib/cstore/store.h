@@ -13,6 +13,7 @@
 
 #include <cstddef>
 #include <memory>
+#include <vector>
 
 #include "edenscm/hgext/extlib/cstore/key.h"
 
@@ -53,6 +54,11 @@ class Store {
  public:
   virtual ~Store() {}
   virtual ConstantStringRef get(const Key& key) = 0;
+
+  /* Hints that the given keys are about to be read, so that a store that
+   * fetches them from elsewhere can do so in one batch.  Does nothing by
+   * default. */
+  virtual void prefetch(const std::vector<Key>& /*keys*/) {}
 };
 
 #endif // FBHGEXT_CSTORE_STORE_H
@@ -29,70 +29,93 @@ UnionDatapackStore::~UnionDatapackStore() {
   // refcount in the py_uniondatapackstore type.
 }
 
-mpatch_flist* getNextLink(void* container, ssize_t index) {
-  std::vector<DeltaChainLink>* links = (std::vector<DeltaChainLink>*)container;
-
-  if (index < 0 || (size_t)index >= links->size()) {
-    return NULL;
-  }
-
-  DeltaChainLink link = links->at(index);
-
-  struct mpatch_flist* res;
-  if ((mpatch_decode(
-          (const char*)link.delta(), (ssize_t)link.deltasz(), &res)) < 0) {
-    throw std::logic_error("invalid patch during patch application");
-  }
-
-  return res;
-}
-
 ConstantStringRef UnionDatapackStore::get(const Key& key) {
   UnionDeltaChainIterator chain = this->getDeltaChain(key);
 
   std::vector<DeltaChainLink> links;
+  std::shared_ptr<std::string> cachedBase;
 
   for (DeltaChainLink link = chain.next(); !link.isdone();
        link = chain.next()) {
+    cachedBase =
+        _fulltextCache.get(link.filename(), link.filenamesz(), link.node());
+    if (cachedBase) {
+      break;
+    }
     links.push_back(link);
   }
 
-  DeltaChainLink fulltextLink = links.back();
-  links.pop_back();
+  const char* base;
+  size_t basesz;
+  if (cachedBase) {
+    _fulltextCache.recordHit();
+    if (links.size() == 0) {
+      return ConstantStringRef(cachedBase);
+    }
+    base = cachedBase->data();
+    basesz = cachedBase->size();
+  } else {
+    DeltaChainLink fulltextLink = links.back();
+    links.pop_back();
+
+    // Short circuit and just return the full text if it's one long
+    if (links.size() == 0) {
+      return ConstantStringRef(
+          (const char*)fulltextLink.delta(), (size_t)fulltextLink.deltasz());
+    }
+    _fulltextCache.recordMiss();
+    base = (const char*)fulltextLink.delta();
+    basesz = (size_t)fulltextLink.deltasz();
+  }
 
-  // Short circuit and just return the full text if it's one long
-  if (links.size() == 0) {
-    return ConstantStringRef(
-        (const char*)fulltextLink.delta(), (size_t)fulltextLink.deltasz());
+  std::vector<mpatch_bin> bins;
+  bins.reserve(links.size());
+  for (auto it = links.rbegin(); it != links.rend(); ++it) {
+    bins.push_back({(const char*)it->delta(), (ssize_t)it->deltasz()});
   }
 
-  std::reverse(links.begin(), links.end());
+  // Fold the whole chain into one hunk list in _foldArena, which is sized
+  // up front, so that no allocations are needed for the intermediate lists.
+  ssize_t arenasize = mpatch_foldsize(bins.data(), (ssize_t)bins.size());
+  if (arenasize < 0) {
+    throw std::logic_error("invalid patch during patch application");
+  }
+  if (_foldArena.size() < (size_t)arenasize) {
+    _foldArena.resize(arenasize);
+  }
 
-  mpatch_flist* patch = mpatch_fold(&links, getNextLink, 0, links.size());
-  if (!patch) { /* error already set or memory error */
+  mpatch_flist patch;
+  if (mpatch_foldinto(
+          bins.data(),
+          (ssize_t)bins.size(),
+          _foldArena.data(),
+          _foldArena.size(),
+          &patch) < 0) {
     throw std::logic_error("mpatch failed to fold patches");
   }
 
-  ssize_t outlen = mpatch_calcsize((ssize_t)fulltextLink.deltasz(), patch);
+  ssize_t outlen = mpatch_calcsize((ssize_t)basesz, &patch);
   if (outlen < 0) {
-    mpatch_lfree(patch);
     throw std::logic_error("mpatch failed to calculate size");
   }
 
   auto result = std::make_shared<std::string>(outlen, '\0');
-  if (mpatch_apply(
-          &(*result)[0],
-          (const char*)fulltextLink.delta(),
-          (ssize_t)fulltextLink.deltasz(),
-          patch) < 0) {
-    mpatch_lfree(patch);
+  if (mpatch_apply(&(*result)[0], base, (ssize_t)basesz, &patch) < 0) {
     throw std::logic_error("mpatch failed to apply patches");
   }
 
-  mpatch_lfree(patch);
+  _fulltextCache.put(key, result);
   return ConstantStringRef(result);
 }
 
+void UnionDatapackStore::setFulltextCacheLimit(size_t maxBytes) {
+  _fulltextCache.setMaxBytes(maxBytes);
+}
+
+FulltextCache::Stats UnionDatapackStore::getFulltextCacheStats() const {
+  return _fulltextCache.getStats();
+}
+
 std::shared_ptr<DeltaChain> UnionDeltaChainIterator::getNextChain(
     const Key& key) {
   for (std::vector<DataStore*>::iterator it = _store._stores.begin();
@@ -114,14 +137,19 @@ UnionDeltaChainIterator UnionDatapackStore::getDeltaChain(const Key& key) {
 }
 
 Key* UnionDatapackStoreKeyIterator::next() {
-  Key* key;
-  while ((key = _missing.next()) != NULL) {
-    if (!_store.contains(*key)) {
-      return key;
+  if (!_started) {
+    _started = true;
+    KeyIterator* missing = &_missing;
+    for (DataStore* substore : _store._stores) {
+      _iterators.push_back(substore->getMissing(*missing));
+      missing = _iterators.back().get();
     }
   }
 
-  return NULL;
+  if (_iterators.empty()) {
+    return _missing.next();
+  }
+  return _iterators.back()->next();
 }
 
 bool UnionDatapackStore::contains(const Key& key) {
@@ -12,6 +12,7 @@
 #define FBHGEXT_CSTORE_UNIONDATAPACKSTORE_H
 
 #include <cstring>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -20,14 +21,20 @@ extern "C" {
 }
 
 #include "edenscm/hgext/extlib/cstore/datapackstore.h"
+#include "edenscm/hgext/extlib/cstore/fulltextcache.h"
 #include "edenscm/hgext/extlib/cstore/key.h"
 #include "edenscm/hgext/extlib/cstore/store.h"
 
 class UnionDatapackStore;
+/* Returns the keys of an iterator that are missing from every store of a
+ * UnionDatapackStore.  The keys are filtered through each store's
+ * getMissing() in turn, so that stores can look them up in batches. */
 class UnionDatapackStoreKeyIterator : public KeyIterator {
  private:
   UnionDatapackStore& _store;
   KeyIterator& _missing;
+  bool _started{false};
+  std::vector<std::shared_ptr<KeyIterator>> _iterators;
 
  public:
   UnionDatapackStoreKeyIterator(UnionDatapackStore& store, KeyIterator& missing)
@@ -51,6 +58,11 @@ class UnionDeltaChainIterator : public DeltaChainIterator {
 };
 
 class UnionDatapackStore : public Store {
+ private:
+  FulltextCache _fulltextCache;
+  // Scratch space for folding delta chains, reused across get() calls.
+  std::vector<char> _foldArena;
+
  public:
   std::vector<DataStore*> _stores;
 
@@ -60,8 +72,16 @@ class UnionDatapackStore : public Store {
 
   ~UnionDatapackStore() override;
 
+  /* Returns the fulltext of a key.  If the fulltext cache is enabled, the
+   * delta chain is only walked back to the nearest cached text, and the
+   * result is cached in turn. */
   ConstantStringRef get(const Key& key) override;
 
+  /* Sets the most bytes of rebuilt fulltexts to cache; 0 disables it. */
+  void setFulltextCacheLimit(size_t maxBytes);
+
+  FulltextCache::Stats getFulltextCacheStats() const;
+
   UnionDeltaChainIterator getDeltaChain(const Key& key);
 
   bool contains(const Key& key);
@@ -9,17 +9,26 @@
 
 #include "edenscm/hgext/extlib/ctreemanifest/manifest.h"
 
+#include <algorithm>
+
 #include "lib/clib/sha1.h"
 
 Manifest::Manifest(ConstantStringRef& rawobj, const char* node)
-    : _rawobj(rawobj), _refcount(0), _mutable(false) {
+    : _rawobj(rawobj),
+      _refcount(0),
+      _mutable(false),
+      entries(ManifestArenaAllocator<ManifestEntry>(&_arena)) {
   const char* parseptr = _rawobj.content();
   const char* endptr = parseptr + _rawobj.size();
 
+  // Each entry ends with a newline, which the entry's name and node cannot
+  // contain.
+  size_t count = std::count(parseptr, endptr, '\n');
+  _arena.reserve(count);
+
   while (parseptr < endptr) {
-    ManifestEntry entry;
-    parseptr = entry.initialize(parseptr);
-    entries.push_back(entry);
+    entries.emplace_back();
+    parseptr = entries.back().initialize(parseptr);
   }
 
   if (!node) {
@@ -32,8 +41,9 @@ Manifest::Manifest(ConstantStringRef& rawobj, const char* node)
 ManifestPtr Manifest::copy() {
   ManifestPtr copied(new Manifest());
   copied->_rawobj = this->_rawobj;
+  copied->_arena.reserve(this->entries.size());
 
-  for (std::list<ManifestEntry>::iterator thisIter = this->entries.begin();
+  for (ManifestEntryList::iterator thisIter = this->entries.begin();
        thisIter != this->entries.end();
        thisIter++) {
     copied->addChild(copied->entries.end(), &(*thisIter));
@@ -51,13 +61,18 @@ SortedManifestIterator Manifest::getSortedIterator() {
   if (this->entries.size() != this->mercurialSortedEntries.size()) {
     this->mercurialSortedEntries.clear();
 
-    for (std::list<ManifestEntry>::iterator iterator = this->entries.begin();
+    this->mercurialSortedEntries.reserve(this->entries.size());
+
+    for (ManifestEntryList::iterator iterator = this->entries.begin();
          iterator != this->entries.end();
          iterator++) {
       this->mercurialSortedEntries.push_back(&(*iterator));
     }
 
-    this->mercurialSortedEntries.sort(ManifestEntry::compareMercurialOrder);
+    std::stable_sort(
+        this->mercurialSortedEntries.begin(),
+        this->mercurialSortedEntries.end(),
+        ManifestEntry::compareMercurialOrder);
   }
 
   return SortedManifestIterator(
@@ -69,12 +84,12 @@ SortedManifestIterator Manifest::getSortedIterator() {
  * filename.  If a child with the same name already exists, *exacthit will
  * be set to true.  Otherwise, it will be set to false.
  */
-std::list<ManifestEntry>::iterator Manifest::findChild(
+ManifestEntryList::iterator Manifest::findChild(
     const char* filename,
     const size_t filenamelen,
     FindResultType resulttype,
     bool* exacthit) {
-  for (std::list<ManifestEntry>::iterator iter = this->entries.begin();
+  for (ManifestEntryList::iterator iter = this->entries.begin();
        iter != this->entries.end();
        iter++) {
     size_t minlen =
@@ -109,7 +124,7 @@ std::list<ManifestEntry>::iterator Manifest::findChild(
 }
 
 ManifestEntry* Manifest::addChild(
-    std::list<ManifestEntry>::iterator iterator,
+    ManifestEntryList::iterator iterator,
     const char* filename,
     const size_t filenamelen,
     const char* node,
@@ -136,7 +151,7 @@ ManifestEntry* Manifest::addChild(
 }
 
 ManifestEntry* Manifest::addChild(
-    std::list<ManifestEntry>::iterator iterator,
+    ManifestEntryList::iterator iterator,
     ManifestEntry* otherChild) {
   if (!this->isMutable()) {
     throw std::logic_error("attempting to mutate immutable Manifest");
@@ -157,8 +172,8 @@ ManifestEntry* Manifest::addChild(
 }
 
 ManifestIterator::ManifestIterator(
-    std::list<ManifestEntry>::iterator iterator,
-    std::list<ManifestEntry>::const_iterator end)
+    ManifestEntryList::iterator iterator,
+    ManifestEntryList::const_iterator end)
     : iterator(iterator), end(end) {}
 
 ManifestEntry* ManifestIterator::next() {
@@ -185,8 +200,8 @@ bool ManifestIterator::isfinished() const {
 }
 
 SortedManifestIterator::SortedManifestIterator(
-    std::list<ManifestEntry*>::iterator iterator,
-    std::list<ManifestEntry*>::const_iterator end)
+    std::vector<ManifestEntry*>::iterator iterator,
+    std::vector<ManifestEntry*>::const_iterator end)
     : iterator(iterator), end(end) {}
 
 ManifestEntry* SortedManifestIterator::next() {
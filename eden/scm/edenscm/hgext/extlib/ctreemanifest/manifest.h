@@ -13,8 +13,10 @@
 #include <cstring>
 #include <list>
 #include <stdexcept>
+#include <vector>
 
 #include "edenscm/hgext/extlib/cstore/store.h"
+#include "edenscm/hgext/extlib/ctreemanifest/manifest_arena.h"
 #include "edenscm/hgext/extlib/ctreemanifest/manifest_entry.h"
 #include "edenscm/hgext/extlib/ctreemanifest/manifest_ptr.h"
 #include "lib/clib/convert.h"
@@ -22,6 +24,9 @@
 class ManifestIterator;
 class SortedManifestIterator;
 
+typedef std::list<ManifestEntry, ManifestArenaAllocator<ManifestEntry>>
+    ManifestEntryList;
+
 enum FindResultType {
   RESULT_FILE,
   RESULT_DIRECTORY,
@@ -43,6 +48,10 @@ enum FindResultType {
  * If the actual manifest data comes from an InMemoryManifest, then the life
  * time of that InMemoryManifest is managed elsewhere, and is unaffected by the
  * existence of Manifest objects that view into it.
+ *
+ * The entries are allocated from an arena owned by the Manifest, so that a
+ * manifest parsed from the store costs a single allocation for all of its
+ * entries and walking it does not chase pointers all over the heap.
  */
 class Manifest {
  private:
@@ -51,16 +60,26 @@ class Manifest {
   bool _mutable;
   char _node[BIN_NODE_SIZE];
 
-  std::list<ManifestEntry> entries;
-  std::list<ManifestEntry*> mercurialSortedEntries;
+  // Must be declared before entries, which allocates from it.
+  ManifestArena _arena;
+  ManifestEntryList entries;
+  std::vector<ManifestEntry*> mercurialSortedEntries;
 
  public:
-  Manifest() : _refcount(0), _mutable(true) {
+  Manifest()
+      : _refcount(0),
+        _mutable(true),
+        entries(ManifestArenaAllocator<ManifestEntry>(&_arena)) {
     memcpy(this->_node, NULLID, BIN_NODE_SIZE);
   }
 
   Manifest(ConstantStringRef& rawobj, const char* node);
 
+  // The entries refer to this Manifest's arena, so it cannot be copied; use
+  // copy() instead.
+  Manifest(const Manifest&) = delete;
+  Manifest& operator=(const Manifest&) = delete;
+
   void incref();
   size_t decref();
 
@@ -87,7 +106,7 @@ class Manifest {
    * and directory/file status already exists, *exacthit will be set to
    * true.  Otherwise, it will be set to false.
    */
-  std::list<ManifestEntry>::iterator findChild(
+  ManifestEntryList::iterator findChild(
       const char* filename,
       const size_t filenamelen,
       FindResultType resulttype,
@@ -101,7 +120,7 @@ class Manifest {
    * @param filenamelen
    */
   ManifestEntry* addChild(
-      std::list<ManifestEntry>::iterator iterator,
+      ManifestEntryList::iterator iterator,
       const char* filename,
       const size_t filenamelen,
       const char* node,
@@ -111,7 +130,7 @@ class Manifest {
    * Adds a deep copy of the given ManifestEntry as a child.
    */
   ManifestEntry* addChild(
-      std::list<ManifestEntry>::iterator iterator,
+      ManifestEntryList::iterator iterator,
       ManifestEntry* otherChild);
 
   size_t children() const {
@@ -123,7 +142,7 @@ class Manifest {
    * @param iterator iterator for this->entries, correctly positioned for
    *                 the child.
    */
-  void removeChild(std::list<ManifestEntry>::iterator iterator) {
+  void removeChild(ManifestEntryList::iterator iterator) {
     if (!this->isMutable()) {
       throw std::logic_error("attempting to mutate immutable Manifest");
     }
@@ -154,15 +173,15 @@ class Manifest {
  */
 class ManifestIterator {
  private:
-  std::list<ManifestEntry>::iterator iterator;
-  std::list<ManifestEntry>::const_iterator end;
+  ManifestEntryList::iterator iterator;
+  ManifestEntryList::const_iterator end;
 
  public:
   ManifestIterator() {}
 
   ManifestIterator(
-      std::list<ManifestEntry>::iterator iterator,
-      std::list<ManifestEntry>::const_iterator end);
+      ManifestEntryList::iterator iterator,
+      ManifestEntryList::const_iterator end);
 
   ManifestEntry* next();
 
@@ -177,15 +196,15 @@ class ManifestIterator {
  */
 class SortedManifestIterator {
  private:
-  std::list<ManifestEntry*>::iterator iterator;
-  std::list<ManifestEntry*>::const_iterator end;
+  std::vector<ManifestEntry*>::iterator iterator;
+  std::vector<ManifestEntry*>::const_iterator end;
 
  public:
   SortedManifestIterator() {}
 
   SortedManifestIterator(
-      std::list<ManifestEntry*>::iterator iterator,
-      std::list<ManifestEntry*>::const_iterator end);
+      std::vector<ManifestEntry*>::iterator iterator,
+      std::vector<ManifestEntry*>::const_iterator end);
 
   ManifestEntry* next();
 
@@ -0,0 +1,134 @@
+// Copyright (c) 2004-present, Facebook, Inc.
+// All Rights Reserved.
+//
+// This software may be used and distributed according to the terms of the
+// GNU General Public License version 2 or any later version.
+
+// manifest_arena.h - arena allocator for the entries of a manifest
+// no-check-code
+
+#ifndef FBHGEXT_CTREEMANIFEST_MANIFEST_ARENA_H
+#define FBHGEXT_CTREEMANIFEST_MANIFEST_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * Hands out memory from a few large blocks, which are only freed when the
+ * arena is destroyed.  A Manifest allocates all of its entries from its own
+ * arena, so that they are close together in memory and cost one allocation
+ * instead of one each.
+ *
+ * Memory that is given back is kept on a free list and reused by later
+ * allocations of the same size, so that a mutable manifest that has
+ * children added and removed repeatedly does not keep growing.
+ */
+class ManifestArena {
+ public:
+  ManifestArena() = default;
+  ManifestArena(const ManifestArena&) = delete;
+  ManifestArena& operator=(const ManifestArena&) = delete;
+
+  /**
+   * Makes the next block large enough for count allocations of the size of
+   * the next allocation, such as when the number of entries of a manifest is
+   * known up front.
+   */
+  void reserve(size_t count) {
+    _reservedCount = count;
+  }
+
+  void* allocate(size_t size) {
+    size = roundUp(size);
+    if (_freeList && size == _freeSize) {
+      void* result = _freeList;
+      _freeList = *static_cast<void**>(_freeList);
+      return result;
+    }
+
+    if (size > _remaining || _reservedCount > 0) {
+      size_t blockSize =
+          (_reservedCount > 0 ? _reservedCount : kBlockAllocations) * size;
+      _blocks.emplace_back(new char[blockSize]);
+      _cursor = _blocks.back().get();
+      _remaining = blockSize;
+      _reservedCount = 0;
+    }
+    void* result = _cursor;
+    _cursor += size;
+    _remaining -= size;
+    return result;
+  }
+
+  void deallocate(void* ptr, size_t size) {
+    size = roundUp(size);
+    // Every allocation of a manifest's entry list has the same size, so a
+    // single free list covers them; anything else is simply dropped.
+    if (!_freeList) {
+      _freeSize = size;
+    }
+    if (size == _freeSize) {
+      *static_cast<void**>(ptr) = _freeList;
+      _freeList = ptr;
+    }
+  }
+
+ private:
+  static constexpr size_t kAlignment = alignof(std::max_align_t);
+  // The number of allocations per block when nothing was reserved.
+  static constexpr size_t kBlockAllocations = 16;
+
+  static size_t roundUp(size_t size) {
+    return (size + kAlignment - 1) / kAlignment * kAlignment;
+  }
+
+  std::vector<std::unique_ptr<char[]>> _blocks;
+  char* _cursor{nullptr};
+  size_t _remaining{0};
+  size_t _reservedCount{0};
+  void* _freeList{nullptr};
+  size_t _freeSize{0};
+};
+
+/**
+ * Standard allocator that allocates from a ManifestArena.
+ */
+template <typename T>
+class ManifestArenaAllocator {
+ public:
+  typedef T value_type;
+
+  explicit ManifestArenaAllocator(ManifestArena* arena) : _arena(arena) {}
+
+  template <typename U>
+  ManifestArenaAllocator(const ManifestArenaAllocator<U>& other)
+      : _arena(other.arena()) {}
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(_arena->allocate(count * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, size_t count) {
+    _arena->deallocate(ptr, count * sizeof(T));
+  }
+
+  ManifestArena* arena() const {
+    return _arena;
+  }
+
+  template <typename U>
+  bool operator==(const ManifestArenaAllocator<U>& other) const {
+    return _arena == other.arena();
+  }
+
+  template <typename U>
+  bool operator!=(const ManifestArenaAllocator<U>& other) const {
+    return _arena != other.arena();
+  }
+
+ private:
+  ManifestArena* _arena;
+};
+
+#endif // FBHGEXT_CTREEMANIFEST_MANIFEST_ARENA_H
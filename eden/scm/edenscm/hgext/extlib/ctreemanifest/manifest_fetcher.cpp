@@ -26,3 +26,7 @@ ManifestPtr ManifestFetcher::get(
       _store->get(Key(path, pathlen, node.c_str(), node.size()));
   return ManifestPtr(new Manifest(content, node.c_str()));
 }
+
+void ManifestFetcher::prefetch(const std::vector<Key>& keys) const {
+  _store->prefetch(keys);
+}
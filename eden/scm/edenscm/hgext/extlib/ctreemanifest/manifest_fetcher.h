@@ -12,6 +12,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "edenscm/hgext/extlib/cstore/store.h"
 #include "edenscm/hgext/extlib/ctreemanifest/manifest_ptr.h"
@@ -31,6 +32,12 @@ class ManifestFetcher {
    * Returns the manifest if found, or throws an exception if not found.
    */
   ManifestPtr get(const char* path, size_t pathlen, std::string& node) const;
+
+  /**
+   * Asks the store to fetch the given manifest keys in one batch, ahead of
+   * the get() calls for them.
+   */
+  void prefetch(const std::vector<Key>& keys) const;
 };
 
 #endif // FBHGEXT_CTREEMANIFEST_MANIFEST_FETCHER_H
@@ -10,6 +10,7 @@
 
 #include <cstddef>
 #include <stdexcept>
+#include <utility>
 
 #include "edenscm/hgext/extlib/ctreemanifest/manifest.h"
 
@@ -28,6 +29,11 @@ ManifestPtr::ManifestPtr(const ManifestPtr& other) : manifest(other.manifest) {
   }
 }
 
+ManifestPtr::ManifestPtr(ManifestPtr&& other) noexcept
+    : manifest(other.manifest) {
+  other.manifest = NULL;
+}
+
 ManifestPtr::~ManifestPtr() {
   if (this->manifest && this->manifest->decref() == 0) {
     delete (this->manifest);
@@ -45,6 +51,12 @@ ManifestPtr& ManifestPtr::operator=(const ManifestPtr& other) {
   return *this;
 }
 
+ManifestPtr& ManifestPtr::operator=(ManifestPtr&& other) noexcept {
+  // other releases the reference this held when it is destroyed.
+  std::swap(this->manifest, other.manifest);
+  return *this;
+}
+
 ManifestPtr::operator Manifest*() const {
   return this->manifest;
 }
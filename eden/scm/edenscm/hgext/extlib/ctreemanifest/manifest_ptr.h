@@ -22,10 +22,16 @@ class ManifestPtr {
 
   ManifestPtr(const ManifestPtr& other);
 
+  // Moving a ManifestPtr hands over its reference without touching the
+  // refcount.
+  ManifestPtr(ManifestPtr&& other) noexcept;
+
   ~ManifestPtr();
 
   ManifestPtr& operator=(const ManifestPtr& other);
 
+  ManifestPtr& operator=(ManifestPtr&& other) noexcept;
+
   operator Manifest*() const;
 
   Manifest* operator->() const;
@@ -11,9 +11,74 @@
 
 #include <cassert>
 #include <limits>
+#include <unordered_map>
+
+/**
+ * Adds the subdirectories of mf that a diff against othermf will descend
+ * into, and that are not loaded yet, to keys.
+ */
+static void treemanifest_collectsubtrees(
+    Manifest* mf,
+    Manifest* othermf,
+    const std::string& path,
+    bool clean,
+    Matcher& matcher,
+    std::vector<Key>& keys) {
+  if (mf == NULL) {
+    return;
+  }
+
+  // The nodes of the other side's directories, to skip unchanged subtrees.
+  std::unordered_map<std::string, const char*> othernodes;
+  if (othermf != NULL && !clean) {
+    ManifestIterator iter = othermf->getIterator();
+    ManifestEntry* entry;
+    while ((entry = iter.next()) != NULL) {
+      if (entry->isdirectory() && entry->hasNode()) {
+        othernodes[std::string(entry->filename, entry->filenamelen)] =
+            entry->get_node();
+      }
+    }
+  }
+
+  std::string childpath(path);
+  ManifestIterator iter = mf->getIterator();
+  ManifestEntry* entry;
+  while ((entry = iter.next()) != NULL) {
+    if (!entry->isdirectory() || !entry->resolved.isnull() ||
+        !entry->hasNode()) {
+      continue;
+    }
+    if (!othernodes.empty()) {
+      auto other =
+          othernodes.find(std::string(entry->filename, entry->filenamelen));
+      if (other != othernodes.end() &&
+          memcmp(other->second, entry->get_node(), HEX_NODE_SIZE) == 0) {
+        continue;
+      }
+    }
+
+    childpath.erase(path.size());
+    entry->appendtopath(childpath);
+    if (!matcher.visitdir(childpath)) {
+      continue;
+    }
+    std::string binnode = binfromhex(entry->get_node());
+    keys.emplace_back(
+        childpath.c_str(),
+        childpath.size() - 1, // without the trailing slash
+        binnode.c_str(),
+        binnode.size());
+  }
+}
 
 /**
  * Helper function that performs the actual recursion on the tree entries.
+ *
+ * If prefetch is true, the subdirectories of each pair of manifests that
+ * are about to be compared are requested from the store in one batch before
+ * descending into any of them, rather than one at a time as the recursion
+ * reaches them.
  */
 void treemanifest_diffrecurse(
     Manifest* selfmf,
@@ -22,10 +87,20 @@ void treemanifest_diffrecurse(
     DiffResult& diff,
     const ManifestFetcher& fetcher,
     bool clean,
-    Matcher& matcher) {
+    Matcher& matcher,
+    bool prefetch) {
   ManifestIterator selfiter;
   ManifestIterator otheriter;
 
+  if (prefetch) {
+    std::vector<Key> keys;
+    treemanifest_collectsubtrees(selfmf, othermf, path, clean, matcher, keys);
+    treemanifest_collectsubtrees(othermf, selfmf, path, clean, matcher, keys);
+    if (!keys.empty()) {
+      fetcher.prefetch(keys);
+    }
+  }
+
   if (selfmf != NULL) {
     selfiter = selfmf->getIterator();
   }
@@ -75,7 +150,14 @@ void treemanifest_diffrecurse(
           Manifest* selfchildmanifest =
               selfentry->get_manifest(fetcher, path.c_str(), path.size());
           treemanifest_diffrecurse(
-              selfchildmanifest, NULL, path, diff, fetcher, clean, matcher);
+              selfchildmanifest,
+              NULL,
+              path,
+              diff,
+              fetcher,
+              clean,
+              matcher,
+              prefetch);
         }
       } else if (matcher.matches(path)) {
         diff.add(path, selfbinnode.c_str(), selfentry->flag, NULL, NULL);
@@ -89,7 +171,14 @@ void treemanifest_diffrecurse(
           Manifest* otherchildmanifest =
               otherentry->get_manifest(fetcher, path.c_str(), path.size());
           treemanifest_diffrecurse(
-              NULL, otherchildmanifest, path, diff, fetcher, clean, matcher);
+              NULL,
+              otherchildmanifest,
+              path,
+              diff,
+              fetcher,
+              clean,
+              matcher,
+              prefetch);
         }
       } else if (matcher.matches(path)) {
         diff.add(path, NULL, NULL, otherbinnode.c_str(), otherentry->flag);
@@ -120,7 +209,8 @@ void treemanifest_diffrecurse(
               diff,
               fetcher,
               clean,
-              matcher);
+              matcher,
+              prefetch);
         }
       } else if (selfentry->isdirectory() && !otherentry->isdirectory()) {
         if (matcher.matches(path)) {
@@ -133,7 +223,14 @@ void treemanifest_diffrecurse(
           Manifest* selfchildmanifest =
               selfentry->get_manifest(fetcher, path.c_str(), path.size());
           treemanifest_diffrecurse(
-              selfchildmanifest, NULL, path, diff, fetcher, clean, matcher);
+              selfchildmanifest,
+              NULL,
+              path,
+              diff,
+              fetcher,
+              clean,
+              matcher,
+              prefetch);
         }
       } else if (!selfentry->isdirectory() && otherentry->isdirectory()) {
         if (matcher.matches(path)) {
@@ -146,7 +243,14 @@ void treemanifest_diffrecurse(
           Manifest* otherchildmanifest =
               otherentry->get_manifest(fetcher, path.c_str(), path.size());
           treemanifest_diffrecurse(
-              NULL, otherchildmanifest, path, diff, fetcher, clean, matcher);
+              NULL,
+              otherchildmanifest,
+              path,
+              diff,
+              fetcher,
+              clean,
+              matcher,
+              prefetch);
         }
       } else {
         // both are files
@@ -219,7 +323,7 @@ FindResult treemanifest::find(
   } else {
     // position the iterator at the right location
     bool exacthit;
-    std::list<ManifestEntry>::iterator iterator =
+    ManifestEntryList::iterator iterator =
         manifest->findChild(word, wordlen, RESULT_DIRECTORY, &exacthit);
 
     ManifestEntry* entry;
@@ -311,7 +415,7 @@ static FindResult get_callback(
 
   // position the iterator at the right location
   bool exacthit;
-  std::list<ManifestEntry>::iterator iterator =
+  ManifestEntryList::iterator iterator =
       manifest->findChild(filename, filenamelen, result->resulttype, &exacthit);
 
   if (!exacthit) {
@@ -378,7 +482,7 @@ static FindResult set_callback(
 
   // position the iterator at the right location
   bool exacthit;
-  std::list<ManifestEntry>::iterator iterator =
+  ManifestEntryList::iterator iterator =
       manifest->findChild(filename, filenamelen, RESULT_FILE, &exacthit);
 
   if (!exacthit) {
@@ -447,7 +551,7 @@ static FindResult remove_callback(
 
   // position the iterator at the right location
   bool exacthit;
-  std::list<ManifestEntry>::iterator iterator =
+  ManifestEntryList::iterator iterator =
       manifest->findChild(filename, filenamelen, RESULT_FILE, &exacthit);
 
   if (exacthit) {
@@ -12,6 +12,7 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "edenscm/hgext/extlib/cstore/match.h"
@@ -205,11 +206,11 @@ struct stackframe {
   bool sorted;
 
   stackframe(ManifestPtr manifest, bool sorted)
-      : manifest(manifest), sorted(sorted) {
+      : manifest(std::move(manifest)), sorted(sorted) {
     if (sorted) {
-      sortedIterator = manifest->getSortedIterator();
+      sortedIterator = this->manifest->getSortedIterator();
     } else {
-      iterator = manifest->getIterator();
+      iterator = this->manifest->getIterator();
     }
   }
 
@@ -362,6 +363,7 @@ extern void treemanifest_diffrecurse(
     DiffResult& diff,
     const ManifestFetcher& fetcher,
     bool clean,
-    Matcher& matcher);
+    Matcher& matcher,
+    bool prefetch = false);
 
 #endif // FBHGEXT_CTREEMANIFEST_TREEMANIFEST_H
@@ -57,6 +57,23 @@ cdef extern from "lib/linelog/linelog.c":
             linelog_linenum a1, linelog_linenum a2,
             linelog_linenum blinecount, const linelog_revnum *brevs,
             const linelog_linenum *blinenums)
+    ctypedef struct linelog_hunk:
+        linelog_linenum a1
+        linelog_linenum a2
+        linelog_linenum b1
+        linelog_linenum b2
+    cdef linelog_result linelog_replacelines_batch_vec(linelog_buf *buf,
+            linelog_annotateresult *ar, linelog_revnum brev,
+            const linelog_hunk *hunks, size_t hunkcount,
+            const linelog_revnum *brevs, const linelog_linenum *blinenums)
+
+    ctypedef struct linelog_annotatecache:
+        pass
+    cdef void linelog_annotatecache_clear(linelog_annotatecache *cache)
+    cdef linelog_result linelog_annotate_cached(const linelog_buf *buf,
+            linelog_annotatecache *cache, linelog_annotateresult *ar,
+            linelog_revnum rev)
+
     cdef linelog_result linelog_getalllines(linelog_buf *buf,
             linelog_annotateresult *ar, linelog_offset offset1,
             linelog_offset offset2)
@@ -114,6 +131,10 @@ cdef class _buffer: # thin wrapper around linelog_buf
     cdef annotate(self, linelog_annotateresult *ar, linelog_revnum rev):
         self._eval(lambda: linelog_annotate(&self.buf, ar, rev))
 
+    cdef annotatecached(self, linelog_annotatecache *cache,
+                        linelog_annotateresult *ar, linelog_revnum rev):
+        self._eval(lambda: linelog_annotate_cached(&self.buf, cache, ar, rev))
+
     cdef replacelines(self, linelog_annotateresult *ar, linelog_revnum brev,
                       linelog_linenum a1, linelog_linenum a2,
                       linelog_linenum b1, linelog_linenum b2):
@@ -129,6 +150,14 @@ cdef class _buffer: # thin wrapper around linelog_buf
                                                     a1, a2, blinecount,
                                                     brevs, blinenums))
 
+    cdef replacelines_batch(self, linelog_annotateresult *ar,
+                            linelog_revnum brev, const linelog_hunk *hunks,
+                            size_t hunkcount, const linelog_revnum *brevs,
+                            const linelog_linenum *blinenums):
+        self._eval(lambda: linelog_replacelines_batch_vec(&self.buf, ar, brev,
+                                                          hunks, hunkcount,
+                                                          brevs, blinenums))
+
     cdef getalllines(self, linelog_annotateresult *ar, linelog_offset offset1,
                      linelog_offset offset2):
         self._eval(lambda: linelog_getalllines(&self.buf, ar,
@@ -260,25 +289,32 @@ cdef class linelog:
     """Python wrapper around linelog"""
 
     cdef linelog_annotateresult ar
+    cdef linelog_annotatecache cache
     cdef readonly _buffer buf
     cdef readonly bint closed
+    cdef readonly bint cacheannotate
     cdef readonly object path
 
     def __cinit__(self):
         self.closed = 0
         memset(&self.ar, 0, sizeof(linelog_annotateresult))
+        memset(&self.cache, 0, sizeof(linelog_annotatecache))
 
-    def __init__(self, path=None):
-        """L(path : str?). Open a linelog.
+    def __init__(self, path=None, cacheannotate=False):
+        """L(path : str?, cacheannotate : bool). Open a linelog.
 
         If path is empty or None, the linelog will be in-memory. Otherwise
         it's based on an on-disk file.
 
+        If cacheannotate is True, the results of recent annotate calls are
+        remembered, and reused while the linelog does not change.
+
         The linelog object does not protect concurrent accesses to a same
         file. The caller should have some lock mechanism (like flock) to
         ensure one file is only accessed by one linelog object.
         """
         self.path = path
+        self.cacheannotate = cacheannotate
         if path:
             IF UNAME_SYSNAME == b'Windows':
                 raise RuntimeError(b'on-disk linelog is unavailable on Windows')
@@ -293,11 +329,13 @@ cdef class linelog:
 
     def __dealloc__(self):
         self._clearannotateresult()
+        linelog_annotatecache_clear(&self.cache)
 
     def clear(self):
         """L.close() -> None. Close the file and free resources."""
         self._checkclosed()
         self._clearannotateresult()
+        linelog_annotatecache_clear(&self.cache)
         self.buf.clear()
 
     def flush(self):
@@ -319,6 +357,7 @@ cdef class linelog:
         Copy content from another linelog object."""
         assert isinstance(rhs, linelog)
         self._checkclosed()
+        linelog_annotatecache_clear(&self.cache)
         self.buf.copyfrom(rhs.buf)
 
     @property
@@ -341,7 +380,10 @@ cdef class linelog:
         """
         self._checkclosed()
         try:
-            self.buf.annotate(&self.ar, rev)
+            if self.cacheannotate:
+                self.buf.annotatecached(&self.cache, &self.ar, rev)
+            else:
+                self.buf.annotate(&self.ar, rev)
         except LinelogError:
             self._clearannotateresult()
             raise
@@ -388,6 +430,57 @@ cdef class linelog:
             free(brevs)
             free(blinenums)
 
+    def replacelines_batch(self, rev, hunks, blines=None):
+        """L.replacelines_batch(rev : int, hunks : [(a1, a2, b1, b2)],
+                                blines : [[(rev, linenum)]]?) -> None
+
+        Replace lines[a1:a2] with lines[b1:b2] in rev for every hunk, like
+        calling L.replacelines for each of them from the last to the first,
+        but in a single pass. hunks should be sorted, as a diff outputs them.
+        If blines is not None, it has the lines of each hunk, as passed to
+        L.replacelines_vec. See comments above linelog_replacelines_batch in
+        linelog.h for details.
+        """
+        self._checkclosed()
+        cdef size_t i, hunkcount = len(hunks)
+        cdef linelog_linenum j, blinecount = 0
+        if hunkcount == 0:
+            return
+        cdef linelog_hunk *chunks = <linelog_hunk *>malloc(
+            sizeof(linelog_hunk) * hunkcount)
+        cdef linelog_revnum *brevs = NULL
+        cdef linelog_linenum *blinenums = NULL
+        try:
+            if chunks == NULL:
+                raise MemoryError()
+            for i in range(0, hunkcount):
+                chunks[i].a1, chunks[i].a2, chunks[i].b1, chunks[i].b2 = (
+                    hunks[i])
+            if blines is not None:
+                # brevs and blinenums are indexed by line numbers at rev
+                blinecount = chunks[hunkcount - 1].b2
+                brevs = <linelog_revnum *>malloc(
+                    sizeof(linelog_revnum) * blinecount)
+                blinenums = <linelog_linenum *>malloc(
+                    sizeof(linelog_linenum) * blinecount)
+                if blinecount > 0 and (brevs == NULL or blinenums == NULL):
+                    raise MemoryError()
+                for i in range(0, hunkcount):
+                    if chunks[i].b2 > blinecount or (
+                            len(blines[i]) != chunks[i].b2 - chunks[i].b1):
+                        raise ValueError(b'blines do not match hunks')
+                    for j in range(chunks[i].b1, chunks[i].b2):
+                        brevs[j], blinenums[j] = blines[i][j - chunks[i].b1]
+            self.buf.replacelines_batch(&self.ar, rev, chunks, hunkcount,
+                                        brevs, blinenums)
+        except LinelogError:
+            self._clearannotateresult()
+            raise
+        finally:
+            free(chunks)
+            free(brevs)
+            free(blinenums)
+
     @property
     def annotateresult(self):
         """L.annotateresult -> [(rev, linenum)]"""
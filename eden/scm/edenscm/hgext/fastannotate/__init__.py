@@ -90,6 +90,11 @@ annotate cache greatly. Run "debugbuildlinkrevcache" before
     # to avoid a file fetch if remotefilelog is used. (default: True)
     forcetext = True
 
+    # remember the results of recent linelog annotate calls, so annotating
+    # the same revision again while the linelog does not change is cheap.
+    # (default: False)
+    annotatecache = False
+
     # use unfiltered repo for better performance.
     unfilteredrepo = True
 
@@ -199,7 +199,10 @@ class _annotatecontext(object):
     @property
     def linelog(self):
         if self._linelog is None:
-            self._linelog = linelogmod.linelog(pycompat.encodeutf8(self.linelogpath))
+            self._linelog = linelogmod.linelog(
+                pycompat.encodeutf8(self.linelogpath),
+                cacheannotate=self.ui.configbool("fastannotate", "annotatecache"),
+            )
         return self._linelog
 
     @property
@@ -680,17 +683,18 @@ class _annotatecontext(object):
         llrev = revmap.append(fctx.node(), path=fctx.path())
         siderevmap[fctx] = llrev
 
-        for (a1, a2, b1, b2), op in reversed(blocks):
-            if op == "=":
-                continue
-            if bannotated is None:
-                linelog.replacelines(llrev, a1, a2, b1, b2)
-            else:
-                blines = [
+        hunks = [(a1, a2, b1, b2) for (a1, a2, b1, b2), op in blocks if op != "="]
+        if bannotated is None:
+            linelog.replacelines_batch(llrev, hunks)
+        else:
+            blines = [
+                [
                     ((r if isinstance(r, int) else siderevmap[r]), l)
                     for r, l in bannotated[b1:b2]
                 ]
-                linelog.replacelines_vec(llrev, a1, a2, blines)
+                for a1, a2, b1, b2 in hunks
+            ]
+            linelog.replacelines_batch(llrev, hunks, blines)
 
     def _addpathtoresult(self, annotateresult, revmap=None):
         """(revmap, [(node, linenum)]) -> [(node, linenum, path)]"""
@@ -19,6 +19,9 @@
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 #include "eden/scm/edenscm/mercurial/bdiff.h"
 #include "eden/scm/edenscm/mercurial/bitmanipulation.h"
@@ -32,24 +35,25 @@ struct pos {
   int pos, len;
 };
 
-int bdiff_splitlines(const char* a, ssize_t len, struct bdiff_line** lr) {
-  unsigned hash;
-  int i;
-  const char *p, *b = a;
+/* number of lines in a[0:len], where the last line may lack a newline */
+static int countlines(const char* a, ssize_t len) {
+  int i = 0;
+  const char *p;
   const char* const plast = a + len - 1;
-  struct bdiff_line* l;
 
-  /* count the lines */
-  i = 1; /* extra line for sentinel */
   for (p = a; p < plast; p++)
     if (*p == '\n')
       i++;
   if (p == plast)
     i++;
+  return i;
+}
 
-  *lr = l = (struct bdiff_line*)malloc(sizeof(struct bdiff_line) * i);
-  if (!l)
-    return -1;
+/* split a[0:len] into l, which has room for countlines(a, len) lines */
+static void filllines(const char* a, ssize_t len, struct bdiff_line* l) {
+  unsigned hash;
+  const char *p, *b = a;
+  const char* const plast = a + len - 1;
 
   /* build the line array and calculate hashes */
   hash = 0;
@@ -75,6 +79,129 @@ int bdiff_splitlines(const char* a, ssize_t len, struct bdiff_line** lr) {
     l->n = INT_MAX;
     l++;
   }
+}
+
+static int parallelthreads = 0;
+static ssize_t parallelminlen = 0;
+
+void bdiff_setparallel(int threads, ssize_t minlen) {
+  parallelthreads = threads;
+  parallelminlen = minlen;
+}
+
+#ifndef _WIN32
+#define MAXTHREADS 64
+
+/* a part of the input that ends with a newline, unless it is the last */
+struct chunk {
+  const char* a;
+  ssize_t len;
+  int count;
+  struct bdiff_line* l;
+};
+
+static void* countchunk(void* arg) {
+  struct chunk* c = (struct chunk*)arg;
+  c->count = countlines(c->a, c->len);
+  return NULL;
+}
+
+static void* fillchunk(void* arg) {
+  struct chunk* c = (struct chunk*)arg;
+  filllines(c->a, c->len, c->l);
+  return NULL;
+}
+
+/* run fn on chunks[1:n] in new threads and on chunks[0] in this one. a
+   chunk whose thread cannot be started is handled here afterwards. */
+static void runchunks(void* (*fn)(void*), struct chunk* chunks, int n) {
+  pthread_t threads[MAXTHREADS];
+  int i, started[MAXTHREADS];
+
+  for (i = 1; i < n; i++)
+    started[i] = pthread_create(&threads[i], NULL, fn, &chunks[i]) == 0;
+  fn(&chunks[0]);
+  for (i = 1; i < n; i++) {
+    if (started[i])
+      pthread_join(threads[i], NULL);
+    else
+      fn(&chunks[i]);
+  }
+}
+
+/* like bdiff_splitlines, but count and hash the lines of up to nthreads
+   chunks of a concurrently. chunks end at newlines, and a line's hash only
+   depends on its own bytes, so the result is the same. */
+static int splitlinesparallel(
+    const char* a,
+    ssize_t len,
+    struct bdiff_line** lr,
+    int nthreads) {
+  struct chunk chunks[MAXTHREADS];
+  const char *p = a, *end = a + len, *q;
+  int i, n = 0, total = 1; /* extra line for sentinel */
+  struct bdiff_line* l;
+
+  if (nthreads > MAXTHREADS)
+    nthreads = MAXTHREADS;
+
+  /* cut a into chunks of about len / nthreads bytes, after a newline */
+  for (i = 1; p < end; i++) {
+    q = i < nthreads ? a + len / nthreads * i : end;
+    if (q < p)
+      continue;
+    if (q < end) {
+      q = (const char*)memchr(q, '\n', end - q);
+      q = q ? q + 1 : end;
+    }
+    chunks[n].a = p;
+    chunks[n].len = q - p;
+    n++;
+    p = q;
+  }
+
+  runchunks(countchunk, chunks, n);
+
+  for (i = 0; i < n; i++)
+    total += chunks[i].count;
+
+  *lr = l = (struct bdiff_line*)malloc(sizeof(struct bdiff_line) * total);
+  if (!l)
+    return -1;
+
+  for (i = 0; i < n; i++) {
+    chunks[i].l = l;
+    l += chunks[i].count;
+  }
+
+  runchunks(fillchunk, chunks, n);
+
+  /* set up a sentinel */
+  l->hash = 0;
+  l->len = 0;
+  l->l = a + len;
+  return total - 1;
+}
+#endif
+
+int bdiff_splitlines(const char* a, ssize_t len, struct bdiff_line** lr) {
+  int i;
+  struct bdiff_line* l;
+
+#ifndef _WIN32
+  if (parallelthreads > 1 && len > 0 && len >= parallelminlen)
+    return splitlinesparallel(a, len, lr, parallelthreads);
+#endif
+
+  /* count the lines */
+  i = countlines(a, len) + 1; /* extra line for sentinel */
+
+  *lr = l = (struct bdiff_line*)malloc(sizeof(struct bdiff_line) * i);
+  if (!l)
+    return -1;
+
+  filllines(a, len, l);
+  l += i - 1;
 
   /* set up a sentinel */
   l->hash = 0;
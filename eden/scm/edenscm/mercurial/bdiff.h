@@ -30,6 +30,9 @@ struct bdiff_hunk {
 };
 
 int bdiff_splitlines(const char* a, ssize_t len, struct bdiff_line** lr);
+/* split inputs of at least minlen bytes with up to threads threads.
+   threads <= 1 disables this, which is the default. ignored on Windows. */
+void bdiff_setparallel(int threads, ssize_t minlen);
 int bdiff_diff(
     struct bdiff_line* a,
     int an,
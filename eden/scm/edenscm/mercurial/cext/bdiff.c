@@ -192,12 +192,27 @@ nomem:
   return result ? result : PyErr_NoMemory();
 }
 
+static PyObject* setparallel(PyObject* self, PyObject* args) {
+  int threads;
+  Py_ssize_t minsize;
+
+  if (!PyArg_ParseTuple(args, "in:setparallel", &threads, &minsize))
+    return NULL;
+
+  bdiff_setparallel(threads, minsize);
+  Py_RETURN_NONE;
+}
+
 static char mdiff_doc[] = "Efficient binary diff.";
 
 static PyMethodDef methods[] = {
     {"bdiff", bdiff, METH_VARARGS, "calculate a binary diff\n"},
     {"blocks", blocks, METH_VARARGS, "find a list of matching lines\n"},
     {"fixws", fixws, METH_VARARGS, "normalize diff whitespaces\n"},
+    {"setparallel",
+     setparallel,
+     METH_VARARGS,
+     "split inputs of at least minsize bytes with up to threads threads\n"},
     {NULL, NULL}};
 
 static const int version = 1;
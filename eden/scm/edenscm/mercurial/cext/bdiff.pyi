@@ -8,3 +8,4 @@ from typing import List, Tuple, Union
 def blocks(a: str, b: str) -> List[Tuple[int, int, int, int]]: ...
 def fixws(s: str, allws: bool) -> bytes: ...
 def bdiff(a: Union[str, bytes], b: Union[str, bytes]) -> bytes: ...
+def setparallel(threads: int, minsize: int) -> None: ...
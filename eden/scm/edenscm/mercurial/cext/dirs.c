@@ -19,11 +19,10 @@
 
 #include "eden/scm/edenscm/mercurial/cext/util.h"
 
-#ifdef IS_PY3K
-#define PYLONG_VALUE(o) ((PyLongObject*)o)->ob_digit[1]
-#else
-#define PYLONG_VALUE(o) PyInt_AS_LONG(o)
-#endif
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 /*
  * This is a multiset of directory names, built from the files that
@@ -31,16 +30,209 @@
  *
  * A few implementation notes:
  *
- * We modify Python integers for refcounting, but those integers are
- * never visible to Python code.
+ * The directories are kept in an open-addressing hash table with linear
+ * probing, rather than in a Python dict, so that building the multiset for
+ * millions of files does not allocate a Python string and integer for every
+ * directory.  The directory names are copied into large arena blocks owned
+ * by the table.  Python strings are only created when the multiset is
+ * iterated.
  *
- * We mutate strings in-place, but leave them immutable once they can
- * be seen by Python code.
+ * Removing the last reference to a directory leaves its entry in place with
+ * a count of zero, so that probe sequences stay intact and adding the
+ * directory back reuses the entry.  Dead entries and their names are
+ * dropped the next time the table is rebuilt.
  */
 typedef struct {
-  PyObject_HEAD PyObject* dict;
+  const char* name;
+  uint64_t hash;
+  uint32_t len;
+  /* Number of references to this directory.  0 for a dead entry. */
+  uint32_t count;
+} direntry;
+
+typedef struct dirblock {
+  struct dirblock* next;
+  size_t used;
+  size_t size;
+  char data[1];
+} dirblock;
+
+typedef struct {
+  PyObject_HEAD direntry* entries;
+  /* Number of slots in entries, always a power of two. */
+  size_t capacity;
+  /* Number of slots holding an entry, dead or alive. */
+  size_t used;
+  /* Number of live entries. */
+  size_t alive;
+  /* Bumped whenever a directory is added or removed, to detect changes
+   * during iteration. */
+  uint64_t generation;
+  dirblock* blocks;
 } dirsObject;
 
+typedef struct {
+  PyObject_HEAD dirsObject* dirs;
+  size_t pos;
+  uint64_t generation;
+} dirsIterObject;
+
+static const size_t dirs_initial_capacity = 64;
+static const size_t dirs_block_size = 64 * 1024;
+
+static inline uint64_t _hashdir(const char* name, size_t len) {
+  /* FNV-1a */
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  size_t i;
+  for (i = 0; i < len; i++) {
+    hash ^= (unsigned char)name[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static void _freeblocks(dirblock* block) {
+  while (block != NULL) {
+    dirblock* next = block->next;
+    free(block);
+    block = next;
+  }
+}
+
+/* Copy a directory name into the arena, returning NULL when out of memory. */
+static const char*
+_internname(dirblock** blocks, const char* name, size_t len) {
+  dirblock* block = *blocks;
+  char* dest;
+
+  if (block == NULL || block->size - block->used < len) {
+    size_t size = len > dirs_block_size ? len : dirs_block_size;
+    block = malloc(offsetof(dirblock, data) + size);
+    if (block == NULL)
+      return NULL;
+    block->used = 0;
+    block->size = size;
+    block->next = *blocks;
+    *blocks = block;
+  }
+  dest = block->data + block->used;
+  memcpy(dest, name, len);
+  block->used += len;
+  return dest;
+}
+
+static direntry* _findslot(
+    direntry* entries,
+    size_t capacity,
+    const char* name,
+    size_t len,
+    uint64_t hash) {
+  size_t mask = capacity - 1;
+  size_t i = (size_t)hash & mask;
+
+  while (entries[i].name != NULL) {
+    direntry* entry = &entries[i];
+    if (entry->hash == hash && entry->len == len &&
+        memcmp(entry->name, name, len) == 0)
+      return entry;
+    i = (i + 1) & mask;
+  }
+  return &entries[i];
+}
+
+/*
+ * Rebuild the table with room for at least one more entry, dropping dead
+ * entries.  Returns -1 with a Python exception set on failure.
+ */
+static int _rebuild(dirsObject* self) {
+  size_t capacity = self->capacity ? self->capacity : dirs_initial_capacity;
+  direntry* entries;
+  dirblock* blocks = NULL;
+  size_t i;
+
+  /* Keep the load factor of live entries at or below one half. */
+  while ((self->alive + 1) * 2 > capacity)
+    capacity *= 2;
+
+  entries = calloc(capacity, sizeof(direntry));
+  if (entries == NULL) {
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  for (i = 0; i < self->capacity; i++) {
+    direntry* entry = &self->entries[i];
+    direntry* slot;
+    if (entry->count == 0)
+      continue;
+    slot = _findslot(entries, capacity, entry->name, entry->len, entry->hash);
+    *slot = *entry;
+    slot->name = _internname(&blocks, entry->name, entry->len);
+    if (slot->name == NULL) {
+      _freeblocks(blocks);
+      free(entries);
+      PyErr_NoMemory();
+      return -1;
+    }
+  }
+
+  free(self->entries);
+  _freeblocks(self->blocks);
+  self->entries = entries;
+  self->blocks = blocks;
+  self->capacity = capacity;
+  self->used = self->alive;
+  self->generation++;
+  return 0;
+}
+
+/*
+ * Return the entry for a directory, creating a dead entry for it if it is
+ * not in the table.  Returns NULL with a Python exception set on failure.
+ */
+static direntry* _getentry(dirsObject* self, const char* name, size_t len) {
+  uint64_t hash = _hashdir(name, len);
+  direntry* slot;
+
+  if (len > UINT32_MAX) {
+    PyErr_SetString(PyExc_ValueError, "path too long");
+    return NULL;
+  }
+  if (self->capacity != 0) {
+    slot = _findslot(self->entries, self->capacity, name, len, hash);
+    if (slot->name != NULL)
+      return slot;
+  }
+
+  /* Keep at least a quarter of the slots empty so that probes terminate
+   * quickly. */
+  if ((self->used + 1) * 4 > self->capacity * 3) {
+    if (_rebuild(self) == -1)
+      return NULL;
+  }
+  slot = _findslot(self->entries, self->capacity, name, len, hash);
+  slot->name = _internname(&self->blocks, name, len);
+  if (slot->name == NULL) {
+    PyErr_NoMemory();
+    return NULL;
+  }
+  slot->hash = hash;
+  slot->len = (uint32_t)len;
+  slot->count = 0;
+  self->used++;
+  return slot;
+}
+
+static direntry* _lookup(dirsObject* self, const char* name, size_t len) {
+  direntry* slot;
+
+  if (self->capacity == 0)
+    return NULL;
+  slot = _findslot(
+      self->entries, self->capacity, name, len, _hashdir(name, len));
+  return slot->name != NULL && slot->count != 0 ? slot : NULL;
+}
+
 static inline Py_ssize_t _finddir(const char* path, Py_ssize_t pos) {
   while (pos != -1) {
     if (path[pos] == '/')
@@ -54,107 +246,50 @@ static inline Py_ssize_t _finddir(const char* path, Py_ssize_t pos) {
   return pos;
 }
 
-static int _addpath(PyObject* dirs, PyObject* path) {
+static int _addpath(dirsObject* dirs, PyObject* path) {
   const char* cpath = PyBytes_AS_STRING(path);
   Py_ssize_t pos = PyBytes_GET_SIZE(path);
-  PyObject* key = NULL;
-  int ret = -1;
 
-  /* This loop is super critical for performance. That's why we inline
-   * access to Python structs instead of going through a supported API.
-   * The implementation, therefore, is heavily dependent on CPython
-   * implementation details. We also commit violations of the Python
-   * "protocol" such as mutating immutable objects. But since we only
-   * mutate objects created in this function or in other well-defined
-   * locations, the references are known so these violations should go
-   * unnoticed. The code for adjusting the length of a PyBytesObject is
-   * essentially a minimal version of _PyBytes_Resize. */
   while ((pos = _finddir(cpath, pos - 1)) != -1) {
-    PyObject* val;
-
-    /* It's likely that every prefix already has an entry
-       in our dict. Try to avoid allocating and
-       deallocating a string for each prefix we check. */
-    if (key != NULL)
-      ((PyBytesObject*)key)->ob_shash = -1;
-    else {
-      /* Force Python to not reuse a small shared string. */
-      key = PyBytes_FromStringAndSize(cpath, pos < 2 ? 2 : pos);
-      if (key == NULL)
-        goto bail;
-    }
-    /* Py_SIZE(o) refers to the ob_size member of the struct. Yes,
-     * assigning to what looks like a function seems wrong. */
-    Py_SIZE(key) = pos;
-    ((PyBytesObject*)key)->ob_sval[pos] = '\0';
-
-    val = PyDict_GetItem(dirs, key);
-    if (val != NULL) {
-      PYLONG_VALUE(val) += 1;
+    direntry* entry = _getentry(dirs, cpath, pos);
+    if (entry == NULL)
+      return -1;
+
+    if (entry->count != 0) {
+      entry->count += 1;
       break;
     }
 
-    /* Force Python to not reuse a small shared int. */
-#ifdef IS_PY3K
-    val = PyLong_FromLong(0x1eadbeef);
-#else
-    val = PyInt_FromLong(0x1eadbeef);
-#endif
-
-    if (val == NULL)
-      goto bail;
-
-    PYLONG_VALUE(val) = 1;
-    ret = PyDict_SetItem(dirs, key, val);
-    Py_DECREF(val);
-    if (ret == -1)
-      goto bail;
-    Py_CLEAR(key);
+    entry->count = 1;
+    dirs->alive++;
+    dirs->generation++;
   }
-  ret = 0;
-
-bail:
-  Py_XDECREF(key);
 
-  return ret;
+  return 0;
 }
 
-static int _delpath(PyObject* dirs, PyObject* path) {
-  char* cpath = PyBytes_AS_STRING(path);
+static int _delpath(dirsObject* dirs, PyObject* path) {
+  const char* cpath = PyBytes_AS_STRING(path);
   Py_ssize_t pos = PyBytes_GET_SIZE(path);
-  PyObject* key = NULL;
-  int ret = -1;
 
   while ((pos = _finddir(cpath, pos - 1)) != -1) {
-    PyObject* val;
-
-    key = PyBytes_FromStringAndSize(cpath, pos);
-
-    if (key == NULL)
-      goto bail;
-
-    val = PyDict_GetItem(dirs, key);
-    if (val == NULL) {
+    direntry* entry = _lookup(dirs, cpath, pos);
+    if (entry == NULL) {
       PyErr_SetString(PyExc_ValueError, "expected a value, found none");
-      goto bail;
+      return -1;
     }
 
-    if (--PYLONG_VALUE(val) <= 0) {
-      if (PyDict_DelItem(dirs, key) == -1)
-        goto bail;
+    if (--entry->count == 0) {
+      dirs->alive--;
+      dirs->generation++;
     } else
       break;
-    Py_CLEAR(key);
   }
-  ret = 0;
 
-bail:
-  Py_XDECREF(key);
-
-  return ret;
+  return 0;
 }
 
-static int dirs_fromdict(PyObject* dirs, PyObject* source, char skipchar) {
+static int dirs_fromdict(dirsObject* dirs, PyObject* source, char skipchar) {
   PyObject *key, *value;
   Py_ssize_t pos = 0;
 
@@ -179,7 +314,7 @@ static int dirs_fromdict(PyObject* dirs, PyObject* source, char skipchar) {
   return 0;
 }
 
-static int dirs_fromiter(PyObject* dirs, PyObject* source) {
+static int dirs_fromiter(dirsObject* dirs, PyObject* source) {
   PyObject *iter, *item = NULL;
   int ret;
 
@@ -204,41 +339,49 @@ static int dirs_fromiter(PyObject* dirs, PyObject* source) {
   return ret;
 }
 
+/*
+ * Release all entries, leaving an empty set.  Live iterators fail with
+ * "dirs changed during iteration" from then on.
+ */
+static void dirs_clear(dirsObject* self) {
+  free(self->entries);
+  _freeblocks(self->blocks);
+  self->entries = NULL;
+  self->blocks = NULL;
+  self->capacity = 0;
+  self->used = 0;
+  self->alive = 0;
+  self->generation++;
+}
+
 /*
  * Calculate a refcounted set of directory names for the files in a
  * dirstate.
  */
 static int dirs_init(dirsObject* self, PyObject* args) {
-  PyObject *dirs = NULL, *source = NULL;
+  PyObject* source = NULL;
   char skipchar = 0;
   int ret = -1;
 
-  self->dict = NULL;
+  dirs_clear(self);
 
   if (!PyArg_ParseTuple(args, "|Oc:__init__", &source, &skipchar))
     return -1;
 
-  dirs = PyDict_New();
-
-  if (dirs == NULL)
-    return -1;
-
   if (source == NULL)
     ret = 0;
   else if (PyDict_Check(source))
-    ret = dirs_fromdict(dirs, source, skipchar);
+    ret = dirs_fromdict(self, source, skipchar);
   else if (skipchar)
     PyErr_SetString(
         PyExc_ValueError,
         "skip character is only supported "
         "with a dict source");
   else
-    ret = dirs_fromiter(dirs, source);
+    ret = dirs_fromiter(self, source);
 
   if (ret == -1)
-    Py_XDECREF(dirs);
-  else
-    self->dict = dirs;
+    dirs_clear(self);
 
   return ret;
 }
@@ -249,7 +392,7 @@ PyObject* dirs_addpath(dirsObject* self, PyObject* args) {
   if (!PyArg_ParseTuple(args, "O!:addpath", &PyBytes_Type, &path))
     return NULL;
 
-  if (_addpath(self->dict, path) == -1)
+  if (_addpath(self, path) == -1)
     return NULL;
 
   Py_RETURN_NONE;
@@ -261,23 +404,55 @@ static PyObject* dirs_delpath(dirsObject* self, PyObject* args) {
   if (!PyArg_ParseTuple(args, "O!:delpath", &PyBytes_Type, &path))
     return NULL;
 
-  if (_delpath(self->dict, path) == -1)
+  if (_delpath(self, path) == -1)
     return NULL;
 
   Py_RETURN_NONE;
 }
 
 static int dirs_contains(dirsObject* self, PyObject* value) {
-  return PyBytes_Check(value) ? PyDict_Contains(self->dict, value) : 0;
+  if (!PyBytes_Check(value))
+    return 0;
+  return _lookup(self, PyBytes_AS_STRING(value), PyBytes_GET_SIZE(value)) !=
+      NULL;
 }
 
 static void dirs_dealloc(dirsObject* self) {
-  Py_XDECREF(self->dict);
+  dirs_clear(self);
   PyObject_Del(self);
 }
 
+static PyTypeObject dirsIterType = {PyVarObject_HEAD_INIT(NULL, 0)};
+
 static PyObject* dirs_iter(dirsObject* self) {
-  return PyObject_GetIter(self->dict);
+  dirsIterObject* iter = PyObject_New(dirsIterObject, &dirsIterType);
+  if (iter == NULL)
+    return NULL;
+  Py_INCREF(self);
+  iter->dirs = self;
+  iter->pos = 0;
+  iter->generation = self->generation;
+  return (PyObject*)iter;
+}
+
+static PyObject* dirsiter_next(dirsIterObject* self) {
+  dirsObject* dirs = self->dirs;
+
+  if (dirs->generation != self->generation) {
+    PyErr_SetString(PyExc_RuntimeError, "dirs changed during iteration");
+    return NULL;
+  }
+  while (self->pos < dirs->capacity) {
+    direntry* entry = &dirs->entries[self->pos++];
+    if (entry->count != 0)
+      return PyBytes_FromStringAndSize(entry->name, entry->len);
+  }
+  return NULL;
+}
+
+static void dirsiter_dealloc(dirsIterObject* self) {
+  Py_XDECREF(self->dirs);
+  PyObject_Del(self);
 }
 
 static PySequenceMethods dirs_sequence_methods;
@@ -303,7 +478,14 @@ void dirs_module_init(PyObject* mod) {
   dirsType.tp_methods = dirs_methods;
   dirsType.tp_init = (initproc)dirs_init;
 
-  if (PyType_Ready(&dirsType) < 0)
+  dirsIterType.tp_name = "parsers.dirsiterator";
+  dirsIterType.tp_basicsize = sizeof(dirsIterObject);
+  dirsIterType.tp_dealloc = (destructor)dirsiter_dealloc;
+  dirsIterType.tp_flags = Py_TPFLAGS_DEFAULT;
+  dirsIterType.tp_iter = PyObject_SelfIter;
+  dirsIterType.tp_iternext = (iternextfunc)dirsiter_next;
+
+  if (PyType_Ready(&dirsType) < 0 || PyType_Ready(&dirsIterType) < 0)
     return;
   Py_INCREF(&dirsType);
 
@@ -250,26 +250,21 @@ PyTypeObject dirstateTupleType = {
     dirstate_tuple_new, /* tp_new */
 };
 
-static PyObject* parse_dirstate(PyObject* self, PyObject* args) {
-  PyObject *dmap, *cmap, *parents = NULL, *ret = NULL;
+/*
+ * Decode every entry of a dirstate into dmap and cmap, and return its
+ * parents.
+ */
+static PyObject* _parse_dirstate(
+    PyObject* dmap,
+    PyObject* cmap,
+    const char* str,
+    Py_ssize_t len) {
+  PyObject *parents = NULL, *ret = NULL;
   PyObject *fname = NULL, *cname = NULL, *entry = NULL;
-  char state, *cur, *str, *cpos;
+  const char *cur, *cpos;
+  char state;
   int mode, size, mtime;
   unsigned int flen, pos = 40;
-  Py_ssize_t readlen, len;
-
-  if (!PyArg_ParseTuple(
-          args,
-          "O!O!s#:parse_dirstate",
-          &PyDict_Type,
-          &dmap,
-          &PyDict_Type,
-          &cmap,
-          &str,
-          &readlen))
-    goto quit;
-
-  len = readlen;
 
   /* read parents */
   if (len < 40) {
@@ -347,6 +342,296 @@ quit:
   return ret;
 }
 
+static PyObject* parse_dirstate(PyObject* self, PyObject* args) {
+  PyObject *dmap, *cmap;
+  char* str;
+  Py_ssize_t readlen;
+
+  if (!PyArg_ParseTuple(
+          args,
+          "O!O!s#:parse_dirstate",
+          &PyDict_Type,
+          &dmap,
+          &PyDict_Type,
+          &cmap,
+          &str,
+          &readlen))
+    return NULL;
+
+  return _parse_dirstate(dmap, cmap, str, readlen);
+}
+
+/*
+ * A read-only view of a dirstate that decodes entries on demand.
+ *
+ * Building it only sorts an index of the entries by filename, so that
+ * commands that look up a few files do not pay for a tuple and two dict
+ * entries per file.  todict() decodes the whole dirstate once something
+ * needs a mutable map.  The dirstate data, typically an mmap of the
+ * dirstate file, is kept alive for the life of the object.
+ */
+typedef struct {
+  const char* name;
+  uint32_t namelen;
+  /* Offset of the entry header in the dirstate data. */
+  uint32_t offset;
+} lazydirstateEntry;
+
+typedef struct {
+  PyObject_HEAD PyObject* data;
+  Py_buffer buf;
+  lazydirstateEntry* entries;
+  Py_ssize_t count;
+} lazydirstateObject;
+
+static int lazydirstate_entrycmp(const void* a, const void* b) {
+  const lazydirstateEntry* left = a;
+  const lazydirstateEntry* right = b;
+  uint32_t len = MIN(left->namelen, right->namelen);
+  int cmp = memcmp(left->name, right->name, len);
+  if (cmp != 0)
+    return cmp;
+  if (left->namelen != right->namelen)
+    return left->namelen < right->namelen ? -1 : 1;
+  /* Later entries for the same file win, as they do in parse_dirstate. */
+  return left->offset < right->offset ? -1 : left->offset > right->offset;
+}
+
+/*
+ * Index the entries of the dirstate, applying the same checks as
+ * parse_dirstate.
+ */
+static int lazydirstate_index(lazydirstateObject* self) {
+  const char* str = self->buf.buf;
+  Py_ssize_t len = self->buf.len;
+  Py_ssize_t capacity = 0, count = 0, i, out;
+  unsigned int flen, pos = 40;
+
+  if (len < 40) {
+    PyErr_SetString(PyExc_ValueError, "too little data for parents");
+    return -1;
+  }
+  if (len > UINT32_MAX) {
+    PyErr_SetString(PyExc_ValueError, "dirstate too large for lazy parsing");
+    return -1;
+  }
+
+  while (pos < len) {
+    const char *cur, *cpos;
+    if (pos + 17 > len) {
+      PyErr_SetString(PyExc_ValueError, "overflow in dirstate");
+      return -1;
+    }
+    cur = str + pos;
+    flen = getbe32(cur + 13);
+    if (flen > len - pos - 17) {
+      PyErr_SetString(PyExc_ValueError, "overflow in dirstate");
+      return -1;
+    }
+    if (count == capacity) {
+      lazydirstateEntry* entries;
+      capacity = capacity ? capacity * 2 : len / 64 + 16;
+      entries = PyMem_Realloc(self->entries, capacity * sizeof(*entries));
+      if (entries == NULL) {
+        PyErr_NoMemory();
+        return -1;
+      }
+      self->entries = entries;
+    }
+    cpos = memchr(cur + 17, 0, flen);
+    self->entries[count].name = cur + 17;
+    self->entries[count].namelen = cpos ? cpos - (cur + 17) : flen;
+    self->entries[count].offset = pos;
+    count++;
+    pos += 17 + flen;
+  }
+
+  qsort(self->entries, count, sizeof(*self->entries), lazydirstate_entrycmp);
+
+  /* Keep only the last entry for each filename. */
+  out = 0;
+  for (i = 0; i < count; i++) {
+    if (i + 1 < count &&
+        self->entries[i].namelen == self->entries[i + 1].namelen &&
+        memcmp(
+            self->entries[i].name,
+            self->entries[i + 1].name,
+            self->entries[i].namelen) == 0)
+      continue;
+    self->entries[out++] = self->entries[i];
+  }
+  self->count = out;
+  return 0;
+}
+
+static int lazydirstate_init(lazydirstateObject* self, PyObject* args) {
+  PyObject* data;
+
+  if (!PyArg_ParseTuple(args, "O:lazydirstate", &data))
+    return -1;
+  if (self->data != NULL) {
+    PyErr_SetString(PyExc_TypeError, "lazydirstate is already initialized");
+    return -1;
+  }
+  if (PyObject_GetBuffer(data, &self->buf, PyBUF_SIMPLE) == -1)
+    return -1;
+  Py_INCREF(data);
+  self->data = data;
+  return lazydirstate_index(self);
+}
+
+static void lazydirstate_dealloc(lazydirstateObject* self) {
+  PyMem_Free(self->entries);
+  if (self->data != NULL) {
+    PyBuffer_Release(&self->buf);
+    Py_DECREF(self->data);
+  }
+  PyObject_Del(self);
+}
+
+/*
+ * Find the entry for key.  Returns NULL without an exception set if there
+ * is no such entry, and NULL with an exception set on error.
+ */
+static lazydirstateEntry* lazydirstate_find(
+    lazydirstateObject* self,
+    PyObject* key) {
+  Py_ssize_t namelen, lo, hi;
+  const char* name;
+
+#ifdef IS_PY3K
+  if (!PyUnicode_Check(key))
+    return NULL;
+  name = PyUnicode_AsUTF8AndSize(key, &namelen);
+  if (name == NULL)
+    return NULL;
+#else
+  if (!PyBytes_Check(key))
+    return NULL;
+  name = PyBytes_AS_STRING(key);
+  namelen = PyBytes_GET_SIZE(key);
+#endif
+  if (self->data == NULL)
+    return NULL;
+
+  lo = 0;
+  hi = self->count;
+  while (lo < hi) {
+    Py_ssize_t mid = lo + (hi - lo) / 2;
+    lazydirstateEntry* entry = &self->entries[mid];
+    int cmp = memcmp(entry->name, name, MIN(entry->namelen, namelen));
+    if (cmp == 0 && entry->namelen != namelen)
+      cmp = entry->namelen < namelen ? -1 : 1;
+    if (cmp == 0)
+      return entry;
+    if (cmp < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return NULL;
+}
+
+static PyObject* lazydirstate_tuple(
+    lazydirstateObject* self,
+    lazydirstateEntry* entry) {
+  const char* cur = (const char*)self->buf.buf + entry->offset;
+  return (PyObject*)make_dirstate_tuple(
+      *cur, getbe32(cur + 1), getbe32(cur + 5), getbe32(cur + 9));
+}
+
+static Py_ssize_t lazydirstate_size(lazydirstateObject* self) {
+  return self->count;
+}
+
+static int lazydirstate_contains(lazydirstateObject* self, PyObject* key) {
+  if (lazydirstate_find(self, key) != NULL)
+    return 1;
+  return PyErr_Occurred() ? -1 : 0;
+}
+
+static PyObject* lazydirstate_getitem(
+    lazydirstateObject* self,
+    PyObject* key) {
+  lazydirstateEntry* entry = lazydirstate_find(self, key);
+  if (entry == NULL) {
+    if (!PyErr_Occurred())
+      PyErr_SetObject(PyExc_KeyError, key);
+    return NULL;
+  }
+  return lazydirstate_tuple(self, entry);
+}
+
+static PyObject* lazydirstate_get(lazydirstateObject* self, PyObject* args) {
+  PyObject *key, *def = Py_None;
+  lazydirstateEntry* entry;
+
+  if (!PyArg_ParseTuple(args, "O|O:get", &key, &def))
+    return NULL;
+  entry = lazydirstate_find(self, key);
+  if (entry == NULL) {
+    if (PyErr_Occurred())
+      return NULL;
+    Py_INCREF(def);
+    return def;
+  }
+  return lazydirstate_tuple(self, entry);
+}
+
+static PyObject* lazydirstate_todict(
+    lazydirstateObject* self,
+    PyObject* args) {
+  PyObject *dmap, *cmap;
+
+  if (!PyArg_ParseTuple(
+          args, "O!O!:todict", &PyDict_Type, &dmap, &PyDict_Type, &cmap))
+    return NULL;
+  if (self->data == NULL) {
+    PyErr_SetString(PyExc_ValueError, "lazydirstate is not initialized");
+    return NULL;
+  }
+  return _parse_dirstate(dmap, cmap, self->buf.buf, self->buf.len);
+}
+
+static PyMappingMethods lazydirstate_mapping_methods = {
+    (lenfunc)lazydirstate_size, /* mp_length */
+    (binaryfunc)lazydirstate_getitem, /* mp_subscript */
+    0, /* mp_ass_subscript */
+};
+
+static PySequenceMethods lazydirstate_sequence_methods;
+
+static PyMethodDef lazydirstate_methods[] = {
+    {"get",
+     (PyCFunction)lazydirstate_get,
+     METH_VARARGS,
+     "look up the entry for a file"},
+    {"todict",
+     (PyCFunction)lazydirstate_todict,
+     METH_VARARGS,
+     "decode every entry into a dirstate map and copy map, returning the "
+     "parents"},
+    {NULL} /* Sentinel */
+};
+
+static PyTypeObject lazydirstateType = {PyVarObject_HEAD_INIT(NULL, 0)};
+
+static int lazydirstate_type_init(void) {
+  lazydirstate_sequence_methods.sq_contains =
+      (objobjproc)lazydirstate_contains;
+  lazydirstateType.tp_name = "parsers.lazydirstate";
+  lazydirstateType.tp_new = PyType_GenericNew;
+  lazydirstateType.tp_basicsize = sizeof(lazydirstateObject);
+  lazydirstateType.tp_dealloc = (destructor)lazydirstate_dealloc;
+  lazydirstateType.tp_as_mapping = &lazydirstate_mapping_methods;
+  lazydirstateType.tp_as_sequence = &lazydirstate_sequence_methods;
+  lazydirstateType.tp_flags = Py_TPFLAGS_DEFAULT;
+  lazydirstateType.tp_doc = "lazydirstate";
+  lazydirstateType.tp_methods = lazydirstate_methods;
+  lazydirstateType.tp_init = (initproc)lazydirstate_init;
+  return PyType_Ready(&lazydirstateType);
+}
+
 /*
  * Build a set of non-normal and other parent entries from the dirstate dmap
  */
@@ -841,6 +1126,11 @@ static void module_init(PyObject* mod) {
     return;
   Py_INCREF(&dirstateTupleType);
   PyModule_AddObject(mod, "dirstatetuple", (PyObject*)&dirstateTupleType);
+
+  if (lazydirstate_type_init() < 0)
+    return;
+  Py_INCREF(&lazydirstateType);
+  PyModule_AddObject(mod, "lazydirstate", (PyObject*)&lazydirstateType);
 }
 
 static int check_python_version(void) {
@@ -28,6 +28,9 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "eden/scm/edenscm/mercurial/cext/util.h"
 
@@ -78,7 +81,7 @@ static inline void memcopy(
     const void* src,
     Py_ssize_t len) {
   if (dest) {
-    assert(*destlen + len < destsize);
+    assert(*destlen + len <= destsize);
     memcpy((void*)&dest[*destlen], src, len);
   }
   *destlen += len;
@@ -92,6 +95,41 @@ hexencode(char* dest, Py_ssize_t* destlen, size_t destsize, uint8_t c) {
   charcopy(dest, destlen, destsize, hexdigit[c & 15]);
 }
 
+static inline int isplain(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-';
+}
+
+/*
+ * Return the length of the run of lowercase letters, digits and '-' at the
+ * start of src.  Every encoding below copies these through unchanged, and
+ * they make up most of a typical path, so check 16 bytes at a time where
+ * SSE2 is available.
+ */
+static inline Py_ssize_t plainprefix(const char* src, Py_ssize_t len) {
+  Py_ssize_t i = 0;
+
+#ifdef __SSE2__
+  /* Bytes >= 0x80 compare as negative, so they fall outside every range. */
+  const __m128i alo = _mm_set1_epi8('a' - 1), ahi = _mm_set1_epi8('z' + 1);
+  const __m128i dlo = _mm_set1_epi8('0' - 1), dhi = _mm_set1_epi8('9' + 1);
+  const __m128i dash = _mm_set1_epi8('-');
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)&src[i]);
+    __m128i plain = _mm_or_si128(
+        _mm_and_si128(_mm_cmpgt_epi8(v, alo), _mm_cmplt_epi8(v, ahi)),
+        _mm_and_si128(_mm_cmpgt_epi8(v, dlo), _mm_cmplt_epi8(v, dhi)));
+    int mask = _mm_movemask_epi8(_mm_or_si128(plain, _mm_cmpeq_epi8(v, dash)));
+    if (mask != 0xffff)
+      return i + __builtin_ctz(~mask);
+  }
+#endif
+
+  while (i < len && isplain(src[i]))
+    i++;
+  return i;
+}
+
 /* 3-byte escape: tilde followed by two hex digits */
 static inline void
 escape3(char* dest, Py_ssize_t* destlen, size_t destsize, char c) {
@@ -443,7 +481,12 @@ static Py_ssize_t _encode(
             break;
         }
         break;
-      case DEFAULT:
+      case DEFAULT: {
+        Py_ssize_t n = plainprefix(&src[i], len - i);
+        memcopy(dest, &destlen, destsize, &src[i], n);
+        i += n;
+        if (i == len)
+          goto done;
         while (inset(onebyte, src[i])) {
           charcopy(dest, &destlen, destsize, src[i++]);
           if (i == len)
@@ -477,6 +520,7 @@ static Py_ssize_t _encode(
             break;
         }
         break;
+      }
     }
   }
 done:
@@ -510,6 +554,11 @@ _lowerencode(char* dest, size_t destsize, const char* src, Py_ssize_t len) {
   Py_ssize_t i, destlen = 0;
 
   for (i = 0; i < len; i++) {
+    Py_ssize_t n = plainprefix(&src[i], len - i);
+    memcopy(dest, &destlen, destsize, &src[i], n);
+    i += n;
+    if (i == len)
+      break;
     if (inset(onebyte, src[i]))
       charcopy(dest, &destlen, destsize, src[i]);
     else if (inset(lower, src[i]))
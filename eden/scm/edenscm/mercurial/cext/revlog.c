@@ -1095,6 +1095,243 @@ static int nt_init(indexObject* self) {
   return 0;
 }
 
+/*
+ * A persistent nodemap file holds a serialized nodetree, so that a process
+ * can load the trie instead of scanning the index to rebuild it.  It starts
+ * with this header, followed by ntlength nodetree records in host byte
+ * order.  The trie was built from the first revcount revisions, and is only
+ * used if the index still has at least that many, and their entries still
+ * add up to indexlength bytes of index file with the same checksum and the
+ * same last node.  Revisions appended since are inserted on load.
+ */
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t ntlength;
+  uint64_t revcount;
+  uint64_t indexlength;
+  uint64_t checksum;
+  char tipnode[20];
+  char padding[4];
+} nodemapheader;
+
+static const char nodemap_magic[8] = {'H', 'G', 'N', 'O', 'D', 'E', 'M', 'P'};
+static const uint32_t nodemap_version = 2;
+
+static inline uint64_t nodemap_mix(uint64_t hash, uint64_t value) {
+  return (hash ^ value) * 0x100000001b3ULL;
+}
+
+/*
+ * Compute the index length in bytes and the checksum of the entries of the
+ * first revcount revisions, as recorded in a persistent nodemap header.  The
+ * checksum covers each revision's data offset and length, linkrev, parents
+ * and node, so that a strip followed by adding other revisions is noticed
+ * even if the count and the last node end up the same.
+ */
+static int nodemap_summarize(
+    indexObject* self,
+    Py_ssize_t revcount,
+    uint64_t* indexlength,
+    uint64_t* checksum) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  uint64_t offset_flags = 0;
+  uint32_t comp_len = 0;
+  Py_ssize_t rev;
+
+  for (rev = 0; rev < revcount; rev++) {
+    uint32_t link_rev, parent_1, parent_2;
+    uint64_t words[3] = {0, 0, 0};
+    const char* node;
+
+    if (rev >= self->length - 1) {
+      PyObject* tuple = PyList_GET_ITEM(self->added, rev - self->length + 1);
+      offset_flags =
+          PyLong_AsUnsignedLongLongMask(PyTuple_GET_ITEM(tuple, 0));
+      comp_len = (uint32_t)PyInt_AS_LONG(PyTuple_GET_ITEM(tuple, 1));
+      link_rev = (uint32_t)PyInt_AS_LONG(PyTuple_GET_ITEM(tuple, 4));
+      parent_1 = (uint32_t)PyInt_AS_LONG(PyTuple_GET_ITEM(tuple, 5));
+      parent_2 = (uint32_t)PyInt_AS_LONG(PyTuple_GET_ITEM(tuple, 6));
+      node = PyBytes_AS_STRING(PyTuple_GET_ITEM(tuple, 7));
+    } else {
+      const char* data = index_deref(self, rev);
+      if (data == NULL)
+        return -1;
+      offset_flags = getbe32(data + 4);
+      if (rev == 0) /* mask out version number for the first entry */
+        offset_flags &= 0xFFFF;
+      else
+        offset_flags |= ((uint64_t)getbe32(data)) << 32;
+      comp_len = getbe32(data + 8);
+      link_rev = getbe32(data + 20);
+      parent_1 = getbe32(data + 24);
+      parent_2 = getbe32(data + 28);
+      node = data + 32;
+    }
+
+    memcpy(words, node, 20);
+    hash = nodemap_mix(hash, offset_flags);
+    hash = nodemap_mix(hash, ((uint64_t)comp_len << 32) | link_rev);
+    hash = nodemap_mix(hash, ((uint64_t)parent_1 << 32) | parent_2);
+    hash = nodemap_mix(hash, words[0]);
+    hash = nodemap_mix(hash, words[1]);
+    hash = nodemap_mix(hash, words[2]);
+  }
+  if (PyErr_Occurred())
+    return -1;
+
+  /* Inline revlogs interleave the revision data with the entries. */
+  *indexlength = (uint64_t)revcount * v1_hdrsize;
+  if (self->inlined && revcount > 0)
+    *indexlength += (offset_flags >> 16) + comp_len;
+  *checksum = hash;
+  return 0;
+}
+
+/*
+ * Insert every revision into the nodetree, so that it can be saved.
+ */
+static int nt_fill(indexObject* self) {
+  int rev;
+
+  if (nt_init(self) == -1)
+    return -1;
+  for (rev = self->ntrev - 1; rev >= 0; rev--) {
+    const char* n = index_node(self, rev);
+    if (n == NULL || nt_insert(self, n, rev) == -1) {
+      self->ntrev = rev + 1;
+      if (!PyErr_Occurred())
+        PyErr_SetString(PyExc_ValueError, "could not build nodetree");
+      return -1;
+    }
+  }
+  self->ntrev = 0;
+  return 0;
+}
+
+static PyObject* index_nodemapdata(indexObject* self) {
+  Py_ssize_t revcount = index_length(self) - 1;
+  nodemapheader header;
+  PyObject* data;
+  const char* tip;
+  char* out;
+
+  if (nt_fill(self) == -1)
+    return NULL;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, nodemap_magic, sizeof(header.magic));
+  header.version = nodemap_version;
+  header.ntlength = self->ntlength;
+  header.revcount = revcount;
+  tip = revcount > 0 ? index_node(self, revcount - 1) : nullid;
+  if (tip == NULL)
+    return NULL;
+  memcpy(header.tipnode, tip, sizeof(header.tipnode));
+  if (nodemap_summarize(
+          self, revcount, &header.indexlength, &header.checksum) == -1)
+    return NULL;
+
+  data = PyBytes_FromStringAndSize(
+      NULL, sizeof(header) + (Py_ssize_t)self->ntlength * sizeof(nodetree));
+  if (data == NULL)
+    return NULL;
+  out = PyBytes_AS_STRING(data);
+  memcpy(out, &header, sizeof(header));
+  memcpy(out + sizeof(header), self->nt, self->ntlength * sizeof(nodetree));
+  return data;
+}
+
+/*
+ * Replace the nodetree with one loaded from a persistent nodemap.  Returns
+ * the number of revisions the nodemap covered, or None if it could not be
+ * used, in which case the nodetree is left alone.
+ */
+static PyObject* index_loadnodemap(indexObject* self, PyObject* args) {
+  Py_ssize_t length = index_length(self) - 1;
+  nodemapheader header;
+  Py_buffer buf;
+  nodetree* nt = NULL;
+  uint32_t ntlength, i;
+  uint64_t indexlength, checksum;
+  Py_ssize_t rev;
+  const char* tip;
+  int k;
+
+  if (!PyArg_ParseTuple(args, "s*:loadnodemap", &buf))
+    return NULL;
+
+  if (buf.len < (Py_ssize_t)sizeof(header))
+    goto unusable;
+  memcpy(&header, buf.buf, sizeof(header));
+  ntlength = header.ntlength;
+  if (memcmp(header.magic, nodemap_magic, sizeof(header.magic)) != 0 ||
+      header.version != nodemap_version || ntlength == 0 ||
+      ntlength > INT_MAX / sizeof(nodetree) ||
+      (uint64_t)(buf.len - sizeof(header)) !=
+          (uint64_t)ntlength * sizeof(nodetree) ||
+      header.revcount > (uint64_t)length)
+    goto unusable;
+  tip = header.revcount > 0 ? index_node(self, header.revcount - 1) : nullid;
+  if (tip == NULL || memcmp(tip, header.tipnode, 20) != 0)
+    goto unusable;
+  if (nodemap_summarize(self, header.revcount, &indexlength, &checksum) ==
+      -1) {
+    PyBuffer_Release(&buf);
+    return NULL;
+  }
+  if (indexlength != header.indexlength || checksum != header.checksum)
+    goto unusable;
+
+  nt = malloc(ntlength * sizeof(nodetree));
+  if (nt == NULL) {
+    PyBuffer_Release(&buf);
+    return PyErr_NoMemory();
+  }
+  memcpy(
+      nt, (const char*)buf.buf + sizeof(header), ntlength * sizeof(nodetree));
+  PyBuffer_Release(&buf);
+
+  /* Reject a trie that points outside itself or at unknown revisions. */
+  for (i = 0; i < ntlength; i++) {
+    for (k = 0; k < 16; k++) {
+      int v = nt[i].children[k];
+      int valid;
+      if (v > 0)
+        valid = (uint32_t)v < ntlength;
+      else if (v < 0)
+        valid = -(v + 1) == INT_MAX || (uint64_t)(-(v + 1)) < header.revcount;
+      else
+        valid = 1;
+      if (!valid) {
+        free(nt);
+        Py_RETURN_NONE;
+      }
+    }
+  }
+
+  free(self->nt);
+  self->nt = nt;
+  self->ntlength = self->ntcapacity = ntlength;
+  self->ntdepth = self->ntsplits = 0;
+  self->ntlookups = self->ntmisses = 0;
+  self->ntrev = 0;
+  for (rev = header.revcount; rev < length; rev++) {
+    const char* n = index_node(self, rev);
+    if (n == NULL || nt_insert(self, n, (int)rev) == -1) {
+      /* Fall back to scanning for the revisions not inserted yet. */
+      self->ntrev = length;
+      PyErr_Clear();
+      break;
+    }
+  }
+  return PyInt_FromSsize_t((Py_ssize_t)header.revcount);
+
+unusable:
+  PyBuffer_Release(&buf);
+  Py_RETURN_NONE;
+}
+
 /*
  * Return values:
  *
@@ -1976,6 +2213,14 @@ static PyMethodDef index_methods[] = {
      METH_VARARGS,
      "match a potentially ambiguous node ID"},
     {"stats", (PyCFunction)index_stats, METH_NOARGS, "stats for the index"},
+    {"loadnodemap",
+     (PyCFunction)index_loadnodemap,
+     METH_VARARGS,
+     "load the nodetree from a persistent nodemap"},
+    {"nodemapdata",
+     (PyCFunction)index_nodemapdata,
+     METH_NOARGS,
+     "serialize the nodetree for a persistent nodemap"},
     {NULL} /* Sentinel */
 };
 
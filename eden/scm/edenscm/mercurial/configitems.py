@@ -238,6 +238,8 @@ coreconfigitem("email", "method", default="smtp")
 coreconfigitem("email", "reply-to", default=None)
 coreconfigitem("email", "to", default=None)
 coreconfigitem("experimental", "archivemetatemplate", default=dynamicdefault)
+coreconfigitem("experimental", "bdiff.parallel-minsize", default="1MB")
+coreconfigitem("experimental", "bdiff.parallel-threads", default=0)
 coreconfigitem("experimental", "bundle-phases", default=False)
 coreconfigitem("experimental", "bundle2-advertise", default=True)
 coreconfigitem("experimental", "bundle2-output-capture", default=False)
@@ -272,7 +274,9 @@ coreconfigitem("experimental", "evolution.bundle-obsmarker", default=False)
 coreconfigitem("experimental", "evolution.track-operation", default=True)
 coreconfigitem("experimental", "worddiff", default=False)
 coreconfigitem("experimental", "mmapindexthreshold", default=None)
+coreconfigitem("experimental", "lazydirstate", default=False)
 coreconfigitem("experimental", "nonnormalparanoidcheck", default=False)
+coreconfigitem("experimental", "persistent-nodemap", default=False)
 coreconfigitem("experimental", "exportableenviron", default=list)
 coreconfigitem("experimental", "extendedheader.index", default=None)
 coreconfigitem("experimental", "extendedheader.similarity", default=False)
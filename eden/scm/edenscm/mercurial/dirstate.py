@@ -1297,6 +1297,23 @@ class dirstatemap(object):
         self.read()
         return self._map
 
+    @propertycache
+    def _lazymap(self):
+        """A parsers.lazydirstate over the dirstate file, or None
+
+        Lookups are served from it until something needs the whole map, at
+        which point _map is decoded from the same snapshot.
+        """
+        if not self._ui.configbool("experimental", "lazydirstate"):
+            return None
+        if not util.safehasattr(parsers, "lazydirstate"):
+            return None
+        # Windows cannot replace a file that is mapped.
+        st = self._readdirstatefile(mmap=not pycompat.iswindows)
+        if not st:
+            return None
+        return parsers.lazydirstate(util.buffer(st))
+
     @propertycache
     def copymap(self):
         self.copymap = {}
@@ -1327,12 +1344,18 @@ class dirstatemap(object):
         return iter(self._map)
 
     def get(self, key, default=None):
+        if "_map" not in self.__dict__ and self._lazymap is not None:
+            return self._lazymap.get(key, default)
         return self._map.get(key, default)
 
     def __contains__(self, key):
+        if "_map" not in self.__dict__ and self._lazymap is not None:
+            return key in self._lazymap
         return key in self._map
 
     def __getitem__(self, key):
+        if "_map" not in self.__dict__ and self._lazymap is not None:
+            return self._lazymap[key]
         return self._map[key]
 
     def keys(self):
@@ -1498,20 +1521,44 @@ class dirstatemap(object):
         self._parents = (p1, p2)
         self._dirtyparents = True
 
-    def read(self):
+    def _readdirstatefile(self, mmap=False):
+        """Returns the contents of the dirstate file, or None if it is missing"""
         # ignore HG_PENDING because identity is used only for writing
         self.identity = util.filestat.frompath(self._opener.join(self._filename))
 
         try:
             fp = self._opendirstatefile()
             try:
-                st = fp.read()
+                if mmap:
+                    return util.mmapread(fp)
+                return fp.read()
             finally:
                 fp.close()
         except IOError as err:
             if err.errno != errno.ENOENT:
                 raise
+            return None
+
+    def _readlazymap(self, lazymap):
+        if util.safehasattr(parsers, "dict_new_presized"):
+            self._map = parsers.dict_new_presized(len(lazymap))
+        # Decode the snapshot that lookups have been served from, rather than
+        # whatever the file contains now.
+        p = util.nogc(lazymap.todict)(self._map, self.copymap)
+        if not self._dirtyparents:
+            self.setparents(*p)
+
+        self.__contains__ = self._map.__contains__
+        self.__getitem__ = self._map.__getitem__
+        self.get = self._map.get
+
+    def read(self):
+        lazymap = self.__dict__.pop("_lazymap", None)
+        if lazymap is not None:
+            self._readlazymap(lazymap)
             return
+
+        st = self._readdirstatefile()
         if not st:
             return
 
@@ -40,6 +40,7 @@ from . import (
     hintutil,
     hook,
     i18n,
+    mdiff,
     perftrace,
     profiling,
     pycompat,
@@ -1089,6 +1090,13 @@ def _dispatch(req):
         if options["profile"]:
             profiler.start()
 
+        bdiffthreads = ui.configint("experimental", "bdiff.parallel-threads")
+        if bdiffthreads > 1:
+            mdiff.setbdiffparallel(
+                bdiffthreads,
+                ui.configbytes("experimental", "bdiff.parallel-minsize"),
+            )
+
         if options["verbose"] or options["debug"] or options["quiet"]:
             for opt in ("verbose", "debug", "quiet"):
                 val = str(bool(options[opt]))
@@ -862,6 +862,9 @@ class localrepository(object):
         mmapindexthreshold = self.ui.configbytes("experimental", "mmapindexthreshold")
         if mmapindexthreshold is not None:
             self.svfs.options["mmapindexthreshold"] = mmapindexthreshold
+        self.svfs.options["persistentnodemap"] = self.ui.configbool(
+            "experimental", "persistent-nodemap"
+        )
         withsparseread = self.ui.configbool("experimental", "sparse-read")
         srdensitythres = float(
             self.ui.config("experimental", "sparse-read.density-threshold")
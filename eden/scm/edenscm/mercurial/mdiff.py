@@ -36,6 +36,7 @@ fixws = bdiff.fixws
 patches = mpatch.patches
 patchedsize = mpatch.patchedsize
 textdiff = bdiff.bdiff
+setbdiffparallel = bdiff.setparallel
 
 
 # called by dispatch.py
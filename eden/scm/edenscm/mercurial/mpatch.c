@@ -146,59 +146,62 @@ static int discard(struct mpatch_flist* src, int cut, int offset) {
   return offset;
 }
 
+/* append the combination of hunk lists a and b to c, while adjusting b for
+   offset changes in a. this consumes a. c needs room for at most
+   lsize(a) + 2 * lsize(b) hunks: besides the hunks of a and b, each hunk of
+   b may split one hunk of a. */
+static void combineinto(
+    struct mpatch_flist* c,
+    struct mpatch_flist* a,
+    struct mpatch_flist* b) {
+  struct mpatch_frag *bh, *ct;
+  int offset = 0, post;
+
+  for (bh = b->head; bh != b->tail; bh++) {
+    /* save old hunks */
+    offset = gather(c, a, bh->start, offset);
+
+    /* discard replaced hunks */
+    post = discard(a, bh->end, offset);
+
+    /* insert new hunk */
+    ct = c->tail;
+    ct->start = bh->start - offset;
+    ct->end = bh->end - post;
+    ct->len = bh->len;
+    ct->data = bh->data;
+    c->tail++;
+    offset = post;
+  }
+
+  /* hold on to tail from a */
+  memcpy(c->tail, a->head, sizeof(struct mpatch_frag) * lsize(a));
+  c->tail += lsize(a);
+}
+
 /* combine hunk lists a and b, while adjusting b for offset changes in a/
    this deletes a and b and returns the resultant list. */
 static struct mpatch_flist* combine(
     struct mpatch_flist* a,
     struct mpatch_flist* b) {
   struct mpatch_flist* c = NULL;
-  struct mpatch_frag *bh, *ct;
-  int offset = 0, post;
 
   if (a && b)
     c = lalloc((lsize(a) + lsize(b)) * 2);
 
-  if (c) {
-    for (bh = b->head; bh != b->tail; bh++) {
-      /* save old hunks */
-      offset = gather(c, a, bh->start, offset);
-
-      /* discard replaced hunks */
-      post = discard(a, bh->end, offset);
-
-      /* insert new hunk */
-      ct = c->tail;
-      ct->start = bh->start - offset;
-      ct->end = bh->end - post;
-      ct->len = bh->len;
-      ct->data = bh->data;
-      c->tail++;
-      offset = post;
-    }
-
-    /* hold on to tail from a */
-    memcpy(c->tail, a->head, sizeof(struct mpatch_frag) * lsize(a));
-    c->tail += lsize(a);
-  }
+  if (c)
+    combineinto(c, a, b);
 
   mpatch_lfree(a);
   mpatch_lfree(b);
   return c;
 }
 
-/* decode a binary patch into a hunk list */
-int mpatch_decode(const char* bin, ssize_t len, struct mpatch_flist** res) {
-  struct mpatch_flist* l;
-  struct mpatch_frag* lt;
+/* decode a binary patch into l, which has room for len / 12 + 1 hunks */
+static int decodeinto(const char* bin, ssize_t len, struct mpatch_flist* l) {
+  struct mpatch_frag* lt = l->tail;
   int pos = 0;
 
-  /* assume worst case size, we won't have many of these lists */
-  l = lalloc(len / 12 + 1);
-  if (!l)
-    return MPATCH_ERR_NO_MEM;
-
-  lt = l->tail;
-
   /* `len - 11` because we access the pos + 11th byte */
   while (pos >= 0 && pos < len - 11) {
     lt->start = getbe32(bin + pos);
@@ -211,12 +214,29 @@ int mpatch_decode(const char* bin, ssize_t len, struct mpatch_flist** res) {
     lt++;
   }
 
-  if (pos != len) {
-    mpatch_lfree(l);
+  if (pos != len)
     return MPATCH_ERR_CANNOT_BE_DECODED;
-  }
 
   l->tail = lt;
+  return 0;
+}
+
+/* decode a binary patch into a hunk list */
+int mpatch_decode(const char* bin, ssize_t len, struct mpatch_flist** res) {
+  struct mpatch_flist* l;
+  int err;
+
+  /* assume worst case size, we won't have many of these lists */
+  l = lalloc(len / 12 + 1);
+  if (!l)
+    return MPATCH_ERR_NO_MEM;
+
+  err = decodeinto(bin, len, l);
+  if (err < 0) {
+    mpatch_lfree(l);
+    return err;
+  }
+
   *res = l;
   return 0;
 }
@@ -283,3 +303,136 @@ struct mpatch_flist* mpatch_fold(
       mpatch_fold(bins, get_next_item, start, start + len),
       mpatch_fold(bins, get_next_item, start + len, end));
 }
+
+/* count the hunks of a binary patch, or return an error like mpatch_decode */
+static ssize_t counthunks(const char* bin, ssize_t len) {
+  ssize_t count = 0;
+  int pos = 0, start, end, l;
+
+  while (pos >= 0 && pos < len - 11) {
+    start = getbe32(bin + pos);
+    end = getbe32(bin + pos + 4);
+    l = getbe32(bin + pos + 8);
+    pos += 12 + l;
+    if (start > end || l < 0)
+      break; /* sanity check */
+    count++;
+  }
+
+  if (pos != len)
+    return MPATCH_ERR_CANNOT_BE_DECODED;
+  return count;
+}
+
+/* the arena of mpatch_foldinto holds a hunk list per bin, followed by two
+   regions of hunks: each level of the fold reads lists from one region and
+   writes the combined lists to the other. cap is the number of hunks each
+   region holds, the most that any level needs. */
+static ssize_t foldcap(const struct mpatch_bin* bins, ssize_t count) {
+  ssize_t *sizes, cap = 1, total = 0, i, n, size;
+
+  sizes = (ssize_t*)malloc(sizeof(ssize_t) * count);
+  if (!sizes)
+    return MPATCH_ERR_NO_MEM;
+
+  for (i = 0; i < count; i++) {
+    size = counthunks(bins[i].data, bins[i].len);
+    if (size < 0) {
+      free(sizes);
+      return size;
+    }
+    sizes[i] = size;
+    total += size;
+  }
+
+  for (n = count;; n = (n + 1) / 2) {
+    if (total > cap)
+      cap = total;
+    if (n == 1)
+      break;
+    total = 0;
+    for (i = 0; i < n / 2; i++) {
+      sizes[i] = sizes[2 * i] + 2 * sizes[2 * i + 1];
+      total += sizes[i];
+    }
+    if (n % 2) {
+      sizes[n / 2] = sizes[n - 1];
+      total += sizes[n / 2];
+    }
+  }
+
+  free(sizes);
+  return cap;
+}
+
+ssize_t mpatch_foldsize(const struct mpatch_bin* bins, ssize_t count) {
+  ssize_t cap;
+
+  if (count < 1)
+    return MPATCH_ERR_INVALID_PATCH;
+  cap = foldcap(bins, count);
+  if (cap < 0)
+    return cap;
+  return sizeof(struct mpatch_flist) * count +
+      sizeof(struct mpatch_frag) * cap * 2;
+}
+
+int mpatch_foldinto(
+    const struct mpatch_bin* bins,
+    ssize_t count,
+    void* arena,
+    size_t arenasize,
+    struct mpatch_flist* res) {
+  struct mpatch_flist* lists = (struct mpatch_flist*)arena;
+  struct mpatch_frag *src, *dst, *tmp, *p;
+  ssize_t cap, need, i, n;
+  int err;
+
+  if (count < 1)
+    return MPATCH_ERR_INVALID_PATCH;
+  if (arenasize < sizeof(struct mpatch_flist) * count)
+    return MPATCH_ERR_NO_MEM;
+  cap = (arenasize - sizeof(struct mpatch_flist) * count) /
+      (sizeof(struct mpatch_frag) * 2);
+  src = (struct mpatch_frag*)(lists + count);
+  dst = src + cap;
+
+  /* decode every bin, one after another */
+  for (i = 0, p = src; i < count; i++) {
+    if (counthunks(bins[i].data, bins[i].len) > src + cap - p)
+      return MPATCH_ERR_NO_MEM;
+    lists[i].base = lists[i].head = lists[i].tail = p;
+    err = decodeinto(bins[i].data, bins[i].len, &lists[i]);
+    if (err < 0)
+      return err;
+    p = lists[i].tail;
+  }
+
+  /* combine adjacent lists until one is left */
+  for (n = count; n > 1; n = (n + 1) / 2) {
+    for (i = 0, need = 0; i < n; i++)
+      need += lsize(&lists[i]) * (i % 2 ? 2 : 1);
+    if (need > cap)
+      return MPATCH_ERR_NO_MEM;
+
+    p = dst;
+    for (i = 0; i < n / 2; i++) {
+      struct mpatch_flist c = {p, p, p};
+      combineinto(&c, &lists[2 * i], &lists[2 * i + 1]);
+      lists[i] = c;
+      p = c.tail;
+    }
+    if (n % 2) {
+      struct mpatch_flist* last = &lists[n - 1];
+      memcpy(p, last->head, sizeof(struct mpatch_frag) * lsize(last));
+      lists[n / 2].base = lists[n / 2].head = p;
+      lists[n / 2].tail = p + lsize(last);
+    }
+    tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  *res = lists[0];
+  return 0;
+}
@@ -42,4 +42,25 @@ struct mpatch_flist* mpatch_fold(
     ssize_t start,
     ssize_t end);
 
+/* a binary patch, for mpatch_foldinto */
+struct mpatch_bin {
+  const char* data;
+  ssize_t len;
+};
+
+/* size in bytes of the arena mpatch_foldinto needs for bins[0:count], or a
+   negative MPATCH_ERR if a bin cannot be decoded */
+ssize_t mpatch_foldsize(const struct mpatch_bin* bins, ssize_t count);
+
+/* like mpatch_fold, but without allocating: bins[0:count] are decoded into
+   the arena, which should be aligned like memory returned by malloc, and
+   combined level by level in it. the resultant hunk list res points into the
+   arena and must not be freed with mpatch_lfree. */
+int mpatch_foldinto(
+    const struct mpatch_bin* bins,
+    ssize_t count,
+    void* arena,
+    size_t arenasize,
+    struct mpatch_flist* res);
+
 #endif
@@ -373,6 +373,10 @@ class revlog(object):
         self._srmingapsize = 262144
 
         mmapindexthreshold = None
+        # Name of the persistent nodemap file, if one is used.
+        self._nodemapfile = None
+        # Number of revisions the persistent nodemap file covers.
+        self._nodemaprevs = 0
         v = REVLOG_DEFAULT_VERSION
         opts = getattr(opener, "options", None)
         if opts is not None:
@@ -392,6 +396,8 @@ class revlog(object):
                 self._compengine = opts["compengine"]
             if mmaplargeindex and "mmapindexthreshold" in opts:
                 mmapindexthreshold = opts["mmapindexthreshold"]
+            if mmaplargeindex and opts.get("persistentnodemap", False):
+                self._nodemapfile = indexfile[:-2] + ".n"
             self._withsparseread = bool(opts.get("with-sparse-read", False))
             if "sparse-read-density-threshold" in opts:
                 self._srdensitythreshold = opts["sparse-read-density-threshold"]
@@ -456,6 +462,8 @@ class revlog(object):
         self.index, nodemap, self._chunkcache = d
         if nodemap is not None:
             self.nodemap = self._nodecache = nodemap
+            if self._nodemapfile is not None and not self._initempty:
+                self._loadnodemap()
         if index2:
             self.index2 = bindings.revlogindex.revlogindex(indexdata)
         if not self._chunkcache:
@@ -465,6 +473,42 @@ class revlog(object):
         # revlog header -> revlog compressor
         self._decompressors = {}
 
+    # Rewrite the persistent nodemap once this many revisions have been added
+    # since it was written.  Until then they are inserted when it is loaded.
+    _nodemaprewriterevs = 1000
+
+    def _loadnodemap(self):
+        loadnodemap = getattr(self.index, "loadnodemap", None)
+        if loadnodemap is None:
+            return
+        try:
+            with self.opener(self._nodemapfile) as f:
+                data = util.buffer(util.mmapread(f))
+        except IOError as inst:
+            if inst.errno != errno.ENOENT:
+                raise
+            return
+        # The nodemap is ignored if it does not match the index.
+        revs = loadnodemap(data)
+        if revs is not None:
+            self._nodemaprevs = revs
+
+    def _writenodemap(self, tr):
+        nodemapdata = getattr(self.index, "nodemapdata", None)
+        if nodemapdata is None:
+            return
+        revs = len(self)
+        if revs - self._nodemaprevs < self._nodemaprewriterevs:
+            return
+        try:
+            with self.opener(self._nodemapfile, "wb", atomictemp=True) as f:
+                f.write(nodemapdata())
+        except (IOError, OSError):
+            # The nodemap is only a cache, so lookups just fall back to
+            # scanning the index.
+            return
+        self._nodemaprevs = revs
+
     @util.propertycache
     def _compressor(self):
         return util.compengines[self._compengine].revlogcompressor()
@@ -2088,6 +2132,11 @@ class revlog(object):
         if dfh:
             dfh.seek(0, os.SEEK_END)
 
+        if self._nodemapfile is not None:
+            transaction.addpostclose(
+                "nodemap-%s" % self.indexfile, self._writenodemap
+            )
+
         curr = len(self) - 1
         if not self._inline:
             transaction.add(self.datafile, offset)
@@ -2300,6 +2349,9 @@ class revlog(object):
             del self.nodemap[self.node(x)]
 
         del self.index[rev:-1]
+        # The persistent nodemap no longer matches the index, and will be
+        # ignored until it is rewritten.
+        self._nodemaprevs = min(self._nodemaprevs, rev)
 
     def checksize(self):
         expected = 0
@@ -30,6 +30,18 @@ std::unique_ptr<folly::IOBuf> bytesToIOBuf(RustCBytes* bytes) {
       },
       reinterpret_cast<void*>(bytes));
 }
+
+std::vector<RustRequest> toRustRequests(
+    const std::vector<std::pair<folly::ByteRange, folly::ByteRange>>&
+        requests) {
+  std::vector<RustRequest> rustRequests;
+  rustRequests.reserve(requests.size());
+  for (const auto& request : requests) {
+    rustRequests.push_back(RustRequest{
+        request.first.data(), request.first.size(), request.second.data()});
+  }
+  return rustRequests;
+}
 } // namespace
 
 HgNativeBackingStore::HgNativeBackingStore(
@@ -89,6 +101,63 @@ std::shared_ptr<RustTree> HgNativeBackingStore::getTree(folly::ByteRange node) {
   return manifest.unwrap();
 }
 
+void HgNativeBackingStore::getBlobBatch(
+    const std::vector<std::pair<folly::ByteRange, folly::ByteRange>>&
+        requests,
+    bool local,
+    std::function<void(size_t, std::unique_ptr<folly::IOBuf>)>&& resolve) {
+  XLOG(DBG7) << "Importing " << requests.size() << " blobs from hgcache";
+  auto rustRequests = toRustRequests(requests);
+
+  rust_backingstore_get_blob_batch(
+      store_.get(),
+      rustRequests.data(),
+      rustRequests.size(),
+      local,
+      &resolve,
+      [](void* data, uintptr_t index, RustCFallibleBase base) {
+        auto& resolver = *static_cast<
+            std::function<void(size_t, std::unique_ptr<folly::IOBuf>)>*>(
+            data);
+        RustCFallible<RustCBytes> result(std::move(base), rust_cbytes_free);
+        if (result.isError()) {
+          XLOG(DBG5) << "Error while getting blob in batch: "
+                     << result.getError();
+          resolver(index, nullptr);
+        } else {
+          resolver(index, bytesToIOBuf(result.unwrap().release()));
+        }
+      });
+}
+
+void HgNativeBackingStore::getTreeBatch(
+    const std::vector<std::pair<folly::ByteRange, folly::ByteRange>>&
+        requests,
+    bool local,
+    std::function<void(size_t, std::shared_ptr<RustTree>)>&& resolve) {
+  XLOG(DBG7) << "Importing " << requests.size() << " trees from hgcache";
+  auto rustRequests = toRustRequests(requests);
+
+  rust_backingstore_get_tree_batch(
+      store_.get(),
+      rustRequests.data(),
+      rustRequests.size(),
+      local,
+      &resolve,
+      [](void* data, uintptr_t index, RustCFallibleBase base) {
+        auto& resolver = *static_cast<
+            std::function<void(size_t, std::shared_ptr<RustTree>)>*>(data);
+        RustCFallible<RustTree> result(std::move(base), rust_tree_free);
+        if (result.isError()) {
+          XLOG(DBG5) << "Error while getting tree in batch: "
+                     << result.getError();
+          resolver(index, nullptr);
+        } else {
+          resolver(index, result.unwrap());
+        }
+      });
+}
+
 void HgNativeBackingStore::refresh() {
   XLOG(DBG7) << "Refreshing backing store";
 
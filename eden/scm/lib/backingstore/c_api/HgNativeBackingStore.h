@@ -7,7 +7,10 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <functional>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "eden/scm/lib/backingstore/c_api/RustBackingStore.h"
 
@@ -27,6 +30,27 @@ class HgNativeBackingStore {
 
   std::shared_ptr<RustTree> getTree(folly::ByteRange node);
 
+  /**
+   * Imports the blobs for the given (name, node) pairs with a single call
+   * into the backing store, so that the missing ones are fetched together.
+   * resolve is called with the index of each request, and with nullptr for
+   * the blobs that could not be found.
+   */
+  void getBlobBatch(
+      const std::vector<std::pair<folly::ByteRange, folly::ByteRange>>&
+          requests,
+      bool local,
+      std::function<void(size_t, std::unique_ptr<folly::IOBuf>)>&& resolve);
+
+  /**
+   * Like getBlobBatch, but for the trees with the given (path, node) pairs.
+   */
+  void getTreeBatch(
+      const std::vector<std::pair<folly::ByteRange, folly::ByteRange>>&
+          requests,
+      bool local,
+      std::function<void(size_t, std::shared_ptr<RustTree>)>&& resolve);
+
   void refresh();
 
  private:
@@ -101,6 +101,13 @@ operator folly::ByteRange() const {
 }
 };
 
+/// The path of a file or directory along with its 20-byte node hash.
+struct RustRequest {
+  const uint8_t *path;
+  uintptr_t length;
+  const uint8_t *node;
+};
+
 struct RustTreeEntry {
   RustCBytes hash;
   RustCBytes name;
@@ -128,10 +135,24 @@ RustCFallibleBase rust_backingstore_get_blob(RustBackingStore *store,
                                                          uintptr_t node_len,
                                                          bool local);
 
+void rust_backingstore_get_blob_batch(RustBackingStore *store,
+                                      const RustRequest *requests,
+                                      uintptr_t size,
+                                      bool local,
+                                      void *data,
+                                      void (*resolve)(void*, uintptr_t, RustCFallibleBase));
+
 RustCFallibleBase rust_backingstore_get_tree(RustBackingStore *store,
                                                        const uint8_t *node,
                                                        uintptr_t node_len);
 
+void rust_backingstore_get_tree_batch(RustBackingStore *store,
+                                      const RustRequest *requests,
+                                      uintptr_t size,
+                                      bool local,
+                                      void *data,
+                                      void (*resolve)(void*, uintptr_t, RustCFallibleBase));
+
 RustCFallibleBase rust_backingstore_new(const char *repository,
                                                           size_t repository_len,
                                                           bool use_edenapi);
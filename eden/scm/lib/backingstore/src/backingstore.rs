@@ -15,8 +15,9 @@ use manifest::{List, Manifest};
 use manifest_tree::TreeManifest;
 use revisionstore::{
     ContentStore, ContentStoreBuilder, EdenApiHgIdRemoteStore, HgIdDataStore, LocalStore,
-    MemcacheStore, StoreKey,
+    MemcacheStore, RemoteDataStore, StoreKey,
 };
+use std::collections::HashSet;
 use std::path::Path;
 use std::sync::Arc;
 use types::{Key, Node, RepoPath};
@@ -72,18 +73,42 @@ impl BackingStore {
     /// Reads file from blobstores. When `local_only` is true, this function will only read blobs
     /// from on disk stores.
     pub fn get_blob(&self, path: &[u8], node: &[u8], local_only: bool) -> Result<Option<Vec<u8>>> {
-        let path = RepoPath::from_utf8(path)?.to_owned();
-        let node = Node::from_slice(node)?;
-        let key = Key::new(path, node);
+        let key = Self::get_key(path, node)?;
 
         // check if the blob present on disk
         if local_only && !self.blobstore.contains(&StoreKey::from(&key))? {
             return Ok(None);
         }
 
+        self.get_blob_by_key(&key)
+    }
+
+    /// Reads multiple files from blobstores, calling `resolve` with the index and result of each
+    /// key. Blobs missing from the on disk stores are found with a single scan, and unless
+    /// `local_only` is true, are fetched from the server with a single request rather than one
+    /// request per blob.
+    pub fn get_blob_batch<F>(&self, keys: Vec<Result<Key>>, local_only: bool, resolve: F)
+    where
+        F: Fn(usize, Result<Option<Vec<u8>>>),
+    {
+        let missing = Self::prepare_batch(&self.blobstore, &keys, local_only);
+
+        for (index, key) in keys.into_iter().enumerate() {
+            let result = key.and_then(|key| {
+                if missing.contains(&StoreKey::from(&key)) {
+                    Ok(None)
+                } else {
+                    self.get_blob_by_key(&key)
+                }
+            });
+            resolve(index, result);
+        }
+    }
+
+    fn get_blob_by_key(&self, key: &Key) -> Result<Option<Vec<u8>>> {
         // Return None for LFS blobs
         // TODO: LFS support
-        if let Ok(Some(metadata)) = self.blobstore.get_meta(&key) {
+        if let Ok(Some(metadata)) = self.blobstore.get_meta(key) {
             if metadata.is_lfs() {
                 return Ok(None);
             }
@@ -91,10 +116,48 @@ impl BackingStore {
 
         Ok(self
             .blobstore
-            .get_file_content(&key)?
+            .get_file_content(key)?
             .map(|blob| blob.as_ref().to_vec()))
     }
 
+    /// Builds the key for the given path and node, in the format taken by the batch methods.
+    pub fn get_key(path: &[u8], node: &[u8]) -> Result<Key> {
+        let path = RepoPath::from_utf8(path)?.to_owned();
+        let node = Node::from_slice(node)?;
+        Ok(Key::new(path, node))
+    }
+
+    /// Returns the keys that are missing from the on disk stores when `local_only` is true, and
+    /// otherwise fetches them all from the server at once.
+    fn prepare_batch(
+        store: &ContentStore,
+        keys: &[Result<Key>],
+        local_only: bool,
+    ) -> HashSet<StoreKey> {
+        let store_keys: Vec<StoreKey> = keys
+            .iter()
+            .filter_map(|key| key.as_ref().ok())
+            .map(StoreKey::from)
+            .collect();
+
+        if local_only {
+            match store.get_missing(&store_keys) {
+                Ok(missing) => missing.into_iter().collect(),
+                Err(e) => {
+                    // Treat everything as missing, which is what a failed lookup would do.
+                    warn!("couldn't check the local store for a batch: {}", e);
+                    store_keys.into_iter().collect()
+                }
+            }
+        } else {
+            // Anything this fails to fetch is reported as not found by the individual lookups.
+            if let Err(e) = store.prefetch(&store_keys) {
+                warn!("couldn't prefetch a batch: {}", e);
+            }
+            HashSet::new()
+        }
+    }
+
     pub fn get_tree(&self, node: &[u8]) -> Result<List> {
         let node = Node::from_slice(node)?;
         let manifest = TreeManifest::durable(self.treestore.clone(), node);
@@ -102,6 +165,27 @@ impl BackingStore {
         manifest.list(RepoPath::empty())
     }
 
+    /// Reads multiple trees, calling `resolve` with the index and result of each key. Like
+    /// `get_blob_batch`, this checks the on disk stores once and, unless `local_only` is true,
+    /// fetches the missing trees from the server with a single request.
+    pub fn get_tree_batch<F>(&self, keys: Vec<Result<Key>>, local_only: bool, resolve: F)
+    where
+        F: Fn(usize, Result<Option<List>>),
+    {
+        let missing = Self::prepare_batch(self.treestore.as_content_store(), &keys, local_only);
+
+        for (index, key) in keys.into_iter().enumerate() {
+            let result = key.and_then(|key| {
+                if missing.contains(&StoreKey::from(&key)) {
+                    Ok(None)
+                } else {
+                    self.get_tree(key.hgid.as_ref()).map(Some)
+                }
+            });
+            resolve(index, result);
+        }
+    }
+
     /// forces backing store to rescan pack files
     pub fn refresh(&self) {
         self.blobstore.get_missing(&[]).ok();
@@ -8,12 +8,12 @@
 //! Provides the c-bindings for `crate::backingstore`.
 
 use anyhow::{ensure, Error, Result};
-use libc::{c_char, size_t};
+use libc::{c_char, c_void, size_t};
 use std::convert::TryInto;
 use std::{slice, str};
 
 use crate::backingstore::BackingStore;
-use crate::raw::{CBytes, CFallible, Tree};
+use crate::raw::{CBytes, CFallible, Request, Tree};
 
 fn stringpiece_to_slice<'a, T, U>(ptr: *const T, length: size_t) -> Result<&'a [U]> {
     ensure!(!ptr.is_null(), "string ptr is null");
@@ -82,6 +82,29 @@ pub extern "C" fn rust_backingstore_get_blob(
     backingstore_get_blob(store, name, name_len, node, node_len, local).into()
 }
 
+#[no_mangle]
+pub extern "C" fn rust_backingstore_get_blob_batch(
+    store: *mut BackingStore,
+    requests: *const Request,
+    size: usize,
+    local: bool,
+    data: *mut c_void,
+    resolve: unsafe extern "C" fn(*mut c_void, usize, CFallible<CBytes>),
+) {
+    assert!(!store.is_null());
+    let store = unsafe { &*store };
+    let requests: &[Request] = unsafe { slice::from_raw_parts(requests, size) };
+    let keys = requests.iter().map(|request| request.try_into_key()).collect();
+
+    store.get_blob_batch(keys, local, |idx, result| {
+        let result = result
+            .and_then(|opt| opt.ok_or_else(|| Error::msg("no blob found")))
+            .map(CBytes::from_vec)
+            .map(|result| Box::into_raw(Box::new(result)));
+        unsafe { resolve(data, idx, result.into()) };
+    });
+}
+
 fn backingstore_get_tree(
     store: *mut BackingStore,
     node: *const u8,
@@ -106,6 +129,29 @@ pub extern "C" fn rust_backingstore_get_tree(
     backingstore_get_tree(store, node, node_len).into()
 }
 
+#[no_mangle]
+pub extern "C" fn rust_backingstore_get_tree_batch(
+    store: *mut BackingStore,
+    requests: *const Request,
+    size: usize,
+    local: bool,
+    data: *mut c_void,
+    resolve: unsafe extern "C" fn(*mut c_void, usize, CFallible<Tree>),
+) {
+    assert!(!store.is_null());
+    let store = unsafe { &*store };
+    let requests: &[Request] = unsafe { slice::from_raw_parts(requests, size) };
+    let keys = requests.iter().map(|request| request.try_into_key()).collect();
+
+    store.get_tree_batch(keys, local, |idx, result| {
+        let result: Result<Tree> = result
+            .and_then(|opt| opt.ok_or_else(|| Error::msg("no tree found")))
+            .and_then(|list| list.try_into());
+        let result = result.map(|result| Box::into_raw(Box::new(result)));
+        unsafe { resolve(data, idx, result.into()) };
+    });
+}
+
 #[no_mangle]
 pub extern "C" fn rust_tree_free(tree: *mut Tree) {
     assert!(!tree.is_null());
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+//! Representation of one key in a batch of blobs or trees requested by EdenFS.
+
+use anyhow::Result;
+use std::slice;
+use types::Key;
+
+use crate::backingstore::BackingStore;
+
+/// The path of a file or directory along with its 20-byte node hash.
+#[repr(C)]
+pub struct Request {
+    path: *const u8,
+    length: usize,
+    node: *const u8,
+}
+
+impl Request {
+    pub fn try_into_key(&self) -> Result<Key> {
+        let path = unsafe { slice::from_raw_parts(self.path, self.length) };
+        let node = unsafe { slice::from_raw_parts(self.node, 20) };
+        BackingStore::get_key(path, node)
+    }
+}
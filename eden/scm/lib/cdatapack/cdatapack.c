@@ -163,6 +163,91 @@ bool find(
   return false;
 }
 
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH_READ(addr) __builtin_prefetch((addr), 0)
+#else
+#define PREFETCH_READ(addr) ((void)(addr))
+#endif
+
+/**
+ * Looks up many nodes at once.  The nodes must be sorted in ascending order,
+ * which lets each search start where the previous one ended, so the index is
+ * walked once from start to end.  Sets found[i] to whether nodes[i] is in the
+ * index.
+ */
+void find_batch(
+    const datapack_handle_t* handle,
+    const uint8_t* const* nodes,
+    size_t count,
+    bool* found) {
+  // No entry before this one can match any of the remaining nodes.
+  index_offset_t cursor = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    const uint8_t* node = nodes[i];
+    found[i] = false;
+
+    uint16_t fanout_idx = get_fanout_index(handle, node);
+    index_offset_t start = handle->fanout_table[fanout_idx].start_index;
+    index_offset_t end = handle->fanout_table[fanout_idx].end_index;
+    if (start > end) {
+      // empty bucket.
+      continue;
+    }
+    if (start < cursor) {
+      start = cursor;
+    }
+
+    if (i + 1 < count) {
+      // Start loading the first entry the next search will look at while
+      // this one proceeds.
+      const fanout_table_entry_t* next =
+          &handle->fanout_table[get_fanout_index(handle, nodes[i + 1])];
+      if (next->start_index <= next->end_index) {
+        PREFETCH_READ(&handle->index_table
+                           [next->start_index +
+                            ((next->end_index - next->start_index) / 2)]);
+      }
+    }
+
+    // indices are INCLUSIVE, so the search is <=
+    while (start <= end) {
+      index_offset_t middle = start + ((end - start) / 2);
+
+      int cmp = memcmp(node, handle->index_table[middle].node, NODE_SZ);
+      if (cmp < 0) {
+        if (middle == 0) {
+          // don't wrap around.
+          break;
+        }
+        end = middle - 1;
+      } else if (cmp > 0) {
+        start = middle + 1;
+      } else {
+        found[i] = true;
+        start = middle;
+        break;
+      }
+    }
+
+    // start is now where node is, or where it would be inserted.
+    cursor = start;
+  }
+}
+
+size_t get_index_entry_count(const datapack_handle_t* handle) {
+  const char* index_end =
+      ((const char*)handle->index_mmap) + handle->index_file_sz;
+  return (size_t)(
+      (const disk_index_entry_t*)index_end - handle->index_table);
+}
+
+const uint8_t* get_index_entry_node(
+    const datapack_handle_t* handle,
+    size_t index) {
+  return handle->index_table[index].node;
+}
+
 static void backfill_fanout_entries(
     datapack_handle_t* handle,
     size_t fanout_idx_start,
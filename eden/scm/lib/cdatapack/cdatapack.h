@@ -144,6 +144,29 @@ extern bool find(
     const uint8_t node[NODE_SZ],
     pack_index_entry_t* packindex);
 
+/**
+ * Looks up count nodes, which must be sorted in ascending order, walking the
+ * index once.  Sets found[i] to whether nodes[i] is in the index.
+ */
+extern void find_batch(
+    const datapack_handle_t* handle,
+    const uint8_t* const* nodes,
+    size_t count,
+    bool* found);
+
+/**
+ * Returns the number of entries in the index.
+ */
+extern size_t get_index_entry_count(const datapack_handle_t* handle);
+
+/**
+ * Returns the node of the index entry at the given position, which must be
+ * less than get_index_entry_count().
+ */
+extern const uint8_t* get_index_entry_node(
+    const datapack_handle_t* handle,
+    size_t index);
+
 /**
  * Retrieves a delta chain for a given node.
  */
@@ -22,6 +22,10 @@ extern "C" void hgrc_configset_free(HgRcConfigSetStruct* configset) noexcept;
 extern "C" HgRcBytesStruct* hgrc_configset_load_path(
     HgRcConfigSetStruct* ptr,
     const char* path) noexcept;
+extern "C" HgRcBytesStruct* hgrc_configset_load_path_with_snapshot(
+    HgRcConfigSetStruct* ptr,
+    const char* path,
+    const char* snapshotPath) noexcept;
 extern "C" HgRcBytesStruct* hgrc_configset_load_system(
     HgRcConfigSetStruct* ptr) noexcept;
 extern "C" HgRcBytesStruct* hgrc_configset_load_user(
@@ -65,6 +69,18 @@ void HgRcConfigSet::loadPath(const char* path) {
   throw HgRcConfigError(errorText.stringPiece().str());
 }
 
+void HgRcConfigSet::loadPathWithSnapshot(
+    const char* path,
+    const char* snapshotPath) {
+  auto result =
+      hgrc_configset_load_path_with_snapshot(ptr_.get(), path, snapshotPath);
+  if (!result) {
+    return;
+  }
+  HgRcBytes errorText(result);
+  throw HgRcConfigError(errorText.stringPiece().str());
+}
+
 void HgRcConfigSet::loadSystem() {
   auto result = hgrc_configset_load_system(ptr_.get());
   if (!result) {
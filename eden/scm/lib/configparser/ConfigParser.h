@@ -56,6 +56,12 @@ class HgRcConfigSet {
   // Throws HgRcConfigError if there were error(s)
   void loadPath(const char* path);
 
+  // Like loadPath(), but skips parsing if the snapshot at snapshotPath shows
+  // that none of the loaded files changed since it was written, and writes a
+  // new snapshot otherwise.
+  // Throws HgRcConfigError if there were error(s)
+  void loadPathWithSnapshot(const char* path, const char* snapshotPath);
+
   // Attempt to load the system configuration files
   // Throws HgRcConfigError if there were error(s)
   void loadSystem();
@@ -78,6 +78,34 @@ pub extern "C" fn hgrc_configset_load_path(cfg: *mut ConfigSet, path: *const c_c
     load_path(cfg, path)
 }
 
+/// Like hgrc_configset_load_path(), but skips parsing if the snapshot at
+/// snapshot_path shows that none of the loaded files changed, and writes a new
+/// snapshot otherwise.
+#[no_mangle]
+pub extern "C" fn hgrc_configset_load_path_with_snapshot(
+    cfg: *mut ConfigSet,
+    path: *const c_char,
+    snapshot_path: *const c_char,
+) -> *mut Text {
+    debug_assert!(!path.is_null());
+    debug_assert!(!snapshot_path.is_null());
+    debug_assert!(!cfg.is_null());
+
+    let mut paths = Vec::with_capacity(2);
+    for ptr in [path, snapshot_path].iter() {
+        let cstr = unsafe { CStr::from_ptr(*ptr) };
+        match cstr.to_str() {
+            Ok(path) => paths.push(Path::new(path)),
+            Err(e) => return errors_to_bytes(vec![Error::Utf8Path(cstr.to_owned(), e)]),
+        }
+    }
+
+    let cfg = unsafe { &mut *cfg };
+
+    let errors = cfg.load_path_with_snapshot(paths[0], paths[1], &Options::new().process_hgplain());
+    errors_to_bytes(errors)
+}
+
 /// Load system config files
 #[no_mangle]
 pub extern "C" fn hgrc_configset_load_system(cfg: *mut ConfigSet) -> *mut Text {
@@ -14,6 +14,7 @@ use std::ops::Range;
 use std::path::{Path, PathBuf};
 use std::str;
 use std::sync::Arc;
+use std::time::SystemTime;
 
 use indexmap::IndexMap;
 use minibytes::Text;
@@ -22,6 +23,7 @@ use util::path::expand_path;
 
 use crate::error::Error;
 use crate::parser::{ConfigParser, Rule};
+use crate::snapshot;
 
 type Pair<'a> = pest::iterators::Pair<'a, Rule>;
 
@@ -105,6 +107,72 @@ impl ConfigSet {
         errors
     }
 
+    /// Like `load_path`, but skip parsing if the snapshot at `snapshot_path`
+    /// shows that none of the files loaded from `path` changed since it was
+    /// written. Otherwise `path` is parsed as usual and, if that succeeded, a
+    /// new snapshot is written for the next load.
+    ///
+    /// Values loaded from a snapshot have no `ValueLocation`. Failing to read
+    /// or write the snapshot is not an error.
+    pub fn load_path_with_snapshot<P: AsRef<Path>, S: AsRef<Path>>(
+        &mut self,
+        path: P,
+        snapshot_path: S,
+        opts: &Options,
+    ) -> Vec<Error> {
+        self.load_path_with_snapshot_at(
+            path.as_ref(),
+            snapshot_path.as_ref(),
+            opts,
+            SystemTime::now(),
+        )
+    }
+
+    pub(crate) fn load_path_with_snapshot_at(
+        &mut self,
+        path: &Path,
+        snapshot_path: &Path,
+        opts: &Options,
+        now: SystemTime,
+    ) -> Vec<Error> {
+        if let Some(values) = snapshot::read(snapshot_path, path) {
+            for (section, name, value) in values {
+                self.set_internal(section, name, value, None, opts);
+            }
+            return Vec::new();
+        }
+
+        // Load into a separate set without filters, so the snapshot has the
+        // values as they are in the files.
+        let mut raw = ConfigSet::new();
+        let raw_opts = Options {
+            source: opts.source.clone(),
+            filters: Vec::new(),
+        };
+        let mut visited = HashSet::new();
+        let mut errors = Vec::new();
+        raw.load_file(path, &raw_opts, &mut visited, &mut errors);
+
+        let mut values = Vec::new();
+        let mut locations = Vec::new();
+        for (section_name, section) in raw.sections {
+            for (name, sources) in section.items {
+                for source in sources {
+                    values.push((section_name.clone(), name.clone(), source.value));
+                    locations.push(source.location);
+                }
+            }
+        }
+        if errors.is_empty() {
+            let files: Vec<PathBuf> = visited.into_iter().collect();
+            let _ = snapshot::write(snapshot_path, path, &files, &values, now);
+        }
+        for ((section, name, value), location) in values.into_iter().zip(locations) {
+            self.set_internal(section, name, value, location, opts);
+        }
+        errors
+    }
+
     /// Load content of an unnamed config file. The `ValueLocation`s of loaded config items will
     /// have an empty `path`.
     ///
@@ -221,6 +289,10 @@ impl ConfigSet {
                 Err(error) => errors.push(Error::Io(path.to_path_buf(), error)),
             }
         } else {
+            // Remember the path, so a snapshot of this load is invalidated
+            // if the file is created later.
+            visited.insert(path.to_path_buf());
+
             // On Windows, a UNC path `\\?\C:\foo\.\x` will fail to canonicalize
             // because it contains `.`. That path can be constructed by using
             // `PathBuf::join` to concatenate a UNC path `\\?\C:\foo` with
@@ -604,6 +676,7 @@ impl SupersetVerification {
 pub(crate) mod tests {
     use super::*;
     use std::io::Write;
+    use std::time::Duration;
     use tempdir::TempDir;
 
     #[test]
@@ -1035,6 +1108,54 @@ pub(crate) mod tests {
         assert_eq!(cfg.get("y", "b"), Some(Text::from("2")));
     }
 
+    #[test]
+    fn test_load_path_with_snapshot() {
+        let dir = TempDir::new("test_load_path_with_snapshot").unwrap();
+        let rootrc = dir.path().join("rootrc");
+        let snapshot = dir.path().join("snapshot");
+        write_file(
+            rootrc.clone(),
+            "[x]\na=1\nb=1\n%include a.rc\n%include b.rc\n%unset b",
+        );
+        write_file(dir.path().join("a.rc"), "[y]\nc=2\n[x]\na=2");
+
+        // Pretend the files were written long enough ago to be snapshotted.
+        let load = |now| {
+            let mut cfg = ConfigSet::new();
+            let now = SystemTime::now() + Duration::from_secs(now);
+            let errors = cfg.load_path_with_snapshot_at(&rootrc, &snapshot, &"snap".into(), now);
+            assert!(errors.is_empty());
+            cfg
+        };
+
+        let cfg = load(10);
+        assert!(cfg.get_sources("x", "a")[0].location().is_some());
+        assert!(snapshot.exists());
+
+        let cfg = load(10);
+        assert_eq!(cfg.sections(), vec![Text::from("x"), Text::from("y")]);
+        assert_eq!(cfg.keys("x"), vec![Text::from("a"), Text::from("b")]);
+        assert_eq!(cfg.get("x", "a"), Some(Text::from("2")));
+        assert_eq!(cfg.get("x", "b"), None);
+        assert_eq!(cfg.get("y", "c"), Some(Text::from("2")));
+        let sources = cfg.get_sources("x", "a");
+        assert_eq!(sources.len(), 2);
+        assert_eq!(sources[1].source(), &Text::from("snap"));
+        assert!(sources[1].location().is_none());
+
+        // Creating an included file that was missing invalidates the snapshot.
+        write_file(dir.path().join("b.rc"), "[z]\nd=3");
+        let cfg = load(10);
+        assert_eq!(cfg.get("z", "d"), Some(Text::from("3")));
+        assert!(cfg.get_sources("z", "d")[0].location().is_some());
+
+        // Files modified too recently are not snapshotted.
+        fs::remove_file(&snapshot).unwrap();
+        let cfg = load(0);
+        assert_eq!(cfg.get("z", "d"), Some(Text::from("3")));
+        assert!(!snapshot.exists());
+    }
+
     #[test]
     fn test_serialize() {
         let mut cfg = ConfigSet::new();
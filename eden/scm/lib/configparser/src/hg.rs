@@ -23,6 +23,7 @@ use crate::error::Error;
 pub const HGPLAIN: &str = "HGPLAIN";
 pub const HGPLAINEXCEPT: &str = "HGPLAINEXCEPT";
 pub const HGRCPATH: &str = "HGRCPATH";
+pub const HGRCSNAPSHOTDIR: &str = "HGRCSNAPSHOTDIR";
 
 pub trait OptionsHgExt {
     /// Drop configs according to `$HGPLAIN` and `$HGPLAINEXCEPT`.
@@ -46,6 +47,8 @@ pub trait OptionsHgExt {
 
 pub trait ConfigSetHgExt {
     /// Load system config files if `$HGRCPATH` is not set.
+    /// If `$HGRCSNAPSHOTDIR` is set, each file is loaded through a snapshot in
+    /// that directory, so that it is not parsed again while unchanged.
     /// Return errors parsing files.
     fn load_system(&mut self) -> Vec<Error>;
 
@@ -220,6 +223,19 @@ impl OptionsHgExt for Options {
     }
 }
 
+/// Load a system config file, through a snapshot in `$HGRCSNAPSHOTDIR` if
+/// that is set.
+fn load_system_path(cfg: &mut ConfigSet, path: impl AsRef<Path>, opts: &Options) -> Vec<Error> {
+    let path = path.as_ref();
+    match (env::var_os(HGRCSNAPSHOTDIR), path.file_name()) {
+        (Some(dir), Some(name)) => {
+            let snapshot = Path::new(&dir).join(format!("{}.snapshot", name.to_string_lossy()));
+            cfg.load_path_with_snapshot(path, snapshot, opts)
+        }
+        _ => cfg.load_path(path, opts),
+    }
+}
+
 impl ConfigSetHgExt for ConfigSet {
     fn load_system(&mut self) -> Vec<Error> {
         let opts = Options::new().source("system").process_hgplain();
@@ -228,22 +244,36 @@ impl ConfigSetHgExt for ConfigSet {
         if env::var(HGRCPATH).is_err() {
             #[cfg(unix)]
             {
-                errors.append(&mut self.load_path("/etc/mercurial/system.rc", &opts));
+                errors.append(&mut load_system_path(
+                    self,
+                    "/etc/mercurial/system.rc",
+                    &opts,
+                ));
                 // TODO(T40519286): Remove this after the tupperware overrides move out of hgrc.d
-                errors.append(
-                    &mut self.load_path("/etc/mercurial/hgrc.d/tupperware_overrides.rc", &opts),
-                );
+                errors.append(&mut load_system_path(
+                    self,
+                    "/etc/mercurial/hgrc.d/tupperware_overrides.rc",
+                    &opts,
+                ));
                 // TODO(quark): Remove this after packages using system.rc are rolled out
-                errors.append(&mut self.load_path("/etc/mercurial/hgrc.d/include.rc", &opts));
+                errors.append(&mut load_system_path(
+                    self,
+                    "/etc/mercurial/hgrc.d/include.rc",
+                    &opts,
+                ));
             }
 
             #[cfg(windows)]
             {
                 if let Ok(program_data_path) = env::var("PROGRAMDATA") {
                     let hgrc_dir = Path::new(&program_data_path).join("Facebook\\Mercurial");
-                    errors.append(&mut self.load_path(hgrc_dir.join("system.rc"), &opts));
+                    errors.append(&mut load_system_path(
+                        self,
+                        hgrc_dir.join("system.rc"),
+                        &opts,
+                    ));
                     // TODO(quark): Remove this after packages using system.rc are rolled out
-                    errors.append(&mut self.load_path(hgrc_dir.join("hgrc"), &opts));
+                    errors.append(&mut load_system_path(self, hgrc_dir.join("hgrc"), &opts));
                 }
             }
         }
@@ -812,6 +842,25 @@ mod tests {
         assert_eq!(cfg.get("y", "b"), Some("2".into()));
     }
 
+    #[test]
+    fn test_load_system_path_with_snapshot() {
+        let dir = TempDir::new("test_load_system_path_with_snapshot").unwrap();
+        let path = dir.path().join("system.rc");
+        write_file(path.clone(), "[x]\na=1\n");
+
+        let _guard = ENV_LOCK.lock();
+        env::remove_var(HGPLAIN);
+        env::set_var(HGRCSNAPSHOTDIR, dir.path());
+
+        let opts = Options::new().process_hgplain();
+        for _ in 0..2 {
+            let mut cfg = ConfigSet::new();
+            assert!(load_system_path(&mut cfg, &path, &opts).is_empty());
+            assert_eq!(cfg.get("x", "a"), Some("1".into()));
+        }
+        env::remove_var(HGRCSNAPSHOTDIR);
+    }
+
     #[test]
     fn test_load_hgrc() {
         let dir = TempDir::new("test_hgrcpath").unwrap();
@@ -71,6 +71,7 @@ pub mod config;
 pub mod error;
 pub mod hg;
 pub mod parser;
+mod snapshot;
 
 pub use error::Error;
 
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+//! Binary snapshots of loaded config files.
+//!
+//! A snapshot records the values set by loading a config path, in the order
+//! they were set and before any `Options` filters, together with the path,
+//! mtime, size and inode of every file the load looked at. Files that did not
+//! exist are recorded too, so that creating an `%include`d file invalidates
+//! the snapshot. If none of the files changed, the values can be replayed
+//! from the snapshot instead of parsing the files again.
+//!
+//! Format (integers are little endian, strings are a u32 length followed by
+//! UTF-8 bytes):
+//!
+//! ```plain,ignore
+//! magic "HGRCSNP1"
+//! string root path
+//! u32 file count, then per file:
+//!     string path, u8 exists, u64 mtime seconds, u32 mtime nanoseconds,
+//!     u64 size, u64 inode
+//! u32 value count, then per value:
+//!     string section, string name, u8 has value, [string value]
+//! ```
+
+use std::fs;
+use std::io::{self, Write};
+use std::path::{Path, PathBuf};
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+
+use memmap::Mmap;
+use minibytes::Text;
+
+const MAGIC: &[u8] = b"HGRCSNP1";
+
+/// Files modified this recently may change again within the resolution of
+/// their mtime, so a snapshot of them could not be trusted.
+const AMBIGUOUS_MTIME: Duration = Duration::from_secs(2);
+
+/// A (section, name, value) triple, as passed to `ConfigSet::set_internal`.
+pub(crate) type SnapshotValue = (Text, Text, Option<Text>);
+
+#[derive(Debug, PartialEq)]
+struct FileStamp {
+    exists: bool,
+    mtime_secs: u64,
+    mtime_nanos: u32,
+    size: u64,
+    inode: u64,
+}
+
+impl FileStamp {
+    fn of(path: &Path) -> io::Result<FileStamp> {
+        let metadata = match fs::metadata(path) {
+            Ok(metadata) => metadata,
+            Err(error) if error.kind() == io::ErrorKind::NotFound => {
+                return Ok(FileStamp {
+                    exists: false,
+                    mtime_secs: 0,
+                    mtime_nanos: 0,
+                    size: 0,
+                    inode: 0,
+                });
+            }
+            Err(error) => return Err(error),
+        };
+        let mtime = metadata
+            .modified()?
+            .duration_since(UNIX_EPOCH)
+            .unwrap_or_default();
+        Ok(FileStamp {
+            exists: true,
+            mtime_secs: mtime.as_secs(),
+            mtime_nanos: mtime.subsec_nanos(),
+            size: metadata.len(),
+            inode: inode(&metadata),
+        })
+    }
+
+    fn is_ambiguous(&self, now: SystemTime) -> bool {
+        let mtime = UNIX_EPOCH + Duration::new(self.mtime_secs, self.mtime_nanos);
+        self.exists && mtime + AMBIGUOUS_MTIME > now
+    }
+}
+
+#[cfg(unix)]
+fn inode(metadata: &fs::Metadata) -> u64 {
+    use std::os::unix::fs::MetadataExt;
+    metadata.ino()
+}
+
+#[cfg(not(unix))]
+fn inode(_metadata: &fs::Metadata) -> u64 {
+    0
+}
+
+/// Return the values in the snapshot at `snapshot_path`, or `None` if there
+/// is no usable snapshot of loading `root`.
+pub(crate) fn read(snapshot_path: &Path, root: &Path) -> Option<Vec<SnapshotValue>> {
+    let file = fs::File::open(snapshot_path).ok()?;
+    let mmap = unsafe { Mmap::map(&file) }.ok()?;
+    let mut reader = Reader { buf: &mmap[..] };
+
+    if reader.take(MAGIC.len())? != MAGIC || Path::new(reader.string()?) != root {
+        return None;
+    }
+    for _ in 0..reader.u32()? {
+        let path = Path::new(reader.string()?);
+        let stamp = FileStamp {
+            exists: reader.u8()? != 0,
+            mtime_secs: reader.u64()?,
+            mtime_nanos: reader.u32()?,
+            size: reader.u64()?,
+            inode: reader.u64()?,
+        };
+        if FileStamp::of(path).ok()? != stamp {
+            return None;
+        }
+    }
+
+    let count = reader.u32()? as usize;
+    let mut values = Vec::with_capacity(count.min(reader.buf.len()));
+    for _ in 0..count {
+        let section = Text::copy_from_slice(reader.string()?);
+        let name = Text::copy_from_slice(reader.string()?);
+        let value = match reader.u8()? {
+            0 => None,
+            _ => Some(Text::copy_from_slice(reader.string()?)),
+        };
+        values.push((section, name, value));
+    }
+    Some(values)
+}
+
+/// Write a snapshot of loading `root`, which looked at `files` and set
+/// `values`. Nothing is written if a file was modified too recently before
+/// `now` for its stamp to be trusted.
+pub(crate) fn write(
+    snapshot_path: &Path,
+    root: &Path,
+    files: &[PathBuf],
+    values: &[SnapshotValue],
+    now: SystemTime,
+) -> io::Result<()> {
+    let mut buf = Vec::new();
+    buf.extend_from_slice(MAGIC);
+    write_path(&mut buf, root)?;
+    write_u32(&mut buf, files.len())?;
+    for path in files {
+        let stamp = FileStamp::of(path)?;
+        if stamp.is_ambiguous(now) {
+            return Ok(());
+        }
+        write_path(&mut buf, path)?;
+        buf.push(stamp.exists as u8);
+        buf.extend_from_slice(&stamp.mtime_secs.to_le_bytes());
+        buf.extend_from_slice(&stamp.mtime_nanos.to_le_bytes());
+        buf.extend_from_slice(&stamp.size.to_le_bytes());
+        buf.extend_from_slice(&stamp.inode.to_le_bytes());
+    }
+    write_u32(&mut buf, values.len())?;
+    for (section, name, value) in values {
+        write_string(&mut buf, section)?;
+        write_string(&mut buf, name)?;
+        match value {
+            None => buf.push(0),
+            Some(value) => {
+                buf.push(1);
+                write_string(&mut buf, value)?;
+            }
+        }
+    }
+
+    // Write to a temporary file and rename it, so readers never see a
+    // partially written snapshot.
+    let mut temp_path = snapshot_path.as_os_str().to_owned();
+    temp_path.push(format!(".{}.tmp", std::process::id()));
+    let temp_path = PathBuf::from(temp_path);
+    let result = fs::File::create(&temp_path)
+        .and_then(|mut file| file.write_all(&buf))
+        .and_then(|_| fs::rename(&temp_path, snapshot_path));
+    if result.is_err() {
+        let _ = fs::remove_file(&temp_path);
+    }
+    result
+}
+
+fn write_u32(buf: &mut Vec<u8>, value: usize) -> io::Result<()> {
+    if value > u32::max_value() as usize {
+        return Err(io::Error::new(io::ErrorKind::InvalidData, "too large"));
+    }
+    buf.extend_from_slice(&(value as u32).to_le_bytes());
+    Ok(())
+}
+
+fn write_string(buf: &mut Vec<u8>, value: &str) -> io::Result<()> {
+    write_u32(buf, value.len())?;
+    buf.extend_from_slice(value.as_bytes());
+    Ok(())
+}
+
+fn write_path(buf: &mut Vec<u8>, path: &Path) -> io::Result<()> {
+    match path.to_str() {
+        Some(path) => write_string(buf, path),
+        None => Err(io::Error::new(
+            io::ErrorKind::InvalidData,
+            "path is not UTF-8",
+        )),
+    }
+}
+
+struct Reader<'a> {
+    buf: &'a [u8],
+}
+
+impl<'a> Reader<'a> {
+    fn take(&mut self, len: usize) -> Option<&'a [u8]> {
+        if self.buf.len() < len {
+            return None;
+        }
+        let (head, tail) = self.buf.split_at(len);
+        self.buf = tail;
+        Some(head)
+    }
+
+    fn u8(&mut self) -> Option<u8> {
+        Some(self.take(1)?[0])
+    }
+
+    fn u32(&mut self) -> Option<u32> {
+        let mut bytes = [0; 4];
+        bytes.copy_from_slice(self.take(4)?);
+        Some(u32::from_le_bytes(bytes))
+    }
+
+    fn u64(&mut self) -> Option<u64> {
+        let mut bytes = [0; 8];
+        bytes.copy_from_slice(self.take(8)?);
+        Some(u64::from_le_bytes(bytes))
+    }
+
+    fn string(&mut self) -> Option<&'a str> {
+        let len = self.u32()? as usize;
+        std::str::from_utf8(self.take(len)?).ok()
+    }
+}
@@ -5,7 +5,10 @@
  * GNU General Public License version 2.
  */
 
-use std::path::{Path, PathBuf};
+use std::{
+    path::{Path, PathBuf},
+    time::Duration,
+};
 
 use url::Url;
 
@@ -14,6 +17,8 @@ use configparser::{config::ConfigSet, hg::ConfigSetHgExt};
 
 use crate::errors::{ApiErrorContext, ApiErrorKind, ApiResult};
 
+const DEFAULT_RETRY_BACKOFF_MS: u64 = 100;
+
 #[derive(Default)]
 pub struct Config {
     pub(crate) base_url: Option<Url>,
@@ -25,6 +30,9 @@ pub struct Config {
     pub(crate) stream_data: bool,
     pub(crate) stream_history: bool,
     pub(crate) stream_trees: bool,
+    pub(crate) max_concurrent_requests: Option<usize>,
+    pub(crate) max_retries: usize,
+    pub(crate) retry_backoff: Duration,
 }
 
 impl Config {
@@ -68,6 +76,17 @@ impl Config {
         let stream_trees = config
             .get_or_default("edenapi", "streamtrees")
             .context(ApiErrorKind::BadConfig("edenapi.streamtrees".into()))?;
+        let max_concurrent_requests = config
+            .get_opt("edenapi", "maxconcurrentrequests")
+            .context(ApiErrorKind::BadConfig(
+                "edenapi.maxconcurrentrequests".into(),
+            ))?;
+        let max_retries = config
+            .get_or_default("edenapi", "maxretries")
+            .context(ApiErrorKind::BadConfig("edenapi.maxretries".into()))?;
+        let retry_backoff_ms: Option<u64> = config
+            .get_opt("edenapi", "retrybackoffms")
+            .context(ApiErrorKind::BadConfig("edenapi.retrybackoffms".into()))?;
 
         Ok(Self {
             base_url,
@@ -79,6 +98,11 @@ impl Config {
             stream_data,
             stream_history,
             stream_trees,
+            max_concurrent_requests,
+            max_retries,
+            retry_backoff: Duration::from_millis(
+                retry_backoff_ms.unwrap_or(DEFAULT_RETRY_BACKOFF_MS),
+            ),
         })
     }
 
@@ -155,6 +179,28 @@ impl Config {
         self.stream_trees = stream_trees;
         self
     }
+
+    /// The most HTTP requests (HTTP/2 streams) of a single fetch that may be
+    /// in flight at once. The rest start as earlier ones complete.
+    /// Setting this to `None` sends all of them at once.
+    pub fn max_concurrent_requests(mut self, max: Option<usize>) -> Self {
+        self.max_concurrent_requests = max;
+        self
+    }
+
+    /// Number of times a data fetch that failed because of the network or
+    /// the server is retried, waiting `retry_backoff` before the first retry
+    /// and twice as long before each subsequent one.
+    pub fn max_retries(mut self, max_retries: usize) -> Self {
+        self.max_retries = max_retries;
+        self
+    }
+
+    /// How long to wait before the first retry of a failed data fetch.
+    pub fn retry_backoff(mut self, backoff: Duration) -> Self {
+        self.retry_backoff = backoff;
+        self
+    }
 }
 
 /// Client credentials for TLS mutual authentication, including an X.509 client
@@ -5,7 +5,14 @@
  * GNU General Public License version 2.
  */
 
-use std::{cmp, sync::mpsc::channel, sync::Arc, thread, time::Instant};
+use std::{
+    cmp,
+    collections::{HashMap, HashSet},
+    sync::mpsc::channel,
+    sync::Arc,
+    thread,
+    time::{Duration, Instant},
+};
 
 use anyhow::{format_err, Result};
 use bytes::Bytes;
@@ -89,6 +96,9 @@ pub struct EdenApiCurlClient {
     stream_data: bool,
     stream_history: bool,
     stream_trees: bool,
+    max_concurrent_requests: Option<usize>,
+    max_retries: usize,
+    retry_backoff: Duration,
 }
 
 // Public API.
@@ -115,6 +125,9 @@ impl EdenApiCurlClient {
             stream_data: config.stream_data,
             stream_history: config.stream_history,
             stream_trees: config.stream_trees,
+            max_concurrent_requests: config.max_concurrent_requests,
+            max_retries: config.max_retries,
+            retry_backoff: config.retry_backoff,
         })
     }
 }
@@ -216,6 +229,7 @@ impl EdenApi for EdenApiCurlClient {
                 self.creds.as_ref(),
                 requests,
                 progress,
+                self.max_concurrent_requests,
                 |response: Vec<(RepoPathBuf, WireHistoryEntry)>| {
                     num_responses += 1;
                     for (path, entry) in response {
@@ -233,6 +247,7 @@ impl EdenApi for EdenApiCurlClient {
                 self.creds.as_ref(),
                 requests,
                 progress,
+                self.max_concurrent_requests,
                 |response: Vec<HistoryResponse>| {
                     num_responses += 1;
                     for entry in response.into_iter().flatten() {
@@ -287,6 +302,7 @@ impl EdenApi for EdenApiCurlClient {
                 creds,
                 requests,
                 progress,
+                self.max_concurrent_requests,
                 |entries| {
                     responses.push(entries);
                     Ok(())
@@ -299,6 +315,7 @@ impl EdenApi for EdenApiCurlClient {
                 creds,
                 requests,
                 progress,
+                self.max_concurrent_requests,
                 |multi_responses: Vec<DataResponse>| {
                     for response in multi_responses {
                         responses.push(response.into_iter().collect());
@@ -348,22 +365,90 @@ impl EdenApiCurlClient {
         log::debug!("Using batch size: {}", batch_size);
         log::debug!("Preparing {} requests", num_requests);
 
-        let mut requests = Vec::with_capacity(num_requests);
-        for batch in &keys.into_iter().chunks(batch_size) {
-            let keys = batch.collect();
-            requests.push(DataRequest { keys });
-        }
+        let chunks = keys.into_iter().chunks(batch_size);
+        let batches: Vec<Vec<Key>> = (&chunks).into_iter().map(Iterator::collect).collect();
+        let batch_of_key: HashMap<&Key, usize> = batches
+            .iter()
+            .enumerate()
+            .flat_map(|(i, keys)| keys.iter().map(move |key| (key, i)))
+            .collect();
+
+        // Each retry only re-sends the batches that have not received a
+        // response yet; the responses of the others are kept. Only the first
+        // attempt reports progress, since the progress of a retry restarts
+        // from zero.
+        let mut pending: Vec<usize> = (0..batches.len()).collect();
+        let mut responses = Vec::with_capacity(batches.len());
+        let mut progress = progress;
+        let mut attempt = 0;
+        let stats = loop {
+            let requests = pending.iter().map(|&i| DataRequest {
+                keys: batches[i].clone(),
+            });
+            let received = responses.len();
+            let e = match self.fetch_data(&url, requests, progress.take(), &mut responses) {
+                Ok(stats) => break stats,
+                Err(e) => e,
+            };
+            if attempt >= self.max_retries || !is_retryable(&e) {
+                return Err(e);
+            }
+
+            // Each response answers exactly one request, so the batch that
+            // its first key belongs to is done.
+            let done: HashSet<usize> = responses[received..]
+                .iter()
+                .filter_map(|entries| entries.first())
+                .filter_map(|entry| batch_of_key.get(entry.key()).cloned())
+                .collect();
+            pending.retain(|i| !done.contains(i));
+
+            let backoff = self.retry_backoff * (1 << cmp::min(attempt, 16));
+            attempt += 1;
+            log::warn!(
+                "Data fetch failed ({}); retrying {}/{} requests in {:?} (attempt {}/{})",
+                &e,
+                pending.len(),
+                batches.len(),
+                &backoff,
+                attempt,
+                self.max_retries
+            );
+            thread::sleep(backoff);
+        };
 
-        let mut responses = Vec::new();
+        let iter = responses
+            .into_iter()
+            .flatten()
+            .map(|entry| {
+                check_data(&entry, self.validate)
+                    .context(ApiErrorKind::BadResponse)
+                    .map(|data| (entry.key().clone(), data))
+            })
+            .collect::<ApiResult<Vec<(Key, Bytes)>>>()?;
+        Ok((Box::new(iter.into_iter()), stats))
+    }
+
+    /// Send the given data requests, appending the entries of each response
+    /// to `responses` as it arrives. If a request fails, the responses that
+    /// were received before the failure are still appended.
+    fn fetch_data(
+        &self,
+        url: &Url,
+        requests: impl IntoIterator<Item = DataRequest>,
+        progress: Option<ProgressFn>,
+        responses: &mut Vec<Vec<DataEntry>>,
+    ) -> ApiResult<DownloadStats> {
         let mut num_responses = 0;
         let mut num_entries = 0;
         let stats = if self.stream_data {
             multi_request_threaded(
                 self.multi.clone(),
-                url,
+                url.clone(),
                 self.creds.as_ref(),
                 requests,
                 progress,
+                self.max_concurrent_requests,
                 |entries: Vec<DataEntry>| {
                     num_responses += 1;
                     num_entries += entries.len();
@@ -374,10 +459,11 @@ impl EdenApiCurlClient {
         } else {
             multi_request_threaded(
                 self.multi.clone(),
-                url,
+                url.clone(),
                 self.creds.as_ref(),
                 requests,
                 progress,
+                self.max_concurrent_requests,
                 |multi_responses: Vec<DataResponse>| {
                     for response in multi_responses {
                         num_responses += 1;
@@ -394,30 +480,32 @@ impl EdenApiCurlClient {
             num_responses,
             num_entries
         );
+        Ok(stats)
+    }
+}
 
-        let iter = responses
-            .into_iter()
-            .flatten()
-            .map(|entry| {
-                check_data(&entry, self.validate)
-                    .context(ApiErrorKind::BadResponse)
-                    .map(|data| (entry.key().clone(), data))
-            })
-            .collect::<ApiResult<Vec<(Key, Bytes)>>>()?;
-        Ok((Box::new(iter.into_iter()), stats))
+/// Whether a failed request may succeed if sent again: network and TLS
+/// errors and server-side HTTP errors are assumed to be transient.
+fn is_retryable(error: &ApiError) -> bool {
+    match error.kind() {
+        ApiErrorKind::Curl | ApiErrorKind::Tls | ApiErrorKind::Proxy(_) => true,
+        ApiErrorKind::Http { code, .. } => code.is_server_error(),
+        _ => false,
     }
 }
 
 /// Send multiple concurrent POST requests using the given requests as the
 /// CBOR payload of each respective request. Assumes that the responses are
 /// CBOR encoded, and automatically deserializes them before passing
-/// them to the given callback.
+/// them to the given callback. At most `max_in_flight` of the requests are
+/// sent at once, if given; the rest are sent as earlier ones complete.
 fn multi_request<'a, R, I, T, F>(
     multi: &'a mut Multi,
     url: &Url,
     creds: Option<&ClientCreds>,
     requests: I,
     progress_cb: Option<ProgressFn>,
+    max_in_flight: Option<usize>,
     mut response_cb: F,
 ) -> ApiResult<DownloadStats>
 where
@@ -432,6 +520,7 @@ where
     let mut progress = ProgressReporter::with_capacity(num_requests);
     let mut driver = MultiDriver::with_capacity(multi, num_requests);
     driver.fail_early(true);
+    driver.max_in_flight(max_in_flight);
 
     for request in requests {
         let updater = progress.new_updater();
@@ -511,6 +600,7 @@ fn multi_request_threaded<R, I, T, F>(
     creds: Option<&ClientCreds>,
     requests: I,
     progress_cb: Option<ProgressFn>,
+    max_in_flight: Option<usize>,
     mut response_cb: F,
 ) -> ApiResult<DownloadStats>
 where
@@ -535,6 +625,7 @@ where
             creds.as_ref(),
             requests,
             progress_cb,
+            max_in_flight,
             |response: Vec<T>| {
                 Ok(tx
                     .send(response)
@@ -5,7 +5,7 @@
  * GNU General Public License version 2.
  */
 
-use std::{cell::RefCell, mem, time::Duration};
+use std::{cell::RefCell, collections::VecDeque, mem, time::Duration};
 
 use curl::{
     self,
@@ -28,6 +28,9 @@ pub struct MultiDriver<'a, H> {
     progress: Option<ProgressReporter>,
     num_transfers: usize,
     fail_early: bool,
+    max_in_flight: Option<usize>,
+    in_flight: usize,
+    pending: VecDeque<Easy2<H>>,
 }
 
 impl<'a, H> MultiDriver<'a, H> {
@@ -38,6 +41,9 @@ impl<'a, H> MultiDriver<'a, H> {
             progress: None,
             num_transfers: 0,
             fail_early: false,
+            max_in_flight: None,
+            in_flight: 0,
+            pending: VecDeque::new(),
         }
     }
 
@@ -49,8 +55,26 @@ impl<'a, H> MultiDriver<'a, H> {
         self.progress.as_ref()
     }
 
+    /// Limit the number of transfers that may be active at once. Handles
+    /// added beyond the limit are queued, and added to the Multi stack as
+    /// earlier transfers complete. This must be set before adding handles.
+    pub fn max_in_flight(&mut self, max_in_flight: Option<usize>) {
+        self.max_in_flight = max_in_flight.map(|max| max.max(1));
+    }
+
     /// Add an Easy2 handle to the Multi stack.
     pub fn add(&mut self, easy: Easy2<H>) -> ApiResult<()> {
+        self.num_transfers += 1;
+        match self.max_in_flight {
+            Some(max) if self.in_flight >= max => {
+                self.pending.push_back(easy);
+                Ok(())
+            }
+            _ => self.start(easy),
+        }
+    }
+
+    fn start(&mut self, easy: Easy2<H>) -> ApiResult<()> {
         // Assign a token to this Easy2 handle so we can correlate messages
         // for this handle with the corresponding Easy2Handle while the
         // Easy2 is owned by the Multi handle.
@@ -59,10 +83,24 @@ impl<'a, H> MultiDriver<'a, H> {
         let mut handle = self.multi.add2(easy)?;
         handle.set_token(token)?;
         handles.push(Some(handle));
-        self.num_transfers += 1;
+        self.in_flight += 1;
         Ok(())
     }
 
+    /// Start queued transfers until the in-flight limit is reached again.
+    /// Returns the number of transfers started.
+    fn start_pending(&mut self) -> ApiResult<usize> {
+        let mut started = 0;
+        while self.max_in_flight.map_or(true, |max| self.in_flight < max) {
+            match self.pending.pop_front() {
+                Some(easy) => self.start(easy)?,
+                None => break,
+            }
+            started += 1;
+        }
+        Ok(started)
+    }
+
     /// If `fail_early` is set to true, then the driver will return early if
     /// any transfers fail (leaving the remaining transfers in an unfinished
     /// state); otherwise, the driver will only return once all transfers
@@ -80,14 +118,16 @@ impl<'a, H> MultiDriver<'a, H> {
         F: FnMut(Result<Easy2<H>, curl::Error>) -> ApiResult<()>,
     {
         let mut in_progress = self.num_transfers;
+        let mut finished = 0;
         let mut i = 0;
 
         loop {
             log::trace!(
-                "Iteration {}: {}/{} transfers complete",
+                "Iteration {}: {}/{} transfers complete ({} in progress)",
                 i,
-                self.num_transfers - in_progress,
-                self.num_transfers
+                finished,
+                self.num_transfers,
+                in_progress
             );
             i += 1;
 
@@ -96,6 +136,7 @@ impl<'a, H> MultiDriver<'a, H> {
             // Check for messages; a message indicates a transfer completed (successfully or not).
             let mut should_report_progress = false;
             let mut errors = Vec::new();
+            let mut completed = 0;
             self.multi.messages(|msg| {
                 let token = msg.token().unwrap();
                 log::trace!("Got message for transfer {}", token);
@@ -104,6 +145,7 @@ impl<'a, H> MultiDriver<'a, H> {
 
                 match msg.result() {
                     Some(Ok(())) => {
+                        completed += 1;
                         log::trace!("Transfer {} complete", token);
                         match self.take_handle(token) {
                             Ok(Some(handle)) => {
@@ -120,6 +162,7 @@ impl<'a, H> MultiDriver<'a, H> {
                         }
                     }
                     Some(Err(e)) => {
+                        completed += 1;
                         log::trace!("Transfer {} failed: {}", token, &e);
                         if let Err(e) = callback(Err(e)) {
                             errors.push(e);
@@ -144,7 +187,11 @@ impl<'a, H> MultiDriver<'a, H> {
                 }
             }
 
-            if in_progress == 0 {
+            finished += completed;
+            self.in_flight -= completed;
+            let started = self.start_pending()?;
+
+            if in_progress == 0 && started == 0 {
                 log::debug!("All transfers finished successfully.");
                 break;
             }
@@ -174,6 +221,8 @@ impl<'a, H> MultiDriver<'a, H> {
     /// Drop all of the outstanding Easy2 handles in the Multi stack.
     fn drop_all(&mut self) {
         self.num_transfers = 0;
+        self.in_flight = 0;
+        self.pending.clear();
         let mut dropped = 0;
 
         let mut handles = self.handles.borrow_mut();
@@ -250,6 +250,86 @@ linelog_result linelog_annotate(
   return LINELOG_RESULT_OK;
 }
 
+/* number of instructions replacelines appends for a hunk, see [1] to [4] */
+static inline linelog_loffset hunkinstcount(
+    linelog_linenum a1,
+    linelog_linenum a2,
+    linelog_linenum b1,
+    linelog_linenum b2,
+    bool a1instisjge0) {
+  return (linelog_loffset)(b2 - b1 /* LINE */ + (b2 > b1) /* JL brev */)
+      /* [1] */
+      + (a2 > a1) /* JGE brev */ /* [2] */
+      + 1 /* a1inst */ /* [3] */
+      + (a1instisjge0 ? 0 : 1) /* JGE 0  */ /* [4] */;
+}
+
+/* step III of replacelines: append the instructions of a hunk to buf and
+   redirect a1addr to them. a2addr is only used if a1 < a2.
+   buf must have space for them, checked by the caller.
+   return the new address of a1inst. */
+static linelog_offset writehunk(
+    linelog_buf* buf,
+    linelog_inst* inst0,
+    linelog_revnum brev,
+    linelog_offset a1addr,
+    const linelog_inst* a1inst,
+    linelog_offset a2addr,
+    linelog_linenum a1,
+    linelog_linenum a2,
+    linelog_linenum b1,
+    linelog_linenum b2,
+    const linelog_revnum* brevs,
+    const linelog_linenum* blinenums) {
+  linelog_offset oldlen = inst0->offset;
+  bool a1instisjge0 = (a1inst->opcode == JGE && a1inst->rev == 0);
+
+/* writeinst should not fail - the caller has reserved enough space. any
+   failure will be a huge headache for the caller. */
+#define appendinst(inst) mustsuccess(writeinst(buf, &inst, inst0->offset++));
+  if (b1 < b2) { /* [1] */
+    linelog_offset pjge = oldlen + (b2 - b1 + 1);
+    linelog_inst jl = {.opcode = JL, .rev = brev, .offset = pjge};
+    appendinst(jl);
+    for (linelog_linenum i = b1; i < b2; ++i) {
+      linelog_inst lineinst = {
+          .opcode = LINE,
+          .rev = brevs ? brevs[i] : brev,
+          .offset /* linenum */ = blinenums ? blinenums[i] : i};
+      appendinst(lineinst);
+    }
+  }
+  if (a1 < a2) { /* [2] */
+    linelog_inst jge = {.opcode = JGE, .rev = brev, .offset = a2addr};
+    appendinst(jge);
+  }
+  linelog_offset a1newaddr = inst0->offset;
+  appendinst(*a1inst); /* [3] */
+  if (!a1instisjge0) { /* [4] */
+    linelog_inst ret = {/* .opcode = */ JGE,
+                        0,
+                        /* .offset = */ a1addr + 1};
+    appendinst(ret);
+  }
+#undef appendinst
+  linelog_inst jge0 = {.opcode = JGE, .rev = 0, .offset = oldlen};
+  mustsuccess(writeinst(buf, &jge0, a1addr)); /* [5] */
+  return a1newaddr;
+}
+
+/* address [2] jumps to, to delete lines[a1:a2]. a2 > a1. */
+static inline linelog_offset deleteaddr(
+    const linelog_lineinfo* a2line,
+    const linelog_lineinfo* a2prevline,
+    linelog_revnum brev,
+    linelog_revnum maxrev) {
+  /* delete a chunk of an old commit. be conservative, do not
+     touch invisible lines between a2 - 1 and a2 */
+  if (brev < maxrev)
+    return a2prevline->offset + 1;
+  return a2line->offset;
+}
+
 static linelog_result replacelines(
     linelog_buf* buf,
     linelog_annotateresult* ar,
@@ -301,11 +381,8 @@ static linelog_result replacelines(
   bool a1instisjge0 = (a1inst.opcode == JGE && a1inst.rev == 0);
 
   /* step I: reserve size for buf: (newlen - oldlen) more instructions */
-  linelog_loffset newlen = (linelog_loffset)oldlen +
-      (b2 - b1 /* LINE */ + (b2 > b1) /* JL brev */) /* [1] */
-      + (a2 > a1) /* JGE brev */ /* [2] */
-      + 1 /* a1inst */ /* [3] */
-      + (a1instisjge0 ? 0 : 1) /* JGE 0  */ /* [4] */;
+  linelog_loffset newlen =
+      (linelog_loffset)oldlen + hunkinstcount(a1, a2, b1, b2, a1instisjge0);
   if (newlen >= MAX_OFFSET)
     return LINELOG_RESULT_EOVERFLOW;
   size_t neededsize = (size_t)newlen * INST_SIZE;
@@ -320,43 +397,24 @@ static linelog_result replacelines(
   returnonerror(reservelines(ar, newlinecount + 1));
   assert(ar->linecount < ar->maxlinecount);
 
-/* writeinst should not fail for remaining steps - we have reserved
-   enough space. any failure will be a huge headache for the caller. */
-
-/* step III: update linelog_buf */
-#define appendinst(inst) mustsuccess(writeinst(buf, &inst, inst0.offset++));
-  if (b1 < b2) { /* [1] */
-    linelog_offset pjge = oldlen + (b2 - b1 + 1);
-    linelog_inst jl = {.opcode = JL, .rev = brev, .offset = pjge};
-    appendinst(jl);
-    for (linelog_linenum i = b1; i < b2; ++i) {
-      linelog_inst lineinst = {
-          .opcode = LINE,
-          .rev = brevs ? brevs[i] : brev,
-          .offset /* linenum */ = blinenums ? blinenums[i] : i};
-      appendinst(lineinst);
-    }
-  }
-  if (a1 < a2) { /* [2] */
-    linelog_offset a2addr = ar->lines[a2].offset;
-    /* delete a chunk of an old commit. be conservative, do not
-       touch invisible lines between a2 - 1 and a2 */
-    if (a2 > 0 && brev < inst0.rev /* maxrev */)
-      a2addr = ar->lines[a2 - 1].offset + 1;
-    linelog_inst jge = {.opcode = JGE, .rev = brev, .offset = a2addr};
-    appendinst(jge);
-  }
-  linelog_offset a1newaddr = inst0.offset;
-  appendinst(a1inst); /* [3] */
-  if (!a1instisjge0) { /* [4] */
-    linelog_inst ret = {/* .opcode = */ JGE,
-                        0,
-                        /* .offset = */ a1addr + 1};
-    appendinst(ret);
-  }
-#undef appendinst
-  linelog_inst jge0 = {.opcode = JGE, .rev = 0, .offset = oldlen};
-  mustsuccess(writeinst(buf, &jge0, a1addr)); /* [5] */
+  /* step III: update linelog_buf */
+  linelog_offset a2addr = 0;
+  if (a1 < a2)
+    a2addr = deleteaddr(
+        ar->lines + a2, ar->lines + a2 - 1, brev, inst0.rev /* maxrev */);
+  linelog_offset a1newaddr = writehunk(
+      buf,
+      &inst0,
+      brev,
+      a1addr,
+      &a1inst,
+      a2addr,
+      a1,
+      a2,
+      b1,
+      b2,
+      brevs,
+      blinenums);
 
   /* step IV: write back updated inst0 */
   if (brev > inst0.rev)
@@ -381,6 +439,125 @@ static linelog_result replacelines(
   return LINELOG_RESULT_OK;
 }
 
+static linelog_result replacelinesbatch(
+    linelog_buf* buf,
+    linelog_annotateresult* ar,
+    linelog_revnum brev,
+    const linelog_hunk* hunks,
+    size_t hunkcount,
+    const linelog_revnum* brevs,
+    const linelog_linenum* blinenums) {
+  /* hunks are applied from the last to the first, so the line numbers of
+     the remaining hunks are not affected by the applied ones. the new
+     annotateresult is filled from its end in the meantime: newlines[p:]
+     holds what ar->lines[bound:] would be if each hunk was applied by
+     replacelines, and ar->lines[:bound] is not changed. */
+
+  /* sanity check, before anything is written */
+  linelog_inst inst0;
+  returnonerror(readinst(buf, &inst0, 0));
+  if (brev >= MAX_REVNUM)
+    return LINELOG_RESULT_EOVERFLOW;
+  if (!ar || brev == 0 || ar->linecount >= ar->maxlinecount ||
+      (hunkcount > 0 && !hunks))
+    return LINELOG_RESULT_EILLDATA;
+  linelog_loffset newlen = inst0.offset;
+  linelog_llinenum newlinecount = ar->linecount;
+  for (size_t k = 0; k < hunkcount; ++k) {
+    const linelog_hunk* h = hunks + k;
+    if (h->a2 >= MAX_LINENUM || h->b2 >= MAX_LINENUM)
+      return LINELOG_RESULT_EOVERFLOW;
+    if (h->a2 < h->a1 || h->b2 < h->b1 || h->a2 > ar->linecount)
+      return LINELOG_RESULT_EILLDATA;
+    if (k > 0 && (h->a1 < h[-1].a2 || h->b1 < h[-1].b2))
+      return LINELOG_RESULT_EILLDATA;
+    linelog_inst a1inst;
+    returnonerror(readinst(buf, &a1inst, ar->lines[h->a1].offset));
+    /* a1inst may be a line inserted by the next hunk by the time this hunk
+       is written, so reserve space as if it is not an unconditional jump */
+    newlen += hunkinstcount(h->a1, h->a2, h->b1, h->b2, false);
+    newlinecount += (linelog_llinenum)(h->b2 - h->b1);
+    newlinecount -= (linelog_llinenum)(h->a2 - h->a1);
+  }
+  if (newlen >= MAX_OFFSET)
+    return LINELOG_RESULT_EOVERFLOW;
+  size_t neededsize = (size_t)newlen * INST_SIZE;
+  if (neededsize > buf->size) {
+    buf->neededsize = neededsize;
+    return LINELOG_RESULT_ENEEDRESIZE;
+  }
+  if (newlinecount >= MAX_LINENUM)
+    return LINELOG_RESULT_EOVERFLOW;
+  if (hunkcount == 0)
+    return LINELOG_RESULT_OK;
+
+  /* the new annotateresult, including the special END line */
+  linelog_lineinfo* newlines =
+      (linelog_lineinfo*)malloc(sizeof(linelog_lineinfo) * (newlinecount + 1));
+  if (newlines == NULL)
+    return LINELOG_RESULT_ENOMEM;
+
+  /* ar->lines[i] as seen by the hunk being applied */
+  linelog_llinenum bound = (linelog_llinenum)ar->linecount + 1;
+  linelog_llinenum p = newlinecount + 1;
+#define seenline(i) ((i) < bound ? ar->lines + (i) : newlines + p + (i)-bound)
+
+  for (size_t k = hunkcount; k-- > 0;) {
+    linelog_linenum a1 = hunks[k].a1, a2 = hunks[k].a2;
+    linelog_linenum b1 = hunks[k].b1, b2 = hunks[k].b2;
+    linelog_offset oldlen = inst0.offset;
+
+    linelog_offset a1addr = seenline(a1)->offset;
+    linelog_inst a1inst;
+    mustsuccess(readinst(buf, &a1inst, a1addr));
+    linelog_offset a2addr = 0;
+    if (a1 < a2)
+      a2addr = deleteaddr(seenline(a2), seenline(a2 - 1), brev, inst0.rev);
+    linelog_offset a1newaddr = writehunk(
+        buf,
+        &inst0,
+        brev,
+        a1addr,
+        &a1inst,
+        a2addr,
+        a1,
+        a2,
+        b1,
+        b2,
+        brevs,
+        blinenums);
+    /* the next hunk may read the instructions just written */
+    if (brev > inst0.rev)
+      inst0.rev = brev;
+    mustsuccess(writeinst(buf, &inst0, 0));
+
+    /* lines[a2:bound] are kept, preceded by lines[b1:b2] */
+    size_t keepcount = bound - a2;
+    p -= keepcount;
+    memcpy(newlines + p, ar->lines + a2, sizeof(linelog_lineinfo) * keepcount);
+    if (a1 == a2) /* a1inst got moved */
+      newlines[p].offset = a1newaddr;
+    p -= b2 - b1;
+    for (linelog_linenum i = b1; i < b2; ++i) {
+      linelog_lineinfo* li = newlines + p + i - b1;
+      li->rev = brevs ? brevs[i] : brev;
+      li->linenum = blinenums ? blinenums[i] : i;
+      li->offset = oldlen + i - b1 + 1;
+    }
+    bound = a1;
+  }
+#undef seenline
+
+  assert(p == bound);
+  memcpy(newlines, ar->lines, sizeof(linelog_lineinfo) * bound);
+
+  free(ar->lines);
+  ar->lines = newlines;
+  ar->linecount = (linelog_linenum)newlinecount;
+  ar->maxlinecount = (linelog_linenum)(newlinecount + 1);
+  return LINELOG_RESULT_OK;
+}
+
 linelog_result linelog_replacelines(
     linelog_buf* buf,
     linelog_annotateresult* ar,
@@ -404,6 +581,80 @@ linelog_result linelog_replacelines_vec(
   return replacelines(buf, ar, brev, a1, a2, 0, blinecount, brevs, blinenums);
 }
 
+linelog_result linelog_replacelines_batch(
+    linelog_buf* buf,
+    linelog_annotateresult* ar,
+    linelog_revnum brev,
+    const linelog_hunk* hunks,
+    size_t hunkcount) {
+  return replacelinesbatch(buf, ar, brev, hunks, hunkcount, NULL, NULL);
+}
+
+linelog_result linelog_replacelines_batch_vec(
+    linelog_buf* buf,
+    linelog_annotateresult* ar,
+    linelog_revnum brev,
+    const linelog_hunk* hunks,
+    size_t hunkcount,
+    const linelog_revnum* brevs,
+    const linelog_linenum* blinenums) {
+  return replacelinesbatch(
+      buf, ar, brev, hunks, hunkcount, brevs, blinenums);
+}
+
+void linelog_annotatecache_clear(linelog_annotatecache* cache) {
+  for (size_t i = 0; i < LINELOG_ANNOTATECACHE_SIZE; ++i)
+    linelog_annotateresult_clear(&cache->entries[i].ar);
+  memset(cache, 0, sizeof(linelog_annotatecache));
+}
+
+/* copy src to dst, including the special END line */
+static linelog_result copyannotateresult(
+    linelog_annotateresult* dst,
+    const linelog_annotateresult* src) {
+  returnonerror(reservelines(dst, (linelog_llinenum)src->linecount + 1));
+  memcpy(
+      dst->lines, src->lines, sizeof(linelog_lineinfo) * (src->linecount + 1));
+  dst->linecount = src->linecount;
+  return LINELOG_RESULT_OK;
+}
+
+linelog_result linelog_annotate_cached(
+    const linelog_buf* buf,
+    linelog_annotatecache* cache,
+    linelog_annotateresult* ar,
+    linelog_revnum rev) {
+  linelog_inst inst0;
+  returnonerror(readinst(buf, &inst0, 0));
+  if (++cache->clock == 0) /* wrapped around, forget the order */
+    cache->clock = 1;
+
+  linelog_annotatecacheentry* victim = cache->entries;
+  for (size_t i = 0; i < LINELOG_ANNOTATECACHE_SIZE; ++i) {
+    linelog_annotatecacheentry* e = cache->entries + i;
+    if (e->lastused && e->rev == rev && e->buflen == inst0.offset &&
+        e->bufmaxrev == inst0.rev) {
+      e->lastused = cache->clock;
+      return copyannotateresult(ar, &e->ar);
+    }
+    if (e->lastused < victim->lastused)
+      victim = e;
+  }
+
+  returnonerror(linelog_annotate(buf, ar, rev));
+  if (copyannotateresult(&victim->ar, ar) != LINELOG_RESULT_OK) {
+    /* ar is still good, the revision is just not remembered */
+    linelog_annotateresult_clear(&victim->ar);
+    victim->lastused = 0;
+    return LINELOG_RESULT_OK;
+  }
+  victim->rev = rev;
+  victim->buflen = inst0.offset;
+  victim->bufmaxrev = inst0.rev;
+  victim->lastused = cache->clock;
+  return LINELOG_RESULT_OK;
+}
+
 linelog_result linelog_getalllines(
     linelog_buf* buf,
     linelog_annotateresult* ar,
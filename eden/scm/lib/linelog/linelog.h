@@ -153,6 +153,77 @@ linelog_result linelog_replacelines_vec(
     const linelog_revnum* brevs,
     const linelog_linenum* blinenums);
 
+/* a changed region: lines[a1:a2] are replaced with lines[b1:b2] */
+typedef struct {
+  linelog_linenum a1, a2, b1, b2;
+} linelog_hunk;
+
+/* like calling linelog_replacelines for each hunk, from the last to the
+   first, but in a single pass
+
+   hunks should be ordered as a diff outputs them: for adjacent hunks,
+   hunks[i].a2 <= hunks[i + 1].a1 and hunks[i].b2 <= hunks[i + 1].b1. both
+   buf and ar are checked to be large enough for every hunk before anything
+   is written, so on ENEEDRESIZE nothing is changed and the call can simply
+   be retried after resizing buf. ar is rebuilt once at the end, instead of
+   being shifted after each hunk.
+
+   on other errors, ar may be in an invalid state and needs to be cleared */
+linelog_result linelog_replacelines_batch(
+    linelog_buf* buf,
+    linelog_annotateresult* ar,
+    linelog_revnum brev,
+    const linelog_hunk* hunks,
+    size_t hunkcount);
+
+/* like linelog_replacelines_batch, but line details are decided by brevs and
+   blinenums, as in linelog_replacelines_vec. both are indexed by the line
+   number at brev, i.e. brevs[b1] is used for the first line of a hunk. */
+linelog_result linelog_replacelines_batch_vec(
+    linelog_buf* buf,
+    linelog_annotateresult* ar,
+    linelog_revnum brev,
+    const linelog_hunk* hunks,
+    size_t hunkcount,
+    const linelog_revnum* brevs,
+    const linelog_linenum* blinenums);
+
+/* number of revisions an annotatecache remembers */
+#define LINELOG_ANNOTATECACHE_SIZE 8
+
+/* an annotated revision remembered by linelog_annotatecache */
+typedef struct {
+  linelog_revnum rev;
+  linelog_offset buflen; /* instruction count of buf when annotated */
+  linelog_revnum bufmaxrev; /* maxrev of buf when annotated */
+  uint32_t lastused; /* 0: unused slot */
+  linelog_annotateresult ar;
+} linelog_annotatecacheentry;
+
+/* results of recent linelog_annotate calls, allocated by callee
+   memset to 0 before use, call linelog_annotatecache_clear to free memory
+
+   every change to buf appends instructions, so an entry is only reused if
+   buf has the same size and maxrev as when it was annotated. call
+   linelog_annotatecache_clear after linelog_clear or after copying another
+   linelog into buf, as those could restore a same size and maxrev. */
+typedef struct {
+  linelog_annotatecacheentry entries[LINELOG_ANNOTATECACHE_SIZE];
+  uint32_t clock;
+} linelog_annotatecache;
+
+/* free memory used by cache, and forget everything it remembers */
+void linelog_annotatecache_clear(linelog_annotatecache* cache);
+
+/* like linelog_annotate, but reuse the result of a recent call with the same
+   rev if buf has not changed since then. the least recently used entry is
+   replaced when the cache is full. */
+linelog_result linelog_annotate_cached(
+    const linelog_buf* buf,
+    linelog_annotatecache* cache,
+    linelog_annotateresult* ar,
+    linelog_revnum rev);
+
 /* get all lines, include deleted ones, output to ar
 
    offsets can be obtained from annotateresult. if they are both 0,
@@ -679,6 +679,45 @@ mod tests {
             .is_err());
     }
 
+    #[test]
+    fn test_diff_prefetches_each_layer_in_one_batch() {
+        let store = Arc::new(TestStore::new());
+        let mut left = TreeManifest::ephemeral(store.clone());
+        let mut right = TreeManifest::ephemeral(store.clone());
+        for (path, lnode, rnode) in &[
+            ("a/b/f", "10", "11"),
+            ("c/d/f", "20", "21"),
+            ("e/f", "30", "30"),
+        ] {
+            left.insert(repo_path_buf(path), make_meta(lnode)).unwrap();
+            right.insert(repo_path_buf(path), make_meta(rnode)).unwrap();
+        }
+        let left = TreeManifest::durable(store.clone(), left.flush().unwrap());
+        let right = TreeManifest::durable(store.clone(), right.flush().unwrap());
+
+        let entries = Diff::new(&left, &right, &AlwaysMatcher::new())
+            .collect::<Result<Vec<_>>>()
+            .unwrap();
+        assert_eq!(entries.len(), 2);
+
+        // Each changed layer is fetched with one request per side, and the
+        // unchanged directory "e" is not fetched at all.
+        let fetches: Vec<Vec<String>> = store
+            .fetches()
+            .iter()
+            .map(|keys| keys.iter().map(|k| k.path.to_string()).collect())
+            .collect();
+        assert_eq!(
+            fetches,
+            vec![
+                vec!["a".to_string(), "c".to_string()],
+                vec!["a".to_string(), "c".to_string()],
+                vec!["a/b".to_string(), "c/d".to_string()],
+                vec!["a/b".to_string(), "c/d".to_string()],
+            ]
+        );
+    }
+
     #[test]
     fn test_diff_one_file_one_directory() {
         let mut left = TreeManifest::ephemeral(Arc::new(TestStore::new()));
@@ -21,6 +21,31 @@ struct GetData {
   RevisionStoreStringStruct* error;
   bool is_key_error;
 };
+
+struct KeyData {
+  const uint8_t* name;
+  size_t name_len;
+  const uint8_t* hgid;
+  size_t hgid_len;
+};
+
+struct MetaData {
+  RevisionStoreStringStruct* error;
+  bool found;
+  bool has_size;
+  uint64_t size;
+};
+
+std::vector<KeyData> toKeyData(
+    folly::Range<const DataPackUnionKey*> keys) {
+  std::vector<KeyData> keyData;
+  keyData.reserve(keys.size());
+  for (const auto& key : keys) {
+    keyData.push_back(KeyData{
+        key.name.data(), key.name.size(), key.hgid.data(), key.hgid.size()});
+  }
+  return keyData;
+}
 } // namespace
 
 extern "C" DataPackUnionStruct* revisionstore_datapackunion_new(
@@ -34,6 +59,16 @@ extern "C" GetData revisionstore_datapackunion_get(
     size_t name_len,
     const uint8_t* hgid,
     size_t hgid_len) noexcept;
+extern "C" void revisionstore_datapackunion_get_many(
+    DataPackUnionStruct* store,
+    const KeyData* keys,
+    size_t num_keys,
+    GetData* results) noexcept;
+extern "C" void revisionstore_datapackunion_get_meta_many(
+    DataPackUnionStruct* store,
+    const KeyData* keys,
+    size_t num_keys,
+    MetaData* results) noexcept;
 
 extern "C" void revisionstore_string_free(
     RevisionStoreStringStruct* str) noexcept;
@@ -73,6 +108,66 @@ folly::Optional<RevisionStoreByteVec> DataPackUnion::get(
   throw DataPackUnionGetError(error.stringPiece().str());
 }
 
+std::vector<folly::Optional<RevisionStoreByteVec>> DataPackUnion::getMany(
+    folly::Range<const DataPackUnionKey*> keys) {
+  auto keyData = toKeyData(keys);
+  std::vector<GetData> got(keys.size());
+  revisionstore_datapackunion_get_many(
+      store_.get(), keyData.data(), keyData.size(), got.data());
+
+  // Take ownership of every result before throwing, so that none leak.
+  std::vector<folly::Optional<RevisionStoreByteVec>> results;
+  results.reserve(got.size());
+  folly::Optional<RevisionStoreString> error;
+  for (const auto& entry : got) {
+    if (entry.value) {
+      results.emplace_back(RevisionStoreByteVec(entry.value));
+    } else {
+      results.emplace_back(folly::none);
+      if (entry.error) {
+        RevisionStoreString entryError(entry.error);
+        if (!error) {
+          error = std::move(entryError);
+        }
+      }
+    }
+  }
+  if (error) {
+    throw DataPackUnionGetError(error->stringPiece().str());
+  }
+  return results;
+}
+
+std::vector<DataPackUnionMeta> DataPackUnion::getMetaMany(
+    folly::Range<const DataPackUnionKey*> keys) {
+  auto keyData = toKeyData(keys);
+  std::vector<MetaData> got(keys.size());
+  revisionstore_datapackunion_get_meta_many(
+      store_.get(), keyData.data(), keyData.size(), got.data());
+
+  std::vector<DataPackUnionMeta> results;
+  results.reserve(got.size());
+  folly::Optional<RevisionStoreString> error;
+  for (const auto& entry : got) {
+    if (entry.error) {
+      RevisionStoreString entryError(entry.error);
+      if (!error) {
+        error = std::move(entryError);
+      }
+    }
+    DataPackUnionMeta meta;
+    meta.found = entry.found;
+    if (entry.has_size) {
+      meta.size = entry.size;
+    }
+    results.push_back(std::move(meta));
+  }
+  if (error) {
+    throw DataPackUnionGetError(error->stringPiece().str());
+  }
+  return results;
+}
+
 RevisionStoreString::RevisionStoreString(RevisionStoreStringStruct* ptr)
     : ptr_(ptr) {}
 
@@ -99,5 +194,17 @@ folly::ByteRange RevisionStoreByteVec::bytes() const noexcept {
   return folly::ByteRange(data.ptr, data.len);
 }
 
+std::unique_ptr<folly::IOBuf> RevisionStoreByteVec::intoIOBuf() && {
+  auto data = revisionstore_bytevec_data(ptr_.get());
+  return folly::IOBuf::takeOwnership(
+      const_cast<uint8_t*>(data.ptr),
+      data.len,
+      [](void* /* buf */, void* userData) {
+        revisionstore_bytevec_free(
+            static_cast<RevisionStoreByteVecStruct*>(userData));
+      },
+      ptr_.release());
+}
+
 } // namespace eden
 } // namespace facebook
@@ -5,8 +5,11 @@
  */
 #include <folly/Optional.h>
 #include <folly/Range.h>
+#include <folly/io/IOBuf.h>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 namespace facebook {
 namespace eden {
@@ -51,6 +54,10 @@ class RevisionStoreByteVec {
     return bytes();
   }
 
+  // Hand the bytes over to an IOBuf without copying them.  The IOBuf frees
+  // the Rust Vec<u8> when its last reference goes away.
+  std::unique_ptr<folly::IOBuf> intoIOBuf() &&;
+
  private:
   struct Deleter {
     void operator()(RevisionStoreByteVecStruct*) const noexcept;
@@ -64,6 +71,21 @@ class DataPackUnionGetError : public std::runtime_error {
   using std::runtime_error::runtime_error;
 };
 
+/** A name/hgid pair to look up with the batched DataPackUnion methods.
+ */
+struct DataPackUnionKey {
+  folly::ByteRange name;
+  folly::ByteRange hgid;
+};
+
+/** What DataPackUnion::getMetaMany() knows about a key without reading its
+ * value.  The size is only known if the pack recorded it.
+ */
+struct DataPackUnionMeta {
+  bool found{false};
+  folly::Optional<uint64_t> size;
+};
+
 /** DataPackUnion is configured with a list of directory paths that
  * contain some number of datapack files.
  * DataPackUnion can be queried to see if it contains a given key,
@@ -81,6 +103,19 @@ class DataPackUnion {
       folly::ByteRange name,
       folly::ByteRange hgid);
 
+  // Like get(), but for many keys at once, returning one result per key in
+  // the same order.  The pack files are rescanned at most once for the whole
+  // batch.  If an error occurs for any key, throw a DataPackUnionGetError
+  // exception. This method is not thread safe.
+  std::vector<folly::Optional<RevisionStoreByteVec>> getMany(
+      folly::Range<const DataPackUnionKey*> keys);
+
+  // Look up whether each key is present, and the size of its value, without
+  // de-deltaing the values.  Errors are reported as by getMany(). This method
+  // is not thread safe.
+  std::vector<DataPackUnionMeta> getMetaMany(
+      folly::Range<const DataPackUnionKey*> keys);
+
  private:
   struct Deleter {
     void operator()(DataPackUnionStruct*) const noexcept;
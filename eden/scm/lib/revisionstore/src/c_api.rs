@@ -19,13 +19,14 @@ use std::{
     sync::Arc,
 };
 
-use anyhow::Result;
+use anyhow::{format_err, Result};
 
 use types::{HgId, Key, RepoPath};
 
 use crate::datapack::DataPack;
 use crate::datastore::HgIdDataStore;
 use crate::uniondatastore::UnionHgIdDataStore;
+use crate::Metadata;
 
 pub struct DataPackUnion {
     paths: Vec<PathBuf>,
@@ -119,6 +120,38 @@ impl DataPackUnion {
             },
         }
     }
+
+    /// Lookup many keys with `lookup`, scanning for changes in the pack files
+    /// at most once for the whole batch if any key is missing.
+    fn lookup_many<T>(
+        &mut self,
+        keys: &[Result<Key>],
+        lookup: impl Fn(&UnionHgIdDataStore<Arc<DataPack>>, &Key) -> Result<Option<T>>,
+    ) -> Vec<Result<Option<T>>> {
+        let mut results = Vec::with_capacity(keys.len());
+        let mut missing = Vec::new();
+        for (index, key) in keys.iter().enumerate() {
+            let result = match key {
+                Ok(key) => lookup(&self.store, key),
+                Err(err) => Err(format_err!("{}", err)),
+            };
+            if let Ok(None) = result {
+                missing.push(index);
+            }
+            results.push(result);
+        }
+
+        if !missing.is_empty() {
+            if let ScanResult::ChangesDetected = self.rescan_paths() {
+                for index in missing {
+                    if let Ok(key) = &keys[index] {
+                        results[index] = lookup(&self.store, key);
+                    }
+                }
+            }
+        }
+        results
+    }
 }
 
 /// Construct a new datapack store.
@@ -195,6 +228,28 @@ pub struct GetData {
     is_key_error: bool,
 }
 
+impl From<Result<Option<Vec<u8>>>> for GetData {
+    fn from(result: Result<Option<Vec<u8>>>) -> Self {
+        match result {
+            Ok(Some(data)) => GetData {
+                value: Box::into_raw(Box::new(data)),
+                error: ptr::null_mut(),
+                is_key_error: false,
+            },
+            Ok(None) => GetData {
+                value: ptr::null_mut(),
+                error: ptr::null_mut(),
+                is_key_error: true,
+            },
+            Err(err) => GetData {
+                value: ptr::null_mut(),
+                error: Box::into_raw(Box::new(format!("{}", err))),
+                is_key_error: false,
+            },
+        }
+    }
+}
+
 /// Lookup the value corresponding to name/hgid.
 /// If the key is present, de-delta and populate `GetData::value`.
 /// If the requested key could not be found sets `GetData::is_key_error` to true.
@@ -211,22 +266,109 @@ pub extern "C" fn revisionstore_datapackunion_get(
     hgid: *const u8,
     hgid_len: usize,
 ) -> GetData {
-    match datapackunion_get_impl(store, name, name_len, hgid, hgid_len) {
-        Ok(Some(data)) => GetData {
-            value: Box::into_raw(Box::new(data)),
-            error: ptr::null_mut(),
-            is_key_error: false,
-        },
-        Ok(None) => GetData {
-            value: ptr::null_mut(),
-            error: ptr::null_mut(),
-            is_key_error: true,
-        },
-        Err(err) => GetData {
-            value: ptr::null_mut(),
-            error: Box::into_raw(Box::new(format!("{}", err))),
-            is_key_error: false,
-        },
+    datapackunion_get_impl(store, name, name_len, hgid, hgid_len).into()
+}
+
+/// A name/hgid pair passed to the batched lookup functions.
+#[repr(C)]
+pub struct KeyData {
+    name: *const u8,
+    name_len: usize,
+    hgid: *const u8,
+    hgid_len: usize,
+}
+
+/// Helper function that parses the keys of a batched lookup
+fn make_keys(keys: *const KeyData, num_keys: usize) -> Vec<Result<Key>> {
+    debug_assert!(!keys.is_null());
+    let keys = unsafe { slice::from_raw_parts(keys, num_keys) };
+    keys.iter()
+        .map(|key| make_key(key.name, key.name_len, key.hgid, key.hgid_len))
+        .collect()
+}
+
+/// Lookup the values corresponding to `num_keys` name/hgid pairs, populating
+/// the `num_keys` entries of `results` as revisionstore_datapackunion_get()
+/// would.  The pack files are rescanned at most once for the whole batch.
+/// The caller is responsible for freeing the `error` and `value` of every
+/// result, as for revisionstore_datapackunion_get().
+#[no_mangle]
+pub extern "C" fn revisionstore_datapackunion_get_many(
+    store: *mut DataPackUnion,
+    keys: *const KeyData,
+    num_keys: usize,
+    results: *mut GetData,
+) {
+    if num_keys == 0 {
+        return;
+    }
+    debug_assert!(!store.is_null());
+    debug_assert!(!results.is_null());
+    let store = unsafe { &mut *store };
+    let keys = make_keys(keys, num_keys);
+    let results = unsafe { slice::from_raw_parts_mut(results, num_keys) };
+    let values = store.lookup_many(&keys, |store, key| store.get(key));
+    for (result, value) in results.iter_mut().zip(values) {
+        *result = value.into();
+    }
+}
+
+#[repr(C)]
+pub struct MetaData {
+    error: *mut String,
+    found: bool,
+    has_size: bool,
+    size: u64,
+}
+
+impl From<Result<Option<Metadata>>> for MetaData {
+    fn from(result: Result<Option<Metadata>>) -> Self {
+        match result {
+            Ok(Some(meta)) => MetaData {
+                error: ptr::null_mut(),
+                found: true,
+                has_size: meta.size.is_some(),
+                size: meta.size.unwrap_or(0),
+            },
+            Ok(None) => MetaData {
+                error: ptr::null_mut(),
+                found: false,
+                has_size: false,
+                size: 0,
+            },
+            Err(err) => MetaData {
+                error: Box::into_raw(Box::new(format!("{}", err))),
+                found: false,
+                has_size: false,
+                size: 0,
+            },
+        }
+    }
+}
+
+/// Lookup whether each of `num_keys` name/hgid pairs is present, and the size
+/// of its de-delta'd value if the pack records it, without reading the values.
+/// The pack files are rescanned at most once for the whole batch.
+/// The caller is responsible for calling revisionstore_string_free() on the
+/// `error` of every result that is non-null when this function returns.
+#[no_mangle]
+pub extern "C" fn revisionstore_datapackunion_get_meta_many(
+    store: *mut DataPackUnion,
+    keys: *const KeyData,
+    num_keys: usize,
+    results: *mut MetaData,
+) {
+    if num_keys == 0 {
+        return;
+    }
+    debug_assert!(!store.is_null());
+    debug_assert!(!results.is_null());
+    let store = unsafe { &mut *store };
+    let keys = make_keys(keys, num_keys);
+    let results = unsafe { slice::from_raw_parts_mut(results, num_keys) };
+    let metas = store.lookup_many(&keys, |store, key| store.get_meta(key));
+    for (result, meta) in results.iter_mut().zip(metas) {
+        *result = meta.into();
     }
 }
 
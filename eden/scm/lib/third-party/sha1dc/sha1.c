@@ -1608,6 +1608,170 @@ static void sha1_recompression_step(uint32_t step, uint32_t ihvin[5], uint32_t i
 
 
 
+/*
+   Hardware accelerated compression.
+   The SHA-1 instructions of x86 (SHA-NI) and ARMv8 compute the same
+   compression function as sha1_compression_states, but cannot record the
+   expanded message and intermediate states that collision detection needs,
+   so sha1_process only uses them when collision detection is disabled.
+   Define SHA1DC_NO_HW_ACCEL to always use the portable code.
+ */
+#if !defined(SHA1DC_NO_HW_ACCEL) && !defined(SHA1DC_BIGENDIAN) && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+
+#define SHA1DC_HAVE_HW_ACCEL
+#include <cpuid.h>
+#include <immintrin.h>
+
+/* 4 steps of the round with function f, using message words m */
+#define SHA1NI_STEPS(ein, eout, abcd, m, f) \
+	{ ein = _mm_sha1nexte_epu32(ein, m); eout = abcd; \
+	  abcd = _mm_sha1rnds4_epu32(abcd, ein, f); }
+
+/* same, while expanding the message words 4 steps ahead */
+#define SHA1NI_STEPS_EXPAND(ein, eout, abcd, m0, m1, m2, m3, f) \
+	{ ein = _mm_sha1nexte_epu32(ein, m0); eout = abcd; \
+	  m1 = _mm_sha1msg2_epu32(m1, m0); \
+	  abcd = _mm_sha1rnds4_epu32(abcd, ein, f); \
+	  m3 = _mm_sha1msg1_epu32(m3, m0); m2 = _mm_xor_si128(m2, m0); }
+
+__attribute__((target("sha,sse4.1")))
+static void sha1_compression_hw(uint32_t ihv[5], const uint32_t m[16])
+{
+	const __m128i bswap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+	__m128i abcd, abcd_save, e0, e1, e_save, m0, m1, m2, m3;
+
+	abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)ihv), 0x1B);
+	e0 = _mm_set_epi32((int)ihv[4], 0, 0, 0);
+	abcd_save = abcd;
+	e_save = e0;
+
+	m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(m + 0)), bswap);
+	m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(m + 4)), bswap);
+	m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(m + 8)), bswap);
+	m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(m + 12)), bswap);
+
+	/* steps 0-15 */
+	e0 = _mm_add_epi32(e0, m0);
+	e1 = abcd;
+	abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+	SHA1NI_STEPS(e1, e0, abcd, m1, 0);
+	m0 = _mm_sha1msg1_epu32(m0, m1);
+	SHA1NI_STEPS(e0, e1, abcd, m2, 0);
+	m1 = _mm_sha1msg1_epu32(m1, m2);
+	m0 = _mm_xor_si128(m0, m2);
+	SHA1NI_STEPS_EXPAND(e1, e0, abcd, m3, m0, m1, m2, 0);
+
+	/* steps 16-67 */
+	SHA1NI_STEPS_EXPAND(e0, e1, abcd, m0, m1, m2, m3, 0);
+	SHA1NI_STEPS_EXPAND(e1, e0, abcd, m1, m2, m3, m0, 1);
+	SHA1NI_STEPS_EXPAND(e0, e1, abcd, m2, m3, m0, m1, 1);
+	SHA1NI_STEPS_EXPAND(e1, e0, abcd, m3, m0, m1, m2, 1);
+	SHA1NI_STEPS_EXPAND(e0, e1, abcd, m0, m1, m2, m3, 1);
+	SHA1NI_STEPS_EXPAND(e1, e0, abcd, m1, m2, m3, m0, 1);
+	SHA1NI_STEPS_EXPAND(e0, e1, abcd, m2, m3, m0, m1, 2);
+	SHA1NI_STEPS_EXPAND(e1, e0, abcd, m3, m0, m1, m2, 2);
+	SHA1NI_STEPS_EXPAND(e0, e1, abcd, m0, m1, m2, m3, 2);
+	SHA1NI_STEPS_EXPAND(e1, e0, abcd, m1, m2, m3, m0, 2);
+	SHA1NI_STEPS_EXPAND(e0, e1, abcd, m2, m3, m0, m1, 2);
+	SHA1NI_STEPS_EXPAND(e1, e0, abcd, m3, m0, m1, m2, 3);
+	SHA1NI_STEPS_EXPAND(e0, e1, abcd, m0, m1, m2, m3, 3);
+
+	/* steps 68-79 */
+	SHA1NI_STEPS(e1, e0, abcd, m1, 3);
+	m2 = _mm_sha1msg2_epu32(m2, m1);
+	m3 = _mm_xor_si128(m3, m1);
+	SHA1NI_STEPS(e0, e1, abcd, m2, 3);
+	m3 = _mm_sha1msg2_epu32(m3, m2);
+	SHA1NI_STEPS(e1, e0, abcd, m3, 3);
+
+	e0 = _mm_sha1nexte_epu32(e0, e_save);
+	abcd = _mm_add_epi32(abcd, abcd_save);
+	_mm_storeu_si128((__m128i*)ihv, _mm_shuffle_epi32(abcd, 0x1B));
+	ihv[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+static int sha1_hw_supported(void)
+{
+	/* 0 = not yet checked, 1 = supported, -1 = not supported */
+	static volatile int supported;
+	unsigned int eax, ebx, ecx, edx;
+
+	if (supported == 0)
+	{
+		int ok = __get_cpuid(1, &eax, &ebx, &ecx, &edx)
+			&& (ecx & bit_SSSE3) && (ecx & bit_SSE4_1)
+			&& __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)
+			&& (ebx & (1u << 29)); /* SHA */
+		supported = ok ? 1 : -1;
+	}
+	return supported > 0;
+}
+
+#elif !defined(SHA1DC_NO_HW_ACCEL) && !defined(SHA1DC_BIGENDIAN) && \
+    defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO)
+
+#define SHA1DC_HAVE_HW_ACCEL
+#include <arm_neon.h>
+
+/* expands a message block to the 80 words of the message schedule */
+static void sha1_message_expansion(uint32_t W[80], const uint32_t m[16])
+{
+	unsigned i;
+	uint32_t temp;
+
+	for (i = 0; i < 16; ++i)
+	{
+		sha1_load(m, i, temp);
+		W[i] = temp;
+	}
+	/* sha1_store keeps the compiler from vectorizing this loop, which
+	   stalls on reading back words that were just stored */
+	for (i = 16; i < 80; ++i)
+		sha1_store(W, i, sha1_mix(W, i));
+}
+
+static void sha1_compression_hw(uint32_t ihv[5], const uint32_t m[16])
+{
+	static const uint32_t K[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+	uint32_t W[80];
+	uint32x4_t abcd, abcd_save, wk;
+	uint32_t e, e_next;
+	unsigned i;
+
+	/* the instructions take the expanded message, 4 words at a time */
+	sha1_message_expansion(W, m);
+	abcd = abcd_save = vld1q_u32(ihv);
+	e = ihv[4];
+
+	for (i = 0; i < 80; i += 4)
+	{
+		wk = vaddq_u32(vld1q_u32(W + i), vdupq_n_u32(K[i / 20]));
+		/* after 4 steps, e is the rotated a from before them */
+		e_next = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		if (i < 20)
+			abcd = vsha1cq_u32(abcd, e, wk);
+		else if (i < 40 || i >= 60)
+			abcd = vsha1pq_u32(abcd, e, wk);
+		else
+			abcd = vsha1mq_u32(abcd, e, wk);
+		e = e_next;
+	}
+
+	vst1q_u32(ihv, vaddq_u32(abcd, abcd_save));
+	ihv[4] += e;
+}
+
+static int sha1_hw_supported(void)
+{
+	return 1;
+}
+
+#endif
+
+
+
 static void sha1_process(SHA1_CTX* ctx, const uint32_t block[16])
 {
 	unsigned i, j;
@@ -1620,6 +1784,14 @@ static void sha1_process(SHA1_CTX* ctx, const uint32_t block[16])
 	ctx->ihv1[3] = ctx->ihv[3];
 	ctx->ihv1[4] = ctx->ihv[4];
 
+#ifdef SHA1DC_HAVE_HW_ACCEL
+	if (!ctx->detect_coll && sha1_hw_supported())
+	{
+		sha1_compression_hw(ctx->ihv, block);
+		return;
+	}
+#endif
+
 	sha1_compression_states(ctx->ihv, block, ctx->m1, ctx->states);
 
 	if (ctx->detect_coll)
@@ -156,6 +156,23 @@ static int xdl_classify_record(unsigned int pass, xdlclassifier_t *cf, xrecord_t
 }
 
 
+/*
+ * Returns the number of '\n' bytes in a word.  A byte of x is zero exactly
+ * when the high bit of its byte in t is clear.
+ */
+static int64_t xdl_count_newlines(uint64_t word) {
+	const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+	uint64_t x = word ^ 0x0a0a0a0a0a0a0a0aULL;
+	uint64_t t = ((x & low7) + low7) | x;
+	uint64_t zeros = ~t & ~low7;
+	int64_t n = 0;
+
+	for (; zeros; zeros &= zeros - 1)
+		n++;
+	return n;
+}
+
+
 /*
  * Trim common prefix from files.
  *
@@ -185,13 +202,33 @@ static void xdl_trim_files(mmfile_t *mf1, mmfile_t *mf2, int64_t reserved,
 		memcpy(&mlarge, mf1, sizeof(mmfile_t));
 	}
 
+	/* Compare a word at a time while the files agree, then finish the
+	 * mismatching word byte by byte. */
 	pp1 = msmall.ptr, pp2 = mlarge.ptr;
-	for (i = 0; i < msmall.size && *pp1 == *pp2; ++i) {
+	for (i = 0; i + (int64_t) sizeof(uint64_t) <= msmall.size; ) {
+		uint64_t w1, w2;
+		memcpy(&w1, pp1, sizeof(w1));
+		memcpy(&w2, pp2, sizeof(w2));
+		if (w1 != w2)
+			break;
+		plines += xdl_count_newlines(w1);
+		i += sizeof(w1), pp1 += sizeof(w1), pp2 += sizeof(w2);
+	}
+	for (; i < msmall.size && *pp1 == *pp2; ++i) {
 		plines += (*pp1 == '\n');
 		pp1++, pp2++;
 	}
 
 	ps1 = msmall.ptr + msmall.size - 1, ps2 = mlarge.ptr + mlarge.size - 1;
+	while (ps1 - pp1 > (int64_t) sizeof(uint64_t)) {
+		uint64_t w1, w2;
+		memcpy(&w1, ps1 - (sizeof(w1) - 1), sizeof(w1));
+		memcpy(&w2, ps2 - (sizeof(w2) - 1), sizeof(w2));
+		if (w1 != w2)
+			break;
+		slines += xdl_count_newlines(w1);
+		ps1 -= sizeof(w1), ps2 -= sizeof(w2);
+	}
 	while (ps1 > pp1 && *ps1 == *ps2) {
 		slines += (*ps1 == '\n');
 		ps1--, ps2--;
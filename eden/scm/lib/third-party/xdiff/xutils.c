@@ -128,16 +128,37 @@ int xdl_recmatch(const char *l1, int64_t s1, const char *l2, int64_t s2)
 	return 0;
 }
 
+/*
+ * The hash only needs to be equal for equal lines, so it is free to depend
+ * on the byte order of the machine.  The end of the line is found with
+ * memchr, which libc vectorizes, and the line is then hashed a word rather
+ * than a byte at a time.  The final mix spreads the bits to the low end,
+ * which XDL_HASHLONG uses to pick a bucket.
+ */
+#define XDL_HASH_MUL 0x9e3779b97f4a7c15ULL
+
 uint64_t xdl_hash_record(char const **data, char const *top) {
-	uint64_t ha = 5381;
 	char const *ptr = *data;
-
-	for (; ptr < top && *ptr != '\n'; ptr++) {
-		ha += (ha << 5);
-		ha ^= (unsigned long) *ptr;
+	char const *eol = memchr(ptr, '\n', top - ptr);
+	char const *end = eol ? eol : top;
+	uint64_t ha = 5381 ^ ((uint64_t) (end - ptr) * XDL_HASH_MUL);
+	uint64_t word;
+
+	for (; end - ptr >= (int64_t) sizeof(word); ptr += sizeof(word)) {
+		memcpy(&word, ptr, sizeof(word));
+		ha = (ha ^ word) * XDL_HASH_MUL;
+		ha ^= ha >> 29;
+	}
+	if (ptr < end) {
+		word = 0;
+		memcpy(&word, ptr, end - ptr);
+		ha = (ha ^ word) * XDL_HASH_MUL;
 	}
-	*data = ptr < top ? ptr + 1: ptr;
+	*data = eol ? eol + 1 : top;
 
+	ha ^= ha >> 33;
+	ha *= 0xff51afd7ed558ccdULL;
+	ha ^= ha >> 33;
 	return ha;
 }
 
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+use std::env;
+use std::fs;
+
+use minibench::{bench, elapsed};
+use xdiff::diff_hunks;
+
+const LINE_COUNT: usize = 500_000;
+
+/// Small deterministic generator so that every run diffs the same texts.
+struct Lcg(u64);
+
+impl Lcg {
+    fn next(&mut self) -> u64 {
+        self.0 = self.0.wrapping_mul(6364136223846793005).wrapping_add(1);
+        self.0 >> 33
+    }
+}
+
+/// A pretty-printed JSON array of objects, like generated configs or API
+/// snapshots.
+fn generate_json(lines: usize) -> String {
+    let mut rng = Lcg(1);
+    let mut text = String::from("[\n");
+    for _ in 0..lines / 6 {
+        let id = rng.next();
+        text.push_str("  {\n");
+        text.push_str(&format!("    \"id\": {},\n", id));
+        text.push_str(&format!("    \"name\": \"item-{:x}\",\n", rng.next()));
+        text.push_str(&format!("    \"enabled\": {},\n", id % 2 == 0));
+        text.push_str(&format!("    \"weight\": {}.{}\n", id % 100, rng.next() % 1000));
+        text.push_str("  },\n");
+    }
+    text.push_str("]\n");
+    text
+}
+
+/// A lockfile with one resolved package per stanza.
+fn generate_lockfile(lines: usize) -> String {
+    let mut rng = Lcg(2);
+    let mut text = String::new();
+    for _ in 0..lines / 5 {
+        let package = rng.next();
+        text.push_str(&format!("\"package-{:x}@^{}.0.0\":\n", package, package % 20));
+        text.push_str(&format!("  version \"{}.{}.{}\"\n", package % 20, rng.next() % 50, 0));
+        text.push_str(&format!(
+            "  resolved \"https://registry.example.com/package-{:x}/-/{:x}.tgz#{:016x}\"\n",
+            package,
+            package,
+            rng.next()
+        ));
+        text.push_str(&format!("  integrity sha512-{:016x}{:016x}==\n\n", rng.next(), rng.next()));
+    }
+    text
+}
+
+/// Changes about one line in every `every`, as an upgrade or regeneration
+/// would.
+fn edit(text: &str, every: u64) -> String {
+    let mut rng = Lcg(3);
+    let mut result = String::with_capacity(text.len());
+    for line in text.lines() {
+        match rng.next() % every {
+            0 => {}
+            1 => {
+                result.push_str(line);
+                result.push_str(" changed\n");
+            }
+            2 => {
+                result.push_str(line);
+                result.push_str("\ninserted\n");
+            }
+            _ => {
+                result.push_str(line);
+                result.push('\n');
+            }
+        }
+    }
+    result
+}
+
+fn bench_pair(name: &str, old: &[u8], new: &[u8]) {
+    bench(name, || {
+        elapsed(|| {
+            diff_hunks(old, new);
+        })
+    });
+}
+
+fn main() {
+    let json = generate_json(LINE_COUNT);
+    let lockfile = generate_lockfile(LINE_COUNT);
+
+    bench_pair("json, identical", json.as_bytes(), json.as_bytes());
+    for &every in &[1000, 20] {
+        let edited = edit(&json, every);
+        let name = format!("json, 1 in {} lines edited", every);
+        bench_pair(&name, json.as_bytes(), edited.as_bytes());
+    }
+    for &every in &[1000, 20] {
+        let edited = edit(&lockfile, every);
+        let name = format!("lockfile, 1 in {} lines edited", every);
+        bench_pair(&name, lockfile.as_bytes(), edited.as_bytes());
+    }
+
+    // Real-world pairs can be given as "old:new" paths separated by commas.
+    if let Ok(pairs) = env::var("XDIFF_BENCH_PAIRS") {
+        for pair in pairs.split(',').filter(|pair| !pair.is_empty()) {
+            let mut paths = pair.splitn(2, ':');
+            let (old_path, new_path) = match (paths.next(), paths.next()) {
+                (Some(old), Some(new)) => (old, new),
+                _ => panic!("XDIFF_BENCH_PAIRS entry {:?} is not old:new", pair),
+            };
+            let old = fs::read(old_path).expect("cannot read old file");
+            let new = fs::read(new_path).expect("cannot read new file");
+            bench_pair(pair, &old, &new);
+        }
+    }
+}
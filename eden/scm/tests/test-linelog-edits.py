@@ -14,6 +14,8 @@ maxlinenum = 0xFFFFFF
 maxb1 = 0xFFFFFF
 maxdeltaa = 10  # max(a2 - b1)
 maxdeltab = 10  # max(b2 - b1)
+maxhunks = 8  # max(len(hunks)) of a replacelines_batch
+maxgap = 20  # max unchanged lines between two hunks of a batch
 
 
 def generator(seed=None, endrev=None):  # generate test cases
@@ -36,6 +38,41 @@ def generator(seed=None, endrev=None):  # generate test cases
         yield lines, rev, a1, a2, b1, b2, blines, usevec
 
 
+def batchgenerator(seed=None, endrev=None):  # generate batched test cases
+    lines = []
+    random.seed(seed)
+    rev = 0
+    while rev != endrev:
+        rev += 1
+        n = len(lines)
+        usevec = not bool(randint(0, vecratio))
+        hunks = []
+        hunkblines = []
+        a = 0
+        offset = 0  # b1 - a1, as in a diff
+        for _ in range(randint(1, maxhunks)):
+            if a > n:
+                break
+            a1 = randint(a, min(n, a + maxgap))
+            a2 = randint(a1, min(n, a1 + maxdeltaa))
+            b1 = a1 + offset
+            b2 = randint(b1 if a2 > a1 else b1 + 1, b1 + maxdeltab)
+            if usevec:
+                blines = [
+                    (randint(0, rev), randint(0, maxlinenum)) for _ in range(b1, b2)
+                ]
+            else:
+                blines = [(rev, bidx) for bidx in range(b1, b2)]
+            hunks.append((a1, a2, b1, b2))
+            hunkblines.append(blines)
+            offset += (b2 - b1) - (a2 - a1)
+            # a diff separates hunks by at least one unchanged line
+            a = a2 + 1
+        for (a1, a2, b1, b2), blines in reversed(list(zip(hunks, hunkblines))):
+            lines[a1:a2] = blines
+        yield lines, rev, hunks, hunkblines, usevec
+
+
 def ensure(condition):
     if not condition:
         raise RuntimeError("Unexpected")
@@ -66,3 +103,47 @@ for lines, rev, a1, a2, b1, b2, blines, usevec in generator(seed, endrev):
 for lines, rev, a1, a2, b1, b2, blines, usevec in generator(seed, endrev):
     log.annotate(rev)
     ensure(lines == log.annotateresult)
+
+# replacelines_batch matches replacelines called for each hunk from the last
+# to the first, both in the annotate result and in the instructions written
+batchlog = linelog.linelog()
+seqlog = linelog.linelog()
+cachedlog = linelog.linelog(cacheannotate=True)
+for llog in (batchlog, seqlog, cachedlog):
+    llog.annotate(0)
+batchrevs = []
+for lines, rev, hunks, hunkblines, usevec in batchgenerator(seed, endrev):
+    batchrevs.append(list(lines))
+    if usevec:
+        batchlog.replacelines_batch(rev, hunks, hunkblines)
+        cachedlog.replacelines_batch(rev, hunks, hunkblines)
+    else:
+        batchlog.replacelines_batch(rev, hunks)
+        cachedlog.replacelines_batch(rev, hunks)
+    for (a1, a2, b1, b2), blines in reversed(list(zip(hunks, hunkblines))):
+        if usevec:
+            seqlog.replacelines_vec(rev, a1, a2, blines)
+        else:
+            seqlog.replacelines(rev, a1, a2, b1, b2)
+    ensure(lines == batchlog.annotateresult)
+    ensure(lines == seqlog.annotateresult)
+    ensure(lines == cachedlog.annotateresult)
+    ensure(batchlog.actualsize == seqlog.actualsize)
+
+    # annotating an older revision through the cache, after the buffer has
+    # changed, matches annotating it without the cache
+    old = randint(1, rev)
+    cachedlog.annotate(old)
+    ensure(batchrevs[old - 1] == cachedlog.annotateresult)
+    cachedlog.annotate(rev)
+    ensure(lines == cachedlog.annotateresult)
+ensure(batchlog.getalllines() == seqlog.getalllines())
+
+# cached annotate results match plain ones, including revisions annotated
+# repeatedly and ones evicted from the cache
+for _ in range(4 * len(batchrevs)):
+    rev = randint(1, len(batchrevs))
+    batchlog.annotate(rev)
+    cachedlog.annotate(rev)
+    ensure(batchrevs[rev - 1] == batchlog.annotateresult)
+    ensure(batchlog.annotateresult == cachedlog.annotateresult)
@@ -0,0 +1,134 @@
+# test the persistent nodemap of revlog indexes
+
+from __future__ import absolute_import
+
+import hashlib
+import shutil
+import tempfile
+import unittest
+
+from edenscm.mercurial import revlog, transaction, vfs
+from edenscm.mercurial.node import nullid
+from edenscmnative import parsers
+from hghave import require
+
+
+require(["py2"])
+
+
+class testnodemap(unittest.TestCase):
+    def setUp(self):
+        self._testdir = tempfile.mkdtemp("revlognodemaptest")
+        self.vfs = vfs.vfs(self._testdir)
+        self.vfs.options = {
+            "revlogv1": True,
+            "generaldelta": True,
+            "persistentnodemap": True,
+        }
+
+    def tearDown(self):
+        shutil.rmtree(self._testdir, True)
+
+    def newrevlog(self):
+        rlog = revlog.revlog(self.vfs, "_testrevlog.i", mmaplargeindex=True)
+        # Rewrite the nodemap after every transaction.
+        rlog._nodemaprewriterevs = 1
+        return rlog
+
+    def addrevs(self, rlog, texts):
+        report = lambda msg: None
+        tr = transaction.transaction(
+            report, self.vfs, {"plain": self.vfs}, "journal"
+        )
+        try:
+            for text in texts:
+                p1 = rlog.node(len(rlog) - 1) if len(rlog) else nullid
+                rlog.addrevision(text, tr, len(rlog), p1, nullid)
+            tr.close()
+        finally:
+            tr.release()
+
+    def strip(self, rlog, minlink):
+        report = lambda msg: None
+        tr = transaction.transaction(
+            report, self.vfs, {"plain": self.vfs}, "journal"
+        )
+        try:
+            rlog.strip(minlink, tr)
+            tr.close()
+        finally:
+            tr.release()
+
+    def assertnodes(self, rlog):
+        for rev in range(len(rlog)):
+            self.assertEqual(rlog.rev(rlog.node(rev)), rev)
+
+    def testwriteandreload(self):
+        rlog = self.newrevlog()
+        self.addrevs(rlog, [b"rev %d\n" % i for i in range(10)])
+        self.assertTrue(self.vfs.exists("_testrevlog.n"))
+
+        reloaded = self.newrevlog()
+        self.assertEqual(reloaded._nodemaprevs, 10)
+        self.assertnodes(reloaded)
+
+    def testappendpaststoredcount(self):
+        rlog = self.newrevlog()
+        self.addrevs(rlog, [b"rev %d\n" % i for i in range(10)])
+        rlog._nodemaprewriterevs = 1000
+        self.addrevs(rlog, [b"more %d\n" % i for i in range(5)])
+
+        # The nodemap still covers the first 10 revisions, and the others are
+        # inserted when it is loaded.
+        reloaded = self.newrevlog()
+        self.assertEqual(reloaded._nodemaprevs, 10)
+        self.assertEqual(len(reloaded), 15)
+        self.assertnodes(reloaded)
+
+    def teststripinvalidates(self):
+        rlog = self.newrevlog()
+        self.addrevs(rlog, [b"rev %d\n" % i for i in range(10)])
+        self.strip(rlog, 5)
+        rlog._nodemaprewriterevs = 1000
+        self.addrevs(rlog, [b"other %d\n" % i for i in range(5)])
+
+        # Same number of revisions, but the nodemap no longer matches them.
+        reloaded = self.newrevlog()
+        self.assertEqual(len(reloaded), 10)
+        self.assertEqual(reloaded._nodemaprevs, 0)
+        self.assertnodes(reloaded)
+
+        # The next write replaces it.
+        reloaded._nodemaprewriterevs = 1
+        self.addrevs(reloaded, [b"last\n"])
+        self.assertEqual(self.newrevlog()._nodemaprevs, 11)
+
+    def testreorderedentriesinvalidate(self):
+        def entry(rev, node):
+            data = revlog.indexformatng_pack(
+                rev * 10 << 16, 10, 10, rev, rev, rev - 1, -1, node
+            )
+            if rev == 0:
+                data = revlog.versionformat_pack(revlog.REVLOGV1) + data[4:]
+            return data
+
+        nodes = [hashlib.sha1(b"%d" % i).digest() for i in range(10)]
+        data = b"".join(entry(rev, node) for rev, node in enumerate(nodes))
+        index, cache = parsers.parse_index2(data, False)
+        nodemap = index.nodemapdata()
+
+        index, cache = parsers.parse_index2(data, False)
+        self.assertEqual(index.loadnodemap(nodemap), 10)
+
+        # Swap two revisions in the middle, keeping the count and the tip.
+        nodes[3], nodes[4] = nodes[4], nodes[3]
+        data = b"".join(entry(rev, node) for rev, node in enumerate(nodes))
+        index, cache = parsers.parse_index2(data, False)
+        self.assertIsNone(index.loadnodemap(nodemap))
+        self.assertEqual(index[nodes[3]], 3)
+
+
+if __name__ == "__main__":
+    import silenttestrunner
+
+    silenttestrunner.main(__name__)